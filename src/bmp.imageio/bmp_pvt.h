@@ -34,6 +34,7 @@
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/fmath.h"
+#include "../libOpenImageIO/palette_pvt.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -150,6 +151,7 @@ class BmpInput : public ImageInput {
     bmp_pvt::DibInformationHeader m_dib_header;
     std::string m_filename;
     std::vector<bmp_pvt::color_table> m_colortable;
+    palette_pvt::Palette m_palette;   ///< m_colortable as RGBA, for lookups
     fpos_t m_image_start;
     void init (void) {
         m_scanline_size = 0;
@@ -157,6 +159,7 @@ class BmpInput : public ImageInput {
         m_fd = NULL;
         m_filename.clear ();
         m_colortable.clear ();
+        m_palette.clear ();
     }
 
     bool read_color_table (void);
@@ -44,6 +44,9 @@ OIIO_PLUGIN_EXPORTS_BEGIN
     OIIO_EXPORT const char *bmp_input_extensions[] = {
         "bmp", NULL
     };
+    OIIO_EXPORT const char *bmp_input_magic[] = {
+        "424d", "4241", "4349", "4350", "5054", NULL
+    };
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -174,6 +177,13 @@ BmpInput::read_native_scanline (int y, int z, void *data)
         return true;
     }
 
+    if (m_dib_header.bpp <= 8) {
+        palette_pvt::expand_packed (m_palette, &fscanline[0],
+                                    m_dib_header.bpp, m_spec.width,
+                                    m_spec.nchannels, (unsigned char *)data);
+        return true;
+    }
+
     std::vector<unsigned char> mscanline (m_spec.scanline_bytes());
     if (m_dib_header.bpp == 16) {
         const uint16_t RED = 0x7C00;
@@ -186,39 +196,6 @@ BmpInput::read_native_scanline (int y, int z, void *data)
             mscanline[j+2] = (uint8_t)(pixel & BLUE);
         }
     }
-    if (m_dib_header.bpp == 8) {
-        for (unsigned int i = 0, j = 0; j < m_spec.scanline_bytes(); ++i, j+=3) {
-            mscanline[j] = m_colortable[fscanline[i]].r;
-            mscanline[j+1] = m_colortable[fscanline[i]].g;
-            mscanline[j+2] = m_colortable[fscanline[i]].b;
-        }
-    }
-    if (m_dib_header.bpp == 4) {
-        for (unsigned int i = 0, j = 0; j + 6 < m_spec.scanline_bytes(); ++i, j+=6) {
-            uint8_t mask = 0xF0;
-            mscanline[j] = m_colortable[(fscanline[i] & mask) >> 4].r;
-            mscanline[j+1] = m_colortable[(fscanline[i] & mask) >> 4].g;
-            mscanline[j+2] = m_colortable[(fscanline[i] & mask) >> 4].b;
-            mask = 0x0F;
-            mscanline[j+3] = m_colortable[fscanline[i] & mask].r;
-            mscanline[j+4] = m_colortable[fscanline[i] & mask].g;
-            mscanline[j+5] = m_colortable[fscanline[i] & mask].b;
-        }
-    }
-    if (m_dib_header.bpp == 1) {
-        for (unsigned int i = 0, k = 0; i < fscanline.size (); ++i) {
-            for (int j = 7; j >= 0; --j, k+=3) {
-                if (k + 2 >= mscanline.size())
-                    break;
-                int index = 0;
-                if (fscanline[i] & (1 << j))
-                    index = 1;
-                mscanline[k] = m_colortable[index].r;
-                mscanline[k+1] = m_colortable[index].g;
-                mscanline[k+2] = m_colortable[index].b;
-            }
-        }
-    }
     memcpy (data, &mscanline[0], m_spec.scanline_bytes());
     return true;
 }
@@ -261,6 +238,8 @@ BmpInput::read_color_table (void)
                 error ("read error while reading color table");
             return false;   // Read failed
         }
+        m_palette.set (i, m_colortable[i].r, m_colortable[i].g,
+                       m_colortable[i].b);
     }
     return true;  // ok
 }
@@ -28,13 +28,17 @@
   (This is the Modified BSD License)
 */
 
+#include <memory>
+
 #include "libcineon/Cineon.h"
+#include "libcineon/ReaderInternal.h"
 
 #include "OpenImageIO/dassert.h"
 #include "OpenImageIO/typedesc.h"
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/strutil.h"
+#include "OpenImageIO/parallel.h"
 
 using namespace cineon;
 
@@ -49,6 +53,8 @@ public:
     virtual bool open (const std::string &name, ImageSpec &newspec);
     virtual bool close ();
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
 
 private:
     InStream *m_stream;
@@ -66,6 +72,12 @@ private:
         m_userBuf.clear ();
     }
 
+    /// Read scanlines [y0,y1) of 10-bit filled or 10/12-bit packed data
+    /// with one read of the file, then unpack groups of lines in
+    /// parallel.  Return false, having read nothing, for any other
+    /// layout; otherwise set ok.
+    bool read_packed_scanlines (int y0, int y1, void *data, bool &ok);
+
     /// Helper function - retrieve string for libcineon descriptor
     ///
     char *get_descriptor_string (cineon::Descriptor c);
@@ -85,6 +97,9 @@ OIIO_EXPORT const char* cineon_imageio_library_version () { return NULL; }
 OIIO_EXPORT const char * cineon_input_extensions[] = {
     "cin", NULL
 };
+OIIO_EXPORT const char * cineon_input_magic[] = {
+    "802a5fd7", "d75f2a80", NULL
+};
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -435,6 +450,78 @@ CineonInput::read_native_scanline (int y, int z, void *data)
 
 
 
+bool
+CineonInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    // libcineon can read a block of many lines in one call, so hand it
+    // the whole range instead of going a line at a time.  Its line
+    // offsets are only right for multi-line blocks when there is no end
+    // of line padding, so padded files still go line by line.
+    yend = std::min (yend, m_spec.y+m_spec.height);
+    if (yend - ybegin < 2 || m_cin.header.EndOfLinePadding () != 0)
+        return ImageInput::read_native_scanlines (ybegin, yend, z, data);
+    bool ok = true;
+    if (read_packed_scanlines (ybegin, yend, data, ok))
+        return ok;
+    cineon::Block block(0, ybegin, m_cin.header.Width () - 1, yend - 1);
+    return m_cin.ReadBlock (data, m_cin.header.ComponentDataSize (0), block);
+}
+
+
+
+bool
+CineonInput::read_packed_scanlines (int y0, int y1, void *data, bool &ok)
+{
+    // FIXME: like libcineon, assume all the elements match element 0
+    const cineon::Header &h (m_cin.header);
+    const int bits = h.BitDepth (0);
+    const cineon::Packing packing = h.ImagePacking ();
+    const int datums = h.Width () * h.NumberOfElements ();
+    bool filled = (bits == 10 && (packing == cineon::kLongWordLeft ||
+                                  packing == cineon::kLongWordRight));
+    bool packed = ((bits == 10 || bits == 12) && packing == cineon::kPacked);
+    // Same limits as the unpacking fast paths in ReaderInternal.h
+    if (! (filled || packed) || m_spec.format != TypeDesc::UINT16 ||
+        h.ComponentDataSize (0) != cineon::kWord ||
+        (packed && ! littleendian()))
+        return false;
+
+    size_t linebytes = filled ? size_t((datums - 1) / 3 + 1) * 4
+                              : size_t(datums * bits + 31) / 32 * 4;
+    int nlines = y1 - y0;
+    std::unique_ptr<unsigned char[]> raw (new unsigned char [linebytes * nlines]);
+    if (! m_stream->Seek (long(h.ImageOffset () + y0 * linebytes),
+                          InStream::kStart) ||
+        m_stream->Read (raw.get(), linebytes * nlines) != linebytes * nlines) {
+        error ("Read error");
+        ok = false;
+        return true;
+    }
+    if (h.RequiresByteSwap ())
+        swap_endian ((unsigned int *)raw.get(), int(linebytes * nlines / 4));
+
+    int64_t minlines = std::max (1, 16384 / std::max (1, datums));
+    parallel_for_chunked (0, nlines, threads() == 1 ? nlines : minlines,
+                          [&](int, int64_t b, int64_t e) {
+        for (int64_t l = b;  l < e;  ++l) {
+            const cineon::U32 *in = (const cineon::U32 *)(raw.get() + l * linebytes);
+            cineon::U16 *out = (cineon::U16 *)data + l * datums;
+            if (packed && bits == 10)
+                cineon::UnPackLinePacked<10> (in, out, datums);
+            else if (packed)
+                cineon::UnPackLinePacked<12> (in, out, datums);
+            else if (packing == cineon::kLongWordLeft)
+                cineon::UnfillLine10bitFilled<PADDINGBITS_10BITFILLEDMETHODA> (in, out, datums);
+            else
+                cineon::UnfillLine10bitFilled<PADDINGBITS_10BITFILLEDMETHODB> (in, out, datums);
+        }
+    });
+    ok = true;
+    return true;
+}
+
+
+
 char *
 CineonInput::get_descriptor_string (cineon::Descriptor c)
 {
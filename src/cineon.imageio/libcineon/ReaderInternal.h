@@ -39,6 +39,8 @@
 
 #include <algorithm>
 #include "BaseTypeConverter.h"
+#include "OpenImageIO/platform.h"
+#include "OpenImageIO/simd.h"
 
 
 #define PADDINGBITS_10BITFILLEDMETHODA	2
@@ -60,6 +62,59 @@
 namespace cineon
 {
 
+	// Fast path for Read10bitFilled: unpack a whole line of count 10-bit
+	// filled datums into U16, a word (three datums) at a time rather than
+	// dividing out each datum's position.  Returns false, having done
+	// nothing, for other output types.
+	template <int PADDINGBITS, typename BUF>
+	inline bool UnfillLine10bitFilled(const U32 *readBuf, BUF *obuf, int count)
+	{
+		return false;
+	}
+
+	template <int PADDINGBITS>
+	inline bool UnfillLine10bitFilled(const U32 *readBuf, U16 *obuf, int count)
+	{
+		int i = 0, w = 0;
+#if OIIO_SIMD_SSE >= 3
+		// four words make twelve datums: shift and widen the three datums
+		// of each word in 32-bit lanes, then shuffle them into order
+		const __m128i mask = _mm_set1_epi32(0x3ff);
+		const __m128i alo = _mm_setr_epi8(0, 1, 2, 3, -1, -1, 4, 5, 6, 7, -1, -1, 8, 9, 10, 11);
+		const __m128i clo = _mm_setr_epi8(-1, -1, -1, -1, 0, 1, -1, -1, -1, -1, 4, 5, -1, -1, -1, -1);
+		const __m128i ahi = _mm_setr_epi8(-1, -1, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+		const __m128i chi = _mm_setr_epi8(8, 9, -1, -1, -1, -1, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+		for ( ; i + 12 <= count; i += 12, w += 4)
+		{
+			__m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(readBuf + w));
+			__m128i a = _mm_and_si128(_mm_srli_epi32(words, 20 + PADDINGBITS), mask);
+			__m128i b = _mm_and_si128(_mm_srli_epi32(words, 10 + PADDINGBITS), mask);
+			__m128i c = _mm_and_si128(_mm_srli_epi32(words, PADDINGBITS), mask);
+			// BaseTypeConvertU10ToU16
+			a = _mm_or_si128(_mm_slli_epi32(a, 6), _mm_srli_epi32(a, 4));
+			b = _mm_or_si128(_mm_slli_epi32(b, 6), _mm_srli_epi32(b, 4));
+			c = _mm_or_si128(_mm_slli_epi32(c, 6), _mm_srli_epi32(c, 4));
+			__m128i ab = _mm_or_si128(a, _mm_slli_epi32(b, 16));
+			__m128i lo = _mm_or_si128(_mm_shuffle_epi8(ab, alo), _mm_shuffle_epi8(c, clo));
+			__m128i hi = _mm_or_si128(_mm_shuffle_epi8(ab, ahi), _mm_shuffle_epi8(c, chi));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(obuf + i), lo);
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(obuf + i + 8), hi);
+		}
+#endif
+		for (int k = 0; i < count; ++i)
+		{
+			U16 d = U16(readBuf[w] >> ((2 - k) * 10 + PADDINGBITS) & 0x3ff);
+			BaseTypeConvertU10ToU16(d, obuf[i]);
+			if (++k == 3)
+			{
+				k = 0;
+				++w;
+			}
+		}
+		return true;
+	}
+
+
 	template <typename IR, typename BUF, int PADDINGBITS>
 	bool Read10bitFilled(const Header &dpxHeader, U32 *readBuf, IR *fd, const Block &block, BUF *data)
 	{
@@ -108,6 +163,10 @@ namespace cineon
 			BUF *obuf = data + bufoff;
 			int index = (block.x1 * sizeof(U32)) % numberOfComponents;
 
+			if (block.x1 == 0 &&
+				UnfillLine10bitFilled<PADDINGBITS>(readBuf, obuf, (block.x2 + 1) * numberOfComponents))
+				continue;
+
 			for (int count = (block.x2 - block.x1 + 1) * numberOfComponents - 1; count >= 0; count--)
 			{
 				// unpacking the buffer backwords
@@ -186,6 +245,45 @@ namespace cineon
 	}
 
 
+	// Fast path for ReadPacked: unpack count 10 or 12-bit packed datums
+	// that start at the beginning of readBuf into U16, pulling the bits
+	// through a 64-bit window instead of locating each datum's bytes.
+	// This matches UnPackPacked's byte addressing on little endian hosts
+	// only; elsewhere, and for other output types, it returns false and
+	// does nothing.
+	template <int BITDEPTH, typename BUF>
+	inline bool UnPackLinePacked(const U32 *readBuf, BUF *obuf, int count)
+	{
+		return false;
+	}
+
+	template <int BITDEPTH>
+	inline bool UnPackLinePacked(const U32 *readBuf, U16 *obuf, int count)
+	{
+		if (! OIIO::littleendian())
+			return false;
+		const unsigned long long mask = (1 << BITDEPTH) - 1;
+		unsigned long long bits = 0;
+		int nbits = 0;
+		for (int i = 0; i < count; i++)
+		{
+			if (nbits < BITDEPTH)
+			{
+				bits |= static_cast<unsigned long long>(*readBuf++) << nbits;
+				nbits += 32;
+			}
+			U16 d = U16(bits & mask);
+			bits >>= BITDEPTH;
+			nbits -= BITDEPTH;
+			if (BITDEPTH == 10)
+				BaseTypeConvertU10ToU16(d, obuf[i]);
+			else
+				BaseTypeConvertU12ToU16(d, obuf[i]);
+		}
+		return true;
+	}
+
+
 	template <typename IR, typename BUF, U32 MASK, int MULTIPLIER, int REMAIN, int REVERSE>
 	bool ReadPacked(const Header &dpxHeader, U32 *readBuf, IR *fd, const Block &block, BUF *data)
 	{
@@ -224,6 +322,10 @@ namespace cineon
 
 			// unpack the words in the buffer
 			int count = (block.x2 - block.x1 + 1) * numberOfComponents;
+			if (block.x1 == 0 && (dataSize == 10 || dataSize == 12) &&
+				(dataSize == 10 ? UnPackLinePacked<10>(readBuf, data + bufoff, count)
+				                : UnPackLinePacked<12>(readBuf, data + bufoff, count)))
+				continue;
 			UnPackPacked<BUF, MASK, MULTIPLIER, REMAIN, REVERSE>(readBuf, dataSize, data, count, bufoff);
 		}
 
@@ -38,8 +38,7 @@
 #include "OpenImageIO/typedesc.h"
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/fmath.h"
-
-#include "squish/squish.h"
+#include "OpenImageIO/parallel.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -54,6 +53,8 @@ public:
     virtual ~DDSInput () { close(); }
     virtual const char * format_name (void) const { return "dds"; }
     virtual bool open (const std::string &name, ImageSpec &newspec);
+    virtual bool open (const std::string &name, ImageSpec &newspec,
+                       const ImageSpec &config);
     virtual bool close ();
     virtual int current_subimage (void) const { return m_subimage; }
     virtual int current_miplevel (void) const { return m_miplevel; }
@@ -74,6 +75,7 @@ private:
     int m_greenL, m_greenR;           ///< Bit shifts to extract green channel
     int m_blueL, m_blueR;             ///< Bit shifts to extract blue channel
     int m_alphaL, m_alphaR;           ///< Bit shifts to extract alpha channel
+    bool m_raw_blocks;                ///< Hand out compressed blocks as-is
 
     dds_header m_dds;                 ///< DDS header
 
@@ -84,8 +86,17 @@ private:
         m_subimage = -1;
         m_miplevel = -1;
         m_buf.clear ();
+        m_raw_blocks = false;
     }
 
+    /// Bytes per 4x4 block of the compressed format, or 0 if the image
+    /// isn't compressed.
+    int block_bytes () const;
+
+    /// Size in the file of one w x h x d image (a single MIP level of a
+    /// single cube face).
+    size_t image_bytes (int w, int h, int d) const;
+
     /// Helper function: read the image as scanlines (all but cubemaps).
     ///
     bool readimg_scanlines ();
@@ -130,11 +141,194 @@ OIIO_EXPORT const char* dds_imageio_library_version () { return NULL; }
 OIIO_EXPORT const char * dds_input_extensions[] = {
     "dds", NULL
 };
+OIIO_EXPORT const char * dds_input_magic[] = {
+    "44445320", NULL
+};
 
 OIIO_PLUGIN_EXPORTS_END
 
 
 
+// BCn (a.k.a. DXTn) block decoders. They give bit-for-bit the same results
+// as squish::Decompress, but write straight into the destination image, so
+// that big images can be decoded a row of blocks per task.
+
+static inline void
+unpack_565 (const unsigned char *packed, unsigned char *colour)
+{
+    int value = packed[0] | (packed[1] << 8);
+    int r = (value >> 11) & 0x1f, g = (value >> 5) & 0x3f, b = value & 0x1f;
+    colour[0] = (unsigned char)((r << 3) | (r >> 2));
+    colour[1] = (unsigned char)((g << 2) | (g >> 4));
+    colour[2] = (unsigned char)((b << 3) | (b >> 2));
+    colour[3] = 255;
+}
+
+
+
+// Colour block of BC1, BC2 and BC3 -> 16 RGBA pixels. Only BC1 has the
+// 3-colour mode with punch-through alpha.
+static void
+decode_colour_block (const unsigned char *block, unsigned char *rgba,
+                     bool bc1)
+{
+    unsigned char codes[16];
+    unpack_565 (block, codes);
+    unpack_565 (block + 2, codes + 4);
+    int a = block[0] | (block[1] << 8);
+    int b = block[2] | (block[3] << 8);
+    bool punchthrough = bc1 && a <= b;
+    for (int i = 0; i < 3; ++i) {
+        int c = codes[i], d = codes[4 + i];
+        if (punchthrough) {
+            codes[8 + i] = (unsigned char)((c + d) / 2);
+            codes[12 + i] = 0;
+        } else {
+            codes[8 + i] = (unsigned char)((2 * c + d) / 3);
+            codes[12 + i] = (unsigned char)((c + 2 * d) / 3);
+        }
+    }
+    codes[8 + 3] = 255;
+    codes[12 + 3] = punchthrough ? 0 : 255;
+
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16)
+                     | (uint32_t(block[7]) << 24);
+    for (int i = 0; i < 16; ++i, indices >>= 2)
+        memcpy (rgba + 4 * i, codes + 4 * (indices & 3), 4);
+}
+
+
+
+// BC2 explicit 4-bit alpha -> the alpha bytes of 16 RGBA pixels.
+static void
+decode_explicit_alpha (const unsigned char *block, unsigned char *rgba)
+{
+    for (int i = 0; i < 8; ++i) {
+        int lo = block[i] & 0x0f, hi = block[i] & 0xf0;
+        rgba[8 * i + 3] = (unsigned char)(lo | (lo << 4));
+        rgba[8 * i + 7] = (unsigned char)(hi | (hi >> 4));
+    }
+}
+
+
+
+// Interpolated single channel block, as used for BC3 alpha, BC4 and both
+// channels of BC5. Writes 16 values, stride bytes apart.
+static void
+decode_channel_block (const unsigned char *block, unsigned char *out,
+                      int stride)
+{
+    int a0 = block[0], a1 = block[1];
+    unsigned char codes[8];
+    codes[0] = (unsigned char)a0;
+    codes[1] = (unsigned char)a1;
+    if (a0 <= a1) {
+        for (int i = 1; i < 5; ++i)
+            codes[1 + i] = (unsigned char)(((5 - i) * a0 + i * a1) / 5);
+        codes[6] = 0;
+        codes[7] = 255;
+    } else {
+        for (int i = 1; i < 7; ++i)
+            codes[1 + i] = (unsigned char)(((7 - i) * a0 + i * a1) / 7);
+    }
+    // 16 3-bit indices, in two groups of 8 packed into 3 bytes each
+    for (int g = 0; g < 2; ++g) {
+        const unsigned char *src = block + 2 + 3 * g;
+        uint32_t bits = src[0] | (src[1] << 8) | (src[2] << 16);
+        for (int i = 0; i < 8; ++i, bits >>= 3)
+            out[(8 * g + i) * stride] = codes[bits & 7];
+    }
+}
+
+
+
+// Decode one block into 16 pixels of nchans channels each.
+static void
+decode_block (const unsigned char *block, unsigned char *pixels,
+              uint32_t fourCC)
+{
+    switch (fourCC) {
+    case DDS_4CC_DXT1:
+        decode_colour_block (block, pixels, true);
+        break;
+    case DDS_4CC_DXT2:
+    case DDS_4CC_DXT3:
+        decode_colour_block (block + 8, pixels, false);
+        decode_explicit_alpha (block, pixels);
+        break;
+    case DDS_4CC_DXT4:
+    case DDS_4CC_DXT5:
+        decode_colour_block (block + 8, pixels, false);
+        decode_channel_block (block, pixels + 3, 4);
+        break;
+    case DDS_4CC_ATI1:
+    case DDS_4CC_BC4U:
+        decode_channel_block (block, pixels, 1);
+        break;
+    case DDS_4CC_ATI2:
+    case DDS_4CC_BC5U:
+        decode_channel_block (block, pixels, 2);
+        decode_channel_block (block + 8, pixels + 1, 2);
+        break;
+    }
+}
+
+
+
+// Decompress a w x h x d image stored as blocks of the given size into
+// nchans channel UINT8 pixels at dst. Rows of blocks are independent, so
+// for all but tiny images (i.e., the tail of the MIP chain) they are
+// spread across the thread pool.
+static void
+decode_blocks (const unsigned char *src, int blockbytes, uint32_t fourCC,
+               unsigned char *dst, int w, int h, int d, int nchans)
+{
+    int bw = (w + 3) / 4, bh = (h + 3) / 4;
+    int64_t rows = int64_t(bh) * d;
+    bool unpremult = (fourCC == DDS_4CC_DXT2 || fourCC == DDS_4CC_DXT4);
+    int64_t chunk = (int64_t(bw) * bh * d < 4096) ? rows : 0;
+    parallel_for_chunked (0, rows, chunk,
+                          [&](int id, int64_t rbegin, int64_t rend) {
+        unsigned char pixels[16 * 4];
+        for (int64_t row = rbegin; row < rend; ++row) {
+            int z = int(row / bh), by = int(row % bh);
+            const unsigned char *block = src + row * bw * blockbytes;
+            for (int bx = 0;  bx < bw;  ++bx, block += blockbytes) {
+                decode_block (block, pixels, fourCC);
+                if (unpremult) {
+                    // DXT2 and DXT4 hold pre-multiplied colour
+                    for (int i = 0; i < 16; ++i) {
+                        unsigned char *p = pixels + 4 * i;
+                        if (p[3])
+                            for (int c = 0; c < 3; ++c)
+                                p[c] = (unsigned char) std::min (255,
+                                              int(p[c]) * 255 / int(p[3]));
+                    }
+                }
+                int xn = std::min (4, w - 4 * bx);
+                for (int py = 0; py < 4 && 4 * by + py < h; ++py) {
+                    size_t y = size_t(z) * h + 4 * by + py;
+                    memcpy (dst + (y * w + 4 * bx) * nchans,
+                            pixels + 4 * py * nchans, xn * nchans);
+                }
+            }
+        }
+    });
+}
+
+
+
+bool
+DDSInput::open (const std::string &name, ImageSpec &newspec,
+                const ImageSpec &config)
+{
+    close ();
+    m_raw_blocks = config.get_int_attribute ("dds:rawblocks", 0) != 0;
+    return open (name, newspec);
+}
+
+
+
 bool
 DDSInput::open (const std::string &name, ImageSpec &newspec)
 {
@@ -145,6 +339,8 @@ DDSInput::open (const std::string &name, ImageSpec &newspec)
         error ("Could not open file \"%s\"", name.c_str());
         return false;
     }
+    m_subimage = -1;
+    m_miplevel = -1;
 
 // due to struct packing, we may get a corrupt header if we just load the
 // struct from file; to adress that, read every member individually
@@ -256,17 +452,25 @@ DDSInput::open (const std::string &name, ImageSpec &newspec)
         && m_dds.fmt.fourCC != DDS_4CC_DXT2
         && m_dds.fmt.fourCC != DDS_4CC_DXT3
         && m_dds.fmt.fourCC != DDS_4CC_DXT4
-        && m_dds.fmt.fourCC != DDS_4CC_DXT5) {
+        && m_dds.fmt.fourCC != DDS_4CC_DXT5
+        && m_dds.fmt.fourCC != DDS_4CC_ATI1
+        && m_dds.fmt.fourCC != DDS_4CC_BC4U
+        && m_dds.fmt.fourCC != DDS_4CC_ATI2
+        && m_dds.fmt.fourCC != DDS_4CC_BC5U) {
         error ("Unsupported compression type");
         return false;
     }
 
     // determine the number of channels we have
     if (m_dds.fmt.flags & DDS_PF_FOURCC) {
-        // squish decompresses everything to RGBA anyway
-        /*if (m_dds.fmt.fourCC == DDS_4CC_DXT1)
-            m_nchans = 3; // no alpha in DXT1
-        else*/
+        // BC1-3 decompress to RGBA (we don't know whether a DXT1 image
+        // actually uses its punch-through alpha), BC4 to one channel and
+        // BC5 to two
+        if (m_dds.fmt.fourCC == DDS_4CC_ATI1 || m_dds.fmt.fourCC == DDS_4CC_BC4U)
+            m_nchans = 1;
+        else if (m_dds.fmt.fourCC == DDS_4CC_ATI2 || m_dds.fmt.fourCC == DDS_4CC_BC5U)
+            m_nchans = 2;
+        else
             m_nchans = 4;
     } else {
         m_nchans = ((m_dds.fmt.flags & DDS_PF_LUMINANCE) ? 1 : 3)
@@ -302,11 +506,43 @@ DDSInput::open (const std::string &name, ImageSpec &newspec)
     seek_subimage(0, 0, m_spec);
 
     newspec = spec ();
+    if (m_raw_blocks && !block_bytes()) {
+        error ("\"%s\" is not block compressed", name.c_str());
+        return false;
+    }
+
     return true;
 }
 
 
 
+int
+DDSInput::block_bytes () const
+{
+    if (!(m_dds.fmt.flags & DDS_PF_FOURCC))
+        return 0;
+    switch (m_dds.fmt.fourCC) {
+    case DDS_4CC_DXT1:
+    case DDS_4CC_ATI1:
+    case DDS_4CC_BC4U:
+        return 8;
+    default:
+        return 16;
+    }
+}
+
+
+
+size_t
+DDSInput::image_bytes (int w, int h, int d) const
+{
+    if (int bb = block_bytes())
+        return size_t((w + 3) / 4) * size_t((h + 3) / 4) * d * bb;
+    return size_t(w) * h * d * m_Bpp;
+}
+
+
+
 inline void
 DDSInput::calc_shifts (int mask, int& left, int& right)
 {
@@ -359,26 +595,13 @@ DDSInput::internal_seek_subimage (int cubeface, int miplevel, unsigned int& w,
         // don't skip at all, so just add the offset and continue
         if (m_dds.mipmaps < 2) {
             if (j > 0) {
-                if (m_dds.fmt.flags & DDS_PF_FOURCC)
-                    // only check for DXT1 - all other formats have same block
-                    // size
-                    len = squish::GetStorageRequirements(w, h,
-                        m_dds.fmt.fourCC == DDS_4CC_DXT1 ? squish::kDxt1
-                        : squish::kDxt5);
-                else
-                     len = w * h * d * m_Bpp;
+                len = image_bytes (w, h, d);
                 ofs += len;
             }
             continue;
         }
         for (int i = 0; i < miplevel; i++) {
-            if (m_dds.fmt.flags & DDS_PF_FOURCC)
-                // only check for DXT1 - all other formats have same block size
-                len = squish::GetStorageRequirements(w, h,
-                    m_dds.fmt.fourCC == DDS_4CC_DXT1 ? squish::kDxt1
-                    : squish::kDxt5);
-            else
-                len = w * h * d * m_Bpp;
+            len = image_bytes (w, h, d);
             ofs += len;
             w >>= 1;
             if (!w)
@@ -436,20 +659,37 @@ DDSInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
             if (d < 1)
                 d = 1;
         }
+    } else {
+        internal_seek_subimage(0, miplevel, w, h, d);
+    }
+
+    // In raw block mode, each "pixel" is one 4x4 block, its bytes handed
+    // out untouched as an array of UINT8 so they can go straight to the
+    // GPU; otherwise pixels are decoded to UINT8.
+    unsigned int pw = w, ph = h;
+    int nchans = m_nchans;
+    TypeDesc format = TypeDesc::UINT8;
+    if (m_raw_blocks) {
+        w = (w + 3) / 4;
+        h = (h + 3) / 4;
+        nchans = 1;
+        format = TypeDesc (TypeDesc::UINT8, block_bytes());
+    }
+
+    if (m_dds.caps.flags2 & DDS_CAPS2_CUBEMAP) {
         // create imagespec for the 3x2 cube map layout
 #ifdef DDS_3X2_CUBE_MAP_LAYOUT
-        m_spec = ImageSpec (w * 3, h * 2, m_nchans, TypeDesc::UINT8);
+        m_spec = ImageSpec (w * 3, h * 2, nchans, format);
 #else   // 1x6 layout
-        m_spec = ImageSpec (w, h * 6, m_nchans, TypeDesc::UINT8);
+        m_spec = ImageSpec (w, h * 6, nchans, format);
 #endif // DDS_3X2_CUBE_MAP_LAYOUT
         m_spec.depth = d;
         m_spec.tile_width   = m_spec.full_width     = w;
         m_spec.tile_height  = m_spec.full_height    = h;
         m_spec.tile_depth   = m_spec.full_depth     = d;
     } else {
-        internal_seek_subimage(0, miplevel, w, h, d);
         // create imagespec
-        m_spec = ImageSpec (w, h, m_nchans, TypeDesc::UINT8);
+        m_spec = ImageSpec (w, h, nchans, format);
         m_spec.depth = d;
     }
 
@@ -464,6 +704,14 @@ DDSInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
     }
     m_spec.attribute ("oiio:BitsPerSample", m_dds.fmt.bpp);
     m_spec.default_channel_names ();
+    if (m_raw_blocks) {
+        m_spec.channelnames[0] = "block";
+        m_spec.attribute ("dds:BlockWidth", 4);
+        m_spec.attribute ("dds:BlockHeight", 4);
+        m_spec.attribute ("dds:BlockBytes", block_bytes());
+        m_spec.attribute ("dds:PixelWidth", (int)pw);
+        m_spec.attribute ("dds:PixelHeight", (int)ph);
+    }
 
     // detect texture type
     if (m_dds.caps.flags2 & DDS_CAPS2_VOLUME) {
@@ -517,53 +765,17 @@ DDSInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
 
 bool
 DDSInput::internal_readimg (unsigned char *dst, int w, int h, int d) {
+    if (m_raw_blocks) {
+        // w and h are already counted in blocks
+        return fread (dst, size_t(w) * h * d * block_bytes(), 1);
+    }
     if (m_dds.fmt.flags & DDS_PF_FOURCC) {
         // compressed image
-        int flags = 0;
-        switch (m_dds.fmt.fourCC) {
-            case DDS_4CC_DXT1:
-                flags = squish::kDxt1;
-                break;
-            // DXT2 and 3 are the same, only 2 has pre-multiplied alpha
-            case DDS_4CC_DXT2:
-            case DDS_4CC_DXT3:
-                flags = squish::kDxt3;
-                break;
-            // DXT4 and 5 are the same, only 4 has pre-multiplied alpha
-            case DDS_4CC_DXT4:
-            case DDS_4CC_DXT5:
-                flags = squish::kDxt5;
-                break;
-        }
-        // create source buffer
-        std::vector<squish::u8> tmp(squish::GetStorageRequirements
-                                    (w, h, flags));
-        // load image into buffer
+        std::vector<unsigned char> tmp (image_bytes (w, h, d));
         if (! fread (&tmp[0], tmp.size(), 1))
             return false;
-        // decompress image
-        squish::DecompressImage (dst, w, h,
-                                 &tmp[0], flags);
-        tmp.clear();
-        // correct pre-multiplied alpha, if necessary
-        if (m_dds.fmt.fourCC == DDS_4CC_DXT2
-            || m_dds.fmt.fourCC == DDS_4CC_DXT4) {
-            int k;
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    k = (y * w + x) * 4;
-                    dst[k + 0] =
-                        (unsigned char)((int)dst[k + 0] * 255
-                            / (int)dst[k + 3]);
-                    dst[k + 1] =
-                        (unsigned char)((int)dst[k + 1] * 255
-                            / (int)dst[k + 3]);
-                    dst[k + 2] =
-                        (unsigned char)((int)dst[k + 2] * 255
-                            / (int)dst[k + 3]);
-                }
-            }
-        }
+        decode_blocks (&tmp[0], block_bytes(), m_dds.fmt.fourCC,
+                       dst, w, h, d, m_nchans);
     } else {
         // uncompressed image
         
@@ -38,6 +38,12 @@
 #include "OpenImageIO/typedesc.h"
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/fmath.h"
+#include "OpenImageIO/filesystem.h"
+#include "OpenImageIO/strutil.h"
+#include "OpenImageIO/parallel.h"
+
+#include "squish/squish.h"
+#include "squish/alpha.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -48,20 +54,63 @@ public:
     DDSOutput ();
     virtual ~DDSOutput ();
     virtual const char * format_name (void) const { return "dds"; }
+    virtual int supports (string_view feature) const {
+        return (feature == "tiles"
+             || feature == "mipmap"
+             || feature == "alpha");
+    }
     virtual bool open (const std::string &name, const ImageSpec &spec,
                        OpenMode mode);
     virtual bool close ();
     virtual bool write_scanline (int y, int z, TypeDesc format,
                                  const void *data, stride_t xstride);
+    virtual bool write_tile (int x, int y, int z, TypeDesc format,
+                             const void *data, stride_t xstride,
+                             stride_t ystride, stride_t zstride);
 
 private:
     std::string m_filename;           ///< Stash the filename
     FILE *m_file;                     ///< Open image handle
     std::vector<unsigned char> m_scratch;
+    std::vector<unsigned char> m_buf; ///< Pixels of the current MIP level
+    uint32_t m_fourCC;                ///< Compression, or 0 for none
+    int m_squish_flags;               ///< Colour fit quality for squish
+    int m_miplevels;                  ///< MIP levels begun so far
+    int m_width, m_height;            ///< Resolution of the top level
+    int m_nchans;                     ///< Channels of the top level
 
     // Initialize private members to pre-opened state
     void init (void) {
         m_file = NULL;
+        m_buf.clear ();
+        m_fourCC = 0;
+        m_squish_flags = 0;
+        m_miplevels = 0;
+    }
+
+    /// Bytes per 4x4 block of the compression in use.
+    int block_bytes () const {
+        return (m_fourCC == DDS_4CC_DXT1 || m_fourCC == DDS_4CC_ATI1) ? 8 : 16;
+    }
+
+    /// Write (or, at close, rewrite) the file header.
+    bool write_header ();
+
+    /// Compress if needed and write out the buffered MIP level.
+    bool write_level ();
+
+    /// Helper: write, with error detection
+    bool fwrite (const void *buf, size_t itemsize, size_t nitems) {
+        size_t n = ::fwrite (buf, itemsize, nitems, m_file);
+        if (n != nitems)
+            error ("Write error");
+        return n == nitems;
+    }
+
+    bool write_uint32 (uint32_t v) {
+        if (bigendian())
+            swap_endian (&v);
+        return fwrite (&v, sizeof(v), 1);
     }
 };
 
@@ -83,6 +132,67 @@ OIIO_PLUGIN_EXPORTS_END
 
 
 
+// Map the "compression" attribute to a fourCC. DXT2 and DXT4 are written
+// as DXT3 and DXT5, since we always get un-premultiplied pixels. Anything
+// unrecognized (e.g. the "zip" that maketx asks for by default) means an
+// uncompressed file.
+static uint32_t
+compression_fourCC (string_view compression)
+{
+    if (Strutil::iequals (compression, "dxt1")
+        || Strutil::iequals (compression, "bc1"))
+        return DDS_4CC_DXT1;
+    if (Strutil::iequals (compression, "dxt2")
+        || Strutil::iequals (compression, "dxt3")
+        || Strutil::iequals (compression, "bc2"))
+        return DDS_4CC_DXT3;
+    if (Strutil::iequals (compression, "dxt4")
+        || Strutil::iequals (compression, "dxt5")
+        || Strutil::iequals (compression, "bc3"))
+        return DDS_4CC_DXT5;
+    if (Strutil::iequals (compression, "ati1")
+        || Strutil::iequals (compression, "bc4")
+        || Strutil::iequals (compression, "bc4u"))
+        return DDS_4CC_ATI1;
+    if (Strutil::iequals (compression, "ati2")
+        || Strutil::iequals (compression, "bc5")
+        || Strutil::iequals (compression, "bc5u"))
+        return DDS_4CC_ATI2;
+    return 0;
+}
+
+
+
+// Gather the 4x4 block at (bx,by) of an nchans UINT8 image as the RGBA
+// that squish wants, along with the mask of pixels inside the image.
+static int
+gather_block (const unsigned char *pixels, int width, int height,
+              int nchans, int bx, int by, unsigned char *rgba)
+{
+    int mask = 0;
+    for (int py = 0; py < 4; ++py) {
+        for (int px = 0; px < 4; ++px) {
+            int x = 4 * bx + px, y = 4 * by + py, i = 4 * py + px;
+            unsigned char *out = rgba + 4 * i;
+            if (x >= width || y >= height) {
+                out[0] = out[1] = out[2] = out[3] = 0;
+                continue;
+            }
+            mask |= 1 << i;
+            const unsigned char *p = pixels + (size_t(y) * width + x) * nchans;
+            if (nchans >= 3) {
+                out[0] = p[0];  out[1] = p[1];  out[2] = p[2];
+            } else {
+                out[0] = out[1] = out[2] = p[0];
+            }
+            out[3] = (nchans == 4) ? p[3] : (nchans == 2) ? p[1] : 255;
+        }
+    }
+    return mask;
+}
+
+
+
 DDSOutput::DDSOutput ()
 {
     init ();
@@ -102,9 +212,211 @@ bool
 DDSOutput::open (const std::string &name, const ImageSpec &userspec,
                  OpenMode mode)
 {
-    error ("DDS writing is not supported yet, please poke Leszek in the "
-        "mailing list");
-    return false;
+    if (mode == AppendSubimage) {
+        error ("%s does not support subimages", format_name());
+        return false;
+    }
+
+    if (mode == AppendMIPLevel) {
+        if (! m_file) {
+            error ("Cannot append a MIP level to a file that isn't open");
+            return false;
+        }
+        // Finish the previous level, then expect the next one to be half
+        // the size of it, as DDS readers compute the offsets that way.
+        if (! write_level ())
+            return false;
+        int w = std::max (1, m_spec.width / 2);
+        int h = std::max (1, m_spec.height / 2);
+        if (userspec.width != w || userspec.height != h
+            || userspec.nchannels != m_nchans) {
+            error ("DDS MIP level %d must be %dx%d with %d channels",
+                   m_miplevels, w, h, m_nchans);
+            return false;
+        }
+        m_spec = userspec;
+        m_spec.set_format (TypeDesc::UINT8);
+        m_buf.assign (m_spec.image_bytes(), 0);
+        ++m_miplevels;
+        return true;
+    }
+
+    close ();  // Close any already-opened file
+    m_spec = userspec;  // Stash the spec
+
+    if (m_spec.width < 1 || m_spec.height < 1) {
+        error ("Image resolution must be at least 1x1, you asked for %d x %d",
+               m_spec.width, m_spec.height);
+        return false;
+    }
+    if (m_spec.depth < 1)
+        m_spec.depth = 1;
+    if (m_spec.depth > 1) {
+        error ("%s does not support volume images (depth > 1)", format_name());
+        return false;
+    }
+    if (m_spec.nchannels < 1 || m_spec.nchannels > 4) {
+        error ("%s does not support %d-channel images", format_name(),
+               m_spec.nchannels);
+        return false;
+    }
+
+    std::string compression = m_spec.get_string_attribute ("compression");
+    if (Strutil::istarts_with (compression, "bc6")
+        || Strutil::istarts_with (compression, "bc7")) {
+        error ("%s compression is not supported", compression);
+        return false;
+    }
+    m_fourCC = compression_fourCC (compression);
+    std::string quality = m_spec.get_string_attribute ("dds:quality", "normal");
+    if (Strutil::iequals (quality, "fast"))
+        m_squish_flags = squish::kColourRangeFit;
+    else if (Strutil::iequals (quality, "best"))
+        m_squish_flags = squish::kColourIterativeClusterFit;
+    else
+        m_squish_flags = squish::kColourClusterFit;
+
+    // DDS only holds 8 bits per channel here
+    m_spec.set_format (TypeDesc::UINT8);
+    m_width = m_spec.width;
+    m_height = m_spec.height;
+    m_nchans = m_spec.nchannels;
+
+    m_filename = name;
+    m_file = Filesystem::fopen (name, "wb");
+    if (! m_file) {
+        error ("Could not open file \"%s\"", name.c_str());
+        return false;
+    }
+    // The header is written again at close, when we know how many MIP
+    // levels there are.
+    if (! write_header ())
+        return false;
+    m_buf.assign (m_spec.image_bytes(), 0);
+    m_miplevels = 1;
+    return true;
+}
+
+
+
+bool
+DDSOutput::write_header ()
+{
+    uint32_t flags = DDS_CAPS | DDS_HEIGHT | DDS_WIDTH | DDS_PIXELFORMAT;
+    uint32_t pitch, pfflags, bpp = 0;
+    uint32_t rmask = 0, gmask = 0, bmask = 0, amask = 0;
+    if (m_fourCC) {
+        flags |= DDS_LINEARSIZE;
+        pitch = uint32_t((m_width + 3) / 4) * ((m_height + 3) / 4)
+              * block_bytes();
+        pfflags = DDS_PF_FOURCC;
+    } else {
+        flags |= DDS_PITCH;
+        pitch = m_width * m_nchans;
+        bpp = 8 * m_nchans;
+        // channels are stored in order, R in the lowest byte
+        if (m_nchans <= 2) {
+            pfflags = DDS_PF_LUMINANCE;
+            rmask = 0x000000ff;
+        } else {
+            pfflags = DDS_PF_RGB;
+            rmask = 0x000000ff;
+            gmask = 0x0000ff00;
+            bmask = 0x00ff0000;
+        }
+        if (m_nchans == 2 || m_nchans == 4) {
+            pfflags |= DDS_PF_ALPHA;
+            amask = m_nchans == 2 ? 0x0000ff00 : 0xff000000;
+        }
+    }
+    uint32_t caps1 = DDS_CAPS1_TEXTURE;
+    if (m_miplevels > 1) {
+        flags |= DDS_MIPMAPCOUNT;
+        caps1 |= DDS_CAPS1_COMPLEX | DDS_CAPS1_MIPMAP;
+    }
+
+    fseek (m_file, 0, SEEK_SET);
+    bool ok = write_uint32 (DDS_MAKE4CC('D', 'D', 'S', ' '));
+    ok &= write_uint32 (124);
+    ok &= write_uint32 (flags);
+    ok &= write_uint32 (m_height);
+    ok &= write_uint32 (m_width);
+    ok &= write_uint32 (pitch);
+    ok &= write_uint32 (0);                   // depth
+    ok &= write_uint32 (m_miplevels > 1 ? m_miplevels : 0);
+    for (int i = 0; i < 11; ++i)
+        ok &= write_uint32 (0);               // reserved
+    ok &= write_uint32 (32);                  // pixel format size
+    ok &= write_uint32 (pfflags);
+    ok &= write_uint32 (m_fourCC);
+    ok &= write_uint32 (bpp);
+    ok &= write_uint32 (rmask);
+    ok &= write_uint32 (gmask);
+    ok &= write_uint32 (bmask);
+    ok &= write_uint32 (amask);
+    ok &= write_uint32 (caps1);
+    for (int i = 0; i < 4; ++i)
+        ok &= write_uint32 (0);               // caps2-4, reserved
+    fseek (m_file, 0, SEEK_END);
+    return ok;
+}
+
+
+
+bool
+DDSOutput::write_level ()
+{
+    int w = m_spec.width, h = m_spec.height, nchans = m_spec.nchannels;
+    if (! m_fourCC)
+        return fwrite (&m_buf[0], m_buf.size(), 1);
+
+    // Compress block by block. The fits are expensive and independent, so
+    // rows of blocks go to the thread pool, except for the small levels at
+    // the end of the MIP chain.
+    int bw = (w + 3) / 4, bh = (h + 3) / 4;
+    int bytes = block_bytes();
+    std::vector<unsigned char> blocks (size_t(bw) * bh * bytes);
+    uint32_t fourCC = m_fourCC;
+    int flags = m_squish_flags;
+    const unsigned char *pixels = &m_buf[0];
+    int64_t chunk = (int64_t(bw) * bh < 256) ? bh : 0;
+    parallel_for_chunked (0, bh, chunk,
+                          [&](int id, int64_t ybegin, int64_t yend) {
+        unsigned char rgba[16 * 4], channel[16 * 4];
+        for (int by = int(ybegin); by < int(yend); ++by) {
+            unsigned char *block = &blocks[size_t(by) * bw * bytes];
+            for (int bx = 0;  bx < bw;  ++bx, block += bytes) {
+                int mask = gather_block (pixels, w, h, nchans, bx, by, rgba);
+                switch (fourCC) {
+                case DDS_4CC_DXT1:
+                    squish::CompressMasked (rgba, mask, block,
+                                            squish::kDxt1 | flags);
+                    break;
+                case DDS_4CC_DXT3:
+                    squish::CompressMasked (rgba, mask, block,
+                                            squish::kDxt3 | flags);
+                    break;
+                case DDS_4CC_DXT5:
+                    squish::CompressMasked (rgba, mask, block,
+                                            squish::kDxt5 | flags);
+                    break;
+                case DDS_4CC_ATI1:
+                case DDS_4CC_ATI2:
+                    // Each BC4 channel is coded like DXT5 alpha, which
+                    // squish reads from the alpha byte of each pixel.
+                    for (int c = 0; c < (fourCC == DDS_4CC_ATI2 ? 2 : 1); ++c) {
+                        for (int i = 0; i < 16; ++i)
+                            channel[4 * i + 3] = (c == 0 || nchans >= 3)
+                                ? rgba[4 * i + c]
+                                : (nchans == 2 ? rgba[4 * i + 3] : 0);
+                        squish::CompressAlphaDxt5 (channel, mask, block + 8 * c);
+                    }
+                    break;
+                }
+            }
+        }
+    });
+    return fwrite (&blocks[0], blocks.size(), 1);
 }
 
 
@@ -112,7 +424,17 @@ DDSOutput::open (const std::string &name, const ImageSpec &userspec,
 bool
 DDSOutput::close ()
 {
-    return false;
+    if (! m_file) {   // already closed
+        init ();
+        return true;
+    }
+
+    bool ok = write_level ();
+    ok &= write_header ();
+    fclose (m_file);
+    m_file = NULL;
+    init ();
+    return ok;
 }
 
 
@@ -121,8 +443,27 @@ bool
 DDSOutput::write_scanline (int y, int z, TypeDesc format,
                             const void *data, stride_t xstride)
 {
-    return false;
+    y -= m_spec.y;
+    if (y < 0 || y >= m_spec.height) {
+        error ("Attempt to write scanline %d outside the image", y);
+        return false;
+    }
+    data = to_native_scanline (format, data, xstride, m_scratch);
+    memcpy (&m_buf[y * m_spec.scanline_bytes()], data,
+            m_spec.scanline_bytes());
+    return true;
+}
+
+
+
+bool
+DDSOutput::write_tile (int x, int y, int z, TypeDesc format,
+                       const void *data, stride_t xstride,
+                       stride_t ystride, stride_t zstride)
+{
+    // Emulate tiles by buffering the whole level
+    return copy_tile_to_image_buffer (x, y, z, format, data, xstride,
+                                      ystride, zstride, &m_buf[0]);
 }
 
 OIIO_PLUGIN_NAMESPACE_END
-
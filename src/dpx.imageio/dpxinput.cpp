@@ -30,13 +30,16 @@
 
 #include "libdpx/DPX.h"
 #include "libdpx/DPXColorConverter.h"
+#include "libdpx/ReaderInternal.h"
 #include <OpenEXR/ImfTimeCode.h> //For TimeCode support
 
 #include "OpenImageIO/typedesc.h"
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/strutil.h"
+#include "OpenImageIO/parallel.h"
 #include <iomanip>
+#include <memory>
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -52,6 +55,9 @@ public:
     virtual int current_subimage (void) const { return m_subimage; }
     virtual bool seek_subimage (int subimage, int miplevel, ImageSpec &newspec);
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
+    virtual bool raw_pixel_layout (int64_t &offset, stride_t &ystride);
 
 private:
     int m_subimage;
@@ -74,6 +80,12 @@ private:
         m_userBuf.clear ();
     }
 
+    /// Read scanlines [y0,y1) (relative to the image) of 10-bit filled
+    /// or 10/12-bit packed data with one read of the file, then unpack
+    /// and convert groups of lines in parallel.  Return false, having
+    /// read nothing, for any other layout; otherwise set ok.
+    bool read_packed_scanlines (int y0, int y1, void *data, bool &ok);
+
     /// Helper function - retrieve string for libdpx characteristic
     ///
     std::string get_characteristic_string (dpx::Characteristic c);
@@ -105,6 +117,9 @@ OIIO_EXPORT const char* dpx_imageio_library_version () { return NULL; }
 OIIO_EXPORT const char * dpx_input_extensions[] = {
     "dpx", NULL
 };
+OIIO_EXPORT const char * dpx_input_magic[] = {
+    "53445058", "58504453", NULL
+};
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -634,6 +649,127 @@ DPXInput::read_native_scanline (int y, int z, void *data)
 
 
 
+bool
+DPXInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    // libdpx can read and unpack a block of many lines in one call, so
+    // hand it the whole range instead of going a line at a time.  Its
+    // line offsets are only right for multi-line blocks when there is no
+    // end of line padding, so padded files still go line by line.
+    yend = std::min (yend, m_spec.y+m_spec.height);
+    if (yend - ybegin < 2 || m_dpx.header.EndOfLinePadding (m_subimage) != 0)
+        return ImageInput::read_native_scanlines (ybegin, yend, z, data);
+    bool ok = true;
+    if (read_packed_scanlines (ybegin-m_spec.y, yend-m_spec.y, data, ok))
+        return ok;
+    dpx::Block block(0, ybegin-m_spec.y, m_dpx.header.Width () - 1,
+                     yend-1-m_spec.y);
+    if (m_wantRaw)
+        return m_dpx.ReadBlock (m_subimage, (unsigned char *)data, block);
+
+    // read the scanlines and convert to RGB, via a buffer for the lot if
+    // the conversion can't be done in place
+    std::unique_ptr<unsigned char[]> buf;
+    void *ptr = data;
+    if (m_dataPtr) {
+        buf.reset (new unsigned char [dpx::QueryRGBBufferSize (m_dpx.header,
+                                                       m_subimage, block)]);
+        ptr = buf.get();
+    }
+    return m_dpx.ReadBlock (m_subimage, (unsigned char *)ptr, block) &&
+           dpx::ConvertToRGB (m_dpx.header, m_subimage, ptr, data, block);
+}
+
+
+
+bool
+DPXInput::read_packed_scanlines (int y0, int y1, void *data, bool &ok)
+{
+    const dpx::Header &h (m_dpx.header);
+    const int bits = h.BitDepth (m_subimage);
+    const dpx::Packing packing = h.ImagePacking (m_subimage);
+    const int nc = h.ImageElementComponentCount (m_subimage);
+    const int datums = h.Width () * nc;
+    bool filled = (bits == 10 && (packing == dpx::kFilledMethodA ||
+                                  packing == dpx::kFilledMethodB));
+    bool packed = ((bits == 10 || bits == 12) && packing == dpx::kPacked);
+    // Same limits as the unpacking fast paths in ReaderInternal.h
+    if (! (filled || packed) || h.ImageEncoding (m_subimage) == dpx::kRLE ||
+        m_spec.format != TypeDesc::UINT16 || (packed && ! littleendian()) ||
+        (filled && nc == 1 && datums % 3))
+        return false;
+
+    size_t linebytes = filled ? size_t((datums - 1) / 3 + 1) * 4
+                              : size_t(datums * bits + 31) / 32 * 4;
+    int nlines = y1 - y0;
+    std::unique_ptr<unsigned char[]> raw (new unsigned char [linebytes * nlines]);
+    if (! m_stream->Seek (long(h.DataOffset (m_subimage) + y0 * linebytes),
+                          InStream::kStart) ||
+        m_stream->Read (raw.get(), linebytes * nlines) != linebytes * nlines) {
+        error ("Read error");
+        ok = false;
+        return true;
+    }
+    if (h.RequiresByteSwap ())
+        swap_endian ((unsigned int *)raw.get(), int(linebytes * nlines / 4));
+
+    // Unpack into the caller's buffer, unless the descriptor needs a
+    // conversion that can't be done in place.
+    std::unique_ptr<unsigned short[]> tmp;
+    unsigned short *unpacked = (unsigned short *)data;
+    if (! m_wantRaw && m_dataPtr) {
+        tmp.reset (new unsigned short [size_t(datums) * nlines]);
+        unpacked = tmp.get();
+    }
+    size_t outbytes = m_spec.scanline_bytes (true);
+    int64_t minlines = std::max (1, 16384 / std::max (1, datums));
+    atomic_int failed (0);
+    parallel_for_chunked (0, nlines, threads() == 1 ? nlines : minlines,
+                          [&](int, int64_t b, int64_t e) {
+        for (int64_t l = b;  l < e;  ++l) {
+            const dpx::U32 *in = (const dpx::U32 *)(raw.get() + l * linebytes);
+            dpx::U16 *out = unpacked + l * datums;
+            if (packed && bits == 10)
+                dpx::UnPackLinePacked<10> (in, out, datums);
+            else if (packed)
+                dpx::UnPackLinePacked<12> (in, out, datums);
+            else if (packing == dpx::kFilledMethodA)
+                dpx::UnfillLine10bitFilled<PADDINGBITS_10BITFILLEDMETHODA> (in, out, datums, nc == 1);
+            else
+                dpx::UnfillLine10bitFilled<PADDINGBITS_10BITFILLEDMETHODB> (in, out, datums, nc == 1);
+        }
+        dpx::Block block (0, int(y0 + b), h.Width () - 1, int(y0 + e - 1));
+        if (! m_wantRaw &&
+            ! dpx::ConvertToRGB (h, m_subimage, unpacked + b * datums,
+                                 (char *)data + b * outbytes, block))
+            ++failed;
+    });
+    ok = ! failed;
+    return true;
+}
+
+
+
+bool
+DPXInput::raw_pixel_layout (int64_t &offset, stride_t &ystride)
+{
+    // Only when libdpx would itself do a single direct read (see
+    // dpx::Reader::ReadBlock) with no swapping or colour conversion.
+    const dpx::Header &h (m_dpx.header);
+    dpx::Descriptor desc = h.ImageDescriptor (m_subimage);
+    if (h.ImageEncoding (m_subimage) == dpx::kRLE ||
+        h.EndOfLinePadding (m_subimage) != 0 || h.RequiresByteSwap () ||
+        h.BitDepth (m_subimage) != 8 * m_spec.format.size() ||
+        h.ImageElementComponentCount (m_subimage) != m_spec.nchannels ||
+        ! (m_wantRaw || desc == dpx::kRGB || desc == dpx::kRGBA))
+        return false;
+    offset = h.DataOffset (m_subimage);
+    ystride = (stride_t) m_spec.scanline_bytes();
+    return true;
+}
+
+
+
 std::string
 DPXInput::get_characteristic_string (dpx::Characteristic c)
 {
@@ -38,6 +38,7 @@
 
 
 #include "BaseTypeConverter.h"
+#include "OpenImageIO/simd.h"
 
 
 namespace dpx 
@@ -215,35 +216,59 @@ namespace dpx
 		// shift bits over 2 if Method A
 		const int method_shift = (METHOD == kFilledMethodA ? 2 : 0);
 		
-		// loop through the buffer
-		int i;
-		U32 value = 0;
-		for (i = 0; i < len; i++)
+		// bit position of each of the three datums in a U32
+		const int s0 = (reverse ? 20 : 0) + method_shift;
+		const int s1 = 10 + method_shift;
+		const int s2 = (reverse ? 0 : 20) + method_shift;
+
+		// pack a word at a time; each word is written only after its
+		// datums are read, so packing in place is safe
+		const IB *in = src + access.offset;
+		int i = 0, w = 0;
+#if OIIO_SIMD_SSE >= 3
+		// twelve datums make four words: shuffle the first, second and
+		// third datum of each word into 32-bit lanes, then shift and merge
+		const __m128i c0 = _mm_cvtsi32_si128(s0);
+		const __m128i c1 = _mm_cvtsi32_si128(s1);
+		const __m128i c2 = _mm_cvtsi32_si128(s2);
+		const __m128i lo0 = _mm_setr_epi8(0, 1, -1, -1, 6, 7, -1, -1, 12, 13, -1, -1, -1, -1, -1, -1);
+		const __m128i hi0 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 3, -1, -1);
+		const __m128i lo1 = _mm_setr_epi8(2, 3, -1, -1, 8, 9, -1, -1, 14, 15, -1, -1, -1, -1, -1, -1);
+		const __m128i hi1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 4, 5, -1, -1);
+		const __m128i lo2 = _mm_setr_epi8(4, 5, -1, -1, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+		const __m128i hi2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 0, 1, -1, -1, 6, 7, -1, -1);
+		for ( ; sizeof(IB) == 2 && i + 12 <= len; i += 12, w += 4)
 		{
-			int div = i / 3;			// 3 10-bit values in a U32
-			int rem = i % 3;
-	
-			// write previously calculated value
-			if (i && rem == 0)
+			__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+			__m128i hi = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i + 8));
+			__m128i d0 = _mm_or_si128(_mm_shuffle_epi8(lo, lo0), _mm_shuffle_epi8(hi, hi0));
+			__m128i d1 = _mm_or_si128(_mm_shuffle_epi8(lo, lo1), _mm_shuffle_epi8(hi, hi1));
+			__m128i d2 = _mm_or_si128(_mm_shuffle_epi8(lo, lo2), _mm_shuffle_epi8(hi, hi2));
+			__m128i words = _mm_or_si128(_mm_sll_epi32(_mm_srli_epi32(d0, shift), c0),
+			                _mm_or_si128(_mm_sll_epi32(_mm_srli_epi32(d1, shift), c1),
+			                             _mm_sll_epi32(_mm_srli_epi32(d2, shift), c2)));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst_u32 + w), words);
+		}
+#endif
+		for ( ; i + 3 <= len; i += 3, ++w)
+		{
+			U32 d0 = (static_cast<U32>(in[i]) >> shift) & bitmask;
+			U32 d1 = (static_cast<U32>(in[i+1]) >> shift) & bitmask;
+			U32 d2 = (static_cast<U32>(in[i+2]) >> shift) & bitmask;
+			dst_u32[w] = (d0 << s0) | (d1 << s1) | (d2 << s2);
+		}
+
+		// partial last word
+		if (i < len)
+		{
+			U32 value = 0;
+			for (int k = 0; i < len; ++i, ++k)
 			{
-				dst_u32[div-1] = value;
-				value = 0;
+				int rem = reverse ? 2 - k : k;
+				value |= ((static_cast<U32>(in[i]) >> shift) & bitmask) << (bitdepth * rem + method_shift);
 			}
-
-			// if reverse the order
-			if (reverse)
-				rem = 2 - rem;
-
-			// place the 10 bits in the proper place with mask
-			U32 comp = ((static_cast<U32>(src[i+access.offset]) >> shift) << (bitdepth * rem)) << method_shift;
-			U32 mask = (bitmask << (bitdepth * rem)) << method_shift ;
-			
-			// overwrite only the proper 10 bits
-			value = (value & ~mask) | (comp & mask);
+			dst_u32[w] = value;
 		}
-		
-		// write last
-		dst_u32[(len+2)/3-1] = value;
 
 		// adjust offset/length
 		// multiply * 2 because it takes two U16 = U32 and this func packs into a U32
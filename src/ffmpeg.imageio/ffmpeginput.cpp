@@ -36,6 +36,10 @@ extern "C" { // ffmpeg is a C api
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57,24,0)
 # include <libavutil/imgutils.h>
 #endif
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58,18,100)
+# include <libavutil/hwcontext.h>
+# include <libavutil/pixdesc.h>
+#endif
 }
 
 
@@ -124,10 +128,15 @@ inline int receive_frame(AVCodecContext *avctx, AVFrame *picture,
 }
 #endif
 
+// Hardware decoding (hw_device_ctx + avcodec_get_hw_config) is usable
+// starting with ffmpeg 4.0.
+#define USE_FFMPEG_HWACCEL (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58,18,100))
+
 #include <boost/thread/once.hpp>
 
 #include "OpenImageIO/imageio.h"
 #include  <iostream>
+#include  <algorithm>
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -138,6 +147,8 @@ public:
     virtual ~FFmpegInput();
     virtual const char *format_name (void) const { return "FFmpeg movie"; }
     virtual bool open (const std::string &name, ImageSpec &spec);
+    virtual bool open (const std::string &name, ImageSpec &spec,
+                       const ImageSpec &config);
     virtual bool close (void);
     virtual int current_subimage (void) const { return m_subimage; }
     virtual bool seek_subimage (int subimage, int miplevel, ImageSpec &newspec);
@@ -150,7 +161,22 @@ public:
     bool seek (int pos);
     double fps() const;
     int64_t time_stamp(int pos) const;
+    int frame_number (int64_t pts) const;
 private:
+    // One keyframe, as found by the packet scan in open().
+    struct Keyframe {
+        int frame;      // frame number of the keyframe
+        int64_t pts;    // its timestamp, in the video stream's time base
+        bool operator< (const Keyframe &k) const { return frame < k.frame; }
+    };
+    // A converted RGB frame held in the small LRU cache.
+    struct CachedFrame {
+        int frame;
+        uint64_t lastuse;
+        std::vector<uint8_t> pixels;
+    };
+    static const size_t max_cached_frames = 4;
+
     std::string m_filename;
     int m_subimage;
     int64_t m_nsubimages;
@@ -173,6 +199,25 @@ private:
     bool m_codec_cap_delay;
     bool m_read_frame;
     int64_t m_start_time;
+    std::vector<Keyframe> m_keyframes;     // sorted by frame
+    std::vector<CachedFrame> m_frame_cache;
+    uint64_t m_cache_clock;
+    std::string m_hwaccel;                 // requested hwaccel device type
+    bool m_headeronly;                     // opened "oiio:headeronly"
+#if USE_FFMPEG_HWACCEL
+    AVBufferRef *m_hw_device_ctx;
+    AVPixelFormat m_hw_pix_fmt;
+    AVFrame *m_sw_frame;                   // hw frames get downloaded here
+
+    bool setup_hwaccel ();
+    static AVPixelFormat get_hw_format (AVCodecContext *ctx,
+                                        const AVPixelFormat *fmts);
+#endif
+
+    void build_keyframe_index ();
+    const Keyframe *keyframe_before (int frame) const;
+    bool find_cached_frame (int frame);
+    void cache_frame (int frame);
 
     // init to initialize state
     void init (void) {
@@ -195,6 +240,16 @@ private:
         m_codec_cap_delay = false;
         m_subimage = 0;
         m_start_time = 0;
+        m_keyframes.clear();
+        m_frame_cache.clear();
+        m_cache_clock = 0;
+        m_hwaccel.clear();
+        m_headeronly = false;
+#if USE_FFMPEG_HWACCEL
+        m_hw_device_ctx = NULL;
+        m_hw_pix_fmt = AV_PIX_FMT_NONE;
+        m_sw_frame = NULL;
+#endif
     }
 };
 
@@ -238,6 +293,19 @@ FFmpegInput::~FFmpegInput()
 
 
 
+bool
+FFmpegInput::open (const std::string &name, ImageSpec &spec,
+                   const ImageSpec &config)
+{
+    // Check 'config' for any special requests
+    m_hwaccel = config.get_string_attribute ("ffmpeg:hwaccel");
+    // Header-only opens don't need the keyframe index for seeking
+    m_headeronly = config.get_int_attribute ("oiio:headeronly", 0) != 0;
+    return open (name, spec);
+}
+
+
+
 bool
 FFmpegInput::open (const std::string &name, ImageSpec &spec)
 {
@@ -322,6 +390,23 @@ FFmpegInput::open (const std::string &name, ImageSpec &spec)
     }
 #endif
 
+    // Let the decoder use frame and/or slice threads, as many as OIIO
+    // itself is allowed to use.
+    int nthreads = 0;
+    OIIO::getattribute ("threads", nthreads);
+    m_codec_context->thread_count = nthreads;
+#ifdef FF_THREAD_FRAME
+    m_codec_context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+#endif
+#if USE_FFMPEG_HWACCEL
+    // Optional hardware decoding. If the device can't be had, or the codec
+    // can't use it, we quietly carry on decoding in software.
+    if (m_hwaccel.size() && setup_hwaccel ()) {
+        // Frame threads buy nothing once the GPU does the work.
+        m_codec_context->thread_count = 1;
+    }
+#endif
+
     if (avcodec_open2 (m_codec_context, m_codec, NULL) < 0) {
         error ("\"%s\" could not open codec", file_name);
         return false;
@@ -358,6 +443,8 @@ FFmpegInput::open (const std::string &name, ImageSpec &spec)
         }
         m_frames = max_pts;
     }
+    if (! m_headeronly)
+        build_keyframe_index ();
     m_frame = av_frame_alloc();
     m_rgb_frame = av_frame_alloc();
 
@@ -434,6 +521,10 @@ FFmpegInput::open (const std::string &name, ImageSpec &spec)
     m_spec.attribute ("FramesPerSecond", m_frame_rate.num / static_cast<float> (m_frame_rate.den));
     m_spec.attribute ("oiio:Movie", true);
     m_spec.attribute ("oiio:BitsPerSample", m_codec_context->bits_per_raw_sample);
+#if USE_FFMPEG_HWACCEL
+    if (m_hw_device_ctx)
+        m_spec.attribute ("ffmpeg:hwaccel", m_hwaccel);
+#endif
     m_nsubimages = m_frames;
     spec = m_spec;
     return true;
@@ -481,6 +572,10 @@ FFmpegInput::close (void)
     av_free (m_format_context); // will free m_codec and m_codec_context
     av_frame_free (&m_frame); // free after close input
     av_frame_free (&m_rgb_frame);
+#if USE_FFMPEG_HWACCEL
+    av_frame_free (&m_sw_frame);
+    av_buffer_unref (&m_hw_device_ctx);
+#endif
     sws_freeContext (m_sws_rgb_context);
     init ();
     return true;
@@ -488,12 +583,159 @@ FFmpegInput::close (void)
 
 
 
+#if USE_FFMPEG_HWACCEL
+bool
+FFmpegInput::setup_hwaccel ()
+{
+    // "vaapi", "videotoolbox", "cuda" (NVDEC), "dxva2", "d3d11va", ...
+    AVHWDeviceType type = av_hwdevice_find_type_by_name (m_hwaccel.c_str());
+    if (type == AV_HWDEVICE_TYPE_NONE)
+        return false;
+    for (int i = 0; ; ++i) {
+        const AVCodecHWConfig *hwconfig = avcodec_get_hw_config (m_codec, i);
+        if (! hwconfig)
+            return false;   // this decoder can't use that device type
+        if ((hwconfig->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) &&
+            hwconfig->device_type == type) {
+            m_hw_pix_fmt = hwconfig->pix_fmt;
+            break;
+        }
+    }
+    if (av_hwdevice_ctx_create (&m_hw_device_ctx, type, NULL, NULL, 0) < 0) {
+        m_hw_pix_fmt = AV_PIX_FMT_NONE;
+        return false;
+    }
+    m_codec_context->hw_device_ctx = av_buffer_ref (m_hw_device_ctx);
+    m_codec_context->opaque = this;
+    m_codec_context->get_format = get_hw_format;
+    m_sw_frame = av_frame_alloc();
+    return true;
+}
+
+
+
+AVPixelFormat
+FFmpegInput::get_hw_format (AVCodecContext *ctx, const AVPixelFormat *fmts)
+{
+    const FFmpegInput *self = (const FFmpegInput *) ctx->opaque;
+    for (const AVPixelFormat *f = fmts; *f != AV_PIX_FMT_NONE; ++f)
+        if (*f == self->m_hw_pix_fmt)
+            return *f;
+    // The hardware can't do this stream after all (e.g., an unsupported
+    // profile); fall back to the first software format offered.
+    for (const AVPixelFormat *f = fmts; *f != AV_PIX_FMT_NONE; ++f)
+        if (! (av_pix_fmt_desc_get(*f)->flags & AV_PIX_FMT_FLAG_HWACCEL))
+            return *f;
+    return fmts[0];
+}
+#endif
+
+
+
+void
+FFmpegInput::build_keyframe_index ()
+{
+    // Demux (but don't decode) the whole video stream once, noting where
+    // every keyframe lands, so that seek() can go straight to the start
+    // of the right GOP instead of guessing from the frame rate.
+    m_keyframes.clear ();
+    seek (0);
+    AVPacket pkt;
+    av_init_packet (&pkt);
+    while (av_read_frame (m_format_context, &pkt) >= 0) {
+        if (pkt.stream_index == m_video_stream && (pkt.flags & AV_PKT_FLAG_KEY)) {
+            int64_t ts = pkt.pts;
+            if (ts == int64_t(AV_NOPTS_VALUE))
+                ts = pkt.dts;
+            if (ts != int64_t(AV_NOPTS_VALUE)) {
+                Keyframe k = { frame_number (ts), ts };
+                m_keyframes.push_back (k);
+            }
+        }
+        av_free_packet (&pkt);
+    }
+    std::stable_sort (m_keyframes.begin(), m_keyframes.end());
+    // Rewind. The decoder now sits just before frame 0.
+    seek (0);
+    m_last_decoded_pos = -1;
+}
+
+
+
+const FFmpegInput::Keyframe *
+FFmpegInput::keyframe_before (int frame) const
+{
+    Keyframe k = { frame, 0 };
+    std::vector<Keyframe>::const_iterator i =
+        std::upper_bound (m_keyframes.begin(), m_keyframes.end(), k);
+    if (i == m_keyframes.begin())
+        return NULL;
+    return &(*(i-1));
+}
+
+
+
+bool
+FFmpegInput::find_cached_frame (int frame)
+{
+    for (size_t i = 0, e = m_frame_cache.size(); i < e; ++i) {
+        CachedFrame &c (m_frame_cache[i]);
+        if (c.frame == frame) {
+            c.lastuse = ++m_cache_clock;
+            m_rgb_buffer = c.pixels;
+            avpicture_fill (reinterpret_cast<AVPicture*>(m_rgb_frame),
+                            &m_rgb_buffer[0], m_dst_pix_format,
+                            m_codec_context->width, m_codec_context->height);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+
+void
+FFmpegInput::cache_frame (int frame)
+{
+    CachedFrame *slot = NULL;
+    if (m_frame_cache.size() < max_cached_frames) {
+        m_frame_cache.resize (m_frame_cache.size()+1);
+        slot = &m_frame_cache.back();
+    } else {
+        // Evict the least recently used frame
+        slot = &m_frame_cache[0];
+        for (size_t i = 1, e = m_frame_cache.size(); i < e; ++i)
+            if (m_frame_cache[i].lastuse < slot->lastuse)
+                slot = &m_frame_cache[i];
+    }
+    slot->frame = frame;
+    slot->lastuse = ++m_cache_clock;
+    slot->pixels = m_rgb_buffer;
+}
+
+
+
 void
 FFmpegInput::read_frame(int frame)
 {
-    if (m_last_decoded_pos + 1 != frame ) {
+    if (find_cached_frame (frame)) {
+        m_read_frame = true;
+        return;
+    }
+    bool need_seek = (m_last_decoded_pos + 1 != frame);
+    if (need_seek && frame > m_last_decoded_pos && m_last_decoded_pos >= 0) {
+        // If the target is further along in the GOP we're already
+        // decoding, seeking would only land us back on the same keyframe;
+        // just keep decoding forward.
+        const Keyframe *k = keyframe_before (frame);
+        if (k && k->frame <= m_last_decoded_pos)
+            need_seek = false;
+    }
+    if (need_seek) {
         seek (frame);
     }
+    // Where the decoder sits is unknown until the target frame lands.
+    m_last_decoded_pos = -2;
     AVPacket pkt;
     int finished = 0;
     int ret = 0;
@@ -506,17 +748,35 @@ FFmpegInput::read_frame(int frame)
 
             finished = receive_frame(m_codec_context, m_frame, &pkt);
 
-            double pts = 0;
+            int64_t pts = 0;
             if (static_cast<int64_t>(m_frame->pkt_pts) != int64_t(AV_NOPTS_VALUE)) {
-                pts = av_q2d (m_format_context->streams[m_video_stream]->time_base) *  m_frame->pkt_pts;
+                pts = m_frame->pkt_pts;
             }
 
-            int current_frame = int((pts-m_start_time) * fps() + 0.5f); //???
+            int current_frame = frame_number (pts);
             //current_frame =   m_frame->display_picture_number;
             m_last_search_pos = current_frame;
 
             if( current_frame == frame && finished)
             {
+                AVFrame *src = m_frame;
+#if USE_FFMPEG_HWACCEL
+                if (m_hw_device_ctx && m_frame->format == m_hw_pix_fmt) {
+                    // Download from the device, typically as NV12 or P010,
+                    // and let swscale convert from whatever that is.
+                    av_frame_unref (m_sw_frame);
+                    src = NULL;
+                    if (av_hwframe_transfer_data (m_sw_frame, m_frame, 0) == 0) {
+                        src = m_sw_frame;
+                        m_sws_rgb_context = sws_getCachedContext (
+                            m_sws_rgb_context,
+                            m_codec_context->width, m_codec_context->height,
+                            AVPixelFormat(src->format),
+                            m_codec_context->width, m_codec_context->height,
+                            m_dst_pix_format, SWS_AREA, NULL, NULL, NULL);
+                    }
+                }
+#endif
                 avpicture_fill
                 (
                     reinterpret_cast<AVPicture*>(m_rgb_frame),
@@ -525,17 +785,23 @@ FFmpegInput::read_frame(int frame)
                     m_codec_context->width,
                     m_codec_context->height
                 );
+                if (! src) {
+                    // The device download failed; nothing usable to show.
+                    av_free_packet (&pkt);
+                    break;
+                }
                 sws_scale
                 (
                     m_sws_rgb_context,
-                    static_cast<uint8_t const * const *> (m_frame->data),
-                    m_frame->linesize,
+                    static_cast<uint8_t const * const *> (src->data),
+                    src->linesize,
                     0,
                     m_codec_context->height,
                     m_rgb_frame->data,
                     m_rgb_frame->linesize
                 );
                 m_last_decoded_pos = current_frame;
+                cache_frame (current_frame);
                 av_free_packet (&pkt);
                 break;
             }
@@ -570,6 +836,13 @@ FFmpegInput::has_metadata (const char * key)
 bool
 FFmpegInput::seek (int frame)
 {
+    if (const Keyframe *k = keyframe_before (frame)) {
+        // Seek directly to the keyframe that starts the frame's GOP
+        avcodec_flush_buffers (m_codec_context);
+        av_seek_frame (m_format_context, m_video_stream, k->pts,
+                       AVSEEK_FLAG_BACKWARD);
+        return true;
+    }
     int64_t offset = time_stamp (frame);
     int flags = AVSEEK_FLAG_BACKWARD;
     avcodec_flush_buffers (m_codec_context);
@@ -591,6 +864,16 @@ FFmpegInput::time_stamp(int frame) const
 
 
 
+int
+FFmpegInput::frame_number (int64_t pts) const
+{
+    // Map a video stream timestamp to a frame number.
+    double t = av_q2d (m_format_context->streams[m_video_stream]->time_base) * pts;
+    return int((t - m_start_time) * fps() + 0.5f);
+}
+
+
+
 double
 FFmpegInput::fps() const
 {
@@ -80,6 +80,11 @@ public:
     // Transform world space P to local space P.
     virtual void worldToLocal (const Imath::V3f &wsP, Imath::V3f &lsP,
                                float time) const = 0;
+
+    // If the tile at (x,y,z) of the current subimage is an unallocated
+    // block of a sparse field, store its one value (a native pixel) in
+    // *value and return true, without reading anything.
+    virtual bool constant_tile (int x, int y, int z, void *value) = 0;
 };
 
 
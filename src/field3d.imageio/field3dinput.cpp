@@ -75,6 +75,8 @@ public:
     virtual void worldToLocal (const Imath::V3f &wsP, Imath::V3f &lsP,
                                float time) const;
 
+    virtual bool constant_tile (int x, int y, int z, void *value);
+
 private:
     std::string m_name;
     Field3DInputFile *m_input;
@@ -89,6 +91,7 @@ private:
                          TypeDesc datatype, size_t layernum);
 
     template<typename T> bool readtile (int x, int y, int z, T *data);
+    template<typename T> bool empty_block (int x, int y, int z, T *value);
 
     void init () {
         m_name.clear ();
@@ -129,9 +132,13 @@ f3dpvt::oiio_field3d_initialize ()
         spin_lock lock (field3d_mutex());
         if (! initialized) {
             initIO ();
-            // Minimize Field3D's own internal caching
+            // Minimize Field3D's own internal caching: sparse blocks are
+            // read on demand and the ImageCache holds on to the tiles, so
+            // anything Field3D keeps is double counted.  It only needs to
+            // be big enough to stage the block being read (see
+            // reserve_field3d_cache).
             SparseFileManager::singleton().setLimitMemUse(true); // Enables cache
-            SparseFileManager::singleton().setMaxMemUse(20.0f); // In MB
+            SparseFileManager::singleton().setMaxMemUse(1.0f); // In MB
 #if (100*FIELD3D_MAJOR_VER + FIELD3D_MINOR_VER) >= 104
             Msg::setVerbosity (0); // Turn off console messages from F3D
 #endif
@@ -142,6 +149,23 @@ f3dpvt::oiio_field3d_initialize ()
 
 
 
+// Make sure Field3D's sparse block cache can hold a few blocks of the
+// given size, so that reading one tile never evicts its own block.
+// Call with field3d_mutex held.
+static void
+reserve_field3d_cache (int blocksize, size_t pixelbytes)
+{
+    static float reserved = 1.0f;  // matches oiio_field3d_initialize
+    float mb = 4.0f * blocksize * blocksize * blocksize * pixelbytes
+             / (1024.0f * 1024.0f);
+    if (mb > reserved) {
+        reserved = mb;
+        SparseFileManager::singleton().setMaxMemUse(reserved);
+    }
+}
+
+
+
 template<typename T>
 inline int blocksize (FieldRes::Ptr &f)
 {
@@ -149,7 +173,8 @@ inline int blocksize (FieldRes::Ptr &f)
     typename SparseField<T>::Ptr sf (field_dynamic_cast<SparseField<T> >(f));
     if (sf)
         return sf->blockSize();
-    typename SparseField<T>::Ptr vsf (field_dynamic_cast<SparseField<T> >(f));
+    typedef FIELD3D_VEC3_T<T> VecData_T;
+    typename SparseField<VecData_T>::Ptr vsf (field_dynamic_cast<SparseField<VecData_T> >(f));
     if (vsf)
         return vsf->blockSize();
     return 0;
@@ -246,6 +271,7 @@ Field3DInput::read_one_layer (FieldRes::Ptr field, layerrecord &lay,
     }
     if (b) {
         // There was a block size found
+        reserve_field3d_cache (b, lay.spec.pixel_bytes());
         lay.spec.tile_width = b;
         lay.spec.tile_height = b;
         lay.spec.tile_depth = b;
@@ -523,6 +549,59 @@ Field3DInput::read_native_tile (int x, int y, int z, void *data)
 
 
 
+template<class T>
+bool Field3DInput::empty_block (int x, int y, int z, T *value)
+{
+    layerrecord &lay (m_layers[m_subimage]);
+    typename SparseField<T>::Ptr f = field_dynamic_cast<SparseField<T> > (lay.field);
+    if (! f)
+        return false;
+    // Tiles are the sparse blocks, which start at the data window origin
+    int b = f->blockSize();
+    x -= lay.spec.x;
+    y -= lay.spec.y;
+    z -= lay.spec.z;
+    if (x % b || y % b || z % b)
+        return false;
+    int bi = x / b, bj = y / b, bk = z / b;
+    if (! f->blockIndexIsValid (bi, bj, bk) || f->blockIsAllocated (bi, bj, bk))
+        return false;
+    *value = f->getBlockEmptyValue (bi, bj, bk);
+    return true;
+}
+
+
+
+bool
+Field3DInput::constant_tile (int x, int y, int z, void *value)
+{
+    spin_lock lock (field3d_mutex());
+    if (m_subimage < 0 || m_subimage >= (int)m_layers.size())
+        return false;
+    layerrecord &lay (m_layers[m_subimage]);
+    if (lay.fieldtype != f3dpvt::Sparse)
+        return false;
+    if (lay.datatype == TypeDesc::FLOAT) {
+        if (lay.vecfield)
+            return empty_block (x, y, z, (FIELD3D_VEC3_T<float> *)value);
+        else
+            return empty_block (x, y, z, (float *)value);
+    } else if (lay.datatype == TypeDesc::HALF) {
+        if (lay.vecfield)
+            return empty_block (x, y, z, (FIELD3D_VEC3_T<FIELD3D_NS::half> *)value);
+        else
+            return empty_block (x, y, z, (FIELD3D_NS::half *)value);
+    } else if (lay.datatype == TypeDesc::DOUBLE) {
+        if (lay.vecfield)
+            return empty_block (x, y, z, (FIELD3D_VEC3_T<double> *)value);
+        else
+            return empty_block (x, y, z, (double *)value);
+    }
+    return false;
+}
+
+
+
 void
 Field3DInput::worldToLocal (const Imath::V3f &wsP, Imath::V3f &lsP,
                             float time) const
@@ -78,6 +78,9 @@ class FitsInput : public ImageInput {
     virtual bool open (const std::string &name, ImageSpec &spec);
     virtual bool close (void);
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
+    virtual bool raw_pixel_layout (int64_t &offset, stride_t &ystride);
     virtual bool seek_subimage (int subimage, int miplevel, ImageSpec &newspec);
     virtual int current_subimage () const { return m_cur_subimage; }
  private:
@@ -124,6 +127,18 @@ class FitsInput : public ImageInput {
     // subimages are stored in m_subimages
     void subimage_search ();
 
+    // given the first block of an HDU's header (the file is positioned
+    // just after it), compute how many bytes the header and its data
+    // (padded to whole blocks) take. Return false if the header can't be
+    // parsed.
+    bool hdu_size (const std::string &block, size_t &size);
+
+    // change the big-endian pixel data in buf to native byte order
+    void to_native_endian (void *buf, size_t bytes);
+
+    // offset of scanline y of slice z from the start of the image data
+    int64_t scanline_offset (int y, int z) const;
+
     // set basic info (width, height) of subimage
     // add attributes to ImageSpec
     // return true if ok, false upon error reading the spec from the file.
@@ -49,6 +49,9 @@ OIIO_PLUGIN_EXPORTS_BEGIN
     OIIO_EXPORT const char *fits_input_extensions[] = {
         "fits", NULL
     };
+    OIIO_EXPORT const char *fits_input_magic[] = {
+        "53494d504c45", NULL
+    };
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -117,11 +120,12 @@ FitsInput::read_native_scanline (int y, int z, void *data)
     if (!m_naxes)
         return true;
 
-    std::vector<unsigned char> data_tmp (m_spec.scanline_bytes ());
-    long scanline_off = (m_spec.height - y) * m_spec.scanline_bytes ();
-    fseek (m_fd, scanline_off, SEEK_CUR);
-    size_t n = fread (&data_tmp[0], 1, m_spec.scanline_bytes(), m_fd);
-    if (n != m_spec.scanline_bytes()) {
+    size_t scanline_bytes = m_spec.scanline_bytes ();
+    fseek (m_fd, (long)scanline_offset (y, z), SEEK_CUR);
+    size_t n = fread (data, 1, scanline_bytes, m_fd);
+    // after reading scanline we set file pointer to the start of image data
+    fsetpos (m_fd, &m_filepos);
+    if (n != scanline_bytes) {
         if (feof (m_fd))
             error ("Hit end of file unexpectedly");
         else
@@ -129,29 +133,101 @@ FitsInput::read_native_scanline (int y, int z, void *data)
         return false;   // Read failed
     }
 
+    to_native_endian (data, scanline_bytes);
+    return true;
+};
+
+
+
+bool
+FitsInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    // we return true just to support 0x0 images
+    if (!m_naxes)
+        return true;
+    yend = std::min (yend, m_spec.y + m_spec.height);
+    if (ybegin >= yend)
+        return true;
+
+    // Scanlines are stored bottom to top, so [ybegin,yend) is one
+    // contiguous run in the file, starting with yend-1. Read it all at
+    // once, then put the rows back in top to bottom order.
+    size_t scanline_bytes = m_spec.scanline_bytes ();
+    size_t nrows = size_t (yend - ybegin);
+    fseek (m_fd, (long)scanline_offset (yend-1, z), SEEK_CUR);
+    size_t n = fread (data, 1, nrows * scanline_bytes, m_fd);
+    fsetpos (m_fd, &m_filepos);
+    if (n != nrows * scanline_bytes) {
+        if (feof (m_fd))
+            error ("Hit end of file unexpectedly");
+        else
+            error ("read error");
+        return false;   // Read failed
+    }
+
+    char *rows = (char *) data;
+    std::vector<char> tmp (scanline_bytes);
+    for (size_t a = 0, b = nrows-1;  a < b;  ++a, --b) {
+        char *ra = rows + a * scanline_bytes;
+        char *rb = rows + b * scanline_bytes;
+        memcpy (&tmp[0], ra, scanline_bytes);
+        memcpy (ra, rb, scanline_bytes);
+        memcpy (rb, &tmp[0], scanline_bytes);
+    }
+    to_native_endian (data, nrows * scanline_bytes);
+    return true;
+}
+
+
+
+int64_t
+FitsInput::scanline_offset (int y, int z) const
+{
+    // each slice of a cube is stored bottom to top, slices in order
+    int64_t scanline_bytes = (int64_t) m_spec.scanline_bytes ();
+    return (int64_t(z - m_spec.z) * m_spec.height + (m_spec.height - y))
+           * scanline_bytes;
+}
+
+
+
+void
+FitsInput::to_native_endian (void *buf, size_t bytes)
+{
     // in FITS image data is stored in big-endian so we have to switch to
     // little-endian on little-endian machines
     if (littleendian ()) {
         if (m_spec.format == TypeDesc::USHORT)
-            swap_endian ((unsigned short*)&data_tmp[0],
-                         data_tmp.size () / sizeof (unsigned short));
+            swap_endian ((unsigned short*)buf, bytes / sizeof (unsigned short));
         else if (m_spec.format == TypeDesc::UINT)
-            swap_endian ((unsigned int*)&data_tmp[0],
-                         data_tmp.size () / sizeof (unsigned int));
+            swap_endian ((unsigned int*)buf, bytes / sizeof (unsigned int));
         else if (m_spec.format == TypeDesc::FLOAT)
-            swap_endian ((float*)&data_tmp[0],
-                         data_tmp.size () / sizeof (float));
+            swap_endian ((float*)buf, bytes / sizeof (float));
         else if (m_spec.format == TypeDesc::DOUBLE)
-            swap_endian ((double*)&data_tmp[0],
-                         data_tmp.size () / sizeof (double));
+            swap_endian ((double*)buf, bytes / sizeof (double));
     }
+}
 
-    memcpy (data, &data_tmp[0], data_tmp.size ());
 
-    // after reading scanline we set file pointer to the start of image data
+
+bool
+FitsInput::raw_pixel_layout (int64_t &offset, stride_t &ystride)
+{
+    // FITS data is big-endian, so only bytes (or anything on a big-endian
+    // machine) can be used in place.  Scanlines are stored bottom to top,
+    // laid out exactly as read_native_scanline seeks them.
+    if (! m_naxes || m_spec.depth > 1 ||
+        (m_spec.format.size() > 1 && ! bigendian()))
+        return false;
     fsetpos (m_fd, &m_filepos);
+    long start = ftell (m_fd);
+    if (start < 0)
+        return false;
+    stride_t sl = (stride_t) m_spec.scanline_bytes();
+    offset = int64_t(start) + m_spec.height * sl;
+    ystride = -sl;
     return true;
-};
+}
 
 
 
@@ -246,10 +322,10 @@ FitsInput::read_fits_header (void)
         return false;   // Read failed
     }
 
+    std::string card;
     for (int i = 0; i < CARDS_PER_HEADER; ++i) {
-        std::string card (CARD_SIZE, 0);
         // reading card number i
-        memcpy (&card[0], &fits_header[i*CARD_SIZE], CARD_SIZE);
+        card.assign (&fits_header[i*CARD_SIZE], CARD_SIZE);
 
         std::string keyname, value;
         fits_pvt::unpack_card (card, keyname, value);
@@ -295,6 +371,12 @@ FitsInput::read_fits_header (void)
             m_spec.full_height = m_spec.height;
             continue;
         }
+        // a 3D cube is a volume, one slice per NAXIS3 plane
+        if (keyname == "NAXIS3" && m_naxes == 3) {
+            m_spec.depth = std::max (1, atoi (&card[10]));
+            m_spec.full_depth = m_spec.depth;
+            continue;
+        }
         // ignoring other axis
         if (keyname.substr (0,5) == "NAXIS") {
             continue;
@@ -375,7 +457,8 @@ FitsInput::subimage_search ()
     // or by "XTENSION= 'IMAGE   '" (it is image extensions)
     std::string hdu (HEADER_SIZE, 0);
     size_t offset = 0;
-    while (fread (&hdu[0], 1, HEADER_SIZE, m_fd) == HEADER_SIZE) {
+    while (fseek (m_fd, (long)offset, SEEK_SET) == 0 &&
+           fread (&hdu[0], 1, HEADER_SIZE, m_fd) == HEADER_SIZE) {
         if (!strncmp (&hdu[0], "SIMPLE", 6) ||
             !strncmp (&hdu[0], "XTENSION= 'IMAGE   '", 20)) {
             fits_pvt::Subimage newSub;
@@ -383,13 +466,75 @@ FitsInput::subimage_search ()
             newSub.offset = offset;
             m_subimages.push_back (newSub);
         }
-        offset += HEADER_SIZE;
+        // Jump straight over the header and data of each HDU, rather than
+        // reading every block of (possibly gigabytes of) pixel data. If a
+        // header can't be parsed, fall back to checking the next block.
+        size_t size = 0;
+        if (!strncmp (&hdu[0], "SIMPLE", 6) ||
+            !strncmp (&hdu[0], "XTENSION", 8)) {
+            if (! hdu_size (hdu, size))
+                size = HEADER_SIZE;
+        } else {
+            size = HEADER_SIZE;
+        }
+        offset += size;
     }
     fsetpos (m_fd, &fpos);
 }
 
 
 
+bool
+FitsInput::hdu_size (const std::string &block, size_t &size)
+{
+    int bitpix = 0, naxes = 0;
+    int64_t pcount = 0, gcount = 1;
+    std::vector<int64_t> naxis;
+    std::string hdr (block);
+    for (size_t nblocks = 1;  ;  ++nblocks) {
+        for (int i = 0; i < CARDS_PER_HEADER; ++i) {
+            const char *card = &hdr[i*CARD_SIZE];
+            string_view keyname = Strutil::strip (string_view (card, 8));
+            if (keyname == "END") {
+                // header done: data size is |BITPIX|/8 * GCOUNT *
+                // (PCOUNT + NAXIS1*...*NAXISn), padded to whole blocks.
+                // NAXIS1 == 0 means random groups, and doesn't count.
+                int64_t elements = 0;
+                if (naxes > 0) {
+                    elements = 1;
+                    for (int a = 0; a < naxes; ++a)
+                        if (! (a == 0 && naxis[0] == 0 && naxes > 1))
+                            elements *= naxis[a];
+                }
+                int64_t bytes = (std::abs (bitpix) / 8) * gcount * (pcount + elements);
+                bytes = (bytes + HEADER_SIZE - 1) / HEADER_SIZE * HEADER_SIZE;
+                size = nblocks * HEADER_SIZE + size_t (bytes);
+                return true;
+            }
+            if (keyname == "BITPIX")
+                bitpix = atoi (card+10);
+            else if (keyname == "NAXIS") {
+                naxes = atoi (card+10);
+                if (naxes < 0 || naxes > 999)
+                    return false;
+                naxis.resize (naxes, 0);
+            } else if (Strutil::starts_with (keyname, "NAXIS")) {
+                int a = atoi (std::string (keyname.substr (5)).c_str()) - 1;
+                if (a >= 0 && a < naxes)
+                    naxis[a] = strtoll (card+10, NULL, 10);
+            } else if (keyname == "PCOUNT")
+                pcount = strtoll (card+10, NULL, 10);
+            else if (keyname == "GCOUNT")
+                gcount = strtoll (card+10, NULL, 10);
+        }
+        // END wasn't in this block, so the header continues in the next
+        if (fread (&hdr[0], 1, HEADER_SIZE, m_fd) != HEADER_SIZE)
+            return false;
+    }
+}
+
+
+
 std::string
 FitsInput::convert_date (const std::string &date)
 {
@@ -28,12 +28,16 @@
   (This is the Modified BSD License)
 */
 
+#include <cstdio>
 #include <vector>
 #include <memory>
+#include <algorithm>
 #include <gif_lib.h>
 
 #include "OpenImageIO/imageio.h"
+#include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/thread.h"
+#include "../libOpenImageIO/palette_pvt.h"
 
 // GIFLIB:
 // http://giflib.sourceforge.net/
@@ -61,6 +65,8 @@ public:
     virtual ~GIFInput () { close (); }
     virtual const char *format_name (void) const { return "gif"; }
     virtual bool open (const std::string &name, ImageSpec &newspec);
+    virtual bool open (const std::string &name, ImageSpec &newspec,
+                       const ImageSpec &config);
     virtual bool close (void);
     virtual bool read_native_scanline (int y, int z, void *data);
     virtual bool seek_subimage (int subimage, int miplevel, ImageSpec &newspec);
@@ -86,11 +92,43 @@ public:
     std::vector<unsigned char> m_canvas; ///< Image canvas in output format, on
                                          ///  which subimages are sequentially
                                          ///  drawn.
+    FILE *m_file;                    ///< The file GIFLIB reads through us
+    bool m_headeronly;               ///< Opened with "oiio:headeronly"
+    bool m_pending_draw;             ///< Current subimage not drawn yet
+
+    /// Snapshot of the decoding state just before a subimage is read, so
+    /// that seeking to a later subimage needn't composite every frame
+    /// from the start.
+    struct Keyframe {
+        int subimage;                    ///< Subimage to be read next
+        long offset;                     ///< File position of its records
+        int disposal_method;             ///< Disposal method of the one before
+        std::vector<unsigned char> canvas;  ///< Canvas before drawing it
+    };
+    std::vector<Keyframe> m_keyframes;   ///< Sorted by subimage
+    int m_keyframe_interval;             ///< Snapshot every this many frames
+    static const size_t max_keyframe_bytes = 64 * 1024 * 1024;
 
     /// Reset everything to initial state
     ///
     void init (void);
 
+    /// (Re)open the GIFLIB handle at the start of the file.
+    ///
+    bool open_gif (void);
+
+    /// Close the GIFLIB handle (but not m_file).
+    ///
+    bool close_gif (void);
+
+    /// Remember the current state if subimage is due a keyframe.
+    ///
+    void save_keyframe (int subimage);
+
+    /// Return the last keyframe at or before subimage, or NULL.
+    ///
+    const Keyframe *find_keyframe (int subimage) const;
+
     /// Read current subimage metadata.
     ///
     bool read_subimage_metadata (ImageSpec &newspec);
@@ -120,6 +158,7 @@ OIIO_PLUGIN_EXPORTS_BEGIN
 OIIO_EXPORT int gif_imageio_version = OIIO_PLUGIN_VERSION;
 OIIO_EXPORT ImageInput *gif_input_imageio_create () { return new GIFInput; }
 OIIO_EXPORT const char *gif_input_extensions[] = { "gif", NULL };
+OIIO_EXPORT const char *gif_input_magic[] = { "47494638", NULL };
 
 OIIO_EXPORT const char* gif_imageio_library_version () {
 #define STRINGIZE2(a) #a
@@ -139,6 +178,11 @@ void
 GIFInput::init (void)
 {
     m_gif_file = NULL;
+    m_file = NULL;
+    m_keyframes.clear ();
+    m_keyframe_interval = 16;
+    m_headeronly = false;
+    m_pending_draw = false;
 }
 
 
@@ -149,12 +193,115 @@ GIFInput::open (const std::string &name, ImageSpec &newspec)
     m_filename = name;
     m_subimage = -1;
     m_canvas.clear ();
+    m_keyframes.clear ();
+    m_keyframe_interval = 16;
+    m_pending_draw = false;
     
     return seek_subimage (0, 0, newspec);
 }
 
 
 
+bool
+GIFInput::open (const std::string &name, ImageSpec &newspec,
+                const ImageSpec &config)
+{
+    // With "oiio:headeronly", frames are only drawn if pixels are read
+    m_headeronly = config.get_int_attribute ("oiio:headeronly", 0) != 0;
+    return open (name, newspec);
+}
+
+
+
+static int
+gif_read_func (GifFileType *gif, GifByteType *buf, int len)
+{
+    return (int) fread (buf, 1, len, (FILE *) gif->UserData);
+}
+
+
+
+bool
+GIFInput::open_gif (void)
+{
+    if (m_gif_file && ! close_gif ())
+        return false;
+    if (! m_file) {
+        m_file = Filesystem::fopen (m_filename, "rb");
+        if (! m_file) {
+            error ("Could not open file \"%s\"", m_filename.c_str());
+            return false;
+        }
+    }
+    fseek (m_file, 0, SEEK_SET);
+
+    // Reading through our own FILE lets us know and set the file
+    // position, which is what makes keyframes possible.
+#if GIFLIB_MAJOR >= 5
+    int giflib_error;
+    if (! (m_gif_file = DGifOpen (m_file, gif_read_func, &giflib_error))) {
+        error (GifErrorString (giflib_error));
+        return false; 
+    }
+#else
+    if (! (m_gif_file = DGifOpen (m_file, gif_read_func))) {
+        error ("Error trying to open the file.");
+        return false; 
+    }
+#endif
+
+    m_subimage = -1;
+    m_canvas.resize (m_gif_file->SWidth * m_gif_file->SHeight * 4);
+    return true;
+}
+
+
+
+void
+GIFInput::save_keyframe (int subimage)
+{
+    if (subimage <= 0 || subimage % m_keyframe_interval)
+        return;
+    std::vector<Keyframe>::iterator k = m_keyframes.begin();
+    while (k != m_keyframes.end() && k->subimage < subimage)
+        ++k;
+    if (k != m_keyframes.end() && k->subimage == subimage)
+        return;   // already have it
+    Keyframe kf;
+    kf.subimage = subimage;
+    kf.offset = ftell (m_file);
+    kf.disposal_method = m_disposal_method;
+    kf.canvas = m_canvas;
+    m_keyframes.insert (k, kf);
+
+    // Too much memory in snapshots: space them out further
+    while (m_keyframes.size() * m_canvas.size() > max_keyframe_bytes
+           && m_keyframes.size() > 1) {
+        m_keyframe_interval *= 2;
+        int interval = m_keyframe_interval;
+        m_keyframes.erase (std::remove_if (m_keyframes.begin(),
+                                           m_keyframes.end(),
+                                           [=](const Keyframe &f) {
+                                               return f.subimage % interval != 0;
+                                           }),
+                           m_keyframes.end());
+    }
+}
+
+
+
+const GIFInput::Keyframe *
+GIFInput::find_keyframe (int subimage) const
+{
+    const Keyframe *found = NULL;
+    for (size_t i = 0; i < m_keyframes.size() &&
+                       m_keyframes[i].subimage <= subimage; ++i)
+        found = &m_keyframes[i];
+    return found;
+}
+
+
+
 inline int
 GIFInput::decode_line_number (int line_number, int height)
 {
@@ -176,6 +323,11 @@ GIFInput::read_native_scanline (int y, int z, void *data)
 {
     if (y < 0 || y > m_spec.height || ! m_canvas.size())
         return false;
+    if (m_pending_draw) {
+        m_pending_draw = false;
+        if (! read_subimage_data ())
+            return false;
+    }
 
     memcpy (data, &m_canvas[y * m_spec.width * m_spec.nchannels],
             m_spec.width * m_spec.nchannels);
@@ -296,15 +448,19 @@ GIFInput::read_subimage_metadata (ImageSpec &newspec)
 bool
 GIFInput::read_subimage_data()
 {
-    GifColorType *colormap = NULL;
+    ColorMapObject *colormap = NULL;
     if (m_gif_file->Image.ColorMap) { // local colormap
-        colormap = m_gif_file->Image.ColorMap->Colors;
+        colormap = m_gif_file->Image.ColorMap;
     } else if (m_gif_file->SColorMap) { // global colormap
-        colormap = m_gif_file->SColorMap->Colors;
+        colormap = m_gif_file->SColorMap;
     } else {
         error ("Neither local nor global colormap present.");
         return false;
     }
+    palette_pvt::Palette palette;
+    for (int i = 0; i < colormap->ColorCount; ++i)
+        palette.set (i, colormap->Colors[i].Red, colormap->Colors[i].Green,
+                     colormap->Colors[i].Blue);
 
     if (m_subimage == 0 || m_previous_disposal_method == DISPOSE_BACKGROUND) {
         // make whole canvas transparent
@@ -320,6 +476,10 @@ GIFInput::read_subimage_data()
     int window_top    = m_gif_file->Image.Top;
     int window_left   = m_gif_file->Image.Left;
     std::unique_ptr<unsigned char[]> fscanline (new unsigned char [window_width]);
+    std::unique_ptr<unsigned char[]> rgba (new unsigned char [4 * window_width]);
+    // the part of each window row that lands on the canvas
+    int xbegin = std::max (0, -window_left);
+    int xend = std::min (window_width, m_spec.width - window_left);
     for (int wy = 0; wy < window_height; wy++) {
         if (DGifGetLine (m_gif_file, &fscanline[0], window_width) == GIF_ERROR) {
             report_last_error ();
@@ -327,17 +487,18 @@ GIFInput::read_subimage_data()
         }
         int y = window_top + (interlacing ?
                                   decode_line_number(wy, window_height) : wy);
-        if (0 <= y && y < m_spec.height) {
-            for (int wx = 0; wx < window_width; wx++) {
-                int x = window_left + wx;
-                int idx = m_spec.nchannels * (y * m_spec.width + x);
-                if (0 <= x && x < m_spec.width &&
-                        fscanline[wx] != m_transparent_color) {
-                    m_canvas[idx]     = colormap[fscanline[wx]].Red;
-                    m_canvas[idx + 1] = colormap[fscanline[wx]].Green;
-                    m_canvas[idx + 2] = colormap[fscanline[wx]].Blue;
-                    m_canvas[idx + 3] = 0xff;
-                }
+        if (0 <= y && y < m_spec.height && xbegin < xend) {
+            palette_pvt::expand (palette, &fscanline[xbegin], xend - xbegin,
+                                 4, &rgba[0]);
+            unsigned char *dst = &m_canvas[m_spec.nchannels *
+                                           (y * m_spec.width + window_left + xbegin)];
+            if (m_transparent_color < 0) {
+                memcpy (dst, &rgba[0], 4 * (xend - xbegin));
+            } else {
+                for (int wx = xbegin; wx < xend; wx++)
+                    if (fscanline[wx] != m_transparent_color)
+                        memcpy (dst + 4 * (wx - xbegin),
+                                &rgba[4 * (wx - xbegin)], 4);
             }
         }
     }
@@ -359,43 +520,43 @@ GIFInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
         return true;
     }
 
-    if (m_subimage > subimage) {
-        // requested subimage is located before the current one
-        // file needs to be reopened
-        if (m_gif_file && ! close()) {
+    if (m_pending_draw) {
+        // Later frames draw over this one, so it has to be drawn first
+        m_pending_draw = false;
+        if (m_gif_file && m_subimage < subimage && ! read_subimage_data ())
             return false;
-        }
     }
 
-    if (! m_gif_file) {
-        
-#if GIFLIB_MAJOR >= 5
-        int giflib_error;
-        if (! (m_gif_file = DGifOpenFileName (m_filename.c_str(),
-                                              &giflib_error))) {
-            error (GifErrorString (giflib_error));
-            return false; 
-        }
-#else
-        if (! (m_gif_file = DGifOpenFileName (m_filename.c_str()))) {
-            error ("Error trying to open the file.");
-            return false; 
-        }
-#endif
-        
-        m_subimage = -1;
-        m_canvas.resize (m_gif_file->SWidth * m_gif_file->SHeight * 4);
+    // Frames composite onto the ones before them, so we can only get to
+    // the requested subimage by drawing its predecessors -- from the
+    // current one if we're before it, or else from the nearest keyframe.
+    const Keyframe *kf = find_keyframe (subimage);
+    bool forward = m_gif_file && m_subimage < subimage;
+    if (kf && (! forward || kf->subimage > m_subimage + 1)) {
+        if (! m_gif_file && ! open_gif ())
+            return false;
+        fseek (m_file, kf->offset, SEEK_SET);
+        m_canvas = kf->canvas;
+        m_disposal_method = kf->disposal_method;
+        m_subimage = kf->subimage - 1;
+    } else if (! forward) {
+        // requested subimage is located before the current one
+        // file needs to be reopened
+        if (! open_gif ())
+            return false;
     }
 
     // skip subimages preceding the requested one
     if (m_subimage < subimage) {
         for (m_subimage += 1; m_subimage < subimage; m_subimage ++) {
+            save_keyframe (m_subimage);
             if (! read_subimage_metadata (newspec) ||
                 ! read_subimage_data ()) {
                 return false;
             }
         }
     }
+    save_keyframe (subimage);
 
     // read metadata of current subimage
     if (! read_subimage_metadata (newspec)) {
@@ -412,6 +573,12 @@ GIFInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
     m_spec = newspec;
     m_subimage = subimage;
 
+    if (m_headeronly) {
+        // Don't draw it until someone wants the pixels
+        m_pending_draw = true;
+        return true;
+    }
+
     // draw subimage on canvas
     if (! read_subimage_data ()) {
         return false;
@@ -449,6 +616,23 @@ GIFInput::report_last_error (void)
 
 inline bool
 GIFInput::close (void)
+{
+    bool ok = close_gif ();
+    if (m_file) {
+        fclose (m_file);
+        m_file = NULL;
+    }
+    m_canvas.clear();
+    m_keyframes.clear();
+    m_headeronly = false;
+    m_pending_draw = false;
+    return ok;
+}
+
+
+
+bool
+GIFInput::close_gif (void)
 {
     if (m_gif_file) {
 #if GIFLIB_MAJOR > 5 || (GIFLIB_MAJOR == 5 && GIFLIB_MINOR >= 1)
@@ -461,8 +645,6 @@ GIFInput::close (void)
         }
         m_gif_file = NULL;
     }
-    m_canvas.clear();
-    
     return true;
 }
 
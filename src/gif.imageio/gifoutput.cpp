@@ -37,6 +37,8 @@
 
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/platform.h"
+#include "OpenImageIO/fmath.h"
+#include "../libOpenImageIO/palette_pvt.h"
 
 namespace {
 #define GIF_TEMP_MALLOC malloc
@@ -87,6 +89,7 @@ class GIFOutput : public ImageOutput {
 
     bool start_subimage ();
     bool finish_subimage ();
+    void quantize_frame (GifPalette &pal, bool firstframe);
 };
 
 
@@ -212,11 +215,71 @@ GIFOutput::finish_subimage ()
     if (! m_pending_write)
         return true;
 
-    bool ok = GifWriteFrame (&m_gifwriter, &m_canvas[0],
-                             spec().width, spec().height,
-                             m_delay, 8 /*bitdepth*/, true /*dither*/);
+    if (! m_gifwriter.f)
+        return false;
+    // Same as gif.h's GifWriteFrame (dithered, delta against the previous
+    // frame), but with our own palette selection and color lookup.
+    GifPalette pal;
+    quantize_frame (pal, m_gifwriter.firstFrame);
+    m_gifwriter.firstFrame = false;
+    GifWriteLzwImage (m_gifwriter.f, m_gifwriter.oldImage, 0, 0,
+                      spec().width, spec().height, m_delay, &pal);
     m_pending_write = false;
-    return ok;
+    return true;
+}
+
+
+
+void
+GIFOutput::quantize_frame (GifPalette &pal, bool firstframe)
+{
+    // Palette entry 0 is reserved by gif.h as the transparent color that
+    // marks pixels unchanged since the previous frame, so there are 255
+    // left to choose.
+    const int width = spec().width, height = spec().height;
+    palette_pvt::Quantizer quant;
+    quant.build (&m_canvas[0], int64_t(width) * height, 255);
+    memset (&pal, 0, sizeof(pal));
+    pal.bitDepth = 8;
+    for (int i = 0; i < quant.size(); ++i) {
+        pal.r[i+1] = quant.color(i)[0];
+        pal.g[i+1] = quant.color(i)[1];
+        pal.b[i+1] = quant.color(i)[2];
+    }
+
+    // Floyd-Steinberg dithering into oldImage, which holds the previous
+    // frame as written (RGB of the palette color, index in alpha).
+    // Errors are kept in 1/16ths for this row and the next.
+    std::vector<int> errbuf (6 * (width + 2), 0);
+    int *err = &errbuf[3], *nexterr = &errbuf[3 * (width + 2) + 3];
+    const uint8_t *in = &m_canvas[0];
+    uint8_t *out = m_gifwriter.oldImage;
+    for (int y = 0; y < height; ++y) {
+        std::fill (nexterr - 3, nexterr + 3 * (width + 1), 0);
+        for (int x = 0; x < width; ++x, in += 4, out += 4) {
+            int want[3];
+            for (int c = 0; c < 3; ++c)
+                want[c] = clamp (in[c] + (err[3*x+c] + 8) / 16, 0, 255);
+            if (! firstframe && out[0] == want[0] && out[1] == want[1]
+                             && out[2] == want[2]) {
+                out[3] = kGifTransIndex;
+                continue;
+            }
+            int index = quant.nearest (want[0], want[1], want[2]) + 1;
+            out[0] = pal.r[index];
+            out[1] = pal.g[index];
+            out[2] = pal.b[index];
+            out[3] = uint8_t(index);
+            for (int c = 0; c < 3; ++c) {
+                int e = want[c] - out[c];
+                err[3*(x+1)+c]     += 7 * e;
+                nexterr[3*(x-1)+c] += 3 * e;
+                nexterr[3*x+c]     += 5 * e;
+                nexterr[3*(x+1)+c] += e;
+            }
+        }
+        std::swap (err, nexterr);
+    }
 }
 
 
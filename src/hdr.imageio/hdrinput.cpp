@@ -62,6 +62,8 @@ public:
     virtual const char * format_name (void) const { return "hdr"; }
     virtual bool open (const std::string &name, ImageSpec &spec);
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
     virtual bool close ();
     virtual int current_subimage (void) const { return m_subimage; }
     virtual bool seek_subimage (int subimage, int miplevel, ImageSpec &newspec);
@@ -72,6 +74,7 @@ private:
     int m_subimage;               ///< What subimage are we looking at?
     int m_next_scanline;          ///< Next scanline to read
     char rgbe_error[1024];        ///< Buffer for RGBE library error msgs
+    std::vector<float> m_skipbuf; ///< Scratch for skipped scanlines
 
     void init () {
         m_fd = NULL;
@@ -160,6 +163,15 @@ HdrInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
 bool
 HdrInput::read_native_scanline (int y, int z, void *data)
 {
+    return read_native_scanlines (y, y+1, z, data);
+}
+
+
+
+bool
+HdrInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    int y = ybegin;
     if (m_next_scanline > y) {
         // User is trying to read an earlier scanline than the one we're
         // up to.  Easy fix: close the file and re-open.
@@ -173,14 +185,25 @@ HdrInput::read_native_scanline (int y, int z, void *data)
         assert (m_next_scanline == 0 && current_subimage() == subimage &&
                 current_miplevel() == miplevel);
     }
-    while (m_next_scanline <= y) {
-        // Keep reading until we're read the scanline we really need
-        int r = RGBE_ReadPixels_RLE (m_fd, (float *)data, m_spec.width, 1, rgbe_error);
-        ++m_next_scanline;
+    if (m_next_scanline < y) {
+        // Skip ahead to the first scanline we really need
+        m_skipbuf.resize (size_t(y - m_next_scanline) * m_spec.width * 3);
+        int r = RGBE_ReadPixels_RLE (m_fd, &m_skipbuf[0], m_spec.width,
+                                     y - m_next_scanline, rgbe_error);
+        std::vector<float>().swap (m_skipbuf);
         if (r != RGBE_RETURN_SUCCESS) {
             error ("%s", rgbe_error);
             return false;
         }
+        m_next_scanline = y;
+    }
+    // Decode the whole block of scanlines in one call
+    int r = RGBE_ReadPixels_RLE (m_fd, (float *)data, m_spec.width,
+                                 yend - ybegin, rgbe_error);
+    m_next_scanline = yend;
+    if (r != RGBE_RETURN_SUCCESS) {
+        error ("%s", rgbe_error);
+        return false;
     }
     return true;
 }
@@ -37,6 +37,7 @@
 #include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/strutil.h"
+#include "OpenImageIO/parallel.h"
 #include "rgbe.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
@@ -50,6 +51,10 @@ class HdrOutput : public ImageOutput {
                        OpenMode mode);
     virtual bool write_scanline (int y, int z, TypeDesc format,
                                  const void *data, stride_t xstride);
+    virtual bool write_scanlines (int ybegin, int yend, int z,
+                                  TypeDesc format, const void *data,
+                                  stride_t xstride=AutoStride,
+                                  stride_t ystride=AutoStride);
     virtual bool write_tile (int x, int y, int z, TypeDesc format,
                              const void *data, stride_t xstride,
                              stride_t ystride, stride_t zstride);
@@ -160,6 +165,43 @@ HdrOutput::write_scanline (int y, int z, TypeDesc format,
 
 
 
+bool
+HdrOutput::write_scanlines (int ybegin, int yend, int z, TypeDesc format,
+                            const void *data, stride_t xstride,
+                            stride_t ystride)
+{
+    // Each scanline is RLE encoded independently, so encode a batch of
+    // them in parallel, then write them out in order.
+    stride_t zstride = AutoStride;
+    m_spec.auto_stride (xstride, ystride, zstride, format, m_spec.nchannels,
+                        m_spec.width, yend-ybegin);
+    const int batch = 64;
+    std::vector<std::vector<unsigned char> > encoded (batch);
+    for (int y = ybegin; y < yend; y += batch) {
+        int n = std::min (batch, yend - y);
+        const char *batchdata = (const char *)data + stride_t(y - ybegin) * ystride;
+        parallel_for (0, n, [&](int64_t i){
+            std::vector<unsigned char> scratch;
+            const void *native = to_native_scanline (format,
+                                        batchdata + i * ystride,
+                                        xstride, scratch, 0, y + int(i), z);
+            encoded[i].clear ();
+            RGBE_EncodePixels_RLE ((const float *)native, m_spec.width, 1,
+                                   encoded[i]);
+        });
+        for (int i = 0; i < n; ++i) {
+            if (encoded[i].size() &&
+                fwrite (&encoded[i][0], encoded[i].size(), 1, m_fd) != 1) {
+                error ("RGBE write error");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+
 bool
 HdrOutput::write_tile (int x, int y, int z, TypeDesc format,
                        const void *data, stride_t xstride,
@@ -3,6 +3,7 @@
  * IT IS STRICTLY USE AT YOUR OWN RISK.  */
 
 #include "rgbe.h"
+#include "OpenImageIO/simd.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,6 +31,11 @@
  3. Change the default programtype string from "RGBE" to "RADIANCE" since
     I noticed that some hdr/rgbe readers (including OS X's preivew util)
     will only accept "RADIANCE" as the programtype.
+ Later changes for OIIO:
+ 4. Convert rgbe to float with an exponent table, 4 pixels at a time with
+    SIMD for the (planar) RLE scanlines.
+ 5. RLE encoding can go to a memory buffer, so that callers can encode
+    scanlines in parallel and write them in order.
 */
 
 #if defined(_CPLUSPLUS) || defined(__cplusplus)
@@ -111,22 +117,56 @@ float2rgbe(unsigned char rgbe[4], float red, float green, float blue)
   }
 }
 
+/* the scale ldexpf(1.0f,e-(128+8)) for each exponent byte e, and 0 for */
+/* the e == 0 that marks a zero pixel */
+static struct rgbe_exponent_table {
+  float scale[256];
+  rgbe_exponent_table () {
+    scale[0] = 0.0f;
+    for (int e = 1; e < 256; ++e)
+      scale[e] = ldexpf(1.0f,e-(int)(128+8));
+  }
+} rgbe_exponents;
+
 /* standard conversion from rgbe to float pixels */
 /* note: Ward uses ldexp(col+0.5,exp-(128+8)).  However we wanted pixels */
 /*       in the range [0,1] to map back into the range [0,1].            */
 static INLINE void 
-rgbe2float(float *red, float *green, float *blue, unsigned char rgbe[4])
+rgbe2float(float *red, float *green, float *blue, const unsigned char rgbe[4])
 {
-  float f;
+  float f = rgbe_exponents.scale[rgbe[3]];
+  *red = rgbe[0] * f;
+  *green = rgbe[1] * f;
+  *blue = rgbe[2] * f;
+}
 
-  if (rgbe[3]) {   /*nonzero pixel*/
-    f = ldexpf(1.0f,rgbe[3]-(int)(128+8));
-    *red = rgbe[0] * f;
-    *green = rgbe[1] * f;
-    *blue = rgbe[2] * f;
+/* convert a scanline held as separate runs of r, g, b and e bytes (as RLE */
+/* scanlines are stored) to float pixels, 4 at a time */
+static void
+rgbe_planar2float(float *data, const unsigned char *buf, int width)
+{
+  const unsigned char *r = buf, *g = buf + width, *b = buf + 2*width;
+  const unsigned char *e = buf + 3*width;
+  const float *scale = rgbe_exponents.scale;
+  int i = 0;
+  for ( ; i+4 <= width; i += 4, data += 4*RGBE_DATA_SIZE) {
+    simd::float4 f (scale[e[i]], scale[e[i+1]], scale[e[i+2]], scale[e[i+3]]);
+    simd::float4 p0, p1, p2, p3;
+    simd::transpose (simd::float4(r+i) * f, simd::float4(g+i) * f,
+                     simd::float4(b+i) * f, simd::float4::Zero(),
+                     p0, p1, p2, p3);
+    /* each store spills one float into the next pixel, which the next */
+    /* store overwrites; the last one must not go past the scanline */
+    p0.store (data);
+    p1.store (data + RGBE_DATA_SIZE);
+    p2.store (data + 2*RGBE_DATA_SIZE);
+    p3.store (data + 3*RGBE_DATA_SIZE, 3);
+  }
+  for ( ; i < width; i++, data += RGBE_DATA_SIZE) {
+    unsigned char rgbe[4] = { r[i], g[i], b[i], e[i] };
+    rgbe2float(&data[RGBE_DATA_RED],&data[RGBE_DATA_GREEN],
+               &data[RGBE_DATA_BLUE],rgbe);
   }
-  else
-    *red = *green = *blue = 0.0;
 }
 
 /* default minimal header. modify if you want more information in header */
@@ -289,14 +329,18 @@ int RGBE_WritePixels(FILE *fp, float *data, int numpixels,
 int RGBE_ReadPixels(FILE *fp, float *data, int numpixels,
                     char *errbuf)
 {
-  unsigned char rgbe[4];
+  /* read in chunks rather than a pixel at a time */
+  const int chunk = 4096;
+  unsigned char rgbe[4*chunk];
 
-  while(numpixels-- > 0) {
-    if (fread(rgbe, sizeof(rgbe), 1, fp) < 1)
+  while(numpixels > 0) {
+    int n = numpixels < chunk ? numpixels : chunk;
+    if (fread(rgbe, 4, n, fp) < (size_t)n)
       return rgbe_error(rgbe_read_error,NULL, errbuf);
-    rgbe2float(&data[RGBE_DATA_RED],&data[RGBE_DATA_GREEN],
-	       &data[RGBE_DATA_BLUE],rgbe);
-    data += RGBE_DATA_SIZE;
+    for (int i = 0; i < n; i++, data += RGBE_DATA_SIZE)
+      rgbe2float(&data[RGBE_DATA_RED],&data[RGBE_DATA_GREEN],
+                 &data[RGBE_DATA_BLUE],&rgbe[4*i]);
+    numpixels -= n;
   }
   return RGBE_RETURN_SUCCESS;
 }
@@ -306,12 +350,11 @@ int RGBE_ReadPixels(FILE *fp, float *data, int numpixels,
 /* save some space.  For each scanline, each channel (r,g,b,e) is */
 /* encoded separately for better compression. */
 
-static int RGBE_WriteBytes_RLE(FILE *fp, unsigned char *data, int numbytes,
-                               char *errbuf)
+static void RGBE_EncodeBytes_RLE(const unsigned char *data, int numbytes,
+                                 std::vector<unsigned char> &out)
 {
 #define MINRUNLENGTH 4
   int cur, beg_run, run_count, old_run_count, nonrun_count;
-  unsigned char buf[2];
 
   cur = 0;
   while(cur < numbytes) {
@@ -322,16 +365,14 @@ static int RGBE_WriteBytes_RLE(FILE *fp, unsigned char *data, int numbytes,
       beg_run += run_count;
       old_run_count = run_count;
       run_count = 1;
-      while((data[beg_run] == data[beg_run + run_count]) 
-	    && (beg_run + run_count < numbytes) && (run_count < 127))
+      while((beg_run + run_count < numbytes) && (run_count < 127)
+            && (data[beg_run] == data[beg_run + run_count]))
 	run_count++;
     }
     /* if data before next big run is a short run then write it as such */
     if ((old_run_count > 1)&&(old_run_count == beg_run - cur)) {
-      buf[0] = 128 + old_run_count;   /*write short run*/
-      buf[1] = data[cur];
-      if (fwrite(buf,sizeof(buf[0])*2,1,fp) < 1)
-	return rgbe_error(rgbe_write_error,NULL, errbuf);
+      out.push_back((unsigned char)(128 + old_run_count));   /*write short run*/
+      out.push_back(data[cur]);
       cur = beg_run;
     }
     /* write out bytes until we reach the start of the next run */
@@ -339,50 +380,42 @@ static int RGBE_WriteBytes_RLE(FILE *fp, unsigned char *data, int numbytes,
       nonrun_count = beg_run - cur;
       if (nonrun_count > 128) 
 	nonrun_count = 128;
-      buf[0] = nonrun_count;
-      if (fwrite(buf,sizeof(buf[0]),1,fp) < 1)
-	return rgbe_error(rgbe_write_error,NULL, errbuf);
-      if (fwrite(&data[cur],sizeof(data[0])*nonrun_count,1,fp) < 1)
-	return rgbe_error(rgbe_write_error,NULL, errbuf);
+      out.push_back((unsigned char)nonrun_count);
+      out.insert(out.end(), data + cur, data + cur + nonrun_count);
       cur += nonrun_count;
     }
     /* write out next run if one was found */
     if (run_count >= MINRUNLENGTH) {
-      buf[0] = 128 + run_count;
-      buf[1] = data[beg_run];
-      if (fwrite(buf,sizeof(buf[0])*2,1,fp) < 1)
-	return rgbe_error(rgbe_write_error,NULL, errbuf);
+      out.push_back((unsigned char)(128 + run_count));
+      out.push_back(data[beg_run]);
       cur += run_count;
     }
   }
-  return RGBE_RETURN_SUCCESS;
 #undef MINRUNLENGTH
 }
 
-int RGBE_WritePixels_RLE(FILE *fp, float *data, int scanline_width,
-			 int num_scanlines, char *errbuf)
+void RGBE_EncodePixels_RLE(const float *data, int scanline_width,
+                           int num_scanlines, std::vector<unsigned char> &out)
 {
   unsigned char rgbe[4];
-  unsigned char *buffer;
-  int i, err;
 
-  if ((scanline_width < 8)||(scanline_width > 0x7fff))
+  if ((scanline_width < 8)||(scanline_width > 0x7fff)) {
     /* run length encoding is not allowed so write flat*/
-    return RGBE_WritePixels(fp,data,scanline_width*num_scanlines);
-  buffer = (unsigned char *)malloc(sizeof(unsigned char)*4*scanline_width);
-  if (buffer == NULL) 
-    /* no buffer space so write flat */
-    return RGBE_WritePixels(fp,data,scanline_width*num_scanlines);
-  while(num_scanlines-- > 0) {
-    rgbe[0] = 2;
-    rgbe[1] = 2;
-    rgbe[2] = scanline_width >> 8;
-    rgbe[3] = scanline_width & 0xFF;
-    if (fwrite(rgbe, sizeof(rgbe), 1, fp) < 1) {
-      free(buffer);
-      return rgbe_error(rgbe_write_error,NULL, errbuf);
+    for (int i = 0; i < scanline_width*num_scanlines; i++) {
+      float2rgbe(rgbe,data[RGBE_DATA_RED],
+                 data[RGBE_DATA_GREEN],data[RGBE_DATA_BLUE]);
+      out.insert(out.end(), rgbe, rgbe+4);
+      data += RGBE_DATA_SIZE;
     }
-    for(i=0;i<scanline_width;i++) {
+    return;
+  }
+  std::vector<unsigned char> buffer(4*scanline_width);
+  while(num_scanlines-- > 0) {
+    out.push_back(2);
+    out.push_back(2);
+    out.push_back((unsigned char)(scanline_width >> 8));
+    out.push_back((unsigned char)(scanline_width & 0xFF));
+    for(int i=0;i<scanline_width;i++) {
       float2rgbe(rgbe,data[RGBE_DATA_RED],
 		 data[RGBE_DATA_GREEN],data[RGBE_DATA_BLUE]);
       buffer[i] = rgbe[0];
@@ -393,18 +426,21 @@ int RGBE_WritePixels_RLE(FILE *fp, float *data, int scanline_width,
     }
     /* write out each of the four channels separately run length encoded */
     /* first red, then green, then blue, then exponent */
-    for(i=0;i<4;i++) {
-      if ((err = RGBE_WriteBytes_RLE(fp,&buffer[i*scanline_width],
-				     scanline_width, errbuf)) != RGBE_RETURN_SUCCESS) {
-	free(buffer);
-	return err;
-      }
-    }
+    for(int i=0;i<4;i++)
+      RGBE_EncodeBytes_RLE(&buffer[i*scanline_width], scanline_width, out);
   }
-  free(buffer);
+}
+
+int RGBE_WritePixels_RLE(FILE *fp, float *data, int scanline_width,
+			 int num_scanlines, char *errbuf)
+{
+  std::vector<unsigned char> encoded;
+  RGBE_EncodePixels_RLE(data, scanline_width, num_scanlines, encoded);
+  if (encoded.size() && fwrite(&encoded[0], encoded.size(), 1, fp) < 1)
+    return rgbe_error(rgbe_write_error,NULL, errbuf);
   return RGBE_RETURN_SUCCESS;
 }
-      
+
 int RGBE_ReadPixels_RLE(FILE *fp, float *data, int scanline_width,
 			int num_scanlines, char *errbuf)
 {
@@ -477,15 +513,8 @@ int RGBE_ReadPixels_RLE(FILE *fp, float *data, int scanline_width,
       }
     }
     /* now convert data from buffer into floats */
-    for(i=0;i<scanline_width;i++) {
-      rgbe[0] = scanline_buffer[i];
-      rgbe[1] = scanline_buffer[i+scanline_width];
-      rgbe[2] = scanline_buffer[i+2*scanline_width];
-      rgbe[3] = scanline_buffer[i+3*scanline_width];
-      rgbe2float(&data[RGBE_DATA_RED],&data[RGBE_DATA_GREEN],
-		 &data[RGBE_DATA_BLUE],rgbe);
-      data += RGBE_DATA_SIZE;
-    }
+    rgbe_planar2float(data, scanline_buffer, scanline_width);
+    data += RGBE_DATA_SIZE*scanline_width;
     num_scanlines--;
   }
   free(scanline_buffer);
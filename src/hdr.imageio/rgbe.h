@@ -9,6 +9,7 @@
 */
 
 #include <stdio.h>
+#include <vector>
 
 #include "OpenImageIO/imageio.h"
 
@@ -61,6 +62,11 @@ int RGBE_WritePixels_RLE(FILE *fp, float *data, int scanline_width,
 int RGBE_ReadPixels_RLE(FILE *fp, float *data, int scanline_width,
 			int num_scanlines, char *errbuf=NULL);
 
+/* run length encode scanlines into memory, appending to out (OIIO addition, */
+/* so that scanlines can be encoded in parallel) */
+void RGBE_EncodePixels_RLE(const float *data, int scanline_width,
+                           int num_scanlines, std::vector<unsigned char> &out);
+
 OIIO_PLUGIN_NAMESPACE_END
 
 #endif /* _H_RGBE */
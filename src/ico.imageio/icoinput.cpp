@@ -34,6 +34,7 @@
 
 #include "ico.h"
 #include "../png.imageio/png_pvt.h"
+#include "../libOpenImageIO/palette_pvt.h"
 
 #include "OpenImageIO/dassert.h"
 #include "OpenImageIO/typedesc.h"
@@ -113,6 +114,9 @@ OIIO_EXPORT const char* ico_imageio_library_version () { return NULL; }
 OIIO_EXPORT const char * ico_input_extensions[] = {
     "ico", NULL
 };
+OIIO_EXPORT const char * ico_input_magic[] = {
+    "00000100", NULL
+};
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -306,11 +310,15 @@ ICOInput::readimg ()
 
     // icons < 16bpp are colour-indexed, so load the palette
     // a palette consists of 4-byte BGR quads, with the last byte unused (reserved)
-    std::vector<ico_palette_entry> palette (m_palette_size);
+    palette_pvt::Palette palette;
     if (m_bpp < 16) { // >= 16-bit icons are unpaletted
-        for (int i = 0; i < m_palette_size; i++)
-            if (! fread (&palette[i], 1, sizeof (ico_palette_entry)))
+        for (int i = 0; i < m_palette_size; i++) {
+            ico_palette_entry pe;
+            if (! fread (&pe, 1, sizeof (ico_palette_entry)))
                 return false;
+            palette.set (i, (unsigned char)pe.r, (unsigned char)pe.g,
+                         (unsigned char)pe.b);
+        }
     }
 
     // read the colour data (the 1-bit transparency is added later on)
@@ -318,46 +326,21 @@ ICOInput::readimg ()
     int slb = (m_spec.width * m_bpp + 7) / 8 // real data bytes
               + (4 - ((m_spec.width * m_bpp + 7) / 8) % 4) % 4; // padding
     std::vector<unsigned char> scanline (slb);
-    ico_palette_entry *pe;
     int k;
     for (int y = m_spec.height - 1; y >= 0; y--) {
         if (! fread (&scanline[0], 1, slb))
             return false;
+        if (m_bpp <= 8) {
+            // colour-indexed, expand the whole row through the palette
+            palette_pvt::expand_packed (palette, &scanline[0], m_bpp,
+                                        m_spec.width, 4,
+                                        &m_buf[y * m_spec.width * 4]);
+            continue;
+        }
         for (int x = 0; x < m_spec.width; x++) {
             k = y * m_spec.width * 4 + x * 4;
             // fill the buffer
             switch (m_bpp) {
-            case 1:
-                pe = &palette[(scanline[x / 8] & (1 << (7 - x % 8))) != 0];
-                m_buf[k + 0] = pe->r;
-                m_buf[k + 1] = pe->g;
-                m_buf[k + 2] = pe->b;
-                break;
-            case 4:
-                pe = &palette[(scanline[x / 2] & 0xF0) >> 4];
-                m_buf[k + 0] = pe->r;
-                m_buf[k + 1] = pe->g;
-                m_buf[k + 2] = pe->b;
-                // 2 pixels per byte
-                pe = &palette[scanline[x / 2] & 0x0F];
-                if (x == m_spec.width - 1)
-                    break; // avoid buffer overflows
-                x++;
-                m_buf[k + 4] = pe->r;
-                m_buf[k + 5] = pe->g;
-                m_buf[k + 6] = pe->b;
-                /*std::cerr << "[ico] " << y << " 2*4bit pixel: "
-                          << ((int)scanline[x / 2]) << " -> "
-                          << ((int)(scanline[x / 2] & 0xF0) >> 4)
-                          << " & " << ((int)(scanline[x / 2]) & 0x0F)
-                          << "\n";*/
-                break;
-            case 8:
-                pe = &palette[scanline[x]];
-                m_buf[k + 0] = pe->r;
-                m_buf[k + 1] = pe->g;
-                m_buf[k + 2] = pe->b;
-                break;
             // bpp values > 8 mean non-indexed BGR(A) images
 #if 0
             // doesn't seem like ICOs can really be 16-bit, where did I even get
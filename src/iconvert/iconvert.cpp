@@ -228,7 +228,13 @@ adjust_spec (ImageInput *in, ImageOutput *out,
             outspec.set_format (TypeDesc::DOUBLE);
         outspec.channelformats.clear ();
     }
-    if (outspec.format != inspec.format || inspec.channelformats.size())
+    // Mixed channel formats that are passed through unchanged don't
+    // preclude a copy (OpenEXR to OpenEXR can then copy raw chunks).
+    bool sameformat = (outspec.format == inspec.format &&
+                       inspec.channelformats.empty()) ||
+                      (outspec.format == TypeDesc::UNKNOWN &&
+                       outspec.channelformats == inspec.channelformats);
+    if (! sameformat)
         nocopy = true;
     
     outspec.attribute ("oiio:Gamma", gammaval);
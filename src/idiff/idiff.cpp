@@ -74,6 +74,7 @@ static float failthresh = 1.0e-6f;
 static float failpercent = 0;
 static bool perceptual = false;
 static float hardfail = std::numeric_limits<float>::max();
+static bool failfast = false;
 static std::vector<std::string> filenames;
 //static bool comparemeta = false;
 static bool compareall = false;
@@ -107,6 +108,7 @@ getargs (int argc, char *argv[])
                   "-fail %g", &failthresh, "Failure threshold difference (0.000001)",
                   "-failpercent %g", &failpercent, "Allow this percentage of failures (0)",
                   "-hardfail %g", &hardfail, "Fail if any one pixel exceeds this error (infinity)",
+                  "-failfast", &failfast, "Stop comparing as soon as the failure limits are exceeded",
                   "-warn %g", &warnthresh, "Warning threshold difference (0.00001)",
                   "-warnpercent %g", &warnpercent, "Allow this percentage of warnings (0)",
                   "-hardwarn %g", &hardwarn, "Warn if any one pixel exceeds this error (infinity)",
@@ -264,7 +266,12 @@ main (int argc, char *argv[])
             // Compare the two images.
             //
             ImageBufAlgo::CompareResults cr;
-            ImageBufAlgo::compare (img0, img1, failthresh, warnthresh, cr);
+            if (failfast)
+                ImageBufAlgo::compare (img0, img1, failthresh, warnthresh,
+                                       imagesize_t(failpercent/100.0 * npels),
+                                       hardfail, cr);
+            else
+                ImageBufAlgo::compare (img0, img1, failthresh, warnthresh, cr);
 
             int yee_failures = 0;
             if (perceptual && ! img0.deep()) {
@@ -328,6 +335,8 @@ main (int argc, char *argv[])
                               << std::setprecision(3) << (100.0*yee_failures / npels) 
                               << std::setprecision(precis)
                               << "%) failed the perceptual test\n";
+                if (failfast && ret == ErrFail)
+                    std::cout << "  (-failfast: stopped once it failed, so these are for part of the image)\n";
             }
 
             // If the user requested that a difference image be output,
@@ -162,8 +162,10 @@ private:
     // helper to read an image
     bool readimg (void);
     
-    // helper to uncompress a rle channel
-    size_t uncompress_rle_channel(const uint8_t *in, uint8_t * out, int size);
+    // helper to uncompress a rle channel from the inlen bytes at in,
+    // returning how many were used (0 if it was corrupt)
+    size_t uncompress_rle_channel (const uint8_t *in, size_t inlen,
+                                   uint8_t *out, int size);
 
     bool read_short (uint16_t& val) {
         bool ok = fread (&val, sizeof(val), 1, m_fd);
@@ -226,6 +228,7 @@ private:
     std::vector<uint8_t> m_buf;
     unsigned int m_dither;
     std::vector<uint8_t> scratch;    
+    std::vector<uint8_t> m_rle;     // an encoded channel
 
     void init (void) {
         m_fd = NULL;
@@ -262,12 +265,6 @@ private:
             && (val.size() == 0 || write_str (val));
     }
 
-    // helper to compress verbatim
-    void compress_verbatim (const uint8_t *& in, uint8_t *& out, int size);
-      
-    // helper to compress duplicate
-    void compress_duplicate (const uint8_t *&in, uint8_t *& out, int size);
-      
     // helper to compress a rle channel
     size_t compress_rle_channel (const uint8_t *in, uint8_t *out, int size);
 };
@@ -28,6 +28,7 @@
   (This is the Modified BSD License)
 */
 #include "iff_pvt.h"
+#include "../libOpenImageIO/rle_pvt.h"
 
 #include <cmath>
 
@@ -46,6 +47,9 @@ OIIO_PLUGIN_EXPORTS_BEGIN
     OIIO_EXPORT const char *iff_input_extensions[] = {
         "iff", "z", NULL
     };
+    OIIO_EXPORT const char *iff_input_magic[] = {
+        "464f5234", NULL
+    };
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -311,7 +315,14 @@ IffInput::readimg()
                     uint8_t *in_p = &in[0];
           
                     // uncompress and increment
-                    p += uncompress_rle_channel (p, in_p, tw * th);
+                    size_t used = uncompress_rle_channel (p,
+                                      scratch.size() - (p - &scratch[0]),
+                                      in_p, tw * th);
+                    if (! used) {
+                        error ("Corrupt RLE data");
+                        return false;
+                    }
+                    p += used;
             
                     // set tile
                     for (uint16_t py=ymin; py<=ymax; py++) {
@@ -398,7 +409,14 @@ IffInput::readimg()
                     uint8_t *in_p = &in[0];
               
                     // uncompress and increment
-                    p += uncompress_rle_channel (p, in_p, tw * th);
+                    size_t used = uncompress_rle_channel (p,
+                                      scratch.size() - (p - &scratch[0]),
+                                      in_p, tw * th);
+                    if (! used) {
+                        error ("Corrupt RLE data");
+                        return false;
+                    }
+                    p += used;
 
                     // set tile
                     for (uint16_t py=ymin; py<=ymax; py++) {
@@ -488,33 +506,10 @@ IffInput::readimg()
 
 
 size_t
-IffInput::uncompress_rle_channel(
-    const uint8_t * in, uint8_t * out, int size
-)
+IffInput::uncompress_rle_channel (const uint8_t *in, size_t inlen,
+                                  uint8_t *out, int size)
 {
-    const uint8_t * const _in = in;
-    const uint8_t * const end = out + size;
-
-    while (out < end) {
-        // information.
-        const uint8_t count = (*in & 0x7f) + 1;
-        const bool run = (*in & 0x80) ? true : false;
-        ++in;
-
-        // find runs
-        if (!run) {
-            // verbatim
-            for (int i=0; i<count; i++)
-            *out++ = *in++;
-        } else {
-            // duplicate
-            const uint8_t p = *in++;
-            for (int i=0; i<count; i++)
-                *out++ = p;
-        }
-    }
-    const size_t r = in - _in;
-    return r;
+    return rle_pvt::decode (rle_pvt::HighBitRun, in, inlen, out, size, 1);
 }
 
 OIIO_PLUGIN_NAMESPACE_END
@@ -29,6 +29,7 @@
 */
 
 #include "iff_pvt.h"
+#include "../libOpenImageIO/rle_pvt.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -559,87 +560,14 @@ IffOutput::close (void)
 
 
 
-void
-IffOutput::compress_verbatim (
-    const uint8_t *& in, uint8_t *& out, int size)
-{
-    int count = 1;
-    unsigned char byte = 0;
-
-    // two in a row or count
-    for (; count < size; ++count)
-    {
-        if (in[count - 1] == in[count]) 
-        {
-            if (byte == in[count - 1])
-            {
-                count -= 2;
-                break;
-            }
-        }
-        byte = in[count - 1];
-    }
-
-    // copy
-    *out++ = count - 1;
-    memcpy (out, in, count);
-
-    out += count;
-    in += count;
-}
-
-
-
-void
-IffOutput::compress_duplicate (
-    const uint8_t *& in, uint8_t *& out, int size)
-{
-    int count = 1;
-    for (; count < size; ++count)
-    {
-        if (in[count - 1] != in[count]) break; 
-    }
-  
-    const bool run = count > 1;
-    const int length = run ? 1 : count;
-    
-    // copy
-    *out++ = ((count - 1) & 0x7f) | (run << 7);
-    *out = *in;
-
-    out += length;
-    in += count;
-}
-
-
-
 size_t 
 IffOutput::compress_rle_channel (
     const uint8_t * in, uint8_t * out, int size)
 {
-    const uint8_t * const _out = out;
-    const uint8_t * const end = in + size;
-  
-    while (in < end) 
-    {
-        // find runs
-        const int max = std::min (0x7f + 1, static_cast<int>(end - in));
-        if (max > 0)
-        {
-            if (in[0] != in[1])
-            {
-                // compress verbatim
-                compress_verbatim (in, out, max);
-            }
-            else
-            {
-                // compress duplicate
-                compress_duplicate (in, out, max);
-            }
-        }
-    }
-    const size_t r = out - _out;
-    return r;
+    m_rle.clear ();
+    rle_pvt::encode (rle_pvt::HighBitRun, in, size, 1, m_rle);
+    memcpy (out, &m_rle[0], m_rle.size());
+    return m_rle.size();
 }
 
 
@@ -43,6 +43,7 @@
 #include "OpenImageIO/strutil.h"
 #include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/imageio.h"
+#include "OpenImageIO/parallel.h"
 
 OIIO_NAMESPACE_USING;
 
@@ -55,39 +56,109 @@ static bool file_match = false;
 static bool print_dirs = false;
 static bool all_subimages = false;
 static bool extended_regex = false;
+static int nthreads = 0;     // 0 = use all cores
 static std::string pattern;
+static std::string attrib_pattern;
+static boost::regex attrib_re;
 static std::vector<std::string> filenames;
 
+#if OIIO_MSVS_BEFORE_2015
+#define IGREP_PARALLEL 0
+#else
+#define IGREP_PARALLEL 1
+#endif
 
 
-static bool
-grep_file (const std::string &filename, boost::regex &re,
-           bool ignore_nonimage_files=false)
-{
-    if (! Filesystem::exists (filename)) {
-        std::cerr << "igrep: " << filename << ": No such file or directory\n";
-        return false;
-    }
 
+// One thing to search: an image file (or what we hope is one), or a
+// directory whose name we print when recursing with -d.
+struct Item {
+    std::string name;
+    bool directory;
+    bool from_directory;    // found by recursing, so ok if not an image
+};
+
+
+
+// Expand the named file or directory into the items to search, in the
+// order they would be visited by a depth-first walk.
+static void
+gather (const std::string &filename, bool from_directory,
+        std::vector<Item> &items)
+{
     if (Filesystem::is_directory (filename)) {
         if (! recursive)
-            return false;
-        if (print_dirs) {
-            std::cout << "(" << filename << "/)\n";
-            std::cout.flush();
-        }
-        bool r = false;
+            return;
+        items.push_back (Item { filename, true, from_directory });
         std::vector<std::string> directory_entries;
         Filesystem::get_directory_entries (filename, directory_entries);
-        for (size_t i = 0, e = directory_entries.size(); i < e; ++i)
-            r |= grep_file (directory_entries[i], re, true);
-        return r;
+        for (auto&& e : directory_entries)
+            gather (e, true, items);
+    } else {
+        items.push_back (Item { filename, false, from_directory });
+    }
+}
+
+
+
+// Does the value of ParamValue p match re?  Without an attribute name
+// filter, only string metadata are searched.  Attributes picked out by
+// --attrib are searched whatever their type, formatted as iinfo would.
+// Append a line for each match unless we're only listing files.
+static bool
+grep_attribute (const std::string &filename, const ParamValue &p,
+                const boost::regex &re, std::string &out)
+{
+    bool found = false;
+    TypeDesc t = p.type();
+    if (t.elementtype() == TypeDesc::STRING) {
+        int n = t.numelements();
+        for (int i = 0;  i < n;  ++i) {
+            const char *val = ((const char **)p.data())[i];
+            bool match = boost::regex_search (val, re);
+            found |= match;
+            if (match && ! invert_match) {
+                if (list_files)
+                    return true;
+                out += Strutil::format ("%s: %s = %s\n", filename, p.name(), val);
+            }
+        }
+    } else if (! attrib_pattern.empty()) {
+        std::string val = ImageSpec::metadata_val (p);
+        found = boost::regex_search (val, re);
+        if (found && ! invert_match && ! list_files)
+            out += Strutil::format ("%s: %s = %s\n", filename, p.name(), val);
+    }
+    return found;
+}
+
+
+
+// Search one file, appending what we'd print to out (and err).
+static bool
+grep_file (const Item &item, const boost::regex &re,
+           std::string &out, std::string &err)
+{
+    const std::string &filename (item.name);
+    if (item.directory) {
+        if (print_dirs)
+            out += Strutil::format ("(%s/)\n", filename);
+        return false;
+    }
+    if (! Filesystem::exists (filename)) {
+        err += Strutil::format ("igrep: %s: No such file or directory\n", filename);
+        return false;
     }
 
-    std::unique_ptr<ImageInput> in (ImageInput::open (filename.c_str()));
+    // We only search metadata, so the plugins needn't set up for pixels
+    ImageSpec config;
+    config.attribute ("oiio:headeronly", 1);
+    std::unique_ptr<ImageInput> in (ImageInput::open (filename.c_str(),
+                                                      &config));
     if (! in.get()) {
-        if (! ignore_nonimage_files)
-            std::cerr << geterror() << "\n";
+        std::string e = geterror();
+        if (! item.from_directory)
+            err += e + "\n";
         return false;
     }
     ImageSpec spec = in->spec();
@@ -95,7 +166,7 @@ grep_file (const std::string &filename, boost::regex &re,
     if (file_match) {
         bool match = boost::regex_search (filename, re);
         if (match && ! invert_match) {
-            std::cout << filename << "\n";
+            out += filename + "\n";
             return true;
         }
     }
@@ -106,21 +177,13 @@ grep_file (const std::string &filename, boost::regex &re,
         if (!all_subimages && subimage > 0)
             break;
         for (auto&& p : spec.extra_attribs) {
-            TypeDesc t = p.type();
-            if (t.elementtype() == TypeDesc::STRING) {
-                int n = t.numelements();
-                for (int i = 0;  i < n;  ++i) {
-                    bool match = boost::regex_search (((const char **)p.data())[i], re);
-                    found |= match;
-                    if (match && ! invert_match) {
-                        if (list_files) {
-                            std::cout << filename << "\n";
-                            return found;
-                        }
-                        std::cout << filename << ": " << p.name() << " = " 
-                                  << ((const char **)p.data())[i] << "\n";
-                    }
-                }
+            if (! attrib_pattern.empty() &&
+                ! boost::regex_search (p.name().c_str(), attrib_re))
+                continue;
+            found |= grep_attribute (filename, p, re, out);
+            if (found && list_files && ! invert_match) {
+                out += filename + "\n";
+                return true;
             }
         }
     } while (in->seek_subimage (++subimage, 0, spec));
@@ -128,7 +191,7 @@ grep_file (const std::string &filename, boost::regex &re,
     if (invert_match) {
         found = !found;
         if (found)
-            std::cout << filename << "\n";
+            out += filename + "\n";
     }
     return found;
 }
@@ -166,6 +229,8 @@ main (int argc, const char *argv[])
                 "-r", &recursive, "Recurse into directories",
                 "-d", &print_dirs, "Print directories (when recursive)",
                 "-a", &all_subimages, "Search all subimages of each file",
+                "--attrib %s", &attrib_pattern, "Only search attributes whose names match this regex",
+                "--threads %d", &nthreads, "Number of files to search at once (default 0 == #cores)",
                 "--help", &help, "Print help message",
                 NULL);
     if (ap.parse(argc, argv) < 0 || pattern.empty() || filenames.empty()) {
@@ -184,8 +249,41 @@ main (int argc, const char *argv[])
     if (ignore_case)
         flag |= boost::regex_constants::icase;
     boost::regex re (pattern, flag);
-    for (auto&& s : filenames) {
-        grep_file (s, re);
+    if (! attrib_pattern.empty())
+        attrib_re.assign (attrib_pattern, flag);
+    if (nthreads)
+        OIIO::attribute ("threads", nthreads);
+
+    std::vector<Item> items;
+    for (auto&& s : filenames)
+        gather (s, false, items);
+
+    // Search the files in batches, several at once (each open file held
+    // by one thread, so no more are open than there are threads), and
+    // print each batch's results in order when it's done.  The compiled
+    // expressions are shared, read-only, by all the threads.
+    const size_t batchsize = 256;
+    std::vector<std::string> out (batchsize), err (batchsize);
+    for (size_t batch = 0;  batch < items.size();  batch += batchsize) {
+        size_t n = std::min (batchsize, items.size() - batch);
+        auto search = [&](int64_t i) {
+            out[i].clear ();
+            err[i].clear ();
+            grep_file (items[batch+i], re, out[i], err[i]);
+        };
+#if IGREP_PARALLEL
+        parallel_for (0, int64_t(n), search);
+#else
+        for (size_t i = 0;  i < n;  ++i)
+            search (i);
+#endif
+        for (size_t i = 0;  i < n;  ++i) {
+            fputs (out[i].c_str(), stdout);
+            if (err[i].size()) {
+                fflush (stdout);
+                std::cerr << err[i];
+            }
+        }
     }
 
     return 0;
@@ -47,6 +47,7 @@
 #include "OpenImageIO/deepdata.h"
 #include "OpenImageIO/hash.h"
 #include "OpenImageIO/filesystem.h"
+#include "OpenImageIO/parallel.h"
 
 OIIO_NAMESPACE_USING;
 
@@ -64,6 +65,24 @@ static bool subimages = false;
 static bool compute_sha1 = false;
 static bool compute_stats = false;
 
+// Each file's report (and any errors) is built up in a string rather than
+// printed right away, so that several files can be examined at once and
+// still be reported in order.
+#if OIIO_MSVS_BEFORE_2015
+static std::string *report = NULL, *report_errors = NULL;
+#define IINFO_PARALLEL 0
+#else
+static thread_local std::string *report = NULL, *report_errors = NULL;
+#define IINFO_PARALLEL 1
+#endif
+
+template<typename... Args>
+static void
+outf (const char *fmt, const Args&... args)
+{
+    *report += Strutil::format (fmt, args...);
+}
+
 
 
 static void
@@ -75,7 +94,7 @@ print_sha1 (ImageInput *input)
         // Special handling of deep data
         DeepData dd;
         if (! input->read_native_deep_image (dd)) {
-            printf ("    SHA-1: unable to compute, could not read image\n");
+            outf ("    SHA-1: unable to compute, could not read image\n");
             return;
         }
         // Hash both the sample counds and the data block
@@ -84,18 +103,18 @@ print_sha1 (ImageInput *input)
     } else {
         imagesize_t size = input->spec().image_bytes (true /*native*/);
         if (size >= std::numeric_limits<size_t>::max()) {
-            printf ("    SHA-1: unable to compute, image is too big\n");
+            outf ("    SHA-1: unable to compute, image is too big\n");
             return;
         }
         std::unique_ptr<char[]> buf (new char [size]);
         if (! input->read_image (TypeDesc::UNKNOWN /*native*/, &buf[0])) {
-            printf ("    SHA-1: unable to compute, could not read image\n");
+            outf ("    SHA-1: unable to compute, could not read image\n");
             return;
         }
         sha.append (&buf[0], size);
     }
 
-    printf ("    SHA-1: %s\n", sha.digest().c_str());
+    outf ("    SHA-1: %s\n", sha.digest().c_str());
 }
 
 
@@ -114,8 +133,8 @@ read_input (const std::string &filename, ImageBuf &img,
         img.read (subimage, miplevel, false, TypeDesc::FLOAT))
         return true;
 
-    std::cerr << "iinfo ERROR: Could not read " << filename << ":\n\t"
-              << img.geterror() << "\n";
+    *report_errors += Strutil::format ("iinfo ERROR: Could not read %s:\n\t%s\n",
+                                       filename, img.geterror());
     return false;
 }
 
@@ -125,14 +144,14 @@ static void
 print_stats_num (float val, int maxval, bool round)
 {
     if (maxval == 0) {
-        printf("%f",val);
+        outf ("%f",val);
     } else {
         float fval = val * static_cast<float>(maxval);
         if (round) {
             int v = static_cast<int>(roundf (fval));
-            printf ("%d", v);
+            outf ("%d", v);
         } else {
-            printf ("%0.2f", fval);
+            outf ("%0.2f", fval);
         }
     }
 }
@@ -173,9 +192,9 @@ static void
 print_stats_footer (unsigned int maxval)
 {
     if (maxval==0)
-        printf ("(float)");
+        outf ("(float)");
     else
-        printf ("(of %u)", maxval);
+        outf ("(of %u)", maxval);
 }
 
 
@@ -189,14 +208,15 @@ print_stats (const std::string &filename,
 
     ImageBuf input;
     if (! read_input (filename, input, subimage, miplevel)) {
-        std::cerr << "Stats: read error: " << input.geterror() << "\n";
+        *report_errors += Strutil::format ("Stats: read error: %s\n",
+                                           input.geterror());
         return;
     }
     
     if (! computePixelStats (stats, input)) {
-        printf ("%sStats: (unable to compute)\n", indent);
+        outf ("%sStats: (unable to compute)\n", indent);
         if (input.has_error())
-            std::cerr << "Error: " << input.geterror() << "\n";
+            *report_errors += Strutil::format ("Error: %s\n", input.geterror());
         return;
     }
     
@@ -204,55 +224,55 @@ print_stats (const std::string &filename,
     // be reported incorrectly (as FLOAT)
     unsigned int maxval = (unsigned int)get_intsample_maxval (originalspec);
     
-    printf ("%sStats Min: ", indent);
+    outf ("%sStats Min: ", indent);
     for (unsigned int i=0; i<stats.min.size(); ++i) {
         print_stats_num (stats.min[i], maxval, true);
-        printf (" ");
+        outf (" ");
     }
     print_stats_footer (maxval);
-    printf ("\n");
+    outf ("\n");
     
-    printf ("%sStats Max: ", indent);
+    outf ("%sStats Max: ", indent);
     for (unsigned int i=0; i<stats.max.size(); ++i) {
         print_stats_num (stats.max[i], maxval, true);
-        printf (" ");
+        outf (" ");
     }
     print_stats_footer (maxval);
-    printf ("\n");
+    outf ("\n");
     
-    printf ("%sStats Avg: ", indent);
+    outf ("%sStats Avg: ", indent);
     for (unsigned int i=0; i<stats.avg.size(); ++i) {
         print_stats_num (stats.avg[i], maxval, false);
-        printf (" ");
+        outf (" ");
     }
     print_stats_footer (maxval);
-    printf ("\n");
+    outf ("\n");
     
-    printf ("%sStats StdDev: ", indent);
+    outf ("%sStats StdDev: ", indent);
     for (unsigned int i=0; i<stats.stddev.size(); ++i) {
         print_stats_num (stats.stddev[i], maxval, false);
-        printf (" ");
+        outf (" ");
     }
     print_stats_footer (maxval);
-    printf ("\n");
+    outf ("\n");
     
-    printf ("%sStats NanCount: ", indent);
+    outf ("%sStats NanCount: ", indent);
     for (unsigned int i=0; i<stats.nancount.size(); ++i) {
-        printf ("%llu ", (unsigned long long)stats.nancount[i]);
+        outf ("%llu ", (unsigned long long)stats.nancount[i]);
     }
-    printf ("\n");
+    outf ("\n");
     
-    printf ("%sStats InfCount: ", indent);
+    outf ("%sStats InfCount: ", indent);
     for (unsigned int i=0; i<stats.infcount.size(); ++i) {
-        printf ("%llu ", (unsigned long long)stats.infcount[i]);
+        outf ("%llu ", (unsigned long long)stats.infcount[i]);
     }
-    printf ("\n");
+    outf ("\n");
     
-    printf ("%sStats FiniteCount: ", indent);
+    outf ("%sStats FiniteCount: ", indent);
     for (unsigned int i=0; i<stats.finitecount.size(); ++i) {
-        printf ("%llu ", (unsigned long long)stats.finitecount[i]);
+        outf ("%llu ", (unsigned long long)stats.finitecount[i]);
     }
-    printf ("\n");
+    outf ("\n");
 
     if (input.deep()) {
         const DeepData *dd (input.deepdata());
@@ -269,32 +289,32 @@ print_stats (const std::string &filename,
             if (c == 0)
                 ++emptypixels;
         }
-        printf ("%sMin deep samples in any pixel : %llu\n", indent, (unsigned long long)minsamples);
-        printf ("%sMax deep samples in any pixel : %llu\n", indent, (unsigned long long)maxsamples);
-        printf ("%sAverage deep samples per pixel: %.2f\n", indent, double(totalsamples)/double(npixels));
-        printf ("%sTotal deep samples in all pixels: %llu\n", indent, (unsigned long long)totalsamples);
-        printf ("%sPixels with deep samples   : %llu\n", indent, (unsigned long long)(npixels-emptypixels));
-        printf ("%sPixels with no deep samples: %llu\n", indent, (unsigned long long)emptypixels);
+        outf ("%sMin deep samples in any pixel : %llu\n", indent, (unsigned long long)minsamples);
+        outf ("%sMax deep samples in any pixel : %llu\n", indent, (unsigned long long)maxsamples);
+        outf ("%sAverage deep samples per pixel: %.2f\n", indent, double(totalsamples)/double(npixels));
+        outf ("%sTotal deep samples in all pixels: %llu\n", indent, (unsigned long long)totalsamples);
+        outf ("%sPixels with deep samples   : %llu\n", indent, (unsigned long long)(npixels-emptypixels));
+        outf ("%sPixels with no deep samples: %llu\n", indent, (unsigned long long)emptypixels);
     } else {
         std::vector<float> constantValues(input.spec().nchannels);
         if (isConstantColor(input, &constantValues[0])) {
-            printf ("%sConstant: Yes\n", indent);
-            printf ("%sConstant Color: ", indent);
+            outf ("%sConstant: Yes\n", indent);
+            outf ("%sConstant Color: ", indent);
             for (unsigned int i=0; i<constantValues.size(); ++i) {
                 print_stats_num (constantValues[i], maxval, false);
-                printf (" ");
+                outf (" ");
             }
             print_stats_footer (maxval);
-            printf ("\n");
+            outf ("\n");
         }
         else {
-            printf ("%sConstant: No\n", indent);
+            outf ("%sConstant: No\n", indent);
         }
     
         if (isMonochrome(input)) {
-            printf ("%sMonochrome: Yes\n", indent);
+            outf ("%sMonochrome: Yes\n", indent);
         } else {
-            printf ("%sMonochrome: No\n", indent);
+            outf ("%sMonochrome: No\n", indent);
         }
     }
 }
@@ -309,30 +329,30 @@ print_metadata (const ImageSpec &spec, const std::string &filename)
           boost::regex_search ("channels", field_re) ||
           boost::regex_search ("channel list", field_re)) {
         if (filenameprefix)
-            printf ("%s : ", filename.c_str());
-        printf ("    channel list: ");
+            outf ("%s : ", filename.c_str());
+        outf ("    channel list: ");
         for (int i = 0;  i < spec.nchannels;  ++i) {
             if (i < (int)spec.channelnames.size())
-                printf ("%s", spec.channelnames[i].c_str());
+                outf ("%s", spec.channelnames[i].c_str());
             else
-                printf ("unknown");
+                outf ("unknown");
             if (i < (int)spec.channelformats.size())
-                printf (" (%s)", spec.channelformats[i].c_str());
+                outf (" (%s)", spec.channelformats[i].c_str());
             if (i < spec.nchannels-1)
-                printf (", ");
+                outf (", ");
         }
-        printf ("\n");
+        outf ("\n");
         printed = true;
     }
     if (spec.x || spec.y || spec.z) {
         if (metamatch.empty() ||
             boost::regex_search ("pixel data origin", field_re)) {
             if (filenameprefix)
-                printf ("%s : ", filename.c_str());
-            printf ("    pixel data origin: x=%d, y=%d", spec.x, spec.y);
+                outf ("%s : ", filename.c_str());
+            outf ("    pixel data origin: x=%d, y=%d", spec.x, spec.y);
             if (spec.depth > 1)
-                printf (", z=%d", spec.z);
-            printf ("\n");
+                outf (", z=%d", spec.z);
+            outf ("\n");
             printed = true;
         }
     }
@@ -343,23 +363,23 @@ print_metadata (const ImageSpec &spec, const std::string &filename)
         if (metamatch.empty() ||
               boost::regex_search ("full/display size", field_re)) {
             if (filenameprefix)
-                printf ("%s : ", filename.c_str());
-            printf ("    full/display size: %d x %d",
+                outf ("%s : ", filename.c_str());
+            outf ("    full/display size: %d x %d",
                     spec.full_width, spec.full_height);
             if (spec.depth > 1)
-                printf (" x %d", spec.full_depth);
-            printf ("\n");
+                outf (" x %d", spec.full_depth);
+            outf ("\n");
             printed = true;
         }
         if (metamatch.empty() ||
             boost::regex_search ("full/display origin", field_re)) {
             if (filenameprefix)
-                printf ("%s : ", filename.c_str());
-            printf ("    full/display origin: %d, %d",
+                outf ("%s : ", filename.c_str());
+            outf ("    full/display origin: %d, %d",
                     spec.full_x, spec.full_y);
             if (spec.depth > 1)
-                printf (", %d", spec.full_z);
-            printf ("\n");
+                outf (", %d", spec.full_z);
+            outf ("\n");
             printed = true;
         }
     }
@@ -367,12 +387,12 @@ print_metadata (const ImageSpec &spec, const std::string &filename)
         if (metamatch.empty() ||
             boost::regex_search ("tile", field_re)) {
             if (filenameprefix)
-                printf ("%s : ", filename.c_str());
-            printf ("    tile size: %d x %d",
+                outf ("%s : ", filename.c_str());
+            outf ("    tile size: %d x %d",
                     spec.tile_width, spec.tile_height);
             if (spec.depth > 1)
-                printf (" x %d", spec.tile_depth);
-            printf ("\n");
+                outf (" x %d", spec.tile_depth);
+            outf ("\n");
             printed = true;
         }
     }
@@ -383,20 +403,20 @@ print_metadata (const ImageSpec &spec, const std::string &filename)
             continue;
         std::string s = spec.metadata_val (p, true);
         if (filenameprefix)
-            printf ("%s : ", filename.c_str());
-        printf ("    %s: ", p.name().c_str());
+            outf ("%s : ", filename.c_str());
+        outf ("    %s: ", p.name().c_str());
         if (! strcmp (s.c_str(), "1.#INF"))
-            printf ("inf");
+            outf ("inf");
         else
-            printf ("%s", s.c_str());
-        printf ("\n");
+            outf ("%s", s.c_str());
+        outf ("\n");
         printed = true;
     }
 
     if (! printed && !metamatch.empty()) {
         if (filenameprefix)
-            printf ("%s : ", filename.c_str());
-        printf ("    %s: <unknown>\n", metamatch.c_str());
+            outf ("%s : ", filename.c_str());
+        outf ("    %s: <unknown>\n", metamatch.c_str());
     }
 }
 
@@ -461,35 +481,35 @@ print_info_subimage (int current_subimage, int max_subimages, ImageSpec &spec,
     bool printres = verbose && (metamatch.empty() ||
                                 boost::regex_search ("resolution, width, height, depth, channels", field_re));
     if (printres && max_subimages > 1 && subimages) {
-        printf (" subimage %2d: ", current_subimage);
-        printf ("%4d x %4d", spec.width, spec.height);
+        outf (" subimage %2d: ", current_subimage);
+        outf ("%4d x %4d", spec.width, spec.height);
         if (spec.depth > 1)
-            printf (" x %4d", spec.depth);
+            outf (" x %4d", spec.depth);
         int bits = spec.get_int_attribute ("oiio:BitsPerSample", 0);
-        printf (", %d channel, %s%s%s", spec.nchannels,
+        outf (", %d channel, %s%s%s", spec.nchannels,
                 spec.deep ? "deep " : "",
                 spec.depth > 1 ? "volume " : "",
                 extended_format_name(spec.format, bits));
-        printf (" %s", input->format_name());
-        printf ("\n");
+        outf (" %s", input->format_name());
+        outf ("\n");
     }
     // Count MIP levels
     ImageSpec mipspec;
     while (input->seek_subimage (current_subimage, nmip, mipspec)) {
         if (printres) {
             if (nmip == 1)
-                printf ("    MIP-map levels: %dx%d", spec.width, spec.height);
-            printf (" %dx%d", mipspec.width, mipspec.height);
+                outf ("    MIP-map levels: %dx%d", spec.width, spec.height);
+            outf (" %dx%d", mipspec.width, mipspec.height);
         }
         ++nmip;
     }
     if (printres && nmip > 1)
-        printf ("\n");
+        outf ("\n");
 
     if (compute_sha1 && (metamatch.empty() ||
                          boost::regex_search ("sha-1", field_re))) {
         if (filenameprefix)
-            printf ("%s : ", filename.c_str());
+            outf ("%s : ", filename.c_str());
         // Before sha-1, be sure to point back to the highest-res MIP level
         ImageSpec tmpspec;
         input->seek_subimage (current_subimage, 0, tmpspec);
@@ -505,9 +525,9 @@ print_info_subimage (int current_subimage, int max_subimages, ImageSpec &spec,
             ImageSpec mipspec;
             input->seek_subimage (current_subimage, m, mipspec);
             if (filenameprefix)
-                printf ("%s : ", filename.c_str());
+                outf ("%s : ", filename.c_str());
             if (nmip > 1 && (subimages || m == 0)) {
-                printf ("    MIP %d of %d (%d x %d):\n",
+                outf ("    MIP %d of %d (%d x %d):\n",
                         m, nmip, mipspec.width, mipspec.height);
             }
             print_stats (filename, spec, current_subimage, m, nmip>1);
@@ -554,60 +574,60 @@ print_info (const std::string &filename, size_t namefieldlength,
 
     if (metamatch.empty() ||
         boost::regex_search ("resolution, width, height, depth, channels", field_re)) {
-        printf ("%s%s : %4d x %4d", filename.c_str(), padding.c_str(),
+        outf ("%s%s : %4d x %4d", filename.c_str(), padding.c_str(),
                 spec.width, spec.height);
         if (spec.depth > 1)
-            printf (" x %4d", spec.depth);
-        printf (", %d channel, %s%s", spec.nchannels,
+            outf (" x %4d", spec.depth);
+        outf (", %d channel, %s%s", spec.nchannels,
                 spec.deep ? "deep " : "",
                 spec.depth > 1 ? "volume " : "");
         if (spec.channelformats.size()) {
             for (size_t c = 0;  c < spec.channelformats.size();  ++c)
-                printf ("%s%s", c ? "/" : "",
+                outf ("%s%s", c ? "/" : "",
                         spec.channelformats[c].c_str());
         } else {
             int bits = spec.get_int_attribute ("oiio:BitsPerSample", 0);
-            printf ("%s", extended_format_name(spec.format, bits));
+            outf ("%s", extended_format_name(spec.format, bits));
         }
-        printf (" %s", input->format_name());
+        outf (" %s", input->format_name());
         if (sum) {
             imagesize_t imagebytes = spec.image_bytes (true);
             totalsize += imagebytes;
-            printf (" (%.2f MB)", (float)imagebytes / (1024.0*1024.0));
+            outf (" (%.2f MB)", (float)imagebytes / (1024.0*1024.0));
         }
         // we print info about how many subimages are stored in file
         // only when we have more then one subimage
         if ( ! verbose && num_of_subimages != 1)
-            printf (" (%d subimages%s)", num_of_subimages,
+            outf (" (%d subimages%s)", num_of_subimages,
                     any_mipmapping ? " +mipmap)" : "");
         if (! verbose && num_of_subimages == 1 && any_mipmapping)
-            printf (" (+mipmap)");
-        printf ("\n");
+            outf (" (+mipmap)");
+        outf ("\n");
     }
 
     int movie = spec.get_int_attribute ("oiio:Movie");
     if (verbose && num_of_subimages != 1) {
         // info about num of subimages and their resolutions
-        printf ("    %d subimages: ", num_of_subimages);
+        outf ("    %d subimages: ", num_of_subimages);
         for (int i = 0; i < num_of_subimages; ++i) {
             input->seek_subimage (i, 0, spec);
             int bits = spec.get_int_attribute ("oiio:BitsPerSample",
                                                spec.format.size()*8);
             if (i)
-                printf (", ");
+                outf (", ");
             if (spec.depth > 1)
-                printf ("%dx%dx%d ", spec.width, spec.height, spec.depth);
+                outf ("%dx%dx%d ", spec.width, spec.height, spec.depth);
             else
-                printf ("%dx%d ", spec.width, spec.height);
-            // printf ("[");
+                outf ("%dx%d ", spec.width, spec.height);
+            // outf ("[");
             for (int c = 0; c < spec.nchannels; ++c)
-                printf ("%c%s", c ? ',' : '[',
+                outf ("%c%s", c ? ',' : '[',
                         brief_format_name(spec.channelformat(c), bits));
-            printf ("]");
+            outf ("]");
             if (movie)
                 break;
         }
-        printf ("\n");
+        outf ("\n");
     }
 
     // if the '-a' flag is not set we print info
@@ -669,20 +689,52 @@ main (int argc, const char *argv[])
         longestname = std::max (longestname, s.length());
     longestname = std::min (longestname, (size_t)40);
 
+    // Examine the files in batches, several at once, printing each
+    // batch's reports in order when it's done.
     long long totalsize = 0;
-    for (auto&& s : filenames) {
-        ImageInput *in = ImageInput::open (s.c_str());
-        if (! in) {
-            std::string err = geterror();
-            if (err.empty())
-                err = Strutil::format ("Could not open \"%s\"", s.c_str());
-            std::cerr << "iinfo: " << err << "\n";
-            continue;
+    const size_t batchsize = 256;
+    std::vector<std::string> reports (batchsize), errors (batchsize);
+    std::vector<long long> sizes (batchsize);
+    for (size_t batch = 0; batch < filenames.size(); batch += batchsize) {
+        size_t n = std::min (batchsize, filenames.size() - batch);
+        auto examine = [&](int64_t i) {
+            const std::string &s (filenames[batch+i]);
+            report = &reports[i];
+            report_errors = &errors[i];
+            reports[i].clear ();
+            errors[i].clear ();
+            sizes[i] = 0;
+            // Unless we need the pixels for the hash, only ask for the header
+            ImageSpec config;
+            if (! compute_sha1)
+                config.attribute ("oiio:headeronly", 1);
+            ImageInput *in = ImageInput::open (s.c_str(), &config);
+            if (! in) {
+                std::string err = geterror();
+                if (err.empty())
+                    err = Strutil::format ("Could not open \"%s\"", s.c_str());
+                errors[i] += Strutil::format ("iinfo: %s\n", err);
+                return;
+            }
+            ImageSpec spec = in->spec();
+            print_info (s, longestname, in, spec, verbose, sum, sizes[i]);
+            in->close ();
+            delete in;
+        };
+#if IINFO_PARALLEL
+        parallel_for (0, int64_t(n), examine);
+#else
+        for (size_t i = 0; i < n; ++i)
+            examine (i);
+#endif
+        for (size_t i = 0; i < n; ++i) {
+            fputs (reports[i].c_str(), stdout);
+            if (errors[i].size()) {
+                fflush (stdout);
+                std::cerr << errors[i];
+            }
+            totalsize += sizes[i];
         }
-        ImageSpec spec = in->spec();
-        print_info (s, longestname, in, spec, verbose, sum, totalsize);
-        in->close ();
-        delete in;
     }
 
     if (sum) {
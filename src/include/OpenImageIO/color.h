@@ -284,6 +284,13 @@ inline float Rec709_to_linear (float x)
         return powf ((x + 0.099f) * (1.0f/1.099f), (1.0f/0.45f));
 }
 
+inline simd::float4 Rec709_to_linear (simd::float4 x)
+{
+    return simd::select (x < 0.081f, x * (1.0f/4.5f),
+                         fast_pow_pos (madd (x, (1.0f/1.099f), 0.099f*(1.0f/1.099f)),
+                                       (1.0f/0.45f)));
+}
+
 /// Utility -- convert linear value to Rec709
 inline float linear_to_Rec709 (float x)
 {
@@ -293,6 +300,12 @@ inline float linear_to_Rec709 (float x)
         return 1.099f * powf(x, 0.45f) - 0.099f;
 }
 
+inline simd::float4 linear_to_Rec709 (simd::float4 x)
+{
+    return simd::select (x < 0.018f, x * 4.5f,
+                         madd (1.099f, fast_pow_pos (x, 0.45f), -0.099f));
+}
+
 
 OIIO_NAMESPACE_END
 
@@ -90,6 +90,12 @@ public:
     /// The size for all channels of one sample.
     size_t samplesize () const;
 
+    /// The index of the channel named Z, Zback, or A (or ending in ".Z",
+    /// etc.), or -1 if there is no such channel.
+    int Z_channel () const;
+    int Zback_channel () const;
+    int A_channel () const;
+
     /// Retrieve the number of samples for the given pixel index.
     int samples (int pixel) const;
 
@@ -46,6 +46,8 @@
 #include <cstdio>
 #include <ctime>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -323,6 +325,192 @@ OIIO_API bool scan_for_matching_filenames (const std::string &pattern,
                                            std::vector<int> &numbers,
                                            std::vector<std::string> &filenames);
 
+
+
+/// Proxy class for I/O.  Plugins that support it (see the "ioproxy"
+/// feature of ImageInput/ImageOutput::supports) do all their reading and
+/// writing through an IOProxy passed to open() as the "oiio:ioproxy"
+/// pointer attribute, rather than opening the named file themselves.
+/// That makes it possible to read images from memory, object stores, or
+/// custom async I/O without a temporary file.  Subclasses override the
+/// virtual methods; the caller owns the proxy and must keep it alive
+/// until the ImageInput or ImageOutput is closed.
+class OIIO_API IOProxy {
+public:
+    enum Mode { Closed = 0, Read = 'r', Write = 'w' };
+    IOProxy () {}
+    IOProxy (string_view filename, Mode mode)
+        : m_filename(filename), m_mode(mode) {}
+    virtual ~IOProxy () { }
+    virtual const char* proxytype () const = 0;
+    virtual void close () { m_mode = Closed; }
+    virtual bool opened () const { return mode() != Closed; }
+    virtual int64_t tell () { return m_pos; }
+    /// Seek to the absolute position offset, returning true on success.
+    virtual bool seek (int64_t offset) { m_pos = offset; return true; }
+    /// Read up to size bytes at the current position, advancing it.
+    /// Return the number of bytes read.
+    virtual size_t read (void *buf, size_t size) { return 0; }
+    /// Write size bytes at the current position, advancing it.  Return
+    /// the number of bytes written.
+    virtual size_t write (const void *buf, size_t size) { return 0; }
+    /// Read up to size bytes from the absolute position offset, without
+    /// using or moving the current position.  This is safe to call from
+    /// several threads at once, so plugins may use it for parallel reads.
+    virtual size_t pread (void *buf, size_t size, int64_t offset) { return 0; }
+    /// Write size bytes to the absolute position offset, without using
+    /// or moving the current position.
+    virtual size_t pwrite (const void *buf, size_t size, int64_t offset) { return 0; }
+    /// Total size of the underlying file or buffer, in bytes.
+    virtual size_t size () const { return 0; }
+    virtual void flush () { }
+
+    Mode mode () const { return m_mode; }
+    const std::string& filename () const { return m_filename; }
+    /// Seek relative to origin (SEEK_SET, SEEK_CUR, or SEEK_END).
+    bool seek (int64_t offset, int origin) {
+        return seek ((origin == SEEK_SET ? 0 :
+                      origin == SEEK_CUR ? tell() : int64_t(size()))
+                     + offset);
+    }
+
+protected:
+    std::string m_filename;
+    int64_t m_pos = 0;
+    Mode m_mode = Closed;
+};
+
+
+
+/// IOProxy subclass for reading or writing a FILE*.  pread is thread-safe
+/// (and, on POSIX systems, lock-free).
+class OIIO_API IOFile : public IOProxy {
+public:
+    /// Open the named file for reading or writing.
+    IOFile (string_view filename, Mode mode);
+    /// Use an already open FILE*, which the IOFile will not close.
+    IOFile (FILE *file, Mode mode);
+    virtual ~IOFile ();
+    virtual const char* proxytype () const { return "file"; }
+    virtual void close ();
+    virtual bool seek (int64_t offset);
+    virtual size_t read (void *buf, size_t size);
+    virtual size_t write (const void *buf, size_t size);
+    virtual size_t pread (void *buf, size_t size, int64_t offset);
+    virtual size_t pwrite (const void *buf, size_t size, int64_t offset);
+    virtual size_t size () const;
+    virtual void flush ();
+    FILE *handle () const { return m_file; }
+
+private:
+    FILE *m_file = NULL;
+    size_t m_size = 0;
+    bool m_auto_close = false;
+    std::mutex m_mutex;
+};
+
+
+
+/// IOProxy subclass for writing into (and reading back from) a
+/// std::vector<unsigned char>, which grows as needed.
+class OIIO_API IOVecOutput : public IOProxy {
+public:
+    /// Write into a vector owned by the IOVecOutput.
+    IOVecOutput () : IOProxy ("", Write), m_buf(m_local_buffer) {}
+    /// Write into a vector owned by the caller.
+    IOVecOutput (std::vector<unsigned char> &buf)
+        : IOProxy ("", Write), m_buf(buf) {}
+    virtual const char* proxytype () const { return "vecoutput"; }
+    virtual size_t read (void *buf, size_t size);
+    virtual size_t write (const void *buf, size_t size);
+    virtual size_t pread (void *buf, size_t size, int64_t offset);
+    virtual size_t pwrite (const void *buf, size_t size, int64_t offset);
+    virtual size_t size () const { return m_buf.size(); }
+    /// Access the buffer.
+    std::vector<unsigned char> & buffer () const { return m_buf; }
+
+private:
+    std::vector<unsigned char> &m_buf;
+    std::vector<unsigned char> m_local_buffer;
+    std::mutex m_mutex;
+};
+
+
+
+/// IOProxy subclass for reading from a memory buffer owned by the caller,
+/// which must stay valid for the life of the proxy.
+class OIIO_API IOMemReader : public IOProxy {
+public:
+    IOMemReader (const void *buf, size_t size)
+        : IOProxy ("", Read), m_buf((const unsigned char *)buf), m_size(size) {}
+    virtual const char* proxytype () const { return "memreader"; }
+    virtual size_t read (void *buf, size_t size);
+    virtual size_t pread (void *buf, size_t size, int64_t offset);
+    virtual size_t size () const { return m_size; }
+
+private:
+    const unsigned char *m_buf = NULL;
+    size_t m_size = 0;
+};
+
+
+
+/// Readahead for a frame-numbered image sequence.  While the caller works
+/// on frame N, the files for frames N+1..N+frames_ahead are fetched in the
+/// background by the default thread pool, so that opening them later
+/// doesn't wait on the disk or network.  The files of the frames being
+/// read ahead may total no more than memory_limit bytes (a frame bigger
+/// than that on its own is never read ahead).
+///
+/// Ordinarily this just asks the OS to bring the files into its cache
+/// (posix_fadvise where available, otherwise by reading them through),
+/// and the frames may then be opened by name as usual.  If buffer is
+/// true, the files are instead read into memory owned by the
+/// SequenceReadahead, and ioproxy(N) returns an IOProxy for frame N that
+/// may be passed to ImageInput::open as "oiio:ioproxy".
+///
+/// The methods are not thread-safe; drive a SequenceReadahead from one
+/// thread.
+class OIIO_API SequenceReadahead {
+public:
+    SequenceReadahead (const std::vector<std::string> &filenames,
+                       int frames_ahead = 2,
+                       size_t memory_limit = size_t(1) << 30,
+                       bool buffer = false);
+    /// Expand a normalized pattern (such as "foo.%04d.exr") and frame
+    /// range (such as "1-100") as enumerate_file_sequence does.
+    SequenceReadahead (const std::string &pattern, string_view framespec,
+                       int frames_ahead = 2,
+                       size_t memory_limit = size_t(1) << 30,
+                       bool buffer = false);
+    /// Waits for any reads still in flight.
+    ~SequenceReadahead ();
+
+    /// Number of frames in the sequence.
+    int nframes () const;
+    /// Filename of the given frame (by index into the sequence, not by
+    /// frame number).
+    const std::string& filename (int index) const;
+
+    /// Say that the caller is about to process the given frame: release
+    /// everything held for earlier frames and start fetching the next
+    /// frames_ahead frames that aren't already under way.
+    void advance (int index);
+
+    /// If buffer was true and the frame has been read ahead, wait for its
+    /// read to finish and return an IOProxy for it, which stays valid
+    /// until advance() moves past the frame.  Otherwise, return NULL, and
+    /// the caller should open the file by name.
+    IOProxy* ioproxy (int index);
+
+    /// Total bytes of the files currently being read ahead or held.
+    size_t bytes_ahead () const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
 };  // namespace Filesystem
 
 OIIO_NAMESPACE_END
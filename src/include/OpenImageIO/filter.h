@@ -33,6 +33,8 @@
 #ifndef OPENIMAGEIO_FILTER_H
 #define OPENIMAGEIO_FILTER_H
 
+#include <vector>
+
 #include "oiioversion.h"
 #include "export.h"
 #include "string_view.h"
@@ -67,6 +69,12 @@ public:
     /// Evalutate the filter at an x position (relative to filter center)
     virtual float operator() (float x) const = 0;
 
+    /// Evaluate the filter at the n positions x[0..n-1], storing the
+    /// results in result[0..n-1].  This is equivalent to calling
+    /// operator() for each x, but costs one virtual call for the batch.
+    /// It's fine for result and x to be the same array.
+    virtual void eval (float *result, const float *x, int n) const;
+
     /// Return the name of the filter, e.g., "box", "gaussian"
     virtual string_view name (void) const = 0;
 
@@ -112,6 +120,12 @@ public:
     /// center).
     virtual float operator() (float x, float y) const = 0;
 
+    /// Evaluate the filter at the n positions (x[i], y) along a row,
+    /// storing the results in result[0..n-1].  This is equivalent to
+    /// calling operator() for each, but costs one virtual call for the
+    /// batch.  It's fine for result and x to be the same array.
+    virtual void eval (float *result, const float *x, float y, int n) const;
+
     /// Evaluate just the horizontal filter (if separable; for non-separable
     /// it just evaluates at (x,0).
     virtual float xfilt (float x) const { return (*this)(x,0.0f); }
@@ -120,6 +134,12 @@ public:
     /// it just evaluates at (0,y).
     virtual float yfilt (float y) const { return (*this)(0.0f,y); }
 
+    /// Batched versions of xfilt and yfilt: evaluate at n positions,
+    /// storing the results in result[0..n-1] (which may be the same
+    /// array as the positions).
+    virtual void xfilt (float *result, const float *x, int n) const;
+    virtual void yfilt (float *result, const float *y, int n) const;
+
     /// Return the name of the filter, e.g., "box", "gaussian"
     virtual string_view name (void) const = 0;
 
@@ -145,6 +165,43 @@ protected:
 };
 
 
+
+/// FilterTable holds a finely sampled table of a Filter1D, or of one
+/// axis of a separable Filter2D, and evaluates it by linear
+/// interpolation, which avoids both the virtual call and whatever
+/// transcendental functions the filter itself uses.  At the default
+/// 256 samples per unit the error is under 1e-4 of the filter's peak,
+/// except that filters that jump to zero at their edges (box, gaussian)
+/// are smeared across the last sample there.
+class OIIO_API FilterTable {
+public:
+    FilterTable (const Filter1D *filter, int samples_per_unit = 256);
+    FilterTable (const Filter2D *filter, bool yaxis,
+                 int samples_per_unit = 256);
+
+    /// Radius of the support; the table is zero outside [-radius,radius].
+    float radius () const { return m_radius; }
+
+    /// Evaluate at an x position relative to the filter center.
+    float operator() (float x) const {
+        float f = (x + m_radius) * m_scale;
+        if (! (f >= 0.0f && f <= m_last))   // also rejects NaN
+            return 0.0f;
+        int i = int (f);
+        f -= float (i);
+        return m_table[i] + f * (m_table[i+1] - m_table[i]);
+    }
+
+    /// Evaluate at n positions, storing the results in result[0..n-1].
+    void eval (float *result, const float *x, int n) const;
+
+private:
+    std::vector<float> m_table;
+    float m_radius, m_scale, m_last;
+    std::vector<float> init (float width, int samples_per_unit);
+};
+
+
 OIIO_NAMESPACE_END
 
 #endif // OPENIMAGEIO_FILTER_H
@@ -236,6 +236,12 @@ clamp (simd::float8 a, simd::float8 low, simd::float8 high)
     return simd::min (high, simd::max (low, a));
 }
 
+template<> inline simd::float16
+clamp (simd::float16 a, simd::float16 low, simd::float16 high)
+{
+    return simd::min (high, simd::max (low, a));
+}
+
 
 
 /// Fused multiply and add: (a*b + c)
@@ -537,17 +543,34 @@ template<class T>
 inline void
 swap_endian (T *f, int len=1)
 {
-    for (char *c = (char *) f;  len--;  c += sizeof(T)) {
-        if (sizeof(T) == 2) {
-            std::swap (c[0], c[1]);
-        } else if (sizeof(T) == 4) {
-            std::swap (c[0], c[3]);
-            std::swap (c[1], c[2]);
-        } else if (sizeof(T) == 8) {
-            std::swap (c[0], c[7]);
-            std::swap (c[1], c[6]);
-            std::swap (c[2], c[5]);
-            std::swap (c[3], c[4]);
+    // Work on whole words with shifts and masks rather than swapping
+    // bytes one pair at a time: compilers recognize these as bswap and
+    // vectorize the loops, which matters for the big buffers that file
+    // readers push through here.
+    char *c = (char *) f;
+    if (sizeof(T) == 2) {
+        for (int i = 0;  i < len;  ++i, c += 2) {
+            uint16_t v;
+            memcpy (&v, c, 2);
+            v = uint16_t((v >> 8) | (v << 8));
+            memcpy (c, &v, 2);
+        }
+    } else if (sizeof(T) == 4) {
+        for (int i = 0;  i < len;  ++i, c += 4) {
+            uint32_t v;
+            memcpy (&v, c, 4);
+            v = (v >> 24) | ((v >> 8) & 0x0000ff00u) |
+                ((v << 8) & 0x00ff0000u) | (v << 24);
+            memcpy (c, &v, 4);
+        }
+    } else if (sizeof(T) == 8) {
+        for (int i = 0;  i < len;  ++i, c += 8) {
+            uint64_t v;
+            memcpy (&v, c, 8);
+            v = ((v >> 8) & 0x00ff00ff00ff00ffULL) | ((v & 0x00ff00ff00ff00ffULL) << 8);
+            v = ((v >> 16) & 0x0000ffff0000ffffULL) | ((v & 0x0000ffff0000ffffULL) << 16);
+            v = (v >> 32) | (v << 32);
+            memcpy (c, &v, 8);
         }
     }
 }
@@ -596,7 +619,7 @@ void convert_type (const S *src, D *dst, size_t n, D _min, D _max)
 {
     if (is_same<S,D>::value) {
         // They must be the same type.  Just memcpy.
-        memcpy (dst, src, n*sizeof(D));
+        memcpy ((void *)dst, (const void *)src, n*sizeof(D));
         return;
     }
     typedef typename big_enough_float<D>::float_t F;
@@ -663,6 +686,14 @@ inline void convert_type<uint8_t,float> (const uint8_t *src,
                                          float _min, float _max)
 {
     float scale (1.0f/std::numeric_limits<uint8_t>::max());
+#if OIIO_SIMD_AVX
+    simd::float8 scale_simd8 (scale);
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        simd::float8 s_simd (src);
+        simd::float8 d_simd = s_simd * scale_simd8;
+        d_simd.store (dst);
+    }
+#endif
     simd::float4 scale_simd (scale);
     for ( ; n >= 4; n -= 4, src += 4, dst += 4) {
         simd::float4 s_simd (src);
@@ -681,6 +712,14 @@ inline void convert_type<uint16_t,float> (const uint16_t *src,
                                           float _min, float _max)
 {
     float scale (1.0f/std::numeric_limits<uint16_t>::max());
+#if OIIO_SIMD_AVX
+    simd::float8 scale_simd8 (scale);
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        simd::float8 s_simd (src);
+        simd::float8 d_simd = s_simd * scale_simd8;
+        d_simd.store (dst);
+    }
+#endif
     simd::float4 scale_simd (scale);
     for ( ; n >= 4; n -= 4, src += 4, dst += 4) {
         simd::float4 s_simd (src);
@@ -698,6 +737,19 @@ inline void convert_type<half,float> (const half *src,
                                       float *dst, size_t n,
                                       float _min, float _max)
 {
+#if OIIO_SIMD_AVX >= 512
+    for ( ; n >= 16; n -= 16, src += 16, dst += 16) {
+        simd::float16 s_simd (src);
+        s_simd.store (dst);
+    }
+#endif
+#if OIIO_SIMD_AVX
+    // F16C, when available, does 8 at a time
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        simd::float8 s_simd (src);
+        s_simd.store (dst);
+    }
+#endif
     for ( ; n >= 4; n -= 4, src += 4, dst += 4) {
         simd::float4 s_simd (src);
         s_simd.store (dst);
@@ -717,6 +769,16 @@ convert_type<float,uint16_t> (const float *src, uint16_t *dst, size_t n,
     float min = std::numeric_limits<uint16_t>::min();
     float max = std::numeric_limits<uint16_t>::max();
     float scale = max;
+#if OIIO_SIMD_AVX
+    simd::float8 max_simd8 (max);
+    simd::float8 zero_simd8 (0.0f);
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        simd::float8 scaled = simd::round (simd::float8(src) * max_simd8);
+        simd::float8 clamped = simd::min (simd::max (scaled, zero_simd8), max_simd8);
+        simd::int8 i (clamped);
+        i.store (dst);
+    }
+#endif
     simd::float4 max_simd (max);
     simd::float4 one_half_simd (0.5f);
     simd::float4 zero_simd (0.0f);
@@ -739,6 +801,16 @@ convert_type<float,uint8_t> (const float *src, uint8_t *dst, size_t n,
     float min = std::numeric_limits<uint8_t>::min();
     float max = std::numeric_limits<uint8_t>::max();
     float scale = max;
+#if OIIO_SIMD_AVX
+    simd::float8 max_simd8 (max);
+    simd::float8 zero_simd8 (0.0f);
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        simd::float8 scaled = simd::round (simd::float8(src) * max_simd8);
+        simd::float8 clamped = simd::min (simd::max (scaled, zero_simd8), max_simd8);
+        simd::int8 i (clamped);
+        i.store (dst);
+    }
+#endif
     simd::float4 max_simd (max);
     simd::float4 one_half_simd (0.5f);
     simd::float4 zero_simd (0.0f);
@@ -759,6 +831,20 @@ inline void
 convert_type<float,half> (const float *src, half *dst, size_t n,
                           half _min, half _max)
 {
+    // Without F16C, the float4 store uses an SSE2 bit-twiddling
+    // conversion rather than Imath's per-value rounding.
+#if OIIO_SIMD_AVX >= 512
+    for ( ; n >= 16; n -= 16, src += 16, dst += 16) {
+        simd::float16 s (src);
+        s.store (dst);
+    }
+#endif
+#if OIIO_SIMD_AVX
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        simd::float8 s (src);
+        s.store (dst);
+    }
+#endif
     for ( ; n >= 4; n -= 4, src += 4, dst += 4) {
         simd::float4 s (src);
         s.store (dst);
@@ -1325,6 +1411,40 @@ inline float fast_atan2 (float y, float x) {
     return copysignf(r, y);
 }
 
+
+// SIMD versions of fast_acos and fast_atan2 (float4, float8, float16).
+// They evaluate the same approximations as the float versions above,
+// without branches, and have the same error bounds: under 4.52e-05 for
+// fast_acos and under 6.56e-06 radians for fast_atan2.  (The int_t
+// parameter keeps scalar arguments, such as doubles, going to the float
+// versions.)
+template<typename T, typename = typename T::int_t>
+inline T fast_acos (const T& x) {
+    using namespace simd;
+    const T one (1.0f);
+    T f = abs (x);
+    T m = select (f < one, one - (one - f), one); // clamp and crush denormals
+    T a = sqrt (one - m) * madd (m, madd (m, madd (m, T(-0.02164095f), T(0.077980478f)),
+                                          T(-0.213300989f)), T(1.5707963267f));
+    return select (x < T(0.0f), T(float(M_PI)) - a, a);
+}
+
+template<typename T, typename = typename T::int_t>
+inline T fast_atan2 (const T& y, const T& x) {
+    using namespace simd;
+    const T zero (0.0f), one (1.0f);
+    T a = abs (x);
+    T b = abs (y);
+    T k = select (b == zero, zero, select (a == b, one, min (a, b) / max (a, b)));
+    T s = one - (one - k); // crush denormals
+    T t = s * s;
+    T r = s * madd (T(0.43157974f), t, one) / madd (madd (T(0.05831938f), t, T(0.76443945f)), t, one);
+    r = select (b > a, T(1.570796326794896557998982f) - r, r); // account for arg reduction
+    r = select (bitcast_to_int(x) < T::int_t::Zero(), T(float(M_PI)) - r, r); // sign bit of x
+    // r is non-negative, so copysign is just OR-ing in y's sign bit
+    return bitcast_to_float (bitcast_to_int(r) | (bitcast_to_int(y) & bitcast_to_int(T(-0.0f))));
+}
+
 template<typename T>
 inline T fast_log2 (const T& xval) {
     using namespace simd;
@@ -1561,6 +1681,35 @@ inline float fast_safe_pow (float x, float y) {
 }
 
 
+// SIMD fast_safe_pow, with the same special cases as the float version:
+// x^0 = 1, 0^y = 0, exact results for y = 1 and 2, and 0 (rather than
+// NaN) for negative x raised to a non-integer power.  Other results have
+// the combined error of fast_log2 and fast_exp2 (relative error around
+// 2e-5 * |y * log2(x)|, plus the 232 ulp of fast_exp2).
+template<typename T, typename = typename T::int_t>
+inline T fast_safe_pow (const T& x, const T& y) {
+    using namespace simd;
+    typedef typename T::int_t intN;
+    typedef typename T::bool_t boolN;
+    const T zero (0.0f), one (1.0f);
+    T r = fast_exp2 (y * fast_log2 (abs (x)));
+    // Negative x: the sign alternates with integer powers.  Every float
+    // of magnitude 2^24 or more is an even integer (and might not fit in
+    // an int).
+    T big (16777216.0f);
+    boolN huge = abs (y) >= big;
+    intN yi (select (huge, zero, y));
+    boolN isint = huge | (T(yi) == y);
+    boolN odd = (yi & intN(1)) == intN(1);
+    r = select (x < zero, select (isint, select (odd, -r, r), zero), r);
+    r = select (y == T(2.0f), min (x*x, T(std::numeric_limits<float>::max())), r);
+    r = select (y == one, x, r);
+    r = select (x == zero, zero, r);
+    r = select (y == zero, one, r);
+    return r;
+}
+
+
 // Fast simd pow that only needs to work for positive x
 template<typename T, typename U>
 inline T fast_pow_pos (const T& x, const U& y) {
@@ -48,6 +48,8 @@
 #include "imagecache.h"
 #include "dassert.h"
 
+#include <algorithm>
+#include <future>
 #include <limits>
 
 
@@ -211,8 +213,10 @@ public:
     /// can't change its resolution or data type.
     ImageBuf (string_view name, const ImageSpec &spec, void *buffer);
 
-    /// Construct a copy of an ImageBuf.
-    ///
+    /// Construct a copy of an ImageBuf.  Local pixels held as one block
+    /// are shared with src, not copied, until either one is written to
+    /// (copy-on-write); the same goes for copy() without a change of
+    /// format, and for copy_pixels() between identical layouts.
     ImageBuf (const ImageBuf &src);
 
     /// Destructor for an ImageBuf.
@@ -223,7 +227,9 @@ public:
     enum IBStorage { UNINITIALIZED,   // no pixel memory
                      LOCALBUFFER,     // The IB owns the memory
                      APPBUFFER,       // The IB wraps app's memory
-                     IMAGECACHE       // Backed by ImageCache
+                     IMAGECACHE,      // Backed by ImageCache
+                     VIEWBUFFER,      // Read-only view of another IB's pixels
+                     MMAPBUFFER       // Read-only memory map of the file
                    };
 
     /// Restore the ImageBuf to an uninitialized state.
@@ -280,6 +286,32 @@ public:
                ProgressCallback progress_callback=NULL,
                void *progress_callback_data=NULL);
 
+    /// Read the file from disk like the read() above, but transform the
+    /// pixels from color space fromspace to tospace (using the default
+    /// color configuration, just as ImageBufAlgo::colorconvert would) as
+    /// they are read.  The transform is applied to each chunk of the file
+    /// while it is converted to the buffer's data type, in parallel,
+    /// rather than in a separate pass over the whole image afterwards.
+    /// This always reads the pixels into local memory, and sets the
+    /// "oiio:ColorSpace" metadata to tospace.
+    bool read (int subimage, int miplevel, int chbegin, int chend,
+               bool force, TypeDesc convert,
+               string_view fromspace, string_view tospace,
+               bool unpremult=false,
+               ProgressCallback progress_callback=NULL,
+               void *progress_callback_data=NULL);
+
+    /// Do the same thing as read(), but on a thread from the default
+    /// thread pool, immediately returning a future that will hold read()'s
+    /// result.  The ImageBuf must not be otherwise used or destroyed until
+    /// the future is ready.  The progress callback (if any) is called from
+    /// the thread doing the reading.
+    std::future<bool> read_async (int subimage=0, int miplevel=0,
+                                  bool force=false,
+                                  TypeDesc convert=TypeDesc::UNKNOWN,
+                                  ProgressCallback progress_callback=NULL,
+                                  void *progress_callback_data=NULL);
+
     /// Initialize this ImageBuf with the named image file, and read its
     /// header to fill out the spec correctly.  Return true if this
     /// succeeded, false if the file could not be read.  But don't
@@ -295,6 +327,15 @@ public:
                 ProgressCallback progress_callback=NULL,
                 void *progress_callback_data=NULL) const;
 
+    /// Do the same thing as write(filename,...), but on a thread from the
+    /// default thread pool, immediately returning a future that will hold
+    /// write()'s result.  The ImageBuf must not be modified or destroyed
+    /// until the future is ready.
+    std::future<bool> write_async (string_view filename,
+                                   string_view fileformat = string_view(),
+                                   ProgressCallback progress_callback=NULL,
+                                   void *progress_callback_data=NULL) const;
+
     /// Inform the ImageBuf what data format you'd like for any subsequent
     /// write().
     void set_write_format (TypeDesc format);
@@ -321,8 +362,38 @@ public:
     /// forced data types (you might want to do this if it is critical that
     /// the apparent data type doesn't change, for example if you are
     /// calling make_writeable from within a type-specialized function).
+    /// A view (see make_view) copies the pixels it refers to, and a buffer
+    /// whose pixels are referred to by views stops sharing them.
     bool make_writeable (bool keep_cache_type = false);
 
+    /// Store the pixels that this ImageBuf owns as separate tiles of
+    /// width x height x depth pixels, rather than as one contiguous block
+    /// (or, for width 0, go back to one contiguous block).  This avoids a
+    /// single huge allocation for big images and keeps neighborhoods of
+    /// pixels together in memory.  Pixels already held locally are moved
+    /// into the new layout; otherwise the layout is used the next time
+    /// local pixels are allocated (by reset(spec), read(), or
+    /// make_writeable()).  The choice survives clear() and reset().
+    /// Iterators, getpixel/setpixel, get_pixels/set_pixels and pixeladdr
+    /// work the same with either layout, but with tiles localpixels()
+    /// returns NULL, since the image is not one block.  Return false (and
+    /// do nothing) for an ImageBuf that wraps an application buffer.
+    bool set_local_tiles (int width, int height, int depth=1);
+
+    /// Make *this a copy-on-write "view" of the roi region of src (all of
+    /// src's data window if roi is undefined): the spec is src's with the
+    /// data window set to roi, but no pixels are copied -- reads come
+    /// straight from src's memory, which stays alive as long as the view
+    /// needs it.  The view's storage() is VIEWBUFFER and localpixels() is
+    /// NULL.  The first write to either the view or src (through an
+    /// Iterator, setpixel, pixeladdr, localpixels, etc.) gives the one
+    /// being written its own copy of the pixels, so neither ever sees the
+    /// other's changes.  Return false (and leave *this untouched) unless
+    /// src holds its pixels in memory as one block (or is itself a view),
+    /// is not deep, and roi lies within src's data window and includes all
+    /// of its channels.
+    bool make_view (const ImageBuf &src, ROI roi = ROI::All());
+
     /// Copy all the metadata from src to *this (except for pixel data
     /// resolution, channel information, and data format).
     void copy_metadata (const ImageBuf &src);
@@ -636,8 +707,9 @@ public:
     TypeDesc pixeltype () const;
 
     /// A raw pointer to "local" pixel memory, if they are fully in RAM
-    /// and not backed by an ImageCache, or NULL otherwise.  You can
-    /// also test it like a bool to find out if pixels are local.
+    /// as one contiguous block, or NULL otherwise (if backed by an
+    /// ImageCache, or stored as local tiles).  You can also test it like
+    /// a bool to find out if pixels are local and contiguous.
     void *localpixels ();
     const void *localpixels () const;
 
@@ -649,7 +721,8 @@ public:
 
     /// Return the address where pixel (x,y,z) is stored in the image buffer.
     /// Use with extreme caution!  Will return NULL if the pixel values
-    /// aren't local.
+    /// aren't local.  Unless localpixels() is non-NULL, the pixels that
+    /// follow it in memory are only its neighbors within the same tile.
     const void *pixeladdr (int x, int y, int z=0) const;
 
     /// Return the address where pixel (x,y) is stored in the image buffer.
@@ -779,16 +852,13 @@ public:
         }
 
         ~IteratorBase () {
-            if (m_tile)
-                m_ib->imagecache()->release_tile (m_tile);
+            release_tile ();
         }
 
         /// Assign one IteratorBase to another
         ///
         const IteratorBase & assign_base (const IteratorBase &i) {
-            if (m_tile)
-                m_ib->imagecache()->release_tile (m_tile);
-            m_tile = NULL;
+            release_tile ();
             m_proxydata = i.m_proxydata;
             m_ib = i.m_ib;
             init_ib (i.m_wrap);
@@ -845,6 +915,44 @@ public:
                     m_y == m_rng_ybegin && m_z == m_rng_zend);
         }
 
+        /// Return the number of pixels, starting with the current one and
+        /// proceeding in +x, that are stored one after another in memory
+        /// and lie within both the iteration range and the data window --
+        /// the rest of the scanline for local pixels, or the rest of the
+        /// tile row for cached or locally tiled pixels.  All of them may be
+        /// reached from rawptr() in steps of the pixel size.  Return 1 for
+        /// a pixel outside the data window (or of a deep image), and 0 if
+        /// the iterator is not valid.
+        int span () const {
+            if (! m_valid)
+                return 0;
+            if (! m_exists || m_deep)
+                return 1;
+            int end = std::min (m_rng_xend, m_img_xend);
+            if (! m_localpixels) {
+                if (! m_tile)
+                    return 1;
+                end = std::min (end, m_tilexend);
+            }
+            return end - m_x;
+        }
+
+        /// Move forward by n pixels, where 1 <= n <= span().  This is the
+        /// same as n increments, but checks for tile and range boundaries
+        /// only once, so kernels can run a tight loop over each span:
+        ///     for (ImageBuf::ConstIterator<float> p (buf);  !p.done(); ) {
+        ///         int n = p.span ();
+        ///         const float *f = (const float *) p.rawptr ();
+        ///         ... process n pixels starting at f ...
+        ///         p.advance (n);
+        ///     }
+        void advance (int n) {
+            DASSERT (n >= 1 && n <= span());
+            m_x += n - 1;
+            m_proxydata += (n - 1) * m_pixel_bytes;
+            ++(*this);
+        }
+
         /// Retrieve the number of deep data samples at this pixel.
         int deep_samples () const { return m_ib->deep_samples (m_x, m_y, m_z); }
 
@@ -1033,6 +1141,14 @@ public:
             }
         }
 
+        // Release the tile we're holding.  Buffers with local tiles (see
+        // set_local_tiles()) hand out tiles the ImageCache doesn't own.
+        void release_tile () {
+            if (m_tile && m_ib->cachedpixels())
+                m_ib->imagecache()->release_tile (m_tile);
+            m_tile = NULL;
+        }
+
         // Set to the "done" position
         void pos_done () {
             m_valid = false;
@@ -1043,8 +1159,10 @@ public:
 
         // Make sure it's writeable. Use with caution!
         void make_writeable () {
+            // N.B. even local pixels may need to stop being shared with
+            // views of them, so always ask.
+            const_cast<ImageBuf*>(m_ib)->make_writeable (true);
             if (! m_localpixels) {
-                const_cast<ImageBuf*>(m_ib)->make_writeable (true);
                 DASSERT (m_ib->storage() != IMAGECACHE);
                 m_tile = NULL;
                 m_proxydata = NULL;
@@ -1305,6 +1423,21 @@ protected:
 };
 
 
+
+/// Read many image files into memory at once: bufs[i] is reset to
+/// filenames[i] (through the given ImageCache, or the default one if
+/// NULL) and its first subimage and MIP level read with force=true and
+/// the given convert type, as if by read(0,0,true,convert).  Up to
+/// nthreads files (the size of the thread pool if 0) are read at the
+/// same time, on the default thread pool.  Return true if every read
+/// succeeded; failed ones have the error in their ImageBuf.  There must
+/// be at least as many bufs as filenames.
+OIIO_API bool read_images (array_view<ImageBuf * const> bufs,
+                           array_view<const std::string> filenames,
+                           TypeDesc convert = TypeDesc::UNKNOWN,
+                           int nthreads = 0, ImageCache *imagecache = NULL);
+
+
 OIIO_NAMESPACE_END
 
 #endif // OPENIMAGEIO_IMAGEBUF_H
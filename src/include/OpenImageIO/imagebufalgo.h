@@ -50,6 +50,9 @@
 #ifndef __OPENCV_CORE_TYPES_H__
 struct IplImage;  // Forward declaration; used by Intel Image lib & OpenCV
 #endif
+namespace cv {
+    class Mat;    // Forward declaration of OpenCV's C++ image class
+}
 
 
 
@@ -1011,6 +1014,80 @@ bool OIIO_API colorconvert (float *color, int nchannels,
                             const ColorProcessor *processor, bool unpremult);
 
 
+/// A PixelPipeline records a chain of point-wise operations (those for
+/// which each result pixel depends only on the same pixel of the input)
+/// without performing them, then applies the whole chain in a single pass
+/// over the image.  For example,
+///     PixelPipeline pp;
+///     pp.mul (0.5f).add (0.1f).clamp (0.0f, 1.0f);
+///     pp.apply (R, A);
+/// gives the same result as calling mul(), add(), and clamp() in turn,
+/// but each region of pixels is loaded, transformed, and stored just
+/// once, and no full-size intermediate images are allocated.
+///
+/// The ops that take values accept either a single value (used for all
+/// channels) or one value per channel.  Channels past the end of a
+/// per-channel list are left unchanged by that op.
+class OIIO_API PixelPipeline {
+public:
+    PixelPipeline ();
+    ~PixelPipeline ();
+
+    /// Append A + b, A - b, A * b, A / b (dividing by 0 gives 0, as
+    /// with div()), or A ^ b.
+    PixelPipeline& add (array_view<const float> b);
+    PixelPipeline& sub (array_view<const float> b);
+    PixelPipeline& mul (array_view<const float> b);
+    PixelPipeline& div (array_view<const float> b);
+    PixelPipeline& pow (array_view<const float> b);
+
+    /// Append abs(A), or the inverse 1-A.
+    PixelPipeline& abs ();
+    PixelPipeline& invert ();
+
+    /// Append a clamp to [min,max], and optionally of any alpha channel
+    /// to [0,1], as with clamp().
+    PixelPipeline& clamp (array_view<const float> min,
+                          array_view<const float> max,
+                          bool clampalpha01 = false);
+
+    /// Append a color transform, as with colorconvert().  A from space
+    /// of "" or "current" means the color space of the image at that
+    /// point in the chain: the source image's "oiio:ColorSpace", or the
+    /// 'to' space of an earlier colorconvert in the chain.  The
+    /// transform is looked up when the pipeline is applied, and the
+    /// colorconfig (if not NULL) must remain valid until then.
+    PixelPipeline& colorconvert (string_view from, string_view to,
+                                 bool unpremult = false,
+                                 string_view context_key = "",
+                                 string_view context_value = "",
+                                 ColorConfig *colorconfig = NULL);
+
+    /// Number of recorded ops.
+    size_t size () const { return m_ops.size(); }
+    bool empty () const { return m_ops.empty(); }
+
+    /// Discard all recorded ops.
+    void clear () { m_ops.clear(); }
+
+    /// Apply the recorded ops, in order, to the pixels of src within the
+    /// designated region, storing the results in dst.  The dst and roi
+    /// conventions are the same as for other IBA functions, and dst may
+    /// be the same image as src.  An empty pipeline simply copies the
+    /// pixels.
+    ///
+    /// Return true on success, false on error (with an appropriate error
+    /// message set in dst).
+    bool apply (ImageBuf &dst, const ImageBuf &src,
+                ROI roi=ROI::All(), int nthreads=0) const;
+
+    struct Op;   // Opaque; for internal use only
+private:
+    std::vector<std::shared_ptr<const Op> > m_ops;
+    PixelPipeline& append (Op *op);
+};
+
+
 /// Copy pixels within the ROI from src to dst, applying an OpenColorIO
 /// "look" transform. In-place operations (dst == src) are supported.
 ///
@@ -1213,6 +1290,18 @@ bool OIIO_API compare (const ImageBuf &A, const ImageBuf &B,
                        CompareResults &result,
                        ROI roi = ROI::All(), int nthreads=0);
 
+/// Compare two images as above, but stop early, as soon as more than
+/// maxfail pixels have failed or any difference exceeds hardfail, for
+/// when only a pass/fail answer is needed.  If it stops early, the
+/// results describe only the parts of the images compared so far (and
+/// the number of failures may be a bit past maxfail, since several
+/// regions are compared at once), and it returns false.
+bool OIIO_API compare (const ImageBuf &A, const ImageBuf &B,
+                       float failthresh, float warnthresh,
+                       imagesize_t maxfail, float hardfail,
+                       CompareResults &result,
+                       ROI roi = ROI::All(), int nthreads=0);
+
 /// Compare two images using Hector Yee's perceptual metric, returning
 /// the number of pixels that fail the comparison.  Only the first three
 /// channels (or first three channels specified by roi) are compared.
@@ -1223,6 +1312,10 @@ bool OIIO_API compare (const ImageBuf &A, const ImageBuf &B,
 /// failed most severely.  (The other fields of the CompareResults
 /// are not used for Yee comparison.)
 ///
+/// The prepared form of A (its LAB pixels and luminance pyramid) is kept
+/// until the next call, so comparing one reference image (as either A or
+/// B) against a series of others only prepares the reference once.
+///
 /// The nthreads parameter specifies how many threads (potentially) may
 /// be used, but it's not a guarantee.  If nthreads == 0, it will use
 /// the global OIIO attribute "nthreads".  If nthreads == 1, it
@@ -1361,6 +1454,20 @@ std::string OIIO_API computePixelHashSHA1 (const ImageBuf &src,
                                            ROI roi = ROI::All(),
                                            int blocksize = 0, int nthreads=0);
 
+/// Compute a fast, non-cryptographic 64 bit hash (xxHash64) of all the
+/// pixels in the specified region of the image, returned as 16 hex
+/// digits.  The pixels are hashed in independent blocks of 'blocksize'
+/// scanlines (64 if blocksize <= 0), in parallel on up to nthreads
+/// threads (if nthreads is 0, the global OIIO thread count), and the
+/// result is a hash of the block hashes.  The result depends on the
+/// pixel values, the blocksize, and the 'extrainfo' text that is
+/// incorporated into the hash, but not on the number of threads.  It is
+/// meant for fingerprinting and deduplication, not for security.
+std::string OIIO_API computePixelHashXX64 (const ImageBuf &src,
+                                           string_view extrainfo = "",
+                                           ROI roi = ROI::All(),
+                                           int blocksize = 0, int nthreads=0);
+
 
 /// Warp the src image using the supplied 3x3 transformation matrix.
 ///
@@ -1401,6 +1508,47 @@ bool OIIO_API warp (ImageBuf &dst, const ImageBuf &src,
                     ROI roi = ROI::All(), int nthreads = 0);
 
 
+/// Warp the src image using an "STMap": for each dst pixel, channels
+/// chan_s and chan_t of the corresponding stbuf pixel give the normalized
+/// (0-1 across the full/display window) src coordinates that it should be
+/// taken from, with (0,0) the upper left corner -- or the opposite edge
+/// for the coordinates whose flip_s or flip_t is true (flip_t gives the
+/// bottom-up convention of some compositing packages).  This is the usual
+/// way to apply a lens distortion that has been baked into an image.
+///
+/// The filter (named, and with the width given in dst pixels just as for
+/// warp(), defaulting to lanczos3) weights the src pixels under each
+/// lookup, with the footprint grown by the rate of change of the STMap
+/// where it minifies.  Unscaled "triangle" (width 2) and "catmull-rom"
+/// (width 4) filters are bilinear and bicubic interpolation, respectively.
+/// Lookups outside the src data window see black.  The src may be backed
+/// by an ImageCache: it is read in blocks covering each region of dst.
+///
+/// If dst is uninitialized, it takes the ROI of stbuf and the channels of
+/// src.  Only the pixels (and channels) of dst that are specified by roi
+/// will be altered; the default roi is all of dst.
+///
+/// The nthreads parameter specifies how many threads (potentially) may
+/// be used, but it's not a guarantee.  If nthreads == 0, it will use
+/// the global OIIO attribute "nthreads".  If nthreads == 1, it
+/// guarantees that it will not launch any new threads.
+///
+/// Return true on success, false on error (with an appropriate error
+/// message set in dst).
+bool OIIO_API st_warp (ImageBuf &dst, const ImageBuf &src,
+                       const ImageBuf &stbuf,
+                       string_view filtername = string_view(),
+                       float filterwidth = 0.0f,
+                       int chan_s = 0, int chan_t = 1,
+                       bool flip_s = false, bool flip_t = false,
+                       ROI roi = ROI::All(), int nthreads = 0);
+bool OIIO_API st_warp (ImageBuf &dst, const ImageBuf &src,
+                       const ImageBuf &stbuf, const Filter2D *filter,
+                       int chan_s = 0, int chan_t = 1,
+                       bool flip_s = false, bool flip_t = false,
+                       ROI roi = ROI::All(), int nthreads = 0);
+
+
 /// Rotate the src image by the angle (in radians, with positive angles
 /// clockwise). When center_x and center_y are supplied, they denote the
 /// center of rotation; in their absence, the rotation will be about the
@@ -1461,6 +1609,11 @@ bool OIIO_API rotate (ImageBuf &dst, const ImageBuf &src,
 /// when upsizing, lanczos3 when downsizing) if the empty string is passed
 /// or if filterwidth is 0.
 ///
+/// For reductions of 4x or more, src is first halved by 2x2 box averages
+/// until it is within 4x of dst, and the filter is applied to that, which
+/// is much faster and only very slightly softer than the exact resize.
+/// Setting the global attribute "resize:prereduce" to 0 disables this.
+///
 /// The nthreads parameter specifies how many threads (potentially) may
 /// be used, but it's not a guarantee.  If nthreads == 0, it will use
 /// the global OIIO attribute "nthreads".  If nthreads == 1, it
@@ -1525,6 +1678,9 @@ bool OIIO_API resample (ImageBuf &dst, const ImageBuf &src,
 /// normalized is true, the kernel will be normalized for the 
 /// convolution, otherwise the original values will be used.
 ///
+/// Separable 2D kernels are applied as two 1D passes, and large
+/// non-separable kernels may be applied by FFT when that is cheaper.
+///
 /// The nthreads parameter specifies how many threads (potentially) may
 /// be used, but it's not a guarantee.  If nthreads == 0, it will use
 /// the global OIIO attribute "nthreads".  If nthreads == 1, it
@@ -1558,6 +1714,35 @@ bool OIIO_API make_kernel (ImageBuf &dst, string_view name,
                            float width, float height, float depth = 1.0f,
                            bool normalize = true);
 
+/// Replace the given ROI of dst with a gaussian blur of the
+/// corresponding region of src, where width and height are the full
+/// widths of the gaussian in the sense of make_kernel (a height of 0
+/// means the same as the width).  The method selects the algorithm:
+///     "gaussian"   convolve with the gaussian kernel (exact, but the
+///                  cost grows with the blur size);
+///     "iir"        recursive (Young / van Vliet) gaussian approximation;
+///     "box"        three stacked box filters approximating a gaussian.
+/// The "iir" and "box" methods cost the same per pixel no matter how
+/// big the blur is.  They are approximations, and near the edges of the
+/// image they extend the edge pixels outward, so they are best suited
+/// to glows, bloom, previews and the like.
+///
+/// If roi is not defined, it defaults to the full size of dst (or src,
+/// if dst was undefined).  If dst is uninitialized, it will be
+/// allocated to be the size specified by roi.
+///
+/// The nthreads parameter specifies how many threads (potentially) may
+/// be used, but it's not a guarantee.  If nthreads == 0, it will use
+/// the global OIIO attribute "nthreads".  If nthreads == 1, it
+/// guarantees that it will not launch any new threads.
+///
+/// Return true on success, false on error (with an appropriate error
+/// message set in dst).
+bool OIIO_API blur (ImageBuf &dst, const ImageBuf &src,
+                    float width, float height = 0.0f,
+                    string_view method = "gaussian",
+                    ROI roi = ROI::All(), int nthreads = 0);
+
 /// Replace the given ROI of dst with a sharpened version of the
 /// corresponding region of src using the ``unsharp mask'' technique.
 /// Unsharp masking basically works by first blurring the image (low
@@ -1835,6 +2020,29 @@ bool OIIO_API from_IplImage (ImageBuf &dst, const IplImage *ipl,
 /// calling application.
 OIIO_API IplImage* to_IplImage (const ImageBuf &src);
 
+/// Set dst to be an ImageBuf that wraps the pixels of the OpenCV cv::Mat,
+/// without copying them (as the ImageBuf(name,spec,buffer) constructor
+/// does), so that each sees what the other writes.  This requires a 2D
+/// Mat whose rows are contiguous, of a depth ImageBuf can hold (8, 16 or
+/// 32 bit integers, float, or double).  The channels stay in OpenCV's
+/// order, and are named accordingly ("B", "G", "R", "A" for 3 or 4
+/// channels) rather than reordered.  The Mat must stay alive, and keep
+/// its pixels, as long as dst uses them.  Return false (with an error in
+/// dst) if the Mat can't be wrapped, or if OpenImageIO was compiled
+/// without OpenCV support.
+bool OIIO_API wrap_cv_mat (ImageBuf &dst, cv::Mat &mat);
+
+/// Set dst to be a cv::Mat holding the pixels of src.  If src keeps its
+/// pixels in memory as one block (LOCALBUFFER or APPBUFFER) in a type
+/// OpenCV can hold, 2D, the Mat simply refers to those pixels (and
+/// dst.data == src.localpixels()), so src must outlive the Mat, and
+/// must not be copied while the Mat is being written to.  Otherwise the
+/// pixels are copied into a newly allocated Mat (with half converted to
+/// float).  Either way the channels are not reordered.  Return false if
+/// it is not possible, or if OpenImageIO was compiled without OpenCV
+/// support.
+bool OIIO_API to_cv_mat (cv::Mat &dst, ImageBuf &src);
+
 /// Capture a still image from a designated camera.  If able to do so,
 /// store the image in dst and return true.  If there is no such device,
 /// or support for camera capture is not available (such as if OpenCV
@@ -1941,8 +2149,8 @@ bool OIIO_API render_text (ImageBuf &dst, int x, int y,
 /// ImageBufAlgo::histogram --------------------------------------------------
 /// Parameters:
 /// src         - Input image that contains the one channel to be histogramed.
-///               src must contain float pixel data and have at least 1 channel,
-///               but it can have more.
+///               src may have any pixel data type and must have at least 1
+///               channel, but it can have more.
 /// channel     - Only this channel in src will be histogramed. It must satisfy
 ///               0 <= channel < src.nchannels().
 /// histogram   - Clear old content and store the histogram here.
@@ -1954,11 +2162,13 @@ bool OIIO_API render_text (ImageBuf &dst, int x, int y,
 /// roi         - Only pixels in this region of the image are histogramed. If
 ///               roi is not defined then the full size image will be
 ///               histogramed.
+/// nthreads    - Number of threads, as for the other ImageBufAlgo functions.
 /// --------------------------------------------------------------------------
 bool OIIO_API histogram (const ImageBuf &src, int channel,
                          std::vector<imagesize_t> &histogram, int bins=256,
                          float min=0, float max=1, imagesize_t *submin=NULL,
-                         imagesize_t *supermax=NULL, ROI roi=ROI::All());
+                         imagesize_t *supermax=NULL, ROI roi=ROI::All(),
+                         int nthreads=0);
 
 
 
@@ -2022,6 +2232,11 @@ enum OIIO_API MakeTextureMode {
 ///                              output file doesn't already exist, or is
 ///                              older than the input file, or was created
 ///                              with different command-line arguments. (0)
+///    maketx:incremental (int) If nonzero, write new output only if the
+///                              output file doesn't already exist, or was
+///                              created with different command-line
+///                              arguments, or from different pixels (as
+///                              judged by its recorded SHA-1 hash). (0)
 ///    maketx:constant_color_detect (int)
 ///                           If nonzero, detect images that are entirely
 ///                             one color, and change them to be low
@@ -2036,6 +2251,16 @@ enum OIIO_API MakeTextureMode {
 ///    maketx:compute_average (int)
 ///                           If nonzero, compute and store the average
 ///                              color of the texture (default: 1).
+///    maketx:envcdf (int)
+///                           If nonzero, for a latlong environment map,
+///                              store the importance-sampling tables that
+///                              TextureSystem::environment_cdf() returns,
+///                              so they need not be computed when the
+///                              texture is first used (default: 0).
+///    maketx:tile_stats (int)
+///                           If nonzero, compute and store the average,
+///                              min, and max of each tile of the top
+///                              level, as "oiio:TileStats" (default: 0).
 ///    maketx:unpremult (int) If nonzero, unpremultiply color by alpha before
 ///                              color conversion, then multiply by alpha
 ///                              after color conversion (default: 0).
@@ -2138,6 +2363,23 @@ bool OIIO_API make_texture (MakeTextureMode mode,
                             const ImageSpec &config,
                             std::ostream *outstream = NULL);
 
+/// Convert many files to textures, up to njobs of them at a time (0 picks
+/// a default based on the number of hardware threads), all with the same
+/// config.  Texture i is made from filenames[i] and written to
+/// outputfilenames[i]; if there is no such output name, or it is empty,
+/// the usual default (the input name with a ".tx" extension) is used.
+/// The jobs share the default ColorConfig, its color processors, and the
+/// shared ImageCache.  The messages of each job are written to outstream
+/// together when it finishes, followed, if maketx:verbose or
+/// maketx:runstats is set, by the total time and throughput.  Return true
+/// if every texture was made successfully.
+bool OIIO_API make_texture_batch (MakeTextureMode mode,
+                            const std::vector<std::string> &filenames,
+                            const std::vector<std::string> &outputfilenames,
+                            const ImageSpec &config,
+                            std::ostream *outstream = NULL,
+                            int njobs = 0);
+
 
 
 
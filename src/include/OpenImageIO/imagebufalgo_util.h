@@ -35,6 +35,7 @@
 #include <OpenImageIO/platform.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/thread.h>
+#include <OpenImageIO/trace.h>
 
 #if OIIO_CPLUSPLUS_VERSION >= 11
 # include <functional>
@@ -62,7 +63,54 @@ using boost::this_thread::get_id;
 
 namespace ImageBufAlgo {
 
-enum SplitDir { Split_X, Split_Y, Split_Z, Split_Biggest };
+enum SplitDir { Split_X, Split_Y, Split_Z, Split_Biggest, Split_Tile };
+
+/// Run f over roi cut into blocks of xsize x ysize x zsize, on up to
+/// nthreads threads (the caller and pool workers) that keep claiming the
+/// next unprocessed block until none remain.  This is the engine of both
+/// forms of parallel_image.
+template <class Func>
+void
+parallel_image_blocks (Func f, ROI roi, int nthreads,
+                       int xsize, int ysize, int zsize)
+{
+    int nx = (roi.width() + xsize - 1) / xsize;
+    int ny = (roi.height() + ysize - 1) / ysize;
+    int nz = (roi.depth() + zsize - 1) / zsize;
+    int nchunks = nx * ny * nz;
+    nthreads = std::min (nthreads, nchunks);
+    if (nthreads <= 1) {
+        f (roi);
+        return;
+    }
+
+    // Each worker repeatedly claims the next chunk index until they run
+    // out. Tasks that are only scheduled after the others have finished
+    // everything just find nothing left to do.
+    atomic_int next_chunk (0);
+    auto worker = [=,&next_chunk] (int /*id*/) mutable {
+        for (int c; (c = next_chunk++) < nchunks; ) {
+            int x = c % nx, y = (c / nx) % ny, z = c / (nx * ny);
+            ROI r = roi;
+            r.xbegin = roi.xbegin + x * xsize;
+            r.xend   = std::min (r.xbegin + xsize, roi.xend);
+            r.ybegin = roi.ybegin + y * ysize;
+            r.yend   = std::min (r.ybegin + ysize, roi.yend);
+            r.zbegin = roi.zbegin + z * zsize;
+            r.zend   = std::min (r.zbegin + zsize, roi.zend);
+            f (r);
+        }
+    };
+    thread_pool *pool = default_thread_pool();
+    nthreads = std::min (nthreads, pool->size() + 1);
+    task_set<void> tasks (pool);
+    for (int i = 1; i < nthreads; ++i)
+        tasks.push (pool->push (worker));
+    worker (-1);   // The calling thread works, too
+    tasks.wait ();
+}
+
+
 
 /// Helper template for generalized multithreading for image processing
 /// functions.  Some function/functor f is applied to every pixel the
@@ -74,7 +122,16 @@ enum SplitDir { Split_X, Split_Y, Split_Z, Split_Biggest };
 /// made. The default is Split_Y (vertical splits), which generally seems
 /// the fastest (due to cache layout issues?), but perhaps there are
 /// algorithms where it's better to split in X, Z, or along the longest
-/// axis.
+/// axis. Split_Tile divides the region into roughly square 2D tiles.
+///
+/// The work runs on the shared default_thread_pool() rather than on
+/// freshly spawned threads. The region is cut into several chunks per
+/// thread (but no smaller than about 16k pixels each), and each worker,
+/// including the calling thread, keeps claiming the next unprocessed chunk
+/// until none remain, so threads that finish early pick up the slack of
+/// slower ones.  It is safe to call parallel_image from within a pool
+/// task (nested parallelism): if no pool threads are free, the calling
+/// thread simply does all the chunks itself.
 ///
 /// Most image operations will require additional arguments, including
 /// additional input and output images or other parameters.  The
@@ -95,54 +152,65 @@ parallel_image (Func f, ROI roi, int nthreads=0, SplitDir splitdir=Split_Y)
     if (nthreads <= 0)
         OIIO::getattribute ("threads", nthreads);
     // Try not to assign a thread less than 16k pixels, or it's not worth
-    // the thread startup/teardown cost.
-    nthreads = std::min (nthreads, 1 + int(roi.npixels() / size_t(16384)));
+    // the task overhead.
+    const size_t minpixels = 16384;
+    size_t maxchunks = 1 + roi.npixels() / minpixels;
+    nthreads = int (std::min (size_t(nthreads), maxchunks));
     if (nthreads <= 1) {
         // Just one thread, or a small image region: use this thread only
         f (roi);
         return;
     }
 
+    // Aim for a few chunks per thread, for load balancing.
+    int nchunks_wanted = int (std::min (size_t(4*nthreads), maxchunks));
+
     // If splitdir was not explicit, find the longest edge.
-    if (splitdir >= Split_Biggest)
+    if (splitdir == Split_Biggest)
         splitdir = roi.width() > roi.height() ? Split_X : Split_Y;
-    int minmax[6] = { roi.xbegin, roi.xend, roi.ybegin, roi.yend,
-                      roi.zbegin, roi.zend };
-    int roi_begin = minmax[2*int(splitdir)];
-    int roi_end = minmax[2*int(splitdir)+1];
-    int splitlen = roi_end - roi_begin;
-    nthreads = std::min (nthreads, splitlen);
-
-    // Spawn threads by dividing the region into bands.
-    OIIO::thread_group threads;
-    int blocksize = std::max (1, (splitlen + nthreads - 1) / nthreads);
-    for (int i = 0;  i < nthreads;  i++) {
-        if (splitdir == Split_Y) {
-            roi.ybegin = roi_begin + i * blocksize;
-            roi.yend = std::min (roi.ybegin + blocksize, roi_end);
-            if (roi.ybegin >= roi.yend)
-                break;   // no more work to dole out
-        } else if (splitdir == Split_X) {
-            roi.xbegin = roi_begin + i * blocksize;
-            roi.xend = std::min (roi.xbegin + blocksize, roi_end);
-            if (roi.xbegin >= roi.xend)
-                break;   // no more work to dole out
-        } else { // if (splitdir == Split_Z)
-            roi.zbegin = roi_begin + i * blocksize;
-            roi.zend = std::min (roi.zbegin + blocksize, roi_end);
-            if (roi.zbegin >= roi.zend)
-                break;   // no more work to dole out
-        }
-        if (i < nthreads-1)
-            threads.add_thread (new OIIO::thread (f, roi));
-        else
-            f (roi);   // Run the last one in the calling thread
+
+    // Work out the chunk grid: nx by ny chunks of size xsize by ysize in
+    // x and y, and nz chunks of zsize in z.
+    int xsize = roi.width(), ysize = roi.height(), zsize = roi.depth();
+    if (splitdir == Split_Tile) {
+        int side = int (sqrtf (float(roi.npixels() / roi.depth()) / nchunks_wanted));
+        side = std::max (side, 128);   // 128*128 == minpixels
+        xsize = std::min (side, xsize);
+        ysize = std::min (side, ysize);
+    } else {
+        int &size (splitdir == Split_X ? xsize
+                   : (splitdir == Split_Y ? ysize : zsize));
+        int nchunks = std::max (1, std::min (nchunks_wanted, size));
+        size = (size + nchunks - 1) / nchunks;
     }
-    threads.join_all ();
+    parallel_image_blocks (f, roi, nthreads, xsize, ysize, zsize);
 }
 
 
 
+/// Like parallel_image, but cut roi into 2D blocks of tilewidth x
+/// tileheight pixels (each spanning the full depth of roi), which the
+/// threads claim dynamically.  Operations whose cost varies across the
+/// image, or whose source lookups are coherent in 2D rather than along
+/// scanlines -- warps, large non-separable filters -- balance better and
+/// fit caches better this way than in bands.  A tile size of 0 means 64.
+template <class Func>
+void
+parallel_image (Func f, ROI roi, int nthreads, int tilewidth, int tileheight)
+{
+    if (nthreads <= 0)
+        OIIO::getattribute ("threads", nthreads);
+    int xsize = std::min (tilewidth > 0 ? tilewidth : 64, roi.width());
+    int ysize = std::min (tileheight > 0 ? tileheight : 64, roi.height());
+    parallel_image_blocks (f, roi, nthreads, std::max (xsize, 1),
+                           std::max (ysize, 1), std::max (roi.depth(), 1));
+}
+
+
+
+
+
+
 /// Common preparation for IBA functions: Given an ROI (which may or may not
 /// be the default ROI::All()), destination image (which may or may not yet
 /// be allocated), and optional input images, adjust roi if necessary and
@@ -209,6 +277,8 @@ inline TypeDesc type_merge (TypeDesc a, TypeDesc b, TypeDesc c)
 
 // Macro to call a type-specialzed version func<type>(R,...)
 #define OIIO_DISPATCH_TYPES(ret,name,func,type,R,...)                   \
+    do {                                                                \
+    OIIO_TRACE_ZONE (name);                                             \
     switch (type.basetype) {                                            \
     case TypeDesc::FLOAT :                                              \
         ret = func<float> (R, __VA_ARGS__); break;                      \
@@ -231,7 +301,8 @@ inline TypeDesc type_merge (TypeDesc a, TypeDesc b, TypeDesc c)
     default:                                                            \
         (R).error ("%s: Unsupported pixel data format '%s'", name, type); \
         ret = false;                                                    \
-    }
+    }                                                                   \
+    } while (0)
 
 // Helper, do not call from the outside world.
 #define OIIO_DISPATCH_TYPES2_HELP(ret,name,func,Rtype,Atype,R,...)      \
@@ -261,6 +332,8 @@ inline TypeDesc type_merge (TypeDesc a, TypeDesc b, TypeDesc c)
 
 // Macro to call a type-specialzed version func<Rtype,Atype>(R,...).
 #define OIIO_DISPATCH_TYPES2(ret,name,func,Rtype,Atype,R,...)           \
+    do {                                                                \
+    OIIO_TRACE_ZONE (name);                                             \
     switch (Rtype.basetype) {                                           \
     case TypeDesc::FLOAT :                                              \
         OIIO_DISPATCH_TYPES2_HELP(ret,name,func,float,Atype,R,__VA_ARGS__); \
@@ -292,12 +365,15 @@ inline TypeDesc type_merge (TypeDesc a, TypeDesc b, TypeDesc c)
     default:                                                            \
         (R).error ("%s: Unsupported pixel data format '%s'", name, Rtype); \
         ret = false;                                                    \
-    }
+    }                                                                   \
+    } while (0)
 
 
 // Macro to call a type-specialzed version func<type>(R,...) for
 // the most common types, will auto-convert the rest to float.
 #define OIIO_DISPATCH_COMMON_TYPES(ret,name,func,type,R,...)            \
+    do {                                                                \
+    OIIO_TRACE_ZONE (name);                                             \
     switch (type.basetype) {                                            \
     case TypeDesc::FLOAT :                                              \
         ret = func<float> (R, __VA_ARGS__); break;                      \
@@ -318,7 +394,8 @@ inline TypeDesc type_merge (TypeDesc a, TypeDesc b, TypeDesc c)
         else                                                            \
             (R).error ("%s", Rtmp.geterror());                          \
         }                                                               \
-    }
+    }                                                                   \
+    } while (0)
 
 // Helper, do not call from the outside world.
 #define OIIO_DISPATCH_COMMON_TYPES2_HELP(ret,name,func,Rtype,Atype,R,A,...) \
@@ -342,6 +419,8 @@ inline TypeDesc type_merge (TypeDesc a, TypeDesc b, TypeDesc c)
 // Macro to call a type-specialzed version func<Rtype,Atype>(R,A,...) for
 // the most common types, will auto-convert the rest to float.
 #define OIIO_DISPATCH_COMMON_TYPES2(ret,name,func,Rtype,Atype,R,A,...)  \
+    do {                                                                \
+    OIIO_TRACE_ZONE (name);                                             \
     switch (Rtype.basetype) {                                           \
     case TypeDesc::FLOAT :                                              \
         OIIO_DISPATCH_COMMON_TYPES2_HELP(ret,name,func,float,Atype,R,A,__VA_ARGS__); \
@@ -366,7 +445,8 @@ inline TypeDesc type_merge (TypeDesc a, TypeDesc b, TypeDesc c)
         else                                                            \
             (R).error ("%s", Rtmp.geterror());                          \
         }                                                               \
-    }
+    }                                                                   \
+    } while (0)
 
 
 // Helper, do not call from the outside world.
@@ -419,6 +499,8 @@ inline TypeDesc type_merge (TypeDesc a, TypeDesc b, TypeDesc c)
 // Macro to call a type-specialzed version func<Rtype,Atype,Btype>(R,A,B,...)
 // the most common types, will auto-convert the rest to float.
 #define OIIO_DISPATCH_COMMON_TYPES3(ret,name,func,Rtype,Atype,Btype,R,A,B,...)  \
+    do {                                                                \
+    OIIO_TRACE_ZONE (name);                                             \
     switch (Atype.basetype) {                                           \
     case TypeDesc::FLOAT :                                              \
         OIIO_DISPATCH_COMMON_TYPES3_HELP(ret,name,func,Rtype,float,Btype,R,A,B,__VA_ARGS__); \
@@ -437,7 +519,8 @@ inline TypeDesc type_merge (TypeDesc a, TypeDesc b, TypeDesc c)
         ImageBuf Atmp;                                                  \
         Atmp.copy (A, TypeDesc::FLOAT);                                 \
         OIIO_DISPATCH_COMMON_TYPES3_HELP(ret,name,func,Rtype,float,Btype,R,Atmp,B,__VA_ARGS__); \
-    }
+    }                                                                   \
+    } while (0)
 
 
 
@@ -85,6 +85,8 @@ public:
     /// if the name and type were recognized and the attrib was set.
     /// Documented attributes:
     ///     int max_open_files : maximum number of file handles held open
+    ///     int open_file_lru : if nonzero, close least recently used files
+    ///                          first, on a background thread (default=0)
     ///     float max_memory_MB : maximum tile cache size, in MB
     ///     string searchpath : colon-separated search path for images
     ///     string plugin_searchpath : colon-separated search path for plugins
@@ -97,12 +99,32 @@ public:
     ///     int statistics:level : verbosity of statistics auto-printed.
     ///     int forcefloat : if nonzero, convert all to float.
     ///     int failure_retries : number of times to retry a read before fail.
+    ///     int microcache_size : entries in each thread's table of recently
+    ///                          used tiles (power of 2, default=0)
+    ///     float max_compressed_memory_MB : budget for a tier that keeps
+    ///                          evicted tiles compressed in memory (def=0)
+    ///     int max_tile_batch : read up to this many neighboring missing
+    ///                          tiles of a row at once (default=1)
     ///     int deduplicate : if nonzero, detect duplicate textures (default=1)
+    ///     string tile_cache_dir : directory for decoded tiles shared with
+    ///                          other processes (default="", no sharing)
+    ///     int mmap_tiles : if nonzero, memory-map the tiles found in
+    ///                          tile_cache_dir rather than reading them
     ///     string substitute_image : uses the named image in place of all
     ///                               texture and image references.
     ///     int unassociatedalpha : if nonzero, keep unassociated alpha images
     ///     int max_errors_per_file : Limits how many errors to issue for
     ///                               issue for each (default: 100)
+    ///     int lockfree_tiles : if nonzero, look up cached tiles without
+    ///                          locking (default=0)
+    ///     int prefetch_threads : number of threads that read tiles for
+    ///                          prefetch_tiles() (default=2)
+    ///     int gather_threads : number of threads that gather the tiles of
+    ///                          a get_pixels() region spanning several
+    ///                          rows of tiles (default=1, 0 = all)
+    ///     string eviction_policy : how tiles are chosen to be freed when
+    ///                          the cache is full: "clock" (default) or
+    ///                          "gclock" (sharded and frequency-aware)
     ///
     virtual bool attribute (string_view name, TypeDesc type,
                             const void *val) = 0;
@@ -368,6 +390,58 @@ public:
                          format, buffer, xstride, ystride, zstride);
     }
 
+    /// Ask for all the tiles of the given subimage and MIP level that
+    /// overlap the pixel region roi (and its channel range, or all
+    /// channels if roi.chend < roi.chbegin) to be read into the cache in
+    /// the background, by a pool of I/O threads (see the
+    /// "prefetch_threads" attribute).  This returns right away, without
+    /// waiting for any reads.  A later request for a tile that is being
+    /// read at that moment will wait for that read to finish rather than
+    /// reading it again.  Return false if the file or level can't be
+    /// found.
+    virtual bool prefetch_tiles (ustring filename, int subimage,
+                                 int miplevel, ROI roi) = 0;
+    virtual bool prefetch_tiles (ImageHandle *file, Perthread *thread_info,
+                                 int subimage, int miplevel, ROI roi) = 0;
+
+    /// Read (if need be) all the tiles of the given subimage and MIP
+    /// level that overlap roi (and its channel range, or all channels if
+    /// roi.chend < roi.chbegin), and pin them: the cache will not evict a
+    /// pinned tile to make room for others, until unpin_tiles() has been
+    /// called for it as many times as pin_tiles().  This is meant for
+    /// renderers that know the working set of a bucket, so that the
+    /// bucket doesn't push its own tiles out.  The memory held by pinned
+    /// tiles is limited by the "max_pinned_MB" attribute; a request that
+    /// would go past it pins the tiles it can, issues an error, and
+    /// returns false (unpinning the same region releases the ones that
+    /// were pinned).  Also return false if the file or level can't be
+    /// found or a tile can't be read.
+    virtual bool pin_tiles (ustring filename, int subimage, int miplevel,
+                            ROI roi) = 0;
+    virtual bool pin_tiles (ImageHandle *file, Perthread *thread_info,
+                            int subimage, int miplevel, ROI roi) = 0;
+
+    /// Undo one pin_tiles() of the tiles overlapping roi.  Tiles that are
+    /// not pinned are ignored.  Return false if the file or level can't
+    /// be found.
+    virtual bool unpin_tiles (ustring filename, int subimage, int miplevel,
+                              ROI roi) = 0;
+    virtual bool unpin_tiles (ImageHandle *file, Perthread *thread_info,
+                              int subimage, int miplevel, ROI roi) = 0;
+
+    /// Write a manifest of the cache's working set to the named text
+    /// file: every file referenced (hottest first) and every tile now
+    /// resident in the cache.  Return false if it could not be written.
+    virtual bool save_manifest (string_view filename) = 0;
+
+    /// Read a manifest written by save_manifest() (perhaps by a previous
+    /// process) and ask for its files to be opened and its tiles to be
+    /// read in the background, as prefetch_tiles() does, so that a new
+    /// session starts with a warm cache.  Entries that no longer fit the
+    /// file they name are skipped.  This returns right away; it returns
+    /// false only if the manifest could not be read.
+    virtual bool load_manifest (string_view filename) = 0;
+
     /// If any of the API routines returned false indicating an error,
     /// this routine will return the error string (and clear any error
     /// flags).  If no error has occurred since the last time geterror()
@@ -378,6 +452,20 @@ public:
     ///
     virtual std::string getstats (int level=1) const = 0;
 
+    /// Return a snapshot of the statistics as a JSON object, for
+    /// programs that monitor the cache rather than print its report:
+    ///     {"imagecache":{"files":{...}, "tiles":{...}, "memory":{...},
+    ///      "time":{...}, "tile_read_latency":{...}, ...}}
+    /// Level 1 has the totals, eviction and lock wait times, and
+    /// histograms of tile read and file open latencies ("counts"[i] is
+    /// the number of times under "bucket_us"[i] microseconds, and not
+    /// under the previous bound; the last count has no bound).  Level 2
+    /// adds a "per_file" array with the opens, tile reads (misses), main
+    /// cache hits and per-MIP-level tile reads of every file.  Level 1
+    /// does not visit the files, so it is cheap enough to poll every
+    /// few seconds during a long render.
+    virtual std::string getstats_json (int level=1) const = 0;
+
     /// Reset most statistics to be as they were with a fresh
     /// ImageCache.  Caveat emptor: this does not flush the cache itelf,
     /// so the resulting statistics from the next set of texture
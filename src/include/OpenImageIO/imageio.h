@@ -53,6 +53,7 @@
 #include <string>
 #include <limits>
 #include <cmath>
+#include <functional>
 
 #include "export.h"
 #include "oiioversion.h"
@@ -65,6 +66,7 @@
 OIIO_NAMESPACE_BEGIN
 
 class DeepData;
+struct ROI;
 
 
 /// Type we use for stride lengths.  This is only used to designate
@@ -469,6 +471,16 @@ public:
     ///    "iptc"           Can this format store IPTC data?
     ///    "procedural"     Can this format create images without reading
     ///                        from a disk file?
+    ///    "concurrent_tiles" Is read_tiles_concurrent() implemented, so
+    ///                        that several threads may read tiles of one
+    ///                        open file at the same time?
+    ///    "ioproxy"        Can open() take a Filesystem::IOProxy* in the
+    ///                        config's "oiio:ioproxy" attribute (of type
+    ///                        TypeDesc::PTR) and read through it instead
+    ///                        of opening the named file?
+    ///    "subimage_count" Once a file is open, the number of subimages
+    ///                        in it, if the reader knows without having
+    ///                        to seek through them (0 if it doesn't).
     ///
     /// Note that main advantage of this approach, versus having
     /// separate individual supports_foo() methods, is that this allows
@@ -498,6 +510,12 @@ public:
     /// instructions.  ImageInput implementations are free to not
     /// respond to any such requests, so the default implementation is
     /// just to ignore config and call regular open(name,newspec).
+    ///
+    /// A request understood across plugins is "oiio:headeronly" (int):
+    /// if nonzero, the caller only wants the ImageSpec, so the plugin
+    /// may skip any work needed only for reading pixels (unpacking,
+    /// indexing, decoding thumbnails).  Reading pixels from a file
+    /// opened this way is not guaranteed to work.
     virtual bool open (const std::string &name, ImageSpec &newspec,
                        const ImageSpec & /*config*/) { return open(name,newspec); }
 
@@ -670,6 +688,24 @@ public:
                              stride_t ystride=AutoStride,
                              stride_t zstride=AutoStride);
 
+    /// Read the whole tiles covering [xbegin,xend) X [ybegin,yend) X
+    /// [zbegin,zend) of the given subimage and MIP level, channels
+    /// [chbegin,chend), into contiguous data in the requested format
+    /// (or the native layout if format is TypeDesc::UNKNOWN).  Unlike
+    /// read_tiles, this neither depends on nor changes the current
+    /// subimage, and it may be called by several threads at once on the
+    /// same ImageInput, even while another thread uses the ordinary
+    /// calls -- as long as none of them calls open() or close(), and the
+    /// subimage and MIP level have already been visited with
+    /// seek_subimage.  Only formats for which supports("concurrent_tiles")
+    /// is true implement it; the default just returns false.
+    virtual bool read_tiles_concurrent (int subimage, int miplevel,
+                                        int xbegin, int xend,
+                                        int ybegin, int yend,
+                                        int zbegin, int zend,
+                                        int chbegin, int chend,
+                                        TypeDesc format, void *data);
+
     /// Read the entire image of spec.width x spec.height x spec.depth
     /// pixels into data (which must already be sized large enough for
     /// the entire image) with the given strides and in the desired
@@ -788,6 +824,49 @@ public:
     /// spec.depth pixels, all channels, into deepdata.
     virtual bool read_native_deep_image (DeepData &deepdata);
 
+    /// Read just the number of deep samples of each pixel in
+    /// [xbegin,xend) X [ybegin,yend) X [zbegin,zend) into counts (one
+    /// per pixel, in scanline order), without reading the samples.  For
+    /// tiled files the region must consist of whole tiles.  Return
+    /// false if the format reader can't do this (the default).
+    virtual bool read_native_deep_sample_counts (int xbegin, int xend,
+                                                 int ybegin, int yend,
+                                                 int zbegin, int zend,
+                                                 unsigned int *counts);
+
+    /// Callback for read_native_deep_blocks: it is handed the region of
+    /// each block and its deep data (whose pixel indices are relative to
+    /// roi), and returns false to stop reading.
+    typedef std::function<bool(const ROI &roi, const DeepData &deepdata)>
+            DeepBlockFunc;
+
+    /// Read the deep image of the current subimage and MIP level
+    /// incrementally, so that only one block of it is ever in memory:
+    /// call fn for each successive block of whole scanlines or tiles, in
+    /// order, reading only channels [chbegin,chend).  If the reader can
+    /// read_native_deep_sample_counts, the counts of the whole image are
+    /// read first and the blocks are sized to hold no more than
+    /// max_samples samples each (when a single tile or scanline doesn't
+    /// have more); otherwise each block is one row of tiles or 16
+    /// scanlines.  Return false if a read fails; stopping early because
+    /// fn returned false is not an error.
+    bool read_native_deep_blocks (int chbegin, int chend,
+                                  imagesize_t max_samples,
+                                  const DeepBlockFunc &fn);
+
+    /// If the pixels of the current subimage and MIP level are stored in
+    /// the file uncompressed, in this machine's byte order, and exactly as
+    /// read_native_scanline would return them (scanlines of contiguous
+    /// spec().format pixels, each ystride bytes after the previous one --
+    /// which may be negative for bottom-to-top files), store the byte
+    /// position of the first pixel of the first scanline in offset, the
+    /// scanline stride in ystride, and return true.  This lets a caller
+    /// memory-map the file instead of reading it.  The default
+    /// implementation returns false.
+    virtual bool raw_pixel_layout (int64_t &offset, stride_t &ystride) {
+        return false;
+    }
+
 
     /// General message passing between client and image input server
     ///
@@ -915,6 +994,10 @@ public:
     ///                        arbitrary names and types?
     ///    "exif"           Can this format store Exif camera data?
     ///    "iptc"           Can this format store IPTC data?
+    ///    "ioproxy"        Can open() take a Filesystem::IOProxy* in the
+    ///                        spec's "oiio:ioproxy" attribute (of type
+    ///                        TypeDesc::PTR) and write through it instead
+    ///                        of creating the named file?
     ///
     /// Note that main advantage of this approach, versus having
     /// separate individual supports_foo() methods, is that this allows
@@ -1244,12 +1327,26 @@ OIIO_API std::string geterror ();
 ///             How many threads to use for operations that can be sped
 ///             by spawning threads (default=0, meaning to use the full
 ///             available hardware concurrency detected).
+///     string threads:affinity
+///             How the shared thread pool's workers are bound to CPUs:
+///             "none" (the default) lets them run anywhere; "numa" deals
+///             workers in turn to the NUMA nodes, each free to run on any
+///             CPU of its node; "cpu" does the same but pins each worker
+///             to a single CPU.  Bound workers keep the ImageCache tiles
+///             and ImageBuf pixels they first touch in node-local memory.
+///             Only supported on Linux.
+///     int threads:numa_nodes  (for 'getattribute' only, cannot set)
+///             The number of NUMA nodes detected (1 where the platform
+///             doesn't report them).
 ///     int exr_threads
 ///             The size of the internal OpenEXR thread pool. The default
 ///             is to use the full available hardware concurrency detected.
 ///             Default is 0 meaning to use full available hardware
 ///             concurrency detected, -1 means to disable usage of the OpenEXR
 ///             thread pool and execute everything in the caller thread.
+///             With OpenEXR 2.3 or newer, OpenEXR's tasks are run by OIIO's
+///             own default thread pool, and this value limits how many of
+///             them a single file may have in flight.
 ///     string plugin_searchpath
 ///             Colon-separated list of directories to search for 
 ///             dynamically-loaded format plugins.
@@ -1274,6 +1371,72 @@ OIIO_API std::string geterror ();
 ///             When nonzero, allows TIFF to write 'half' pixel data.
 ///             N.B. Most apps may not read these correctly, but OIIO will.
 ///             That's why the default is not to support it.
+///     int imagebuf:pool_MB
+///             When nonzero, freed ImageBuf pixel memory (up to this many
+///             MB) is kept in a pool, bucketed by size, and reused by
+///             later ImageBufs of the same size (default: 0, no pool).
+///     int imagebuf:hugepages
+///             When nonzero, large ImageBuf pixel allocations ask the OS
+///             for huge pages where supported (default: 0).
+///     int imagebuf:mmap
+///             When nonzero, a forced ImageBuf::read of an uncompressed
+///             file whose pixels are stored exactly in the requested
+///             format memory-maps the file rather than reading it
+///             (default: 0).
+///     int imagebuf:spill_MB
+///             When nonzero, an ImageBuf pixel allocation that would take
+///             the memory held by all ImageBufs past this many MB is
+///             instead backed by a scratch file that the OS pages in and
+///             out as needed (default: 0, never spill).
+///     string imagebuf:spill_dir
+///             Directory for the scratch files (default: the system's
+///             temporary directory).
+///     string color:precision
+///             "exact" (the default) applies color transforms made by the
+///             ImageBufAlgo color functions exactly; "baked" first bakes
+///             each one into a 3D LUT over the [0,1] RGB cube, applied
+///             with tetrahedral interpolation, and uses the exact
+///             transform only for pixels outside the cube.
+///     int resize:prereduce
+///             When nonzero (the default), ImageBufAlgo::resize by filter
+///             name first halves the source with 2x2 box averages while
+///             it is at least 4x bigger than the result, then applies the
+///             named filter to the reduced image.  Set to 0 for the exact
+///             single-pass filtered resize.
+///     string simd
+///             The instruction set used by the pixel conversion kernels that
+///             are selected at runtime (those behind convert_image and
+///             convert_types), e.g. "avx2" if the library was built for SSE
+///             but runs on a CPU with AVX2, FMA and F16C.  Setting it to a
+///             lower level, such as "sse2", restricts those kernels to the
+///             instruction set the library was compiled for (useful for
+///             testing and benchmarking); "" restores the best available.
+///     string hw:simd  (getattribute only)
+///             Comma-separated list of the SIMD features of the CPU we are
+///             running on, e.g. "sse2,sse3,ssse3,sse4.1,sse4.2,avx,avx2".
+///     string oiio:simd  (getattribute only)
+///             Comma-separated list of the SIMD features OIIO was compiled
+///             to use.
+///     int trace
+///             When nonzero, the timed zones compiled into the library
+///             (see trace.h) are recorded; the default is 0 unless the
+///             OIIO_TRACE environment variable names an output file.
+///     int trace:buffer_size
+///             The number of most recent zones kept per thread (default
+///             65536); older zones are overwritten.
+///     string trace:file  (attribute only)
+///             When set, the recorded zones are written to this file, in
+///             Chrome trace event JSON format, when the program exits.
+///     int64 stat:imagebuf:spilled_bytes  (getattribute only)
+///             Bytes of ImageBuf pixels currently held in scratch files.
+///     int64 stat:imagebuf:pool_bytes, stat:imagebuf:pool_reused_bytes,
+///           stat:imagebuf:pool_peak_bytes  (getattribute only)
+///             Bytes currently held in the pixel pool, total bytes reused
+///             from it, and the biggest the pool has been.
+///     int64 stat:imagebuf:local_bytes, stat:imagebuf:local_peak_bytes
+///             Bytes of pixel memory currently owned by ImageBufs, and the
+///             most there has been since the peak was reset (by setting
+///             the attribute "stat:imagebuf:local_peak_bytes" to anything).
 ///
 OIIO_API bool attribute (string_view name, TypeDesc type, const void *val);
 // Shortcuts for common types
@@ -1373,6 +1536,29 @@ OIIO_API bool parallel_convert_image (
                stride_t dst_zstride,
                int alpha_channel=-1, int z_channel=-1, int nthreads=0);
 
+/// Helper routines for data conversion between "planar" layout, in which
+/// each of the nchannels channels of a width x height x depth image is a
+/// separate contiguous plane (successive planes planestride bytes apart,
+/// or back to back if planestride is AutoStride), and contiguous
+/// "interleaved" layout, with all the channels of each pixel together,
+/// converting from src_type to dst_type along the way.  The work is split
+/// over up to nthreads threads (0 means the global OIIO "threads"
+/// attribute), and common same-type layouts (such as 4-channel uint8 or
+/// float) use vectorized transposes.  Return true if ok, false if it
+/// didn't know how to do the conversion.
+OIIO_API bool planar_to_interleaved (int nchannels, int width, int height,
+                                     int depth, const void *src,
+                                     TypeDesc src_type,
+                                     stride_t src_planestride,
+                                     void *dst, TypeDesc dst_type,
+                                     int nthreads=0);
+OIIO_API bool interleaved_to_planar (int nchannels, int width, int height,
+                                     int depth, const void *src,
+                                     TypeDesc src_type,
+                                     void *dst, TypeDesc dst_type,
+                                     stride_t dst_planestride,
+                                     int nthreads=0);
+
 /// Add random [-theramplitude,ditheramplitude] dither to the color channels
 /// of the image.  Dither will not be added to the alpha or z channel.  The
 /// image origin and dither seed values allow a reproducible (or variable)
@@ -1452,6 +1638,14 @@ OIIO_API void encode_iptc_iim (const ImageSpec &spec, std::vector<char> &iptc);
 /// functionality within each plugin.
 OIIO_API bool decode_xmp (const std::string &xml, ImageSpec &spec);
 
+/// Some readers (such as JPEG, when opened with the "oiio:DeferMetadata"
+/// configuration hint) leave the raw Exif, XMP and IPTC blocks in the
+/// spec as "oiio:ExifData", "oiio:XMPData" and "oiio:IPTCData" (uint8
+/// arrays) rather than decoding them at open time.  Decode any such
+/// blocks into ordinary attributes and remove them.  Return true if all
+/// is ok, false if any of them was malformed.
+OIIO_API bool decode_deferred_metadata (ImageSpec &spec);
+
 /// Find all the relavant metadata (IPTC, Exif, etc.) in spec and
 /// assemble it into an XMP XML string.  This is a utility function to
 /// make it easy for multiple format plugins to support embedding XMP
@@ -155,6 +155,63 @@ parallel_for (int64_t start, int64_t end,
 
 
 
+/// Parallel "for" loop over a 2D range, for a task that takes an int
+/// thread ID followed by a [xbegin,xend) x [ybegin,yend) block.  The range
+/// is cut into blocks of xchunk x ychunk (smaller at the right and bottom
+/// edges), which the calling thread and the pool's workers keep claiming
+/// until none remain, so blocks of uneven cost balance out.  A chunk size
+/// of 0 means 64, a block that (for a few channels of float pixels) fits
+/// comfortably in a core's cache.
+inline void
+parallel_for_2d (int64_t xbegin, int64_t xend, int64_t xchunk,
+                 int64_t ybegin, int64_t yend, int64_t ychunk,
+                 std::function<void(int id, int64_t xb, int64_t xe,
+                                    int64_t yb, int64_t ye)>&& task)
+{
+    if (xend <= xbegin || yend <= ybegin)
+        return;
+    if (xchunk < 1)
+        xchunk = 64;
+    if (ychunk < 1)
+        ychunk = 64;
+    int64_t nx = (xend - xbegin + xchunk - 1) / xchunk;
+    int64_t nchunks = nx * ((yend - ybegin + ychunk - 1) / ychunk);
+    std::atomic<int64_t> next_chunk (0);
+    auto worker = [&](int id) {
+        for (int64_t c; (c = next_chunk++) < nchunks; ) {
+            int64_t xb = xbegin + (c % nx) * xchunk;
+            int64_t yb = ybegin + (c / nx) * ychunk;
+            task (id, xb, std::min (xb + xchunk, xend),
+                  yb, std::min (yb + ychunk, yend));
+        }
+    };
+    thread_pool *pool (default_thread_pool());
+    int nworkers = int (std::min (int64_t(pool->size()), nchunks - 1));
+    task_set<void> ts (pool);
+    for (int i = 0; i < nworkers; ++i)
+        ts.push (pool->push (worker));
+    worker (-1);   // The calling thread works, too
+    ts.wait ();
+}
+
+
+/// Parallel "for" loop over a 2D range, for a task that takes a
+/// [xbegin,xend) x [ybegin,yend) block (but not a thread ID).
+inline void
+parallel_for_2d (int64_t xbegin, int64_t xend, int64_t xchunk,
+                 int64_t ybegin, int64_t yend, int64_t ychunk,
+                 std::function<void(int64_t xb, int64_t xe,
+                                    int64_t yb, int64_t ye)>&& task)
+{
+    parallel_for_2d (xbegin, xend, xchunk, ybegin, yend, ychunk,
+                     [&task](int id, int64_t xb, int64_t xe,
+                             int64_t yb, int64_t ye) {
+        task (xb, xe, yb, ye);
+    });
+}
+
+
+
 /// parallel_for_each, semantically is like std::for_each(), but each
 /// iteration is a separate job for the default thread pool.
 template<class InputIt, class UnaryFunction>
@@ -45,6 +45,7 @@
 #  pragma warning (disable : 4251)
 #endif
 
+#include <memory>
 #include <vector>
 
 #include "export.h"
@@ -168,6 +169,22 @@ class OIIO_API ParamValueList {
     typedef std::vector<ParamValue> Rep;
 public:
     ParamValueList () { }
+    ParamValueList (const ParamValueList &p)
+        : m_vals(p.m_vals), m_index(std::atomic_load(&p.m_index)) { }
+    ParamValueList (ParamValueList &&p)
+        : m_vals(std::move(p.m_vals)), m_index(std::move(p.m_index)) { }
+    const ParamValueList& operator= (const ParamValueList &p) {
+        if (this != &p) {
+            m_vals = p.m_vals;
+            m_index = std::atomic_load (&p.m_index);
+        }
+        return *this;
+    }
+    const ParamValueList& operator= (ParamValueList &&p) {
+        m_vals = std::move (p.m_vals);
+        m_index = std::move (p.m_index);
+        return *this;
+    }
 
     typedef Rep::iterator        iterator;
     typedef Rep::const_iterator  const_iterator;
@@ -194,7 +211,7 @@ public:
     reference operator[] (size_t i) { return m_vals[i]; }
     const_reference operator[] (size_t i) const { return m_vals[i]; }
 
-    void resize (size_t newsize) { m_vals.resize (newsize); }
+    void resize (size_t newsize) { m_vals.resize (newsize); invalidate(); }
     size_t size () const { return m_vals.size(); }
 
     /// Add space for one more ParamValue to the list, and return a
@@ -206,11 +223,16 @@ public:
 
     /// Add a ParamValue to the end of the list.
     ///
-    void push_back (const ParamValue &p) { m_vals.push_back (p); }
+    void push_back (const ParamValue &p) { m_vals.push_back (p); invalidate(); }
     
     /// Find the first entry with matching name, and if type != UNKNOWN,
     /// then also with matching type. The name search is case sensitive if
     /// casesensitive == true.
+    ///
+    /// Long lists are searched through a name index that is built on the
+    /// first search and discarded by any call that adds or removes
+    /// entries. Renaming an entry in place (via a reference or iterator)
+    /// does not discard it, so call invalidate() after doing so.
     iterator find (string_view name, TypeDesc type = TypeDesc::UNKNOWN,
                    bool casesensitive = true);
     iterator find (ustring name, TypeDesc type = TypeDesc::UNKNOWN,
@@ -222,22 +244,40 @@ public:
 
     /// Removes from the ParamValueList container a single element.
     /// 
-    iterator erase (iterator position) { return m_vals.erase (position); }
+    iterator erase (iterator position) {
+        invalidate();
+        return m_vals.erase (position);
+    }
     
     /// Removes from the ParamValueList container a range of elements ([first,last)).
     /// 
-    iterator erase (iterator first, iterator last) { return m_vals.erase (first, last); }
+    iterator erase (iterator first, iterator last) {
+        invalidate();
+        return m_vals.erase (first, last);
+    }
     
     /// Remove all the values in the list.
     ///
-    void clear () { m_vals.clear(); }
+    void clear () { m_vals.clear(); invalidate(); }
 
     /// Even more radical than clear, free ALL memory associated with the
     /// list itself.
-    void free () { Rep tmp; std::swap (m_vals, tmp); }
+    void free () { Rep tmp; std::swap (m_vals, tmp); invalidate(); }
+
+    /// Discard the name index used by find(). This only needs to be
+    /// called explicitly after renaming an entry in place.
+    void invalidate () { m_index.reset(); }
 
 private:
+    struct Index;
     Rep m_vals;
+    // Immutable once built, so copies of the list may share it. It's
+    // built lazily by find() and published atomically, so concurrent
+    // const searches of a shared list are safe.
+    mutable std::shared_ptr<const Index> m_index;
+
+    std::shared_ptr<const Index> index () const;
+    size_t find_index (ustring name, TypeDesc type, bool casesensitive) const;
 };
 
 
@@ -57,6 +57,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <OpenEXR/ImathMatrix.h>
 #include <algorithm>
 #include <cstring>
+#include <cstdint>
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -83,8 +84,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //             available (generally will be OIIO_SIMD*4).
 // OIIO_SIMD4_ALIGN : macro for best alignment of 4-wide SIMD values in mem.
 // OIIO_SIMD8_ALIGN : macro for best alignment of 8-wide SIMD values in mem.
+// OIIO_SIMD16_ALIGN : macro for best alignment of 16-wide SIMD values in mem.
 // OIIO_SIMD_HAS_MATRIX4 : nonzero if matrix44 is defined
 // OIIO_SIMD_HAS_FLOAT8 : nonzero if float8, int8, bool8 are defined
+// OIIO_SIMD_HAS_FLOAT16 : nonzero if float16, int16, bool16 are defined
 
 #if (defined(__SSE2__) || (_MSC_VER >= 1300 && !_M_CEE_PURE)) && !defined(OIIO_NO_SSE)
 #  include <immintrin.h>
@@ -130,8 +133,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #  define OIIO_SIMD_MAX_SIZE_BYTES 32
 #  define OIIO_SIMD8_ALIGN OIIO_ALIGN(32)
 #  define OIIO_AVX_ALIGN OIIO_ALIGN(32)
-#  if defined(__AVX512__) && !defined(OIIO_NO_AVX512)
+#  if defined(__AVX512F__) && !defined(OIIO_NO_AVX512)
+#    undef OIIO_SIMD_AVX
 #    define OIIO_SIMD_AVX 512
+#    undef OIIO_SIMD
+#    define OIIO_SIMD 16
 #    undef OIIO_SIMD_MAX_SIZE_BYTES
 #    define OIIO_SIMD_MAX_SIZE_BYTES 64
 #    define OIIO_SIMD16_ALIGN OIIO_ALIGN(64)
@@ -164,6 +170,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #  define OIIO_SIMD_MAX_SIZE_BYTES 16
 #endif
 
+#ifndef OIIO_SIMD16_ALIGN
+#  define OIIO_SIMD16_ALIGN OIIO_SIMD_ALIGN
+#endif
+
 // General features that client apps may want to test for, for conditional
 // compilation. Will add to this over time as needed. Note that just
 // because a feature is present doesn't mean it's fast -- HAS_FLOAT8 means
@@ -171,6 +181,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // different from OIIO_SIMD >= 8, which means it's supported in hardware.
 #define OIIO_SIMD_HAS_MATRIX4 1  /* matrix44 defined */
 #define OIIO_SIMD_HAS_FLOAT8 1   /* float8, int8, bool8 defined */
+#define OIIO_SIMD_HAS_FLOAT16 1  /* float16, int16, bool16 defined */
 
 
 
@@ -191,6 +202,9 @@ typedef bool4 mask4;    // old name
 class bool8;
 class int8;
 class float8;
+class bool16;
+class int16;
+class float16;
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -215,13 +229,15 @@ template<> struct simd_bool_t<8> { typedef __m256 type; };
 #if OIIO_SIMD_AVX >= 512
 template<> struct simd_raw_t<int,16> { typedef __m512i type; };
 template<> struct simd_raw_t<float,16> { typedef __m512 type; };
-template<> struct simd_bool_t<16> { typedef __m512 type; };
+template<> struct simd_bool_t<16> { typedef __mmask16 type; };
+#else
+template<> struct simd_bool_t<16> { typedef uint16_t type; };
 #endif
 
 #if OIIO_SIMD_NEON
-template<> struct simd_raw_t<int,4> { typedef int32x4 type; };
+template<> struct simd_raw_t<int,4> { typedef int32x4_t type; };
 template<> struct simd_raw_t<float,4> { typedef float32x4_t type; };
-template<> struct simd_bool_t<4> { typedef int32x4 type; };
+template<> struct simd_bool_t<4> { typedef uint32x4_t type; };
 #endif
 
 
@@ -236,6 +252,9 @@ template<> struct VecType<bool,4>  { typedef bool4 type; };
 template<> struct VecType<int,8>   { typedef int8 type; };
 template<> struct VecType<float,8> { typedef float8 type; };
 template<> struct VecType<bool,8>  { typedef bool8 type; };
+template<> struct VecType<int,16>   { typedef int16 type; };
+template<> struct VecType<float,16> { typedef float16 type; };
+template<> struct VecType<bool,16>  { typedef bool16 type; };
 
 /// Template to retrieve the SIMD size of a SIMD type. Rigged to be 1 for
 /// anything but our SIMD types.
@@ -247,6 +266,9 @@ template<> struct SimdSize<bool4>    { static const int size = 4; };
 template<> struct SimdSize<int8>     { static const int size = 8; };
 template<> struct SimdSize<float8>   { static const int size = 8; };
 template<> struct SimdSize<bool8>    { static const int size = 8; };
+template<> struct SimdSize<int16>    { static const int size = 16; };
+template<> struct SimdSize<float16>  { static const int size = 16; };
+template<> struct SimdSize<bool16>   { static const int size = 16; };
 
 /// Template to retrieve the number of elements size of a SIMD type. Rigged
 /// to be 1 for anything but our SIMD types.
@@ -261,6 +283,9 @@ template<> struct SimdTypeName<bool4>    { static const char *name() { return "b
 template<> struct SimdTypeName<float8>   { static const char *name() { return "float8"; } };
 template<> struct SimdTypeName<int8>     { static const char *name() { return "int8"; } };
 template<> struct SimdTypeName<bool8>    { static const char *name() { return "bool8"; } };
+template<> struct SimdTypeName<float16>  { static const char *name() { return "float16"; } };
+template<> struct SimdTypeName<int16>    { static const char *name() { return "int16"; } };
+template<> struct SimdTypeName<bool16>   { static const char *name() { return "bool16"; } };
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -1936,1680 +1961,3854 @@ float8 nmsub (const float8& a, const float8& b, const float8& c); // -a*b - c
 
 
 
+/// bool16: An 16-vector whose elements act mostly like bools, accelerated
+/// by SIMD instructions when available. This is what is naturally produced
+/// by SIMD comparison operators on the float16 and int16 types.  Unlike
+/// the narrower bool types, it is stored as a bit mask (one bit per
+/// element), which is what AVX-512 comparisons produce natively.
+class bool16 {
+public:
+    static const char* type_name() { return "bool16"; }
+    typedef bool value_t;        ///< Underlying equivalent scalar value type
+    enum { elements = 16 };      ///< Number of scalar elements
+    enum { paddedelements = 16 }; ///< Number of scalar elements for full pad
+    enum { bits = 16 };          ///< Total number of bits
+    typedef simd_bool_t<16>::type simd_t;  ///< the native SIMD type used
 
+    /// Default constructor (contents undefined)
+    bool16 () { }
 
+    /// Destructor
+    ~bool16 () { }
 
-//////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////
-//
-// Gory implementation details follow.
-//
-// ^^^ All declarations and documention is above ^^^
-//
-// vvv Below is the implementation, often considerably cluttered with
-//     #if's for each architeture, and unapologitic use of intrinsics and
-//     every manner of dirty trick we can think of to make things fast.
-//     Some of this isn't pretty. We won't recapitulate comments or
-//     documentation of what the functions are supposed to do, please
-//     consult the declarations above for that.
-//
-//     Here be dragons.
-//
-//////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////
+    /// Construct from a single value (store it in all slots)
+    bool16 (bool a) { load (a); }
 
+    explicit bool16 (const bool *values);
 
+    /// Construct from 16 values
+    bool16 (bool v0, bool v1, bool v2, bool v3, bool v4, bool v5,
+            bool v6, bool v7, bool v8, bool v9, bool v10, bool v11,
+            bool v12, bool v13, bool v14, bool v15);
 
-//////////////////////////////////////////////////////////////////////
-// bool4 implementation
+    /// Copy construct from another bool16
+    bool16 (const bool16 &other) { m_simd = other.m_simd; }
 
+    /// Construct from a SIMD int (is each element nonzero?)
+    bool16 (const int16 &i);
 
-OIIO_FORCEINLINE int bool4::operator[] (int i) const {
-    DASSERT(i >= 0 && i < elements);
-#if OIIO_SIMD_SSE
-    return ((_mm_movemask_ps(m_simd) >> i) & 1) ? -1 : 0;
-#else
-    return m_val[i];
-#endif
-}
+    /// Construct from two bool8's
+    bool16 (const bool8 &lo, const bool8 &hi);
 
-OIIO_FORCEINLINE int& bool4::operator[] (int i) {
-    DASSERT(i >= 0 && i < elements);
-    return m_val[i];
-}
+    /// Construct from a bit mask, bit i giving element i.
+    static bool16 from_bitmask (int bitmask);
 
+    /// Return the elements as a bit mask, bit i giving element i.
+    int bitmask () const { return m_simd; }
 
-OIIO_FORCEINLINE std::ostream& operator<< (std::ostream& cout, const bool4& a) {
-    cout << a[0];
-    for (int i = 1; i < a.elements; ++i)
-        cout << ' ' << a[i];
-    return cout;
-}
+    /// Return the raw SIMD type
+    operator simd_t () const { return m_simd; }
+    simd_t simd () const { return m_simd; }
 
+    /// Set all components to false
+    void clear ();
 
-OIIO_FORCEINLINE void bool4::load (bool a) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_castsi128_ps(_mm_set1_epi32(-int(a)));
-#else
-    int val = -int(a);
-    SIMD_CONSTRUCT (val);
-#endif
-}
+    /// Return a bool16 the is 'false' for all values
+    static const bool16 False ();
 
+    /// Return a bool16 the is 'true' for all values
+    static const bool16 True ();
 
-OIIO_FORCEINLINE void bool4::load (bool a, bool b, bool c, bool d) {
-#if OIIO_SIMD_SSE
-    // N.B. -- we need to reverse the order because of our convention
-    // of storing a,b,c,d in the same order in memory.
-    m_simd = _mm_castsi128_ps(_mm_set_epi32(-int(d), -int(c), -int(b), -int(a)));
-#else
-    m_val[0] = -int(a);
-    m_val[1] = -int(b);
-    m_val[2] = -int(c);
-    m_val[3] = -int(d);
-#endif
-}
+    /// Assign one value to all components
+    const bool16 & operator= (bool a);
 
-OIIO_FORCEINLINE bool4::bool4 (bool *a) {
-    load (a[0], a[1], a[2], a[3]);
-}
+    /// Assignment of another bool16
+    const bool16 & operator= (const bool16 & other);
 
-OIIO_FORCEINLINE const bool4& bool4::operator= (const bool4 & other) {
-    m_simd = other.m_simd;
-    return *this;
-}
+    /// Component access (get)
+    int operator[] (int i) const;
 
+    /// Component access (set). Since the values are bits, there is no
+    /// operator[] returning a reference.
+    void setcomp (int i, bool value);
 
+    /// Extract the lower 8 elements as a bool8
+    bool8 lo () const;
 
-OIIO_FORCEINLINE void bool4::clear () {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_setzero_ps();
-#else
-    *this = false;
-#endif
-}
+    /// Extract the higher 8 elements as a bool8
+    bool8 hi () const;
 
+    /// Helper: load a single value into all components.
+    void load (bool a);
 
-OIIO_FORCEINLINE const bool4 bool4::False () {
-#if OIIO_SIMD_SSE
-    return _mm_setzero_ps();
-#else
-    return false;
-#endif
-}
+    /// Helper: load separate values into each component.
+    void load (bool v0, bool v1, bool v2, bool v3, bool v4, bool v5,
+               bool v6, bool v7, bool v8, bool v9, bool v10, bool v11,
+               bool v12, bool v13, bool v14, bool v15);
 
-OIIO_FORCEINLINE const bool4 bool4::True () {
-    // Fastest way to fill with all 1 bits is to cmp any value to itself.
-#if OIIO_SIMD_SSE
-# if OIIO_SIMD_AVX && (OIIO_GNUC_VERSION > 50000)
-    __m128i anyval = _mm_undefined_si128();
-# else
-    __m128i anyval = _mm_setzero_si128();
-# endif
-    return _mm_castsi128_ps (_mm_cmpeq_epi8 (anyval, anyval));
-#else
-    return true;
-#endif
-}
+    /// Helper: store the values into memory as bools.
+    void store (bool *values) const;
 
-OIIO_FORCEINLINE void bool4::store (bool *values) const {
-    SIMD_DO (values[i] = m_val[i] ? true : false);
-}
+    /// Store the first n values into memory.
+    void store (bool *values, int n) const;
 
-OIIO_FORCEINLINE void bool4::store (bool *values, int n) const {
-    DASSERT (n >= 0 && n <= elements);
-    for (int i = 0; i < n; ++i)
-        values[i] = m_val[i] ? true : false;
-}
+    /// Logical/bitwise operators, component-by-component
+    friend bool16 operator! (const bool16& a);
+    friend bool16 operator& (const bool16& a, const bool16& b);
+    friend bool16 operator| (const bool16& a, const bool16& b);
+    friend bool16 operator^ (const bool16& a, const bool16& b);
+    friend bool16 operator~ (const bool16& a);
+    friend const bool16& operator&= (bool16& a, const bool16& b);
+    friend const bool16& operator|= (bool16& a, const bool16& b);
+    friend const bool16& operator^= (bool16& a, const bool16& b);
 
+    /// Comparison operators, component by component
+    friend bool16 operator== (const bool16& a, const bool16& b);
+    friend bool16 operator!= (const bool16& a, const bool16& b);
 
+    /// Stream output
+    friend std::ostream& operator<< (std::ostream& cout, const bool16 & a);
 
-OIIO_FORCEINLINE bool4 operator! (const bool4 & a) {
-#if OIIO_SIMD_SSE
-    return _mm_xor_ps (a.simd(), bool4::True());
-#else
-    SIMD_RETURN (bool4, a[i] ^ (-1));
-#endif
-}
+private:
+    // The actual data representation
+    simd_t m_simd;
+};
 
-OIIO_FORCEINLINE bool4 operator& (const bool4 & a, const bool4 & b) {
-#if OIIO_SIMD_SSE
-    return _mm_and_ps (a.simd(), b.simd());
-#else
-    SIMD_RETURN (bool4, a[i] & b[i]);
-#endif
-}
 
-OIIO_FORCEINLINE bool4 operator| (const bool4 & a, const bool4 & b) {
-#if OIIO_SIMD_SSE
-    return _mm_or_ps (a.simd(), b.simd());
-#else
-    SIMD_RETURN (bool4, a[i] | b[i]);
-#endif
-}
 
-OIIO_FORCEINLINE bool4 operator^ (const bool4& a, const bool4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_xor_ps (a.simd(), b.simd());
-#else
-    SIMD_RETURN (bool4, a[i] ^ b[i]);
-#endif
-}
+/// Helper: as rapid as possible extraction of one component, when the
+/// index is fixed.
+template<int i> bool extract (const bool16& a);
 
+/// Helper: substitute val for a[i]
+template<int i> bool16 insert (const bool16& a, bool val);
 
-OIIO_FORCEINLINE const bool4& operator&= (bool4& a, const bool4 &b) {
-    return a = a & b;
-}
+/// Logical reduction across all components.
+bool reduce_and (const bool16& v);
+bool reduce_or (const bool16& v);
 
-OIIO_FORCEINLINE const bool4& operator|= (bool4& a, const bool4& b) {
-    return a = a | b;
-}
+// Are all/any/no components true?
+bool all (const bool16& v);
+bool any (const bool16& v);
+bool none (const bool16& v);
 
-OIIO_FORCEINLINE const bool4& operator^= (bool4& a, const bool4& b) {
-    return a = a ^ b;
-}
 
-OIIO_FORCEINLINE bool4 operator~ (const bool4& a) {
-#if OIIO_SIMD_SSE
-    // Fastest way to bit-complement in SSE is to xor with 0xffffffff.
-    return _mm_xor_ps (a.simd(), bool4::True());
-#else
-    SIMD_RETURN (bool4, ~a[i]);
-#endif
-}
 
-OIIO_FORCEINLINE bool4 operator== (const bool4 & a, const bool4 & b) {
-#if OIIO_SIMD_SSE
-    return _mm_castsi128_ps (_mm_cmpeq_epi32 (_mm_castps_si128 (a), _mm_castps_si128(b)));
-#else
-    SIMD_RETURN (bool4, a[i] == b[i] ? -1 : 0);
-#endif
-}
 
-OIIO_FORCEINLINE bool4 operator!= (const bool4 & a, const bool4 & b) {
-#if OIIO_SIMD_SSE
-    return _mm_xor_ps (a, b);
-#else
-    SIMD_RETURN (bool4, a[i] != b[i] ? -1 : 0);
-#endif
-}
 
+/// Integer 16-vector, accelerated by SIMD instructions when available.
+class int16 {
+public:
+    static const char* type_name() { return "int16"; }
+    typedef int value_t;      ///< Underlying equivalent scalar value type
+    enum { elements = 16 };   ///< Number of scalar elements
+    enum { paddedelements = 16 }; ///< Number of scalar elements for full pad
+    enum { bits = 512 };      ///< Total number of bits
+    typedef simd_raw_t<int,elements>::type simd_t;  ///< the native SIMD type used
+    typedef bool16 bool_t; ///< bool type of the same length
+    typedef float16 float_t; ///< float type of the same length
 
+    /// Default constructor (contents undefined)
+    int16 () { }
 
+    /// Destructor
+    ~int16 () { }
 
-#if OIIO_SIMD_SSE
-// Shuffling. Use like this:  x = shuffle<3,2,1,0>(b)
-template<int i0, int i1, int i2, int i3>
-OIIO_FORCEINLINE __m128i shuffle_sse (__m128i v) {
-    return _mm_shuffle_epi32(v, _MM_SHUFFLE(i3, i2, i1, i0));
-}
-#endif
+    /// Construct from a single value (store it in all slots)
+    int16 (int a);
 
-#if OIIO_SIMD_SSE >= 3
-// SSE3 has intrinsics for a few special cases
-template<> OIIO_FORCEINLINE __m128i shuffle_sse<0, 0, 2, 2> (__m128i a) {
-    return _mm_castps_si128(_mm_moveldup_ps(_mm_castsi128_ps(a)));
-}
-template<> OIIO_FORCEINLINE __m128i shuffle_sse<1, 1, 3, 3> (__m128i a) {
-    return _mm_castps_si128(_mm_movehdup_ps(_mm_castsi128_ps(a)));
-}
-template<> OIIO_FORCEINLINE __m128i shuffle_sse<0, 1, 0, 1> (__m128i a) {
-    return _mm_castpd_si128(_mm_movedup_pd(_mm_castsi128_pd(a)));
-}
-#endif
+    /// Construct from 16 values
+    int16 (int v0, int v1, int v2, int v3, int v4, int v5, int v6, int v7,
+           int v8, int v9, int v10, int v11, int v12, int v13, int v14, int v15);
 
-#if OIIO_SIMD_SSE
-template<int i0, int i1, int i2, int i3>
-OIIO_FORCEINLINE __m128 shuffle_sse (__m128 a) {
-    return _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(a), _MM_SHUFFLE(i3, i2, i1, i0)));
-}
-#endif
+    /// Construct from a pointer to values
+    int16 (const int *vals);
 
-#if OIIO_SIMD_SSE >= 3
-// SSE3 has intrinsics for a few special cases
-template<> OIIO_FORCEINLINE __m128 shuffle_sse<0, 0, 2, 2> (__m128 a) {
-    return _mm_moveldup_ps(a);
-}
-template<> OIIO_FORCEINLINE __m128 shuffle_sse<1, 1, 3, 3> (__m128 a) {
-    return _mm_movehdup_ps(a);
-}
-template<> OIIO_FORCEINLINE __m128 shuffle_sse<0, 1, 0, 1> (__m128 a) {
-    return _mm_castpd_ps(_mm_movedup_pd(_mm_castps_pd(a)));
-}
-#endif
+    /// Construct from a pointer to unsigned short values
+    explicit int16 (const unsigned short *vals);
 
+    /// Construct from a pointer to signed short values
+    explicit int16 (const short *vals);
 
-/// Helper: shuffle/swizzle with constant (templated) indices.
-/// Example: shuffle<1,1,2,2>(bool4(a,b,c,d)) returns (b,b,c,c)
-template<int i0, int i1, int i2, int i3>
-OIIO_FORCEINLINE bool4 shuffle (const bool4& a) {
-#if OIIO_SIMD_SSE
-    return shuffle_sse<i0,i1,i2,i3> (a.simd());
-#else
-    return bool4 (a[i0], a[i1], a[i2], a[i3]);
-#endif
-}
+    /// Construct from a pointer to unsigned char values (0 - 255)
+    explicit int16 (const unsigned char *vals);
 
-/// shuffle<i>(a) is the same as shuffle<i,i,i,i>(a)
-template<int i> OIIO_FORCEINLINE bool4 shuffle (const bool4& a) {
-    return shuffle<i,i,i,i>(a);
-}
+    /// Construct from a pointer to signed char values (-128 - 127)
+    explicit int16 (const char *vals);
 
+    /// Copy construct from another int16
+    int16 (const int16 & other) { m_simd = other.m_simd; }
 
-/// Helper: as rapid as possible extraction of one component, when the
-/// index is fixed.
-template<int i>
-OIIO_FORCEINLINE bool extract (const bool4& a) {
-#if OIIO_SIMD_SSE >= 4
-    return _mm_extract_epi32(_mm_castps_si128(a.simd()), i);  // SSE4.1 only
-#else
-    return a[i];
-#endif
-}
+    /// Convert a float16 to an int16. Equivalent to i = (int)f;
+    explicit int16 (const float16& f); // implementation below
 
-/// Helper: substitute val for a[i]
-template<int i>
-OIIO_FORCEINLINE bool4 insert (const bool4& a, bool val) {
-#if OIIO_SIMD_SSE >= 4
-    int ival = -int(val);
-    return _mm_castsi128_ps (_mm_insert_epi32 (_mm_castps_si128(a), ival, i));
-#else
-    bool4 tmp = a;
-    tmp[i] = -int(val);
-    return tmp;
-#endif
-}
+    /// Construct from two int8's
+    int16 (const int8 &lo, const int8 &hi);
 
-OIIO_FORCEINLINE bool reduce_and (const bool4& v) {
-#if OIIO_SIMD_AVX
-    return _mm_testc_ps (v, bool4(true)) != 0;
-#elif OIIO_SIMD_SSE
-    return _mm_movemask_ps(v.simd()) == 0xf;
-#else
-    SIMD_RETURN_REDUCE (bool, true, r &= v[i]);
-#endif
-}
+    /// Construct from the underlying SIMD type
+    int16 (const simd_t& m) : m_simd(m) { }
 
-OIIO_FORCEINLINE bool reduce_or (const bool4& v) {
-#if OIIO_SIMD_AVX
-    return ! _mm_testz_ps (v, v);
-#elif OIIO_SIMD_SSE
-    return _mm_movemask_ps(v) != 0;
-#else
-    SIMD_RETURN_REDUCE (bool, false, r |= v[i]);
-#endif
-}
+    /// Return the raw SIMD type
+    operator simd_t () const { return m_simd; }
+    simd_t simd () const { return m_simd; }
 
-OIIO_FORCEINLINE bool all (const bool4& v) { return reduce_and(v) == true; }
-OIIO_FORCEINLINE bool any (const bool4& v) { return reduce_or(v) == true; }
-OIIO_FORCEINLINE bool none (const bool4& v) { return reduce_or(v) == false; }
+    /// Sset all components to 0
+    void clear () ;
 
+    /// Return an int16 with all components set to 0
+    static const int16 Zero ();
 
+    /// Return an int16 with all components set to 1
+    static const int16 One ();
 
-//////////////////////////////////////////////////////////////////////
-// bool8 implementation
+    /// Return an int16 with all components set to -1 (aka 0xffffffff)
+    static const int16 NegOne ();
 
+    /// Return an int16 with incremented components (e.g., 0,1,2,3).
+    /// Optional argument can give a non-zero starting point.
+    static const int16 Iota (int start=0, int step=1);
 
-OIIO_FORCEINLINE int bool8::operator[] (int i) const {
-    DASSERT(i >= 0 && i < elements);
-#if OIIO_SIMD_AVX
-    return ((_mm256_movemask_ps(m_simd) >> i) & 1) ? -1 : 0;
-#else
-    return m_val[i];
-#endif
-}
+    /// Assign one value to all components.
+    const int16 & operator= (int a);
 
-OIIO_FORCEINLINE int& bool8::operator[] (int i) {
-    DASSERT(i >= 0 && i < elements);
-    return m_val[i];
-}
+    /// Assignment from another int16
+    const int16 & operator= (int16 other) ;
 
+    /// Component access (set)
+    int& operator[] (int i) ;
 
-OIIO_FORCEINLINE std::ostream& operator<< (std::ostream& cout, const bool8& a) {
-    cout << a[0];
-    for (int i = 1; i < a.elements; ++i)
-        cout << ' ' << a[i];
-    return cout;
-}
+    /// Component access (get)
+    int operator[] (int i) const;
 
+    /// Extract the lower 8 elements as an int8
+    int8 lo () const;
 
-OIIO_FORCEINLINE void bool8::load (bool a) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_castsi256_ps(_mm256_set1_epi32(-int(a)));
-#else
-    int val = -int(a);
-    SIMD_CONSTRUCT (val);
-#endif
-}
+    /// Extract the higher 8 elements as an int8
+    int8 hi () const;
 
+    /// Helper: load a single int into all components
+    void load (int a);
 
-OIIO_FORCEINLINE void bool8::load (bool a, bool b, bool c, bool d,
-                                   bool e, bool f, bool g, bool h) {
-#if OIIO_SIMD_AVX
-    // N.B. -- we need to reverse the order because of our convention
-    // of storing a,b,c,d in the same order in memory.
-    m_simd = _mm256_castsi256_ps(_mm256_set_epi32(-int(h), -int(g), -int(f), -int(e),
-                                                  -int(d), -int(c), -int(b), -int(a)));
-#else
-    m_val[0] = -int(a);
-    m_val[1] = -int(b);
-    m_val[2] = -int(c);
-    m_val[3] = -int(d);
-    m_val[4] = -int(e);
-    m_val[5] = -int(f);
-    m_val[6] = -int(g);
-    m_val[7] = -int(h);
-#endif
-}
+    /// Load separate values into each component.
+    void load (int v0, int v1, int v2, int v3, int v4, int v5, int v6, int v7,
+               int v8, int v9, int v10, int v11, int v12, int v13, int v14, int v15);
 
-OIIO_FORCEINLINE bool8::bool8 (bool a, bool b, bool c, bool d,
-                               bool e, bool f, bool g, bool h) {
-    load (a, b, c, d, e, f, g, h);
-}
+    /// Load from an array of 16 values
+    void load (const int *values);
 
-OIIO_FORCEINLINE bool8::bool8 (bool *a) {
-    load (a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
-}
+    /// Load from a partial array of <=16 values. Unassigned values are 0.
+    void load (const int *values, int n) ;
 
+    /// Load from an array of 16 unsigned short values, convert to int16
+    void load (const unsigned short *values) ;
 
-OIIO_FORCEINLINE const bool8& bool8::operator= (bool a) {
-    load(a);
-    return *this;
-}
+    /// Load from an array of 16 short values, convert to int16
+    void load (const short *values);
 
-OIIO_FORCEINLINE const bool8& bool8::operator= (const bool8 & other) {
-    m_simd = other.m_simd;
-    return *this;
-}
+    /// Load from an array of 16 unsigned char values, convert to int16
+    void load (const unsigned char *values);
 
-OIIO_FORCEINLINE void bool8::clear () {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_setzero_ps();
-#else
-    *this = false;
-#endif
-}
+    /// Load from an array of 16 char values, convert to int16
+    void load (const char *values);
 
-OIIO_FORCEINLINE const bool8 bool8::False () {
-#if OIIO_SIMD_AVX
-    return _mm256_setzero_ps();
-#else
-    return false;
-#endif
-}
+    /// Store the values into memory
+    void store (int *values) const;
 
+    /// Store the first n values into memory
+    void store (int *values, int n) const;
 
-OIIO_FORCEINLINE const bool8 bool8::True () {
-#if OIIO_SIMD_AVX
-# if OIIO_SIMD_AVX >= 2 && (OIIO_GNUC_VERSION > 50000)
-    // Fastest way to fill with all 1 bits is to cmp any value to itself.
-    __m256i anyval = _mm256_undefined_si256();
-    return _mm256_castsi256_ps (_mm256_cmpeq_epi8 (anyval, anyval));
-# else
-    return _mm256_castsi256_ps (_mm256_set1_epi32 (-1));
-# endif
-#else
-    return true;
-#endif
-}
+    /// Store the least significant 16 bits of each element into adjacent
+    /// unsigned shorts.
+    void store (unsigned short *values) const;
 
+    /// Store the least significant 8 bits of each element into adjacent
+    /// unsigned chars.
+    void store (unsigned char *values) const;
 
-OIIO_FORCEINLINE void bool8::store (bool *values) const {
-    SIMD_DO (values[i] = m_val[i] ? true : false);
-}
+    // Arithmetic operators (component-by-component)
+    friend int16 operator+ (const int16& a, const int16& b);
+    friend int16 operator- (const int16& a);
+    friend int16 operator- (const int16& a, const int16& b);
+    friend int16 operator* (const int16& a, const int16& b);
+    friend int16 operator/ (const int16& a, const int16& b);
+    friend int16 operator% (const int16& a, const int16& b);
+    friend const int16 & operator+= (int16& a, const int16& b);
+    friend const int16 & operator-= (int16& a, const int16& b);
+    friend const int16 & operator*= (int16& a, const int16& b);
+    friend const int16 & operator/= (int16& a, const int16& b);
+    friend const int16 & operator%= (int16& a, const int16& b);
+    // Bitwise operators (component-by-component)
+    friend int16 operator& (const int16& a, const int16& b);
+    friend int16 operator| (const int16& a, const int16& b);
+    friend int16 operator^ (const int16& a, const int16& b);
+    friend const int16& operator&= (int16& a, const int16& b);
+    friend const int16& operator|= (int16& a, const int16& b);
+    friend const int16& operator^= (int16& a, const int16& b);
+    friend int16 operator~ (const int16& a);
+    friend int16 operator<< (const int16& a, unsigned int bits);
+    friend int16 operator>> (const int16& a, unsigned int bits);
+    friend const int16& operator<<= (int16& a, unsigned int bits);
+    friend const int16& operator>>= (int16& a, unsigned int bits);
+    // Comparison operators (component-by-component)
+    friend bool16 operator== (const int16& a, const int16& b);
+    friend bool16 operator!= (const int16& a, const int16& b);
+    friend bool16 operator<  (const int16& a, const int16& b);
+    friend bool16 operator>  (const int16& a, const int16& b);
+    friend bool16 operator>= (const int16& a, const int16& b);
+    friend bool16 operator<= (const int16& a, const int16& b);
 
-OIIO_FORCEINLINE void bool8::store (bool *values, int n) const {
-    DASSERT (n >= 0 && n <= elements);
-    for (int i = 0; i < n; ++i)
-        values[i] = m_val[i] ? true : false;
-}
+    /// Stream output
+    friend std::ostream& operator<< (std::ostream& cout, const int16& a);
 
+private:
+    // The actual data representation
+    union {
+        simd_t  m_simd;
+        value_t m_val[elements];
+        simd_raw_t<int,8>::type m_8[2];
+    };
+};
 
-OIIO_FORCEINLINE bool4 bool8::lo () const {
-#if OIIO_SIMD_AVX
-    return _mm256_castps256_ps128 (simd());
-#else
-    return m_4[0];
-#endif
-}
 
-OIIO_FORCEINLINE bool4 bool8::hi () const {
-#if OIIO_SIMD_AVX
-    return _mm256_extractf128_ps (simd(), 1);
-#else
-    return m_4[1];
-#endif
-}
 
+// Shift right logical -- unsigned shift. This differs from operator>>
+// in how it handles the sign bit.  (1<<31) >> 1 == (1<<31), but
+// srl((1<<31),1) == 1<<30.
+int16 srl (const int16& val, const unsigned int bits);
 
-OIIO_FORCEINLINE bool8::bool8 (const bool4& lo, const bool4 &hi) {
-#if OIIO_SIMD_AVX
-    __m256 r = _mm256_castps128_ps256 (lo);
-    m_simd = _mm256_insertf128_ps (r, hi, 1);
-    // N.B. equivalent, if available: m_simd = _mm256_set_m128 (hi, lo);
-#else
-    m_4[0] = lo;
-    m_4[1] = hi;
-#endif
-}
+/// Helper: as rapid as possible extraction of one component, when the
+/// index is fixed.
+template<int i> int extract (const int16& v);
 
+/// Helper: substitute val for a[i]
+template<int i> int16 insert (const int16& a, int val);
 
-OIIO_FORCEINLINE bool8 operator! (const bool8 & a) {
-#if OIIO_SIMD_AVX
-    return _mm256_xor_ps (a.simd(), bool8::True());
-#else
-    SIMD_RETURN (bool8, a[i] ^ (-1));
-#endif
-}
+/// The sum of all components, returned in all components.
+int16 vreduce_add (const int16& v);
 
-OIIO_FORCEINLINE bool8 operator& (const bool8 & a, const bool8 & b) {
-#if OIIO_SIMD_AVX
-    return _mm256_and_ps (a.simd(), b.simd());
-#else
-    SIMD_RETURN (bool8, a[i] & b[i]);
-#endif
-}
+// Reduction across all components
+int reduce_add (const int16& v);
+int reduce_and (const int16& v);
+int reduce_or (const int16& v);
 
-OIIO_FORCEINLINE bool8 operator| (const bool8 & a, const bool8 & b) {
-#if OIIO_SIMD_AVX
-    return _mm256_or_ps (a.simd(), b.simd());
-#else
-    SIMD_RETURN (bool8, a[i] | b[i]);
-#endif
-}
+/// Use a bool mask to select between components of a (if mask[i] is false)
+/// and b (if mask[i] is true).
+int16 blend (const int16& a, const int16& b, const bool16& mask);
 
-OIIO_FORCEINLINE bool8 operator^ (const bool8& a, const bool8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_xor_ps (a.simd(), b.simd());
-#else
-    SIMD_RETURN (bool8, a[i] ^ b[i]);
-#endif
-}
+/// Use a bool mask to select between components of a (if mask[i] is true)
+/// or 0 (if mask[i] is true).
+int16 blend0 (const int16& a, const bool16& mask);
 
+/// Use a bool mask to select between components of a (if mask[i] is FALSE)
+/// or 0 (if mask[i] is TRUE).
+int16 blend0not (const int16& a, const bool16& mask);
 
-OIIO_FORCEINLINE const bool8& operator&= (bool8& a, const bool8 &b) {
-    return a = a & b;
-}
+/// Select 'a' where mask is true, 'b' where mask is false. Sure, it's a
+/// synonym for blend with arguments rearranged, but this is more clear
+/// because the arguments are symmetric to scalar (cond ? a : b).
+int16 select (const bool16& mask, const int16& a, const int16& b);
 
-OIIO_FORCEINLINE const bool8& operator|= (bool8& a, const bool8& b) {
-    return a = a | b;
-}
+// Per-element math
+int16 abs (const int16& a);
+int16 min (const int16& a, const int16& b);
+int16 max (const int16& a, const int16& b);
 
-OIIO_FORCEINLINE const bool8& operator^= (bool8& a, const bool8& b) {
-    return a = a ^ b;
-}
+/// andnot(a,b) returns ((~a) & b)
+int16 andnot (const int16& a, const int16& b);
 
+/// Bitcast back and forth to intN (not a convert -- move the bits!)
+int16 bitcast_to_int (const bool16& x);
+int16 bitcast_to_int (const float16& x);
+float16 bitcast_to_float (const int16& x);
 
-OIIO_FORCEINLINE bool8 operator~ (const bool8& a) {
-#if OIIO_SIMD_AVX
-    // Fastest way to bit-complement in SSE is to xor with 0xffffffff.
-    return _mm256_xor_ps (a.simd(), bool8::True());
-#else
-    SIMD_RETURN (bool8, ~a[i]);
-#endif
-}
 
 
-OIIO_FORCEINLINE bool8 operator== (const bool8 & a, const bool8 & b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_castsi256_ps (_mm256_cmpeq_epi32 (_mm256_castps_si256 (a), _mm256_castps_si256(b)));
-#elif OIIO_SIMD_AVX
-    return _mm256_cmp_ps (a, b, _CMP_EQ_UQ);
-#else
-    SIMD_RETURN (bool8, a[i] == b[i] ? -1 : 0);
-#endif
-}
 
-OIIO_FORCEINLINE bool8 operator!= (const bool8 & a, const bool8 & b) {
-#if OIIO_SIMD_AVX
-    return _mm256_xor_ps (a, b);
-#else
-    SIMD_RETURN (bool8, a[i] != b[i] ? -1 : 0);
-#endif
-}
 
+/// Floating point 16-vector, accelerated by SIMD instructions when
+/// available.
+class float16 {
+public:
+    enum { elements = 16 };   ///< Number of scalar elements
+    enum { paddedelements = 16 }; ///< Number of scalar elements for full pad
+    enum { bits = elements*32 }; ///< Total number of bits
+    typedef float value_t;    ///< Underlying equivalent scalar value type
+    typedef simd_raw_t<float,16>::type simd_t;  ///< the native SIMD type used
+    typedef bool16 bool_t; ///< bool type of the same length
+    typedef int16 int_t;    ///< int type of the same length
+    static const char* type_name() { return "float16"; }
 
-template<int i0, int i1, int i2, int i3, int i4, int i5, int i6, int i7>
-OIIO_FORCEINLINE bool8 shuffle (const bool8& a) {
-#if OIIO_SIMD_AVX >= 2
-    int8 index (i0, i1, i2, i3, i4, i5, i6, i7);
-    return _mm256_permutevar8x32_ps (a.simd(), index.simd());
-#else
-    return bool8 (a[i0], a[i1], a[i2], a[i3], a[i4], a[i5], a[i6], a[i7]);
-#endif
-}
+    /// Default constructor (contents undefined)
+    float16 () { }
 
-template<int i> OIIO_FORCEINLINE bool8 shuffle (const bool8& a) {
-    return shuffle<i,i,i,i,i,i,i,i>(a);
-}
+    /// Destructor
+    ~float16 () { }
 
+    /// Construct from a single value (store it in all slots)
+    float16 (float a) { load(a); }
 
-template<int i>
-OIIO_FORCEINLINE bool extract (const bool8& a) {
-#if OIIO_SIMD_AVX && !_WIN32
-    return _mm256_extract_epi32(_mm256_castps_si256(a.simd()), i);  // SSE4.1 only
-#else
-    return a[i];
-#endif
-}
+    /// Construct from 16 values
+    float16 (float v0, float v1, float v2, float v3,
+             float v4, float v5, float v6, float v7,
+             float v8, float v9, float v10, float v11,
+             float v12, float v13, float v14, float v15);
 
-template<int i>
-OIIO_FORCEINLINE bool8 insert (const bool8& a, bool val) {
-#if OIIO_SIMD_AVX && !_WIN32
-    int ival = -int(val);
-    return _mm256_castsi256_ps (_mm256_insert_epi32 (_mm256_castps_si256(a.simd()), ival, i));
-#else
-    bool8 tmp = a;
-    tmp[i] = -int(val);
-    return tmp;
-#endif
-}
+    /// Construct from a pointer to 16 values
+    float16 (const float *f) { load (f); }
 
+    /// Copy construct from another float16
+    float16 (const float16 &other) { m_simd = other.m_simd; }
 
-OIIO_FORCEINLINE bool reduce_and (const bool8& v) {
-#if OIIO_SIMD_AVX
-    return _mm256_testc_ps (v, bool8(true)) != 0;
-    // return _mm256_movemask_ps(v.simd()) == 0xff;
-#else
-    SIMD_RETURN_REDUCE (bool, true, r &= bool(v[i]));
-#endif
-}
+    /// Construct from an int vector (promoting all components to float)
+    explicit float16 (const int16& ival);
 
-OIIO_FORCEINLINE bool reduce_or (const bool8& v) {
-#if OIIO_SIMD_AVX
-    return ! _mm256_testz_ps (v, v);   // FIXME? Not in all immintrin.h !
-    // return _mm256_movemask_ps(v) != 0;
-#else
-    SIMD_RETURN_REDUCE (bool, false, r |= bool(v[i]));
-#endif
-}
+    /// Construct from two float8's
+    float16 (const float8 &lo, const float8 &hi);
 
+    /// Construct from the underlying SIMD type
+    float16 (const simd_t& m) : m_simd(m) { }
 
-OIIO_FORCEINLINE bool all (const bool8& v) { return reduce_and(v) == true; }
-OIIO_FORCEINLINE bool any (const bool8& v) { return reduce_or(v) == true; }
-OIIO_FORCEINLINE bool none (const bool8& v) { return reduce_or(v) == false; }
+    /// Return the raw SIMD type
+    operator simd_t () const { return m_simd; }
+    simd_t simd () const { return m_simd; }
 
+    /// Construct from a pointer to unsigned short values
+    explicit float16 (const unsigned short *vals) { load(vals); }
 
+    /// Construct from a pointer to short values
+    explicit float16 (const short *vals) { load(vals); }
 
-//////////////////////////////////////////////////////////////////////
-// int4 implementation
+    /// Construct from a pointer to unsigned char values
+    explicit float16 (const unsigned char *vals) { load(vals); }
 
-OIIO_FORCEINLINE const int4 & int4::operator= (int4 other) {
-    m_simd = other.m_simd;
-    return *this;
-}
+    /// Construct from a pointer to char values
+    explicit float16 (const char *vals) { load(vals); }
 
-OIIO_FORCEINLINE int& int4::operator[] (int i) {
-    DASSERT(i<elements);
-    return m_val[i];
-}
+#ifdef _HALF_H_
+    /// Construct from a pointer to half (16 bit float) values
+    explicit float16 (const half *vals) { load(vals); }
+#endif
 
-OIIO_FORCEINLINE int int4::operator[] (int i) const {
-    DASSERT(i<elements);
-    return m_val[i];
-}
+    /// Assign a single value to all components
+    const float16& operator= (float a) { load(a); return *this; }
 
+    /// Assign a float16
+    const float16& operator= (float16 other) {
+        m_simd = other.m_simd;
+        return *this;
+    }
 
-OIIO_FORCEINLINE void int4::load (int a) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_set1_epi32 (a);
-#else
-    SIMD_CONSTRUCT (a);
-#endif
-}
+    /// Return a float16 with all components set to 0.0
+    static const float16 Zero ();
 
+    /// Return a float16 with all components set to 1.0
+    static const float16 One ();
 
+    /// Return a float16 with incremented components (e.g., 0,1,2,3,...)
+    /// Optional argument can give a non-zero starting point and non-1 step.
+    static const float16 Iota (float start=0.0f, float step=1.0f);
 
-OIIO_FORCEINLINE void int4::load (int a, int b, int c, int d) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_set_epi32 (d, c, b, a);
-#else
-    m_val[0] = a;
-    m_val[1] = b;
-    m_val[2] = c;
-    m_val[3] = d;
-#endif
-}
+    /// Set all components to 0.0
+    void clear ();
 
+    /// Component access (set)
+    float& operator[] (int i);
+    /// Component access (get)
+    float operator[] (int i) const;
 
-// OIIO_FORCEINLINE void int4::load (int a, int b, int c, int d,
-//                                   int e, int f, int g, int h) {
-//     load (a, b, c, d);
-// }
+    /// Extract the lower 8 elements as a float8
+    float8 lo () const;
 
+    /// Extract the higher 8 elements as a float8
+    float8 hi () const;
 
+    /// Helper: load a single value into all components
+    void load (float val);
 
-OIIO_FORCEINLINE void int4::load (const int *values) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_loadu_si128 ((const simd_t *)values);
-#else
-    SIMD_CONSTRUCT (values[i]);
-#endif
-}
+    /// Helper: load 16 values.
+    void load (float v0, float v1, float v2, float v3,
+               float v4, float v5, float v6, float v7,
+               float v8, float v9, float v10, float v11,
+               float v12, float v13, float v14, float v15);
 
+    /// Load from an array of values
+    void load (const float *values);
 
-OIIO_FORCEINLINE void int4::load (const int *values, int n)
-{
-#if OIIO_SIMD_SSE
-    switch (n) {
-    case 1:
-        m_simd = _mm_castps_si128 (_mm_load_ss ((const float *)values));
-        break;
-    case 2:
-        // Trickery: load one double worth of bits!
-        m_simd = _mm_castpd_si128 (_mm_load_sd ((const double*)values));
-        break;
-    case 3:
-        // Trickery: load one double worth of bits, then a float,
-        // and combine, casting to ints.
-        m_simd = _mm_castps_si128 (_mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)values)),
-                                                _mm_load_ss ((const float *)values + 2)));
-        break;
-    case 4:
-        m_simd = _mm_loadu_si128 ((const simd_t *)values);
-        break;
-    default:
-        break;
-    }
-#else
-    for (int i = 0; i < n; ++i)
-        m_val[i] = values[i];
-    for (int i = n; i < elements; ++i)
-        m_val[i] = 0;
-#endif
-}
+    /// Load from a partial array of <=16 values. Unassigned values are 0.
+    void load (const float *values, int n);
 
+    /// Load from an array of 16 unsigned short values, convert to float
+    void load (const unsigned short *values);
 
-OIIO_FORCEINLINE void int4::load (const unsigned short *values) {
-#if OIIO_SIMD_SSE >= 4
-    // Trickery: load one double worth of bits = 4 uint16's!
-    simd_t a = _mm_castpd_si128 (_mm_load_sd ((const double *)values));
-    m_simd = _mm_cvtepu16_epi32 (a);
-#else
-    SIMD_CONSTRUCT (values[i]);
-#endif
-}
+    /// Load from an array of 16 short values, convert to float
+    void load (const short *values);
 
+    /// Load from an array of 16 unsigned char values, convert to float
+    void load (const unsigned char *values);
 
-OIIO_FORCEINLINE void int4::load (const short *values) {
-#if OIIO_SIMD_SSE >= 4
-    // Trickery: load one double worth of bits = 4 int16's!
-    simd_t a = _mm_castpd_si128 (_mm_load_sd ((const double *)values));
-    m_simd = _mm_cvtepi16_epi32 (a);
-#else
-    SIMD_CONSTRUCT (values[i]);
-#endif
-}
+    /// Load from an array of 16 char values, convert to float
+    void load (const char *values);
 
+#ifdef _HALF_H_
+    /// Load from an array of 16 half values, convert to float
+    void load (const half *values);
+#endif /* _HALF_H_ */
 
-OIIO_FORCEINLINE void int4::load (const unsigned char *values) {
-#if OIIO_SIMD_SSE >= 4
-    // Trickery: load one float worth of bits = 4 uint8's!
-    simd_t a = _mm_castps_si128 (_mm_load_ss ((const float *)values));
-    m_simd = _mm_cvtepu8_epi32 (a);
-#else
-    SIMD_CONSTRUCT (values[i]);
-#endif
-}
+    void store (float *values) const;
 
+    /// Store the first n values into memory
+    void store (float *values, int n) const;
 
-OIIO_FORCEINLINE void int4::load (const char *values) {
-#if OIIO_SIMD_SSE >= 4
-    // Trickery: load one float worth of bits = 4 uint8's!
-    simd_t a = _mm_castps_si128 (_mm_load_ss ((const float *)values));
-    m_simd = _mm_cvtepi8_epi32 (a);
-#else
-    SIMD_CONSTRUCT (values[i]);
+#ifdef _HALF_H_
+    void store (half *values) const;
 #endif
-}
 
+    // Arithmetic operators
+    friend float16 operator+ (const float16& a, const float16& b);
+    const float16 & operator+= (const float16& a);
+    float16 operator- () const;
+    friend float16 operator- (const float16& a, const float16& b);
+    const float16 & operator-= (const float16& a);
+    friend float16 operator* (const float16& a, const float16& b);
+    const float16 & operator*= (const float16& a);
+    const float16 & operator*= (float val);
+    friend float16 operator/ (const float16& a, const float16& b);
+    const float16 & operator/= (const float16& a);
+    const float16 & operator/= (float val);
 
-OIIO_FORCEINLINE int4::int4 (int a) { load(a); }
+    // Comparison operations
+    friend bool16 operator== (const float16& a, const float16& b);
+    friend bool16 operator!= (const float16& a, const float16& b);
+    friend bool16 operator<  (const float16& a, const float16& b);
+    friend bool16 operator>  (const float16& a, const float16& b);
+    friend bool16 operator>= (const float16& a, const float16& b);
+    friend bool16 operator<= (const float16& a, const float16& b);
 
-OIIO_FORCEINLINE int4::int4 (int a, int b) { load(a,a,b,b); }
+    /// Stream output
+    friend inline std::ostream& operator<< (std::ostream& cout, const float16& val);
 
-OIIO_FORCEINLINE int4::int4 (int a, int b, int c, int d) { load(a,b,c,d); }
+protected:
+    // The actual data representation
+    union {
+        simd_t  m_simd;
+        value_t m_val[paddedelements];
+        simd_raw_t<float,8>::type m_8[2];
+    };
+};
 
-// OIIO_FORCEINLINE int4::int4 (int a, int b, int c, int d,
-//                              int e, int f, int g, int h) {
-//     load(a,b,c,d,e,f,g,h);
-// }
 
-OIIO_FORCEINLINE int4::int4 (const int *vals) { load (vals); }
-OIIO_FORCEINLINE int4::int4 (const unsigned short *vals) { load(vals); }
-OIIO_FORCEINLINE int4::int4 (const short *vals) { load(vals); }
-OIIO_FORCEINLINE int4::int4 (const unsigned char *vals) { load(vals); }
-OIIO_FORCEINLINE int4::int4 (const char *vals) { load(vals); }
 
-OIIO_FORCEINLINE const int4 & int4::operator= (int a) { load(a); return *this; }
+/// Helper: as rapid as possible extraction of one component, when the
+/// index is fixed.
+template<int i> float extract (const float16& a);
 
+/// Helper: substitute val for a[i]
+template<int i> float16 insert (const float16& a, float val);
 
-OIIO_FORCEINLINE void int4::store (int *values) const {
-#if OIIO_SIMD_SSE
-    // Use an unaligned store -- it's just as fast when the memory turns
-    // out to be aligned, nearly as fast even when unaligned. Not worth
-    // the headache of using stores that require alignment.
-    _mm_storeu_si128 ((simd_t *)values, m_simd);
-#else
-    SIMD_DO (values[i] = m_val[i]);
-#endif
-}
+/// The sum of all components, returned in all components.
+float16 vreduce_add (const float16& v);
 
+/// The sum of all components, returned as a scalar.
+float reduce_add (const float16& v);
 
-OIIO_FORCEINLINE void int4::clear () {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_setzero_si128();
-#else
-    *this = 0;
-#endif
-}
+/// Use a bool mask to select between components of a (if mask[i] is false)
+/// and b (if mask[i] is true).
+float16 blend (const float16& a, const float16& b, const bool16& mask);
 
+/// Use a bool mask to select between components of a (if mask[i] is true)
+/// or 0 (if mask[i] is true).
+float16 blend0 (const float16& a, const bool16& mask);
 
+/// Use a bool mask to select between components of a (if mask[i] is FALSE)
+/// or 0 (if mask[i] is TRUE).
+float16 blend0not (const float16& a, const bool16& mask);
 
-OIIO_FORCEINLINE const int4 int4::Zero () {
-#if OIIO_SIMD_SSE
-    return _mm_setzero_si128();
-#else
-    return 0;
-#endif
-}
+/// "Safe" divide of float16/float16 -- for any component of the divisor
+/// that is 0, return 0 rather than Inf.
+float16 safe_div (const float16 &a, const float16 &b);
 
+/// Select 'a' where mask is true, 'b' where mask is false. Sure, it's a
+/// synonym for blend with arguments rearranged, but this is more clear
+/// because the arguments are symmetric to scalar (cond ? a : b).
+float16 select (const bool16& mask, const float16& a, const float16& b);
 
-OIIO_FORCEINLINE const int4 int4::One () { return int4(1); }
+// Per-element math
+float16 abs (const float16& a);    ///< absolute value (float)
+float16 sign (const float16& a);   ///< 1.0 when value >= 0, -1 when negative
+float16 ceil (const float16& a);
+float16 floor (const float16& a);
+int16 floori (const float16& a);    ///< (int)floor
 
-OIIO_FORCEINLINE const int4 int4::NegOne () {
-#if OIIO_SIMD_SSE
-    // Fastest way to fill an __m128 with all 1 bits is to cmpeq_epi8
-    // any value to itself.
-# if OIIO_SIMD_AVX && (OIIO_GNUC_VERSION > 50000)
-    __m128i anyval = _mm_undefined_si128();
-# else
-    __m128i anyval = _mm_setzero_si128();
-# endif
-    return _mm_cmpeq_epi8 (anyval, anyval);
-#else
-    return int4(-1);
-#endif
-}
+/// Per-element round to nearest integer.
+float16 round (const float16& a);
 
+/// Per-element round to nearest integer.
+int16 rint (const float16& a);
 
+float16 sqrt (const float16 &a);
+float16 rsqrt (const float16 &a);   ///< Fully accurate 1/sqrt
+float16 rsqrt_fast (const float16 &a);  ///< Fast, approximate 1/sqrt
+float16 min (const float16& a, const float16& b); ///< Per-element min
+float16 max (const float16& a, const float16& b); ///< Per-element max
 
-OIIO_FORCEINLINE const int4 int4::Iota (int start, int step) {
-    return int4 (start+0*step, start+1*step, start+2*step, start+3*step);
-}
+/// andnot(a,b) returns ((~a) & b)
+float16 andnot (const float16& a, const float16& b);
 
+// Fused multiply and add (or subtract):
+float16 madd (const float16& a, const float16& b, const float16& c); // a*b + c
+float16 msub (const float16& a, const float16& b, const float16& c); // a*b - c
+float16 nmadd (const float16& a, const float16& b, const float16& c); // -a*b + c
+float16 nmsub (const float16& a, const float16& b, const float16& c); // -a*b - c
 
-OIIO_FORCEINLINE int4 operator+ (const int4& a, const int4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_add_epi32 (a.simd(), b.simd());
-#else
-    SIMD_RETURN (int4, a[i] + b[i]);
-#endif
-}
 
-OIIO_FORCEINLINE const int4& operator+= (int4& a, const int4& b) {
-    return a = a + b;
-}
 
 
-OIIO_FORCEINLINE int4 operator- (const int4& a) {
-#if OIIO_SIMD_SSE
-    return _mm_sub_epi32 (_mm_setzero_si128(), a);
-#else
-    SIMD_RETURN (int4, -a[i]);
-#endif
-}
 
 
-OIIO_FORCEINLINE int4 operator- (const int4& a, const int4& b) {
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+//
+// Gory implementation details follow.
+//
+// ^^^ All declarations and documention is above ^^^
+//
+// vvv Below is the implementation, often considerably cluttered with
+//     #if's for each architeture, and unapologitic use of intrinsics and
+//     every manner of dirty trick we can think of to make things fast.
+//     Some of this isn't pretty. We won't recapitulate comments or
+//     documentation of what the functions are supposed to do, please
+//     consult the declarations above for that.
+//
+//     Here be dragons.
+//
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+
+
+//////////////////////////////////////////////////////////////////////
+// bool4 implementation
+
+
+OIIO_FORCEINLINE int bool4::operator[] (int i) const {
+    DASSERT(i >= 0 && i < elements);
 #if OIIO_SIMD_SSE
-    return _mm_sub_epi32 (a.simd(), b.simd());
+    return ((_mm_movemask_ps(m_simd) >> i) & 1) ? -1 : 0;
 #else
-    SIMD_RETURN (int4, a[i] - b[i]);
+    return m_val[i];
 #endif
 }
 
+OIIO_FORCEINLINE int& bool4::operator[] (int i) {
+    DASSERT(i >= 0 && i < elements);
+    return m_val[i];
+}
+
 
-OIIO_FORCEINLINE const int4 &operator-= (int4& a, const int4& b) {
-    return a = a - b;
+OIIO_FORCEINLINE std::ostream& operator<< (std::ostream& cout, const bool4& a) {
+    cout << a[0];
+    for (int i = 1; i < a.elements; ++i)
+        cout << ' ' << a[i];
+    return cout;
 }
 
 
+OIIO_FORCEINLINE void bool4::load (bool a) {
 #if OIIO_SIMD_SSE
-// Shamelessly lifted from Syrah which lifted from Manta which lifted it
-// from intel.com
-OIIO_FORCEINLINE __m128i mul_epi32 (__m128i a, __m128i b) {
-#if OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
-    return _mm_mullo_epi32(a, b);
+    m_simd = _mm_castsi128_ps(_mm_set1_epi32(-int(a)));
 #else
-    // Prior to SSE 4.1, there is no _mm_mullo_epi32 instruction, so we have
-    // to fake it.
-    __m128i t0;
-    __m128i t1;
-    t0 = _mm_mul_epu32 (a, b);
-    t1 = _mm_mul_epu32 (_mm_shuffle_epi32 (a, 0xB1),
-                        _mm_shuffle_epi32 (b, 0xB1));
-    t0 = _mm_shuffle_epi32 (t0, 0xD8);
-    t1 = _mm_shuffle_epi32 (t1, 0xD8);
-    return _mm_unpacklo_epi32 (t0, t1);
+    int val = -int(a);
+    SIMD_CONSTRUCT (val);
 #endif
 }
-#endif
 
 
-OIIO_FORCEINLINE int4 operator* (const int4& a, const int4& b) {
+OIIO_FORCEINLINE void bool4::load (bool a, bool b, bool c, bool d) {
 #if OIIO_SIMD_SSE
-    return mul_epi32 (a.simd(), b.simd());
+    // N.B. -- we need to reverse the order because of our convention
+    // of storing a,b,c,d in the same order in memory.
+    m_simd = _mm_castsi128_ps(_mm_set_epi32(-int(d), -int(c), -int(b), -int(a)));
 #else
-    SIMD_RETURN (int4, a[i] * b[i]);
+    m_val[0] = -int(a);
+    m_val[1] = -int(b);
+    m_val[2] = -int(c);
+    m_val[3] = -int(d);
 #endif
 }
 
-
-OIIO_FORCEINLINE const int4& operator*= (int4& a, const int4& b) { return a = a * b; }
-OIIO_FORCEINLINE const int4& operator*= (int4& a, int b) { return a = a * b; }
-
-
-OIIO_FORCEINLINE int4 operator/ (const int4& a, const int4& b) {
-    // NO INTEGER DIVISION IN SSE!
-    SIMD_RETURN (int4, a[i] / b[i]);
-}
-
-
-OIIO_FORCEINLINE const int4& operator/= (int4& a, const int4& b) { return a = a / b; }
-
-OIIO_FORCEINLINE int4 operator% (const int4& a, const int4& b) {
-    // NO INTEGER MODULUS IN SSE!
-    SIMD_RETURN (int4, a[i] % b[i]);
+OIIO_FORCEINLINE bool4::bool4 (bool *a) {
+    load (a[0], a[1], a[2], a[3]);
 }
 
-
-
-OIIO_FORCEINLINE const int4& operator%= (int4& a, const int4& b) { return a = a % b; }
-
-
-OIIO_FORCEINLINE int4 operator% (const int4& a, int w) {
-    // NO INTEGER MODULUS in SSE!
-    SIMD_RETURN (int4, a[i] % w);
+OIIO_FORCEINLINE const bool4& bool4::operator= (const bool4 & other) {
+    m_simd = other.m_simd;
+    return *this;
 }
 
 
-OIIO_FORCEINLINE const int4& operator%= (int4& a, int b) { return a = a % b; }
-
 
-OIIO_FORCEINLINE int4 operator& (const int4& a, const int4& b) {
+OIIO_FORCEINLINE void bool4::clear () {
 #if OIIO_SIMD_SSE
-    return _mm_and_si128 (a.simd(), b.simd());
+    m_simd = _mm_setzero_ps();
 #else
-    SIMD_RETURN (int4, a[i] & b[i]);
+    *this = false;
 #endif
 }
 
 
-OIIO_FORCEINLINE const int4& operator&= (int4& a, const int4& b) { return a = a & b; }
-
-
-
-OIIO_FORCEINLINE int4 operator| (const int4& a, const int4& b) {
+OIIO_FORCEINLINE const bool4 bool4::False () {
 #if OIIO_SIMD_SSE
-    return _mm_or_si128 (a.simd(), b.simd());
+    return _mm_setzero_ps();
 #else
-    SIMD_RETURN (int4, a[i] | b[i]);
+    return false;
 #endif
 }
 
-OIIO_FORCEINLINE const int4& operator|= (int4& a, const int4& b) { return a = a | b; }
-
-
-OIIO_FORCEINLINE int4 operator^ (const int4& a, const int4& b) {
+OIIO_FORCEINLINE const bool4 bool4::True () {
+    // Fastest way to fill with all 1 bits is to cmp any value to itself.
 #if OIIO_SIMD_SSE
-    return _mm_xor_si128 (a.simd(), b.simd());
+# if OIIO_SIMD_AVX && (OIIO_GNUC_VERSION > 50000)
+    __m128i anyval = _mm_undefined_si128();
+# else
+    __m128i anyval = _mm_setzero_si128();
+# endif
+    return _mm_castsi128_ps (_mm_cmpeq_epi8 (anyval, anyval));
 #else
-    SIMD_RETURN (int4, a[i] ^ b[i]);
+    return true;
 #endif
 }
 
+OIIO_FORCEINLINE void bool4::store (bool *values) const {
+    SIMD_DO (values[i] = m_val[i] ? true : false);
+}
 
-OIIO_FORCEINLINE const int4& operator^= (int4& a, const int4& b) { return a = a ^ b; }
+OIIO_FORCEINLINE void bool4::store (bool *values, int n) const {
+    DASSERT (n >= 0 && n <= elements);
+    for (int i = 0; i < n; ++i)
+        values[i] = m_val[i] ? true : false;
+}
 
 
-OIIO_FORCEINLINE int4 operator~ (const int4& a) {
+
+OIIO_FORCEINLINE bool4 operator! (const bool4 & a) {
 #if OIIO_SIMD_SSE
-    return a ^ a.NegOne();
+    return _mm_xor_ps (a.simd(), bool4::True());
 #else
-    SIMD_RETURN (int4, ~a[i]);
+    SIMD_RETURN (bool4, a[i] ^ (-1));
 #endif
 }
 
-OIIO_FORCEINLINE int4 operator<< (const int4& a, unsigned int bits) {
+OIIO_FORCEINLINE bool4 operator& (const bool4 & a, const bool4 & b) {
 #if OIIO_SIMD_SSE
-    return _mm_slli_epi32 (a, bits);
+    return _mm_and_ps (a.simd(), b.simd());
 #else
-    SIMD_RETURN (int4, a[i] << bits);
+    SIMD_RETURN (bool4, a[i] & b[i]);
 #endif
 }
 
-OIIO_FORCEINLINE const int4& operator<<= (int4& a, const unsigned int bits) {
-    return a = a << bits;
+OIIO_FORCEINLINE bool4 operator| (const bool4 & a, const bool4 & b) {
+#if OIIO_SIMD_SSE
+    return _mm_or_ps (a.simd(), b.simd());
+#else
+    SIMD_RETURN (bool4, a[i] | b[i]);
+#endif
 }
 
-
-OIIO_FORCEINLINE int4 operator>> (const int4& a, const unsigned int bits) {
+OIIO_FORCEINLINE bool4 operator^ (const bool4& a, const bool4& b) {
 #if OIIO_SIMD_SSE
-    return _mm_srai_epi32 (a, bits);
+    return _mm_xor_ps (a.simd(), b.simd());
 #else
-    SIMD_RETURN (int4, a[i] >> bits);
+    SIMD_RETURN (bool4, a[i] ^ b[i]);
 #endif
 }
 
-OIIO_FORCEINLINE const int4& operator>>= (int4& a, const unsigned int bits) {
-    return a = a >> bits;
+
+OIIO_FORCEINLINE const bool4& operator&= (bool4& a, const bool4 &b) {
+    return a = a & b;
 }
 
+OIIO_FORCEINLINE const bool4& operator|= (bool4& a, const bool4& b) {
+    return a = a | b;
+}
 
-OIIO_FORCEINLINE int4 srl (const int4& a, const unsigned int bits) {
+OIIO_FORCEINLINE const bool4& operator^= (bool4& a, const bool4& b) {
+    return a = a ^ b;
+}
+
+OIIO_FORCEINLINE bool4 operator~ (const bool4& a) {
 #if OIIO_SIMD_SSE
-    return _mm_srli_epi32 (a, bits);
+    // Fastest way to bit-complement in SSE is to xor with 0xffffffff.
+    return _mm_xor_ps (a.simd(), bool4::True());
 #else
-    SIMD_RETURN (int4, int ((unsigned int)(a[i]) >> bits));
+    SIMD_RETURN (bool4, ~a[i]);
 #endif
 }
 
-
-OIIO_FORCEINLINE bool4 operator== (const int4& a, const int4& b) {
+OIIO_FORCEINLINE bool4 operator== (const bool4 & a, const bool4 & b) {
 #if OIIO_SIMD_SSE
-    return _mm_castsi128_ps(_mm_cmpeq_epi32 (a, b));
+    return _mm_castsi128_ps (_mm_cmpeq_epi32 (_mm_castps_si128 (a), _mm_castps_si128(b)));
 #else
     SIMD_RETURN (bool4, a[i] == b[i] ? -1 : 0);
 #endif
 }
 
-OIIO_FORCEINLINE bool4 operator!= (const int4& a, const int4& b) {
-    return ! (a == b);
-}
-
-
-OIIO_FORCEINLINE bool4 operator> (const int4& a, const int4& b) {
+OIIO_FORCEINLINE bool4 operator!= (const bool4 & a, const bool4 & b) {
 #if OIIO_SIMD_SSE
-    return _mm_castsi128_ps(_mm_cmpgt_epi32 (a, b));
+    return _mm_xor_ps (a, b);
 #else
-    SIMD_RETURN (bool4, a[i] > b[i] ? -1 : 0);
+    SIMD_RETURN (bool4, a[i] != b[i] ? -1 : 0);
 #endif
 }
 
-OIIO_FORCEINLINE bool4 operator< (const int4& a, const int4& b) {
+
+
+
 #if OIIO_SIMD_SSE
-    return _mm_castsi128_ps(_mm_cmplt_epi32 (a, b));
-#else
-    SIMD_RETURN (bool4, a[i] < b[i] ? -1 : 0);
-#endif
+// Shuffling. Use like this:  x = shuffle<3,2,1,0>(b)
+template<int i0, int i1, int i2, int i3>
+OIIO_FORCEINLINE __m128i shuffle_sse (__m128i v) {
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(i3, i2, i1, i0));
 }
+#endif
 
-OIIO_FORCEINLINE bool4 operator>= (const int4& a, const int4& b) {
-    return (b < a) | (a == b);
+#if OIIO_SIMD_SSE >= 3
+// SSE3 has intrinsics for a few special cases
+template<> OIIO_FORCEINLINE __m128i shuffle_sse<0, 0, 2, 2> (__m128i a) {
+    return _mm_castps_si128(_mm_moveldup_ps(_mm_castsi128_ps(a)));
 }
-
-OIIO_FORCEINLINE bool4 operator<= (const int4& a, const int4& b) {
-    return (b > a) | (a == b);
+template<> OIIO_FORCEINLINE __m128i shuffle_sse<1, 1, 3, 3> (__m128i a) {
+    return _mm_castps_si128(_mm_movehdup_ps(_mm_castsi128_ps(a)));
 }
-
-inline std::ostream& operator<< (std::ostream& cout, const int4& val) {
-    cout << val[0];
-    for (int i = 1; i < val.elements; ++i)
-        cout << ' ' << val[i];
-    return cout;
+template<> OIIO_FORCEINLINE __m128i shuffle_sse<0, 1, 0, 1> (__m128i a) {
+    return _mm_castpd_si128(_mm_movedup_pd(_mm_castsi128_pd(a)));
 }
-
-
-// FIXME(SSE,AVX): is there a faster way to do a partial store? 512!
-
-OIIO_FORCEINLINE void int4::store (int *values, int n) const {
-    DASSERT (n >= 0 && n <= elements);
-#if defined(OIIO_SIMD)
-    // For full SIMD, there is a speed advantage to storing all components.
-    if (n == elements)
-        store (values);
-    else
 #endif
-        for (int i = 0; i < n; ++i)
-            values[i] = m_val[i];
-}
 
-// FIXME(SSE,AVX): is there a faster way to do a partial store? 512!
-
-OIIO_FORCEINLINE void int4::store (unsigned short *values) const {
 #if OIIO_SIMD_SSE
-    // Expressed as half-words and considering little endianness, we
-    // currently have xAxBxCxD (the 'x' means don't care).
-    int4 clamped = m_val & int4(0xffff);   // A0B0C0D0
-    int4 low = _mm_shufflelo_epi16 (clamped, (0<<0) | (2<<2) | (1<<4) | (1<<6));
-                    // low = AB00xxxx
-    int4 high = _mm_shufflehi_epi16 (clamped, (1<<0) | (1<<2) | (0<<4) | (2<<6));
-                    // high = xxxx00CD
-    int4 highswapped = shuffle_sse<2,3,0,1>(high);  // 00CDxxxx
-    int4 result = low | highswapped;   // ABCDxxxx
-    _mm_storel_pd ((double *)values, _mm_castsi128_pd(result));
-    // At this point, values[] should hold A,B,C,D
-#else
-    SIMD_DO (values[i] = m_val[i]);
-#endif
+template<int i0, int i1, int i2, int i3>
+OIIO_FORCEINLINE __m128 shuffle_sse (__m128 a) {
+    return _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(a), _MM_SHUFFLE(i3, i2, i1, i0)));
 }
-
-
-
-OIIO_FORCEINLINE void int4::store (unsigned char *values) const {
-#if OIIO_SIMD_SSE
-    // Expressed as bytes and considering little endianness, we
-    // currently have xAxBxCxD (the 'x' means don't care).
-    int4 clamped = m_val & int4(0xff);            // A000 B000 C000 D000
-    int4 swapped = shuffle_sse<1,0,3,2>(clamped); // B000 A000 D000 C000
-    int4 shifted = swapped << 8;                  // 0B00 0A00 0D00 0C00
-    int4 merged = clamped | shifted;              // AB00 xxxx CD00 xxxx
-    int4 merged2 = shuffle_sse<2,2,2,2>(merged);  // CD00 ...
-    int4 shifted2 = merged2 << 16;                // 00CD ...
-    int4 result = merged | shifted2;              // ABCD ...
-    *(int*)values = result[0]; //extract<0>(result);
-    // At this point, values[] should hold A,B,C,D
-#else
-    SIMD_DO (values[i] = m_val[i]);
 #endif
-}
-
 
+#if OIIO_SIMD_SSE >= 3
+// SSE3 has intrinsics for a few special cases
+template<> OIIO_FORCEINLINE __m128 shuffle_sse<0, 0, 2, 2> (__m128 a) {
+    return _mm_moveldup_ps(a);
+}
+template<> OIIO_FORCEINLINE __m128 shuffle_sse<1, 1, 3, 3> (__m128 a) {
+    return _mm_movehdup_ps(a);
+}
+template<> OIIO_FORCEINLINE __m128 shuffle_sse<0, 1, 0, 1> (__m128 a) {
+    return _mm_castpd_ps(_mm_movedup_pd(_mm_castps_pd(a)));
+}
+#endif
 
 
+/// Helper: shuffle/swizzle with constant (templated) indices.
+/// Example: shuffle<1,1,2,2>(bool4(a,b,c,d)) returns (b,b,c,c)
 template<int i0, int i1, int i2, int i3>
-OIIO_FORCEINLINE int4 shuffle (const int4& a) {
+OIIO_FORCEINLINE bool4 shuffle (const bool4& a) {
 #if OIIO_SIMD_SSE
-    return shuffle_sse<i0,i1,i2,i3> (__m128i(a));
+    return shuffle_sse<i0,i1,i2,i3> (a.simd());
 #else
-    return int4(a[i0], a[i1], a[i2], a[i3]);
+    return bool4 (a[i0], a[i1], a[i2], a[i3]);
 #endif
 }
 
-template<int i> OIIO_FORCEINLINE int4 shuffle (const int4& a) { return shuffle<i,i,i,i>(a); }
+/// shuffle<i>(a) is the same as shuffle<i,i,i,i>(a)
+template<int i> OIIO_FORCEINLINE bool4 shuffle (const bool4& a) {
+    return shuffle<i,i,i,i>(a);
+}
 
 
+/// Helper: as rapid as possible extraction of one component, when the
+/// index is fixed.
 template<int i>
-OIIO_FORCEINLINE int extract (const int4& v) {
+OIIO_FORCEINLINE bool extract (const bool4& a) {
 #if OIIO_SIMD_SSE >= 4
-    return _mm_extract_epi32(v.simd(), i);  // SSE4.1 only
+    return _mm_extract_epi32(_mm_castps_si128(a.simd()), i);  // SSE4.1 only
 #else
-    return v[i];
+    return a[i];
 #endif
 }
 
-#if OIIO_SIMD_SSE
-template<> OIIO_FORCEINLINE int extract<0> (const int4& v) {
-    return _mm_cvtsi128_si32(v.simd());
-}
-#endif
-
+/// Helper: substitute val for a[i]
 template<int i>
-OIIO_FORCEINLINE int4 insert (const int4& a, int val) {
+OIIO_FORCEINLINE bool4 insert (const bool4& a, bool val) {
 #if OIIO_SIMD_SSE >= 4
-    return _mm_insert_epi32 (a.simd(), val, i);
+    int ival = -int(val);
+    return _mm_castsi128_ps (_mm_insert_epi32 (_mm_castps_si128(a), ival, i));
 #else
-    int4 tmp = a;
-    tmp[i] = val;
+    bool4 tmp = a;
+    tmp[i] = -int(val);
     return tmp;
 #endif
 }
 
-
-
-OIIO_FORCEINLINE int int4::x () const { return extract<0>(*this); }
-OIIO_FORCEINLINE int int4::y () const { return extract<1>(*this); }
-OIIO_FORCEINLINE int int4::z () const { return extract<2>(*this); }
-OIIO_FORCEINLINE int int4::w () const { return extract<3>(*this); }
-OIIO_FORCEINLINE void int4::set_x (int val) { *this = insert<0>(*this, val); }
-OIIO_FORCEINLINE void int4::set_y (int val) { *this = insert<1>(*this, val); }
-OIIO_FORCEINLINE void int4::set_z (int val) { *this = insert<2>(*this, val); }
-OIIO_FORCEINLINE void int4::set_w (int val) { *this = insert<3>(*this, val); }
-
-
-OIIO_FORCEINLINE int4 bitcast_to_int (const bool4& x)
-{
-#if OIIO_SIMD_SSE
-    return _mm_castps_si128 (x.simd());
+OIIO_FORCEINLINE bool reduce_and (const bool4& v) {
+#if OIIO_SIMD_AVX
+    return _mm_testc_ps (v, bool4(true)) != 0;
+#elif OIIO_SIMD_SSE
+    return _mm_movemask_ps(v.simd()) == 0xf;
 #else
-    return *(int4 *)&x;
+    SIMD_RETURN_REDUCE (bool, true, r &= v[i]);
 #endif
 }
 
-// Old names:
-inline int4 bitcast_to_int4 (const bool4& x) { return bitcast_to_int(x); }
-
-
-OIIO_FORCEINLINE int4 vreduce_add (const int4& v) {
-#if OIIO_SIMD_SSE >= 3
-    // People seem to agree that SSE3 does add reduction best with 2
-    // horizontal adds.
-    // suppose v = (a, b, c, d)
-    simd::int4 ab_cd = _mm_hadd_epi32 (v.simd(), v.simd());
-    // ab_cd = (a+b, c+d, a+b, c+d)
-    simd::int4 abcd = _mm_hadd_epi32 (ab_cd.simd(), ab_cd.simd());
-    // all abcd elements are a+b+c+d, return an element as fast as possible
-    return abcd;
-#elif OIIO_SIMD_SSE >= 2
-    // I think this is the best we can do for SSE2, and I'm still not sure
-    // it's faster than the default scalar operation. But anyway...
-    // suppose v = (a, b, c, d)
-    int4 ab_ab_cd_cd = shuffle<1,0,3,2>(v) + v;
-    // ab_ab_cd_cd = (b,a,d,c) + (a,b,c,d) = (a+b,a+b,c+d,c+d)
-    int4 cd_cd_ab_ab = shuffle<2,3,0,1>(ab_ab_cd_cd);
-    // cd_cd_ab_ab = (c+d,c+d,a+b,a+b)
-    int4 abcd = ab_ab_cd_cd + cd_cd_ab_ab;   // a+b+c+d in all components
-    return abcd;
+OIIO_FORCEINLINE bool reduce_or (const bool4& v) {
+#if OIIO_SIMD_AVX
+    return ! _mm_testz_ps (v, v);
+#elif OIIO_SIMD_SSE
+    return _mm_movemask_ps(v) != 0;
 #else
-    SIMD_RETURN_REDUCE (int4, 0, r += v[i]);
+    SIMD_RETURN_REDUCE (bool, false, r |= v[i]);
 #endif
 }
 
+OIIO_FORCEINLINE bool all (const bool4& v) { return reduce_and(v) == true; }
+OIIO_FORCEINLINE bool any (const bool4& v) { return reduce_or(v) == true; }
+OIIO_FORCEINLINE bool none (const bool4& v) { return reduce_or(v) == false; }
 
-OIIO_FORCEINLINE int reduce_add (const int4& v) {
-#if OIIO_SIMD_SSE
-    return extract<0> (vreduce_add(v));
-#else
-    SIMD_RETURN_REDUCE (int, 0, r += v[i]);
-#endif
-}
 
 
-OIIO_FORCEINLINE int reduce_and (const int4& v) {
-#if OIIO_SIMD_SSE
-    int4 ab = v & shuffle<1,1,3,3>(v); // ab bb cd dd
-    int4 abcd = ab & shuffle<2>(ab);
-    return extract<0>(abcd);
-#else
-    SIMD_RETURN_REDUCE (int, -1, r &= v[i]);
-#endif
-}
+//////////////////////////////////////////////////////////////////////
+// bool8 implementation
 
 
-OIIO_FORCEINLINE int reduce_or (const int4& v) {
-#if OIIO_SIMD_SSE
-    int4 ab = v | shuffle<1,1,3,3>(v); // ab bb cd dd
-    int4 abcd = ab | shuffle<2>(ab);
-    return extract<0>(abcd);
+OIIO_FORCEINLINE int bool8::operator[] (int i) const {
+    DASSERT(i >= 0 && i < elements);
+#if OIIO_SIMD_AVX
+    return ((_mm256_movemask_ps(m_simd) >> i) & 1) ? -1 : 0;
 #else
-    SIMD_RETURN_REDUCE (int, 0, r |= v[i]);
+    return m_val[i];
 #endif
 }
 
+OIIO_FORCEINLINE int& bool8::operator[] (int i) {
+    DASSERT(i >= 0 && i < elements);
+    return m_val[i];
+}
 
 
-OIIO_FORCEINLINE int4 blend (const int4& a, const int4& b, const bool4& mask) {
-#if OIIO_SIMD_SSE >= 4 /* SSE >= 4.1 */
-    return _mm_castps_si128 (_mm_blendv_ps (_mm_castsi128_ps(a.simd()),
-                                            _mm_castsi128_ps(b.simd()), mask));
-#elif OIIO_SIMD_SSE
-    return _mm_or_si128 (_mm_and_si128(_mm_castps_si128(mask.simd()), b.simd()),
-                         _mm_andnot_si128(_mm_castps_si128(mask.simd()), a.simd()));
-#else
-    SIMD_RETURN (int4, mask[i] ? b[i] : a[i]);
-#endif
+OIIO_FORCEINLINE std::ostream& operator<< (std::ostream& cout, const bool8& a) {
+    cout << a[0];
+    for (int i = 1; i < a.elements; ++i)
+        cout << ' ' << a[i];
+    return cout;
 }
 
-OIIO_FORCEINLINE int4 blend0 (const int4& a, const bool4& mask) {
-#if OIIO_SIMD_SSE
-    return _mm_and_si128(_mm_castps_si128(mask), a.simd());
+
+OIIO_FORCEINLINE void bool8::load (bool a) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_castsi256_ps(_mm256_set1_epi32(-int(a)));
 #else
-    SIMD_RETURN (int4, mask[i] ? a[i] : 0.0f);
+    int val = -int(a);
+    SIMD_CONSTRUCT (val);
 #endif
 }
 
 
-OIIO_FORCEINLINE int4 blend0not (const int4& a, const bool4& mask) {
-#if OIIO_SIMD_SSE
-    return _mm_andnot_si128(_mm_castps_si128(mask), a.simd());
+OIIO_FORCEINLINE void bool8::load (bool a, bool b, bool c, bool d,
+                                   bool e, bool f, bool g, bool h) {
+#if OIIO_SIMD_AVX
+    // N.B. -- we need to reverse the order because of our convention
+    // of storing a,b,c,d in the same order in memory.
+    m_simd = _mm256_castsi256_ps(_mm256_set_epi32(-int(h), -int(g), -int(f), -int(e),
+                                                  -int(d), -int(c), -int(b), -int(a)));
 #else
-    SIMD_RETURN (int4, mask[i] ? 0.0f : a[i]);
+    m_val[0] = -int(a);
+    m_val[1] = -int(b);
+    m_val[2] = -int(c);
+    m_val[3] = -int(d);
+    m_val[4] = -int(e);
+    m_val[5] = -int(f);
+    m_val[6] = -int(g);
+    m_val[7] = -int(h);
 #endif
 }
 
-
-OIIO_FORCEINLINE int4 select (const bool4& mask, const int4& a, const int4& b) {
-    return blend (b, a, mask);
+OIIO_FORCEINLINE bool8::bool8 (bool a, bool b, bool c, bool d,
+                               bool e, bool f, bool g, bool h) {
+    load (a, b, c, d, e, f, g, h);
 }
 
+OIIO_FORCEINLINE bool8::bool8 (bool *a) {
+    load (a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+}
 
 
-OIIO_FORCEINLINE int4 abs (const int4& a) {
-#if OIIO_SIMD_SSE >= 3
-    return _mm_abs_epi32(a.simd());
-#else
-    SIMD_RETURN (int4, std::abs(a[i]));
-#endif
+OIIO_FORCEINLINE const bool8& bool8::operator= (bool a) {
+    load(a);
+    return *this;
 }
 
+OIIO_FORCEINLINE const bool8& bool8::operator= (const bool8 & other) {
+    m_simd = other.m_simd;
+    return *this;
+}
 
-
-OIIO_FORCEINLINE int4 min (const int4& a, const int4& b) {
-#if OIIO_SIMD_SSE >= 4 /* SSE >= 4.1 */
-    return _mm_min_epi32 (a, b);
+OIIO_FORCEINLINE void bool8::clear () {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_setzero_ps();
 #else
-    SIMD_RETURN (int4, std::min(a[i], b[i]));
+    *this = false;
 #endif
 }
 
-
-OIIO_FORCEINLINE int4 max (const int4& a, const int4& b) {
-#if OIIO_SIMD_SSE >= 4 /* SSE >= 4.1 */
-    return _mm_max_epi32 (a, b);
+OIIO_FORCEINLINE const bool8 bool8::False () {
+#if OIIO_SIMD_AVX
+    return _mm256_setzero_ps();
 #else
-    SIMD_RETURN (int4, std::max(a[i], b[i]));
+    return false;
 #endif
 }
 
 
-OIIO_FORCEINLINE int4 rotl32 (const int4& x, const unsigned int k) {
-    return (x<<k) | srl(x,32-k);
-}
-
-
-OIIO_FORCEINLINE int4 andnot (const int4& a, const int4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_andnot_si128 (a.simd(), b.simd());
+OIIO_FORCEINLINE const bool8 bool8::True () {
+#if OIIO_SIMD_AVX
+# if OIIO_SIMD_AVX >= 2 && (OIIO_GNUC_VERSION > 50000)
+    // Fastest way to fill with all 1 bits is to cmp any value to itself.
+    __m256i anyval = _mm256_undefined_si256();
+    return _mm256_castsi256_ps (_mm256_cmpeq_epi8 (anyval, anyval));
+# else
+    return _mm256_castsi256_ps (_mm256_set1_epi32 (-1));
+# endif
 #else
-    SIMD_RETURN (int4, ~(a[i]) & b[i]);
+    return true;
 #endif
 }
 
 
-// Implementation had to be after the definition of int4::Zero.
-OIIO_FORCEINLINE bool4::bool4 (const int4& ival) {
-    m_simd = (ival != int4::Zero());
+OIIO_FORCEINLINE void bool8::store (bool *values) const {
+    SIMD_DO (values[i] = m_val[i] ? true : false);
 }
 
-
-
-
-//////////////////////////////////////////////////////////////////////
-// int8 implementation
-
-OIIO_FORCEINLINE const int8 & int8::operator= (int8 other) {
-    m_simd = other.m_simd;
-    return *this;
+OIIO_FORCEINLINE void bool8::store (bool *values, int n) const {
+    DASSERT (n >= 0 && n <= elements);
+    for (int i = 0; i < n; ++i)
+        values[i] = m_val[i] ? true : false;
 }
 
-OIIO_FORCEINLINE int& int8::operator[] (int i) {
-    DASSERT(i<elements);
-    return m_val[i];
-}
 
-OIIO_FORCEINLINE int int8::operator[] (int i) const {
-    DASSERT(i<elements);
-    return m_val[i];
+OIIO_FORCEINLINE bool4 bool8::lo () const {
+#if OIIO_SIMD_AVX
+    return _mm256_castps256_ps128 (simd());
+#else
+    return m_4[0];
+#endif
 }
 
-
-OIIO_FORCEINLINE void int8::load (int a) {
+OIIO_FORCEINLINE bool4 bool8::hi () const {
 #if OIIO_SIMD_AVX
-    m_simd = _mm256_set1_epi32 (a);
+    return _mm256_extractf128_ps (simd(), 1);
 #else
-    SIMD_CONSTRUCT (a);
+    return m_4[1];
 #endif
 }
 
 
-OIIO_FORCEINLINE void int8::load (int a, int b, int c, int d,
-                                  int e, int f, int g, int h) {
+OIIO_FORCEINLINE bool8::bool8 (const bool4& lo, const bool4 &hi) {
 #if OIIO_SIMD_AVX
-    m_simd = _mm256_set_epi32 (h, g, f, e, d, c, b, a);
+    __m256 r = _mm256_castps128_ps256 (lo);
+    m_simd = _mm256_insertf128_ps (r, hi, 1);
+    // N.B. equivalent, if available: m_simd = _mm256_set_m128 (hi, lo);
 #else
-    m_val[0] = a;
-    m_val[1] = b;
-    m_val[2] = c;
-    m_val[3] = d;
-    m_val[4] = e;
-    m_val[5] = f;
-    m_val[6] = g;
-    m_val[7] = h;
+    m_4[0] = lo;
+    m_4[1] = hi;
 #endif
 }
 
 
-OIIO_FORCEINLINE void int8::load (const int *values) {
+OIIO_FORCEINLINE bool8 operator! (const bool8 & a) {
 #if OIIO_SIMD_AVX
-    m_simd = _mm256_loadu_si256 ((const simd_t *)values);
+    return _mm256_xor_ps (a.simd(), bool8::True());
 #else
-    SIMD_CONSTRUCT (values[i]);
+    SIMD_RETURN (bool8, a[i] ^ (-1));
 #endif
 }
 
-
-OIIO_FORCEINLINE void int8::load (const int *values, int n)
-{
-    // FIXME: is this faster with AVX masked loads?
-#if OIIO_SIMD_SSE
-    if (n > 0 && n <= 4) {
-        int4 l; l.load (values, n);
-        m_simd = int8(l, int4::Zero());
-    } else if (n > 4 && n <= 8) {
-        int4 h; h.load (values+4, n-4);
-        m_simd = int8(int4(values), h);
-    }
-    else
-        clear();
+OIIO_FORCEINLINE bool8 operator& (const bool8 & a, const bool8 & b) {
+#if OIIO_SIMD_AVX
+    return _mm256_and_ps (a.simd(), b.simd());
 #else
-    for (int i = 0; i < n; ++i)
-        m_val[i] = values[i];
-    for (int i = n; i < elements; ++i)
-        m_val[i] = 0;
+    SIMD_RETURN (bool8, a[i] & b[i]);
 #endif
 }
 
-// FIXME(AVX): fast load from unsigned short, short, unsigned char, char
-
-OIIO_FORCEINLINE void int8::load (const short *values) {
-    SIMD_CONSTRUCT (values[i]);
+OIIO_FORCEINLINE bool8 operator| (const bool8 & a, const bool8 & b) {
+#if OIIO_SIMD_AVX
+    return _mm256_or_ps (a.simd(), b.simd());
+#else
+    SIMD_RETURN (bool8, a[i] | b[i]);
+#endif
 }
 
-OIIO_FORCEINLINE void int8::load (const unsigned short *values) {
-    SIMD_CONSTRUCT (values[i]);
+OIIO_FORCEINLINE bool8 operator^ (const bool8& a, const bool8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_xor_ps (a.simd(), b.simd());
+#else
+    SIMD_RETURN (bool8, a[i] ^ b[i]);
+#endif
 }
 
 
-OIIO_FORCEINLINE void int8::load (const char *values) {
-    SIMD_CONSTRUCT (values[i]);
+OIIO_FORCEINLINE const bool8& operator&= (bool8& a, const bool8 &b) {
+    return a = a & b;
 }
 
-OIIO_FORCEINLINE void int8::load (const unsigned char *values) {
-    SIMD_CONSTRUCT (values[i]);
+OIIO_FORCEINLINE const bool8& operator|= (bool8& a, const bool8& b) {
+    return a = a | b;
 }
 
-
-
-OIIO_FORCEINLINE int8::int8 (int a) { load(a); }
-
-// OIIO_FORCEINLINE int8::int8 (int a, int b, int c, int d) { load(a,b,c,d); }
-
-OIIO_FORCEINLINE int8::int8 (int a, int b, int c, int d,
-                             int e, int f, int g, int h) {
-    load(a,b,c,d,e,f,g,h);
+OIIO_FORCEINLINE const bool8& operator^= (bool8& a, const bool8& b) {
+    return a = a ^ b;
 }
 
-OIIO_FORCEINLINE int8::int8 (const int *vals) { load (vals); }
-OIIO_FORCEINLINE int8::int8 (const unsigned short *vals) { load(vals); }
-OIIO_FORCEINLINE int8::int8 (const short *vals) { load(vals); }
-OIIO_FORCEINLINE int8::int8 (const unsigned char *vals) { load(vals); }
-OIIO_FORCEINLINE int8::int8 (const char *vals) { load(vals); }
-
-OIIO_FORCEINLINE const int8 & int8::operator= (int a) { load(a); return *this; }
-
 
-OIIO_FORCEINLINE void int8::store (int *values) const {
+OIIO_FORCEINLINE bool8 operator~ (const bool8& a) {
 #if OIIO_SIMD_AVX
-    // Use an unaligned store -- it's just as fast when the memory turns
-    // out to be aligned, nearly as fast even when unaligned. Not worth
-    // the headache of using stores that require alignment.
-    _mm256_storeu_si256 ((simd_t *)values, m_simd);
+    // Fastest way to bit-complement in SSE is to xor with 0xffffffff.
+    return _mm256_xor_ps (a.simd(), bool8::True());
 #else
-    SIMD_DO (values[i] = m_val[i]);
+    SIMD_RETURN (bool8, ~a[i]);
 #endif
 }
 
 
-OIIO_FORCEINLINE void int8::clear () {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_setzero_si256();
+OIIO_FORCEINLINE bool8 operator== (const bool8 & a, const bool8 & b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_castsi256_ps (_mm256_cmpeq_epi32 (_mm256_castps_si256 (a), _mm256_castps_si256(b)));
+#elif OIIO_SIMD_AVX
+    return _mm256_cmp_ps (a, b, _CMP_EQ_UQ);
 #else
-    *this = 0;
+    SIMD_RETURN (bool8, a[i] == b[i] ? -1 : 0);
 #endif
 }
 
-
-OIIO_FORCEINLINE const int8 int8::Zero () {
+OIIO_FORCEINLINE bool8 operator!= (const bool8 & a, const bool8 & b) {
 #if OIIO_SIMD_AVX
-    return _mm256_setzero_si256();
+    return _mm256_xor_ps (a, b);
 #else
-    return 0;
+    SIMD_RETURN (bool8, a[i] != b[i] ? -1 : 0);
 #endif
 }
 
-OIIO_FORCEINLINE const int8 int8::One () { return int8(1); }
 
-OIIO_FORCEINLINE const int8 int8::NegOne () { return int8(-1); }
+template<int i0, int i1, int i2, int i3, int i4, int i5, int i6, int i7>
+OIIO_FORCEINLINE bool8 shuffle (const bool8& a) {
+#if OIIO_SIMD_AVX >= 2
+    int8 index (i0, i1, i2, i3, i4, i5, i6, i7);
+    return _mm256_permutevar8x32_ps (a.simd(), index.simd());
+#else
+    return bool8 (a[i0], a[i1], a[i2], a[i3], a[i4], a[i5], a[i6], a[i7]);
+#endif
+}
 
+template<int i> OIIO_FORCEINLINE bool8 shuffle (const bool8& a) {
+    return shuffle<i,i,i,i,i,i,i,i>(a);
+}
 
-OIIO_FORCEINLINE const int8 int8::Iota (int start, int step) {
-    return int8 (start+0*step, start+1*step, start+2*step, start+3*step,
-                 start+4*step, start+5*step, start+6*step, start+7*step);
+
+template<int i>
+OIIO_FORCEINLINE bool extract (const bool8& a) {
+#if OIIO_SIMD_AVX && !_WIN32
+    return _mm256_extract_epi32(_mm256_castps_si256(a.simd()), i);  // SSE4.1 only
+#else
+    return a[i];
+#endif
+}
+
+template<int i>
+OIIO_FORCEINLINE bool8 insert (const bool8& a, bool val) {
+#if OIIO_SIMD_AVX && !_WIN32
+    int ival = -int(val);
+    return _mm256_castsi256_ps (_mm256_insert_epi32 (_mm256_castps_si256(a.simd()), ival, i));
+#else
+    bool8 tmp = a;
+    tmp[i] = -int(val);
+    return tmp;
+#endif
 }
 
 
-OIIO_FORCEINLINE int4 int8::lo () const {
+OIIO_FORCEINLINE bool reduce_and (const bool8& v) {
 #if OIIO_SIMD_AVX
-    return _mm256_castsi256_si128 (simd());
+    return _mm256_testc_ps (v, bool8(true)) != 0;
+    // return _mm256_movemask_ps(v.simd()) == 0xff;
 #else
-    return m_4[0];
+    SIMD_RETURN_REDUCE (bool, true, r &= bool(v[i]));
 #endif
 }
 
-OIIO_FORCEINLINE int4 int8::hi () const {
+OIIO_FORCEINLINE bool reduce_or (const bool8& v) {
 #if OIIO_SIMD_AVX
-    return _mm256_extractf128_si256 (simd(), 1);
+    return ! _mm256_testz_ps (v, v);   // FIXME? Not in all immintrin.h !
+    // return _mm256_movemask_ps(v) != 0;
 #else
-    return m_4[1];
+    SIMD_RETURN_REDUCE (bool, false, r |= bool(v[i]));
 #endif
 }
 
 
-OIIO_FORCEINLINE int8::int8 (const int4& lo, const int4 &hi) {
-#if OIIO_SIMD_AVX
-    __m256i r = _mm256_castsi128_si256 (lo);
-    m_simd = _mm256_insertf128_si256 (r, hi, 1);
-    // N.B. equivalent, if available: m_simd = _mm256_set_m128i (hi, lo);
+OIIO_FORCEINLINE bool all (const bool8& v) { return reduce_and(v) == true; }
+OIIO_FORCEINLINE bool any (const bool8& v) { return reduce_or(v) == true; }
+OIIO_FORCEINLINE bool none (const bool8& v) { return reduce_or(v) == false; }
+
+
+
+//////////////////////////////////////////////////////////////////////
+// int4 implementation
+
+OIIO_FORCEINLINE const int4 & int4::operator= (int4 other) {
+    m_simd = other.m_simd;
+    return *this;
+}
+
+OIIO_FORCEINLINE int& int4::operator[] (int i) {
+    DASSERT(i<elements);
+    return m_val[i];
+}
+
+OIIO_FORCEINLINE int int4::operator[] (int i) const {
+    DASSERT(i<elements);
+    return m_val[i];
+}
+
+
+OIIO_FORCEINLINE void int4::load (int a) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_set1_epi32 (a);
 #else
-    m_4[0] = lo;
-    m_4[1] = hi;
+    SIMD_CONSTRUCT (a);
 #endif
 }
 
 
-OIIO_FORCEINLINE int8 operator+ (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_add_epi32 (a.simd(), b.simd());
+
+OIIO_FORCEINLINE void int4::load (int a, int b, int c, int d) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_set_epi32 (d, c, b, a);
+#else
+    m_val[0] = a;
+    m_val[1] = b;
+    m_val[2] = c;
+    m_val[3] = d;
+#endif
+}
+
+
+// OIIO_FORCEINLINE void int4::load (int a, int b, int c, int d,
+//                                   int e, int f, int g, int h) {
+//     load (a, b, c, d);
+// }
+
+
+
+OIIO_FORCEINLINE void int4::load (const int *values) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_loadu_si128 ((const simd_t *)values);
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void int4::load (const int *values, int n)
+{
+#if OIIO_SIMD_SSE
+    switch (n) {
+    case 1:
+        m_simd = _mm_castps_si128 (_mm_load_ss ((const float *)values));
+        break;
+    case 2:
+        // Trickery: load one double worth of bits!
+        m_simd = _mm_castpd_si128 (_mm_load_sd ((const double*)values));
+        break;
+    case 3:
+        // Trickery: load one double worth of bits, then a float,
+        // and combine, casting to ints.
+        m_simd = _mm_castps_si128 (_mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)values)),
+                                                _mm_load_ss ((const float *)values + 2)));
+        break;
+    case 4:
+        m_simd = _mm_loadu_si128 ((const simd_t *)values);
+        break;
+    default:
+        break;
+    }
+#else
+    for (int i = 0; i < n; ++i)
+        m_val[i] = values[i];
+    for (int i = n; i < elements; ++i)
+        m_val[i] = 0;
+#endif
+}
+
+
+OIIO_FORCEINLINE void int4::load (const unsigned short *values) {
+#if OIIO_SIMD_SSE >= 4
+    // Trickery: load one double worth of bits = 4 uint16's!
+    simd_t a = _mm_castpd_si128 (_mm_load_sd ((const double *)values));
+    m_simd = _mm_cvtepu16_epi32 (a);
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void int4::load (const short *values) {
+#if OIIO_SIMD_SSE >= 4
+    // Trickery: load one double worth of bits = 4 int16's!
+    simd_t a = _mm_castpd_si128 (_mm_load_sd ((const double *)values));
+    m_simd = _mm_cvtepi16_epi32 (a);
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void int4::load (const unsigned char *values) {
+#if OIIO_SIMD_SSE >= 4
+    // Trickery: load one float worth of bits = 4 uint8's!
+    simd_t a = _mm_castps_si128 (_mm_load_ss ((const float *)values));
+    m_simd = _mm_cvtepu8_epi32 (a);
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void int4::load (const char *values) {
+#if OIIO_SIMD_SSE >= 4
+    // Trickery: load one float worth of bits = 4 uint8's!
+    simd_t a = _mm_castps_si128 (_mm_load_ss ((const float *)values));
+    m_simd = _mm_cvtepi8_epi32 (a);
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int4::int4 (int a) { load(a); }
+
+OIIO_FORCEINLINE int4::int4 (int a, int b) { load(a,a,b,b); }
+
+OIIO_FORCEINLINE int4::int4 (int a, int b, int c, int d) { load(a,b,c,d); }
+
+// OIIO_FORCEINLINE int4::int4 (int a, int b, int c, int d,
+//                              int e, int f, int g, int h) {
+//     load(a,b,c,d,e,f,g,h);
+// }
+
+OIIO_FORCEINLINE int4::int4 (const int *vals) { load (vals); }
+OIIO_FORCEINLINE int4::int4 (const unsigned short *vals) { load(vals); }
+OIIO_FORCEINLINE int4::int4 (const short *vals) { load(vals); }
+OIIO_FORCEINLINE int4::int4 (const unsigned char *vals) { load(vals); }
+OIIO_FORCEINLINE int4::int4 (const char *vals) { load(vals); }
+
+OIIO_FORCEINLINE const int4 & int4::operator= (int a) { load(a); return *this; }
+
+
+OIIO_FORCEINLINE void int4::store (int *values) const {
+#if OIIO_SIMD_SSE
+    // Use an unaligned store -- it's just as fast when the memory turns
+    // out to be aligned, nearly as fast even when unaligned. Not worth
+    // the headache of using stores that require alignment.
+    _mm_storeu_si128 ((simd_t *)values, m_simd);
+#else
+    SIMD_DO (values[i] = m_val[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void int4::clear () {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_setzero_si128();
+#else
+    *this = 0;
+#endif
+}
+
+
+
+OIIO_FORCEINLINE const int4 int4::Zero () {
+#if OIIO_SIMD_SSE
+    return _mm_setzero_si128();
+#else
+    return 0;
+#endif
+}
+
+
+OIIO_FORCEINLINE const int4 int4::One () { return int4(1); }
+
+OIIO_FORCEINLINE const int4 int4::NegOne () {
+#if OIIO_SIMD_SSE
+    // Fastest way to fill an __m128 with all 1 bits is to cmpeq_epi8
+    // any value to itself.
+# if OIIO_SIMD_AVX && (OIIO_GNUC_VERSION > 50000)
+    __m128i anyval = _mm_undefined_si128();
+# else
+    __m128i anyval = _mm_setzero_si128();
+# endif
+    return _mm_cmpeq_epi8 (anyval, anyval);
+#else
+    return int4(-1);
+#endif
+}
+
+
+
+OIIO_FORCEINLINE const int4 int4::Iota (int start, int step) {
+    return int4 (start+0*step, start+1*step, start+2*step, start+3*step);
+}
+
+
+OIIO_FORCEINLINE int4 operator+ (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_add_epi32 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int4, a[i] + b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const int4& operator+= (int4& a, const int4& b) {
+    return a = a + b;
+}
+
+
+OIIO_FORCEINLINE int4 operator- (const int4& a) {
+#if OIIO_SIMD_SSE
+    return _mm_sub_epi32 (_mm_setzero_si128(), a);
+#else
+    SIMD_RETURN (int4, -a[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int4 operator- (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_sub_epi32 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int4, a[i] - b[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE const int4 &operator-= (int4& a, const int4& b) {
+    return a = a - b;
+}
+
+
+#if OIIO_SIMD_SSE
+// Shamelessly lifted from Syrah which lifted from Manta which lifted it
+// from intel.com
+OIIO_FORCEINLINE __m128i mul_epi32 (__m128i a, __m128i b) {
+#if OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
+    return _mm_mullo_epi32(a, b);
+#else
+    // Prior to SSE 4.1, there is no _mm_mullo_epi32 instruction, so we have
+    // to fake it.
+    __m128i t0;
+    __m128i t1;
+    t0 = _mm_mul_epu32 (a, b);
+    t1 = _mm_mul_epu32 (_mm_shuffle_epi32 (a, 0xB1),
+                        _mm_shuffle_epi32 (b, 0xB1));
+    t0 = _mm_shuffle_epi32 (t0, 0xD8);
+    t1 = _mm_shuffle_epi32 (t1, 0xD8);
+    return _mm_unpacklo_epi32 (t0, t1);
+#endif
+}
+#endif
+
+
+OIIO_FORCEINLINE int4 operator* (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return mul_epi32 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int4, a[i] * b[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE const int4& operator*= (int4& a, const int4& b) { return a = a * b; }
+OIIO_FORCEINLINE const int4& operator*= (int4& a, int b) { return a = a * b; }
+
+
+OIIO_FORCEINLINE int4 operator/ (const int4& a, const int4& b) {
+    // NO INTEGER DIVISION IN SSE!
+    SIMD_RETURN (int4, a[i] / b[i]);
+}
+
+
+OIIO_FORCEINLINE const int4& operator/= (int4& a, const int4& b) { return a = a / b; }
+
+OIIO_FORCEINLINE int4 operator% (const int4& a, const int4& b) {
+    // NO INTEGER MODULUS IN SSE!
+    SIMD_RETURN (int4, a[i] % b[i]);
+}
+
+
+
+OIIO_FORCEINLINE const int4& operator%= (int4& a, const int4& b) { return a = a % b; }
+
+
+OIIO_FORCEINLINE int4 operator% (const int4& a, int w) {
+    // NO INTEGER MODULUS in SSE!
+    SIMD_RETURN (int4, a[i] % w);
+}
+
+
+OIIO_FORCEINLINE const int4& operator%= (int4& a, int b) { return a = a % b; }
+
+
+OIIO_FORCEINLINE int4 operator& (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_and_si128 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int4, a[i] & b[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE const int4& operator&= (int4& a, const int4& b) { return a = a & b; }
+
+
+
+OIIO_FORCEINLINE int4 operator| (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_or_si128 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int4, a[i] | b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const int4& operator|= (int4& a, const int4& b) { return a = a | b; }
+
+
+OIIO_FORCEINLINE int4 operator^ (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_xor_si128 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int4, a[i] ^ b[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE const int4& operator^= (int4& a, const int4& b) { return a = a ^ b; }
+
+
+OIIO_FORCEINLINE int4 operator~ (const int4& a) {
+#if OIIO_SIMD_SSE
+    return a ^ a.NegOne();
+#else
+    SIMD_RETURN (int4, ~a[i]);
+#endif
+}
+
+OIIO_FORCEINLINE int4 operator<< (const int4& a, unsigned int bits) {
+#if OIIO_SIMD_SSE
+    return _mm_slli_epi32 (a, bits);
+#else
+    SIMD_RETURN (int4, a[i] << bits);
+#endif
+}
+
+OIIO_FORCEINLINE const int4& operator<<= (int4& a, const unsigned int bits) {
+    return a = a << bits;
+}
+
+
+OIIO_FORCEINLINE int4 operator>> (const int4& a, const unsigned int bits) {
+#if OIIO_SIMD_SSE
+    return _mm_srai_epi32 (a, bits);
+#else
+    SIMD_RETURN (int4, a[i] >> bits);
+#endif
+}
+
+OIIO_FORCEINLINE const int4& operator>>= (int4& a, const unsigned int bits) {
+    return a = a >> bits;
+}
+
+
+OIIO_FORCEINLINE int4 srl (const int4& a, const unsigned int bits) {
+#if OIIO_SIMD_SSE
+    return _mm_srli_epi32 (a, bits);
+#else
+    SIMD_RETURN (int4, int ((unsigned int)(a[i]) >> bits));
+#endif
+}
+
+
+OIIO_FORCEINLINE bool4 operator== (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_castsi128_ps(_mm_cmpeq_epi32 (a, b));
+#else
+    SIMD_RETURN (bool4, a[i] == b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool4 operator!= (const int4& a, const int4& b) {
+    return ! (a == b);
+}
+
+
+OIIO_FORCEINLINE bool4 operator> (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_castsi128_ps(_mm_cmpgt_epi32 (a, b));
+#else
+    SIMD_RETURN (bool4, a[i] > b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool4 operator< (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_castsi128_ps(_mm_cmplt_epi32 (a, b));
+#else
+    SIMD_RETURN (bool4, a[i] < b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool4 operator>= (const int4& a, const int4& b) {
+    return (b < a) | (a == b);
+}
+
+OIIO_FORCEINLINE bool4 operator<= (const int4& a, const int4& b) {
+    return (b > a) | (a == b);
+}
+
+inline std::ostream& operator<< (std::ostream& cout, const int4& val) {
+    cout << val[0];
+    for (int i = 1; i < val.elements; ++i)
+        cout << ' ' << val[i];
+    return cout;
+}
+
+
+// FIXME(SSE,AVX): is there a faster way to do a partial store? 512!
+
+OIIO_FORCEINLINE void int4::store (int *values, int n) const {
+    DASSERT (n >= 0 && n <= elements);
+#if defined(OIIO_SIMD)
+    // For full SIMD, there is a speed advantage to storing all components.
+    if (n == elements)
+        store (values);
+    else
+#endif
+        for (int i = 0; i < n; ++i)
+            values[i] = m_val[i];
+}
+
+// FIXME(SSE,AVX): is there a faster way to do a partial store? 512!
+
+OIIO_FORCEINLINE void int4::store (unsigned short *values) const {
+#if OIIO_SIMD_SSE
+    // Expressed as half-words and considering little endianness, we
+    // currently have xAxBxCxD (the 'x' means don't care).
+    int4 clamped = m_val & int4(0xffff);   // A0B0C0D0
+    int4 low = _mm_shufflelo_epi16 (clamped, (0<<0) | (2<<2) | (1<<4) | (1<<6));
+                    // low = AB00xxxx
+    int4 high = _mm_shufflehi_epi16 (clamped, (1<<0) | (1<<2) | (0<<4) | (2<<6));
+                    // high = xxxx00CD
+    int4 highswapped = shuffle_sse<2,3,0,1>(high);  // 00CDxxxx
+    int4 result = low | highswapped;   // ABCDxxxx
+    _mm_storel_pd ((double *)values, _mm_castsi128_pd(result));
+    // At this point, values[] should hold A,B,C,D
+#else
+    SIMD_DO (values[i] = m_val[i]);
+#endif
+}
+
+
+
+OIIO_FORCEINLINE void int4::store (unsigned char *values) const {
+#if OIIO_SIMD_SSE
+    // Expressed as bytes and considering little endianness, we
+    // currently have xAxBxCxD (the 'x' means don't care).
+    int4 clamped = m_val & int4(0xff);            // A000 B000 C000 D000
+    int4 swapped = shuffle_sse<1,0,3,2>(clamped); // B000 A000 D000 C000
+    int4 shifted = swapped << 8;                  // 0B00 0A00 0D00 0C00
+    int4 merged = clamped | shifted;              // AB00 xxxx CD00 xxxx
+    int4 merged2 = shuffle_sse<2,2,2,2>(merged);  // CD00 ...
+    int4 shifted2 = merged2 << 16;                // 00CD ...
+    int4 result = merged | shifted2;              // ABCD ...
+    *(int*)values = result[0]; //extract<0>(result);
+    // At this point, values[] should hold A,B,C,D
+#else
+    SIMD_DO (values[i] = m_val[i]);
+#endif
+}
+
+
+
+
+template<int i0, int i1, int i2, int i3>
+OIIO_FORCEINLINE int4 shuffle (const int4& a) {
+#if OIIO_SIMD_SSE
+    return shuffle_sse<i0,i1,i2,i3> (__m128i(a));
+#else
+    return int4(a[i0], a[i1], a[i2], a[i3]);
+#endif
+}
+
+template<int i> OIIO_FORCEINLINE int4 shuffle (const int4& a) { return shuffle<i,i,i,i>(a); }
+
+
+template<int i>
+OIIO_FORCEINLINE int extract (const int4& v) {
+#if OIIO_SIMD_SSE >= 4
+    return _mm_extract_epi32(v.simd(), i);  // SSE4.1 only
+#else
+    return v[i];
+#endif
+}
+
+#if OIIO_SIMD_SSE
+template<> OIIO_FORCEINLINE int extract<0> (const int4& v) {
+    return _mm_cvtsi128_si32(v.simd());
+}
+#endif
+
+template<int i>
+OIIO_FORCEINLINE int4 insert (const int4& a, int val) {
+#if OIIO_SIMD_SSE >= 4
+    return _mm_insert_epi32 (a.simd(), val, i);
+#else
+    int4 tmp = a;
+    tmp[i] = val;
+    return tmp;
+#endif
+}
+
+
+
+OIIO_FORCEINLINE int int4::x () const { return extract<0>(*this); }
+OIIO_FORCEINLINE int int4::y () const { return extract<1>(*this); }
+OIIO_FORCEINLINE int int4::z () const { return extract<2>(*this); }
+OIIO_FORCEINLINE int int4::w () const { return extract<3>(*this); }
+OIIO_FORCEINLINE void int4::set_x (int val) { *this = insert<0>(*this, val); }
+OIIO_FORCEINLINE void int4::set_y (int val) { *this = insert<1>(*this, val); }
+OIIO_FORCEINLINE void int4::set_z (int val) { *this = insert<2>(*this, val); }
+OIIO_FORCEINLINE void int4::set_w (int val) { *this = insert<3>(*this, val); }
+
+
+OIIO_FORCEINLINE int4 bitcast_to_int (const bool4& x)
+{
+#if OIIO_SIMD_SSE
+    return _mm_castps_si128 (x.simd());
+#else
+    return *(int4 *)&x;
+#endif
+}
+
+// Old names:
+inline int4 bitcast_to_int4 (const bool4& x) { return bitcast_to_int(x); }
+
+
+OIIO_FORCEINLINE int4 vreduce_add (const int4& v) {
+#if OIIO_SIMD_SSE >= 3
+    // People seem to agree that SSE3 does add reduction best with 2
+    // horizontal adds.
+    // suppose v = (a, b, c, d)
+    simd::int4 ab_cd = _mm_hadd_epi32 (v.simd(), v.simd());
+    // ab_cd = (a+b, c+d, a+b, c+d)
+    simd::int4 abcd = _mm_hadd_epi32 (ab_cd.simd(), ab_cd.simd());
+    // all abcd elements are a+b+c+d, return an element as fast as possible
+    return abcd;
+#elif OIIO_SIMD_SSE >= 2
+    // I think this is the best we can do for SSE2, and I'm still not sure
+    // it's faster than the default scalar operation. But anyway...
+    // suppose v = (a, b, c, d)
+    int4 ab_ab_cd_cd = shuffle<1,0,3,2>(v) + v;
+    // ab_ab_cd_cd = (b,a,d,c) + (a,b,c,d) = (a+b,a+b,c+d,c+d)
+    int4 cd_cd_ab_ab = shuffle<2,3,0,1>(ab_ab_cd_cd);
+    // cd_cd_ab_ab = (c+d,c+d,a+b,a+b)
+    int4 abcd = ab_ab_cd_cd + cd_cd_ab_ab;   // a+b+c+d in all components
+    return abcd;
+#else
+    SIMD_RETURN_REDUCE (int4, 0, r += v[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int reduce_add (const int4& v) {
+#if OIIO_SIMD_SSE
+    return extract<0> (vreduce_add(v));
+#else
+    SIMD_RETURN_REDUCE (int, 0, r += v[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int reduce_and (const int4& v) {
+#if OIIO_SIMD_SSE
+    int4 ab = v & shuffle<1,1,3,3>(v); // ab bb cd dd
+    int4 abcd = ab & shuffle<2>(ab);
+    return extract<0>(abcd);
+#else
+    SIMD_RETURN_REDUCE (int, -1, r &= v[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int reduce_or (const int4& v) {
+#if OIIO_SIMD_SSE
+    int4 ab = v | shuffle<1,1,3,3>(v); // ab bb cd dd
+    int4 abcd = ab | shuffle<2>(ab);
+    return extract<0>(abcd);
+#else
+    SIMD_RETURN_REDUCE (int, 0, r |= v[i]);
+#endif
+}
+
+
+
+OIIO_FORCEINLINE int4 blend (const int4& a, const int4& b, const bool4& mask) {
+#if OIIO_SIMD_SSE >= 4 /* SSE >= 4.1 */
+    return _mm_castps_si128 (_mm_blendv_ps (_mm_castsi128_ps(a.simd()),
+                                            _mm_castsi128_ps(b.simd()), mask));
+#elif OIIO_SIMD_SSE
+    return _mm_or_si128 (_mm_and_si128(_mm_castps_si128(mask.simd()), b.simd()),
+                         _mm_andnot_si128(_mm_castps_si128(mask.simd()), a.simd()));
+#else
+    SIMD_RETURN (int4, mask[i] ? b[i] : a[i]);
+#endif
+}
+
+OIIO_FORCEINLINE int4 blend0 (const int4& a, const bool4& mask) {
+#if OIIO_SIMD_SSE
+    return _mm_and_si128(_mm_castps_si128(mask), a.simd());
+#else
+    SIMD_RETURN (int4, mask[i] ? a[i] : 0.0f);
+#endif
+}
+
+
+OIIO_FORCEINLINE int4 blend0not (const int4& a, const bool4& mask) {
+#if OIIO_SIMD_SSE
+    return _mm_andnot_si128(_mm_castps_si128(mask), a.simd());
+#else
+    SIMD_RETURN (int4, mask[i] ? 0.0f : a[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int4 select (const bool4& mask, const int4& a, const int4& b) {
+    return blend (b, a, mask);
+}
+
+
+
+OIIO_FORCEINLINE int4 abs (const int4& a) {
+#if OIIO_SIMD_SSE >= 3
+    return _mm_abs_epi32(a.simd());
+#else
+    SIMD_RETURN (int4, std::abs(a[i]));
+#endif
+}
+
+
+
+OIIO_FORCEINLINE int4 min (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE >= 4 /* SSE >= 4.1 */
+    return _mm_min_epi32 (a, b);
+#else
+    SIMD_RETURN (int4, std::min(a[i], b[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE int4 max (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE >= 4 /* SSE >= 4.1 */
+    return _mm_max_epi32 (a, b);
+#else
+    SIMD_RETURN (int4, std::max(a[i], b[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE int4 rotl32 (const int4& x, const unsigned int k) {
+    return (x<<k) | srl(x,32-k);
+}
+
+
+OIIO_FORCEINLINE int4 andnot (const int4& a, const int4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_andnot_si128 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int4, ~(a[i]) & b[i]);
+#endif
+}
+
+
+// Implementation had to be after the definition of int4::Zero.
+OIIO_FORCEINLINE bool4::bool4 (const int4& ival) {
+    m_simd = (ival != int4::Zero());
+}
+
+
+
+
+//////////////////////////////////////////////////////////////////////
+// int8 implementation
+
+OIIO_FORCEINLINE const int8 & int8::operator= (int8 other) {
+    m_simd = other.m_simd;
+    return *this;
+}
+
+OIIO_FORCEINLINE int& int8::operator[] (int i) {
+    DASSERT(i<elements);
+    return m_val[i];
+}
+
+OIIO_FORCEINLINE int int8::operator[] (int i) const {
+    DASSERT(i<elements);
+    return m_val[i];
+}
+
+
+OIIO_FORCEINLINE void int8::load (int a) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_set1_epi32 (a);
+#else
+    SIMD_CONSTRUCT (a);
+#endif
+}
+
+
+OIIO_FORCEINLINE void int8::load (int a, int b, int c, int d,
+                                  int e, int f, int g, int h) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_set_epi32 (h, g, f, e, d, c, b, a);
+#else
+    m_val[0] = a;
+    m_val[1] = b;
+    m_val[2] = c;
+    m_val[3] = d;
+    m_val[4] = e;
+    m_val[5] = f;
+    m_val[6] = g;
+    m_val[7] = h;
+#endif
+}
+
+
+OIIO_FORCEINLINE void int8::load (const int *values) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_loadu_si256 ((const simd_t *)values);
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void int8::load (const int *values, int n)
+{
+    // FIXME: is this faster with AVX masked loads?
+#if OIIO_SIMD_SSE
+    if (n > 0 && n <= 4) {
+        int4 l; l.load (values, n);
+        m_simd = int8(l, int4::Zero());
+    } else if (n > 4 && n <= 8) {
+        int4 h; h.load (values+4, n-4);
+        m_simd = int8(int4(values), h);
+    }
+    else
+        clear();
+#else
+    for (int i = 0; i < n; ++i)
+        m_val[i] = values[i];
+    for (int i = n; i < elements; ++i)
+        m_val[i] = 0;
+#endif
+}
+
+// FIXME(AVX): fast load from unsigned short, short, unsigned char, char
+
+OIIO_FORCEINLINE void int8::load (const short *values) {
+    SIMD_CONSTRUCT (values[i]);
+}
+
+OIIO_FORCEINLINE void int8::load (const unsigned short *values) {
+    SIMD_CONSTRUCT (values[i]);
+}
+
+
+OIIO_FORCEINLINE void int8::load (const char *values) {
+    SIMD_CONSTRUCT (values[i]);
+}
+
+OIIO_FORCEINLINE void int8::load (const unsigned char *values) {
+    SIMD_CONSTRUCT (values[i]);
+}
+
+
+
+OIIO_FORCEINLINE int8::int8 (int a) { load(a); }
+
+// OIIO_FORCEINLINE int8::int8 (int a, int b, int c, int d) { load(a,b,c,d); }
+
+OIIO_FORCEINLINE int8::int8 (int a, int b, int c, int d,
+                             int e, int f, int g, int h) {
+    load(a,b,c,d,e,f,g,h);
+}
+
+OIIO_FORCEINLINE int8::int8 (const int *vals) { load (vals); }
+OIIO_FORCEINLINE int8::int8 (const unsigned short *vals) { load(vals); }
+OIIO_FORCEINLINE int8::int8 (const short *vals) { load(vals); }
+OIIO_FORCEINLINE int8::int8 (const unsigned char *vals) { load(vals); }
+OIIO_FORCEINLINE int8::int8 (const char *vals) { load(vals); }
+
+OIIO_FORCEINLINE const int8 & int8::operator= (int a) { load(a); return *this; }
+
+
+OIIO_FORCEINLINE void int8::store (int *values) const {
+#if OIIO_SIMD_AVX
+    // Use an unaligned store -- it's just as fast when the memory turns
+    // out to be aligned, nearly as fast even when unaligned. Not worth
+    // the headache of using stores that require alignment.
+    _mm256_storeu_si256 ((simd_t *)values, m_simd);
+#else
+    SIMD_DO (values[i] = m_val[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void int8::clear () {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_setzero_si256();
+#else
+    *this = 0;
+#endif
+}
+
+
+OIIO_FORCEINLINE const int8 int8::Zero () {
+#if OIIO_SIMD_AVX
+    return _mm256_setzero_si256();
+#else
+    return 0;
+#endif
+}
+
+OIIO_FORCEINLINE const int8 int8::One () { return int8(1); }
+
+OIIO_FORCEINLINE const int8 int8::NegOne () { return int8(-1); }
+
+
+OIIO_FORCEINLINE const int8 int8::Iota (int start, int step) {
+    return int8 (start+0*step, start+1*step, start+2*step, start+3*step,
+                 start+4*step, start+5*step, start+6*step, start+7*step);
+}
+
+
+OIIO_FORCEINLINE int4 int8::lo () const {
+#if OIIO_SIMD_AVX
+    return _mm256_castsi256_si128 (simd());
+#else
+    return m_4[0];
+#endif
+}
+
+OIIO_FORCEINLINE int4 int8::hi () const {
+#if OIIO_SIMD_AVX
+    return _mm256_extractf128_si256 (simd(), 1);
+#else
+    return m_4[1];
+#endif
+}
+
+
+OIIO_FORCEINLINE int8::int8 (const int4& lo, const int4 &hi) {
+#if OIIO_SIMD_AVX
+    __m256i r = _mm256_castsi128_si256 (lo);
+    m_simd = _mm256_insertf128_si256 (r, hi, 1);
+    // N.B. equivalent, if available: m_simd = _mm256_set_m128i (hi, lo);
+#else
+    m_4[0] = lo;
+    m_4[1] = hi;
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 operator+ (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_add_epi32 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int8, a[i] + b[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE const int8& operator+= (int8& a, const int8& b) {
+    return a = a + b;
+}
+
+
+OIIO_FORCEINLINE int8 operator- (const int8& a) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_sub_epi32 (_mm256_setzero_si256(), a);
+#else
+    SIMD_RETURN (int8, -a[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 operator- (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_sub_epi32 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int8, a[i] - b[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE const int8 &operator-= (int8& a, const int8& b) {
+    return a = a - b;
+}
+
+
+OIIO_FORCEINLINE int8 operator* (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_mullo_epi32 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int8, a[i] * b[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE const int8& operator*= (int8& a, const int8& b) { return a = a * b; }
+OIIO_FORCEINLINE const int8& operator*= (int8& a, int b) { return a = a * b; }
+
+
+OIIO_FORCEINLINE int8 operator/ (const int8& a, const int8& b) {
+    // NO INTEGER DIVISION IN SSE or AVX!
+    SIMD_RETURN (int8, a[i] / b[i]);
+}
+
+OIIO_FORCEINLINE const int8& operator/= (int8& a, const int8& b) { return a = a / b; }
+
+
+OIIO_FORCEINLINE int8 operator% (const int8& a, const int8& b) {
+    // NO INTEGER MODULUS IN SSE or AVX!
+    SIMD_RETURN (int8, a[i] % b[i]);
+}
+
+OIIO_FORCEINLINE const int8& operator%= (int8& a, const int8& b) { return a = a % b; }
+
+OIIO_FORCEINLINE int8 operator% (const int8& a, int w) {
+    // NO INTEGER MODULUS in SSE or AVX!
+    SIMD_RETURN (int8, a[i] % w);
+}
+
+OIIO_FORCEINLINE const int8& operator%= (int8& a, int b) { return a = a % b; }
+
+
+OIIO_FORCEINLINE int8 operator& (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_and_si256 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int8, a[i] & b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const int8& operator&= (int8& a, const int8& b) { return a = a & b; }
+
+OIIO_FORCEINLINE int8 operator| (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_or_si256 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int8, a[i] | b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const int8& operator|= (int8& a, const int8& b) { return a = a | b; }
+
+OIIO_FORCEINLINE int8 operator^ (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_xor_si256 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int8, a[i] ^ b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const int8& operator^= (int8& a, const int8& b) { return a = a ^ b; }
+
+
+OIIO_FORCEINLINE int8 operator~ (const int8& a) {
+#if OIIO_SIMD_AVX >= 2
+    return a ^ a.NegOne();
+#else
+    SIMD_RETURN (int8, ~a[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 operator<< (const int8& a, unsigned int bits) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_slli_epi32 (a, bits);
+#elif OIIO_SIMD_SSE
+    return int8 (a.lo() << bits, a.hi() << bits);
+#else
+    SIMD_RETURN (int8, a[i] << bits);
+#endif
+}
+
+
+OIIO_FORCEINLINE const int8& operator<<= (int8& a, const unsigned int bits) {
+    return a = a << bits;
+}
+
+OIIO_FORCEINLINE int8 operator>> (const int8& a, const unsigned int bits) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_srai_epi32 (a, bits);
+#elif OIIO_SIMD_SSE
+    return int8 (a.lo() >> bits, a.hi() >> bits);
+#else
+    SIMD_RETURN (int8, a[i] >> bits);
+#endif
+}
+
+OIIO_FORCEINLINE const int8& operator>>= (int8& a, const unsigned int bits) {
+    return a = a >> bits;
+}
+
+
+OIIO_FORCEINLINE int8 srl (const int8& a, const unsigned int bits) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_srli_epi32 (a, bits);
+#else
+    SIMD_RETURN (int8, int ((unsigned int)(a[i]) >> bits));
+#endif
+}
+
+
+OIIO_FORCEINLINE bool8 operator== (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32 (a.m_simd, b.m_simd));
+#elif OIIO_SIMD_SSE  /* Fall back to 4-wide */
+    return bool8 (a.lo() == b.lo(), a.hi() == b.hi());
+#else
+    SIMD_RETURN (bool8, a[i] == b[i] ? -1 : 0);
+#endif
+}
+
+
+OIIO_FORCEINLINE bool8 operator!= (const int8& a, const int8& b) {
+    return ! (a == b);
+}
+
+
+OIIO_FORCEINLINE bool8 operator> (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_castsi256_ps(_mm256_cmpgt_epi32 (a, b));
+#elif OIIO_SIMD_SSE  /* Fall back to 4-wide */
+    return bool8 (a.lo() > b.lo(), a.hi() > b.hi());
+#else
+    SIMD_RETURN (bool8, a[i] > b[i] ? -1 : 0);
+#endif
+}
+
+
+OIIO_FORCEINLINE bool8 operator< (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    // No lt or lte!
+    return (b > a);
+#elif OIIO_SIMD_SSE  /* Fall back to 4-wide */
+    return bool8 (a.lo() < b.lo(), a.hi() < b.hi());
+#else
+    SIMD_RETURN (bool8, a[i] < b[i] ? -1 : 0);
+#endif
+}
+
+
+OIIO_FORCEINLINE bool8 operator>= (const int8& a, const int8& b) {
+    return (a > b) | (a == b);
+}
+
+
+OIIO_FORCEINLINE bool8 operator<= (const int8& a, const int8& b) {
+    return (b > a) | (a == b);
+}
+
+
+inline std::ostream& operator<< (std::ostream& cout, const int8& val) {
+    cout << val[0];
+    for (int i = 1; i < val.elements; ++i)
+        cout << ' ' << val[i];
+    return cout;
+}
+
+
+OIIO_FORCEINLINE void int8::store (int *values, int n) const {
+    DASSERT (n >= 0 && n <= elements);
+    // FIXME: is this faster with AVX masked stores?
+#if OIIO_SIMD_SSE
+    if (n <= 4) {
+        lo().store (values, n);
+    } else if (n <= 8) {
+        lo().store (values);
+        hi().store (values+4, n-4);
+    }
+#endif
+        for (int i = 0; i < n; ++i)
+            values[i] = m_val[i];
+}
+
+
+// FIXME(AVX): fast int8 store to unsigned short, unsigned char
+
+OIIO_FORCEINLINE void int8::store (unsigned short *values) const {
+#if 0 && OIIO_SIMD_AVX >= 2
+    // FIXME -- try to determine if this is faster:
+    lo().store (values);
+    hi().store (values+4);
+#else
+    SIMD_DO (values[i] = m_val[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void int8::store (unsigned char *values) const {
+#if OIIO_SIMD_SSE
+    lo().store (values);
+    hi().store (values+4);
+#else
+    SIMD_DO (values[i] = m_val[i]);
+#endif
+}
+
+
+template<int i0, int i1, int i2, int i3, int i4, int i5, int i6, int i7>
+OIIO_FORCEINLINE int8 shuffle (const int8& a) {
+#if OIIO_SIMD_AVX >= 2
+    int8 index (i0, i1, i2, i3, i4, i5, i6, i7);
+    return _mm256_castps_si256 (_mm256_permutevar8x32_ps (_mm256_castsi256_ps(a.simd()), index.simd()));
+#else
+    return int8 (a[i0], a[i1], a[i2], a[i3], a[i4], a[i5], a[i6], a[i7]);
+#endif
+}
+
+template<int i> OIIO_FORCEINLINE int8 shuffle (const int8& a) {
+    return shuffle<i,i,i,i,i,i,i,i>(a);
+}
+
+
+template<int i>
+OIIO_FORCEINLINE int extract (const int8& v) {
+#if OIIO_SIMD_AVX && !_WIN32
+    return _mm256_extract_epi32(v.simd(), i);
+#else
+    return v[i];
+#endif
+}
+
+
+template<int i>
+OIIO_FORCEINLINE int8 insert (const int8& a, int val) {
+#if OIIO_SIMD_AVX && !_WIN32
+    return _mm256_insert_epi32 (a.simd(), val, i);
+#else
+    int8 tmp = a;
+    tmp[i] = val;
+    return tmp;
+#endif
+}
+
+
+OIIO_FORCEINLINE int int8::x () const { return extract<0>(*this); }
+OIIO_FORCEINLINE int int8::y () const { return extract<1>(*this); }
+OIIO_FORCEINLINE int int8::z () const { return extract<2>(*this); }
+OIIO_FORCEINLINE int int8::w () const { return extract<3>(*this); }
+OIIO_FORCEINLINE void int8::set_x (int val) { *this = insert<0>(*this, val); }
+OIIO_FORCEINLINE void int8::set_y (int val) { *this = insert<1>(*this, val); }
+OIIO_FORCEINLINE void int8::set_z (int val) { *this = insert<2>(*this, val); }
+OIIO_FORCEINLINE void int8::set_w (int val) { *this = insert<3>(*this, val); }
+
+
+OIIO_FORCEINLINE int8 bitcast_to_int (const bool8& x)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_castps_si256 (x.simd());
+#else
+    return *(int8 *)&x;
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 vreduce_add (const int8& v) {
+#if OIIO_SIMD_AVX >= 2
+    // From Syrah:
+    int8 ab_cd_0_0_ef_gh_0_0 = _mm256_hadd_epi32(v.simd(), _mm256_setzero_si256());
+    int8 abcd_0_0_0_efgh_0_0_0 = _mm256_hadd_epi32(ab_cd_0_0_ef_gh_0_0, _mm256_setzero_si256());
+    // get efgh in the 0-idx slot
+    int8 efgh = shuffle<4>(abcd_0_0_0_efgh_0_0_0);
+    int8 final_sum = abcd_0_0_0_efgh_0_0_0 + efgh;
+    return shuffle<0>(final_sum);
+#elif OIIO_SIMD_SSE
+    int4 hadd4 = vreduce_add(v.lo()) + vreduce_add(v.hi());
+    return int8(hadd4, hadd4);
+#else
+    SIMD_RETURN_REDUCE (int8, 0, r += v[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int reduce_add (const int8& v) {
+#if OIIO_SIMD_SSE
+    return extract<0> (vreduce_add(v));
+#else
+    SIMD_RETURN_REDUCE (int, 0, r += v[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int reduce_and (const int8& v) {
+#if OIIO_SSE_AVX >= 2
+    int8 ab = v & shuffle<1,1,3,3,5,5,7,7>(v); // ab bb cd dd ef ff gh hh
+    int8 abcd = ab & shuffle<2,2,2,2,6,6,6,6>(ab); // abcd x x x efgh x x x
+    int8 abcdefgh = abcd & shuffle<4>(abcdefgh); // abcdefgh x x x x x x x
+    return extract<0> (abcdefgh);
+#else
+    // AVX 1.0 or less -- use SSE
+    return reduce_and(v.lo() & v.hi());
+#endif
+}
+
+
+OIIO_FORCEINLINE int reduce_or (const int8& v) {
+#if OIIO_SSE_AVX >= 2
+    int8 ab = v | shuffle<1,1,3,3,5,5,7,7>(v); // ab bb cd dd ef ff gh hh
+    int8 abcd = ab | shuffle<2,2,2,2,6,6,6,6>(ab); // abcd x x x efgh x x x
+    int8 abcdefgh = abcd | shuffle<4>(abcdefgh); // abcdefgh x x x x x x x
+    return extract<0> (abcdefgh);
+#else
+    // AVX 1.0 or less -- use SSE
+    return reduce_or(v.lo() | v.hi());
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 blend (const int8& a, const int8& b, const bool8& mask) {
+#if OIIO_SIMD_AVX
+    return _mm256_castps_si256 (_mm256_blendv_ps (_mm256_castsi256_ps(a.simd()),
+                                                  _mm256_castsi256_ps(b.simd()), mask));
+#else
+    SIMD_RETURN (int8, mask[i] ? b[i] : a[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 blend0 (const int8& a, const bool8& mask) {
+#if OIIO_SIMD_AVX
+    return _mm256_castps_si256(_mm256_and_ps(_mm256_castsi256_ps(a.simd()), mask));
+#else
+    SIMD_RETURN (int8, mask[i] ? a[i] : 0.0f);
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 blend0not (const int8& a, const bool8& mask) {
+#if OIIO_SIMD_AVX
+    return _mm256_castps_si256 (_mm256_andnot_ps (mask.simd(), _mm256_castsi256_ps(a.simd())));
+#else
+    SIMD_RETURN (int8, mask[i] ? 0.0f : a[i]);
+#endif
+}
+
+OIIO_FORCEINLINE int8 select (const bool8& mask, const int8& a, const int8& b) {
+    return blend (b, a, mask);
+}
+
+
+OIIO_FORCEINLINE int8 abs (const int8& a) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_abs_epi32(a.simd());
+#else
+    SIMD_RETURN (int8, std::abs(a[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 min (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_min_epi32 (a, b);
+#else
+    SIMD_RETURN (int8, std::min(a[i], b[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 max (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_max_epi32 (a, b);
+#else
+    SIMD_RETURN (int8, std::max(a[i], b[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE int8 rotl32 (const int8& x, const unsigned int k) {
+    return (x<<k) | srl(x,32-k);
+}
+
+
+OIIO_FORCEINLINE int8 andnot (const int8& a, const int8& b) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_andnot_si256 (a.simd(), b.simd());
+#else
+    SIMD_RETURN (int8, ~(a[i]) & b[i]);
+#endif
+}
+
+
+// Implementation had to be after the definition of int8::Zero.
+OIIO_FORCEINLINE bool8::bool8 (const int8& ival) {
+    m_simd = (ival != int8::Zero());
+}
+
+
+
+
+//////////////////////////////////////////////////////////////////////
+// float4 implementation
+
+
+OIIO_FORCEINLINE float4::float4 (const int4& ival) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_cvtepi32_ps (ival.simd());
+#else
+    SIMD_CONSTRUCT (float(ival[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE const float4 float4::Zero () {
+#if OIIO_SIMD_SSE
+    return _mm_setzero_ps();
+#else
+    return float4(0.0f);
+#endif
+}
+
+OIIO_FORCEINLINE const float4 float4::One () {
+    return float4(1.0f);
+}
+
+OIIO_FORCEINLINE const float4 float4::Iota (float start, float step) {
+    return float4 (start+0.0f*step, start+1.0f*step, start+2.0f*step, start+3.0f*step);
+}
+
+/// Set all components to 0.0
+OIIO_FORCEINLINE void float4::clear () {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_setzero_ps();
+#else
+    load (0.0f);
+#endif
+}
+
+#if defined(ILMBASE_VERSION_MAJOR) && ILMBASE_VERSION_MAJOR >= 2
+OIIO_FORCEINLINE const float4 & float4::operator= (const Imath::V4f &v) {
+    load ((const float *)&v);
+    return *this;
+}
+#endif
+
+OIIO_FORCEINLINE const float4 & float4::operator= (const Imath::V3f &v) {
+    load (v[0], v[1], v[2], 0.0f);
+    return *this;
+}
+
+OIIO_FORCEINLINE float& float4::operator[] (int i) {
+    DASSERT(i<elements);
+    return m_val[i];
+}
+
+OIIO_FORCEINLINE float float4::operator[] (int i) const {
+    DASSERT(i<elements);
+    return m_val[i];
+}
+
+
+OIIO_FORCEINLINE void float4::load (float val) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_set1_ps (val);
+#elif defined(OIIO_SIMD_NEON)
+    m_simd = vdupq_n_f32 (val);
+#else
+    SIMD_CONSTRUCT (val);
+#endif
+}
+
+OIIO_FORCEINLINE void float4::load (float a, float b, float c, float d) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_set_ps (d, c, b, a);
+#elif defined(OIIO_SIMD_NEON)
+    float values[4] = { a, b, c, d };
+    m_simd = vld1q_f32 (values);
+#else
+    m_val[0] = a;
+    m_val[1] = b;
+    m_val[2] = c;
+    m_val[3] = d;
+#endif
+}
+
+    /// Load from an array of 4 values
+OIIO_FORCEINLINE void float4::load (const float *values) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_loadu_ps (values);
+#elif defined(OIIO_SIMD_NEON)
+    m_simd = vld1q_f32 (values);
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void float4::load (const float *values, int n) {
+#if OIIO_SIMD_SSE
+    switch (n) {
+    case 1:
+        m_simd = _mm_load_ss (values);
+        break;
+    case 2:
+        // Trickery: load one double worth of bits!
+        m_simd = _mm_castpd_ps (_mm_load_sd ((const double*)values));
+        break;
+    case 3:
+        m_simd = _mm_setr_ps (values[0], values[1], values[2], 0.0f);
+        // This looks wasteful, but benchmarks show that it's the
+        // fastest way to set 3 values with the 4th getting zero.
+        // Actually, gcc and clang both turn it into something more
+        // efficient than _mm_setr_ps. The version below looks smart,
+        // but was much more expensive as the _mm_setr_ps!
+        //   __m128 xy = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)values));
+        //   m_simd = _mm_movelh_ps(xy, _mm_load_ss (values + 2));
+        break;
+    case 4:
+        m_simd = _mm_loadu_ps (values);
+        break;
+    default:
+        break;
+    }
+#elif defined(OIIO_SIMD_NEON)
+    switch (n) {
+    case 1: m_simd = vdupq_n_f32 (val);                    break;
+    case 2: load (values[0], values[1], 0.0f, 0.0f);      break;
+    case 3: load (values[0], values[1], values[2], 0.0f); break;
+    case 4: m_simd = vld1q_f32 (values);                   break;
+    default: break;
+    }
+#else
+    for (int i = 0; i < n; ++i)
+        m_val[i] = values[i];
+    for (int i = n; i < paddedelements; ++i)
+        m_val[i] = 0;
+#endif
+}
+
+
+OIIO_FORCEINLINE void float4::load (const unsigned short *values) {
+#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
+    m_simd = _mm_cvtepi32_ps (int4(values).simd());
+    // You might guess that the following is faster, but it's NOT:
+    //   NO!  m_simd = _mm_cvtpu16_ps (*(__m64*)values);
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void float4::load (const short *values) {
+#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
+    m_simd = _mm_cvtepi32_ps (int4(values).simd());
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void float4::load (const unsigned char *values) {
+#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
+    m_simd = _mm_cvtepi32_ps (int4(values).simd());
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+    /// Load from an array of 4 char values, convert to float
+OIIO_FORCEINLINE void float4::load (const char *values) {
+#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
+    m_simd = _mm_cvtepi32_ps (int4(values).simd());
+#else
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+
+#ifdef _HALF_H_
+OIIO_FORCEINLINE void float4::load (const half *values) {
+#if defined(__F16C__) && defined(OIIO_SIMD_SSE)
+    /* Enabled 16 bit float instructions! */
+    __m128i a = _mm_castpd_si128 (_mm_load_sd ((const double *)values));
+    m_simd = _mm_cvtph_ps (a);
+#elif defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
+    // SSE half-to-float by Fabian "ryg" Giesen. Public domain.
+    // https://gist.github.com/rygorous/2144712
+    int4 h ((const unsigned short *)values);
+# define CONSTI(name) *(const __m128i *)&name
+# define CONSTF(name) *(const __m128 *)&name
+    OIIO_SIMD_UINT4_CONST(mask_nosign, 0x7fff);
+    OIIO_SIMD_UINT4_CONST(magic,       (254 - 15) << 23);
+    OIIO_SIMD_UINT4_CONST(was_infnan,  0x7bff);
+    OIIO_SIMD_UINT4_CONST(exp_infnan,  255 << 23);
+    __m128i mnosign     = CONSTI(mask_nosign);
+    __m128i expmant     = _mm_and_si128(mnosign, h);
+    __m128i justsign    = _mm_xor_si128(h, expmant);
+    __m128i expmant2    = expmant; // copy (just here for counting purposes)
+    __m128i shifted     = _mm_slli_epi32(expmant, 13);
+    __m128  scaled      = _mm_mul_ps(_mm_castsi128_ps(shifted), *(const __m128 *)&magic);
+    __m128i b_wasinfnan = _mm_cmpgt_epi32(expmant2, CONSTI(was_infnan));
+    __m128i sign        = _mm_slli_epi32(justsign, 16);
+    __m128  infnanexp   = _mm_and_ps(_mm_castsi128_ps(b_wasinfnan), CONSTF(exp_infnan));
+    __m128  sign_inf    = _mm_or_ps(_mm_castsi128_ps(sign), infnanexp);
+    __m128  final       = _mm_or_ps(scaled, sign_inf);
+    // ~11 SSE2 ops.
+    m_simd = final;
+# undef CONSTI
+# undef CONSTF
+#else /* No SIMD defined: */
+    SIMD_CONSTRUCT (values[i]);
+#endif
+}
+#endif /* _HALF_H_ */
+
+OIIO_FORCEINLINE void float4::store (float *values) const {
+#if OIIO_SIMD_SSE
+    // Use an unaligned store -- it's just as fast when the memory turns
+    // out to be aligned, nearly as fast even when unaligned. Not worth
+    // the headache of using stores that require alignment.
+    _mm_storeu_ps (values, m_simd);
+#elif defined(OIIO_SIMD_NEON)
+    vst1q_f32 (values, m_simd);
+#else
+    SIMD_DO (values[i] = m_val[i]);
+#endif
+}
+
+OIIO_FORCEINLINE void float4::store (float *values, int n) const {
+    DASSERT (n >= 0 && n <= 4);
+#if OIIO_SIMD_SSE
+    switch (n) {
+        case 1:
+        _mm_store_ss (values, m_simd);
+        break;
+    case 2:
+        // Trickery: store two floats as a double worth of bits
+        _mm_store_sd ((double*)values, _mm_castps_pd(m_simd));
+        break;
+    case 3:
+        values[0] = m_val[0];
+        values[1] = m_val[1];
+        values[2] = m_val[2];
+        // This looks wasteful, but benchmarks show that it's the
+        // fastest way to store 3 values, in benchmarks was faster than
+        // this, below:
+        //   _mm_store_sd ((double*)values, _mm_castps_pd(m_simd));
+        //   _mm_store_ss (values + 2, _mm_movehl_ps(m_simd,m_simd));
+        break;
+    case 4:
+        store (values);
+        break;
+    default:
+        break;
+    }
+#elif defined(OIIO_SIMD_NEON)
+    switch (n) {
+    case 1:
+        vst1q_lane_f32 (values, m_simd, 0);
+        break;
+    case 2:
+        vst1q_lane_f32 (values++, m_simd, 0);
+        vst1q_lane_f32 (values, m_simd, 1);
+        break;
+    case 3:
+        vst1q_lane_f32 (values++, m_simd, 0);
+        vst1q_lane_f32 (values++, m_simd, 1);
+        vst1q_lane_f32 (values, m_simd, 2);
+        break;
+    case 4:
+        vst1q_f32 (values, m_simd); break;
+    default:
+        break;
+    }
+#else
+    for (int i = 0; i < n; ++i)
+        values[i] = m_val[i];
+#endif
+}
+
+#ifdef _HALF_H_
+OIIO_FORCEINLINE void float4::store (half *values) const {
+#if defined(__F16C__) && defined(OIIO_SIMD_SSE)
+    __m128i h = _mm_cvtps_ph (m_simd, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
+    _mm_store_sd ((double *)values, _mm_castsi128_pd(h));
+#elif defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
+    // SSE float-to-half with round to nearest even, also by Fabian "ryg"
+    // Giesen. Public domain.  https://gist.github.com/rygorous/2156668
+    // Rounds exactly as F16C and Imath's half(float) do (though NaN
+    // payloads aren't preserved).
+# define CONSTI(name) *(const __m128i *)&name
+    OIIO_SIMD_UINT4_CONST(mask_sign,       0x80000000u);
+    OIIO_SIMD_UINT4_CONST(f16max,          (127 + 16) << 23);  // >= rounds to inf
+    OIIO_SIMD_UINT4_CONST(nanbit,          0x200);
+    OIIO_SIMD_UINT4_CONST(infty_as_fp16,   0x7c00);
+    OIIO_SIMD_UINT4_CONST(min_normal,      (127 - 14) << 23);  // smallest normal result
+    OIIO_SIMD_UINT4_CONST(subnorm_magic,   ((127 - 15) + (23 - 10) + 1) << 23);
+    OIIO_SIMD_UINT4_CONST(normal_bias,     0xfffu - ((127u - 15u) << 23));
+    __m128  justsign    = _mm_and_ps (_mm_castsi128_ps(CONSTI(mask_sign)), m_simd);
+    __m128  absf        = _mm_xor_ps (m_simd, justsign);
+    __m128i absf_int    = _mm_castps_si128 (absf);
+    __m128  b_isnan     = _mm_cmpunord_ps (absf, absf);
+    __m128i b_isregular = _mm_cmpgt_epi32 (CONSTI(f16max), absf_int);
+    __m128i nan_bit     = _mm_and_si128 (_mm_castps_si128(b_isnan), CONSTI(nanbit));
+    __m128i inf_or_nan  = _mm_or_si128 (nan_bit, CONSTI(infty_as_fp16));
+    __m128i b_issub     = _mm_cmpgt_epi32 (CONSTI(min_normal), absf_int);
+    // Results that are subnormal halfs: let the FP add do the rounding
+    __m128  subnorm1    = _mm_add_ps (absf, _mm_castsi128_ps(CONSTI(subnorm_magic)));
+    __m128i subnorm2    = _mm_sub_epi32 (_mm_castps_si128(subnorm1), CONSTI(subnorm_magic));
+    // Normal results: rebias the exponent and round the mantissa to even
+    __m128i mantodd     = _mm_srai_epi32 (_mm_slli_epi32 (absf_int, 31 - 13), 31);
+    __m128i round1      = _mm_add_epi32 (absf_int, CONSTI(normal_bias));
+    __m128i normal      = _mm_srli_epi32 (_mm_sub_epi32 (round1, mantodd), 13);
+    __m128i nonspecial  = _mm_or_si128 (_mm_and_si128 (subnorm2, b_issub),
+                                        _mm_andnot_si128 (b_issub, normal));
+    __m128i joined      = _mm_or_si128 (_mm_and_si128 (nonspecial, b_isregular),
+                                        _mm_andnot_si128 (b_isregular, inf_or_nan));
+    // The arithmetic shift of the sign leaves each lane in int16 range,
+    // so the signed saturating pack just keeps the low 16 bits.
+    __m128i sign_shift  = _mm_srai_epi32 (_mm_castps_si128(justsign), 16);
+    __m128i final       = _mm_or_si128 (joined, sign_shift);
+    // ~28 SSE2 ops.
+    _mm_storel_epi64 ((__m128i *)values, _mm_packs_epi32 (final, final));
+# undef CONSTI
+#else
+    SIMD_DO (values[i] = m_val[i]);
+#endif
+}
+#endif
+
+OIIO_FORCEINLINE float4 operator+ (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_add_ps (a.m_simd, b.m_simd);
+#elif defined(OIIO_SIMD_NEON)
+    return vaddq_f32 (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (float4, a[i] + b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const float4 & float4::operator+= (const float4& a) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_add_ps (m_simd, a.m_simd);
+#elif defined(OIIO_SIMD_NEON)
+    m_simd = vaddq_f32 (m_simd, a.m_simd);
+#else
+    SIMD_DO (m_val[i] += a[i]);
+#endif
+    return *this;
+    }
+
+OIIO_FORCEINLINE float4 float4::operator- () const {
+#if OIIO_SIMD_SSE
+    return _mm_sub_ps (_mm_setzero_ps(), m_simd);
+#elif defined(OIIO_SIMD_NEON)
+    return vsubq_f32 (Zero(), m_simd);
+#else
+    SIMD_RETURN (float4, -m_val[i]);
+#endif
+}
+
+OIIO_FORCEINLINE float4 operator- (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_sub_ps (a.m_simd, b.m_simd);
+#elif defined(OIIO_SIMD_NEON)
+    return vsubq_f32 (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (float4, a[i] - b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const float4 & float4::operator-= (const float4& a) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_sub_ps (m_simd, a.m_simd);
+#elif defined(OIIO_SIMD_NEON)
+    m_simd = vsubq_f32 (m_simd, a.m_simd);
+#else
+    SIMD_DO (m_val[i] -= a[i]);
+#endif
+    return *this;
+}
+
+OIIO_FORCEINLINE float4 operator* (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_mul_ps (a.m_simd, b.m_simd);
+#elif defined(OIIO_SIMD_NEON)
+    return vmulq_f32 (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (float4, a[i] * b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const float4 & float4::operator*= (const float4& a) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_mul_ps (m_simd, a.m_simd);
+#elif defined(OIIO_SIMD_NEON)
+    m_simd = vmulq_f32 (m_simd, a.m_simd);
+#else
+    SIMD_DO (m_val[i] *= a[i]);
+#endif
+    return *this;
+}
+
+OIIO_FORCEINLINE const float4 & float4::operator*= (float val) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_mul_ps (m_simd, _mm_set1_ps(val));
+#elif defined(OIIO_SIMD_NEON)
+    m_simd = vmulq_f32 (m_simd, vdupq_n_f32(val));
+#else
+    SIMD_DO (m_val[i] *= val);
+#endif
+    return *this;
+}
+
+OIIO_FORCEINLINE float4 operator/ (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_div_ps (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (float4, a[i] / b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const float4 & float4::operator/= (const float4& a) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_div_ps (m_simd, a.m_simd);
+#else
+    SIMD_DO (m_val[i] /= a[i]);
+#endif
+    return *this;
+}
+
+OIIO_FORCEINLINE const float4 & float4::operator/= (float val) {
+#if OIIO_SIMD_SSE
+    m_simd = _mm_div_ps (m_simd, _mm_set1_ps(val));
+#else
+    SIMD_DO (m_val[i] /= val);
+#endif
+    return *this;
+}
+
+OIIO_FORCEINLINE bool4 operator== (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_cmpeq_ps (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (bool4, a[i] == b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool4 operator!= (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_cmpneq_ps (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (bool4, a[i] != b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool4 operator< (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_cmplt_ps (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (bool4, a[i] < b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool4 operator>  (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_cmpgt_ps (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (bool4, a[i] > b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool4 operator>= (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_cmpge_ps (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (bool4, a[i] >= b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool4 operator<= (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_cmple_ps (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (bool4, a[i] <= b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE float4 AxyBxy (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_movelh_ps (a.m_simd, b.m_simd);
+#else
+    return float4 (a[0], a[1], b[0], b[1]);
+#endif
+}
+
+OIIO_FORCEINLINE float4 AxBxAyBy (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_unpacklo_ps (a.m_simd, b.m_simd);
+#else
+    return float4 (a[0], b[0], a[1], b[1]);
+#endif
+}
+
+OIIO_FORCEINLINE float4 float4::xyz0 () const {
+    return insert<3>(*this, 0.0f);
+}
+
+OIIO_FORCEINLINE float4 float4::xyz1 () const {
+    return insert<3>(*this, 1.0f);
+}
+
+inline std::ostream& operator<< (std::ostream& cout, const float4& val) {
+    cout << val[0];
+    for (int i = 1; i < val.elements; ++i)
+        cout << ' ' << val[i];
+    return cout;
+}
+
+
+// Implementation had to be after the definition of float4.
+OIIO_FORCEINLINE int4::int4 (const float4& f)
+{
+#if OIIO_SIMD_SSE
+    m_simd = _mm_cvttps_epi32(f.simd());
+#else
+    SIMD_CONSTRUCT ((int) f[i]);
+#endif
+}
+
+
+template<int i0, int i1, int i2, int i3>
+OIIO_FORCEINLINE float4 shuffle (const float4& a) {
+#if OIIO_SIMD_SSE
+    return shuffle_sse<i0,i1,i2,i3> (__m128(a));
+#else
+    return float4(a[i0], a[i1], a[i2], a[i3]);
+#endif
+}
+
+template<int i> OIIO_FORCEINLINE float4 shuffle (const float4& a) { return shuffle<i,i,i,i>(a); }
+
+#if defined(OIIO_SIMD_NEON)
+template<> OIIO_FORCEINLINE float4 shuffle<0> (const float4& a) {
+    float32x2_t t = vget_low_f32(a.m_simd); return vdupq_lane_f32(t,0);
+}
+template<> OIIO_FORCEINLINE float4 shuffle<1> (const float4& a) {
+    float32x2_t t = vget_low_f32(a.m_simd); return vdupq_lane_f32(t,1);
+}
+template<> OIIO_FORCEINLINE float4 shuffle<2> (const float4& a) {
+    float32x2_t t = vget_high_f32(a.m_simd); return vdupq_lane_f32(t,0);
+}
+template<> OIIO_FORCEINLINE float4 shuffle<3> (const float4& a) {
+    float32x2_t t = vget_high_f32(a.m_simd); return vdupq_lane_f32(t,1);
+}
+#endif
+
+
+
+/// Helper: as rapid as possible extraction of one component, when the
+/// index is fixed.
+template<int i>
+OIIO_FORCEINLINE float extract (const float4& a) {
+#if OIIO_SIMD_SSE
+    return _mm_cvtss_f32(shuffle_sse<i,i,i,i>(a.simd()));
+#else
+    return a[i];
+#endif
+}
+
+#if OIIO_SIMD_SSE
+template<> OIIO_FORCEINLINE float extract<0> (const float4& a) {
+    return _mm_cvtss_f32(a.simd());
+}
+#endif
+
+
+/// Helper: substitute val for a[i]
+template<int i>
+OIIO_FORCEINLINE float4 insert (const float4& a, float val) {
+#if OIIO_SIMD_SSE >= 4
+    return _mm_insert_ps (a, _mm_set_ss(val), i<<4);
+#else
+    float4 tmp = a;
+    tmp[i] = val;
+    return tmp;
+#endif
+}
+
+#if OIIO_SIMD_SSE
+// Slightly faster special cases for SSE
+template<> OIIO_FORCEINLINE float4 insert<0> (const float4& a, float val) {
+    return _mm_move_ss (a.simd(), _mm_set_ss(val));
+}
+#endif
+
+
+OIIO_FORCEINLINE float float4::x () const { return extract<0>(*this); }
+OIIO_FORCEINLINE float float4::y () const { return extract<1>(*this); }
+OIIO_FORCEINLINE float float4::z () const { return extract<2>(*this); }
+OIIO_FORCEINLINE float float4::w () const { return extract<3>(*this); }
+OIIO_FORCEINLINE void float4::set_x (float val) { *this = insert<0>(*this, val); }
+OIIO_FORCEINLINE void float4::set_y (float val) { *this = insert<1>(*this, val); }
+OIIO_FORCEINLINE void float4::set_z (float val) { *this = insert<2>(*this, val); }
+OIIO_FORCEINLINE void float4::set_w (float val) { *this = insert<3>(*this, val); }
+
+
+OIIO_FORCEINLINE int4 bitcast_to_int (const float4& x)
+{
+#if OIIO_SIMD_SSE
+    return _mm_castps_si128 (x.simd());
+#else
+    return *(int4 *)&x;
+#endif
+}
+
+OIIO_FORCEINLINE float4 bitcast_to_float (const int4& x)
+{
+#if OIIO_SIMD_SSE
+    return _mm_castsi128_ps (x.simd());
+#else
+    return *(float4 *)&x;
+#endif
+}
+
+
+// Old names:
+inline int4 bitcast_to_int4 (const float4& x) { return bitcast_to_int(x); }
+inline float4 bitcast_to_float4 (const int4& x) { return bitcast_to_float(x); }
+
+
+
+OIIO_FORCEINLINE float4 vreduce_add (const float4& v) {
+#if OIIO_SIMD_SSE >= 3
+    // People seem to agree that SSE3 does add reduction best with 2
+    // horizontal adds.
+    // suppose v = (a, b, c, d)
+    simd::float4 ab_cd = _mm_hadd_ps (v.simd(), v.simd());
+    // ab_cd = (a+b, c+d, a+b, c+d)
+    simd::float4 abcd = _mm_hadd_ps (ab_cd.simd(), ab_cd.simd());
+    // all abcd elements are a+b+c+d
+    return abcd;
+#elif defined(OIIO_SIMD_SSE)
+    // I think this is the best we can do for SSE2, and I'm still not sure
+    // it's faster than the default scalar operation. But anyway...
+    // suppose v = (a, b, c, d)
+    float4 ab_ab_cd_cd = shuffle<1,0,3,2>(v) + v;
+    // now x = (b,a,d,c) + (a,b,c,d) = (a+b,a+b,c+d,c+d)
+    float4 cd_cd_ab_ab = shuffle<2,3,0,1>(ab_ab_cd_cd);
+    // now y = (c+d,c+d,a+b,a+b)
+    float4 abcd = ab_ab_cd_cd + cd_cd_ab_ab;   // a+b+c+d in all components
+    return abcd;
+#else
+    return float4 (v[0] + v[1] + v[2] + v[3]);
+#endif
+}
+
+
+OIIO_FORCEINLINE float reduce_add (const float4& v) {
+#if OIIO_SIMD_SSE
+    return _mm_cvtss_f32(vreduce_add (v));
+#else
+    return v[0] + v[1] + v[2] + v[3];
+#endif
+}
+
+OIIO_FORCEINLINE float4 vdot (const float4 &a, const float4 &b) {
+#if OIIO_SIMD_SSE >= 4
+    return _mm_dp_ps (a.simd(), b.simd(), 0xff);
+#elif OIIO_SIMD_NEON
+    float32x4_t ab = vmulq_f32(a, b);
+    float32x4_t sum1 = vaddq_f32(ab, vrev64q_f32(ab));
+    return vaddq_f32(sum1, vcombine_f32(vget_high_f32(sum1), vget_low_f32(sum1)));
+#else
+    return vreduce_add (a*b);
+#endif
+}
+
+OIIO_FORCEINLINE float dot (const float4 &a, const float4 &b) {
+#if OIIO_SIMD_SSE >= 4
+    return _mm_cvtss_f32 (_mm_dp_ps (a.simd(), b.simd(), 0xff));
+#else
+    return reduce_add (a*b);
+#endif
+}
+
+OIIO_FORCEINLINE float4 vdot3 (const float4 &a, const float4 &b) {
+#if OIIO_SIMD_SSE >= 4
+    return _mm_dp_ps (a.simd(), b.simd(), 0x7f);
+#else
+    return vreduce_add((a*b).xyz0());
+#endif
+}
+
+OIIO_FORCEINLINE float dot3 (const float4 &a, const float4 &b) {
+#if OIIO_SIMD_SSE >= 4
+    return _mm_cvtss_f32 (_mm_dp_ps (a.simd(), b.simd(), 0x77));
+#else
+    return reduce_add ((a*b).xyz0());
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 blend (const float4& a, const float4& b, const bool4& mask)
+{
+#if OIIO_SIMD_SSE >= 4
+    // SSE >= 4.1 only
+    return _mm_blendv_ps (a.simd(), b.simd(), mask.simd());
+#elif defined(OIIO_SIMD_SSE)
+    // Trick for SSE < 4.1
+    return _mm_or_ps (_mm_and_ps(mask.simd(), b.simd()),
+                      _mm_andnot_ps(mask.simd(), a.simd()));
+#else
+    return float4 (mask[0] ? b[0] : a[0],
+                   mask[1] ? b[1] : a[1],
+                   mask[2] ? b[2] : a[2],
+                   mask[3] ? b[3] : a[3]);
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 blend0 (const float4& a, const bool4& mask)
+{
+#if OIIO_SIMD_SSE
+    return _mm_and_ps(mask.simd(), a.simd());
+#else
+    return float4 (mask[0] ? a[0] : 0.0f,
+                   mask[1] ? a[1] : 0.0f,
+                   mask[2] ? a[2] : 0.0f,
+                   mask[3] ? a[3] : 0.0f);
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 blend0not (const float4& a, const bool4& mask)
+{
+#if OIIO_SIMD_SSE
+    return _mm_andnot_ps(mask.simd(), a.simd());
+#else
+    return float4 (mask[0] ? 0.0f : a[0],
+                   mask[1] ? 0.0f : a[1],
+                   mask[2] ? 0.0f : a[2],
+                   mask[3] ? 0.0f : a[3]);
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 safe_div (const float4 &a, const float4 &b) {
+#if OIIO_SIMD_SSE
+    return blend0not (a/b, b == float4::Zero());
+#else
+    return float4 (b[0] == 0.0f ? 0.0f : a[0] / b[0],
+                   b[1] == 0.0f ? 0.0f : a[1] / b[1],
+                   b[2] == 0.0f ? 0.0f : a[2] / b[2],
+                   b[3] == 0.0f ? 0.0f : a[3] / b[3]);
+#endif
+}
+
+
+OIIO_FORCEINLINE float3 hdiv (const float4 &a)
+{
+#if OIIO_SIMD_SSE
+    return float3(safe_div(a, shuffle<3>(a)).xyz0());
+#else
+    float d = a[3];
+    return d == 0.0f ? float3 (0.0f) : float3 (a[0]/d, a[1]/d, a[2]/d);
+#endif
+}
+
+
+
+OIIO_FORCEINLINE float4 select (const bool4& mask, const float4& a, const float4& b)
+{
+    return blend (b, a, mask);
+}
+
+
+OIIO_FORCEINLINE float4 abs (const float4& a)
+{
+#if OIIO_SIMD_SSE
+    // Just clear the sign bit for cheap fabsf
+    return _mm_and_ps (a.simd(), _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+#else
+    SIMD_RETURN (float4, fabsf(a[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 sign (const float4& a)
+{
+    float4 one(1.0f);
+    return blend (one, -one, a < float4::Zero());
+}
+
+
+OIIO_FORCEINLINE float4 ceil (const float4& a)
+{
+#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
+    return _mm_ceil_ps (a);
+#else
+    SIMD_RETURN (float4, ceilf(a[i]));
+#endif
+}
+
+OIIO_FORCEINLINE float4 floor (const float4& a)
+{
+#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
+    return _mm_floor_ps (a);
+#else
+    SIMD_RETURN (float4, floorf(a[i]));
+#endif
+}
+
+OIIO_FORCEINLINE float4 round (const float4& a)
+{
+#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
+    return _mm_round_ps (a, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
+#else
+    SIMD_RETURN (float4, roundf(a[i]));
+#endif
+}
+
+OIIO_FORCEINLINE int4 floori (const float4& a)
+{
+#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
+    return int4(floor(a));
+#elif defined(OIIO_SIMD_SSE)   /* SSE2/3 */
+    int4 i (a);  // truncates
+    int4 isneg = bitcast_to_int (a < float4::Zero());
+    return i + isneg;
+    // The trick here (thanks, Cycles, for letting me spy on your code) is
+    // that the comparison will return (int)-1 for components that are less
+    // than zero, and adding that is the same as subtracting one!
+#else
+    SIMD_RETURN (int4, (int)floorf(a[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE int4 rint (const float4& a)
+{
+    return int4 (round(a));
+}
+
+
+OIIO_FORCEINLINE float4 sqrt (const float4 &a)
+{
+#if OIIO_SIMD_SSE
+    return _mm_sqrt_ps (a.simd());
+#else
+    SIMD_RETURN (float4, sqrtf(a[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 rsqrt (const float4 &a)
+{
+#if OIIO_SIMD_SSE
+    return _mm_div_ps (_mm_set1_ps(1.0f), _mm_sqrt_ps (a.simd()));
+#else
+    SIMD_RETURN (float4, 1.0f/sqrtf(a[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 rsqrt_fast (const float4 &a)
+{
+#if OIIO_SIMD_SSE
+    return _mm_rsqrt_ps (a.simd());
+#else
+    SIMD_RETURN (float4, 1.0f/sqrtf(a[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 min (const float4& a, const float4& b)
+{
+#if OIIO_SIMD_SSE
+    return _mm_min_ps (a, b);
+#else
+    SIMD_RETURN (float4, std::min (a[i], b[i]));
+#endif
+}
+
+OIIO_FORCEINLINE float4 max (const float4& a, const float4& b)
+{
+#if OIIO_SIMD_SSE
+    return _mm_max_ps (a, b);
+#else
+    SIMD_RETURN (float4, std::max (a[i], b[i]));
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 andnot (const float4& a, const float4& b) {
+#if OIIO_SIMD_SSE
+    return _mm_andnot_ps (a.simd(), b.simd());
+#else
+    const int *ai = (const int *)&a;
+    const int *bi = (const int *)&b;
+    return bitcast_to_float (int4(~(ai[0]) & bi[0],
+                                  ~(ai[1]) & bi[1],
+                                  ~(ai[2]) & bi[2],
+                                  ~(ai[3]) & bi[3]));
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 madd (const simd::float4& a, const simd::float4& b,
+                              const simd::float4& c)
+{
+#if OIIO_SIMD_SSE && OIIO_FMA_ENABLED
+    // If we are sure _mm_fmadd_ps intrinsic is available, use it.
+    return _mm_fmadd_ps (a, b, c);
+#elif OIIO_SIMD_SSE && !defined(_MSC_VER)
+    // If we directly access the underlying __m128, on some platforms and
+    // compiler flags, it will turn into fma anyway, even if we don't use
+    // the intrinsic.
+    return a.simd() * b.simd() + c.simd();
+#else
+    // Fallback: just use regular math and hope for the best.
+    return a * b + c;
+#endif
+}
+
+
+OIIO_FORCEINLINE float4 msub (const simd::float4& a, const simd::float4& b,
+                              const simd::float4& c)
+{
+#if OIIO_SIMD_SSE && OIIO_FMA_ENABLED
+    // If we are sure _mm_fnmsub_ps intrinsic is available, use it.
+    return _mm_fmsub_ps (a, b, c);
+#elif OIIO_SIMD_SSE && !defined(_MSC_VER)
+    // If we directly access the underlying __m128, on some platforms and
+    // compiler flags, it will turn into fma anyway, even if we don't use
+    // the intrinsic.
+    return a.simd() * b.simd() - c.simd();
+#else
+    // Fallback: just use regular math and hope for the best.
+    return a * b - c;
+#endif
+}
+
+
+
+OIIO_FORCEINLINE float4 nmadd (const simd::float4& a, const simd::float4& b,
+                               const simd::float4& c)
+{
+#if OIIO_SIMD_SSE && OIIO_FMA_ENABLED
+    // If we are sure _mm_fnmadd_ps intrinsic is available, use it.
+    return _mm_fnmadd_ps (a, b, c);
+#elif OIIO_SIMD_SSE && !defined(_MSC_VER)
+    // If we directly access the underlying __m128, on some platforms and
+    // compiler flags, it will turn into fma anyway, even if we don't use
+    // the intrinsic.
+    return c.simd() - a.simd() * b.simd();
+#else
+    // Fallback: just use regular math and hope for the best.
+    return c - a * b;
+#endif
+}
+
+
+
+OIIO_FORCEINLINE float4 nmsub (const simd::float4& a, const simd::float4& b,
+                               const simd::float4& c)
+{
+#if OIIO_SIMD_SSE && OIIO_FMA_ENABLED
+    // If we are sure _mm_fnmsub_ps intrinsic is available, use it.
+    return _mm_fnmsub_ps (a, b, c);
+#elif OIIO_SIMD_SSE && !defined(_MSC_VER)
+    // If we directly access the underlying __m128, on some platforms and
+    // compiler flags, it will turn into fma anyway, even if we don't use
+    // the intrinsic.
+    return -(a.simd() * b.simd()) - c.simd();
+#else
+    // Fallback: just use regular math and hope for the best.
+    return -(a * b) - c;
+#endif
+}
+
+
+
+// Full precision exp() of all components of a SIMD vector.
+template<typename T>
+OIIO_FORCEINLINE T exp (const T& v)
+{
+#if OIIO_SIMD_SSE
+    // Implementation inspired by:
+    // https://github.com/embree/embree/blob/master/common/simd/sse_special.h
+    // Which is listed as Copyright (C) 2007  Julien Pommier and distributed
+    // under the zlib license.
+    typedef typename T::int_t int_t;
+    T x = v;
+    const float exp_hi (88.3762626647949f);
+    const float exp_lo (-88.3762626647949f);
+    const float cephes_LOG2EF (1.44269504088896341f);
+    const float cephes_exp_C1 (0.693359375f);
+    const float cephes_exp_C2 (-2.12194440e-4f);
+    const float cephes_exp_p0 (1.9875691500E-4f);
+    const float cephes_exp_p1 (1.3981999507E-3f);
+    const float cephes_exp_p2 (8.3334519073E-3f);
+    const float cephes_exp_p3 (4.1665795894E-2f);
+    const float cephes_exp_p4 (1.6666665459E-1f);
+    const float cephes_exp_p5 (5.0000001201E-1f);
+    T tmp (0.0f);
+    T one (1.0f);
+    x = min (x, T(exp_hi));
+    x = max (x, T(exp_lo));
+    T fx = madd (x, T(cephes_LOG2EF), T(0.5f));
+    int_t emm0 = int_t(fx);
+    tmp = T(emm0);
+    T mask = bitcast_to_float (bitcast_to_int(tmp > fx) & bitcast_to_int(one));
+    fx = tmp - mask;
+    tmp = fx * cephes_exp_C1;
+    T z = fx * cephes_exp_C2;
+    x = x - tmp;
+    x = x - z;
+    z = x * x;
+    T y = cephes_exp_p0;
+    y = madd (y, x, cephes_exp_p1);
+    y = madd (y, x, cephes_exp_p2);
+    y = madd (y, x, cephes_exp_p3);
+    y = madd (y, x, cephes_exp_p4);
+    y = madd (y, x, cephes_exp_p5);
+    y = madd (y, z, x);
+    y = y + one;
+    emm0 = (int_t(fx) + int_t(0x7f)) << 23;
+    T pow2n = bitcast_to_float(emm0);
+    y = y * pow2n;
+    return y;
+#else
+    SIMD_RETURN (T, expf(v[i]));
+#endif
+}
+
+
+
+// Full precision log() of all components of a SIMD vector.
+template<typename T>
+OIIO_FORCEINLINE T log (const T& v)
+{
+#if OIIO_SIMD_SSE
+    // Implementation inspired by:
+    // https://github.com/embree/embree/blob/master/common/simd/sse_special.h
+    // Which is listed as Copyright (C) 2007  Julien Pommier and distributed
+    // under the zlib license.
+    typedef typename T::int_t int_t;
+    typedef typename T::bool_t bool_t;
+    T x = v;
+    int_t emm0;
+    T zero (T::Zero());
+    T one (1.0f);
+    bool_t invalid_mask = (x <= zero);
+    const int min_norm_pos ((int)0x00800000);
+    const int inv_mant_mask ((int)~0x7f800000);
+    x = max(x, bitcast_to_float(int_t(min_norm_pos)));  /* cut off denormalized stuff */
+    emm0 = srl (bitcast_to_int(x), 23);
+    /* keep only the fractional part */
+    x = bitcast_to_float (bitcast_to_int(x) & int_t(inv_mant_mask));
+    x = bitcast_to_float (bitcast_to_int(x) | bitcast_to_int(T(0.5f)));
+    emm0 = emm0 - int_t(0x7f);
+    T e (emm0);
+    e = e + one;
+    // OIIO_SIMD_FLOAT4_CONST (cephes_SQRTHF, 0.707106781186547524f);
+    const float cephes_SQRTHF (0.707106781186547524f);
+    bool_t mask = (x < T(cephes_SQRTHF));
+    T tmp = bitcast_to_float (bitcast_to_int(x) & bitcast_to_int(mask));
+    x = x - one;
+    e = e - bitcast_to_float (bitcast_to_int(one) & bitcast_to_int(mask));
+    x = x + tmp;
+    T z = x * x;
+    const float cephes_log_p0 (7.0376836292E-2f);
+    const float cephes_log_p1 (- 1.1514610310E-1f);
+    const float cephes_log_p2 (1.1676998740E-1f);
+    const float cephes_log_p3 (- 1.2420140846E-1f);
+    const float cephes_log_p4 (+ 1.4249322787E-1f);
+    const float cephes_log_p5 (- 1.6668057665E-1f);
+    const float cephes_log_p6 (+ 2.0000714765E-1f);
+    const float cephes_log_p7 (- 2.4999993993E-1f);
+    const float cephes_log_p8 (+ 3.3333331174E-1f);
+    const float cephes_log_q1 (-2.12194440e-4f);
+    const float cephes_log_q2 (0.693359375f);
+    T y = cephes_log_p0;
+    y = madd (y, x, T(cephes_log_p1));
+    y = madd (y, x, T(cephes_log_p2));
+    y = madd (y, x, T(cephes_log_p3));
+    y = madd (y, x, T(cephes_log_p4));
+    y = madd (y, x, T(cephes_log_p5));
+    y = madd (y, x, T(cephes_log_p6));
+    y = madd (y, x, T(cephes_log_p7));
+    y = madd (y, x, T(cephes_log_p8));
+    y = y * x;
+    y = y * z;
+    y = madd(e, T(cephes_log_q1), y);
+    y = nmadd (z, 0.5f, y);
+    x = x + y;
+    x = madd (e, T(cephes_log_q2), x);
+    x = bitcast_to_float (bitcast_to_int(x) | bitcast_to_int(invalid_mask)); // negative arg will be NAN
+    return x;
+#else
+    SIMD_RETURN (T, logf(v[i]));
+#endif
+}
+
+
+
+OIIO_FORCEINLINE void transpose (float4 &a, float4 &b, float4 &c, float4 &d)
+{
+#if OIIO_SIMD_SSE
+    _MM_TRANSPOSE4_PS (a, b, c, d);
+#else
+    float4 A (a[0], b[0], c[0], d[0]);
+    float4 B (a[1], b[1], c[1], d[1]);
+    float4 C (a[2], b[2], c[2], d[2]);
+    float4 D (a[3], b[3], c[3], d[3]);
+    a = A;  b = B;  c = C;  d = D;
+#endif
+}
+
+
+OIIO_FORCEINLINE void transpose (const float4& a, const float4& b, const float4& c, const float4& d,
+                                 float4 &r0, float4 &r1, float4 &r2, float4 &r3)
+{
+#if OIIO_SIMD_SSE
+    //_MM_TRANSPOSE4_PS (a, b, c, d);
+    float4 l02 = _mm_unpacklo_ps (a, c);
+    float4 h02 = _mm_unpackhi_ps (a, c);
+    float4 l13 = _mm_unpacklo_ps (b, d);
+    float4 h13 = _mm_unpackhi_ps (b, d);
+    r0 = _mm_unpacklo_ps (l02, l13);
+    r1 = _mm_unpackhi_ps (l02, l13);
+    r2 = _mm_unpacklo_ps (h02, h13);
+    r3 = _mm_unpackhi_ps (h02, h13);
+#else
+    r0.load (a[0], b[0], c[0], d[0]);
+    r1.load (a[1], b[1], c[1], d[1]);
+    r2.load (a[2], b[2], c[2], d[2]);
+    r3.load (a[3], b[3], c[3], d[3]);
+#endif
+}
+
+
+OIIO_FORCEINLINE void transpose (int4 &a, int4 &b, int4 &c, int4 &d)
+{
+#if OIIO_SIMD_SSE
+    __m128 A = _mm_castsi128_ps (a);
+    __m128 B = _mm_castsi128_ps (b);
+    __m128 C = _mm_castsi128_ps (c);
+    __m128 D = _mm_castsi128_ps (d);
+    _MM_TRANSPOSE4_PS (A, B, C, D);
+    a = _mm_castps_si128 (A);
+    b = _mm_castps_si128 (B);
+    c = _mm_castps_si128 (C);
+    d = _mm_castps_si128 (D);
+#else
+    int4 A (a[0], b[0], c[0], d[0]);
+    int4 B (a[1], b[1], c[1], d[1]);
+    int4 C (a[2], b[2], c[2], d[2]);
+    int4 D (a[3], b[3], c[3], d[3]);
+    a = A;  b = B;  c = C;  d = D;
+#endif
+}
+
+OIIO_FORCEINLINE void transpose (const int4& a, const int4& b, const int4& c, const int4& d,
+                                 int4 &r0, int4 &r1, int4 &r2, int4 &r3)
+{
+#if OIIO_SIMD_SSE
+    //_MM_TRANSPOSE4_PS (a, b, c, d);
+    __m128 A = _mm_castsi128_ps (a);
+    __m128 B = _mm_castsi128_ps (b);
+    __m128 C = _mm_castsi128_ps (c);
+    __m128 D = _mm_castsi128_ps (d);
+    _MM_TRANSPOSE4_PS (A, B, C, D);
+    r0 = _mm_castps_si128 (A);
+    r1 = _mm_castps_si128 (B);
+    r2 = _mm_castps_si128 (C);
+    r3 = _mm_castps_si128 (D);
 #else
-    SIMD_RETURN (int8, a[i] + b[i]);
+    r0.load (a[0], b[0], c[0], d[0]);
+    r1.load (a[1], b[1], c[1], d[1]);
+    r2.load (a[2], b[2], c[2], d[2]);
+    r3.load (a[3], b[3], c[3], d[3]);
 #endif
 }
 
 
-OIIO_FORCEINLINE const int8& operator+= (int8& a, const int8& b) {
-    return a = a + b;
-}
-
-
-OIIO_FORCEINLINE int8 operator- (const int8& a) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_sub_epi32 (_mm256_setzero_si256(), a);
+OIIO_FORCEINLINE float4 AxBxCxDx (const float4& a, const float4& b,
+                                  const float4& c, const float4& d)
+{
+#if OIIO_SIMD_SSE
+    float4 l02 = _mm_unpacklo_ps (a, c);
+    float4 l13 = _mm_unpacklo_ps (b, d);
+    return _mm_unpacklo_ps (l02, l13);
 #else
-    SIMD_RETURN (int8, -a[i]);
+    return float4 (a[0], b[0], c[0], d[0]);
 #endif
 }
 
 
-OIIO_FORCEINLINE int8 operator- (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_sub_epi32 (a.simd(), b.simd());
+OIIO_FORCEINLINE int4 AxBxCxDx (const int4& a, const int4& b,
+                                const int4& c, const int4& d)
+{
+#if OIIO_SIMD_SSE
+    int4 l02 = _mm_unpacklo_epi32 (a, c);
+    int4 l13 = _mm_unpacklo_epi32 (b, d);
+    return _mm_unpacklo_epi32 (l02, l13);
 #else
-    SIMD_RETURN (int8, a[i] - b[i]);
+    return int4 (a[0], b[0], c[0], d[0]);
 #endif
 }
 
 
-OIIO_FORCEINLINE const int8 &operator-= (int8& a, const int8& b) {
-    return a = a - b;
-}
 
+//////////////////////////////////////////////////////////////////////
+// float3 implementation
 
-OIIO_FORCEINLINE int8 operator* (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_mullo_epi32 (a.simd(), b.simd());
+OIIO_FORCEINLINE float3::float3 (const float3 &other) {
+#if defined(OIIO_SIMD_SSE) || defined(OIIO_SIMD_NEON)
+    m_simd = other.m_simd;
 #else
-    SIMD_RETURN (int8, a[i] * b[i]);
+    SIMD_CONSTRUCT_PAD (other[i]);
 #endif
 }
 
-
-OIIO_FORCEINLINE const int8& operator*= (int8& a, const int8& b) { return a = a * b; }
-OIIO_FORCEINLINE const int8& operator*= (int8& a, int b) { return a = a * b; }
-
-
-OIIO_FORCEINLINE int8 operator/ (const int8& a, const int8& b) {
-    // NO INTEGER DIVISION IN SSE or AVX!
-    SIMD_RETURN (int8, a[i] / b[i]);
+OIIO_FORCEINLINE float3::float3 (const float4 &other) {
+#if defined(OIIO_SIMD_SSE) || defined(OIIO_SIMD_NEON)
+    m_simd = other.simd();
+#else
+    SIMD_CONSTRUCT_PAD (other[i]);
+    m_val[3] = 0.0f;
+#endif
 }
 
-OIIO_FORCEINLINE const int8& operator/= (int8& a, const int8& b) { return a = a / b; }
+OIIO_FORCEINLINE const float3 float3::Zero () { return float3(float4::Zero()); }
 
+OIIO_FORCEINLINE const float3 float3::One () { return float3(1.0f); }
 
-OIIO_FORCEINLINE int8 operator% (const int8& a, const int8& b) {
-    // NO INTEGER MODULUS IN SSE or AVX!
-    SIMD_RETURN (int8, a[i] % b[i]);
+OIIO_FORCEINLINE const float3 float3::Iota (float start, float step) {
+    return float3 (start+0.0f*step, start+1.0f*step, start+2.0f*step);
 }
 
-OIIO_FORCEINLINE const int8& operator%= (int8& a, const int8& b) { return a = a % b; }
-
-OIIO_FORCEINLINE int8 operator% (const int8& a, int w) {
-    // NO INTEGER MODULUS in SSE or AVX!
-    SIMD_RETURN (int8, a[i] % w);
-}
 
-OIIO_FORCEINLINE const int8& operator%= (int8& a, int b) { return a = a % b; }
+OIIO_FORCEINLINE void float3::load (float val) { float4::load (val, val, val, 0.0f); }
 
+OIIO_FORCEINLINE void float3::load (const float *values) { float4::load (values, 3); }
 
-OIIO_FORCEINLINE int8 operator& (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_and_si256 (a.simd(), b.simd());
-#else
-    SIMD_RETURN (int8, a[i] & b[i]);
-#endif
+OIIO_FORCEINLINE void float3::load (const float *values, int n) {
+    float4::load (values, n);
 }
 
-OIIO_FORCEINLINE const int8& operator&= (int8& a, const int8& b) { return a = a & b; }
-
-OIIO_FORCEINLINE int8 operator| (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_or_si256 (a.simd(), b.simd());
-#else
-    SIMD_RETURN (int8, a[i] | b[i]);
-#endif
+OIIO_FORCEINLINE void float3::load (const unsigned short *values) {
+    float4::load (float(values[0]), float(values[1]), float(values[2]));
 }
 
-OIIO_FORCEINLINE const int8& operator|= (int8& a, const int8& b) { return a = a | b; }
-
-OIIO_FORCEINLINE int8 operator^ (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_xor_si256 (a.simd(), b.simd());
-#else
-    SIMD_RETURN (int8, a[i] ^ b[i]);
-#endif
+OIIO_FORCEINLINE void float3::load (const short *values) {
+    float4::load (float(values[0]), float(values[1]), float(values[2]));
 }
 
-OIIO_FORCEINLINE const int8& operator^= (int8& a, const int8& b) { return a = a ^ b; }
-
-
-OIIO_FORCEINLINE int8 operator~ (const int8& a) {
-#if OIIO_SIMD_AVX >= 2
-    return a ^ a.NegOne();
-#else
-    SIMD_RETURN (int8, ~a[i]);
-#endif
+OIIO_FORCEINLINE void float3::load (const unsigned char *values) {
+    float4::load (float(values[0]), float(values[1]), float(values[2]));
 }
 
-
-OIIO_FORCEINLINE int8 operator<< (const int8& a, unsigned int bits) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_slli_epi32 (a, bits);
-#elif OIIO_SIMD_SSE
-    return int8 (a.lo() << bits, a.hi() << bits);
-#else
-    SIMD_RETURN (int8, a[i] << bits);
-#endif
+OIIO_FORCEINLINE void float3::load (const char *values) {
+    float4::load (float(values[0]), float(values[1]), float(values[2]));
 }
 
-
-OIIO_FORCEINLINE const int8& operator<<= (int8& a, const unsigned int bits) {
-    return a = a << bits;
+#ifdef _HALF_H_
+OIIO_FORCEINLINE void float3::load (const half *values) {
+    float4::load (float(values[0]), float(values[1]), float(values[2]));
 }
+#endif /* _HALF_H_ */
 
-OIIO_FORCEINLINE int8 operator>> (const int8& a, const unsigned int bits) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_srai_epi32 (a, bits);
-#elif OIIO_SIMD_SSE
-    return int8 (a.lo() >> bits, a.hi() >> bits);
-#else
-    SIMD_RETURN (int8, a[i] >> bits);
-#endif
+OIIO_FORCEINLINE void float3::store (float *values) const {
+    float4::store (values, 3);
 }
 
-OIIO_FORCEINLINE const int8& operator>>= (int8& a, const unsigned int bits) {
-    return a = a >> bits;
+OIIO_FORCEINLINE void float3::store (float *values, int n) const {
+    float4::store (values, n);
 }
 
-
-OIIO_FORCEINLINE int8 srl (const int8& a, const unsigned int bits) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_srli_epi32 (a, bits);
-#else
-    SIMD_RETURN (int8, int ((unsigned int)(a[i]) >> bits));
-#endif
+#ifdef _HALF_H_
+OIIO_FORCEINLINE void float3::store (half *values) const {
+    SIMD_DO (values[i] = m_val[i]);
 }
+#endif
 
+OIIO_FORCEINLINE void float3::store (Imath::V3f &vec) const {
+    store ((float *)&vec);
+}
 
-OIIO_FORCEINLINE bool8 operator== (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_castsi256_ps(_mm256_cmpeq_epi32 (a.m_simd, b.m_simd));
-#elif OIIO_SIMD_SSE  /* Fall back to 4-wide */
-    return bool8 (a.lo() == b.lo(), a.hi() == b.hi());
-#else
-    SIMD_RETURN (bool8, a[i] == b[i] ? -1 : 0);
-#endif
+OIIO_FORCEINLINE float3 operator+ (const float3& a, const float3& b) {
+    return float3 (float4(a) + float4(b));
 }
 
+OIIO_FORCEINLINE const float3 & float3::operator+= (const float3& a) {
+    *this = *this + a; return *this;
+}
 
-OIIO_FORCEINLINE bool8 operator!= (const int8& a, const int8& b) {
-    return ! (a == b);
+OIIO_FORCEINLINE float3 float3::operator- () const {
+    return float3 (-float4(*this));
 }
 
+OIIO_FORCEINLINE float3 operator- (const float3& a, const float3& b) {
+    return float3 (float4(a) - float4(b));
+}
 
-OIIO_FORCEINLINE bool8 operator> (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_castsi256_ps(_mm256_cmpgt_epi32 (a, b));
-#elif OIIO_SIMD_SSE  /* Fall back to 4-wide */
-    return bool8 (a.lo() > b.lo(), a.hi() > b.hi());
-#else
-    SIMD_RETURN (bool8, a[i] > b[i] ? -1 : 0);
-#endif
+OIIO_FORCEINLINE const float3 & float3::operator-= (const float3& a) {
+    *this = *this - a; return *this;
 }
 
+OIIO_FORCEINLINE float3 operator* (const float3& a, const float3& b) {
+    return float3 (float4(a) * float4(b));
+}
 
-OIIO_FORCEINLINE bool8 operator< (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    // No lt or lte!
-    return (b > a);
-#elif OIIO_SIMD_SSE  /* Fall back to 4-wide */
-    return bool8 (a.lo() < b.lo(), a.hi() < b.hi());
-#else
-    SIMD_RETURN (bool8, a[i] < b[i] ? -1 : 0);
-#endif
+OIIO_FORCEINLINE const float3 & float3::operator*= (const float3& a) {
+    *this = *this * a; return *this;
 }
 
+OIIO_FORCEINLINE const float3 & float3::operator*= (float a) {
+    *this = *this * a; return *this;
+}
 
-OIIO_FORCEINLINE bool8 operator>= (const int8& a, const int8& b) {
-    return (a > b) | (a == b);
+OIIO_FORCEINLINE float3 operator/ (const float3& a, const float3& b) {
+    return float3 (float4(a) / b.xyz1()); // Avoid divide by zero!
 }
 
+OIIO_FORCEINLINE const float3 & float3::operator/= (const float3& a) {
+    *this = *this / a; return *this;
+}
 
-OIIO_FORCEINLINE bool8 operator<= (const int8& a, const int8& b) {
-    return (b > a) | (a == b);
+OIIO_FORCEINLINE const float3 & float3::operator/= (float a) {
+    *this = *this / a; return *this;
 }
 
 
-inline std::ostream& operator<< (std::ostream& cout, const int8& val) {
+inline std::ostream& operator<< (std::ostream& cout, const float3& val) {
     cout << val[0];
     for (int i = 1; i < val.elements; ++i)
         cout << ' ' << val[i];
@@ -3617,367 +5816,451 @@ inline std::ostream& operator<< (std::ostream& cout, const int8& val) {
 }
 
 
-OIIO_FORCEINLINE void int8::store (int *values, int n) const {
-    DASSERT (n >= 0 && n <= elements);
-    // FIXME: is this faster with AVX masked stores?
+OIIO_FORCEINLINE float3 vreduce_add (const float3& v) {
 #if OIIO_SIMD_SSE
-    if (n <= 4) {
-        lo().store (values, n);
-    } else if (n <= 8) {
-        lo().store (values);
-        hi().store (values+4, n-4);
-    }
+    return float3 ((vreduce_add(float4(v))).xyz0());
+#else
+    return float3 (v[0] + v[1] + v[2]);
+#endif
+}
+
+
+OIIO_FORCEINLINE float3 vdot (const float3 &a, const float3 &b) {
+#if OIIO_SIMD_SSE >= 4
+    return float3(_mm_dp_ps (a.simd(), b.simd(), 0x77));
+#else
+    return vreduce_add (a*b);
+#endif
+}
+
+
+OIIO_FORCEINLINE float dot (const float3 &a, const float3 &b) {
+#if OIIO_SIMD_SSE >= 4
+    return _mm_cvtss_f32 (_mm_dp_ps (a.simd(), b.simd(), 0x77));
+#else
+    return reduce_add (a*b);
 #endif
-        for (int i = 0; i < n; ++i)
-            values[i] = m_val[i];
 }
 
 
-// FIXME(AVX): fast int8 store to unsigned short, unsigned char
-
-OIIO_FORCEINLINE void int8::store (unsigned short *values) const {
-#if 0 && OIIO_SIMD_AVX >= 2
-    // FIXME -- try to determine if this is faster:
-    lo().store (values);
-    hi().store (values+4);
+OIIO_FORCEINLINE float3 vdot3 (const float3 &a, const float3 &b) {
+#if OIIO_SIMD_SSE >= 4
+    return float3(_mm_dp_ps (a.simd(), b.simd(), 0x77));
 #else
-    SIMD_DO (values[i] = m_val[i]);
+    return float3 (vreduce_add((a*b).xyz0()).xyz0());
 #endif
 }
 
-
-OIIO_FORCEINLINE void int8::store (unsigned char *values) const {
-#if OIIO_SIMD_SSE
-    lo().store (values);
-    hi().store (values+4);
+OIIO_FORCEINLINE float3 float3::normalized () const
+{
+#if OIIO_SIMD
+    float3 len2 = vdot3 (*this, *this);
+    return float3 (safe_div (*this, sqrt(len2)));
 #else
-    SIMD_DO (values[i] = m_val[i]);
+    float len2 = dot (*this, *this);
+    return len2 > 0.0f ? (*this) / sqrtf(len2) : float3::Zero();
 #endif
 }
 
 
-template<int i0, int i1, int i2, int i3, int i4, int i5, int i6, int i7>
-OIIO_FORCEINLINE int8 shuffle (const int8& a) {
-#if OIIO_SIMD_AVX >= 2
-    int8 index (i0, i1, i2, i3, i4, i5, i6, i7);
-    return _mm256_castps_si256 (_mm256_permutevar8x32_ps (_mm256_castsi256_ps(a.simd()), index.simd()));
+OIIO_FORCEINLINE float3 float3::normalized_fast () const
+{
+#if OIIO_SIMD
+    float3 len2 = vdot3 (*this, *this);
+    float4 invlen = blend0not (rsqrt_fast (len2), len2 == float4::Zero());
+    return float3 ((*this) * invlen);
 #else
-    return int8 (a[i0], a[i1], a[i2], a[i3], a[i4], a[i5], a[i6], a[i7]);
+    float len2 = dot (*this, *this);
+    return len2 > 0.0f ? (*this) / sqrtf(len2) : float3::Zero();
 #endif
 }
 
-template<int i> OIIO_FORCEINLINE int8 shuffle (const int8& a) {
-    return shuffle<i,i,i,i,i,i,i,i>(a);
+
+
+//////////////////////////////////////////////////////////////////////
+// matrix44 implementation
+
+
+OIIO_FORCEINLINE const Imath::M44f& matrix44::M44f() const {
+    return *(Imath::M44f*)this;
 }
 
 
-template<int i>
-OIIO_FORCEINLINE int extract (const int8& v) {
-#if OIIO_SIMD_AVX && !_WIN32
-    return _mm256_extract_epi32(v.simd(), i);
+OIIO_FORCEINLINE float4 matrix44::operator[] (int i) const {
+#if OIIO_SIMD_SSE
+    return m_row[i];
 #else
-    return v[i];
+    return float4 (m_mat[i]);
 #endif
 }
 
 
-template<int i>
-OIIO_FORCEINLINE int8 insert (const int8& a, int val) {
-#if OIIO_SIMD_AVX && !_WIN32
-    return _mm256_insert_epi32 (a.simd(), val, i);
+OIIO_FORCEINLINE matrix44 matrix44::transposed () const {
+    matrix44 T;
+#if OIIO_SIMD_SSE
+    simd::transpose (m_row[0], m_row[1], m_row[2], m_row[3],
+                     T.m_row[0], T.m_row[1], T.m_row[2], T.m_row[3]);
 #else
-    int8 tmp = a;
-    tmp[i] = val;
-    return tmp;
+    T = m_mat.transposed();
 #endif
+    return T;
 }
 
-
-OIIO_FORCEINLINE int int8::x () const { return extract<0>(*this); }
-OIIO_FORCEINLINE int int8::y () const { return extract<1>(*this); }
-OIIO_FORCEINLINE int int8::z () const { return extract<2>(*this); }
-OIIO_FORCEINLINE int int8::w () const { return extract<3>(*this); }
-OIIO_FORCEINLINE void int8::set_x (int val) { *this = insert<0>(*this, val); }
-OIIO_FORCEINLINE void int8::set_y (int val) { *this = insert<1>(*this, val); }
-OIIO_FORCEINLINE void int8::set_z (int val) { *this = insert<2>(*this, val); }
-OIIO_FORCEINLINE void int8::set_w (int val) { *this = insert<3>(*this, val); }
-
-
-OIIO_FORCEINLINE int8 bitcast_to_int (const bool8& x)
-{
-#if OIIO_SIMD_AVX
-    return _mm256_castps_si256 (x.simd());
+OIIO_FORCEINLINE float3 matrix44::transformp (const float3 &V) const {
+#if OIIO_SIMD_SSE
+    float4 R = shuffle<0>(V) * m_row[0] + shuffle<1>(V) * m_row[1] +
+               shuffle<2>(V) * m_row[2] + m_row[3];
+    R = R / shuffle<3>(R);
+    return float3 (R.xyz0());
 #else
-    return *(int8 *)&x;
+    Imath::V3f R;
+    m_mat.multVecMatrix (*(Imath::V3f *)&V, R);
+    return float3(R);
 #endif
 }
 
-
-OIIO_FORCEINLINE int8 vreduce_add (const int8& v) {
-#if OIIO_SIMD_AVX >= 2
-    // From Syrah:
-    int8 ab_cd_0_0_ef_gh_0_0 = _mm256_hadd_epi32(v.simd(), _mm256_setzero_si256());
-    int8 abcd_0_0_0_efgh_0_0_0 = _mm256_hadd_epi32(ab_cd_0_0_ef_gh_0_0, _mm256_setzero_si256());
-    // get efgh in the 0-idx slot
-    int8 efgh = shuffle<4>(abcd_0_0_0_efgh_0_0_0);
-    int8 final_sum = abcd_0_0_0_efgh_0_0_0 + efgh;
-    return shuffle<0>(final_sum);
-#elif OIIO_SIMD_SSE
-    int4 hadd4 = vreduce_add(v.lo()) + vreduce_add(v.hi());
-    return int8(hadd4, hadd4);
+OIIO_FORCEINLINE float3 matrix44::transformv (const float3 &V) const {
+#if OIIO_SIMD_SSE
+    float4 R = shuffle<0>(V) * m_row[0] + shuffle<1>(V) * m_row[1] +
+               shuffle<2>(V) * m_row[2];
+    return float3 (R.xyz0());
 #else
-    SIMD_RETURN_REDUCE (int8, 0, r += v[i]);
+    Imath::V3f R;
+    m_mat.multDirMatrix (*(Imath::V3f *)&V, R);
+    return float3(R);
 #endif
 }
 
+OIIO_FORCEINLINE float3 matrix44::transformvT (const float3 &V) const {
+#if OIIO_SIMD_SSE
+    matrix44 T = transposed();
+    float4 R = shuffle<0>(V) * T[0] + shuffle<1>(V) * T[1] +
+               shuffle<2>(V) * T[2];
+    return float3 (R.xyz0());
+#else
+    Imath::V3f R;
+    m_mat.transposed().multDirMatrix (*(Imath::V3f *)&V, R);
+    return float3(R);
+#endif
+}
 
-OIIO_FORCEINLINE int reduce_add (const int8& v) {
+OIIO_FORCEINLINE bool matrix44::operator== (const matrix44& m) const {
 #if OIIO_SIMD_SSE
-    return extract<0> (vreduce_add(v));
+    bool4 b0 = (m_row[0] == m[0]);
+    bool4 b1 = (m_row[1] == m[1]);
+    bool4 b2 = (m_row[2] == m[2]);
+    bool4 b3 = (m_row[3] == m[3]);
+    return simd::all (b0 & b1 & b2 & b3);
 #else
-    SIMD_RETURN_REDUCE (int, 0, r += v[i]);
+    return memcmp(this, &m, 16*sizeof(float)) == 0;
 #endif
 }
 
+OIIO_FORCEINLINE bool matrix44::operator== (const Imath::M44f& m) const {
+    return memcmp(this, &m, 16*sizeof(float)) == 0;
+}
+
+OIIO_FORCEINLINE bool operator== (const Imath::M44f& a, const matrix44 &b) {
+    return (b == a);
+}
 
-OIIO_FORCEINLINE int reduce_and (const int8& v) {
-#if OIIO_SSE_AVX >= 2
-    int8 ab = v & shuffle<1,1,3,3,5,5,7,7>(v); // ab bb cd dd ef ff gh hh
-    int8 abcd = ab & shuffle<2,2,2,2,6,6,6,6>(ab); // abcd x x x efgh x x x
-    int8 abcdefgh = abcd & shuffle<4>(abcdefgh); // abcdefgh x x x x x x x
-    return extract<0> (abcdefgh);
+OIIO_FORCEINLINE bool matrix44::operator!= (const matrix44& m) const {
+#if OIIO_SIMD_SSE
+    bool4 b0 = (m_row[0] != m[0]);
+    bool4 b1 = (m_row[1] != m[1]);
+    bool4 b2 = (m_row[2] != m[2]);
+    bool4 b3 = (m_row[3] != m[3]);
+    return simd::any (b0 | b1 | b2 | b3);
 #else
-    // AVX 1.0 or less -- use SSE
-    return reduce_and(v.lo() & v.hi());
+    return memcmp(this, &m, 16*sizeof(float)) != 0;
 #endif
 }
 
+OIIO_FORCEINLINE bool matrix44::operator!= (const Imath::M44f& m) const {
+    return memcmp(this, &m, 16*sizeof(float)) != 0;
+}
 
-OIIO_FORCEINLINE int reduce_or (const int8& v) {
-#if OIIO_SSE_AVX >= 2
-    int8 ab = v | shuffle<1,1,3,3,5,5,7,7>(v); // ab bb cd dd ef ff gh hh
-    int8 abcd = ab | shuffle<2,2,2,2,6,6,6,6>(ab); // abcd x x x efgh x x x
-    int8 abcdefgh = abcd | shuffle<4>(abcdefgh); // abcdefgh x x x x x x x
-    return extract<0> (abcdefgh);
+OIIO_FORCEINLINE bool operator!= (const Imath::M44f& a, const matrix44 &b) {
+    return (b != a);
+}
+
+OIIO_FORCEINLINE matrix44 matrix44::inverse() const {
+#if OIIO_SIMD_SSE
+    // Adapted from this code from Intel:
+    // ftp://download.intel.com/design/pentiumiii/sml/24504301.pdf
+    float4 minor0, minor1, minor2, minor3;
+    float4 row0, row1, row2, row3;
+    float4 det, tmp1;
+    const float *src = (const float *)this;
+    float4 zero = float4::Zero();
+    tmp1 = _mm_loadh_pi(_mm_loadl_pi(zero, (__m64*)(src)), (__m64*)(src+ 4));
+    row1 = _mm_loadh_pi(_mm_loadl_pi(zero, (__m64*)(src+8)), (__m64*)(src+12));
+    row0 = _mm_shuffle_ps(tmp1, row1, 0x88);
+    row1 = _mm_shuffle_ps(row1, tmp1, 0xDD);
+    tmp1 = _mm_loadh_pi(_mm_loadl_pi(tmp1, (__m64*)(src+ 2)), (__m64*)(src+ 6));
+    row3 = _mm_loadh_pi(_mm_loadl_pi(zero, (__m64*)(src+10)), (__m64*)(src+14));
+    row2 = _mm_shuffle_ps(tmp1, row3, 0x88);
+    row3 = _mm_shuffle_ps(row3, tmp1, 0xDD);
+    // -----------------------------------------------
+    tmp1 = row2 * row3;
+    tmp1 = shuffle<1,0,3,2>(tmp1);
+    minor0 = row1 * tmp1;
+    minor1 = row0 * tmp1;
+    tmp1 = shuffle<2,3,0,1>(tmp1);
+    minor0 = (row1 * tmp1) - minor0;
+    minor1 = (row0 * tmp1) - minor1;
+    minor1 = shuffle<2,3,0,1>(minor1);
+    // -----------------------------------------------
+    tmp1 = row1 * row2;
+    tmp1 = shuffle<1,0,3,2>(tmp1);
+    minor0 = (row3 * tmp1) + minor0;
+    minor3 = row0 * tmp1;
+    tmp1 = shuffle<2,3,0,1>(tmp1);
+    minor0 = minor0 - (row3 * tmp1);
+    minor3 = (row0 * tmp1) - minor3;
+    minor3 = shuffle<2,3,0,1>(minor3);
+    // -----------------------------------------------
+    tmp1 = shuffle<2,3,0,1>(row1) * row3;
+    tmp1 = shuffle<1,0,3,2>(tmp1);
+    row2 = shuffle<2,3,0,1>(row2);
+    minor0 = (row2 * tmp1) + minor0;
+    minor2 = row0 * tmp1;
+    tmp1 = shuffle<2,3,0,1>(tmp1);
+    minor0 = minor0 - (row2 * tmp1);
+    minor2 = (row0 * tmp1) - minor2;
+    minor2 = shuffle<2,3,0,1>(minor2);
+    // -----------------------------------------------
+    tmp1 = row0 * row1;
+    tmp1 = shuffle<1,0,3,2>(tmp1);
+    minor2 = (row3 * tmp1) + minor2;
+    minor3 = (row2 * tmp1) - minor3;
+    tmp1 = shuffle<2,3,0,1>(tmp1);
+    minor2 = (row3 * tmp1) - minor2;
+    minor3 = minor3 - (row2 * tmp1);
+    // -----------------------------------------------
+    tmp1 = row0 * row3;
+    tmp1 = shuffle<1,0,3,2>(tmp1);
+    minor1 = minor1 - (row2 * tmp1);
+    minor2 = (row1 * tmp1) + minor2;
+    tmp1 = shuffle<2,3,0,1>(tmp1);
+    minor1 = (row2 * tmp1) + minor1;
+    minor2 = minor2 - (row1 * tmp1);
+    // -----------------------------------------------
+    tmp1 = row0 * row2;
+    tmp1 = shuffle<1,0,3,2>(tmp1);
+    minor1 = (row3 * tmp1) + minor1;
+    minor3 = minor3 - (row1 * tmp1);
+    tmp1 = shuffle<2,3,0,1>(tmp1);
+    minor1 = minor1 - (row3 * tmp1);
+    minor3 = (row1 * tmp1) + minor3;
+    // -----------------------------------------------
+    det = row0 * minor0;
+    det = shuffle<2,3,0,1>(det) + det;
+    det = _mm_add_ss(shuffle<1,0,3,2>(det), det);
+    tmp1 = _mm_rcp_ss(det);
+    det = _mm_sub_ss(_mm_add_ss(tmp1, tmp1), _mm_mul_ss(det, _mm_mul_ss(tmp1, tmp1)));
+    det = shuffle<0>(det);
+    return matrix44 (det*minor0, det*minor1, det*minor2, det*minor3);
 #else
-    // AVX 1.0 or less -- use SSE
-    return reduce_or(v.lo() | v.hi());
+    return m_mat.inverse();
 #endif
 }
 
 
-OIIO_FORCEINLINE int8 blend (const int8& a, const int8& b, const bool8& mask) {
-#if OIIO_SIMD_AVX
-    return _mm256_castps_si256 (_mm256_blendv_ps (_mm256_castsi256_ps(a.simd()),
-                                                  _mm256_castsi256_ps(b.simd()), mask));
-#else
-    SIMD_RETURN (int8, mask[i] ? b[i] : a[i]);
-#endif
+inline std::ostream& operator<< (std::ostream& cout, const matrix44 &M) {
+    const float *m = (const float *)&M;
+    cout << m[0];
+    for (int i = 1; i < 16; ++i)
+        cout << ' ' << m[i];
+    return cout;
 }
 
 
-OIIO_FORCEINLINE int8 blend0 (const int8& a, const bool8& mask) {
-#if OIIO_SIMD_AVX
-    return _mm256_castps_si256(_mm256_and_ps(_mm256_castsi256_ps(a.simd()), mask));
-#else
-    SIMD_RETURN (int8, mask[i] ? a[i] : 0.0f);
-#endif
-}
 
+OIIO_FORCEINLINE float3 transformp (const matrix44 &M, const float3 &V) {
+    return M.transformp (V);
+}
 
-OIIO_FORCEINLINE int8 blend0not (const int8& a, const bool8& mask) {
-#if OIIO_SIMD_AVX
-    return _mm256_castps_si256 (_mm256_andnot_ps (mask.simd(), _mm256_castsi256_ps(a.simd())));
+OIIO_FORCEINLINE float3 transformp (const Imath::M44f &M, const float3 &V)
+{
+#if OIIO_SIMD
+    return matrix44(M).transformp (V);
 #else
-    SIMD_RETURN (int8, mask[i] ? 0.0f : a[i]);
+    Imath::V3f R;
+    M.multVecMatrix (*(Imath::V3f *)&V, R);
+    return float3(R);
 #endif
 }
 
-OIIO_FORCEINLINE int8 select (const bool8& mask, const int8& a, const int8& b) {
-    return blend (b, a, mask);
-}
 
+OIIO_FORCEINLINE float3 transformv (const matrix44 &M, const float3 &V) {
+    return M.transformv (V);
+}
 
-OIIO_FORCEINLINE int8 abs (const int8& a) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_abs_epi32(a.simd());
+OIIO_FORCEINLINE float3 transformv (const Imath::M44f &M, const float3 &V)
+{
+#if OIIO_SIMD
+    return matrix44(M).transformv (V);
 #else
-    SIMD_RETURN (int8, std::abs(a[i]));
+    Imath::V3f R;
+    M.multDirMatrix (*(Imath::V3f *)&V, R);
+    return float3(R);
 #endif
 }
 
+OIIO_FORCEINLINE float3 transformvT (const matrix44 &M, const float3 &V)
+{
+    return M.transformvT (V);
+}
 
-OIIO_FORCEINLINE int8 min (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_min_epi32 (a, b);
+OIIO_FORCEINLINE float3 transformvT (const Imath::M44f &M, const float3 &V)
+{
+#if OIIO_SIMD
+    return matrix44(M).transformvT(V);
 #else
-    SIMD_RETURN (int8, std::min(a[i], b[i]));
+    return transformv (M.transposed(), V);
 #endif
 }
 
 
-OIIO_FORCEINLINE int8 max (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_max_epi32 (a, b);
-#else
-    SIMD_RETURN (int8, std::max(a[i], b[i]));
-#endif
+
+//////////////////////////////////////////////////////////////////////
+// float8 implementation
+
+OIIO_FORCEINLINE float& float8::operator[] (int i) {
+    DASSERT(i<elements);
+    return m_val[i];
 }
 
+OIIO_FORCEINLINE float float8::operator[] (int i) const {
+    DASSERT(i<elements);
+    return m_val[i];
+}
 
-OIIO_FORCEINLINE int8 rotl32 (const int8& x, const unsigned int k) {
-    return (x<<k) | srl(x,32-k);
+
+inline std::ostream& operator<< (std::ostream& cout, const float8& val) {
+    cout << val[0];
+    for (int i = 1; i < val.elements; ++i)
+        cout << ' ' << val[i];
+    return cout;
 }
 
 
-OIIO_FORCEINLINE int8 andnot (const int8& a, const int8& b) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_andnot_si256 (a.simd(), b.simd());
+OIIO_FORCEINLINE float4 float8::lo () const {
+#if OIIO_SIMD_AVX
+    return _mm256_castps256_ps128 (simd());
 #else
-    SIMD_RETURN (int8, ~(a[i]) & b[i]);
+    return m_4[0];
 #endif
 }
 
-
-// Implementation had to be after the definition of int8::Zero.
-OIIO_FORCEINLINE bool8::bool8 (const int8& ival) {
-    m_simd = (ival != int8::Zero());
+OIIO_FORCEINLINE float4 float8::hi () const {
+#if OIIO_SIMD_AVX
+    return _mm256_extractf128_ps (simd(), 1);
+#else
+    return m_4[1];
+#endif
 }
 
 
+OIIO_FORCEINLINE float8::float8 (const float4& lo, const float4 &hi) {
+#if OIIO_SIMD_AVX
+    __m256 r = _mm256_castps128_ps256 (lo);
+    m_simd = _mm256_insertf128_ps (r, hi, 1);
+    // N.B. equivalent, if available: m_simd = _mm256_set_m128 (hi, lo);
+#else
+    m_4[0] = lo;
+    m_4[1] = hi;
+#endif
+}
 
 
-//////////////////////////////////////////////////////////////////////
-// float4 implementation
-
-
-OIIO_FORCEINLINE float4::float4 (const int4& ival) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_cvtepi32_ps (ival.simd());
+OIIO_FORCEINLINE float8::float8 (const int8& ival) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_cvtepi32_ps (ival);
 #else
     SIMD_CONSTRUCT (float(ival[i]));
 #endif
 }
 
 
-OIIO_FORCEINLINE const float4 float4::Zero () {
-#if OIIO_SIMD_SSE
-    return _mm_setzero_ps();
+OIIO_FORCEINLINE const float8 float8::Zero () {
+#if OIIO_SIMD_AVX
+    return _mm256_setzero_ps();
 #else
-    return float4(0.0f);
+    return float8(0.0f);
 #endif
 }
 
-OIIO_FORCEINLINE const float4 float4::One () {
-    return float4(1.0f);
+OIIO_FORCEINLINE const float8 float8::One () {
+    return float8(1.0f);
 }
 
-OIIO_FORCEINLINE const float4 float4::Iota (float start, float step) {
-    return float4 (start+0.0f*step, start+1.0f*step, start+2.0f*step, start+3.0f*step);
+OIIO_FORCEINLINE const float8 float8::Iota (float start, float step) {
+    return float8 (start+0.0f*step, start+1.0f*step, start+2.0f*step, start+3.0f*step,
+                   start+4.0f*step, start+5.0f*step, start+6.0f*step, start+7.0f*step);
 }
 
 /// Set all components to 0.0
-OIIO_FORCEINLINE void float4::clear () {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_setzero_ps();
+OIIO_FORCEINLINE void float8::clear () {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_setzero_ps();
 #else
     load (0.0f);
 #endif
 }
 
-#if defined(ILMBASE_VERSION_MAJOR) && ILMBASE_VERSION_MAJOR >= 2
-OIIO_FORCEINLINE const float4 & float4::operator= (const Imath::V4f &v) {
-    load ((const float *)&v);
-    return *this;
-}
-#endif
-
-OIIO_FORCEINLINE const float4 & float4::operator= (const Imath::V3f &v) {
-    load (v[0], v[1], v[2], 0.0f);
-    return *this;
-}
-
-OIIO_FORCEINLINE float& float4::operator[] (int i) {
-    DASSERT(i<elements);
-    return m_val[i];
-}
-
-OIIO_FORCEINLINE float float4::operator[] (int i) const {
-    DASSERT(i<elements);
-    return m_val[i];
-}
 
 
-OIIO_FORCEINLINE void float4::load (float val) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_set1_ps (val);
-#elif defined(OIIO_SIMD_NEON)
-    m_simd = vdupq_n_f32 (val);
+OIIO_FORCEINLINE void float8::load (float val) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_set1_ps (val);
 #else
     SIMD_CONSTRUCT (val);
 #endif
 }
 
-OIIO_FORCEINLINE void float4::load (float a, float b, float c, float d) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_set_ps (d, c, b, a);
-#elif defined(OIIO_SIMD_NEON)
-    float values[4] = { a, b, c, d };
-    m_simd = vld1q_f32 (values);
+OIIO_FORCEINLINE void float8::load (float a, float b, float c, float d,
+                                    float e, float f, float g, float h) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_set_ps (h, g, f, e, d, c, b, a);
 #else
     m_val[0] = a;
     m_val[1] = b;
     m_val[2] = c;
     m_val[3] = d;
+    m_val[4] = e;
+    m_val[5] = f;
+    m_val[6] = g;
+    m_val[7] = h;
 #endif
 }
 
-    /// Load from an array of 4 values
-OIIO_FORCEINLINE void float4::load (const float *values) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_loadu_ps (values);
-#elif defined(OIIO_SIMD_NEON)
-    m_simd = vld1q_f32 (values);
+
+OIIO_FORCEINLINE void float8::load (const float *values) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_loadu_ps (values);
+#elif OIIO_SIMD_SSE
+    m_4[0] = float4(values);
+    m_4[1] = float4(values+4);
 #else
     SIMD_CONSTRUCT (values[i]);
 #endif
 }
 
 
-OIIO_FORCEINLINE void float4::load (const float *values, int n) {
+OIIO_FORCEINLINE void float8::load (const float *values, int n) {
+    // FIXME: is this faster with AVX masked loads?
 #if OIIO_SIMD_SSE
-    switch (n) {
-    case 1:
-        m_simd = _mm_load_ss (values);
-        break;
-    case 2:
-        // Trickery: load one double worth of bits!
-        m_simd = _mm_castpd_ps (_mm_load_sd ((const double*)values));
-        break;
-    case 3:
-        m_simd = _mm_setr_ps (values[0], values[1], values[2], 0.0f);
-        // This looks wasteful, but benchmarks show that it's the
-        // fastest way to set 3 values with the 4th getting zero.
-        // Actually, gcc and clang both turn it into something more
-        // efficient than _mm_setr_ps. The version below looks smart,
-        // but was much more expensive as the _mm_setr_ps!
-        //   __m128 xy = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)values));
-        //   m_simd = _mm_movelh_ps(xy, _mm_load_ss (values + 2));
-        break;
-    case 4:
-        m_simd = _mm_loadu_ps (values);
-        break;
-    default:
-        break;
-    }
-#elif defined(OIIO_SIMD_NEON)
-    switch (n) {
-    case 1: m_simd = vdupq_n_f32 (val);                    break;
-    case 2: load (values[0], values[1], 0.0f, 0.0f);      break;
-    case 3: load (values[0], values[1], values[2], 0.0f); break;
-    case 4: m_simd = vld1q_f32 (values);                   break;
-    default: break;
+    if (n > 0 && n <= 4) {
+        float4 l; l.load (values, n);
+        m_simd = float8(l, float4::Zero());
+    } else if (n > 4 && n <= 8) {
+        float4 h; h.load (values+4, n-4);
+        m_simd = float8(float4(values), h);
     }
+    else
+        clear();
 #else
     for (int i = 0; i < n; ++i)
         m_val[i] = values[i];
@@ -3987,138 +6270,80 @@ OIIO_FORCEINLINE void float4::load (const float *values, int n) {
 }
 
 
-OIIO_FORCEINLINE void float4::load (const unsigned short *values) {
-#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
-    m_simd = _mm_cvtepi32_ps (int4(values).simd());
-    // You might guess that the following is faster, but it's NOT:
-    //   NO!  m_simd = _mm_cvtpu16_ps (*(__m64*)values);
+OIIO_FORCEINLINE void float8::load (const unsigned short *values) {
+#if OIIO_SIMD_AVX
+    // Rely on the uint16->int conversion, then convert to float
+    m_simd = _mm256_cvtepi32_ps (int8(values).simd());
 #else
     SIMD_CONSTRUCT (values[i]);
 #endif
 }
 
 
-OIIO_FORCEINLINE void float4::load (const short *values) {
-#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
-    m_simd = _mm_cvtepi32_ps (int4(values).simd());
+OIIO_FORCEINLINE void float8::load (const short *values) {
+#if OIIO_SIMD_AVX
+    // Rely on the int16->int conversion, then convert to float
+    m_simd = _mm256_cvtepi32_ps (int8(values).simd());
 #else
     SIMD_CONSTRUCT (values[i]);
 #endif
 }
 
 
-OIIO_FORCEINLINE void float4::load (const unsigned char *values) {
-#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
-    m_simd = _mm_cvtepi32_ps (int4(values).simd());
+OIIO_FORCEINLINE void float8::load (const unsigned char *values) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_cvtepi32_ps (int8(values).simd());
 #else
     SIMD_CONSTRUCT (values[i]);
 #endif
 }
 
-    /// Load from an array of 4 char values, convert to float
-OIIO_FORCEINLINE void float4::load (const char *values) {
-#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
-    m_simd = _mm_cvtepi32_ps (int4(values).simd());
+
+OIIO_FORCEINLINE void float8::load (const char *values) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_cvtepi32_ps (int8(values).simd());
 #else
     SIMD_CONSTRUCT (values[i]);
 #endif
 }
 
 #ifdef _HALF_H_
-OIIO_FORCEINLINE void float4::load (const half *values) {
-#if defined(__F16C__) && defined(OIIO_SIMD_SSE)
+OIIO_FORCEINLINE void float8::load (const half *values) {
+#if OIIO_SIMD_AVX && defined(__F16C__)
     /* Enabled 16 bit float instructions! */
-    __m128i a = _mm_castpd_si128 (_mm_load_sd ((const double *)values));
-    m_simd = _mm_cvtph_ps (a);
-#elif defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 2
-    // SSE half-to-float by Fabian "ryg" Giesen. Public domain.
-    // https://gist.github.com/rygorous/2144712
-    int4 h ((const unsigned short *)values);
-# define CONSTI(name) *(const __m128i *)&name
-# define CONSTF(name) *(const __m128 *)&name
-    OIIO_SIMD_UINT4_CONST(mask_nosign, 0x7fff);
-    OIIO_SIMD_UINT4_CONST(magic,       (254 - 15) << 23);
-    OIIO_SIMD_UINT4_CONST(was_infnan,  0x7bff);
-    OIIO_SIMD_UINT4_CONST(exp_infnan,  255 << 23);
-    __m128i mnosign     = CONSTI(mask_nosign);
-    __m128i expmant     = _mm_and_si128(mnosign, h);
-    __m128i justsign    = _mm_xor_si128(h, expmant);
-    __m128i expmant2    = expmant; // copy (just here for counting purposes)
-    __m128i shifted     = _mm_slli_epi32(expmant, 13);
-    __m128  scaled      = _mm_mul_ps(_mm_castsi128_ps(shifted), *(const __m128 *)&magic);
-    __m128i b_wasinfnan = _mm_cmpgt_epi32(expmant2, CONSTI(was_infnan));
-    __m128i sign        = _mm_slli_epi32(justsign, 16);
-    __m128  infnanexp   = _mm_and_ps(_mm_castsi128_ps(b_wasinfnan), CONSTF(exp_infnan));
-    __m128  sign_inf    = _mm_or_ps(_mm_castsi128_ps(sign), infnanexp);
-    __m128  final       = _mm_or_ps(scaled, sign_inf);
-    // ~11 SSE2 ops.
-    m_simd = final;
-# undef CONSTI
-# undef CONSTF
+    int4 a ((const int *)values);
+    m_simd = _mm256_cvtph_ps (a);
+#elif OIIO_SIMD_SSE >= 2
+    m_4[0] = float4(values);
+    m_4[1] = float4(values+4);
 #else /* No SIMD defined: */
     SIMD_CONSTRUCT (values[i]);
 #endif
 }
 #endif /* _HALF_H_ */
 
-OIIO_FORCEINLINE void float4::store (float *values) const {
-#if OIIO_SIMD_SSE
+
+OIIO_FORCEINLINE void float8::store (float *values) const {
+#if OIIO_SIMD_AVX
     // Use an unaligned store -- it's just as fast when the memory turns
     // out to be aligned, nearly as fast even when unaligned. Not worth
     // the headache of using stores that require alignment.
-    _mm_storeu_ps (values, m_simd);
-#elif defined(OIIO_SIMD_NEON)
-    vst1q_f32 (values, m_simd);
+    _mm256_storeu_ps (values, m_simd);
 #else
     SIMD_DO (values[i] = m_val[i]);
 #endif
 }
 
-OIIO_FORCEINLINE void float4::store (float *values, int n) const {
-    DASSERT (n >= 0 && n <= 4);
+
+OIIO_FORCEINLINE void float8::store (float *values, int n) const {
+    DASSERT (n >= 0 && n <= elements);
+    // FIXME: is this faster with AVX masked stores?
 #if OIIO_SIMD_SSE
-    switch (n) {
-        case 1:
-        _mm_store_ss (values, m_simd);
-        break;
-    case 2:
-        // Trickery: store two floats as a double worth of bits
-        _mm_store_sd ((double*)values, _mm_castps_pd(m_simd));
-        break;
-    case 3:
-        values[0] = m_val[0];
-        values[1] = m_val[1];
-        values[2] = m_val[2];
-        // This looks wasteful, but benchmarks show that it's the
-        // fastest way to store 3 values, in benchmarks was faster than
-        // this, below:
-        //   _mm_store_sd ((double*)values, _mm_castps_pd(m_simd));
-        //   _mm_store_ss (values + 2, _mm_movehl_ps(m_simd,m_simd));
-        break;
-    case 4:
-        store (values);
-        break;
-    default:
-        break;
-    }
-#elif defined(OIIO_SIMD_NEON)
-    switch (n) {
-    case 1:
-        vst1q_lane_f32 (values, m_simd, 0);
-        break;
-    case 2:
-        vst1q_lane_f32 (values++, m_simd, 0);
-        vst1q_lane_f32 (values, m_simd, 1);
-        break;
-    case 3:
-        vst1q_lane_f32 (values++, m_simd, 0);
-        vst1q_lane_f32 (values++, m_simd, 1);
-        vst1q_lane_f32 (values, m_simd, 2);
-        break;
-    case 4:
-        vst1q_f32 (values, m_simd); break;
-    default:
-        break;
+    if (n <= 4) {
+        lo().store (values, n);
+    } else if (n <= 8) {
+        lo().store (values);
+        hi().store (values+4, n-4);
     }
 #else
     for (int i = 0; i < n; ++i)
@@ -4127,1353 +6352,1325 @@ OIIO_FORCEINLINE void float4::store (float *values, int n) const {
 }
 
 #ifdef _HALF_H_
-OIIO_FORCEINLINE void float4::store (half *values) const {
-#if defined(__F16C__) && defined(OIIO_SIMD_SSE)
-    __m128i h = _mm_cvtps_ph (m_simd, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
-    _mm_store_sd ((double *)values, _mm_castsi128_pd(h));
+OIIO_FORCEINLINE void float8::store (half *values) const {
+#if OIIO_SIMD_AVX && defined(__F16C__)
+    __m128i h = _mm256_cvtps_ph (m_simd, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
+    _mm_storeu_si128 ((__m128i *)values, h);
+#elif OIIO_SIMD_SSE >= 2
+    lo().store (values);
+    hi().store (values+4);
 #else
     SIMD_DO (values[i] = m_val[i]);
 #endif
 }
 #endif
 
-OIIO_FORCEINLINE float4 operator+ (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_add_ps (a.m_simd, b.m_simd);
-#elif defined(OIIO_SIMD_NEON)
-    return vaddq_f32 (a.m_simd, b.m_simd);
+
+OIIO_FORCEINLINE float8 operator+ (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_add_ps (a.m_simd, b.m_simd);
 #else
-    SIMD_RETURN (float4, a[i] + b[i]);
+    SIMD_RETURN (float8, a[i] + b[i]);
 #endif
 }
 
-OIIO_FORCEINLINE const float4 & float4::operator+= (const float4& a) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_add_ps (m_simd, a.m_simd);
-#elif defined(OIIO_SIMD_NEON)
-    m_simd = vaddq_f32 (m_simd, a.m_simd);
+OIIO_FORCEINLINE const float8 & float8::operator+= (const float8& a) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_add_ps (m_simd, a.m_simd);
 #else
     SIMD_DO (m_val[i] += a[i]);
 #endif
     return *this;
-    }
+}
 
-OIIO_FORCEINLINE float4 float4::operator- () const {
-#if OIIO_SIMD_SSE
-    return _mm_sub_ps (_mm_setzero_ps(), m_simd);
-#elif defined(OIIO_SIMD_NEON)
-    return vsubq_f32 (Zero(), m_simd);
+OIIO_FORCEINLINE float8 float8::operator- () const {
+#if OIIO_SIMD_AVX
+    return _mm256_sub_ps (_mm256_setzero_ps(), m_simd);
 #else
-    SIMD_RETURN (float4, -m_val[i]);
+    SIMD_RETURN (float8, -m_val[i]);
 #endif
 }
 
-OIIO_FORCEINLINE float4 operator- (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_sub_ps (a.m_simd, b.m_simd);
-#elif defined(OIIO_SIMD_NEON)
-    return vsubq_f32 (a.m_simd, b.m_simd);
+OIIO_FORCEINLINE float8 operator- (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_sub_ps (a.m_simd, b.m_simd);
 #else
-    SIMD_RETURN (float4, a[i] - b[i]);
+    SIMD_RETURN (float8, a[i] - b[i]);
 #endif
 }
 
-OIIO_FORCEINLINE const float4 & float4::operator-= (const float4& a) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_sub_ps (m_simd, a.m_simd);
-#elif defined(OIIO_SIMD_NEON)
-    m_simd = vsubq_f32 (m_simd, a.m_simd);
+OIIO_FORCEINLINE const float8 & float8::operator-= (const float8& a) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_sub_ps (m_simd, a.m_simd);
 #else
     SIMD_DO (m_val[i] -= a[i]);
 #endif
     return *this;
 }
 
-OIIO_FORCEINLINE float4 operator* (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_mul_ps (a.m_simd, b.m_simd);
-#elif defined(OIIO_SIMD_NEON)
-    return vmulq_f32 (a.m_simd, b.m_simd);
+OIIO_FORCEINLINE float8 operator* (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_mul_ps (a.m_simd, b.m_simd);
 #else
-    SIMD_RETURN (float4, a[i] * b[i]);
+    SIMD_RETURN (float8, a[i] * b[i]);
 #endif
 }
 
-OIIO_FORCEINLINE const float4 & float4::operator*= (const float4& a) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_mul_ps (m_simd, a.m_simd);
-#elif defined(OIIO_SIMD_NEON)
-    m_simd = vmulq_f32 (m_simd, a.m_simd);
+OIIO_FORCEINLINE const float8 & float8::operator*= (const float8& a) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_mul_ps (m_simd, a.m_simd);
 #else
     SIMD_DO (m_val[i] *= a[i]);
 #endif
     return *this;
 }
 
-OIIO_FORCEINLINE const float4 & float4::operator*= (float val) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_mul_ps (m_simd, _mm_set1_ps(val));
-#elif defined(OIIO_SIMD_NEON)
-    m_simd = vmulq_f32 (m_simd, vdupq_n_f32(val));
+OIIO_FORCEINLINE const float8 & float8::operator*= (float val) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_mul_ps (m_simd, _mm256_set1_ps(val));
 #else
     SIMD_DO (m_val[i] *= val);
 #endif
     return *this;
 }
 
-OIIO_FORCEINLINE float4 operator/ (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_div_ps (a.m_simd, b.m_simd);
+OIIO_FORCEINLINE float8 operator/ (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_div_ps (a.m_simd, b.m_simd);
+#else
+    SIMD_RETURN (float8, a[i] / b[i]);
+#endif
+}
+
+OIIO_FORCEINLINE const float8 & float8::operator/= (const float8& a) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_div_ps (m_simd, a.m_simd);
+#else
+    SIMD_DO (m_val[i] /= a[i]);
+#endif
+    return *this;
+}
+
+OIIO_FORCEINLINE const float8 & float8::operator/= (float val) {
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_div_ps (m_simd, _mm256_set1_ps(val));
+#else
+    SIMD_DO (m_val[i] /= val);
+#endif
+    return *this;
+}
+
+OIIO_FORCEINLINE bool8 operator== (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_EQ_OQ);
+#else
+    SIMD_RETURN (bool8, a[i] == b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool8 operator!= (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_NEQ_OQ);
+#else
+    SIMD_RETURN (bool8, a[i] != b[i] ? -1 : 0);
+#endif
+}
+
+OIIO_FORCEINLINE bool8 operator< (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_LT_OQ);
 #else
-    SIMD_RETURN (float4, a[i] / b[i]);
+    SIMD_RETURN (bool8, a[i] < b[i] ? -1 : 0);
 #endif
 }
 
-OIIO_FORCEINLINE const float4 & float4::operator/= (const float4& a) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_div_ps (m_simd, a.m_simd);
+OIIO_FORCEINLINE bool8 operator>  (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_GT_OQ);
 #else
-    SIMD_DO (m_val[i] /= a[i]);
+    SIMD_RETURN (bool8, a[i] > b[i] ? -1 : 0);
 #endif
-    return *this;
 }
 
-OIIO_FORCEINLINE const float4 & float4::operator/= (float val) {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_div_ps (m_simd, _mm_set1_ps(val));
+OIIO_FORCEINLINE bool8 operator>= (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_GE_OQ);
 #else
-    SIMD_DO (m_val[i] /= val);
+    SIMD_RETURN (bool8, a[i] >= b[i] ? -1 : 0);
 #endif
-    return *this;
 }
 
-OIIO_FORCEINLINE bool4 operator== (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_cmpeq_ps (a.m_simd, b.m_simd);
+OIIO_FORCEINLINE bool8 operator<= (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_LE_OQ);
 #else
-    SIMD_RETURN (bool4, a[i] == b[i] ? -1 : 0);
+    SIMD_RETURN (bool8, a[i] <= b[i] ? -1 : 0);
 #endif
 }
 
-OIIO_FORCEINLINE bool4 operator!= (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_cmpneq_ps (a.m_simd, b.m_simd);
+
+// Implementation had to be after the definition of float8.
+OIIO_FORCEINLINE int8::int8 (const float8& f)
+{
+#if OIIO_SIMD_AVX
+    m_simd = _mm256_cvttps_epi32(f);
 #else
-    SIMD_RETURN (bool4, a[i] != b[i] ? -1 : 0);
+    SIMD_CONSTRUCT ((int) f[i]);
 #endif
 }
 
-OIIO_FORCEINLINE bool4 operator< (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_cmplt_ps (a.m_simd, b.m_simd);
+
+template<int i0, int i1, int i2, int i3, int i4, int i5, int i6, int i7>
+OIIO_FORCEINLINE float8 shuffle (const float8& a) {
+#if OIIO_SIMD_AVX >= 2
+    int8 index (i0, i1, i2, i3, i4, i5, i6, i7);
+    return _mm256_permutevar8x32_ps (a, index);
 #else
-    SIMD_RETURN (bool4, a[i] < b[i] ? -1 : 0);
+    return float8 (a[i0], a[i1], a[i2], a[i3], a[i4], a[i5], a[i6], a[i7]);
 #endif
 }
 
-OIIO_FORCEINLINE bool4 operator>  (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_cmpgt_ps (a.m_simd, b.m_simd);
+template<int i> OIIO_FORCEINLINE float8 shuffle (const float8& a) {
+#if OIIO_SIMD_AVX >= 2
+    return _mm256_permutevar8x32_ps (a, int8(i));
 #else
-    SIMD_RETURN (bool4, a[i] > b[i] ? -1 : 0);
+    return shuffle<i,i,i,i,i,i,i,i>(a);
 #endif
 }
 
-OIIO_FORCEINLINE bool4 operator>= (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_cmpge_ps (a.m_simd, b.m_simd);
+
+template<int i>
+OIIO_FORCEINLINE float extract (const float8& v) {
+#if OIIO_SIMD_AVX_NO_FIXME
+    // Looks like the fastest we can do it is to extract a float4,
+    // shuffle its one element everywhere, then extract element 0.
+    _m128 f4 = _mm256_extractf128_ps (i >> 2);
+    int j = i & 3;
+    return _mm_cvtss_f32(shuffle_sse<j,j,j,j>(a.simd()));
 #else
-    SIMD_RETURN (bool4, a[i] >= b[i] ? -1 : 0);
+    return v[i];
 #endif
 }
 
-OIIO_FORCEINLINE bool4 operator<= (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_cmple_ps (a.m_simd, b.m_simd);
+
+template<int i>
+OIIO_FORCEINLINE float8 insert (const float8& a, float val) {
+#if OIIO_SIMD_AVX_NO_FIXME
+    return _mm256_insert_epi32 (a, val, i);
 #else
-    SIMD_RETURN (bool4, a[i] <= b[i] ? -1 : 0);
+    float8 tmp = a;
+    tmp[i] = val;
+    return tmp;
 #endif
 }
 
-OIIO_FORCEINLINE float4 AxyBxy (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_movelh_ps (a.m_simd, b.m_simd);
+
+OIIO_FORCEINLINE float float8::x () const { return extract<0>(*this); }
+OIIO_FORCEINLINE float float8::y () const { return extract<1>(*this); }
+OIIO_FORCEINLINE float float8::z () const { return extract<2>(*this); }
+OIIO_FORCEINLINE float float8::w () const { return extract<3>(*this); }
+OIIO_FORCEINLINE void float8::set_x (float val) { *this = insert<0>(*this, val); }
+OIIO_FORCEINLINE void float8::set_y (float val) { *this = insert<1>(*this, val); }
+OIIO_FORCEINLINE void float8::set_z (float val) { *this = insert<2>(*this, val); }
+OIIO_FORCEINLINE void float8::set_w (float val) { *this = insert<3>(*this, val); }
+
+
+OIIO_FORCEINLINE int8 bitcast_to_int (const float8& x)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_castps_si256 (x.simd());
 #else
-    return float4 (a[0], a[1], b[0], b[1]);
+    return *(int8 *)&x;
 #endif
 }
 
-OIIO_FORCEINLINE float4 AxBxAyBy (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_unpacklo_ps (a.m_simd, b.m_simd);
+OIIO_FORCEINLINE float8 bitcast_to_float (const int8& x)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_castsi256_ps (x.simd());
 #else
-    return float4 (a[0], b[0], a[1], b[1]);
+    return *(float8 *)&x;
 #endif
 }
 
-OIIO_FORCEINLINE float4 float4::xyz0 () const {
-    return insert<3>(*this, 0.0f);
-}
 
-OIIO_FORCEINLINE float4 float4::xyz1 () const {
-    return insert<3>(*this, 1.0f);
+OIIO_FORCEINLINE float8 vreduce_add (const float8& v) {
+#if OIIO_SIMD_AVX
+    // From Syrah:
+    float8 ab_cd_0_0_ef_gh_0_0 = _mm256_hadd_ps(v.simd(), _mm256_setzero_ps());
+    float8 abcd_0_0_0_efgh_0_0_0 = _mm256_hadd_ps(ab_cd_0_0_ef_gh_0_0, _mm256_setzero_ps());
+    // get efgh in the 0-idx slot
+    float8 efgh = shuffle<4>(abcd_0_0_0_efgh_0_0_0);
+    float8 final_sum = abcd_0_0_0_efgh_0_0_0 + efgh;
+    return shuffle<0>(final_sum);
+#else
+    float4 hadd4 = vreduce_add(v.lo()) + vreduce_add(v.hi());
+    return float8(hadd4, hadd4);
+#endif
 }
 
-inline std::ostream& operator<< (std::ostream& cout, const float4& val) {
-    cout << val[0];
-    for (int i = 1; i < val.elements; ++i)
-        cout << ' ' << val[i];
-    return cout;
+
+OIIO_FORCEINLINE float reduce_add (const float8& v) {
+#if OIIO_SIMD_AVX >= 2
+    return extract<0>(vreduce_add(v));
+#else
+    return reduce_add(v.lo()) + reduce_add(v.hi());
+#endif
 }
 
 
-// Implementation had to be after the definition of float4.
-OIIO_FORCEINLINE int4::int4 (const float4& f)
+OIIO_FORCEINLINE float8 blend (const float8& a, const float8& b, const bool8& mask)
 {
-#if OIIO_SIMD_SSE
-    m_simd = _mm_cvttps_epi32(f.simd());
+#if OIIO_SIMD_AVX
+    return _mm256_blendv_ps (a, b, mask);
+#elif defined(OIIO_SIMD_SSE)
+    return float8 (blend (a.lo(), b.lo(), mask.lo()),
+                   blend (a.hi(), b.hi(), mask.hi()));
 #else
-    SIMD_CONSTRUCT ((int) f[i]);
+    SIMD_RETURN (float8, mask[i] ? b[i] : a[i]);
 #endif
 }
 
 
-template<int i0, int i1, int i2, int i3>
-OIIO_FORCEINLINE float4 shuffle (const float4& a) {
-#if OIIO_SIMD_SSE
-    return shuffle_sse<i0,i1,i2,i3> (__m128(a));
+OIIO_FORCEINLINE float8 blend0 (const float8& a, const bool8& mask)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_and_ps(mask, a);
+#elif defined(OIIO_SIMD_SSE)
+    return float8 (blend0 (a.lo(), mask.lo()),
+                   blend0 (a.hi(), mask.hi()));
 #else
-    return float4(a[i0], a[i1], a[i2], a[i3]);
+    SIMD_RETURN (float8, mask[i] ? a[i] : 0.0f);
 #endif
 }
 
-template<int i> OIIO_FORCEINLINE float4 shuffle (const float4& a) { return shuffle<i,i,i,i>(a); }
 
-#if defined(OIIO_SIMD_NEON)
-template<> OIIO_FORCEINLINE float4 shuffle<0> (const float4& a) {
-    float32x2_t t = vget_low_f32(a.m_simd); return vdupq_lane_f32(t,0);
-}
-template<> OIIO_FORCEINLINE float4 shuffle<1> (const float4& a) {
-    float32x2_t t = vget_low_f32(a.m_simd); return vdupq_lane_f32(t,1);
-}
-template<> OIIO_FORCEINLINE float4 shuffle<2> (const float4& a) {
-    float32x2_t t = vget_high_f32(a.m_simd); return vdupq_lane_f32(t,0);
-}
-template<> OIIO_FORCEINLINE float4 shuffle<3> (const float4& a) {
-    float32x2_t t = vget_high_f32(a.m_simd); return vdupq_lane_f32(t,1);
-}
+OIIO_FORCEINLINE float8 blend0not (const float8& a, const bool8& mask)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_andnot_ps(mask, a);
+#elif defined(OIIO_SIMD_SSE)
+    return float8 (blend0not (a.lo(), mask.lo()),
+                   blend0not (a.hi(), mask.hi()));
+#else
+    SIMD_RETURN (float8, mask[i] ? 0.0f : a[i]);
 #endif
+}
 
 
-
-/// Helper: as rapid as possible extraction of one component, when the
-/// index is fixed.
-template<int i>
-OIIO_FORCEINLINE float extract (const float4& a) {
+OIIO_FORCEINLINE float8 safe_div (const float8 &a, const float8 &b) {
 #if OIIO_SIMD_SSE
-    return _mm_cvtss_f32(shuffle_sse<i,i,i,i>(a.simd()));
+    return blend0not (a/b, b == float8::Zero());
 #else
-    return a[i];
+    SIMD_RETURN (float8, b[i] == 0.0f ? 0.0f : a[i] / b[i]);
 #endif
 }
 
-#if OIIO_SIMD_SSE
-template<> OIIO_FORCEINLINE float extract<0> (const float4& a) {
-    return _mm_cvtss_f32(a.simd());
+
+OIIO_FORCEINLINE float8 select (const bool8& mask, const float8& a, const float8& b)
+{
+    return blend (b, a, mask);
 }
-#endif
 
 
-/// Helper: substitute val for a[i]
-template<int i>
-OIIO_FORCEINLINE float4 insert (const float4& a, float val) {
-#if OIIO_SIMD_SSE >= 4
-    return _mm_insert_ps (a, _mm_set_ss(val), i<<4);
+OIIO_FORCEINLINE float8 abs (const float8& a)
+{
+#if OIIO_SIMD_AVX
+    // Just clear the sign bit for cheap fabsf
+    return _mm256_and_ps (a.simd(), _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
 #else
-    float4 tmp = a;
-    tmp[i] = val;
-    return tmp;
+    SIMD_RETURN (float8, fabsf(a[i]));
 #endif
 }
 
-#if OIIO_SIMD_SSE
-// Slightly faster special cases for SSE
-template<> OIIO_FORCEINLINE float4 insert<0> (const float4& a, float val) {
-    return _mm_move_ss (a.simd(), _mm_set_ss(val));
+
+OIIO_FORCEINLINE float8 sign (const float8& a)
+{
+    float8 one(1.0f);
+    return blend (one, -one, a < float8::Zero());
 }
-#endif
 
 
-OIIO_FORCEINLINE float float4::x () const { return extract<0>(*this); }
-OIIO_FORCEINLINE float float4::y () const { return extract<1>(*this); }
-OIIO_FORCEINLINE float float4::z () const { return extract<2>(*this); }
-OIIO_FORCEINLINE float float4::w () const { return extract<3>(*this); }
-OIIO_FORCEINLINE void float4::set_x (float val) { *this = insert<0>(*this, val); }
-OIIO_FORCEINLINE void float4::set_y (float val) { *this = insert<1>(*this, val); }
-OIIO_FORCEINLINE void float4::set_z (float val) { *this = insert<2>(*this, val); }
-OIIO_FORCEINLINE void float4::set_w (float val) { *this = insert<3>(*this, val); }
+OIIO_FORCEINLINE float8 ceil (const float8& a)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_ceil_ps (a);
+#else
+    SIMD_RETURN (float8, ceilf(a[i]));
+#endif
+}
 
+OIIO_FORCEINLINE float8 floor (const float8& a)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_floor_ps (a);
+#else
+    SIMD_RETURN (float8, floorf(a[i]));
+#endif
+}
 
-OIIO_FORCEINLINE int4 bitcast_to_int (const float4& x)
+OIIO_FORCEINLINE float8 round (const float8& a)
 {
-#if OIIO_SIMD_SSE
-    return _mm_castps_si128 (x.simd());
+#if OIIO_SIMD_AVX
+    return _mm256_round_ps (a, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
 #else
-    return *(int4 *)&x;
+    SIMD_RETURN (float8, roundf(a[i]));
 #endif
 }
 
-OIIO_FORCEINLINE float4 bitcast_to_float (const int4& x)
+OIIO_FORCEINLINE int8 floori (const float8& a)
 {
-#if OIIO_SIMD_SSE
-    return _mm_castsi128_ps (x.simd());
+#if OIIO_SIMD_AVX
+    return int8(floor(a));
+#elif defined(OIIO_SIMD_SSE)   /* SSE2/3 */
+    int8 i (a);  // truncates
+    int8 isneg = bitcast_to_int (a < float8::Zero());
+    return i + isneg;
+    // The trick here (thanks, Cycles, for letting me spy on your code) is
+    // that the comparison will return (int)-1 for components that are less
+    // than zero, and adding that is the same as subtracting one!
 #else
-    return *(float4 *)&x;
+    SIMD_RETURN (int8, (int)floorf(a[i]));
 #endif
 }
 
 
-// Old names:
-inline int4 bitcast_to_int4 (const float4& x) { return bitcast_to_int(x); }
-inline float4 bitcast_to_float4 (const int4& x) { return bitcast_to_float(x); }
+OIIO_FORCEINLINE int8 rint (const float8& a)
+{
+    return int8 (round(a));
+}
 
 
 
-OIIO_FORCEINLINE float4 vreduce_add (const float4& v) {
-#if OIIO_SIMD_SSE >= 3
-    // People seem to agree that SSE3 does add reduction best with 2
-    // horizontal adds.
-    // suppose v = (a, b, c, d)
-    simd::float4 ab_cd = _mm_hadd_ps (v.simd(), v.simd());
-    // ab_cd = (a+b, c+d, a+b, c+d)
-    simd::float4 abcd = _mm_hadd_ps (ab_cd.simd(), ab_cd.simd());
-    // all abcd elements are a+b+c+d
-    return abcd;
-#elif defined(OIIO_SIMD_SSE)
-    // I think this is the best we can do for SSE2, and I'm still not sure
-    // it's faster than the default scalar operation. But anyway...
-    // suppose v = (a, b, c, d)
-    float4 ab_ab_cd_cd = shuffle<1,0,3,2>(v) + v;
-    // now x = (b,a,d,c) + (a,b,c,d) = (a+b,a+b,c+d,c+d)
-    float4 cd_cd_ab_ab = shuffle<2,3,0,1>(ab_ab_cd_cd);
-    // now y = (c+d,c+d,a+b,a+b)
-    float4 abcd = ab_ab_cd_cd + cd_cd_ab_ab;   // a+b+c+d in all components
-    return abcd;
+OIIO_FORCEINLINE float8 sqrt (const float8 &a)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_sqrt_ps (a.simd());
 #else
-    return float4 (v[0] + v[1] + v[2] + v[3]);
+    SIMD_RETURN (float8, sqrtf(a[i]));
 #endif
 }
 
 
-OIIO_FORCEINLINE float reduce_add (const float4& v) {
-#if OIIO_SIMD_SSE
-    return _mm_cvtss_f32(vreduce_add (v));
-#else
-    return v[0] + v[1] + v[2] + v[3];
-#endif
-}
 
-OIIO_FORCEINLINE float4 vdot (const float4 &a, const float4 &b) {
-#if OIIO_SIMD_SSE >= 4
-    return _mm_dp_ps (a.simd(), b.simd(), 0xff);
-#elif OIIO_SIMD_NEON
-    float32x4_t ab = vmulq_f32(a, b);
-    float32x4_t sum1 = vaddq_f32(ab, vrev64q_f32(ab));
-    return vaddq_f32(sum1, vcombine_f32(vget_high_f32(sum1), vget_low_f32(sum1)));
+OIIO_FORCEINLINE float8 rsqrt (const float8 &a)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_div_ps (_mm256_set1_ps(1.0f), _mm256_sqrt_ps (a.simd()));
 #else
-    return vreduce_add (a*b);
+    SIMD_RETURN (float8, 1.0f/sqrtf(a[i]));
 #endif
 }
 
-OIIO_FORCEINLINE float dot (const float4 &a, const float4 &b) {
-#if OIIO_SIMD_SSE >= 4
-    return _mm_cvtss_f32 (_mm_dp_ps (a.simd(), b.simd(), 0xff));
+
+
+OIIO_FORCEINLINE float8 rsqrt_fast (const float8 &a)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_rsqrt_ps (a.simd());
 #else
-    return reduce_add (a*b);
+    SIMD_RETURN (float8, 1.0f/sqrtf(a[i]));
 #endif
 }
 
-OIIO_FORCEINLINE float4 vdot3 (const float4 &a, const float4 &b) {
-#if OIIO_SIMD_SSE >= 4
-    return _mm_dp_ps (a.simd(), b.simd(), 0x7f);
+
+
+OIIO_FORCEINLINE float8 min (const float8& a, const float8& b)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_min_ps (a, b);
 #else
-    return vreduce_add((a*b).xyz0());
+    SIMD_RETURN (float8, std::min (a[i], b[i]));
 #endif
 }
 
-OIIO_FORCEINLINE float dot3 (const float4 &a, const float4 &b) {
-#if OIIO_SIMD_SSE >= 4
-    return _mm_cvtss_f32 (_mm_dp_ps (a.simd(), b.simd(), 0x77));
+OIIO_FORCEINLINE float8 max (const float8& a, const float8& b)
+{
+#if OIIO_SIMD_AVX
+    return _mm256_max_ps (a, b);
 #else
-    return reduce_add ((a*b).xyz0());
+    SIMD_RETURN (float8, std::max (a[i], b[i]));
 #endif
 }
 
 
-OIIO_FORCEINLINE float4 blend (const float4& a, const float4& b, const bool4& mask)
-{
-#if OIIO_SIMD_SSE >= 4
-    // SSE >= 4.1 only
-    return _mm_blendv_ps (a.simd(), b.simd(), mask.simd());
-#elif defined(OIIO_SIMD_SSE)
-    // Trick for SSE < 4.1
-    return _mm_or_ps (_mm_and_ps(mask.simd(), b.simd()),
-                      _mm_andnot_ps(mask.simd(), a.simd()));
+OIIO_FORCEINLINE float8 andnot (const float8& a, const float8& b) {
+#if OIIO_SIMD_AVX
+    return _mm256_andnot_ps (a.simd(), b.simd());
 #else
-    return float4 (mask[0] ? b[0] : a[0],
-                   mask[1] ? b[1] : a[1],
-                   mask[2] ? b[2] : a[2],
-                   mask[3] ? b[3] : a[3]);
+    const int *ai = (const int *)&a;
+    const int *bi = (const int *)&b;
+    return bitcast_to_float (int8(~(ai[0]) & bi[0],
+                                  ~(ai[1]) & bi[1],
+                                  ~(ai[2]) & bi[2],
+                                  ~(ai[3]) & bi[3],
+                                  ~(ai[4]) & bi[4],
+                                  ~(ai[5]) & bi[5],
+                                  ~(ai[6]) & bi[6],
+                                  ~(ai[7]) & bi[7]));
 #endif
 }
 
 
-OIIO_FORCEINLINE float4 blend0 (const float4& a, const bool4& mask)
+OIIO_FORCEINLINE float8 madd (const simd::float8& a, const simd::float8& b,
+                              const simd::float8& c)
 {
-#if OIIO_SIMD_SSE
-    return _mm_and_ps(mask.simd(), a.simd());
+#if OIIO_SIMD_AVX && OIIO_FMA_ENABLED
+    // If we are sure _mm256_fmadd_ps intrinsic is available, use it.
+    return _mm256_fmadd_ps (a, b, c);
 #else
-    return float4 (mask[0] ? a[0] : 0.0f,
-                   mask[1] ? a[1] : 0.0f,
-                   mask[2] ? a[2] : 0.0f,
-                   mask[3] ? a[3] : 0.0f);
+    // Fallback: just use regular math and hope for the best.
+    return a * b + c;
 #endif
 }
 
 
-OIIO_FORCEINLINE float4 blend0not (const float4& a, const bool4& mask)
+OIIO_FORCEINLINE float8 msub (const simd::float8& a, const simd::float8& b,
+                              const simd::float8& c)
 {
-#if OIIO_SIMD_SSE
-    return _mm_andnot_ps(mask.simd(), a.simd());
+#if OIIO_SIMD_AVX && OIIO_FMA_ENABLED
+    // If we are sure _mm256_fnmsub_ps intrinsic is available, use it.
+    return _mm256_fmsub_ps (a, b, c);
 #else
-    return float4 (mask[0] ? 0.0f : a[0],
-                   mask[1] ? 0.0f : a[1],
-                   mask[2] ? 0.0f : a[2],
-                   mask[3] ? 0.0f : a[3]);
+    // Fallback: just use regular math and hope for the best.
+    return a * b - c;
 #endif
 }
 
 
-OIIO_FORCEINLINE float4 safe_div (const float4 &a, const float4 &b) {
-#if OIIO_SIMD_SSE
-    return blend0not (a/b, b == float4::Zero());
+
+OIIO_FORCEINLINE float8 nmadd (const simd::float8& a, const simd::float8& b,
+                               const simd::float8& c)
+{
+#if OIIO_SIMD_AVX && OIIO_FMA_ENABLED
+    // If we are sure _mm256_fnmadd_ps intrinsic is available, use it.
+    return _mm256_fnmadd_ps (a, b, c);
 #else
-    return float4 (b[0] == 0.0f ? 0.0f : a[0] / b[0],
-                   b[1] == 0.0f ? 0.0f : a[1] / b[1],
-                   b[2] == 0.0f ? 0.0f : a[2] / b[2],
-                   b[3] == 0.0f ? 0.0f : a[3] / b[3]);
+    // Fallback: just use regular math and hope for the best.
+    return c - a * b;
 #endif
 }
 
 
-OIIO_FORCEINLINE float3 hdiv (const float4 &a)
+
+OIIO_FORCEINLINE float8 nmsub (const simd::float8& a, const simd::float8& b,
+                               const simd::float8& c)
 {
-#if OIIO_SIMD_SSE
-    return float3(safe_div(a, shuffle<3>(a)).xyz0());
+#if OIIO_SIMD_AVX && OIIO_FMA_ENABLED
+    // If we are sure _mm256_fnmsub_ps intrinsic is available, use it.
+    return _mm256_fnmsub_ps (a, b, c);
 #else
-    float d = a[3];
-    return d == 0.0f ? float3 (0.0f) : float3 (a[0]/d, a[1]/d, a[2]/d);
+    // Fallback: just use regular math and hope for the best.
+    return -(a * b) - c;
 #endif
 }
 
 
 
-OIIO_FORCEINLINE float4 select (const bool4& mask, const float4& a, const float4& b)
-{
-    return blend (b, a, mask);
+
+//////////////////////////////////////////////////////////////////////
+// bool16 implementation
+
+
+OIIO_FORCEINLINE int bool16::operator[] (int i) const {
+    DASSERT(i >= 0 && i < elements);
+    return ((int(m_simd) >> i) & 1) ? -1 : 0;
 }
 
+OIIO_FORCEINLINE void bool16::setcomp (int i, bool value) {
+    DASSERT(i >= 0 && i < elements);
+    int bits = int(m_simd);
+    bits = value ? (bits | (1<<i)) : (bits & ~(1<<i));
+    m_simd = simd_t(bits);
+}
 
-OIIO_FORCEINLINE float4 abs (const float4& a)
-{
-#if OIIO_SIMD_SSE
-    // Just clear the sign bit for cheap fabsf
-    return _mm_and_ps (a.simd(), _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
-#else
-    SIMD_RETURN (float4, fabsf(a[i]));
-#endif
+
+OIIO_FORCEINLINE std::ostream& operator<< (std::ostream& cout, const bool16& a) {
+    cout << a[0];
+    for (int i = 1; i < a.elements; ++i)
+        cout << ' ' << a[i];
+    return cout;
 }
 
 
-OIIO_FORCEINLINE float4 sign (const float4& a)
-{
-    float4 one(1.0f);
-    return blend (one, -one, a < float4::Zero());
+OIIO_FORCEINLINE bool16 bool16::from_bitmask (int bitmask) {
+    bool16 r;
+    r.m_simd = simd_t(bitmask & 0xffff);
+    return r;
 }
 
 
-OIIO_FORCEINLINE float4 ceil (const float4& a)
-{
-#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
-    return _mm_ceil_ps (a);
-#else
-    SIMD_RETURN (float4, ceilf(a[i]));
-#endif
+OIIO_FORCEINLINE void bool16::load (bool a) {
+    m_simd = simd_t(a ? 0xffff : 0);
 }
 
-OIIO_FORCEINLINE float4 floor (const float4& a)
-{
-#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
-    return _mm_floor_ps (a);
-#else
-    SIMD_RETURN (float4, floorf(a[i]));
-#endif
+
+OIIO_FORCEINLINE void bool16::load (bool v0, bool v1, bool v2, bool v3,
+                                    bool v4, bool v5, bool v6, bool v7,
+                                    bool v8, bool v9, bool v10, bool v11,
+                                    bool v12, bool v13, bool v14, bool v15) {
+    m_simd = simd_t(int(v0) | (int(v1)<<1) | (int(v2)<<2) | (int(v3)<<3)
+                    | (int(v4)<<4) | (int(v5)<<5) | (int(v6)<<6) | (int(v7)<<7)
+                    | (int(v8)<<8) | (int(v9)<<9) | (int(v10)<<10) | (int(v11)<<11)
+                    | (int(v12)<<12) | (int(v13)<<13) | (int(v14)<<14) | (int(v15)<<15));
 }
 
-OIIO_FORCEINLINE float4 round (const float4& a)
-{
-#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
-    return _mm_round_ps (a, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
-#else
-    SIMD_RETURN (float4, roundf(a[i]));
-#endif
+OIIO_FORCEINLINE bool16::bool16 (bool v0, bool v1, bool v2, bool v3,
+                                 bool v4, bool v5, bool v6, bool v7,
+                                 bool v8, bool v9, bool v10, bool v11,
+                                 bool v12, bool v13, bool v14, bool v15) {
+    load (v0, v1, v2, v3, v4, v5, v6, v7,
+          v8, v9, v10, v11, v12, v13, v14, v15);
 }
 
-OIIO_FORCEINLINE int4 floori (const float4& a)
-{
-#if defined(OIIO_SIMD_SSE) && OIIO_SIMD_SSE >= 4  /* SSE >= 4.1 */
-    return int4(floor(a));
-#elif defined(OIIO_SIMD_SSE)   /* SSE2/3 */
-    int4 i (a);  // truncates
-    int4 isneg = bitcast_to_int (a < float4::Zero());
-    return i + isneg;
-    // The trick here (thanks, Cycles, for letting me spy on your code) is
-    // that the comparison will return (int)-1 for components that are less
-    // than zero, and adding that is the same as subtracting one!
-#else
-    SIMD_RETURN (int4, (int)floorf(a[i]));
-#endif
+OIIO_FORCEINLINE bool16::bool16 (const bool *a) {
+    load (a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
+          a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15]);
 }
 
 
-OIIO_FORCEINLINE int4 rint (const float4& a)
-{
-    return int4 (round(a));
+OIIO_FORCEINLINE const bool16& bool16::operator= (bool a) {
+    load(a);
+    return *this;
 }
 
+OIIO_FORCEINLINE const bool16& bool16::operator= (const bool16 & other) {
+    m_simd = other.m_simd;
+    return *this;
+}
 
-OIIO_FORCEINLINE float4 sqrt (const float4 &a)
-{
-#if OIIO_SIMD_SSE
-    return _mm_sqrt_ps (a.simd());
-#else
-    SIMD_RETURN (float4, sqrtf(a[i]));
-#endif
+OIIO_FORCEINLINE void bool16::clear () {
+    m_simd = simd_t(0);
+}
+
+OIIO_FORCEINLINE const bool16 bool16::False () {
+    return bool16::from_bitmask (0);
 }
 
 
-OIIO_FORCEINLINE float4 rsqrt (const float4 &a)
-{
-#if OIIO_SIMD_SSE
-    return _mm_div_ps (_mm_set1_ps(1.0f), _mm_sqrt_ps (a.simd()));
-#else
-    SIMD_RETURN (float4, 1.0f/sqrtf(a[i]));
-#endif
+OIIO_FORCEINLINE const bool16 bool16::True () {
+    return bool16::from_bitmask (0xffff);
 }
 
 
-OIIO_FORCEINLINE float4 rsqrt_fast (const float4 &a)
-{
-#if OIIO_SIMD_SSE
-    return _mm_rsqrt_ps (a.simd());
-#else
-    SIMD_RETURN (float4, 1.0f/sqrtf(a[i]));
-#endif
+OIIO_FORCEINLINE void bool16::store (bool *values) const {
+    SIMD_DO (values[i] = (*this)[i] ? true : false);
+}
+
+OIIO_FORCEINLINE void bool16::store (bool *values, int n) const {
+    DASSERT (n >= 0 && n <= elements);
+    for (int i = 0; i < n; ++i)
+        values[i] = (*this)[i] ? true : false;
 }
 
 
-OIIO_FORCEINLINE float4 min (const float4& a, const float4& b)
-{
-#if OIIO_SIMD_SSE
-    return _mm_min_ps (a, b);
+OIIO_FORCEINLINE bool8 bool16::lo () const {
+#if OIIO_SIMD_AVX >= 512
+    // Expand the mask bits into full 32 bit lanes.
+    __m512i m = _mm512_maskz_mov_epi32 (m_simd, _mm512_set1_epi32(-1));
+    return _mm256_castsi256_ps (_mm512_castsi512_si256 (m));
 #else
-    SIMD_RETURN (float4, std::min (a[i], b[i]));
+    int m = bitmask();
+    return bool8 (m & 0x01, m & 0x02, m & 0x04, m & 0x08,
+                  m & 0x10, m & 0x20, m & 0x40, m & 0x80);
 #endif
 }
 
-OIIO_FORCEINLINE float4 max (const float4& a, const float4& b)
-{
-#if OIIO_SIMD_SSE
-    return _mm_max_ps (a, b);
+OIIO_FORCEINLINE bool8 bool16::hi () const {
+#if OIIO_SIMD_AVX >= 512
+    __m512i m = _mm512_maskz_mov_epi32 (m_simd, _mm512_set1_epi32(-1));
+    return _mm256_castsi256_ps (_mm512_extracti64x4_epi64 (m, 1));
 #else
-    SIMD_RETURN (float4, std::max (a[i], b[i]));
+    int m = bitmask() >> 8;
+    return bool8 (m & 0x01, m & 0x02, m & 0x04, m & 0x08,
+                  m & 0x10, m & 0x20, m & 0x40, m & 0x80);
 #endif
 }
 
 
-OIIO_FORCEINLINE float4 andnot (const float4& a, const float4& b) {
-#if OIIO_SIMD_SSE
-    return _mm_andnot_ps (a.simd(), b.simd());
+OIIO_FORCEINLINE bool16::bool16 (const bool8& lo, const bool8 &hi) {
+#if OIIO_SIMD_AVX
+    m_simd = simd_t (_mm256_movemask_ps(lo) | (_mm256_movemask_ps(hi) << 8));
 #else
-    const int *ai = (const int *)&a;
-    const int *bi = (const int *)&b;
-    return bitcast_to_float (int4(~(ai[0]) & bi[0],
-                                  ~(ai[1]) & bi[1],
-                                  ~(ai[2]) & bi[2],
-                                  ~(ai[3]) & bi[3]));
+    int m = 0;
+    for (int i = 0; i < 8; ++i)
+        m |= (lo[i] ? (1 << i) : 0) | (hi[i] ? (1 << (i+8)) : 0);
+    m_simd = simd_t (m);
 #endif
 }
 
 
-OIIO_FORCEINLINE float4 madd (const simd::float4& a, const simd::float4& b,
-                              const simd::float4& c)
-{
-#if OIIO_SIMD_SSE && OIIO_FMA_ENABLED
-    // If we are sure _mm_fmadd_ps intrinsic is available, use it.
-    return _mm_fmadd_ps (a, b, c);
-#elif OIIO_SIMD_SSE && !defined(_MSC_VER)
-    // If we directly access the underlying __m128, on some platforms and
-    // compiler flags, it will turn into fma anyway, even if we don't use
-    // the intrinsic.
-    return a.simd() * b.simd() + c.simd();
-#else
-    // Fallback: just use regular math and hope for the best.
-    return a * b + c;
-#endif
+OIIO_FORCEINLINE bool16 operator! (const bool16 & a) {
+    return bool16::from_bitmask (~a.bitmask());
 }
 
+OIIO_FORCEINLINE bool16 operator& (const bool16 & a, const bool16 & b) {
+    return bool16::from_bitmask (a.bitmask() & b.bitmask());
+}
 
-OIIO_FORCEINLINE float4 msub (const simd::float4& a, const simd::float4& b,
-                              const simd::float4& c)
-{
-#if OIIO_SIMD_SSE && OIIO_FMA_ENABLED
-    // If we are sure _mm_fnmsub_ps intrinsic is available, use it.
-    return _mm_fmsub_ps (a, b, c);
-#elif OIIO_SIMD_SSE && !defined(_MSC_VER)
-    // If we directly access the underlying __m128, on some platforms and
-    // compiler flags, it will turn into fma anyway, even if we don't use
-    // the intrinsic.
-    return a.simd() * b.simd() - c.simd();
-#else
-    // Fallback: just use regular math and hope for the best.
-    return a * b - c;
-#endif
+OIIO_FORCEINLINE bool16 operator| (const bool16 & a, const bool16 & b) {
+    return bool16::from_bitmask (a.bitmask() | b.bitmask());
 }
 
+OIIO_FORCEINLINE bool16 operator^ (const bool16& a, const bool16& b) {
+    return bool16::from_bitmask (a.bitmask() ^ b.bitmask());
+}
 
 
-OIIO_FORCEINLINE float4 nmadd (const simd::float4& a, const simd::float4& b,
-                               const simd::float4& c)
-{
-#if OIIO_SIMD_SSE && OIIO_FMA_ENABLED
-    // If we are sure _mm_fnmadd_ps intrinsic is available, use it.
-    return _mm_fnmadd_ps (a, b, c);
-#elif OIIO_SIMD_SSE && !defined(_MSC_VER)
-    // If we directly access the underlying __m128, on some platforms and
-    // compiler flags, it will turn into fma anyway, even if we don't use
-    // the intrinsic.
-    return c.simd() - a.simd() * b.simd();
-#else
-    // Fallback: just use regular math and hope for the best.
-    return c - a * b;
-#endif
+OIIO_FORCEINLINE const bool16& operator&= (bool16& a, const bool16 &b) {
+    return a = a & b;
 }
 
+OIIO_FORCEINLINE const bool16& operator|= (bool16& a, const bool16& b) {
+    return a = a | b;
+}
 
+OIIO_FORCEINLINE const bool16& operator^= (bool16& a, const bool16& b) {
+    return a = a ^ b;
+}
 
-OIIO_FORCEINLINE float4 nmsub (const simd::float4& a, const simd::float4& b,
-                               const simd::float4& c)
-{
-#if OIIO_SIMD_SSE && OIIO_FMA_ENABLED
-    // If we are sure _mm_fnmsub_ps intrinsic is available, use it.
-    return _mm_fnmsub_ps (a, b, c);
-#elif OIIO_SIMD_SSE && !defined(_MSC_VER)
-    // If we directly access the underlying __m128, on some platforms and
-    // compiler flags, it will turn into fma anyway, even if we don't use
-    // the intrinsic.
-    return -(a.simd() * b.simd()) - c.simd();
-#else
-    // Fallback: just use regular math and hope for the best.
-    return -(a * b) - c;
-#endif
+
+OIIO_FORCEINLINE bool16 operator~ (const bool16& a) {
+    return bool16::from_bitmask (~a.bitmask());
 }
 
 
+OIIO_FORCEINLINE bool16 operator== (const bool16 & a, const bool16 & b) {
+    return bool16::from_bitmask (~(a.bitmask() ^ b.bitmask()));
+}
 
-// Full precision exp() of all components of a SIMD vector.
-template<typename T>
-OIIO_FORCEINLINE T exp (const T& v)
-{
-#if OIIO_SIMD_SSE
-    // Implementation inspired by:
-    // https://github.com/embree/embree/blob/master/common/simd/sse_special.h
-    // Which is listed as Copyright (C) 2007  Julien Pommier and distributed
-    // under the zlib license.
-    typedef typename T::int_t int_t;
-    T x = v;
-    const float exp_hi (88.3762626647949f);
-    const float exp_lo (-88.3762626647949f);
-    const float cephes_LOG2EF (1.44269504088896341f);
-    const float cephes_exp_C1 (0.693359375f);
-    const float cephes_exp_C2 (-2.12194440e-4f);
-    const float cephes_exp_p0 (1.9875691500E-4f);
-    const float cephes_exp_p1 (1.3981999507E-3f);
-    const float cephes_exp_p2 (8.3334519073E-3f);
-    const float cephes_exp_p3 (4.1665795894E-2f);
-    const float cephes_exp_p4 (1.6666665459E-1f);
-    const float cephes_exp_p5 (5.0000001201E-1f);
-    T tmp (0.0f);
-    T one (1.0f);
-    x = min (x, T(exp_hi));
-    x = max (x, T(exp_lo));
-    T fx = madd (x, T(cephes_LOG2EF), T(0.5f));
-    int_t emm0 = int_t(fx);
-    tmp = T(emm0);
-    T mask = bitcast_to_float (bitcast_to_int(tmp > fx) & bitcast_to_int(one));
-    fx = tmp - mask;
-    tmp = fx * cephes_exp_C1;
-    T z = fx * cephes_exp_C2;
-    x = x - tmp;
-    x = x - z;
-    z = x * x;
-    T y = cephes_exp_p0;
-    y = madd (y, x, cephes_exp_p1);
-    y = madd (y, x, cephes_exp_p2);
-    y = madd (y, x, cephes_exp_p3);
-    y = madd (y, x, cephes_exp_p4);
-    y = madd (y, x, cephes_exp_p5);
-    y = madd (y, z, x);
-    y = y + one;
-    emm0 = (int_t(fx) + int_t(0x7f)) << 23;
-    T pow2n = bitcast_to_float(emm0);
-    y = y * pow2n;
-    return y;
-#else
-    SIMD_RETURN (T, expf(v[i]));
-#endif
+OIIO_FORCEINLINE bool16 operator!= (const bool16 & a, const bool16 & b) {
+    return bool16::from_bitmask (a.bitmask() ^ b.bitmask());
 }
 
 
+template<int i>
+OIIO_FORCEINLINE bool extract (const bool16& a) {
+    return (a.bitmask() >> i) & 1;
+}
 
-// Full precision log() of all components of a SIMD vector.
-template<typename T>
-OIIO_FORCEINLINE T log (const T& v)
-{
-#if OIIO_SIMD_SSE
-    // Implementation inspired by:
-    // https://github.com/embree/embree/blob/master/common/simd/sse_special.h
-    // Which is listed as Copyright (C) 2007  Julien Pommier and distributed
-    // under the zlib license.
-    typedef typename T::int_t int_t;
-    typedef typename T::bool_t bool_t;
-    T x = v;
-    int_t emm0;
-    T zero (T::Zero());
-    T one (1.0f);
-    bool_t invalid_mask = (x <= zero);
-    const int min_norm_pos ((int)0x00800000);
-    const int inv_mant_mask ((int)~0x7f800000);
-    x = max(x, bitcast_to_float(int_t(min_norm_pos)));  /* cut off denormalized stuff */
-    emm0 = srl (bitcast_to_int(x), 23);
-    /* keep only the fractional part */
-    x = bitcast_to_float (bitcast_to_int(x) & int_t(inv_mant_mask));
-    x = bitcast_to_float (bitcast_to_int(x) | bitcast_to_int(T(0.5f)));
-    emm0 = emm0 - int_t(0x7f);
-    T e (emm0);
-    e = e + one;
-    // OIIO_SIMD_FLOAT4_CONST (cephes_SQRTHF, 0.707106781186547524f);
-    const float cephes_SQRTHF (0.707106781186547524f);
-    bool_t mask = (x < T(cephes_SQRTHF));
-    T tmp = bitcast_to_float (bitcast_to_int(x) & bitcast_to_int(mask));
-    x = x - one;
-    e = e - bitcast_to_float (bitcast_to_int(one) & bitcast_to_int(mask));
-    x = x + tmp;
-    T z = x * x;
-    const float cephes_log_p0 (7.0376836292E-2f);
-    const float cephes_log_p1 (- 1.1514610310E-1f);
-    const float cephes_log_p2 (1.1676998740E-1f);
-    const float cephes_log_p3 (- 1.2420140846E-1f);
-    const float cephes_log_p4 (+ 1.4249322787E-1f);
-    const float cephes_log_p5 (- 1.6668057665E-1f);
-    const float cephes_log_p6 (+ 2.0000714765E-1f);
-    const float cephes_log_p7 (- 2.4999993993E-1f);
-    const float cephes_log_p8 (+ 3.3333331174E-1f);
-    const float cephes_log_q1 (-2.12194440e-4f);
-    const float cephes_log_q2 (0.693359375f);
-    T y = cephes_log_p0;
-    y = madd (y, x, T(cephes_log_p1));
-    y = madd (y, x, T(cephes_log_p2));
-    y = madd (y, x, T(cephes_log_p3));
-    y = madd (y, x, T(cephes_log_p4));
-    y = madd (y, x, T(cephes_log_p5));
-    y = madd (y, x, T(cephes_log_p6));
-    y = madd (y, x, T(cephes_log_p7));
-    y = madd (y, x, T(cephes_log_p8));
-    y = y * x;
-    y = y * z;
-    y = madd(e, T(cephes_log_q1), y);
-    y = nmadd (z, 0.5f, y);
-    x = x + y;
-    x = madd (e, T(cephes_log_q2), x);
-    x = bitcast_to_float (bitcast_to_int(x) | bitcast_to_int(invalid_mask)); // negative arg will be NAN
-    return x;
+template<int i>
+OIIO_FORCEINLINE bool16 insert (const bool16& a, bool val) {
+    bool16 tmp = a;
+    tmp.setcomp (i, val);
+    return tmp;
+}
+
+
+OIIO_FORCEINLINE bool reduce_and (const bool16& v) {
+    return v.bitmask() == 0xffff;
+}
+
+OIIO_FORCEINLINE bool reduce_or (const bool16& v) {
+    return v.bitmask() != 0;
+}
+
+
+OIIO_FORCEINLINE bool all (const bool16& v) { return reduce_and(v) == true; }
+OIIO_FORCEINLINE bool any (const bool16& v) { return reduce_or(v) == true; }
+OIIO_FORCEINLINE bool none (const bool16& v) { return reduce_or(v) == false; }
+
+
+
+//////////////////////////////////////////////////////////////////////
+// int16 implementation
+
+OIIO_FORCEINLINE const int16 & int16::operator= (int16 other) {
+    m_simd = other.m_simd;
+    return *this;
+}
+
+OIIO_FORCEINLINE int& int16::operator[] (int i) {
+    DASSERT(i<elements);
+    return m_val[i];
+}
+
+OIIO_FORCEINLINE int int16::operator[] (int i) const {
+    DASSERT(i<elements);
+    return m_val[i];
+}
+
+
+OIIO_FORCEINLINE int8 int16::lo () const {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_castsi512_si256 (simd());
 #else
-    SIMD_RETURN (T, logf(v[i]));
+    return m_8[0];
 #endif
 }
 
+OIIO_FORCEINLINE int8 int16::hi () const {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_extracti64x4_epi64 (simd(), 1);
+#else
+    return m_8[1];
+#endif
+}
 
 
-OIIO_FORCEINLINE void transpose (float4 &a, float4 &b, float4 &c, float4 &d)
-{
-#if OIIO_SIMD_SSE
-    _MM_TRANSPOSE4_PS (a, b, c, d);
+OIIO_FORCEINLINE int16::int16 (const int8& lo, const int8 &hi) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_inserti64x4 (_mm512_castsi256_si512 (lo), hi, 1);
 #else
-    float4 A (a[0], b[0], c[0], d[0]);
-    float4 B (a[1], b[1], c[1], d[1]);
-    float4 C (a[2], b[2], c[2], d[2]);
-    float4 D (a[3], b[3], c[3], d[3]);
-    a = A;  b = B;  c = C;  d = D;
+    m_8[0] = lo;
+    m_8[1] = hi;
 #endif
 }
 
 
-OIIO_FORCEINLINE void transpose (const float4& a, const float4& b, const float4& c, const float4& d,
-                                 float4 &r0, float4 &r1, float4 &r2, float4 &r3)
-{
-#if OIIO_SIMD_SSE
-    //_MM_TRANSPOSE4_PS (a, b, c, d);
-    float4 l02 = _mm_unpacklo_ps (a, c);
-    float4 h02 = _mm_unpackhi_ps (a, c);
-    float4 l13 = _mm_unpacklo_ps (b, d);
-    float4 h13 = _mm_unpackhi_ps (b, d);
-    r0 = _mm_unpacklo_ps (l02, l13);
-    r1 = _mm_unpackhi_ps (l02, l13);
-    r2 = _mm_unpacklo_ps (h02, h13);
-    r3 = _mm_unpackhi_ps (h02, h13);
+OIIO_FORCEINLINE void int16::load (int a) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_set1_epi32 (a);
 #else
-    r0.load (a[0], b[0], c[0], d[0]);
-    r1.load (a[1], b[1], c[1], d[1]);
-    r2.load (a[2], b[2], c[2], d[2]);
-    r3.load (a[3], b[3], c[3], d[3]);
+    m_8[0] = int8 (a);
+    m_8[1] = int8 (a);
 #endif
 }
 
 
-OIIO_FORCEINLINE void transpose (int4 &a, int4 &b, int4 &c, int4 &d)
-{
-#if OIIO_SIMD_SSE
-    __m128 A = _mm_castsi128_ps (a);
-    __m128 B = _mm_castsi128_ps (b);
-    __m128 C = _mm_castsi128_ps (c);
-    __m128 D = _mm_castsi128_ps (d);
-    _MM_TRANSPOSE4_PS (A, B, C, D);
-    a = _mm_castps_si128 (A);
-    b = _mm_castps_si128 (B);
-    c = _mm_castps_si128 (C);
-    d = _mm_castps_si128 (D);
+OIIO_FORCEINLINE void int16::load (int v0, int v1, int v2, int v3,
+                                   int v4, int v5, int v6, int v7,
+                                   int v8, int v9, int v10, int v11,
+                                   int v12, int v13, int v14, int v15) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_set_epi32 (v15, v14, v13, v12, v11, v10, v9, v8,
+                               v7, v6, v5, v4, v3, v2, v1, v0);
 #else
-    int4 A (a[0], b[0], c[0], d[0]);
-    int4 B (a[1], b[1], c[1], d[1]);
-    int4 C (a[2], b[2], c[2], d[2]);
-    int4 D (a[3], b[3], c[3], d[3]);
-    a = A;  b = B;  c = C;  d = D;
+    m_8[0] = int8 (v0, v1, v2, v3, v4, v5, v6, v7);
+    m_8[1] = int8 (v8, v9, v10, v11, v12, v13, v14, v15);
 #endif
 }
 
-OIIO_FORCEINLINE void transpose (const int4& a, const int4& b, const int4& c, const int4& d,
-                                 int4 &r0, int4 &r1, int4 &r2, int4 &r3)
-{
-#if OIIO_SIMD_SSE
-    //_MM_TRANSPOSE4_PS (a, b, c, d);
-    __m128 A = _mm_castsi128_ps (a);
-    __m128 B = _mm_castsi128_ps (b);
-    __m128 C = _mm_castsi128_ps (c);
-    __m128 D = _mm_castsi128_ps (d);
-    _MM_TRANSPOSE4_PS (A, B, C, D);
-    r0 = _mm_castps_si128 (A);
-    r1 = _mm_castps_si128 (B);
-    r2 = _mm_castps_si128 (C);
-    r3 = _mm_castps_si128 (D);
+
+OIIO_FORCEINLINE void int16::load (const int *values) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_loadu_si512 ((const simd_t *)values);
 #else
-    r0.load (a[0], b[0], c[0], d[0]);
-    r1.load (a[1], b[1], c[1], d[1]);
-    r2.load (a[2], b[2], c[2], d[2]);
-    r3.load (a[3], b[3], c[3], d[3]);
+    m_8[0] = int8 (values);
+    m_8[1] = int8 (values+8);
 #endif
 }
 
 
-OIIO_FORCEINLINE float4 AxBxCxDx (const float4& a, const float4& b,
-                                  const float4& c, const float4& d)
+OIIO_FORCEINLINE void int16::load (const int *values, int n)
 {
-#if OIIO_SIMD_SSE
-    float4 l02 = _mm_unpacklo_ps (a, c);
-    float4 l13 = _mm_unpacklo_ps (b, d);
-    return _mm_unpacklo_ps (l02, l13);
-#else
-    return float4 (a[0], b[0], c[0], d[0]);
+    DASSERT (n >= 0 && n <= elements);
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_maskz_loadu_epi32 (__mmask16((1 << n) - 1), values);
+#else
+    if (n <= 8) {
+        int8 l; l.load (values, n);
+        m_8[0] = l;
+        m_8[1] = int8::Zero();
+    } else {
+        int8 h; h.load (values+8, n-8);
+        m_8[0] = int8 (values);
+        m_8[1] = h;
+    }
 #endif
 }
 
 
-OIIO_FORCEINLINE int4 AxBxCxDx (const int4& a, const int4& b,
-                                const int4& c, const int4& d)
-{
-#if OIIO_SIMD_SSE
-    int4 l02 = _mm_unpacklo_epi32 (a, c);
-    int4 l13 = _mm_unpacklo_epi32 (b, d);
-    return _mm_unpacklo_epi32 (l02, l13);
+OIIO_FORCEINLINE void int16::load (const short *values) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_cvtepi16_epi32 (_mm256_loadu_si256 ((const __m256i *)values));
 #else
-    return int4 (a[0], b[0], c[0], d[0]);
+    m_8[0] = int8 (values);
+    m_8[1] = int8 (values+8);
 #endif
 }
 
+OIIO_FORCEINLINE void int16::load (const unsigned short *values) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_cvtepu16_epi32 (_mm256_loadu_si256 ((const __m256i *)values));
+#else
+    m_8[0] = int8 (values);
+    m_8[1] = int8 (values+8);
+#endif
+}
 
 
-//////////////////////////////////////////////////////////////////////
-// float3 implementation
-
-OIIO_FORCEINLINE float3::float3 (const float3 &other) {
-#if defined(OIIO_SIMD_SSE) || defined(OIIO_SIMD_NEON)
-    m_simd = other.m_simd;
+OIIO_FORCEINLINE void int16::load (const char *values) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_cvtepi8_epi32 (_mm_loadu_si128 ((const __m128i *)values));
 #else
-    SIMD_CONSTRUCT_PAD (other[i]);
+    m_8[0] = int8 (values);
+    m_8[1] = int8 (values+8);
 #endif
 }
 
-OIIO_FORCEINLINE float3::float3 (const float4 &other) {
-#if defined(OIIO_SIMD_SSE) || defined(OIIO_SIMD_NEON)
-    m_simd = other.simd();
+OIIO_FORCEINLINE void int16::load (const unsigned char *values) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_cvtepu8_epi32 (_mm_loadu_si128 ((const __m128i *)values));
 #else
-    SIMD_CONSTRUCT_PAD (other[i]);
-    m_val[3] = 0.0f;
+    m_8[0] = int8 (values);
+    m_8[1] = int8 (values+8);
 #endif
 }
 
-OIIO_FORCEINLINE const float3 float3::Zero () { return float3(float4::Zero()); }
 
-OIIO_FORCEINLINE const float3 float3::One () { return float3(1.0f); }
+OIIO_FORCEINLINE int16::int16 (int a) { load(a); }
 
-OIIO_FORCEINLINE const float3 float3::Iota (float start, float step) {
-    return float3 (start+0.0f*step, start+1.0f*step, start+2.0f*step);
+OIIO_FORCEINLINE int16::int16 (int v0, int v1, int v2, int v3,
+                               int v4, int v5, int v6, int v7,
+                               int v8, int v9, int v10, int v11,
+                               int v12, int v13, int v14, int v15) {
+    load (v0, v1, v2, v3, v4, v5, v6, v7,
+          v8, v9, v10, v11, v12, v13, v14, v15);
 }
 
+OIIO_FORCEINLINE int16::int16 (const int *vals) { load (vals); }
+OIIO_FORCEINLINE int16::int16 (const unsigned short *vals) { load(vals); }
+OIIO_FORCEINLINE int16::int16 (const short *vals) { load(vals); }
+OIIO_FORCEINLINE int16::int16 (const unsigned char *vals) { load(vals); }
+OIIO_FORCEINLINE int16::int16 (const char *vals) { load(vals); }
 
-OIIO_FORCEINLINE void float3::load (float val) { float4::load (val, val, val, 0.0f); }
+OIIO_FORCEINLINE const int16 & int16::operator= (int a) { load(a); return *this; }
 
-OIIO_FORCEINLINE void float3::load (const float *values) { float4::load (values, 3); }
 
-OIIO_FORCEINLINE void float3::load (const float *values, int n) {
-    float4::load (values, n);
+OIIO_FORCEINLINE void int16::store (int *values) const {
+#if OIIO_SIMD_AVX >= 512
+    // Use an unaligned store -- it's just as fast when the memory turns
+    // out to be aligned, nearly as fast even when unaligned. Not worth
+    // the headache of using stores that require alignment.
+    _mm512_storeu_si512 ((simd_t *)values, m_simd);
+#else
+    lo().store (values);
+    hi().store (values+8);
+#endif
 }
 
-OIIO_FORCEINLINE void float3::load (const unsigned short *values) {
-    float4::load (float(values[0]), float(values[1]), float(values[2]));
-}
 
-OIIO_FORCEINLINE void float3::load (const short *values) {
-    float4::load (float(values[0]), float(values[1]), float(values[2]));
+OIIO_FORCEINLINE void int16::store (int *values, int n) const {
+    DASSERT (n >= 0 && n <= elements);
+#if OIIO_SIMD_AVX >= 512
+    _mm512_mask_storeu_epi32 (values, __mmask16((1 << n) - 1), m_simd);
+#else
+    if (n <= 8) {
+        lo().store (values, n);
+    } else {
+        lo().store (values);
+        hi().store (values+8, n-8);
+    }
+#endif
 }
 
-OIIO_FORCEINLINE void float3::load (const unsigned char *values) {
-    float4::load (float(values[0]), float(values[1]), float(values[2]));
-}
 
-OIIO_FORCEINLINE void float3::load (const char *values) {
-    float4::load (float(values[0]), float(values[1]), float(values[2]));
+OIIO_FORCEINLINE void int16::store (unsigned short *values) const {
+#if OIIO_SIMD_AVX >= 512
+    _mm256_storeu_si256 ((__m256i *)values, _mm512_cvtepi32_epi16 (m_simd));
+#else
+    lo().store (values);
+    hi().store (values+8);
+#endif
 }
 
-#ifdef _HALF_H_
-OIIO_FORCEINLINE void float3::load (const half *values) {
-    float4::load (float(values[0]), float(values[1]), float(values[2]));
-}
-#endif /* _HALF_H_ */
 
-OIIO_FORCEINLINE void float3::store (float *values) const {
-    float4::store (values, 3);
+OIIO_FORCEINLINE void int16::store (unsigned char *values) const {
+#if OIIO_SIMD_AVX >= 512
+    _mm_storeu_si128 ((__m128i *)values, _mm512_cvtepi32_epi8 (m_simd));
+#else
+    lo().store (values);
+    hi().store (values+8);
+#endif
 }
 
-OIIO_FORCEINLINE void float3::store (float *values, int n) const {
-    float4::store (values, n);
-}
 
-#ifdef _HALF_H_
-OIIO_FORCEINLINE void float3::store (half *values) const {
-    SIMD_DO (values[i] = m_val[i]);
-}
+OIIO_FORCEINLINE void int16::clear () {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_setzero_si512();
+#else
+    load (0);
 #endif
-
-OIIO_FORCEINLINE void float3::store (Imath::V3f &vec) const {
-    store ((float *)&vec);
 }
 
-OIIO_FORCEINLINE float3 operator+ (const float3& a, const float3& b) {
-    return float3 (float4(a) + float4(b));
+
+OIIO_FORCEINLINE const int16 int16::Zero () {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_setzero_si512();
+#else
+    return int16(0);
+#endif
 }
 
-OIIO_FORCEINLINE const float3 & float3::operator+= (const float3& a) {
-    *this = *this + a; return *this;
+OIIO_FORCEINLINE const int16 int16::One () { return int16(1); }
+
+OIIO_FORCEINLINE const int16 int16::NegOne () { return int16(-1); }
+
+
+OIIO_FORCEINLINE const int16 int16::Iota (int start, int step) {
+    return int16 (start+0*step, start+1*step, start+2*step, start+3*step,
+                  start+4*step, start+5*step, start+6*step, start+7*step,
+                  start+8*step, start+9*step, start+10*step, start+11*step,
+                  start+12*step, start+13*step, start+14*step, start+15*step);
 }
 
-OIIO_FORCEINLINE float3 float3::operator- () const {
-    return float3 (-float4(*this));
+
+OIIO_FORCEINLINE int16 operator+ (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_add_epi32 (a.simd(), b.simd());
+#else
+    return int16 (a.lo()+b.lo(), a.hi()+b.hi());
+#endif
 }
 
-OIIO_FORCEINLINE float3 operator- (const float3& a, const float3& b) {
-    return float3 (float4(a) - float4(b));
+
+OIIO_FORCEINLINE const int16& operator+= (int16& a, const int16& b) {
+    return a = a + b;
 }
 
-OIIO_FORCEINLINE const float3 & float3::operator-= (const float3& a) {
-    *this = *this - a; return *this;
+
+OIIO_FORCEINLINE int16 operator- (const int16& a) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_sub_epi32 (_mm512_setzero_si512(), a);
+#else
+    return int16 (-a.lo(), -a.hi());
+#endif
 }
 
-OIIO_FORCEINLINE float3 operator* (const float3& a, const float3& b) {
-    return float3 (float4(a) * float4(b));
+
+OIIO_FORCEINLINE int16 operator- (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_sub_epi32 (a.simd(), b.simd());
+#else
+    return int16 (a.lo()-b.lo(), a.hi()-b.hi());
+#endif
 }
 
-OIIO_FORCEINLINE const float3 & float3::operator*= (const float3& a) {
-    *this = *this * a; return *this;
+
+OIIO_FORCEINLINE const int16 &operator-= (int16& a, const int16& b) {
+    return a = a - b;
 }
 
-OIIO_FORCEINLINE const float3 & float3::operator*= (float a) {
-    *this = *this * a; return *this;
+
+OIIO_FORCEINLINE int16 operator* (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_mullo_epi32 (a.simd(), b.simd());
+#else
+    return int16 (a.lo()*b.lo(), a.hi()*b.hi());
+#endif
 }
 
-OIIO_FORCEINLINE float3 operator/ (const float3& a, const float3& b) {
-    return float3 (float4(a) / b.xyz1()); // Avoid divide by zero!
+
+OIIO_FORCEINLINE const int16& operator*= (int16& a, const int16& b) { return a = a * b; }
+
+
+OIIO_FORCEINLINE int16 operator/ (const int16& a, const int16& b) {
+    // NO INTEGER DIVISION IN SSE/AVX!
+    SIMD_RETURN (int16, a[i] / b[i]);
 }
 
-OIIO_FORCEINLINE const float3 & float3::operator/= (const float3& a) {
-    *this = *this / a; return *this;
+OIIO_FORCEINLINE const int16& operator/= (int16& a, const int16& b) { return a = a / b; }
+
+
+OIIO_FORCEINLINE int16 operator% (const int16& a, const int16& b) {
+    // NO INTEGER MODULUS IN SSE/AVX!
+    SIMD_RETURN (int16, a[i] % b[i]);
 }
 
-OIIO_FORCEINLINE const float3 & float3::operator/= (float a) {
-    *this = *this / a; return *this;
+OIIO_FORCEINLINE const int16& operator%= (int16& a, const int16& b) { return a = a % b; }
+
+
+OIIO_FORCEINLINE int16 operator& (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_and_si512 (a.simd(), b.simd());
+#else
+    return int16 (a.lo() & b.lo(), a.hi() & b.hi());
+#endif
 }
 
+OIIO_FORCEINLINE const int16& operator&= (int16& a, const int16& b) { return a = a & b; }
 
-inline std::ostream& operator<< (std::ostream& cout, const float3& val) {
-    cout << val[0];
-    for (int i = 1; i < val.elements; ++i)
-        cout << ' ' << val[i];
-    return cout;
+
+OIIO_FORCEINLINE int16 operator| (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_or_si512 (a.simd(), b.simd());
+#else
+    return int16 (a.lo() | b.lo(), a.hi() | b.hi());
+#endif
 }
 
+OIIO_FORCEINLINE const int16& operator|= (int16& a, const int16& b) { return a = a | b; }
 
-OIIO_FORCEINLINE float3 vreduce_add (const float3& v) {
-#if OIIO_SIMD_SSE
-    return float3 ((vreduce_add(float4(v))).xyz0());
+
+OIIO_FORCEINLINE int16 operator^ (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_xor_si512 (a.simd(), b.simd());
 #else
-    return float3 (v[0] + v[1] + v[2]);
+    return int16 (a.lo() ^ b.lo(), a.hi() ^ b.hi());
 #endif
 }
 
+OIIO_FORCEINLINE const int16& operator^= (int16& a, const int16& b) { return a = a ^ b; }
 
-OIIO_FORCEINLINE float3 vdot (const float3 &a, const float3 &b) {
-#if OIIO_SIMD_SSE >= 4
-    return float3(_mm_dp_ps (a.simd(), b.simd(), 0x77));
+
+OIIO_FORCEINLINE int16 operator~ (const int16& a) {
+#if OIIO_SIMD_AVX >= 512
+    return a ^ a.NegOne();
 #else
-    return vreduce_add (a*b);
+    return int16 (~a.lo(), ~a.hi());
 #endif
 }
 
 
-OIIO_FORCEINLINE float dot (const float3 &a, const float3 &b) {
-#if OIIO_SIMD_SSE >= 4
-    return _mm_cvtss_f32 (_mm_dp_ps (a.simd(), b.simd(), 0x77));
+OIIO_FORCEINLINE int16 operator<< (const int16& a, unsigned int bits) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_sll_epi32 (a, _mm_cvtsi32_si128(int(bits)));
 #else
-    return reduce_add (a*b);
+    return int16 (a.lo() << bits, a.hi() << bits);
 #endif
 }
 
 
-OIIO_FORCEINLINE float3 vdot3 (const float3 &a, const float3 &b) {
-#if OIIO_SIMD_SSE >= 4
-    return float3(_mm_dp_ps (a.simd(), b.simd(), 0x77));
+OIIO_FORCEINLINE const int16& operator<<= (int16& a, const unsigned int bits) {
+    return a = a << bits;
+}
+
+OIIO_FORCEINLINE int16 operator>> (const int16& a, const unsigned int bits) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_sra_epi32 (a, _mm_cvtsi32_si128(int(bits)));
 #else
-    return float3 (vreduce_add((a*b).xyz0()).xyz0());
+    return int16 (a.lo() >> bits, a.hi() >> bits);
 #endif
 }
 
-OIIO_FORCEINLINE float3 float3::normalized () const
-{
-#if OIIO_SIMD
-    float3 len2 = vdot3 (*this, *this);
-    return float3 (safe_div (*this, sqrt(len2)));
+OIIO_FORCEINLINE const int16& operator>>= (int16& a, const unsigned int bits) {
+    return a = a >> bits;
+}
+
+
+OIIO_FORCEINLINE int16 srl (const int16& a, const unsigned int bits) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_srl_epi32 (a, _mm_cvtsi32_si128(int(bits)));
 #else
-    float len2 = dot (*this, *this);
-    return len2 > 0.0f ? (*this) / sqrtf(len2) : float3::Zero();
+    return int16 (srl (a.lo(), bits), srl (a.hi(), bits));
 #endif
 }
 
 
-OIIO_FORCEINLINE float3 float3::normalized_fast () const
-{
-#if OIIO_SIMD
-    float3 len2 = vdot3 (*this, *this);
-    float4 invlen = blend0not (rsqrt_fast (len2), len2 == float4::Zero());
-    return float3 ((*this) * invlen);
-#else
-    float len2 = dot (*this, *this);
-    return len2 > 0.0f ? (*this) / sqrtf(len2) : float3::Zero();
+OIIO_FORCEINLINE bool16 operator== (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmpeq_epi32_mask (a.simd(), b.simd()));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() == b.lo(), a.hi() == b.hi());
 #endif
 }
 
 
+OIIO_FORCEINLINE bool16 operator!= (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmpneq_epi32_mask (a.simd(), b.simd()));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() != b.lo(), a.hi() != b.hi());
+#endif
+}
+
 
-//////////////////////////////////////////////////////////////////////
-// matrix44 implementation
+OIIO_FORCEINLINE bool16 operator> (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmpgt_epi32_mask (a.simd(), b.simd()));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() > b.lo(), a.hi() > b.hi());
+#endif
+}
 
 
-OIIO_FORCEINLINE const Imath::M44f& matrix44::M44f() const {
-    return *(Imath::M44f*)this;
+OIIO_FORCEINLINE bool16 operator< (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmplt_epi32_mask (a.simd(), b.simd()));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() < b.lo(), a.hi() < b.hi());
+#endif
 }
 
 
-OIIO_FORCEINLINE float4 matrix44::operator[] (int i) const {
-#if OIIO_SIMD_SSE
-    return m_row[i];
-#else
-    return float4 (m_mat[i]);
+OIIO_FORCEINLINE bool16 operator>= (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmpge_epi32_mask (a.simd(), b.simd()));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() >= b.lo(), a.hi() >= b.hi());
 #endif
 }
 
 
-OIIO_FORCEINLINE matrix44 matrix44::transposed () const {
-    matrix44 T;
-#if OIIO_SIMD_SSE
-    simd::transpose (m_row[0], m_row[1], m_row[2], m_row[3],
-                     T.m_row[0], T.m_row[1], T.m_row[2], T.m_row[3]);
-#else
-    T = m_mat.transposed();
+OIIO_FORCEINLINE bool16 operator<= (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmple_epi32_mask (a.simd(), b.simd()));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() <= b.lo(), a.hi() <= b.hi());
 #endif
-    return T;
 }
 
-OIIO_FORCEINLINE float3 matrix44::transformp (const float3 &V) const {
-#if OIIO_SIMD_SSE
-    float4 R = shuffle<0>(V) * m_row[0] + shuffle<1>(V) * m_row[1] +
-               shuffle<2>(V) * m_row[2] + m_row[3];
-    R = R / shuffle<3>(R);
-    return float3 (R.xyz0());
+
+inline std::ostream& operator<< (std::ostream& cout, const int16& val) {
+    cout << val[0];
+    for (int i = 1; i < val.elements; ++i)
+        cout << ' ' << val[i];
+    return cout;
+}
+
+
+template<int i>
+OIIO_FORCEINLINE int extract (const int16& v) {
+#if OIIO_SIMD_AVX >= 512 && !_WIN32
+    return _mm_extract_epi32 (_mm512_extracti32x4_epi32 (v.simd(), i/4), i%4);
 #else
-    Imath::V3f R;
-    m_mat.multVecMatrix (*(Imath::V3f *)&V, R);
-    return float3(R);
+    return v[i];
 #endif
 }
 
-OIIO_FORCEINLINE float3 matrix44::transformv (const float3 &V) const {
-#if OIIO_SIMD_SSE
-    float4 R = shuffle<0>(V) * m_row[0] + shuffle<1>(V) * m_row[1] +
-               shuffle<2>(V) * m_row[2];
-    return float3 (R.xyz0());
+
+template<int i>
+OIIO_FORCEINLINE int16 insert (const int16& a, int val) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_mask_set1_epi32 (a.simd(), __mmask16(1 << i), val);
 #else
-    Imath::V3f R;
-    m_mat.multDirMatrix (*(Imath::V3f *)&V, R);
-    return float3(R);
+    int16 tmp = a;
+    tmp[i] = val;
+    return tmp;
 #endif
 }
 
-OIIO_FORCEINLINE float3 matrix44::transformvT (const float3 &V) const {
-#if OIIO_SIMD_SSE
-    matrix44 T = transposed();
-    float4 R = shuffle<0>(V) * T[0] + shuffle<1>(V) * T[1] +
-               shuffle<2>(V) * T[2];
-    return float3 (R.xyz0());
+
+OIIO_FORCEINLINE bool16::bool16 (const int16& ival) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_test_epi32_mask (ival.simd(), ival.simd());
 #else
-    Imath::V3f R;
-    m_mat.transposed().multDirMatrix (*(Imath::V3f *)&V, R);
-    return float3(R);
+    *this = bool16 (bool8(ival.lo()), bool8(ival.hi()));
 #endif
 }
 
-OIIO_FORCEINLINE bool matrix44::operator== (const matrix44& m) const {
-#if OIIO_SIMD_SSE
-    bool4 b0 = (m_row[0] == m[0]);
-    bool4 b1 = (m_row[1] == m[1]);
-    bool4 b2 = (m_row[2] == m[2]);
-    bool4 b3 = (m_row[3] == m[3]);
-    return simd::all (b0 & b1 & b2 & b3);
+
+OIIO_FORCEINLINE int16 bitcast_to_int (const bool16& x)
+{
+    // N.B. bool16 is a bit mask, so "bitcast" expands each bit into a
+    // full 32 bit lane of all ones or all zeroes, like the narrower bools.
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_maskz_mov_epi32 (x, _mm512_set1_epi32(-1));
 #else
-    return memcmp(this, &m, 16*sizeof(float)) == 0;
+    return int16 (bitcast_to_int (x.lo()), bitcast_to_int (x.hi()));
 #endif
 }
 
-OIIO_FORCEINLINE bool matrix44::operator== (const Imath::M44f& m) const {
-    return memcmp(this, &m, 16*sizeof(float)) == 0;
-}
 
-OIIO_FORCEINLINE bool operator== (const Imath::M44f& a, const matrix44 &b) {
-    return (b == a);
+OIIO_FORCEINLINE int16 vreduce_add (const int16& v) {
+    return int16 (reduce_add (v));
 }
 
-OIIO_FORCEINLINE bool matrix44::operator!= (const matrix44& m) const {
-#if OIIO_SIMD_SSE
-    bool4 b0 = (m_row[0] != m[0]);
-    bool4 b1 = (m_row[1] != m[1]);
-    bool4 b2 = (m_row[2] != m[2]);
-    bool4 b3 = (m_row[3] != m[3]);
-    return simd::any (b0 | b1 | b2 | b3);
+
+OIIO_FORCEINLINE int reduce_add (const int16& v) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_reduce_add_epi32 (v.simd());
 #else
-    return memcmp(this, &m, 16*sizeof(float)) != 0;
+    return reduce_add (v.lo() + v.hi());
 #endif
 }
 
-OIIO_FORCEINLINE bool matrix44::operator!= (const Imath::M44f& m) const {
-    return memcmp(this, &m, 16*sizeof(float)) != 0;
+
+OIIO_FORCEINLINE int reduce_and (const int16& v) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_reduce_and_epi32 (v.simd());
+#else
+    return reduce_and (v.lo() & v.hi());
+#endif
 }
 
-OIIO_FORCEINLINE bool operator!= (const Imath::M44f& a, const matrix44 &b) {
-    return (b != a);
+
+OIIO_FORCEINLINE int reduce_or (const int16& v) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_reduce_or_epi32 (v.simd());
+#else
+    return reduce_or (v.lo() | v.hi());
+#endif
 }
 
-OIIO_FORCEINLINE matrix44 matrix44::inverse() const {
-#if OIIO_SIMD_SSE
-    // Adapted from this code from Intel:
-    // ftp://download.intel.com/design/pentiumiii/sml/24504301.pdf
-    float4 minor0, minor1, minor2, minor3;
-    float4 row0, row1, row2, row3;
-    float4 det, tmp1;
-    const float *src = (const float *)this;
-    float4 zero = float4::Zero();
-    tmp1 = _mm_loadh_pi(_mm_loadl_pi(zero, (__m64*)(src)), (__m64*)(src+ 4));
-    row1 = _mm_loadh_pi(_mm_loadl_pi(zero, (__m64*)(src+8)), (__m64*)(src+12));
-    row0 = _mm_shuffle_ps(tmp1, row1, 0x88);
-    row1 = _mm_shuffle_ps(row1, tmp1, 0xDD);
-    tmp1 = _mm_loadh_pi(_mm_loadl_pi(tmp1, (__m64*)(src+ 2)), (__m64*)(src+ 6));
-    row3 = _mm_loadh_pi(_mm_loadl_pi(zero, (__m64*)(src+10)), (__m64*)(src+14));
-    row2 = _mm_shuffle_ps(tmp1, row3, 0x88);
-    row3 = _mm_shuffle_ps(row3, tmp1, 0xDD);
-    // -----------------------------------------------
-    tmp1 = row2 * row3;
-    tmp1 = shuffle<1,0,3,2>(tmp1);
-    minor0 = row1 * tmp1;
-    minor1 = row0 * tmp1;
-    tmp1 = shuffle<2,3,0,1>(tmp1);
-    minor0 = (row1 * tmp1) - minor0;
-    minor1 = (row0 * tmp1) - minor1;
-    minor1 = shuffle<2,3,0,1>(minor1);
-    // -----------------------------------------------
-    tmp1 = row1 * row2;
-    tmp1 = shuffle<1,0,3,2>(tmp1);
-    minor0 = (row3 * tmp1) + minor0;
-    minor3 = row0 * tmp1;
-    tmp1 = shuffle<2,3,0,1>(tmp1);
-    minor0 = minor0 - (row3 * tmp1);
-    minor3 = (row0 * tmp1) - minor3;
-    minor3 = shuffle<2,3,0,1>(minor3);
-    // -----------------------------------------------
-    tmp1 = shuffle<2,3,0,1>(row1) * row3;
-    tmp1 = shuffle<1,0,3,2>(tmp1);
-    row2 = shuffle<2,3,0,1>(row2);
-    minor0 = (row2 * tmp1) + minor0;
-    minor2 = row0 * tmp1;
-    tmp1 = shuffle<2,3,0,1>(tmp1);
-    minor0 = minor0 - (row2 * tmp1);
-    minor2 = (row0 * tmp1) - minor2;
-    minor2 = shuffle<2,3,0,1>(minor2);
-    // -----------------------------------------------
-    tmp1 = row0 * row1;
-    tmp1 = shuffle<1,0,3,2>(tmp1);
-    minor2 = (row3 * tmp1) + minor2;
-    minor3 = (row2 * tmp1) - minor3;
-    tmp1 = shuffle<2,3,0,1>(tmp1);
-    minor2 = (row3 * tmp1) - minor2;
-    minor3 = minor3 - (row2 * tmp1);
-    // -----------------------------------------------
-    tmp1 = row0 * row3;
-    tmp1 = shuffle<1,0,3,2>(tmp1);
-    minor1 = minor1 - (row2 * tmp1);
-    minor2 = (row1 * tmp1) + minor2;
-    tmp1 = shuffle<2,3,0,1>(tmp1);
-    minor1 = (row2 * tmp1) + minor1;
-    minor2 = minor2 - (row1 * tmp1);
-    // -----------------------------------------------
-    tmp1 = row0 * row2;
-    tmp1 = shuffle<1,0,3,2>(tmp1);
-    minor1 = (row3 * tmp1) + minor1;
-    minor3 = minor3 - (row1 * tmp1);
-    tmp1 = shuffle<2,3,0,1>(tmp1);
-    minor1 = minor1 - (row3 * tmp1);
-    minor3 = (row1 * tmp1) + minor3;
-    // -----------------------------------------------
-    det = row0 * minor0;
-    det = shuffle<2,3,0,1>(det) + det;
-    det = _mm_add_ss(shuffle<1,0,3,2>(det), det);
-    tmp1 = _mm_rcp_ss(det);
-    det = _mm_sub_ss(_mm_add_ss(tmp1, tmp1), _mm_mul_ss(det, _mm_mul_ss(tmp1, tmp1)));
-    det = shuffle<0>(det);
-    return matrix44 (det*minor0, det*minor1, det*minor2, det*minor3);
+
+OIIO_FORCEINLINE int16 blend (const int16& a, const int16& b, const bool16& mask) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_mask_blend_epi32 (mask, a, b);
 #else
-    return m_mat.inverse();
+    return int16 (blend (a.lo(), b.lo(), mask.lo()),
+                  blend (a.hi(), b.hi(), mask.hi()));
 #endif
 }
 
 
-inline std::ostream& operator<< (std::ostream& cout, const matrix44 &M) {
-    const float *m = (const float *)&M;
-    cout << m[0];
-    for (int i = 1; i < 16; ++i)
-        cout << ' ' << m[i];
-    return cout;
+OIIO_FORCEINLINE int16 blend0 (const int16& a, const bool16& mask) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_maskz_mov_epi32 (mask, a);
+#else
+    return int16 (blend0 (a.lo(), mask.lo()),
+                  blend0 (a.hi(), mask.hi()));
+#endif
 }
 
 
+OIIO_FORCEINLINE int16 blend0not (const int16& a, const bool16& mask) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_maskz_mov_epi32 (!mask, a);
+#else
+    return int16 (blend0not (a.lo(), mask.lo()),
+                  blend0not (a.hi(), mask.hi()));
+#endif
+}
 
-OIIO_FORCEINLINE float3 transformp (const matrix44 &M, const float3 &V) {
-    return M.transformp (V);
+OIIO_FORCEINLINE int16 select (const bool16& mask, const int16& a, const int16& b) {
+    return blend (b, a, mask);
 }
 
-OIIO_FORCEINLINE float3 transformp (const Imath::M44f &M, const float3 &V)
-{
-#if OIIO_SIMD
-    return matrix44(M).transformp (V);
+
+OIIO_FORCEINLINE int16 abs (const int16& a) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_abs_epi32 (a.simd());
 #else
-    Imath::V3f R;
-    M.multVecMatrix (*(Imath::V3f *)&V, R);
-    return float3(R);
+    return int16 (abs(a.lo()), abs(a.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE float3 transformv (const matrix44 &M, const float3 &V) {
-    return M.transformv (V);
+OIIO_FORCEINLINE int16 min (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_min_epi32 (a, b);
+#else
+    return int16 (min(a.lo(), b.lo()), min(a.hi(), b.hi()));
+#endif
 }
 
-OIIO_FORCEINLINE float3 transformv (const Imath::M44f &M, const float3 &V)
-{
-#if OIIO_SIMD
-    return matrix44(M).transformv (V);
+
+OIIO_FORCEINLINE int16 max (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_max_epi32 (a, b);
 #else
-    Imath::V3f R;
-    M.multDirMatrix (*(Imath::V3f *)&V, R);
-    return float3(R);
+    return int16 (max(a.lo(), b.lo()), max(a.hi(), b.hi()));
 #endif
 }
 
-OIIO_FORCEINLINE float3 transformvT (const matrix44 &M, const float3 &V)
-{
-    return M.transformvT (V);
-}
 
-OIIO_FORCEINLINE float3 transformvT (const Imath::M44f &M, const float3 &V)
-{
-#if OIIO_SIMD
-    return matrix44(M).transformvT(V);
+OIIO_FORCEINLINE int16 andnot (const int16& a, const int16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_andnot_si512 (a.simd(), b.simd());
 #else
-    return transformv (M.transposed(), V);
+    return int16 (andnot(a.lo(), b.lo()), andnot(a.hi(), b.hi()));
 #endif
 }
 
 
 
 //////////////////////////////////////////////////////////////////////
-// float8 implementation
+// float16 implementation
 
-OIIO_FORCEINLINE float& float8::operator[] (int i) {
+OIIO_FORCEINLINE float& float16::operator[] (int i) {
     DASSERT(i<elements);
     return m_val[i];
 }
 
-OIIO_FORCEINLINE float float8::operator[] (int i) const {
+OIIO_FORCEINLINE float float16::operator[] (int i) const {
     DASSERT(i<elements);
     return m_val[i];
 }
 
 
-inline std::ostream& operator<< (std::ostream& cout, const float8& val) {
+inline std::ostream& operator<< (std::ostream& cout, const float16& val) {
     cout << val[0];
     for (int i = 1; i < val.elements; ++i)
         cout << ' ' << val[i];
@@ -5481,719 +7678,632 @@ inline std::ostream& operator<< (std::ostream& cout, const float8& val) {
 }
 
 
-OIIO_FORCEINLINE float4 float8::lo () const {
-#if OIIO_SIMD_AVX
-    return _mm256_castps256_ps128 (simd());
+OIIO_FORCEINLINE float8 float16::lo () const {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_castps512_ps256 (simd());
 #else
-    return m_4[0];
+    return m_8[0];
 #endif
 }
 
-OIIO_FORCEINLINE float4 float8::hi () const {
-#if OIIO_SIMD_AVX
-    return _mm256_extractf128_ps (simd(), 1);
+OIIO_FORCEINLINE float8 float16::hi () const {
+#if OIIO_SIMD_AVX >= 512
+    return _mm256_castpd_ps (_mm512_extractf64x4_pd (_mm512_castps_pd(simd()), 1));
 #else
-    return m_4[1];
+    return m_8[1];
 #endif
 }
 
 
-OIIO_FORCEINLINE float8::float8 (const float4& lo, const float4 &hi) {
-#if OIIO_SIMD_AVX
-    __m256 r = _mm256_castps128_ps256 (lo);
-    m_simd = _mm256_insertf128_ps (r, hi, 1);
-    // N.B. equivalent, if available: m_simd = _mm256_set_m128 (hi, lo);
+OIIO_FORCEINLINE float16::float16 (float v0, float v1, float v2, float v3,
+                                   float v4, float v5, float v6, float v7,
+                                   float v8, float v9, float v10, float v11,
+                                   float v12, float v13, float v14, float v15) {
+    load (v0, v1, v2, v3, v4, v5, v6, v7,
+          v8, v9, v10, v11, v12, v13, v14, v15);
+}
+
+
+OIIO_FORCEINLINE float16::float16 (const float8& lo, const float8 &hi) {
+#if OIIO_SIMD_AVX >= 512
+    __m512d r = _mm512_castpd256_pd512 (_mm256_castps_pd (lo));
+    m_simd = _mm512_castpd_ps (_mm512_insertf64x4 (r, _mm256_castps_pd(hi), 1));
 #else
-    m_4[0] = lo;
-    m_4[1] = hi;
+    m_8[0] = lo;
+    m_8[1] = hi;
 #endif
 }
 
 
-OIIO_FORCEINLINE float8::float8 (const int8& ival) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_cvtepi32_ps (ival);
+OIIO_FORCEINLINE float16::float16 (const int16& ival) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_cvtepi32_ps (ival);
 #else
-    SIMD_CONSTRUCT (float(ival[i]));
+    m_8[0] = float8 (ival.lo());
+    m_8[1] = float8 (ival.hi());
 #endif
 }
 
 
-OIIO_FORCEINLINE const float8 float8::Zero () {
-#if OIIO_SIMD_AVX
-    return _mm256_setzero_ps();
+OIIO_FORCEINLINE const float16 float16::Zero () {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_setzero_ps();
 #else
-    return float8(0.0f);
+    return float16(0.0f);
 #endif
 }
 
-OIIO_FORCEINLINE const float8 float8::One () {
-    return float8(1.0f);
+OIIO_FORCEINLINE const float16 float16::One () {
+    return float16(1.0f);
 }
 
-OIIO_FORCEINLINE const float8 float8::Iota (float start, float step) {
-    return float8 (start+0.0f*step, start+1.0f*step, start+2.0f*step, start+3.0f*step,
-                   start+4.0f*step, start+5.0f*step, start+6.0f*step, start+7.0f*step);
+OIIO_FORCEINLINE const float16 float16::Iota (float start, float step) {
+    return float16 (start+0.0f*step, start+1.0f*step, start+2.0f*step, start+3.0f*step,
+                    start+4.0f*step, start+5.0f*step, start+6.0f*step, start+7.0f*step,
+                    start+8.0f*step, start+9.0f*step, start+10.0f*step, start+11.0f*step,
+                    start+12.0f*step, start+13.0f*step, start+14.0f*step, start+15.0f*step);
 }
 
 /// Set all components to 0.0
-OIIO_FORCEINLINE void float8::clear () {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_setzero_ps();
+OIIO_FORCEINLINE void float16::clear () {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_setzero_ps();
 #else
     load (0.0f);
 #endif
 }
 
 
-
-OIIO_FORCEINLINE void float8::load (float val) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_set1_ps (val);
+OIIO_FORCEINLINE void float16::load (float val) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_set1_ps (val);
 #else
-    SIMD_CONSTRUCT (val);
+    m_8[0] = float8 (val);
+    m_8[1] = float8 (val);
 #endif
 }
 
-OIIO_FORCEINLINE void float8::load (float a, float b, float c, float d,
-                                    float e, float f, float g, float h) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_set_ps (h, g, f, e, d, c, b, a);
+
+OIIO_FORCEINLINE void float16::load (float v0, float v1, float v2, float v3,
+                                     float v4, float v5, float v6, float v7,
+                                     float v8, float v9, float v10, float v11,
+                                     float v12, float v13, float v14, float v15) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_set_ps (v15, v14, v13, v12, v11, v10, v9, v8,
+                            v7, v6, v5, v4, v3, v2, v1, v0);
 #else
-    m_val[0] = a;
-    m_val[1] = b;
-    m_val[2] = c;
-    m_val[3] = d;
-    m_val[4] = e;
-    m_val[5] = f;
-    m_val[6] = g;
-    m_val[7] = h;
+    m_8[0] = float8 (v0, v1, v2, v3, v4, v5, v6, v7);
+    m_8[1] = float8 (v8, v9, v10, v11, v12, v13, v14, v15);
 #endif
 }
 
 
-OIIO_FORCEINLINE void float8::load (const float *values) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_loadu_ps (values);
-#elif OIIO_SIMD_SSE
-    m_4[0] = float4(values);
-    m_4[1] = float4(values+4);
+OIIO_FORCEINLINE void float16::load (const float *values) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_loadu_ps (values);
 #else
-    SIMD_CONSTRUCT (values[i]);
+    m_8[0] = float8 (values);
+    m_8[1] = float8 (values+8);
 #endif
 }
 
 
-OIIO_FORCEINLINE void float8::load (const float *values, int n) {
-    // FIXME: is this faster with AVX masked loads?
-#if OIIO_SIMD_SSE
-    if (n > 0 && n <= 4) {
-        float4 l; l.load (values, n);
-        m_simd = float8(l, float4::Zero());
-    } else if (n > 4 && n <= 8) {
-        float4 h; h.load (values+4, n-4);
-        m_simd = float8(float4(values), h);
+OIIO_FORCEINLINE void float16::load (const float *values, int n) {
+    DASSERT (n >= 0 && n <= elements);
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_maskz_loadu_ps (__mmask16((1 << n) - 1), values);
+#else
+    if (n <= 8) {
+        float8 l; l.load (values, n);
+        m_8[0] = l;
+        m_8[1] = float8::Zero();
+    } else {
+        float8 h; h.load (values+8, n-8);
+        m_8[0] = float8 (values);
+        m_8[1] = h;
     }
-    else
-        clear();
-#else
-    for (int i = 0; i < n; ++i)
-        m_val[i] = values[i];
-    for (int i = n; i < paddedelements; ++i)
-        m_val[i] = 0;
 #endif
 }
 
 
-OIIO_FORCEINLINE void float8::load (const unsigned short *values) {
-#if OIIO_SIMD_AVX
-    // Rely on the uint16->int conversion, then convert to float
-    m_simd = _mm256_cvtepi32_ps (int8(values).simd());
+OIIO_FORCEINLINE void float16::load (const unsigned short *values) {
+#if OIIO_SIMD_AVX >= 512
+    // Rely on the ushort->int conversion, then convert to float
+    m_simd = _mm512_cvtepi32_ps (int16(values).simd());
 #else
-    SIMD_CONSTRUCT (values[i]);
+    m_8[0] = float8 (values);
+    m_8[1] = float8 (values+8);
 #endif
 }
 
 
-OIIO_FORCEINLINE void float8::load (const short *values) {
-#if OIIO_SIMD_AVX
-    // Rely on the int16->int conversion, then convert to float
-    m_simd = _mm256_cvtepi32_ps (int8(values).simd());
+OIIO_FORCEINLINE void float16::load (const short *values) {
+#if OIIO_SIMD_AVX >= 512
+    // Rely on the short->int conversion, then convert to float
+    m_simd = _mm512_cvtepi32_ps (int16(values).simd());
 #else
-    SIMD_CONSTRUCT (values[i]);
+    m_8[0] = float8 (values);
+    m_8[1] = float8 (values+8);
 #endif
 }
 
 
-OIIO_FORCEINLINE void float8::load (const unsigned char *values) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_cvtepi32_ps (int8(values).simd());
+OIIO_FORCEINLINE void float16::load (const unsigned char *values) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_cvtepi32_ps (int16(values).simd());
 #else
-    SIMD_CONSTRUCT (values[i]);
+    m_8[0] = float8 (values);
+    m_8[1] = float8 (values+8);
 #endif
 }
 
 
-OIIO_FORCEINLINE void float8::load (const char *values) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_cvtepi32_ps (int8(values).simd());
+OIIO_FORCEINLINE void float16::load (const char *values) {
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_cvtepi32_ps (int16(values).simd());
 #else
-    SIMD_CONSTRUCT (values[i]);
+    m_8[0] = float8 (values);
+    m_8[1] = float8 (values+8);
 #endif
 }
 
+
 #ifdef _HALF_H_
-OIIO_FORCEINLINE void float8::load (const half *values) {
-#if OIIO_SIMD_AVX && defined(__F16C__)
+OIIO_FORCEINLINE void float16::load (const half *values) {
+#if OIIO_SIMD_AVX >= 512
     /* Enabled 16 bit float instructions! */
-    int4 a ((const int *)values);
-    m_simd = _mm256_cvtph_ps (a);
-#elif OIIO_SIMD_SSE >= 2
-    m_4[0] = float4(values);
-    m_4[1] = float4(values+4);
-#else /* No SIMD defined: */
-    SIMD_CONSTRUCT (values[i]);
+    __m256i a = _mm256_loadu_si256 ((const __m256i *)values);
+    m_simd = _mm512_cvtph_ps (a);
+#else
+    m_8[0] = float8 (values);
+    m_8[1] = float8 (values+8);
 #endif
 }
 #endif /* _HALF_H_ */
 
 
-OIIO_FORCEINLINE void float8::store (float *values) const {
-#if OIIO_SIMD_AVX
+
+OIIO_FORCEINLINE void float16::store (float *values) const {
+#if OIIO_SIMD_AVX >= 512
     // Use an unaligned store -- it's just as fast when the memory turns
     // out to be aligned, nearly as fast even when unaligned. Not worth
     // the headache of using stores that require alignment.
-    _mm256_storeu_ps (values, m_simd);
+    _mm512_storeu_ps (values, m_simd);
 #else
-    SIMD_DO (values[i] = m_val[i]);
+    lo().store (values);
+    hi().store (values+8);
 #endif
 }
 
 
-OIIO_FORCEINLINE void float8::store (float *values, int n) const {
+OIIO_FORCEINLINE void float16::store (float *values, int n) const {
     DASSERT (n >= 0 && n <= elements);
-    // FIXME: is this faster with AVX masked stores?
-#if OIIO_SIMD_SSE
-    if (n <= 4) {
+#if OIIO_SIMD_AVX >= 512
+    _mm512_mask_storeu_ps (values, __mmask16((1 << n) - 1), m_simd);
+#else
+    if (n <= 8) {
         lo().store (values, n);
-    } else if (n <= 8) {
+    } else {
         lo().store (values);
-        hi().store (values+4, n-4);
+        hi().store (values+8, n-8);
     }
-#else
-    for (int i = 0; i < n; ++i)
-        values[i] = m_val[i];
-#endif
-}
-
-#ifdef _HALF_H_
-OIIO_FORCEINLINE void float8::store (half *values) const {
-#if OIIO_SIMD_AVX && defined(__F16C__)
-    __m128i h = _mm256_cvtps_ph (m_simd, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
-    _mm_storeu_si128 ((__m128i *)values, h);
-#else
-    SIMD_DO (values[i] = m_val[i]);
 #endif
 }
-#endif
-
 
-OIIO_FORCEINLINE float8 operator+ (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_add_ps (a.m_simd, b.m_simd);
-#else
-    SIMD_RETURN (float8, a[i] + b[i]);
-#endif
-}
 
-OIIO_FORCEINLINE const float8 & float8::operator+= (const float8& a) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_add_ps (m_simd, a.m_simd);
+#ifdef _HALF_H_
+OIIO_FORCEINLINE void float16::store (half *values) const {
+#if OIIO_SIMD_AVX >= 512
+    __m256i h = _mm512_cvtps_ph (m_simd, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
+    _mm256_storeu_si256 ((__m256i *)values, h);
 #else
-    SIMD_DO (m_val[i] += a[i]);
+    lo().store (values);
+    hi().store (values+8);
 #endif
-    return *this;
 }
-
-OIIO_FORCEINLINE float8 float8::operator- () const {
-#if OIIO_SIMD_AVX
-    return _mm256_sub_ps (_mm256_setzero_ps(), m_simd);
-#else
-    SIMD_RETURN (float8, -m_val[i]);
 #endif
-}
 
-OIIO_FORCEINLINE float8 operator- (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_sub_ps (a.m_simd, b.m_simd);
-#else
-    SIMD_RETURN (float8, a[i] - b[i]);
-#endif
-}
 
-OIIO_FORCEINLINE const float8 & float8::operator-= (const float8& a) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_sub_ps (m_simd, a.m_simd);
+OIIO_FORCEINLINE float16 operator+ (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_add_ps (a.m_simd, b.m_simd);
 #else
-    SIMD_DO (m_val[i] -= a[i]);
+    return float16 (a.lo()+b.lo(), a.hi()+b.hi());
 #endif
-    return *this;
 }
 
-OIIO_FORCEINLINE float8 operator* (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_mul_ps (a.m_simd, b.m_simd);
-#else
-    SIMD_RETURN (float8, a[i] * b[i]);
-#endif
+OIIO_FORCEINLINE const float16 & float16::operator+= (const float16& a) {
+    return *this = *this + a;
 }
 
-OIIO_FORCEINLINE const float8 & float8::operator*= (const float8& a) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_mul_ps (m_simd, a.m_simd);
+OIIO_FORCEINLINE float16 float16::operator- () const {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_sub_ps (_mm512_setzero_ps(), m_simd);
 #else
-    SIMD_DO (m_val[i] *= a[i]);
+    return float16 (-lo(), -hi());
 #endif
-    return *this;
 }
 
-OIIO_FORCEINLINE const float8 & float8::operator*= (float val) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_mul_ps (m_simd, _mm256_set1_ps(val));
+OIIO_FORCEINLINE float16 operator- (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_sub_ps (a.m_simd, b.m_simd);
 #else
-    SIMD_DO (m_val[i] *= val);
+    return float16 (a.lo()-b.lo(), a.hi()-b.hi());
 #endif
-    return *this;
 }
 
-OIIO_FORCEINLINE float8 operator/ (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_div_ps (a.m_simd, b.m_simd);
-#else
-    SIMD_RETURN (float8, a[i] / b[i]);
-#endif
+OIIO_FORCEINLINE const float16 & float16::operator-= (const float16& a) {
+    return *this = *this - a;
 }
 
-OIIO_FORCEINLINE const float8 & float8::operator/= (const float8& a) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_div_ps (m_simd, a.m_simd);
+OIIO_FORCEINLINE float16 operator* (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_mul_ps (a.m_simd, b.m_simd);
 #else
-    SIMD_DO (m_val[i] /= a[i]);
+    return float16 (a.lo()*b.lo(), a.hi()*b.hi());
 #endif
-    return *this;
 }
 
-OIIO_FORCEINLINE const float8 & float8::operator/= (float val) {
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_div_ps (m_simd, _mm256_set1_ps(val));
-#else
-    SIMD_DO (m_val[i] /= val);
-#endif
-    return *this;
+OIIO_FORCEINLINE const float16 & float16::operator*= (const float16& a) {
+    return *this = *this * a;
 }
 
-OIIO_FORCEINLINE bool8 operator== (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_EQ_OQ);
-#else
-    SIMD_RETURN (bool8, a[i] == b[i] ? -1 : 0);
-#endif
+OIIO_FORCEINLINE const float16 & float16::operator*= (float val) {
+    return *this = *this * float16(val);
 }
 
-OIIO_FORCEINLINE bool8 operator!= (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_NEQ_OQ);
+OIIO_FORCEINLINE float16 operator/ (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_div_ps (a.m_simd, b.m_simd);
 #else
-    SIMD_RETURN (bool8, a[i] != b[i] ? -1 : 0);
+    return float16 (a.lo()/b.lo(), a.hi()/b.hi());
 #endif
 }
 
-OIIO_FORCEINLINE bool8 operator< (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_LT_OQ);
-#else
-    SIMD_RETURN (bool8, a[i] < b[i] ? -1 : 0);
+OIIO_FORCEINLINE const float16 & float16::operator/= (const float16& a) {
+    return *this = *this / a;
+}
+
+OIIO_FORCEINLINE const float16 & float16::operator/= (float val) {
+    return *this = *this / float16(val);
+}
+
+
+OIIO_FORCEINLINE bool16 operator== (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmp_ps_mask (a.m_simd, b.m_simd, _CMP_EQ_OQ));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() == b.lo(), a.hi() == b.hi());
 #endif
 }
 
-OIIO_FORCEINLINE bool8 operator>  (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_GT_OQ);
-#else
-    SIMD_RETURN (bool8, a[i] > b[i] ? -1 : 0);
+
+OIIO_FORCEINLINE bool16 operator!= (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmp_ps_mask (a.m_simd, b.m_simd, _CMP_NEQ_OQ));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() != b.lo(), a.hi() != b.hi());
 #endif
 }
 
-OIIO_FORCEINLINE bool8 operator>= (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_GE_OQ);
-#else
-    SIMD_RETURN (bool8, a[i] >= b[i] ? -1 : 0);
+
+OIIO_FORCEINLINE bool16 operator< (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmp_ps_mask (a.m_simd, b.m_simd, _CMP_LT_OQ));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() < b.lo(), a.hi() < b.hi());
 #endif
 }
 
-OIIO_FORCEINLINE bool8 operator<= (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_cmp_ps (a.m_simd, b.m_simd, _CMP_LE_OQ);
-#else
-    SIMD_RETURN (bool8, a[i] <= b[i] ? -1 : 0);
+
+OIIO_FORCEINLINE bool16 operator>  (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmp_ps_mask (a.m_simd, b.m_simd, _CMP_GT_OQ));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() > b.lo(), a.hi() > b.hi());
 #endif
 }
 
 
-// Implementation had to be after the definition of float8.
-OIIO_FORCEINLINE int8::int8 (const float8& f)
-{
-#if OIIO_SIMD_AVX
-    m_simd = _mm256_cvttps_epi32(f);
-#else
-    SIMD_CONSTRUCT ((int) f[i]);
+OIIO_FORCEINLINE bool16 operator>= (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmp_ps_mask (a.m_simd, b.m_simd, _CMP_GE_OQ));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() >= b.lo(), a.hi() >= b.hi());
 #endif
 }
 
 
-template<int i0, int i1, int i2, int i3, int i4, int i5, int i6, int i7>
-OIIO_FORCEINLINE float8 shuffle (const float8& a) {
-#if OIIO_SIMD_AVX >= 2
-    int8 index (i0, i1, i2, i3, i4, i5, i6, i7);
-    return _mm256_permutevar8x32_ps (a, index);
-#else
-    return float8 (a[i0], a[i1], a[i2], a[i3], a[i4], a[i5], a[i6], a[i7]);
+OIIO_FORCEINLINE bool16 operator<= (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    return bool16::from_bitmask (_mm512_cmp_ps_mask (a.m_simd, b.m_simd, _CMP_LE_OQ));
+#else  /* Fall back to 8-wide */
+    return bool16 (a.lo() <= b.lo(), a.hi() <= b.hi());
 #endif
 }
 
-template<int i> OIIO_FORCEINLINE float8 shuffle (const float8& a) {
-#if OIIO_SIMD_AVX >= 2
-    return _mm256_permutevar8x32_ps (a, int8(i));
+
+// Implementation had to be after the definition of float16.
+OIIO_FORCEINLINE int16::int16 (const float16& f)
+{
+#if OIIO_SIMD_AVX >= 512
+    m_simd = _mm512_cvttps_epi32(f);
 #else
-    return shuffle<i,i,i,i,i,i,i,i>(a);
+    m_8[0] = int8 (f.lo());
+    m_8[1] = int8 (f.hi());
 #endif
 }
 
 
 template<int i>
-OIIO_FORCEINLINE float extract (const float8& v) {
-#if OIIO_SIMD_AVX_NO_FIXME
-    // Looks like the fastest we can do it is to extract a float4,
-    // shuffle its one element everywhere, then extract element 0.
-    _m128 f4 = _mm256_extractf128_ps (i >> 2);
-    int j = i & 3;
-    return _mm_cvtss_f32(shuffle_sse<j,j,j,j>(a.simd()));
+OIIO_FORCEINLINE float extract (const float16& a) {
+#if OIIO_SIMD_AVX >= 512
+    __m128 f4 = _mm512_extractf32x4_ps (a.simd(), i/4);
+    return _mm_cvtss_f32 (_mm_shuffle_ps (f4, f4, _MM_SHUFFLE(i%4,i%4,i%4,i%4)));
 #else
-    return v[i];
+    return a[i];
 #endif
 }
 
 
 template<int i>
-OIIO_FORCEINLINE float8 insert (const float8& a, float val) {
-#if OIIO_SIMD_AVX_NO_FIXME
-    return _mm256_insert_epi32 (a, val, i);
+OIIO_FORCEINLINE float16 insert (const float16& a, float val) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_mask_mov_ps (a.simd(), __mmask16(1 << i), _mm512_set1_ps(val));
 #else
-    float8 tmp = a;
+    float16 tmp = a;
     tmp[i] = val;
     return tmp;
 #endif
 }
 
 
-OIIO_FORCEINLINE float float8::x () const { return extract<0>(*this); }
-OIIO_FORCEINLINE float float8::y () const { return extract<1>(*this); }
-OIIO_FORCEINLINE float float8::z () const { return extract<2>(*this); }
-OIIO_FORCEINLINE float float8::w () const { return extract<3>(*this); }
-OIIO_FORCEINLINE void float8::set_x (float val) { *this = insert<0>(*this, val); }
-OIIO_FORCEINLINE void float8::set_y (float val) { *this = insert<1>(*this, val); }
-OIIO_FORCEINLINE void float8::set_z (float val) { *this = insert<2>(*this, val); }
-OIIO_FORCEINLINE void float8::set_w (float val) { *this = insert<3>(*this, val); }
-
-
-OIIO_FORCEINLINE int8 bitcast_to_int (const float8& x)
+OIIO_FORCEINLINE int16 bitcast_to_int (const float16& x)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_castps_si256 (x.simd());
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_castps_si512 (x.simd());
 #else
-    return *(int8 *)&x;
+    return int16 (bitcast_to_int (x.lo()), bitcast_to_int (x.hi()));
 #endif
 }
 
-OIIO_FORCEINLINE float8 bitcast_to_float (const int8& x)
+OIIO_FORCEINLINE float16 bitcast_to_float (const int16& x)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_castsi256_ps (x.simd());
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_castsi512_ps (x.simd());
 #else
-    return *(float8 *)&x;
+    return float16 (bitcast_to_float (x.lo()), bitcast_to_float (x.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE float8 vreduce_add (const float8& v) {
-#if OIIO_SIMD_AVX
-    // From Syrah:
-    float8 ab_cd_0_0_ef_gh_0_0 = _mm256_hadd_ps(v.simd(), _mm256_setzero_ps());
-    float8 abcd_0_0_0_efgh_0_0_0 = _mm256_hadd_ps(ab_cd_0_0_ef_gh_0_0, _mm256_setzero_ps());
-    // get efgh in the 0-idx slot
-    float8 efgh = shuffle<4>(abcd_0_0_0_efgh_0_0_0);
-    float8 final_sum = abcd_0_0_0_efgh_0_0_0 + efgh;
-    return shuffle<0>(final_sum);
-#else
-    float4 hadd4 = vreduce_add(v.lo()) + vreduce_add(v.hi());
-    return float8(hadd4, hadd4);
-#endif
+OIIO_FORCEINLINE float16 vreduce_add (const float16& v) {
+    return float16 (reduce_add (v));
 }
 
 
-OIIO_FORCEINLINE float reduce_add (const float8& v) {
-#if OIIO_SIMD_AVX >= 2
-    return extract<0>(vreduce_add(v));
+OIIO_FORCEINLINE float reduce_add (const float16& v) {
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_reduce_add_ps (v.simd());
 #else
-    return reduce_add(v.lo()) + reduce_add(v.hi());
+    return reduce_add (v.lo()) + reduce_add (v.hi());
 #endif
 }
 
 
-OIIO_FORCEINLINE float8 blend (const float8& a, const float8& b, const bool8& mask)
+OIIO_FORCEINLINE float16 blend (const float16& a, const float16& b, const bool16& mask)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_blendv_ps (a, b, mask);
-#elif defined(OIIO_SIMD_SSE)
-    return float8 (blend (a.lo(), b.lo(), mask.lo()),
-                   blend (a.hi(), b.hi(), mask.hi()));
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_mask_blend_ps (mask, a, b);
 #else
-    SIMD_RETURN (float8, mask[i] ? b[i] : a[i]);
+    return float16 (blend (a.lo(), b.lo(), mask.lo()),
+                    blend (a.hi(), b.hi(), mask.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE float8 blend0 (const float8& a, const bool8& mask)
+OIIO_FORCEINLINE float16 blend0 (const float16& a, const bool16& mask)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_and_ps(mask, a);
-#elif defined(OIIO_SIMD_SSE)
-    return float8 (blend0 (a.lo(), mask.lo()),
-                   blend0 (a.hi(), mask.hi()));
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_maskz_mov_ps (mask, a);
 #else
-    SIMD_RETURN (float8, mask[i] ? a[i] : 0.0f);
+    return float16 (blend0 (a.lo(), mask.lo()),
+                    blend0 (a.hi(), mask.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE float8 blend0not (const float8& a, const bool8& mask)
+OIIO_FORCEINLINE float16 blend0not (const float16& a, const bool16& mask)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_andnot_ps(mask, a);
-#elif defined(OIIO_SIMD_SSE)
-    return float8 (blend0not (a.lo(), mask.lo()),
-                   blend0not (a.hi(), mask.hi()));
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_maskz_mov_ps (!mask, a);
 #else
-    SIMD_RETURN (float8, mask[i] ? 0.0f : a[i]);
+    return float16 (blend0not (a.lo(), mask.lo()),
+                    blend0not (a.hi(), mask.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE float8 safe_div (const float8 &a, const float8 &b) {
-#if OIIO_SIMD_SSE
-    return blend0not (a/b, b == float8::Zero());
-#else
-    SIMD_RETURN (float8, b[i] == 0.0f ? 0.0f : a[i] / b[i]);
-#endif
+OIIO_FORCEINLINE float16 safe_div (const float16 &a, const float16 &b) {
+    return blend0not (a/b, b == float16::Zero());
 }
 
 
-OIIO_FORCEINLINE float8 select (const bool8& mask, const float8& a, const float8& b)
+OIIO_FORCEINLINE float16 select (const bool16& mask, const float16& a, const float16& b)
 {
     return blend (b, a, mask);
 }
 
 
-OIIO_FORCEINLINE float8 abs (const float8& a)
+OIIO_FORCEINLINE float16 abs (const float16& a)
 {
-#if OIIO_SIMD_AVX
+#if OIIO_SIMD_AVX >= 512
     // Just clear the sign bit for cheap fabsf
-    return _mm256_and_ps (a.simd(), _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+    return _mm512_castsi512_ps (_mm512_and_si512 (_mm512_castps_si512(a.simd()),
+                                                  _mm512_set1_epi32(0x7fffffff)));
 #else
-    SIMD_RETURN (float8, fabsf(a[i]));
+    return float16 (abs(a.lo()), abs(a.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE float8 sign (const float8& a)
+OIIO_FORCEINLINE float16 sign (const float16& a)
 {
-    float8 one(1.0f);
-    return blend (one, -one, a < float8::Zero());
+    float16 one(1.0f);
+    return blend (one, -one, a < float16::Zero());
 }
 
 
-OIIO_FORCEINLINE float8 ceil (const float8& a)
+OIIO_FORCEINLINE float16 ceil (const float16& a)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_ceil_ps (a);
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_roundscale_ps (a, (_MM_FROUND_TO_POS_INF |_MM_FROUND_NO_EXC));
 #else
-    SIMD_RETURN (float8, ceilf(a[i]));
+    return float16 (ceil(a.lo()), ceil(a.hi()));
 #endif
 }
 
-OIIO_FORCEINLINE float8 floor (const float8& a)
+OIIO_FORCEINLINE float16 floor (const float16& a)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_floor_ps (a);
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_roundscale_ps (a, (_MM_FROUND_TO_NEG_INF |_MM_FROUND_NO_EXC));
 #else
-    SIMD_RETURN (float8, floorf(a[i]));
+    return float16 (floor(a.lo()), floor(a.hi()));
 #endif
 }
 
-OIIO_FORCEINLINE float8 round (const float8& a)
+OIIO_FORCEINLINE float16 round (const float16& a)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_round_ps (a, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_roundscale_ps (a, (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
 #else
-    SIMD_RETURN (float8, roundf(a[i]));
+    return float16 (round(a.lo()), round(a.hi()));
 #endif
 }
 
-OIIO_FORCEINLINE int8 floori (const float8& a)
+OIIO_FORCEINLINE int16 floori (const float16& a)
 {
-#if OIIO_SIMD_AVX
-    return int8(floor(a));
-#elif defined(OIIO_SIMD_SSE)   /* SSE2/3 */
-    int8 i (a);  // truncates
-    int8 isneg = bitcast_to_int (a < float8::Zero());
-    return i + isneg;
-    // The trick here (thanks, Cycles, for letting me spy on your code) is
-    // that the comparison will return (int)-1 for components that are less
-    // than zero, and adding that is the same as subtracting one!
+#if OIIO_SIMD_AVX >= 512
+    return int16(floor(a));
 #else
-    SIMD_RETURN (int8, (int)floorf(a[i]));
+    return int16 (floori(a.lo()), floori(a.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE int8 rint (const float8& a)
+OIIO_FORCEINLINE int16 rint (const float16& a)
 {
-    return int8 (round(a));
+    return int16 (round(a));
 }
 
 
-
-OIIO_FORCEINLINE float8 sqrt (const float8 &a)
+OIIO_FORCEINLINE float16 sqrt (const float16 &a)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_sqrt_ps (a.simd());
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_sqrt_ps (a.simd());
 #else
-    SIMD_RETURN (float8, sqrtf(a[i]));
+    return float16 (sqrt(a.lo()), sqrt(a.hi()));
 #endif
 }
 
 
-
-OIIO_FORCEINLINE float8 rsqrt (const float8 &a)
+OIIO_FORCEINLINE float16 rsqrt (const float16 &a)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_div_ps (_mm256_set1_ps(1.0f), _mm256_sqrt_ps (a.simd()));
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_div_ps (_mm512_set1_ps(1.0f), _mm512_sqrt_ps (a.simd()));
 #else
-    SIMD_RETURN (float8, 1.0f/sqrtf(a[i]));
+    return float16 (rsqrt(a.lo()), rsqrt(a.hi()));
 #endif
 }
 
 
-
-OIIO_FORCEINLINE float8 rsqrt_fast (const float8 &a)
+OIIO_FORCEINLINE float16 rsqrt_fast (const float16 &a)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_rsqrt_ps (a.simd());
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_rsqrt14_ps (a.simd());
 #else
-    SIMD_RETURN (float8, 1.0f/sqrtf(a[i]));
+    return float16 (rsqrt_fast(a.lo()), rsqrt_fast(a.hi()));
 #endif
 }
 
 
-
-OIIO_FORCEINLINE float8 min (const float8& a, const float8& b)
+OIIO_FORCEINLINE float16 min (const float16& a, const float16& b)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_min_ps (a, b);
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_min_ps (a, b);
 #else
-    SIMD_RETURN (float8, std::min (a[i], b[i]));
+    return float16 (min(a.lo(),b.lo()), min(a.hi(),b.hi()));
 #endif
 }
 
-OIIO_FORCEINLINE float8 max (const float8& a, const float8& b)
+OIIO_FORCEINLINE float16 max (const float16& a, const float16& b)
 {
-#if OIIO_SIMD_AVX
-    return _mm256_max_ps (a, b);
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_max_ps (a, b);
 #else
-    SIMD_RETURN (float8, std::max (a[i], b[i]));
+    return float16 (max(a.lo(),b.lo()), max(a.hi(),b.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE float8 andnot (const float8& a, const float8& b) {
-#if OIIO_SIMD_AVX
-    return _mm256_andnot_ps (a.simd(), b.simd());
+OIIO_FORCEINLINE float16 andnot (const float16& a, const float16& b) {
+#if OIIO_SIMD_AVX >= 512
+    // N.B. _mm512_andnot_ps needs AVX512DQ, so do it in the int domain.
+    return _mm512_castsi512_ps (_mm512_andnot_si512 (_mm512_castps_si512(a),
+                                                     _mm512_castps_si512(b)));
 #else
-    const int *ai = (const int *)&a;
-    const int *bi = (const int *)&b;
-    return bitcast_to_float (int8(~(ai[0]) & bi[0],
-                                  ~(ai[1]) & bi[1],
-                                  ~(ai[2]) & bi[2],
-                                  ~(ai[3]) & bi[3],
-                                  ~(ai[4]) & bi[4],
-                                  ~(ai[5]) & bi[5],
-                                  ~(ai[6]) & bi[6],
-                                  ~(ai[7]) & bi[7]));
+    return float16 (andnot(a.lo(),b.lo()), andnot(a.hi(),b.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE float8 madd (const simd::float8& a, const simd::float8& b,
-                              const simd::float8& c)
+OIIO_FORCEINLINE float16 madd (const simd::float16& a, const simd::float16& b,
+                               const simd::float16& c)
 {
-#if OIIO_SIMD_AVX && OIIO_FMA_ENABLED
-    // If we are sure _mm256_fmadd_ps intrinsic is available, use it.
-    return _mm256_fmadd_ps (a, b, c);
+#if OIIO_SIMD_AVX >= 512
+    // AVX-512 always includes the fused multiply-add instructions.
+    return _mm512_fmadd_ps (a, b, c);
 #else
-    // Fallback: just use regular math and hope for the best.
-    return a * b + c;
+    return float16 (madd(a.lo(), b.lo(), c.lo()),
+                    madd(a.hi(), b.hi(), c.hi()));
 #endif
 }
 
 
-OIIO_FORCEINLINE float8 msub (const simd::float8& a, const simd::float8& b,
-                              const simd::float8& c)
+OIIO_FORCEINLINE float16 msub (const simd::float16& a, const simd::float16& b,
+                               const simd::float16& c)
 {
-#if OIIO_SIMD_AVX && OIIO_FMA_ENABLED
-    // If we are sure _mm256_fnmsub_ps intrinsic is available, use it.
-    return _mm256_fmsub_ps (a, b, c);
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_fmsub_ps (a, b, c);
 #else
-    // Fallback: just use regular math and hope for the best.
-    return a * b - c;
+    return float16 (msub(a.lo(), b.lo(), c.lo()),
+                    msub(a.hi(), b.hi(), c.hi()));
 #endif
 }
 
 
 
-OIIO_FORCEINLINE float8 nmadd (const simd::float8& a, const simd::float8& b,
-                               const simd::float8& c)
+OIIO_FORCEINLINE float16 nmadd (const simd::float16& a, const simd::float16& b,
+                                const simd::float16& c)
 {
-#if OIIO_SIMD_AVX && OIIO_FMA_ENABLED
-    // If we are sure _mm256_fnmadd_ps intrinsic is available, use it.
-    return _mm256_fnmadd_ps (a, b, c);
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_fnmadd_ps (a, b, c);
 #else
-    // Fallback: just use regular math and hope for the best.
-    return c - a * b;
+    return float16 (nmadd(a.lo(), b.lo(), c.lo()),
+                    nmadd(a.hi(), b.hi(), c.hi()));
 #endif
 }
 
 
 
-OIIO_FORCEINLINE float8 nmsub (const simd::float8& a, const simd::float8& b,
-                               const simd::float8& c)
+OIIO_FORCEINLINE float16 nmsub (const simd::float16& a, const simd::float16& b,
+                                const simd::float16& c)
 {
-#if OIIO_SIMD_AVX && OIIO_FMA_ENABLED
-    // If we are sure _mm256_fnmsub_ps intrinsic is available, use it.
-    return _mm256_fnmsub_ps (a, b, c);
+#if OIIO_SIMD_AVX >= 512
+    return _mm512_fnmsub_ps (a, b, c);
 #else
-    // Fallback: just use regular math and hope for the best.
-    return -(a * b) - c;
+    return float16 (nmsub(a.lo(), b.lo(), c.lo()),
+                    nmsub(a.hi(), b.hi(), c.hi()));
 #endif
 }
 
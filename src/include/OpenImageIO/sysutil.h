@@ -40,6 +40,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <time.h>
 
 #ifdef __MINGW32__
@@ -103,6 +104,11 @@ OIIO_API unsigned int hardware_concurrency ();
 /// platforms will return the number of virtual cores.
 OIIO_API unsigned int physical_concurrency ();
 
+/// Return the CPU numbers of each NUMA node on this machine, one list per
+/// node.  Where the platform doesn't report NUMA topology (or there is
+/// none), the result is a single node holding every virtual core.
+OIIO_API std::vector<std::vector<int>> numa_node_cpus ();
+
 /// Get the maximum number of open file handles allowed on this system.
 OIIO_API size_t max_open_files ();
 
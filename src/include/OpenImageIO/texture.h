@@ -109,7 +109,9 @@ public:
         MipModeNoMIP,        ///< Just use highest-res image, no MIP mapping
         MipModeOneLevel,     ///< Use just one mipmap level
         MipModeTrilinear,    ///< Use two MIPmap levels (trilinear)
-        MipModeAniso         ///< Use two MIPmap levels w/ anisotropic
+        MipModeAniso,        ///< Use two MIPmap levels w/ anisotropic
+        MipModeEWA           ///< Elliptical weighted average (see the
+                             ///<   "ewa_quality" attribute)
     };
 
     /// Interp mode determines how we sample within a mipmap level
@@ -213,7 +215,9 @@ public:
         MipModeNoMIP,        ///< Just use highest-res image, no MIP mapping
         MipModeOneLevel,     ///< Use just one mipmap level
         MipModeTrilinear,    ///< Use two MIPmap levels (trilinear)
-        MipModeAniso         ///< Use two MIPmap levels w/ anisotropic
+        MipModeAniso,        ///< Use two MIPmap levels w/ anisotropic
+        MipModeEWA           ///< Elliptical weighted average (see the
+                             ///<   "ewa_quality" attribute)
     };
 
     /// Interp mode determines how we sample within a mipmap level
@@ -287,6 +291,32 @@ private:
 
 
 
+/// Description of the MIP levels and tiles that one texture() lookup
+/// would touch, as returned by TextureSystem::texture_footprint().
+struct TextureFootprint {
+    ustring filename;         ///< Concrete file (differs from the
+                              ///<   requested name for UDIM textures)
+    int subimage;             ///< Subimage of the lookup
+    int nlevels;              ///< How many MIP levels are used (0, 1 or 2)
+    int miplevel[2];          ///< Which MIP levels
+    float levelweight[2];     ///< Blend weight of each level
+    int xbegin[2], xend[2];   ///< Texels read at each level, rounded out
+    int ybegin[2], yend[2];   ///<   to whole tiles and clipped to the
+                              ///<   data window (before wrapping)
+    int ntiles[2];            ///< Number of tiles in that region
+
+    TextureFootprint () : subimage(0), nlevels(0) {
+        for (int i = 0;  i < 2;  ++i) {
+            miplevel[i] = -1;
+            levelweight[i] = 0.0f;
+            xbegin[i] = xend[i] = ybegin[i] = yend[i] = 0;
+            ntiles[i] = 0;
+        }
+    }
+};
+
+
+
 /// Define an API to an abstract class that that manages texture files,
 /// caches of open file handles as well as tiles of texels so that truly
 /// huge amounts of texture may be accessed by an application with low
@@ -336,6 +366,8 @@ public:
     ///     int max_tile_channels : max channels to store all chans in a tile
     ///     string latlong_up : default "up" direction for latlong ("y")
     ///     int flip_t : flip v coord for texture lookups?
+    ///     int sort_batches : reorder batched lookups by tile (default=1)
+    ///     float ewa_quality : texel density of MipModeEWA (default=1)
     ///     int max_errors_per_file : Limits how many errors to issue for
     ///                               issue for each (default: 100)
     ///
@@ -398,6 +430,16 @@ public:
     /// read or sampled.
     virtual bool good (TextureHandle *texture_handle) = 0;
 
+    /// Return the index of the subimage of the texture (previously
+    /// returned by get_texture_handle()) whose "oiio:subimagename" is
+    /// subimagename, or -1 if there is no such subimage or the handle is
+    /// not valid.  Storing the result in TextureOpt::subimage (rather than
+    /// setting TextureOpt::subimagename) avoids resolving the name on
+    /// every texture lookup.
+    virtual int get_subimage_index (TextureHandle *texture_handle,
+                                    Perthread *thread_info,
+                                    ustring subimagename) = 0;
+
     /// Filtered 2D texture lookup for a single point.
     ///
     /// s,t are the texture coordinates; dsdx, dtdx, dsdy, and dtdy are
@@ -649,6 +691,47 @@ public:
                              int chbegin, int chend,
                              TypeDesc format, void *result) = 0;
 
+    /// Ask for the tiles of the given subimage and MIP level of the named
+    /// texture that cover the texture-space rectangle [smin,smax] x
+    /// [tmin,tmax] to be read into the cache in the background, as with
+    /// ImageCache::prefetch_tiles().  This returns right away.  Return
+    /// false if the texture or level can't be found.
+    virtual bool prefetch_tiles (ustring filename, int subimage, int miplevel,
+                                 float smin, float smax,
+                                 float tmin, float tmax) = 0;
+
+    /// Without sampling anything, compute which MIP levels (and with
+    /// what weights) a texture() call with the same options, (s,t) and
+    /// derivatives would use, and which tiles of those levels it would
+    /// read (a conservative bound on the filter footprint).  This uses
+    /// the same level selection as texture(), so the levels match
+    /// exactly.  Lookups of constant-colored textures report no levels.
+    /// Return false if the texture can't be found.
+    virtual bool texture_footprint (ustring filename, TextureOpt &options,
+                                    float s, float t, float dsdx, float dtdx,
+                                    float dsdy, float dtdy,
+                                    TextureFootprint &footprint) = 0;
+    virtual bool texture_footprint (TextureHandle *texture_handle,
+                                    Perthread *thread_info,
+                                    TextureOpt &options,
+                                    float s, float t, float dsdx, float dtdx,
+                                    float dsdy, float dtdy,
+                                    TextureFootprint &footprint) = 0;
+
+    /// For a latlong environment map, return tables for importance
+    /// sampling directions in proportion to the map's luminance times
+    /// solid angle, built from a MIP level no larger than 512 across (and
+    /// computed only once per texture).  marginal holds height+1 values,
+    /// the CDF over rows (t); conditional holds height rows of width+1
+    /// values, the CDF over columns (s) within each row.  Both run from
+    /// 0 to 1.  If the map was made by maketx --envcdf, the tables
+    /// stored with it (to 16 bit precision) are used instead.  Return
+    /// false if the map can't be found or isn't a latlong environment map.
+    virtual bool environment_cdf (ustring filename, int subimage,
+                                  int &width, int &height,
+                                  std::vector<float> &marginal,
+                                  std::vector<float> &conditional) = 0;
+
     /// If any of the API routines returned false indicating an error,
     /// this routine will return the error string (and clear any error
     /// flags).  If no error has occurred since the last time geterror()
@@ -659,6 +742,12 @@ public:
     ///
     virtual std::string getstats (int level=1, bool icstats=true) const = 0;
 
+    /// Return a snapshot of the statistics as a JSON object with a
+    /// "texture" member (queries, batches and interpolations), and if
+    /// icstats is true, the "imagecache" member described in
+    /// ImageCache::getstats_json.
+    virtual std::string getstats_json (int level=1, bool icstats=true) const = 0;
+
     /// Invalidate any cached information about the named file. A client
     /// might do this if, for example, they are aware that an image
     /// being held in the cache has been updated on disk.
@@ -41,6 +41,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
@@ -540,6 +541,29 @@ public:
     /// means the queue is fully engaged.
     int idle () const;
 
+    /// Ways to bind the pool's worker threads to CPUs.
+    enum Affinity {
+        AffinityNone = 0,   ///< Workers may run on any CPU (the default)
+        AffinityNUMA,       ///< Worker i runs on the CPUs of NUMA node
+                            ///<   i % nodes, so workers alternate nodes
+        AffinityCPU         ///< Like AffinityNUMA, but each worker is
+                            ///<   pinned to one CPU of its node
+    };
+
+    /// Bind the pool's workers (present and future) to CPUs as described
+    /// by a. Binding is currently only supported on Linux; elsewhere the
+    /// setting is remembered but has no effect. Like resize(), this
+    /// should not be done while jobs are running.
+    void set_affinity (Affinity a);
+
+    /// The current Affinity setting.
+    Affinity affinity () const;
+
+    /// Return the NUMA node to which the worker with the given thread id
+    /// is bound, or -1 if workers are not bound (or thread_id is -1, a
+    /// non-pool thread). Tasks may use this to prefer node-local data.
+    int numa_node (int thread_id) const;
+
     /// Run the user's function that accepts argument int - id of the
     /// running thread. The returned value is templatized std::future, where
     /// the user can get the result and rethrow any exceptions.
@@ -575,6 +599,24 @@ public:
     /// when they would ordinarily be idle.
     bool run_one_task ();
 
+    /// Return true if the calling thread is one of this pool's worker
+    /// threads. A task that would block waiting on other tasks it pushed
+    /// can use this to run them itself rather than risk starving the pool.
+    bool this_thread_is_in_pool () const;
+
+    /// Wait for the future (or shared_future) f to be ready, running tasks
+    /// from the queue on the calling thread meanwhile. A pool task that
+    /// must wait on work it pushed should do this rather than f.wait(), so
+    /// that it keeps its thread busy and can't deadlock a full pool.
+    template<typename FUTURE>
+    void wait_for (const FUTURE &f) {
+        std::chrono::milliseconds wait_time (0);
+        while (f.wait_for (wait_time) != std::future_status::ready) {
+            if (! run_one_task())
+                yield();
+        }
+    }
+
 private:
     // Disallow copy construction and assignment
     thread_pool (const thread_pool&) = delete;
@@ -600,6 +642,53 @@ OIIO_API thread_pool* default_thread_pool ();
 
 
 
+namespace pvt {
+
+// Bookkeeping shared by a task_set and the tasks submitted to it: how many
+// submitted tasks haven't finished, and the continuations to launch when
+// that count drops to zero.
+class task_set_state {
+public:
+    void add () {
+        lock_guard lock (m_mutex);
+        ++m_pending;
+    }
+    void done () {
+        std::vector<std::function<void()>> hooks;
+        {
+            lock_guard lock (m_mutex);
+            if (--m_pending == 0)
+                hooks.swap (m_hooks);
+        }
+        for (auto &h : hooks)
+            h ();
+    }
+    // Call hook when no submitted tasks are pending -- now, if that's
+    // already the case.
+    void when_done (std::function<void()> &&hook) {
+        {
+            lock_guard lock (m_mutex);
+            if (m_pending) {
+                m_hooks.emplace_back (std::move(hook));
+                return;
+            }
+        }
+        hook ();
+    }
+    bool idle () const {
+        lock_guard lock (m_mutex);
+        return m_pending == 0;
+    }
+private:
+    mutable mutex m_mutex;
+    int m_pending = 0;
+    std::vector<std::function<void()>> m_hooks;
+};
+
+} // end namespace pvt
+
+
+
 /// task_set<T> is a group of future<T>'s from a thread_queue that you can
 /// add to, and when you either call wait() or just leave the task_set's
 /// scope, it will wait for all the tasks in the set to be done before
@@ -619,18 +708,82 @@ OIIO_API thread_pool* default_thread_pool ();
 ///        // wait for all those queue tasks to finish.
 ///    }
 ///
+/// Tasks may instead be handed to submit(), which pushes them to the pool
+/// and tracks their completion, so that then() can queue a continuation
+/// to run once they are all done, without any thread blocking on them.
+/// Giving then() another task_set makes the continuation one of that
+/// set's submitted tasks, which lets stages be chained into a pipeline:
+///
+///    task_set<void> decode (pool), convert (pool), write (pool);
+///    for (auto &f : files)
+///        decode.submit ([&f](int id){ read (f); });
+///    decode.then ([&](int id){ convert_all (); }, convert);
+///    convert.then ([&](int id){ write_all (); }, write);
+///    write.wait ();
+///
+/// A continuation runs when the set has no unfinished submitted tasks,
+/// which includes any submitted after then() but before the others finish.
+/// It does not wait for futures added with push().
+///
 template<typename T>
 class task_set {
 public:
-    task_set (thread_pool *pool) { m_pool = pool; }
+    task_set (thread_pool *pool)
+        : m_pool(pool), m_state(std::make_shared<pvt::task_set_state>()) { }
     ~task_set () { wait(); }
     void push (std::future<T> &&f) { m_futures.emplace_back (std::move(f)); }
+
+    /// Push f (a function taking the thread id and returning T) to the
+    /// pool as a tracked task of this set, returning its future. This may
+    /// be called from any thread, including the set's own tasks.
+    template<typename F>
+    std::future<T> submit (F &&f) {
+        auto pck = std::make_shared<std::packaged_task<T(int)>>(std::forward<F>(f));
+        std::shared_ptr<pvt::task_set_state> state (m_state);
+        state->add ();
+        m_pool->push ([pck,state](int id) {
+            (*pck)(id);
+            state->done ();
+        });
+        return pck->get_future();
+    }
+
+    /// Queue f (taking the thread id) to run in the pool once every task
+    /// submitted to this set has finished, and return its future. The
+    /// call never blocks.
+    template<typename F>
+    auto then (F &&f) -> std::future<decltype(f(0))> {
+        auto pck = std::make_shared<std::packaged_task<decltype(f(0))(int)>>(std::forward<F>(f));
+        thread_pool *pool = m_pool;
+        m_state->when_done ([pool,pck]() {
+            pool->push ([pck](int id){ (*pck)(id); });
+        });
+        return pck->get_future();
+    }
+
+    /// Like then(f), but f becomes a submitted task of next, so waits on
+    /// next (and next's own continuations) wait for it too.
+    template<typename F, typename U>
+    std::future<U> then (F &&f, task_set<U> &next) {
+        auto pck = std::make_shared<std::packaged_task<U(int)>>(std::forward<F>(f));
+        thread_pool *pool = next.m_pool;
+        std::shared_ptr<pvt::task_set_state> nstate (next.m_state);
+        nstate->add ();
+        m_state->when_done ([pool,pck,nstate]() {
+            pool->push ([pck,nstate](int id) {
+                (*pck)(id);
+                nstate->done ();
+            });
+        });
+        return pck->get_future();
+    }
+
     void wait (bool block = false) {
         if (block == false) {
             int tries = 0;
             std::chrono::milliseconds wait_time (0);
             while (1) {
-                bool all_finished = true;
+                bool all_finished = m_state->idle();
                 for (auto& f : m_futures) {
                     // Asking future.wait_for for 0 time just checks the status.
                     auto status = f.wait_for (wait_time);
@@ -652,10 +805,14 @@ public:
             // and don't try to do any of the work with the calling thread.
             for (auto& f : m_futures)
                 f.wait ();
+            while (! m_state->idle())
+                yield();
         }
     }
 private:
+    template<typename U> friend class task_set;
     thread_pool *m_pool;
+    std::shared_ptr<pvt::task_set_state> m_state;
     std::vector<std::future<T>> m_futures;
 };
 
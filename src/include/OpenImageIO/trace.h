@@ -0,0 +1,166 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+/// @file trace.h
+/// @brief Low-overhead tracing of where the time goes.
+
+
+#ifndef OPENIMAGEIO_TRACE_H
+#define OPENIMAGEIO_TRACE_H
+
+#include "oiioversion.h"
+#include "export.h"
+#include "platform.h"
+#include "string_view.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <intrin.h>
+#elif !defined(__i386__) && !defined(__x86_64__)
+#  include <chrono>
+#endif
+
+
+OIIO_NAMESPACE_BEGIN
+
+/// Tracing records named, timed "zones" -- scopes of code marked with
+/// OIIO_TRACE_ZONE -- into a ring buffer per thread, and writes them out
+/// in the Chrome trace event format, which chrome://tracing and Perfetto
+/// display as a timeline and which Tracy can import.
+///
+/// Zones are compiled in only where OIIO_TRACING is defined to nonzero
+/// (for OIIO itself, by building with USE_TRACING=ON); elsewhere the
+/// macro expands to nothing.  Compiled-in zones record nothing, at the
+/// cost of one test, until tracing is turned on with Trace::enable(),
+/// the global attribute "trace", or the environment variable OIIO_TRACE,
+/// which names a file to write the trace to when the program exits.
+///
+/// Zone names (and details) are not copied, so they must stay valid
+/// until the trace is written: use string literals or ustring::c_str().
+///
+/// Example:
+///
+///     void decode (...) {
+///         OIIO_TRACE_ZONE ("decode");
+///         ...
+///     }
+///     ...
+///     Trace::enable ();
+///     decode (...);
+///     Trace::write ("trace.json");
+///
+namespace Trace {
+
+/// Turn recording of zones on or off.
+OIIO_API void enable (bool on=true);
+
+/// Is recording turned on?
+OIIO_API bool enabled ();
+
+/// Set the maximum number of zones each thread keeps.  When a thread's
+/// buffer is full, its oldest zones are overwritten.  The default is
+/// 65536.  Applies to buffers started after the call.
+OIIO_API void set_buffer_size (int zones_per_thread);
+OIIO_API int buffer_size ();
+
+/// Discard everything recorded so far.
+OIIO_API void clear ();
+
+/// Total number of zones currently held, over all threads.
+OIIO_API size_t size ();
+
+/// Write everything recorded so far to the file, as a Chrome trace
+/// (JSON) file.  Return true on success.
+OIIO_API bool write (string_view filename);
+
+/// Name a file to write the trace to when the program exits (or ""
+/// for none).  This is how the OIIO_TRACE environment variable works.
+OIIO_API void write_at_exit (string_view filename);
+
+/// The current timestamp, in the units that record() takes: the CPU's
+/// time stamp counter where there is one, nanoseconds elsewhere.
+inline unsigned long long timestamp () {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__i386__) || defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/// Record a zone that started and ended at the given timestamps, for
+/// the calling thread.  Normally one uses ScopedZone or OIIO_TRACE_ZONE
+/// rather than calling this directly.
+OIIO_API void record (const char *name, const char *detail,
+                      unsigned long long begin, unsigned long long end);
+
+
+/// Records a zone spanning its lifetime, if tracing is on when it's
+/// constructed.  The optional detail (a file name, say) is shown as an
+/// argument of the zone.
+class ScopedZone {
+public:
+    explicit ScopedZone (const char *name, const char *detail = NULL)
+        : m_name(enabled() ? name : NULL), m_detail(detail),
+          m_begin(m_name ? timestamp() : 0) { }
+    ~ScopedZone () {
+        if (m_name)
+            record (m_name, m_detail, m_begin, timestamp());
+    }
+private:
+    const char *m_name;
+    const char *m_detail;
+    unsigned long long m_begin;
+    ScopedZone (const ScopedZone&);              // not copyable
+    ScopedZone& operator= (const ScopedZone&);
+};
+
+}  // end namespace Trace
+
+OIIO_NAMESPACE_END
+
+
+#define OIIO_TRACE_CONCAT_HELPER(a,b) a##b
+#define OIIO_TRACE_CONCAT(a,b) OIIO_TRACE_CONCAT_HELPER(a,b)
+
+/// OIIO_TRACE_ZONE(name [,detail]) records the enclosing scope as a zone
+/// when tracing is compiled in and turned on, and is nothing otherwise.
+#if defined(OIIO_TRACING) && OIIO_TRACING
+#  define OIIO_TRACE_ZONE(...)                                          \
+    OIIO::Trace::ScopedZone                                             \
+        OIIO_TRACE_CONCAT(oiio_trace_zone_,__LINE__) (__VA_ARGS__)
+#else
+#  define OIIO_TRACE_ZONE(...)
+#endif
+
+
+#endif // OPENIMAGEIO_TRACE_H
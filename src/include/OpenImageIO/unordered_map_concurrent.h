@@ -64,6 +64,20 @@ OIIO_NAMESPACE_BEGIN
 /// accessing the map simultaneously will not be accessing the same bin,
 /// and therefore will not be contending for the same lock.
 ///
+/// Each bin is guarded by a reader/writer lock:  retrieve() takes it only
+/// shared, so threads that just look up entries in the same bin don't
+/// lock each other out, while everything that may modify the bin (or
+/// hands back an iterator through which entries may be modified) takes
+/// it exclusively.
+///
+/// A bin that would have to rehash to fit one more entry doesn't do so
+/// all at once (stalling every thread waiting on that bin for the length
+/// of the rehash).  Instead, its entries are set aside as the bin's "old"
+/// map, new entries go into a fresh map with room for twice as many, and
+/// each subsequent insert into the bin moves a few of the old entries
+/// over, so that the old map is empty well before the new one fills.
+/// Lookups in the meantime search both.
+///
 /// unordered_map_concurrent provides an iterator which points to an
 /// entry in the map and also knows which bin it is in and implicitly
 /// holds a lock on the bin.  When the iterator is destroyed, the lock
@@ -98,7 +112,7 @@ public:
         /// Construct an unordered_map_concurrent iterator that points
         /// to nothing.
         iterator (unordered_map_concurrent *umc = NULL)
-            : m_umc(umc), m_bin(-1), m_locked(false) { }
+            : m_umc(umc), m_bin(-1), m_old(false), m_locked(false) { }
 
         /// Copy constructor of an unordered_map_concurrent iterator
         /// transfers the lock (if held) to this.  Caveat: the copied
@@ -107,6 +121,7 @@ public:
             m_umc = src.m_umc;
             m_bin = src.m_bin;
             m_biniterator = src.m_biniterator;
+            m_old = src.m_old;
             m_locked = src.m_locked;
             // assignment transfers lock ownership
             *(const_cast<bool *>(&src.m_locked)) = false;
@@ -141,8 +156,7 @@ public:
         /// valid element of one of the bins of the map, false if it's
         /// equivalent to the end() iterator.
         operator bool() {
-            return m_umc && m_bin >= 0 &&
-                m_biniterator != m_umc->m_bins[m_bin].map.end();
+            return m_umc && m_bin >= 0 && m_biniterator != binmap().end();
         }
 
         /// Iterator assignment transfers ownership of any bin locks
@@ -152,6 +166,7 @@ public:
             m_umc = src.m_umc;
             m_bin = src.m_bin;
             m_biniterator = src.m_biniterator;
+            m_old = src.m_old;
             m_locked = src.m_locked;
             // assignment transfers lock ownership
             *(const_cast<bool *>(&src.m_locked)) = false;
@@ -163,7 +178,7 @@ public:
                 return false;
             if (m_bin == -1 && other.m_bin == -1)
                 return true;
-            return m_bin == other.m_bin &&
+            return m_bin == other.m_bin && m_old == other.m_old &&
                 m_biniterator == other.m_biniterator;
         }
         bool operator!= (const iterator &other) {
@@ -178,7 +193,7 @@ public:
             DASSERT (m_umc);
             DASSERT (m_bin >= 0);
             ++m_biniterator;
-            while (m_biniterator == m_umc->m_bins[m_bin].map.end()) {
+            while (! into_old ()) {
                 if (m_bin == BINS-1) {
                     // ran off the end
                     unbin();
@@ -211,10 +226,28 @@ public:
         /// bin contents.
         bool incr_no_lock () {
             ++m_biniterator;
-            return (m_biniterator != m_umc->m_bins[m_bin].map.end());
+            return into_old ();
         }
 
     private:
+        // The map within our bin that m_biniterator walks.
+        BinMap_t & binmap () const {
+            Bin &bin (m_umc->m_bins[m_bin]);
+            return m_old ? bin.old : bin.map;
+        }
+
+        // If we've run off the end of the bin's main map, go on to its
+        // old map.  Return true if we point to an entry, false if we ran
+        // off the end of the bin.
+        bool into_old () {
+            Bin &bin (m_umc->m_bins[m_bin]);
+            if (! m_old && m_biniterator == bin.map.end()) {
+                m_old = true;
+                m_biniterator = bin.old.begin();
+            }
+            return m_biniterator != binmap().end();
+        }
+
         // No longer refer to a particular bin, release lock on the bin
         // it had (if any).
         void unbin () {
@@ -232,12 +265,14 @@ public:
             unbin ();
             m_bin = newbin;
             lock ();
+            m_old = false;
             m_biniterator = m_umc->m_bins[m_bin].map.begin();
         }
 
         unordered_map_concurrent *m_umc;  // which umc this iterator refers to
         int m_bin;                        // which bin within the umc
         BinMap_iterator_t m_biniterator;  // which entry within the bin
+        bool m_old;                       // is m_biniterator in the old map?
         bool m_locked;                    // do we own the lock on the bin?
     };
 
@@ -246,7 +281,7 @@ public:
     iterator begin () {
         iterator i (this);
         i.rebin (0);
-        while (i.m_biniterator == m_bins[i.m_bin].map.end()) {
+        while (! i.into_old ()) {
             if (i.m_bin == BINS-1) {
                 // ran off the end
                 i.unbin();
@@ -257,6 +292,20 @@ public:
         return i;
     }
 
+    /// Return a locked iterator pointing to the first entry of the given
+    /// bin (which will be equivalent to end() as a bool if the bin is
+    /// empty).  Use incr_no_lock() to step through the rest of the bin.
+    iterator bin_begin (size_t bin) {
+        DASSERT (bin < BINS);
+        iterator i (this);
+        i.rebin (int(bin));
+        i.into_old ();
+        return i;
+    }
+
+    /// Return the number of bins.
+    size_t nbins () const { return BINS; }
+
     /// Return an iterator signifying the end of the map (no valid
     /// entry pointed to).
     iterator end () {
@@ -277,8 +326,9 @@ public:
         Bin &bin (m_bins[b]);
         if (do_lock)
             bin.lock ();
-        typename BinMap_t::iterator it = bin.map.find (key);
-        if (it == bin.map.end()) {
+        typename BinMap_t::iterator it;
+        bool old;
+        if (! bin.find (key, it, old)) {
             // not found -- return the 'end' iterator
             if (do_lock)
                 bin.unlock();
@@ -288,6 +338,7 @@ public:
         iterator i (this);
         i.m_bin = (unsigned) b;
         i.m_biniterator = it;
+        i.m_old = old;
         i.m_locked = do_lock;
         return i;
     }
@@ -301,13 +352,14 @@ public:
         size_t b = whichbin(key);
         Bin &bin (m_bins[b]);
         if (do_lock)
-            bin.lock ();
-        typename BinMap_t::iterator it = bin.map.find (key);
-        bool found = (it != bin.map.end());
+            bin.lock_shared ();
+        typename BinMap_t::iterator it;
+        bool old;
+        bool found = bin.find (key, it, old);
         if (found)
             value = it->second;
         if (do_lock)
-            bin.unlock();
+            bin.unlock_shared ();
         return found;
     }
 
@@ -322,10 +374,13 @@ public:
         Bin &bin (m_bins[b]);
         if (do_lock)
             bin.lock ();
-        bool add = (bin.map.find (key) == bin.map.end());
+        typename BinMap_t::iterator it;
+        bool old;
+        bool add = ! bin.find (key, it, old);
         if (add) {
             // not found -- add it!
-            bin.map[key] = value;
+            bin.make_room ();
+            bin.map.insert (std::make_pair (key, value));
             ++m_size;
         }
         if (do_lock)
@@ -342,9 +397,11 @@ public:
         Bin &bin (m_bins[b]);
         if (do_lock)
             bin.lock ();
-        typename BinMap_t::iterator it = bin.map.find (key);
-        if (it != bin.map.end()) {
-            bin.map.erase (it);
+        typename BinMap_t::iterator it;
+        bool old;
+        if (bin.find (key, it, old)) {
+            (old ? bin.old : bin.map).erase (it);
+            --m_size;
         }
         if (do_lock)
             bin.unlock();
@@ -371,11 +428,22 @@ public:
         m_bins[bin].unlock ();
     }
 
+    /// Make room for the map to hold n entries in all without any bin
+    /// having to grow (assuming they're spread evenly among the bins).
+    void reserve (size_t n) {
+        for (size_t b = 0;  b < BINS;  ++b) {
+            m_bins[b].lock ();
+            m_bins[b].map.reserve (n / BINS + 1);
+            m_bins[b].unlock ();
+        }
+    }
+
 private:
     struct Bin {
         OIIO_CACHE_ALIGN             // align bin to cache line
-        mutable spin_mutex mutex;    // mutex for this bin
+        mutable spin_rw_mutex mutex; // mutex for this bin
         BinMap_t map;                // hash map for this bin
+        BinMap_t old;                // entries still to move into map
 #ifndef NDEBUG
         mutable atomic_int m_nlocks; // for debugging
 #endif
@@ -404,6 +472,45 @@ private:
 #endif
             mutex.unlock();
         }
+        void lock_shared () const { mutex.lock_shared(); }
+        void unlock_shared () const { mutex.unlock_shared(); }
+
+        // Find key in either map: if it's there, return true and set it
+        // to the entry and inold to which map it's in.  The caller holds
+        // the lock.
+        bool find (const KEY &key, typename BinMap_t::iterator &it,
+                   bool &inold) {
+            it = map.find (key);
+            inold = false;
+            if (it != map.end())
+                return true;
+            if (old.empty())
+                return false;
+            it = old.find (key);
+            inold = true;
+            return it != old.end();
+        }
+
+        // Make sure that map can take one more entry without rehashing:
+        // if it couldn't, make it the old map and start afresh with room
+        // for twice as many.  Then move some old entries into map.  The
+        // caller holds the lock exclusively.
+        void make_room () {
+            const size_t small = 64;   // just let small maps rehash
+            const int moves = 4;       // drains old long before map fills
+            if (old.empty()) {
+                if (map.size() < small ||
+                    map.size()+1 <= map.bucket_count() * map.max_load_factor())
+                    return;
+                old.swap (map);
+                map.reserve (2 * old.size());
+            }
+            for (int i = 0;  i < moves && ! old.empty();  ++i) {
+                typename BinMap_t::iterator it = old.begin();
+                map.insert (std::make_pair (it->first, std::move (it->second)));
+                old.erase (it);
+            }
+        }
     };
 
     HASH m_hash;         // hashing function
@@ -62,6 +62,8 @@
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/sysutil.h"
 #include "OpenImageIO/filesystem.h"
+#include "OpenImageIO/imagecache.h"
+#include "OpenImageIO/thread.h"
 #include "ivutils.h"
 
 
@@ -110,7 +112,9 @@ ImageViewer::ImageViewer ()
     : infoWindow(NULL), preferenceWindow(NULL), darkPaletteBox(NULL),
       m_current_image(-1), m_current_channel(0), m_color_mode(RGBA),
       m_last_image(-1), m_zoom(1), m_fullscreen(false), m_default_gamma(1),
-      m_darkPalette(false)
+      m_darkPalette(false), m_play_direction(0), m_play_start_frame(0),
+      m_play_step(0), m_play_shown(0), m_play_dropped(0),
+      m_readahead_stop(false)
 {
     readSettings (false);
 
@@ -135,6 +139,8 @@ ImageViewer::ImageViewer ()
     slideTimer = new QTimer();
     slideDuration_ms = 5000;
     slide_loop = true;
+    playbackTimer = new QTimer();
+    connect (playbackTimer, SIGNAL(timeout()), this, SLOT(playbackTick()));
     glwin = new IvGL (this, *this);
     glwin->setPalette (m_palette);
     glwin->resize (m_default_width, m_default_height);
@@ -156,6 +162,8 @@ ImageViewer::ImageViewer ()
 
 ImageViewer::~ImageViewer ()
 {
+    stopPlayback ();
+    glwin->cancel_fetches ();
     for (auto i : m_images)
         delete i;
 }
@@ -369,6 +377,17 @@ ImageViewer::createActions()
     slideNoLoopAct->setCheckable (true);
     connect(slideNoLoopAct, SIGNAL(triggered()), this, SLOT(slideNoLoop()));
 
+    playForwardAct = new QAction(tr("Play Forward"), this);
+    playForwardAct->setShortcut(tr("Space"));
+    connect (playForwardAct, SIGNAL(triggered()), this, SLOT(playForward()));
+
+    playBackwardAct = new QAction(tr("Play Backward"), this);
+    playBackwardAct->setShortcut(tr("Shift+Space"));
+    connect (playBackwardAct, SIGNAL(triggered()), this, SLOT(playBackward()));
+
+    stopPlaybackAct = new QAction(tr("Stop"), this);
+    connect (stopPlaybackAct, SIGNAL(triggered()), this, SLOT(stopPlayback()));
+
     sortByNameAct = new QAction(tr("By Name"), this);
     connect(sortByNameAct, SIGNAL(triggered()), this, SLOT(sortByName()));
 
@@ -419,6 +438,17 @@ ImageViewer::createActions()
     slideShowDuration->setSuffix (" s");
     slideShowDuration->setAccelerated (true);
     connect(slideShowDuration, SIGNAL(valueChanged(int)), this, SLOT(setSlideShowDuration(int)));
+
+    playbackFpsLabel = new QLabel (tr("Flipbook frame rate"));
+    playbackFps = new QSpinBox ();
+    playbackFps->setRange (1, 120);
+    playbackFps->setSuffix (" fps");
+
+    playbackCacheLabel = new QLabel (tr("Flipbook frame cache"));
+    playbackCache = new QSpinBox ();
+    playbackCache->setRange (64, sizeof (void *) == 4 ? 2048 : 65536);
+    playbackCache->setSingleStep (256);
+    playbackCache->setSuffix (" MB");
 }
 
 
@@ -467,6 +497,11 @@ ImageViewer::createMenus()
     slideMenu->addAction (slideLoopAct);
     slideMenu->addAction (slideNoLoopAct);
 
+    playbackMenu = new QMenu(tr("Flipbook"));
+    playbackMenu->addAction (playForwardAct);
+    playbackMenu->addAction (playBackwardAct);
+    playbackMenu->addAction (stopPlaybackAct);
+
     sortMenu = new QMenu(tr("Sort"));
     sortMenu->addAction (sortByNameAct);
     sortMenu->addAction (sortByPathAct);
@@ -518,6 +553,7 @@ ImageViewer::createMenus()
     toolsMenu->addAction (showInfoWindowAct);
     toolsMenu->addAction (showPixelviewWindowAct);
     toolsMenu->addMenu (slideMenu);
+    toolsMenu->addMenu (playbackMenu);
     toolsMenu->addMenu (sortMenu);
         
     // Menus, toolbars, & status
@@ -603,6 +639,8 @@ ImageViewer::readSettings (bool ui_is_set_up)
     else
         maxMemoryIC->setValue (settings.value ("maxMemoryIC", 2048).toInt());
     slideShowDuration->setValue (settings.value ("slideShowDuration", 10).toInt());
+    playbackFps->setValue (settings.value ("playbackFps", 24).toInt());
+    playbackCache->setValue (settings.value ("playbackCache", 4096).toInt());
 
     ImageCache *imagecache = ImageCache::create (true);
     imagecache->attribute ("automip", autoMipmap->isChecked());
@@ -623,6 +661,8 @@ ImageViewer::writeSettings()
     settings.setValue ("autoMipmap", autoMipmap->isChecked());
     settings.setValue ("maxMemoryIC", maxMemoryIC->value());
     settings.setValue ("slideShowDuration", slideShowDuration->value());
+    settings.setValue ("playbackFps", playbackFps->value());
+    settings.setValue ("playbackCache", playbackCache->value());
     QStringList recent;
     for (auto&& s : m_recent_files)
         recent.push_front (QString(s.c_str()));
@@ -748,6 +788,7 @@ ImageViewer::reload()
     if (m_images.empty())
         return;
     IvImage *newimage = m_images[m_current_image];
+    glwin->cancel_fetches ();
     newimage->invalidate ();
     //glwin->trigger_redraw ();
     displayCurrentImage ();
@@ -905,6 +946,13 @@ ImageViewer::updateStatusBar ()
         message += Strutil::format ("  MIP %d/%d",
                                     cur()->miplevel()+1, cur()->nmiplevels());
     }
+    if (m_play_direction) {
+        double t = m_play_clock();
+        message += Strutil::format ("  %s %.1f fps, %d dropped",
+                                    m_play_direction > 0 ? ">" : "<",
+                                    t > 0 ? m_play_shown / t : 0.0,
+                                    m_play_dropped);
+    }
 
     statusViewInfo->setText(message.c_str()); // tr("iv status"));
 }
@@ -919,6 +967,9 @@ ImageViewer::loadCurrentImage (int subimage, int miplevel)
     }
     IvImage *img = cur ();
     if (img) {
+        // The display may still be reading pixels from this image in the
+        // background, which must stop before we re-read it.
+        glwin->cancel_fetches ();
         // We need the spec available to compare the image format with
         // opengl's capabilities.
         if (! img->init_spec (img->name(), subimage, miplevel)) {
@@ -946,16 +997,8 @@ ImageViewer::loadCurrentImage (int subimage, int miplevel)
                 //std::cerr << "Loading HALF-FLOAT as FLOAT\n";
                 read_format = TypeDesc::FLOAT;
             }
-            if (IsSpecSrgb(image_spec) && !glwin->is_srgb_capable ()) {
-                // If the image is in sRGB, but OpenGL can't load sRGB textures then
-                // we'll need to do the transformation on the CPU after loading the
-                // image. We (so far) can only do this with UINT8 images, so make
-                // sure that it gets loaded in this format.
-                //std::cerr << "Loading as UINT8 to do sRGB\n";
-                read_format = TypeDesc::UINT8;
-                srgb_transform = true;
-                allow_transforms = true;
-            }
+            // If the image is in sRGB but OpenGL can't load sRGB textures,
+            // the shader decodes it, so there's nothing to do on the CPU.
         } else {
             //std::cerr << "Loading as UINT8\n";
             read_format = TypeDesc::UINT8;
@@ -1255,19 +1298,9 @@ ImageViewer::viewChannel (int c, COLOR_MODE colormode)
                 bool srgb_transform = (! glwin->is_srgb_capable () && IsSpecSrgb(img->spec()));
                 img->pixel_transform (srgb_transform, (int)colormode, c);
             }
-        } else {
-            // FIXME: There are even more chances to avoid updating the textures
-            // if we can keep trac of which channels are in the texture.
-            if (m_current_channel == c) {
-                if (m_color_mode == SINGLE_CHANNEL || m_color_mode == HEATMAP) {
-                    if (colormode == HEATMAP || colormode == SINGLE_CHANNEL)
-                        update = false;
-                } else if (m_color_mode == RGB || m_color_mode == LUMINANCE) {
-                    if (colormode == RGB || colormode == LUMINANCE)
-                        update = false;
-                }
-            }
         }
+        // With shaders, IvGL::update() only sends the pixels again if the
+        // channels it holds in the textures have to change.
         m_current_channel = c;
         m_color_mode = colormode;
         displayCurrentImage (update);
@@ -1343,6 +1376,173 @@ ImageViewer::setSlideShowDuration (int seconds)
 
 
 
+void
+ImageViewer::playForward ()
+{
+    if (m_play_direction > 0)
+        stopPlayback ();
+    else
+        startPlayback (1);
+}
+
+
+
+void
+ImageViewer::playBackward ()
+{
+    if (m_play_direction < 0)
+        stopPlayback ();
+    else
+        startPlayback (-1);
+}
+
+
+
+void
+ImageViewer::startPlayback (int direction)
+{
+    stopPlayback ();
+    if (m_images.size() < 2)
+        return;
+    // While playing, the ImageCache is the frame cache.
+    ImageCache *imagecache = ImageCache::create (true);
+    imagecache->attribute ("max_memory_MB", (float) std::max (playbackCache->value(),
+                                                              maxMemoryIC->value()));
+    m_play_direction = direction;
+    m_play_start_frame = std::max (0, m_current_image);
+    m_play_step = 0;
+    m_play_shown = 0;
+    m_play_dropped = 0;
+    m_play_clock.reset ();
+    m_play_clock.start ();
+    readahead ();
+    // Tick at twice the frame rate, and let the clock decide when each
+    // frame is due.
+    playbackTimer->start (std::max (1, 500 / playbackFps->value()));
+}
+
+
+
+void
+ImageViewer::stopPlayback ()
+{
+    if (! m_play_direction && m_readahead.empty())
+        return;
+    playbackTimer->stop ();
+    m_readahead_stop = true;
+    for (auto&& r : m_readahead)
+        default_thread_pool()->wait_for (r.second);
+    m_readahead.clear ();
+    m_readahead_stop = false;
+    ImageCache *imagecache = ImageCache::create (true);
+    imagecache->attribute ("max_memory_MB", (float) maxMemoryIC->value ());
+    if (m_play_direction) {
+        double t = m_play_clock();
+        m_play_direction = 0;
+        updateStatusBar ();
+        statusViewInfo->setText (tr("Played %1 frames at %2 fps, %3 dropped")
+                                 .arg (m_play_shown)
+                                 .arg (t > 0 ? m_play_shown / t : 0.0, 0, 'f', 1)
+                                 .arg (m_play_dropped));
+    }
+}
+
+
+
+void
+ImageViewer::playbackTick ()
+{
+    int n = (int) m_images.size();
+    if (n < 2 || ! m_play_direction) {
+        stopPlayback ();
+        return;
+    }
+    // The frame that's due is decided by the clock, not by counting
+    // ticks, so if we can't keep up we drop frames rather than slow down.
+    long step = (long) (m_play_clock() * playbackFps->value());
+    if (step <= m_play_step)
+        return;
+    long frame = m_play_start_frame + m_play_direction * step;
+    if (! slide_loop && (frame < 0 || frame >= n)) {
+        stopPlayback ();
+        return;
+    }
+    m_play_dropped += (int) (step - m_play_step - 1);
+    m_play_step = step;
+    current_image ((int) (((frame % n) + n) % n));
+    ++m_play_shown;
+    updateStatusBar ();
+    readahead ();
+}
+
+
+
+// Bring all the tiles of the top level of a file into the ImageCache.
+static void
+read_frame_ahead (ustring filename, const std::atomic<bool> &stop)
+{
+    ImageCache *imagecache = ImageCache::create (true);
+    ImageSpec spec;
+    if (! imagecache->get_imagespec (filename, spec))
+        return;
+    int tw = spec.tile_width ? spec.tile_width : spec.width;
+    int th = spec.tile_height ? spec.tile_height : spec.height;
+    int td = spec.tile_depth ? spec.tile_depth : spec.depth;
+    for (int z = spec.z;  z < spec.z + spec.depth;  z += td)
+        for (int y = spec.y;  y < spec.y + spec.height;  y += th)
+            for (int x = spec.x;  x < spec.x + spec.width;  x += tw) {
+                if (stop)
+                    return;
+                ImageCache::Tile *tile = imagecache->get_tile (filename, 0, 0,
+                                                               x, y, z);
+                if (! tile)
+                    return;
+                imagecache->release_tile (tile);
+            }
+}
+
+
+
+void
+ImageViewer::readahead ()
+{
+    int n = (int) m_images.size();
+    const ImageSpec *spec = curspec();
+    if (! m_play_direction || n < 2 || ! spec)
+        return;
+    // Read ahead as many frames as will fit in the cache, judging by the
+    // size of this one.
+    imagesize_t framesize = std::max (spec->image_bytes(), imagesize_t(1));
+    int nahead = (int) std::min (imagesize_t(n - 1),
+                                 imagesize_t(playbackCache->value()) * 1024 * 1024 / framesize);
+    nahead = std::max (nahead, 1);
+    // How far ahead of the playhead (in the playback direction) is a frame?
+    auto ahead = [&](int frame) {
+        return ((frame - m_current_image) * m_play_direction % n + n) % n;
+    };
+    // Forget finished reads of frames we've passed, so they'll be read
+    // again if we loop around to them.
+    for (auto i = m_readahead.begin();  i != m_readahead.end();  ) {
+        int a = ahead (i->first);
+        if ((a == 0 || a > nahead) &&
+            i->second.wait_for (std::chrono::seconds(0)) == std::future_status::ready)
+            i = m_readahead.erase (i);
+        else
+            ++i;
+    }
+    for (int a = 1;  a <= nahead;  ++a) {
+        int frame = ((m_current_image + a * m_play_direction) % n + n) % n;
+        if (m_readahead.count (frame))
+            continue;
+        ustring filename (m_images[frame]->name());
+        m_readahead[frame] = default_thread_pool()->push ([=](int /*id*/){
+            read_frame_ahead (filename, m_readahead_stop);
+        });
+    }
+}
+
+
+
 static bool
 compName (IvImage *first, IvImage *second)
 {
@@ -1727,6 +1927,7 @@ ImageViewer::closeImg()
 {
     if (m_images.empty())
         return;
+    glwin->cancel_fetches ();
     delete m_images[m_current_image];
     m_images[m_current_image] = NULL;
     m_images.erase (m_images.begin()+m_current_image);
@@ -44,6 +44,9 @@
 // included to remove std::min/std::max errors
 #include "OpenImageIO/platform.h"
 
+#include <atomic>
+#include <future>
+#include <map>
 #include <vector>
 
 #include <glew.h>
@@ -59,6 +62,7 @@
 
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/imagebuf.h"
+#include "OpenImageIO/timer.h"
 
 OIIO_NAMESPACE_USING;
 
@@ -200,6 +204,19 @@ public:
     ///
     COLOR_MODE current_color_mode (void) const { return m_color_mode; }
 
+    /// Show images through the given OCIO display and view (an empty
+    /// display means no display transform).
+    void display_transform (const std::string &display,
+                            const std::string &view) {
+        m_display = display;
+        m_view = view;
+    }
+
+    /// The OCIO display and view we show images through.
+    ///
+    const std::string &display (void) const { return m_display; }
+    const std::string &view (void) const { return m_view; }
+
     /// Return the current zoom level.  1.0 == 1:1 pixel ratio.  Positive
     /// is a "zoom in" (closer/maxify), negative is zoom out (farther/minify).
     float zoom (void) const { return m_zoom; }
@@ -301,6 +318,10 @@ private slots:
     void slideNoLoop();                 ///< Slide show without loop
     void setSlideShowDuration(int seconds); ///< Set the slide show duration in seconds
     void slideImages();                 ///< Slide show - move to next image
+    void playForward();                 ///< Flipbook - play (or stop) forward
+    void playBackward();                ///< Flipbook - play (or stop) backward
+    void stopPlayback();                ///< Flipbook - stop playing
+    void playbackTick();                ///< Flipbook - show the frame due now
     void showInfoWindow();              ///< View extended info on image
     void showPixelviewWindow();         ///< View closeup pixel view
     void editPreferences();             ///< Edit viewer preferences
@@ -322,11 +343,26 @@ private:
     void keyPressEvent (QKeyEvent *event);
     void resizeEvent (QResizeEvent *event);
     void closeEvent (QCloseEvent *event);
+    void startPlayback (int direction);
+    void readahead ();
 
     QTimer *slideTimer;          ///< Timer to use for slide show mode
     long slideDuration_ms;       ///< Slide show mode duration (in ms)
     bool slide_loop;             ///< Do we loop when in slide mode?
 
+    // Flipbook playback.  Frames are shown when the clock says they're
+    // due, skipping (and counting) any we're too slow for.  Frames ahead
+    // of the playhead are read into the ImageCache in the background.
+    QTimer *playbackTimer;       ///< Ticks faster than the frame rate
+    int m_play_direction;        ///< 1 forward, -1 backward, 0 stopped
+    Timer m_play_clock;          ///< Time since playback started
+    int m_play_start_frame;      ///< Frame we started playing from
+    long m_play_step;            ///< Frames played since the start
+    int m_play_shown;            ///< Frames actually shown
+    int m_play_dropped;          ///< Frames skipped to keep up
+    std::map<int,std::future<void>> m_readahead; ///< Frames being read ahead
+    std::atomic<bool> m_readahead_stop;          ///< Tell readahead to quit
+
     IvGL *glwin;
     IvInfoWindow *infoWindow;
     IvPreferenceWindow *preferenceWindow;
@@ -361,12 +397,14 @@ private:
     QAction *sortByNameAct, *sortByPathAct, *sortReverseAct;
     QAction *sortByImageDateAct, *sortByFileDateAct;
     QAction *slideShowAct, *slideLoopAct, *slideNoLoopAct;
+    QAction *playForwardAct, *playBackwardAct, *stopPlaybackAct;
     QAction *showInfoWindowAct;
     QAction *editPreferencesAct;
     QAction *showPixelviewWindowAct;
     QMenu *fileMenu, *editMenu, /**imageMenu,*/ *viewMenu, *toolsMenu, *helpMenu;
     QMenu *openRecentMenu;
     QMenu *expgamMenu, *channelMenu, *colormodeMenu, *slideMenu, *sortMenu;
+    QMenu *playbackMenu;
     QLabel *statusImgInfo, *statusViewInfo;
     QProgressBar *statusProgress;
     QComboBox *mouseModeComboBox;
@@ -380,6 +418,10 @@ private:
     QSpinBox *maxMemoryIC;
     QLabel   *slideShowDurationLabel;
     QSpinBox *slideShowDuration;
+    QLabel   *playbackFpsLabel;
+    QSpinBox *playbackFps;
+    QLabel   *playbackCacheLabel;
+    QSpinBox *playbackCache;
 
     std::vector<IvImage *> m_images;  ///< List of images
     int m_current_image;              ///< Index of current image, -1 if none
@@ -392,6 +434,8 @@ private:
     float m_default_gamma;            ///< Default gamma of the display
     QPalette m_palette;               ///< Custom palette
     bool m_darkPalette;               ///< Use dark palette?
+    std::string m_display;            ///< OCIO display ("" for none)
+    std::string m_view;               ///< OCIO view
 
     static const int m_default_width = 640; ///< The default width of the window.
     static const int m_default_height = 480; ///< The default height of the window.
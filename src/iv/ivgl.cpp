@@ -46,6 +46,10 @@
 #include "OpenImageIO/strutil.h"
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/timer.h"
+#include "OpenImageIO/thread.h"
+#include "OpenImageIO/imagecache.h"
+#include "OpenImageIO/imagebufalgo.h"
+#include "OpenImageIO/color.h"
 
 
 static const char *
@@ -64,6 +68,14 @@ gl_err_to_string (GLenum err)
 }
 
 
+static bool
+is_srgb (const ImageSpec &spec)
+{
+    return Strutil::iequals (spec.get_string_attribute ("oiio:ColorSpace"), "sRGB");
+}
+
+
+
 #define GLERRPRINT(msg)                                           \
     for (GLenum err = glGetError();  err != GL_NO_ERROR;  err = glGetError()) \
         std::cerr << "GL error " << msg << " " << (int)err <<  " - " << gl_err_to_string(err) << "\n";      \
@@ -79,7 +91,12 @@ IvGL::IvGL (QWidget *parent, ImageViewer &viewer)
       m_use_srgb(false), m_use_pbo(false), 
       m_texture_width(1), m_texture_height(1), m_last_pbo_used(0), 
       m_current_image(NULL), m_pixelview_left_corner(true),
-      m_last_texbuf_used(0)
+      m_last_texbuf_used(0), m_streaming(false), m_cancel_fetches(false),
+      m_preview_loaded(false), m_preview_tex(0),
+      m_preview_tex_width(1), m_preview_tex_height(1),
+      m_tex_valid(false), m_tex_image(NULL), m_tex_subimage(0),
+      m_tex_miplevel(0), m_tex_chbegin(0), m_tex_chend(0),
+      m_display_lut_tex(0), m_display_lut_valid(false)
 {
 #if 0
     QGLFormat format;
@@ -99,6 +116,7 @@ IvGL::IvGL (QWidget *parent, ImageViewer &viewer)
 
 IvGL::~IvGL ()
 {
+    cancel_fetches ();
 }
 
 
@@ -154,7 +172,8 @@ IvGL::create_textures (void)
         return;
 
     // FIXME: Determine this dynamically.
-    const int total_texbufs = 4;
+    // Enough to cover a large window with stream_tile_size tiles.
+    const int total_texbufs = 16;
     GLuint textures[total_texbufs];
 
     glGenTextures (total_texbufs, textures);
@@ -195,6 +214,25 @@ IvGL::create_textures (void)
     glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
+    // A 3D texture for the display transform LUT.
+    glGenTextures (1, &m_display_lut_tex);
+    glBindTexture (GL_TEXTURE_3D, m_display_lut_tex);
+    glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri (GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture (GL_TEXTURE_3D, 0);
+
+    // And one for the low-res preview of streamed images.
+    glGenTextures (1, &m_preview_tex);
+    glBindTexture (GL_TEXTURE_2D, m_preview_tex);
+    glTexImage2D (GL_TEXTURE_2D, 0, 4, 1, 1, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
     if (m_use_pbo) {
         glGenBuffersARB(2, m_pbo_objects);
         glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, m_pbo_objects[0]);
@@ -223,14 +261,31 @@ IvGL::create_shaders (void)
         "varying vec2 vTexCoord;\n"
         "uniform float gain;\n"
         "uniform float gamma;\n"
+        // startchannel is relative to the first channel in the texture,
+        // which holds texchannels of the image's imgchannels channels.
         "uniform int startchannel;\n"
         "uniform int colormode;\n"
         // Remember, if imgchannels == 2, second channel would be channel 4 (a).
         "uniform int imgchannels;\n"
+        "uniform int texchannels;\n"
         "uniform int pixelview;\n"
         "uniform int linearinterp;\n"
         "uniform int width;\n"
         "uniform int height;\n"
+        "uniform int srgbdecode;\n"
+        "uniform sampler3D displaylut;\n"
+        "uniform int usedisplaylut;\n"
+        "uniform float displaylutsize;\n"
+        "float channel (vec4 C, int i)\n"
+        "{\n"
+        "    if (i < 0 || i >= texchannels)\n"
+        "        return 0.0;\n"
+        "    if (texchannels == 2 && i == 1)\n"  // luminance-alpha texture
+        "        return C.a;\n"
+        "    float C2[4];\n"
+        "    C2[0]=C.x; C2[1]=C.y; C2[2]=C.z; C2[3]=C.w;\n"
+        "    return C2[i];\n"
+        "}\n"
         "vec4 rgba_mode (vec4 C)\n"
         "{\n"
         "    if (imgchannels <= 2) {\n"
@@ -238,7 +293,11 @@ IvGL::create_shaders (void)
         "           return vec4(C.aaa, 1.0);\n"
         "        return C.rrra;\n"
         "    }\n"
-        "    return C;\n"
+        "    float a = 1.0;\n"
+        "    if (startchannel+3 < texchannels)\n"
+        "        a = channel (C, startchannel+3);\n"
+        "    return vec4 (channel (C, startchannel), channel (C, startchannel+1),\n"
+        "                 channel (C, startchannel+2), a);\n"
         "}\n"
         "vec4 rgb_mode (vec4 C)\n"
         "{\n"
@@ -247,24 +306,22 @@ IvGL::create_shaders (void)
         "           return vec4(C.aaa, 1.0);\n"
         "        return vec4 (C.rrr, 1.0);\n"
         "    }\n"
-        "    float C2[4];\n"
-        "    C2[0]=C.x; C2[1]=C.y; C2[2]=C.z; C2[3]=C.w;\n"
-        "    return vec4 (C2[startchannel], C2[startchannel+1], C2[startchannel+2], 1.0);\n"
+        "    return vec4 (channel (C, startchannel), channel (C, startchannel+1),\n"
+        "                 channel (C, startchannel+2), 1.0);\n"
         "}\n"
         "vec4 singlechannel_mode (vec4 C)\n"
         "{\n"
-        "    float C2[4];\n"
-        "    C2[0]=C.x; C2[1]=C.y; C2[2]=C.z; C2[3]=C.w;\n"
-        "    if (startchannel > imgchannels)\n"
-        "        return vec4 (0.0,0.0,0.0,1.0);\n"
-        "    return vec4 (C2[startchannel], C2[startchannel], C2[startchannel], 1.0);\n"
+        "    float c = channel (C, startchannel);\n"
+        "    return vec4 (c, c, c, 1.0);\n"
         "}\n"
         "vec4 luminance_mode (vec4 C)\n"
         "{\n"
         "    if (imgchannels <= 2)\n"
         "        return vec4 (C.rrr, C.a);\n"
-        "    float lum = dot (C.rgb, vec3(0.2126, 0.7152, 0.0722));\n"
-        "    return vec4 (lum, lum, lum, C.a);\n"
+        "    vec3 rgb = vec3 (channel (C, startchannel), channel (C, startchannel+1),\n"
+        "                     channel (C, startchannel+2));\n"
+        "    float lum = dot (rgb, vec3(0.2126, 0.7152, 0.0722));\n"
+        "    return vec4 (lum, lum, lum, 1.0);\n"
         "}\n"
         "float heat_red(float x)\n"
         "{\n"
@@ -278,12 +335,13 @@ IvGL::create_shaders (void)
         "}\n"
         "vec4 heatmap_mode (vec4 C)\n"
         "{\n"
-        "    float C2[4];\n"
-        "    C2[0]=C.x; C2[1]=C.y; C2[2]=C.z; C2[3]=C.w;\n"
-        "    return vec4(heat_red(C2[startchannel]),\n"
-        "                heat_green(C2[startchannel]),\n"
-        "                heat_red(1.0-C2[startchannel]),\n"
-        "                1.0);\n"
+        "    float c = channel (C, startchannel);\n"
+        "    return vec4(heat_red(c), heat_green(c), heat_red(1.0-c), 1.0);\n"
+        "}\n"
+        "vec3 srgb_to_linear (vec3 c)\n"
+        "{\n"
+        "    vec3 hi = pow (max ((c + 0.055) / 1.055, 0.0), vec3 (2.4));\n"
+        "    return mix (c / 12.92, hi, step (vec3 (0.04045), c));\n"
         "}\n"
         "void main ()\n"
         "{\n"
@@ -305,6 +363,8 @@ IvGL::create_shaders (void)
         "        }\n"
         "    }\n"
         "    vec4 C = texture2D (imgtex, st);\n"
+        "    if (srgbdecode != 0)\n"
+        "        C.rgb = srgb_to_linear (C.rgb);\n"
         "    C = mix (C, vec4(0.05,0.05,0.05,1.0), black);\n"
         "    if (startchannel < 0)\n"
         "        C = vec4(0.0,0.0,0.0,1.0);\n"
@@ -321,6 +381,13 @@ IvGL::create_shaders (void)
         "    if (pixelview != 0)\n"
         "        C.a = 1.0;\n"
         "    C.xyz *= gain;\n"
+        // Display transform baked into a 3D LUT over [0,1], sampled at
+        // texel centers.
+        "    if (usedisplaylut != 0) {\n"
+        "        vec3 lutst = clamp (C.xyz, 0.0, 1.0) * ((displaylutsize - 1.0) / displaylutsize)\n"
+        "                     + 0.5 / displaylutsize;\n"
+        "        C.xyz = texture3D (displaylut, lutst).xyz;\n"
+        "    }\n"
         "    float invgamma = 1.0/gamma;\n"
         "    C.xyz = pow (C.xyz, vec3 (invgamma, invgamma, invgamma));\n"
         "    gl_FragColor = C;\n"
@@ -646,9 +713,22 @@ IvGL::paintGL ()
     m_viewer.statusViewInfo->hide ();
     m_viewer.statusProgress->show ();
 
-    // FIXME: change the code path so we can take full advantage of async DMA
-    // when using PBO.
-    for (int ystart = ybegin ; ystart < yend; ystart += m_texture_height) {
+    // Streamed images: if the preview has at least as much detail as the
+    // window can show at this zoom, the full resolution tiles are not
+    // needed at all.
+    bool preview_only = false;
+    if (m_streaming && preview_ready ()) {
+        preview_only = (z * spec.width <= m_preview->width &&
+                        z * spec.height <= m_preview->height);
+    }
+    std::vector<ROI> missing;  // Streamed tiles that haven't arrived yet
+    if (preview_only)
+        missing.push_back (ROI (spec.x, spec.x+spec.width,
+                                spec.y, spec.y+spec.height));
+    for (auto&& f : m_pending)
+        f->wanted = false;
+
+    for (int ystart = ybegin ; ystart < yend && ! preview_only; ystart += m_texture_height) {
         for (int xstart = xbegin ; xstart < xend; xstart += m_texture_width) {
             int tile_width = std::min (xend - xstart, m_texture_width);
             int tile_height = std::min (yend - ystart, m_texture_height);
@@ -658,16 +738,37 @@ IvGL::paintGL ()
             //std::cerr << "xstart: " << xstart << ". ystart: " << ystart << "\n";
             //std::cerr << "tile_width: " << tile_width << ". tile_height: " << tile_height << "\n";
 
-            // FIXME: This can get too slow. Some ideas: avoid sending the tex
-            // images more than necessary, figure an optimum texture size, use
-            // multiple texture objects.
-            load_texture (xstart, ystart, tile_width, tile_height, percent);
+            if (m_streaming) {
+                if (! load_texture_async (xstart, ystart, tile_width, tile_height)) {
+                    missing.push_back (ROI (xstart, xstart+tile_width,
+                                            ystart, ystart+tile_height));
+                    continue;
+                }
+            } else {
+                load_texture (xstart, ystart, tile_width, tile_height, percent);
+            }
             gl_rect (xstart, ystart, xstart+tile_width, ystart+tile_height, 0,
                      smin, tmin, smax, tmax);
             percent += tile_advance;
         }
     }
 
+    // Stand in for the tiles we're still waiting on with the matching part
+    // of the preview.
+    if (! missing.empty() && preview_ready ()) {
+        useshader (m_preview_tex_width, m_preview_tex_height);
+        glBindTexture (GL_TEXTURE_2D, m_preview_tex);
+        float sscale = float(m_preview->width) / (m_preview_tex_width * spec.width);
+        float tscale = float(m_preview->height) / (m_preview_tex_height * spec.height);
+        for (auto&& r : missing) {
+            gl_rect (r.xbegin, r.ybegin, r.xend, r.yend, 0,
+                     (r.xbegin - spec.x) * sscale, (r.ybegin - spec.y) * tscale,
+                     (r.xend - spec.x) * sscale, (r.yend - spec.y) * tscale);
+        }
+    }
+    if (m_streaming)
+        retire_fetches ();
+
     glPopMatrix ();
 
     if (m_viewer.pixelviewOn()) {
@@ -704,26 +805,6 @@ IvGL::shadowed_text (float x, float y, float z, const std::string &s,
 
 
 
-static int
-num_channels (int current_channel, int nchannels, ImageViewer::COLOR_MODE color_mode)
-{
-    switch (color_mode) {
-    case ImageViewer::RGBA:
-        return clamp (nchannels-current_channel, 0, 4);
-    case ImageViewer::RGB:
-    case ImageViewer::LUMINANCE:
-        return clamp (nchannels-current_channel, 0, 3);
-        break;
-    case ImageViewer::SINGLE_CHANNEL:
-    case ImageViewer::HEATMAP:
-        return 1;
-    default:
-        return nchannels;
-    }
-}
-
-
-
 void
 IvGL::paint_pixelview ()
 {
@@ -807,25 +888,16 @@ IvGL::paint_pixelview ()
         //std::cerr << "tex (" << smin << "," << tmin << ") - (" << smax << "," << tmax << ")\n";
         //std::cerr << "center mouse (" << xp << "," << yp << "), real (" << real_xp << "," << real_yp << ")\n";
 
-        int nchannels = img->nchannels();
-        // For simplicity, we don't support more than 4 channels without shaders
-        // (yet).
-        if (m_use_shaders) {
-            nchannels = num_channels(m_viewer.current_channel(), nchannels, m_viewer.current_color_mode());
-        }
+        int chbegin, chend;
+        texture_channels (img, chbegin, chend);
+        int nchannels = chend - chbegin;
+        TypeDesc format = texture_format (spec);
 
-        void *zoombuffer = alloca ((xend-xbegin)*(yend-ybegin)*nchannels*spec.channel_bytes());
-        if (! m_use_shaders) {
-            img->get_pixels (ROI (spec.x + xbegin, spec.x + xend,
-                                  spec.y + ybegin, spec.y + yend),
-                             spec.format, zoombuffer);
-        } else {
-            ROI roi (spec.x + xbegin, spec.x + xend,
-                     spec.y + ybegin, spec.y + yend,
-                     0, 1,
-                     m_viewer.current_channel(), m_viewer.current_channel()+nchannels);
-            img->get_pixels (roi, spec.format, zoombuffer);
-        }
+        void *zoombuffer = alloca ((xend-xbegin)*(yend-ybegin)*nchannels*format.size());
+        ROI roi (spec.x + xbegin, spec.x + xend,
+                 spec.y + ybegin, spec.y + yend,
+                 0, 1, chbegin, chend);
+        img->get_pixels (roi, format, zoombuffer);
 
         GLenum glformat, gltype, glinternalformat;
         typespec_to_opengl (spec, nchannels, gltype, glformat, glinternalformat);
@@ -932,8 +1004,12 @@ IvGL::useshader (int tex_width, int tex_height, bool pixelview)
 
     if (!m_use_shaders) {
         glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-        for (auto&& tb : m_texbufs) {
-            glBindTexture (GL_TEXTURE_2D, tb.tex_object);
+        std::vector<GLuint> textures;
+        for (auto&& tb : m_texbufs)
+            textures.push_back (tb.tex_object);
+        textures.push_back (m_preview_tex);
+        for (auto tex : textures) {
+            glBindTexture (GL_TEXTURE_2D, tex);
             if (m_viewer.linearInterpolation ()) {
                 glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
                 glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -953,12 +1029,33 @@ IvGL::useshader (int tex_width, int tex_height, bool pixelview)
 
     GLint loc;
 
+    int chbegin, chend;
+    texture_channels (img, chbegin, chend);
     loc = gl_get_uniform_location ("startchannel");
     if (m_viewer.current_channel()>=spec.nchannels) {
         gl_uniform (loc, -1);
         return;
     }
-    gl_uniform (loc, 0);
+    gl_uniform (loc, m_viewer.current_channel() - chbegin);
+
+    loc = gl_get_uniform_location ("texchannels");
+    gl_uniform (loc, chend - chbegin);
+
+    // Without sRGB texture support, the shader does the decoding.
+    loc = gl_get_uniform_location ("srgbdecode");
+    gl_uniform (loc, int (! m_use_srgb && is_srgb (spec)));
+
+    loc = gl_get_uniform_location ("usedisplaylut");
+    gl_uniform (loc, int (m_display_lut_valid));
+    if (m_display_lut_valid) {
+        loc = gl_get_uniform_location ("displaylut");
+        gl_uniform (loc, 1);  // texture unit
+        loc = gl_get_uniform_location ("displaylutsize");
+        gl_uniform (loc, float (display_lut_size));
+        glActiveTexture (GL_TEXTURE1);
+        glBindTexture (GL_TEXTURE_3D, m_display_lut_tex);
+        glActiveTexture (GL_TEXTURE0);
+    }
 
     loc = gl_get_uniform_location ("imgtex");
     // This is the texture unit, not the texture object
@@ -998,32 +1095,50 @@ void
 IvGL::update ()
 {
     //std::cerr << "update image\n";
-    
+
     IvImage* img = m_viewer.cur();
     if (! img) {
+        cancel_fetches ();
         m_current_image = NULL;
         return;
     }
 
     const ImageSpec &spec (img->spec());
+    update_display_lut (spec);
 
-    int nchannels = img->nchannels();
-    // For simplicity, we don't support more than 4 channels without shaders
-    // (yet).
-    if (m_use_shaders) {
-        nchannels = num_channels(m_viewer.current_channel(), nchannels, m_viewer.current_color_mode());
+    int chbegin, chend;
+    texture_channels (img, chbegin, chend);
+    int nchannels = chend - chbegin;
+    if (! nchannels) {
+        cancel_fetches ();
+        return; // Don't bother, the shader will show blackness for us.
     }
 
-    if (! nchannels)
-        return; // Don't bother, the shader will show blackness for us.
+    // If the textures already hold these channels of this image, there's
+    // nothing to do: exposure, gamma and the channel view are all applied
+    // by the shader.
+    if (m_use_shaders && m_tex_valid && img == m_current_image && img == m_tex_image
+          && img->subimage() == m_tex_subimage
+          && img->miplevel() == m_tex_miplevel
+          && chbegin == m_tex_chbegin && chend == m_tex_chend)
+        return;
+
+    // Whatever is still being fetched is for the old state of the image.
+    cancel_fetches ();
 
     GLenum gltype = GL_UNSIGNED_BYTE;
     GLenum glformat = GL_RGB;
     GLenum glinternalformat = GL_RGB;
     typespec_to_opengl (spec, nchannels, gltype, glformat, glinternalformat);
 
-    m_texture_width = clamp (pow2roundup(spec.width), 1, m_max_texture_size);
-    m_texture_height= clamp (pow2roundup(spec.height), 1, m_max_texture_size);
+    // Huge images are streamed in modest tiles, so that no single tile
+    // keeps the user waiting long.
+    m_streaming = (spec.image_pixels() > stream_min_pixels);
+    int max_tile = m_max_texture_size;
+    if (m_streaming)
+        max_tile = std::min (max_tile, (int)stream_tile_size);
+    m_texture_width = clamp (pow2roundup(spec.width), 1, max_tile);
+    m_texture_height= clamp (pow2roundup(spec.height), 1, max_tile);
 
     if (m_use_pbo) {
         // Otherwise OpenGL will confuse the NULL with an index into one of
@@ -1052,8 +1167,17 @@ IvGL::update ()
     GLERRPRINT ("Setting up pixelview texture");
 
     // Resize the buffer at once, rather than create one each drawing.
-    m_tex_buffer.resize (m_texture_width * m_texture_height * nchannels * spec.channel_bytes());
+    m_tex_buffer.resize (m_texture_width * m_texture_height * nchannels * texture_format(spec).size());
     m_current_image = img;
+    m_tex_valid = true;
+    m_tex_image = img;
+    m_tex_subimage = img->subimage();
+    m_tex_miplevel = img->miplevel();
+    m_tex_chbegin = chbegin;
+    m_tex_chend = chend;
+
+    if (m_streaming)
+        start_preview_fetch ();
 }
 
 
@@ -1446,7 +1570,8 @@ void
 IvGL::typespec_to_opengl (const ImageSpec &spec, int nchannels, GLenum &gltype, GLenum &glformat, 
                           GLenum &glinternalformat) const
 {
-    switch (spec.format.basetype) {
+    TypeDesc format = texture_format (spec);
+    switch (format.basetype) {
     case TypeDesc::FLOAT  : gltype = GL_FLOAT;          break;
     case TypeDesc::HALF   : if (m_use_halffloat) {
                                 gltype = GL_HALF_FLOAT_ARB;
@@ -1471,75 +1596,75 @@ IvGL::typespec_to_opengl (const ImageSpec &spec, int nchannels, GLenum &gltype,
         break;
     }
 
-    bool issrgb = Strutil::iequals (spec.get_string_attribute ("oiio:ColorSpace"), "sRGB");
-    
+    bool issrgb = is_srgb (spec);
+
     glinternalformat = nchannels;
     if (nchannels == 1) {
         glformat = GL_LUMINANCE;
         if (m_use_srgb && issrgb) {
-            if (spec.format.basetype == TypeDesc::UINT8) {
+            if (format.basetype == TypeDesc::UINT8) {
                 glinternalformat = GL_SLUMINANCE8;
             } else {
                 glinternalformat = GL_SLUMINANCE;
             }
-        } else if (spec.format.basetype == TypeDesc::UINT8) {
+        } else if (format.basetype == TypeDesc::UINT8) {
             glinternalformat = GL_LUMINANCE8;
-        } else if (spec.format.basetype == TypeDesc::UINT16) {
+        } else if (format.basetype == TypeDesc::UINT16) {
             glinternalformat = GL_LUMINANCE16;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::FLOAT) {
+        } else if (m_use_float && format.basetype == TypeDesc::FLOAT) {
             glinternalformat = GL_LUMINANCE32F_ARB;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::HALF) {
+        } else if (m_use_float && format.basetype == TypeDesc::HALF) {
             glinternalformat = GL_LUMINANCE16F_ARB;
         }
     } else if (nchannels == 2) {
         glformat = GL_LUMINANCE_ALPHA;
         if (m_use_srgb && issrgb) {
-            if (spec.format.basetype == TypeDesc::UINT8) {
+            if (format.basetype == TypeDesc::UINT8) {
                 glinternalformat = GL_SLUMINANCE8_ALPHA8;
             } else {
                 glinternalformat = GL_SLUMINANCE_ALPHA;
             }
-        } else if (spec.format.basetype == TypeDesc::UINT8) {
+        } else if (format.basetype == TypeDesc::UINT8) {
             glinternalformat = GL_LUMINANCE8_ALPHA8;
-        } else if (spec.format.basetype == TypeDesc::UINT16) {
+        } else if (format.basetype == TypeDesc::UINT16) {
             glinternalformat = GL_LUMINANCE16_ALPHA16;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::FLOAT) {
+        } else if (m_use_float && format.basetype == TypeDesc::FLOAT) {
             glinternalformat = GL_LUMINANCE_ALPHA32F_ARB;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::HALF) {
+        } else if (m_use_float && format.basetype == TypeDesc::HALF) {
             glinternalformat = GL_LUMINANCE_ALPHA16F_ARB;
         }
     } else if (nchannels == 3) {
         glformat = GL_RGB;
         if (m_use_srgb && issrgb) {
-            if (spec.format.basetype == TypeDesc::UINT8) {
+            if (format.basetype == TypeDesc::UINT8) {
                 glinternalformat = GL_SRGB8;
             } else {
                 glinternalformat = GL_SRGB;
             }
-        } else if (spec.format.basetype == TypeDesc::UINT8) {
+        } else if (format.basetype == TypeDesc::UINT8) {
             glinternalformat = GL_RGB8;
-        } else if (spec.format.basetype == TypeDesc::UINT16) {
+        } else if (format.basetype == TypeDesc::UINT16) {
             glinternalformat = GL_RGB16;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::FLOAT) {
+        } else if (m_use_float && format.basetype == TypeDesc::FLOAT) {
             glinternalformat = GL_RGB32F_ARB;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::HALF) {
+        } else if (m_use_float && format.basetype == TypeDesc::HALF) {
             glinternalformat = GL_RGB16F_ARB;
         }
     } else if (nchannels == 4) {
         glformat = GL_RGBA;
         if (m_use_srgb && issrgb) {
-            if (spec.format.basetype == TypeDesc::UINT8) {
+            if (format.basetype == TypeDesc::UINT8) {
                 glinternalformat = GL_SRGB8_ALPHA8;
             } else {
                 glinternalformat = GL_SRGB_ALPHA;
             }
-        } else if (spec.format.basetype == TypeDesc::UINT8) {
+        } else if (format.basetype == TypeDesc::UINT8) {
             glinternalformat = GL_RGBA8;
-        } else if (spec.format.basetype == TypeDesc::UINT16) {
+        } else if (format.basetype == TypeDesc::UINT16) {
             glinternalformat = GL_RGBA16;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::FLOAT) {
+        } else if (m_use_float && format.basetype == TypeDesc::FLOAT) {
             glinternalformat = GL_RGBA32F_ARB;
-        } else if (m_use_float && spec.format.basetype == TypeDesc::HALF) {
+        } else if (m_use_float && format.basetype == TypeDesc::HALF) {
             glinternalformat = GL_RGBA16F_ARB;
         }
     } else {
@@ -1570,12 +1695,9 @@ IvGL::load_texture (int x, int y, int width, int height, float percent)
     m_viewer.statusProgress->repaint ();
     setCursor (Qt::WaitCursor);
 
-    int nchannels = spec.nchannels;
-    // For simplicity, we don't support more than 4 channels without shaders
-    // (yet).
-    if (m_use_shaders) {
-        nchannels = num_channels(m_viewer.current_channel(), nchannels, m_viewer.current_color_mode());
-    }
+    int chbegin, chend;
+    texture_channels (m_current_image, chbegin, chend);
+    int nchannels = chend - chbegin;
     GLenum gltype, glformat, glinternalformat;
     typespec_to_opengl (spec, nchannels, gltype, glformat, glinternalformat);
 
@@ -1587,40 +1709,347 @@ IvGL::load_texture (int x, int y, int width, int height, float percent)
     // Copy the imagebuf pixels we need, that's the only way we can do
     // it safely since ImageBuf has a cache underneath and the whole image
     // may not be resident at once.
-    if (! m_use_shaders) {
-        m_current_image->get_pixels (ROI (x, x + width, y, y + height),
-                                     spec.format, &m_tex_buffer[0]);
-    } else {
-        m_current_image->get_pixels (ROI (x, x+width, y, y+height, 0, 1,
-                                          m_viewer.current_channel(),
-                                          m_viewer.current_channel() + nchannels),
-                                     spec.format, &m_tex_buffer[0]);
+    TypeDesc format = texture_format (spec);
+    m_current_image->get_pixels (ROI (x, x+width, y, y+height, 0, 1,
+                                      chbegin, chend),
+                                 format, &m_tex_buffer[0]);
+    upload_texture (tb.tex_object, width, height, &m_tex_buffer[0],
+                    size_t(width) * height * nchannels * format.size(),
+                    glformat, gltype);
+    m_last_texbuf_used = (m_last_texbuf_used + 1) % m_texbufs.size();
+}
+
+
+
+void
+IvGL::texture_channels (const IvImage *img, int &chbegin, int &chend) const
+{
+    chbegin = 0;
+    chend = img->nchannels();
+    // For simplicity, we don't support more than 4 channels without shaders
+    // (yet).  With shaders, images of up to 4 channels are sent whole, and
+    // the shader picks out the channels to show, so changing the channel
+    // or color mode never needs the pixels sent again.  Wider images are
+    // sent 4 channels at a time starting with the current channel.
+    if (m_use_shaders && chend > 4) {
+        chbegin = clamp (m_viewer.current_channel(), 0, chend - 1);
+        chend = std::min (chbegin + 4, chend);
     }
+}
+
+
+
+TypeDesc
+IvGL::texture_format (const ImageSpec &spec) const
+{
+    // Float images go to the GPU as half: that's plenty for display, and
+    // halves the upload bandwidth and the texture memory.
+    if (spec.format.basetype == TypeDesc::FLOAT && m_use_halffloat
+          && m_use_float)
+        return TypeDesc::HALF;
+    return spec.format;
+}
+
+
+
+void
+IvGL::upload_texture (GLuint tex, int width, int height, const void *pixels,
+                      size_t size, GLenum glformat, GLenum gltype)
+{
     if (m_use_pbo) {
+        // Let the driver DMA the pixels from the PBO to the texture
+        // without us waiting for it.
         glBindBufferARB (GL_PIXEL_UNPACK_BUFFER_ARB, 
                          m_pbo_objects[m_last_pbo_used]);
-        glBufferDataARB (GL_PIXEL_UNPACK_BUFFER_ARB, 
-                         width * height * spec.pixel_bytes(),
-                         &m_tex_buffer[0],
+        glBufferDataARB (GL_PIXEL_UNPACK_BUFFER_ARB, size, pixels,
                          GL_STREAM_DRAW_ARB);
         GLERRPRINT ("After buffer data");
         m_last_pbo_used = (m_last_pbo_used + 1) & 1;
+        // When using PBO this is the offset within the buffer.
+        pixels = NULL;
     }
 
-    // When using PBO this is the offset within the buffer.
-    void *data = 0;
-    if (! m_use_pbo)
-        data = &m_tex_buffer[0];
-
-    glBindTexture (GL_TEXTURE_2D, tb.tex_object);
+    glBindTexture (GL_TEXTURE_2D, tex);
     GLERRPRINT ("After bind texture");
     glTexSubImage2D (GL_TEXTURE_2D, 0,
                      0, 0,
                      width, height,
                      glformat, gltype,
-                     data);
+                     pixels);
     GLERRPRINT ("After loading sub image");
-    m_last_texbuf_used = (m_last_texbuf_used + 1) % m_texbufs.size();
+}
+
+
+
+bool
+IvGL::load_texture_async (int x, int y, int width, int height)
+{
+    const ImageSpec &spec = m_current_image->spec ();
+    // Find if this has already been loaded.
+    for (auto&& tb : m_texbufs) {
+        if (tb.x == x && tb.y == y && tb.width >= width && tb.height >= height) {
+            glBindTexture (GL_TEXTURE_2D, tb.tex_object);
+            return true;
+        }
+    }
+
+    int chbegin, chend;
+    texture_channels (m_current_image, chbegin, chend);
+    int nchannels = chend - chbegin;
+
+    // Is it on its way?
+    for (size_t i = 0;  i < m_pending.size();  ++i) {
+        PendingFetch &f (*m_pending[i]);
+        if (f.x != x || f.y != y || f.width < width || f.height < height)
+            continue;
+        f.wanted = true;
+        if (! f.done)
+            return false;
+        default_thread_pool()->wait_for (f.task);
+        GLenum gltype, glformat, glinternalformat;
+        typespec_to_opengl (spec, nchannels, gltype, glformat, glinternalformat);
+        TexBuffer &tb = m_texbufs[m_last_texbuf_used];
+        tb.x = f.x;
+        tb.y = f.y;
+        tb.width = f.width;
+        tb.height = f.height;
+        upload_texture (tb.tex_object, f.width, f.height, &f.pixels[0],
+                        f.pixels.size(), glformat, gltype);
+        m_last_texbuf_used = (m_last_texbuf_used + 1) % m_texbufs.size();
+        m_pending.erase (m_pending.begin() + i);
+        return true;
+    }
+
+    // Neither, so start reading it. The task only holds a raw pointer to
+    // the PendingFetch (which holds the task's future), and we never let
+    // go of a PendingFetch before its task has finished.
+    PendingFetchRef fetch = std::make_shared<PendingFetch> (x, y, width, height);
+    TypeDesc format = texture_format (spec);
+    fetch->pixels.resize (size_t(width) * height * nchannels * format.size());
+    PendingFetch *f = fetch.get();
+    IvImage *img = m_current_image;
+    ROI roi (x, x+width, y, y+height, 0, 1, chbegin, chend);
+    f->task = default_thread_pool()->push ([=](int /*id*/){
+        if (! m_cancel_fetches)
+            img->get_pixels (roi, format, &f->pixels[0]);
+        f->done = true;
+        QMetaObject::invokeMethod (this, "fetch_done", Qt::QueuedConnection);
+    });
+    m_pending.push_back (fetch);
+    return false;
+}
+
+
+
+void
+IvGL::start_preview_fetch ()
+{
+    int chbegin, chend;
+    texture_channels (m_current_image, chbegin, chend);
+    m_preview = std::make_shared<PendingFetch> (0, 0, 0, 0);
+    m_preview_loaded = false;
+    PendingFetch *f = m_preview.get();
+    IvImage *img = m_current_image;
+    f->task = default_thread_pool()->push ([=](int /*id*/){
+        fetch_preview (img, chbegin, chend, *f);
+        f->done = true;
+        QMetaObject::invokeMethod (this, "fetch_done", Qt::QueuedConnection);
+    });
+}
+
+
+
+void
+IvGL::fetch_preview (IvImage *img, int chbegin, int chend,
+                     PendingFetch &preview)
+{
+    const ImageSpec &spec (img->spec());
+    TypeDesc format = texture_format (spec);
+    size_t pixelsize = (chend - chbegin) * format.size();
+
+    // If the file has MIP levels then the biggest one that fits the
+    // preview size can just be read through the ImageCache.
+    ImageCache *imagecache = img->imagecache();
+    if (imagecache && img->nmiplevels() > 1) {
+        ustring name (img->name());
+        int subimage = std::max (0, img->subimage());
+        for (int m = std::max (0, img->miplevel()) + 1;
+             m < img->nmiplevels();  ++m) {
+            ImageSpec mipspec;
+            if (! imagecache->get_imagespec (name, mipspec, subimage, m))
+                break;
+            if (mipspec.width > preview_size || mipspec.height > preview_size)
+                continue;
+            preview.width = mipspec.width;
+            preview.height = mipspec.height;
+            preview.pixels.resize (mipspec.image_pixels() * pixelsize);
+            if (imagecache->get_pixels (name, subimage, m,
+                                        mipspec.x, mipspec.x+mipspec.width,
+                                        mipspec.y, mipspec.y+mipspec.height,
+                                        mipspec.z, mipspec.z+1,
+                                        chbegin, chend, format,
+                                        &preview.pixels[0]))
+                return;
+            break;
+        }
+    }
+
+    // Otherwise point sample every stride-th pixel of every stride-th
+    // scanline. Only those scanlines are read, which for a tiled file
+    // still means every row of tiles, but it's done in the background.
+    int stride = std::max ((spec.width + preview_size - 1) / preview_size,
+                           (spec.height + preview_size - 1) / preview_size);
+    preview.width = (spec.width + stride - 1) / stride;
+    preview.height = (spec.height + stride - 1) / stride;
+    preview.pixels.resize (size_t(preview.width) * preview.height * pixelsize);
+    std::vector<unsigned char> scanline (spec.width * pixelsize);
+    for (int j = 0;  j < preview.height && ! m_cancel_fetches;  ++j) {
+        int y = spec.y + j * stride;
+        img->get_pixels (ROI (spec.x, spec.x+spec.width, y, y+1,
+                              spec.z, spec.z+1, chbegin, chend),
+                         format, &scanline[0]);
+        unsigned char *p = &preview.pixels[j * preview.width * pixelsize];
+        for (int i = 0;  i < preview.width;  ++i, p += pixelsize)
+            memcpy (p, &scanline[i * stride * pixelsize], pixelsize);
+    }
+}
+
+
+
+bool
+IvGL::preview_ready ()
+{
+    if (m_preview_loaded)
+        return true;
+    if (! m_preview || ! m_preview->done)
+        return false;
+    default_thread_pool()->wait_for (m_preview->task);
+
+    int chbegin, chend;
+    texture_channels (m_current_image, chbegin, chend);
+    GLenum gltype, glformat, glinternalformat;
+    typespec_to_opengl (m_current_image->spec(), chend - chbegin,
+                        gltype, glformat, glinternalformat);
+    m_preview_tex_width = pow2roundup (m_preview->width);
+    m_preview_tex_height = pow2roundup (m_preview->height);
+    if (m_use_pbo)
+        glBindBufferARB (GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+    glBindTexture (GL_TEXTURE_2D, m_preview_tex);
+    glTexImage2D (GL_TEXTURE_2D, 0, glinternalformat,
+                  m_preview_tex_width, m_preview_tex_height, 0,
+                  glformat, gltype, NULL);
+    GLERRPRINT ("Setting up preview texture");
+    upload_texture (m_preview_tex, m_preview->width, m_preview->height,
+                    &m_preview->pixels[0], m_preview->pixels.size(),
+                    glformat, gltype);
+    // Only the dimensions are needed from now on.
+    std::vector<unsigned char>().swap (m_preview->pixels);
+    m_preview_loaded = true;
+    return true;
+}
+
+
+
+void
+IvGL::retire_fetches ()
+{
+    for (size_t i = 0;  i < m_pending.size();  ) {
+        PendingFetch &f (*m_pending[i]);
+        if (f.done && ! f.wanted) {
+            default_thread_pool()->wait_for (f.task);
+            m_pending.erase (m_pending.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+
+
+void
+IvGL::cancel_fetches ()
+{
+    m_cancel_fetches = true;
+    for (auto&& f : m_pending)
+        default_thread_pool()->wait_for (f->task);
+    m_pending.clear ();
+    if (m_preview)
+        default_thread_pool()->wait_for (m_preview->task);
+    m_preview.reset ();
+    m_preview_loaded = false;
+    m_cancel_fetches = false;
+    m_tex_valid = false;
+}
+
+
+
+void
+IvGL::update_display_lut (const ImageSpec &spec)
+{
+    // The texture is already linear if OpenGL (or the shader) decoded the
+    // sRGB, otherwise it's in whatever space the file says it is.
+    std::string colorspace = spec.get_string_attribute ("oiio:ColorSpace");
+    if (colorspace.empty() || is_srgb (spec))
+        colorspace = "linear";
+    std::string key;
+    if (m_use_shaders && m_viewer.display().size())
+        key = m_viewer.display() + "/" + m_viewer.view() + "/" + colorspace;
+    if (key == m_display_lut_key)
+        return;
+    m_display_lut_key = key;
+    m_display_lut_valid = false;
+    if (key.empty())
+        return;
+
+    // Building the config is expensive, so do it just once.
+    static ColorConfig colorconfig;
+    std::string view = m_viewer.view();
+    if (view.empty() && colorconfig.getDefaultViewName (m_viewer.display()))
+        view = colorconfig.getDefaultViewName (m_viewer.display());
+    ColorProcessor *processor =
+        colorconfig.createDisplayTransform (m_viewer.display(), view,
+                                            colorspace);
+    if (! processor) {
+        std::cerr << "iv: can't make a display transform for "
+                  << m_viewer.display() << "/" << view
+                  << " from " << colorspace << ": "
+                  << colorconfig.geterror() << "\n";
+        return;
+    }
+
+    // Run a lattice of colors through the processor, one 2D slice of the
+    // cube after another, so it's laid out just as glTexImage3D wants.
+    const int n = display_lut_size;
+    std::vector<float> lut (n * n * n * 3);
+    for (int b = 0, i = 0;  b < n;  ++b)
+        for (int g = 0;  g < n;  ++g)
+            for (int r = 0;  r < n;  ++r, i += 3) {
+                lut[i+0] = float(r) / (n-1);
+                lut[i+1] = float(g) / (n-1);
+                lut[i+2] = float(b) / (n-1);
+            }
+    ImageBuf lattice (ImageSpec (n, n * n, 3, TypeDesc::FLOAT), &lut[0]);
+    bool ok = ImageBufAlgo::colorconvert (lattice, lattice, processor, false);
+    ColorConfig::deleteColorProcessor (processor);
+    if (! ok)
+        return;
+
+    if (m_use_pbo)
+        glBindBufferARB (GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+    glBindTexture (GL_TEXTURE_3D, m_display_lut_tex);
+    glTexImage3D (GL_TEXTURE_3D, 0, m_use_float ? GL_RGB16F_ARB : GL_RGB8,
+                  n, n, n, 0, GL_RGB, GL_FLOAT, &lut[0]);
+    GLERRPRINT ("Setting up display LUT");
+    glBindTexture (GL_TEXTURE_3D, 0);
+    m_display_lut_valid = true;
+}
+
+
+
+void
+IvGL::fetch_done ()
+{
+    trigger_redraw ();
 }
 
 
@@ -44,6 +44,9 @@
 // included to remove std::min/std::max errors
 #include "OpenImageIO/platform.h"
 
+#include <atomic>
+#include <future>
+#include <memory>
 #include <vector>
 
 #include <QGLWidget>
@@ -124,6 +127,16 @@ public:
     void typespec_to_opengl (const ImageSpec& spec, int nchannels, GLenum &gltype,
                              GLenum &glformat, GLenum &glinternal) const;
 
+    /// Stop all background reads of the current image's pixels and throw
+    /// away whatever they fetched.  This must be called before the image
+    /// being displayed is re-read, changed, or deleted.
+    void cancel_fetches ();
+
+private slots:
+    /// Called on the GUI thread whenever a background fetch finishes, so
+    /// that the newly arrived pixels get drawn.
+    void fetch_done ();
+
 protected:
     ImageViewer &m_viewer;            ///< Backpointer to viewer
     bool m_shaders_created;           ///< Have the shaders been created?
@@ -166,6 +179,38 @@ protected:
     };
     std::vector<TexBuffer> m_texbufs;
     int m_last_texbuf_used;
+
+    /// A patch of the image whose pixels are being read in the background.
+    ///
+    struct PendingFetch {
+        int x, y, width, height;
+        std::vector<unsigned char> pixels;
+        std::atomic<bool> done;       ///< Set by the task when pixels are in
+        bool wanted;                  ///< Visible in the last redraw?
+        std::future<void> task;
+        PendingFetch (int x, int y, int width, int height)
+            : x(x), y(y), width(width), height(height), done(false),
+              wanted(true) { }
+    };
+    typedef std::shared_ptr<PendingFetch> PendingFetchRef;
+    bool m_streaming;                 ///< Fetch tiles in the background?
+    std::vector<PendingFetchRef> m_pending; ///< Tiles being fetched
+    std::atomic<bool> m_cancel_fetches;     ///< Tell fetches to give up
+    PendingFetchRef m_preview;        ///< Low-res version of whole image
+    bool m_preview_loaded;            ///< Is m_preview_tex up to date?
+    GLuint m_preview_tex;             ///< Texture holding the preview
+    int m_preview_tex_width, m_preview_tex_height;
+
+    // What's in the texture buffers, so that update() can tell when they
+    // have to be reloaded.
+    bool m_tex_valid;                 ///< Are the m_tex_* fields current?
+    IvImage *m_tex_image;             ///< Image they came from
+    int m_tex_subimage, m_tex_miplevel;
+    int m_tex_chbegin, m_tex_chend;   ///< Image channels they hold
+
+    GLuint m_display_lut_tex;         ///< 3D texture of display transform
+    bool m_display_lut_valid;         ///< Should the shader use it?
+    std::string m_display_lut_key;    ///< display/view/colorspace it's for
     bool m_mouse_activation;          ///< Can we expect the window to be activated by mouse?
 
 
@@ -204,6 +249,15 @@ private:
     /// closeuptexsize is the size of the texture used to upload the pixelview
     /// to OpenGL.
     const static int closeuptexsize = 16;
+    /// Images with more pixels than stream_min_pixels are shown with
+    /// tiles of no more than stream_tile_size pixels on a side, fetched
+    /// in the background, with a preview of at most preview_size pixels
+    /// on a side shown until they arrive.
+    const static imagesize_t stream_min_pixels = 2048 * 2048;
+    const static int stream_tile_size = 1024;
+    const static int preview_size = 1024;
+    /// Resolution of the display transform LUT in each dimension.
+    const static int display_lut_size = 32;
 
     void clamp_view_to_window ();
 
@@ -224,6 +278,40 @@ private:
     /// Loads the given patch of the image, but first figures if it's already
     /// been loaded.
     void load_texture (int x, int y, int width, int height, float percent);
+
+    /// Like load_texture, but the pixels are read on a worker thread. The
+    /// first call for a patch starts the fetch and returns false; a later
+    /// call uploads the patch if it has arrived and returns true.
+    bool load_texture_async (int x, int y, int width, int height);
+
+    /// Start reading a low-resolution preview of the whole image in the
+    /// background, from a MIP level if there is one, otherwise by point
+    /// sampling the full resolution image.
+    void start_preview_fetch ();
+    void fetch_preview (IvImage *img, int chbegin, int chend,
+                        PendingFetch &preview);
+
+    /// Upload the preview to m_preview_tex if it has arrived since the
+    /// last redraw. Return true if the preview texture is ready to draw.
+    bool preview_ready ();
+
+    /// Throw away fetched tiles that weren't visible in the last redraw.
+    void retire_fetches ();
+
+    /// Which image channels go into the texture.
+    void texture_channels (const IvImage *img, int &chbegin, int &chend) const;
+
+    /// The data type of the pixels we send to OpenGL for this image.
+    TypeDesc texture_format (const ImageSpec &spec) const;
+
+    /// Make sure the display transform LUT is the one for the viewer's
+    /// current OCIO display and view, and the color space of spec.
+    void update_display_lut (const ImageSpec &spec);
+
+    /// Send pixels to texture tex, through a PBO if we can.
+    void upload_texture (GLuint tex, int width, int height,
+                         const void *pixels, size_t size,
+                         GLenum glformat, GLenum gltype);
     
     /// Destroys shaders and selects fixed-function pipeline
     void create_shaders_abort (void);
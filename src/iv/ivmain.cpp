@@ -60,6 +60,7 @@ OIIO_NAMESPACE_USING;
 static bool verbose = false;
 static bool foreground_mode = false;
 static std::vector<std::string> filenames;
+static std::string display, view;
 
 
 
@@ -85,6 +86,8 @@ getargs (int argc, char *argv[])
                   "--help", &help, "Print help message",
                   "-v", &verbose, "Verbose status messages",
                   "-F", &foreground_mode, "Foreground mode",
+                  "--display %s", &display, "OCIO display to view images through",
+                  "--view %s", &view, "OCIO view (used with --display)",
                   NULL);
     if (ap.parse (argc, (const char**)argv) < 0) {
         std::cerr << ap.geterror() << std::endl;
@@ -121,6 +124,7 @@ main (int argc, char *argv[])
 //    Q_INIT_RESOURCE(iv);
     QApplication app(argc, argv);
     ImageViewer *mainWin = new ImageViewer;
+    mainWin->display_transform (display, view);
     mainWin->show();
 
     // Set up the imagecache with parameters that make sense for iv
@@ -64,8 +64,18 @@ IvPreferenceWindow::IvPreferenceWindow (ImageViewer &viewer)
     slideShowLayout->addWidget (viewer.slideShowDurationLabel);
     slideShowLayout->addWidget (viewer.slideShowDuration);
 
+    QLayout *playbackFpsLayout = new QHBoxLayout;
+    playbackFpsLayout->addWidget (viewer.playbackFpsLabel);
+    playbackFpsLayout->addWidget (viewer.playbackFps);
+
+    QLayout *playbackCacheLayout = new QHBoxLayout;
+    playbackCacheLayout->addWidget (viewer.playbackCacheLabel);
+    playbackCacheLayout->addWidget (viewer.playbackCache);
+
     layout->addLayout (inner_layout);
     layout->addLayout (slideShowLayout);
+    layout->addLayout (playbackFpsLayout);
+    layout->addLayout (playbackCacheLayout);
     layout->addWidget (closeButton);
     setLayout (layout);
 
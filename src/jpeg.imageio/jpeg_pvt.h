@@ -76,7 +76,8 @@ class JpgInput : public ImageInput {
     virtual const char * format_name (void) const { return "jpeg"; }
     virtual int supports (string_view feature) const {
         return (feature == "exif"
-             || feature == "iptc");
+             || feature == "iptc"
+             || feature == "ioproxy");
     }
     virtual bool valid_file (const std::string &filename) const;
     virtual bool open (const std::string &name, ImageSpec &spec);
@@ -98,11 +99,14 @@ class JpgInput : public ImageInput {
 
  private:
     FILE *m_fd;
+    Filesystem::IOProxy *m_io;  // Caller's I/O proxy, if any
     std::string m_filename;
     int m_next_scanline;      // Which scanline is the next to read?
     bool m_raw;               // Read raw coefficients, not scanlines
+    int m_scale;              // Decode at 1/m_scale resolution (1,2,4,8)
     bool m_cmyk;              // The input file is cmyk
     bool m_fatalerr;          // JPEG reader hit a fatal error
+    bool m_defer_metadata;    // Keep Exif/XMP/IPTC blocks undecoded
     struct jpeg_decompress_struct m_cinfo;
     my_error_mgr m_jerr;
     jvirt_barray_ptr *m_coeffs;
@@ -110,9 +114,12 @@ class JpgInput : public ImageInput {
 
     void init () {
         m_fd = NULL;
+        m_io = NULL;
         m_raw = false;
+        m_scale = 1;
         m_cmyk = false;
         m_fatalerr = false;
+        m_defer_metadata = false;
         m_coeffs = NULL;
         m_jerr.jpginput = this;
     }
@@ -137,6 +144,15 @@ class JpgInput : public ImageInput {
 
 
 
+// Point a decompressor or compressor at a Filesystem::IOProxy instead
+// of a FILE*, analogous to jpeg_stdio_src/jpeg_stdio_dest.  The write
+// side sets *failed if the proxy doesn't take all the bytes.
+void jpeg_proxy_src (j_decompress_ptr cinfo, Filesystem::IOProxy *io);
+void jpeg_proxy_dest (j_compress_ptr cinfo, Filesystem::IOProxy *io,
+                      bool *failed);
+
+
+
 OIIO_PLUGIN_NAMESPACE_END
 
 
@@ -64,6 +64,9 @@ OIIO_PLUGIN_EXPORTS_BEGIN
     OIIO_EXPORT const char *jpeg_input_extensions[] = {
         "jpg", "jpe", "jpeg", "jif", "jfif", "jfi", NULL
     };
+    OIIO_EXPORT const char *jpeg_input_magic[] = {
+        "ffd8ff", NULL
+    };
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -147,6 +150,84 @@ JpgInput::jpegerror (my_error_ptr myerr, bool fatal)
 
 
 
+// libjpeg source manager that reads through an IOProxy
+struct proxy_source_mgr {
+    struct jpeg_source_mgr pub;
+    Filesystem::IOProxy *io;
+    JOCTET buffer[4096];
+};
+
+
+
+static void
+proxy_init_source (j_decompress_ptr cinfo)
+{
+}
+
+
+
+static boolean
+proxy_fill_input_buffer (j_decompress_ptr cinfo)
+{
+    proxy_source_mgr *src = (proxy_source_mgr *) cinfo->src;
+    size_t n = src->io->read (src->buffer, sizeof(src->buffer));
+    if (n == 0) {
+        // Premature end of data: insert a fake EOI marker, as libjpeg's
+        // own stdio source manager does.
+        src->buffer[0] = (JOCTET) 0xFF;
+        src->buffer[1] = (JOCTET) JPEG_EOI;
+        n = 2;
+    }
+    src->pub.next_input_byte = src->buffer;
+    src->pub.bytes_in_buffer = n;
+    return TRUE;
+}
+
+
+
+static void
+proxy_skip_input_data (j_decompress_ptr cinfo, long num_bytes)
+{
+    proxy_source_mgr *src = (proxy_source_mgr *) cinfo->src;
+    if (num_bytes <= 0)
+        return;
+    while (num_bytes > (long) src->pub.bytes_in_buffer) {
+        num_bytes -= (long) src->pub.bytes_in_buffer;
+        proxy_fill_input_buffer (cinfo);
+    }
+    src->pub.next_input_byte += (size_t) num_bytes;
+    src->pub.bytes_in_buffer -= (size_t) num_bytes;
+}
+
+
+
+static void
+proxy_term_source (j_decompress_ptr cinfo)
+{
+}
+
+
+
+void
+jpeg_proxy_src (j_decompress_ptr cinfo, Filesystem::IOProxy *io)
+{
+    if (! cinfo->src)
+        cinfo->src = (struct jpeg_source_mgr *)
+            (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+                                        sizeof(proxy_source_mgr));
+    proxy_source_mgr *src = (proxy_source_mgr *) cinfo->src;
+    src->pub.init_source = proxy_init_source;
+    src->pub.fill_input_buffer = proxy_fill_input_buffer;
+    src->pub.skip_input_data = proxy_skip_input_data;
+    src->pub.resync_to_restart = jpeg_resync_to_restart;
+    src->pub.term_source = proxy_term_source;
+    src->pub.bytes_in_buffer = 0;
+    src->pub.next_input_byte = NULL;
+    src->io = io;
+}
+
+
+
 bool
 JpgInput::valid_file (const std::string &filename) const
 {
@@ -174,6 +255,16 @@ JpgInput::open (const std::string &name, ImageSpec &newspec,
     const ImageIOParameter *p = config.find_attribute ("_jpeg:raw",
                                                        TypeDesc::TypeInt);
     m_raw = p && *(int *)p->data();
+    p = config.find_attribute ("oiio:ioproxy", TypeDesc::PTR);
+    if (p)
+        m_io = *(Filesystem::IOProxy **)p->data();
+    // "jpeg:scale" asks for a reduced resolution decode, which libjpeg
+    // does cheaply in the DCT domain.  It supports 1/2, 1/4 and 1/8.
+    int scale = config.get_int_attribute ("jpeg:scale", 1);
+    m_scale = scale >= 8 ? 8 : scale >= 4 ? 4 : scale >= 2 ? 2 : 1;
+    // "oiio:DeferMetadata" leaves the metadata blocks for the caller to
+    // decode with decode_deferred_metadata(), if it ever wants them.
+    m_defer_metadata = config.get_int_attribute ("oiio:DeferMetadata", 0) != 0;
     return open (name, newspec);
 }
 
@@ -184,21 +275,27 @@ JpgInput::open (const std::string &name, ImageSpec &newspec)
 {
     // Check that file exists and can be opened
     m_filename = name;
-    m_fd = Filesystem::fopen (name, "rb");
-    if (m_fd == NULL) {
-        error ("Could not open file \"%s\"", name.c_str());
-        return false;
+    if (! m_io) {
+        m_fd = Filesystem::fopen (name, "rb");
+        if (m_fd == NULL) {
+            error ("Could not open file \"%s\"", name.c_str());
+            return false;
+        }
     }
 
     // Check magic number to assure this is a JPEG file
     uint8_t magic[2] = {0, 0};
-    if (fread (magic, sizeof(magic), 1, m_fd) != 1) {
+    if (m_io ? (! m_io->seek (0) || m_io->read (magic, sizeof(magic)) != sizeof(magic))
+             : (fread (magic, sizeof(magic), 1, m_fd) != 1)) {
         error ("Empty file \"%s\"", name.c_str());
         close_file ();
         return false;
     }
 
-    rewind (m_fd);
+    if (m_io)
+        m_io->seek (0);
+    else
+        rewind (m_fd);
     if (magic[0] != JPEG_MAGIC1 || magic[1] != JPEG_MAGIC2) {
         close_file ();
         error ("\"%s\" is not a JPEG file, magic number doesn't match (was 0x%x%x)",
@@ -220,7 +317,10 @@ JpgInput::open (const std::string &name, ImageSpec &newspec)
     }
 
     jpeg_create_decompress (&m_cinfo);          // initialize decompressor
-    jpeg_stdio_src (&m_cinfo, m_fd);            // specify the data source
+    if (m_io)                                   // specify the data source
+        jpeg_proxy_src (&m_cinfo, m_io);
+    else
+        jpeg_stdio_src (&m_cinfo, m_fd);
 
     // Request saving of EXIF and other special tags for later spelunking
     for (int mark = 0;  mark < 16;  ++mark)
@@ -243,6 +343,11 @@ JpgInput::open (const std::string &name, ImageSpec &newspec)
         m_cmyk = true;
     }
 
+    if (m_scale > 1 && ! m_raw) {
+        m_cinfo.scale_num = 1;
+        m_cinfo.scale_denom = m_scale;
+    }
+
     if (m_raw)
         m_coeffs = jpeg_read_coefficients (&m_cinfo);
     else
@@ -257,6 +362,9 @@ JpgInput::open (const std::string &name, ImageSpec &newspec)
     // Assume JPEG is in sRGB unless the Exif or XMP tags say otherwise.
     m_spec.attribute ("oiio:ColorSpace", "sRGB");
 
+    if (m_scale > 1 && ! m_raw)
+        m_spec.attribute ("jpeg:scale", m_scale);
+
     if (m_cinfo.jpeg_color_space == JCS_CMYK)
         m_spec.attribute ("jpeg:ColorSpace", "CMYK");
     else if (m_cinfo.jpeg_color_space == JCS_YCCK)
@@ -274,13 +382,24 @@ JpgInput::open (const std::string &name, ImageSpec &newspec)
                 ! strcmp ((const char *)m->data, "Exif")) {
             // The block starts with "Exif\0\0", so skip 6 bytes to get
             // to the start of the actual Exif data TIFF directory
-            decode_exif (string_view((char *)m->data+6, m->data_length-6), m_spec);
+            if (m_defer_metadata && m->data_length > 6)
+                m_spec.attribute ("oiio:ExifData",
+                                  TypeDesc (TypeDesc::UINT8, m->data_length-6),
+                                  m->data+6);
+            else
+                decode_exif (string_view((char *)m->data+6, m->data_length-6), m_spec);
         }
         else if (m->marker == (JPEG_APP0+1) &&
                  ! strcmp ((const char *)m->data, "http://ns.adobe.com/xap/1.0/")) {
 #ifndef NDEBUG
             std::cerr << "Found APP1 XMP! length " << m->data_length << "\n";
 #endif
+            if (m_defer_metadata) {
+                m_spec.attribute ("oiio:XMPData",
+                                  TypeDesc (TypeDesc::UINT8, m->data_length),
+                                  m->data);
+                continue;
+            }
             std::string xml ((const char *)m->data, m->data_length);
             decode_xmp (xml, m_spec);
         }
@@ -417,8 +536,13 @@ JpgInput::read_native_scanline (int y, int z, void *data)
         // up to.  Easy fix: close the file and re-open.
         ImageSpec dummyspec;
         int subimage = current_subimage();
-        if (! close ()  ||
-            ! open (m_filename, dummyspec)  ||
+        int scale = m_scale;   // close() forgets these, but open() needs them
+        Filesystem::IOProxy *io = m_io;
+        if (! close ())
+            return false;
+        m_scale = scale;
+        m_io = io;
+        if (! open (m_filename, dummyspec)  ||
             ! seek_subimage (subimage, 0, dummyspec))
             return false;    // Somehow, the re-open failed
         assert (m_next_scanline == 0 && current_subimage() == subimage);
@@ -460,7 +584,7 @@ JpgInput::read_native_scanline (int y, int z, void *data)
 bool
 JpgInput::close ()
 {
-    if (m_fd != NULL) {
+    if (m_fd != NULL || m_io != NULL) {
         // unnecessary?  jpeg_abort_decompress (&m_cinfo);
         jpeg_destroy_decompress (&m_cinfo);
         close_file ();
@@ -498,6 +622,12 @@ JpgInput::jpeg_decode_iptc (const unsigned char *buf)
     int segmentsize = (buf[0] << 8) + buf[1];
     buf += 2;
 
+    if (m_defer_metadata) {
+        if (segmentsize > 0)
+            m_spec.attribute ("oiio:IPTCData",
+                              TypeDesc (TypeDesc::UINT8, segmentsize), buf);
+        return;
+    }
     decode_iptc_iim (buf, segmentsize, m_spec);
 }
 
@@ -58,7 +58,8 @@ class JpgOutput : public ImageOutput {
     virtual const char * format_name (void) const { return "jpeg"; }
     virtual int supports (string_view feature) const {
         return (feature == "exif"
-             || feature == "iptc");
+             || feature == "iptc"
+             || feature == "ioproxy");
     }
     virtual bool open (const std::string &name, const ImageSpec &spec,
                        OpenMode mode=Create);
@@ -72,6 +73,8 @@ class JpgOutput : public ImageOutput {
 
  private:
     FILE *m_fd;
+    Filesystem::IOProxy *m_io;       // Caller's I/O proxy, if any
+    bool m_io_failed;                // The proxy didn't take our bytes
     std::string m_filename;
     unsigned int m_dither;
     int m_next_scanline;             // Which scanline is the next to write?
@@ -84,6 +87,8 @@ class JpgOutput : public ImageOutput {
 
     void init (void) {
         m_fd = NULL;
+        m_io = NULL;
+        m_io_failed = false;
         m_copy_coeffs = NULL;
         m_copy_decompressor = NULL;
     }
@@ -114,6 +119,67 @@ OIIO_PLUGIN_EXPORTS_END
 
 
 
+// libjpeg destination manager that writes through an IOProxy
+struct proxy_dest_mgr {
+    struct jpeg_destination_mgr pub;
+    Filesystem::IOProxy *io;
+    bool *failed;
+    JOCTET buffer[4096];
+};
+
+
+
+static void
+proxy_init_destination (j_compress_ptr cinfo)
+{
+    proxy_dest_mgr *dest = (proxy_dest_mgr *) cinfo->dest;
+    dest->pub.next_output_byte = dest->buffer;
+    dest->pub.free_in_buffer = sizeof(dest->buffer);
+}
+
+
+
+static boolean
+proxy_empty_output_buffer (j_compress_ptr cinfo)
+{
+    proxy_dest_mgr *dest = (proxy_dest_mgr *) cinfo->dest;
+    if (dest->io->write (dest->buffer, sizeof(dest->buffer)) != sizeof(dest->buffer))
+        *dest->failed = true;
+    proxy_init_destination (cinfo);
+    return TRUE;
+}
+
+
+
+static void
+proxy_term_destination (j_compress_ptr cinfo)
+{
+    proxy_dest_mgr *dest = (proxy_dest_mgr *) cinfo->dest;
+    size_t n = sizeof(dest->buffer) - dest->pub.free_in_buffer;
+    if (n && dest->io->write (dest->buffer, n) != n)
+        *dest->failed = true;
+    dest->io->flush ();
+}
+
+
+
+void
+jpeg_proxy_dest (j_compress_ptr cinfo, Filesystem::IOProxy *io, bool *failed)
+{
+    if (! cinfo->dest)
+        cinfo->dest = (struct jpeg_destination_mgr *)
+            (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+                                        sizeof(proxy_dest_mgr));
+    proxy_dest_mgr *dest = (proxy_dest_mgr *) cinfo->dest;
+    dest->pub.init_destination = proxy_init_destination;
+    dest->pub.empty_output_buffer = proxy_empty_output_buffer;
+    dest->pub.term_destination = proxy_term_destination;
+    dest->io = io;
+    dest->failed = failed;
+}
+
+
+
 bool
 JpgOutput::open (const std::string &name, const ImageSpec &newspec,
                  OpenMode mode)
@@ -147,15 +213,24 @@ JpgOutput::open (const std::string &name, const ImageSpec &newspec,
         return false;
     }
 
-    m_fd = Filesystem::fopen (name, "wb");
-    if (m_fd == NULL) {
-        error ("Unable to open file \"%s\"", name.c_str());
-        return false;
+    const ImageIOParameter *p = m_spec.find_attribute ("oiio:ioproxy",
+                                                       TypeDesc::PTR);
+    if (p) {
+        m_io = *(Filesystem::IOProxy **)p->data();
+    } else {
+        m_fd = Filesystem::fopen (name, "wb");
+        if (m_fd == NULL) {
+            error ("Unable to open file \"%s\"", name.c_str());
+            return false;
+        }
     }
 
     m_cinfo.err = jpeg_std_error (&c_jerr);             // set error handler
     jpeg_create_compress (&m_cinfo);                    // create compressor
-    jpeg_stdio_dest (&m_cinfo, m_fd);                   // set output stream
+    if (m_io)                                           // set output stream
+        jpeg_proxy_dest (&m_cinfo, m_io, &m_io_failed);
+    else
+        jpeg_stdio_dest (&m_cinfo, m_fd);
 
     // Set image and compression parameters
     m_cinfo.image_width = m_spec.width;
@@ -391,7 +466,7 @@ JpgOutput::write_tile (int x, int y, int z, TypeDesc format,
 bool
 JpgOutput::close ()
 {
-    if (! m_fd) {         // Already closed
+    if (! m_fd && ! m_io) {         // Already closed
         return true;
         init();
     }
@@ -429,7 +504,12 @@ JpgOutput::close ()
     }
     DBG std::cout << "out close: about to destroy_compress\n";
     jpeg_destroy_compress (&m_cinfo);
-    fclose (m_fd);
+    if (m_fd)
+        fclose (m_fd);
+    if (m_io_failed) {
+        error ("Could not write all of \"%s\"", m_filename.c_str());
+        ok = false;
+    }
     m_fd = NULL;
     init();
     
@@ -177,6 +177,9 @@ OIIO_PLUGIN_EXPORTS_BEGIN
     OIIO_EXPORT const char *jpeg2000_input_extensions[] = {
         "jp2", "j2k", "j2c", NULL
     };
+    OIIO_EXPORT const char *jpeg2000_input_magic[] = {
+        "0000000c6a5020200d0a870a", "ff4fff51", NULL
+    };
 
 OIIO_PLUGIN_EXPORTS_END
 
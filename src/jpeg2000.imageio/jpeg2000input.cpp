@@ -34,6 +34,7 @@
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/imagebuf.h"
+#include "OpenImageIO/sysutil.h"
 
 
 
@@ -110,7 +111,11 @@ class Jpeg2000Input : public ImageInput {
     virtual bool open (const std::string &name, ImageSpec &newspec,
                        const ImageSpec &config);
     virtual bool close (void);
+    virtual int current_subimage (void) const { return 0; }
+    virtual int current_miplevel (void) const { return m_miplevel; }
+    virtual bool seek_subimage (int subimage, int miplevel, ImageSpec &newspec);
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_tile (int x, int y, int z, void *data);
 
  private:
 
@@ -121,9 +126,25 @@ class Jpeg2000Input : public ImageInput {
     opj_codec_t *m_codec;
     opj_stream_t *m_stream;
     bool m_keep_unassociated_alpha;   // Do not convert unassociated alpha
+    ImageSpec m_topspec;      // Spec of the full resolution image
+    std::vector<opj_image_comp_t> m_comps;  // Full res component headers
+    int m_x0, m_y0, m_x1, m_y1;             // Full res image area
+    int m_miplevel;           // Resolution level we're decoding
+    int m_nlevels;            // Number of resolution levels (MIP levels)
+    bool m_decoded;           // Has the whole level been decoded?
+    bool m_tiled;             // Can we decode tile by tile?
+    int m_tdx, m_tdy;         // Full resolution tile size
+    int m_ntiles_x;           // Number of tiles across
 
     void init (void);
 
+    // (Re)create the codec and stream, set to decode the given
+    // resolution level, and read the header into a fresh m_image.
+    bool start_decoder (int level);
+
+    // Set up the spec for a reduced resolution level.
+    void level_spec (int level, ImageSpec &spec) const;
+
     bool isJp2File(const int* const p_magicTable) const;
 
     opj_codec_t* create_decompressor();
@@ -139,6 +160,13 @@ class Jpeg2000Input : public ImageInput {
     template<typename T>
     void read_scanline(int y, int z, void *data);
 
+    template<typename T>
+    void read_tile(void *data);
+
+    void associate_alpha (void *data, int npixels);
+
+    static int ceildivpow2 (int a, int b) { return (a + (1 << b) - 1) >> b; }
+
     uint16_t baseTypeConvertU10ToU16(int src)
     {
         return (uint16_t)((src << 6) | (src >> 4));
@@ -150,9 +178,9 @@ class Jpeg2000Input : public ImageInput {
     }
 
     template<typename T>
-    void yuv_to_rgb(T *p_scanline)
+    void yuv_to_rgb(T *p_scanline, int width)
     {
-        for (int x = 0, i = 0; x < m_spec.width; ++x, i += m_spec.nchannels) {
+        for (int x = 0, i = 0; x < width; ++x, i += m_spec.nchannels) {
             float y = convert_type<T,float>(p_scanline[i+0]);
             float u = convert_type<T,float>(p_scanline[i+1])-0.5f;
             float v = convert_type<T,float>(p_scanline[i+2])-0.5f;
@@ -188,6 +216,9 @@ OIIO_PLUGIN_EXPORTS_BEGIN
     OIIO_EXPORT const char *jpeg2000_input_extensions[] = {
         "jp2", "j2k", "j2c", NULL
     };
+    OIIO_EXPORT const char *jpeg2000_input_magic[] = {
+        "0000000c6a5020200d0a870a", "ff4fff51", NULL
+    };
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -200,31 +231,57 @@ Jpeg2000Input::init (void)
     m_codec = NULL;
     m_stream = NULL;
     m_keep_unassociated_alpha = false;
+    m_miplevel = 0;
+    m_nlevels = 1;
+    m_decoded = false;
+    m_tiled = false;
+    m_tdx = m_tdy = 0;
+    m_ntiles_x = 0;
 }
 
 
+
 bool
-Jpeg2000Input::open (const std::string &p_name, ImageSpec &p_spec)
+Jpeg2000Input::start_decoder (int level)
 {
-    m_filename = p_name;
-    if (! Filesystem::exists(m_filename)) {
-        error ("Could not open file \"%s\"", m_filename);
-        return false;
+    if (m_image) {
+        opj_image_destroy (m_image);
+        m_image = NULL;
     }
+    destroy_decompressor ();
+    destroy_stream ();
+    if (m_file) {
+        fclose (m_file);
+        m_file = NULL;
+    }
+    m_decoded = false;
 
     m_codec = create_decompressor();
     if (!m_codec) {
         error ("Could not create Jpeg2000 stream decompressor");
-        close();
         return false;
     }
 
     setup_event_mgr (m_codec);
 
+    // Reduced resolution levels come straight out of the wavelet
+    // decomposition, so decoding one skips the finer levels entirely.
     opj_dparameters_t parameters;
     opj_set_default_decoder_parameters(&parameters);
+    parameters.cp_reduce = level;
     opj_setup_decoder(m_codec, &parameters);
 
+#if defined(OPJ_VERSION_MAJOR) && \
+    (OPJ_VERSION_MAJOR > 2 || (OPJ_VERSION_MAJOR == 2 && OPJ_VERSION_MINOR >= 2))
+    // OpenJpeg >= 2.2 can decode code blocks in parallel
+    int nthreads = 0;
+    OIIO::getattribute ("threads", nthreads);
+    if (nthreads <= 0)
+        nthreads = Sysutil::hardware_concurrency();
+    if (nthreads > 1)
+        opj_codec_set_threads (m_codec, nthreads);
+#endif
+
 #if defined(OPJ_VERSION_MAJOR)
     // OpenJpeg >= 2.1
     m_stream = opj_stream_create_default_file_stream (m_filename.c_str(), true);
@@ -235,20 +292,31 @@ Jpeg2000Input::open (const std::string &p_name, ImageSpec &p_spec)
 #endif
     if (!m_stream) {
         error ("Could not open Jpeg2000 stream");
-        close();
         return false;
     }
 
-    ASSERT (m_image == NULL);
     if (! opj_read_header (m_stream, m_codec, &m_image)) {
         error ("Could not read Jpeg2000 header");
-        close ();
         return false;
     }
-    opj_decode (m_codec, m_stream, m_image);
+    return true;
+}
 
-    destroy_decompressor ();
-    destroy_stream ();
+
+bool
+Jpeg2000Input::open (const std::string &p_name, ImageSpec &p_spec)
+{
+    m_filename = p_name;
+    if (! Filesystem::exists(m_filename)) {
+        error ("Could not open file \"%s\"", m_filename);
+        return false;
+    }
+
+    ASSERT (m_image == NULL);
+    if (! start_decoder (0)) {
+        close ();
+        return false;
+    }
 
     // we support only one, three or four components in image
     const int channelCount = m_image->numcomps;
@@ -306,12 +374,102 @@ Jpeg2000Input::open (const std::string &p_name, ImageSpec &p_spec)
                           m_image->icc_profile_buf);
 #endif
 
+    // Remember the full resolution layout; reduced levels derive from it
+    m_topspec = m_spec;
+    m_x0 = m_image->x0;  m_y0 = m_image->y0;
+    m_x1 = m_image->x1;  m_y1 = m_image->y1;
+    m_comps.assign (m_image->comps, m_image->comps + channelCount);
+    m_miplevel = 0;
+    m_nlevels = 1;
+    m_tiled = false;
+
+#if defined(OPJ_VERSION_MAJOR)
+    // OpenJpeg >= 2.1 tells us the tiling and number of resolutions
+    if (opj_codestream_info_v2_t *info = opj_get_cstr_info (m_codec)) {
+        m_nlevels = std::max (1, int(info->m_default_tile_info.tccp_info
+                                     ? info->m_default_tile_info.tccp_info[0].numresolutions
+                                     : 1));
+        // Don't bother with levels that would shrink to nothing
+        while (m_nlevels > 1 &&
+               (ceildivpow2 (m_x1, m_nlevels-1) - ceildivpow2 (m_x0, m_nlevels-1) < 1 ||
+                ceildivpow2 (m_y1, m_nlevels-1) - ceildivpow2 (m_y0, m_nlevels-1) < 1))
+            --m_nlevels;
+        m_tdx = info->tdx;
+        m_tdy = info->tdy;
+        m_ntiles_x = info->tw;
+        // Expose the codestream tiles only when they map directly onto
+        // an OIIO tile grid: more than one tile, everything anchored at
+        // the origin, and no subsampled components.
+        m_tiled = (info->tw * info->th > 1 && info->tx0 == 0 && info->ty0 == 0
+                   && m_x0 == 0 && m_y0 == 0);
+        for (int c = 0; c < channelCount; ++c)
+            if (m_comps[c].dx != 1 || m_comps[c].dy != 1 ||
+                m_comps[c].x0 != 0 || m_comps[c].y0 != 0)
+                m_tiled = false;
+        opj_destroy_cstr_info (&info);
+    }
+#endif
+    level_spec (0, m_spec);
+
     p_spec = m_spec;
     return true;
 }
 
 
 
+void
+Jpeg2000Input::level_spec (int level, ImageSpec &spec) const
+{
+    spec = m_topspec;
+    if (level > 0) {
+        ROI datawindow;
+        for (size_t i = 0; i < m_comps.size(); ++i) {
+            const opj_image_comp_t &comp (m_comps[i]);
+            int x0 = ceildivpow2 (comp.x0, level);
+            int y0 = ceildivpow2 (comp.y0, level);
+            int w = ceildivpow2 (comp.x0 + comp.w, level) - x0;
+            int h = ceildivpow2 (comp.y0 + comp.h, level) - y0;
+            ROI roichan (x0, x0+w*comp.dx, y0, y0+h*comp.dy);
+            datawindow = roi_union (datawindow, roichan);
+        }
+        spec.x = datawindow.xbegin;
+        spec.y = datawindow.ybegin;
+        spec.width = datawindow.width();
+        spec.height = datawindow.height();
+        spec.full_x = ceildivpow2 (m_x0, level);
+        spec.full_y = ceildivpow2 (m_y0, level);
+        spec.full_width  = ceildivpow2 (m_x1, level);
+        spec.full_height = ceildivpow2 (m_y1, level);
+    }
+    // Tile sizes only stay aligned while they divide evenly
+    if (m_tiled && (m_tdx % (1 << level)) == 0 && (m_tdy % (1 << level)) == 0) {
+        spec.tile_width = m_tdx >> level;
+        spec.tile_height = m_tdy >> level;
+        spec.tile_depth = 1;
+    } else {
+        spec.tile_width = spec.tile_height = spec.tile_depth = 0;
+    }
+}
+
+
+
+bool
+Jpeg2000Input::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
+{
+    if (subimage != 0 || miplevel < 0 || miplevel >= m_nlevels)
+        return false;
+    if (miplevel != m_miplevel || ! m_image) {
+        if (! start_decoder (miplevel))
+            return false;
+        m_miplevel = miplevel;
+        level_spec (miplevel, m_spec);
+    }
+    newspec = m_spec;
+    return true;
+}
+
+
+
 bool
 Jpeg2000Input::open (const std::string &name, ImageSpec &newspec,
                      const ImageSpec &config)
@@ -326,26 +484,83 @@ Jpeg2000Input::open (const std::string &name, ImageSpec &newspec,
 bool
 Jpeg2000Input::read_native_scanline (int y, int z, void *data)
 {
+    if (m_spec.tile_width) {
+        error ("Jpeg2000 level %d is tiled", m_miplevel);
+        return false;
+    }
+    if (! m_decoded) {
+        // Decode the whole resolution level the first time it's needed
+        if (! m_image || ! opj_decode (m_codec, m_stream, m_image)) {
+            error ("Could not decode Jpeg2000 image \"%s\"", m_filename);
+            return false;
+        }
+        destroy_decompressor ();
+        destroy_stream ();
+        m_decoded = true;
+    }
+
     if (m_spec.format == TypeDesc::UINT8)
         read_scanline<uint8_t>(y, z, data);
     else
         read_scanline<uint16_t>(y, z, data);
 
+    associate_alpha (data, m_spec.width);
+    return true;
+}
+
+
+
+bool
+Jpeg2000Input::read_native_tile (int x, int y, int z, void *data)
+{
+    if (! m_spec.tile_width || ! m_image)
+        return false;
+    int tx = (x - m_spec.x) / m_spec.tile_width;
+    int ty = (y - m_spec.y) / m_spec.tile_height;
+    OPJ_UINT32 tileindex = OPJ_UINT32 (ty * m_ntiles_x + tx);
+
+    bool ok = m_codec && opj_get_decoded_tile (m_codec, m_stream, m_image,
+                                               tileindex);
+    if (! ok) {
+        // The codec might not be able to go backwards in the stream;
+        // start again from the header and retry.
+        if (! start_decoder (m_miplevel))
+            return false;
+        ok = opj_get_decoded_tile (m_codec, m_stream, m_image, tileindex);
+    }
+    if (! ok) {
+        error ("Could not decode Jpeg2000 tile %d of \"%s\"",
+               (int)tileindex, m_filename);
+        return false;
+    }
+
+    if (m_spec.format == TypeDesc::UINT8)
+        read_tile<uint8_t>(data);
+    else
+        read_tile<uint16_t>(data);
+
+    associate_alpha (data, int(m_spec.tile_pixels()));
+    return true;
+}
+
+
+
+void
+Jpeg2000Input::associate_alpha (void *data, int npixels)
+{
     // JPEG2000 specifically dictates unassociated (un-"premultiplied") alpha.
     // Convert to associated unless we were requested not to do so.
     if (m_spec.alpha_channel != -1 && !m_keep_unassociated_alpha) {
         float gamma = m_spec.get_float_attribute ("oiio:Gamma", 2.2f);
         if (m_spec.format == TypeDesc::UINT16)
-            associateAlpha ((unsigned short *)data, m_spec.width,
+            associateAlpha ((unsigned short *)data, npixels,
                             m_spec.nchannels, m_spec.alpha_channel,
                             gamma);
         else
-            associateAlpha ((unsigned char *)data, m_spec.width,
+            associateAlpha ((unsigned char *)data, npixels,
                             m_spec.nchannels, m_spec.alpha_channel,
                             gamma);
     }
-
-    return true;
 }
 
 
@@ -440,7 +655,38 @@ Jpeg2000Input::read_scanline(int y, int z, void *data)
         }
     }
     if (m_image->color_space == OPJ_CLRSPC_SYCC)
-        yuv_to_rgb(scanline);
+        yuv_to_rgb(scanline, m_spec.width);
+}
+
+
+
+template<typename T>
+void
+Jpeg2000Input::read_tile(void *data)
+{
+    // m_image holds just the decoded tile (clipped at the image edge)
+    T* tile = static_cast<T*>(data);
+    int nc = m_spec.nchannels;
+    int tw = m_spec.tile_width, th = m_spec.tile_height;
+    int bits = sizeof(T)*8;
+    memset (data, 0, size_t(tw) * th * nc * sizeof(T));
+    for (int c = 0; c < nc; ++c) {
+        const opj_image_comp_t &comp (m_image->comps[c]);
+        int w = std::min (int(comp.w), tw), h = std::min (int(comp.h), th);
+        for (int y = 0;  y < h;  ++y) {
+            const OPJ_INT32 *src = comp.data + size_t(y) * comp.w;
+            T *dst = tile + size_t(y) * tw * nc + c;
+            for (int x = 0;  x < w;  ++x, dst += nc) {
+                unsigned int val = src[x];
+                if (comp.sgnd)
+                    val += (1<<(bits/2-1));
+                *dst = (T) bit_range_convert (val, comp.prec, bits);
+            }
+        }
+    }
+    if (m_image->color_space == OPJ_CLRSPC_SYCC)
+        for (int y = 0;  y < th;  ++y)
+            yuv_to_rgb(tile + size_t(y) * tw * nc, tw);
 }
 
 
@@ -29,6 +29,10 @@
 */
 
 #include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -39,6 +43,7 @@
 #include "OpenImageIO/color.h"
 #include "OpenImageIO/imagebufalgo.h"
 #include "OpenImageIO/imagebufalgo_util.h"
+#include "imageio_pvt.h"
 
 #ifdef USE_OCIO
 #include <OpenColorIO/OpenColorIO.h>
@@ -61,6 +66,24 @@ ColorConfig::supportsOpenColorIO ()
 
 
 
+static spin_mutex colorconfig_mutex;
+
+// Processors made for the ImageBufAlgo color functions, kept for reuse,
+// for each ColorConfig, keyed by a description of the transform.  A
+// configuration's processors go away when it is reset or destroyed.
+// Guarded by colorconfig_mutex.
+typedef std::map<std::string, std::shared_ptr<ColorProcessor> > ProcessorMap;
+static std::map<const ColorConfig *, ProcessorMap> processor_cache;
+
+static void
+forget_processors (const ColorConfig *config)
+{
+    spin_lock lock (colorconfig_mutex);
+    processor_cache.erase (config);
+}
+
+
+
 // Hidden implementation of ColorConfig
 class ColorConfig::Impl
 {
@@ -127,6 +150,7 @@ ColorConfig::ColorConfig (string_view filename)
 
 ColorConfig::~ColorConfig()
 {
+    forget_processors (this);
     delete m_impl;
     m_impl = NULL;
 }
@@ -137,6 +161,8 @@ bool
 ColorConfig::reset (string_view filename)
 {
     bool ok = true;
+    if (m_impl)
+        forget_processors (this);
     delete m_impl;
 
     m_impl = new ColorConfig::Impl;
@@ -361,10 +387,42 @@ public:
     virtual void apply (float *data, int width, int height, int channels,
                         stride_t chanstride, stride_t xstride,
                         stride_t ystride) const = 0;
+    // For a transform that maps each of the first three channels on its
+    // own (and leaves the rest alone), return a table of the results for
+    // every stored value of an unsigned 8 or 16 bit channel of the given
+    // type, or NULL if there is none.
+    virtual const float *int_lut (TypeDesc type) const { return NULL; }
 };
 
 
 
+// The results of a per-channel transform function for every value of
+// an unsigned 8 or 16 bit channel, computed the first time they're asked
+// for.
+template<float (*F)(float)>
+static const float *
+int_lut_for (TypeDesc type)
+{
+    struct Table {
+        Table (int n) : values (n) {
+            for (int i = 0;  i < n;  ++i)
+                values[i] = F (float(i) / float(n-1));
+        }
+        std::vector<float> values;
+    };
+    if (type == TypeDesc::UINT8) {
+        static Table table (256);
+        return &table.values[0];
+    }
+    if (type == TypeDesc::UINT16) {
+        static Table table (65536);
+        return &table.values[0];
+    }
+    return NULL;
+}
+
+
+
 #ifdef USE_OCIO
 // Custom ColorProcessor that wraps an OpenColorIO Processor.
 class ColorProcessor_OCIO : public ColorProcessor
@@ -398,6 +456,9 @@ class ColorProcessor_sRGB_to_linear : public ColorProcessor {
 public:
     ColorProcessor_sRGB_to_linear () : ColorProcessor() { };
     ~ColorProcessor_sRGB_to_linear () { };
+    virtual const float *int_lut (TypeDesc type) const {
+        return int_lut_for<sRGB_to_linear> (type);
+    }
 
     virtual void apply (float *data, int width, int height, int channels,
                         stride_t chanstride, stride_t xstride,
@@ -405,22 +466,13 @@ public:
     {
         if (channels > 3)
             channels = 3;
-        if (channels == 3) {
-            for (int y = 0;  y < height;  ++y) {
-                char *d = (char *)data + y*ystride;
-                for (int x = 0;  x < width;  ++x, d += xstride) {
-                    simd::float4 r;
-                    r.load ((float *)d, 3);
-                    r = sRGB_to_linear (simd::float4((float *)d));
-                    r.store ((float *)d, 3);
-                }
-            }
-        } else {
-            for (int y = 0;  y < height;  ++y) {
-                char *d = (char *)data + y*ystride;
-                for (int x = 0;  x < width;  ++x, d += xstride)
-                    for (int c = 0;  c < channels;  ++c)
-                        ((float *)d)[c] = sRGB_to_linear (((float *)d)[c]);
+        for (int y = 0;  y < height;  ++y) {
+            char *d = (char *)data + y*ystride;
+            for (int x = 0;  x < width;  ++x, d += xstride) {
+                simd::float4 r;
+                r.load ((float *)d, channels);
+                r = sRGB_to_linear (r);
+                r.store ((float *)d, channels);
             }
         }
     }
@@ -432,6 +484,9 @@ class ColorProcessor_linear_to_sRGB : public ColorProcessor {
 public:
     ColorProcessor_linear_to_sRGB () : ColorProcessor() { };
     ~ColorProcessor_linear_to_sRGB () { };
+    virtual const float *int_lut (TypeDesc type) const {
+        return int_lut_for<linear_to_sRGB> (type);
+    }
     
     virtual void apply (float *data, int width, int height, int channels,
                         stride_t chanstride, stride_t xstride,
@@ -439,22 +494,13 @@ public:
     {
         if (channels > 3)
             channels = 3;
-        if (channels == 3) {
-            for (int y = 0;  y < height;  ++y) {
-                char *d = (char *)data + y*ystride;
-                for (int x = 0;  x < width;  ++x, d += xstride) {
-                    simd::float4 r;
-                    r.load ((float *)d, 3);
-                    r = linear_to_sRGB (simd::float4((float *)d));
-                    r.store ((float *)d, 3);
-                }
-            }
-        } else {
-            for (int y = 0;  y < height;  ++y) {
-                char *d = (char *)data + y*ystride;
-                for (int x = 0;  x < width;  ++x, d += xstride)
-                    for (int c = 0;  c < channels;  ++c)
-                        ((float *)d)[c] = linear_to_sRGB (((float *)d)[c]);
+        for (int y = 0;  y < height;  ++y) {
+            char *d = (char *)data + y*ystride;
+            for (int x = 0;  x < width;  ++x, d += xstride) {
+                simd::float4 r;
+                r.load ((float *)d, channels);
+                r = linear_to_sRGB (r);
+                r.store ((float *)d, channels);
             }
         }
     }
@@ -467,6 +513,9 @@ class ColorProcessor_Rec709_to_linear : public ColorProcessor {
 public:
     ColorProcessor_Rec709_to_linear () : ColorProcessor() { };
     ~ColorProcessor_Rec709_to_linear () { };
+    virtual const float *int_lut (TypeDesc type) const {
+        return int_lut_for<Rec709_to_linear> (type);
+    }
 
     virtual void apply (float *data, int width, int height, int channels,
                         stride_t chanstride, stride_t xstride,
@@ -476,9 +525,12 @@ public:
             channels = 3;
         for (int y = 0;  y < height;  ++y) {
             char *d = (char *)data + y*ystride;
-            for (int x = 0;  x < width;  ++x, d += xstride)
-                for (int c = 0;  c < channels;  ++c)
-                    ((float *)d)[c] = Rec709_to_linear (((float *)d)[c]);
+            for (int x = 0;  x < width;  ++x, d += xstride) {
+                simd::float4 r;
+                r.load ((float *)d, channels);
+                r = Rec709_to_linear (r);
+                r.store ((float *)d, channels);
+            }
         }
     }
 };
@@ -489,6 +541,9 @@ class ColorProcessor_linear_to_Rec709 : public ColorProcessor {
 public:
     ColorProcessor_linear_to_Rec709 () : ColorProcessor() { };
     ~ColorProcessor_linear_to_Rec709 () { };
+    virtual const float *int_lut (TypeDesc type) const {
+        return int_lut_for<linear_to_Rec709> (type);
+    }
     
     virtual void apply (float *data, int width, int height, int channels,
                         stride_t chanstride, stride_t xstride,
@@ -498,9 +553,12 @@ public:
             channels = 3;
         for (int y = 0;  y < height;  ++y) {
             char *d = (char *)data + y*ystride;
-            for (int x = 0;  x < width;  ++x, d += xstride)
-                for (int c = 0;  c < channels;  ++c)
-                    ((float *)d)[c] = linear_to_Rec709 (((float *)d)[c]);
+            for (int x = 0;  x < width;  ++x, d += xstride) {
+                simd::float4 r;
+                r.load ((float *)d, channels);
+                r = linear_to_Rec709 (r);
+                r.store ((float *)d, channels);
+            }
         }
     }
 };
@@ -521,6 +579,110 @@ public:
 
 
 
+// ColorProcessor that applies another one's transform through a 3D LUT
+// (with tetrahedral interpolation) baked from it over the [0,1] RGB
+// cube.  Pixels with any color channel outside the cube, and layouts
+// other than packed float channels, go through the exact processor.
+class ColorProcessor_Baked : public ColorProcessor {
+public:
+    ColorProcessor_Baked (std::shared_ptr<ColorProcessor> exact)
+        : ColorProcessor(), m_exact(exact)
+    {
+        const int n = lutsize;
+        m_lut.resize (n*n*n);
+        for (int b = 0, i = 0;  b < n;  ++b)
+            for (int g = 0;  g < n;  ++g)
+                for (int r = 0;  r < n;  ++r, ++i)
+                    m_lut[i] = simd::float4 (float(r)/(n-1), float(g)/(n-1),
+                                             float(b)/(n-1), 1.0f);
+        m_exact->apply ((float *)&m_lut[0], n, n*n, 4, sizeof(float),
+                        sizeof(simd::float4), n*sizeof(simd::float4));
+    }
+    ~ColorProcessor_Baked () { };
+    virtual bool hasChannelCrosstalk() const {
+        return m_exact->hasChannelCrosstalk();
+    }
+    virtual void apply (float *data, int width, int height, int channels,
+                        stride_t chanstride, stride_t xstride,
+                        stride_t ystride) const
+    {
+        if (channels < 3 || chanstride != sizeof(float)) {
+            m_exact->apply (data, width, height, channels,
+                            chanstride, xstride, ystride);
+            return;
+        }
+        std::vector<float> outside;
+        for (int y = 0;  y < height;  ++y) {
+            char *row = (char *)data + y*ystride;
+            outside.clear ();
+            for (int x = 0;  x < width;  ++x) {
+                float *d = (float *)(row + x*xstride);
+                if (! lookup (d)) {
+                    // Set aside for the exact transform, remembering x
+                    outside.push_back (float(x));
+                    outside.insert (outside.end(), d, d+channels);
+                }
+            }
+            if (outside.size()) {
+                stride_t ps = (channels+1) * sizeof(float);
+                int count = int (outside.size() / (channels+1));
+                m_exact->apply (&outside[1], count, 1, channels,
+                                sizeof(float), ps, count*ps);
+                for (int i = 0;  i < count;  ++i) {
+                    const float *p = &outside[i*(channels+1)];
+                    memcpy (row + int(p[0])*xstride, p+1,
+                            channels*sizeof(float));
+                }
+            }
+        }
+    }
+
+private:
+    enum { lutsize = 65 };
+    std::shared_ptr<ColorProcessor> m_exact;
+    std::vector<simd::float4> m_lut;
+
+    // Transform the RGB of d in place through the LUT, or return false
+    // if it lies outside the cube (or is NaN).
+    bool lookup (float *d) const {
+        using namespace simd;
+        const int n = lutsize;
+        float r = d[0], g = d[1], b = d[2];
+        if (! (r >= 0.0f && r <= 1.0f && g >= 0.0f && g <= 1.0f &&
+               b >= 0.0f && b <= 1.0f))
+            return false;
+        float fr = r * (n-1), fg = g * (n-1), fb = b * (n-1);
+        int ir = std::min (int(fr), n-2);
+        int ig = std::min (int(fg), n-2);
+        int ib = std::min (int(fb), n-2);
+        float dr = fr - ir, dg = fg - ig, db = fb - ib;
+        const int sr = 1, sg = n, sb = n*n;
+        const float4 *c = &m_lut[(ib*n + ig)*n + ir];
+        // Walk from corner 000 to 111 along the edges of the tetrahedron
+        // holding the point, taking the largest fractional step first.
+        float w1, w2, w3;
+        int o1, o2;
+        if (dr > dg) {
+            if (dg > db)      { w1 = dr; w2 = dg; w3 = db; o1 = sr; o2 = sr+sg; }
+            else if (dr > db) { w1 = dr; w2 = db; w3 = dg; o1 = sr; o2 = sr+sb; }
+            else              { w1 = db; w2 = dr; w3 = dg; o1 = sb; o2 = sr+sb; }
+        } else {
+            if (db > dg)      { w1 = db; w2 = dg; w3 = dr; o1 = sb; o2 = sg+sb; }
+            else if (db > dr) { w1 = dg; w2 = db; w3 = dr; o1 = sg; o2 = sg+sb; }
+            else              { w1 = dg; w2 = dr; w3 = db; o1 = sg; o2 = sr+sg; }
+        }
+        float4 c0 = c[0], c1 = c[o1], c2 = c[o2], c3 = c[sr+sg+sb];
+        float4 result = c0 + float4(w1) * (c1 - c0) + float4(w2) * (c2 - c1)
+                           + float4(w3) * (c3 - c2);
+        d[0] = result[0];
+        d[1] = result[1];
+        d[2] = result[2];
+        return true;
+    }
+};
+
+
+
 ColorProcessor*
 ColorConfig::createColorProcessor (string_view inputColorSpace,
                                    string_view outputColorSpace) const
@@ -826,7 +988,126 @@ ColorConfig::deleteColorProcessor (ColorProcessor * processor)
 
 
 static std::shared_ptr<ColorConfig> default_colorconfig;  // default color config
-static spin_mutex colorconfig_mutex;
+
+
+
+// Find, or make with make() and remember, colorconfig's processor for the
+// transform described by key.  A NULL colorconfig means the shared
+// default configuration.  When the "color:precision" attribute is
+// "baked", the processor remembered is a LUT baked from the one made.
+static const ColorProcessor *
+cached_processor (ColorConfig *colorconfig, std::string key,
+                  std::function<ColorProcessor* (ColorConfig *)> make,
+                  std::string &err)
+{
+    bool baked = (pvt::oiio_color_precision == "baked");
+    key += baked ? "/baked" : "/exact";
+    std::shared_ptr<ColorProcessor> exact;
+    {
+        spin_lock lock (colorconfig_mutex);
+        if (! colorconfig)
+            colorconfig = default_colorconfig.get();
+        if (! colorconfig)
+            default_colorconfig.reset (colorconfig = new ColorConfig);
+        ProcessorMap &cache (processor_cache[colorconfig]);
+        ProcessorMap::const_iterator found = cache.find (key);
+        if (found != cache.end())
+            return found->second.get();
+        exact.reset (make (colorconfig));
+        if (! exact) {
+            if (colorconfig->error())
+                err = colorconfig->geterror();
+            else
+                err = "Could not construct the color transform";
+            return NULL;
+        }
+        if (! baked || exact->isNoOp()) {
+            cache[key] = exact;
+            return exact.get();
+        }
+    }
+    // Bake without holding the lock, since it runs the exact transform
+    // over the whole LUT.  If another thread got there first, use its.
+    std::shared_ptr<ColorProcessor> processor (new ColorProcessor_Baked (exact));
+    spin_lock lock (colorconfig_mutex);
+    ProcessorMap &cache (processor_cache[colorconfig]);
+    return cache.insert (std::make_pair (key, processor)).first->second.get();
+}
+
+
+
+const ColorProcessor *
+pvt::colorprocessor_create (ColorConfig *colorconfig,
+                            string_view from, string_view to,
+                            string_view context_key,
+                            string_view context_value, std::string &err)
+{
+    std::string key = Strutil::format ("convert/%s/%s/%s/%s", from, to,
+                                       context_key, context_value);
+    const ColorProcessor *processor = cached_processor (colorconfig, key,
+        [&](ColorConfig *config) {
+            return config->createColorProcessor (from, to, context_key,
+                                                 context_value);
+        }, err);
+    if (! processor && err == "Could not construct the color transform")
+        err = Strutil::format ("Could not construct the color transform %s -> %s",
+                               from, to);
+    return processor;
+}
+
+
+
+bool
+pvt::colorprocessor_isnoop (const ColorProcessor *processor)
+{
+    return processor->isNoOp();
+}
+
+
+
+void
+pvt::colorprocessor_apply (const ColorProcessor *processor, bool unpremult,
+                           float *pixels, int npixels, int nchannels,
+                           int roi_nchannels, float *scratch)
+{
+    // Same channel handling as colorconvert_impl: up to the first four
+    // channels go through the transform as RGBA.
+    int channelsToCopy = std::min (4, std::min (nchannels, roi_nchannels));
+    if (channelsToCopy < 4)
+        memset (scratch, 0, npixels*4*sizeof(float));
+    for (int i = 0; i < npixels; ++i)
+        for (int c = 0; c < channelsToCopy; ++c)
+            scratch[4*i+c] = pixels[i*nchannels+c];
+
+    const float fltmin = std::numeric_limits<float>::min();
+    if ((channelsToCopy >= 4) && unpremult) {
+        for (int i = 0; i < npixels; ++i) {
+            float alpha = scratch[4*i+3];
+            if (alpha > fltmin) {
+                scratch[4*i+0] /= alpha;
+                scratch[4*i+1] /= alpha;
+                scratch[4*i+2] /= alpha;
+            }
+        }
+    }
+    processor->apply (scratch, npixels, 1, 4, sizeof(float),
+                      4*sizeof(float), npixels*4*sizeof(float));
+    if ((channelsToCopy >= 4) && unpremult) {
+        for (int i = 0; i < npixels; ++i) {
+            float alpha = scratch[4*i+3];
+            if (alpha > fltmin) {
+                scratch[4*i+0] *= alpha;
+                scratch[4*i+1] *= alpha;
+                scratch[4*i+2] *= alpha;
+            }
+        }
+    }
+
+    for (int i = 0; i < npixels; ++i)
+        for (int c = 0; c < channelsToCopy; ++c)
+            pixels[i*nchannels+c] = scratch[4*i+c];
+}
+
 
 
 
@@ -867,31 +1148,16 @@ ImageBufAlgo::colorconvert (ImageBuf &dst, const ImageBuf &src,
         dst.error ("Unknown color space name");
         return false;
     }
-    ColorProcessor *processor = NULL;
-    {
-        spin_lock lock (colorconfig_mutex);
-        if (! colorconfig)
-            colorconfig = default_colorconfig.get();
-        if (! colorconfig)
-            default_colorconfig.reset (colorconfig = new ColorConfig);
-        processor = colorconfig->createColorProcessor (from, to,
-                                                context_key, context_value);
-        if (! processor) {
-            if (colorconfig->error())
-                dst.error ("%s", colorconfig->geterror());
-            else
-                dst.error ("Could not construct the color transform %s -> %s",
-                           from, to);
-            return false;
-        }
+    std::string err;
+    const ColorProcessor *processor = pvt::colorprocessor_create (colorconfig,
+                                    from, to, context_key, context_value, err);
+    if (! processor) {
+        dst.error ("%s", err);
+        return false;
     }
     bool ok = colorconvert (dst, src, processor, unpremult, roi, nthreads);
     if (ok)
         dst.specmod().attribute ("oiio:ColorSpace", to);
-    {
-        spin_lock lock (colorconfig_mutex);
-        colorconfig->deleteColorProcessor (processor);
-    }
     return ok;
 }
 
@@ -943,6 +1209,14 @@ colorconvert_impl (ImageBuf &R, const ImageBuf &A,
     bool clearScanline = (channelsToCopy<4 && 
                           (processor->hasChannelCrosstalk() || unpremult));
     
+    // A per-channel transform of 8 or 16 bit values can be looked up
+    // straight from the stored values, unless unpremultiplying first.
+    const float *lut = A.deep() ? NULL
+                     : processor->int_lut (BaseTypeFromC<Atype>::value);
+    if (unpremult && channelsToCopy >= 4)
+        lut = NULL;
+    int lutchannels = std::min (3, channelsToCopy);
+
     ImageBuf::ConstIterator<Atype> a (A, roi);
     ImageBuf::Iterator<Rtype> r (R, roi);
     for (int k = roi.zbegin; k < roi.zend; ++k) {
@@ -954,6 +1228,22 @@ colorconvert_impl (ImageBuf &R, const ImageBuf &A,
             // Load the scanline
             dstPtr = &scanline[0];
             a.rerange (roi.xbegin, roi.xend, j, j+1, k, k+1);
+            if (lut) {
+                for ( ; !a.done(); ++a, dstPtr += 4) {
+                    const Atype *raw = (const Atype *) a.rawptr();
+                    bool exists = a.exists();
+                    for (int c = 0; c < lutchannels; ++c)
+                        dstPtr[c] = exists ? lut[int(raw[c])] : lut[0];
+                    for (int c = lutchannels; c < channelsToCopy; ++c)
+                        dstPtr[c] = a[c];
+                }
+                dstPtr = &scanline[0];
+                r.rerange (roi.xbegin, roi.xend, j, j+1, k, k+1);
+                for ( ; !r.done(); ++r, dstPtr += 4)
+                    for (int c = 0; c < channelsToCopy; ++c)
+                        r[c] = dstPtr[c];
+                continue;
+            }
             for ( ; !a.done(); ++a, dstPtr += 4)
                 for (int c = 0; c < channelsToCopy; ++c)
                     dstPtr[c] = a[c];
@@ -1067,30 +1357,21 @@ ImageBufAlgo::ociolook (ImageBuf &dst, const ImageBuf &src,
         dst.error ("Unknown color space name");
         return false;
     }
-    ColorProcessor *processor = NULL;
-    {
-        spin_lock lock (colorconfig_mutex);
-        if (! colorconfig)
-            colorconfig = default_colorconfig.get();
-        if (! colorconfig)
-            default_colorconfig.reset (colorconfig = new ColorConfig);
-        processor = colorconfig->createLookTransform (looks, from, to, inverse,
-                                                 key, value);
-        if (! processor) {
-            if (colorconfig->error())
-                dst.error ("%s", colorconfig->geterror());
-            else
-                dst.error ("Could not construct the color transform");
-            return false;
-        }
+    std::string err;
+    std::string cachekey = Strutil::format ("look/%s/%s/%s/%d/%s/%s", looks,
+                                            from, to, inverse, key, value);
+    const ColorProcessor *processor = cached_processor (colorconfig, cachekey,
+        [&](ColorConfig *config) {
+            return config->createLookTransform (looks, from, to, inverse,
+                                                key, value);
+        }, err);
+    if (! processor) {
+        dst.error ("%s", err);
+        return false;
     }
     bool ok = colorconvert (dst, src, processor, unpremult, roi, nthreads);
     if (ok)
         dst.specmod().attribute ("oiio:ColorSpace", to);
-    {
-        spin_lock lock (colorconfig_mutex);
-        colorconfig->deleteColorProcessor (processor);
-    }
     return ok;
 }
 
@@ -1126,28 +1407,20 @@ ImageBufAlgo::ociodisplay (ImageBuf &dst, const ImageBuf &src,
         dst.error ("Unknown color space name");
         return false;
     }
-    ColorProcessor *processor = NULL;
-    {
-        spin_lock lock (colorconfig_mutex);
-        if (! colorconfig)
-            colorconfig = default_colorconfig.get();
-        if (! colorconfig)
-            default_colorconfig.reset (colorconfig = new ColorConfig);
-        processor = colorconfig->createDisplayTransform (display, view, from, looks, key, value);
-        if (! processor) {
-            if (colorconfig->error())
-                dst.error ("%s", colorconfig->geterror());
-            else
-                dst.error ("Could not construct the color transform");
-            return false;
-        }
-    }
-    bool ok = colorconvert (dst, src, processor, unpremult, roi, nthreads);
-    {
-        spin_lock lock (colorconfig_mutex);
-        colorconfig->deleteColorProcessor (processor);
+    std::string err;
+    std::string cachekey = Strutil::format ("display/%s/%s/%s/%s/%s/%s",
+                                            display, view, from, looks,
+                                            key, value);
+    const ColorProcessor *processor = cached_processor (colorconfig, cachekey,
+        [&](ColorConfig *config) {
+            return config->createDisplayTransform (display, view, from,
+                                                   looks, key, value);
+        }, err);
+    if (! processor) {
+        dst.error ("%s", err);
+        return false;
     }
-    return ok;
+    return colorconvert (dst, src, processor, unpremult, roi, nthreads);
 }
 
 
@@ -1161,29 +1434,19 @@ ImageBufAlgo::ociofiletransform (ImageBuf &dst, const ImageBuf &src,
         dst.error ("Unknown filetransform name");
         return false;
     }
-    ColorProcessor *processor = NULL;
-    {
-        spin_lock lock (colorconfig_mutex);
-        if (! colorconfig)
-            colorconfig = default_colorconfig.get();
-        if (! colorconfig)
-            default_colorconfig.reset (colorconfig = new ColorConfig);
-        processor = colorconfig->createFileTransform (name, inverse);
-        if (! processor) {
-            if (colorconfig->error())
-                dst.error ("%s", colorconfig->geterror());
-            else
-                dst.error ("Could not construct the color transform");
-            return false;
-        }
+    std::string err;
+    std::string cachekey = Strutil::format ("file/%s/%d", name, inverse);
+    const ColorProcessor *processor = cached_processor (colorconfig, cachekey,
+        [&](ColorConfig *config) {
+            return config->createFileTransform (name, inverse);
+        }, err);
+    if (! processor) {
+        dst.error ("%s", err);
+        return false;
     }
     bool ok = colorconvert (dst, src, processor, unpremult, roi, nthreads);
     if (ok)
         dst.specmod().attribute ("oiio:ColorSpace", name);
-    {
-        spin_lock lock (colorconfig_mutex);
-        colorconfig->deleteColorProcessor (processor);
-    }
     return ok;
 }
 
@@ -37,6 +37,7 @@
 
 
 #include <iostream>
+#include <functional>
 
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/imagebuf.h>
@@ -274,6 +275,55 @@ test_compute ()
 
 
 
+// Host timings of the ops that would be candidates for a device backend,
+// each on its fastest CPU path, so that any such backend has a baseline
+// (including the cost of getting pixels to and from it) to beat.
+void
+test_candidate_ops ()
+{
+    std::cout << "\nCandidate ops, " << numthreads << " threads:\n";
+    ImageSpec rgba (xres, yres, 4, TypeDesc::FLOAT);
+    ImageBuf A (rgba), B (rgba), R;
+    ImageBufAlgo::noise (A, "uniform", 0.0f, 1.0f, false, 1);
+    ImageBufAlgo::noise (B, "uniform", 0.0f, 1.0f, false, 2);
+    ImageBuf K;
+    ImageBufAlgo::make_kernel (K, "gaussian", 5.0f, 5.0f);
+    Imath::M33f M;
+    M.rotate (0.2f);
+    int iters = std::max (1, iterations/20);
+    double Mvals = (double (xres) * yres * 4) / 1.0e6;
+
+    auto report = [&](const char *name, std::function<void()> &&f) {
+        double time = time_trial (f, ntrials, iters) / iters;
+        std::cout << Strutil::format ("  %-28s %8.1f Mvals/sec\n", name,
+                                      Mvals/time);
+    };
+    report ("resize (half, triangle)", [&](){
+        ImageBuf D (ImageSpec (xres/2, yres/2, 4, TypeDesc::FLOAT));
+        ImageBufAlgo::resize (D, A, "triangle", 0.0f, ROI(), numthreads);
+    });
+    report ("convolve (5x5 gaussian)", [&](){
+        ImageBufAlgo::convolve (R, A, K, true, ROI(), numthreads);
+    });
+    ustring oldprecision;
+    OIIO::getattribute ("color:precision", TypeDesc::TypeString, &oldprecision);
+    OIIO::attribute ("color:precision", "baked");
+    report ("colorconvert (baked LUT)", [&](){
+        ImageBufAlgo::colorconvert (R, A, "sRGB", "linear", false,
+                                    "", "", NULL, ROI(), numthreads);
+    });
+    OIIO::attribute ("color:precision", oldprecision.string());
+    report ("over", [&](){
+        ImageBufAlgo::over (R, A, B, ROI(), numthreads);
+    });
+    report ("warp (rotate, triangle)", [&](){
+        ImageBufAlgo::warp (R, A, M, "triangle", 0.0f, false,
+                            ImageBuf::WrapDefault, A.roi(), numthreads);
+    });
+}
+
+
+
 static void
 getargs (int argc, char *argv[])
 {
@@ -332,6 +382,7 @@ int main (int argc, char *argv[])
     // imgB.write ("B.exr");
 
     test_compute ();
+    test_candidate_ops ();
 
     return unit_test_failures;
 }
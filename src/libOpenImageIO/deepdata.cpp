@@ -40,6 +40,7 @@
 #include "OpenImageIO/deepdata.h"
 #include "OpenImageIO/thread.h"
 #include "OpenImageIO/strutil.h"
+#include "OpenImageIO/simd.h"
 
 OIIO_NAMESPACE_BEGIN
 
@@ -53,6 +54,86 @@ OIIO_NAMESPACE_BEGIN
 // need to lock the mutex. As long as capacity is not changing, threads may
 // change number of samples (inserting or deleting) as well as altering
 // data, simultaneously, as long as they are working on separate pixels.
+//
+// All pixels start out packed into one block (m_data), in order.  A pixel
+// whose capacity grows after allocation moves to a chunk of the sample
+// arena instead of shifting the samples of every pixel after it, so that
+// editing a pixel costs time proportional to its own samples.  The first
+// time somebody needs the whole contiguous block again (all_data,
+// get_pointers, or a copy), compact() repacks all pixels into m_data.
+
+
+
+namespace {
+
+// Chunked storage for the samples of pixels that outgrew their place in
+// m_data, and the table of where each such pixel went.  Chunks never
+// move once allocated, so pointers into one pixel stay valid while other
+// pixels grow, and the table is created once and published atomically,
+// so threads growing different pixels don't disturb each other's lookups
+// (alloc and set_moved must be called with the DeepData mutex held).
+// Copying an arena yields an empty one -- DeepData compacts before it
+// copies.
+class SampleArena {
+public:
+    SampleArena () : m_moved(NULL), m_used(0), m_size(0), m_bytes(0) { }
+    SampleArena (const SampleArena &) : m_moved(NULL), m_used(0), m_size(0),
+                                        m_bytes(0) { }
+    const SampleArena& operator= (const SampleArena &) {
+        clear ();
+        return *this;
+    }
+    ~SampleArena () { clear (); }
+
+    // Return space for the given number of bytes (8-byte aligned).
+    char *alloc (size_t bytes) {
+        bytes = (bytes + 7) & ~size_t(7);
+        if (m_used + bytes > m_size) {
+            m_size = std::max (bytes, size_t(chunksize));
+            m_chunks.emplace_back (new char [m_size]);
+            m_used = 0;
+        }
+        char *p = m_chunks.back().get() + m_used;
+        m_used += bytes;
+        m_bytes += bytes;
+        return p;
+    }
+
+    void clear () {
+        delete [] m_moved.exchange (NULL);
+        m_chunks.clear ();
+        m_used = m_size = m_bytes = 0;
+    }
+
+    bool empty () const { return m_moved.load() == NULL; }
+
+    // Where pixel p has moved, or NULL if it's still in m_data.
+    char *moved (size_t p) const {
+        char **table = m_moved.load (std::memory_order_acquire);
+        return table ? table[p] : NULL;
+    }
+
+    void set_moved (size_t p, char *data, size_t npixels) {
+        char **table = m_moved.load();
+        if (! table) {
+            table = new char* [npixels];
+            std::fill (table, table+npixels, (char *)NULL);
+            m_moved.store (table, std::memory_order_release);
+        }
+        table[p] = data;
+    }
+
+    // Total bytes handed out, including those of blocks since outgrown.
+    size_t bytes () const { return m_bytes; }
+
+private:
+    enum { chunksize = 256*1024 };
+    std::atomic<char **> m_moved;
+    std::vector<std::unique_ptr<char[]> > m_chunks;
+    size_t m_used, m_size, m_bytes;
+};
+
+}  // end anon namespace
 
 
 
@@ -64,8 +145,9 @@ public:
     std::vector<size_t> m_channeloffsets;  // for each channel [c]
     std::vector<unsigned int> m_nsamples;  // for each pixel [p]
     std::vector<unsigned int> m_capacity;  // for each pixel [p]
-    std::vector<unsigned int> m_cumcapacity;  // cumulative capacity before pixel [p]
+    std::vector<unsigned int> m_cumcapacity;  // offset of pixel [p] in m_data
     std::vector<char> m_data;              // for each sample [p][s][c]
+    SampleArena m_arena;                   // pixels that outgrew m_data
     std::vector<std::string> m_channelnames; // For each channel[c]
     std::vector<int> m_myalphachannel;     // For each channel[c], its alpha
       // myalphachannel[c] gives the alpha channel corresponding to channel
@@ -87,6 +169,7 @@ public:
         m_capacity.clear();
         m_cumcapacity.clear();
         m_data.clear();
+        m_arena.clear();
         m_channelnames.clear ();
         m_myalphachannel.clear ();
         m_samplesize = 0;
@@ -113,21 +196,76 @@ public:
         }
     }
 
-    size_t data_offset (int pixel, int channel, int sample) {
+    // Where the samples of the pixel start. Only call after alloc().
+    char * pixel_data (int pixel) {
         DASSERT (int(m_cumcapacity.size()) > pixel);
         DASSERT (m_capacity[pixel] >= m_nsamples[pixel]);
-        return (m_cumcapacity[pixel] + sample) * m_samplesize
-             + m_channeloffsets[channel];
+        if (char *moved = m_arena.moved (pixel))
+            return moved;
+        return m_data.data() + size_t(m_cumcapacity[pixel]) * m_samplesize;
     }
 
     void * data_ptr (int pixel, int channel, int sample) {
-        size_t offset = data_offset (pixel, channel, sample);
-        DASSERT (offset < m_data.size());
-        return &m_data[offset];
+        return pixel_data (pixel) + sample * m_samplesize
+                                  + m_channeloffsets[channel];
+    }
+
+    // Grow the capacity of one pixel of allocated data by moving its
+    // samples to the arena.  The caller holds m_mutex.
+    void grow (int pixel, int samps) {
+        size_t oldbytes = m_capacity[pixel] * m_samplesize;
+        size_t newbytes = size_t(samps) * m_samplesize;
+        char *newdata = m_arena.alloc (newbytes);
+        if (oldbytes)
+            memcpy (newdata, pixel_data (pixel), oldbytes);
+        memset (newdata + oldbytes, 0, newbytes - oldbytes);
+        m_arena.set_moved (pixel, newdata, m_capacity.size());
+        m_capacity[pixel] = samps;
     }
 
-    size_t total_capacity () const {
-        return m_cumcapacity.back() + m_capacity.back();
+    // Repack every pixel into m_data, in order, as alloc() would lay
+    // them out, and release the arena.
+    void compact () {
+        if (m_arena.empty())
+            return;
+        spin_lock lock (m_mutex);
+        if (m_arena.empty())
+            return;
+        size_t npixels = m_capacity.size();
+        std::vector<unsigned int> cumcapacity (npixels);
+        size_t totalcapacity = 0;
+        for (size_t i = 0; i < npixels; ++i) {
+            cumcapacity[i] = totalcapacity;
+            totalcapacity += m_capacity[i];
+        }
+        std::vector<char> data (totalcapacity * m_samplesize);
+        for (size_t i = 0; i < npixels; ++i)
+            if (m_capacity[i])
+                memcpy (&data[cumcapacity[i] * m_samplesize],
+                        pixel_data (int(i)), m_capacity[i] * m_samplesize);
+        m_data.swap (data);
+        m_cumcapacity.swap (cumcapacity);
+        m_arena.clear ();
+    }
+
+    // Copy channel c of the first n samples of the pixel, as floats, to
+    // contiguous memory.  Only call after alloc().
+    void get_channel (int pixel, int c, int n, float *out) {
+        const char *p = pixel_data (pixel) + m_channeloffsets[c];
+        TypeDesc t = m_channeltypes[c];
+        if (t == TypeDesc::FLOAT) {
+            for (int s = 0; s < n; ++s, p += m_samplesize)
+                memcpy (out+s, p, sizeof(float));
+        } else if (t == TypeDesc::HALF) {
+            for (int s = 0; s < n; ++s, p += m_samplesize) {
+                half h;
+                memcpy (&h, p, sizeof(half));
+                out[s] = h;
+            }
+        } else {
+            for (int s = 0; s < n; ++s, p += m_samplesize)
+                convert_types (t, p, TypeDesc::FLOAT, out+s, 1);
+        }
     }
 
     inline void sanity () const {
@@ -137,7 +275,7 @@ public:
         int npixels = int(m_capacity.size());
         ASSERT (m_nsamples.size() == m_capacity.size());
         ASSERT (m_cumcapacity.size() == m_capacity.size());
-        if (m_allocated) {
+        if (m_allocated && m_arena.empty()) {
             size_t totalcapacity = 0;
             for (int p = 0; p < npixels; ++p) {
                 ASSERT (m_cumcapacity[p] == totalcapacity);
@@ -176,6 +314,7 @@ DeepData::DeepData (const DeepData &d) : m_impl(NULL)
     m_npixels = d.m_npixels;
     m_nchannels = d.m_nchannels;
     if (d.m_impl) {
+        d.m_impl->compact ();
         m_impl = new Impl;
         *m_impl = *(d.m_impl);
     }
@@ -191,8 +330,10 @@ DeepData::operator= (const DeepData &d)
         m_nchannels = d.m_nchannels;
         if (! m_impl)
             m_impl = new Impl;
-        if (d.m_impl)
+        if (d.m_impl) {
+            d.m_impl->compact ();
             *m_impl = *(d.m_impl);
+        }
         else
             m_impl->clear ();
     }
@@ -252,6 +393,30 @@ DeepData::samplesize () const
 
 
 
+int
+DeepData::Z_channel () const
+{
+    return m_impl ? m_impl->m_z_channel : -1;
+}
+
+
+
+int
+DeepData::Zback_channel () const
+{
+    return m_impl ? m_impl->m_zback_channel : -1;
+}
+
+
+
+int
+DeepData::A_channel () const
+{
+    return m_impl ? m_impl->m_alpha_channel : -1;
+}
+
+
+
 // Is name the same as suffix, or does it end in ".suffix"?
 inline bool
 is_or_endswithdot (string_view name, string_view suffix)
@@ -396,22 +561,8 @@ DeepData::set_capacity (int pixel, int samps)
     if (m_impl->m_allocated) {
         // Data already allocated. Expand capacity if necessary, don't
         // contract. (FIXME?)
-        int n = (int)capacity(pixel);
-        if (samps > n) {
-            int toadd = samps-n;
-            if (m_impl->m_data.empty()) {
-                size_t newtotal = (m_impl->total_capacity()+toadd);
-                m_impl->m_data.resize (newtotal*samplesize());
-            } else {
-                size_t offset = m_impl->data_offset (pixel, 0, n);
-                m_impl->m_data.insert (m_impl->m_data.begin() + offset,
-                                       toadd*samplesize(), 0);
-            }
-            // Adjust the cumulative prefix sum of samples for subsequent pixels
-            for (int p = pixel+1; p < m_npixels; ++p)
-                m_impl->m_cumcapacity[p] += toadd;
-            m_impl->m_capacity[pixel] = samps;
-        }
+        if (samps > capacity(pixel))
+            m_impl->grow (pixel, samps);
     } else {
         m_impl->m_capacity[pixel] = samps;
     }
@@ -474,7 +625,12 @@ void
 DeepData::insert_samples (int pixel, int samplepos, int n)
 {
     int oldsamps = samples(pixel);
-    set_capacity (pixel, oldsamps + n);
+    // Once the data is allocated, growing a pixel moves it, so grow
+    // geometrically to make repeated single inserts cheap.
+    int cap = capacity(pixel);
+    if (oldsamps + n > cap)
+        set_capacity (pixel, m_impl->m_allocated ? std::max (oldsamps+n, 2*cap)
+                                                 : oldsamps+n);
     // set_capacity is thread-safe, it locks internalls. Once the acpacity
     // is adjusted, we can alter nsamples or copy the data around within
     // the pixel without a lock, we presume that if multiple threads are
@@ -482,11 +638,10 @@ DeepData::insert_samples (int pixel, int samplepos, int n)
     if (m_impl->m_allocated) {
         // Move the data
         if (samplepos < oldsamps) {
-            size_t offset = m_impl->data_offset (pixel, 0, samplepos);
-            size_t end = m_impl->data_offset (pixel, 0, oldsamps);
-            std::copy_backward (m_impl->m_data.begin() + offset,
-                                m_impl->m_data.begin() + end,
-                                m_impl->m_data.begin() + end + n*samplesize());
+            char *data = m_impl->pixel_data (pixel);
+            memmove (data + (samplepos+n)*samplesize(),
+                     data + samplepos*samplesize(),
+                     (oldsamps-samplepos)*samplesize());
         }
     }
     // Add to this pixel's sample count
@@ -505,11 +660,12 @@ DeepData::erase_samples (int pixel, int samplepos, int n)
     if (m_impl->m_allocated) {
         // Move the data
         int oldsamps = samples(pixel);
-        size_t offset = m_impl->data_offset (pixel, 0, samplepos);
-        size_t end = m_impl->data_offset (pixel, 0, oldsamps);
-        std::copy (m_impl->m_data.begin() + offset + n*samplesize(),
-                   m_impl->m_data.begin() + end,
-                   m_impl->m_data.begin() + offset);
+        if (samplepos + n < oldsamps) {
+            char *data = m_impl->pixel_data (pixel);
+            memmove (data + samplepos*samplesize(),
+                     data + (samplepos+n)*samplesize(),
+                     (oldsamps-samplepos-n)*samplesize());
+        }
     }
     m_impl->m_nsamples[pixel] -= n;
 }
@@ -534,7 +690,7 @@ DeepData::data_ptr (int pixel, int channel, int sample) const
 {
     if (pixel < 0 || pixel >= m_npixels ||
             channel < 0 || channel >= m_nchannels ||
-            !m_impl || !m_impl->m_data.size() ||
+            !m_impl || !m_impl->m_allocated ||
             sample < 0 || sample >= int(m_impl->m_nsamples[pixel]))
         return NULL;
     return m_impl->data_ptr (pixel, channel, sample);
@@ -707,6 +863,7 @@ DeepData::all_data () const
 {
     ASSERT (m_impl);
     m_impl->alloc (m_npixels);
+    m_impl->compact ();
     return m_impl->m_data;
 }
 
@@ -717,6 +874,7 @@ DeepData::get_pointers (std::vector<void*> &pointers) const
 {
     ASSERT (m_impl);
     m_impl->alloc (m_npixels);
+    m_impl->compact ();
     pointers.resize (pixels()*channels());
     for (int i = 0;  i < m_npixels;  ++i) {
         if (m_impl->m_nsamples[i])
@@ -876,28 +1034,23 @@ DeepData::split (int pixel, float depth)
 
 namespace {
 
-// Comparitor functor for depth sorting sample indices of a deep pixel.
+// Comparitor functor for depth sorting sample indices of a deep pixel,
+// given the pixel's z and zback values in contiguous arrays.
 class SampleComparator {
 public:
-    SampleComparator (const DeepData &dd, int pixel, int zchan, int zbackchan)
-        : deepdata(dd), pixel(pixel), zchan(zchan), zbackchan(zbackchan) { }
+    SampleComparator (const float *z, const float *zback)
+        : z(z), zback(zback) { }
     bool operator() (int i, int j) const {
         // If either has a lower z, that's the lower
-        float iz = deepdata.deep_value (pixel, zchan, i);
-        float jz = deepdata.deep_value (pixel, zchan, j);
-        if (iz < jz)
+        if (z[i] < z[j])
             return true;
-        if (iz > jz)
+        if (z[i] > z[j])
             return false;
         // If both z's are equal, sort based on zback
-        float izb = deepdata.deep_value (pixel, zbackchan, i);
-        float jzb = deepdata.deep_value (pixel, zbackchan, j);
-        return izb < jzb;
+        return zback[i] < zback[j];
     }
 private:
-    const DeepData &deepdata;
-    int pixel;
-    int zchan, zbackchan;
+    const float *z, *zback;
 };
 
 }
@@ -910,12 +1063,26 @@ DeepData::sort (int pixel)
     int zchan = m_impl->m_z_channel;
     if (zchan < 0)
         return;   // No channel labeled Z -- we don't know what to do
-    int zbackchan = m_impl->m_z_channel;
+    int zbackchan = m_impl->m_zback_channel;
     if (zbackchan < 0)
         zbackchan = zchan;
     int nsamples = samples(pixel);
     if (nsamples < 2)
         return;   // 0 or 1 samples -- no sort necessary
+    m_impl->alloc (m_npixels);
+    float *z = OIIO_ALLOCA (float, 2*nsamples);
+    float *zback = z + nsamples;
+    m_impl->get_channel (pixel, zchan, nsamples, z);
+    m_impl->get_channel (pixel, zbackchan, nsamples, zback);
+
+    // Most pixels arrive already in order, and then there's nothing to
+    // move at all.
+    SampleComparator less (z, zback);
+    int s = 1;
+    while (s < nsamples && ! less (s, s-1))
+        ++s;
+    if (s == nsamples)
+        return;
 
     // Ick, std::sort and friends take a custom comparator, but not a custom
     // swapper, so there's no way to std::sort a data type whose size is not
@@ -927,16 +1094,78 @@ DeepData::sort (int pixel)
     for (int i = 0; i < nsamples; ++i)
         sample_indices[i] = i;
 #endif
-    std::stable_sort (sample_indices, sample_indices+nsamples,
-                      SampleComparator(*this, pixel, zchan, zbackchan));
+    if (nsamples <= 16) {
+        // For the typical handful of samples, a stable insertion sort
+        // (starting from the first out-of-order one) beats stable_sort,
+        // which allocates a temp buffer.
+        for ( ; s < nsamples; ++s) {
+            int key = sample_indices[s], j = s;
+            for ( ; j > 0 && less (key, sample_indices[j-1]); --j)
+                sample_indices[j] = sample_indices[j-1];
+            sample_indices[j] = key;
+        }
+    } else {
+        std::stable_sort (sample_indices, sample_indices+nsamples, less);
+    }
 
     // Now copy around using a temp buffer
     size_t samplebytes = samplesize();
     char *tmppixel = OIIO_ALLOCA (char, samplebytes*nsamples);
     memcpy (tmppixel, data_ptr (pixel, 0, 0), samplebytes*nsamples);
     for (int i = 0; i < nsamples; ++i)
-        memcpy (data_ptr (pixel, 0, i),
-                tmppixel+samplebytes*sample_indices[i], samplebytes);
+        if (sample_indices[i] != i)
+            memcpy (data_ptr (pixel, 0, i),
+                    tmppixel+samplebytes*sample_indices[i], samplebytes);
+}
+
+
+
+namespace {
+
+// How to blend the colors associated with one alpha channel when two
+// samples that overlap exactly are merged, per
+// http://www.openexr.com/InterpretingDeepPixels.pdf
+struct OverlapWeights {
+    enum Mode { Average, First, Second, Weighted };
+    Mode mode;
+    float v1, v2, w;   // for Weighted: cm = (c1*v1 + c2*v2) * w
+    float am;          // the merged alpha
+
+    void init (float a1, float a2) {
+#if OIIO_CPLUSPLUS_VERSION >= 11
+        using std::log1p;
+#endif
+        a1 = clamp (a1, 0.0f, 1.0f);
+        a2 = clamp (a2, 0.0f, 1.0f);
+        am = a1 + a2 - a1 * a2;
+        if (a1 == 1.0f && a2 == 1.0f)
+            mode = Average;
+        else if (a1 == 1.0f)
+            mode = First;
+        else if (a2 == 1.0f)
+            mode = Second;
+        else {
+            static const float MAX = std::numeric_limits<float>::max();
+            mode = Weighted;
+            float u1 = -log1p (-a1);
+            v1 = (u1 < a1 * MAX)? u1 / a1: 1.0f;
+            float u2 = -log1p (-a2);
+            v2 = (u2 < a2 * MAX)? u2 / a2: 1.0f;
+            float u = u1 + u2;
+            w = (u > 1.0f || am < u * MAX)? am / u: 1.0f;
+        }
+    }
+
+    float color (float c1, float c2) const {
+        switch (mode) {
+        case Average : return (c1 + c2) / 2.0f;
+        case First   : return c1;
+        case Second  : return c2;
+        default      : return (c1 * v1 + c2 * v2) * w;
+        }
+    }
+};
+
 }
 
 
@@ -944,9 +1173,6 @@ DeepData::sort (int pixel)
 void
 DeepData::merge_overlaps (int pixel)
 {
-#if OIIO_CPLUSPLUS_VERSION >= 11
-    using std::log1p;
-#endif
     int zchan = m_impl->m_z_channel;
     int zbackchan = m_impl->m_zback_channel;
     if (zchan < 0)
@@ -954,61 +1180,76 @@ DeepData::merge_overlaps (int pixel)
     if (zbackchan < 0)
         zbackchan = zchan;  // Missing Zback -- use Z
     int nchans = channels();
-    for (int s = 1 /* YES, 1 */; s < samples(pixel); ++s) {
-        float zf = deep_value (pixel, zchan, s);     // z front
-        float zb = deep_value (pixel, zbackchan, s); // z back
-        if (zf == deep_value (pixel, zchan, s-1) &&
-            zb == deep_value (pixel, zbackchan, s-1)) {
-            // The samples overlap exactly, merge them per
-            // See http://www.openexr.com/InterpretingDeepPixels.pdf
-            for (int c = 0; c < nchans; ++c) {  // set the colors
-                int alphachan = m_impl->m_myalphachannel[c];
-                if (alphachan < 0)
-                    continue;    // Not color or alpha
-                if (alphachan == c)
-                    continue;  // Adjust the alphas in a second pass below
-                float a1 = (alphachan < 0) ? 1.0f :
-                           clamp (deep_value (pixel, alphachan, s-1), 0.0f, 1.0f);
-                float a2 = (alphachan < 0) ? 1.0f :
-                           clamp (deep_value (pixel, alphachan, s), 0.0f, 1.0f);
-                float c1 = deep_value (pixel, c, s-1);
-                float c2 = deep_value (pixel, c, s);
-                float am = a1 + a2 - a1 * a2;
-                float cm;
-                if (a1 == 1.0f && a2 == 1.0f)
-                    cm = (c1 + c2) / 2.0f;
-                else if (a1 == 1.0f)
-                    cm = c1;
-                else if (a2 == 1.0f)
-                    cm = c2;
-                else {
-                    static const float MAX = std::numeric_limits<float>::max();
-                    float u1 = -log1p (-a1);
-                    float v1 = (u1 < a1 * MAX)? u1 / a1: 1.0f;
-                    float u2 = -log1p (-a2);
-                    float v2 = (u2 < a2 * MAX)? u2 / a2: 1.0f;
-                    float u = u1 + u2;
-                    float w = (u > 1.0f || am < u * MAX)? am / u: 1.0f;
-                    cm = (c1 * v1 + c2 * v2) * w;
-                }
-                set_deep_value (pixel, c, s-1, cm); // setting color
+    int nsamples = samples(pixel);
+    if (nsamples < 2)
+        return;
+    m_impl->alloc (m_npixels);
+    float *z = OIIO_ALLOCA (float, 2*nsamples);
+    float *zback = z + nsamples;
+    m_impl->get_channel (pixel, zchan, nsamples, z);
+    m_impl->get_channel (pixel, zbackchan, nsamples, zback);
+    int s = 1;
+    while (s < nsamples && (z[s] != z[s-1] || zback[s] != zback[s-1]))
+        ++s;
+    if (s == nsamples)
+        return;   // The common case: nothing overlaps
+
+    // All-float channels (the usual Z/ZBack/A/RGBA layout) are merged
+    // straight from memory; anything else goes through deep_value.
+    bool allfloat = true;
+    for (int c = 0; c < nchans; ++c)
+        allfloat &= (m_impl->m_channeltypes[c] == TypeDesc::FLOAT);
+    const std::vector<int> &alphachannel (m_impl->m_myalphachannel);
+    float *first = OIIO_ALLOCA (float, 2*nchans);
+    float *second = first + nchans;
+    OverlapWeights *weights = OIIO_ALLOCA (OverlapWeights, nchans);
+    size_t samplebytes = samplesize();
+
+    // Merge in place: samples [0,w] are done, and each sample s either
+    // merges into w, or becomes the next w.  Then trim the tail once,
+    // rather than erasing one sample at a time.
+    int w = s - 1;
+    for ( ; s < nsamples; ++s) {
+        if (z[s] != z[w] || zback[s] != zback[w]) {
+            if (++w != s) {
+                memcpy (data_ptr (pixel, 0, w), data_ptr (pixel, 0, s),
+                        samplebytes);
+                z[w] = z[s];
+                zback[w] = zback[s];
             }
-            for (int c = 0; c < nchans; ++c) {  // set the alphas
-                int alphachan = m_impl->m_myalphachannel[c];
-                if (alphachan != c)
-                    continue;    // This pass is only for alphas
-                float a1 = (alphachan < 0) ? 1.0f :
-                           clamp (deep_value (pixel, alphachan, s-1), 0.0f, 1.0f);
-                float a2 = (alphachan < 0) ? 1.0f :
-                           clamp (deep_value (pixel, alphachan, s), 0.0f, 1.0f);
-                float am = a1 + a2 - a1 * a2;
-                set_deep_value (pixel, c, s-1, am); // setting alpha
+            continue;
+        }
+        // The samples overlap exactly, merge s into w
+        if (allfloat) {
+            memcpy (first, data_ptr (pixel, 0, w), nchans*sizeof(float));
+            memcpy (second, data_ptr (pixel, 0, s), nchans*sizeof(float));
+        } else {
+            for (int c = 0; c < nchans; ++c) {
+                first[c] = deep_value (pixel, c, w);
+                second[c] = deep_value (pixel, c, s);
             }
-            // Now eliminate sample s and revisit again
-            erase_samples (pixel, s, 1);
-            --s;
+        }
+        for (int c = 0; c < nchans; ++c)   // one set of weights per alpha
+            if (alphachannel[c] == c)
+                weights[c].init (first[c], second[c]);
+        for (int c = 0; c < nchans; ++c) {
+            int alphachan = alphachannel[c];
+            if (alphachan < 0)
+                continue;    // Not color or alpha
+            const OverlapWeights &wt (weights[alphachan]);
+            first[c] = (alphachan == c) ? wt.am
+                                        : wt.color (first[c], second[c]);
+        }
+        if (allfloat) {
+            memcpy (data_ptr (pixel, 0, w), first, nchans*sizeof(float));
+        } else {
+            for (int c = 0; c < nchans; ++c)
+                if (alphachannel[c] >= 0)
+                    set_deep_value (pixel, c, w, first[c]);
         }
     }
+    if (w+1 < nsamples)
+        erase_samples (pixel, w+1, nsamples-(w+1));
 }
 
 
@@ -1059,8 +1300,18 @@ DeepData::occlusion_cull (int pixel)
     if (alpha_channel < 0)
         return;   // If there isn't a definitive alpha channel, never mind
     int nsamples = samples(pixel);
-    for (int s = 0; s < nsamples; ++s) {
-        if (deep_value (pixel, alpha_channel, s) >= 1.0f) {
+    if (nsamples < 2)
+        return;
+    m_impl->alloc (m_npixels);
+    float *alpha = OIIO_ALLOCA (float, nsamples);
+    m_impl->get_channel (pixel, alpha_channel, nsamples, alpha);
+    // Look for the first opaque sample four at a time.
+    int s = 0;
+    for ( ; s+4 <= nsamples; s += 4)
+        if (any (simd::float4(alpha+s) >= simd::float4(1.0f)))
+            break;
+    for ( ; s < nsamples; ++s) {
+        if (alpha[s] >= 1.0f) {
             // We hit an opaque sample. Cull everything farther.
             set_samples (pixel, s+1);
             break;
@@ -1070,5 +1070,31 @@ exif_tag_lookup (string_view name, int &tag, int &tifftype, int &count)
 }
 
 
+
+bool
+decode_deferred_metadata (ImageSpec &spec)
+{
+    // Pull each block out of the spec before decoding it, in the order
+    // they usually appear in a file, so later ones take precedence.
+    bool ok = true;
+    if (const ImageIOParameter *p = spec.find_attribute ("oiio:ExifData")) {
+        std::string exif ((const char *)p->data(), p->type().size());
+        spec.erase_attribute ("oiio:ExifData");
+        ok &= decode_exif (exif, spec);
+    }
+    if (const ImageIOParameter *p = spec.find_attribute ("oiio:XMPData")) {
+        std::string xml ((const char *)p->data(), p->type().size());
+        spec.erase_attribute ("oiio:XMPData");
+        ok &= decode_xmp (xml, spec);
+    }
+    if (const ImageIOParameter *p = spec.find_attribute ("oiio:IPTCData")) {
+        std::string iptc ((const char *)p->data(), p->type().size());
+        spec.erase_attribute ("oiio:IPTCData");
+        ok &= decode_iptc_iim (iptc.data(), int(iptc.size()), spec);
+    }
+    return ok;
+}
+
+
 OIIO_NAMESPACE_END
 
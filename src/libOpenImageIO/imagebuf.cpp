@@ -35,6 +35,8 @@
 
 #include <iostream>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include <OpenEXR/ImathFun.h>
 #include <OpenEXR/half.h>
@@ -46,15 +48,252 @@
 #include "OpenImageIO/imagebufalgo_util.h"
 #include "OpenImageIO/imagecache.h"
 #include "OpenImageIO/dassert.h"
+#include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/strutil.h"
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/thread.h"
+#include "OpenImageIO/parallel.h"
 #include "OpenImageIO/simd.h"
+#include "imageio_pvt.h"
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
 
 OIIO_NAMESPACE_BEGIN
 
 
 static atomic_ll IB_local_mem_current;
+static atomic_ll IB_local_mem_peak;
+
+// Adjust the count of pixel memory owned by ImageBufs, keeping the peak.
+inline void
+IB_local_mem_add (long long delta)
+{
+    atomic_max (IB_local_mem_peak, (long long)(IB_local_mem_current += delta));
+}
+
+
+
+namespace {
+
+// Pixel memory pool.  ImageBuf pixel allocations are rounded up to a
+// multiple of the page size and, when freed, parked in per-size buckets
+// (up to the "imagebuf:pool_MB" limit) so that the next ImageBuf of the
+// same size can reuse them instead of going back to the heap.  Pooled
+// memory is never cleared -- ImageBuf never promised zeroed pixels.
+static const size_t pixelmem_page = 4096;
+static const size_t pixelmem_hugepage = 2 * 1024 * 1024;
+static spin_mutex pixelmem_mutex;
+static std::unordered_map<size_t, std::vector<char*> > pixelmem_buckets;
+static atomic_ll pixelmem_pooled (0);   // bytes sitting in the pool now
+static atomic_ll pixelmem_reused (0);   // total bytes handed out again
+static atomic_ll pixelmem_peak (0);     // largest pool size seen
+
+
+
+// Allocate at least size bytes, return the pointer and set size to the
+// amount actually allocated (which must be passed to pixelmem_free).
+static char *
+pixelmem_alloc (size_t &size)
+{
+    if (! size)
+        return NULL;
+    bool pooling = (pvt::oiio_imagebuf_pool_limit > 0);
+    bool huge = pvt::oiio_imagebuf_hugepages && size >= pixelmem_hugepage;
+    if (pooling || huge)
+        size = round_to_multiple (size, huge ? pixelmem_hugepage : pixelmem_page);
+    if (pooling) {
+        spin_lock lock (pixelmem_mutex);
+        auto found = pixelmem_buckets.find (size);
+        if (found != pixelmem_buckets.end() && found->second.size()) {
+            char *p = found->second.back();
+            found->second.pop_back ();
+            pixelmem_pooled -= size;
+            pixelmem_reused += size;
+            return p;
+        }
+    }
+    void *p = NULL;
+#ifdef __linux__
+    if (huge) {
+        if (posix_memalign (&p, pixelmem_hugepage, size) != 0)
+            p = NULL;
+# ifdef MADV_HUGEPAGE
+        if (p)
+            madvise (p, size, MADV_HUGEPAGE);
+# endif
+    }
+#endif
+    if (! p)
+        p = malloc (size);
+    if (! p)
+        throw std::bad_alloc();
+    return (char *)p;
+}
+
+
+
+static void
+pixelmem_free (char *p, size_t size)
+{
+    if (! p)
+        return;
+    if (pvt::oiio_imagebuf_pool_limit > 0 &&
+          pixelmem_pooled + (long long)size <= pvt::oiio_imagebuf_pool_limit) {
+        spin_lock lock (pixelmem_mutex);
+        pixelmem_buckets[size].push_back (p);
+        long long pooled = (pixelmem_pooled += size);
+        if (pooled > pixelmem_peak)
+            pixelmem_peak = pooled;
+        return;
+    }
+    free (p);
+}
+
+
+
+// Deleter that returns pixel memory to the pool.
+struct PixelMemDeleter {
+    PixelMemDeleter (size_t size=0) : size(size) { }
+    void operator() (char *p) const { pixelmem_free (p, size); }
+    size_t size;
+};
+
+// Pixel memory is reference counted so that views (see
+// ImageBuf::make_view) can keep their parent's pixels alive.
+typedef std::shared_ptr<char> PixelMemPtr;
+
+inline PixelMemPtr
+pixelmem_make (size_t size)
+{
+    char *p = pixelmem_alloc (size);
+    return PixelMemPtr (p, PixelMemDeleter(size));
+}
+
+
+
+static atomic_ll spillmem_current (0);  // pixel bytes in scratch files
+
+// Back size bytes of pixels with an (already unlinked) scratch file in
+// the "imagebuf:spill_dir" directory, mapped shared, so that the OS keeps
+// only the pages in use in memory and writes dirty ones back to the file
+// when it needs the room.  Return an empty pointer if that can't be done.
+static PixelMemPtr
+spillmem_make (size_t size)
+{
+#ifndef _WIN32
+    std::string dir = pvt::oiio_imagebuf_spill_dir.string();
+    if (dir.empty())
+        dir = Filesystem::temp_directory_path();
+    std::string path = dir + "/oiio_spill_XXXXXX";
+    int fd = mkstemp (&path[0]);
+    if (fd < 0)
+        return PixelMemPtr();
+    unlink (path.c_str());   // goes away with the last reference
+    void *p = MAP_FAILED;
+#ifdef __linux__
+    // Reserve the disk space now, rather than fault on a full disk later
+    bool sized = (posix_fallocate (fd, 0, off_t(size)) == 0);
+#else
+    bool sized = (ftruncate (fd, off_t(size)) == 0);
+#endif
+    if (sized)
+        p = mmap (NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close (fd);
+    if (p == MAP_FAILED)
+        return PixelMemPtr();
+    spillmem_current += size;
+    return PixelMemPtr ((char *)p, [size](char *p) {
+        munmap (p, size);
+        spillmem_current -= size;
+    });
+#else
+    return PixelMemPtr();
+#endif
+}
+
+
+
+// Allocate size bytes of pixel memory: from the heap (or pool), or, if
+// that would take ImageBufs past the "imagebuf:spill_MB" budget, in a
+// scratch file.  Set counted to how much of it is held in memory.
+static PixelMemPtr
+pixelmem_make_or_spill (size_t size, size_t &counted)
+{
+    long long limit = pvt::oiio_imagebuf_spill_limit;
+    if (limit > 0 && size && IB_local_mem_current + (long long)size > limit) {
+        PixelMemPtr p = spillmem_make (size);
+        if (p) {
+            counted = 0;
+            return p;
+        }
+    }
+    counted = size;
+    return pixelmem_make (size);
+}
+
+}  // end anonymous namespace
+
+
+
+void
+pvt::imagebuf_pool_trim ()
+{
+    spin_lock lock (pixelmem_mutex);
+    while (pixelmem_pooled > std::max (0LL, (long long)oiio_imagebuf_pool_limit)) {
+        // Free from the largest buckets first
+        auto biggest = pixelmem_buckets.end();
+        for (auto b = pixelmem_buckets.begin(); b != pixelmem_buckets.end(); ++b)
+            if (b->second.size() && (biggest == pixelmem_buckets.end() ||
+                                     b->first > biggest->first))
+                biggest = b;
+        if (biggest == pixelmem_buckets.end())
+            break;
+        free (biggest->second.back());
+        biggest->second.pop_back ();
+        pixelmem_pooled -= biggest->first;
+    }
+}
+
+
+
+void
+pvt::imagebuf_pool_stats (long long &pooled, long long &reused,
+                          long long &peak)
+{
+    pooled = pixelmem_pooled;
+    reused = pixelmem_reused;
+    peak = pixelmem_peak;
+}
+
+
+
+long long
+pvt::imagebuf_spilled_bytes ()
+{
+    return spillmem_current;
+}
+
+
+
+void
+pvt::imagebuf_local_mem_stats (long long &current, long long &peak)
+{
+    current = IB_local_mem_current;
+    peak = IB_local_mem_peak;
+}
+
+
+
+void
+pvt::imagebuf_local_mem_reset_peak ()
+{
+    IB_local_mem_peak = (long long) IB_local_mem_current;
+}
 
 
 
@@ -152,10 +391,14 @@ public:
     void alloc (const ImageSpec &spec);
     void realloc ();
     bool init_spec (string_view filename, int subimage, int miplevel);
+    // If processor is not NULL, try to apply it to the pixels as they are
+    // read, and set *colorconverted to whether that was done.
     bool read (int subimage, int miplevel, int chbegin=0, int chend=-1,
                bool force=false, TypeDesc convert=TypeDesc::UNKNOWN,
                ProgressCallback progress_callback=NULL,
-               void *progress_callback_data=NULL);
+               void *progress_callback_data=NULL,
+               const ColorProcessor *processor=NULL, bool unpremult=false,
+               bool *colorconverted=NULL);
     void copy_metadata (const ImageBufImpl &src);
 
     // Error reporting for ImageBuf: call this with printf-like
@@ -170,7 +413,8 @@ public:
 
     TypeDesc pixeltype () const {
         validate_spec ();
-        return m_localpixels ? m_spec.format : m_cachedpixeltype;
+        return (m_localpixels || has_localtiles() || is_view())
+                    ? m_spec.format : m_cachedpixeltype;
     }
 
     DeepData *deepdata () {
@@ -186,6 +430,72 @@ public:
     }
     bool cachedpixels () const { return m_storage == ImageBuf::IMAGECACHE; }
 
+    // Is this a read-only view of another ImageBuf's pixels, or of a
+    // memory-mapped file?
+    bool is_view () const {
+        return m_storage == ImageBuf::VIEWBUFFER ||
+               m_storage == ImageBuf::MMAPBUFFER;
+    }
+
+    // Address of pixel (x,y,z), relative to the data window origin,
+    // within the pixels of the buffer we are a view of.
+    char *view_pixel (int x, int y, int z) const {
+        return m_viewpixels + x * stride_t(m_pixel_bytes)
+                            + y * m_view_ystride + z * m_view_zstride;
+    }
+
+    // Make this a view of the roi region of src (see ImageBuf::make_view).
+    bool make_view (const ImageBufImpl &src, ROI roi);
+
+    // Before writing: if we are a view, copy the viewed pixels into our
+    // own memory; if views of our pixels exist, stop sharing with them.
+    void make_pixels_unique () {
+        if (is_view() || m_pixels_shared)
+            unshare_pixels ();
+    }
+    void unshare_pixels ();
+
+    // Share src's contiguous local pixels (copy-on-write) instead of
+    // copying them.  With keep_spec, only the pixels are replaced, and
+    // the layouts must match exactly; otherwise we become like
+    // reset(src.name(), src.spec()).  Return false if it isn't possible.
+    bool share_pixels (const ImageBufImpl &src, bool keep_spec);
+
+    // Are the local pixels stored as separate tiles (set_local_tiles)?
+    bool has_localtiles () const { return ! m_localtiles.empty(); }
+
+    // Address of pixel (x,y,z), relative to the data window origin,
+    // within the local tiles.
+    char *localtile_pixel (int x, int y, int z) const {
+        int tw = m_localtile_width, th = m_localtile_height;
+        int td = m_localtile_depth;
+        int xtile = x / tw, ytile = y / th, ztile = z / td;
+        size_t t = (size_t(ztile) * m_nlocaltiles_y + ytile) * m_nlocaltiles_x + xtile;
+        size_t offset = ((size_t(z - ztile*td) * th + (y - ytile*th)) * tw
+                         + (x - xtile*tw)) * m_pixel_bytes;
+        return m_localtiles[t].get() + offset;
+    }
+
+    // Change the layout of local pixels (see ImageBuf::set_local_tiles).
+    bool set_local_tiles (ImageBuf &ib, int width, int height, int depth);
+
+    // Fill the local tiles from the ImageCache, one tile at a time.
+    bool read_localtiles (int subimage, int miplevel, int chbegin, int chend);
+
+    // Try to memory-map the pixels of the file (see "imagebuf:mmap").
+    // Return false, with no error, if the file's layout doesn't allow it.
+    bool read_mmap (int subimage, int miplevel);
+
+    // Can write_converted handle writing this image to out?
+    bool can_write_converted (const ImageOutput *out) const;
+
+    // Write the image to out in chunks of whole scanlines or tile strips,
+    // converting (and dithering) each chunk to the file's data format
+    // ourselves, in parallel, while the previous chunk is being written.
+    bool write_converted (const ImageBuf &ib, ImageOutput *out,
+                          ProgressCallback progress_callback,
+                          void *progress_callback_data) const;
+
     const void *pixeladdr (int x, int y, int z) const;
     void *pixeladdr (int x, int y, int z);
 
@@ -277,8 +587,16 @@ private:
     int m_threads;               ///< thread policy for this image
     ImageSpec m_spec;            ///< Describes the image (size, etc)
     ImageSpec m_nativespec;      ///< Describes the true native image
-    std::unique_ptr<char[]> m_pixels; ///< Pixel data, if local and we own it
+    PixelMemPtr m_pixels;        ///< Pixel data, if local and we own it
     char *m_localpixels;         ///< Pointer to local pixels
+    int m_localtile_width;       ///< Tile size for local pixels (0 = one block)
+    int m_localtile_height;
+    int m_localtile_depth;
+    int m_nlocaltiles_x, m_nlocaltiles_y; ///< Local tiles in x and y
+    std::vector<PixelMemPtr> m_localtiles; ///< Local tiles, if any
+    char *m_viewpixels;          ///< Origin pixel, if we're a view
+    stride_t m_view_ystride, m_view_zstride; ///< Strides of viewed pixels
+    mutable std::atomic<bool> m_pixels_shared; ///< Views of m_pixels exist?
     mutable spin_mutex m_valid_mutex;
     mutable bool m_spec_valid;   ///< Is the spec valid
     mutable bool m_pixels_valid; ///< Image is valid
@@ -316,6 +634,10 @@ ImageBufImpl::ImageBufImpl (string_view filename,
       m_nmiplevels(0),
       m_threads(0),
       m_localpixels(NULL),
+      m_localtile_width(0), m_localtile_height(0), m_localtile_depth(0),
+      m_nlocaltiles_x(0), m_nlocaltiles_y(0),
+      m_viewpixels(NULL), m_view_ystride(0), m_view_zstride(0),
+      m_pixels_shared(false),
       m_spec_valid(false), m_pixels_valid(false),
       m_badfile(false), m_pixelaspect(1),
       m_pixel_bytes(0), m_scanline_bytes(0), m_plane_bytes(0),
@@ -362,8 +684,15 @@ ImageBufImpl::ImageBufImpl (const ImageBufImpl &src)
       m_nmiplevels(src.m_nmiplevels),
       m_threads(src.m_threads),
       m_spec(src.m_spec), m_nativespec(src.m_nativespec),
-      m_pixels(src.m_localpixels ? new char [src.m_spec.image_bytes()] : NULL),
-      m_localpixels(m_pixels.get()),
+      m_localpixels(NULL),
+      m_localtile_width(src.m_localtile_width),
+      m_localtile_height(src.m_localtile_height),
+      m_localtile_depth(src.m_localtile_depth),
+      m_nlocaltiles_x(src.m_nlocaltiles_x),
+      m_nlocaltiles_y(src.m_nlocaltiles_y),
+      m_viewpixels(src.m_viewpixels),
+      m_view_ystride(src.m_view_ystride), m_view_zstride(src.m_view_zstride),
+      m_pixels_shared(false),
       m_badfile(src.m_badfile),
       m_pixelaspect(src.m_pixelaspect),
       m_pixel_bytes(src.m_pixel_bytes),
@@ -380,17 +709,34 @@ ImageBufImpl::ImageBufImpl (const ImageBufImpl &src)
 {
     m_spec_valid = src.m_spec_valid;
     m_pixels_valid = src.m_pixels_valid;
-    m_allocated_size = src.m_localpixels ? src.spec().image_bytes() : 0;
-    IB_local_mem_current += m_allocated_size;
+    m_allocated_size = 0;
+    if (src.has_localtiles()) {
+        // Source had the image in memory as separate tiles -- copy them
+        size_t tilebytes = src.m_allocated_size / src.m_localtiles.size();
+        m_localtiles.resize (src.m_localtiles.size());
+        for (size_t t = 0, n = m_localtiles.size();  t < n;  ++t) {
+            m_localtiles[t] = pixelmem_make (tilebytes);
+            memcpy (m_localtiles[t].get(), src.m_localtiles[t].get(), tilebytes);
+        }
+        m_allocated_size = src.m_allocated_size;
+    }
+    IB_local_mem_add (m_allocated_size);
     if (src.m_localpixels) {
         // Source had the image fully in memory (no cache)
         if (m_storage == ImageBuf::APPBUFFER) {
             // Source just wrapped the client app's pixels
             ASSERT (0 && "ImageBuf wrapping client buffer not yet supported");
         } else {
-            // We own our pixels -- copy from source
-            memcpy (m_pixels.get(), src.m_pixels.get(), m_spec.image_bytes());
+            // Source owns its pixels -- share them, until either of us
+            // writes to them (see unshare_pixels).
+            m_pixels = src.m_pixels;
+            m_localpixels = m_pixels.get();
+            m_pixels_shared = true;
+            src.m_pixels_shared = true;
         }
+    } else if (src.is_view()) {
+        // Source was a view -- so are we, sharing the same pixels
+        m_pixels = src.m_pixels;
     } else {
         // Source was cache-based or deep
         // nothing else to do
@@ -545,6 +891,11 @@ ImageBufImpl::clear ()
     m_nativespec = ImageSpec ();
     m_pixels.reset ();
     m_localpixels = NULL;
+    m_localtiles.clear ();   // N.B. the local tile size choice is kept
+    m_viewpixels = NULL;
+    m_view_ystride = 0;
+    m_view_zstride = 0;
+    m_pixels_shared = false;
     m_spec_valid = false;
     m_pixels_valid = false;
     m_badfile = false;
@@ -645,17 +996,38 @@ void
 ImageBufImpl::realloc ()
 {
     IB_local_mem_current -= m_allocated_size;
-    m_allocated_size = m_spec.deep ? size_t(0) : m_spec.image_bytes ();
-    IB_local_mem_current += m_allocated_size;
-    m_pixels.reset (m_allocated_size ? new char [m_allocated_size] : NULL);
-    m_localpixels = m_pixels.get();
-    m_storage = m_allocated_size ? ImageBuf::LOCALBUFFER : ImageBuf::UNINITIALIZED;
     m_pixel_bytes = m_spec.pixel_bytes();
     m_scanline_bytes = m_spec.scanline_bytes();
     m_plane_bytes = clamped_mult64 (m_scanline_bytes, (imagesize_t)m_spec.height);
+    m_pixels.reset ();
+    m_localtiles.clear ();
+    m_viewpixels = NULL;
+    m_pixels_shared = false;
+    if (m_spec.deep) {
+        m_allocated_size = 0;
+    } else if (m_localtile_width > 0) {
+        // Allocate each tile separately, so that even a huge image never
+        // needs one huge block.  Edge tiles are full size, for simplicity.
+        int tw = m_localtile_width, th = m_localtile_height;
+        int td = m_localtile_depth;
+        m_nlocaltiles_x = (m_spec.width + tw - 1) / tw;
+        m_nlocaltiles_y = (m_spec.height + th - 1) / th;
+        int nlocaltiles_z = (m_spec.depth + td - 1) / td;
+        size_t tilebytes = m_pixel_bytes * size_t(tw) * th * td;
+        m_localtiles.resize (size_t(m_nlocaltiles_x) * m_nlocaltiles_y * nlocaltiles_z);
+        for (auto &tile : m_localtiles)
+            tile = pixelmem_make (tilebytes);
+        m_allocated_size = tilebytes * m_localtiles.size();
+    } else {
+        m_pixels = pixelmem_make_or_spill (m_spec.image_bytes(), m_allocated_size);
+    }
+    IB_local_mem_add (m_allocated_size);
+    m_localpixels = m_pixels.get();
+    bool allocated = (m_allocated_size || m_localpixels);
+    m_storage = allocated ? ImageBuf::LOCALBUFFER : ImageBuf::UNINITIALIZED;
     m_blackpixel.resize (round_to_multiple (m_pixel_bytes, OIIO_SIMD_MAX_SIZE_BYTES), 0);
     // NB make it big enough for SSE
-    if (m_allocated_size)
+    if (allocated)
         m_pixels_valid = true;
     if (m_spec.deep) {
         m_deepdata.init (m_spec);
@@ -770,11 +1142,19 @@ bool
 ImageBufImpl::read (int subimage, int miplevel, int chbegin, int chend,
                     bool force, TypeDesc convert,
                     ProgressCallback progress_callback,
-                    void *progress_callback_data)
+                    void *progress_callback_data,
+                    const ColorProcessor *processor, bool unpremult,
+                    bool *colorconverted)
 {
+    if (colorconverted)
+        *colorconverted = false;
     if (! m_name.length())
         return true;
 
+    // Pixels already in memory were not read with this transform.
+    if (processor)
+        force = true;
+
     if (m_pixels_valid && !force &&
             subimage == m_current_subimage && miplevel == m_current_miplevel)
         return true;
@@ -824,7 +1204,7 @@ ImageBufImpl::read (int subimage, int miplevel, int chbegin, int chend,
                                   ustring("cachedpixeltype"),
                                   TypeDesc::TypeInt, &peltype);
     m_cachedpixeltype = TypeDesc ((TypeDesc::BASETYPE)peltype);
-    if (! m_localpixels && ! force && ! use_channel_subset &&
+    if (! m_localpixels && ! has_localtiles() && ! force && ! use_channel_subset &&
         (convert == m_cachedpixeltype || convert == TypeDesc::UNKNOWN)) {
         m_spec.format = m_cachedpixeltype;
         m_pixel_bytes = m_spec.pixel_bytes();
@@ -854,6 +1234,15 @@ ImageBufImpl::read (int subimage, int miplevel, int chbegin, int chend,
         }
     }
 
+    // A forced read of a file whose pixels are already laid out on disk
+    // exactly as we would hold them can just map them.
+    if (force && pvt::oiio_imagebuf_mmap && ! use_channel_subset &&
+        ! processor &&
+        ! has_localtiles() && ! m_nativespec.channelformats.size() &&
+        (convert == TypeDesc::UNKNOWN || convert == m_nativespec.format) &&
+        read_mmap (subimage, miplevel))
+        return true;
+
     if (convert != TypeDesc::UNKNOWN)
         m_spec.format = convert;
     else
@@ -866,7 +1255,14 @@ ImageBufImpl::read (int subimage, int miplevel, int chbegin, int chend,
     m_spec.tile_height = m_nativespec.tile_height;
     m_spec.tile_depth = m_nativespec.tile_depth;
 
-    if (force || (convert != TypeDesc::UNKNOWN &&
+    if (has_localtiles()) {
+        // Local tiles are always filled through the image cache, one tile
+        // at a time, so that there is never one big buffer.
+        m_pixels_valid = read_localtiles (subimage, miplevel, chbegin, chend);
+        return m_pixels_valid;
+    }
+
+    if (force || processor || (convert != TypeDesc::UNKNOWN &&
                   convert != m_cachedpixeltype &&
                   convert.size() >= m_cachedpixeltype.size() &&
                   convert.size() >= m_nativespec.format.size())) {
@@ -891,11 +1287,20 @@ ImageBufImpl::read (int subimage, int miplevel, int chbegin, int chend,
                 ImageSpec newspec;
                 ok &= in->seek_subimage (subimage, miplevel, newspec);
             }
-            if (ok)
+            if (ok && processor) {
+                ok &= pvt::read_image_colorconvert (in, chbegin, chend,
+                                    m_spec.format, m_localpixels,
+                                    AutoStride, AutoStride, AutoStride,
+                                    processor, unpremult,
+                                    progress_callback, progress_callback_data);
+            } else if (ok) {
                 ok &= in->read_image (chbegin, chend, convert, m_localpixels);
+            }
             in->close ();
             if (ok) {
                 m_pixels_valid = true;
+                if (processor && colorconverted)
+                    *colorconverted = true;
             } else {
                 m_pixels_valid = false;
                 error ("%s", in->geterror());
@@ -927,6 +1332,112 @@ ImageBufImpl::read (int subimage, int miplevel, int chbegin, int chend,
 
 
 
+bool
+ImageBufImpl::read_mmap (int subimage, int miplevel)
+{
+#ifndef _WIN32
+    int64_t offset = 0;
+    stride_t ystride = 0;
+    {
+        std::unique_ptr<ImageInput> in (
+                    ImageInput::open (m_name.string(), m_configspec.get()));
+        if (! in) {
+            OIIO::geterror ();   // clear it, the normal read will report it
+            return false;
+        }
+        ImageSpec newspec;
+        if ((subimage || miplevel) &&
+              ! in->seek_subimage (subimage, miplevel, newspec))
+            return false;
+        const ImageSpec &spec (in->spec());
+        if (spec.format != m_nativespec.format || spec.channelformats.size() ||
+            spec.nchannels != m_nativespec.nchannels || spec.deep ||
+            spec.depth != 1 || spec.width != m_nativespec.width ||
+            spec.height != m_nativespec.height ||
+            ! in->raw_pixel_layout (offset, ystride))
+            return false;
+    }
+
+    // The byte range holding the scanlines, and the page-aligned mapping
+    // that covers it.
+    stride_t rowbytes = (stride_t) m_nativespec.scanline_bytes();
+    int64_t first = offset + std::min (stride_t(0), ystride * (m_nativespec.height-1));
+    int64_t last = first + std::abs (ystride) * (m_nativespec.height-1) + rowbytes;
+    int fd = ::open (m_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    int64_t pagesize = sysconf (_SC_PAGESIZE);
+    int64_t base = first - first % pagesize;
+    size_t length = size_t (last - base);
+    void *map = MAP_FAILED;
+    if (first >= 0 && std::abs (ystride) >= rowbytes &&
+        fstat (fd, &st) == 0 && int64_t(st.st_size) >= last)
+        map = mmap (NULL, length, PROT_READ, MAP_PRIVATE, fd, off_t(base));
+    ::close (fd);   // the mapping stays valid
+    if (map == MAP_FAILED)
+        return false;
+    PixelMemPtr pixels ((char *)map, [length](char *p){ munmap (p, length); });
+
+    IB_local_mem_current -= m_allocated_size;   // mapped pages aren't ours
+    m_allocated_size = 0;
+    m_localpixels = NULL;
+    m_pixels_shared = false;
+    m_spec.format = m_nativespec.format;
+    m_spec.tile_width = m_nativespec.tile_width;
+    m_spec.tile_height = m_nativespec.tile_height;
+    m_spec.tile_depth = m_nativespec.tile_depth;
+    m_pixel_bytes = m_spec.pixel_bytes();
+    m_scanline_bytes = m_spec.scanline_bytes();
+    m_plane_bytes = clamped_mult64 (m_scanline_bytes, (imagesize_t)m_spec.height);
+    m_blackpixel.resize (round_to_multiple (m_pixel_bytes, OIIO_SIMD_MAX_SIZE_BYTES), 0);
+    m_pixels = pixels;
+    m_viewpixels = (char *)map + (offset - base);
+    m_view_ystride = ystride;
+    m_view_zstride = ystride * m_spec.height;
+    m_storage = ImageBuf::MMAPBUFFER;
+    m_pixels_valid = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+
+bool
+ImageBufImpl::read_localtiles (int subimage, int miplevel,
+                               int chbegin, int chend)
+{
+    int tw = m_localtile_width, th = m_localtile_height;
+    int td = m_localtile_depth;
+    stride_t xstride = m_pixel_bytes;
+    stride_t ystride = xstride * tw;
+    stride_t zstride = ystride * th;
+    for (int z = 0;  z < m_spec.depth;  z += td) {
+        int zend = std::min (z+td, m_spec.depth);
+        for (int y = 0;  y < m_spec.height;  y += th) {
+            int yend = std::min (y+th, m_spec.height);
+            for (int x = 0;  x < m_spec.width;  x += tw) {
+                int xend = std::min (x+tw, m_spec.width);
+                if (! m_imagecache->get_pixels (m_name, subimage, miplevel,
+                                        m_spec.x+x, m_spec.x+xend,
+                                        m_spec.y+y, m_spec.y+yend,
+                                        m_spec.z+z, m_spec.z+zend,
+                                        chbegin, chend, m_spec.format,
+                                        localtile_pixel (x, y, z),
+                                        xstride, ystride, zstride)) {
+                    error ("%s", m_imagecache->geterror ());
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+
 bool
 ImageBuf::read (int subimage, int miplevel, bool force, TypeDesc convert,
                 ProgressCallback progress_callback,
@@ -950,6 +1461,84 @@ ImageBuf::read (int subimage, int miplevel, int chbegin, int chend,
 
 
 
+bool
+ImageBuf::read (int subimage, int miplevel, int chbegin, int chend,
+                bool force, TypeDesc convert,
+                string_view fromspace, string_view tospace, bool unpremult,
+                ProgressCallback progress_callback,
+                void *progress_callback_data)
+{
+    std::string err;
+    const ColorProcessor *processor =
+        pvt::colorprocessor_create (NULL, fromspace, tospace, "", "", err);
+    if (! processor) {
+        error ("%s", err);
+        return false;
+    }
+    if (pvt::colorprocessor_isnoop (processor))
+        processor = NULL;
+    bool converted = false;
+    if (! impl()->read (subimage, miplevel, chbegin, chend, force, convert,
+                        progress_callback, progress_callback_data,
+                        processor, unpremult, &converted))
+        return false;
+    // Deep files and local tile storage can't take the fused path; those
+    // get an ordinary in-place conversion after the read.
+    if (processor && ! converted &&
+        ! ImageBufAlgo::colorconvert (*this, *this, processor, unpremult,
+                                      ROI::All()))
+        return false;
+    specmod().attribute ("oiio:ColorSpace", tospace);
+    return true;
+}
+
+
+
+// Run f (which takes the pool thread id and returns bool) on the default
+// thread pool.  A pool with no threads would never run it, so in that case
+// just run it now.
+template<typename F>
+static std::future<bool>
+push_async (F &&f)
+{
+    thread_pool *pool = default_thread_pool();
+    if (pool->size() < 1) {
+        std::promise<bool> result;
+        result.set_value (f(-1));
+        return result.get_future();
+    }
+    return pool->push (std::forward<F>(f));
+}
+
+
+
+std::future<bool>
+ImageBuf::read_async (int subimage, int miplevel, bool force,
+                      TypeDesc convert, ProgressCallback progress_callback,
+                      void *progress_callback_data)
+{
+    return push_async ([=](int /*id*/) {
+        return read (subimage, miplevel, force, convert,
+                     progress_callback, progress_callback_data);
+    });
+}
+
+
+
+std::future<bool>
+ImageBuf::write_async (string_view filename, string_view fileformat,
+                       ProgressCallback progress_callback,
+                       void *progress_callback_data) const
+{
+    std::string name (filename), format (fileformat);  // outlive caller's
+    return push_async ([=](int /*id*/) {
+        return write (name, format, progress_callback,
+                      progress_callback_data);
+    });
+}
+
+
+
 void
 ImageBuf::set_write_format (TypeDesc format)
 {
@@ -967,6 +1556,152 @@ ImageBuf::set_write_tiles (int width, int height, int depth)
 
 
 
+bool
+ImageBufImpl::can_write_converted (const ImageOutput *out) const
+{
+    const ImageSpec &outspec (out->spec());
+    if (m_spec.deep || outspec.format == TypeDesc::UNKNOWN ||
+        outspec.format == m_spec.format || outspec.channelformats.size() ||
+        m_spec.channelformats.size() || out->supports ("rectangles"))
+        return false;
+    // Only when the file is the same window as the buffer -- anything
+    // else is left to the plugin.
+    return (outspec.x == m_spec.x && outspec.y == m_spec.y &&
+            outspec.z == m_spec.z && outspec.width == m_spec.width &&
+            outspec.height == m_spec.height && outspec.depth == m_spec.depth &&
+            outspec.nchannels == m_spec.nchannels &&
+            (outspec.tile_width == 0 || out->supports ("tiles")));
+}
+
+
+
+bool
+ImageBufImpl::write_converted (const ImageBuf &ib, ImageOutput *out,
+                               ProgressCallback progress_callback,
+                               void *progress_callback_data) const
+{
+    const ImageSpec &outspec (out->spec());
+    TypeDesc outformat = outspec.format;
+    int nchans = m_spec.nchannels;
+    int width = m_spec.width, height = m_spec.height, depth = m_spec.depth;
+    bool tiled = (outspec.tile_width != 0);
+
+    // Dither exactly as ImageOutput::to_native_rectangle would have: same
+    // seed, same origin for each scanline or tile.
+    unsigned int dither = outspec.get_int_attribute ("oiio:dither", 0);
+    bool do_dither = (dither && m_spec.format.is_floating_point() &&
+                      outformat.basetype == TypeDesc::UINT8);
+
+    // Chunks are a single strip of tiles, or as many scanlines as fit in
+    // the budget.
+    const imagesize_t budget = 1024*1024*16; // 16 MB per buffer
+    int chunkheight, chunkdepth;
+    imagesize_t rowbytes = imagesize_t(width) * nchans
+                         * (do_dither ? sizeof(float) : outformat.size());
+    if (tiled) {
+        chunkheight = outspec.tile_height;
+        chunkdepth = std::max (1, outspec.tile_depth);
+    } else {
+        chunkheight = clamp (int(budget / std::max (rowbytes, imagesize_t(1))),
+                             1, height);
+        chunkdepth = 1;
+    }
+    size_t chunkpixels = size_t(width) * chunkheight * chunkdepth;
+    size_t chunkbytes = chunkpixels * nchans * outformat.size();
+    std::unique_ptr<char[]> buffers[2];
+    std::unique_ptr<float[]> staging[2];
+    for (int b = 0; b < 2; ++b) {
+        buffers[b].reset (new char [chunkbytes]);
+        if (do_dither)
+            staging[b].reset (new float [chunkpixels * nchans]);
+    }
+
+    // Where the pixels come from: in place for local pixels and views,
+    // get_pixels for everything else (cache-backed or local tiles).
+    bool direct = (m_localpixels || is_view());
+    stride_t sxstride = m_pixel_bytes;
+    stride_t systride = is_view() ? m_view_ystride : m_scanline_bytes;
+    stride_t szstride = is_view() ? m_view_zstride : m_plane_bytes;
+
+    struct Chunk { int y, yend, z, zend; };
+    std::vector<Chunk> chunks;
+    for (int z = m_spec.z; z < m_spec.z + depth; z += chunkdepth)
+        for (int y = m_spec.y; y < m_spec.y + height; y += chunkheight)
+            chunks.push_back (Chunk { y, std::min (y+chunkheight, m_spec.y+height),
+                                      z, std::min (z+chunkdepth, m_spec.z+depth) });
+
+    auto convert = [&](const Chunk &c, int b) -> bool {
+        int h = c.yend - c.y, d = c.zend - c.z;
+        ROI roi (m_spec.x, m_spec.x+width, c.y, c.yend, c.z, c.zend);
+        const void *src = direct ? pixeladdr (m_spec.x, c.y, c.z) : NULL;
+        if (! do_dither) {
+            if (direct)
+                return parallel_convert_image (nchans, width, h, d,
+                                src, m_spec.format, sxstride, systride, szstride,
+                                buffers[b].get(), outformat,
+                                AutoStride, AutoStride, AutoStride);
+            return ib.get_pixels (roi, outformat, buffers[b].get());
+        }
+        float *f = staging[b].get();
+        bool ok = direct ? parallel_convert_image (nchans, width, h, d,
+                                src, m_spec.format, sxstride, systride, szstride,
+                                f, TypeDesc::FLOAT, AutoStride, AutoStride, AutoStride)
+                         : ib.get_pixels (roi, TypeDesc::FLOAT, f);
+        // Each row of each tile (or each whole scanline) is an independent
+        // dither job.
+        int blockwidth = tiled ? outspec.tile_width : width;
+        int nblocks = (width + blockwidth - 1) / blockwidth;
+        stride_t ystride = stride_t(width) * nchans;
+        parallel_for (0, int64_t(nblocks) * h * d, [&](int64_t i) {
+            int x = int(i % nblocks) * blockwidth;
+            int y = int((i / nblocks) % h), z = int(i / (int64_t(nblocks) * h));
+            add_dither (nchans, std::min (blockwidth, width-x), 1, 1,
+                        f + (z*h + y) * ystride + x * nchans,
+                        AutoStride, AutoStride, AutoStride, 1.0f/255.0f,
+                        outspec.alpha_channel, outspec.z_channel, dither, 0,
+                        m_spec.x + x, c.y + y, c.z + z);
+        });
+        return ok && parallel_convert_image (nchans, width, h, d,
+                                f, TypeDesc::FLOAT, AutoStride, AutoStride, AutoStride,
+                                buffers[b].get(), outformat,
+                                AutoStride, AutoStride, AutoStride);
+    };
+
+    if (chunks.empty())
+        return true;
+    thread_pool *pool = default_thread_pool();
+    bool ok = convert (chunks[0], 0);
+    for (size_t i = 0; i < chunks.size() && ok; ++i) {
+        const Chunk &c (chunks[i]);
+        int b = int(i & 1);
+        // Convert the next chunk into the other buffer while this one is
+        // being written.
+        bool nextok = true;
+        {
+            task_set<void> next (pool);
+            if (i+1 < chunks.size())
+                next.push (pool->push ([&,i,b](int /*id*/){
+                    nextok = convert (chunks[i+1], 1-b);
+                }));
+            if (tiled) {
+                ok &= out->write_tiles (m_spec.x, m_spec.x+width, c.y, c.yend,
+                                        c.z, c.zend, outformat, buffers[b].get());
+            } else {
+                ok &= out->write_scanlines (c.y, c.yend, c.z, outformat,
+                                            buffers[b].get());
+            }
+            // leaving scope waits for the conversion, helping if idle
+        }
+        ok &= nextok;
+        if (progress_callback &&
+            progress_callback (progress_callback_data, float(i+1)/chunks.size()))
+            break;
+    }
+    return ok;
+}
+
+
+
 bool
 ImageBuf::write (ImageOutput *out,
                  ProgressCallback progress_callback,
@@ -979,10 +1714,20 @@ ImageBuf::write (ImageOutput *out,
     const ImageSpec &bufspec (impl->m_spec);
     const ImageSpec &outspec (out->spec());
     TypeDesc bufformat = spec().format;
-    if (impl->m_localpixels) {
+    if (impl->can_write_converted (out)) {
+        // The file wants a different data format: convert in parallel,
+        // overlapped with the plugin's writing (and compression).
+        ok &= impl->write_converted (*this, out, progress_callback,
+                                     progress_callback_data);
+    } else if (impl->m_localpixels) {
         // In-core pixel buffer for the whole image
         ok = out->write_image (bufformat, impl->m_localpixels, as, as, as,
                                progress_callback, progress_callback_data);
+    } else if (impl->is_view()) {
+        // View of another buffer's pixels: write them in place, strided
+        ok = out->write_image (bufformat, impl->m_viewpixels, as,
+                               impl->m_view_ystride, impl->m_view_zstride,
+                               progress_callback, progress_callback_data);
     } else if (deep()) {
         // Deep image record
         ok = out->write_deep_image (impl->m_deepdata);
@@ -990,7 +1735,8 @@ ImageBuf::write (ImageOutput *out,
         // The image we want to write is backed by ImageCache -- we must be
         // immediately writing out a file from disk, possibly with file
         // format or data format conversion, but without any ImageBufAlgo
-        // functions having been applied.
+        // functions having been applied -- or is held in local tiles.
+        // Either way, gather it in chunks with get_pixels.
         const imagesize_t budget = 1024*1024*64; // 64 MB
         imagesize_t imagesize = bufspec.image_bytes();
         if (imagesize <= budget) {
@@ -1109,15 +1855,210 @@ ImageBuf::write (string_view _filename, string_view _fileformat,
 bool
 ImageBuf::make_writeable (bool keep_cache_type)
 {
-    if (storage() == IMAGECACHE) {
-        return read (subimage(), miplevel(), 0, -1, true /*force*/,
-                     keep_cache_type ? impl()->m_cachedpixeltype : TypeDesc());
+    if (storage() == IMAGECACHE &&
+          ! read (subimage(), miplevel(), 0, -1, true /*force*/,
+                  keep_cache_type ? impl()->m_cachedpixeltype : TypeDesc()))
+        return false;
+    impl()->make_pixels_unique ();   // e.g. if the read memory-mapped it
+    return true;
+}
+
+
+
+bool
+ImageBufImpl::make_view (const ImageBufImpl &src, ROI roi)
+{
+    src.validate_pixels ();
+    const ImageSpec &srcspec (src.m_spec);
+    if (! roi.defined())
+        roi = get_roi (srcspec);
+    // Only whole pixels of in-memory, non-tiled, owned (or themselves
+    // viewed) pixels can be viewed, and only within the data window.
+    bool src_ok = (src.m_storage == ImageBuf::LOCALBUFFER &&
+                   src.m_localpixels && src.m_pixels) || src.is_view();
+    if (! src_ok || srcspec.deep || &src == this || roi.npixels() == 0 ||
+        roi.chbegin != 0 || std::min (roi.chend, srcspec.nchannels) != srcspec.nchannels ||
+        roi.xbegin < srcspec.x || roi.xend > srcspec.x+srcspec.width ||
+        roi.ybegin < srcspec.y || roi.yend > srcspec.y+srcspec.height ||
+        roi.zbegin < srcspec.z || roi.zend > srcspec.z+srcspec.depth)
+        return false;
+
+    ImageSpec spec (srcspec);
+    set_roi (spec, roi);
+    spec.tile_width = 0;
+    spec.tile_height = 0;
+    spec.tile_depth = 0;
+    char *origin = (char *) src.pixeladdr (roi.xbegin, roi.ybegin, roi.zbegin);
+    stride_t ystride, zstride;
+    if (src.is_view()) {
+        ystride = src.m_view_ystride;
+        zstride = src.m_view_zstride;
+    } else {
+        ystride = src.m_scanline_bytes;
+        zstride = src.m_plane_bytes;
+        src.m_pixels_shared = true;
+    }
+    PixelMemPtr pixels (src.m_pixels);  // hold on, clear() may drop src's
+    clear ();
+    m_spec = spec;
+    m_nativespec = spec;
+    m_pixel_bytes = spec.pixel_bytes();
+    m_scanline_bytes = spec.scanline_bytes();
+    m_plane_bytes = clamped_mult64 (m_scanline_bytes, (imagesize_t)m_spec.height);
+    m_blackpixel.resize (round_to_multiple (m_pixel_bytes, OIIO_SIMD_MAX_SIZE_BYTES), 0);
+    m_pixels = pixels;
+    m_viewpixels = origin;
+    m_view_ystride = ystride;
+    m_view_zstride = zstride;
+    m_storage = ImageBuf::VIEWBUFFER;
+    m_spec_valid = true;
+    m_pixels_valid = true;
+    return true;
+}
+
+
+
+bool
+ImageBuf::make_view (const ImageBuf &src, ROI roi)
+{
+    return impl()->make_view (*src.impl(), roi);
+}
+
+
+
+void
+ImageBufImpl::unshare_pixels ()
+{
+    spin_lock lock (m_valid_mutex);
+    if (is_view()) {
+        // Copy the viewed pixels into memory of our own
+        PixelMemPtr viewed (m_pixels);
+        char *origin = m_viewpixels;
+        stride_t ystride = m_view_ystride, zstride = m_view_zstride;
+        realloc ();
+        size_t rowbytes = m_spec.width * m_pixel_bytes;
+        for (int z = 0;  z < m_spec.depth;  ++z)
+            for (int y = 0;  y < m_spec.height;  ++y) {
+                const char *row = origin + y*ystride + z*zstride;
+                if (has_localtiles()) {
+                    for (int x = 0;  x < m_spec.width;  ++x)
+                        memcpy (localtile_pixel (x, y, z),
+                                row + x*m_pixel_bytes, m_pixel_bytes);
+                } else {
+                    memcpy (m_localpixels + y*m_scanline_bytes + z*m_plane_bytes,
+                            row, rowbytes);
+                }
+            }
+    } else if (m_pixels_shared) {
+        // Views or copies of our pixels may still exist -- they keep the
+        // old memory, and we get a copy.
+        if (m_pixels.use_count() > 1) {
+            size_t size = m_spec.image_bytes(), counted;
+            PixelMemPtr copy = pixelmem_make_or_spill (size, counted);
+            memcpy (copy.get(), m_pixels.get(), size);
+            m_pixels = copy;
+            m_localpixels = m_pixels.get();
+            IB_local_mem_add ((long long)counted - (long long)m_allocated_size);
+            m_allocated_size = counted;
+        }
     }
+    m_pixels_shared = false;
+}
+
+
+
+bool
+ImageBufImpl::share_pixels (const ImageBufImpl &src, bool keep_spec)
+{
+    src.validate_pixels ();
+    if (&src == this || src.m_storage != ImageBuf::LOCALBUFFER ||
+        ! src.m_localpixels || ! src.m_pixels || src.m_spec.deep ||
+        m_localtile_width > 0)
+        return false;
+    const ImageSpec &srcspec (src.m_spec);
+    if (keep_spec) {
+        validate_pixels ();
+        if (m_storage != ImageBuf::LOCALBUFFER || ! m_localpixels ||
+            m_spec.deep || m_spec.x != srcspec.x || m_spec.y != srcspec.y ||
+            m_spec.z != srcspec.z || m_spec.width != srcspec.width ||
+            m_spec.height != srcspec.height || m_spec.depth != srcspec.depth ||
+            m_spec.nchannels != srcspec.nchannels ||
+            m_spec.format != srcspec.format ||
+            m_spec.channelformats != srcspec.channelformats)
+            return false;
+    } else {
+        ustring name = src.m_name;   // in case clear() frees it
+        clear ();
+        m_name = name;
+        m_current_subimage = 0;
+        m_current_miplevel = 0;
+        m_spec = srcspec;
+        m_nativespec = srcspec;
+        m_pixel_bytes = srcspec.pixel_bytes();
+        m_scanline_bytes = srcspec.scanline_bytes();
+        m_plane_bytes = clamped_mult64 (m_scanline_bytes, (imagesize_t)m_spec.height);
+        m_blackpixel.resize (round_to_multiple (m_pixel_bytes, OIIO_SIMD_MAX_SIZE_BYTES), 0);
+        m_spec_valid = true;
+    }
+    // Shared memory is only counted once, by whoever allocated it.
+    IB_local_mem_current -= m_allocated_size;
+    m_allocated_size = 0;
+    m_pixels = src.m_pixels;
+    m_localpixels = m_pixels.get();
+    m_storage = ImageBuf::LOCALBUFFER;
+    m_pixels_valid = true;
+    m_pixels_shared = true;
+    src.m_pixels_shared = true;
     return true;
 }
 
 
 
+bool
+ImageBufImpl::set_local_tiles (ImageBuf &ib, int width, int height, int depth)
+{
+    if (m_storage == ImageBuf::APPBUFFER) {
+        error ("ImageBuf wrapping an application buffer can't use local tiles");
+        return false;
+    }
+    if (width > 0) {
+        height = std::max (height, 1);
+        depth = std::max (depth, 1);
+    } else {
+        width = height = depth = 0;
+    }
+    if (width == m_localtile_width && height == m_localtile_height &&
+          depth == m_localtile_depth)
+        return true;   // Nothing to change
+
+    if (m_storage != ImageBuf::LOCALBUFFER || m_spec.deep) {
+        // No local pixels yet -- just remember for when they're allocated
+        m_localtile_width = width;
+        m_localtile_height = height;
+        m_localtile_depth = depth;
+        return true;
+    }
+
+    // Move the pixels we have into the new layout.
+    ImageBuf old (ib);
+    m_localtile_width = width;
+    m_localtile_height = height;
+    m_localtile_depth = depth;
+    realloc ();
+    return ib.copy_pixels (old);
+}
+
+
+
+bool
+ImageBuf::set_local_tiles (int width, int height, int depth)
+{
+    impl()->validate_pixels ();
+    return impl()->set_local_tiles (*this, width, height, depth);
+}
+
+
+
 void
 ImageBufImpl::copy_metadata (const ImageBufImpl &src)
 {
@@ -1270,6 +2211,8 @@ void *
 ImageBuf::localpixels ()
 {
     impl()->validate_pixels ();
+    if (! impl()->is_view())   // views have no local pixels to write to
+        impl()->make_pixels_unique ();
     return impl()->m_localpixels;
 }
 
@@ -1367,7 +2310,7 @@ copy_pixels_impl (ImageBuf &dst, const ImageBuf &src, ROI roi, int nthreads=0)
     int nchannels = roi.nchannels();
     if (is_same<D,S>::value) {
         // If both bufs are the same type, just directly copy the values
-        if (src.localpixels() && roi.chbegin == 0 &&
+        if (src.localpixels() && dst.localpixels() && roi.chbegin == 0 &&
             roi.chend == dst.nchannels() && roi.chend == src.nchannels()) {
             // Extra shortcut -- totally local pixels for src, copying all
             // channels, so we can copy memory around line by line, rather
@@ -1382,11 +2325,19 @@ copy_pixels_impl (ImageBuf &dst, const ImageBuf &src, ROI roi, int nthreads=0)
                         draw[x] = sraw[x];
                 }
         } else {
+            // Copy whole runs of pixels that are contiguous in both
             ImageBuf::Iterator<D,D> d (dst, roi);
             ImageBuf::ConstIterator<D,D> s (src, roi);
-            for ( ; ! d.done();  ++d, ++s) {
-                for (int c = 0;  c < nchannels;  ++c)
-                    d[c] = s[c];
+            int dchans = dst.nchannels(), schans = src.nchannels();
+            for ( ; ! d.done(); ) {
+                int n = std::min (d.span(), s.span());
+                D *draw = (D *) d.rawptr() + roi.chbegin;
+                const D *sraw = (const D *) s.rawptr() + roi.chbegin;
+                for (int x = 0;  x < n;  ++x, draw += dchans, sraw += schans)
+                    for (int c = 0;  c < nchannels;  ++c)
+                        draw[c] = sraw[c];
+                d.advance (n);
+                s.advance (n);
             }
         }
     } else {
@@ -1418,6 +2369,10 @@ ImageBuf::copy_pixels (const ImageBuf &src)
     ROI myroi = get_roi(spec());
     ROI roi = roi_intersection (myroi, get_roi(src.spec()));
 
+    // Identical layouts can simply share the pixels until one is written
+    if (impl()->share_pixels (*src.impl(), true /*keep_spec*/))
+        return true;
+
     // If we aren't copying over all our pixels, zero out the pixels
     if (roi != myroi)
         ImageBufAlgo::zero (*this);
@@ -1445,6 +2400,10 @@ ImageBuf::copy (const ImageBuf &src, TypeDesc format)
         impl()->m_deepdata = src.impl()->m_deepdata;
         return true;
     }
+    if ((format.basetype == TypeDesc::UNKNOWN ||
+         (format == src.spec().format && src.spec().channelformats.empty()))
+          && impl()->share_pixels (*src.impl(), false /*keep_spec*/))
+        return true;   // copy-on-write
     if (format.basetype == TypeDesc::UNKNOWN || src.deep())
         reset (src.name(), src.spec());
     else {
@@ -1716,13 +2675,28 @@ get_pixels_ (const ImageBuf &buf, ROI whole_roi, ROI roi, void *r_,
 
     D *r = (D *)r_;
     int nchans = roi.nchannels();
-    for (ImageBuf::ConstIterator<S,D> p (buf, roi); !p.done(); ++p) {
+    int bufchans = buf.nchannels();
+    // If we want all the channels, packed, each span of contiguous buffer
+    // pixels can be converted in one shot.
+    bool packed = (roi.chbegin == 0 && nchans == bufchans &&
+                   xstride == stride_t(nchans * sizeof(D)));
+    for (ImageBuf::ConstIterator<S,D> p (buf, roi); !p.done(); ) {
         imagesize_t offset = (p.z()-whole_roi.zbegin)*zstride
                            + (p.y()-whole_roi.ybegin)*ystride
                            + (p.x()-whole_roi.xbegin)*xstride;
         D *rc = (D *)((char *)r + offset);
-        for (int c = 0;  c < nchans;  ++c)
-            rc[c] = p[c+roi.chbegin];
+        int n = p.span ();
+        const S *s = (const S *) p.rawptr() + roi.chbegin;
+        if (packed) {
+            convert_type<S,D> (s, rc, size_t(n) * nchans);
+        } else {
+            for (int x = 0;  x < n;  ++x, s += bufchans) {
+                for (int c = 0;  c < nchans;  ++c)
+                    rc[c] = convert_type<S,D> (s[c]);
+                rc = (D *)((char *)rc + xstride);
+            }
+        }
+        p.advance (n);
     }
     return true;
 }
@@ -1804,15 +2778,28 @@ set_pixels_ (ImageBuf &buf, ROI roi, const void *data_,
     const D *data = (const D *)data_;
     int w = roi.width(), h = roi.height(), nchans = roi.nchannels();
     ImageSpec::auto_stride (xstride, ystride, zstride, sizeof(S), nchans, w, h);
-    for (ImageBuf::Iterator<D,S> p (buf, roi);  !p.done();  ++p) {
-        if (! p.exists())
+    // As in get_pixels_, all channels from packed data can be converted a
+    // whole span at a time.
+    bool packed = (roi.chbegin == 0 && nchans == buf.nchannels() &&
+                   xstride == stride_t(nchans * sizeof(S)));
+    for (ImageBuf::Iterator<D,S> p (buf, roi);  !p.done(); ) {
+        if (! p.exists()) {
+            ++p;
             continue;
+        }
         imagesize_t offset = (p.z()-roi.zbegin)*zstride
                            + (p.y()-roi.ybegin)*ystride
                            + (p.x()-roi.xbegin)*xstride;
         const S *src = (const S *)((const char *)data + offset);
-        for (int c = 0;  c < nchans;  ++c)
-            p[c+roi.chbegin] = src[c];
+        if (packed) {
+            int n = p.span ();
+            convert_type<S,D> (src, (D *)p.rawptr(), size_t(n) * nchans);
+            p.advance (n);
+        } else {
+            for (int c = 0;  c < nchans;  ++c)
+                p[c+roi.chbegin] = src[c];
+            ++p;
+        }
     }
     return true;
 }
@@ -2179,7 +3166,7 @@ ImageBuf::set_roi_full (const ROI &newroi)
 bool
 ImageBuf::contains_roi (ROI roi) const
 {
-    ROI myroi = roi;
+    ROI myroi = this->roi();
     return (roi.defined() && myroi.defined() &&
             roi.xbegin >= myroi.xbegin && roi.xend <= myroi.xend &&
             roi.ybegin >= myroi.ybegin && roi.yend <= myroi.yend &&
@@ -2198,6 +3185,10 @@ ImageBufImpl::pixeladdr (int x, int y, int z) const
     x -= m_spec.x;
     y -= m_spec.y;
     z -= m_spec.z;
+    if (has_localtiles())
+        return localtile_pixel (x, y, z);
+    if (is_view())
+        return view_pixel (x, y, z);
     size_t p = y * m_scanline_bytes + x * m_pixel_bytes
              + z * m_plane_bytes;
     return &(m_localpixels[p]);
@@ -2211,9 +3202,12 @@ ImageBufImpl::pixeladdr (int x, int y, int z)
     validate_pixels ();
     if (cachedpixels())
         return NULL;
+    make_pixels_unique ();
     x -= m_spec.x;
     y -= m_spec.y;
     z -= m_spec.z;
+    if (has_localtiles())
+        return localtile_pixel (x, y, z);
     size_t p = y * m_scanline_bytes + x * m_pixel_bytes
              + z * m_plane_bytes;
     return &(m_localpixels[p]);
@@ -2328,6 +3322,33 @@ ImageBufImpl::retile (int x, int y, int z, ImageCache::Tile* &tile,
              y >= m_spec.y && y < m_spec.y+m_spec.height &&
              z >= m_spec.z && z < m_spec.z+m_spec.depth);
 
+    if (is_view()) {
+        // A view is handed out one scanline at a time, as if each row
+        // were a tile.  As with local tiles, the iterator never releases it.
+        tilexbegin = m_spec.x;
+        tileybegin = y;
+        tilezbegin = z;
+        tilexend = m_spec.x + m_spec.width;
+        tile = (ImageCache::Tile *) view_pixel (0, y-m_spec.y, z-m_spec.z);
+        return view_pixel (x-m_spec.x, y-m_spec.y, z-m_spec.z);
+    }
+
+    if (has_localtiles()) {
+        // Local tiles aren't ImageCache tiles.  Point tile at the tile's
+        // memory anyway, so that the iterator knows it holds one; the
+        // iterator never releases it (see IteratorBase::release_tile).
+        int tw = m_localtile_width, th = m_localtile_height;
+        int td = m_localtile_depth;
+        tilexbegin = m_spec.x + (x-m_spec.x) / tw * tw;
+        tileybegin = m_spec.y + (y-m_spec.y) / th * th;
+        tilezbegin = m_spec.z + (z-m_spec.z) / td * td;
+        tilexend = tilexbegin + tw;
+        tile = (ImageCache::Tile *) localtile_pixel (tilexbegin-m_spec.x,
+                                                     tileybegin-m_spec.y,
+                                                     tilezbegin-m_spec.z);
+        return localtile_pixel (x-m_spec.x, y-m_spec.y, z-m_spec.z);
+    }
+
     int tw = m_spec.tile_width, th = m_spec.tile_height;
     int td = m_spec.tile_depth;  DASSERT(m_spec.tile_depth >= 1);
     DASSERT (tile == NULL || tilexend == (tilexbegin+tw));
@@ -2379,4 +3400,38 @@ ImageBuf::retile (int x, int y, int z, ImageCache::Tile* &tile,
 
 
 
+bool
+read_images (array_view<ImageBuf * const> bufs,
+             array_view<const std::string> filenames,
+             TypeDesc convert, int nthreads, ImageCache *imagecache)
+{
+    size_t n = filenames.size();
+    ASSERT (bufs.size() >= n);
+    thread_pool *pool (default_thread_pool());
+    if (nthreads <= 0)
+        nthreads = std::max (1, pool->size());
+    nthreads = (int) std::min (size_t(nthreads), n);
+
+    // Each worker claims the next unread file until there are none left,
+    // so one slow file doesn't hold up a whole share of the others.
+    std::atomic<size_t> next (0);
+    std::atomic<bool> ok (true);
+    auto worker = [&](int /*id*/) {
+        for (size_t i; (i = next++) < n; ) {
+            bufs[i]->reset (filenames[i], imagecache);
+            if (! bufs[i]->read (0, 0, true, convert))
+                ok = false;
+        }
+    };
+    task_set<void> tasks (pool);
+    for (int t = 1; t < nthreads; ++t)
+        tasks.push (pool->push (worker));
+    if (nthreads > 0)
+        worker (-1);   // the calling thread works too
+    tasks.wait ();
+    return ok;
+}
+
+
+
 OIIO_NAMESPACE_END
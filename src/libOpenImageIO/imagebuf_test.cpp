@@ -32,6 +32,7 @@
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/deepdata.h>
 #include <OpenImageIO/unittest.h>
 
 #include <iostream>
@@ -359,6 +360,501 @@ test_read_channel_subset ()
 
 
 
+void
+test_local_tiles ()
+{
+    std::cout << "\nTesting local tiles\n";
+    ImageBufAlgo::CompareResults cr;
+    // An odd size, so that the edge tiles are partly outside the image
+    ImageSpec spec (13, 11, 3, TypeDesc::FLOAT);
+    spec.x = spec.full_x = 2;
+    spec.y = spec.full_y = -1;
+    ImageBuf A (spec);
+    for (ImageBuf::Iterator<float> p (A);  ! p.done();  ++p)
+        for (int c = 0;  c < 3;  ++c)
+            p[c] = p.x() * 100 + p.y() * 10 + c;
+
+    // Tiles set up before the pixels are allocated
+    ImageBuf B;
+    OIIO_CHECK_ASSERT (B.set_local_tiles (4, 4));
+    B.reset (spec);
+    OIIO_CHECK_ASSERT (B.localpixels() == NULL);
+    OIIO_CHECK_EQUAL (B.storage(), ImageBuf::LOCALBUFFER);
+    OIIO_CHECK_ASSERT (B.copy_pixels (A));
+    for (ImageBuf::ConstIterator<float> a (A), b (B);  ! a.done();  ++a, ++b) {
+        for (int c = 0;  c < 3;  ++c)
+            OIIO_CHECK_EQUAL (a[c], b[c]);
+        OIIO_CHECK_EQUAL (*(const float *)B.pixeladdr (a.x(), a.y()), a[0]);
+    }
+    float pixel[3];
+    B.getpixel (spec.x+5, spec.y+9, pixel);
+    OIIO_CHECK_EQUAL (pixel[2], (spec.x+5) * 100 + (spec.y+9) * 10 + 2);
+    ImageBufAlgo::compare (A, B, 0.0f, 0.0f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+
+    // Wrapping off the edge of a tiled buffer
+    ImageBuf::ConstIterator<float> w (B, ROI(-10, 30, -10, 30),
+                                      ImageBuf::WrapClamp);
+    w.pos (spec.x + spec.width + 3, spec.y - 4);
+    OIIO_CHECK_EQUAL (w[0], A.getchannel (spec.x+spec.width-1, spec.y, 0, 0));
+
+    // Existing pixels moved into a tiled layout, and back
+    ImageBuf C (A);
+    OIIO_CHECK_ASSERT (C.set_local_tiles (8, 2));
+    OIIO_CHECK_ASSERT (C.localpixels() == NULL);
+    ImageBufAlgo::compare (A, C, 0.0f, 0.0f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+    OIIO_CHECK_ASSERT (C.set_local_tiles (0, 0));
+    OIIO_CHECK_ASSERT (C.localpixels() != NULL);
+    ImageBufAlgo::compare (A, C, 0.0f, 0.0f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+}
+
+
+
+void
+test_iterator_spans ()
+{
+    std::cout << "\nTesting iterator spans\n";
+    ImageSpec spec (10, 5, 2, TypeDesc::FLOAT);
+    ImageBuf A (spec);
+    for (ImageBuf::Iterator<float> p (A);  ! p.done();  ++p)
+        p[0] = p[1] = p.y() * 10 + p.x();
+    // Contiguous buffer: spans are the rest of the row within the range.
+    // Local tiles: spans also stop at tile edges.
+    ImageBuf B;
+    B.set_local_tiles (4, 4);
+    B.copy (A);
+    for (int tiled = 0;  tiled < 2;  ++tiled) {
+        const ImageBuf &buf (tiled ? B : A);
+        ROI roi (1, 9, 1, 4);
+        int npixels = 0;
+        for (ImageBuf::ConstIterator<float> p (buf, roi);  ! p.done(); ) {
+            int n = p.span ();
+            OIIO_CHECK_EQUAL (n, tiled ? std::min (roi.xend, (p.x()/4+1)*4) - p.x()
+                                       : roi.xend - p.x());
+            const float *f = (const float *) p.rawptr ();
+            for (int x = 0;  x < n;  ++x, f += 2)
+                OIIO_CHECK_EQUAL (f[0], p.y() * 10 + p.x() + x);
+            npixels += n;
+            p.advance (n);
+        }
+        OIIO_CHECK_EQUAL (npixels, int(roi.npixels()));
+    }
+}
+
+
+
+void
+test_pixel_pool ()
+{
+    std::cout << "\nTesting pixel memory pool\n";
+    OIIO::attribute ("imagebuf:pool_MB", 16);
+    long long reused0 = 0, reused1 = 0, pooled = 0;
+    OIIO::getattribute ("stat:imagebuf:pool_reused_bytes", TypeDesc::INT64, &reused0);
+    ImageSpec spec (64, 64, 3, TypeDesc::FLOAT);
+    {
+        ImageBuf A (spec);
+        ImageBufAlgo::zero (A);
+    }
+    OIIO::getattribute ("stat:imagebuf:pool_bytes", TypeDesc::INT64, &pooled);
+    OIIO_CHECK_ASSERT (pooled >= (long long) spec.image_bytes());
+    {
+        // Same size again should come straight from the pool
+        ImageBuf B (spec);
+        ImageBufAlgo::zero (B);
+        OIIO_CHECK_EQUAL (B.getchannel (63, 63, 0, 2), 0.0f);
+    }
+    OIIO::getattribute ("stat:imagebuf:pool_reused_bytes", TypeDesc::INT64, &reused1);
+    OIIO_CHECK_ASSERT (reused1 - reused0 >= (long long) spec.image_bytes());
+    // Turning the pool off releases everything it holds
+    OIIO::attribute ("imagebuf:pool_MB", 0);
+    OIIO::getattribute ("stat:imagebuf:pool_bytes", TypeDesc::INT64, &pooled);
+    OIIO_CHECK_EQUAL (pooled, 0);
+}
+
+
+
+void
+test_views ()
+{
+    std::cout << "\nTesting views\n";
+    ImageSpec spec (10, 8, 2, TypeDesc::FLOAT);
+    ImageBuf A (spec);
+    for (ImageBuf::Iterator<float> p (A);  ! p.done();  ++p)
+        p[0] = p[1] = p.y() * 10 + p.x();
+    ROI roi (2, 7, 3, 6);
+    {
+        // A crop within the data window is a view, reading A's pixels
+        ImageBuf B;
+        OIIO_CHECK_ASSERT (ImageBufAlgo::crop (B, A, roi));
+        OIIO_CHECK_EQUAL (B.storage(), ImageBuf::VIEWBUFFER);
+        OIIO_CHECK_ASSERT (B.localpixels() == NULL);
+        OIIO_CHECK_EQUAL (B.roi(), roi);
+        for (ImageBuf::ConstIterator<float> p (B);  ! p.done();  ++p)
+            OIIO_CHECK_EQUAL (p[1], p.y() * 10 + p.x());
+        // Writing to the view copies it, leaving A alone
+        float val[2] = { -1.0f, -1.0f };
+        B.setpixel (3, 4, val);
+        OIIO_CHECK_EQUAL (B.storage(), ImageBuf::LOCALBUFFER);
+        OIIO_CHECK_EQUAL (B.getchannel (3, 4, 0, 0), -1.0f);
+        OIIO_CHECK_EQUAL (B.getchannel (4, 4, 0, 0), 44.0f);
+        OIIO_CHECK_EQUAL (A.getchannel (3, 4, 0, 0), 43.0f);
+    }
+    {
+        // Writing to the parent doesn't change its views, even after the
+        // parent is gone
+        ImageBuf P (A), C, D;
+        OIIO_CHECK_ASSERT (C.make_view (P, roi));
+        OIIO_CHECK_ASSERT (D.make_view (C, ROI (4, 6, 4, 5)));
+        ImageBufAlgo::zero (P);
+        OIIO_CHECK_EQUAL (P.getchannel (3, 4, 0, 0), 0.0f);
+        OIIO_CHECK_EQUAL (C.getchannel (3, 4, 0, 0), 43.0f);
+        P.clear ();
+        OIIO_CHECK_EQUAL (D.getchannel (5, 4, 0, 1), 45.0f);
+        ImageBuf E;
+        ImageBufAlgo::cut (E, C, ROI (4, 6, 4, 5));
+        OIIO_CHECK_EQUAL (E.storage(), ImageBuf::VIEWBUFFER);
+        OIIO_CHECK_EQUAL (E.getchannel (1, 0, 0, 0), 45.0f);
+    }
+    // Regions outside the data window, or channel subsets, can't be views
+    ImageBuf F;
+    OIIO_CHECK_ASSERT (! F.make_view (A, ROI (5, 12, 0, 4)));
+    OIIO_CHECK_ASSERT (! F.make_view (A, ROI (0, 4, 0, 4, 0, 1, 0, 1)));
+    OIIO_CHECK_ASSERT (ImageBufAlgo::crop (F, A, ROI (5, 12, 0, 4)));
+    OIIO_CHECK_EQUAL (F.storage(), ImageBuf::LOCALBUFFER);
+}
+
+
+
+void
+test_copy_on_write ()
+{
+    std::cout << "\nTesting copy-on-write copies\n";
+    ImageSpec spec (8, 6, 3, TypeDesc::FLOAT);
+    ImageBuf A (spec);
+    for (ImageBuf::Iterator<float> p (A);  ! p.done();  ++p)
+        p[0] = p[1] = p[2] = p.y() * 10 + p.x();
+    const ImageBuf &Aconst (A);
+    ImageBuf B (A), C;
+    C.copy (A);
+    const ImageBuf &Bconst (B), &Cconst (C);
+    // Copies share A's pixels...
+    OIIO_CHECK_ASSERT (Bconst.localpixels() == Aconst.localpixels());
+    OIIO_CHECK_ASSERT (Cconst.localpixels() == Aconst.localpixels());
+    // ...until one is written
+    float val[3] = { -1.0f, -1.0f, -1.0f };
+    B.setpixel (2, 3, val);
+    OIIO_CHECK_ASSERT (Bconst.localpixels() != Aconst.localpixels());
+    OIIO_CHECK_EQUAL (B.getchannel (2, 3, 0, 1), -1.0f);
+    OIIO_CHECK_EQUAL (A.getchannel (2, 3, 0, 1), 32.0f);
+    OIIO_CHECK_EQUAL (C.getchannel (2, 3, 0, 1), 32.0f);
+    ImageBufAlgo::zero (A);
+    OIIO_CHECK_EQUAL (A.getchannel (2, 3, 0, 1), 0.0f);
+    OIIO_CHECK_EQUAL (C.getchannel (2, 3, 0, 1), 32.0f);
+    // A format change really copies
+    ImageBuf D;
+    D.copy (C, TypeDesc::HALF);
+    OIIO_CHECK_EQUAL (D.spec().format, TypeDesc::HALF);
+    OIIO_CHECK_EQUAL (D.getchannel (2, 3, 0, 1), 32.0f);
+    // copy_pixels between identical layouts shares, too
+    ImageBuf E (spec);
+    E.copy_pixels (C);
+    OIIO_CHECK_ASSERT (((const ImageBuf &)E).localpixels() == Cconst.localpixels());
+    OIIO_CHECK_EQUAL (E.getchannel (7, 5, 0, 2), 57.0f);
+}
+
+
+
+void
+test_async_io ()
+{
+    std::cout << "\nTesting read_async/write_async\n";
+    ImageSpec spec (64, 32, 3, TypeDesc::FLOAT);
+    ImageBuf A (spec);
+    float white[3] = { 1.0f, 0.5f, 0.25f };
+    ImageBufAlgo::fill (A, white);
+    std::future<bool> w = A.write_async ("async.tif");
+    OIIO_CHECK_ASSERT (w.get());
+    ImageBuf B ("async.tif");
+    std::future<bool> r = B.read_async (0, 0, true /*force*/, TypeDesc::FLOAT);
+    OIIO_CHECK_ASSERT (r.get());
+    OIIO_CHECK_EQUAL (B.storage(), ImageBuf::LOCALBUFFER);
+    ImageBufAlgo::CompareResults cr;
+    ImageBufAlgo::compare (A, B, 0.0f, 0.0f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+}
+
+
+
+// Writing to a different data format converts in chunks on our side;
+// make sure the result is what a plain conversion gives, for scanline
+// and tiled files, and for local pixels and views.
+void
+test_write_converted ()
+{
+    std::cout << "\nTesting write with data format conversion\n";
+    ImageSpec spec (67, 45, 3, TypeDesc::FLOAT);
+    ImageBuf A (spec);
+    float tl[3] = { 0.0f, 0.25f, 1.0f }, br[3] = { 1.0f, 0.5f, 0.0f };
+    ImageBufAlgo::fill (A, tl, tl, br, br);
+    ImageBuf ref;
+    ref.copy (A, TypeDesc::UINT8);
+    ImageBuf V;
+    V.make_view (A);
+    for (int tiled = 0; tiled < 2; ++tiled) {
+        for (const ImageBuf *src : { (const ImageBuf *)&A, (const ImageBuf *)&V }) {
+            ImageBuf S (*src);
+            S.set_write_format (TypeDesc::UINT8);
+            if (tiled)
+                S.set_write_tiles (16, 16);
+            OIIO_CHECK_ASSERT (S.write ("convert.tif"));
+            ImageBuf B ("convert.tif");
+            OIIO_CHECK_EQUAL (B.spec().format, TypeDesc::UINT8);
+            OIIO_CHECK_EQUAL (B.spec().tile_width, tiled ? 16 : 0);
+            ImageBufAlgo::CompareResults cr;
+            ImageBufAlgo::compare (ref, B, 0.0f, 0.0f, cr);
+            OIIO_CHECK_EQUAL (cr.nfail, 0);
+        }
+    }
+}
+
+
+
+// Forced reads of uncompressed, native-layout files can map the file.
+void
+test_mmap_read ()
+{
+    std::cout << "\nTesting memory-mapped reads\n";
+    ImageSpec spec (64, 48, 3, TypeDesc::UINT8);
+    spec.attribute ("compression", "none");
+    ImageBuf A (spec);
+    float tl[3] = { 0.0f, 0.25f, 1.0f }, br[3] = { 1.0f, 0.5f, 0.0f };
+    ImageBufAlgo::fill (A, tl, tl, br, br);
+    int oldmmap = 0;
+    OIIO::getattribute ("imagebuf:mmap", oldmmap);
+    OIIO::attribute ("imagebuf:mmap", 1);
+    for (const char *name : { "mmap.tif", "mmap.ppm" }) {
+        OIIO_CHECK_ASSERT (A.write (name));
+        ImageBuf B (name);
+        OIIO_CHECK_ASSERT (B.read (0, 0, true /*force*/));
+        OIIO_CHECK_EQUAL (B.storage(), ImageBuf::MMAPBUFFER);
+        ImageBufAlgo::CompareResults cr;
+        ImageBufAlgo::compare (A, B, 0.0f, 0.0f, cr);
+        OIIO_CHECK_EQUAL (cr.nfail, 0);
+        // Writing copies the pixels out of the mapping
+        float red[3] = { 1.0f, 0.0f, 0.0f };
+        B.setpixel (1, 1, red);
+        OIIO_CHECK_EQUAL (B.storage(), ImageBuf::LOCALBUFFER);
+        ImageBuf C (name);
+        OIIO_CHECK_ASSERT (C.read (0, 0, true /*force*/));
+        ImageBufAlgo::compare (A, C, 0.0f, 0.0f, cr);
+        OIIO_CHECK_EQUAL (cr.nfail, 0);
+    }
+    OIIO::attribute ("imagebuf:mmap", oldmmap);
+}
+
+
+
+// Allocations past the spill budget are backed by a scratch file.
+void
+test_spill ()
+{
+    std::cout << "\nTesting spill to disk\n";
+    int oldspill = 0;
+    OIIO::getattribute ("imagebuf:spill_MB", oldspill);
+    OIIO::attribute ("imagebuf:spill_MB", 1);
+    long long spilled = -1;
+    {
+        ImageBuf A (ImageSpec (1024, 1024, 4, TypeDesc::FLOAT)); // 16 MB
+        OIIO::getattribute ("stat:imagebuf:spilled_bytes", TypeDesc::INT64, &spilled);
+        OIIO_CHECK_EQUAL (spilled, 16*1024*1024);
+        OIIO_CHECK_EQUAL (A.storage(), ImageBuf::LOCALBUFFER);
+        OIIO_CHECK_ASSERT (A.localpixels() != NULL);
+        float color[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+        ImageBufAlgo::fill (A, color);
+        ImageBufAlgo::PixelStats stats;
+        ImageBufAlgo::computePixelStats (stats, A);
+        OIIO_CHECK_EQUAL (stats.min[2], 0.75f);
+        OIIO_CHECK_EQUAL (stats.max[2], 0.75f);
+    }
+    OIIO::getattribute ("stat:imagebuf:spilled_bytes", TypeDesc::INT64, &spilled);
+    OIIO_CHECK_EQUAL (spilled, 0);
+    OIIO::attribute ("imagebuf:spill_MB", oldspill);
+}
+
+
+
+// Reading with a color transform matches reading and then converting.
+void
+test_read_colorconvert ()
+{
+    std::cout << "\nTesting read with color conversion\n";
+    ImageSpec spec (200, 150, 4, TypeDesc::UINT16);
+    ImageBuf A (spec);
+    float tl[4] = { 0.0f, 0.25f, 1.0f, 1.0f }, br[4] = { 1.0f, 0.5f, 0.0f, 0.5f };
+    ImageBufAlgo::fill (A, tl, tl, br, br);
+    for (const char *name : { "cc_scan.tif", "cc_tile.tif" }) {
+        if (name[3] == 't')
+            A.set_write_tiles (64, 64);
+        OIIO_CHECK_ASSERT (A.write (name));
+        ImageBuf R (name);
+        OIIO_CHECK_ASSERT (R.read (0, 0, true /*force*/, TypeDesc::FLOAT));
+        ImageBuf Ref;
+        ImageBufAlgo::colorconvert (Ref, R, "sRGB", "linear", true,
+                                    "", "", NULL, ROI::All());
+        for (TypeDesc t : { TypeDesc::FLOAT, TypeDesc::UINT16 }) {
+            ImageBuf B (name);
+            OIIO_CHECK_ASSERT (B.read (0, 0, 0, -1, true, t, "sRGB", "linear",
+                                       true /*unpremult*/));
+            OIIO_CHECK_EQUAL (B.spec().format, t);
+            OIIO_CHECK_EQUAL (B.spec().get_string_attribute ("oiio:ColorSpace"),
+                              "linear");
+            ImageBufAlgo::CompareResults cr;
+            float eps = (t == TypeDesc::FLOAT) ? 1.0e-6f : 1.0f/65535.0f;
+            ImageBufAlgo::compare (Ref, B, eps, 0.0f, cr);
+            OIIO_CHECK_EQUAL (cr.nfail, 0);
+        }
+    }
+}
+
+
+
+void
+test_read_images ()
+{
+    std::cout << "\nTesting read_images\n";
+    std::vector<std::string> names;
+    for (int i = 0; i < 5; ++i) {
+        ImageBuf A (ImageSpec (32+i, 16, 3, TypeDesc::UINT8));
+        float val[3] = { float(i & 1), 0.5f, 1.0f };
+        ImageBufAlgo::fill (A, val);
+        names.push_back (Strutil::format ("readimages%d.tif", i));
+        OIIO_CHECK_ASSERT (A.write (names.back()));
+    }
+    names.push_back ("no_such_file.tif");
+    std::vector<ImageBuf> bufs (names.size());
+    std::vector<ImageBuf *> bufptrs;
+    for (auto &b : bufs)
+        bufptrs.push_back (&b);
+    OIIO_CHECK_ASSERT (! read_images (bufptrs, names, TypeDesc::FLOAT, 3));
+    for (int i = 0; i < 5; ++i) {
+        OIIO_CHECK_EQUAL (bufs[i].spec().width, 32+i);
+        OIIO_CHECK_EQUAL (bufs[i].spec().format, TypeDesc::FLOAT);
+        OIIO_CHECK_ASSERT (bufs[i].localpixels() != NULL);
+        OIIO_CHECK_EQUAL (bufs[i].getchannel (3, 4, 0, 0), float(i & 1));
+    }
+    OIIO_CHECK_ASSERT (bufs.back().has_error());
+    bufs.back().geterror ();
+}
+
+
+
+// The runtime-selected conversion kernels match the compile-time ones.
+void
+test_simd_dispatch ()
+{
+    std::cout << "\nTesting runtime SIMD dispatch\n";
+    std::cout << "  hw:simd = " << OIIO::get_string_attribute ("hw:simd") << "\n";
+    std::cout << "  oiio:simd = " << OIIO::get_string_attribute ("oiio:simd") << "\n";
+    std::cout << "  simd = " << OIIO::get_string_attribute ("simd") << "\n";
+    const int n = 1003;  // not a multiple of any SIMD width
+    std::vector<float> src (n);
+    for (int i = 0; i < n; ++i)
+        src[i] = (i - 100) / 800.0f;   // includes values outside [0,1]
+    for (TypeDesc t : { TypeDesc::UINT8, TypeDesc::UINT16, TypeDesc::HALF }) {
+        std::vector<char> best (n * t.size()), base (n * t.size());
+        std::vector<float> bestf (n), basef (n);
+        OIIO::attribute ("simd", "");
+        convert_types (TypeDesc::FLOAT, &src[0], t, &best[0], n);
+        convert_types (t, &best[0], TypeDesc::FLOAT, &bestf[0], n);
+        OIIO::attribute ("simd", "sse2");
+        convert_types (TypeDesc::FLOAT, &src[0], t, &base[0], n);
+        convert_types (t, &base[0], TypeDesc::FLOAT, &basef[0], n);
+        OIIO::attribute ("simd", "");
+        // Builds without SSE4.1 round exact halves away from zero rather
+        // than to even, so allow a difference of one code value.
+        float eps = (t == TypeDesc::UINT8) ? 1.0f/255.0f
+                  : (t == TypeDesc::UINT16) ? 1.0f/65535.0f : 0.0f;
+        int nfail = 0;
+        for (int i = 0; i < n; ++i)
+            nfail += fabsf (bestf[i] - basef[i]) > 1.001f * eps;
+        OIIO_CHECK_EQUAL (nfail, 0);
+    }
+}
+
+
+
+// Growing one pixel of allocated deep data must leave the others alone,
+// and the contiguous view must come back in the original packed layout.
+void
+test_deepdata_edits ()
+{
+    std::cout << "\nTesting DeepData edits\n";
+    const char *names[] = { "R", "A", "Z" };
+    std::vector<std::string> channelnames (names, names+3);
+    DeepData dd;
+    TypeDesc ftype = TypeDesc::FLOAT;
+    dd.init (4, 3, ftype, channelnames);
+    unsigned int nsamples[] = { 2, 1, 0, 3 };
+    dd.set_all_samples (nsamples);
+    for (int p = 0; p < 4; ++p)
+        for (int s = 0; s < dd.samples(p); ++s)
+            for (int c = 0; c < 3; ++c)
+                dd.set_deep_value (p, c, s, float(100*p + 10*s + c));
+
+    // Prepend samples to pixel 1, one at a time, then erase one.
+    for (int i = 0; i < 20; ++i) {
+        dd.insert_samples (1, 0);
+        dd.set_deep_value (1, 2, 0, float(-i));
+    }
+    dd.erase_samples (1, 0);
+    OIIO_CHECK_EQUAL (dd.samples(1), 20);
+    OIIO_CHECK_GE (dd.capacity(1), 21);
+    OIIO_CHECK_EQUAL (dd.deep_value (1, 2, 0), -18.0f);
+    OIIO_CHECK_EQUAL (dd.deep_value (1, 0, 19), 100.0f);
+    OIIO_CHECK_EQUAL (dd.deep_value (0, 1, 1), 11.0f);
+    OIIO_CHECK_EQUAL (dd.deep_value (3, 2, 2), 322.0f);
+
+    // Copies and the contiguous view are packed like a fresh allocation.
+    DeepData copy (dd);
+    size_t totalcap = 0;
+    for (int p = 0; p < 4; ++p)
+        totalcap += dd.capacity(p);
+    OIIO_CHECK_EQUAL (dd.all_data().size(), totalcap * dd.samplesize());
+    OIIO_CHECK_EQUAL ((const char *)dd.data_ptr (3, 0, 0) - dd.all_data().data(),
+                      ptrdiff_t((totalcap - 3) * dd.samplesize()));
+    OIIO_CHECK_EQUAL (copy.deep_value (1, 0, 19), 100.0f);
+    OIIO_CHECK_EQUAL (copy.deep_value (3, 2, 2), 322.0f);
+
+    // Sort pixel 1 by Z, then cull behind the first opaque sample.
+    dd.sort (1);
+    OIIO_CHECK_EQUAL (dd.deep_value (1, 2, 0), -18.0f);
+    OIIO_CHECK_EQUAL (dd.deep_value (1, 2, 19), 102.0f);
+    for (int s = 0; s < dd.samples(1); ++s)
+        dd.set_deep_value (1, 1, s, s == 13 ? 1.0f : 0.5f);
+    dd.occlusion_cull (1);
+    OIIO_CHECK_EQUAL (dd.samples(1), 14);
+
+    // Samples at the same depth merge: two half-transparent samples
+    // give alpha 0.75, and the colors of the rest shift down.
+    dd.set_samples (3, 3);
+    float vals[3][3] = { { 4.0f, 0.5f, 7.0f }, { 2.0f, 0.5f, 7.0f },
+                         { 9.0f, 1.0f, 1.0f } };
+    for (int s = 0; s < 3; ++s)
+        for (int c = 0; c < 3; ++c)
+            dd.set_deep_value (3, c, s, vals[s][c]);
+    dd.sort (3);
+    OIIO_CHECK_EQUAL (dd.deep_value (3, 2, 0), 1.0f);
+    dd.merge_overlaps (3);
+    OIIO_CHECK_EQUAL (dd.samples(3), 2);
+    OIIO_CHECK_EQUAL (dd.deep_value (3, 0, 0), 9.0f);
+    OIIO_CHECK_EQUAL (dd.deep_value (3, 1, 1), 0.75f);
+    OIIO_CHECK_EQUAL (dd.deep_value (3, 2, 1), 7.0f);
+}
+
+
+
 int
 main (int argc, char **argv)
 {
@@ -380,6 +876,19 @@ main (int argc, char **argv)
     test_read_channel_subset ();
 
     test_set_get_pixels ();
+    test_local_tiles ();
+    test_iterator_spans ();
+    test_pixel_pool ();
+    test_views ();
+    test_copy_on_write ();
+    test_async_io ();
+    test_write_converted ();
+    test_mmap_read ();
+    test_spill ();
+    test_read_colorconvert ();
+    test_read_images ();
+    test_simd_dispatch ();
+    test_deepdata_edits ();
 
     return unit_test_failures;
 }
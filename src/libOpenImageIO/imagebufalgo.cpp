@@ -42,7 +42,9 @@
 #include "OpenImageIO/platform.h"
 #include "OpenImageIO/filter.h"
 #include "OpenImageIO/thread.h"
+#include "OpenImageIO/simd.h"
 #include "kissfft.hh"
+#include "imageio_pvt.h"
 
 
 
@@ -386,6 +388,366 @@ convolve_ (ImageBuf &dst, const ImageBuf &src, const ImageBuf &kernel,
 
 
 
+// Is the 2D kernel (channel 0) the outer product of a column and a row
+// vector, to within float roundoff?  If so, return true and set col and
+// row so that kernel(x,y) == col[y]*row[x].
+static bool
+kernel_separable (const ImageBuf &kernel, std::vector<float> &col,
+                  std::vector<float> &row)
+{
+    const ImageSpec &kspec (kernel.spec());
+    if (kspec.depth != 1)
+        return false;
+    int kw = kspec.width, kh = kspec.height, kc = kspec.nchannels;
+    const float *k = (const float *)kernel.localpixels();
+    // Factor around the biggest element, which is surely in a nonzero
+    // row and column.
+    int px = 0, py = 0;
+    float big = 0.0f;
+    for (int y = 0;  y < kh;  ++y)
+        for (int x = 0;  x < kw;  ++x)
+            if (fabsf (k[(y*kw+x)*kc]) > big) {
+                big = fabsf (k[(y*kw+x)*kc]);
+                px = x;  py = y;
+            }
+    if (big == 0.0f)
+        return false;
+    float pivot = k[(py*kw+px)*kc];
+    row.resize (kw);
+    col.resize (kh);
+    for (int x = 0;  x < kw;  ++x)
+        row[x] = k[(py*kw+x)*kc];
+    for (int y = 0;  y < kh;  ++y)
+        col[y] = k[(y*kw+px)*kc] / pivot;
+    const float tolerance = 1.0e-6f * big;
+    for (int y = 0;  y < kh;  ++y)
+        for (int x = 0;  x < kw;  ++x)
+            if (fabsf (col[y]*row[x] - k[(y*kw+x)*kc]) > tolerance)
+                return false;
+    return true;
+}
+
+
+
+// r[i] += w * p[i] for i in [0,n)
+inline void
+axpy (float *r, float w, const float *p, int n)
+{
+    int i = 0;
+    simd::float4 W (w);
+    for ( ;  i <= n-4;  i += 4)
+        simd::madd (W, simd::float4(p+i), simd::float4(r+i)).store (r+i);
+    for ( ;  i < n;  ++i)
+        r[i] += w * p[i];
+}
+
+
+
+// Separable convolution: a horizontal 1D pass of the rows the region
+// needs into a float buffer, then a vertical 1D pass of that buffer.
+// The edge handling (clamping source coordinates to the data window)
+// is the same as for convolve_.
+static bool
+convolve_separable_ (ImageBuf &dst, const ImageBuf &src,
+                     const std::vector<float> &col,
+                     const std::vector<float> &row,
+                     ROI kroi, float scale, ROI roi, int nthreads)
+{
+    if (nthreads != 1 && roi.npixels() >= 1000) {
+        // Lots of pixels and request for multi threads? Parallelize.
+        ImageBufAlgo::parallel_image (
+            OIIO::bind(convolve_separable_, OIIO::ref(dst), OIIO::cref(src),
+                        OIIO::cref(col), OIIO::cref(row), kroi, scale,
+                        _1 /*roi*/, 1 /*nthreads*/),
+            roi, nthreads);
+        return true;
+    }
+
+    // Serial case
+    ROI sroi = src.roi();
+    int nc = roi.nchannels();
+    int width = roi.width();
+    int n = width * nc;
+    int kw = kroi.width(), kh = kroi.height();
+    int pw = width + kw - 1;
+    int x0 = roi.xbegin + kroi.xbegin;   // source x of padded column 0
+    int sx0 = OIIO::clamp (x0, sroi.xbegin, sroi.xend-1);
+    int sx1 = OIIO::clamp (x0+pw-1, sroi.xbegin, sroi.xend-1);
+    int y0 = OIIO::clamp (roi.ybegin + kroi.ybegin, sroi.ybegin, sroi.yend-1);
+    int y1 = OIIO::clamp (roi.yend-1 + kroi.yend-1, sroi.ybegin, sroi.yend-1);
+    std::vector<float> srow ((sx1-sx0+1) * nc);
+    std::vector<float> padded (pw * nc);
+    std::vector<float> H ((y1-y0+1) * n);
+    std::vector<float> out (n);
+    for (int z = roi.zbegin;  z < roi.zend;  ++z) {
+        int sz = OIIO::clamp (z, sroi.zbegin, sroi.zend-1);
+        for (int y = y0;  y <= y1;  ++y) {
+            src.get_pixels (ROI (sx0, sx1+1, y, y+1, sz, sz+1,
+                                 roi.chbegin, roi.chend),
+                            TypeDesc::FLOAT, &srow[0]);
+            for (int i = 0;  i < pw;  ++i) {
+                int sx = OIIO::clamp (x0+i, sx0, sx1);
+                memcpy (&padded[i*nc], &srow[(sx-sx0)*nc], nc*sizeof(float));
+            }
+            float *h = &H[(y-y0)*n];
+            memset (h, 0, n*sizeof(float));
+            for (int kx = 0;  kx < kw;  ++kx)
+                axpy (h, row[kx], &padded[kx*nc], n);
+        }
+        for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+            memset (&out[0], 0, n*sizeof(float));
+            for (int ky = 0;  ky < kh;  ++ky) {
+                int sy = OIIO::clamp (y + kroi.ybegin + ky,
+                                      sroi.ybegin, sroi.yend-1);
+                axpy (&out[0], scale*col[ky], &H[(sy-y0)*n], n);
+            }
+            dst.set_pixels (ROI (roi.xbegin, roi.xend, y, y+1, z, z+1,
+                                 roi.chbegin, roi.chend),
+                            TypeDesc::FLOAT, &out[0]);
+        }
+    }
+    return true;
+}
+
+
+
+// Smallest size >= n whose only prime factors are 2, 3, and 5, which
+// kissfft transforms efficiently.
+static int
+fft_good_size (int n)
+{
+    for ( ;  ;  ++n) {
+        int m = n;
+        while (m % 2 == 0) m /= 2;
+        while (m % 3 == 0) m /= 3;
+        while (m % 5 == 0) m /= 5;
+        if (m == 1)
+            return n;
+    }
+}
+
+
+
+// Transpose the nx by ny row-major array in into the ny by nx array
+// out, in small square blocks so that both the reads and the writes
+// stay within a few cache lines at a time.
+template<typename T>
+static void
+transpose_blocked (const T *in, T *out, int nx, int ny, int nthreads)
+{
+    const int B = 32;
+    ImageBufAlgo::parallel_image ([=](ROI r) {
+        for (int y0 = r.ybegin;  y0 < r.yend;  y0 += B) {
+            int y1 = std::min (y0 + B, r.yend);
+            for (int x0 = 0;  x0 < nx;  x0 += B) {
+                int x1 = std::min (x0 + B, nx);
+                for (int y = y0;  y < y1;  ++y) {
+                    const T *i = in + size_t(y)*nx;
+                    for (int x = x0;  x < x1;  ++x)
+                        out[size_t(x)*ny + y] = i[x];
+                }
+            }
+        }
+    }, ROI (0, nx, 0, ny), nthreads);
+}
+
+
+
+// Transform, in place, each of the ny rows (of length nx) of a row-major
+// complex array, scaling the results by scale.
+static void
+fft_rows (std::complex<float> *data, int nx, int ny, bool inverse,
+          float scale, int nthreads)
+{
+    typedef std::complex<float> cfloat;
+    ImageBufAlgo::parallel_image ([=](ROI r) {
+        kissfft<float> F (nx, inverse);
+        std::vector<cfloat> tmp (nx);
+        for (int y = r.ybegin;  y < r.yend;  ++y) {
+            cfloat *row = data + size_t(y)*nx;
+            F.transform (row, &tmp[0]);
+            for (int x = 0;  x < nx;  ++x)
+                row[x] = tmp[x] * scale;
+        }
+    }, ROI (0, nx, 0, ny), nthreads);
+}
+
+
+
+// Forward transform each of the ny real rows of in (length nx each) into
+// the complex rows of out.  Rows are taken two at a time, packed as the
+// real and imaginary parts of a single complex signal, and separated
+// again using the conjugate symmetry of the transform of a real signal,
+// so each pair of rows costs one complex FFT.
+static void
+fft_rows_real (const float *in, std::complex<float> *out, int nx, int ny,
+               float scale, int nthreads)
+{
+    typedef std::complex<float> cfloat;
+    int npairs = (ny + 1) / 2;
+    ImageBufAlgo::parallel_image ([=](ROI r) {
+        kissfft<float> F (nx, false);
+        std::vector<cfloat> z (nx), Z (nx);
+        for (int p = r.ybegin;  p < r.yend;  ++p) {
+            int y = 2 * p;
+            bool pair = (y + 1 < ny);
+            const float *a = in + size_t(y)*nx;
+            const float *b = pair ? a + nx : NULL;
+            for (int x = 0;  x < nx;  ++x)
+                z[x] = cfloat (a[x], b ? b[x] : 0.0f);
+            F.transform (&z[0], &Z[0]);
+            cfloat *A = out + size_t(y)*nx;
+            cfloat *Bout = pair ? A + nx : NULL;
+            float half = 0.5f * scale;
+            for (int k = 0;  k < nx;  ++k) {
+                cfloat Zk = Z[k], Zc = std::conj (Z[k ? nx-k : 0]);
+                A[k] = (Zk + Zc) * half;
+                if (Bout) {
+                    // (Zk - Zc) / 2i
+                    cfloat d = Zk - Zc;
+                    Bout[k] = cfloat (d.imag(), -d.real()) * half;
+                }
+            }
+        }
+    }, ROI (0, 2*nx, 0, npairs), nthreads);
+}
+
+
+
+// Inverse transform each of the ny complex rows of in (length nx each),
+// keeping only the real part of the result, into the rows of out.  The
+// real part of the inverse transform of Y is the inverse transform of
+// the Hermitian part of Y, which is a real signal, so two rows can share
+// one complex inverse FFT.
+static void
+ifft_rows_real (const std::complex<float> *in, float *out, int nx, int ny,
+                float scale, int nthreads)
+{
+    typedef std::complex<float> cfloat;
+    int npairs = (ny + 1) / 2;
+    ImageBufAlgo::parallel_image ([=](ROI r) {
+        kissfft<float> F (nx, true);
+        std::vector<cfloat> z (nx), Z (nx);
+        for (int p = r.ybegin;  p < r.yend;  ++p) {
+            int y = 2 * p;
+            bool pair = (y + 1 < ny);
+            const cfloat *A = in + size_t(y)*nx;
+            const cfloat *Bin = pair ? A + nx : NULL;
+            for (int k = 0;  k < nx;  ++k) {
+                int kc = k ? nx-k : 0;
+                cfloat ha = (A[k] + std::conj(A[kc])) * 0.5f;
+                cfloat hb = Bin ? (Bin[k] + std::conj(Bin[kc])) * 0.5f
+                                : cfloat (0.0f);
+                // ha + i*hb
+                z[k] = cfloat (ha.real() - hb.imag(), ha.imag() + hb.real());
+            }
+            F.transform (&z[0], &Z[0]);
+            float *a = out + size_t(y)*nx;
+            float *b = pair ? a + nx : NULL;
+            for (int x = 0;  x < nx;  ++x) {
+                a[x] = Z[x].real() * scale;
+                if (b)
+                    b[x] = Z[x].imag() * scale;
+            }
+        }
+    }, ROI (0, 2*nx, 0, npairs), nthreads);
+}
+
+
+
+// In-place 2D FFT of an nx by ny row-major complex array: transform the
+// rows, transpose so the columns become contiguous, transform those and
+// transpose back.
+static void
+fft2d (std::complex<float> *data, int nx, int ny, bool inverse, int nthreads)
+{
+    std::vector<std::complex<float> > T (size_t(nx) * size_t(ny));
+    fft_rows (data, nx, ny, inverse, 1.0f, nthreads);
+    transpose_blocked (data, &T[0], nx, ny, nthreads);
+    fft_rows (&T[0], ny, nx, inverse, 1.0f, nthreads);
+    transpose_blocked (&T[0], data, ny, nx, nthreads);
+}
+
+
+
+// Compute the padded FFT size needed to convolve roi with the kernel.
+static void
+convolve_fft_size (ROI roi, ROI kroi, int &nx, int &ny)
+{
+    nx = fft_good_size (roi.width() + kroi.width() - 1);
+    ny = fft_good_size (roi.height() + kroi.height() - 1);
+}
+
+
+
+// Convolution by multiplying spectra. The source region, padded by
+// clamping to the data window just as convolve_ does, is transformed two
+// channels at a time (packed as the real and imaginary parts), since the
+// kernel is real.  Correlating with the kernel, as the direct sum does,
+// is multiplying by the conjugate of its spectrum.
+static bool
+convolve_fft_ (ImageBuf &dst, const ImageBuf &src, const ImageBuf &kernel,
+               float scale, ROI roi, int nthreads)
+{
+    typedef std::complex<float> cfloat;
+    ROI sroi = src.roi();
+    ROI kroi = kernel.roi();
+    int kw = kroi.width(), kh = kroi.height(), kc = kernel.nchannels();
+    int nx, ny;
+    convolve_fft_size (roi, kroi, nx, ny);
+    size_t npix = size_t(nx) * size_t(ny);
+    int pw = roi.width() + kw - 1, ph = roi.height() + kh - 1;
+    int x0 = roi.xbegin + kroi.xbegin, y0 = roi.ybegin + kroi.ybegin;
+    int sx0 = OIIO::clamp (x0, sroi.xbegin, sroi.xend-1);
+    int sx1 = OIIO::clamp (x0+pw-1, sroi.xbegin, sroi.xend-1);
+
+    std::vector<cfloat> K (npix, cfloat(0.0f));
+    const float *k = (const float *)kernel.localpixels();
+    for (int y = 0;  y < kh;  ++y)
+        for (int x = 0;  x < kw;  ++x)
+            K[size_t(y)*nx+x] = k[(y*kw+x)*kc];
+    fft2d (&K[0], nx, ny, false, nthreads);
+
+    std::vector<cfloat> P (npix);
+    std::vector<float> srow ((sx1-sx0+1) * 2);
+    std::vector<float> out (roi.width() * 2);
+    float norm = scale / float(npix);
+    for (int z = roi.zbegin;  z < roi.zend;  ++z) {
+        int sz = OIIO::clamp (z, sroi.zbegin, sroi.zend-1);
+        for (int c = roi.chbegin;  c < roi.chend;  c += 2) {
+            int cn = std::min (2, roi.chend - c);
+            std::fill (P.begin(), P.end(), cfloat(0.0f));
+            for (int j = 0;  j < ph;  ++j) {
+                int sy = OIIO::clamp (y0+j, sroi.ybegin, sroi.yend-1);
+                src.get_pixels (ROI (sx0, sx1+1, sy, sy+1, sz, sz+1, c, c+cn),
+                                TypeDesc::FLOAT, &srow[0], 2*sizeof(float));
+                cfloat *p = &P[size_t(j)*nx];
+                for (int i = 0;  i < pw;  ++i) {
+                    int sx = OIIO::clamp (x0+i, sx0, sx1) - sx0;
+                    p[i] = cfloat (srow[2*sx], cn > 1 ? srow[2*sx+1] : 0.0f);
+                }
+            }
+            fft2d (&P[0], nx, ny, false, nthreads);
+            for (size_t i = 0;  i < npix;  ++i)
+                P[i] *= std::conj (K[i]);
+            fft2d (&P[0], nx, ny, true, nthreads);
+            for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+                const cfloat *p = &P[size_t(y-roi.ybegin)*nx];
+                for (int x = 0, w = roi.width();  x < w;  ++x) {
+                    out[2*x] = norm * p[x].real();
+                    out[2*x+1] = norm * p[x].imag();
+                }
+                dst.set_pixels (ROI (roi.xbegin, roi.xend, y, y+1, z, z+1,
+                                     c, c+cn),
+                                TypeDesc::FLOAT, &out[0], 2*sizeof(float));
+            }
+        }
+    }
+    return true;
+}
+
+
+
 bool
 ImageBufAlgo::convolve (ImageBuf &dst, const ImageBuf &src,
                         const ImageBuf &kernel, bool normalize,
@@ -401,6 +763,35 @@ ImageBufAlgo::convolve (ImageBuf &dst, const ImageBuf &src,
         Ktmp.copy (kernel, TypeDesc::FLOAT);
         K = &Ktmp;
     }
+
+    // Pick the cheapest method. A separable kernel costs kw+kh per pixel
+    // instead of kw*kh. Failing that, a big kernel may be cheaper to
+    // apply by FFT, whose cost hardly depends on the kernel size.
+    ROI kroi = K->roi();
+    if (kroi.depth() == 1 && kroi.zbegin == 0 && roi.npixels() &&
+            &dst != &src) {
+        float scale = 1.0f;
+        if (normalize) {
+            scale = 0.0f;
+            for (ImageBuf::ConstIterator<float> k (*K); ! k.done(); ++k)
+                scale += k[0];
+            scale = 1.0f / scale;
+        }
+        std::vector<float> col, row;
+        if (kroi.width() > 1 && kroi.height() > 1 &&
+                kernel_separable (*K, col, row))
+            return convolve_separable_ (dst, src, col, row, kroi, scale,
+                                        roi, nthreads);
+        int nx, ny;
+        convolve_fft_size (roi, kroi, nx, ny);
+        double n = double(nx) * double(ny);
+        double fftcost = (2 * ((roi.nchannels()+1)/2) + 1) * 2.5 * n * log2(n);
+        double directcost = double(roi.npixels()) * roi.nchannels()
+                          * kroi.width() * kroi.height();
+        if (2.0 * fftcost < directcost)
+            return convolve_fft_ (dst, src, *K, scale, roi, nthreads);
+    }
+
     OIIO_DISPATCH_COMMON_TYPES2 (ok, "convolve", convolve_,
                           dst.spec().format, src.spec().format,
                           dst, src, *K, normalize, roi, nthreads);
@@ -444,9 +835,17 @@ ImageBufAlgo::make_kernel (ImageBuf &dst, string_view name,
     dst.reset (spec);
 
     if (Filter2D *filter = Filter2D::create (name, width, height)) {
-        // Named continuous filter from filter.h
-        for (ImageBuf::Iterator<float> p (dst);  ! p.done();  ++p)
-            p[0] = (*filter)((float)p.x(), (float)p.y());
+        // Named continuous filter from filter.h, evaluated a row at a time
+        std::vector<float> xpos (w), row (w);
+        for (int i = 0;  i < w;  ++i)
+            xpos[i] = float (spec.x + i);
+        for (int z = spec.z;  z < spec.z+d;  ++z) {
+            for (int y = spec.y;  y < spec.y+h;  ++y) {
+                filter->eval (&row[0], &xpos[0], (float)y, w);
+                dst.set_pixels (ROI (spec.x, spec.x+w, y, y+1, z, z+1),
+                                TypeDesc::FLOAT, &row[0]);
+            }
+        }
         delete filter;
     } else if (name == "binomial") {
         // Binomial filter
@@ -493,6 +892,253 @@ ImageBufAlgo::make_kernel (ImageBuf &dst, string_view name,
 
 
 
+// Young & van Vliet recursive gaussian: B and the three feedback
+// coefficients (already divided by b0) for standard deviation sigma, in
+// c[0..3], followed by the 3x3 matrix (in c[4..12]) giving the values
+// just past the end of the line that start the anti-causal pass, as a
+// function of how far the last three causal outputs are from the edge
+// value (Triggs & Sdika).  Rather than use the closed form, the matrix
+// is found by running both passes over each basis state.
+static void
+iir_gauss_coefs (float sigma, float c[13])
+{
+    double q = (sigma >= 2.5f) ? 0.98711 * sigma - 0.96330
+                : 3.97156 - 4.14554 * sqrt (1.0 - 0.26891 * sigma);
+    double q2 = q*q, q3 = q2*q;
+    double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+    double b1 = 2.44413*q + 2.85619*q2 + 1.26661*q3;
+    double b2 = -(1.4281*q2 + 1.26661*q3);
+    double b3 = 0.422205*q3;
+    double a1 = b1 / b0, a2 = b2 / b0, a3 = b3 / b0, B = 1.0 - a1 - a2 - a3;
+    c[0] = float(B);  c[1] = float(a1);  c[2] = float(a2);  c[3] = float(a3);
+    int K = int (20.0f * sigma) + 32;
+    std::vector<double> e (K+3), d (K+6);
+    for (int j = 0;  j < 3;  ++j) {
+        // e[2-k] is the causal output k samples before the end
+        std::fill (e.begin(), e.end(), 0.0);
+        std::fill (d.begin(), d.end(), 0.0);
+        e[2-j] = 1.0;
+        for (int t = 3;  t < K+3;  ++t)
+            e[t] = a1*e[t-1] + a2*e[t-2] + a3*e[t-3];
+        for (int t = K+2;  t >= 3;  --t)
+            d[t] = B*e[t] + a1*d[t+1] + a2*d[t+2] + a3*d[t+3];
+        for (int k = 0;  k < 3;  ++k)
+            c[4 + 3*k + j] = float (d[3+k]);
+    }
+}
+
+
+
+// Run the causal then anti-causal recursive gaussian, in place, along n
+// samples that are stride floats apart, each sample being a run of L
+// contiguous floats (the channels of one pixel, or of a band of pixels)
+// that are all filtered together.  Edges are extended by replication.
+// The scratch space must hold 5*L floats.
+static void
+iir_gauss_lanes (float *p, int n, size_t stride, int L, const float c[13],
+                 float *edge)
+{
+    const float B = c[0], c1 = c[1], c2 = c[2], c3 = c[3];
+    const float *M = c + 4;
+    // Causal pass, starting from the steady state of the first sample
+    float *u = edge, *uend = edge + L;
+    float *last = p + (n-1)*stride;
+    std::copy (p, p+L, u);
+    std::copy (last, last+L, uend);
+    for (int i = 0;  i < n;  ++i) {
+        float *x = p + i*stride;
+        const float *x1 = i >= 1 ? x - stride : u;
+        const float *x2 = i >= 2 ? x - 2*stride : u;
+        const float *x3 = i >= 3 ? x - 3*stride : u;
+        for (int l = 0;  l < L;  ++l)
+            x[l] = B*x[l] + c1*x1[l] + c2*x2[l] + c3*x3[l];
+    }
+    // Anti-causal pass, starting from the values past the end that an
+    // endlessly replicated last sample would have produced.
+    // Causal outputs before the start of the line are the first input.
+    float *y = edge + 2*L;
+    for (int l = 0;  l < L;  ++l) {
+        float e0 = last[l] - uend[l];
+        float e1 = (n >= 2 ? last[l-stride] : u[l]) - uend[l];
+        float e2 = (n >= 3 ? last[l-2*stride] : u[l]) - uend[l];
+        for (int k = 0;  k < 3;  ++k)
+            y[k*L+l] = uend[l] + M[3*k]*e0 + M[3*k+1]*e1 + M[3*k+2]*e2;
+    }
+    for (int i = n-1;  i >= 0;  --i) {
+        float *x = p + i*stride;
+        const float *x1 = i+1 < n ? x + stride : y + (i+1-n)*L;
+        const float *x2 = i+2 < n ? x + 2*stride : y + (i+2-n)*L;
+        const float *x3 = i+3 < n ? x + 3*stride : y + (i+3-n)*L;
+        for (int l = 0;  l < L;  ++l)
+            x[l] = B*x[l] + c1*x1[l] + c2*x2[l] + c3*x3[l];
+    }
+}
+
+
+
+// Radii of three successive box filters whose combination approximates
+// a gaussian of standard deviation sigma (the variance of a box of
+// width w is (w*w-1)/12, and variances add).
+static void
+box_gauss_radii (float sigma, int r[3])
+{
+    const int n = 3;
+    float wideal = sqrtf (12.0f * sigma * sigma / n + 1.0f);
+    int wl = int (floorf (wideal));
+    if ((wl & 1) == 0)
+        --wl;
+    wl = std::max (wl, 1);
+    int m = int (roundf ((12.0f*sigma*sigma - n*wl*wl - 4*n*wl - 3*n)
+                         / (-4.0f*wl - 4.0f)));
+    for (int i = 0;  i < n;  ++i)
+        r[i] = ((i < m ? wl : wl+2) - 1) / 2;
+}
+
+
+
+// Box filter of radius r from in to out along n samples of L contiguous
+// floats each, stride floats apart, by a running sum (so the cost does
+// not depend on r).  Edges are extended by replication.
+static void
+box_lanes (const float *in, float *out, int n, size_t stride, int L, int r,
+           double *acc)
+{
+    std::fill (acc, acc+L, 0.0);
+    for (int k = -r;  k <= r;  ++k) {
+        const float *s = in + clamp (k, 0, n-1) * stride;
+        for (int l = 0;  l < L;  ++l)
+            acc[l] += s[l];
+    }
+    double scale = 1.0 / (2*r+1);
+    for (int i = 0;  i < n;  ++i) {
+        float *o = out + i*stride;
+        for (int l = 0;  l < L;  ++l)
+            o[l] = float (acc[l] * scale);
+        const float *add = in + std::min (i+r+1, n-1) * stride;
+        const float *sub = in + std::max (i-r, 0) * stride;
+        for (int l = 0;  l < L;  ++l)
+            acc[l] += add[l] - sub[l];
+    }
+}
+
+
+
+// Blur the w x h, nc-channel float buffer buf, in place, with a
+// recursive gaussian or a cascade of box filters.  Passes whose
+// sigma is below half a pixel are skipped.
+static void
+fast_blur_ (float *buf, int w, int h, int nc, float sigmax, float sigmay,
+            bool box, int nthreads)
+{
+    ROI all (0, w, 0, h);
+    if (sigmax >= 0.5f) {
+        float c[13];
+        int radii[3];
+        iir_gauss_coefs (sigmax, c);
+        box_gauss_radii (sigmax, radii);
+        ImageBufAlgo::parallel_image ([=](ROI r) {
+            std::vector<float> edge (5*nc), t0, t1;
+            std::vector<double> acc (nc);
+            if (box) {
+                t0.resize (size_t(w)*nc);
+                t1.resize (size_t(w)*nc);
+            }
+            for (int y = r.ybegin;  y < r.yend;  ++y) {
+                float *row = buf + size_t(y)*w*nc;
+                if (box) {
+                    std::copy (row, row + size_t(w)*nc, t0.begin());
+                    box_lanes (&t0[0], &t1[0], w, nc, nc, radii[0], &acc[0]);
+                    box_lanes (&t1[0], &t0[0], w, nc, nc, radii[1], &acc[0]);
+                    box_lanes (&t0[0], row, w, nc, nc, radii[2], &acc[0]);
+                } else {
+                    iir_gauss_lanes (row, w, nc, nc, c, &edge[0]);
+                }
+            }
+        }, all, nthreads, ImageBufAlgo::Split_Y);
+    }
+    if (sigmay >= 0.5f) {
+        // Vertical passes filter a whole band of columns at once, with
+        // each row of the band contiguous in memory.
+        float c[13];
+        int radii[3];
+        iir_gauss_coefs (sigmay, c);
+        box_gauss_radii (sigmay, radii);
+        size_t stride = size_t(w) * nc;
+        std::vector<float> tmp (box ? size_t(w)*h*nc : 0);
+        float *t = box ? &tmp[0] : NULL;
+        ImageBufAlgo::parallel_image ([=](ROI r) {
+            int L = r.width() * nc;
+            float *p = buf + size_t(r.xbegin)*nc;
+            if (box) {
+                std::vector<double> acc (L);
+                float *q = t + size_t(r.xbegin)*nc;
+                box_lanes (p, q, h, stride, L, radii[0], &acc[0]);
+                box_lanes (q, p, h, stride, L, radii[1], &acc[0]);
+                box_lanes (p, q, h, stride, L, radii[2], &acc[0]);
+                for (int y = 0;  y < h;  ++y)
+                    std::copy (q + y*stride, q + y*stride + L, p + y*stride);
+            } else {
+                std::vector<float> edge (5*L);
+                iir_gauss_lanes (p, h, stride, L, c, &edge[0]);
+            }
+        }, all, nthreads, ImageBufAlgo::Split_X);
+    }
+}
+
+
+
+bool
+ImageBufAlgo::blur (ImageBuf &dst, const ImageBuf &src,
+                    float width, float height, string_view method,
+                    ROI roi, int nthreads)
+{
+    if (! IBAprep (roi, &dst, &src,
+            IBAprep_REQUIRE_SAME_NCHANNELS | IBAprep_NO_SUPPORT_VOLUME))
+        return false;
+    if (height <= 0.0f)
+        height = width;
+
+    if (method == "gaussian" || method.empty()) {
+        ImageBuf K;
+        if (! make_kernel (K, "gaussian", width, height)) {
+            dst.error ("%s", K.geterror());
+            return false;
+        }
+        return convolve (dst, src, K, true, roi, nthreads);
+    }
+    if (method != "iir" && method != "box") {
+        dst.error ("Unknown blur method \"%s\"", method);
+        return false;
+    }
+
+    // Work on a float copy of roi, padded by the blur's reach on each
+    // side wherever src has pixels, so that the results near the edges
+    // of roi still see their neighbors.  make_kernel's gaussian of a
+    // given width has sigma = width/4 but is cut off at 2 sigma, which
+    // leaves it with the variance of an untruncated gaussian whose
+    // sigma is 0.88 times that, so that is what we approximate.
+    float sigmax = 0.22f * width, sigmay = 0.22f * height;
+    int padx = int (ceilf (width)), pady = int (ceilf (height));
+    ROI work (roi.xbegin - padx, roi.xend + padx,
+              roi.ybegin - pady, roi.yend + pady,
+              roi.zbegin, roi.zend, roi.chbegin, roi.chend);
+    work = roi_union (roi, roi_intersection (work, src.roi()));
+    int w = work.width(), h = work.height(), nc = roi.nchannels();
+    std::vector<float> buf (size_t(w) * h * nc);
+    if (! src.get_pixels (work, TypeDesc::FLOAT, &buf[0])) {
+        dst.error ("%s", src.geterror());
+        return false;
+    }
+    fast_blur_ (&buf[0], w, h, nc, sigmax, sigmay, method == "box", nthreads);
+
+    size_t offset = (size_t(roi.ybegin - work.ybegin) * w
+                     + (roi.xbegin - work.xbegin)) * nc;
+    return dst.set_pixels (roi, TypeDesc::FLOAT, &buf[offset],
+                           nc * sizeof(float), w * nc * sizeof(float));
+}
+
+
+
 // Helper function for unsharp mask to perform the thresholding
 static bool
 threshold_to_zero (ImageBuf &dst, float threshold,
@@ -594,6 +1240,82 @@ ImageBufAlgo::laplacian (ImageBuf &dst, const ImageBuf &src,
 
 
 
+// Median filter of an 8 bit image in constant time per pixel, after
+// Perreault & Hebert, "Median Filtering in Constant Time" (IEEE TIP 2007).
+// Each padded column keeps a 256-bin histogram of the window's rows in
+// that column, updated by one row out and one row in as y advances; the
+// window histogram slides across a row by subtracting the column that
+// leaves and adding the one that enters.  The window for output (x,y) is
+// [x-w_2, x-w_2+width) x [y-h_2, y-h_2+height) with source coordinates
+// clamped to the data window, the same samples median_filter_impl sorts.
+static bool
+median_filter_hist8 (ImageBuf &R, const ImageBuf &A, int width, int height,
+                     int w_2, int h_2, ROI roi)
+{
+    const int nc = R.nchannels();
+    const ROI sroi = A.roi();
+    const int pw = roi.width() + width - 1;
+    const int x0 = roi.xbegin - w_2;
+    const int sx0 = OIIO::clamp (x0, sroi.xbegin, sroi.xend-1);
+    const int sx1 = OIIO::clamp (x0+pw-1, sroi.xbegin, sroi.xend-1);
+    const uint32_t mid = uint32_t(width) * uint32_t(height) / 2;
+    std::vector<unsigned char> row ((sx1-sx0+1) * nc);
+    std::vector<uint16_t> colhist (size_t(pw) * nc * 256);  // [col][chan][bin]
+    std::vector<uint32_t> hist (nc * 256);                  // [chan][bin]
+    std::vector<float> out (roi.width() * nc);
+    int z = roi.zbegin;
+
+    // Add (delta=1) or remove (delta=-1) source row y to the column
+    // histograms.
+    auto addrow = [&](int y, int delta) {
+        int sy = OIIO::clamp (y, sroi.ybegin, sroi.yend-1);
+        A.get_pixels (ROI (sx0, sx1+1, sy, sy+1, z, z+1, 0, nc),
+                      TypeDesc::UINT8, &row[0]);
+        for (int i = 0;  i < pw;  ++i) {
+            const unsigned char *p = &row[(OIIO::clamp (x0+i, sx0, sx1)-sx0) * nc];
+            uint16_t *h = &colhist[size_t(i) * nc * 256];
+            for (int c = 0;  c < nc;  ++c)
+                h[c*256 + p[c]] += delta;
+        }
+    };
+
+    for (int j = 0;  j < height;  ++j)
+        addrow (roi.ybegin - h_2 + j, 1);
+    for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+        if (y > roi.ybegin) {
+            addrow (y - 1 - h_2, -1);
+            addrow (y - 1 - h_2 + height, 1);
+        }
+        std::fill (hist.begin(), hist.end(), 0);
+        for (int i = 0;  i < width;  ++i) {
+            const uint16_t *h = &colhist[size_t(i) * nc * 256];
+            for (int b = 0;  b < nc*256;  ++b)
+                hist[b] += h[b];
+        }
+        for (int x = 0, w = roi.width();  x < w;  ++x) {
+            if (x > 0) {
+                const uint16_t *hout = &colhist[size_t(x-1) * nc * 256];
+                const uint16_t *hin = &colhist[size_t(x-1+width) * nc * 256];
+                for (int b = 0;  b < nc*256;  ++b)
+                    hist[b] += uint32_t(hin[b]) - uint32_t(hout[b]);
+            }
+            for (int c = 0;  c < nc;  ++c) {
+                const uint32_t *h = &hist[c*256];
+                uint32_t sum = 0;
+                int b = 0;
+                while ((sum += h[b]) <= mid)
+                    ++b;
+                out[x*nc+c] = convert_type<unsigned char,float> ((unsigned char)b);
+            }
+        }
+        R.set_pixels (ROI (roi.xbegin, roi.xend, y, y+1, z, z+1, 0, nc),
+                      TypeDesc::FLOAT, &out[0]);
+    }
+    return true;
+}
+
+
+
 template<class Rtype, class Atype>
 static bool
 median_filter_impl (ImageBuf &R, const ImageBuf &A, int width, int height,
@@ -616,6 +1338,11 @@ median_filter_impl (ImageBuf &R, const ImageBuf &A, int width, int height,
     int w_2 = std::max (1, width/2);
     int h_2 = std::max (1, height/2);
     int windowsize = width*height;
+    // For all but small windows, 8 bit images can use histograms, whose
+    // cost per pixel doesn't depend on the window size.
+    if (A.spec().format == TypeDesc::UINT8 && windowsize >= 64 &&
+            height < 65536 && A.spec().depth == 1)
+        return median_filter_hist8 (R, A, width, height, w_2, h_2, roi);
     int nchannels = R.nchannels();
     float **chans = OIIO_ALLOCA (float*, nchannels);
     for (int c = 0;  c < nchannels;  ++c)
@@ -637,7 +1364,7 @@ median_filter_impl (ImageBuf &R, const ImageBuf &A, int width, int height,
         if (n) {
             int mid = n/2;
             for (int c = 0;  c < nchannels;  ++c) {
-                std::sort (chans[c]+0, chans[c]+n);
+                std::nth_element (chans[c]+0, chans[c]+mid, chans[c]+n);
                 r[c] = chans[c][mid];
             }
         } else {
@@ -671,6 +1398,93 @@ ImageBufAlgo::median_filter (ImageBuf &dst, const ImageBuf &src,
 
 enum MorphOp { MorphDilate, MorphErode };
 
+
+// Running max (or min) of window size k along a sequence of nout+k-1
+// elements, each a vector of n floats: out[i] = op(in[i..i+k-1]).  This
+// is the van Herk / Gil-Werman algorithm: cut the sequence into blocks of
+// k, take the running op forward (g) and backward (h) within each block;
+// any window spans at most two blocks, so out[i] = op(h[i], g[i+k-1]).
+// That is 3 ops per element whatever the window size.  g and h are
+// scratch of (nout+k-1)*n floats.
+template<class OP>
+static void
+running_extreme (const float *in, float *out, int nout, int k, int n,
+                 OP op, float *g, float *h)
+{
+    const int m = nout + k - 1;
+    for (int i = 0;  i < m;  ++i) {
+        const float *v = in + size_t(i)*n;
+        float *gi = g + size_t(i)*n;
+        if (i % k == 0)
+            std::copy (v, v+n, gi);
+        else
+            for (int j = 0;  j < n;  ++j)
+                gi[j] = op (gi[j-n], v[j]);
+    }
+    for (int i = m-1;  i >= 0;  --i) {
+        const float *v = in + size_t(i)*n;
+        float *hi = h + size_t(i)*n;
+        if (i % k == k-1 || i == m-1)
+            std::copy (v, v+n, hi);
+        else
+            for (int j = 0;  j < n;  ++j)
+                hi[j] = op (hi[j+n], v[j]);
+    }
+    for (int i = 0;  i < nout;  ++i) {
+        const float *hi = h + size_t(i)*n;
+        const float *gi = g + size_t(i+k-1)*n;
+        float *o = out + size_t(i)*n;
+        for (int j = 0;  j < n;  ++j)
+            o[j] = op (hi[j], gi[j]);
+    }
+}
+
+
+
+// Dilate/erode as a horizontal then a vertical running_extreme, over the
+// window [x-w_2, x-w_2+width) x [y-h_2, y-h_2+height) with source
+// coordinates clamped to the data window, same as morph_impl's gather.
+// Rows are done in bands, bounding the intermediate buffer.
+template<class OP>
+static bool
+morph_separable (ImageBuf &R, const ImageBuf &A, int width, int height,
+                 int w_2, int h_2, OP op, ROI roi)
+{
+    const int nc = R.nchannels();
+    const ROI sroi = A.roi();
+    const int w = roi.width();
+    const int n = w * nc;
+    const int pw = w + width - 1;
+    const int x0 = roi.xbegin - w_2;
+    const int sx0 = OIIO::clamp (x0, sroi.xbegin, sroi.xend-1);
+    const int sx1 = OIIO::clamp (x0+pw-1, sroi.xbegin, sroi.xend-1);
+    const int band = std::max (64, 4*height);
+    const int z = roi.zbegin;
+    std::vector<float> row ((sx1-sx0+1) * nc), padded (pw * nc);
+    std::vector<float> g (std::max (pw * nc, (band+height-1) * n));
+    std::vector<float> h (g.size());
+    std::vector<float> H ((band+height-1) * n), out (band * n);
+    for (int yb = roi.ybegin;  yb < roi.yend;  yb += band) {
+        int nrows = std::min (band, roi.yend - yb);
+        int nin = nrows + height - 1;
+        for (int j = 0;  j < nin;  ++j) {
+            int sy = OIIO::clamp (yb - h_2 + j, sroi.ybegin, sroi.yend-1);
+            A.get_pixels (ROI (sx0, sx1+1, sy, sy+1, z, z+1, 0, nc),
+                          TypeDesc::FLOAT, &row[0]);
+            for (int i = 0;  i < pw;  ++i)
+                std::copy_n (&row[(OIIO::clamp (x0+i, sx0, sx1)-sx0) * nc],
+                             nc, &padded[i*nc]);
+            running_extreme (&padded[0], &H[size_t(j)*n], w, width, nc,
+                             op, &g[0], &h[0]);
+        }
+        running_extreme (&H[0], &out[0], nrows, height, n, op, &g[0], &h[0]);
+        R.set_pixels (ROI (roi.xbegin, roi.xend, yb, yb+nrows, z, z+1, 0, nc),
+                      TypeDesc::FLOAT, &out[0]);
+    }
+    return true;
+}
+
+
 template<class Rtype, class Atype>
 static bool
 morph_impl (ImageBuf &R, const ImageBuf &A, int width, int height,
@@ -692,6 +1506,16 @@ morph_impl (ImageBuf &R, const ImageBuf &A, int width, int height,
         height = width;
     int w_2 = std::max (1, width/2);
     int h_2 = std::max (1, height/2);
+    if (A.spec().depth == 1) {
+        if (op == MorphDilate)
+            return morph_separable (R, A, width, height, w_2, h_2,
+                                    [](float a, float b){ return std::max(a,b); },
+                                    roi);
+        if (op == MorphErode)
+            return morph_separable (R, A, width, height, w_2, h_2,
+                                    [](float a, float b){ return std::min(a,b); },
+                                    roi);
+    }
     int nchannels = R.nchannels();
     float *vals = OIIO_ALLOCA (float, nchannels);
 
@@ -765,49 +1589,6 @@ ImageBufAlgo::erode (ImageBuf &dst, const ImageBuf &src,
 
 
 
-// Helper function: fft of the horizontal rows
-static bool
-hfft_ (ImageBuf &dst, const ImageBuf &src, bool inverse, bool unitary,
-       ROI roi, int nthreads)
-{
-    ASSERT (dst.spec().format.basetype == TypeDesc::FLOAT &&
-            src.spec().format.basetype == TypeDesc::FLOAT &&
-            dst.spec().nchannels == 2 && src.spec().nchannels == 2 &&
-            dst.roi() == src.roi() &&
-            (dst.storage() == ImageBuf::LOCALBUFFER || dst.storage() == ImageBuf::APPBUFFER) &&
-            (src.storage() == ImageBuf::LOCALBUFFER || src.storage() == ImageBuf::APPBUFFER)
-        );
-
-    if (nthreads != 1 && roi.npixels() >= 1000) {
-        // Lots of pixels and request for multi threads? Parallelize.
-        ImageBufAlgo::parallel_image (
-            OIIO::bind (hfft_, OIIO::ref(dst), OIIO::cref(src),
-                         inverse, unitary,
-                         _1 /*roi*/, 1 /*nthreads*/),
-            roi, nthreads);
-        return true;
-    }
-
-    // Serial case
-    int width = roi.width();
-    float rescale = sqrtf (1.0f / width);
-    kissfft<float> F (width, inverse);
-    for (int z = roi.zbegin;  z < roi.zend;  ++z) {
-        for (int y = roi.ybegin;  y < roi.yend;  ++y) {
-            std::complex<float> *s, *d;
-            s = (std::complex<float> *)src.pixeladdr(roi.xbegin, y, z);
-            d = (std::complex<float> *)dst.pixeladdr(roi.xbegin, y, z);
-            F.transform (s, d);
-            if (unitary)
-                for (int x = 0;  x < width;  ++x)
-                    d[x] *= rescale;
-        }
-    }
-    return true;
-}
-
-
-
 bool
 ImageBufAlgo::fft (ImageBuf &dst, const ImageBuf &src,
                    ROI roi, int nthreads)
@@ -835,43 +1616,31 @@ ImageBufAlgo::fft (ImageBuf &dst, const ImageBuf &src,
     spec.channelnames.push_back ("real");
     spec.channelnames.push_back ("imag");
 
-    // And a spec that describes the transposed intermediate
-    ImageSpec specT = spec;
-    std::swap (specT.width, specT.height);
-    std::swap (specT.full_width, specT.full_height);
-
     // Resize dst
     dst.reset (dst.name(), spec);
 
-    // Copy src to a 2-channel (for "complex") float buffer
-    ImageBuf A (spec);
-    if (src.nchannels() < 2) {
-        // If we're pasting fewer than 2 channels, zero out channel 1.
-        ROI r = roi;
-        r.chbegin = 1; r.chend = 2;
-        zero (A, r);
-    }
+    // Copy the one src channel into a contiguous float buffer
+    ImageSpec specR = spec;
+    specR.nchannels = 1;
+    specR.channelnames.clear ();
+    specR.channelnames.push_back ("R");
+    ImageBuf A (specR);
     if (! ImageBufAlgo::paste (A, 0, 0, 0, 0, src, roi, nthreads)) {
         dst.error ("%s", A.geterror());
         return false;
     }
 
-    // FFT the rows (into temp buffer B).
-    ImageBuf B (spec);
-    hfft_ (B, A, false /*inverse*/, true /*unitary*/,
-           get_roi(B.spec()), nthreads);
-
-    // Transpose and shift back to A
+    // FFT the (real) rows, transpose so that the columns are contiguous,
+    // FFT those, and transpose again into dst.
+    typedef std::complex<float> cfloat;
+    int w = spec.width, h = spec.height;
+    std::vector<cfloat> B (size_t(w) * size_t(h)), T (B.size());
+    fft_rows_real ((const float *)A.localpixels(), &B[0], w, h,
+                   sqrtf (1.0f / w), nthreads);
     A.clear ();
-    ImageBufAlgo::transpose (A, B, ROI::All(), nthreads);
-
-    // FFT what was originally the columns (back to B)
-    B.reset (specT);
-    hfft_ (B, A, false /*inverse*/, true /*unitary*/,
-           get_roi(A.spec()), nthreads);
-
-    // Transpose again, into the dest
-    ImageBufAlgo::transpose (dst, B, ROI::All(), nthreads);
+    transpose_blocked (&B[0], &T[0], w, h, nthreads);
+    fft_rows (&T[0], h, w, false, sqrtf (1.0f / h), nthreads);
+    transpose_blocked (&T[0], (cfloat *)dst.localpixels(), h, w, nthreads);
 
     return true;
 }
@@ -911,29 +1680,28 @@ ImageBufAlgo::ifft (ImageBuf &dst, const ImageBuf &src,
     spec.channelnames.push_back ("real");
     spec.channelnames.push_back ("imag");
 
-    // Inverse FFT the rows (into temp buffer B).
-    ImageBuf B (spec);
-    hfft_ (B, src, true /*inverse*/, true /*unitary*/,
-           get_roi(B.spec()), nthreads);
-
-    // Transpose and shift back to A
-    ImageBuf A;
-    ImageBufAlgo::transpose (A, B, ROI::All(), nthreads);
-
-    // Inverse FFT what was originally the columns (back to B)
-    B.reset (A.spec());
-    hfft_ (B, A, true /*inverse*/, true /*unitary*/,
-           get_roi(A.spec()), nthreads);
+    // Inverse FFT the complex rows, transpose so that the columns are
+    // contiguous, inverse FFT those keeping only the real part, and
+    // transpose again into the single (real) channel of dst.
+    typedef std::complex<float> cfloat;
+    int w = spec.width, h = spec.height;
+    std::vector<cfloat> B (size_t(w) * size_t(h)), T (B.size());
+    if (! src.get_pixels (roi, TypeDesc::FLOAT, &B[0])) {
+        dst.error ("%s", src.geterror());
+        return false;
+    }
+    fft_rows (&B[0], w, h, true, sqrtf (1.0f / w), nthreads);
+    transpose_blocked (&B[0], &T[0], w, h, nthreads);
+    std::vector<cfloat>().swap (B);
+    std::vector<float> R (T.size());
+    ifft_rows_real (&T[0], &R[0], h, w, sqrtf (1.0f / h), nthreads);
+    std::vector<cfloat>().swap (T);
 
-    // Transpose again, into the dst, in the process throw out the
-    // imaginary part and go back to a single (real) channel.
     spec.nchannels = 1;
     spec.channelnames.clear ();
     spec.channelnames.push_back ("R");
     dst.reset (dst.name(), spec);
-    ROI Broi = get_roi(B.spec());
-    Broi.chend = 1;
-    ImageBufAlgo::transpose (dst, B, Broi, nthreads);
+    transpose_blocked (&R[0], (float *)dst.localpixels(), h, w, nthreads);
 
     return true;
 }
@@ -1045,35 +1813,127 @@ ImageBufAlgo::complex_to_polar (ImageBuf &dst, const ImageBuf &src,
 
 
 
-// Helper for fillholes_pp: for any nonzero alpha pixels in dst, divide
-// all components by alpha.
-static bool
-divide_by_alpha (ImageBuf &dst, ROI roi, int nthreads)
-{
-    if (nthreads != 1 && roi.npixels() >= 1000) {
-        // Lots of pixels and request for multi threads? Parallelize.
-        ImageBufAlgo::parallel_image (
-            OIIO::bind(divide_by_alpha, OIIO::ref(dst),
-                        _1 /*roi*/, 1 /*nthreads*/),
-            roi, nthreads);
-        return true;
+namespace {
+
+// One level of the fillholes_pushpull pyramid: nc-channel float pixels,
+// scanline-contiguous, living inside the one allocation shared by all
+// levels, plus the data and full windows that resize() would see for it.
+struct PushPullLevel {
+    float *pixels;
+    ROI data, full;
+
+    float *pixel (int x, int y, int nc) const {
+        return pixels + ((imagesize_t)(y-data.ybegin) * data.width()
+                         + (x-data.xbegin)) * nc;
     }
+};
 
-    // Serial case
-    const ImageSpec &spec (dst.spec());
-    ASSERT (spec.format == TypeDesc::FLOAT);
-    int nc = spec.nchannels;
-    int ac = spec.alpha_channel;
-    for (ImageBuf::Iterator<float> d (dst, roi);  ! d.done();  ++d) {
-        float alpha = d[ac];
-        if (alpha != 0.0f) {
-            for (int c = 0; c < nc; ++c)
-                d[c] = d[c] / alpha;
+
+
+// Resample pyramid level 'from' to the resolution of level 'to' with the
+// same triangle filter and weights resize() uses, with source coordinates
+// clamped to from's data window.  Going down the pyramid ("push"), every
+// pixel of 'to' is computed and then divided by its alpha, if nonzero.
+// Going back up ("pull"), only the pixels of 'to' whose alpha is less
+// than 1 are visited, and each is composited over the resampled value
+// just as over() would do it, so the cost scales with the holes.
+static void
+pushpull_resample (const PushPullLevel &from, const PushPullLevel &to,
+                   int nc, int ac, int zc, bool pull, int nthreads)
+{
+    float wratio = float(to.full.width()) / float(from.full.width());
+    float hratio = float(to.full.height()) / float(from.full.height());
+    std::shared_ptr<Filter2D> filter (Filter2D::create ("triangle",
+                                          2.0f * std::max (1.0f, wratio),
+                                          2.0f * std::max (1.0f, hratio)),
+                                      Filter2D::destroy);
+    pvt::ResizeWeights xw (filter.get(), false, to.data.xbegin, to.data.xend,
+                           to.full.xbegin, to.full.width(),
+                           from.full.xbegin, from.full.width());
+    pvt::ResizeWeights yw (filter.get(), true, to.data.ybegin, to.data.yend,
+                           to.full.ybegin, to.full.height(),
+                           from.full.ybegin, from.full.height());
+    const int fw = from.data.width(), tw = to.data.width();
+
+    ImageBufAlgo::parallel_image ([&](ROI roi){
+        std::vector<float> col (fw * nc), sum (nc);
+        for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+            float *out = to.pixel (to.data.xbegin, y, nc);
+            if (pull) {
+                bool holes = false;
+                for (int x = 0;  x < tw && ! holes;  ++x)
+                    holes = (out[x*nc+ac] < 1.0f);
+                if (! holes)
+                    continue;
+            }
+            // Vertical pass over all of from's columns under this row
+            const float *wy = yw[y-to.data.ybegin];
+            int firsty = yw.first[y-to.data.ybegin];
+            std::fill (col.begin(), col.end(), 0.0f);
+            for (int j = 0;  j < yw.taps;  ++j) {
+                if (wy[j] == 0.0f)
+                    continue;
+                int sy = clamp (firsty+j, from.data.ybegin, from.data.yend-1);
+                const float *p = from.pixel (from.data.xbegin, sy, nc);
+                for (int i = 0, n = fw*nc;  i < n;  ++i)
+                    col[i] += wy[j] * p[i];
+            }
+            // Horizontal pass
+            for (int x = 0;  x < tw;  ++x, out += nc) {
+                float alpha = pull ? clamp (out[ac], 0.0f, 1.0f) : 0.0f;
+                if (alpha == 1.0f)
+                    continue;
+                const float *wx = xw[x];
+                int firstx = xw.first[x];
+                std::fill (sum.begin(), sum.end(), 0.0f);
+                for (int i = 0;  i < xw.taps;  ++i) {
+                    if (wx[i] == 0.0f)
+                        continue;
+                    int sx = clamp (firstx+i, from.data.xbegin,
+                                    from.data.xend-1);
+                    const float *p = &col[(sx-from.data.xbegin)*nc];
+                    for (int c = 0;  c < nc;  ++c)
+                        sum[c] += wx[i] * p[c];
+                }
+                if (pull) {
+                    float one_minus_alpha = 1.0f - alpha;
+                    float z = zc >= 0 ? out[zc] : 0.0f;
+                    for (int c = 0;  c < nc;  ++c)
+                        out[c] += one_minus_alpha * sum[c];
+                    if (zc >= 0)
+                        out[zc] = (alpha != 0.0f) ? z : sum[zc];
+                } else {
+                    float a = sum[ac];
+                    for (int c = 0;  c < nc;  ++c)
+                        out[c] = (a != 0.0f) ? sum[c] / a : sum[c];
+                }
+            }
         }
-    }
-    return true;
+    }, to.data, nthreads);
+}
+
+
+
+// Does any pixel of the level have alpha < 1?
+static bool
+pushpull_has_holes (const PushPullLevel &level, int nc, int ac, int nthreads)
+{
+    atomic_int holes (0);
+    ImageBufAlgo::parallel_image ([&](ROI roi){
+        for (int y = roi.ybegin;  y < roi.yend && ! holes;  ++y) {
+            const float *p = level.pixel (roi.xbegin, y, nc);
+            for (int x = roi.xbegin;  x < roi.xend;  ++x, p += nc)
+                if (p[ac] < 1.0f) {
+                    holes = 1;
+                    break;
+                }
+        }
+    }, level.data, nthreads);
+    return holes != 0;
 }
 
+}  // end anon namespace
+
 
 
 bool
@@ -1098,50 +1958,60 @@ ImageBufAlgo::fillholes_pushpull (ImageBuf &dst, const ImageBuf &src,
         return false;
     }
 
-    // We generate a bunch of temp images to form an image pyramid.
-    // These give us a place to stash them and make sure they are
-    // auto-deleted when the function exits.
-    std::vector<std::shared_ptr<ImageBuf> > pyramid;
-
-    // First, make a writeable copy of the original image (converting
-    // to float as a convenience) as the top level of the pyramid.
-    ImageSpec topspec = src.spec();
-    topspec.set_format (TypeDesc::FLOAT);
-    ImageBuf *top = new ImageBuf (topspec);
-    paste (*top, topspec.x, topspec.y, topspec.z, 0, src);
-    pyramid.push_back (std::shared_ptr<ImageBuf>(top));
-
-    // Construct the rest of the pyramid by successive x/2 resizing and
-    // then dividing nonzero alpha pixels by their alpha (this "spreads
-    // out" the defined part of the image).
-    int w = src.spec().width, h = src.spec().height;
+    // Lay out the image pyramid: the top level is a float copy of the
+    // source, and each level below it is half the size of the one above,
+    // down to 1x1.  All of the levels share a single allocation.
+    const ImageSpec &srcspec (src.spec());
+    const int nc = srcspec.nchannels;
+    const int ac = srcspec.alpha_channel, zc = srcspec.z_channel;
+    std::vector<PushPullLevel> pyramid (1);
+    pyramid[0].data = get_roi (srcspec);
+    pyramid[0].full = get_roi_full (srcspec);
+    imagesize_t npixels = pyramid[0].data.npixels();
+    int w = srcspec.width, h = srcspec.height;
     while (w > 1 || h > 1) {
         w = std::max (1, w/2);
         h = std::max (1, h/2);
-        ImageSpec smallspec (w, h, src.nchannels(), TypeDesc::FLOAT);
-        ImageBuf *small = new ImageBuf (smallspec);
-        ImageBufAlgo::resize (*small, *pyramid.back(), "triangle");
-        divide_by_alpha (*small, get_roi(smallspec), nthreads);
-        pyramid.push_back (std::shared_ptr<ImageBuf>(small));
-        //debug small->save();
-    }
-
-    // Now pull back up the pyramid by doing an alpha composite of level
-    // i over a resized level i+1, thus filling in the alpha holes.  By
-    // time we get to the top, pixels whose original alpha are
-    // unchanged, those with alpha < 1 are replaced by the blended
-    // colors of the higher pyramid levels.
-    for (int i = (int)pyramid.size()-2;  i >= 0;  --i) {
-        ImageBuf &big(*pyramid[i]), &small(*pyramid[i+1]);
-        ImageBuf blowup (big.spec());
-        ImageBufAlgo::resize (blowup, small, "triangle");
-        ImageBufAlgo::over (big, big, blowup);
-        //debug big.save (Strutil::format ("after%d.exr", i));
+        PushPullLevel level;
+        level.data = level.full = ROI (0, w, 0, h, 0, 1, 0, nc);
+        pyramid.push_back (level);
+        npixels += imagesize_t(w) * h;
+    }
+    std::unique_ptr<float[]> storage (new float [npixels * nc]);
+    float *p = storage.get();
+    for (auto &level : pyramid) {
+        level.pixels = p;
+        p += level.data.npixels() * nc;
+    }
+    src.get_pixels (pyramid[0].data, TypeDesc::FLOAT, pyramid[0].pixels);
+
+    // Push: construct the lower levels by successive x/2 resizing and
+    // dividing nonzero alpha pixels by their alpha (this "spreads out" the
+    // defined part of the image).  Levels below the first one without
+    // holes can never show through, so we stop there.
+    int nlevels = 1;
+    while (nlevels < (int)pyramid.size() &&
+           pushpull_has_holes (pyramid[nlevels-1], nc, ac, nthreads)) {
+        pushpull_resample (pyramid[nlevels-1], pyramid[nlevels], nc, ac, zc,
+                           false, nthreads);
+        ++nlevels;
     }
 
+    // Pull: back up the pyramid, composite each level over the resized
+    // level below it, thus filling in the alpha holes.  By the time we get
+    // to the top, pixels whose original alpha was 1 are unchanged, and
+    // those with alpha < 1 are blended with the colors of the lower
+    // pyramid levels.
+    for (int i = nlevels-2;  i >= 0;  --i)
+        pushpull_resample (pyramid[i+1], pyramid[i], nc, ac, zc,
+                           true, nthreads);
+
     // Now copy the completed base layer of the pyramid back to the
     // original requested output.
-    paste (dst, dstspec.x, dstspec.y, dstspec.z, 0, *pyramid[0]);
+    ImageSpec topspec = srcspec;
+    topspec.set_format (TypeDesc::FLOAT);
+    ImageBuf top (topspec, pyramid[0].pixels);
+    paste (dst, dstspec.x, dstspec.y, dstspec.z, 0, top);
 
     return true;
 }
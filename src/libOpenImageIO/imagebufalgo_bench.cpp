@@ -0,0 +1,453 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+// imagebufalgo_bench -- time the ImageBufAlgo functions over a matrix of
+// data types, channel counts, resolutions and thread counts, optionally
+// writing the results as JSON and comparing them against a baseline
+// JSON file written by an earlier run.
+//
+// Typical use:
+//     imagebufalgo_bench --json base.json
+//     ... make changes, rebuild ...
+//     imagebufalgo_bench --baseline base.json --tolerance 10
+
+
+#include "OpenImageIO/imageio.h"
+#include "OpenImageIO/imagebuf.h"
+#include "OpenImageIO/imagebufalgo.h"
+#include "OpenImageIO/argparse.h"
+#include "OpenImageIO/filesystem.h"
+#include "OpenImageIO/strutil.h"
+#include "OpenImageIO/sysutil.h"
+#include "OpenImageIO/timer.h"
+#include "OpenImageIO/ustring.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+OIIO_NAMESPACE_USING;
+
+static bool verbose = false;
+static int iterations = 1;
+static int ntrials = 3;
+static float tolerance = 10.0f;   // percent slowdown considered a regression
+static std::string threadlist = "1,0";
+static std::string reslist = "512,2048";
+static std::string typelist = "uint8,uint16,half,float";
+static std::string chanlist = "1,3,4";
+static std::string opfilter;
+static std::string json_filename;
+static std::string baseline_filename;
+
+
+
+static void
+getargs (int argc, char *argv[])
+{
+    bool help = false;
+    ArgParse ap;
+    ap.options ("imagebufalgo_bench\n"
+                OIIO_INTRO_STRING "\n"
+                "Usage:  imagebufalgo_bench [options]",
+                "--help", &help, "Print help message",
+                "-v", &verbose, "Verbose mode",
+                "--threads %s", &threadlist,
+                    ustring::format("Comma-separated thread counts, 0 = all cores (default: %s)", threadlist).c_str(),
+                "--res %s", &reslist,
+                    ustring::format("Comma-separated square resolutions (default: %s)", reslist).c_str(),
+                "--types %s", &typelist,
+                    ustring::format("Comma-separated pixel data types (default: %s)", typelist).c_str(),
+                "--channels %s", &chanlist,
+                    ustring::format("Comma-separated channel counts (default: %s)", chanlist).c_str(),
+                "--ops %s", &opfilter, "Comma-separated list of ops to run (default: all)",
+                "--iters %d", &iterations,
+                    ustring::format("Number of iterations per trial (default: %d)", iterations).c_str(),
+                "--trials %d", &ntrials,
+                    ustring::format("Number of trials, best is kept (default: %d)", ntrials).c_str(),
+                "--json %s", &json_filename, "Write results as JSON to this file",
+                "--baseline %s", &baseline_filename, "Compare against results in this JSON file",
+                "--tolerance %f", &tolerance,
+                    ustring::format("Percent slowdown reported as a regression (default: %g)", tolerance).c_str(),
+                NULL);
+    if (ap.parse (argc, (const char**)argv) < 0) {
+        std::cerr << ap.geterror() << std::endl;
+        ap.usage ();
+        exit (EXIT_FAILURE);
+    }
+    if (help) {
+        ap.usage ();
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+
+// One benchmarked operation. The function is handed a destination that
+// persists across iterations (so only the first, untimed, call pays for
+// allocating it), two source images of the type/size being tested, and
+// the thread count.
+struct BenchOp {
+    const char *name;
+    int minchannels;   // skip channel counts below this
+    std::function<bool(ImageBuf &dst, const ImageBuf &A, const ImageBuf &B,
+                       int nthreads)> func;
+};
+
+
+
+static std::vector<BenchOp> &
+bench_ops ()
+{
+    static ImageBuf kernel;
+    if (! kernel.initialized())
+        ImageBufAlgo::make_kernel (kernel, "gaussian", 5.0f, 5.0f);
+    static std::vector<BenchOp> ops = {
+        { "fill", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            if (! R.initialized())
+                R.reset (A.spec());
+            const float vals[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+            return ImageBufAlgo::fill (R, vals, ROI::All(), nt);
+        } },
+        { "copy", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::copy (R, A, TypeDesc::UNKNOWN, ROI::All(), nt);
+        } },
+        { "copy_to_float", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::copy (R, A, TypeDesc::FLOAT, ROI::All(), nt);
+        } },
+        { "channels", 3, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            const int order[3] = { 2, 1, 0 };
+            return ImageBufAlgo::channels (R, A, 3, order, NULL, NULL,
+                                           false, nt);
+        } },
+        { "flip", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::flip (R, A, ROI::All(), nt);
+        } },
+        { "rotate90", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::rotate90 (R, A, ROI::All(), nt);
+        } },
+        { "transpose", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::transpose (R, A, ROI::All(), nt);
+        } },
+        { "clamp", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::clamp (R, A, 0.1f, 0.9f, false, ROI::All(), nt);
+        } },
+        { "add", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &B, int nt) {
+            return ImageBufAlgo::add (R, A, B, ROI::All(), nt);
+        } },
+        { "add_const", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::add (R, A, 0.125f, ROI::All(), nt);
+        } },
+        { "sub", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &B, int nt) {
+            return ImageBufAlgo::sub (R, A, B, ROI::All(), nt);
+        } },
+        { "absdiff", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &B, int nt) {
+            return ImageBufAlgo::absdiff (R, A, B, ROI::All(), nt);
+        } },
+        { "mul", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &B, int nt) {
+            return ImageBufAlgo::mul (R, A, B, ROI::All(), nt);
+        } },
+        { "mul_const", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::mul (R, A, 0.5f, ROI::All(), nt);
+        } },
+        { "div", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &B, int nt) {
+            return ImageBufAlgo::div (R, A, B, ROI::All(), nt);
+        } },
+        { "mad", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &B, int nt) {
+            return ImageBufAlgo::mad (R, A, B, A, ROI::All(), nt);
+        } },
+        { "invert", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::invert (R, A, ROI::All(), nt);
+        } },
+        { "pow", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::pow (R, A, 2.2f, ROI::All(), nt);
+        } },
+        { "channel_sum", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::channel_sum (R, A, NULL, ROI::All(), nt);
+        } },
+        { "rangecompress", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::rangecompress (R, A, false, ROI::All(), nt);
+        } },
+        { "colorconvert", 3, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::colorconvert (R, A, "sRGB", "linear",
+                                               false, "", "", NULL,
+                                               ROI::All(), nt);
+        } },
+        { "premult", 4, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::premult (R, A, ROI::All(), nt);
+        } },
+        { "unpremult", 4, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::unpremult (R, A, ROI::All(), nt);
+        } },
+        { "over", 4, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &B, int nt) {
+            return ImageBufAlgo::over (R, A, B, ROI::All(), nt);
+        } },
+        { "computePixelStats", 1, [](ImageBuf &, const ImageBuf &A, const ImageBuf &, int nt) {
+            ImageBufAlgo::PixelStats stats;
+            return ImageBufAlgo::computePixelStats (stats, A, ROI::All(), nt);
+        } },
+        { "isConstantColor", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            // Scan a truly constant image, so the test runs to the end
+            // rather than stopping at the first mismatched pixel.
+            if (! R.initialized()) {
+                R.reset (A.spec());
+                const float half[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+                ImageBufAlgo::fill (R, half);
+            }
+            return ImageBufAlgo::isConstantColor (R, NULL, ROI::All(), nt);
+        } },
+        { "compare", 1, [](ImageBuf &, const ImageBuf &A, const ImageBuf &B, int nt) {
+            ImageBufAlgo::CompareResults cr;
+            return ImageBufAlgo::compare (A, B, 1.0e-6f, 1.0e-6f, cr,
+                                          ROI::All(), nt);
+        } },
+        { "resize_half", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            if (! R.initialized()) {
+                ImageSpec spec = A.spec();
+                spec.width = spec.full_width = std::max (1, spec.width/2);
+                spec.height = spec.full_height = std::max (1, spec.height/2);
+                R.reset (spec);
+            }
+            return ImageBufAlgo::resize (R, A, "", 0.0f, ROI::All(), nt);
+        } },
+        { "resample_half", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            if (! R.initialized()) {
+                ImageSpec spec = A.spec();
+                spec.width = spec.full_width = std::max (1, spec.width/2);
+                spec.height = spec.full_height = std::max (1, spec.height/2);
+                R.reset (spec);
+            }
+            return ImageBufAlgo::resample (R, A, true, ROI::All(), nt);
+        } },
+        { "rotate", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::rotate (R, A, 0.5f, string_view(), 0.0f,
+                                         false, ROI::All(), nt);
+        } },
+        { "convolve", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::convolve (R, A, kernel, true, ROI::All(), nt);
+        } },
+        { "unsharp_mask", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::unsharp_mask (R, A, "gaussian", 3.0f, 1.0f,
+                                               0.0f, ROI::All(), nt);
+        } },
+        { "median_filter", 1, [](ImageBuf &R, const ImageBuf &A, const ImageBuf &, int nt) {
+            return ImageBufAlgo::median_filter (R, A, 3, 3, ROI::All(), nt);
+        } },
+    };
+    return ops;
+}
+
+
+
+struct BenchResult {
+    std::string op;
+    std::string type;
+    int nchannels;
+    int res;
+    int threads;
+    double time;      // seconds per call, best trial
+};
+
+
+
+static std::string
+result_key (string_view op, string_view type, int nchannels, int res,
+            int threads)
+{
+    return Strutil::format ("%s/%s/%d/%d/%d", op, type, nchannels, res,
+                            threads);
+}
+
+
+
+// Read a results file written by write_json. Each result lives on its
+// own line, so there's no need for a general JSON parser.
+static bool
+read_baseline (const std::string &filename,
+               std::map<std::string,double> &baseline)
+{
+    FILE *file = Filesystem::fopen (filename, "r");
+    if (! file) {
+        std::cerr << "imagebufalgo_bench: could not open " << filename << "\n";
+        return false;
+    }
+    char line[1024];
+    while (fgets (line, sizeof(line), file)) {
+        const char *rec = strstr (line, "{\"op\"");
+        if (! rec)
+            continue;
+        char op[64], type[16];
+        int nchannels, res, threads;
+        double time;
+        if (sscanf (rec, "{\"op\":\"%63[^\"]\",\"type\":\"%15[^\"]\","
+                    "\"nchannels\":%d,\"res\":%d,\"threads\":%d,\"time\":%lf",
+                    op, type, &nchannels, &res, &threads, &time) == 6)
+            baseline[result_key (op, type, nchannels, res, threads)] = time;
+    }
+    fclose (file);
+    return true;
+}
+
+
+
+static bool
+write_json (const std::string &filename,
+            const std::vector<BenchResult> &results)
+{
+    FILE *file = Filesystem::fopen (filename, "w");
+    if (! file) {
+        std::cerr << "imagebufalgo_bench: could not open " << filename << "\n";
+        return false;
+    }
+    fprintf (file, "{\n\"oiio_version\":\"%s\",\n", OIIO_VERSION_STRING);
+    fprintf (file, "\"hardware_threads\":%d,\n",
+             (int) Sysutil::hardware_concurrency());
+    fprintf (file, "\"trials\":%d,\n\"iterations\":%d,\n", ntrials, iterations);
+    fprintf (file, "\"results\":[\n");
+    for (size_t i = 0, e = results.size(); i < e; ++i) {
+        const BenchResult &r (results[i]);
+        fprintf (file, "{\"op\":\"%s\",\"type\":\"%s\",\"nchannels\":%d,"
+                 "\"res\":%d,\"threads\":%d,\"time\":%.9g}%s\n",
+                 r.op.c_str(), r.type.c_str(), r.nchannels, r.res,
+                 r.threads, r.time, i+1 < e ? "," : "");
+    }
+    fprintf (file, "]\n}\n");
+    fclose (file);
+    return true;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+    getargs (argc, argv);
+
+    std::vector<int> threads, resolutions, chans;
+    std::vector<std::string> types, ops_wanted;
+    Strutil::extract_from_list_string (threads, threadlist);
+    Strutil::extract_from_list_string (resolutions, reslist);
+    Strutil::extract_from_list_string (chans, chanlist);
+    Strutil::split (typelist, types, ",");
+    if (opfilter.size())
+        Strutil::split (opfilter, ops_wanted, ",");
+
+    std::map<std::string,double> baseline;
+    if (baseline_filename.size() && ! read_baseline (baseline_filename, baseline))
+        return EXIT_FAILURE;
+
+    std::cout << "ImageBufAlgo benchmark: " << ntrials << " trials x "
+              << iterations << " iterations, "
+              << Sysutil::hardware_concurrency() << " hardware threads\n";
+
+    std::vector<BenchResult> results;
+    int nregressions = 0;
+    for (const std::string &typestr : types) {
+        TypeDesc type (typestr);
+        if (type == TypeDesc::UNKNOWN) {
+            std::cerr << "imagebufalgo_bench: unknown type \"" << typestr << "\"\n";
+            continue;
+        }
+        for (int nc : chans) {
+            for (int res : resolutions) {
+                // Create the sources once per configuration: a uniform
+                // noise image and a gaussian noise image, so arithmetic
+                // ops can't take data-dependent shortcuts.
+                ImageSpec spec (res, res, nc, type);
+                if (nc == 4)
+                    spec.alpha_channel = 3;
+                ImageBuf A (spec), B (spec);
+                ImageBufAlgo::noise (A, "uniform", 0.05f, 1.0f, false, 1);
+                ImageBufAlgo::noise (B, "gaussian", 0.5f, 0.2f, false, 2);
+                std::cout << "\n" << typestr << " " << nc << " channel"
+                          << (nc > 1 ? "s" : "") << ", " << res << "x"
+                          << res << "\n";
+                for (BenchOp &op : bench_ops()) {
+                    if (nc < op.minchannels)
+                        continue;
+                    if (ops_wanted.size() &&
+                        std::find (ops_wanted.begin(), ops_wanted.end(),
+                                   op.name) == ops_wanted.end())
+                        continue;
+                    for (int nt : threads) {
+                        ImageBuf R;
+                        // Untimed call to allocate R and warm up caches.
+                        if (! op.func (R, A, B, nt)) {
+                            std::cout << Strutil::format ("  %-18s  failed: %s\n",
+                                                          op.name, R.geterror());
+                            break;
+                        }
+                        double range = 0.0;
+                        double t = time_trial ([&](){ op.func (R, A, B, nt); },
+                                               ntrials, iterations, &range) / iterations;
+                        BenchResult r = { op.name, typestr, nc, res, nt, t };
+                        results.push_back (r);
+                        double mpels = double(res)*double(res) / t * 1.0e-6;
+                        std::string line = Strutil::format (
+                            "  %-18s  %2d thr  %9.3f ms  %8.1f Mpel/s",
+                            op.name, nt, t*1000.0, mpels);
+                        if (verbose)
+                            line += Strutil::format ("  (range %.3f ms)",
+                                                     range/iterations*1000.0);
+                        auto found = baseline.find (result_key (op.name, typestr,
+                                                                nc, res, nt));
+                        if (found != baseline.end() && found->second > 0.0) {
+                            double change = (t / found->second - 1.0) * 100.0;
+                            line += Strutil::format ("  %+6.1f%%", change);
+                            if (change > tolerance) {
+                                line += "  REGRESSION";
+                                ++nregressions;
+                            }
+                        }
+                        std::cout << line << "\n";
+                    }
+                }
+            }
+        }
+    }
+
+    if (json_filename.size() && ! write_json (json_filename, results))
+        return EXIT_FAILURE;
+
+    if (baseline.size()) {
+        std::cout << "\n" << nregressions << " regression"
+                  << (nregressions == 1 ? "" : "s") << " (slower than "
+                  << baseline_filename << " by more than " << tolerance
+                  << "%)\n";
+        if (nregressions)
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -34,6 +34,7 @@
 
 #include <OpenEXR/half.h>
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <limits>
@@ -42,6 +43,10 @@
 #include "OpenImageIO/imagebufalgo.h"
 #include "OpenImageIO/imagebufalgo_util.h"
 #include "OpenImageIO/dassert.h"
+#include "OpenImageIO/hash.h"
+#include "OpenImageIO/simd.h"
+#include "OpenImageIO/thread.h"
+#include "OpenImageIO/parallel.h"
 #include "OpenImageIO/SHA1.h"
 
 #ifdef USE_OPENSSL
@@ -130,6 +135,145 @@ finalize (ImageBufAlgo::PixelStats &p)
 
 
 
+// Accumulate into p the stats of npixels interleaved float pixels of nc
+// channels, which are channels chbegin..chbegin+nc-1 of p.
+//
+// A block of 4 pixels is 4*nc floats, which we take as nc float4's; lane
+// t of the j-th one always holds channel (4j+t) % nc, so nc accumulators
+// of each kind serve any channel count, with no branches per value.  The
+// float partial sums are folded into p's double sums every 256 blocks to
+// keep their precision.  Leftover pixels go through val().
+static void
+stats_row (ImageBufAlgo::PixelStats &p, const float *data, int npixels,
+           int nc, int chbegin)
+{
+    using namespace simd;
+    const float4 inf (std::numeric_limits<float>::infinity());
+    std::vector<float4> sum (nc), sum2 (nc), vmin (nc), vmax (nc);
+    std::vector<int4> finite (nc), nans (nc);
+    for (int j = 0;  j < nc;  ++j) {
+        sum[j] = float4::Zero();
+        sum2[j] = float4::Zero();
+        vmin[j] = inf;
+        vmax[j] = -inf;
+        finite[j] = int4::Zero();
+        nans[j] = int4::Zero();
+    }
+    auto flush = [&]() {
+        for (int j = 0;  j < nc;  ++j) {
+            for (int t = 0;  t < 4;  ++t) {
+                int c = chbegin + (4*j+t) % nc;
+                p.sum[c] += sum[j][t];
+                p.sum2[c] += sum2[j][t];
+            }
+            sum[j] = float4::Zero();
+            sum2[j] = float4::Zero();
+        }
+    };
+    int nblocks = npixels / 4;
+    for (int b = 0;  b < nblocks;  ++b) {
+        const float *d = data + size_t(b) * 4 * nc;
+        for (int j = 0;  j < nc;  ++j) {
+            float4 v (d + 4*j);
+            bool4 isfin = abs(v) < inf;
+            float4 vf = blend0 (v, isfin);
+            sum[j] += vf;
+            sum2[j] += vf * vf;
+            vmin[j] = min (vmin[j], blend (inf, v, isfin));
+            vmax[j] = max (vmax[j], blend (-inf, v, isfin));
+            finite[j] -= bitcast_to_int (isfin);     // true is -1
+            nans[j] -= bitcast_to_int (v != v);
+        }
+        if ((b & 255) == 255)
+            flush ();
+    }
+    flush ();
+    for (int j = 0;  j < nc;  ++j) {
+        for (int t = 0;  t < 4;  ++t) {
+            int c = chbegin + (4*j+t) % nc;
+            p.min[c] = std::min (p.min[c], vmin[j][t]);
+            p.max[c] = std::max (p.max[c], vmax[j][t]);
+            p.finitecount[c] += finite[j][t];
+            p.nancount[c] += nans[j][t];
+            p.infcount[c] += nblocks - finite[j][t] - nans[j][t];
+        }
+    }
+    for (int i = 4*nblocks*nc, e = npixels*nc;  i < e;  ++i)
+        val (p, chbegin + i % nc, data[i]);
+}
+
+
+
+// Accumulate into p the stats of npixels interleaved unsigned integer
+// pixels, in the native type: exact integer sums, converted to the
+// normalized float range only at the end of the row.
+template<class T>
+static void
+stats_row_uint (ImageBufAlgo::PixelStats &p, const T *data, int npixels,
+                int nc, int chbegin)
+{
+    const double scale = 1.0 / double(std::numeric_limits<T>::max());
+    for (int c = 0;  c < nc;  ++c) {
+        uint64_t sum = 0, sum2 = 0;
+        T vmin = std::numeric_limits<T>::max(), vmax = 0;
+        const T *d = data + c;
+        for (int i = 0;  i < npixels;  ++i, d += nc) {
+            uint64_t v = *d;
+            sum += v;
+            sum2 += v * v;
+            vmin = std::min (vmin, *d);
+            vmax = std::max (vmax, *d);
+        }
+        int ch = chbegin + c;
+        p.sum[ch] += double(sum) * scale;
+        p.sum2[ch] += double(sum2) * (scale * scale);
+        p.finitecount[ch] += npixels;
+        if (npixels) {
+            p.min[ch] = std::min (p.min[ch], convert_type<T,float>(vmin));
+            p.max[ch] = std::max (p.max[ch], convert_type<T,float>(vmax));
+        }
+    }
+}
+
+
+
+// Stats of the rows of roi of src (not deep), added into stats.  Pixels
+// are read in their native type (direct from local memory when possible)
+// for uint8 and uint16 images, otherwise as float.
+template <class T>
+static void
+computePixelStats_rows (const ImageBuf &src, ImageBufAlgo::PixelStats &stats,
+                        ROI roi)
+{
+    const bool native = std::is_same<T,unsigned char>::value
+                     || std::is_same<T,unsigned short>::value;
+    typedef typename std::conditional<native, T, float>::type V;
+    const TypeDesc vtype = BaseTypeFromC<V>::value;
+    const int nc = roi.nchannels();
+    const bool direct = std::is_same<T,V>::value && src.localpixels()
+        && src.contains_roi (roi) && nc == src.nchannels();
+    std::vector<V> buf (direct ? 0 : size_t(roi.width()) * nc);
+    for (int z = roi.zbegin;  z < roi.zend;  ++z)
+        for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+            const V *row;
+            if (direct) {
+                row = (const V *)src.pixeladdr (roi.xbegin, y, z);
+            } else {
+                src.get_pixels (ROI (roi.xbegin, roi.xend, y, y+1, z, z+1,
+                                     roi.chbegin, roi.chend), vtype, &buf[0]);
+                row = &buf[0];
+            }
+            if (native)
+                stats_row_uint (stats, (const T *)row, roi.width(), nc,
+                                roi.chbegin);
+            else
+                stats_row (stats, (const float *)row, roi.width(), nc,
+                           roi.chbegin);
+        }
+}
+
+
+
 template <class T>
 static bool
 computePixelStats_ (const ImageBuf &src, ImageBufAlgo::PixelStats &stats,
@@ -176,17 +320,16 @@ computePixelStats_ (const ImageBuf &src, ImageBufAlgo::PixelStats &stats,
             }
         }
     } else {  // Non-deep case
-        // Loop over all pixels ...
-        for (ImageBuf::ConstIterator<T> s(src, roi); ! s.done();  ++s) {
-            for (int c = roi.chbegin;  c < roi.chend;  ++c) {
-                float value = s[c];
-                val (tmp, c, value);
-                if ((tmp.finitecount[c] % PIXELS_PER_BATCH) == 0) {
-                    merge (stats, tmp);
-                    reset (tmp, nchannels);
-                }
-            }
-        }
+        // Each chunk of the image accumulates its own stats, row by row,
+        // then merges them into the totals.
+        spin_mutex mutex;
+        ImageBufAlgo::parallel_image ([&](ROI chunk){
+            ImageBufAlgo::PixelStats chunkstats;
+            reset (chunkstats, nchannels);
+            computePixelStats_rows<T> (src, chunkstats, chunk);
+            spin_lock lock (mutex);
+            merge (stats, chunkstats);
+        }, roi, nthreads);
     }
 
     // Merge anything left over
@@ -268,26 +411,54 @@ compare_value (ImageBuf::ConstIterator<BUFT,float> &a, int chan,
 
 
 
+// The running sums for comparing one region of the images.
+struct ComparePart {
+    ImageBufAlgo::CompareResults result;
+    double totalerror, totalsqrerror;
+    float maxval;
+    imagesize_t nvals;
+    int64_t order;    // where the region falls in scanline order
+
+    ComparePart (int64_t order=0)
+        : totalerror(0), totalsqrerror(0), maxval(1.0f), nvals(0),
+          order(order)
+    {
+        result.maxerror = 0;
+        result.maxx = 0, result.maxy = 0, result.maxz = 0, result.maxc = 0;
+        result.nfail = 0, result.nwarn = 0;
+    }
+
+    // Fold in the part that comes next in scanline order.  On ties, the
+    // first place the biggest error occurs is what's reported, just as
+    // if the whole image were compared in order.
+    void merge (const ComparePart &p) {
+        if (p.result.maxerror > result.maxerror) {
+            result.maxerror = p.result.maxerror;
+            result.maxx = p.result.maxx;
+            result.maxy = p.result.maxy;
+            result.maxz = p.result.maxz;
+            result.maxc = p.result.maxc;
+        }
+        result.nfail += p.result.nfail;
+        result.nwarn += p.result.nwarn;
+        totalerror += p.totalerror;
+        totalsqrerror += p.totalsqrerror;
+        maxval = std::max (maxval, p.maxval);
+        nvals += p.nvals;
+    }
+};
+
+
+
 template <class Atype, class Btype>
-static bool
-compare_ (const ImageBuf &A, const ImageBuf &B,
-          float failthresh, float warnthresh,
-          ImageBufAlgo::CompareResults &result,
-          ROI roi, int nthreads)
+static void
+compare_region (const ImageBuf &A, const ImageBuf &B,
+                float failthresh, float warnthresh,
+                ComparePart &part, ROI roi)
 {
-    imagesize_t npels = roi.npixels();
-    imagesize_t nvals = npels * roi.nchannels();
+    ImageBufAlgo::CompareResults &result (part.result);
     int Achannels = A.nchannels(), Bchannels = B.nchannels();
-
-    // Compare the two images.
-    //
-    double totalerror = 0;
-    double totalsqrerror = 0;
-    result.maxerror = 0;
-    result.maxx=0, result.maxy=0, result.maxz=0, result.maxc=0;
-    result.nfail = 0, result.nwarn = 0;
-    float maxval = 1.0;  // max possible value
-
+    part.nvals += roi.npixels() * roi.nchannels();
     ImageBuf::ConstIterator<Atype> a (A, roi, ImageBuf::WrapBlack);
     ImageBuf::ConstIterator<Btype> b (B, roi, ImageBuf::WrapBlack);
     bool deep = A.deep();
@@ -303,7 +474,7 @@ compare_ (const ImageBuf &A, const ImageBuf &B,
                 for (int c = roi.chbegin;  c < roi.chend;  ++c)
                     for (int s = 0, e = a.deep_samples(); s < e;  ++s) {
                         compare_value (a, c, a.deep_value(c,s),
-                                       b.deep_value(c,s), result, maxval,
+                                       b.deep_value(c,s), result, part.maxval,
                                        batcherror, batch_sqrerror,
                                        failed, warned, failthresh, warnthresh);
                     }
@@ -314,17 +485,77 @@ compare_ (const ImageBuf &A, const ImageBuf &B,
                 for (int c = roi.chbegin;  c < roi.chend;  ++c)
                     compare_value (a, c, c < Achannels ? a[c] : 0.0f,
                                    c < Bchannels ? b[c] : 0.0f,
-                                   result, maxval, batcherror, batch_sqrerror,
-                                   failed, warned, failthresh, warnthresh);
+                                   result, part.maxval, batcherror,
+                                   batch_sqrerror, failed, warned,
+                                   failthresh, warnthresh);
             }
         }
-        totalerror += batcherror;
-        totalsqrerror += batch_sqrerror;
+        part.totalerror += batcherror;
+        part.totalsqrerror += batch_sqrerror;
+    }
+}
+
+
+
+template <class Atype, class Btype>
+static bool
+compare_ (const ImageBuf &A, const ImageBuf &B,
+          float failthresh, float warnthresh,
+          imagesize_t maxfail, float hardfail,
+          ImageBufAlgo::CompareResults &result,
+          ROI roi, int nthreads)
+{
+    // Compare the images in bands of scanlines (or of the image's tile
+    // height, so each band touches as few cache tiles as possible),
+    // in parallel.  Once the failures are past the limits, the bands not
+    // yet started are skipped.
+    int height = roi.height();
+    int64_t nrows = int64_t(height) * roi.depth();
+    int tileheight = std::max (A.spec().tile_height, B.spec().tile_height);
+    int64_t bandrows = std::max (tileheight, std::max (1, 65536 / std::max (1, roi.width())));
+    std::vector<ComparePart> parts;
+    mutex parts_mutex;
+    ComparePart sofar;
+    atomic_int stop (0);
+    auto band = [&](int64_t b, int64_t e) {
+        if (stop)
+            return;
+        ComparePart part (b);
+        while (b < e) {
+            int z = int(b / height), y = int(b % height);
+            int yend = int(std::min (int64_t(height), y + (e - b)));
+            compare_region<Atype,Btype> (A, B, failthresh, warnthresh, part,
+                     ROI (roi.xbegin, roi.xend, roi.ybegin+y, roi.ybegin+yend,
+                          roi.zbegin+z, roi.zbegin+z+1,
+                          roi.chbegin, roi.chend));
+            b += yend - y;
+        }
+        lock_guard lock (parts_mutex);
+        parts.push_back (part);
+        sofar.merge (part);
+        if (sofar.result.nfail > maxfail || sofar.result.maxerror > hardfail)
+            stop = 1;
+    };
+    if (nthreads == 1 || nrows <= bandrows) {
+        for (int64_t b = 0; b < nrows && ! stop; b += bandrows)
+            band (b, std::min (nrows, b + bandrows));
+    } else {
+        parallel_for_chunked (0, nrows, bandrows, band);
     }
-    result.meanerror = totalerror / nvals;
-    result.rms_error = sqrt (totalsqrerror / nvals);
-    result.PSNR = 20.0 * log10 (maxval / result.rms_error);
-    return result.nfail == 0;
+
+    std::sort (parts.begin(), parts.end(),
+               [](const ComparePart &a, const ComparePart &b){
+                   return a.order < b.order;
+               });
+    ComparePart total;
+    for (auto&& p : parts)
+        total.merge (p);
+    result = total.result;
+    imagesize_t nvals = std::max (total.nvals, imagesize_t(1));
+    result.meanerror = total.totalerror / nvals;
+    result.rms_error = sqrt (total.totalsqrerror / nvals);
+    result.PSNR = 20.0 * log10 (total.maxval / result.rms_error);
+    return result.nfail == 0 && ! stop;
 }
 
 
@@ -334,6 +565,21 @@ ImageBufAlgo::compare (const ImageBuf &A, const ImageBuf &B,
                        float failthresh, float warnthresh,
                        ImageBufAlgo::CompareResults &result,
                        ROI roi, int nthreads)
+{
+    return compare (A, B, failthresh, warnthresh,
+                    std::numeric_limits<imagesize_t>::max(),
+                    std::numeric_limits<float>::infinity(),
+                    result, roi, nthreads);
+}
+
+
+
+bool
+ImageBufAlgo::compare (const ImageBuf &A, const ImageBuf &B,
+                       float failthresh, float warnthresh,
+                       imagesize_t maxfail, float hardfail,
+                       ImageBufAlgo::CompareResults &result,
+                       ROI roi, int nthreads)
 {
     // If no ROI is defined, use the union of the data windows of the two
     // images.
@@ -348,11 +594,8 @@ ImageBufAlgo::compare (const ImageBuf &A, const ImageBuf &B,
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "compare", compare_,
                           A.spec().format, B.spec().format,
-                          A, B, failthresh, warnthresh, result,
-                          roi, nthreads);
-    // FIXME - The nthreads argument is for symmetry with the rest of
-    // ImageBufAlgo and for future expansion. But for right now, we
-    // don't actually split by threads.  Maybe later.
+                          A, B, failthresh, warnthresh, maxfail, hardfail,
+                          result, roi, nthreads);
     return ok;
 }
 
@@ -492,41 +735,33 @@ ImageBufAlgo::isMonochrome (const ImageBuf &src, ROI roi, int nthreads)
 
 template<typename T>
 static bool
-color_count_ (const ImageBuf &src, atomic_ll *count,
+color_count_ (const ImageBuf &src, imagesize_t *count,
               int ncolors, const float *color, const float *eps,
               ROI roi, int nthreads)
 {
-    if (nthreads != 1 && roi.npixels() >= 1000) {
-        // Lots of pixels and request for multi threads? Parallelize.
-        ImageBufAlgo::parallel_image (
-            OIIO::bind(color_count_<T>, OIIO::ref(src),
-                        count, ncolors, color, eps,
-                        _1 /*roi*/, 1 /*nthreads*/),
-            roi, nthreads);
-        return true;
-    }
-
-    // Serial case
+    // Each band counts into its own private tallies, which are merged
+    // into the caller's counts once per band rather than per pixel.
+    spin_mutex mutex;
     int nchannels = src.nchannels();
-    long long *n = ALLOCA (long long, ncolors);
-    for (int col = 0;  col < ncolors;  ++col)
-        n[col] = 0;
-    for (ImageBuf::ConstIterator<T> p (src, roi);  !p.done();  ++p) {
-        int coloffset = 0;
-        for (int col = 0;  col < ncolors;  ++col, coloffset += nchannels) {
-            int match = 1;
-            for (int c = roi.chbegin;  c < roi.chend;  ++c) {
-                if (fabsf(p[c] - color[coloffset+c]) > eps[c]) {
-                    match = 0;
-                    break;
+    ImageBufAlgo::parallel_image ([&](ROI roi){
+        std::vector<imagesize_t> n (ncolors, 0);
+        for (ImageBuf::ConstIterator<T> p (src, roi);  !p.done();  ++p) {
+            int coloffset = 0;
+            for (int col = 0;  col < ncolors;  ++col, coloffset += nchannels) {
+                int match = 1;
+                for (int c = roi.chbegin;  c < roi.chend;  ++c) {
+                    if (fabsf(p[c] - color[coloffset+c]) > eps[c]) {
+                        match = 0;
+                        break;
+                    }
                 }
+                n[col] += match;
             }
-            n[col] += match;
         }
-    }
-
-    for (int col = 0;  col < ncolors;  ++col)
-        count[col] += n[col];
+        spin_lock lock (mutex);
+        for (int col = 0;  col < ncolors;  ++col)
+            count[col] += n[col];
+    }, roi, roi.npixels() < 1000 ? 1 : nthreads);
     return true;
 }
 
@@ -554,7 +789,7 @@ ImageBufAlgo::color_count (const ImageBuf &src, imagesize_t *count,
         count[col] = 0;
     bool ok;
     OIIO_DISPATCH_TYPES (ok, "color_count", color_count_, src.spec().format,
-                         src, (atomic_ll *)count, ncolors, color, eps,
+                         src, count, ncolors, color, eps,
                          roi, nthreads);
     return ok;
 }
@@ -801,19 +1036,32 @@ simplePixelHashSHA1 (const ImageBuf &src,
 
 
 
-// Wrapper to single-threadedly SHA1 hash a region in blocks and store
-// the results in a designated place.
+// Call f(b) for each b in [0,nblocks), using up to nthreads threads (0
+// means the global "threads" attribute) of the shared pool, the calling
+// thread among them.  Blocks are handed out one at a time as threads free
+// up, so uneven blocks still balance.
+template<class F>
 static void
-sha1_hasher (const ImageBuf *src, ROI roi, int blocksize,
-             std::string *results, int firstresult)
+parallel_blocks (int nblocks, int nthreads, F f)
 {
-    ROI broi = roi;
-    for (int y = roi.ybegin; y < roi.yend; y += blocksize) {
-        broi.ybegin = y;
-        broi.yend = std::min (y+blocksize, roi.yend);
-        std::string s = simplePixelHashSHA1 (*src, "", broi);
-        results[firstresult++] = s;
+    if (nthreads <= 0)
+        OIIO::getattribute ("threads", nthreads);
+    thread_pool *pool = default_thread_pool();
+    nthreads = std::min (std::min (nthreads, nblocks), pool->size()+1);
+    atomic_int next (0);
+    auto worker = [&](int /*id*/){
+        for (int b;  (b = next++) < nblocks;  )
+            f (b);
+    };
+    if (nthreads <= 1) {
+        worker (-1);
+        return;
     }
+    task_set<void> tasks (pool);
+    for (int t = 1;  t < nthreads;  ++t)
+        tasks.push (pool->push (worker));
+    worker (-1);
+    tasks.wait ();
 }
 
 } // anon namespace
@@ -832,30 +1080,14 @@ ImageBufAlgo::computePixelHashSHA1 (const ImageBuf &src,
     if (blocksize <= 0 || blocksize >= roi.height())
         return simplePixelHashSHA1 (src, extrainfo, roi);
 
-    // Request for 0 threads means "use the OIIO global thread count"
-    if (nthreads <= 0)
-        OIIO::getattribute ("threads", nthreads);
-
     int nblocks = (roi.height()+blocksize-1) / blocksize;
     std::vector<std::string> results (nblocks);
-    if (nthreads <= 1) {
-        sha1_hasher (&src, roi, blocksize, &results[0], 0);
-    } else {
-        // parallel case
-        OIIO::thread_group threads;
-        int blocks_per_thread = (nblocks+nthreads-1) / nthreads;
+    parallel_blocks (nblocks, nthreads, [&](int b){
         ROI broi = roi;
-        for (int b = 0, t = 0;  b < nblocks;  b += blocks_per_thread, ++t) {
-            int y = roi.ybegin + b*blocksize;
-            if (y >= roi.yend)
-                break;
-            broi.ybegin = y;
-            broi.yend = std::min (y+blocksize*blocks_per_thread, roi.yend);
-            threads.add_thread (new OIIO::thread (sha1_hasher, &src, broi,
-                                                   blocksize, &results[0], b));
-        }
-        threads.join_all ();
-    }
+        broi.ybegin = roi.ybegin + b*blocksize;
+        broi.yend = std::min (broi.ybegin+blocksize, roi.yend);
+        results[b] = simplePixelHashSHA1 (src, "", broi);
+    });
 
 #ifdef USE_OPENSSL
     // If OpenSSL was available at build time, use its SHA-1
@@ -890,6 +1122,49 @@ ImageBufAlgo::computePixelHashSHA1 (const ImageBuf &src,
 
 
 
+std::string
+ImageBufAlgo::computePixelHashXX64 (const ImageBuf &src,
+                                    string_view extrainfo,
+                                    ROI roi, int blocksize, int nthreads)
+{
+    if (! roi.defined())
+        roi = get_roi (src.spec());
+    if (blocksize <= 0)
+        blocksize = 64;
+
+    // Hash each block of scanlines (of each z plane) independently, then
+    // hash the array of block hashes.  Full-width rows of local pixels are
+    // one contiguous span and are hashed in place; otherwise the block's
+    // pixels are gathered with get_pixels, giving the same bytes.
+    const size_t scanline_bytes = size_t(roi.width()) * src.spec().pixel_bytes();
+    const int yblocks = (roi.height()+blocksize-1) / blocksize;
+    const int nblocks = yblocks * roi.depth();
+    const bool contiguous = src.localpixels() && src.contains_roi (roi) &&
+                            roi.xbegin == src.xbegin() && roi.xend == src.xend();
+    std::vector<unsigned long long> results (nblocks);
+    parallel_blocks (nblocks, nthreads, [&](int b){
+        int z = roi.zbegin + b / yblocks;
+        int y = roi.ybegin + (b % yblocks) * blocksize;
+        int y1 = std::min (y + blocksize, roi.yend);
+        size_t nbytes = scanline_bytes * (y1 - y);
+        if (contiguous) {
+            results[b] = xxhash::XXH64 (src.pixeladdr (roi.xbegin, y, z), nbytes);
+        } else {
+            std::unique_ptr<char[]> tmp (new char [nbytes]);
+            src.get_pixels (ROI (roi.xbegin, roi.xend, y, y1, z, z+1),
+                            src.spec().format, &tmp[0]);
+            results[b] = xxhash::XXH64 (&tmp[0], nbytes);
+        }
+    });
+    unsigned long long h = xxhash::XXH64 (results.data(),
+                                          results.size() * sizeof(results[0]));
+    if (extrainfo.size())
+        h = xxhash::XXH64 (extrainfo.data(), extrainfo.size(), h);
+    return Strutil::format ("%016llX", h);
+}
+
+
+
 
 /// histogram_impl -----------------------------------------------------------
 /// Fully type-specialized version of histogram.
@@ -900,47 +1175,101 @@ ImageBufAlgo::computePixelHashSHA1 (const ImageBuf &src,
 /// range and x is the value in the min->max range. There is one special
 /// case x==max for which the formula is not used and x is assigned to the
 /// last bin at position (bins-1) in the vector histogram.
+///
+/// Each thread bins its own band of scanlines into private counters, four
+/// values at a time, and the bands are summed only once at the end.
 /// --------------------------------------------------------------------------
-template<class Atype>
+static void
+histogram_span (const float *p, stride_t stride, int n, imagesize_t *hist,
+                int bins, float min, float max, float ratio,
+                imagesize_t &nlow, imagesize_t &nhigh)
+{
+    using namespace simd;
+    float4 vmin (min), vmax (max), vratio (ratio);
+    int4 vlast (bins-1), none (-1);
+    int4 nlow4 = int4::Zero(), nbinned4 = int4::Zero();
+    int i = 0;
+    for ( ; i+4 <= n;  i += 4, p += 4*stride) {
+        float4 c (p[0], p[stride], p[2*stride], p[3*stride]);
+        bool4 inrange = (c >= vmin) & (c <= vmax);
+        // Clamping takes care of both x==max and any rounding of
+        // (x-min)*ratio up to exactly 'bins'.
+        int4 bin = simd::min (floori ((c-vmin)*vratio), vlast);
+        bin = select (inrange, bin, none);
+        nlow4 += blend0 (int4::One(), c < vmin);
+        nbinned4 += blend0 (int4::One(), inrange);
+        int b[4];
+        bin.store (b);
+        for (int j = 0;  j < 4;  ++j)
+            if (b[j] >= 0)
+                ++hist[b[j]];
+    }
+    imagesize_t low = reduce_add (nlow4), binned = reduce_add (nbinned4);
+    for ( ; i < n;  ++i, p += stride) {
+        float c = *p;
+        if (c >= min && c <= max) {
+            ++hist[std::min (int ((c-min) * ratio), bins-1)];
+            ++binned;
+        } else if (c < min) {
+            ++low;
+        }
+    }
+    // Whatever is neither binned nor below min (including NaN) is "high".
+    nlow += low;
+    nhigh += imagesize_t(n) - binned - low;
+}
+
+
+
 static bool
 histogram_impl (const ImageBuf &A, int channel,
                 std::vector<imagesize_t> &histogram, int bins,
                 float min, float max, imagesize_t *submin,
-                imagesize_t *supermax, ROI roi)
+                imagesize_t *supermax, ROI roi, int nthreads)
 {
-    // Double check A's type.
-    if (A.spec().format != BaseTypeFromC<Atype>::value) {
-        A.error ("Unsupported pixel data format '%s'", A.spec().format);
-        return false;
-    }
-
-    // Initialize.
-    ImageBuf::ConstIterator<Atype, float> a (A, roi);
     float ratio = bins / (max-min);
-    int bins_minus_1 = bins-1;
-    bool submin_ok = submin != NULL;
-    bool supermax_ok = supermax != NULL;
-    if (submin_ok)
-        *submin = 0;
-    if (supermax_ok)
-        *supermax = 0;
-    histogram.assign(bins, 0);
-
-    // Compute histogram.
-    for ( ; ! a.done(); a++) {
-        float c = a[channel];
-        if (c >= min && c < max) {
-            // Map range min->max to 0->(bins-1).
-            histogram[ (int) ((c-min) * ratio) ]++;
-        } else if (c == max) {
-            histogram[bins_minus_1]++;
-        } else {
-            if (submin_ok && c < min)
-                (*submin)++;
-            else if (supermax_ok)
-                (*supermax)++;
+    histogram.assign (bins, 0);
+    imagesize_t nlow = 0, nhigh = 0;
+    spin_mutex mutex;
+    const bool direct = A.localpixels() && A.spec().format == TypeDesc::FLOAT;
+
+    ImageBufAlgo::parallel_image ([&](ROI roi){
+        std::vector<imagesize_t> hist (bins, 0);
+        imagesize_t low = 0, high = 0;
+        std::vector<float> row;
+        int width = roi.width();
+        for (int z = roi.zbegin;  z < roi.zend;  ++z) {
+            for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+                const float *p;
+                stride_t stride;
+                if (direct) {
+                    p = (const float *)A.pixeladdr (roi.xbegin, y, z) + channel;
+                    stride = A.spec().nchannels;
+                } else {
+                    // Any other pixel type or an ImageCache-backed image:
+                    // fetch the one channel of this scanline as float.
+                    row.resize (width);
+                    A.get_pixels (ROI (roi.xbegin, roi.xend, y, y+1, z, z+1,
+                                       channel, channel+1),
+                                  TypeDesc::FLOAT, &row[0]);
+                    p = &row[0];
+                    stride = 1;
+                }
+                histogram_span (p, stride, width, &hist[0], bins, min, max,
+                                ratio, low, high);
+            }
         }
-    }
+        spin_lock lock (mutex);
+        for (int b = 0;  b < bins;  ++b)
+            histogram[b] += hist[b];
+        nlow += low;
+        nhigh += high;
+    }, roi, nthreads);
+
+    if (submin)
+        *submin = nlow;
+    if (supermax)
+        *supermax = submin ? nhigh : nhigh + nlow;
     return true;
 }
 
@@ -950,13 +1279,8 @@ bool
 ImageBufAlgo::histogram (const ImageBuf &A, int channel,
                          std::vector<imagesize_t> &histogram, int bins,
                          float min, float max, imagesize_t *submin,
-                         imagesize_t *supermax, ROI roi)
+                         imagesize_t *supermax, ROI roi, int nthreads)
 {
-    if (A.spec().format != TypeDesc::TypeFloat) {
-        A.error ("Unsupported pixel data format '%s'", A.spec().format);
-        return false;
-    }
-
     if (A.nchannels() == 0) {
         A.error ("Input image must have at least 1 channel");
         return false;
@@ -982,8 +1306,8 @@ ImageBufAlgo::histogram (const ImageBuf &A, int channel,
     if (! roi.defined())
         roi = get_roi (A.spec());
 
-    histogram_impl<float> (A, channel, histogram, bins, min, max,
-                                  submin, supermax, roi);
+    histogram_impl (A, channel, histogram, bins, min, max,
+                    submin, supermax, roi, nthreads);
 
     return ! A.has_error();
 }
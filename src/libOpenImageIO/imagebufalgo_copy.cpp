@@ -36,31 +36,144 @@
 #include <OpenEXR/half.h>
 
 #include <cmath>
+#include <cstring>
 #include <iostream>
+#include <type_traits>
 
 #include "OpenImageIO/imagebuf.h"
 #include "OpenImageIO/imagebufalgo.h"
 #include "OpenImageIO/imagebufalgo_util.h"
 #include "OpenImageIO/deepdata.h"
 #include "OpenImageIO/thread.h"
+#include "imageio_pvt.h"
 
 
 
 OIIO_NAMESPACE_BEGIN
 
 
+// Where copy_native finds each pixel of dst: pixel (x,y,z), channel c
+// of dst comes from pixel (xsign*x+xoffset, ysign*y+yoffset, z+zoffset),
+// channel c+choffset of src -- or, if transposed, from pixel
+// (xsign*y+xoffset, ysign*x+yoffset, z+zoffset).
+struct NativeMap {
+    int xsign, xoffset, ysign, yoffset, zoffset, choffset;
+    bool transposed;
+    NativeMap (int xsign=1, int xoffset=0, int ysign=1, int yoffset=0,
+               int zoffset=0, int choffset=0, bool transposed=false)
+        : xsign(xsign), xoffset(xoffset), ysign(ysign), yoffset(yoffset),
+          zoffset(zoffset), choffset(choffset), transposed(transposed) {}
+};
+
+
+
+// The range [sbegin,send) covered by sign*i+offset for i in [begin,end).
+inline void
+map_range (int begin, int end, int sign, int offset, int &sbegin, int &send)
+{
+    sbegin = std::min (sign*begin, sign*(end-1)) + offset;
+    send = std::max (sign*begin, sign*(end-1)) + offset + 1;
+}
+
+
+
+// Copy the roi of dst from src (as mapped by m) by moving raw pixel
+// bytes, when both hold the same pixel type in one block of local memory
+// that covers the region.  This skips the per-channel conversions of the
+// iterator loops: whole rows that line up are a single memcpy, and for 8
+// and 16 bit images in particular it is many times faster.  Transposed
+// maps walk dst in small square blocks, so that the column of src read
+// for each row of a block is still in cache for the next one.  Return
+// false, having done nothing, if the images don't allow it.
+static bool
+copy_native (ImageBuf &dst, const ImageBuf &src, ROI roi,
+             const NativeMap &m, int nthreads)
+{
+    if (dst.deep() || src.deep() || dst.spec().format != src.spec().format)
+        return false;
+    ROI sroi = roi;
+    map_range (m.transposed ? roi.ybegin : roi.xbegin,
+               m.transposed ? roi.yend : roi.xend,
+               m.xsign, m.xoffset, sroi.xbegin, sroi.xend);
+    map_range (m.transposed ? roi.xbegin : roi.ybegin,
+               m.transposed ? roi.xend : roi.yend,
+               m.ysign, m.yoffset, sroi.ybegin, sroi.yend);
+    sroi.zbegin += m.zoffset;   sroi.zend += m.zoffset;
+    sroi.chbegin += m.choffset; sroi.chend += m.choffset;
+    const ImageBuf &cdst (dst);
+    if (! cdst.localpixels() || ! src.localpixels() ||
+        ! dst.contains_roi (roi) || ! src.contains_roi (sroi))
+        return false;
+    char *dbase = (char *) dst.localpixels();   // may un-share dst's pixels
+    const char *sbase = (const char *) src.localpixels();
+    size_t dpixelbytes = dst.spec().pixel_bytes();
+    size_t spixelbytes = src.spec().pixel_bytes();
+    size_t chanbytes = dst.spec().format.size();
+    size_t dchanoffset = roi.chbegin * chanbytes;
+    size_t schanoffset = sroi.chbegin * chanbytes;
+    size_t nbytes = roi.nchannels() * chanbytes;
+    bool wholepixels = (nbytes == dpixelbytes && nbytes == spixelbytes);
+    // Bytes between successive src pixels as we step along a dst row
+    stride_t sstep = m.transposed
+                   ? m.ysign * stride_t(src.spec().width) * stride_t(spixelbytes)
+                   : m.xsign * stride_t(spixelbytes);
+    ImageBufAlgo::parallel_image ([&](ROI r){
+        // Copy the n pixels of dst starting at (x,y,z)
+        auto copyrow = [&](int x, int y, int z, int n) {
+            char *d = dbase + size_t(dst.pixelindex (x, y, z)) * dpixelbytes
+                    + dchanoffset;
+            const char *s = sbase + schanoffset + size_t(m.transposed
+                ? src.pixelindex (m.xsign*y+m.xoffset, m.ysign*x+m.yoffset, z+m.zoffset)
+                : src.pixelindex (m.xsign*x+m.xoffset, m.ysign*y+m.yoffset, z+m.zoffset))
+                * spixelbytes;
+            if (wholepixels && sstep == stride_t(spixelbytes))
+                memcpy (d, s, n * nbytes);
+            else
+                for ( ;  n--;  d += dpixelbytes, s += sstep)
+                    memcpy (d, s, nbytes);
+        };
+        const int blocksize = 32;
+        for (int z = r.zbegin;  z < r.zend;  ++z) {
+            if (! m.transposed) {
+                for (int y = r.ybegin;  y < r.yend;  ++y)
+                    copyrow (r.xbegin, y, z, r.width());
+                continue;
+            }
+            for (int yb = r.ybegin;  yb < r.yend;  yb += blocksize)
+                for (int xb = r.xbegin;  xb < r.xend;  xb += blocksize) {
+                    int ye = std::min (yb+blocksize, r.yend);
+                    int n = std::min (blocksize, r.xend-xb);
+                    for (int y = yb;  y < ye;  ++y)
+                        copyrow (xb, y, z, n);
+                }
+        }
+    }, roi, nthreads);
+    return true;
+}
+
+
+
 template<class D, class S>
 static bool
 paste_ (ImageBuf &dst, ROI dstroi,
         const ImageBuf &src, ROI srcroi, int nthreads)
 {
-    // N.B. Punt on parallelizing because of the subtle interplay
-    // between srcroi and dstroi, the parallel_image idiom doesn't
-    // handle that especially well. And it's not worth customizing for
-    // this function which is inexpensive and not commonly used, and so
-    // would benefit little from parallelizing. We can always revisit
-    // this later. But in the mean time, we maintain the 'nthreads'
-    // parameter for uniformity with the rest of IBA.
+    if (nthreads != 1 && dstroi.npixels() >= 1000) {
+        // Split the destination region, and paste into each piece the
+        // part of srcroi it lines up with.
+        ImageBufAlgo::parallel_image ([&](ROI d){
+            ROI s (d.xbegin - dstroi.xbegin + srcroi.xbegin,
+                   d.xend   - dstroi.xbegin + srcroi.xbegin,
+                   d.ybegin - dstroi.ybegin + srcroi.ybegin,
+                   d.yend   - dstroi.ybegin + srcroi.ybegin,
+                   d.zbegin - dstroi.zbegin + srcroi.zbegin,
+                   d.zend   - dstroi.zbegin + srcroi.zbegin,
+                   srcroi.chbegin, srcroi.chend);
+            paste_<D,S> (dst, d, src, s, 1);
+        }, dstroi, nthreads);
+        return true;
+    }
+
     int src_nchans = src.nchannels ();
     int dst_nchans = dst.nchannels ();
     ImageBuf::ConstIterator<S,D> s (src, srcroi);
@@ -96,6 +209,12 @@ ImageBufAlgo::paste (ImageBuf &dst, int xbegin, int ybegin,
         return false;
 
     // do the actual copying
+    NativeMap m (1, srcroi.xbegin - dstroi_save.xbegin,
+                 1, srcroi.ybegin - dstroi_save.ybegin,
+                 srcroi.zbegin - dstroi_save.zbegin,
+                 srcroi.chbegin - dstroi_save.chbegin);
+    if (copy_native (dst, src, dstroi_save, m, nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "paste", paste_, dst.spec().format, src.spec().format,
                           dst, dstroi_save, src, srcroi, nthreads);
@@ -182,6 +301,8 @@ ImageBufAlgo::copy (ImageBuf &dst, const ImageBuf &src, TypeDesc convert,
         ImageBuf::ConstIterator<float> s (src, roi);
         for (ImageBuf::Iterator<float> d (dst, roi);  !d.done();  ++d, ++s)
             d.set_deep_samples (s.deep_samples());
+    } else if (copy_native (dst, src, roi, NativeMap(), nthreads)) {
+        return true;
     }
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "copy", copy_, dst.spec().format, src.spec().format,
@@ -197,6 +318,10 @@ ImageBufAlgo::crop (ImageBuf &dst, const ImageBuf &src,
 {
     dst.clear ();
     roi.chend = std::min (roi.chend, src.nchannels());
+    // Cropping to a region entirely within src's in-memory pixels needs no
+    // copy at all: dst can be a copy-on-write view of them.
+    if (dst.make_view (src, roi))
+        return true;
     if (! IBAprep (roi, &dst, &src, IBAprep_SUPPORT_DEEP))
         return false;
 
@@ -207,6 +332,8 @@ ImageBufAlgo::crop (ImageBuf &dst, const ImageBuf &src,
         ImageBuf::ConstIterator<float> s (src, roi);
         for (ImageBuf::Iterator<float> d (dst, roi);  !d.done();  ++d, ++s)
             d.set_deep_samples (s.deep_samples());
+    } else if (copy_native (dst, src, roi, NativeMap(), nthreads)) {
+        return true;
     }
 
     bool ok;
@@ -279,6 +406,11 @@ ImageBufAlgo::flip(ImageBuf &dst, const ImageBuf &src, ROI roi, int nthreads)
     // the midline of the display window.
     if (! IBAprep (dst_roi, &dst, &src))
         return false;
+    // Row y of dst mirrors src row src_roi_full.yend-1 - (y - dst ybegin)
+    if (copy_native (dst, src, dst_roi,
+                     NativeMap (1, 0, -1, src_roi_full.yend - 1 + dst.roi_full().ybegin),
+                     nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "flip", flip_,
                           dst.spec().format, src.spec().format,
@@ -330,6 +462,11 @@ ImageBufAlgo::flop(ImageBuf &dst, const ImageBuf &src, ROI roi, int nthreads)
     // the midline of the display window.
     if (! IBAprep (dst_roi, &dst, &src))
         return false;
+    // Column x of dst mirrors src column src_roi_full.xend-1 - (x - dst xbegin)
+    if (copy_native (dst, src, dst_roi,
+                     NativeMap (-1, src_roi_full.xend - 1 + dst.roi_full().xbegin),
+                     nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "flop", flop_,
                           dst.spec().format, src.spec().format,
@@ -391,6 +528,11 @@ ImageBufAlgo::rotate90 (ImageBuf &dst, const ImageBuf &src,
     if (! dst_initialized)
         dst.set_roi_full (dst_roi_full);
 
+    // Pixel (x,y) of dst is src pixel (y, dst xend-1 - x)
+    if (copy_native (dst, src, dst_roi,
+                     NativeMap (1, 0, -1, dst.roi_full().xend - 1, 0, 0, true),
+                     nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "rotate90", rotate90_,
                           dst.spec().format, src.spec().format,
@@ -448,6 +590,11 @@ ImageBufAlgo::rotate180 (ImageBuf &dst, const ImageBuf &src,
     // the midline of the display window.
     if (! IBAprep (dst_roi, &dst, &src))
         return false;
+    if (copy_native (dst, src, dst_roi,
+                     NativeMap (-1, src_roi_full.xend - 1 + dst.roi_full().xbegin,
+                                -1, src_roi_full.yend - 1 + dst.roi_full().ybegin),
+                     nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "rotate180", rotate180_,
                           dst.spec().format, src.spec().format,
@@ -510,6 +657,11 @@ ImageBufAlgo::rotate270 (ImageBuf &dst, const ImageBuf &src,
     if (! dst_initialized)
         dst.set_roi_full (dst_roi_full);
 
+    // Pixel (x,y) of dst is src pixel (dst yend-1 - y, x)
+    if (copy_native (dst, src, dst_roi,
+                     NativeMap (-1, dst.roi_full().yend - 1, 1, 0, 0, 0, true),
+                     nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "rotate270", rotate270_,
                           dst.spec().format, src.spec().format,
@@ -612,6 +764,9 @@ ImageBufAlgo::transpose (ImageBuf &dst, const ImageBuf &src,
                           r.zbegin, r.zend, r.chbegin, r.chend);
         dst.set_roi_full (dst_roi_full);
     }
+    if (copy_native (dst, src, dst_roi, NativeMap (1, 0, 1, 0, 0, 0, true),
+                     nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "transpose", transpose_, dst.spec().format,
                           src.spec().format, dst, src, roi, nthreads);
@@ -656,6 +811,47 @@ circular_shift_ (ImageBuf &dst, const ImageBuf &src,
 
 
 
+// The wrap splits each axis of the shifted region into at most two
+// spans, each a plain offset copy, so a circular shift is at most 8
+// copy_native blocks.
+static bool
+circular_shift_native (ImageBuf &dst, const ImageBuf &src,
+                       int xshift, int yshift, int zshift,
+                       ROI roi, int nthreads)
+{
+    struct Span { int begin, end, offset; };
+    // dst [begin,end) from src [begin,end) shifted by shift, wrapping
+    auto spans = [](int begin, int end, int shift, Span *span) -> int {
+        int len = end - begin;
+        shift %= len;
+        if (shift < 0)
+            shift += len;
+        int n = 0;
+        if (shift)
+            span[n++] = Span { begin, begin+shift, len-shift };
+        span[n++] = Span { begin+shift, end, -shift };
+        return n;
+    };
+    if (roi.npixels() == 0)
+        return false;
+    Span xs[2], ys[2], zs[2];
+    int nx = spans (roi.xbegin, roi.xend, xshift, xs);
+    int ny = spans (roi.ybegin, roi.yend, yshift, ys);
+    int nz = spans (roi.zbegin, roi.zend, zshift, zs);
+    for (int k = 0;  k < nz;  ++k)
+        for (int j = 0;  j < ny;  ++j)
+            for (int i = 0;  i < nx;  ++i) {
+                ROI r (xs[i].begin, xs[i].end, ys[j].begin, ys[j].end,
+                       zs[k].begin, zs[k].end, roi.chbegin, roi.chend);
+                NativeMap m (1, xs[i].offset, 1, ys[j].offset, zs[k].offset);
+                if (! copy_native (dst, src, r, m, nthreads))
+                    return false;   // none of them will work
+            }
+    return true;
+}
+
+
+
 bool
 ImageBufAlgo::circular_shift (ImageBuf &dst, const ImageBuf &src,
                               int xshift, int yshift, int zshift,
@@ -663,6 +859,8 @@ ImageBufAlgo::circular_shift (ImageBuf &dst, const ImageBuf &src,
 {
     if (! IBAprep (roi, &dst, &src))
         return false;
+    if (circular_shift_native (dst, src, xshift, yshift, zshift, roi, nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "circular_shift", circular_shift_,
                           dst.spec().format, src.spec().format, dst, src,
@@ -672,6 +870,17 @@ ImageBufAlgo::circular_shift (ImageBuf &dst, const ImageBuf &src,
 
 
 
+// Does the pixel region (ignoring channels) of outer include all of inner?
+inline bool
+covers_pixels (const ROI &outer, const ROI &inner)
+{
+    return inner.xbegin >= outer.xbegin && inner.xend <= outer.xend &&
+           inner.ybegin >= outer.ybegin && inner.yend <= outer.yend &&
+           inner.zbegin >= outer.zbegin && inner.zend <= outer.zend;
+}
+
+
+
 template<typename DSTTYPE>
 static bool
 channels_ (ImageBuf &dst, const ImageBuf &src,
@@ -689,6 +898,33 @@ channels_ (ImageBuf &dst, const ImageBuf &src,
     }
 
     int nchannels = src.nchannels();
+
+    // Local buffers of the same type just get each scanline's pixels
+    // shuffled in place, unless a channel would be left with no value.
+    bool fillok = true;
+    for (int c = roi.chbegin;  c < roi.chend;  ++c)
+        fillok &= (channelorder[c] >= 0 && channelorder[c] < nchannels) ||
+                  channelvalues;
+    if (fillok && dst.localpixels() && src.localpixels() &&
+        src.spec().format == dst.spec().format &&
+        roi.chbegin == 0 && roi.chend == dst.nchannels() &&
+        covers_pixels (src.roi(), roi)) {
+        DSTTYPE *fill = NULL;
+        if (channelvalues) {
+            fill = ALLOCA (DSTTYPE, roi.chend);
+            for (int c = 0;  c < roi.chend;  ++c)
+                fill[c] = convert_type<float,DSTTYPE> (channelvalues[c]);
+        }
+        for (int z = roi.zbegin;  z < roi.zend;  ++z)
+            for (int y = roi.ybegin;  y < roi.yend;  ++y)
+                pvt::shuffle_channels (src.pixeladdr (roi.xbegin, y, z),
+                                       nchannels,
+                                       dst.pixeladdr (roi.xbegin, y, z),
+                                       dst.nchannels(), sizeof(DSTTYPE),
+                                       channelorder, fill, roi.width());
+        return true;
+    }
+
     ImageBuf::ConstIterator<DSTTYPE> s (src, roi);
     ImageBuf::Iterator<DSTTYPE> d (dst, roi);
     for (  ;  ! s.done();  ++s, ++d) {
@@ -743,6 +979,8 @@ ImageBufAlgo::channels (ImageBuf &dst, const ImageBuf &src,
             inorder &= (newchannelnames[c] == src.spec().channelnames[c]);
     }
     if (nchannels == src.spec().nchannels && inorder) {
+        if (&dst != &src && dst.make_view (src))
+            return true;
         return dst.copy (src);
     }
 
@@ -839,6 +1077,30 @@ channel_append_impl (ImageBuf &dst, const ImageBuf &A, const ImageBuf &B,
     if (nthreads == 1 || roi.npixels() < 1000) {
         int na = A.nchannels(), nb = B.nchannels();
         int n = std::min (dst.nchannels(), na+nb);
+        if (std::is_same<Rtype,ABtype>::value && n == dst.nchannels() &&
+            n == na+nb && dst.localpixels() && A.localpixels() &&
+            B.localpixels() && covers_pixels (dst.roi(), roi) &&
+            covers_pixels (A.roi(), roi) && covers_pixels (B.roi(), roi)) {
+            // Same-typed local buffers: shuffle each scanline of A and
+            // then of B into its channels of dst.
+            int *aorder = ALLOCA (int, n), *border = ALLOCA (int, n);
+            for (int c = 0;  c < n;  ++c) {
+                aorder[c] = c < na ? c : -1;
+                border[c] = c < na ? -1 : c - na;
+            }
+            for (int z = roi.zbegin;  z < roi.zend;  ++z) {
+                for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+                    void *r = dst.pixeladdr (roi.xbegin, y, z);
+                    pvt::shuffle_channels (A.pixeladdr (roi.xbegin, y, z), na,
+                                           r, n, sizeof(Rtype), aorder,
+                                           NULL, roi.width());
+                    pvt::shuffle_channels (B.pixeladdr (roi.xbegin, y, z), nb,
+                                           r, n, sizeof(Rtype), border,
+                                           NULL, roi.width());
+                }
+            }
+            return true;
+        }
         ImageBuf::Iterator<Rtype> r (dst, roi);
         ImageBuf::ConstIterator<ABtype> a (A, roi);
         ImageBuf::ConstIterator<ABtype> b (B, roi);
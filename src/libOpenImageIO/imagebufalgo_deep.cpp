@@ -241,51 +241,93 @@ ImageBufAlgo::deepen (ImageBuf &dst, const ImageBuf &src, float zvalue,
         return false;
     }
 
-    float *pixel = OIIO_ALLOCA (float, nc);
-
-    // First, figure out which pixels get a sample and which do not
-    for (int z = roi.zbegin; z < roi.zend; ++z)
-    for (int y = roi.ybegin; y < roi.yend; ++y)
-    for (int x = roi.xbegin; x < roi.xend; ++x) {
-        bool has_sample = false;
-        src.getpixel (x, y, z, pixel);
-        for (int c = 0; c < nc; ++c)
-            if (c != force_spec.z_channel && c != zback_channel
-                  && pixel[c] != 0.0f) {
-                has_sample = true;
-                break;
-            }
-        if (! has_sample && ! add_z_channel)
+    // First, figure out which pixels get a sample and which do not.
+    // Setting the sample counts of separate pixels before the deep data
+    // is allocated is safe to do in parallel.
+    int z_channel = force_spec.z_channel;
+    ImageBufAlgo::parallel_image ([&,nc](ROI r) {
+        float *pixel = OIIO_ALLOCA (float, nc);
+        for (int z = r.zbegin; z < r.zend; ++z)
+        for (int y = r.ybegin; y < r.yend; ++y)
+        for (int x = r.xbegin; x < r.xend; ++x) {
+            bool has_sample = false;
+            src.getpixel (x, y, z, pixel);
             for (int c = 0; c < nc; ++c)
-                if ((c == force_spec.z_channel || c == zback_channel)
-                    && (pixel[c] != 0.0f && pixel[c] < 1e30)) {
+                if (c != z_channel && c != zback_channel
+                      && pixel[c] != 0.0f) {
                     has_sample = true;
                     break;
                 }
-        if (has_sample)
-            dst.set_deep_samples (x, y, z, 1);
-    }
+            if (! has_sample && ! add_z_channel)
+                for (int c = 0; c < nc; ++c)
+                    if ((c == z_channel || c == zback_channel)
+                        && (pixel[c] != 0.0f && pixel[c] < 1e30)) {
+                        has_sample = true;
+                        break;
+                    }
+            if (has_sample)
+                dst.set_deep_samples (x, y, z, 1);
+        }
+    }, roi, nthreads);
 
     // Now actually set the values
-    for (int z = roi.zbegin; z < roi.zend; ++z)
-    for (int y = roi.ybegin; y < roi.yend; ++y)
-    for (int x = roi.xbegin; x < roi.xend; ++x) {
-        if (dst.deep_samples (x, y, z) == 0)
-            continue;
-        for (int c = 0; c < nc; ++c)
-            dst.set_deep_value (x, y, z, c, 0 /*sample*/,
-                                src.getchannel (x, y, z, c));
-        if (add_z_channel)
-            dst.set_deep_value (x, y, z, nc, 0, zvalue);
-    }
+    ImageBufAlgo::parallel_image ([&,nc](ROI r) {
+        float *pixel = OIIO_ALLOCA (float, nc);
+        for (int z = r.zbegin; z < r.zend; ++z)
+        for (int y = r.ybegin; y < r.yend; ++y)
+        for (int x = r.xbegin; x < r.xend; ++x) {
+            if (dst.deep_samples (x, y, z) == 0)
+                continue;
+            src.getpixel (x, y, z, pixel);
+            for (int c = 0; c < nc; ++c)
+                dst.set_deep_value (x, y, z, c, 0 /*sample*/, pixel[c]);
+            if (add_z_channel)
+                dst.set_deep_value (x, y, z, nc, 0, zvalue);
+        }
+    }, roi, nthreads);
 
-    bool ok = true;
-    // FIXME -- the above doesn't split into threads. Someday, it should
-    // be refactored like this:
-    // OIIO_DISPATCH_COMMON_TYPES2 (ok, "deepen", deepen_,
-    //                              dst.spec().format, srcspec.format,
-    //                              dst, src, add_z_channel, z, roi, nthreads);
-    return ok;
+    return true;
+}
+
+
+
+// The number of samples DeepData::merge_deep_pixels will need when
+// merging pixel Bpixel of B into a copy of pixel Apixel of A, before it
+// merges overlaps: the two pixels' samples get split against each other,
+// which cuts every sample at each distinct depth, among all the samples'
+// z and zback values, that lies strictly inside it.  The bounds vector
+// is scratch space.
+static int
+merged_capacity (const DeepData &A, int Apixel, const DeepData &B, int Bpixel,
+                 int zchan, int zbackchan, std::vector<float> &bounds)
+{
+    int nA = A.samples (Apixel), nB = B.samples (Bpixel);
+    if (zchan < 0 || zbackchan < 0 || nA == 0 || nB == 0)
+        return nA + nB;   // no splitting will happen
+    bounds.clear ();
+    for (int s = 0; s < nA; ++s) {
+        bounds.push_back (A.deep_value (Apixel, zchan, s));
+        bounds.push_back (A.deep_value (Apixel, zbackchan, s));
+    }
+    for (int s = 0; s < nB; ++s) {
+        bounds.push_back (B.deep_value (Bpixel, zchan, s));
+        bounds.push_back (B.deep_value (Bpixel, zbackchan, s));
+    }
+    std::sort (bounds.begin(), bounds.end());
+    bounds.erase (std::unique (bounds.begin(), bounds.end()), bounds.end());
+    int total = 0;
+    for (int s = 0; s < nA + nB; ++s) {
+        const DeepData &dd (s < nA ? A : B);
+        int pixel = s < nA ? Apixel : Bpixel;
+        int samp = s < nA ? s : s - nA;
+        float zf = dd.deep_value (pixel, zchan, samp);
+        float zb = dd.deep_value (pixel, zbackchan, samp);
+        std::vector<float>::const_iterator lo, hi;
+        lo = std::upper_bound (bounds.begin(), bounds.end(), zf);
+        hi = std::lower_bound (bounds.begin(), bounds.end(), zb);
+        total += 1 + std::max (int(hi - lo), 0);
+    }
+    return total;
 }
 
 
@@ -307,34 +349,48 @@ ImageBufAlgo::deep_merge (ImageBuf &dst, const ImageBuf &A,
         return false;
     }
 
-    // First, set the capacity of the dst image to reserve enough space for
-    // the segments of both source images. It may be that more insertions
-    // are needed, due to overlaps, but those will be compartively fewer
-    // than doing reallocations for every single sample.
+    // First, in parallel, work out how many samples each merged pixel
+    // will need, then set the capacities of dst (serially -- it's cheap,
+    // and set_capacity locks) so that it's allocated just once, by the
+    // copy of A, and merging separate pixels in parallel never needs to
+    // grow them.
     DeepData &dstdd (*dst.deepdata());
     const DeepData &Add (*A.deepdata());
     const DeepData &Bdd (*B.deepdata());
+    int zchan = dstdd.Z_channel(), zbackchan = dstdd.Zback_channel();
+    std::vector<int> capacity (roi.npixels());
+    ImageBufAlgo::parallel_image ([&](ROI r) {
+        std::vector<float> bounds;
+        for (int z = r.zbegin; z < r.zend; ++z)
+        for (int y = r.ybegin; y < r.yend; ++y)
+        for (int x = r.xbegin; x < r.xend; ++x) {
+            imagesize_t i = (imagesize_t(z - roi.zbegin) * roi.height()
+                             + (y - roi.ybegin)) * roi.width() + (x - roi.xbegin);
+            capacity[i] = merged_capacity (Add, A.pixelindex (x, y, z, true),
+                                           Bdd, B.pixelindex (x, y, z, true),
+                                           zchan, zbackchan, bounds);
+        }
+    }, roi, nthreads);
+    imagesize_t i = 0;
     for (int z = roi.zbegin; z < roi.zend; ++z)
     for (int y = roi.ybegin; y < roi.yend; ++y)
-    for (int x = roi.xbegin; x < roi.xend; ++x) {
-        int dstpixel = dst.pixelindex (x, y, z, true);
-        int Apixel = A.pixelindex (x, y, z, true);
-        int Bpixel = B.pixelindex (x, y, z, true);
-        dstdd.set_capacity (dstpixel, Add.capacity(Apixel) + Bdd.capacity(Bpixel));
-    }
+    for (int x = roi.xbegin; x < roi.xend; ++x, ++i)
+        dstdd.set_capacity (dst.pixelindex (x, y, z, true), capacity[i]);
 
     bool ok = ImageBufAlgo::copy (dst, A, TypeDesc::UNKNOWN, roi, nthreads);
 
-    for (int z = roi.zbegin; z < roi.zend; ++z)
-    for (int y = roi.ybegin; y < roi.yend; ++y)
-    for (int x = roi.xbegin; x < roi.xend; ++x) {
-        int dstpixel = dst.pixelindex (x, y, z, true);
-        int Bpixel = B.pixelindex (x, y, z, true);
-        DASSERT (dstpixel >= 0);
-        dstdd.merge_deep_pixels (dstpixel, Bdd, Bpixel);
-        if (occlusion_cull)
-            dstdd.occlusion_cull (dstpixel);
-    }
+    ImageBufAlgo::parallel_image ([&](ROI r) {
+        for (int z = r.zbegin; z < r.zend; ++z)
+        for (int y = r.ybegin; y < r.yend; ++y)
+        for (int x = r.xbegin; x < r.xend; ++x) {
+            int dstpixel = dst.pixelindex (x, y, z, true);
+            int Bpixel = B.pixelindex (x, y, z, true);
+            DASSERT (dstpixel >= 0);
+            dstdd.merge_deep_pixels (dstpixel, Bdd, Bpixel);
+            if (occlusion_cull)
+                dstdd.occlusion_cull (dstpixel);
+        }
+    }, roi, nthreads);
     return ok;
 }
 
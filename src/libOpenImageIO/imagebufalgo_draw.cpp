@@ -31,6 +31,8 @@
 #include <OpenEXR/half.h>
 
 #include <cmath>
+#include <memory>
+#include <unordered_map>
 
 #include "OpenImageIO/imagebuf.h"
 #include "OpenImageIO/imagebufalgo.h"
@@ -41,6 +43,7 @@
 #include "OpenImageIO/thread.h"
 #include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/hash.h"
+#include "OpenImageIO/simd.h"
 
 #ifdef USE_FREETYPE
 #include <ft2build.h>
@@ -496,25 +499,87 @@ hashrand (int x, int y, int z, int c, int seed)
 }
 
 
-// Return a hash-based normal-distributed pseudorandom value.
-// We use the Marsaglia polar method, and hashrand to
+// bjhash::bjfinal of four sets of values at once.
+OIIO_FORCEINLINE simd::int4
+bjfinal4 (simd::int4 a, simd::int4 b, simd::int4 c)
+{
+    using simd::rotl32;
+    c ^= b; c -= rotl32(b,14);
+    a ^= c; a -= rotl32(c,11);
+    b ^= a; b -= rotl32(a,25);
+    c ^= b; c -= rotl32(b,16);
+    a ^= c; a -= rotl32(c,4);
+    b ^= a; b -= rotl32(a,14);
+    c ^= b; c -= rotl32(b,24);
+    return c;
+}
+
+
+// Set r[i] = hashrand (x0+i, y, z, c, seed) for i in [0,n), computing
+// four at a time.  Since hashrand is a pure function of its arguments,
+// the values (and so the noise) don't depend on how the image is split
+// among threads.
+static void
+hashrand_span (float *r, int x0, int n, int y, int z, int c, int seed)
+{
+    using namespace simd;
+    const int magic = 0xfffff;
+    const int4 yu (y), zu (z), cu (c), seedu (seed), mask (magic);
+    const float4 scale (1.0f/(magic+1));
+    int i = 0;
+    for ( ;  i <= n-4;  i += 4) {
+        int4 h = bjfinal4 (bjfinal4 (int4::Iota(x0+i), yu, zu), cu, seedu);
+        (float4 (h & mask) * scale).store (r+i);
+    }
+    for ( ;  i < n;  ++i)
+        r[i] = hashrand (x0+i, y, z, c, seed);
+}
+
+
+// The Marsaglia polar method, given the first pair of uniform values
+// to try, hashrand(x,y,z,c,seed) and hashrand(x,y,z,c,seed+139).
 OIIO_FORCEINLINE float
-hashnormal (int x, int y, int z, int c, int seed)
+hashnormal (float ux, float uy, int x, int y, int z, int c, int seed)
 {
     float xr, yr, r2;
-    int s = seed-1;
-    do {
+    int s = seed;
+    xr = 2.0 * ux - 1.0;
+    yr = 2.0 * uy - 1.0;
+    r2 = xr*xr + yr*yr;
+    while (r2 > 1.0 || r2 == 0.0) {
         s += 1;
         xr = 2.0 * hashrand(x,y,z,c,s) - 1.0;
         yr = 2.0 * hashrand(x,y,z,c,s+139) - 1.0;
         r2 = xr*xr + yr*yr;
-    } while (r2 > 1.0 || r2 == 0.0);
+    }
     float M = sqrt(-2.0 * log(r2) / r2);
     return xr * M;
 }
 
 
 
+// Fill rnd (in channel-major order, roi.width() values per channel) with
+// hashrand of each pixel in one scanline of roi, and of the seed+139
+// pairs as well if pairs is true (for hashnormal), for just the first
+// channel if mono.
+static void
+hashrand_scanline (std::vector<float> &rnd, ROI roi, int y, int z,
+                   bool mono, int seed, bool pairs)
+{
+    int w = roi.width();
+    int nc = mono ? 1 : roi.nchannels();
+    rnd.resize (size_t(w) * nc * (pairs ? 2 : 1));
+    for (int c = 0;  c < nc;  ++c) {
+        hashrand_span (&rnd[size_t(c)*w], roi.xbegin, w, y, z,
+                       roi.chbegin+c, seed);
+        if (pairs)
+            hashrand_span (&rnd[size_t(nc+c)*w], roi.xbegin, w, y, z,
+                           roi.chbegin+c, seed+139);
+    }
+}
+
+
+
 template<typename T>
 static bool
 noise_uniform_ (ImageBuf &dst, float min, float max, bool mono,
@@ -530,14 +595,23 @@ noise_uniform_ (ImageBuf &dst, float min, float max, bool mono,
         return true;
     }
 
-    // Serial case
-    for (ImageBuf::Iterator<T> p (dst, roi);  !p.done();  ++p) {
-        int x = p.x(), y = p.y(), z = p.z();
-        float n = 0.0;
-        for (int c = roi.chbegin;  c < roi.chend;  ++c) {
-            if (c == roi.chbegin || !mono)
-                n = lerp (min, max, hashrand (x, y, z, c, seed));
-            p[c] = p[c] + n;
+    // Serial case: a scanline's worth of random values at a time
+    std::vector<float> rnd;
+    int w = roi.width();
+    for (int z = roi.zbegin;  z < roi.zend;  ++z) {
+        for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+            hashrand_scanline (rnd, roi, y, z, mono, seed, false);
+            ROI row (roi.xbegin, roi.xend, y, y+1, z, z+1,
+                     roi.chbegin, roi.chend);
+            for (ImageBuf::Iterator<T> p (dst, row);  !p.done();  ++p) {
+                const float *r = &rnd[p.x() - roi.xbegin];
+                float n = 0.0;
+                for (int c = roi.chbegin;  c < roi.chend;  ++c) {
+                    if (c == roi.chbegin || !mono)
+                        n = lerp (min, max, r[(c-roi.chbegin)*w]);
+                    p[c] = p[c] + n;
+                }
+            }
         }
     }
     return true;
@@ -560,14 +634,28 @@ noise_gaussian_ (ImageBuf &dst, float mean, float stddev, bool mono,
         return true;
     }
 
-    // Serial case
-    for (ImageBuf::Iterator<T> p (dst, roi);  !p.done();  ++p) {
-        int x = p.x(), y = p.y(), z = p.z();
-        float n = 0.0;
-        for (int c = roi.chbegin;  c < roi.chend;  ++c) {
-            if (c == roi.chbegin || !mono)
-                n = mean + stddev * hashnormal (x, y, z, c, seed);
-            p[c] = p[c] + n;
+    // Serial case: a scanline's worth of random values at a time
+    std::vector<float> rnd;
+    int w = roi.width();
+    int nc = mono ? 1 : roi.nchannels();
+    for (int z = roi.zbegin;  z < roi.zend;  ++z) {
+        for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+            hashrand_scanline (rnd, roi, y, z, mono, seed, true);
+            ROI row (roi.xbegin, roi.xend, y, y+1, z, z+1,
+                     roi.chbegin, roi.chend);
+            for (ImageBuf::Iterator<T> p (dst, row);  !p.done();  ++p) {
+                int x = p.x();
+                const float *r = &rnd[x - roi.xbegin];
+                float n = 0.0;
+                for (int c = roi.chbegin;  c < roi.chend;  ++c) {
+                    if (c == roi.chbegin || !mono) {
+                        int i = c - roi.chbegin;
+                        n = mean + stddev * hashnormal (r[i*w], r[(nc+i)*w],
+                                                        x, y, z, c, seed);
+                    }
+                    p[c] = p[c] + n;
+                }
+            }
         }
     }
     return true;
@@ -590,15 +678,24 @@ noise_salt_ (ImageBuf &dst, float saltval, float saltportion, bool mono,
         return true;
     }
 
-    // Serial case
-    for (ImageBuf::Iterator<T> p (dst, roi);  !p.done();  ++p) {
-        int x = p.x(), y = p.y(), z = p.z();
-        float n = 0.0;
-        for (int c = roi.chbegin;  c < roi.chend;  ++c) {
-            if (c == roi.chbegin || !mono)
-                n = hashrand (x, y, z, c, seed);
-            if (n < saltportion)
-                p[c] = saltval;
+    // Serial case: a scanline's worth of random values at a time
+    std::vector<float> rnd;
+    int w = roi.width();
+    for (int z = roi.zbegin;  z < roi.zend;  ++z) {
+        for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+            hashrand_scanline (rnd, roi, y, z, mono, seed, false);
+            ROI row (roi.xbegin, roi.xend, y, y+1, z, z+1,
+                     roi.chbegin, roi.chend);
+            for (ImageBuf::Iterator<T> p (dst, row);  !p.done();  ++p) {
+                const float *r = &rnd[p.x() - roi.xbegin];
+                float n = 0.0;
+                for (int c = roi.chbegin;  c < roi.chend;  ++c) {
+                    if (c == roi.chbegin || !mono)
+                        n = r[(c-roi.chbegin)*w];
+                    if (n < saltportion)
+                        p[c] = saltval;
+                }
+            }
         }
     }
     return true;
@@ -641,38 +738,62 @@ static bool ft_broken = false;
 static const char * default_font_name[] = {
         "DroidSans", "cour", "Courier New", "FreeMono", NULL
      };
-} // anon namespace
-#endif
 
+// Everything below is process-wide and guarded by ft_mutex. Resolved
+// font paths and opened faces are kept for the life of the process;
+// rendered glyphs are kept until there are too many of them, so that
+// repeatedly burning the same slate or frame number text into many
+// images only pays for FreeType once per distinct glyph.
+static std::unordered_map<std::string,ustring> font_paths;
 
-bool
-ImageBufAlgo::render_text (ImageBuf &R, int x, int y, string_view text,
-                           int fontsize, string_view font_,
-                           const float *textcolor)
-{
-    if (R.spec().depth > 1) {
-        R.error ("ImageBufAlgo::render_text does not support volume images");
-        return false;
-    }
+struct FontFace {
+    FT_Face face;
+    int size;        // pixel size currently set on the face
+};
+static std::unordered_map<ustring,FontFace,ustringHash> font_faces;
 
-#ifdef USE_FREETYPE
-    // If we know FT is broken, don't bother trying again
-    if (ft_broken)
-        return false;
+struct Glyph {
+    int left, top;            // offset of the bitmap from the pen position
+    int width, height;
+    int advance;              // in pixels
+    std::vector<float> coverage;   // width*height, 0-1
+};
 
-    // Thread safety
-    lock_guard ft_lock (ft_mutex);
-    int error = 0;
+struct GlyphKey {
+    ustring font;
+    int size;
+    uint32_t ch;
+    bool operator== (const GlyphKey &k) const {
+        return font == k.font && size == k.size && ch == k.ch;
+    }
+};
 
-    // If FT not yet initialized, do it now.
-    if (! ft_library) {
-        error = FT_Init_FreeType (&ft_library);
-        if (error) {
-            ft_broken = true;
-            R.error ("Could not initialize FreeType for font rendering");
-            return false;
-        }
+struct GlyphKeyHash {
+    size_t operator() (const GlyphKey &k) const {
+        return k.font.hash() ^ (size_t(k.size) * 0x9e3779b9u + k.ch);
     }
+};
+
+static std::unordered_map<GlyphKey,std::shared_ptr<const Glyph>,GlyphKeyHash> glyph_cache;
+static const size_t max_cached_glyphs = 1 << 16;
+
+// A glyph and where its pen position lands in the image.
+struct PlacedGlyph {
+    int x, y;
+    std::shared_ptr<const Glyph> glyph;
+};
+
+
+
+// Find the file for the named font (or a default font, if the name is
+// empty), searching the usual font directories. Return the empty string
+// and set an error in R if it can't be found. Must hold ft_mutex.
+static ustring
+resolve_font (ImageBuf &R, string_view font_)
+{
+    auto found = font_paths.find (font_);
+    if (found != font_paths.end())
+        return found->second;
 
     // A set of likely directories for fonts to live, across several systems.
     std::vector<std::string> search_dirs;
@@ -715,7 +836,7 @@ ImageBufAlgo::render_text (ImageBuf &R, int x, int y, string_view text,
         }
         if (font.empty()) {
             R.error ("Could not set default font face");
-            return false;
+            return ustring();
         }
     } else if (Filesystem::is_regular (font)) {
         // directly specified a filename -- use it
@@ -728,7 +849,7 @@ ImageBufAlgo::render_text (ImageBuf &R, int x, int y, string_view text,
                                              search_dirs, true, true);
         if (f.empty()) {
             R.error ("Could not set font face to \"%s\"", font);
-            return false;
+            return ustring();
         }
         font = f;
     }
@@ -736,28 +857,141 @@ ImageBufAlgo::render_text (ImageBuf &R, int x, int y, string_view text,
     ASSERT (! font.empty());
     if (! Filesystem::is_regular (font)) {
         R.error ("Could not find font \"%s\"", font);
-        return false;
+        return ustring();
     }
+    ustring path (font);
+    font_paths[font_] = path;
+    return path;
+}
 
-    FT_Face face;      // handle to face object
-    error = FT_New_Face (ft_library, font.c_str(), 0 /* face index */, &face);
-    if (error) {
-        R.error ("Could not set font face to \"%s\"", font);
-        return false;  // couldn't open the face
+
+
+// Return the cached rendering of character ch in the given font file at
+// the given size, rasterizing it first if necessary. Return NULL if
+// the face can't be opened or sized (setting an error in R and setting
+// fatal) or the character can't be loaded. Must hold ft_mutex.
+static std::shared_ptr<const Glyph>
+get_glyph (ImageBuf &R, ustring font, int fontsize, uint32_t ch, bool &fatal)
+{
+    GlyphKey key = { font, fontsize, ch };
+    auto found = glyph_cache.find (key);
+    if (found != glyph_cache.end())
+        return found->second;
+
+    auto facefound = font_faces.find (font);
+    if (facefound == font_faces.end()) {
+        FontFace ff = { NULL, 0 };
+        int error = FT_New_Face (ft_library, font.c_str(), 0 /* face index */,
+                                 &ff.face);
+        if (error) {
+            R.error ("Could not set font face to \"%s\"", font);
+            fatal = true;
+            return std::shared_ptr<const Glyph>();  // couldn't open the face
+        }
+        facefound = font_faces.emplace (font, ff).first;
+    }
+    FontFace &ff (facefound->second);
+    if (ff.size != fontsize) {
+        int error = FT_Set_Pixel_Sizes (ff.face,     // handle to face object
+                                        0,           // pixel_width
+                                        fontsize);   // pixel_heigh
+        if (error) {
+            ff.size = 0;
+            R.error ("Could not set font size to %d", fontsize);
+            fatal = true;
+            return std::shared_ptr<const Glyph>();
+        }
+        ff.size = fontsize;
     }
 
-    error = FT_Set_Pixel_Sizes (face,        // handle to face object
-                                0,           // pixel_width
-                                fontsize);   // pixel_heigh
-    if (error) {
-        FT_Done_Face (face);
-        R.error ("Could not set font size to %d", fontsize);
-        return false;  // couldn't set the character size
+    if (FT_Load_Char (ff.face, ch, FT_LOAD_RENDER))
+        return std::shared_ptr<const Glyph>();  // ignore errors
+    FT_GlyphSlot slot = ff.face->glyph;  // a small shortcut
+    std::shared_ptr<Glyph> glyph (new Glyph);
+    glyph->left = slot->bitmap_left;
+    glyph->top = slot->bitmap_top;
+    glyph->width = static_cast<int>(slot->bitmap.width);
+    glyph->height = static_cast<int>(slot->bitmap.rows);
+    glyph->advance = int (slot->advance.x >> 6);
+    glyph->coverage.resize (size_t(glyph->width) * glyph->height);
+    for (int j = 0;  j < glyph->height;  ++j) {
+        const unsigned char *row = slot->bitmap.buffer + slot->bitmap.pitch*j;
+        float *cov = &glyph->coverage[size_t(j) * glyph->width];
+        for (int i = 0;  i < glyph->width;  ++i)
+            cov[i] = row[i] * (1.0f/255.0f);
     }
 
-    FT_GlyphSlot slot = face->glyph;  // a small shortcut
+    // Placed glyphs hold their own references, so it's safe to drop the
+    // whole cache at any time.
+    if (glyph_cache.size() >= max_cached_glyphs)
+        glyph_cache.clear ();
+    glyph_cache[key] = glyph;
+    return glyph;
+}
+
+
+
+// Composite the coverage masks of the placed glyphs over R in the text
+// color, clipped to R's pixel data window.
+template<typename T>
+static bool
+render_glyphs_ (ImageBuf &R, const std::vector<PlacedGlyph> &glyphs,
+                const float *textcolor)
+{
+    int nchannels = R.nchannels();
+    // For float pixels with up to 4 channels, blend a whole pixel at a
+    // time in SIMD registers.
+    bool simdblend = (R.spec().format == TypeDesc::FLOAT && nchannels <= 4
+                      && R.localpixels());
+    simd::float4 color;
+    for (int c = 0;  c < 4;  ++c)
+        color[c] = c < nchannels ? textcolor[c] : 0.0f;
+    for (const PlacedGlyph &pg : glyphs) {
+        const Glyph &g (*pg.glyph);
+        int x0 = pg.x + g.left, y0 = pg.y - g.top;
+        ROI roi = roi_intersection (ROI (x0, x0 + g.width, y0, y0 + g.height,
+                                         0, 1, 0, nchannels),
+                                    R.roi());
+        if (roi.npixels() == 0)
+            continue;
+        for (ImageBuf::Iterator<T> p (R, roi);  !p.done();  ++p) {
+            float b = g.coverage[size_t(p.y()-y0) * g.width + (p.x()-x0)];
+            if (b == 0.0f)
+                continue;
+            if (simdblend) {
+                float *f = (float *) p.rawptr();
+                simd::float4 px;
+                px.load (f, nchannels);
+                px += b * (color - px);
+                px.store (f, nchannels);
+            } else {
+                for (int c = 0;  c < nchannels;  ++c)
+                    p[c] = b*textcolor[c] + (1.0f-b) * p[c];
+            }
+        }
+    }
+    return true;
+}
+} // anon namespace
+#endif
+
+
+bool
+ImageBufAlgo::render_text (ImageBuf &R, int x, int y, string_view text,
+                           int fontsize, string_view font_,
+                           const float *textcolor)
+{
+    if (R.spec().depth > 1) {
+        R.error ("ImageBufAlgo::render_text does not support volume images");
+        return false;
+    }
+
+#ifdef USE_FREETYPE
+    // If we know FT is broken, don't bother trying again
+    if (ft_broken)
+        return false;
+
     int nchannels = R.spec().nchannels;
-    float *pixelcolor = ALLOCA (float, nchannels);
     if (! textcolor) {
         float *localtextcolor = ALLOCA (float, nchannels);
         for (int c = 0;  c < nchannels;  ++c)
@@ -769,28 +1003,47 @@ ImageBufAlgo::render_text (ImageBuf &R, int x, int y, string_view text,
     utext.reserve(text.size()); //Possible overcommit, but most text will be ascii
     Strutil::utf8_to_unicode(text, utext);
 
-    for (size_t n = 0, e = utext.size();  n < e;  ++n) {
-        error = FT_Load_Char (face, utext[n], FT_LOAD_RENDER);
-        if (error)
-            continue;  // ignore errors
-        // now, draw to our target surface
-        for (int j = 0;  j < static_cast<int>(slot->bitmap.rows); ++j) {
-            int ry = y + j - slot->bitmap_top;
-            for (int i = 0;  i < static_cast<int>(slot->bitmap.width); ++i) {
-                int rx = x + i + slot->bitmap_left;
-                float b = slot->bitmap.buffer[slot->bitmap.pitch*j+i] / 255.0f;
-                R.getpixel (rx, ry, pixelcolor);
-                for (int c = 0;  c < nchannels;  ++c)
-                    pixelcolor[c] = b*textcolor[c] + (1.0f-b) * pixelcolor[c];
-                R.setpixel (rx, ry, pixelcolor);
+    // Lay out the whole string under the lock, fetching (or rendering)
+    // each glyph from the cache, then composite without holding it.
+    std::vector<PlacedGlyph> placed;
+    placed.reserve (utext.size());
+    {
+        lock_guard ft_lock (ft_mutex);   // Thread safety
+
+        // If FT not yet initialized, do it now.
+        if (! ft_library) {
+            int error = FT_Init_FreeType (&ft_library);
+            if (error) {
+                ft_broken = true;
+                R.error ("Could not initialize FreeType for font rendering");
+                return false;
             }
         }
-        // increment pen position
-        x += slot->advance.x >> 6;
+
+        ustring font = resolve_font (R, font_);
+        if (font.empty())
+            return false;
+
+        for (size_t n = 0, e = utext.size();  n < e;  ++n) {
+            bool fatal = false;
+            std::shared_ptr<const Glyph> glyph = get_glyph (R, font, fontsize,
+                                                            utext[n], fatal);
+            if (! glyph) {
+                if (fatal)
+                    return false;  // face or size problem
+                continue;          // ignore errors loading one character
+            }
+            PlacedGlyph pg = { x, y, glyph };
+            placed.push_back (pg);
+            // increment pen position
+            x += glyph->advance;
+        }
     }
 
-    FT_Done_Face (face);
-    return true;
+    bool ok;
+    OIIO_DISPATCH_TYPES (ok, "render_text", render_glyphs_, R.spec().format,
+                         R, placed, textcolor);
+    return ok;
 
 #else
     R.error ("OpenImageIO was not compiled with FreeType for font rendering");
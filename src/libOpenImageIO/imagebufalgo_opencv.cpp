@@ -34,6 +34,7 @@
 /// These are nonfunctional if OpenCV is not found at build time.
 
 #ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
 #include <opencv2/core/core_c.h>
 #include <opencv2/highgui/highgui_c.h>
 #include <opencv2/imgproc/imgproc_c.h>
@@ -43,6 +44,7 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <memory>
 
 #include "OpenImageIO/imagebuf.h"
 #include "OpenImageIO/imagebufalgo.h"
@@ -55,6 +57,20 @@
 OIIO_NAMESPACE_BEGIN
 
 
+namespace {
+
+// Swap channels 0 and 2 (BGR <-> RGB) of each pixel, in place.
+static void
+swap_red_blue (char *pixels, imagesize_t npixels,
+               size_t pixelsize, size_t chansize)
+{
+    for (imagesize_t i = 0;  i < npixels;  ++i, pixels += pixelsize)
+        std::swap_ranges (pixels, pixels+chansize, pixels+2*chansize);
+}
+
+}
+
+
 
 bool
 ImageBufAlgo::from_IplImage (ImageBuf &dst, const IplImage *ipl,
@@ -102,29 +118,30 @@ ImageBufAlgo::from_IplImage (ImageBuf &dst, const IplImage *ipl,
     // Account for the origin in the line step size, to end up with the
     // standard OIIO origin-at-upper-left:
     size_t linestep = ipl->origin ? -ipl->widthStep : ipl->widthStep;
-    // Block copy and convert
+    // Block copy and convert (via a temporary if dst keeps its pixels
+    // in local tiles rather than one block)
+    std::unique_ptr<char[]> tmp;
+    char *dstpixels = (char *) dst.localpixels();
+    if (! dstpixels) {
+        tmp.reset (new char [spec.image_bytes()]);
+        dstpixels = tmp.get();
+    }
     convert_image (spec.nchannels, spec.width, spec.height, 1,
                    ipl->imageData, srcformat,
                    pixelsize, linestep, 0,
-                   dst.pixeladdr(0,0), dstformat,
+                   dstpixels, dstformat,
                    spec.pixel_bytes(), spec.scanline_bytes(), 0);
     // FIXME - honor dataOrder.  I'm not sure if it is ever used by
     // OpenCV.  Fix when it becomes a problem.
 
-    // OpenCV uses BGR ordering
+    // OpenCV uses BGR ordering; swap in place while the pixels are
+    // still in their raw layout.
     // FIXME: what do they do with alpha?
-    if (spec.nchannels >= 3) {
-        float pixel[4];
-        for (int y = 0;  y < spec.height;  ++y) {
-            for (int x = 0;  x < spec.width;  ++x) {
-                dst.getpixel (x, y, pixel, 4);
-                float tmp = pixel[0];  pixel[0] = pixel[2]; pixel[2] = tmp;
-                dst.setpixel (x, y, pixel, 4);
-            }
-        }
-    }
-    // FIXME -- the copy and channel swap should happen all as one loop,
-    // probably templated by type.
+    if (spec.nchannels >= 3)
+        swap_red_blue (dstpixels, spec.image_pixels(), spec.pixel_bytes(),
+                       dstformat.size());
+    if (tmp)
+        dst.set_pixels (dst.roi(), dstformat, tmp.get());
 
     return true;
 #else
@@ -214,6 +231,115 @@ ImageBufAlgo::to_IplImage (const ImageBuf &src)
 
 
 
+#ifdef USE_OPENCV
+// The TypeDesc of an OpenCV depth, or UNKNOWN if we can't hold it.
+static TypeDesc
+cv_depth_to_typedesc (int depth)
+{
+    switch (depth) {
+    case CV_8U  : return TypeDesc::UINT8;
+    case CV_8S  : return TypeDesc::INT8;
+    case CV_16U : return TypeDesc::UINT16;
+    case CV_16S : return TypeDesc::INT16;
+    case CV_32S : return TypeDesc::INT32;
+    case CV_32F : return TypeDesc::FLOAT;
+    case CV_64F : return TypeDesc::DOUBLE;
+    default     : return TypeDesc::UNKNOWN;
+    }
+}
+
+// The OpenCV depth for a TypeDesc, or -1 if OpenCV can't hold it.
+static int
+typedesc_to_cv_depth (TypeDesc t)
+{
+    switch (t.basetype) {
+    case TypeDesc::UINT8  : return CV_8U;
+    case TypeDesc::INT8   : return CV_8S;
+    case TypeDesc::UINT16 : return CV_16U;
+    case TypeDesc::INT16  : return CV_16S;
+    case TypeDesc::INT32  : return CV_32S;
+    case TypeDesc::FLOAT  : return CV_32F;
+    case TypeDesc::DOUBLE : return CV_64F;
+    default               : return -1;
+    }
+}
+#endif
+
+
+
+bool
+ImageBufAlgo::wrap_cv_mat (ImageBuf &dst, cv::Mat &mat)
+{
+#ifdef USE_OPENCV
+    TypeDesc format = cv_depth_to_typedesc (mat.depth());
+    if (format == TypeDesc::UNKNOWN) {
+        dst.error ("Unsupported cv::Mat depth %d", mat.depth());
+        return false;
+    }
+    if (mat.dims != 2 || mat.empty()) {
+        dst.error ("Can only wrap a non-empty 2D cv::Mat");
+        return false;
+    }
+    ImageSpec spec (mat.cols, mat.rows, mat.channels(), format);
+    if (mat.step[0] != spec.scanline_bytes()) {
+        // ImageBuf's wrapped buffers are contiguous, so padded rows
+        // (such as a Mat that is a region of a bigger one) can't be shared.
+        dst.error ("Can't wrap a cv::Mat whose rows are not contiguous");
+        return false;
+    }
+    // OpenCV keeps color in BGR(A) order.  Rather than reorder the
+    // pixels we are sharing, say what the channels are.
+    if (spec.nchannels == 3 || spec.nchannels == 4) {
+        spec.channelnames[0] = "B";
+        spec.channelnames[2] = "R";
+    }
+    ImageBuf wrapped (dst.name(), spec, mat.data);
+    dst.swap (wrapped);
+    return true;
+#else
+    dst.error ("wrap_cv_mat not supported -- no OpenCV support at compile time");
+    return false;
+#endif
+}
+
+
+
+bool
+ImageBufAlgo::to_cv_mat (cv::Mat &dst, ImageBuf &src)
+{
+#ifdef USE_OPENCV
+    if (! src.initialized() && ! src.read (src.subimage(), src.miplevel()))
+        return false;
+    const ImageSpec &spec (src.spec());
+    if (spec.depth > 1 || spec.nchannels > CV_CN_MAX)
+        return false;
+    int depth = typedesc_to_cv_depth (spec.format);
+    if (depth >= 0 && (src.storage() == ImageBuf::LOCALBUFFER ||
+                       src.storage() == ImageBuf::APPBUFFER)) {
+        // Point the Mat at the pixels in place, if they are one block
+        // (not local tiles).  The non-const localpixels() stops sharing
+        // them copy-on-write, since the Mat may write to them.
+        if (void *pixels = src.localpixels()) {
+            dst = cv::Mat (spec.height, spec.width,
+                           CV_MAKETYPE(depth, spec.nchannels),
+                           pixels, spec.scanline_bytes());
+            return true;
+        }
+    }
+    // Otherwise copy, converting types OpenCV doesn't have to float.
+    TypeDesc format = depth >= 0 ? spec.format : TypeDesc::TypeFloat;
+    if (depth < 0)
+        depth = CV_32F;
+    dst.create (spec.height, spec.width, CV_MAKETYPE(depth, spec.nchannels));
+    return src.get_pixels (src.roi(), format, dst.data,
+                           AutoStride, (stride_t) dst.step[0]);
+#else
+    return false;
+#endif
+}
+
+
+
 namespace {
 
 #ifdef USE_OPENCV
@@ -0,0 +1,370 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+/// \file
+/// Implementation of ImageBufAlgo::PixelPipeline, which fuses a chain of
+/// point-wise operations into a single pass over the pixels.
+
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "OpenImageIO/imagebuf.h"
+#include "OpenImageIO/imagebufalgo.h"
+#include "OpenImageIO/imagebufalgo_util.h"
+#include "imageio_pvt.h"
+
+
+
+OIIO_NAMESPACE_BEGIN
+
+
+struct ImageBufAlgo::PixelPipeline::Op {
+    enum Kind { Add, Mul, Mad, Pow, Abs, Clamp, ColorConvert };
+    Kind kind;
+    std::vector<float> a, b;    // Values: one for all chans, or per-channel
+    bool flag;                  // clampalpha01 or unpremult
+    std::string from, to, context_key, context_value;
+    ColorConfig *colorconfig;
+
+    Op (Kind kind) : kind(kind), flag(false), colorconfig(NULL) { }
+};
+
+
+
+namespace {
+
+// One op of the pipeline as it is run on a particular image: values
+// expanded to one per channel, color transform looked up.
+struct Stage {
+    ImageBufAlgo::PixelPipeline::Op::Kind kind;
+    std::vector<float> a, b;
+    bool flag;
+    const ColorProcessor *processor;
+};
+
+
+static void
+expand_values (std::vector<float> &out, const std::vector<float> &in,
+               int nchannels, float dflt)
+{
+    if (in.size() == 1)
+        out.assign (nchannels, in[0]);
+    else {
+        out.assign (nchannels, dflt);
+        std::copy (in.begin(), in.begin() + std::min (in.size(), out.size()),
+                   out.begin());
+    }
+}
+
+
+
+// Run all the stages on the pixels of roi, a few rows at a time so that
+// the float working buffer stays cache-sized.
+static void
+pipeline_impl (ImageBuf &dst, const ImageBuf &src,
+               const std::vector<Stage> &stages, ROI roi)
+{
+    const int nc = src.nchannels();
+    const int width = roi.width();
+    const int rows = std::max (1, std::min (16384 / std::max (width, 1),
+                                            roi.height()));
+    const int alpha = src.spec().alpha_channel;
+    std::vector<float> buf (size_t(width) * rows * nc);
+    std::vector<float> scratch;
+    for (int z = roi.zbegin;  z < roi.zend;  ++z) {
+        for (int y = roi.ybegin;  y < roi.yend;  y += rows) {
+            ROI r (roi.xbegin, roi.xend, y, std::min (y+rows, roi.yend),
+                   z, z+1, 0, nc);
+            int npixels = int (r.npixels());
+            src.get_pixels (r, TypeDesc::FLOAT, &buf[0]);
+            for (const Stage &st : stages) {
+                float *p = &buf[0];
+                switch (st.kind) {
+                case ImageBufAlgo::PixelPipeline::Op::Add :
+                    for (int i = 0;  i < npixels;  ++i, p += nc)
+                        for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                            p[c] = p[c] + st.a[c];
+                    break;
+                case ImageBufAlgo::PixelPipeline::Op::Mul :
+                    for (int i = 0;  i < npixels;  ++i, p += nc)
+                        for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                            p[c] = p[c] * st.a[c];
+                    break;
+                case ImageBufAlgo::PixelPipeline::Op::Mad :
+                    for (int i = 0;  i < npixels;  ++i, p += nc)
+                        for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                            p[c] = p[c] * st.a[c] + st.b[c];
+                    break;
+                case ImageBufAlgo::PixelPipeline::Op::Pow :
+                    for (int i = 0;  i < npixels;  ++i, p += nc)
+                        for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                            p[c] = pow (p[c], st.a[c]);
+                    break;
+                case ImageBufAlgo::PixelPipeline::Op::Abs :
+                    for (int i = 0;  i < npixels;  ++i, p += nc)
+                        for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                            p[c] = fabsf (p[c]);
+                    break;
+                case ImageBufAlgo::PixelPipeline::Op::Clamp :
+                    for (int i = 0;  i < npixels;  ++i, p += nc) {
+                        for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                            p[c] = OIIO::clamp (p[c], st.a[c], st.b[c]);
+                        if (st.flag && alpha >= roi.chbegin && alpha < roi.chend)
+                            p[alpha] = OIIO::clamp (p[alpha], 0.0f, 1.0f);
+                    }
+                    break;
+                case ImageBufAlgo::PixelPipeline::Op::ColorConvert :
+                    scratch.resize (4*size_t(npixels));
+                    pvt::colorprocessor_apply (st.processor, st.flag, p,
+                                               npixels, nc, roi.nchannels(),
+                                               &scratch[0]);
+                    break;
+                }
+            }
+            r.chbegin = roi.chbegin;
+            r.chend = roi.chend;
+            dst.set_pixels (r, TypeDesc::FLOAT, &buf[roi.chbegin],
+                            nc*sizeof(float), width*nc*sizeof(float));
+        }
+    }
+}
+
+}  // anon namespace
+
+
+
+ImageBufAlgo::PixelPipeline::PixelPipeline ()
+{
+}
+
+
+
+ImageBufAlgo::PixelPipeline::~PixelPipeline ()
+{
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::append (Op *op)
+{
+    m_ops.emplace_back (op);
+    return *this;
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::add (array_view<const float> b)
+{
+    Op *op = new Op (Op::Add);
+    op->a.assign (b.data(), b.data() + b.size());
+    return append (op);
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::sub (array_view<const float> b)
+{
+    Op *op = new Op (Op::Add);
+    for (size_t i = 0;  i < b.size();  ++i)
+        op->a.push_back (-b[i]);
+    return append (op);
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::mul (array_view<const float> b)
+{
+    Op *op = new Op (Op::Mul);
+    op->a.assign (b.data(), b.data() + b.size());
+    return append (op);
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::div (array_view<const float> b)
+{
+    // Like div(), multiply by the reciprocal, with x/0 == 0.
+    Op *op = new Op (Op::Mul);
+    for (size_t i = 0;  i < b.size();  ++i)
+        op->a.push_back (b[i] == 0.0f ? 0.0f : 1.0f/b[i]);
+    return append (op);
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::pow (array_view<const float> b)
+{
+    Op *op = new Op (Op::Pow);
+    op->a.assign (b.data(), b.data() + b.size());
+    return append (op);
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::abs ()
+{
+    return append (new Op (Op::Abs));
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::invert ()
+{
+    // Same as invert(): 1-A == A*(-1)+1
+    Op *op = new Op (Op::Mad);
+    op->a.assign (1, -1.0f);
+    op->b.assign (1, 1.0f);
+    return append (op);
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::clamp (array_view<const float> min,
+                                    array_view<const float> max,
+                                    bool clampalpha01)
+{
+    Op *op = new Op (Op::Clamp);
+    op->a.assign (min.data(), min.data() + min.size());
+    op->b.assign (max.data(), max.data() + max.size());
+    op->flag = clampalpha01;
+    return append (op);
+}
+
+
+
+ImageBufAlgo::PixelPipeline&
+ImageBufAlgo::PixelPipeline::colorconvert (string_view from, string_view to,
+                                           bool unpremult,
+                                           string_view context_key,
+                                           string_view context_value,
+                                           ColorConfig *colorconfig)
+{
+    Op *op = new Op (Op::ColorConvert);
+    op->from = from;
+    op->to = to;
+    op->flag = unpremult;
+    op->context_key = context_key;
+    op->context_value = context_value;
+    op->colorconfig = colorconfig;
+    return append (op);
+}
+
+
+
+bool
+ImageBufAlgo::PixelPipeline::apply (ImageBuf &dst, const ImageBuf &src,
+                                    ROI roi, int nthreads) const
+{
+    if (! IBAprep (roi, &dst, &src, IBAprep_CLAMP_MUTUAL_NCHANNELS))
+        return false;
+
+    // Expand the per-channel values for this image and look up the color
+    // transforms, following the color space through the chain.
+    const int nc = src.nchannels();
+    const float big = std::numeric_limits<float>::max();
+    std::string colorspace = src.spec().get_string_attribute ("oiio:ColorSpace",
+                                                              "Linear");
+    bool colorspace_changed = false;
+    std::vector<Stage> stages;
+    std::string err;
+    for (const auto &op : m_ops) {
+        Stage st;
+        st.kind = op->kind;
+        st.flag = op->flag;
+        st.processor = NULL;
+        switch (op->kind) {
+        case Op::Add :
+            expand_values (st.a, op->a, nc, 0.0f);
+            break;
+        case Op::Mul :
+        case Op::Pow :
+            expand_values (st.a, op->a, nc, 1.0f);
+            break;
+        case Op::Mad :
+            expand_values (st.a, op->a, nc, 1.0f);
+            expand_values (st.b, op->b, nc, 0.0f);
+            break;
+        case Op::Clamp :
+            expand_values (st.a, op->a, nc, -big);
+            expand_values (st.b, op->b, nc, big);
+            break;
+        case Op::Abs :
+            break;
+        case Op::ColorConvert : {
+            std::string from = op->from;
+            if (from.empty() || from == "current")
+                from = colorspace;
+            if (from.empty() || op->to.empty()) {
+                err = "Unknown color space name";
+                break;
+            }
+            st.processor = pvt::colorprocessor_create (op->colorconfig,
+                                    from, op->to, op->context_key,
+                                    op->context_value, err);
+            colorspace = op->to;
+            colorspace_changed = true;
+            break;
+            }
+        }
+        if (err.size())
+            break;
+        if (st.processor && pvt::colorprocessor_isnoop (st.processor))
+            continue;
+        stages.push_back (st);
+    }
+
+    if (err.empty())
+        parallel_image (OIIO::bind (pipeline_impl, OIIO::ref(dst),
+                                    OIIO::cref(src), OIIO::cref(stages), _1),
+                        roi, nthreads);
+
+    if (err.size()) {
+        dst.error ("%s", err);
+        return false;
+    }
+    if (colorspace_changed)
+        dst.specmod().attribute ("oiio:ColorSpace", colorspace);
+    return true;
+}
+
+
+OIIO_NAMESPACE_END
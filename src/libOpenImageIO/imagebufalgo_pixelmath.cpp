@@ -50,6 +50,185 @@
 OIIO_NAMESPACE_BEGIN
 
 
+namespace {
+
+// Integer-domain fast paths.
+//
+// When all the images involved hold unsigned 8 or 16 bit pixels in one
+// block of local memory, with the same channel count, add, sub, mul,
+// premult and over work directly on the stored integers rather than
+// converting every channel to float and back.  The results are the ones
+// the float path rounds to: a+b and a-b saturate, and the products are
+// rounded quotients by the type's maximum (an odd number, so they never
+// land exactly on a half).  The row loops are simple enough for the
+// compiler to vectorize.
+
+// Can img's pixels covering roi be addressed directly as T values?
+template<class T>
+inline bool
+local_image_ok (const ImageBuf &img, int nchannels, ROI roi)
+{
+    return img.localpixels() && ! img.deep()
+        && img.spec().format == BaseTypeFromC<T>::value
+        && img.nchannels() == nchannels && img.contains_roi (roi);
+}
+
+
+// round (a*b / max) for T's max = 2^bits-1, exactly, without a divide.
+template<class T>
+inline T
+int_mul (uint32_t a, uint32_t b)
+{
+    const int bits = 8 * sizeof(T);
+    uint32_t t = a * b + (1u << (bits-1));
+    return T ((t + (t >> bits)) >> bits);
+}
+
+
+struct IntAdd {
+    template<class T> T operator() (T a, T b) const {
+        return T (std::min (uint32_t(a) + uint32_t(b),
+                            uint32_t(std::numeric_limits<T>::max())));
+    }
+};
+
+struct IntSub {
+    template<class T> T operator() (T a, T b) const {
+        return a > b ? T(a - b) : T(0);
+    }
+};
+
+struct IntMul {
+    template<class T> T operator() (T a, T b) const {
+        return int_mul<T> (a, b);
+    }
+};
+
+
+// Call rowop (r, a, b, rowroi) for each scanline of roi, in parallel if
+// nthreads allows, where r, a and b point to the first pixel of the row
+// in R, A and B (b is NULL if B is).  The images must pass local_image_ok.
+template<class T, class ROWOP>
+void
+local_rows (ImageBuf &R, const ImageBuf &A, const ImageBuf *B,
+          ROI roi, int nthreads, ROWOP rowop)
+{
+    // Find the base addresses up front (serially), since asking for R's
+    // writeable pixels may need to un-share them.
+    T *rbase = (T *) R.localpixels();
+    const T *abase = (const T *) A.localpixels();
+    const T *bbase = B ? (const T *) B->localpixels() : NULL;
+    const int nc = R.nchannels();
+    ImageBufAlgo::parallel_image ([&,rbase,abase,bbase](ROI rroi){
+        for (int z = rroi.zbegin;  z < rroi.zend;  ++z)
+            for (int y = rroi.ybegin;  y < rroi.yend;  ++y) {
+                int x = rroi.xbegin;
+                const T *b = NULL;
+                if (B)
+                    b = bbase + size_t(B->pixelindex (x, y, z)) * nc;
+                rowop (rbase + size_t(R.pixelindex (x, y, z)) * nc,
+                       abase + size_t(A.pixelindex (x, y, z)) * nc, b, rroi);
+            }
+    }, roi, nthreads);
+}
+
+
+// r = op(a,b) for the roi channels of each pixel in a row.
+template<class T, class OP>
+inline void
+int_elementwise (T *r, const T *a, const T *b, ROI roi, int nc, OP op)
+{
+    if (roi.chbegin == 0 && roi.chend == nc) {
+        for (int i = 0, n = roi.width() * nc;  i < n;  ++i)
+            r[i] = op (a[i], b[i]);
+    } else {
+        for (int x = 0, w = roi.width();  x < w;  ++x, r += nc, a += nc, b += nc)
+            for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                r[c] = op (a[c], b[c]);
+    }
+}
+
+
+template<class T, class OP>
+bool
+int_binary_op_ (ImageBuf &R, const ImageBuf &A, const ImageBuf &B,
+                ROI roi, int nthreads, OP op)
+{
+    int nc = R.nchannels();
+    if (! local_image_ok<T> (R, nc, roi) || ! local_image_ok<T> (A, nc, roi) ||
+        ! local_image_ok<T> (B, nc, roi))
+        return false;
+    local_rows<T> (R, A, &B, roi, nthreads,
+                 [=](T *r, const T *a, const T *b, ROI rroi) {
+                     int_elementwise (r, a, b, rroi, nc, op);
+                 });
+    return true;
+}
+
+
+// Do R = op(A,B) in the integer domain if the images allow it, returning
+// true if it was done, false if the caller should use the float path.
+template<class OP>
+bool
+int_binary_op (ImageBuf &R, const ImageBuf &A, const ImageBuf &B,
+               ROI roi, int nthreads, OP op)
+{
+    return int_binary_op_<uint8_t> (R, A, B, roi, nthreads, op)
+        || int_binary_op_<uint16_t> (R, A, B, roi, nthreads, op);
+}
+
+
+template<class T>
+bool
+int_premult_ (ImageBuf &R, const ImageBuf &A, ROI roi, int nthreads)
+{
+    int nc = R.nchannels();
+    if (! local_image_ok<T> (R, nc, roi) || ! local_image_ok<T> (A, nc, roi))
+        return false;
+    int alpha_channel = A.spec().alpha_channel;
+    int z_channel = A.spec().z_channel;
+    local_rows<T> (R, A, NULL, roi, nthreads,
+                 [=](T *r, const T *a, const T *, ROI rroi) {
+        for (int x = 0, w = rroi.width();  x < w;  ++x, r += nc, a += nc) {
+            T alpha = a[alpha_channel];
+            for (int c = rroi.chbegin;  c < rroi.chend;  ++c)
+                if (c != alpha_channel && c != z_channel)
+                    r[c] = int_mul<T> (a[c], alpha);
+                else
+                    r[c] = a[c];
+        }
+    });
+    return true;
+}
+
+
+template<class T>
+bool
+int_over_ (ImageBuf &R, const ImageBuf &A, const ImageBuf &B,
+           int alpha_channel, ROI roi, int nthreads)
+{
+    int nc = R.nchannels();
+    if (! local_image_ok<T> (R, nc, roi) || ! local_image_ok<T> (A, nc, roi) ||
+        ! local_image_ok<T> (B, nc, roi))
+        return false;
+    local_rows<T> (R, A, &B, roi, nthreads,
+                 [=](T *r, const T *a, const T *b, ROI rroi) {
+        const uint32_t maxval = std::numeric_limits<T>::max();
+        for (int x = 0, w = rroi.width();  x < w;
+             ++x, r += nc, a += nc, b += nc) {
+            uint32_t one_minus_alpha = maxval - a[alpha_channel];
+            for (int c = rroi.chbegin;  c < rroi.chend;  ++c)
+                r[c] = T (std::min (a[c] + uint32_t(int_mul<T> (b[c], one_minus_alpha)),
+                                    maxval));
+        }
+    });
+    return true;
+}
+
+} // end anon namespace
+
+
+
 template<class D, class S>
 static bool
 clamp_ (ImageBuf &dst, const ImageBuf &src,
@@ -198,6 +377,8 @@ ImageBufAlgo::add (ImageBuf &dst, const ImageBuf &A, const ImageBuf &B,
         return false;
     ROI origroi = roi;
     roi.chend = std::min (roi.chend, std::min (A.nchannels(), B.nchannels()));
+    if (int_binary_op (dst, A, B, roi, nthreads, IntAdd()))
+        return true;
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES3 (ok, "add", add_impl, dst.spec().format,
                                  A.spec().format, B.spec().format,
@@ -297,6 +478,8 @@ ImageBufAlgo::sub (ImageBuf &dst, const ImageBuf &A, const ImageBuf &B,
         return false;
     ROI origroi = roi;
     roi.chend = std::min (roi.chend, std::min (A.nchannels(), B.nchannels()));
+    if (int_binary_op (dst, A, B, roi, nthreads, IntSub()))
+        return true;
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES3 (ok, "sub", sub_impl, dst.spec().format,
                                  A.spec().format, B.spec().format,
@@ -524,6 +707,8 @@ ImageBufAlgo::mul (ImageBuf &dst, const ImageBuf &A, const ImageBuf &B,
 {
     if (! IBAprep (roi, &dst, &A, &B, NULL, IBAprep_CLAMP_MUTUAL_NCHANNELS))
         return false;
+    if (int_binary_op (dst, A, B, roi, nthreads, IntMul()))
+        return true;
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES3 (ok, "mul", mul_impl, dst.spec().format,
                                  A.spec().format, B.spec().format,
@@ -723,7 +908,7 @@ mad_impl (ImageBuf &R, const ImageBuf &A, const ImageBuf &B, const ImageBuf &C,
 
     if (   (is_same<Rtype,float>::value || is_same<Rtype,half>::value)
         && (is_same<ABCtype,float>::value || is_same<ABCtype,half>::value)
-        // && R.localpixels() // has to be, because it's writeable
+        && R.localpixels() // writeable, but may be in local tiles
         && A.localpixels() && B.localpixels() && C.localpixels()
         // && R.contains_roi(roi)  // has to be, because IBAPrep
         && A.contains_roi(roi) && B.contains_roi(roi) && C.contains_roi(roi)
@@ -904,6 +1089,26 @@ pow_impl (ImageBuf &R, const ImageBuf &A, const float *b,
     }
 
     ImageBuf::ConstIterator<Atype> a (A, roi);
+    if (sizeof(Rtype) == 1) {
+        // Results stored in 8 bits can't tell fast_safe_pow from the real
+        // thing, so do 4 channels at a time with it.  (Its error is about
+        // one 16 bit step, so half and uint16 results keep the exact pow.)
+        // It keeps x^1 and x^2 exact, but gives 0 for a negative x raised
+        // to a non-integer power, where pow gives NaN.
+        for (ImageBuf::Iterator<Rtype> r (R, roi);  !r.done();  ++r, ++a) {
+            for (int c = roi.chbegin;  c < roi.chend;  c += 4) {
+                int n = std::min (4, roi.chend - c);
+                simd::float4 av (0.0f), bv;
+                for (int i = 0;  i < n;  ++i)
+                    av[i] = a[c+i];
+                bv.load (b + c, n);
+                simd::float4 rv = fast_safe_pow (av, bv);
+                for (int i = 0;  i < n;  ++i)
+                    r[c+i] = rv[i];
+            }
+        }
+        return true;
+    }
     for (ImageBuf::Iterator<Rtype> r (R, roi);  !r.done();  ++r, ++a)
         for (int c = roi.chbegin;  c < roi.chend;  ++c)
             r[c] = pow (a[c], b[c]);
@@ -1016,7 +1221,7 @@ inline float rangecompress (float x)
     float absx = fabsf(x);
     if (absx <= x1)
         return x;
-    return copysignf (a + b * logf(fabsf(c*absx + 1.0f)), x);
+    return copysignf (a + b * fast_log(fabsf(c*absx + 1.0f)), x);
 }
 
 
@@ -1035,7 +1240,7 @@ inline float rangeexpand (float y)
     float absy = fabsf(y);
     if (absy <= x1)
         return y;
-    float xIntermediate = expf ((absy - a)/b);
+    float xIntermediate = fast_exp ((absy - a)/b);
     // Since the compression step includes an absolute value, there are
     // two possible results here. If x < x1 it is the incorrect result,
     // so pick the other value.
@@ -1047,6 +1252,37 @@ inline float rangeexpand (float y)
 
 
 
+// float4 versions of rangecompress/rangeexpand with the same coefficients,
+// for transforming up to four channels of a pixel at once.
+inline simd::float4 rangecompress (const simd::float4& x)
+{
+    using namespace simd;
+    const float4 x1 (0.18f), a (-0.54576885700225830078f);
+    const float4 b (0.18351669609546661377f), c (284.3577880859375f);
+    float4 absx = abs (x);
+    float4 r = a + b * fast_log (c*absx + float4::One());
+    // r is positive wherever it's used, so copysign is just OR-ing the sign
+    r = bitcast_to_float (bitcast_to_int(r) | (bitcast_to_int(x) & bitcast_to_int(float4(-0.0f))));
+    return select (absx <= x1, x, r);
+}
+
+
+
+inline simd::float4 rangeexpand (const simd::float4& y)
+{
+    using namespace simd;
+    const float4 x1 (0.18f), a (-0.54576885700225830078f);
+    const float4 b (0.18351669609546661377f), c (284.3577880859375f);
+    float4 absy = abs (y);
+    float4 xIntermediate = fast_exp ((absy - a)/b);
+    float4 x = (xIntermediate - float4::One()) / c;
+    x = select (x < x1, (-xIntermediate - float4::One()) / c, x);
+    x = bitcast_to_float (bitcast_to_int(abs(x)) | (bitcast_to_int(y) & bitcast_to_int(float4(-0.0f))));
+    return select (absy <= x1, y, x);
+}
+
+
+
 template<class Rtype, class Atype>
 static bool
 rangecompress_ (ImageBuf &R, const ImageBuf &A,
@@ -1083,10 +1319,15 @@ rangecompress_ (ImageBuf &R, const ImageBuf &A,
                     r[c] = r[c] * scale;
                 }
             } else {
-                for (int c = roi.chbegin; c < roi.chend; ++c) {
-                    if (c == alpha_channel || c == z_channel)
-                        continue;
-                    r[c] = rangecompress (r[c]);
+                for (int c = roi.chbegin; c < roi.chend; c += 4) {
+                    int n = std::min (4, roi.chend - c);
+                    simd::float4 v (0.0f);
+                    for (int i = 0; i < n; ++i)
+                        v[i] = r[c+i];
+                    v = rangecompress (v);
+                    for (int i = 0; i < n; ++i)
+                        if (c+i != alpha_channel && c+i != z_channel)
+                            r[c+i] = v[i];
                 }
             }
         }
@@ -1103,11 +1344,17 @@ rangecompress_ (ImageBuf &R, const ImageBuf &A,
                         r[c] = a[c] * scale;
                 }
             } else {
-                for (int c = roi.chbegin; c < roi.chend; ++c) {
-                    if (c == alpha_channel || c == z_channel)
-                        r[c] = a[c];
-                    else
-                        r[c] = rangecompress (a[c]);
+                for (int c = roi.chbegin; c < roi.chend; c += 4) {
+                    int n = std::min (4, roi.chend - c);
+                    simd::float4 v (0.0f);
+                    for (int i = 0; i < n; ++i)
+                        v[i] = a[c+i];
+                    v = rangecompress (v);
+                    for (int i = 0; i < n; ++i)
+                        if (c+i == alpha_channel || c+i == z_channel)
+                            r[c+i] = a[c+i];
+                        else
+                            r[c+i] = v[i];
                 }
             }
         }
@@ -1153,10 +1400,15 @@ rangeexpand_ (ImageBuf &R, const ImageBuf &A,
                     r[c] = r[c] * scale;
                 }
             } else {
-                for (int c = roi.chbegin; c < roi.chend; ++c) {
-                    if (c == alpha_channel || c == z_channel)
-                        continue;
-                    r[c] = rangeexpand (r[c]);
+                for (int c = roi.chbegin; c < roi.chend; c += 4) {
+                    int n = std::min (4, roi.chend - c);
+                    simd::float4 v (0.0f);
+                    for (int i = 0; i < n; ++i)
+                        v[i] = r[c+i];
+                    v = rangeexpand (v);
+                    for (int i = 0; i < n; ++i)
+                        if (c+i != alpha_channel && c+i != z_channel)
+                            r[c+i] = v[i];
                 }
             }
         }
@@ -1173,11 +1425,17 @@ rangeexpand_ (ImageBuf &R, const ImageBuf &A,
                         r[c] = a[c] * scale;
                 }
             } else {
-                for (int c = roi.chbegin; c < roi.chend; ++c) {
-                    if (c == alpha_channel || c == z_channel)
-                        r[c] = a[c];
-                    else
-                        r[c] = rangeexpand (a[c]);
+                for (int c = roi.chbegin; c < roi.chend; c += 4) {
+                    int n = std::min (4, roi.chend - c);
+                    simd::float4 v (0.0f);
+                    for (int i = 0; i < n; ++i)
+                        v[i] = a[c+i];
+                    v = rangeexpand (v);
+                    for (int i = 0; i < n; ++i)
+                        if (c+i == alpha_channel || c+i == z_channel)
+                            r[c+i] = a[c+i];
+                        else
+                            r[c+i] = v[i];
                 }
             }
         }
@@ -1336,6 +1594,9 @@ ImageBufAlgo::premult (ImageBuf &dst, const ImageBuf &src,
                           roi.chbegin, src, roi, nthreads);
         return true;
     }
+    if (int_premult_<uint8_t> (dst, src, roi, nthreads) ||
+        int_premult_<uint16_t> (dst, src, roi, nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2 (ok, "premult", premult_, dst.spec().format,
                           src.spec().format, dst, src, roi, nthreads);
@@ -1344,18 +1605,22 @@ ImageBufAlgo::premult (ImageBuf &dst, const ImageBuf &src,
 
 
 
+// If packed is non-empty, it holds the knots as one float4 per knot (with
+// the last knot repeated once more), and each pixel's channels come from a
+// single float4 lerp rather than a strided lookup per channel.
 template<class D, class S>
 static bool
 color_map_ (ImageBuf &dst, const ImageBuf &src,
             int srcchannel, int nknots, int channels,
             array_view<const float> knots,
+            array_view<const simd::float4> packed,
             ROI roi, int nthreads)
 {
     if (nthreads != 1 && roi.npixels() >= 1000) {
         // Possible multiple thread case -- recurse via parallel_image
         ImageBufAlgo::parallel_image (
             OIIO::bind(color_map_<D,S>, OIIO::ref(dst), OIIO::cref(src),
-                       srcchannel, nknots, channels, knots,
+                       srcchannel, nknots, channels, knots, packed,
                        _1 /*roi*/, 1 /*nthreads*/),
             roi, nthreads);
         return true;
@@ -1364,14 +1629,24 @@ color_map_ (ImageBuf &dst, const ImageBuf &src,
     if (srcchannel < 0 && src.nchannels() < 3)
         srcchannel = 0;
     roi.chend = std::min (roi.chend, channels);
+    int nsegs = nknots - 1;
     ImageBuf::Iterator<D> d (dst, roi);
     ImageBuf::ConstIterator<S> s (src, roi);
     for ( ;  !d.done();  ++d, ++s) {
         float x = srcchannel < 0 ? 0.2126f*s[0] + 0.7152f*s[1] + 0.0722f*s[2]
                                  : s[srcchannel];
-        for (int c = roi.chbegin;  c < roi.chend;  ++c) {
-            array_view_strided<const float> k (knots.data()+c, nknots, channels);
-            d[c] = interpolate_linear (x, k);
+        if (packed.size()) {
+            int segnum;
+            float f = floorfrac (clamp (x, 0.0f, 1.0f) * nsegs, &segnum);
+            simd::float4 v = lerp (packed[segnum], packed[segnum+1],
+                                   simd::float4(f));
+            for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                d[c] = v[c];
+        } else {
+            for (int c = roi.chbegin;  c < roi.chend;  ++c) {
+                array_view_strided<const float> k (knots.data()+c, nknots, channels);
+                d[c] = interpolate_linear (x, k);
+            }
         }
     }
     return true;
@@ -1403,11 +1678,23 @@ ImageBufAlgo::color_map (ImageBuf &dst, const ImageBuf &src,
         return false;
     dstroi.chend = std::min (channels, dst.nchannels());
 
+    // Repack the knots once so every pixel is a single float4 lerp. The
+    // knots are already evenly spaced, so they are the lookup table; the
+    // extra copy of the last knot lets x==1 read segnum+1 unclamped.
+    std::vector<simd::float4> packed;
+    if (channels <= 4) {
+        packed.resize (nknots+1, simd::float4(0.0f));
+        for (int k = 0;  k < nknots;  ++k)
+            for (int c = 0;  c < channels;  ++c)
+                packed[k][c] = knots[k*channels+c];
+        packed[nknots] = packed[nknots-1];
+    }
+
     bool ok;
     OIIO_DISPATCH_TYPES2 (ok, "color_map", color_map_,
                           dst.spec().format, src.spec().format,
                           dst, src, srcchannel, nknots, channels, knots,
-                          dstroi, nthreads);
+                          packed, dstroi, nthreads);
     return ok;
 }
 
@@ -1687,6 +1974,60 @@ decode_over_channels (const ImageBuf &R, int &nchannels,
 
 
 
+// over and zover for float or half RGBA (or RGBAZ) images held in local
+// memory, compositing each whole pixel as one float4.  A front pixel
+// that is entirely zero leaves the back pixel as it was, so when the
+// result is being written over B in place, it isn't touched at all.
+template<class T>
+static bool
+simd_over_ (ImageBuf &R, const ImageBuf &A, const ImageBuf &B,
+            bool zcomp, bool z_zeroisinf, ROI roi, int nthreads)
+{
+    int nchannels = 0, alpha_channel = 0, z_channel = 0, ncolor_channels = 0;
+    decode_over_channels (R, nchannels, alpha_channel,
+                          z_channel, ncolor_channels);
+    int nc = R.nchannels();
+    if (alpha_channel != 3 || roi.chbegin != 0 || roi.chend != nc ||
+        ! ((nc == 4 && z_channel < 0) || (nc == 5 && z_channel == 4)) ||
+        ! local_image_ok<T> (R, nc, roi) || ! local_image_ok<T> (A, nc, roi) ||
+        ! local_image_ok<T> (B, nc, roi))
+        return false;
+    bool has_z = (z_channel >= 0);
+    zcomp &= has_z;
+    local_rows<T> (R, A, &B, roi, nthreads,
+                   [=](T *r, const T *a, const T *b, ROI rroi) {
+        using namespace simd;
+        for (int x = 0, w = rroi.width();  x < w;
+             ++x, r += nc, a += nc, b += nc) {
+            const T *front = a, *back = b;
+            if (zcomp) {
+                float az = a[4], bz = b[4];
+                if (z_zeroisinf) {
+                    if (az == 0.0f) az = std::numeric_limits<float>::max();
+                    if (bz == 0.0f) bz = std::numeric_limits<float>::max();
+                }
+                if (az > bz)
+                    std::swap (front, back);
+            }
+            float4 f (front);
+            if (all (f == float4::Zero())) {
+                if (r != back)
+                    for (int c = 0;  c < nc;  ++c)
+                        r[c] = back[c];
+                continue;
+            }
+            float alpha = clamp (f[3], 0.0f, 1.0f);
+            float4 result = f + float4(1.0f - alpha) * float4(back);
+            result.store (r);
+            if (has_z)
+                r[4] = (alpha != 0.0f) ? front[4] : back[4];
+        }
+    });
+    return true;
+}
+
+
+
 // Fully type-specialized version of over.
 template<class Rtype, class Atype, class Btype>
 static bool
@@ -1756,6 +2097,17 @@ ImageBufAlgo::over (ImageBuf &dst, const ImageBuf &A, const ImageBuf &B,
     if (! IBAprep (roi, &dst, &A, &B, NULL,
                    IBAprep_REQUIRE_ALPHA | IBAprep_REQUIRE_SAME_NCHANNELS))
         return false;
+    // The integer path doesn't do Z, which is rarely an integer channel.
+    int nchannels, alpha_channel, z_channel, ncolor_channels;
+    decode_over_channels (dst, nchannels, alpha_channel,
+                          z_channel, ncolor_channels);
+    if (z_channel < 0 &&
+        (int_over_<uint8_t> (dst, A, B, alpha_channel, roi, nthreads) ||
+         int_over_<uint16_t> (dst, A, B, alpha_channel, roi, nthreads)))
+        return true;
+    if (simd_over_<float> (dst, A, B, false, false, roi, nthreads) ||
+        simd_over_<half> (dst, A, B, false, false, roi, nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES3 (ok, "over", over_impl, dst.spec().format,
                                  A.spec().format, B.spec().format,
@@ -1773,6 +2125,9 @@ ImageBufAlgo::zover (ImageBuf &dst, const ImageBuf &A, const ImageBuf &B,
                    IBAprep_REQUIRE_ALPHA | IBAprep_REQUIRE_Z |
                    IBAprep_REQUIRE_SAME_NCHANNELS))
         return false;
+    if (simd_over_<float> (dst, A, B, true, z_zeroisinf, roi, nthreads) ||
+        simd_over_<half> (dst, A, B, true, z_zeroisinf, roi, nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES3 (ok, "zover", over_impl, dst.spec().format,
                                  A.spec().format, B.spec().format,
@@ -35,6 +35,7 @@
 #include "OpenImageIO/imagebuf.h"
 #include "OpenImageIO/imagebufalgo.h"
 #include "OpenImageIO/imagebufalgo_util.h"
+#include "OpenImageIO/color.h"
 #include "OpenImageIO/unittest.h"
 
 #include <iostream>
@@ -220,6 +221,22 @@ void test_paste ()
     OIIO_CHECK_EQUAL (b[0], gray[0]);
     OIIO_CHECK_EQUAL (b[1], a[0]);
     OIIO_CHECK_EQUAL (b[2], a[1]);
+
+    // Big enough to be split among threads, and hanging off the edge
+    ImageSpec Cspec (200, 200, 3, TypeDesc::FLOAT);
+    ImageBuf C (Cspec);
+    ImageBufAlgo::fill (C, gray);
+    ImageBuf D (ImageSpec (300, 300, 3, TypeDesc::FLOAT));
+    ImageBufAlgo::zero (D);
+    ImageBufAlgo::paste (D, 150, 120, 0, 0, C, ROI(10, 200, 20, 200));
+    D.getpixel (149, 120, 0, b);
+    OIIO_CHECK_EQUAL (b[0], 0.0f);
+    D.getpixel (150, 119, 0, b);
+    OIIO_CHECK_EQUAL (b[0], 0.0f);
+    D.getpixel (150, 120, 0, b);
+    OIIO_CHECK_EQUAL (b[0], gray[0]);
+    D.getpixel (299, 299, 0, b);
+    OIIO_CHECK_EQUAL (b[2], gray[2]);
 }
 
 
@@ -528,6 +545,47 @@ void test_computePixelStats ()
         OIIO_CHECK_EQUAL (stats.infcount[c], 0);
         OIIO_CHECK_EQUAL (stats.finitecount[c], 4);
     }
+
+    // Bigger images, with NaN and Inf values, odd sizes and channel
+    // counts, channel subsets, and integer types, against brute force.
+    TypeDesc types[] = { TypeDesc::FLOAT, TypeDesc::HALF, TypeDesc::UINT16 };
+    for (auto type : types) {
+        ImageBuf big (ImageSpec (203, 61, 3, type));
+        for (int y = 0; y < 61; ++y)
+            for (int x = 0; x < 203; ++x) {
+                float pixel[3] = { float((x*7 + y*3) % 101) / 100.0f,
+                                   float((x + y*11) % 17) / 16.0f,
+                                   float(x % 5) / 4.0f };
+                if (type == TypeDesc::FLOAT && x == 17 && y < 3)
+                    pixel[1] = y ? std::numeric_limits<float>::infinity()
+                                 : std::numeric_limits<float>::quiet_NaN();
+                big.setpixel (x, y, pixel);
+            }
+        ROI roi (0, 203, 0, 61, 0, 1, 1, 3);
+        OIIO_CHECK_ASSERT (ImageBufAlgo::computePixelStats (stats, big, roi));
+        for (int c = 1; c < 3; ++c) {
+            double sum = 0, sum2 = 0;
+            float mn = 1e6f, mx = -1e6f;
+            imagesize_t finite = 0, nans = 0, infs = 0;
+            for (int y = 0; y < 61; ++y)
+                for (int x = 0; x < 203; ++x) {
+                    float v = big.getchannel (x, y, 0, c);
+                    if (std::isnan (v)) { ++nans; continue; }
+                    if (std::isinf (v)) { ++infs; continue; }
+                    ++finite;
+                    sum += v;  sum2 += double(v)*v;
+                    mn = std::min (mn, v);  mx = std::max (mx, v);
+                }
+            double avg = sum / finite;
+            OIIO_CHECK_EQUAL (stats.min[c], mn);
+            OIIO_CHECK_EQUAL (stats.max[c], mx);
+            OIIO_CHECK_EQUAL_THRESH (stats.avg[c], avg, 1.0e-5);
+            OIIO_CHECK_EQUAL_THRESH (stats.stddev[c], sqrt(sum2/finite - avg*avg), 1.0e-5);
+            OIIO_CHECK_EQUAL (stats.nancount[c], nans);
+            OIIO_CHECK_EQUAL (stats.infcount[c], infs);
+            OIIO_CHECK_EQUAL (stats.finitecount[c], finite);
+        }
+    }
 }
 
 
@@ -632,6 +690,960 @@ test_IBAprep ()
 
 
 
+// Test that PixelPipeline matches running the same ops one at a time.
+void
+test_pixelpipeline ()
+{
+    std::cout << "test PixelPipeline\n";
+    ImageSpec spec (300, 200, 4, TypeDesc::FLOAT);
+    spec.alpha_channel = 3;
+    ImageBuf A (spec);
+    float black[4] = { 0.1f, -0.2f, 0.3f, 0.4f };
+    float white[4] = { 0.9f, 1.5f, 0.7f, 1.2f };
+    ImageBufAlgo::checker (A, 16, 16, 1, black, white);
+
+    float scale[4] = { 0.5f, 2.0f, 1.0f, 1.0f };
+    float minv[4] = { 0.0f, 0.0f, 0.0f, -10.0f };
+    float maxv[4] = { 1.0f, 1.0f, 1.0f, 10.0f };
+    ImageBuf T1, T2, T3, T4, T5, T6;
+    ImageBufAlgo::mul (T1, A, scale);
+    ImageBufAlgo::add (T2, T1, 0.1f);
+    ImageBufAlgo::invert (T3, T2);
+    ImageBufAlgo::abs (T4, T3);
+    ImageBufAlgo::pow (T5, T4, 2.0f);
+    ImageBufAlgo::clamp (T6, T5, minv, maxv, true);
+
+    ImageBufAlgo::PixelPipeline pp;
+    pp.mul (scale).add (0.1f).invert().abs().pow (2.0f)
+      .clamp (minv, maxv, true);
+    OIIO_CHECK_EQUAL (pp.size(), 6);
+    ImageBuf R;
+    OIIO_CHECK_ASSERT (pp.apply (R, A));
+    ImageBufAlgo::CompareResults cr;
+    ImageBufAlgo::compare (R, T6, 0.0f, 0.0f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+    OIIO_CHECK_EQUAL (cr.maxerror, 0.0);
+
+    // In place, restricted to a region and a channel subset
+    ImageBuf B (A), C (A);
+    ROI roi (10, 250, 20, 150, 0, 1, 1, 3);
+    ImageBufAlgo::sub (C, C, 0.25f, roi);
+    ImageBufAlgo::div (C, C, 4.0f, roi);
+    OIIO_CHECK_ASSERT (ImageBufAlgo::PixelPipeline().sub (0.25f).div (4.0f)
+                       .apply (B, B, roi));
+    ImageBufAlgo::compare (B, C, 0.0f, 0.0f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+
+    // A color transform that can't be found is an error
+    ImageBuf D;
+    OIIO_CHECK_ASSERT (! ImageBufAlgo::PixelPipeline()
+                       .colorconvert ("nonexistent_space", "linear")
+                       .apply (D, A));
+    OIIO_CHECK_ASSERT (D.has_error());
+    D.geterror ();
+}
+
+
+
+// Helper for test_parallel_image: count each pixel visited.
+static void
+count_pixels (std::vector<atomic_int> *counts, ROI full, ROI roi)
+{
+    for (int z = roi.zbegin; z < roi.zend; ++z)
+        for (int y = roi.ybegin; y < roi.yend; ++y)
+            for (int x = roi.xbegin; x < roi.xend; ++x)
+                (*counts)[((z-full.zbegin)*full.height() + (y-full.ybegin))
+                          * full.width() + (x-full.xbegin)] += 1;
+}
+
+
+
+// Test that parallel_image visits every pixel exactly once for all split
+// directions, including when called from within pool tasks.
+void
+test_parallel_image ()
+{
+    using namespace ImageBufAlgo;
+    ROI full (10, 1034, 5, 517, 0, 3);
+    std::vector<atomic_int> counts (full.npixels());
+    SplitDir dirs[] = { Split_X, Split_Y, Split_Z, Split_Biggest, Split_Tile };
+    for (auto dir : dirs) {
+        for (auto& c : counts)
+            c = 0;
+        parallel_image (bind(count_pixels, &counts, full, _1), full, 8, dir);
+        int bad = 0;
+        for (auto& c : counts)
+            bad += (c != 1);
+        OIIO_CHECK_EQUAL (bad, 0);
+    }
+
+    // Explicit tile sizes, including ones that don't divide the region
+    // and the default (0).
+    int tilesizes[][2] = { { 64, 64 }, { 100, 7 }, { 0, 0 }, { 5000, 1 } };
+    for (auto ts : tilesizes) {
+        for (auto& c : counts)
+            c = 0;
+        parallel_image (bind(count_pixels, &counts, full, _1), full, 8,
+                        ts[0], ts[1]);
+        int bad = 0;
+        for (auto& c : counts)
+            bad += (c != 1);
+        OIIO_CHECK_EQUAL (bad, 0);
+    }
+
+    // Nested: several pool tasks each run a parallel_image of their own.
+    const int ntasks = 8;
+    std::vector<atomic_int> nestcounts[ntasks];
+    thread_pool *pool = default_thread_pool();
+    {
+        task_set<void> tasks (pool);
+        for (int t = 0; t < ntasks; ++t) {
+            std::vector<atomic_int> *c = &nestcounts[t];
+            *c = std::vector<atomic_int> (full.npixels());
+            tasks.push (pool->push ([=](int){
+                parallel_image (bind(count_pixels, c, full, _1), full,
+                                0, Split_Tile);
+            }));
+        }
+    }
+    for (int t = 0; t < ntasks; ++t) {
+        int bad = 0;
+        for (auto& c : nestcounts[t])
+            bad += (c != 1);
+        OIIO_CHECK_EQUAL (bad, 0);
+    }
+}
+
+
+
+// Brute force convolution with clamped edges, for comparison.
+static float
+convolve_ref (const ImageBuf &src, const ImageBuf &kernel, int x, int y, int c)
+{
+    ROI kroi = kernel.roi();
+    float sum = 0.0f, ksum = 0.0f;
+    for (int ky = kroi.ybegin; ky < kroi.yend; ++ky)
+        for (int kx = kroi.xbegin; kx < kroi.xend; ++kx) {
+            float k = kernel.getchannel (kx, ky, 0, 0);
+            int sx = clamp (x+kx, src.xbegin(), src.xend()-1);
+            int sy = clamp (y+ky, src.ybegin(), src.yend()-1);
+            sum += k * src.getchannel (sx, sy, 0, c);
+            ksum += k;
+        }
+    return sum / ksum;
+}
+
+
+
+// Test convolve with kernels that take each of the internal strategies:
+// separable (gaussian), FFT (big disk), and direct (small disk).
+void
+test_convolve ()
+{
+    std::cout << "test convolve\n";
+    const int xres = 64, yres = 48, nchans = 3;
+    ImageSpec spec (xres, yres, nchans, TypeDesc::FLOAT);
+    ImageBuf src (spec);
+    for (int y = 0; y < yres; ++y)
+        for (int x = 0; x < xres; ++x) {
+            float pixel[nchans];
+            for (int c = 0; c < nchans; ++c)
+                pixel[c] = float((x*7 + y*13 + c*5) % 17) / 16.0f;
+            src.setpixel (x, y, pixel);
+        }
+
+    struct { const char *name; float width; } kernels[] = {
+        { "gaussian", 5.0f }, { "disk", 41.0f }, { "disk", 5.0f }
+    };
+    for (auto k : kernels) {
+        ImageBuf kernel;
+        ImageBufAlgo::make_kernel (kernel, k.name, k.width, k.width);
+        ImageBuf dst;
+        OIIO_CHECK_ASSERT (ImageBufAlgo::convolve (dst, src, kernel));
+        float maxerr = 0.0f;
+        for (int y = 0; y < yres; ++y)
+            for (int x = 0; x < xres; ++x)
+                for (int c = 0; c < nchans; ++c)
+                    maxerr = std::max (maxerr, fabsf (dst.getchannel (x, y, 0, c)
+                                              - convolve_ref (src, kernel, x, y, c)));
+        std::cout << "  " << k.name << " max error " << maxerr << "\n";
+        OIIO_CHECK_ASSERT (maxerr < 1.0e-4f);
+    }
+
+    // A sub-region with an odd channel count goes through the same paths.
+    ImageBuf kernel, dst (spec);
+    ImageBufAlgo::make_kernel (kernel, "disk", 41.0f, 41.0f);
+    ImageBufAlgo::zero (dst);
+    ROI roi (10, 50, 8, 40, 0, 1, 0, 1);
+    OIIO_CHECK_ASSERT (ImageBufAlgo::convolve (dst, src, kernel, true, roi));
+    OIIO_CHECK_ASSERT (fabsf (dst.getchannel (20, 20, 0, 0)
+                              - convolve_ref (src, kernel, 20, 20, 0)) < 1.0e-4f);
+    OIIO_CHECK_EQUAL (dst.getchannel (20, 20, 0, 1), 0.0f);
+    OIIO_CHECK_EQUAL (dst.getchannel (5, 20, 0, 0), 0.0f);
+}
+
+
+
+// Test resize with separable filters, for both the 4-channel and the
+// general channel count code paths.
+void
+test_resize ()
+{
+    std::cout << "test resize\n";
+    for (int nchans = 3; nchans <= 4; ++nchans) {
+        ImageSpec spec (64, 32, nchans, TypeDesc::FLOAT);
+        ImageBuf src (spec);
+        for (int y = 0; y < spec.height; ++y)
+            for (int x = 0; x < spec.width; ++x) {
+                float pixel[4];
+                for (int c = 0; c < nchans; ++c)
+                    pixel[c] = float((x*3 + y*5 + c) % 11);
+                src.setpixel (x, y, pixel);
+            }
+
+        // A 1-pixel box filter halving the resolution averages 2x2 blocks.
+        ImageBuf dst (ImageSpec (32, 16, nchans, TypeDesc::FLOAT));
+        OIIO_CHECK_ASSERT (ImageBufAlgo::resize (dst, src, "box", 1.0f));
+        float maxerr = 0.0f;
+        for (int y = 0; y < 16; ++y)
+            for (int x = 0; x < 32; ++x)
+                for (int c = 0; c < nchans; ++c) {
+                    float avg = 0.25f * (src.getchannel (2*x, 2*y, 0, c) +
+                                         src.getchannel (2*x+1, 2*y, 0, c) +
+                                         src.getchannel (2*x, 2*y+1, 0, c) +
+                                         src.getchannel (2*x+1, 2*y+1, 0, c));
+                    maxerr = std::max (maxerr, fabsf (dst.getchannel (x, y, 0, c) - avg));
+                }
+        OIIO_CHECK_ASSERT (maxerr < 1.0e-5f);
+
+        // Normalized weights keep a constant image constant, including
+        // at the edges and when only a sub-region is resized.
+        const float val[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+        ImageBufAlgo::fill (src, val);
+        ImageBuf big (ImageSpec (100, 70, nchans, TypeDesc::HALF));
+        ImageBufAlgo::zero (big);
+        ROI roi (5, 95, 10, 60);
+        OIIO_CHECK_ASSERT (ImageBufAlgo::resize (big, src, "lanczos3", 0.0f, roi));
+        OIIO_CHECK_EQUAL_THRESH (big.getchannel (5, 10, 0, nchans-1), val[nchans-1], 1.0e-3);
+        OIIO_CHECK_EQUAL_THRESH (big.getchannel (50, 50, 0, 0), val[0], 1.0e-3);
+        OIIO_CHECK_EQUAL (big.getchannel (2, 2, 0, 0), 0.0f);
+    }
+
+    // A big reduction pre-reduces by 2x box averages; on smooth images
+    // it must stay close to the exact single-pass resize.
+    ImageBuf smooth (ImageSpec (512, 256, 3, TypeDesc::FLOAT));
+    for (int y = 0; y < 256; ++y)
+        for (int x = 0; x < 512; ++x) {
+            float pixel[3] = { 0.5f + 0.5f * sinf (x * 0.02f),
+                               0.5f + 0.5f * cosf (y * 0.03f),
+                               float(x + y) / 768.0f };
+            smooth.setpixel (x, y, pixel);
+        }
+    ImageBuf fast (ImageSpec (40, 20, 3, TypeDesc::FLOAT));
+    ImageBuf exact (ImageSpec (40, 20, 3, TypeDesc::FLOAT));
+    OIIO_CHECK_ASSERT (ImageBufAlgo::resize (fast, smooth));
+    OIIO::attribute ("resize:prereduce", 0);
+    OIIO_CHECK_ASSERT (ImageBufAlgo::resize (exact, smooth));
+    OIIO::attribute ("resize:prereduce", 1);
+    ImageBufAlgo::CompareResults cr;
+    ImageBufAlgo::compare (fast, exact, 0.0f, 0.0f, cr);
+    OIIO_CHECK_ASSERT (cr.maxerror < 0.01);
+}
+
+
+
+// Make a 4-channel test image with alpha of the given type, with pixel
+// values that exercise the rounding of the integer fast paths.
+static ImageBuf
+make_int_test_image (TypeDesc type, int seed)
+{
+    ImageSpec spec (37, 29, 4, type);
+    spec.alpha_channel = 3;
+    ImageBuf img (spec);
+    for (int y = 0; y < spec.height; ++y)
+        for (int x = 0; x < spec.width; ++x) {
+            float pixel[4];
+            for (int c = 0; c < 4; ++c)
+                pixel[c] = float(((x+seed)*37 + (y+2*seed)*91 + c*53) % 256) / 255.0f;
+            img.setpixel (x, y, pixel);
+        }
+    return img;
+}
+
+
+// Largest absolute difference, in units of the type's steps, between the
+// integer result R and float result F converted to R's type.
+static int
+max_int_diff (const ImageBuf &R, const ImageBuf &F)
+{
+    ImageBuf Fi;
+    ImageBufAlgo::copy (Fi, F, R.spec().format);
+    float scale = R.spec().format == TypeDesc::UINT8 ? 255.0f : 65535.0f;
+    ImageBufAlgo::CompareResults cr;
+    ImageBufAlgo::compare (R, Fi, 0.0f, 0.0f, cr);
+    return int (cr.maxerror * scale + 0.5f);
+}
+
+
+// The 8 and 16 bit fast paths must produce the same values as doing the
+// same operation in float and converting the result.
+void
+test_int_fastpaths ()
+{
+    std::cout << "test integer fast paths\n";
+    TypeDesc types[] = { TypeDesc::UINT8, TypeDesc::UINT16 };
+    for (auto type : types) {
+        ImageBuf A = make_int_test_image (type, 0);
+        ImageBuf B = make_int_test_image (type, 5);
+        ImageBuf Af, Bf;
+        ImageBufAlgo::copy (Af, A, TypeDesc::FLOAT);
+        ImageBufAlgo::copy (Bf, B, TypeDesc::FLOAT);
+        ImageBuf R, F;
+
+        ImageBufAlgo::add (R, A, B);
+        ImageBufAlgo::add (F, Af, Bf);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+        ImageBufAlgo::sub (R, A, B);
+        ImageBufAlgo::sub (F, Af, Bf);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+        ImageBufAlgo::mul (R, A, B);
+        ImageBufAlgo::mul (F, Af, Bf);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+        ImageBufAlgo::premult (R, A);
+        ImageBufAlgo::premult (F, Af);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+        ImageBufAlgo::over (R, A, B);
+        ImageBufAlgo::over (F, Af, Bf);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+
+        // A 2x2 box average may round exact halves the other way.
+        ImageBuf Rs (ImageSpec (18, 14, 4, type)), Fs (ImageSpec (18, 14, 4, TypeDesc::FLOAT));
+        ImageBufAlgo::resize (Rs, B, "box", 1.0f, ROI (0, 18, 0, 14));
+        ImageBufAlgo::resize (Fs, Bf, "box", 1.0f, ROI (0, 18, 0, 14));
+        OIIO_CHECK_ASSERT (max_int_diff (Rs, Fs) <= 1);
+
+        // Native copies of a channel subset and vertical flips
+        ROI roi (3, 30, 2, 20, 0, 1, 1, 3);
+        R.copy (A);
+        ImageBufAlgo::copy (R, B, TypeDesc::UNKNOWN, roi);
+        F.copy (Af);
+        ImageBufAlgo::copy (F, Bf, TypeDesc::UNKNOWN, roi);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+        ImageBufAlgo::flip (R, A);
+        ImageBufAlgo::flip (F, Af);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+    }
+}
+
+
+
+// The raw byte copies that paste, flop, the rotations, transpose and
+// circular_shift use when src and dst share a pixel type must match the
+// per-channel loops, which a float dst of a uint8 src still takes.
+void
+test_native_copies ()
+{
+    std::cout << "test native copies\n";
+    ImageBuf A = make_int_test_image (TypeDesc::UINT8, 0);
+    ImageSpec fspec (A.spec());
+    fspec.set_format (TypeDesc::FLOAT);
+    ImageSpec rspec (fspec.height, fspec.width, fspec.nchannels, TypeDesc::FLOAT);
+    ImageBuf R;
+    {
+        ImageBuf F (fspec);
+        ImageBufAlgo::flop (R, A);
+        ImageBufAlgo::flop (F, A);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+    }
+    {
+        ImageBuf F (fspec);
+        ImageBufAlgo::rotate180 (R, A);
+        ImageBufAlgo::rotate180 (F, A);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+    }
+    {
+        ImageBuf F (rspec);
+        R.clear ();
+        ImageBufAlgo::rotate90 (R, A);
+        ImageBufAlgo::rotate90 (F, A);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+    }
+    {
+        ImageBuf F (rspec);
+        R.clear ();
+        ImageBufAlgo::rotate270 (R, A);
+        ImageBufAlgo::rotate270 (F, A);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+    }
+    {
+        ImageBuf F (rspec);
+        R.clear ();
+        ImageBufAlgo::transpose (R, A);
+        ImageBufAlgo::transpose (F, A);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+    }
+    {
+        ImageBuf F (fspec);
+        R.clear ();
+        ImageBufAlgo::circular_shift (R, A, 5, -3);
+        ImageBufAlgo::circular_shift (F, A, 5, -3);
+        OIIO_CHECK_EQUAL (max_int_diff (R, F), 0);
+    }
+    {
+        // Overlapping channel subset, at an offset
+        ImageBuf D (ImageSpec (50, 40, 4, TypeDesc::UINT8));
+        ImageBuf F (ImageSpec (50, 40, 4, TypeDesc::FLOAT));
+        ImageBufAlgo::zero (D);
+        ImageBufAlgo::zero (F);
+        ImageBufAlgo::paste (D, 5, 7, 0, 1, A, ROI (2, 30, 3, 25, 0, 1, 0, 3));
+        ImageBufAlgo::paste (F, 5, 7, 0, 1, A, ROI (2, 30, 3, 25, 0, 1, 0, 3));
+        OIIO_CHECK_EQUAL (max_int_diff (D, F), 0);
+    }
+}
+
+
+
+// Brute force median/max/min of the clamped window that median_filter,
+// dilate and erode use for pixel (x,y) channel c.
+static void
+window_stats_ref (const ImageBuf &src, int width, int height, int x, int y,
+                  int c, float &median, float &maxval, float &minval)
+{
+    int w_2 = std::max (1, width/2), h_2 = std::max (1, height/2);
+    std::vector<float> vals;
+    for (int j = 0; j < height; ++j)
+        for (int i = 0; i < width; ++i) {
+            int sx = clamp (x-w_2+i, src.xbegin(), src.xend()-1);
+            int sy = clamp (y-h_2+j, src.ybegin(), src.yend()-1);
+            vals.push_back (src.getchannel (sx, sy, 0, c));
+        }
+    std::sort (vals.begin(), vals.end());
+    median = vals[vals.size()/2];
+    minval = vals.front();
+    maxval = vals.back();
+}
+
+
+
+// Test median_filter, dilate, and erode against brute force, with window
+// sizes that take both the small-window and the large-window code paths.
+void
+test_median_morph ()
+{
+    std::cout << "test median_filter, dilate, erode\n";
+    ImageSpec spec (41, 33, 2, TypeDesc::UINT8);
+    ImageBuf src (spec);
+    for (int y = 0; y < spec.height; ++y)
+        for (int x = 0; x < spec.width; ++x) {
+            float pixel[2] = { float((x*17 + y*31) % 256) / 255.0f,
+                               float((x*x + 3*y) % 256) / 255.0f };
+            src.setpixel (x, y, pixel);
+        }
+    int sizes[][2] = { { 3, 3 }, { 1, 1 }, { 9, 9 }, { 15, 7 } };
+    for (auto size : sizes) {
+        int width = size[0], height = size[1];
+        ImageBuf med, dil, ero;
+        ImageBufAlgo::median_filter (med, src, width, height);
+        ImageBufAlgo::dilate (dil, src, width, height);
+        ImageBufAlgo::erode (ero, src, width, height);
+        int bad = 0;
+        for (int y = 0; y < spec.height; ++y)
+            for (int x = 0; x < spec.width; ++x)
+                for (int c = 0; c < spec.nchannels; ++c) {
+                    float m, mx, mn;
+                    window_stats_ref (src, width, height, x, y, c, m, mx, mn);
+                    bad += (med.getchannel (x, y, 0, c) != m);
+                    bad += (dil.getchannel (x, y, 0, c) != mx);
+                    bad += (ero.getchannel (x, y, 0, c) != mn);
+                }
+        OIIO_CHECK_EQUAL (bad, 0);
+    }
+}
+
+
+
+// computePixelHashXX64 must not depend on the thread count or on how the
+// pixels are stored, and must notice any changed pixel.
+void
+test_pixel_hash ()
+{
+    std::cout << "test computePixelHashXX64\n";
+    ImageBuf A (ImageSpec (300, 200, 3, TypeDesc::HALF));
+    float red[3] = { 1, 0, 0 }, grey[3] = { 0.5f, 0.5f, 0.5f };
+    ImageBufAlgo::checker (A, 8, 8, 1, red, grey);
+    std::string h1 = ImageBufAlgo::computePixelHashXX64 (A, "", ROI::All(), 16, 1);
+    OIIO_CHECK_EQUAL (h1.size(), 16);
+    OIIO_CHECK_EQUAL (ImageBufAlgo::computePixelHashXX64 (A, "", ROI::All(), 16, 8), h1);
+    OIIO_CHECK_NE (ImageBufAlgo::computePixelHashXX64 (A, "", ROI::All(), 32, 8), h1);
+    OIIO_CHECK_NE (ImageBufAlgo::computePixelHashXX64 (A, "extra", ROI::All(), 16, 8), h1);
+
+    // A partial-width region, gathered rather than hashed in place,
+    // must hash like the same pixels cropped into their own image.
+    ROI roi (10, 250, 5, 190);
+    ImageBuf C;
+    ImageBufAlgo::copy (C, A, TypeDesc::UNKNOWN, roi);
+    OIIO_CHECK_EQUAL (ImageBufAlgo::computePixelHashXX64 (A, "", roi),
+                      ImageBufAlgo::computePixelHashXX64 (C));
+
+    A.setpixel (299, 199, red);
+    OIIO_CHECK_NE (ImageBufAlgo::computePixelHashXX64 (A, "", ROI::All(), 16, 8), h1);
+}
+
+
+
+// fft must match a direct unitary DFT, including for odd sizes where
+// the last row has no partner, and ifft must take it back again.
+void
+test_fft ()
+{
+    std::cout << "test fft/ifft\n";
+    const int w = 15, h = 9;
+    ImageBuf A (ImageSpec (w, h, 1, TypeDesc::FLOAT));
+    for (int y = 0;  y < h;  ++y)
+        for (int x = 0;  x < w;  ++x) {
+            float v = sinf (0.7f*x + 0.3f*y*y) + 0.01f * x * y;
+            A.setpixel (x, y, &v);
+        }
+    ImageBuf F;
+    OIIO_CHECK_ASSERT (ImageBufAlgo::fft (F, A));
+    OIIO_CHECK_EQUAL (F.nchannels(), 2);
+    float maxerr = 0.0f;
+    for (int v = 0;  v < h;  ++v)
+        for (int u = 0;  u < w;  ++u) {
+            double re = 0, im = 0;
+            for (int y = 0;  y < h;  ++y)
+                for (int x = 0;  x < w;  ++x) {
+                    double a = -2.0 * M_PI * (double(u*x)/w + double(v*y)/h);
+                    float p = A.getchannel (x, y, 0, 0);
+                    re += p * cos(a);
+                    im += p * sin(a);
+                }
+            re /= sqrt (double(w*h));
+            im /= sqrt (double(w*h));
+            maxerr = std::max (maxerr, fabsf (F.getchannel(u,v,0,0) - float(re)));
+            maxerr = std::max (maxerr, fabsf (F.getchannel(u,v,0,1) - float(im)));
+        }
+    OIIO_CHECK_ASSERT (maxerr < 1.0e-4f);
+
+    ImageBuf B;
+    OIIO_CHECK_ASSERT (ImageBufAlgo::ifft (B, F));
+    OIIO_CHECK_EQUAL (B.nchannels(), 1);
+    ImageBufAlgo::CompareResults cr;
+    ImageBufAlgo::compare (A, B, 1.0e-4f, 1.0e-4f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+
+    // Threaded results on a bigger image must match the serial ones.
+    ImageBuf C (ImageSpec (300, 201, 1, TypeDesc::FLOAT));
+    ImageBufAlgo::noise (C, "uniform", 0.0f, 1.0f, false, 1);
+    ImageBuf F1, F8, C1, C8;
+    ImageBufAlgo::fft (F1, C, ROI::All(), 1);
+    ImageBufAlgo::fft (F8, C, ROI::All(), 8);
+    ImageBufAlgo::compare (F1, F8, 0.0f, 0.0f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+    ImageBufAlgo::ifft (C1, F1, ROI::All(), 1);
+    ImageBufAlgo::ifft (C8, F1, ROI::All(), 8);
+    ImageBufAlgo::compare (C1, C8, 0.0f, 0.0f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+    ImageBufAlgo::compare (C, C1, 1.0e-4f, 1.0e-4f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+}
+
+
+
+// The fast blur approximations must stay close to the exact gaussian,
+// leave a constant image alone, and not depend on the thread count.
+void
+test_blur ()
+{
+    std::cout << "test blur\n";
+    ImageBuf A (ImageSpec (160, 120, 3, TypeDesc::FLOAT));
+    float white[3] = { 1, 1, 1 }, black[3] = { 0, 0, 0 };
+    ImageBufAlgo::checker (A, 16, 16, 1, white, black);
+    ImageBuf Exact;
+    ImageBufAlgo::blur (Exact, A, 20.0f, 12.0f, "gaussian");
+    const char *methods[] = { "iir", "box" };
+    for (int m = 0;  m < 2;  ++m) {
+        ImageBuf B1, B8;
+        OIIO_CHECK_ASSERT (ImageBufAlgo::blur (B1, A, 20.0f, 12.0f,
+                                               methods[m], ROI::All(), 1));
+        ImageBufAlgo::blur (B8, A, 20.0f, 12.0f, methods[m], ROI::All(), 8);
+        ImageBufAlgo::CompareResults cr;
+        ImageBufAlgo::compare (B1, B8, 0.0f, 0.0f, cr);
+        OIIO_CHECK_EQUAL (cr.nfail, 0);
+        ImageBufAlgo::compare (Exact, B1, 0.1f, 0.1f, cr);
+        OIIO_CHECK_EQUAL (cr.nfail, 0);
+        OIIO_CHECK_ASSERT (cr.meanerror < 0.02);
+
+        ImageBuf C (ImageSpec (64, 64, 4, TypeDesc::HALF)), D;
+        float grey[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+        ImageBufAlgo::fill (C, grey);
+        ImageBufAlgo::blur (D, C, 30.0f, 0.0f, methods[m]);
+        ImageBufAlgo::compare (C, D, 1.0e-3f, 1.0e-3f, cr);
+        OIIO_CHECK_EQUAL (cr.nfail, 0);
+    }
+    ImageBuf E;
+    OIIO_CHECK_ASSERT (! ImageBufAlgo::blur (E, A, 5.0f, 5.0f, "nonesuch"));
+}
+
+
+
+// The float4 over/zover kernels must give what the general path gives
+// (forced here by asking for a double result), including where the
+// foreground is empty and the composite is done in place.
+void
+test_simd_over ()
+{
+    std::cout << "test simd over/zover\n";
+    TypeDesc types[] = { TypeDesc::FLOAT, TypeDesc::HALF };
+    for (auto type : types) {
+        for (int nc = 4;  nc <= 5;  ++nc) {
+            ImageSpec spec (40, 30, nc, type);
+            spec.alpha_channel = 3;
+            if (nc == 5) {
+                spec.channelnames[4] = "Z";
+                spec.z_channel = 4;
+            }
+            ImageBuf A (spec), B (spec);
+            ImageBufAlgo::noise (A, "uniform", 0.0f, 1.0f, false, 1);
+            ImageBufAlgo::noise (B, "uniform", 0.0f, 1.0f, false, 2);
+            ImageBufAlgo::zero (A, ROI (0, 20, 0, 30));
+            ImageBufAlgo::premult (A, A);
+            ImageBufAlgo::premult (B, B);
+            ImageBuf R, G (ImageSpec (40, 30, nc, TypeDesc::DOUBLE));
+            G.specmod().alpha_channel = 3;
+            G.specmod().z_channel = spec.z_channel;
+            ImageBufAlgo::CompareResults cr;
+            for (int z = 0;  z < (nc == 5 ? 2 : 1);  ++z) {
+                if (z) {
+                    ImageBufAlgo::zover (R, A, B);
+                    ImageBufAlgo::zover (G, A, B);
+                } else {
+                    ImageBufAlgo::over (R, A, B);
+                    ImageBufAlgo::over (G, A, B);
+                }
+                ImageBufAlgo::compare (R, G, 2.0e-3f, 2.0e-3f, cr);
+                OIIO_CHECK_EQUAL (cr.nfail, 0);
+            }
+            ImageBuf C;
+            C.copy (B);
+            ImageBufAlgo::over (C, A, C);
+            ImageBufAlgo::over (R, A, B);
+            ImageBufAlgo::compare (C, R, 0.0f, 0.0f, cr);
+            OIIO_CHECK_EQUAL (cr.nfail, 0);
+        }
+    }
+}
+
+
+
+// color_map's packed-knot path must match interpolating the knots one
+// channel at a time, and the float4 rangecompress/rangeexpand must agree
+// with the scalar formula and round-trip, including negative values and
+// an alpha channel that they are supposed to skip.
+void
+test_color_map_range ()
+{
+    std::cout << "test color_map and range ops\n";
+    ImageBuf A (ImageSpec (64, 32, 1, TypeDesc::FLOAT));
+    ImageBufAlgo::noise (A, "uniform", -0.1f, 1.1f, false, 5);
+    static const float k[] = { 0, 0, 0.05,  0, 0, 0.75,  0, 0.5, 0,
+                               0.5, 0.5, 0,  1, 0, 0 };
+    ImageBuf M;
+    ImageBufAlgo::color_map (M, A, 0, 5, 3, k);
+    for (int y = 0;  y < 32;  y += 7)
+        for (int x = 0;  x < 64;  x += 5)
+            for (int c = 0;  c < 3;  ++c) {
+                array_view_strided<const float> kc (k+c, 5, 3);
+                float e = interpolate_linear (A.getchannel (x, y, 0, 0), kc);
+                OIIO_CHECK_EQUAL_THRESH (M.getchannel (x, y, 0, c), e, 1.0e-6f);
+            }
+
+    ImageSpec spec (64, 32, 5, TypeDesc::FLOAT);
+    spec.alpha_channel = 3;
+    ImageBuf B (spec), C, D;
+    ImageBufAlgo::noise (B, "uniform", -20.0f, 20.0f, false, 6);
+    ImageBufAlgo::rangecompress (C, B);
+    ImageBufAlgo::rangeexpand (D, C);
+    for (int y = 0;  y < 32;  y += 3)
+        for (int x = 0;  x < 64;  x += 3)
+            for (int c = 0;  c < 5;  ++c) {
+                float v = B.getchannel (x, y, 0, c);
+                float e = v;
+                if (c != 3 && fabsf(v) > 0.18f)
+                    e = copysignf (-0.54576885700225830078f + 0.18351669609546661377f
+                                   * logf (284.3577880859375f * fabsf(v) + 1.0f), v);
+                OIIO_CHECK_EQUAL_THRESH (C.getchannel (x, y, 0, c), e, 1.0e-5f);
+                OIIO_CHECK_EQUAL_THRESH (D.getchannel (x, y, 0, c), v,
+                                         1.0e-4f * std::max (1.0f, fabsf(v)));
+            }
+}
+
+
+
+// With color:precision "baked", colorconvert goes through a 3D LUT for
+// pixels inside the unit cube and the exact transform elsewhere.
+void
+test_colorconvert_baked ()
+{
+    std::cout << "test colorconvert baked\n";
+    ImageBuf A (ImageSpec (64, 32, 4, TypeDesc::FLOAT));
+    ImageBufAlgo::noise (A, "uniform", 0.0f, 1.0f, false, 3);
+    float bright[4] = { 4.0f, 0.5f, 0.25f, 1.0f };
+    A.setpixel (5, 5, bright);
+    ImageBuf Exact, Baked;
+    ImageBufAlgo::colorconvert (Exact, A, "sRGB", "linear", false,
+                                "", "", NULL, ROI::All());
+    OIIO::attribute ("color:precision", "baked");
+    ImageBufAlgo::colorconvert (Baked, A, "sRGB", "linear", false,
+                                "", "", NULL, ROI::All());
+    OIIO::attribute ("color:precision", "exact");
+    ImageBufAlgo::CompareResults cr;
+    ImageBufAlgo::compare (Exact, Baked, 1.0e-3f, 1.0e-3f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+    OIIO_CHECK_EQUAL (Baked.getchannel (5, 5, 0, 0),
+                      Exact.getchannel (5, 5, 0, 0));
+    OIIO_CHECK_EQUAL (Baked.getchannel (9, 9, 0, 3), A.getchannel (9, 9, 0, 3));
+}
+
+
+
+// 8 and 16 bit sources go through exact per-value tables for the built-in
+// sRGB and Rec709 transforms; results must match converting from float.
+void
+test_colorconvert_int_lut ()
+{
+    std::cout << "test colorconvert integer tables\n";
+    TypeDesc types[] = { TypeDesc::UINT8, TypeDesc::UINT16 };
+    const char *spaces[] = { "sRGB", "Rec709" };
+    for (auto type : types) {
+        ImageBuf A (ImageSpec (300, 50, 4, type)), Af;
+        ImageBufAlgo::noise (A, "uniform", 0.0f, 1.0f, false, 4);
+        ImageBufAlgo::copy (Af, A, TypeDesc::FLOAT);
+        for (auto space : spaces) {
+            ImageBuf R (ImageSpec (300, 50, 4, TypeDesc::FLOAT)), F;
+            ImageBufAlgo::colorconvert (R, A, space, "linear", false,
+                                        "", "", NULL, ROI::All());
+            ImageBufAlgo::colorconvert (F, Af, space, "linear", false,
+                                        "", "", NULL, ROI::All());
+            ImageBufAlgo::CompareResults cr;
+            ImageBufAlgo::compare (R, F, 1.0e-4f, 1.0e-4f, cr);
+            OIIO_CHECK_EQUAL (cr.nfail, 0);
+            OIIO_CHECK_EQUAL (R.getchannel (7, 7, 0, 3), A.getchannel (7, 7, 0, 3));
+        }
+        ImageBuf R (ImageSpec (300, 50, 4, TypeDesc::FLOAT));
+        ImageBufAlgo::colorconvert (R, A, "sRGB", "linear", false,
+                                    "", "", NULL, ROI::All());
+        float v = A.getchannel (11, 3, 0, 1);
+        OIIO_CHECK_EQUAL_THRESH (R.getchannel (11, 3, 0, 1), sRGB_to_linear (v), 1.0e-6f);
+    }
+}
+
+
+
+// Affine warps with separable filters take a specialized path; it must
+// match the general per-pixel filtered lookup used for other matrices.
+void
+test_warp_affine ()
+{
+    std::cout << "test warp affine\n";
+    TypeDesc types[] = { TypeDesc::FLOAT, TypeDesc::UINT8 };
+    const char *filters[] = { "triangle", "catmull-rom", "lanczos3", "gaussian" };
+    float scales[] = { 1.3f, 0.6f };
+    for (auto type : types) {
+        ImageBuf A (ImageSpec (64, 48, 3, type));
+        ImageBufAlgo::noise (A, "uniform", 0.0f, 1.0f, false, 3);
+        for (auto scale : scales) {
+            Imath::M33f M;
+            M.translate (Imath::V2f (-32.0f, -24.0f));
+            M *= Imath::M33f().rotate (0.5f);
+            M *= Imath::M33f().scale (Imath::V2f (scale, scale));
+            M *= Imath::M33f().translate (Imath::V2f (30.0f, 25.0f));
+            // A vanishingly small perspective term forces the general path
+            Imath::M33f P (M);
+            P[0][2] = 1.0e-9f;
+            for (auto filter : filters) {
+                ImageBuf R (ImageSpec (64, 48, 3, TypeDesc::FLOAT));
+                ImageBuf G (ImageSpec (64, 48, 3, TypeDesc::FLOAT));
+                ImageBufAlgo::warp (R, A, M, filter);
+                ImageBufAlgo::warp (G, A, P, filter);
+                ImageBufAlgo::CompareResults cr;
+                ImageBufAlgo::compare (R, G, 1.0e-4f, 1.0e-4f, cr);
+                OIIO_CHECK_EQUAL (cr.nfail, 0);
+            }
+        }
+    }
+}
+
+
+
+// An STMap made from an affine transform must warp just like warp() does
+// with that transform, and an identity STMap must reproduce the source.
+void
+test_st_warp ()
+{
+    std::cout << "test st_warp\n";
+    ImageBuf A (ImageSpec (64, 48, 3, TypeDesc::FLOAT));
+    ImageBufAlgo::noise (A, "uniform", 0.0f, 1.0f, false, 5);
+    Imath::M33f Minv;   // dst -> src
+    Minv.translate (Imath::V2f (-30.0f, -20.0f));
+    Minv *= Imath::M33f().rotate (0.3f);
+    Minv *= Imath::M33f().scale (Imath::V2f (0.7f, 0.7f));
+    Minv *= Imath::M33f().translate (Imath::V2f (32.0f, 24.0f));
+    ImageBuf ST (ImageSpec (64, 48, 2, TypeDesc::FLOAT));
+    ImageBuf Ident (ImageSpec (64, 48, 2, TypeDesc::FLOAT));
+    for (ImageBuf::Iterator<float> p (ST), q (Ident); ! p.done(); ++p, ++q) {
+        Imath::V2f P (p.x()+0.5f, p.y()+0.5f);
+        Minv.multVecMatrix (P, P);
+        p[0] = P.x / 64.0f;
+        p[1] = P.y / 48.0f;
+        q[0] = (q.x()+0.5f) / 64.0f;
+        q[1] = (q.y()+0.5f) / 48.0f;
+    }
+    const char *filters[] = { "triangle", "catmull-rom", "lanczos3" };
+    for (auto filter : filters) {
+        ImageBuf R, W;
+        OIIO_CHECK_ASSERT (ImageBufAlgo::st_warp (R, A, ST, filter));
+        ImageBufAlgo::warp (W, A, Minv.inverse(), filter);
+        OIIO_CHECK_EQUAL (R.roi(), ST.roi());
+        OIIO_CHECK_EQUAL (R.nchannels(), 3);
+        ImageBufAlgo::CompareResults cr;
+        ImageBufAlgo::compare (R, W, 1.0e-3f, 1.0e-3f, cr);
+        OIIO_CHECK_EQUAL (cr.nfail, 0);
+    }
+    ImageBuf I;
+    ImageBufAlgo::st_warp (I, A, Ident, "triangle");
+    ImageBufAlgo::CompareResults cr;
+    ImageBufAlgo::compare (I, A, 1.0e-5f, 1.0e-5f, cr);
+    OIIO_CHECK_EQUAL (cr.nfail, 0);
+}
+
+
+
+// Channel shuffles of like-typed local images go a scanline at a time
+// through the pixel shuffler; check them value by value.
+void
+test_channel_shuffle ()
+{
+    std::cout << "test channel shuffle\n";
+    ImageBuf A (ImageSpec (37, 5, 4, TypeDesc::UINT8));
+    ImageBuf B (ImageSpec (37, 5, 3, TypeDesc::UINT8));
+    ImageBufAlgo::noise (A, "uniform", 0.0f, 1.0f, false, 7);
+    ImageBufAlgo::noise (B, "uniform", 0.0f, 1.0f, false, 8);
+    int order[] = { 2, 1, 0, -1, 3 };
+    float values[] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+    ImageBuf S, AB;
+    ImageBufAlgo::channels (S, A, 5, order, values);
+    ImageBufAlgo::channel_append (AB, A, B);
+    ImageBuf ABu8 (ImageSpec (37, 5, 7, TypeDesc::UINT8));
+    ImageBufAlgo::channel_append (ABu8, A, B);
+    OIIO_CHECK_EQUAL (S.nchannels(), 5);
+    for (int y = 0; y < 5; ++y)
+        for (int x = 0; x < 37; ++x) {
+            for (int c = 0; c < 5; ++c)
+                OIIO_CHECK_EQUAL (S.getchannel (x, y, 0, c),
+                                  order[c] >= 0 ? A.getchannel (x, y, 0, order[c])
+                                                : values[c]);
+            for (int c = 0; c < 7; ++c) {
+                float v = c < 4 ? A.getchannel (x, y, 0, c) : B.getchannel (x, y, 0, c-4);
+                OIIO_CHECK_EQUAL (AB.getchannel (x, y, 0, c), v);
+                OIIO_CHECK_EQUAL (ABu8.getchannel (x, y, 0, c), v);
+            }
+        }
+
+    // Planar <-> interleaved round trip
+    std::vector<unsigned char> pixels (37*5*4), planes (37*5*4), back (37*5*4);
+    A.get_pixels (A.roi(), TypeDesc::UINT8, &pixels[0]);
+    OIIO_CHECK_ASSERT (interleaved_to_planar (4, 37, 5, 1, &pixels[0],
+                           TypeDesc::UINT8, &planes[0], TypeDesc::UINT8,
+                           AutoStride));
+    OIIO_CHECK_EQUAL (int(planes[2*37*5 + 40]), int(pixels[40*4 + 2]));
+    OIIO_CHECK_ASSERT (planar_to_interleaved (4, 37, 5, 1, &planes[0],
+                           TypeDesc::UINT8, AutoStride, &back[0],
+                           TypeDesc::UINT8));
+    OIIO_CHECK_ASSERT (back == pixels);
+    std::vector<unsigned short> pixels16 (37*5*4), planes16 (37*5*4),
+                                back16 (37*5*4);
+    A.get_pixels (A.roi(), TypeDesc::UINT16, &pixels16[0]);
+    OIIO_CHECK_ASSERT (interleaved_to_planar (4, 37, 5, 1, &pixels16[0],
+                           TypeDesc::UINT16, &planes16[0], TypeDesc::UINT16,
+                           AutoStride));
+    OIIO_CHECK_ASSERT (planar_to_interleaved (4, 37, 5, 1, &planes16[0],
+                           TypeDesc::UINT16, AutoStride, &back16[0],
+                           TypeDesc::UINT16));
+    OIIO_CHECK_ASSERT (back16 == pixels16);
+}
+
+
+
+// Histogram and color_count are computed in parallel bands; compare
+// against a straightforward serial tally, for float and uint8 images.
+void
+test_histogram ()
+{
+    std::cout << "test histogram\n";
+    const int bins = 10;
+    for (int t = 0;  t < 2;  ++t) {
+        TypeDesc fmt = t ? TypeDesc::UINT8 : TypeDesc::FLOAT;
+        ImageBuf A (ImageSpec (203, 157, 2, fmt));
+        ImageBufAlgo::noise (A, "uniform", -0.2f, 1.2f, false, 3);
+        float one[2] = { 1.0f, 0.0f };
+        A.setpixel (3, 4, one);  // exactly max goes in the last bin
+        std::vector<imagesize_t> ref (bins, 0);
+        imagesize_t reflow = 0, refhigh = 0;
+        for (ImageBuf::ConstIterator<float> p (A);  !p.done();  ++p) {
+            float c = p[1];
+            if (c >= 0.0f && c < 1.0f)
+                ref[int(c * bins)]++;
+            else if (c == 1.0f)
+                ref[bins-1]++;
+            else if (c < 0.0f)
+                ++reflow;
+            else
+                ++refhigh;
+        }
+        std::vector<imagesize_t> hist;
+        imagesize_t low = 0, high = 0;
+        OIIO_CHECK_ASSERT (ImageBufAlgo::histogram (A, 1, hist, bins, 0.0f,
+                                                    1.0f, &low, &high));
+        OIIO_CHECK_ASSERT (hist == ref);
+        OIIO_CHECK_EQUAL (low, reflow);
+        OIIO_CHECK_EQUAL (high, refhigh);
+    }
+
+    ImageBuf C (ImageSpec (300, 200, 3, TypeDesc::UINT8));
+    float red[3] = { 1, 0, 0 };
+    ImageBufAlgo::fill (C, red, ROI (0, 100, 0, 50));
+    float colors[6] = { 0, 0, 0, 1, 0, 0 };
+    imagesize_t count[2];
+    OIIO_CHECK_ASSERT (ImageBufAlgo::color_count (C, count, 2, colors));
+    OIIO_CHECK_EQUAL (count[0], imagesize_t(300*200 - 100*50));
+    OIIO_CHECK_EQUAL (count[1], imagesize_t(100*50));
+}
+
+
+
+// Push-pull hole filling must leave opaque pixels alone and fill the
+// holes with the surrounding color.
+void
+test_fillholes ()
+{
+    std::cout << "test fillholes_pushpull\n";
+    const float color[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+    ImageSpec spec (67, 45, 4, TypeDesc::HALF);
+    spec.alpha_channel = 3;
+    ImageBuf A (spec);
+    ImageBufAlgo::fill (A, color);
+    ImageBufAlgo::zero (A, ROI (10, 30, 5, 40));
+    ImageBufAlgo::zero (A, ROI (60, 67, 0, 3));
+    ImageBuf R (spec);
+    OIIO_CHECK_ASSERT (ImageBufAlgo::fillholes_pushpull (R, A));
+    for (ImageBuf::ConstIterator<float> r (R);  !r.done();  ++r)
+        for (int c = 0;  c < 4;  ++c)
+            OIIO_CHECK_EQUAL_THRESH (r[c], color[c], 0.002f);
+}
+
+
+
 int
 main (int argc, char **argv)
 {
@@ -651,6 +1663,25 @@ main (int argc, char **argv)
     test_computePixelStats ();
     test_maketx_from_imagebuf ();
     test_IBAprep ();
+    test_parallel_image ();
+    test_pixelpipeline ();
+    test_convolve ();
+    test_resize ();
+    test_int_fastpaths ();
+    test_native_copies ();
+    test_median_morph ();
+    test_pixel_hash ();
+    test_fft ();
+    test_blur ();
+    test_simd_over ();
+    test_color_map_range ();
+    test_colorconvert_baked ();
+    test_colorconvert_int_lut ();
+    test_warp_affine ();
+    test_st_warp ();
+    test_channel_shuffle ();
+    test_histogram ();
+    test_fillholes ();
     
     return unit_test_failures;
 }
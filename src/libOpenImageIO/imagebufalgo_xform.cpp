@@ -37,14 +37,18 @@
 #include <OpenEXR/ImathBox.h>
 
 #include <cmath>
+#include <limits>
 #include <memory>
+#include <vector>
 
 #include "OpenImageIO/imagebuf.h"
 #include "OpenImageIO/imagebufalgo.h"
 #include "OpenImageIO/imagebufalgo_util.h"
 #include "OpenImageIO/dassert.h"
 #include "OpenImageIO/filter.h"
+#include "OpenImageIO/simd.h"
 #include "OpenImageIO/thread.h"
+#include "imageio_pvt.h"
 
 OIIO_NAMESPACE_BEGIN
 
@@ -153,19 +157,31 @@ filtered_sample (const ImageBuf &src, float s, float t,
     float dt_inv = 1.0f / dt;
     float filterrad_s = 0.5f * ds * filter->width();
     float filterrad_t = 0.5f * dt * filter->width();
-    ImageBuf::ConstIterator<SRCTYPE> samp (src, 
-                      (int)floorf(s-filterrad_s), (int)ceilf(s+filterrad_s),
-                      (int)floorf(t-filterrad_t), (int)ceilf(t+filterrad_t),
-                      0, 1, wrap);
+    int xbegin = (int)floorf(s-filterrad_s), xend = (int)ceilf(s+filterrad_s);
+    int ybegin = (int)floorf(t-filterrad_t), yend = (int)ceilf(t+filterrad_t);
+    ImageBuf::ConstIterator<SRCTYPE> samp (src, xbegin, xend, ybegin, yend,
+                                           0, 1, wrap);
     int nc = src.nchannels();
     float *sum = ALLOCA (float, nc);
     memset (sum, 0, nc*sizeof(float));
     float total_w = 0.0f;
-    for ( ; ! samp.done(); ++samp) {
-        float w = (*filter) (ds_inv*(samp.x()+0.5f-s), dt_inv*(samp.y()+0.5f-t));
-        for (int c = 0; c < nc; ++c)
-            sum[c] += w * samp[c];
-        total_w += w;
+    // Evaluate the filter a row of taps at a time.
+    // Huge footprints (extreme derivatives) go on the heap, not the stack.
+    int nx = xend - xbegin;
+    std::vector<float> heapbuf;
+    float *xpos = nx <= 1024 ? ALLOCA (float, 2*nx)
+                             : (heapbuf.resize (2*nx), &heapbuf[0]);
+    float *w = xpos + nx;
+    for (int i = 0; i < nx; ++i)
+        xpos[i] = ds_inv*(xbegin+i+0.5f-s);
+    for (int y = ybegin; y < yend; ++y) {
+        filter->eval (w, xpos, dt_inv*(y+0.5f-t), nx);
+        for (int i = 0; i < nx; ++i, ++samp) {
+            DASSERT (! samp.done() && samp.x() == xbegin+i && samp.y() == y);
+            for (int c = 0; c < nc; ++c)
+                sum[c] += w[i] * samp[c];
+            total_w += w[i];
+        }
     }
     if (total_w != 0.0f)
         for (int c = 0; c < nc; ++c)
@@ -175,6 +191,162 @@ filtered_sample (const ImageBuf &src, float s, float t,
             result[c] = 0.0f;
 }
 
+
+
+// r[i] += w * p[i] for i in [0,n)
+inline void
+accum_row (float *r, float w, const float *p, int n)
+{
+    int i = 0;
+    simd::float4 W (w);
+    for ( ;  i <= n-4;  i += 4)
+        simd::madd (W, simd::float4(p+i), simd::float4(r+i)).store (r+i);
+    for ( ;  i < n;  ++i)
+        r[i] += w * p[i];
+}
+
+
+
+// Resize with a separable filter as two 1D passes over float rows. Each
+// source row the region needs is fetched once, filtered horizontally into
+// a ring of ytaps rows, and each output row is the weighted sum of the
+// ring rows under its vertical filter.  Source coordinates clamp to the
+// data window, just like the WrapClamp iterators of the general case.
+bool
+resize_separable (ImageBuf &dst, const ImageBuf &src,
+                  const Filter2D *filter, ROI roi)
+{
+    const ImageSpec &srcspec (src.spec());
+    const ImageSpec &dstspec (dst.spec());
+    const int nc = dstspec.nchannels;
+    const int width = roi.width();
+    const int n = width * nc;
+    pvt::ResizeWeights xw (filter, false, roi.xbegin, roi.xend, dstspec.full_x,
+                      dstspec.full_width, srcspec.full_x, srcspec.full_width);
+    pvt::ResizeWeights yw (filter, true, roi.ybegin, roi.yend, dstspec.full_y,
+                      dstspec.full_height, srcspec.full_y, srcspec.full_height);
+
+    // Span of source columns under the filter for the whole region.
+    const int xlo = xw.first.front(), xhi = xw.first.back() + xw.taps;
+    const int sxlo = clamp (xlo, src.xbegin(), src.xend()-1);
+    const int sxhi = clamp (xhi-1, src.xbegin(), src.xend()-1) + 1;
+    std::vector<float> srow ((sxhi-sxlo) * nc);
+    std::vector<float> padded ((xhi-xlo) * nc);
+
+    const int ytaps = yw.taps;
+    std::vector<float> ring (ytaps * n);
+    std::vector<int> ringrow (ytaps, std::numeric_limits<int>::min());
+    std::vector<float> out (n);
+
+    for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+        const float *wy = yw[y-roi.ybegin];
+        int firsty = yw.first[y-roi.ybegin];
+        memset (&out[0], 0, n*sizeof(float));
+        for (int j = 0;  j < ytaps;  ++j) {
+            if (wy[j] == 0.0f)
+                continue;
+            int sy = firsty + j;
+            int slot = ((sy % ytaps) + ytaps) % ytaps;
+            float *h = &ring[slot*n];
+            if (ringrow[slot] != sy) {
+                // Horizontal pass for source row sy
+                int cy = clamp (sy, src.ybegin(), src.yend()-1);
+                src.get_pixels (ROI (sxlo, sxhi, cy, cy+1, 0, 1, 0, nc),
+                                TypeDesc::FLOAT, &srow[0]);
+                for (int x = xlo;  x < xhi;  ++x)
+                    memcpy (&padded[(x-xlo)*nc],
+                            &srow[(clamp (x, sxlo, sxhi-1)-sxlo)*nc],
+                            nc*sizeof(float));
+                for (int x = 0;  x < width;  ++x) {
+                    const float *wx = xw[x];
+                    const float *p = &padded[(xw.first[x]-xlo)*nc];
+                    float *hp = h + x*nc;
+                    if (nc == 4) {
+                        simd::float4 sum (0.0f);
+                        for (int i = 0;  i < xw.taps;  ++i)
+                            sum = simd::madd (simd::float4(wx[i]),
+                                              simd::float4(p+4*i), sum);
+                        sum.store (hp);
+                    } else {
+                        for (int c = 0;  c < nc;  ++c)
+                            hp[c] = 0.0f;
+                        for (int i = 0;  i < xw.taps;  ++i, p += nc)
+                            for (int c = 0;  c < nc;  ++c)
+                                hp[c] += wx[i] * p[c];
+                    }
+                }
+                ringrow[slot] = sy;
+            }
+            // Vertical pass
+            accum_row (&out[0], wy[j], h, n);
+        }
+        dst.set_pixels (ROI (roi.xbegin, roi.xend, y, y+1, 0, 1, 0, nc),
+                        TypeDesc::FLOAT, &out[0]);
+    }
+    return true;
+}
+
+
+
+// Resizing by a 1-pixel box filter to an exact integer fraction of the
+// source resolution just averages k x k blocks of source pixels. For 8 and
+// 16 bit images held in local memory we do that with integer sums and
+// exact rounding, never converting to float.  Return false, having done
+// nothing, if the images or filter are not of that kind.
+template<class T>
+bool
+resize_box_int (ImageBuf &dst, const ImageBuf &src, const Filter2D *filter,
+                ROI roi, int nthreads)
+{
+    const ImageSpec &srcspec (src.spec());
+    const ImageSpec &dstspec (dst.spec());
+    if (srcspec.format != BaseTypeFromC<T>::value ||
+        dstspec.format != srcspec.format ||
+        srcspec.nchannels != dstspec.nchannels ||
+        filter->name() != "box" || filter->width() != 1.0f ||
+        filter->height() != 1.0f || dstspec.full_width < 1 ||
+        dstspec.full_height < 1 ||
+        srcspec.full_width % dstspec.full_width ||
+        srcspec.full_height % dstspec.full_height)
+        return false;
+    const int kx = srcspec.full_width / dstspec.full_width;
+    const int ky = srcspec.full_height / dstspec.full_height;
+    if (kx * ky > 65536)   // the block sums must fit in 32 bits
+        return false;
+    // Source block of output pixel (x,y) starts at (x0+kx*x, y0+ky*y).
+    const int x0 = srcspec.full_x - kx * dstspec.full_x;
+    const int y0 = srcspec.full_y - ky * dstspec.full_y;
+    ROI sroi (x0 + kx*roi.xbegin, x0 + kx*roi.xend,
+              y0 + ky*roi.ybegin, y0 + ky*roi.yend, 0, 1);
+    const ImageBuf &cdst (dst);
+    if (! cdst.localpixels() || ! src.localpixels() ||
+        ! dst.contains_roi (roi) || ! src.contains_roi (sroi))
+        return false;
+    T *dbase = (T *) dst.localpixels();
+    const T *sbase = (const T *) src.localpixels();
+    const int nc = dstspec.nchannels;
+    const uint32_t n = kx * ky;
+    ImageBufAlgo::parallel_image ([&,dbase,sbase](ROI r){
+        std::vector<uint32_t> sum (r.width() * nc);
+        for (int y = r.ybegin;  y < r.yend;  ++y) {
+            std::fill (sum.begin(), sum.end(), 0);
+            for (int j = 0;  j < ky;  ++j) {
+                int sy = y0 + ky*y + j;
+                const T *s = sbase + size_t(src.pixelindex (x0 + kx*r.xbegin, sy, 0)) * nc;
+                uint32_t *out = &sum[0];
+                for (int x = 0, w = r.width();  x < w;  ++x, out += nc)
+                    for (int i = 0;  i < kx;  ++i, s += nc)
+                        for (int c = 0;  c < nc;  ++c)
+                            out[c] += s[c];
+            }
+            T *d = dbase + size_t(dst.pixelindex (r.xbegin, y, 0)) * nc;
+            for (int i = 0, e = r.width() * nc;  i < e;  ++i)
+                d[i] = T ((sum[i] + n/2) / n);
+        }
+    }, roi, nthreads);
+    return true;
+}
+
 } // end anon namespace
 
 
@@ -186,17 +358,25 @@ resize_ (ImageBuf &dst, const ImageBuf &src,
          Filter2D *filter, ROI roi, int nthreads)
 {
     if (nthreads != 1 && roi.npixels() >= 1000) {
-        // Lots of pixels and request for multi threads? Parallelize.
-        ImageBufAlgo::parallel_image (
-            OIIO::bind(resize_<DSTTYPE,SRCTYPE>, OIIO::ref(dst),
-                        OIIO::cref(src), filter,
-                        _1 /*roi*/, 1 /*nthreads*/),
-            roi, nthreads);
+        // Lots of pixels and request for multi threads? Parallelize.  The
+        // separable path reuses filtered rows down a band, so it splits
+        // into bands; the general 2D filter gathers a square footprint
+        // per pixel, which is more cache friendly in tiles.
+        auto f = OIIO::bind(resize_<DSTTYPE,SRCTYPE>, OIIO::ref(dst),
+                            OIIO::cref(src), filter,
+                            _1 /*roi*/, 1 /*nthreads*/);
+        if (filter->separable())
+            ImageBufAlgo::parallel_image (f, roi, nthreads);
+        else
+            ImageBufAlgo::parallel_image (f, roi, nthreads, 64, 64);
         return true;
     }
 
     // Serial case
 
+    if (filter->separable())
+        return resize_separable (dst, src, filter, roi);
+
     const ImageSpec &srcspec (src.spec());
     const ImageSpec &dstspec (dst.spec());
     int nchannels = dstspec.nchannels;
@@ -228,37 +408,6 @@ resize_ (ImageBuf &dst, const ImageBuf &src,
     // will filter the source over [x-radi, x+radi] X [y-radj,y+radj].
     int radi = (int) ceilf (filterrad/xratio);
     int radj = (int) ceilf (filterrad/yratio);
-    int xtaps = 2*radi + 1;
-    int ytaps = 2*radj + 1;
-    bool separable = filter->separable();
-    float *yfiltval = ALLOCA (float, ytaps);
-    float *xfiltval_all = NULL;
-    if (separable) {
-        // For separable filters, horizontal tap weights will be the same
-        // for every column. So we precompute all the tap weights for every
-        // x position we'll need. We do the same thing in y, but row by row
-        // inside the loop (since we never revisit a y row). This
-        // substantially speeds up resize.
-        xfiltval_all = ALLOCA (float, xtaps * roi.width());
-        for (int x = roi.xbegin;  x < roi.xend;  ++x) {
-            float *xfiltval = xfiltval_all + (x-roi.xbegin) * xtaps;
-            float s = (x-dstfx+0.5f)*dstpixelwidth;
-            float src_xf = srcfx + s * srcfw;
-            int src_x;
-            float src_xf_frac = floorfrac (src_xf, &src_x);
-            for (int c = 0;  c < nchannels;  ++c)
-                pel[c] = 0.0f;
-            float totalweight_x = 0.0f;
-            for (int i = 0;  i < xtaps;  ++i) {
-                float w = filter->xfilt (xratio * (i-radi-(src_xf_frac-0.5f)));
-                xfiltval[i] = w;
-                totalweight_x += w;
-            }
-            if (totalweight_x != 0.0f)
-                for (int i = 0;  i < xtaps;  ++i)  // normalize x filter
-                    xfiltval[i] /= totalweight_x;  // weights
-        }
-    }
 
 #if 0
     std::cerr << "Resizing " << srcspec.full_width << "x" << srcspec.full_height
@@ -266,25 +415,7 @@ resize_ (ImageBuf &dst, const ImageBuf &src,
     std::cerr << "ratios = " << xratio << ", " << yratio << "\n";
     std::cerr << "examining src filter " << filter->name()
               << " support radius of " << radi << " x " << radj << " pixels\n";
-    std::cout << "  " << xtaps << "x" << ytaps << " filter taps\n";
     std::cerr << "dst range " << roi << "\n";
-    std::cerr << "separable filter\n";
-#endif
-
-#define USE_SPECIAL 0
-#if USE_SPECIAL
-    // Special case: src and dst are local memory, float buffers, and we're
-    // operating on all channels, <= 4.
-    bool special = 
-       (   (is_same<DSTTYPE,float>::value || is_same<DSTTYPE,half>::value)
-        && (is_same<SRCTYPE,float>::value || is_same<SRCTYPE,half>::value)
-        // && dst.localpixels() // has to be, because it's writeable
-        && src.localpixels()
-        // && R.contains_roi(roi)  // has to be, because IBAPrep
-        && src.contains_roi(roi)
-        && roi.chbegin == 0 && roi.chend == dst.nchannels()
-        && roi.chend == src.nchannels() && roi.chend <= 4
-        && separable);
 #endif
 
     // We're going to loop over all output pixels we're interested in.
@@ -300,114 +431,54 @@ resize_ (ImageBuf &dst, const ImageBuf &src,
     // src_xf_frac and src_yf_frac are the position within that pixel
     //     of our sample.
     //
-    // Separate cases for separable and non-separable filters.
-    if (separable) {
-        ImageBuf::Iterator<DSTTYPE> out (dst, roi);
-        ImageBuf::ConstIterator<SRCTYPE> srcpel (src, ImageBuf::WrapClamp);
-        for (int y = roi.ybegin;  y < roi.yend;  ++y) {
-            float t = (y-dstfy+0.5f)*dstpixelheight;
-            float src_yf = srcfy + t * srcfh;
-            int src_y;
-            float src_yf_frac = floorfrac (src_yf, &src_y);
-            // If using separable filters, our vertical set of filter tap
-            // weights will be the same for the whole scanline we're on.  Just
-            // compute and normalize them once.
-            float totalweight_y = 0.0f;
-            for (int j = 0;  j < ytaps;  ++j) {
-                float w = filter->yfilt (yratio * (j-radj-(src_yf_frac-0.5f)));
-                yfiltval[j] = w;
-                totalweight_y += w;
-            }
-            if (totalweight_y != 0.0f)
-                for (int i = 0;  i < ytaps;  ++i)
-                    yfiltval[i] /= totalweight_y;
-
-            for (int x = roi.xbegin;  x < roi.xend;  ++x, ++out) {
-                float s = (x-dstfx+0.5f)*dstpixelwidth;
-                float src_xf = srcfx + s * srcfw;
-                int src_x = ifloor (src_xf);
-                for (int c = 0;  c < nchannels;  ++c)
-                    pel[c] = 0.0f;
-                const float *xfiltval = xfiltval_all + (x-roi.xbegin) * xtaps;
-                float totalweight_x = 0.0f;
-                for (int i = 0;  i < xtaps;  ++i)
-                    totalweight_x += xfiltval[i];
-                if (totalweight_x != 0.0f) {
-                    srcpel.rerange (src_x-radi, src_x+radi+1,
-                                    src_y-radj, src_y+radj+1,
-                                    0, 1, ImageBuf::WrapClamp);
-                    for (int j = -radj;  j <= radj;  ++j) {
-                        float wy = yfiltval[j+radj];
-                        if (wy == 0.0f) {
-                            // 0 weight for this y tap -- move to next line
-                            srcpel.pos (srcpel.x(), srcpel.y()+1, srcpel.z());
-                            continue;
-                        }
-                        for (int i = 0;  i < xtaps; ++i, ++srcpel) {
-                            float w = wy * xfiltval[i];
-                            if (w)
-                                for (int c = 0;  c < nchannels;  ++c)
-                                    pel[c] += w * srcpel[c];
-                        }
+    // Separable filters were handed off above, so this is the general
+    // non-separable case.
+    ImageBuf::Iterator<DSTTYPE> out (dst, roi);
+    ImageBuf::ConstIterator<SRCTYPE> srcpel (src, ImageBuf::WrapClamp);
+    float *xpos = ALLOCA (float, 2*radi+1);
+    float *w = ALLOCA (float, 2*radi+1);
+    for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+        float t = (y-dstfy+0.5f)*dstpixelheight;
+        float src_yf = srcfy + t * srcfh;
+        int src_y;
+        float src_yf_frac = floorfrac (src_yf, &src_y);
+        for (int x = roi.xbegin;  x < roi.xend;  ++x, ++out) {
+            float s = (x-dstfx+0.5f)*dstpixelwidth;
+            float src_xf = srcfx + s * srcfw;
+            int src_x;
+            float src_xf_frac = floorfrac (src_xf, &src_x);
+            for (int c = 0;  c < nchannels;  ++c)
+                pel[c] = 0.0f;
+            float totalweight = 0.0f;
+            srcpel.rerange (src_x-radi, src_x+radi+1,
+                            src_y-radi, src_y+radi+1,
+                            0, 1, ImageBuf::WrapClamp);
+            for (int i = -radi;  i <= radi;  ++i)
+                xpos[i+radi] = xratio * (i-(src_xf_frac-0.5f));
+            for (int j = -radj;  j <= radj;  ++j) {
+                filter->eval (w, xpos, yratio * (j-(src_yf_frac-0.5f)),
+                              2*radi+1);
+                for (int i = -radi;  i <= radi;  ++i, ++srcpel) {
+                    DASSERT (! srcpel.done());
+                    float wi = w[i+radi];
+                    if (wi) {
+                        totalweight += wi;
+                        for (int c = 0;  c < nchannels;  ++c)
+                            pel[c] += wi * srcpel[c];
                     }
                 }
-                // Copy the pixel value (already normalized) to the output.
-                DASSERT (out.x() == x && out.y() == y);
-                if (totalweight_y == 0.0f) {
-                    // zero it out
-                    for (int c = 0;  c < nchannels;  ++c)
-                        out[c] = 0.0f;
-                } else {
-                    for (int c = 0;  c < nchannels;  ++c)
-                        out[c] = pel[c];
-                }
             }
-        }
-
-    } else {
-        // Non-separable filter
-        ImageBuf::Iterator<DSTTYPE> out (dst, roi);
-        ImageBuf::ConstIterator<SRCTYPE> srcpel (src, ImageBuf::WrapClamp);
-        for (int y = roi.ybegin;  y < roi.yend;  ++y) {
-            float t = (y-dstfy+0.5f)*dstpixelheight;
-            float src_yf = srcfy + t * srcfh;
-            int src_y;
-            float src_yf_frac = floorfrac (src_yf, &src_y);
-            for (int x = roi.xbegin;  x < roi.xend;  ++x, ++out) {
-                float s = (x-dstfx+0.5f)*dstpixelwidth;
-                float src_xf = srcfx + s * srcfw;
-                int src_x;
-                float src_xf_frac = floorfrac (src_xf, &src_x);
+            DASSERT (srcpel.done());
+            // Rescale pel to normalize the filter and write it to the
+            // output image.
+            DASSERT (out.x() == x && out.y() == y);
+            if (totalweight == 0.0f) {
+                // zero it out
                 for (int c = 0;  c < nchannels;  ++c)
-                    pel[c] = 0.0f;
-                float totalweight = 0.0f;
-                srcpel.rerange (src_x-radi, src_x+radi+1,
-                                src_y-radi, src_y+radi+1,
-                                0, 1, ImageBuf::WrapClamp);
-                for (int j = -radj;  j <= radj;  ++j) {
-                    for (int i = -radi;  i <= radi;  ++i, ++srcpel) {
-                        DASSERT (! srcpel.done());
-                        float w = (*filter)(xratio * (i-(src_xf_frac-0.5f)),
-                                            yratio * (j-(src_yf_frac-0.5f)));
-                        if (w) {
-                            totalweight += w;
-                            for (int c = 0;  c < nchannels;  ++c)
-                                pel[c] += w * srcpel[c];
-                        }
-                    }
-                }
-                DASSERT (srcpel.done());
-                // Rescale pel to normalize the filter and write it to the
-                // output image.
-                DASSERT (out.x() == x && out.y() == y);
-                if (totalweight == 0.0f) {
-                    // zero it out
-                    for (int c = 0;  c < nchannels;  ++c)
-                        out[c] = 0.0f;
-                } else {
-                    for (int c = 0;  c < nchannels;  ++c)
-                        out[c] = pel[c] / totalweight;
-                }
+                    out[c] = 0.0f;
+            } else {
+                for (int c = 0;  c < nchannels;  ++c)
+                    out[c] = pel[c] / totalweight;
             }
         }
     }
@@ -443,6 +514,9 @@ ImageBufAlgo::resize (ImageBuf &dst, const ImageBuf &src,
         filterptr.reset (filter);
     }
 
+    if (resize_box_int<uint8_t> (dst, src, filter, roi, nthreads) ||
+        resize_box_int<uint16_t> (dst, src, filter, roi, nthreads))
+        return true;
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2 (ok, "resize", resize_,
                           dst.spec().format, src.spec().format,
@@ -452,6 +526,50 @@ ImageBufAlgo::resize (ImageBuf &dst, const ImageBuf &src,
 
 
 
+// A big reduction through a filter sized for the full ratio gathers
+// hundreds of source taps per output pixel.  Instead, halve the source by
+// 2x2 box averages while it is at least 4x the size of dst, leaving the
+// result in reduced, so the final filter sees a ratio between 2 and 4.
+// Return false, having done nothing, if pre-reduction doesn't apply: it
+// is disabled by the "resize:prereduce" attribute, the source has pixels
+// outside (or missing from) its full window, or roi is only a small part
+// of dst, for which the direct gather is cheaper.
+static bool
+resize_prereduce (ImageBuf &reduced, const ImageBuf &src,
+                  const ImageBuf &dst, ROI roi, int nthreads)
+{
+    const ImageSpec &srcspec (src.spec());
+    const ImageSpec &dstspec (dst.spec());
+    const int dstw = dstspec.full_width, dsth = dstspec.full_height;
+    if (! pvt::oiio_resize_prereduce ||
+        srcspec.full_width < 4*dstw || srcspec.full_height < 4*dsth ||
+        src.roi() != src.roi_full() ||
+        roi.npixels() * 4 < imagesize_t(dstw) * imagesize_t(dsth))
+        return false;
+
+    std::shared_ptr<Filter2D> box (Filter2D::create ("box", 1.0f, 1.0f),
+                                   Filter2D::destroy);
+    ImageBuf tmp[2];
+    const ImageBuf *cur = &src;
+    for (int i = 0;  cur->spec().full_width >= 4*dstw &&
+                     cur->spec().full_height >= 4*dsth;  i ^= 1) {
+        // The reduced image spans the same full window in NDC, which is
+        // all the final resize looks at, so it may as well start at 0.
+        ImageSpec spec (cur->spec().full_width / 2,
+                        cur->spec().full_height / 2,
+                        srcspec.nchannels, TypeDesc::FLOAT);
+        tmp[i].reset (spec);
+        if (! ImageBufAlgo::resize (tmp[i], *cur, box.get(), ROI::All(),
+                                    nthreads))
+            return false;   // fall back to the direct resize
+        cur = &tmp[i];
+    }
+    reduced.swap (*const_cast<ImageBuf *>(cur));
+    return true;
+}
+
+
+
 bool
 ImageBufAlgo::resize (ImageBuf &dst, const ImageBuf &src,
                       string_view filtername_, float fwidth,
@@ -494,10 +612,16 @@ ImageBufAlgo::resize (ImageBuf &dst, const ImageBuf &src,
         return false;
     }
 
+    if (resize_box_int<uint8_t> (dst, src, filter.get(), roi, nthreads) ||
+        resize_box_int<uint16_t> (dst, src, filter.get(), roi, nthreads))
+        return true;
+    ImageBuf reduced;
+    const ImageBuf &s (resize_prereduce (reduced, src, dst, roi, nthreads)
+                       ? reduced : src);
     bool ok;
     OIIO_DISPATCH_COMMON_TYPES2 (ok, "resize", resize_,
-                          dstspec.format, srcspec.format,
-                          dst, src, filter.get(), roi, nthreads);
+                          dstspec.format, s.spec().format,
+                          dst, s, filter.get(), roi, nthreads);
     return ok;
 }
 
@@ -601,7 +725,7 @@ affine_resample_ (ImageBuf &dst, const ImageBuf &src, const Imath::M33f &Minv,
             OIIO::bind(affine_resample_<DSTTYPE,SRCTYPE>,
                         OIIO::ref(dst), OIIO::cref(src), Minv,
                         _1 /*roi*/, 1 /*nthreads*/),
-            roi, nthreads);
+            roi, nthreads, 64, 64);
         return true;
     }
 
@@ -621,6 +745,153 @@ affine_resample_ (ImageBuf &dst, const ImageBuf &src, const Imath::M33f &Minv,
 
 
 
+// Kernels that warp_affine_ evaluates inline rather than through the
+// Filter2D virtual calls.
+enum WarpKernel { WarpGeneric, WarpBilinear, WarpBicubic };
+
+
+
+// Compute the weights, along one axis, of the source pixels under the
+// filter footprint of a sample at s (exactly the pixels and weights that
+// filtered_sample would use): set first to the first pixel and fill in
+// w, returning the number of taps.
+inline int
+warp_axis_weights (const Filter2D *filter, WarpKernel kernel, bool yaxis,
+                   float s, float rad, float d_inv, int &first, float *w)
+{
+    if (kernel == WarpBilinear) {
+        // Unscaled width-2 triangle: the two pixels straddling s.
+        float f = floorfrac (s - 0.5f, &first);
+        w[0] = 1.0f - f;
+        w[1] = f;
+        return 2;
+    }
+    if (kernel == WarpBicubic) {
+        // Unscaled width-4 Catmull-Rom: the four nearest pixels.
+        float f = floorfrac (s - 0.5f, &first);
+        first -= 1;
+        float f2 = f*f, f3 = f*f2;
+        float g = 1.0f-f, g2 = g*g, g3 = g*g2;
+        w[0] = 0.5f * (-f3 + 2.0f*f2 - f);   // catrom1d(1+f) / 2
+        w[1] = 1.5f*f3 - 2.5f*f2 + 1.0f;     // catrom1d(f) / 2
+        w[2] = 1.5f*g3 - 2.5f*g2 + 1.0f;     // catrom1d(1-f) / 2
+        w[3] = 0.5f * (-g3 + 2.0f*g2 - g);   // catrom1d(2-f) / 2
+        return 4;
+    }
+    first = (int) floorf (s-rad);
+    int n = (int) ceilf (s+rad) - first;
+    for (int i = 0; i < n; ++i)
+        w[i] = d_inv * (first+i+0.5f-s);
+    if (yaxis)
+        filter->yfilt (w, w, n);
+    else
+        filter->xfilt (w, w, n);
+    return n;
+}
+
+
+
+// The serial body of warp_ for an affine M and a separable filter.  The
+// filter derivatives are then the same for every pixel, so the footprint
+// size is fixed, the source position can be stepped incrementally along
+// each scanline, and the weights of each sample are just the products of
+// per-axis weights, so we evaluate the filter nx+ny times rather than
+// nx*ny.  Footprints lying inside a local source buffer are read directly
+// from memory; others go through an iterator that honors the wrap mode.
+template<typename DSTTYPE, typename SRCTYPE>
+static bool
+warp_affine_ (ImageBuf &dst, const ImageBuf &src, const Imath::M33f &Minv,
+              const Filter2D *filter, ImageBuf::WrapMode wrap, ROI roi)
+{
+    // Same isotropic footprint as filtered_sample
+    float dsdx = Minv[0][0], dtdx = Minv[0][1];
+    float dsdy = Minv[1][0], dtdy = Minv[1][1];
+    float ds = std::max (1.0f, std::max (fabsf(dsdx), fabsf(dsdy)));
+    float dt = std::max (1.0f, std::max (fabsf(dtdx), fabsf(dtdy)));
+    float ds_inv = 1.0f / ds;
+    float dt_inv = 1.0f / dt;
+    float filterrad_s = 0.5f * ds * filter->width();
+    float filterrad_t = 0.5f * dt * filter->width();
+    WarpKernel xkernel = WarpGeneric, ykernel = WarpGeneric;
+    if (filter->width() == filter->height()) {
+        string_view name = filter->name();
+        WarpKernel k = WarpGeneric;
+        if (name == "triangle" && filter->width() == 2.0f)
+            k = WarpBilinear;
+        else if (name == "catmull-rom" && filter->width() == 4.0f)
+            k = WarpBicubic;
+        xkernel = (ds == 1.0f) ? k : WarpGeneric;
+        ykernel = (dt == 1.0f) ? k : WarpGeneric;
+    }
+
+    int nc = src.nchannels();
+    int maxtaps_s = (int) ceilf (2.0f*filterrad_s) + 2;
+    int maxtaps_t = (int) ceilf (2.0f*filterrad_t) + 2;
+    float *wx = ALLOCA (float, std::max (4, maxtaps_s));
+    float *wy = ALLOCA (float, std::max (4, maxtaps_t));
+    float *sum = ALLOCA (float, nc);
+    float *rowsum = ALLOCA (float, nc);
+
+    const ImageSpec &srcspec (src.spec());
+    bool local = (src.localpixels() != NULL);
+    stride_t xstride = srcspec.pixel_bytes();
+    stride_t ystride = srcspec.scanline_bytes();
+
+    ImageBuf::Iterator<DSTTYPE> out (dst, roi);
+    for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+        // Step from the row start by multiples of the derivatives rather
+        // than accumulating, which would drift on long scanlines.
+        float s0 = (roi.xbegin+0.5f) * dsdx + (y+0.5f) * dsdy + Minv[2][0];
+        float t0 = (roi.xbegin+0.5f) * dtdx + (y+0.5f) * dtdy + Minv[2][1];
+        for (int x = roi.xbegin;  x < roi.xend;  ++x) {
+            float s = s0 + (x-roi.xbegin) * dsdx;
+            float t = t0 + (x-roi.xbegin) * dtdx;
+            int x0, y0;
+            int nx = warp_axis_weights (filter, xkernel, false, s,
+                                        filterrad_s, ds_inv, x0, wx);
+            int ny = warp_axis_weights (filter, ykernel, true, t,
+                                        filterrad_t, dt_inv, y0, wy);
+            float total_w = 0.0f, wxsum = 0.0f;
+            for (int i = 0; i < nx; ++i)
+                wxsum += wx[i];
+            for (int j = 0; j < ny; ++j)
+                total_w += wy[j];
+            total_w *= wxsum;
+            memset (sum, 0, nc*sizeof(float));
+            if (local && x0 >= srcspec.x && x0+nx <= srcspec.x+srcspec.width &&
+                         y0 >= srcspec.y && y0+ny <= srcspec.y+srcspec.height) {
+                const char *row = (const char *) src.pixeladdr (x0, y0, 0);
+                for (int j = 0; j < ny; ++j, row += ystride) {
+                    memset (rowsum, 0, nc*sizeof(float));
+                    const char *p = row;
+                    for (int i = 0; i < nx; ++i, p += xstride) {
+                        const SRCTYPE *v = (const SRCTYPE *) p;
+                        for (int c = 0; c < nc; ++c)
+                            rowsum[c] += wx[i] * convert_type<SRCTYPE,float>(v[c]);
+                    }
+                    for (int c = 0; c < nc; ++c)
+                        sum[c] += wy[j] * rowsum[c];
+                }
+            } else {
+                ImageBuf::ConstIterator<SRCTYPE> samp (src, x0, x0+nx,
+                                                       y0, y0+ny, 0, 1, wrap);
+                for ( ; ! samp.done(); ++samp) {
+                    float w = wx[samp.x()-x0] * wy[samp.y()-y0];
+                    for (int c = 0; c < nc; ++c)
+                        sum[c] += w * samp[c];
+                }
+            }
+            float scale = (total_w != 0.0f) ? 1.0f / total_w : 0.0f;
+            for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                out[c] = sum[c] * scale;
+            ++out;
+        }
+    }
+    return true;
+}
+
+
+
 template<typename DSTTYPE, typename SRCTYPE>
 static bool
 warp_ (ImageBuf &dst, const ImageBuf &src, const Imath::M33f &M,
@@ -628,20 +899,26 @@ warp_ (ImageBuf &dst, const ImageBuf &src, const Imath::M33f &M,
        ROI roi, int nthreads)
 {
     if (nthreads != 1 && roi.npixels() >= 1000) {
-        // Possible multiple thread case -- recurse via parallel_image
+        // Possible multiple thread case -- recurse via parallel_image, in
+        // tiles, since the source footprint of a warp is only coherent in
+        // 2D and its cost varies with the local scale of the transform.
         ImageBufAlgo::parallel_image (
             OIIO::bind(warp_<DSTTYPE,SRCTYPE>,
                         OIIO::ref(dst), OIIO::cref(src), M,
                         filter, wrap, _1 /*roi*/, 1 /*nthreads*/),
-            roi, nthreads);
+            roi, nthreads, 64, 64);
         return true;
     }
 
     // Serial case
+    Imath::M33f Minv = M.inverse();
+    if (Minv[0][2] == 0.0f && Minv[1][2] == 0.0f && Minv[2][2] == 1.0f &&
+        filter->separable() && roi.depth() == 1)
+        return warp_affine_<DSTTYPE,SRCTYPE> (dst, src, Minv, filter,
+                                              wrap, roi);
     int nc = dst.nchannels();
     float *pel = ALLOCA (float, nc);
     memset (pel, 0, nc*sizeof(float));
-    Imath::M33f Minv = M.inverse();
     ImageBuf::Iterator<DSTTYPE> out (dst, roi);
     for (  ;  ! out.done();  ++out) {
         Dual2 x (out.x()+0.5f, 1.0f, 0.0f);
@@ -730,6 +1007,323 @@ ImageBufAlgo::warp (ImageBuf &dst, const ImageBuf &src,
 
 
 
+// Is pixel (x,y) within the x and y range of roi?
+inline bool
+roi_contains (const ROI &roi, int x, int y)
+{
+    return x >= roi.xbegin && x < roi.xend && y >= roi.ybegin && y < roi.yend;
+}
+
+
+
+// One st_warp lookup: the src position and footprint of a dst pixel.
+struct STLookup {
+    float s, t;              // src image space position
+    float ds_inv, dt_inv;    // footprint scale
+    float rad_s, rad_t;      // footprint radius
+    bool inside;             // does the footprint touch the src window?
+};
+
+
+
+// Warp the pixels of one block of dst by the STMap.  First the STMap
+// values of the block (plus a one pixel border, for their derivatives)
+// are fetched, giving every pixel's lookup position and footprint; then
+// the part of src under all of the block's footprints is fetched as float
+// with a single get_pixels, so that an ImageCache-backed src is read
+// coherently, and each lookup gathers straight from that buffer.  A block
+// whose lookups are scattered too widely over src is split in four.
+template<typename DSTTYPE>
+static void
+st_warp_block (ImageBuf &dst, const ImageBuf &src, const ImageBuf &stbuf,
+               const Filter2D *filter, int chan_s, int chan_t,
+               bool flip_s, bool flip_t, ROI block)
+{
+    int bw = block.width(), bh = block.height();
+    int stch0 = std::min (chan_s, chan_t);
+    int stnc = std::max (chan_s, chan_t) + 1 - stch0;
+    ROI stroi = roi_intersection (ROI (block.xbegin-1, block.xend+1,
+                                       block.ybegin-1, block.yend+1,
+                                       block.zbegin, block.zbegin+1,
+                                       stch0, stch0+stnc),
+                                  stbuf.roi());
+    std::vector<float> st;
+    if (stroi.npixels()) {
+        st.resize (stroi.npixels() * stnc);
+        stbuf.get_pixels (stroi, TypeDesc::FLOAT, &st[0]);
+    }
+    ROI srcfull = src.roi_full();
+    ROI srcroi = src.roi();
+    // Position of the STMap lookup at (x,y), in src image space
+    auto lookup = [&](int x, int y, float &s, float &t) {
+        const float *v = &st[((y-stroi.ybegin)*stroi.width()
+                              + (x-stroi.xbegin)) * stnc];
+        s = v[chan_s-stch0];
+        t = v[chan_t-stch0];
+        s = srcfull.xbegin + (flip_s ? 1.0f-s : s) * srcfull.width();
+        t = srcfull.ybegin + (flip_t ? 1.0f-t : t) * srcfull.height();
+    };
+
+    WarpKernel kernel = WarpGeneric;
+    if (filter->width() == filter->height()) {
+        if (filter->name() == "triangle" && filter->width() == 2.0f)
+            kernel = WarpBilinear;
+        else if (filter->name() == "catmull-rom" && filter->width() == 4.0f)
+            kernel = WarpBicubic;
+    }
+    bool separable = filter->separable();
+
+    // Pass 1: the lookups, and the bounds of the src region under them.
+    std::vector<STLookup> lookups (imagesize_t(bw) * bh);
+    ROI fetch (std::numeric_limits<int>::max(), std::numeric_limits<int>::min(),
+               std::numeric_limits<int>::max(), std::numeric_limits<int>::min(),
+               block.zbegin, block.zbegin+1, block.chbegin, block.chend);
+    int maxtaps = 4;
+    float maxscale = float (std::max (srcfull.width(), srcfull.height()));
+    for (int y = block.ybegin;  y < block.yend;  ++y) {
+        for (int x = block.xbegin;  x < block.xend;  ++x) {
+            STLookup &L (lookups[(y-block.ybegin)*bw + (x-block.xbegin)]);
+            L.inside = false;
+            if (! roi_contains (stroi, x, y))
+                continue;
+            lookup (x, y, L.s, L.t);
+            int xl = roi_contains (stroi, x-1, y) ? x-1 : x;
+            int xr = roi_contains (stroi, x+1, y) ? x+1 : x;
+            int yl = roi_contains (stroi, x, y-1) ? y-1 : y;
+            int yr = roi_contains (stroi, x, y+1) ? y+1 : y;
+            float s0, t0, s1, t1;
+            float dsdx = 0.0f, dtdx = 0.0f, dsdy = 0.0f, dtdy = 0.0f;
+            if (xr > xl) {
+                lookup (xl, y, s0, t0);
+                lookup (xr, y, s1, t1);
+                dsdx = (s1 - s0) / (xr - xl);
+                dtdx = (t1 - t0) / (xr - xl);
+            }
+            if (yr > yl) {
+                lookup (x, yl, s0, t0);
+                lookup (x, yr, s1, t1);
+                dsdy = (s1 - s0) / (yr - yl);
+                dtdy = (t1 - t0) / (yr - yl);
+            }
+            // Same isotropic footprint as filtered_sample, but no bigger
+            // than src itself (STMaps may have seams where they jump).
+            float ds = std::max (1.0f, std::max (fabsf(dsdx), fabsf(dsdy)));
+            float dt = std::max (1.0f, std::max (fabsf(dtdx), fabsf(dtdy)));
+            ds = std::min (ds, maxscale);
+            dt = std::min (dt, maxscale);
+            L.ds_inv = 1.0f / ds;
+            L.dt_inv = 1.0f / dt;
+            L.rad_s = 0.5f * ds * filter->width();
+            L.rad_t = 0.5f * dt * filter->width();
+            float x0 = floorf (L.s - L.rad_s), x1 = ceilf (L.s + L.rad_s);
+            float y0 = floorf (L.t - L.rad_t), y1 = ceilf (L.t + L.rad_t);
+            // Footprints entirely off of src (or NaN) just give black
+            if (! (std::isfinite(L.s) && std::isfinite(L.t) &&
+                   x1 > srcroi.xbegin && x0 < srcroi.xend &&
+                   y1 > srcroi.ybegin && y0 < srcroi.yend))
+                continue;
+            L.inside = true;
+            fetch.xbegin = std::min (fetch.xbegin, int(x0));
+            fetch.xend   = std::max (fetch.xend,   int(x1));
+            fetch.ybegin = std::min (fetch.ybegin, int(y0));
+            fetch.yend   = std::max (fetch.yend,   int(y1));
+            maxtaps = std::max (maxtaps, int(std::max (x1-x0, y1-y0)) + 1);
+        }
+    }
+    if (fetch.xbegin < fetch.xend)
+        fetch = roi_intersection (fetch, srcroi);
+    else
+        fetch.xend = fetch.xbegin;   // nothing to fetch
+    if (fetch.npixels() > std::max (imagesize_t(16*1024),
+                                    16 * imagesize_t(bw) * bh) &&
+            (bw > 1 || bh > 1)) {
+        int xmid = block.xbegin + (bw+1)/2, ymid = block.ybegin + (bh+1)/2;
+        ROI sub[4] = { block, block, block, block };
+        sub[0].xend = sub[2].xend = xmid;
+        sub[1].xbegin = sub[3].xbegin = xmid;
+        sub[0].yend = sub[1].yend = ymid;
+        sub[2].ybegin = sub[3].ybegin = ymid;
+        for (auto &r : sub)
+            if (r.npixels())
+                st_warp_block<DSTTYPE> (dst, src, stbuf, filter, chan_s,
+                                        chan_t, flip_s, flip_t, r);
+        return;
+    }
+
+    // Pass 2: gather each lookup from the fetched src region.
+    int nc = block.nchannels();
+    int fw = std::max (0, fetch.width());
+    std::vector<float> buf (std::max (imagesize_t(1), fetch.npixels() * nc));
+    if (fetch.npixels())
+        src.get_pixels (fetch, TypeDesc::FLOAT, &buf[0]);
+    std::vector<float> wxbuf (maxtaps), wybuf (maxtaps);
+    float *wx = &wxbuf[0], *wy = &wybuf[0];
+    float *sum = ALLOCA (float, nc);
+    float *rowsum = ALLOCA (float, nc);
+    ImageBuf::Iterator<DSTTYPE> out (dst, block);
+    for (int i = 0;  ! out.done();  ++out, ++i) {
+        const STLookup &L (lookups[i]);
+        memset (sum, 0, nc*sizeof(float));
+        float total_w = 0.0f;
+        if (L.inside && separable) {
+            int x0, y0;
+            int nx = warp_axis_weights (filter,
+                                        L.ds_inv == 1.0f ? kernel : WarpGeneric,
+                                        false, L.s, L.rad_s, L.ds_inv, x0, wx);
+            int ny = warp_axis_weights (filter,
+                                        L.dt_inv == 1.0f ? kernel : WarpGeneric,
+                                        true, L.t, L.rad_t, L.dt_inv, y0, wy);
+            float wxsum = 0.0f;
+            for (int k = 0; k < nx; ++k)
+                wxsum += wx[k];
+            for (int k = 0; k < ny; ++k)
+                total_w += wy[k];
+            total_w *= wxsum;
+            // Taps outside the fetched region are black but still count
+            // toward the total weight.
+            int ib = std::max (0, fetch.xbegin-x0), ie = std::min (nx, fetch.xend-x0);
+            int jb = std::max (0, fetch.ybegin-y0), je = std::min (ny, fetch.yend-y0);
+            for (int j = jb;  j < je;  ++j) {
+                memset (rowsum, 0, nc*sizeof(float));
+                const float *p = &buf[((y0+j-fetch.ybegin)*fw
+                                       + (x0+ib-fetch.xbegin)) * nc];
+                for (int k = ib;  k < ie;  ++k, p += nc)
+                    accum_row (rowsum, wx[k], p, nc);
+                accum_row (sum, wy[j], rowsum, nc);
+            }
+        } else if (L.inside) {
+            int x0 = (int) floorf (L.s - L.rad_s);
+            int x1 = (int) ceilf (L.s + L.rad_s);
+            int y0 = (int) floorf (L.t - L.rad_t);
+            int y1 = (int) ceilf (L.t + L.rad_t);
+            // Reuse the (here otherwise unused) axis weight buffers for a
+            // row of tap positions and their weights.
+            int nx = x1 - x0;
+            float *xpos = wy, *w = wx;
+            for (int x = x0;  x < x1;  ++x)
+                xpos[x-x0] = L.ds_inv*(x+0.5f-L.s);
+            for (int y = y0;  y < y1;  ++y) {
+                filter->eval (w, xpos, L.dt_inv*(y+0.5f-L.t), nx);
+                for (int x = x0;  x < x1;  ++x) {
+                    total_w += w[x-x0];
+                    if (roi_contains (fetch, x, y))
+                        accum_row (sum, w[x-x0], &buf[((y-fetch.ybegin)*fw
+                                                 + (x-fetch.xbegin)) * nc], nc);
+                }
+            }
+        }
+        float scale = (total_w != 0.0f) ? 1.0f / total_w : 0.0f;
+        for (int c = block.chbegin;  c < block.chend;  ++c)
+            out[c] = sum[c-block.chbegin] * scale;
+    }
+}
+
+
+
+template<typename DSTTYPE>
+static bool
+st_warp_ (ImageBuf &dst, const ImageBuf &src, const ImageBuf &stbuf,
+          const Filter2D *filter, int chan_s, int chan_t,
+          bool flip_s, bool flip_t, ROI roi, int nthreads)
+{
+    if (nthreads != 1 && roi.npixels() >= 1000) {
+        // Possible multiple thread case -- recurse via parallel_image
+        ImageBufAlgo::parallel_image ([&](ROI r) {
+                st_warp_<DSTTYPE> (dst, src, stbuf, filter, chan_s, chan_t,
+                                   flip_s, flip_t, r, 1);
+            }, roi, nthreads, 64, 64);
+        return true;
+    }
+
+    // Serial case: work in square blocks, for coherence of the lookups
+    const int blocksize = 32;
+    for (int y = roi.ybegin;  y < roi.yend;  y += blocksize) {
+        for (int x = roi.xbegin;  x < roi.xend;  x += blocksize) {
+            ROI block (x, std::min (x+blocksize, roi.xend),
+                       y, std::min (y+blocksize, roi.yend),
+                       roi.zbegin, roi.zend, roi.chbegin, roi.chend);
+            st_warp_block<DSTTYPE> (dst, src, stbuf, filter, chan_s, chan_t,
+                                    flip_s, flip_t, block);
+        }
+    }
+    return true;
+}
+
+
+
+bool
+ImageBufAlgo::st_warp (ImageBuf &dst, const ImageBuf &src,
+                       const ImageBuf &stbuf, const Filter2D *filter,
+                       int chan_s, int chan_t, bool flip_s, bool flip_t,
+                       ROI roi, int nthreads)
+{
+    if (chan_s < 0 || chan_s >= stbuf.nchannels() ||
+        chan_t < 0 || chan_t >= stbuf.nchannels()) {
+        dst.error ("st_warp: STMap channels %d and %d are not both in the "
+                   "%d-channel STMap image", chan_s, chan_t, stbuf.nchannels());
+        return false;
+    }
+    bool newdst = ! dst.initialized();
+    if (newdst && ! roi.defined()) {
+        roi = stbuf.roi();
+        roi.chbegin = 0;
+        roi.chend = src.nchannels();
+    }
+    if (! IBAprep (roi, &dst, &src,
+                   IBAprep_NO_SUPPORT_VOLUME | IBAprep_NO_COPY_ROI_FULL))
+        return false;
+    if (newdst)
+        set_roi_full (dst.specmod(), stbuf.roi_full());
+    roi.chend = std::min (roi.chend, src.nchannels());
+
+    // Set up a shared pointer with custom deleter to make sure any
+    // filter we allocate here is properly destroyed.
+    std::shared_ptr<Filter2D> filterptr ((Filter2D*)NULL, Filter2D::destroy);
+    if (filter == NULL) {
+        filterptr.reset (Filter2D::create ("lanczos3", 6.0f, 6.0f));
+        filter = filterptr.get();
+    }
+
+    bool ok;
+    OIIO_DISPATCH_TYPES (ok, "st_warp", st_warp_, dst.spec().format,
+                         dst, src, stbuf, filter, chan_s, chan_t,
+                         flip_s, flip_t, roi, nthreads);
+    return ok;
+}
+
+
+
+bool
+ImageBufAlgo::st_warp (ImageBuf &dst, const ImageBuf &src,
+                       const ImageBuf &stbuf,
+                       string_view filtername_, float filterwidth,
+                       int chan_s, int chan_t, bool flip_s, bool flip_t,
+                       ROI roi, int nthreads)
+{
+    // Set up a shared pointer with custom deleter to make sure any
+    // filter we allocate here is properly destroyed.
+    std::shared_ptr<Filter2D> filter ((Filter2D*)NULL, Filter2D::destroy);
+    std::string filtername = filtername_.size() ? filtername_ : "lanczos3";
+    for (int i = 0, e = Filter2D::num_filters();  i < e;  ++i) {
+        FilterDesc fd;
+        Filter2D::get_filterdesc (i, &fd);
+        if (fd.name == filtername) {
+            float w = filterwidth > 0.0f ? filterwidth : fd.width;
+            filter.reset (Filter2D::create (filtername, w, w));
+            break;
+        }
+    }
+    if (! filter) {
+        dst.error ("Filter \"%s\" not recognized", filtername);
+        return false;
+    }
+
+    return st_warp (dst, src, stbuf, filter.get(), chan_s, chan_t,
+                    flip_s, flip_t, roi, nthreads);
+}
+
+
+
 bool
 ImageBufAlgo::rotate (ImageBuf &dst, const ImageBuf &src,
                       float angle, float center_x, float center_y,
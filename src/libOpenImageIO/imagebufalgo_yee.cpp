@@ -34,6 +34,7 @@
 
 #include <iostream>
 #include <cmath>
+#include <memory>
 
 #include <OpenEXR/ImathFun.h>
 #include <OpenEXR/ImathColor.h>
@@ -44,6 +45,8 @@ using Imath::Color3f;
 #include "OpenImageIO/imagebufalgo.h"
 #include "OpenImageIO/imagebufalgo_util.h"
 #include "OpenImageIO/dassert.h"
+#include "OpenImageIO/hash.h"
+#include "OpenImageIO/thread.h"
 
 
 template<class T>
@@ -67,13 +70,16 @@ namespace
 class GaussianPyramid
 {
 public:
-    GaussianPyramid (ImageBuf &image)
+    GaussianPyramid (ImageBuf &image, int nthreads = 0)
     {
         level[0].swap (image);  // swallow the source as the top level
         ImageBuf kernel;
         ImageBufAlgo::make_kernel (kernel, "gaussian", 5, 5);
+        // N.B. convolve finds the gaussian separable, so each level is
+        // two SIMD 1D passes, threaded over the scanlines.
         for (int i = 1;  i < PYRAMID_MAX_LEVELS;  ++i)
-            ImageBufAlgo::convolve (level[i], level[i-1], kernel);
+            ImageBufAlgo::convolve (level[i], level[i-1], kernel, true,
+                                    ROI::All(), nthreads);
     }
 
     ~GaussianPyramid () { }
@@ -95,6 +101,12 @@ public:
         return level[lev].getchannel(x,y,0,1);
     }
 
+    /// The (float, single channel, 0-origin) pixels of a level.
+    const float *pixels (int lev) const {
+        DASSERT (lev < PYRAMID_MAX_LEVELS);
+        return (const float *) level[lev].localpixels();
+    }
+
 private:
     ImageBuf level[PYRAMID_MAX_LEVELS];
 };
@@ -189,14 +201,21 @@ XYZToLAB (ImageBuf &A, ROI roi, int nthreads)
 
 
 
-// Contrast sensitivity function (Barten SPIE 1989)
+// Contrast sensitivity function (Barten SPIE 1989), given the a and b
+// terms that depend only on the luminance.
+inline float
+contrast_sensitivity (float cyclesperdegree, float a, float b)
+{
+    return a * cyclesperdegree * expf(-b * cyclesperdegree) 
+             * sqrtf(1.0f + 0.06f * expf(b * cyclesperdegree)); 
+}
+
 static float
 contrast_sensitivity (float cyclesperdegree, float luminance)
 {
     float a = 440.0f * powf ((1.0f + 0.7f / luminance), -0.2f);
     float b = 0.3f * powf ((1.0f + 100.0f / luminance), 0.15f);
-    return a * cyclesperdegree * expf(-b * cyclesperdegree) 
-             * sqrtf(1.0f + 0.06f * expf(b * cyclesperdegree)); 
+    return contrast_sensitivity (cyclesperdegree, a, b);
 }
 
 
@@ -237,6 +256,65 @@ tvi (float adaptation_luminance)
 }
 
 
+
+// One image made ready for the comparison: its LAB pixels and the
+// Gaussian pyramid of its luminance, along with what it was made from.
+struct YeeImage {
+    uint64_t hash;          // of the pasted float RGB pixels
+    int width, height;
+    float luminance;
+    ImageBuf LAB;
+    std::unique_ptr<GaussianPyramid> pyramid;
+};
+
+
+
+// Comparing one reference against many candidates shouldn't rebuild the
+// reference's pyramid every time, so we hold on to the last first image
+// we prepared, and reuse it for either image if the pixels match.
+static spin_mutex yee_cache_mutex;
+static std::shared_ptr<YeeImage> yee_cache;
+
+
+
+static std::shared_ptr<YeeImage>
+yee_prepare (const ImageBuf &img, ROI roi, float luminance, int nthreads)
+{
+    // paste() to copy of up to 3 channels, converting to float, and
+    // ending up with a 0-origin image.  End up with an LAB image in
+    // LAB, and a luminance image in the pyramid.
+    ImageSpec spec (roi.width(), roi.height(), 3 /*chans*/, TypeDesc::FLOAT);
+    std::shared_ptr<YeeImage> y (new YeeImage);
+    y->LAB.reset (spec);
+    ImageBufAlgo::paste (y->LAB, 0, 0, 0, 0, img, roi, nthreads);
+    y->hash = farmhash::Hash ((const char *)y->LAB.localpixels(),
+                              spec.image_bytes());
+    y->width = spec.width;
+    y->height = spec.height;
+    y->luminance = luminance;
+    {
+        spin_lock lock (yee_cache_mutex);
+        if (yee_cache && yee_cache->hash == y->hash &&
+              yee_cache->width == y->width && yee_cache->height == y->height &&
+              yee_cache->luminance == luminance)
+            return yee_cache;
+    }
+
+    // assuming colorspaces are in Adobe RGB (1998), convert to LAB
+    AdobeRGBToXYZ (y->LAB, ROI::All(), nthreads);  // contains XYZ now
+    ImageBuf Lum;
+    int channelorder[] = { 1 };  // channel to copy
+    ImageBufAlgo::channels (Lum, y->LAB, 1, channelorder);
+    ImageBufAlgo::mul (Lum, Lum, luminance, ROI::All(), nthreads);
+    XYZToLAB (y->LAB, ROI::All(), nthreads);  // now it's LAB
+
+    // Construct Gaussian pyramids (not really pyramids, because they all
+    // have the same resolution, but really just a bunch of successively
+    // more blurred images).
+    y->pyramid.reset (new GaussianPyramid (Lum, nthreads));
+    return y;
+}
+
 }
 
 
@@ -255,39 +333,21 @@ ImageBufAlgo::compare_Yee (const ImageBuf &img0, const ImageBuf &img1,
     result.maxx=0, result.maxy=0, result.maxz=0, result.maxc=0;
     result.nfail = 0, result.nwarn = 0;
 
-    int nscanlines = roi.height() * roi.depth();
-
     bool luminanceOnly = false;
 
-    // assuming colorspaces are in Adobe RGB (1998), convert to LAB
-
-    // paste() to copy of up to 3 channels, converting to float, and
-    // ending up with a 0-origin image.  End up with an LAB image in
-    // aLAB, and a luminance image in aLum.
-    ImageSpec spec (roi.width(), roi.height(), 3 /*chans*/, TypeDesc::FLOAT);
-    ImageBuf aLAB (spec);
-    ImageBufAlgo::paste (aLAB, 0, 0, 0, 0, img0, roi, nthreads);
-    AdobeRGBToXYZ (aLAB, ROI::All(), nthreads);  // contains XYZ now
-    ImageBuf aLum;
-    int channelorder[] = { 1 };  // channel to copy
-    ImageBufAlgo::channels (aLum, aLAB, 1, channelorder);
-    ImageBufAlgo::mul (aLum, aLum, luminance, ROI::All(), nthreads);
-    XYZToLAB (aLAB, ROI::All(), nthreads);  // now it's LAB
-
-    // Same thing for img1/bLAB/bLum
-    ImageBuf bLAB (spec);
-    ImageBufAlgo::paste (bLAB, 0, 0, 0, 0, img1, roi, nthreads);
-    AdobeRGBToXYZ (bLAB, ROI::All(), nthreads);  // contains XYZ now
-    ImageBuf bLum;
-    ImageBufAlgo::channels (bLum, bLAB, 1, channelorder);
-    ImageBufAlgo::mul (bLum, bLum, luminance, ROI::All(), nthreads);
-    XYZToLAB (bLAB, ROI::All(), nthreads);  // now it's LAB
-
-    // Construct Gaussian pyramids (not really pyramids, because they all
-    // have the same resolution, but really just a bunch of successively
-    // more blurred images).
-    GaussianPyramid la (aLum);
-    GaussianPyramid lb (bLum);
+    std::shared_ptr<YeeImage> A = yee_prepare (img0, roi, luminance, nthreads);
+    std::shared_ptr<YeeImage> B = yee_prepare (img1, roi, luminance, nthreads);
+    {
+        // Keep the first image for next time, unless it was the second
+        // that we found already prepared.
+        spin_lock lock (yee_cache_mutex);
+        if (B != yee_cache)
+            yee_cache = A;
+    }
+    const GaussianPyramid &la (*A->pyramid);
+    const GaussianPyramid &lb (*B->pyramid);
+    const float *aLAB = (const float *) A->LAB.localpixels();
+    const float *bLAB = (const float *) B->LAB.localpixels();
 
     float num_one_degree_pixels = (float) (2 * tan(fov * 0.5 * M_PI / 180) * 180 / M_PI);
     float pixels_per_degree = roi.width() / num_one_degree_pixels;
@@ -308,66 +368,102 @@ ImageBufAlgo::compare_Yee (const ImageBuf &img0, const ImageBuf &img1,
     for (int i = 0; i < PYRAMID_MAX_LEVELS - 2;  ++i)
         F_freq[i] = csf_max / contrast_sensitivity (cpd[i], 100.0f);
 
-    for (int y = 0; y < nscanlines;  ++y) {
-        for (int x = 0;  x < roi.width();  ++x) {
-            float contrast[PYRAMID_MAX_LEVELS - 2];
-            float sum_contrast = 0;
-            for (int i = 0; i < PYRAMID_MAX_LEVELS - 2; i++) {
-                float n1 = fabsf (la.value(x,y,i) - la.value(x,y,i+1));
-                float n2 = fabsf (lb.value(x,y,i) - lb.value(x,y,i+1));
-                float numerator = std::max (n1, n2);
-                float d1 = fabsf (la.value(x,y,i+2));
-                float d2 = fabsf (lb.value(x,y,i+2));
-                float denominator = std::max (std::max (d1, d2), 1.0e-5f);
-                contrast[i] = numerator / denominator;
-                sum_contrast += contrast[i];
-            }
-            if (sum_contrast < 1e-5)
-                sum_contrast = 1e-5f;
-            float F_mask[PYRAMID_MAX_LEVELS - 2];
-            float adapt = la.value(x,y,adaptation_level) + lb.value(x,y,adaptation_level);
-            adapt *= 0.5f;
-            if (adapt < 1e-5)
-                adapt = 1e-5f;
-            for (int i = 0; i < PYRAMID_MAX_LEVELS - 2; i++)
-                F_mask[i] = mask(contrast[i] * contrast_sensitivity(cpd[i], adapt)); 
-            float factor = 0;
-            for (int i = 0; i < PYRAMID_MAX_LEVELS - 2; i++)
-                factor += contrast[i] * F_freq[i] * F_mask[i] / sum_contrast;
-            factor = Imath::clamp (factor, 1.0f, 10.0f);
-            float delta = fabsf (la.value(x,y,0) - lb.value(x,y,0));
-            bool pass = true;
-            // pure luminance test
-            delta /= tvi(adapt);
-            if (delta > factor) {
-                pass = false;
-            } else if (! luminanceOnly) {
-                // CIE delta E test with modifications
-                float color_scale = 1.0f;
-                // ramp down the color test in scotopic regions
-                if (adapt < 10.0f) {
-                    color_scale = 1.0f - (10.0f - color_scale) / 10.0f;
-                    color_scale = color_scale * color_scale;
+    // The images hold just the rows of one z plane, so rows beyond
+    // those (of a volume roi) are zero in both, and always pass.
+    int width = A->width;
+    spin_mutex result_mutex;
+    ImageBufAlgo::parallel_image ([&](ROI r) {
+        imagesize_t nfail = 0;
+        float maxerror = 0.0f;
+        int maxx = 0, maxy = 0;
+        const float *levels_a[PYRAMID_MAX_LEVELS], *levels_b[PYRAMID_MAX_LEVELS];
+        for (int i = 0;  i < PYRAMID_MAX_LEVELS;  ++i) {
+            levels_a[i] = la.pixels(i);
+            levels_b[i] = lb.pixels(i);
+        }
+        for (int y = r.ybegin;  y < r.yend;  ++y) {
+            for (int x = 0;  x < width;  ++x) {
+                size_t p = size_t(y) * width + x;
+                float va[PYRAMID_MAX_LEVELS], vb[PYRAMID_MAX_LEVELS];
+                for (int i = 0;  i < PYRAMID_MAX_LEVELS;  ++i) {
+                    va[i] = levels_a[i][p];
+                    vb[i] = levels_b[i][p];
+                }
+                float contrast[PYRAMID_MAX_LEVELS - 2];
+                float sum_contrast = 0;
+                for (int i = 0; i < PYRAMID_MAX_LEVELS - 2; i++) {
+                    float n1 = fabsf (va[i] - va[i+1]);
+                    float n2 = fabsf (vb[i] - vb[i+1]);
+                    float numerator = std::max (n1, n2);
+                    float d1 = fabsf (va[i+2]);
+                    float d2 = fabsf (vb[i+2]);
+                    float denominator = std::max (std::max (d1, d2), 1.0e-5f);
+                    contrast[i] = numerator / denominator;
+                    sum_contrast += contrast[i];
                 }
-                float da = aLAB.getchannel(x,y,0,1) - bLAB.getchannel(x,y,0,1);  // diff in A
-                float db = aLAB.getchannel(x,y,0,2) - bLAB.getchannel(x,y,0,2);  // diff in B
-                da = da * da;
-                db = db * db;
-                delta = (da + db) * color_scale;
-                if (delta > factor)
+                if (sum_contrast < 1e-5)
+                    sum_contrast = 1e-5f;
+                float F_mask[PYRAMID_MAX_LEVELS - 2];
+                float adapt = va[adaptation_level] + vb[adaptation_level];
+                adapt *= 0.5f;
+                if (adapt < 1e-5)
+                    adapt = 1e-5f;
+                // The luminance-dependent terms of the CSF, once per pixel
+                // rather than once per level.
+                float csf_a = 440.0f * powf ((1.0f + 0.7f / adapt), -0.2f);
+                float csf_b = 0.3f * powf ((1.0f + 100.0f / adapt), 0.15f);
+                for (int i = 0; i < PYRAMID_MAX_LEVELS - 2; i++)
+                    F_mask[i] = mask(contrast[i] * contrast_sensitivity(cpd[i], csf_a, csf_b)); 
+                float factor = 0;
+                for (int i = 0; i < PYRAMID_MAX_LEVELS - 2; i++)
+                    factor += contrast[i] * F_freq[i] * F_mask[i] / sum_contrast;
+                factor = Imath::clamp (factor, 1.0f, 10.0f);
+                float delta = fabsf (va[0] - vb[0]);
+                bool pass = true;
+                // pure luminance test
+                delta /= tvi(adapt);
+                if (delta > factor) {
                     pass = false;
-            }
-            if (!pass) {
-                ++result.nfail;
-                if (factor > result.maxerror) {
-                    result.maxerror = factor;
-                    result.maxx = x;
-                    result.maxy = y;
-//                    result.maxz = z;
+                } else if (! luminanceOnly) {
+                    // CIE delta E test with modifications
+                    float color_scale = 1.0f;
+                    // ramp down the color test in scotopic regions
+                    if (adapt < 10.0f) {
+                        color_scale = 1.0f - (10.0f - color_scale) / 10.0f;
+                        color_scale = color_scale * color_scale;
+                    }
+                    float da = aLAB[3*p+1] - bLAB[3*p+1];  // diff in A
+                    float db = aLAB[3*p+2] - bLAB[3*p+2];  // diff in B
+                    da = da * da;
+                    db = db * db;
+                    delta = (da + db) * color_scale;
+                    if (delta > factor)
+                        pass = false;
+                }
+                if (!pass) {
+                    ++nfail;
+                    if (factor > maxerror) {
+                        maxerror = factor;
+                        maxx = x;
+                        maxy = y;
+                    }
                 }
             }
         }
-    }
+        // Merge, keeping the first of equally bad pixels in scanline
+        // order, as a serial pass would.
+        spin_lock lock (result_mutex);
+        result.nfail += nfail;
+        if (nfail && (maxerror > result.maxerror ||
+                      (maxerror == result.maxerror &&
+                       (maxy < result.maxy ||
+                        (maxy == result.maxy && maxx < result.maxx))))) {
+            result.maxerror = maxerror;
+            result.maxx = maxx;
+            result.maxy = maxy;
+//            result.maxz = z;
+        }
+    }, ROI (0, width, 0, A->height), nthreads);
 
     return result.nfail;
 }
@@ -0,0 +1,278 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+// imagecache_bench -- stress the ImageCache with many threads making
+// random or coherent get_pixels / get_tile requests over a set of
+// synthetic tiled files whose total size exceeds max_memory_MB, and
+// report how lookup rate, lock waits, evictions and file handle churn
+// change as the thread count grows.
+
+
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/imagecache.h>
+#include <OpenImageIO/argparse.h>
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/thread.h>
+#include <OpenImageIO/timer.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/ustring.h>
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+OIIO_NAMESPACE_USING;
+
+static bool verbose = false;
+static bool keep_files = false;
+static int nfiles = 16;
+static int res = 1024;
+static int tilesize = 64;
+static int nchannels = 4;
+static int lookups = 100000;         // per thread
+static int max_open_files = 0;       // 0 = leave the cache default
+static float cache_MB = 0.0f;        // 0 = a quarter of the working set
+static std::string threadlist = "1,2,4,8,0";
+static std::string modes = "random,coherent";
+static std::string calls = "get_pixels,get_tile";
+static std::string eviction_policy;
+static std::string dirname = ".";
+static std::vector<ustring> filenames;
+
+
+
+static void
+getargs (int argc, char *argv[])
+{
+    bool help = false;
+    ArgParse ap;
+    ap.options ("imagecache_bench\n"
+                OIIO_INTRO_STRING "\n"
+                "Usage:  imagecache_bench [options]",
+                "--help", &help, "Print help message",
+                "-v", &verbose, "Verbose mode (print full cache stats per run)",
+                "--files %d", &nfiles,
+                    ustring::format("Number of synthetic files (default: %d)", nfiles).c_str(),
+                "--res %d", &res,
+                    ustring::format("Resolution of each file (default: %d)", res).c_str(),
+                "--tile %d", &tilesize,
+                    ustring::format("Tile size (default: %d)", tilesize).c_str(),
+                "--channels %d", &nchannels,
+                    ustring::format("Channels per file (default: %d)", nchannels).c_str(),
+                "--dir %s", &dirname, "Directory for the synthetic files",
+                "--keep", &keep_files, "Don't delete the synthetic files when done",
+                "--threads %s", &threadlist,
+                    ustring::format("Comma-separated thread counts, 0 = all cores (default: %s)", threadlist).c_str(),
+                "--lookups %d", &lookups,
+                    ustring::format("Lookups per thread (default: %d)", lookups).c_str(),
+                "--modes %s", &modes,
+                    ustring::format("Access patterns to run (default: %s)", modes).c_str(),
+                "--calls %s", &calls,
+                    ustring::format("Cache calls to run (default: %s)", calls).c_str(),
+                "--cache %f", &cache_MB, "Cache size in MB (default: 1/4 of the working set)",
+                "--maxfiles %d", &max_open_files, "Set max_open_files (default: cache default)",
+                "--evict %s", &eviction_policy, "Set eviction_policy",
+                NULL);
+    if (ap.parse (argc, (const char**)argv) < 0) {
+        std::cerr << ap.geterror() << std::endl;
+        ap.usage ();
+        exit (EXIT_FAILURE);
+    }
+    if (help) {
+        ap.usage ();
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+
+static void
+make_files ()
+{
+    ImageSpec spec (res, res, nchannels, TypeDesc::UINT8);
+    spec.tile_width = tilesize;
+    spec.tile_height = tilesize;
+    for (int f = 0; f < nfiles; ++f) {
+        ustring name = ustring::format ("%s/icbench_%03d.tif", dirname, f);
+        filenames.push_back (name);
+        if (Filesystem::exists (name.string()))
+            continue;
+        // Noise, so that no tile is constant and gets special treatment.
+        ImageBuf A (spec);
+        ImageBufAlgo::noise (A, "uniform", 0.0f, 1.0f, false, f);
+        if (! A.write (name.string())) {
+            std::cerr << "imagecache_bench: " << A.geterror() << "\n";
+            exit (EXIT_FAILURE);
+        }
+    }
+}
+
+
+
+// One worker: make `lookups` requests, each for one tile's worth of
+// pixels. "random" picks any tile of any file; "coherent" walks the
+// tiles of each file in scanline order, each thread starting on a
+// different file, the way a bucketed renderer sweeps its textures.
+static void
+do_lookups (ImageCache *ic, int thread_index, bool coherent, bool use_tiles)
+{
+    ImageCache::Perthread *thread_info = ic->get_perthread_info ();
+    std::vector<ImageCache::ImageHandle *> handles (filenames.size());
+    for (size_t f = 0; f < filenames.size(); ++f)
+        handles[f] = ic->get_image_handle (filenames[f], thread_info);
+    std::vector<unsigned char> buf (tilesize * tilesize * nchannels);
+    std::minstd_rand rng (1 + thread_index);
+    int ntiles_x = (res + tilesize - 1) / tilesize;
+    int ntiles = ntiles_x * ntiles_x;
+    int file = thread_index % nfiles, tile = 0;
+    for (int i = 0; i < lookups; ++i) {
+        if (coherent) {
+            if (++tile >= ntiles) {
+                tile = 0;
+                file = (file + 1) % nfiles;
+            }
+        } else {
+            file = int (rng() % nfiles);
+            tile = int (rng() % ntiles);
+        }
+        int x = (tile % ntiles_x) * tilesize;
+        int y = (tile / ntiles_x) * tilesize;
+        if (use_tiles) {
+            ImageCache::Tile *t = ic->get_tile (handles[file], thread_info,
+                                                0, 0, x, y, 0);
+            if (t)
+                ic->release_tile (t);
+        } else {
+            ic->get_pixels (handles[file], thread_info, 0, 0,
+                            x, std::min (x+tilesize, res),
+                            y, std::min (y+tilesize, res), 0, 1,
+                            0, nchannels, TypeDesc::UINT8, &buf[0]);
+        }
+    }
+}
+
+
+
+template<typename T>
+static T
+getstat (ImageCache *ic, const char *name)
+{
+    T val = T(0);
+    ic->getattribute (name, TypeDesc(BaseTypeFromC<T>::value), &val);
+    return val;
+}
+
+
+
+static void
+run (ImageCache *ic, int nthreads, bool coherent, bool use_tiles)
+{
+    ic->invalidate_all (true);
+    ic->reset_stats ();
+    if (nthreads == 0)
+        nthreads = Sysutil::hardware_concurrency();
+    Timer timer;
+    thread_group threads;
+    for (int t = 0; t < nthreads; ++t)
+        threads.create_thread (do_lookups, ic, t, coherent, use_tiles);
+    threads.join_all ();
+    double time = timer();
+
+    double nlookups = double(lookups) * nthreads;
+    float locktime = getstat<float> (ic, "stat:tile_locking_time")
+                   + getstat<float> (ic, "stat:file_locking_time");
+    long long evicted = getstat<long long> (ic, "stat:tiles_evicted");
+    int created = getstat<int> (ic, "stat:tiles_created");
+    int opens = getstat<int> (ic, "stat:open_files_created");
+    int reopens = getstat<int> (ic, "stat:file_reopens");
+    float iotime = getstat<float> (ic, "stat:fileio_time");
+    std::cout << Strutil::format ("  %-8s %-10s %3d thr %9.2f Mlookups/s %7.3fs lock %7.3fs io"
+                                  " %9.0f evict/s %5.1f%% miss %6d opens %6d reopens\n",
+                                  coherent ? "coherent" : "random",
+                                  use_tiles ? "get_tile" : "get_pixels",
+                                  nthreads, nlookups / time * 1.0e-6,
+                                  locktime, iotime, evicted / time,
+                                  100.0 * created / nlookups, opens, reopens);
+    if (verbose)
+        std::cout << ic->getstats (2) << "\n";
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+    getargs (argc, argv);
+
+    std::vector<int> threads;
+    std::vector<std::string> modelist, calllist;
+    Strutil::extract_from_list_string (threads, threadlist);
+    Strutil::split (modes, modelist, ",");
+    Strutil::split (calls, calllist, ",");
+
+    make_files ();
+    double workingset = double(nfiles) * res * res * nchannels;
+    if (cache_MB <= 0.0f)
+        cache_MB = std::max (1.0f, float(workingset / 4.0 / (1024*1024)));
+
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    ic->attribute ("max_memory_MB", cache_MB);
+    if (max_open_files > 0)
+        ic->attribute ("max_open_files", max_open_files);
+    if (eviction_policy.size())
+        ic->attribute ("eviction_policy", eviction_policy);
+    ic->attribute ("autotile", 0);
+
+    std::cout << "ImageCache benchmark: " << nfiles << " files of " << res
+              << "x" << res << "x" << nchannels << " uint8, " << tilesize
+              << "x" << tilesize << " tiles\n"
+              << "  working set " << Strutil::memformat ((long long)workingset)
+              << ", cache " << cache_MB << " MB, " << lookups
+              << " lookups per thread\n";
+    for (const std::string &mode : modelist) {
+        for (const std::string &call : calllist) {
+            for (int nt : threads)
+                run (ic, nt, mode == "coherent", call == "get_tile");
+        }
+    }
+    ImageCache::destroy (ic);
+
+    if (! keep_files) {
+        for (ustring f : filenames) {
+            std::string err;
+            Filesystem::remove (f.string(), err);
+        }
+    }
+    return 0;
+}
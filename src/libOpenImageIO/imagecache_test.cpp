@@ -33,8 +33,14 @@
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagecache.h>
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/thread.h>
+#include <OpenImageIO/timer.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/strutil.h>
 #include <OpenImageIO/unittest.h>
 
+#include <functional>
 #include <iostream>
 
 OIIO_NAMESPACE_USING;
@@ -84,6 +90,413 @@ test_get_pixels_cachechannels (int chbegin = 0, int chend = 4,
 
 
 
+// Hammer the tile cache with get_tile calls from many threads at once,
+// sweeping over all the tiles of the file so that the per-thread
+// microcache mostly misses and the main tile cache must be searched.
+// Each thread checks that the tile it got back has the right pixels.
+static void
+do_tile_lookups (ImageCache *ic, ustring filename, int res, int tilesize,
+                 int iterations)
+{
+    int ntiles = res / tilesize;
+    for (int i = 0;  i < iterations;  ++i) {
+        int x = (i % ntiles) * tilesize;
+        int y = ((i / ntiles) % ntiles) * tilesize;
+        ImageCache::Tile *tile = ic->get_tile (filename, 0, 0, x, y, 0);
+        OIIO_CHECK_ASSERT (tile);
+        if (! tile)
+            continue;
+        TypeDesc format;
+        const float *p = (const float *) ic->tile_pixels (tile, format);
+        OIIO_CHECK_ASSERT (p && p[0] == float(x) && p[1] == float(y));
+        ic->release_tile (tile);
+    }
+}
+
+
+
+// Compare how cache hits scale with the number of threads, with and
+// without the lock-free tile index.  If max_memory_MB is small, tiles
+// are constantly being evicted while others are looked up, which
+// exercises the safe-reclamation of tiles removed from the index.
+void
+test_tile_lookup_contention (float max_memory_MB = 256.0f,
+                             int iterations = 100000)
+{
+    std::cout << "\nTesting tile lookup contention, max_memory_MB = "
+              << max_memory_MB << "\n";
+    // Create a tiled file whose pixels encode their own coordinates
+    ustring filename ("tiled_contention.tif");
+    const int res = 512, tilesize = 32;
+    ImageSpec spec (res, res, 2, TypeDesc::FLOAT);
+    spec.tile_width = tilesize;
+    spec.tile_height = tilesize;
+    ImageBuf A (spec);
+    for (ImageBuf::Iterator<float> p (A);  ! p.done();  ++p) {
+        p[0] = float(p.x() - p.x() % tilesize);
+        p[1] = float(p.y() - p.y() % tilesize);
+    }
+    A.write (filename);
+
+    int maxthreads = std::max (4, (int)Sysutil::hardware_concurrency());
+    for (int lockfree = 0;  lockfree <= 1;  ++lockfree) {
+        for (int nthreads = 1;  nthreads <= maxthreads;  nthreads *= 2) {
+            ImageCache *ic = ImageCache::create (false /*not shared*/);
+            ic->attribute ("max_memory_MB", max_memory_MB);
+            ic->attribute ("lockfree_tiles", lockfree);
+            // Populate the cache before timing
+            do_tile_lookups (ic, filename, res, tilesize,
+                             (res/tilesize) * (res/tilesize));
+            auto func = [&](){
+                thread_group threads;
+                for (int t = 0;  t < nthreads;  ++t)
+                    threads.create_thread (do_tile_lookups, ic, filename,
+                                           res, tilesize, iterations/nthreads);
+                threads.join_all ();
+            };
+            double range;
+            double t = time_trial (func, 3, &range);
+            std::cout << Strutil::format ("  %s %2d threads: %5.3fs  (range %.3f)\n",
+                                          lockfree ? "lock-free " : "bin-locked",
+                                          nthreads, t, range);
+            ImageCache::destroy (ic);
+        }
+    }
+}
+
+
+
+// Run the same tile lookups through a cache too small to hold them all,
+// under each eviction policy, and make sure that the evictions were
+// attributed to the right policy (do_tile_lookups checks the pixels).
+void
+test_eviction_policy (const char *policy)
+{
+    std::cout << "\nTesting eviction_policy \"" << policy << "\"\n";
+    ustring filename ("tiled_contention.tif");  // made by the test above
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    ic->attribute ("max_memory_MB", 1.0f);
+    OIIO_CHECK_ASSERT (ic->attribute ("eviction_policy", policy));
+    std::string p;
+    OIIO_CHECK_ASSERT (ic->getattribute ("eviction_policy", p));
+    OIIO_CHECK_EQUAL (p, policy);
+    do_tile_lookups (ic, filename, 512, 32, 2000);
+    long long clock = 0, gclock = 0, total = 0;
+    ic->getattribute ("stat:tiles_evicted_clock", TypeDesc::INT64, &clock);
+    ic->getattribute ("stat:tiles_evicted_gclock", TypeDesc::INT64, &gclock);
+    ic->getattribute ("stat:tiles_evicted", TypeDesc::INT64, &total);
+    std::cout << "  evicted " << clock << " by clock, " << gclock
+              << " by gclock\n";
+    OIIO_CHECK_EQUAL (total, clock + gclock);
+    OIIO_CHECK_ASSERT (std::string(policy) == "clock" ? clock > 0 : gclock > 0);
+    OIIO_CHECK_ASSERT (std::string(policy) == "clock" ? gclock == 0 : clock == 0);
+    ImageCache::destroy (ic);
+}
+
+
+
+// Prefetch all the tiles of a file, wait for the background reads to
+// finish, and then make sure that reading them finds them all in cache.
+void
+test_prefetch_tiles ()
+{
+    std::cout << "\nTesting prefetch_tiles\n";
+    ustring filename ("tiled_contention.tif");  // made by the test above
+    const int res = 512, tilesize = 32, ntiles = (res/tilesize)*(res/tilesize);
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    OIIO_CHECK_ASSERT (ic->prefetch_tiles (filename, 0, 0, ROI::All()));
+    OIIO_CHECK_ASSERT (! ic->prefetch_tiles (filename, 0, 1, ROI::All()));
+    std::cout << "  " << ic->geterror() << "\n";
+    long long prefetched = 0;
+    for (Timer timer;  prefetched < ntiles && timer() < 30.0; ) {
+        Sysutil::usleep (1000);
+        ic->getattribute ("stat:tiles_prefetched", TypeDesc::INT64, &prefetched);
+    }
+    OIIO_CHECK_EQUAL (prefetched, ntiles);
+    do_tile_lookups (ic, filename, res, tilesize, ntiles);
+    int misses = -1;
+    ic->getattribute ("stat:find_tile_cache_misses", TypeDesc::INT, &misses);
+    OIIO_CHECK_EQUAL (misses, 0);
+    ImageCache::destroy (ic);
+}
+
+
+
+// Pin a band of tiles, thrash a cache too small for the whole file, and
+// make sure the pinned tiles were never evicted.  Then check the limit on
+// pinned memory, and that unpinning releases it all.
+void
+test_pin_tiles ()
+{
+    std::cout << "\nTesting pin_tiles\n";
+    ustring filename ("tiled_contention.tif");  // made by the test above
+    const int res = 512, tilesize = 32, ntiles = (res/tilesize)*(res/tilesize);
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    ic->attribute ("max_memory_MB", 1.0f);
+    ic->attribute ("max_pinned_MB", 0.5f);
+    ROI band (0, res, 0, 2*tilesize);
+    OIIO_CHECK_ASSERT (ic->pin_tiles (filename, 0, 0, band));
+    long long pinned = 0;
+    ic->getattribute ("stat:pinned_bytes", TypeDesc::INT64, &pinned);
+    OIIO_CHECK_EQUAL (pinned, 2*(res/tilesize) * tilesize*tilesize*2*4);
+    int misses = -1, misses_before = -1;
+    do_tile_lookups (ic, filename, res, tilesize, 4*ntiles);
+    ic->getattribute ("stat:find_tile_cache_misses", TypeDesc::INT, &misses_before);
+    do_tile_lookups (ic, filename, res, tilesize, 2*(res/tilesize));
+    ic->getattribute ("stat:find_tile_cache_misses", TypeDesc::INT, &misses);
+    OIIO_CHECK_EQUAL (misses, misses_before);
+
+    // The whole file (2 MB) is more than max_pinned_MB
+    OIIO_CHECK_ASSERT (! ic->pin_tiles (filename, 0, 0, ROI::All()));
+    std::cout << "  " << ic->geterror() << "\n";
+    OIIO_CHECK_ASSERT (ic->unpin_tiles (filename, 0, 0, ROI::All()));
+    OIIO_CHECK_ASSERT (ic->unpin_tiles (filename, 0, 0, band));
+    ic->getattribute ("stat:pinned_bytes", TypeDesc::INT64, &pinned);
+    OIIO_CHECK_EQUAL (pinned, 0);
+    ImageCache::destroy (ic);
+}
+
+
+
+// Save the working set of one cache as a manifest, load it into a fresh
+// cache, and make sure that the same lookups then find every tile there.
+void
+test_manifest ()
+{
+    std::cout << "\nTesting save_manifest/load_manifest\n";
+    ustring filename ("tiled_contention.tif");  // made by the test above
+    const int res = 512, tilesize = 32, ntiles = (res/tilesize)*(res/tilesize);
+    std::string manifest ("imagecache_test_manifest.txt");
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    do_tile_lookups (ic, filename, res, tilesize, ntiles);
+    OIIO_CHECK_ASSERT (ic->save_manifest (manifest));
+    ImageCache::destroy (ic);
+
+    ic = ImageCache::create (false /*not shared*/);
+    OIIO_CHECK_ASSERT (! ic->load_manifest ("no_such_manifest.txt"));
+    ic->geterror ();
+    OIIO_CHECK_ASSERT (ic->load_manifest (manifest));
+    long long prefetched = 0;
+    for (Timer timer;  prefetched < ntiles && timer() < 30.0; ) {
+        Sysutil::usleep (1000);
+        ic->getattribute ("stat:tiles_prefetched", TypeDesc::INT64, &prefetched);
+    }
+    OIIO_CHECK_EQUAL (prefetched, ntiles);
+    do_tile_lookups (ic, filename, res, tilesize, ntiles);
+    int misses = -1;
+    ic->getattribute ("stat:find_tile_cache_misses", TypeDesc::INT, &misses);
+    OIIO_CHECK_EQUAL (misses, 0);
+    ImageCache::destroy (ic);
+    std::string err;
+    Filesystem::remove (manifest, err);
+}
+
+
+
+// With max_tile_batch set, a miss should read the missing tiles to its
+// right as well, so a sweep across a row of tiles misses just once.
+void
+test_tile_batch ()
+{
+    std::cout << "\nTesting max_tile_batch\n";
+    ustring filename ("tiled_contention.tif");  // made by the test above
+    const int res = 512, tilesize = 32;
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    ic->attribute ("max_tile_batch", res/tilesize);
+    do_tile_lookups (ic, filename, res, tilesize, res/tilesize);
+    int misses = -1;
+    ic->getattribute ("stat:find_tile_cache_misses", TypeDesc::INT, &misses);
+    OIIO_CHECK_EQUAL (misses, 1);
+    ImageCache::destroy (ic);
+}
+
+
+
+// With a per-thread tile table, cycling through more tiles than the
+// two-entry microcache holds should stop going to the main cache.
+void
+test_microcache_size ()
+{
+    std::cout << "\nTesting microcache_size\n";
+    ustring filename ("tiled_contention.tif");  // made by the test above
+    const int res = 512, tilesize = 32;
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    ic->attribute ("microcache_size", 64);
+    int size = 0;
+    OIIO_CHECK_ASSERT (ic->getattribute ("microcache_size", size));
+    OIIO_CHECK_EQUAL (size, 64);
+    do_tile_lookups (ic, filename, res, tilesize, 2*res/tilesize);
+    long long hits = 0, misses = 0;
+    ic->getattribute ("stat:find_tile_tiletable_hits", TypeDesc::INT64, &hits);
+    ic->getattribute ("stat:find_tile_microcache_misses", TypeDesc::INT64, &misses);
+    std::cout << "  " << hits << " table hits, " << misses << " misses\n";
+    OIIO_CHECK_ASSERT (hits > 0);
+    OIIO_CHECK_EQUAL (hits + misses, 2*res/tilesize);
+    ImageCache::destroy (ic);
+}
+
+
+
+// Test that with a compressed tier, tiles evicted from a too-small cache
+// come back with the right pixels without being read again.
+static void
+test_compressed_tiles ()
+{
+    std::cout << "\nTesting max_compressed_memory_MB\n";
+    // Make a file of 16 MB (more than the smallest allowed cache), whose
+    // pixels encode their own tile coordinates.
+    ustring filename ("tiled_compressed.tif");
+    const int res = 1024, tilesize = 32, ntiles = (res/tilesize)*(res/tilesize);
+    ImageSpec spec (res, res, 4, TypeDesc::FLOAT);
+    spec.tile_width = tilesize;
+    spec.tile_height = tilesize;
+    ImageBuf A (spec);
+    for (ImageBuf::Iterator<float> p (A);  ! p.done();  ++p) {
+        p[0] = float(p.x() - p.x() % tilesize);
+        p[1] = float(p.y() - p.y() % tilesize);
+    }
+    A.write (filename);
+
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    ic->attribute ("max_memory_MB", 1.0f);
+    ic->attribute ("max_compressed_memory_MB", 16.0f);
+    float size = 0.0f;
+    OIIO_CHECK_ASSERT (ic->getattribute ("max_compressed_memory_MB", size));
+    OIIO_CHECK_EQUAL (size, 16.0f);
+    do_tile_lookups (ic, filename, res, tilesize, 2*ntiles);
+    long long hits = 0, misses = 0;
+    ic->getattribute ("stat:compressed_tile_hits", TypeDesc::INT64, &hits);
+    ic->getattribute ("stat:compressed_tile_misses", TypeDesc::INT64, &misses);
+    std::cout << "  " << hits << " compressed tier hits, " << misses << " misses\n";
+    OIIO_CHECK_ASSERT (hits > 0);
+    ic->invalidate_all (true);
+    int held = -1;
+    ic->getattribute ("stat:compressed_tiles_current", held);
+    OIIO_CHECK_EQUAL (held, 0);
+    ImageCache::destroy (ic);
+}
+
+
+
+// Rewrite a file behind the cache's back and make sure that after
+// invalidate() (and again after invalidate_all), lookups see the new
+// pixels, even for tiles already held in the thread's microcache.
+static void
+test_invalidate ()
+{
+    std::cout << "\nTesting invalidate\n";
+    ustring filename ("invalidate_test.tif");
+    ImageSpec spec (64, 64, 1, TypeDesc::FLOAT);
+    spec.tile_width = spec.tile_height = 32;
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    for (int i = 0;  i < 3;  ++i) {
+        ImageBuf A (spec);
+        float val = float(i);
+        ImageBufAlgo::fill (A, &val);
+        A.write (filename.string());
+        if (i == 1)
+            ic->invalidate (filename);
+        else if (i == 2)
+            ic->invalidate_all (true);
+        for (int y = 0;  y < 64;  y += 32) {
+            for (int x = 0;  x < 64;  x += 32) {
+                float pixel = -1.0f;
+                ic->get_pixels (filename, 0, 0, x, x+1, y, y+1, 0, 1,
+                                TypeDesc::FLOAT, &pixel);
+                OIIO_CHECK_EQUAL (pixel, val);
+            }
+        }
+    }
+    ImageCache::destroy (ic);
+    std::string err;
+    Filesystem::remove (filename.string(), err);
+}
+
+
+
+// Test that a second ImageCache using the same tile_cache_dir gets its
+// tiles from there rather than from the file, and a third one maps them.
+static void
+test_tile_cache_dir ()
+{
+    std::cout << "\nTesting tile_cache_dir\n";
+    ustring filename ("tiled_contention.tif");  // made by the test above
+    const int res = 512, tilesize = 32, ntiles = (res/tilesize)*(res/tilesize);
+    std::string dir = "tile_cache_dir_test", err;
+    Filesystem::remove_all (dir, err);
+    Filesystem::create_directory (dir, err);
+    for (int pass = 0;  pass < 3;  ++pass) {
+        ImageCache *ic = ImageCache::create (false /*not shared*/);
+        ic->attribute ("tile_cache_dir", dir);
+        ic->attribute ("mmap_tiles", int(pass == 2));
+        do_tile_lookups (ic, filename, res, tilesize, ntiles);
+        long long hits = 0, written = 0, mapped = 0;
+        ic->getattribute ("stat:disk_tile_hits", TypeDesc::INT64, &hits);
+        ic->getattribute ("stat:disk_tiles_written", TypeDesc::INT64, &written);
+        ic->getattribute ("stat:disk_tiles_mapped", TypeDesc::INT64, &mapped);
+        std::cout << "  pass " << pass << ": " << hits << " hits, "
+                  << written << " tiles written, " << mapped << " mapped\n";
+        OIIO_CHECK_EQUAL (hits, pass ? ntiles : 0);
+        OIIO_CHECK_EQUAL (written, pass ? 0 : ntiles);
+        OIIO_CHECK_EQUAL (mapped, pass == 2 ? ntiles : 0);
+        if (pass == 2) {
+            // Invalidating the file removes its tiles from the directory
+            ic->invalidate (filename);
+            std::vector<std::string> entries;
+            Filesystem::get_directory_entries (dir, entries);
+            OIIO_CHECK_ASSERT (entries.empty());
+        }
+        ImageCache::destroy (ic);
+    }
+    Filesystem::remove_all (dir, err);
+}
+
+
+
+// Test that with open_file_lru, cycling through more files than
+// max_open_files stays within the limit and reads the right pixels.
+static void
+test_open_file_lru ()
+{
+    std::cout << "\nTesting open_file_lru\n";
+    const int nfiles = 8, maxfiles = 4;
+    std::vector<ustring> names;
+    for (int i = 0;  i < nfiles;  ++i) {
+        ImageSpec spec (64, 64, 1, TypeDesc::FLOAT);
+        spec.tile_width = spec.tile_height = 32;
+        ImageBuf A (spec);
+        float val = float(i);
+        ImageBufAlgo::fill (A, &val);
+        names.push_back (ustring::format ("lru_test_%d.tif", i));
+        A.write (names.back().string());
+    }
+    ImageCache *ic = ImageCache::create (false /*not shared*/);
+    ic->attribute ("max_open_files", maxfiles);
+    ic->attribute ("open_file_lru", 1);
+    int peak = 0;
+    for (int pass = 0;  pass < 3;  ++pass) {
+        for (int i = 0;  i < nfiles;  ++i) {
+            // A different tile each pass, so each pass must read the file
+            float val = -1.0f;
+            int x = 32 * (pass & 1), y = 32 * (pass >> 1);
+            ic->get_pixels (names[i], 0, 0, x, x+1, y, y+1, 0, 1,
+                            TypeDesc::FLOAT, &val);
+            OIIO_CHECK_EQUAL (val, float(i));
+            int current = 0;
+            ic->getattribute ("stat:open_files_current", current);
+            peak = std::max (peak, current);
+        }
+    }
+    int reopens = 0;
+    ic->getattribute ("stat:file_reopens", reopens);
+    std::cout << "  " << reopens << " reopens, at most " << peak << " open\n";
+    OIIO_CHECK_ASSERT (peak <= maxfiles);
+    OIIO_CHECK_ASSERT (reopens > 0);
+    ImageCache::destroy (ic);
+}
+
+
+
 int
 main (int argc, char **argv)
 {
@@ -94,5 +507,20 @@ main (int argc, char **argv)
     test_get_pixels_cachechannels (6, 9);
     test_get_pixels_cachechannels (6, 9, 6, 9);
 
+    test_tile_lookup_contention ();
+    test_tile_lookup_contention (1.0f, 10000);
+
+    test_eviction_policy ("clock");
+    test_eviction_policy ("gclock");
+    test_prefetch_tiles ();
+    test_pin_tiles ();
+    test_manifest ();
+    test_tile_batch ();
+    test_microcache_size ();
+    test_compressed_tiles ();
+    test_invalidate ();
+    test_tile_cache_dir ();
+    test_open_file_lru ();
+
     return unit_test_failures;
 }
@@ -40,6 +40,10 @@
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/deepdata.h"
+#include "OpenImageIO/imagebuf.h"
+#include "OpenImageIO/parallel.h"
+#include "OpenImageIO/thread.h"
+#include "OpenImageIO/trace.h"
 #include "imageio_pvt.h"
 
 
@@ -110,6 +114,7 @@ bool
 ImageInput::read_scanline (int y, int z, TypeDesc format, void *data,
                            stride_t xstride)
 {
+    OIIO_TRACE_ZONE ("ImageInput::read_scanline", format_name());
     // native_pixel_bytes is the size of a pixel in the FILE, including
     // the per-channel format.
     stride_t native_pixel_bytes = (stride_t) m_spec.pixel_bytes (true);
@@ -167,6 +172,58 @@ ImageInput::read_scanline (int y, int z, TypeDesc format, void *data,
 
 
 
+// Convert nscanlines of channels [chbegin,chend) of native pixels in buf,
+// as read_native_scanlines leaves them, to format at data with the given
+// strides.
+static bool
+convert_native_scanlines (const ImageSpec &spec, int chbegin, int chend,
+                          const char *buf, int nscanlines,
+                          TypeDesc format, void *data,
+                          stride_t xstride, stride_t ystride, int nthreads)
+{
+    int nchans = chend - chbegin;
+    size_t native_pixel_bytes = spec.pixel_bytes (chbegin, chend, true);
+    stride_t native_scanline_bytes = stride_t(spec.width) * native_pixel_bytes;
+    bool contiguous = (xstride == (stride_t) native_pixel_bytes &&
+                       ystride == native_scanline_bytes);
+    bool ok = true;
+    if (spec.channelformats.empty()) {
+        // No per-channel formats -- do the conversion in one shot
+        if (contiguous) {
+            ok = convert_types (spec.format, buf, format, data,
+                                spec.width * nchans * nscanlines);
+        } else {
+            ok = parallel_convert_image (nchans, spec.width, nscanlines, 1,
+                                buf, spec.format, AutoStride, AutoStride, AutoStride,
+                                data, format, xstride, ystride, AutoStride,
+                                -1 /*alpha*/, -1 /*z*/, nthreads);
+        }
+    } else {
+        // Per-channel formats -- have to convert/copy channels individually
+        size_t offset = 0;
+        int n = 1;
+        for (int c = 0;  ok && c < nchans; c += n) {
+            TypeDesc chanformat = spec.channelformats[c+chbegin];
+            // Try to do more than one channel at a time to improve
+            // memory coherence, if there are groups of adjacent
+            // channels needing the same data conversion.
+            for (n = 1; c+n < nchans; ++n)
+                if (spec.channelformats[c+chbegin+n] != chanformat)
+                    break;
+            ok = parallel_convert_image (n /* channels */, spec.width, nscanlines, 1,
+                                buf+offset, chanformat,
+                                native_pixel_bytes, AutoStride, AutoStride,
+                                (char *)data + c*format.size(),
+                                format, xstride, ystride, AutoStride,
+                                -1 /*alpha*/, -1 /*z*/, nthreads);
+            offset += n * chanformat.size ();
+        }
+    }
+    return ok;
+}
+
+
+
 bool
 ImageInput::read_scanlines (int ybegin, int yend, int z,
                             TypeDesc format, void *data,
@@ -184,6 +241,7 @@ ImageInput::read_scanlines (int ybegin, int yend, int z,
                             TypeDesc format, void *data,
                             stride_t xstride, stride_t ystride)
 {
+    OIIO_TRACE_ZONE ("ImageInput::read_scanlines", format_name());
     chend = clamp (chend, chbegin+1, m_spec.nchannels);
     int nchans = chend - chbegin;
     yend = std::min (yend, spec().y+spec().height);
@@ -210,56 +268,53 @@ ImageInput::read_scanlines (int ybegin, int yend, int z,
             return read_native_scanlines (ybegin, yend, z, chbegin, chend, data);
     }
 
-    // No such luck.  Read scanlines in chunks.
+    // No such luck.  Read scanlines in chunks.  With threads to spare,
+    // each chunk is converted on the pool while the next one is decoded
+    // on this thread into a second buffer, so that (for every plugin)
+    // decoding and conversion overlap.  Use at least a few chunks so that
+    // there is something to overlap.
 
     const imagesize_t limit = 16*1024*1024;   // Allocate 16 MB, or 1 scanline
     int chunk = std::max (1, int(limit / native_scanline_bytes));
-    std::unique_ptr<char[]> buf (new char [chunk * native_scanline_bytes]);
-
-    bool ok = true;
-    int scanline_values = m_spec.width * nchans;
-    for (;  ok && ybegin < yend;  ybegin += chunk) {
+    int nthreads = threads() ? threads() : int(oiio_threads);
+    thread_pool *pool = default_thread_pool();
+    bool overlap = (nthreads != 1 && pool->size() >= 1 && yend - ybegin > 1);
+    if (overlap)
+        chunk = std::min (chunk, std::max (1, (yend - ybegin + 3) / 4));
+    int nbufs = overlap ? 2 : 1;
+    std::unique_ptr<char[]> buf[2];
+    for (int b = 0;  b < nbufs;  ++b)
+        buf[b].reset (new char [chunk * native_scanline_bytes]);
+
+    bool ok = read_native_scanlines (ybegin, std::min (ybegin+chunk, yend), z,
+                                     chbegin, chend, &buf[0][0]);
+    for (int b = 0;  ok && ybegin < yend;  ybegin += chunk, b = (b+1) % nbufs) {
         int y1 = std::min (ybegin+chunk, yend);
-        ok &= read_native_scanlines (ybegin, y1, z, chbegin, chend, &buf[0]);
-        if (! ok)
-            break;
-
         int nscanlines = y1 - ybegin;
-        int chunkvalues = scanline_values * nscanlines;
-        if (m_spec.channelformats.empty()) {
-            // No per-channel formats -- do the conversion in one shot
-            if (contiguous) {
-                ok = convert_types (m_spec.format, &buf[0], format, data, chunkvalues);
-            } else {
-                ok = parallel_convert_image (nchans, m_spec.width, nscanlines, 1, 
-                                    &buf[0], m_spec.format, AutoStride, AutoStride, AutoStride,
-                                    data, format, xstride, ystride, zstride,
-                                    -1 /*alpha*/, -1 /*z*/, threads());
-            }
+        int next = (b+1) % nbufs;
+        bool convok = true;
+        auto convert = [&,b,nscanlines,data](int /*id*/){
+            convok = convert_native_scanlines (m_spec, chbegin, chend,
+                                               &buf[b][0], nscanlines, format,
+                                               data, xstride, ystride, nthreads);
+        };
+        if (overlap && y1 < yend) {
+            task_set<void> tasks (pool);
+            tasks.push (pool->push (convert));
+            ok &= read_native_scanlines (y1, std::min (y1+chunk, yend), z,
+                                         chbegin, chend, &buf[next][0]);
+            // leaving scope waits for the conversion, helping if idle
         } else {
-            // Per-channel formats -- have to convert/copy channels individually
-            size_t offset = 0;
-            int n = 1;
-            for (int c = 0;  ok && c < nchans; c += n) {
-                TypeDesc chanformat = m_spec.channelformats[c+chbegin];
-                // Try to do more than one channel at a time to improve
-                // memory coherence, if there are groups of adjacent
-                // channels needing the same data conversion.
-                for (n = 1; c+n < nchans; ++n)
-                    if (m_spec.channelformats[c+chbegin+n] != chanformat)
-                        break;
-                ok = parallel_convert_image (n /* channels */, m_spec.width, nscanlines, 1, 
-                                    &buf[offset], chanformat,
-                                    native_pixel_bytes, AutoStride, AutoStride,
-                                    (char *)data + c*format.size(),
-                                    format, xstride, ystride, zstride,
-                                    -1 /*alpha*/, -1 /*z*/, threads());
-                offset += n * chanformat.size ();
-            }
+            convert (-1);
+            if (y1 < yend)
+                ok &= read_native_scanlines (y1, std::min (y1+chunk, yend), z,
+                                             chbegin, chend, &buf[next][0]);
         }
-        if (! ok)
+        if (! convok) {
+            ok = false;
             error ("ImageInput::read_scanlines : no support for format %s",
                    m_spec.format.c_str());
+        }
         data = (char *)data + ystride*nscanlines;
     }
     return ok;
@@ -324,6 +379,7 @@ bool
 ImageInput::read_tile (int x, int y, int z, TypeDesc format, void *data,
                        stride_t xstride, stride_t ystride, stride_t zstride)
 {
+    OIIO_TRACE_ZONE ("ImageInput::read_tile", format_name());
     if (! m_spec.tile_width ||
         ((x-m_spec.x) % m_spec.tile_width) != 0 ||
         ((y-m_spec.y) % m_spec.tile_height) != 0 ||
@@ -411,6 +467,7 @@ ImageInput::read_tiles (int xbegin, int xend, int ybegin, int yend,
                         TypeDesc format, void *data,
                         stride_t xstride, stride_t ystride, stride_t zstride)
 {
+    OIIO_TRACE_ZONE ("ImageInput::read_tiles", format_name());
     if (! m_spec.valid_tile_range (xbegin, xend, ybegin, yend, zbegin, zend))
         return false;
 
@@ -518,6 +575,17 @@ ImageInput::read_tiles (int xbegin, int xend, int ybegin, int yend,
 
 
 
+bool
+ImageInput::read_tiles_concurrent (int subimage, int miplevel,
+                                   int xbegin, int xend, int ybegin, int yend,
+                                   int zbegin, int zend, int chbegin, int chend,
+                                   TypeDesc format, void *data)
+{
+    return false;  // default: doesn't support concurrent tile reads
+}
+
+
+
 bool
 ImageInput::read_native_tiles (int xbegin, int xend, int ybegin, int yend,
                                int zbegin, int zend, void *data)
@@ -628,6 +696,7 @@ ImageInput::read_image (int chbegin, int chend, TypeDesc format, void *data,
                         ProgressCallback progress_callback,
                         void *progress_callback_data)
 {
+    OIIO_TRACE_ZONE ("ImageInput::read_image", format_name());
     if (chend < 0)
         chend = m_spec.nchannels;
     chend = clamp (chend, chbegin+1, m_spec.nchannels);
@@ -683,6 +752,97 @@ ImageInput::read_image (int chbegin, int chend, TypeDesc format, void *data,
 
 
 
+bool
+pvt::read_image_colorconvert (ImageInput *in, int chbegin, int chend,
+                              TypeDesc format, void *data,
+                              stride_t xstride, stride_t ystride,
+                              stride_t zstride,
+                              const ColorProcessor *processor, bool unpremult,
+                              ProgressCallback progress_callback,
+                              void *progress_callback_data)
+{
+    const ImageSpec &spec (in->spec());
+    if (chend < 0)
+        chend = spec.nchannels;
+    chend = clamp (chend, chbegin+1, spec.nchannels);
+    int nchans = chend - chbegin;
+    if (format == TypeDesc::UNKNOWN)
+        format = spec.channelformats.size() ? TypeDesc::FLOAT : spec.format;
+    ImageSpec::auto_stride (xstride, ystride, zstride, format, nchans,
+                            spec.width, spec.height);
+
+    // Decode about 4 MB of float pixels at a time (whole rows of tiles
+    // for tiled files).  Files with per-channel formats are brought in
+    // as float, all others in their native format so that the conversion
+    // to float happens in the parallel bands below.
+    bool tiled = (spec.tile_width > 0);
+    int zslab = tiled ? std::max (1, spec.tile_depth) : 1;
+    imagesize_t rowvals = imagesize_t(spec.width) * nchans;
+    int rows = std::max (imagesize_t(1),
+                         imagesize_t(1024*1024) / (rowvals*zslab));
+    rows = std::min (rows, spec.height);
+    if (tiled)
+        rows = round_to_multiple (rows, spec.tile_height);
+    TypeDesc bufformat = spec.channelformats.size() ? TypeDesc::FLOAT
+                                                    : spec.format;
+    size_t bufvalsize = bufformat.size();
+    std::unique_ptr<char[]> buf (new char [rows*zslab*rowvals*bufvalsize]);
+
+    int nthreads = in->threads() ? in->threads() : int(oiio_threads);
+    int bandrows = std::max (1, 16384 / std::max (1, spec.width));
+
+    bool ok = true;
+    if (progress_callback)
+        if (progress_callback (progress_callback_data, 0.0f))
+            return ok;
+    for (int z = 0;  z < spec.depth && ok;  z += zslab) {
+        int nz = std::min (zslab, spec.depth - z);
+        for (int y = 0;  y < spec.height && ok;  y += rows) {
+            int ny = std::min (rows, spec.height - y);
+            if (tiled)
+                ok &= in->read_tiles (spec.x, spec.x+spec.width,
+                                      spec.y+y, spec.y+y+ny,
+                                      spec.z+z, spec.z+z+nz,
+                                      chbegin, chend, bufformat, &buf[0]);
+            else
+                ok &= in->read_scanlines (spec.y+y, spec.y+y+ny, spec.z+z,
+                                          chbegin, chend, bufformat, &buf[0]);
+            if (! ok)
+                break;
+            char *chunkdata = (char *)data + z*zstride + y*ystride;
+            auto band = [&](int64_t b, int64_t e) {
+                int npixels = int(e-b) * spec.width;
+                std::unique_ptr<float[]> f (new float [npixels*(nchans+4)]);
+                float *scratch = f.get() + npixels*nchans;
+                convert_types (bufformat, &buf[b*rowvals*bufvalsize],
+                               TypeDesc::FLOAT, f.get(), npixels*nchans);
+                pvt::colorprocessor_apply (processor, unpremult, f.get(),
+                                           npixels, nchans, nchans, scratch);
+                for (int64_t r = b;  r < e;  ++r)
+                    convert_image (nchans, spec.width, 1, 1,
+                                   f.get() + (r-b)*rowvals, TypeDesc::FLOAT,
+                                   AutoStride, AutoStride, AutoStride,
+                                   chunkdata + (r/ny)*zstride + (r%ny)*ystride,
+                                   format, xstride, ystride, zstride);
+            };
+            int64_t nrows = int64_t(ny) * nz;
+            if (nthreads <= 1 || nrows <= bandrows)
+                band (0, nrows);
+            else
+                parallel_for_chunked (0, nrows, bandrows, band);
+            if (progress_callback &&
+                progress_callback (progress_callback_data,
+                                   float(y+ny)/spec.height))
+                return ok;
+        }
+    }
+    if (progress_callback)
+        progress_callback (progress_callback_data, 1.0f);
+    return ok;
+}
+
+
+
 bool
 ImageInput::read_native_deep_scanlines (int ybegin, int yend, int z,
                                         int chbegin, int chend,
@@ -730,6 +890,115 @@ ImageInput::read_native_deep_image (DeepData &deepdata)
 
 
 
+bool
+ImageInput::read_native_deep_sample_counts (int xbegin, int xend,
+                                            int ybegin, int yend,
+                                            int zbegin, int zend,
+                                            unsigned int *counts)
+{
+    return false;  // default: can't read the counts without the samples
+}
+
+
+
+bool
+ImageInput::read_native_deep_blocks (int chbegin, int chend,
+                                     imagesize_t max_samples,
+                                     const DeepBlockFunc &fn)
+{
+    OIIO_TRACE_ZONE ("ImageInput::read_native_deep_blocks", format_name());
+    if (! m_spec.deep) {
+        error ("read_native_deep_blocks called for an image that isn't deep");
+        return false;
+    }
+    if (m_spec.depth > 1) {
+        error ("read_native_deep_blocks is not supported for volume (3D) images.");
+        return false;
+    }
+    chend = clamp (chend, chbegin+1, m_spec.nchannels);
+    int xbegin = m_spec.x, xend = m_spec.x + m_spec.width;
+    int ybegin = m_spec.y, yend = m_spec.y + m_spec.height;
+    int z = m_spec.z;
+    bool tiled = (m_spec.tile_width != 0);
+    // Blocks are built from units of one row of tiles, or one scanline,
+    // and for tiled images may be narrowed to fewer tile columns.
+    int unitheight = tiled ? m_spec.tile_height : 1;
+    int unitwidth = tiled ? m_spec.tile_width : m_spec.width;
+
+    // Prefetch the sample counts of the whole image, if we can, so that
+    // we can size the blocks to the sample budget.
+    std::vector<unsigned int> counts;
+    if (max_samples > 0) {
+        counts.resize (size_t(m_spec.width) * m_spec.height);
+        if (! read_native_deep_sample_counts (xbegin, xend, ybegin, yend,
+                                              z, z+1, &counts[0]))
+            counts.clear ();
+        geterror ();   // a reader that can't is not an error
+    }
+    // Number of samples in [x0,x1) x [y0,y1), or 0 if we don't know.
+    auto nsamples = [&](int x0, int x1, int y0, int y1) -> imagesize_t {
+        imagesize_t n = 0;
+        if (counts.size())
+            for (int y = y0; y < y1; ++y) {
+                const unsigned int *row = &counts[size_t(y-ybegin)*m_spec.width];
+                for (int x = x0; x < x1; ++x)
+                    n += row[x-xbegin];
+            }
+        return n;
+    };
+
+    DeepData deepdata;
+    for (int y0 = ybegin; y0 < yend; ) {
+        // Gather rows of units while they fit the budget (without counts,
+        // 16 scanlines or a single row of tiles).
+        int y1 = std::min (y0 + unitheight, yend);
+        if (counts.empty()) {
+            if (! tiled)
+                y1 = std::min (y0 + 16, yend);
+        } else {
+            imagesize_t n = nsamples (xbegin, xend, y0, y1);
+            while (y1 < yend) {
+                int ynext = std::min (y1 + unitheight, yend);
+                imagesize_t more = nsamples (xbegin, xend, y1, ynext);
+                if (n + more > max_samples)
+                    break;
+                n += more;
+                y1 = ynext;
+            }
+        }
+        for (int x0 = xbegin; x0 < xend; ) {
+            // A single row of tiles may be split into groups of columns.
+            int x1 = xend;
+            if (tiled && counts.size()) {
+                x1 = std::min (x0 + unitwidth, xend);
+                imagesize_t n = nsamples (x0, x1, y0, y1);
+                while (x1 < xend) {
+                    int xnext = std::min (x1 + unitwidth, xend);
+                    imagesize_t more = nsamples (x1, xnext, y0, y1);
+                    if (n + more > max_samples)
+                        break;
+                    n += more;
+                    x1 = xnext;
+                }
+            }
+            bool ok = tiled
+                ? read_native_deep_tiles (x0, x1, y0, y1, z, z+1,
+                                          chbegin, chend, deepdata)
+                : read_native_deep_scanlines (y0, y1, z, chbegin, chend,
+                                              deepdata);
+            if (! ok)
+                return false;
+            if (! fn (ROI (x0, x1, y0, y1, z, z+1, chbegin, chend), deepdata))
+                return true;
+            x0 = x1;
+        }
+        y0 = y1;
+    }
+    return true;
+}
+
+
+
 int 
 ImageInput::send_to_input (const char *format, ...)
 {
@@ -44,6 +44,8 @@
 #include "OpenImageIO/thread.h"
 #include "OpenImageIO/parallel.h"
 #include "OpenImageIO/hash.h"
+#include "OpenImageIO/simd.h"
+#include "OpenImageIO/trace.h"
 #include "OpenImageIO/imageio.h"
 #include "imageio_pvt.h"
 
@@ -56,6 +58,13 @@ thread_pool *oiio_thread_pool = default_thread_pool();
 atomic_int oiio_threads (Sysutil::hardware_concurrency());
 atomic_int oiio_exr_threads (Sysutil::hardware_concurrency());
 atomic_int oiio_read_chunk (256);
+atomic_ll oiio_imagebuf_pool_limit (0);
+atomic_int oiio_imagebuf_hugepages (0);
+atomic_int oiio_imagebuf_mmap (0);
+atomic_ll oiio_imagebuf_spill_limit (0);
+ustring oiio_imagebuf_spill_dir;
+ustring oiio_color_precision ("exact");
+atomic_int oiio_resize_prereduce (1);
 int tiff_half (0);
 ustring plugin_searchpath (OIIO_DEFAULT_PLUGIN_SEARCHPATH);
 std::string format_list;   // comma-separated list of all formats
@@ -81,6 +90,298 @@ int print_debug (oiio_debug_env ? atoi(oiio_debug_env) : 1);
 
 
 
+// Runtime SIMD dispatch.  The ISA the library is built for is fixed at
+// compile time (by USE_SIMD), but the hottest pixel conversion kernels are
+// also compiled for AVX2 (+FMA and F16C) and used instead when the CPU we
+// find ourselves running on supports them.  Kernels for the extra ISA are
+// plain intrinsics in functions marked with a target attribute, so none of
+// the inline simd.h/fmath.h code gets compiled for an ISA the baseline
+// build doesn't allow.
+#if defined(OIIO_SIMD_SSE) && !OIIO_SIMD_AVX && !defined(_MSC_VER) && \
+    (OIIO_GNUC_VERSION >= 40900 || defined(__clang__))
+#  define OIIO_DISPATCH_AVX2 1
+#  define OIIO_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#  include <cpuid.h>
+#endif
+
+namespace {
+
+// The x86 SIMD features we care about, named as for USE_SIMD.
+enum SimdFeature {
+    SIMD_SSE2 = 1<<0, SIMD_SSE3 = 1<<1, SIMD_SSSE3 = 1<<2,
+    SIMD_SSE41 = 1<<3, SIMD_SSE42 = 1<<4, SIMD_AVX = 1<<5,
+    SIMD_AVX2 = 1<<6, SIMD_FMA = 1<<7, SIMD_F16C = 1<<8,
+    SIMD_AVX512F = 1<<9
+};
+
+static const char *simd_feature_names[] = {
+    "sse2", "sse3", "ssse3", "sse4.1", "sse4.2", "avx",
+    "avx2", "fma", "f16c", "avx512f", NULL
+};
+
+
+// Comma-separated list of the names of the features set in the bit field.
+static std::string
+simd_feature_list (int features)
+{
+    std::vector<string_view> names;
+    for (int i = 0; simd_feature_names[i]; ++i)
+        if (features & (1 << i))
+            names.push_back (simd_feature_names[i]);
+    return Strutil::join (names, ",");
+}
+
+
+// Ask cpuid (and xgetbv, for whether the OS saves the wide registers
+// across context switches) which SIMD features this machine has.
+static int
+hw_simd_features ()
+{
+    int features = 0;
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || \
+    ((defined(__i386__) || defined(__x86_64__)) && !defined(_MSC_VER))
+    unsigned int info[4] = { 0, 0, 0, 0 };
+#  ifdef _MSC_VER
+    __cpuid ((int *)info, 0);
+#  else
+    __cpuid (0, info[0], info[1], info[2], info[3]);
+#  endif
+    unsigned int maxleaf = info[0];
+    if (maxleaf < 1)
+        return 0;
+#  ifdef _MSC_VER
+    __cpuid ((int *)info, 1);
+#  else
+    __cpuid (1, info[0], info[1], info[2], info[3]);
+#  endif
+    unsigned int ecx1 = info[2], edx1 = info[3];
+    if (edx1 & (1<<26)) features |= SIMD_SSE2;
+    if (ecx1 & (1<<0))  features |= SIMD_SSE3;
+    if (ecx1 & (1<<9))  features |= SIMD_SSSE3;
+    if (ecx1 & (1<<19)) features |= SIMD_SSE41;
+    if (ecx1 & (1<<20)) features |= SIMD_SSE42;
+    // AVX and beyond also need the OS to have enabled the YMM (and for
+    // AVX-512, the ZMM) register state.
+    unsigned long long xcr0 = 0;
+    if (ecx1 & (1<<27)) {  // OSXSAVE
+#  ifdef _MSC_VER
+        xcr0 = _xgetbv (0);
+#  else
+        unsigned int eax, edx;
+        __asm__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        xcr0 = ((unsigned long long)edx << 32) | eax;
+#  endif
+    }
+    bool os_ymm = (xcr0 & 0x06) == 0x06;
+    bool os_zmm = (xcr0 & 0xe6) == 0xe6;
+    if (os_ymm) {
+        if (ecx1 & (1<<28)) features |= SIMD_AVX;
+        if (ecx1 & (1<<12)) features |= SIMD_FMA;
+        if (ecx1 & (1<<29)) features |= SIMD_F16C;
+        if (maxleaf >= 7) {
+#  ifdef _MSC_VER
+            __cpuidex ((int *)info, 7, 0);
+#  else
+            __cpuid_count (7, 0, info[0], info[1], info[2], info[3]);
+#  endif
+            if (info[1] & (1<<5))
+                features |= SIMD_AVX2;
+            if (os_zmm && (info[1] & (1<<16)))
+                features |= SIMD_AVX512F;
+        }
+    }
+#endif
+    return features;
+}
+
+
+// The SIMD features the library itself was compiled to use.
+static int
+build_simd_features ()
+{
+    int features = 0;
+#if OIIO_SIMD_SSE >= 2
+    features |= SIMD_SSE2;
+#endif
+#if defined(__SSE3__) || OIIO_SIMD_SSE >= 3
+    features |= SIMD_SSE3;
+#endif
+#if OIIO_SIMD_SSE >= 3
+    features |= SIMD_SSSE3;
+#endif
+#if OIIO_SIMD_SSE >= 4
+    features |= SIMD_SSE41;
+#endif
+#if defined(__SSE4_2__)
+    features |= SIMD_SSE42;
+#endif
+#if OIIO_SIMD_AVX
+    features |= SIMD_AVX;
+#endif
+#if OIIO_SIMD_AVX >= 2
+    features |= SIMD_AVX2;
+#endif
+#if OIIO_FMA_ENABLED
+    features |= SIMD_FMA;
+#endif
+#if defined(__F16C__)
+    features |= SIMD_F16C;
+#endif
+#if OIIO_SIMD_AVX >= 512
+    features |= SIMD_AVX512F;
+#endif
+    return features;
+}
+
+
+// Name of the widest ISA among the features (the "simd" attribute).
+static const char *
+simd_level_name (int features)
+{
+    if (features & SIMD_AVX512F) return "avx512f";
+    if (features & SIMD_AVX2)    return "avx2";
+    if (features & SIMD_AVX)     return "avx";
+    if (features & SIMD_SSE42)   return "sse4.2";
+    if (features & SIMD_SSE41)   return "sse4.1";
+    if (features & SIMD_SSSE3)   return "ssse3";
+    if (features & SIMD_SSE3)    return "sse3";
+    if (features & SIMD_SSE2)    return "sse2";
+    return "none";
+}
+
+
+static const int hw_simd = hw_simd_features ();
+static const int build_simd = build_simd_features ();
+static const int avx2_kernel_features = SIMD_AVX2 | SIMD_FMA | SIMD_F16C;
+
+#if OIIO_DISPATCH_AVX2
+// Nonzero if the AVX2 kernels are in use.
+static atomic_int dispatch_avx2 ((hw_simd & avx2_kernel_features) == avx2_kernel_features);
+#endif
+
+
+// The SIMD level the dispatched kernels are currently running at.
+static const char *
+simd_level ()
+{
+#if OIIO_DISPATCH_AVX2
+    if (dispatch_avx2)
+        return simd_level_name (build_simd | avx2_kernel_features);
+#endif
+    return simd_level_name (build_simd);
+}
+
+
+#if OIIO_DISPATCH_AVX2
+
+// AVX2 versions of the convert_type array specializations in fmath.h,
+// computing the same results 8 values at a time.  The remainders fall
+// through to the baseline code.
+
+OIIO_TARGET_AVX2 static void
+convert_avx2 (const unsigned char *src, float *dst, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps (1.0f/std::numeric_limits<uint8_t>::max());
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        __m256i i = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *)src));
+        _mm256_storeu_ps (dst, _mm256_mul_ps (_mm256_cvtepi32_ps (i), scale));
+    }
+    convert_type (src, dst, n);
+}
+
+OIIO_TARGET_AVX2 static void
+convert_avx2 (const unsigned short *src, float *dst, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps (1.0f/std::numeric_limits<uint16_t>::max());
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        __m256i i = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *)src));
+        _mm256_storeu_ps (dst, _mm256_mul_ps (_mm256_cvtepi32_ps (i), scale));
+    }
+    convert_type (src, dst, n);
+}
+
+OIIO_TARGET_AVX2 static void
+convert_avx2 (const half *src, float *dst, size_t n)
+{
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8)
+        _mm256_storeu_ps (dst, _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i *)src)));
+    convert_type (src, dst, n);
+}
+
+// Scale by max, round to nearest and clamp to [0,max], leaving ints.
+OIIO_TARGET_AVX2 static inline __m256i
+quantize_avx2 (const float *src, __m256 max)
+{
+    __m256 scaled = _mm256_round_ps (_mm256_mul_ps (_mm256_loadu_ps (src), max),
+                                     (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
+    __m256 clamped = _mm256_min_ps (_mm256_max_ps (scaled, _mm256_setzero_ps()), max);
+    return _mm256_cvttps_epi32 (clamped);
+}
+
+OIIO_TARGET_AVX2 static void
+convert_avx2 (const float *src, unsigned char *dst, size_t n)
+{
+    const __m256 max = _mm256_set1_ps (std::numeric_limits<uint8_t>::max());
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        __m256i i = quantize_avx2 (src, max);
+        __m128i s = _mm_packus_epi32 (_mm256_castsi256_si128 (i),
+                                      _mm256_extracti128_si256 (i, 1));
+        _mm_storel_epi64 ((__m128i *)dst, _mm_packus_epi16 (s, s));
+    }
+    convert_type (src, dst, n);
+}
+
+OIIO_TARGET_AVX2 static void
+convert_avx2 (const float *src, unsigned short *dst, size_t n)
+{
+    const __m256 max = _mm256_set1_ps (std::numeric_limits<uint16_t>::max());
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        __m256i i = quantize_avx2 (src, max);
+        _mm_storeu_si128 ((__m128i *)dst,
+                          _mm_packus_epi32 (_mm256_castsi256_si128 (i),
+                                            _mm256_extracti128_si256 (i, 1)));
+    }
+    convert_type (src, dst, n);
+}
+
+OIIO_TARGET_AVX2 static void
+convert_avx2 (const float *src, half *dst, size_t n)
+{
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8) {
+        __m128i h = _mm256_cvtps_ph (_mm256_loadu_ps (src),
+                                     (_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC));
+        _mm_storeu_si128 ((__m128i *)dst, h);
+    }
+    convert_type (src, dst, n);
+}
+
+#endif  /* OIIO_DISPATCH_AVX2 */
+
+
+// convert_type for the arrays with SIMD kernels, using the AVX2 versions
+// when they are selected and the compile-time ones otherwise.
+template<typename S, typename D>
+inline void
+convert_dispatch (const S *src, D *dst, size_t n)
+{
+#if OIIO_DISPATCH_AVX2
+    if (dispatch_avx2) {
+        convert_avx2 (src, dst, n);
+        return;
+    }
+#endif
+    convert_type (src, dst, n);
+}
+
+}  // end anon namespace
+
+
+
 int
 openimageio_version ()
 {
@@ -156,6 +457,16 @@ attribute (string_view name, TypeDesc type, const void *val)
         oiio_thread_pool->resize (ot);
         return true;
     }
+    if (name == "threads:affinity" && type == TypeDesc::TypeString) {
+        string_view a (*(const char **)val);
+        if (a == "numa")
+            oiio_thread_pool->set_affinity (thread_pool::AffinityNUMA);
+        else if (a == "cpu")
+            oiio_thread_pool->set_affinity (thread_pool::AffinityCPU);
+        else
+            oiio_thread_pool->set_affinity (thread_pool::AffinityNone);
+        return true;
+    }
     spin_lock lock (attrib_mutex);
     if (name == "read_chunk" && type == TypeDesc::TypeInt) {
         oiio_read_chunk = *(const int *)val;
@@ -177,6 +488,62 @@ attribute (string_view name, TypeDesc type, const void *val)
         print_debug = *(const int *)val;
         return true;
     }
+    if (name == "imagebuf:pool_MB" && type == TypeDesc::TypeInt) {
+        oiio_imagebuf_pool_limit = std::max (0, *(const int *)val) * 1024LL * 1024LL;
+        pvt::imagebuf_pool_trim ();
+        return true;
+    }
+    if (name == "imagebuf:hugepages" && type == TypeDesc::TypeInt) {
+        oiio_imagebuf_hugepages = *(const int *)val;
+        return true;
+    }
+    if (name == "imagebuf:mmap" && type == TypeDesc::TypeInt) {
+        oiio_imagebuf_mmap = *(const int *)val;
+        return true;
+    }
+    if (name == "imagebuf:spill_MB" && type == TypeDesc::TypeInt) {
+        oiio_imagebuf_spill_limit = std::max (0, *(const int *)val) * 1024LL * 1024LL;
+        return true;
+    }
+    if (name == "imagebuf:spill_dir" && type == TypeDesc::TypeString) {
+        oiio_imagebuf_spill_dir = ustring (*(const char **)val);
+        return true;
+    }
+    if (name == "color:precision" && type == TypeDesc::TypeString) {
+        oiio_color_precision = ustring (*(const char **)val);
+        return true;
+    }
+    if (name == "resize:prereduce" && type == TypeDesc::TypeInt) {
+        oiio_resize_prereduce = *(const int *)val;
+        return true;
+    }
+    if (name == "simd" && type == TypeDesc::TypeString) {
+#if OIIO_DISPATCH_AVX2
+        // Only the AVX2 kernels are switchable: any level from avx2 up
+        // enables them (if the hardware can run them), anything less
+        // restricts us to the compile-time ISA.
+        string_view level (*(const char **)val);
+        bool want = (level == "avx2" || level == "avx512f" || level.empty());
+        dispatch_avx2 = want && (hw_simd & avx2_kernel_features) == avx2_kernel_features;
+#endif
+        return true;
+    }
+    if (name == "trace" && type == TypeDesc::TypeInt) {
+        Trace::enable (*(const int *)val != 0);
+        return true;
+    }
+    if (name == "trace:buffer_size" && type == TypeDesc::TypeInt) {
+        Trace::set_buffer_size (*(const int *)val);
+        return true;
+    }
+    if (name == "trace:file" && type == TypeDesc::TypeString) {
+        Trace::write_at_exit (*(const char **)val);
+        return true;
+    }
+    if (name == "stat:imagebuf:local_peak_bytes") {
+        pvt::imagebuf_local_mem_reset_peak ();
+        return true;
+    }
     return false;
 }
 
@@ -189,6 +556,15 @@ getattribute (string_view name, TypeDesc type, void *val)
         *(int *)val = oiio_threads;
         return true;
     }
+    if (name == "threads:affinity" && type == TypeDesc::TypeString) {
+        static const char *names[] = { "none", "numa", "cpu" };
+        *(ustring *)val = ustring (names[oiio_thread_pool->affinity()]);
+        return true;
+    }
+    if (name == "threads:numa_nodes" && type == TypeDesc::TypeInt) {
+        *(int *)val = int (Sysutil::numa_node_cpus().size());
+        return true;
+    }
     spin_lock lock (attrib_mutex);
     if (name == "read_chunk" && type == TypeDesc::TypeInt) {
         *(int *)val = oiio_read_chunk;
@@ -228,6 +604,88 @@ getattribute (string_view name, TypeDesc type, void *val)
         *(int *)val = print_debug;
         return true;
     }
+    if (name == "imagebuf:pool_MB" && type == TypeDesc::TypeInt) {
+        *(int *)val = int (oiio_imagebuf_pool_limit / (1024LL * 1024LL));
+        return true;
+    }
+    if (name == "imagebuf:hugepages" && type == TypeDesc::TypeInt) {
+        *(int *)val = oiio_imagebuf_hugepages;
+        return true;
+    }
+    if (name == "imagebuf:mmap" && type == TypeDesc::TypeInt) {
+        *(int *)val = oiio_imagebuf_mmap;
+        return true;
+    }
+    if (name == "imagebuf:spill_MB" && type == TypeDesc::TypeInt) {
+        *(int *)val = int (oiio_imagebuf_spill_limit / (1024LL * 1024LL));
+        return true;
+    }
+    if (name == "imagebuf:spill_dir" && type == TypeDesc::TypeString) {
+        *(ustring *)val = oiio_imagebuf_spill_dir;
+        return true;
+    }
+    if (name == "color:precision" && type == TypeDesc::TypeString) {
+        *(ustring *)val = oiio_color_precision;
+        return true;
+    }
+    if (name == "resize:prereduce" && type == TypeDesc::TypeInt) {
+        *(int *)val = oiio_resize_prereduce;
+        return true;
+    }
+    if (name == "simd" && type == TypeDesc::TypeString) {
+        *(ustring *)val = ustring (simd_level());
+        return true;
+    }
+    if (name == "hw:simd" && type == TypeDesc::TypeString) {
+        *(ustring *)val = ustring (simd_feature_list (hw_simd));
+        return true;
+    }
+    if (name == "oiio:simd" && type == TypeDesc::TypeString) {
+        *(ustring *)val = ustring (simd_feature_list (build_simd));
+        return true;
+    }
+    if (name == "trace" && type == TypeDesc::TypeInt) {
+        *(int *)val = Trace::enabled ();
+        return true;
+    }
+    if (name == "trace:buffer_size" && type == TypeDesc::TypeInt) {
+        *(int *)val = Trace::buffer_size ();
+        return true;
+    }
+    if (name == "stat:imagebuf:spilled_bytes" && type == TypeDesc::INT64) {
+        *(long long *)val = pvt::imagebuf_spilled_bytes ();
+        return true;
+    }
+    if (Strutil::starts_with (name, "stat:imagebuf:local_") &&
+          type == TypeDesc::INT64) {
+        long long current, peak;
+        pvt::imagebuf_local_mem_stats (current, peak);
+        if (name == "stat:imagebuf:local_bytes") {
+            *(long long *)val = current;
+            return true;
+        }
+        if (name == "stat:imagebuf:local_peak_bytes") {
+            *(long long *)val = peak;
+            return true;
+        }
+    }
+    if (Strutil::starts_with (name, "stat:imagebuf:pool_") &&
+          type == TypeDesc::INT64) {
+        long long pooled, reused, peak;
+        pvt::imagebuf_pool_stats (pooled, reused, peak);
+        if (name == "stat:imagebuf:pool_bytes") {
+            *(long long *)val = pooled;
+            return true;
+        }
+        if (name == "stat:imagebuf:pool_reused_bytes") {
+            *(long long *)val = reused;
+            return true;
+        }
+        if (name == "stat:imagebuf:pool_peak_bytes") {
+            *(long long *)val = peak;
+            return true;
+        }
+    }
     return false;
 }
 
@@ -241,6 +699,28 @@ quantize (float value, long long quant_min, long long quant_max)
 
 namespace {
 
+// Scalar shuffle of pixels [begin,end) for values of type T.
+template<typename T>
+inline void
+shuffle_channels_scalar (const T *src, int srcchans, T *dst, int dstchans,
+                         const int *channelorder, const T *fill,
+                         int begin, int end)
+{
+    src += begin*srcchans;
+    dst += begin*dstchans;
+    for (int i = begin;  i < end;  ++i, src += srcchans, dst += dstchans) {
+        for (int c = 0;  c < dstchans;  ++c) {
+            int o = channelorder[c];
+            if (o >= 0 && o < srcchans)
+                dst[c] = src[o];
+            else if (fill)
+                dst[c] = fill[c];
+        }
+    }
+}
+
+
+
 /// Type-independent template for turning potentially
 /// non-contiguous-stride data (e.g. "RGB RGB ") into contiguous-stride
 /// ("RGBRGB").  Caller must pass in a dst pointing to enough memory to
@@ -261,7 +741,21 @@ _contiguize (const T *src, int nchannels, stride_t xstride, stride_t ystride, st
         depth = 1;
     
     T *dstsave = dst;
-    if (xstride == nchannels*datasize) {
+    if (xstride % datasize == 0 && xstride > nchannels*datasize) {
+        // Padded pixels ("RGBxRGBx"): drop the extra channels, a scanline
+        // at a time, with the channel shuffler.
+        int srcchans = int (xstride / datasize);
+        int *order = ALLOCA (int, nchannels);
+        for (int c = 0;  c < nchannels;  ++c)
+            order[c] = c;
+        for (int z = 0;  z < depth;  ++z, src = (const T *)((char *)src + zstride)) {
+            const T *scanline = src;
+            for (int y = 0;  y < height;  ++y, dst += nchannels*width,
+                 scanline = (const T *)((char *)scanline + ystride))
+                pvt::shuffle_channels (scanline, srcchans, dst, nchannels,
+                                       datasize, order, NULL, width);
+        }
+    } else if (xstride == nchannels*datasize) {
         // Optimize for contiguous scanlines, but not from scanline to scanline
         for (int z = 0;  z < depth;  ++z, src = (const T *)((char *)src + zstride)) {
             const T *scanline = src;
@@ -330,6 +824,96 @@ pvt::contiguize (const void *src, int nchannels,
 
 
 
+void
+pvt::shuffle_channels (const void *src_, int srcchans,
+                       void *dst_, int dstchans, size_t valsize,
+                       const int *channelorder, const void *fill,
+                       int npixels)
+{
+    const char *src = (const char *)src_;
+    char *dst = (char *)dst_;
+    size_t sp = srcchans * valsize, dp = dstchans * valsize;
+    int i = 0;
+#if OIIO_SIMD_SSE >= 3
+    // Shuffle k whole pixels per 16 byte load with a byte permutation.
+    // The dst bytes past those k pixels (and those of channels left
+    // alone) are blended back from what was there, and are rewritten by
+    // the following step; so the loop must stop short of the end of
+    // both buffers.
+    size_t k = std::min (16/sp, 16/dp);
+    if (k >= 1) {
+        OIIO_ALIGN(16) unsigned char shuf[16], keep[16], fillbytes[16];
+        bool anykeep = false;
+        for (size_t b = 0;  b < 16;  ++b) {
+            shuf[b] = 0x80;   // zero
+            keep[b] = 0xff;
+            fillbytes[b] = 0;
+            if (b < k*dp) {
+                size_t p = b / dp, c = (b % dp) / valsize, byte = b % valsize;
+                int o = channelorder[c];
+                if (o >= 0 && o < srcchans) {
+                    shuf[b] = (unsigned char) (p*sp + o*valsize + byte);
+                    keep[b] = 0;
+                } else if (fill) {
+                    fillbytes[b] = ((const unsigned char *)fill)[c*valsize+byte];
+                    keep[b] = 0;
+                }
+            }
+            anykeep |= (keep[b] != 0);
+        }
+        __m128i S = _mm_load_si128 ((const __m128i *)shuf);
+        __m128i K = _mm_load_si128 ((const __m128i *)keep);
+        __m128i F = _mm_load_si128 ((const __m128i *)fillbytes);
+        size_t srcbytes = npixels * sp, dstbytes = npixels * dp;
+        for ( ;  i*sp + 16 <= srcbytes && i*dp + 16 <= dstbytes;  i += int(k)) {
+            __m128i v = _mm_loadu_si128 ((const __m128i *)(src + i*sp));
+            v = _mm_or_si128 (_mm_shuffle_epi8 (v, S), F);
+            if (anykeep)
+                v = _mm_or_si128 (v, _mm_and_si128 (K,
+                        _mm_loadu_si128 ((const __m128i *)(dst + i*dp))));
+            _mm_storeu_si128 ((__m128i *)(dst + i*dp), v);
+        }
+    }
+#endif
+    switch (valsize) {
+    case 1 :
+        shuffle_channels_scalar ((const uint8_t *)src, srcchans,
+                                 (uint8_t *)dst, dstchans, channelorder,
+                                 (const uint8_t *)fill, i, npixels);
+        break;
+    case 2 :
+        shuffle_channels_scalar ((const uint16_t *)src, srcchans,
+                                 (uint16_t *)dst, dstchans, channelorder,
+                                 (const uint16_t *)fill, i, npixels);
+        break;
+    case 4 :
+        shuffle_channels_scalar ((const uint32_t *)src, srcchans,
+                                 (uint32_t *)dst, dstchans, channelorder,
+                                 (const uint32_t *)fill, i, npixels);
+        break;
+    case 8 :
+        shuffle_channels_scalar ((const uint64_t *)src, srcchans,
+                                 (uint64_t *)dst, dstchans, channelorder,
+                                 (const uint64_t *)fill, i, npixels);
+        break;
+    default :
+        for ( ;  i < npixels;  ++i) {
+            const char *s = src + i*sp;
+            char *d = dst + i*dp;
+            for (int c = 0;  c < dstchans;  ++c) {
+                int o = channelorder[c];
+                if (o >= 0 && o < srcchans)
+                    memcpy (d + c*valsize, s + o*valsize, valsize);
+                else if (fill)
+                    memcpy (d + c*valsize, (const char *)fill + c*valsize,
+                            valsize);
+            }
+        }
+    }
+}
+
+
+
 const float *
 pvt::convert_to_float (const void *src, float *dst, int nvals,
                        TypeDesc format)
@@ -338,13 +922,13 @@ pvt::convert_to_float (const void *src, float *dst, int nvals,
     case TypeDesc::FLOAT :
         return (float *)src;
     case TypeDesc::UINT8 :
-        convert_type ((const unsigned char *)src, dst, nvals);
+        convert_dispatch ((const unsigned char *)src, dst, nvals);
         break;
     case TypeDesc::HALF :
-        convert_type ((const half *)src, dst, nvals);
+        convert_dispatch ((const half *)src, dst, nvals);
         break;
     case TypeDesc::UINT16 :
-        convert_type ((const unsigned short *)src, dst, nvals);
+        convert_dispatch ((const unsigned short *)src, dst, nvals);
         break;
     case TypeDesc::INT8:
         convert_type ((const char *)src, dst, nvals);
@@ -504,9 +1088,9 @@ convert_types (TypeDesc src_type, const void *src,
 
     // Convert float to 'dst_type'
     switch (dst_type.basetype) {
-    case TypeDesc::UINT8 :  convert_type (buf, (unsigned char *)dst, n);  break;
-    case TypeDesc::UINT16 : convert_type (buf, (unsigned short *)dst, n); break;
-    case TypeDesc::HALF :   convert_type (buf, (half *)dst, n);   break;
+    case TypeDesc::UINT8 :  convert_dispatch (buf, (unsigned char *)dst, n);  break;
+    case TypeDesc::UINT16 : convert_dispatch (buf, (unsigned short *)dst, n); break;
+    case TypeDesc::HALF :   convert_dispatch (buf, (half *)dst, n);   break;
     case TypeDesc::INT8 :   convert_type (buf, (char *)dst, n);   break;
     case TypeDesc::INT16 :  convert_type (buf, (short *)dst, n);  break;
     case TypeDesc::INT :    convert_type (buf, (int *)dst, n);  break;
@@ -575,6 +1159,165 @@ convert_image (int nchannels, int width, int height, int depth,
 
 
 
+namespace {
+
+#if OIIO_SIMD_SSE >= 3
+// Byte permutation between 4 interleaved 4-channel uint8 pixels and their
+// values grouped by channel (RRRRGGGGBBBBAAAA); it is its own inverse.
+static const OIIO_ALIGN(16) unsigned char rgba8_by_channel[16] =
+    { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 };
+#endif
+
+
+// Convert pixels [begin,end) between planar and interleaved layout; this
+// is the whole job of planar_to_interleaved / interleaved_to_planar for
+// one chunk of pixels.
+bool
+planar_interleave_chunk (bool to_interleaved, int nchannels,
+                         const char *src, TypeDesc src_type,
+                         stride_t src_planestride,
+                         char *dst, TypeDesc dst_type,
+                         stride_t dst_planestride,
+                         int64_t begin, int64_t end)
+{
+    size_t ssize = src_type.size(), dsize = dst_type.size();
+    int64_t i = begin;
+#if OIIO_SIMD_SSE >= 3
+    if (src_type == dst_type && nchannels == 4 && (ssize == 4 || ssize == 1)) {
+        // 4 channels of 4-byte values are a 4x4 transpose of 4 pixels;
+        // 4 channels of bytes are the same transpose of 16 pixels (as 32
+        // bit groups of 4 pixels' values) plus a byte permutation.
+        int64_t step = (ssize == 4) ? 4 : 16;
+        __m128i perm = _mm_load_si128 ((const __m128i *)rgba8_by_channel);
+        stride_t planestride = to_interleaved ? src_planestride : dst_planestride;
+        for ( ;  i + step <= end;  i += step) {
+            __m128 v[4];
+            for (int c = 0;  c < 4;  ++c) {
+                const char *p = to_interleaved ? src + c*planestride + i*ssize
+                                               : src + (i*4 + c*step) * ssize;
+                v[c] = _mm_loadu_ps ((const float *)p);
+                if (ssize == 1 && ! to_interleaved)
+                    v[c] = _mm_castsi128_ps (_mm_shuffle_epi8 (_mm_castps_si128 (v[c]), perm));
+            }
+            _MM_TRANSPOSE4_PS (v[0], v[1], v[2], v[3]);
+            for (int c = 0;  c < 4;  ++c) {
+                if (ssize == 1 && to_interleaved)
+                    v[c] = _mm_castsi128_ps (_mm_shuffle_epi8 (_mm_castps_si128 (v[c]), perm));
+                char *p = to_interleaved ? dst + (i*4 + c*step) * ssize
+                                         : dst + c*planestride + i*ssize;
+                _mm_storeu_ps ((float *)p, v[c]);
+            }
+        }
+    }
+#endif
+#if OIIO_SIMD_SSE >= 2
+    if (src_type == dst_type && nchannels == 4 && ssize == 2 && to_interleaved) {
+        // 4 channels of 16 bit values (typical of separate-plane TIFF):
+        // two rounds of unpacking interleave 8 pixels at a time.
+        for ( ;  i + 8 <= end;  i += 8) {
+            __m128i v[4];
+            for (int c = 0;  c < 4;  ++c)
+                v[c] = _mm_loadu_si128 ((const __m128i *)(src + c*src_planestride + i*2));
+            __m128i rglo = _mm_unpacklo_epi16 (v[0], v[1]);
+            __m128i rghi = _mm_unpackhi_epi16 (v[0], v[1]);
+            __m128i balo = _mm_unpacklo_epi16 (v[2], v[3]);
+            __m128i bahi = _mm_unpackhi_epi16 (v[2], v[3]);
+            __m128i *p = (__m128i *)(dst + i*8);
+            _mm_storeu_si128 (p+0, _mm_unpacklo_epi32 (rglo, balo));
+            _mm_storeu_si128 (p+1, _mm_unpackhi_epi32 (rglo, balo));
+            _mm_storeu_si128 (p+2, _mm_unpacklo_epi32 (rghi, bahi));
+            _mm_storeu_si128 (p+3, _mm_unpackhi_epi32 (rghi, bahi));
+        }
+    }
+#endif
+    if (i >= end)
+        return true;
+    // Everything else: one strided conversion per channel
+    bool ok = true;
+    int64_t n = end - i;
+    for (int c = 0;  c < nchannels;  ++c) {
+        if (to_interleaved)
+            ok &= convert_image (1, int(n), 1, 1,
+                                 src + c*src_planestride + i*ssize, src_type,
+                                 ssize, AutoStride, AutoStride,
+                                 dst + (i*nchannels + c)*dsize, dst_type,
+                                 nchannels*dsize, AutoStride, AutoStride);
+        else
+            ok &= convert_image (1, int(n), 1, 1,
+                                 src + (i*nchannels + c)*ssize, src_type,
+                                 nchannels*ssize, AutoStride, AutoStride,
+                                 dst + c*dst_planestride + i*dsize, dst_type,
+                                 dsize, AutoStride, AutoStride);
+    }
+    return ok;
+}
+
+
+
+bool
+planar_interleave (bool to_interleaved, int nchannels, int width,
+                   int height, int depth, const void *src, TypeDesc src_type,
+                   stride_t src_planestride, void *dst, TypeDesc dst_type,
+                   stride_t dst_planestride, int nthreads)
+{
+    int64_t npixels = int64_t(width) * height * std::max (depth, 1);
+    if (src_planestride == AutoStride)
+        src_planestride = npixels * src_type.size();
+    if (dst_planestride == AutoStride)
+        dst_planestride = npixels * dst_type.size();
+    if (nthreads <= 0)
+        nthreads = oiio_threads;
+    const int64_t chunk = 16384;
+    if (nthreads <= 1 || npixels <= chunk)
+        return planar_interleave_chunk (to_interleaved, nchannels,
+                                        (const char *)src, src_type,
+                                        src_planestride, (char *)dst,
+                                        dst_type, dst_planestride, 0, npixels);
+    atomic_int ok (1);
+    parallel_for_chunked (0, npixels, chunk, [&](int64_t b, int64_t e) {
+        if (! planar_interleave_chunk (to_interleaved, nchannels,
+                                       (const char *)src, src_type,
+                                       src_planestride, (char *)dst,
+                                       dst_type, dst_planestride, b, e))
+            ok = 0;
+    });
+    return ok != 0;
+}
+
+}  // anon namespace
+
+
+
+bool
+planar_to_interleaved (int nchannels, int width, int height, int depth,
+                       const void *src, TypeDesc src_type,
+                       stride_t src_planestride,
+                       void *dst, TypeDesc dst_type, int nthreads)
+{
+    if (dst_type == TypeDesc::UNKNOWN)
+        dst_type = src_type;
+    return planar_interleave (true, nchannels, width, height, depth,
+                              src, src_type, src_planestride,
+                              dst, dst_type, AutoStride, nthreads);
+}
+
+
+
+bool
+interleaved_to_planar (int nchannels, int width, int height, int depth,
+                       const void *src, TypeDesc src_type,
+                       void *dst, TypeDesc dst_type,
+                       stride_t dst_planestride, int nthreads)
+{
+    if (dst_type == TypeDesc::UNKNOWN)
+        dst_type = src_type;
+    return planar_interleave (false, nchannels, width, height, depth,
+                              src, src_type, AutoStride,
+                              dst, dst_type, dst_planestride, nthreads);
+}
+
+
+
 bool
 parallel_convert_image (int nchannels, int width, int height, int depth,
                const void *src, TypeDesc src_type,
@@ -660,6 +1403,21 @@ copy_image (int nchannels, int width, int height, int depth,
 
 
 
+// bjhash::bjmix on four sets of values at once.
+OIIO_FORCEINLINE void
+bjmix4 (simd::int4 &a, simd::int4 &b, simd::int4 &c)
+{
+    using simd::rotl32;
+    a -= c;  a ^= rotl32(c, 4);  c += b;
+    b -= a;  b ^= rotl32(a, 6);  a += c;
+    c -= b;  c ^= rotl32(b, 8);  b += a;
+    a -= c;  a ^= rotl32(c,16);  c += b;
+    b -= a;  b ^= rotl32(a,19);  a += c;
+    c -= b;  c ^= rotl32(b, 4);  b += a;
+}
+
+
+
 void
 add_dither (int nchannels, int width, int height, int depth,
             float *data, stride_t xstride, stride_t ystride, stride_t zstride,
@@ -667,25 +1425,36 @@ add_dither (int nchannels, int width, int height, int depth,
             int alpha_channel, int z_channel, unsigned int ditherseed,
             int chorigin, int xorigin, int yorigin, int zorigin)
 {
+    using simd::int4;
     ImageSpec::auto_stride (xstride, ystride, zstride,
                             sizeof(float), nchannels, width, height);
+    // The dither of each scanline is its own sequence of hashes, seeded
+    // only by its y and z (and the channel and x origins), so we run
+    // four scanlines at once, one in each SIMD lane.  Each value is
+    // exactly what the scanline-at-a-time loop would give.
     char *plane = (char *)data;
     for (int z = 0;  z < depth;  ++z, plane += zstride) {
-        char *scanline = plane;
-        for (int y = 0;  y < height;  ++y, scanline += ystride) {
-            char *pixel = scanline;
-            uint32_t ba = (z+zorigin)*1311 + yorigin+y;
-            uint32_t bb = ditherseed + (chorigin<<24);
-            uint32_t bc = xorigin;
-            for (int x = 0;  x < width;  ++x, pixel += xstride) {
-                float *val = (float *)pixel;
-                for (int c = 0;  c < nchannels;  ++c, ++val, ++bc) {
-                    bjhash::bjmix (ba, bb, bc);
+        for (int y = 0;  y < height;  y += 4) {
+            int nlanes = std::min (4, height-y);
+            char *scanline = plane + y*ystride;
+            uint32_t ba0 = (z+zorigin)*1311 + yorigin+y;
+            int4 ba = int4(int(ba0)) + int4::Iota();
+            int4 bb (int(ditherseed + (chorigin<<24)));
+            int4 bc (xorigin);
+            const int4 one (1);
+            OIIO_SIMD4_ALIGN uint32_t dither[4];
+            for (int x = 0;  x < width;  ++x) {
+                for (int c = 0;  c < nchannels;  ++c, bc += one) {
+                    bjmix4 (ba, bb, bc);
                     int channel = c+chorigin;
                     if (channel == alpha_channel || channel == z_channel)
                         continue;
-                    float dither = bc / float(std::numeric_limits<uint32_t>::max());
-                    *val += ditheramplitude * (dither - 0.5f);
+                    bc.store ((int *)dither);
+                    for (int l = 0;  l < nlanes;  ++l) {
+                        float *val = (float *)(scanline + l*ystride + x*xstride) + c;
+                        float d = dither[l] / float(std::numeric_limits<uint32_t>::max());
+                        *val += ditheramplitude * (d - 0.5f);
+                    }
                 }
             }
         }
@@ -30,7 +30,11 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -65,6 +69,33 @@ static std::map <std::string, Plugin::Handle> plugin_handles;
 static std::map <std::string, std::string> plugin_filepaths;
 // Map format name to underlying implementation library
 static std::map <std::string, std::string> format_library_versions;
+// Formats already in format_list/extension_list/library_list
+static std::set <std::string> listed_formats;
+// Full search paths that catalog_all_plugins has already scanned
+static std::set <std::string> searched_paths;
+
+// What we remember about an external plugin in the on-disk catalog, so
+// that later processes needn't dlopen it just to learn its extensions.
+struct CatalogEntry {
+    std::time_t mtime;               // Identify the plugin file version
+    uint64_t size;
+    std::string format;
+    bool has_input, has_output;      // Neither means "not a usable plugin"
+    std::vector<std::string> input_extensions, output_extensions;
+    std::string lib_version;
+};
+// Map plugin full path to its catalog entry
+static std::map <std::string, CatalogEntry> plugin_catalog;
+static bool plugin_catalog_loaded = false;
+static bool plugin_catalog_dirty = false;
+// Plugins found through the catalog but not yet loaded: full path to
+// format name, and extensions to full path.
+static std::map <std::string, std::string> deferred_plugins;
+static std::map <std::string, std::string> deferred_input_extensions;
+static std::map <std::string, std::string> deferred_output_extensions;
+// Map ImageInput creator to the byte signatures that begin every file it
+// can read (-1 in a signature matches any byte).
+static std::map <ImageInput::Creator, std::vector<std::vector<int> > > input_magic;
 
 
 
@@ -72,8 +103,9 @@ static std::string pattern = Strutil::format (".imageio.%s",
                                               Plugin::plugin_extension());
 
 
+template<class T>
 inline void
-add_if_missing (std::vector<std::string> &vec, const std::string &val)
+add_if_missing (std::vector<T> &vec, const T &val)
 {
     if (std::find (vec.begin(), vec.end(), val) == vec.end())
         vec.push_back (val);
@@ -83,6 +115,12 @@ add_if_missing (std::vector<std::string> &vec, const std::string &val)
 
 
 
+static void add_format_to_lists (const std::string &format_name,
+                                 const std::vector<std::string> &all_extensions,
+                                 const char *lib_version);
+
+
+
 /// Register the input and output 'create' routine and list of file
 /// extensions for a particular format.
 void
@@ -123,9 +161,21 @@ declare_imageio_format (const std::string &format_name,
         }
     }
 
-    // Add the name to the master list of format_names, and extensions to
-    // their master list.
+    add_format_to_lists (format_name, all_extensions, lib_version);
+}
+
+
+
+/// Add the name to the master list of format_names, and extensions to
+/// their master list (just once per format).
+static void
+add_format_to_lists (const std::string &format_name,
+                     const std::vector<std::string> &all_extensions,
+                     const char *lib_version)
+{
     recursive_lock_guard lock (pvt::imageio_mutex);
+    if (! listed_formats.insert (format_name).second)
+        return;   // already listed
     if (format_list.length())
         format_list += std::string(",");
     format_list += format_name;
@@ -143,6 +193,302 @@ declare_imageio_format (const std::string &format_name,
 }
 
 
+// The plugin catalog cache lives in $OIIO_PLUGIN_CACHE if that's set
+// (setting it to "" or "0" turns the cache off), otherwise in the user's
+// cache directory.  It is specific to this OIIO version.
+/// Register the byte signatures ("magic numbers") that start any file the
+/// given ImageInput can read.  Each is a string of hex digit pairs, with
+/// "??" standing for any byte; the list is terminated by NULL.
+static void
+declare_imageio_magic (ImageInput::Creator input_creator, const char **magic)
+{
+    if (! input_creator || ! magic)
+        return;
+    recursive_lock_guard lock (pvt::imageio_mutex);
+    std::vector<std::vector<int> > &sigs (input_magic[input_creator]);
+    for (const char **m = magic; *m; ++m) {
+        std::vector<int> sig;
+        for (const char *c = *m; c[0] && c[1]; c += 2) {
+            if (c[0] == '?' && c[1] == '?')
+                sig.push_back (-1);
+            else
+                sig.push_back ((int) strtol (std::string(c, 2).c_str(),
+                                             NULL, 16));
+        }
+        if (sig.size())
+            sigs.push_back (sig);
+    }
+}
+
+
+
+/// Does the file header match any of the signatures?
+static bool
+magic_matches (const std::vector<std::vector<int> > &sigs,
+               const unsigned char *header, size_t len)
+{
+    for (auto&& sig : sigs) {
+        if (sig.size() > len)
+            continue;
+        size_t i = 0;
+        while (i < sig.size() && (sig[i] < 0 || sig[i] == header[i]))
+            ++i;
+        if (i == sig.size())
+            return true;
+    }
+    return false;
+}
+
+
+
+static std::string
+plugin_catalog_filename ()
+{
+    const char *env = getenv ("OIIO_PLUGIN_CACHE");
+    if (env)
+        return strcmp (env, "0") ? std::string(env) : std::string();
+    std::string dir;
+#ifdef _WIN32
+    if (const char *appdata = getenv ("LOCALAPPDATA"))
+        dir = appdata;
+#else
+    const char *xdg = getenv ("XDG_CACHE_HOME");
+    const char *home = getenv ("HOME");
+    if (xdg && *xdg)
+        dir = xdg;
+    else if (home && *home)
+        dir = std::string(home) + "/.cache";
+#endif
+    if (dir.empty())
+        return dir;
+    return Strutil::format ("%s/OpenImageIO/plugincatalog-%d.txt",
+                            dir, OIIO_VERSION);
+}
+
+
+
+static std::string catalog_header = Strutil::format ("OIIO plugin catalog %d",
+                                                     OIIO_PLUGIN_VERSION);
+
+
+
+// Read the catalog file, once.  Each line is tab-separated:
+//   path mtime size format has_input input_exts has_output output_exts libversion
+static void
+load_plugin_catalog ()
+{
+    if (plugin_catalog_loaded)
+        return;
+    plugin_catalog_loaded = true;
+    std::string filename = plugin_catalog_filename ();
+    std::string text;
+    if (filename.empty() || ! Filesystem::read_text_file (filename, text))
+        return;
+    std::vector<std::string> lines;
+    Strutil::split (text, lines, "\n");
+    if (lines.empty() || lines[0] != catalog_header)
+        return;   // Different plugin version, start from scratch
+    for (size_t i = 1; i < lines.size(); ++i) {
+        std::vector<std::string> f;
+        Strutil::split (lines[i], f, "\t");
+        if (f.size() != 9)
+            continue;
+        CatalogEntry e;
+        e.mtime = (std::time_t) strtoll (f[1].c_str(), NULL, 10);
+        e.size = (uint64_t) strtoull (f[2].c_str(), NULL, 10);
+        e.format = f[3];
+        e.has_input = f[4] == "1";
+        if (f[5].size())
+            Strutil::split (f[5], e.input_extensions, ",");
+        e.has_output = f[6] == "1";
+        if (f[7].size())
+            Strutil::split (f[7], e.output_extensions, ",");
+        e.lib_version = f[8];
+        plugin_catalog[f[0]] = e;
+    }
+}
+
+
+
+// Write the catalog back out if we learned anything new.  Write to a
+// temporary and rename, so that concurrent processes never see a
+// partial file.
+static void
+save_plugin_catalog ()
+{
+    if (! plugin_catalog_dirty)
+        return;
+    plugin_catalog_dirty = false;
+    std::string filename = plugin_catalog_filename ();
+    if (filename.empty())
+        return;
+    std::string err;
+    std::string dir = Filesystem::parent_path (filename);
+    if (! Filesystem::exists (dir)) {
+        Filesystem::create_directory (Filesystem::parent_path (dir), err);
+        Filesystem::create_directory (dir, err);
+    }
+    std::string tmpname = filename + "." + Filesystem::unique_path ();
+    {
+        OIIO::ofstream out;
+        Filesystem::open (out, tmpname);
+        if (! out)
+            return;
+        out << catalog_header << "\n";
+        for (const auto &p : plugin_catalog) {
+            if (! Filesystem::exists (p.first))
+                continue;   // prune plugins that have gone away
+            const CatalogEntry &e (p.second);
+            out << p.first << '\t' << (long long) e.mtime << '\t'
+                << (unsigned long long) e.size << '\t' << e.format << '\t'
+                << (e.has_input ? 1 : 0) << '\t'
+                << Strutil::join (e.input_extensions, ",") << '\t'
+                << (e.has_output ? 1 : 0) << '\t'
+                << Strutil::join (e.output_extensions, ",") << '\t'
+                << e.lib_version << "\n";
+        }
+        if (! out) {
+            out.close ();
+            Filesystem::remove (tmpname, err);
+            return;
+        }
+    }
+    if (! Filesystem::rename (tmpname, filename, err))
+        Filesystem::remove (tmpname, err);
+}
+
+
+
+// Remember what we learned from actually loading a plugin.
+static void
+record_catalog_entry (const std::string &format_name,
+                      const std::string &plugin_fullpath,
+                      bool has_input, const char **input_extensions,
+                      bool has_output, const char **output_extensions,
+                      const char *lib_version)
+{
+    CatalogEntry e;
+    e.mtime = Filesystem::last_write_time (plugin_fullpath);
+    e.size = Filesystem::file_size (plugin_fullpath);
+    e.format = format_name;
+    e.has_input = has_input;
+    e.has_output = has_output;
+    for (const char **x = input_extensions; has_input && x && *x; ++x)
+        e.input_extensions.push_back (*x);
+    for (const char **x = output_extensions; has_output && x && *x; ++x)
+        e.output_extensions.push_back (*x);
+    // The catalog is line- and tab-delimited
+    e.lib_version = lib_version ? lib_version : "";
+    for (char &c : e.lib_version)
+        if (c == '\t' || c == '\n')
+            c = ' ';
+    plugin_catalog[plugin_fullpath] = e;
+    plugin_catalog_dirty = true;
+}
+
+
+
+// If the catalog has an up to date entry for this plugin, register its
+// extensions without loading it and return true.  Return false if the
+// plugin needs to be loaded to find out about it.
+static bool
+defer_plugin (const std::string &format_name,
+              const std::string &plugin_fullpath)
+{
+    load_plugin_catalog ();
+    std::map<std::string, CatalogEntry>::const_iterator found =
+        plugin_catalog.find (plugin_fullpath);
+    if (found == plugin_catalog.end())
+        return false;
+    const CatalogEntry &e (found->second);
+    if (e.format != format_name ||
+        e.mtime != Filesystem::last_write_time (plugin_fullpath) ||
+        e.size != Filesystem::file_size (plugin_fullpath))
+        return false;   // stale
+    if (! e.has_input && ! e.has_output)
+        return true;    // known not to be useful
+    if (plugin_filepaths.find (format_name) != plugin_filepaths.end())
+        return true;    // already loaded
+    for (const auto &d : deferred_plugins)
+        if (d.second == format_name)
+            return true;   // first one wins, as in catalog_plugin
+
+    deferred_plugins[plugin_fullpath] = format_name;
+    std::vector<std::string> all_extensions;
+    for (std::string ext : e.input_extensions) {
+        Strutil::to_lower (ext);
+        if (input_formats.find (ext) == input_formats.end() &&
+            deferred_input_extensions.find (ext) == deferred_input_extensions.end()) {
+            deferred_input_extensions[ext] = plugin_fullpath;
+            add_if_missing (all_extensions, ext);
+        }
+    }
+    for (std::string ext : e.output_extensions) {
+        Strutil::to_lower (ext);
+        if (output_formats.find (ext) == output_formats.end() &&
+            deferred_output_extensions.find (ext) == deferred_output_extensions.end()) {
+            deferred_output_extensions[ext] = plugin_fullpath;
+            add_if_missing (all_extensions, ext);
+        }
+    }
+    add_format_to_lists (format_name, all_extensions,
+                         e.lib_version.size() ? e.lib_version.c_str() : NULL);
+    return true;
+}
+
+
+
+static void catalog_plugin (const std::string &format_name,
+                            const std::string &plugin_fullpath);
+
+
+
+// Actually load a plugin that we had deferred.
+static void
+load_deferred_plugin (const std::string &plugin_fullpath)
+{
+    std::map<std::string, std::string>::iterator found =
+        deferred_plugins.find (plugin_fullpath);
+    if (found == deferred_plugins.end())
+        return;
+    std::string format_name = found->second;
+    deferred_plugins.erase (found);
+    for (auto i = deferred_input_extensions.begin();
+         i != deferred_input_extensions.end(); )
+        i = (i->second == plugin_fullpath) ? deferred_input_extensions.erase (i) : ++i;
+    for (auto i = deferred_output_extensions.begin();
+         i != deferred_output_extensions.end(); )
+        i = (i->second == plugin_fullpath) ? deferred_output_extensions.erase (i) : ++i;
+    catalog_plugin (format_name, plugin_fullpath);
+}
+
+
+
+// Load the deferred plugin (if any) that handles the given extension.
+static bool
+load_deferred_plugin_for (const std::string &ext, bool input)
+{
+    std::map<std::string, std::string> &exts (input ? deferred_input_extensions
+                                                     : deferred_output_extensions);
+    std::map<std::string, std::string>::const_iterator found = exts.find (ext);
+    if (found == exts.end())
+        return false;
+    load_deferred_plugin (std::string (found->second));
+    return true;
+}
+
+
+
+// Load every deferred plugin, for when we must try them all.
+static void
+load_all_deferred_plugins ()
+{
+    while (deferred_plugins.size())
+        load_deferred_plugin (std::string (deferred_plugins.begin()->first));
+}
+
+
+
 static void
 catalog_plugin (const std::string &format_name,
                 const std::string &plugin_fullpath)
@@ -172,6 +518,8 @@ catalog_plugin (const std::string &format_name,
     int *plugin_version = (int *) Plugin::getsym (handle, version_function.c_str());
     if (! plugin_version || *plugin_version != OIIO_PLUGIN_VERSION) {
         Plugin::close (handle);
+        record_catalog_entry (format_name, plugin_fullpath, false, NULL,
+                              false, NULL, NULL);
         return;
     }
 
@@ -191,12 +539,21 @@ catalog_plugin (const std::string &format_name,
         (ImageOutput::Creator) Plugin::getsym (handle, format_name+"_output_imageio_create");
     const char **output_extensions =
         (const char **) Plugin::getsym (handle, format_name+"_output_extensions");
-
+    const char **magic =
+        (const char **) Plugin::getsym (handle, format_name+"_input_magic");
+
+    const char *lib_version = plugin_lib_version ? plugin_lib_version() : NULL;
+    record_catalog_entry (format_name, plugin_fullpath,
+                          input_creator != NULL, input_extensions,
+                          output_creator != NULL, output_extensions,
+                          lib_version);
     if (input_creator || output_creator)
         declare_imageio_format (format_name, input_creator, input_extensions,
                                 output_creator, output_extensions,
-                                plugin_lib_version ? plugin_lib_version() : NULL);
-    else
+                                lib_version);
+    if (input_creator)
+        declare_imageio_magic (input_creator, magic);
+    if (! (input_creator || output_creator))
         Plugin::close (handle);   // not useful
 }
 
@@ -214,6 +571,9 @@ catalog_plugin (const std::string &format_name,
     extern const char *name ## _output_extensions[];    \
     extern const char *name ## _input_extensions[];     \
     extern const char *name ## _imageio_library_version();
+// Also for the plugins that declare the magic numbers of their files.
+#define PLUGMAGIC(name)                                 \
+    extern const char *name ## _input_magic[];
 
     PLUGENTRY (bmp);
     PLUGENTRY (cineon);
@@ -237,6 +597,7 @@ catalog_plugin (const std::string &format_name,
     PLUGENTRY (raw);
     PLUGENTRY (rla);
     PLUGENTRY (sgi);
+    PLUGENTRY (shm);
     PLUGENTRY (socket);
     PLUGENTRY (softimage);
     PLUGENTRY (tiff);
@@ -244,6 +605,25 @@ catalog_plugin (const std::string &format_name,
     PLUGENTRY (webp);
     PLUGENTRY (zfile);
 
+    PLUGMAGIC (bmp);
+    PLUGMAGIC (cineon);
+    PLUGMAGIC (dds);
+    PLUGMAGIC (dpx);
+    PLUGMAGIC (fits);
+    PLUGMAGIC (gif);
+    PLUGMAGIC (ico);
+    PLUGMAGIC (iff);
+    PLUGMAGIC (jpeg);
+    PLUGMAGIC (jpeg2000);
+    PLUGMAGIC (openexr);
+    PLUGMAGIC (png);
+    PLUGMAGIC (psd);
+    PLUGMAGIC (ptex);
+    PLUGMAGIC (sgi);
+    PLUGMAGIC (softimage);
+    PLUGMAGIC (tiff);
+    PLUGMAGIC (webp);
+    PLUGMAGIC (zfile);
 
 #endif // defined(EMBED_PLUGINS)
 
@@ -266,14 +646,22 @@ catalog_builtin_plugins ()
                    (ImageOutput::Creator) name ## _output_imageio_create, \
                    name ## _output_extensions,                            \
                    name ## _imageio_library_version())
+#define DECLAREMAGIC(name)                                                \
+    declare_imageio_magic (                                               \
+                   (ImageInput::Creator) name ## _input_imageio_create,   \
+                   name ## _input_magic)
 
     DECLAREPLUG (bmp);
+    DECLAREMAGIC (bmp);
     DECLAREPLUG (cineon);
+    DECLAREMAGIC (cineon);
     DECLAREPLUG (dds);
+    DECLAREMAGIC (dds);
 #ifdef USE_DCMTK
     DECLAREPLUG (dicom);
 #endif
     DECLAREPLUG (dpx);
+    DECLAREMAGIC (dpx);
 #ifdef USE_FFMPEG
     DECLAREPLUG (ffmpeg);
 #endif
@@ -281,38 +669,56 @@ catalog_builtin_plugins ()
     DECLAREPLUG (field3d);
 #endif
     DECLAREPLUG (fits);
+    DECLAREMAGIC (fits);
 #ifdef USE_GIF
     DECLAREPLUG (gif);
+    DECLAREMAGIC (gif);
 #endif
     DECLAREPLUG (hdr);
     DECLAREPLUG (ico);
+    DECLAREMAGIC (ico);
     DECLAREPLUG (iff);
+    DECLAREMAGIC (iff);
     DECLAREPLUG (jpeg);
+    DECLAREMAGIC (jpeg);
 #ifdef USE_OPENJPEG
     DECLAREPLUG (jpeg2000);
+    DECLAREMAGIC (jpeg2000);
 #endif
     DECLAREPLUG (openexr);
+    DECLAREMAGIC (openexr);
     DECLAREPLUG (png);
+    DECLAREMAGIC (png);
     DECLAREPLUG (pnm);
     DECLAREPLUG (psd);
+    DECLAREMAGIC (psd);
 #ifdef USE_PTEX
     DECLAREPLUG (ptex);
+    DECLAREMAGIC (ptex);
 #endif
 #ifdef USE_LIBRAW
     DECLAREPLUG (raw);
 #endif
     DECLAREPLUG (rla);
     DECLAREPLUG (sgi);
+    DECLAREMAGIC (sgi);
+#ifdef USE_SHM_IMAGEIO
+    DECLAREPLUG (shm);
+#endif
 #ifdef USE_BOOST_ASIO
     DECLAREPLUG (socket);
 #endif
     DECLAREPLUG (softimage);
+    DECLAREMAGIC (softimage);
     DECLAREPLUG (tiff);
+    DECLAREMAGIC (tiff);
     DECLAREPLUG (targa);
 #ifdef USE_WEBP
     DECLAREPLUG (webp);
+    DECLAREMAGIC (webp);
 #endif
     DECLAREPLUG (zfile);
+    DECLAREMAGIC (zfile);
 #endif
 }
 
@@ -345,7 +751,11 @@ append_if_env_exists (std::string &searchpath, const char *env,
 void
 pvt::catalog_all_plugins (std::string searchpath)
 {
-    catalog_builtin_plugins ();
+    static bool builtins_done = false;
+    if (! builtins_done) {
+        catalog_builtin_plugins ();
+        builtins_done = true;
+    }
 
     append_if_env_exists (searchpath, "OIIO_LIBRARY_PATH", true);
 #ifdef __APPLE__
@@ -354,6 +764,10 @@ pvt::catalog_all_plugins (std::string searchpath)
 #if defined(__linux__) || defined(__FreeBSD__)
     append_if_env_exists (searchpath, "LD_LIBRARY_PATH");
 #endif
+    // Directory scans can be slow (think network home directories), so
+    // each search path only gets scanned once.
+    if (! searched_paths.insert (searchpath).second)
+        return;
 
     size_t patlen = pattern.length();
     std::vector<std::string> dirs;
@@ -367,10 +781,14 @@ pvt::catalog_all_plugins (std::string searchpath)
             if (found != std::string::npos &&
                 (found == leaf.length() - patlen)) {
                 std::string pluginname (leaf.begin(), leaf.begin() + leaf.length() - patlen);
-                catalog_plugin (pluginname, full_filename);
+                // Plugins the catalog already knows are only loaded
+                // once a file actually needs them.
+                if (! defer_plugin (pluginname, full_filename))
+                    catalog_plugin (pluginname, full_filename);
             }
         }
     }
+    save_plugin_catalog ();
 }
 
 
@@ -404,6 +822,11 @@ ImageOutput::create (const std::string &filename,
                                  : pvt::plugin_searchpath.string());
             found = output_formats.find (format);
         }
+        if (found == output_formats.end() &&
+                load_deferred_plugin_for (format, false)) {
+            save_plugin_catalog ();
+            found = output_formats.find (format);
+        }
         if (found != output_formats.end()) {
             create_function = found->second;
         } else {
@@ -481,6 +904,11 @@ ImageInput::create (const std::string &filename,
                                  : pvt::plugin_searchpath.string());
             found = input_formats.find (format);
         }
+        if (found == input_formats.end() &&
+                load_deferred_plugin_for (format, true)) {
+            save_plugin_catalog ();
+            found = input_formats.find (format);
+        }
         if (found != input_formats.end())
             create_function = found->second;
     }
@@ -531,20 +959,44 @@ ImageInput::create (const std::string &filename,
         // doesn't yet exist).
         ImageSpec config;
         config.attribute ("nowait", (int)1);
-        recursive_lock_guard lock (imageio_mutex);  // Ensure thread safety
-        for (InputPluginMap::const_iterator plugin = input_formats.begin();
-             plugin != input_formats.end(); ++plugin)
+        // Read the start of the file just once, and use it to rule out
+        // the plugins whose magic numbers don't match, so they needn't
+        // each open the file only to reject it.  Matching plugins go
+        // first, then the ones that can't tell from the magic alone.
+        unsigned char header[512];
+        size_t headerlen = Filesystem::read_bytes (filename, header,
+                                                   sizeof(header));
+        // Only hold the lock long enough to copy the list of plugins, so
+        // that threads opening other files don't wait on our attempts.
+        std::vector<ImageInput::Creator> creators, nomagic;
         {
+            recursive_lock_guard lock (imageio_mutex);  // Ensure thread safety
+            // Trying every plugin means loading every plugin
+            catalog_all_plugins (plugin_searchpath.size() ? plugin_searchpath
+                                 : pvt::plugin_searchpath.string());
+            load_all_deferred_plugins ();
+            save_plugin_catalog ();
+            for (InputPluginMap::const_iterator plugin = input_formats.begin();
+                 plugin != input_formats.end(); ++plugin) {
+                auto magic = input_magic.find (plugin->second);
+                if (magic == input_magic.end() || ! headerlen)
+                    add_if_missing (nomagic, plugin->second);
+                else if (magic_matches (magic->second, header, headerlen))
+                    add_if_missing (creators, plugin->second);
+            }
+        }
+        creators.insert (creators.end(), nomagic.begin(), nomagic.end());
+        for (auto creator : creators) {
             // If we already tried this create function, don't do it again
             if (std::find (formats_tried.begin(), formats_tried.end(),
-                           plugin->second) != formats_tried.end())
+                           creator) != formats_tried.end())
                 continue;
-            formats_tried.push_back (plugin->second);  // remember
+            formats_tried.push_back (creator);  // remember
 
             ImageSpec tmpspec;
             ImageInput *in = NULL;
             try {
-                in = plugin->second();
+                in = creator();
             } catch (...) {
                 // Safety in case the ctr throws an exception
             }
@@ -31,6 +31,7 @@
 
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/fmath.h"
+#include "OpenImageIO/strutil.h"
 #include "OpenImageIO/unittest.h"
 
 OIIO_NAMESPACE_USING;
@@ -233,12 +234,53 @@ test_get_attribute ()
 
 
 
+
+// Enough attributes that find_attribute goes through the name index,
+// including after the list is modified.
+static void
+test_many_attributes ()
+{
+    std::cout << "test_many_attributes\n";
+    ImageSpec spec (64, 64, 4, TypeDesc::FLOAT);
+    const int n = 200;
+    for (int i = 0; i < n; ++i)
+        spec.attribute (Strutil::format ("attr%d", i), i);
+    bool ok = true;
+    for (int i = 0; i < n; ++i)
+        ok &= (spec.get_int_attribute (Strutil::format ("attr%d", i), -1) == i);
+    OIIO_CHECK_ASSERT (ok);
+    OIIO_CHECK_ASSERT (spec.find_attribute ("ATTR17") != NULL);
+    OIIO_CHECK_ASSERT (spec.find_attribute ("ATTR17", TypeDesc::UNKNOWN, true) == NULL);
+    OIIO_CHECK_ASSERT (spec.find_attribute ("attr17", TypeDesc::FLOAT) == NULL);
+    OIIO_CHECK_ASSERT (spec.find_attribute ("nonexistent") == NULL);
+
+    // Replacing, erasing and adding must all be seen by later lookups.
+    spec.attribute ("attr5", "five");
+    OIIO_CHECK_EQUAL (spec.get_string_attribute ("attr5"), "five");
+    spec.erase_attribute ("attr10");
+    OIIO_CHECK_ASSERT (spec.find_attribute ("attr10") == NULL);
+    OIIO_CHECK_EQUAL (spec.get_int_attribute ("attr11"), 11);
+    OIIO_CHECK_EQUAL (spec.get_int_attribute ("attr199"), 199);
+    spec.attribute ("late", 1000);
+    OIIO_CHECK_EQUAL (spec.get_int_attribute ("Late"), 1000);
+
+    // A copy answers the same way, and modifying it leaves the original.
+    ImageSpec copy = spec;
+    OIIO_CHECK_EQUAL (copy.get_int_attribute ("attr150"), 150);
+    copy.erase_attribute ("attr150");
+    OIIO_CHECK_ASSERT (copy.find_attribute ("attr150") == NULL);
+    OIIO_CHECK_EQUAL (spec.get_int_attribute ("attr150"), 150);
+}
+
+
+
 int main (int argc, char *argv[])
 {
     test_imagespec_pixels ();
     test_imagespec_metadata_val ();
     test_imagespec_attribute_from_string ();
     test_get_attribute ();
+    test_many_attributes ();
 
     return unit_test_failures;
 }
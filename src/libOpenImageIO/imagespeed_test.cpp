@@ -35,6 +35,8 @@
 #include "OpenImageIO/argparse.h"
 #include "OpenImageIO/ustring.h"
 #include "OpenImageIO/strutil.h"
+#include "OpenImageIO/filesystem.h"
+#include "OpenImageIO/sysutil.h"
 #include "OpenImageIO/timer.h"
 #include "OpenImageIO/unittest.h"
 
@@ -61,6 +63,9 @@ static ImageSpec bufspec, outspec;
 static ImageCache *imagecache = NULL;
 static imagesize_t total_image_pixels = 0;
 static float cache_size = 0;
+static std::string codec_list;
+static std::string codec_threads = "1,0";
+static std::vector<char> readbuffer;
 
 
 
@@ -97,6 +102,9 @@ getargs (int argc, char *argv[])
                 "--cache %f", &cache_size, "Specify ImageCache size, in MB",
                 "-o %s", &output_filename, "Test output by writing to this file",
                 "-od %s", &output_format, "Requested output format",
+                "--codecs %s", &codec_list, "Sweep encode/decode speed of a comma-separated list of ext[:compression] (e.g. exr:zip,exr:piz,tif:lzw)",
+                "--codec-threads %s", &codec_threads,
+                    ustring::format("Thread counts for the codec sweep, 0 = all cores (default: %s)", codec_threads).c_str(),
                 NULL);
     if (ap.parse (argc, (const char**)argv) < 0) {
         std::cerr << ap.geterror() << std::endl;
@@ -442,6 +450,29 @@ time_iterate_pixels (ImageBuf &ib, int iters)
 
 
 
+static float
+time_iterate_pixel_spans (ImageBuf &ib, int iters)
+{
+    ASSERT (ib.pixeltype() == TypeDesc::TypeFloat);
+    const ImageSpec &spec (ib.spec());
+    imagesize_t npixels = spec.image_pixels();
+    int nchannels = spec.nchannels;
+    double sum = 0.0f;
+    for (int i = 0;  i < iters;  ++i) {
+        for (ImageBuf::ConstIterator<float,float> p (ib);  !p.done(); ) {
+            int n = p.span ();
+            const float *f = (const float *) p.rawptr ();
+            for (int x = 0;  x < n;  ++x, f += nchannels)
+                sum += f[0];
+            p.advance (n);
+        }
+    }
+    // std::cout << float(sum/npixels/iters) << "\n";
+    return float(sum/npixels/iters);
+}
+
+
+
 static float
 time_iterate_pixels_slave_pos (ImageBuf &ib, int iters)
 {
@@ -525,6 +556,100 @@ set_dataformat (const std::string &output_format, ImageSpec &outspec)
 
 
 
+static void
+time_read_codec_file ()
+{
+    // Like time_read_image, but decodes into a scratch buffer so that a
+    // lossy codec can't alter the source pixels used for later encodes.
+    ImageInput *in = ImageInput::open (output_filename);
+    ASSERT (in);
+    in->read_image (bufspec.format, &readbuffer[0]);
+    in->close ();
+    delete in;
+}
+
+
+
+// Encode and decode the image in buffer with each of the requested
+// formats and compression modes, as scanlines and (where supported) as
+// tiles, at each requested thread count. Report throughput in MB/s of
+// uncompressed pixel data, the compression ratio, and the speedup
+// relative to the first thread count in the list.
+static void
+test_codecs ()
+{
+    std::vector<std::string> codecs;
+    std::vector<int> threads;
+    Strutil::split (codec_list, codecs, ",");
+    Strutil::extract_from_list_string (threads, codec_threads);
+    if (threads.empty())
+        threads.push_back (0);
+    readbuffer.resize (bufspec.image_bytes());
+    double rawbytes = double (bufspec.image_bytes());
+    std::string saved_output_filename = output_filename;
+
+    std::cout << "Timing codecs (" << bufspec.width << "x" << bufspec.height
+              << ", " << bufspec.nchannels << " channels, " << bufspec.format
+              << ", " << Strutil::memformat (imagesize_t(rawbytes))
+              << " uncompressed):\n";
+    std::cout << "  codec            layout   threads   write MB/s  read MB/s"
+                 "   ratio  write x  read x\n";
+    for (const std::string &codec : codecs) {
+        std::vector<std::string> parts;
+        Strutil::split (codec, parts, ":", 1);
+        std::string ext = parts[0];
+        std::string compression = parts.size() > 1 ? parts[1] : std::string();
+        output_filename = Filesystem::temp_directory_path() + "/"
+                        + Filesystem::unique_path() + "." + ext;
+        ImageOutput *out = ImageOutput::create (output_filename);
+        if (! out) {
+            std::cout << "  " << codec << ": no writer for \"" << ext << "\"\n";
+            continue;
+        }
+        bool supports_tiles = out->supports ("tiles");
+        delete out;
+        for (int tilesize : { 0, 64 }) {
+            if (tilesize && ! supports_tiles)
+                continue;
+            outspec = bufspec;
+            set_dataformat (output_format, outspec);
+            outspec.tile_width = tilesize;
+            outspec.tile_height = tilesize;
+            outspec.tile_depth = 1;
+            if (compression.size())
+                outspec.attribute ("compression", compression);
+            double base_write = 0.0, base_read = 0.0;
+            for (size_t t = 0; t < threads.size(); ++t) {
+                OIIO::attribute ("threads", threads[t]);
+                OIIO::attribute ("exr_threads", threads[t]);
+                double twrite = time_trial (time_write_image, ntrials);
+                double ratio = rawbytes / std::max (uint64_t(1),
+                                       Filesystem::file_size (output_filename));
+                double tread = time_trial (time_read_codec_file, ntrials);
+                if (t == 0) {
+                    base_write = twrite;
+                    base_read = tread;
+                }
+                int nthreads = threads[t] ? threads[t]
+                                          : (int) Sysutil::hardware_concurrency();
+                std::cout << Strutil::format ("  %-16s %-8s %7d %12.1f %10.1f %7.2f %8.2f %7.2f\n",
+                              codec, tilesize ? "tiled" : "scanline",
+                              nthreads, rawbytes / twrite / 1.0e6,
+                              rawbytes / tread / 1.0e6, ratio,
+                              base_write / twrite, base_read / tread);
+            }
+        }
+        std::string err;
+        Filesystem::remove (output_filename, err);
+    }
+    std::cout << std::endl;
+    output_filename = saved_output_filename;
+    OIIO::attribute ("threads", numthreads);
+    OIIO::attribute ("exr_threads", numthreads);
+}
+
+
+
 int
 main (int argc, char **argv)
 {
@@ -634,6 +759,20 @@ main (int argc, char **argv)
         std::cout << std::endl;
     }
 
+    if (codec_list.size()) {
+        // Use the first image, in the requested data format
+        ImageInput *in = ImageInput::open (input_filename[0].c_str());
+        ASSERT (in);
+        bufspec = in->spec ();
+        if (conversion != TypeDesc::UNKNOWN)
+            bufspec.set_format (conversion);
+        buffer.resize (bufspec.image_bytes());
+        in->read_image (bufspec.format, &buffer[0]);
+        in->close ();
+        delete in;
+        test_codecs ();
+    }
+
     if (! no_iter) {
         const int iters = 64;
         std::cout << "Timing ways of iterating over an image:\n";
@@ -649,6 +788,10 @@ main (int argc, char **argv)
                               time_iterate_pixels, true, iters);
         test_pixel_iteration ("Iterate over a cache image              ",
                               time_iterate_pixels, false, iters);
+        test_pixel_iteration ("Iterate spans over a loaded image       ",
+                              time_iterate_pixel_spans, true, iters);
+        test_pixel_iteration ("Iterate spans over a cache image        ",
+                              time_iterate_pixel_spans, false, iters);
         test_pixel_iteration ("Iterate over a loaded image (pos slave) ",
                               time_iterate_pixels_slave_pos, true, iters);
         test_pixel_iteration ("Iterate over a cache image (pos slave)  ",
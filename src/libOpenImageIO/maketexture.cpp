@@ -36,6 +36,7 @@
 #include <limits>
 #include <sstream>
 #include <memory>
+#include <future>
 
 #include <boost/version.hpp>
 #include <boost/regex.hpp>
@@ -56,6 +57,9 @@
 #include "OpenImageIO/imagebufalgo_util.h"
 #include "OpenImageIO/thread.h"
 #include "OpenImageIO/filter.h"
+#include "OpenImageIO/simd.h"
+#include "OpenImageIO/parallel.h"
+#include "imageio_pvt.h"
 
 OIIO_NAMESPACE_USING
 
@@ -136,16 +140,39 @@ set_prman_options(TypeDesc out_dataformat, ImageSpec &configspec)
 
 
 
+// Pick a square tile size for OIIO's TextureSystem.  Texture lookups
+// touch a small neighborhood of texels, and the ImageCache reads,
+// decompresses, and holds whole tiles (and each thread's microcache
+// remembers only the last tile it used), so the cost of a miss grows
+// with the tile's byte size while the chance of a hit grows with its
+// footprint in texels.  Empirically the sweet spot is around 16KB of
+// uncompressed pixel data per tile: start at 64x64 and halve until the
+// tile fits the budget, so e.g. 8-bit mono/RGB/RGBA stay at 64x64 while
+// half and float RGB(A) drop to 32x32.
+static int
+oiio_tile_size (TypeDesc format, int nchannels)
+{
+    const imagesize_t budget = 16*1024;
+    imagesize_t pixelbytes = std::max (1, nchannels) * std::max (size_t(1), format.size());
+    int res = 64;
+    while (res > 16 && imagesize_t(res)*res*pixelbytes > budget)
+        res /= 2;
+    return res;
+}
+
+
+
 static TypeDesc
-set_oiio_options(TypeDesc out_dataformat, ImageSpec &configspec)
+set_oiio_options(TypeDesc out_dataformat, int nchannels, ImageSpec &configspec)
 {
     // Interleaved channels are faster to read
     configspec.attribute ("planarconfig", "contig");
-    
-    // Force fixed tile-size across the board
-    configspec.tile_width = 64;
-    configspec.tile_height = 64;
-    
+
+    // Size tiles for the ImageCache based on the bytes per pixel
+    int res = oiio_tile_size (out_dataformat, nchannels);
+    configspec.tile_width = res;
+    configspec.tile_height = res;
+
     return out_dataformat;
 }
 
@@ -255,21 +282,141 @@ resize_block_ (ImageBuf &dst, const ImageBuf &src, ROI roi, bool envlatlmode)
 }
 
 
-// Helper function to compute the first bilerp pass into a scanline buffer
+// Helpers for the 2-pass box filter below: convert n raw values of a
+// scanline to float (not normalized, just as a cast would).
 template<class SRCTYPE>
 static void
-halve_scanline(const SRCTYPE *s, const int nchannels, size_t sw, float *dst)
+scanline_to_float (const SRCTYPE *s, size_t n, float *f)
 {
-    for (size_t i = 0; i < sw; i += 2, s += nchannels) {
-        for (int j = 0; j < nchannels; ++j, ++dst, ++s)
-            *dst = 0.5f * (float) (*s + *(s + nchannels));
-    }
+    for (size_t i = 0; i < n; ++i)
+        f[i] = (float)s[i];
+}
+
+template<class SRCTYPE>
+static void
+scanline_to_float_simd (const SRCTYPE *s, size_t n, float *f)
+{
+    size_t i = 0;
+    for ( ; i+8 <= n; i += 8)
+        simd::float8(s+i).store (f+i);
+    for ( ; i < n; ++i)
+        f[i] = (float)s[i];
+}
+
+template<> void
+scanline_to_float (const unsigned char *s, size_t n, float *f)
+{
+    scanline_to_float_simd (s, n, f);
+}
+
+template<> void
+scanline_to_float (const unsigned short *s, size_t n, float *f)
+{
+    scanline_to_float_simd (s, n, f);
+}
+
+template<> void
+scanline_to_float (const half *s, size_t n, float *f)
+{
+    scanline_to_float_simd (s, n, f);
+}
+
+
+
+// Helper function to compute the first bilerp pass into a scanline
+// buffer: average horizontally adjacent pairs of the 2*dw nchannels-pixels
+// of s into the dw pixels of dst.  Pixels are done 4 channels at a time
+// (the last group of 4 overlapping the one before it, if need be).
+static void
+halve_scanline (const float *s, const int nchannels, size_t dw, float *dst)
+{
+    const simd::float4 half4 (0.5f);
+    const int nc = nchannels;
+    size_t i = 0;
+    if (nc >= 4) {
+        for ( ; i < dw; ++i, s += 2*nc, dst += nc) {
+            for (int c = 0; c < nc; c += 4) {
+                int cc = std::min (c, nc-4);
+                (half4 * (simd::float4(s+cc) + simd::float4(s+nc+cc))).store (dst+cc);
+            }
+        }
+    } else if (nc == 3) {
+        // Each 4-wide store spills into the next pixel, which is then
+        // overwritten in turn; the last pixel is left to the scalar loop.
+        for ( ; i+1 < dw; ++i, s += 6, dst += 3)
+            (half4 * (simd::float4(s) + simd::float4(s+3))).store (dst);
+    }
+    for ( ; i < dw; ++i, s += 2*nc, dst += nc)
+        for (int c = 0; c < nc; ++c)
+            dst[c] = 0.5f * (s[c] + s[c+nc]);
+}
+
+
+
+// Helper for the second pass: average two halved scanlines vertically,
+// d[i] = (DSTTYPE)(0.5 * (s0[i] + s1[i])).
+template<class DSTTYPE>
+static void
+average_scanlines (const float *s0, const float *s1, size_t n, DSTTYPE *d)
+{
+    for (size_t i = 0; i < n; ++i)
+        d[i] = (DSTTYPE) (0.5f * (s0[i] + s1[i]));
+}
+
+template<> void
+average_scanlines (const float *s0, const float *s1, size_t n, float *d)
+{
+    size_t i = 0;
+    const simd::float8 half8 (0.5f);
+    for ( ; i+8 <= n; i += 8)
+        (half8 * (simd::float8(s0+i) + simd::float8(s1+i))).store (d+i);
+    for ( ; i < n; ++i)
+        d[i] = 0.5f * (s0[i] + s1[i]);
+}
+
+template<> void
+average_scanlines (const float *s0, const float *s1, size_t n, half *d)
+{
+    size_t i = 0;
+    const simd::float8 half8 (0.5f);
+    for ( ; i+8 <= n; i += 8)
+        (half8 * (simd::float8(s0+i) + simd::float8(s1+i))).store (d+i);
+    for ( ; i < n; ++i)
+        d[i] = (half) (0.5f * (s0[i] + s1[i]));
+}
+
+template<class DSTTYPE>
+static void
+average_scanlines_int (const float *s0, const float *s1, size_t n, DSTTYPE *d)
+{
+    // Truncating float->int conversion, like the scalar cast
+    size_t i = 0;
+    const simd::float8 half8 (0.5f);
+    for ( ; i+8 <= n; i += 8)
+        simd::int8 (half8 * (simd::float8(s0+i) + simd::float8(s1+i))).store (d+i);
+    for ( ; i < n; ++i)
+        d[i] = (DSTTYPE) (0.5f * (s0[i] + s1[i]));
+}
+
+template<> void
+average_scanlines (const float *s0, const float *s1, size_t n, unsigned char *d)
+{
+    average_scanlines_int (s0, s1, n, d);
+}
+
+template<> void
+average_scanlines (const float *s0, const float *s1, size_t n, unsigned short *d)
+{
+    average_scanlines_int (s0, s1, n, d);
 }
 
 
 
 // Bilinear resize performed as a 2-pass filter.
-// Optimized to assume that the images are contiguous.
+// Optimized to assume that the images are contiguous.  Whole scanlines
+// are converted to float, halved horizontally and averaged vertically
+// with SIMD, in the same order of operations as the plain scalar loops
+// so the results are unchanged.
 template<class SRCTYPE>
 static bool
 resize_block_2pass (ImageBuf &dst, const ImageBuf &src, ROI roi, bool allow_shift)
@@ -281,12 +428,15 @@ resize_block_2pass (ImageBuf &dst, const ImageBuf &src, ROI roi, bool allow_shif
     
     DASSERT(roi.ybegin + roi.height() <= dst.spec().height);
 
-    // Allocate two scanline buffers to hold the result of the first pass
+    // Allocate two scanline buffers to hold the result of the first pass,
+    // and one for a source scanline converted to float.
     const int nchannels = dst.nchannels();
     const size_t row_elem = roi.width() * nchannels;    // # floats in scanline
+    const bool convert = (src.spec().format != TypeDesc::FLOAT);
     std::unique_ptr<float[]> S0 (new float [row_elem]);
     std::unique_ptr<float[]> S1 (new float [row_elem]);
-    
+    std::unique_ptr<float[]> F (new float [convert ? 2*row_elem : 0]);
+
     // We know that the buffers created for mipmapping are all contiguous,
     // so we can skip the iterators for a bilerp resize entirely along with
     // any NDC -> pixel math, and just directly traverse pixels.
@@ -299,17 +449,21 @@ resize_block_2pass (ImageBuf &dst, const ImageBuf &src, ROI roi, bool allow_shif
     
     // Run through destination rows, doing the two-pass bilerp filter
     const size_t dw = roi.width(), dh = roi.height();   // Loop invariants
-    const size_t sw = dw * 2;                           // Handle odd res
-    for (size_t y = 0; y < dh; ++y) {                   // For each dst ROI row
-        halve_scanline<SRCTYPE>(s, nchannels, sw, &S0[0]);
+    const size_t sn = 2 * row_elem;                     // Handle odd res
+    auto halve = [&](const SRCTYPE *s, float *h) {
+        const float *f = (const float *)s;
+        if (convert) {
+            scanline_to_float (s, sn, &F[0]);
+            f = &F[0];
+        }
+        halve_scanline (f, nchannels, dw, h);
+    };
+    for (size_t y = 0; y < dh; ++y, d += row_elem) {    // For each dst ROI row
+        halve (s, &S0[0]);
         s += ystride;
-        halve_scanline<SRCTYPE>(s, nchannels, sw, &S1[0]);
+        halve (s, &S1[0]);
         s += ystride;
-        const float *s0 = &S0[0], *s1 = &S1[0];
-        for (size_t x = 0; x < dw; ++x) {               // For each dst ROI col
-            for (int i = 0; i < nchannels; ++i, ++s0, ++s1, ++d)
-                *d = (SRCTYPE) (0.5f * (*s0 + *s1));   // Average vertically
-        }
+        average_scanlines (&S0[0], &S1[0], row_elem, d); // Average vertically
     }
     
     return true;
@@ -374,6 +528,237 @@ check_nan_block (const ImageBuf &src, ROI roi, int &found_nonfinite)
 
 
 
+// True if channels 1 and 2 equal channel 0 in each of the npixels
+// interleaved float pixels of nc (>= 3) channels.  Each block of 4 pixels
+// is compared, as float4's, with itself shifted by one value, looking
+// only at the lanes that hold channel 0 or 1.
+static bool
+monochrome_row (const float *data, int npixels, int nc)
+{
+    using namespace simd;
+    std::vector<bool4> check (nc);
+    for (int j = 0;  j < nc;  ++j)
+        check[j] = bool4 ((4*j+0) % nc < 2, (4*j+1) % nc < 2,
+                          (4*j+2) % nc < 2, (4*j+3) % nc < 2);
+    // The shifted load reads the first value of the next block, so the
+    // last block is left to the scalar loop.
+    int nblocks = std::max (0, (npixels - 1) / 4);
+    for (int b = 0;  b < nblocks;  ++b) {
+        const float *d = data + size_t(b) * 4 * nc;
+        bool4 differ (false);
+        for (int j = 0;  j < nc;  ++j)
+            differ |= (float4(d+4*j) != float4(d+4*j+1)) & check[j];
+        if (any (differ))
+            return false;
+    }
+    for (int i = 4*nblocks;  i < npixels;  ++i) {
+        const float *p = data + size_t(i) * nc;
+        if (p[1] != p[0] || p[2] != p[0])
+            return false;
+    }
+    return true;
+}
+
+
+
+// What make_texture needs to know about the source pixels, found in a
+// single pass over them.
+struct SourceAnalysis {
+    ImageBufAlgo::PixelStats stats;  // min, max, sum, and counts
+    bool complete = true;     // false if the pass stopped early
+    bool monochrome = false;  // channels 1 and 2 equal channel 0 throughout
+    bool nonfinite = false;   // there are NaN or Inf values
+};
+
+
+
+// Analyze src in one parallel pass, band by band so that each band is
+// still in cache for every test: pixel stats (if want_stats), whether it
+// is monochrome (if want_mono), and whether it has NaN or Inf values (if
+// the stats are complete).  Unless full_stats is needed, the pass stops
+// as soon as every test asked for by detect -- constant color, opaque
+// alpha, monochrome -- is known to fail; the stats are then partial, but
+// still make those tests fail.
+static void
+analyze_source (const ImageBuf &src, SourceAnalysis &result,
+                bool want_stats, bool full_stats, bool want_constant,
+                bool want_opaque, bool want_mono)
+{
+    const ImageSpec &spec (src.spec());
+    const int nc = spec.nchannels;
+    const int alpha = spec.alpha_channel;
+    const float inf = std::numeric_limits<float>::infinity();
+    ImageBufAlgo::PixelStats &stats (result.stats);
+    stats.min.assign (nc, inf);
+    stats.max.assign (nc, -inf);
+    stats.sum.assign (nc, 0.0);
+    stats.sum2.assign (nc, 0.0);
+    stats.finitecount.assign (nc, 0);
+    stats.nancount.assign (nc, 0);
+    stats.infcount.assign (nc, 0);
+    want_mono &= (nc >= 3);
+    result.monochrome = want_mono;
+    result.complete = true;
+    atomic_int mono_failed (0), stop (0);
+    const bool direct = spec.format == TypeDesc::FLOAT && src.localpixels();
+    const int band = std::max (1, int ((256*1024) / std::max (1, spec.width * nc * 4)));
+    spin_mutex mutex;
+
+    ImageBufAlgo::parallel_image ([&](ROI chunk){
+        ImageBufAlgo::PixelStats sum;
+        sum.min.assign (nc, inf);
+        sum.max.assign (nc, -inf);
+        sum.sum.assign (nc, 0.0);
+        sum.sum2.assign (nc, 0.0);
+        sum.finitecount.assign (nc, 0);
+        sum.nancount.assign (nc, 0);
+        sum.infcount.assign (nc, 0);
+        std::vector<float> buf (direct || ! want_mono ? 0 : size_t(chunk.width()) * nc);
+        for (int y = chunk.ybegin;  y < chunk.yend && ! stop;  y += band) {
+            ROI b = chunk;
+            b.ybegin = y;
+            b.yend = std::min (y + band, chunk.yend);
+            if (want_stats) {
+                ImageBufAlgo::PixelStats s;
+                ImageBufAlgo::computePixelStats (s, src, b, 1);
+                for (int c = 0;  c < nc;  ++c) {
+                    // A channel with no finite values reports 0 as its
+                    // min and max, which must not count.
+                    if (s.finitecount[c]) {
+                        sum.min[c] = std::min (sum.min[c], s.min[c]);
+                        sum.max[c] = std::max (sum.max[c], s.max[c]);
+                    }
+                    sum.sum[c] += s.sum[c];
+                    sum.sum2[c] += s.sum2[c];
+                    sum.finitecount[c] += s.finitecount[c];
+                    sum.nancount[c] += s.nancount[c];
+                    sum.infcount[c] += s.infcount[c];
+                }
+            }
+            if (want_mono && ! mono_failed) {
+                for (int z = b.zbegin;  z < b.zend;  ++z)
+                    for (int yy = b.ybegin;  yy < b.yend;  ++yy) {
+                        const float *row;
+                        if (direct) {
+                            row = (const float *) src.pixeladdr (b.xbegin, yy, z);
+                        } else {
+                            src.get_pixels (ROI (b.xbegin, b.xend, yy, yy+1, z, z+1),
+                                            TypeDesc::FLOAT, &buf[0]);
+                            row = &buf[0];
+                        }
+                        if (! monochrome_row (row, b.width(), nc)) {
+                            mono_failed = 1;
+                            z = b.zend;
+                            break;
+                        }
+                    }
+            }
+            if (! full_stats) {
+                // Can the whole pass stop?  Only if each test asked for
+                // has already failed somewhere.
+                bool constant_failed = ! want_constant;
+                for (int c = 0;  c < nc && ! constant_failed;  ++c)
+                    constant_failed = sum.finitecount[c] && sum.min[c] != sum.max[c];
+                bool opaque_failed = ! want_opaque || alpha < 0 ||
+                    (sum.finitecount[alpha] && (sum.min[alpha] != 1.0f ||
+                                                sum.max[alpha] != 1.0f));
+                if (constant_failed && opaque_failed && (! want_mono || mono_failed))
+                    stop = 1;
+            }
+        }
+        spin_lock lock (mutex);
+        for (int c = 0;  c < nc;  ++c) {
+            stats.min[c] = std::min (stats.min[c], sum.min[c]);
+            stats.max[c] = std::max (stats.max[c], sum.max[c]);
+            stats.sum[c] += sum.sum[c];
+            stats.sum2[c] += sum.sum2[c];
+            stats.finitecount[c] += sum.finitecount[c];
+            stats.nancount[c] += sum.nancount[c];
+            stats.infcount[c] += sum.infcount[c];
+        }
+    }, get_roi (spec));
+
+    result.complete = ! stop;
+    result.monochrome = want_mono && ! mono_failed;
+    result.nonfinite = false;
+    stats.avg.assign (nc, 0.0f);
+    stats.stddev.assign (nc, 0.0f);
+    for (int c = 0;  c < nc;  ++c) {
+        result.nonfinite |= (stats.nancount[c] || stats.infcount[c]);
+        if (stats.finitecount[c] == 0) {
+            stats.min[c] = 0.0f;
+            stats.max[c] = 0.0f;
+        } else {
+            double count = double (stats.finitecount[c]);
+            double davg = stats.sum[c] / count;
+            stats.avg[c] = float (davg);
+            stats.stddev[c] = float (safe_sqrt (stats.sum2[c]/count - davg*davg));
+        }
+    }
+}
+
+
+
+// The "oiio:TileStats" metadata for img: the per-cell average, min, and
+// max of each channel, where the cells are tw x th tiles -- or blocks of
+// 2^k x 2^k tiles, if that's what it takes to keep the grid within 64 x 64
+// cells (and the metadata reasonably small).  The string is a
+// comma-separated list: cell width, cell height, cells across, cells
+// down, and nchannels, then all the averages, then all the mins, then all
+// the maxes, each in scanline order of the cells and nchannels per cell.
+static std::string
+tile_stats_string (const ImageBuf &img, int tw, int th)
+{
+    const ImageSpec &spec (img.spec());
+    int cw = std::max (1, tw), ch = std::max (1, th);
+    while ((spec.width + cw - 1) / cw > 64)
+        cw *= 2;
+    while ((spec.height + ch - 1) / ch > 64)
+        ch *= 2;
+    int nx = (spec.width + cw - 1) / cw, ny = (spec.height + ch - 1) / ch;
+    int nc = spec.nchannels;
+    size_t ncells = size_t(nx) * ny;
+    std::vector<float> stats (3 * ncells * nc);
+    ImageBufAlgo::parallel_image ([&](ROI cells){
+        for (int j = cells.ybegin;  j < cells.yend;  ++j)
+            for (int i = cells.xbegin;  i < cells.xend;  ++i) {
+                ROI cell (spec.x + i*cw, std::min (spec.x + (i+1)*cw, spec.x + spec.width),
+                          spec.y + j*ch, std::min (spec.y + (j+1)*ch, spec.y + spec.height),
+                          spec.z, spec.z + spec.depth, 0, nc);
+                ImageBufAlgo::PixelStats s;
+                ImageBufAlgo::computePixelStats (s, img, cell, 1);
+                size_t offset = (size_t(j) * nx + i) * nc;
+                for (int c = 0;  c < nc;  ++c) {
+                    stats[offset + c] = s.avg[c];
+                    stats[ncells*nc + offset + c] = s.min[c];
+                    stats[2*ncells*nc + offset + c] = s.max[c];
+                }
+            }
+    }, ROI (0, nx, 0, ny));
+
+    std::ostringstream os; // Emulate a JSON array
+    os << cw << "," << ch << "," << nx << "," << ny << "," << nc;
+    for (auto v : stats)
+        os << "," << v;
+    return os.str();
+}
+
+
+
+// Remove any hint such as "oiio:TileStats=..." from an ImageDescription.
+// It may be too long for a regex, but it is one word without spaces.
+static void
+erase_hint (std::string &desc, string_view hint)
+{
+    size_t found = desc.find (hint);
+    if (found != std::string::npos) {
+        size_t end = desc.find_first_not_of (' ', desc.find (' ', found));
+        desc.erase (found, end == std::string::npos ? end : end - found);
+    }
+}
+
+
+
 inline Imath::V3f
 latlong_to_dir (float s, float t, bool y_is_up=true)
 {
@@ -410,19 +795,72 @@ lightprobe_to_envlatl (ImageBuf &dst, const ImageBuf &src, bool y_is_up,
 
     // Serial case
     const ImageSpec &dstspec (dst.spec());
+    const ImageSpec &srcspec (src.spec());
     int nchannels = dstspec.nchannels;
     ASSERT (dstspec.format == TypeDesc::FLOAT);
 
-    float *pixel = ALLOCA (float, nchannels);
+    // The direction depends on the column only through theta and on the
+    // row only through phi (see latlong_to_dir), so their sines and
+    // cosines are computed once per column and once per row, not once
+    // per pixel.
     float dw = dstspec.width, dh = dstspec.height;
-    for (ImageBuf::Iterator<float> d (dst, roi);  ! d.done();  ++d) {
-        Imath::V3f V = latlong_to_dir ((d.x()+0.5f)/dw, (dh-1.0f-d.y()+0.5f)/dh, y_is_up);
-        float r = M_1_PI*acosf(V[2]) / hypotf(V[0],V[1]);
-        float u = (V[0]*r + 1.0f) * 0.5f;
-        float v = (V[1]*r + 1.0f) * 0.5f;
-        interppixel_NDC_clamped<float> (src, float(u), float(v), pixel, false);
-        for (int c = roi.chbegin;  c < roi.chend;  ++c)
-            d[c] = pixel[c];
+    std::vector<float> sintheta (roi.width()), costheta (roi.width());
+    for (int x = roi.xbegin;  x < roi.xend;  ++x) {
+        float theta = 2.0f*M_PI * ((x+0.5f)/dw);
+        sintheta[x-roi.xbegin] = sinf (theta);
+        costheta[x-roi.xbegin] = cosf (theta);
+    }
+
+    // A local float source whose pixel and display windows match, at the
+    // origin, is sampled directly, with the same clamped bilinear
+    // interpolation that interppixel_NDC_clamped does through an iterator.
+    bool direct = (srcspec.format == TypeDesc::FLOAT && src.localpixels() &&
+                   srcspec.x == 0 && srcspec.y == 0 && srcspec.z == 0 &&
+                   srcspec.full_x == 0 && srcspec.full_y == 0 &&
+                   srcspec.width == srcspec.full_width &&
+                   srcspec.height == srcspec.full_height);
+    bool direct_dst = dst.localpixels() != NULL;
+    float *pixel = ALLOCA (float, nchannels);
+    for (int z = roi.zbegin;  z < roi.zend;  ++z)
+    for (int y = roi.ybegin;  y < roi.yend;  ++y) {
+        float phi = ((dh-1.0f-y+0.5f)/dh) * M_PI;
+        float sinphi, cosphi;
+        sincos (phi, &sinphi, &cosphi);
+        for (int x = roi.xbegin;  x < roi.xend;  ++x) {
+            float st = sintheta[x-roi.xbegin], ct = costheta[x-roi.xbegin];
+            float V0, V1, V2;
+            if (y_is_up) {
+                V0 = sinphi*st;  V1 = cosphi;  V2 = -sinphi*ct;
+            } else {
+                V0 = -sinphi*ct;  V1 = -sinphi*st;  V2 = cosphi;
+            }
+            float r = M_1_PI*acosf(V2) / hypotf(V0,V1);
+            float u = (V0*r + 1.0f) * 0.5f;
+            float v = (V1*r + 1.0f) * 0.5f;
+            if (direct) {
+                float sx = u * float(srcspec.width) - 0.5f;
+                float sy = v * float(srcspec.height) - 0.5f;
+                int xt, yt;
+                float xfrac = floorfrac (sx, &xt);
+                float yfrac = floorfrac (sy, &yt);
+                int x0 = clamp (xt, 0, srcspec.width-1), x1 = clamp (xt+1, 0, srcspec.width-1);
+                int y0 = clamp (yt, 0, srcspec.height-1), y1 = clamp (yt+1, 0, srcspec.height-1);
+                const float *row0 = (const float *) src.pixeladdr (0, y0);
+                const float *row1 = (const float *) src.pixeladdr (0, y1);
+                bilerp (row0 + x0*nchannels, row0 + x1*nchannels,
+                        row1 + x0*nchannels, row1 + x1*nchannels,
+                        xfrac, yfrac, nchannels, pixel);
+            } else {
+                interppixel_NDC_clamped<float> (src, u, v, pixel, false);
+            }
+            if (direct_dst) {
+                float *d = (float *) dst.pixeladdr (x, y, z);
+                for (int c = roi.chbegin;  c < roi.chend;  ++c)
+                    d[c] = pixel[c];
+            } else {
+                dst.setpixel (x, y, z, pixel, roi.chend);
+            }
+        }
     }
 
     return true;
@@ -434,13 +872,15 @@ static void
 fix_latl_edges (ImageBuf &buf)
 {
     int n = buf.nchannels();
-    float *left = ALLOCA (float, n);
-    float *right = ALLOCA (float, n);
 
     // Make the whole first and last row be solid, since they are exactly
-    // on the pole
+    // on the pole.  The two rows are independent, as are the rows' edge
+    // pixels below, so each is done in parallel; getpixel/setpixel are
+    // safe for distinct pixels of a local buffer.
     float wscale = 1.0f / (buf.spec().width);
-    for (int j = 0;  j <= 1;  ++j) {
+    parallel_for (0, 2, [&](int64_t j){
+        float *left = ALLOCA (float, n);
+        float *right = ALLOCA (float, n);
         int y = (j==0) ? buf.ybegin() : buf.yend()-1;
         // use left for the sum, right for each new pixel
         for (int c = 0;  c < n;  ++c)
@@ -454,18 +894,23 @@ fix_latl_edges (ImageBuf &buf)
             left[c] *= wscale;
         for (int x = buf.xbegin();  x < buf.xend();  ++x)
             buf.setpixel (x, y, left);
-    }
+    });
 
     // Make the left and right match, since they are both right on the
     // prime meridian.
-    for (int y = buf.ybegin();  y < buf.yend();  ++y) {
-        buf.getpixel (buf.xbegin(), y, left);
-        buf.getpixel (buf.xend()-1, y, right);
-        for (int c = 0;  c < n;  ++c)
-            left[c] = 0.5f * left[c] + 0.5f * right[c];
-        buf.setpixel (buf.xbegin(), y, left);
-        buf.setpixel (buf.xend()-1, y, left);
-    }
+    parallel_for_chunked (buf.ybegin(), buf.yend(), 0,
+                          [&](int64_t ybegin, int64_t yend){
+        float *left = ALLOCA (float, n);
+        float *right = ALLOCA (float, n);
+        for (int y = int(ybegin);  y < int(yend);  ++y) {
+            buf.getpixel (buf.xbegin(), y, left);
+            buf.getpixel (buf.xend()-1, y, right);
+            for (int c = 0;  c < n;  ++c)
+                left[c] = 0.5f * left[c] + 0.5f * right[c];
+            buf.setpixel (buf.xbegin(), y, left);
+            buf.setpixel (buf.xend()-1, y, left);
+        }
+    });
 }
 
 
@@ -566,6 +1011,32 @@ write_mipmap (ImageBufAlgo::MakeTextureMode mode,
         filtername = "lanczos3";
     }
 
+    // With maketx:envcdf, store the importance-sampling tables of a
+    // latlong environment with the level that environment_cdf() would
+    // build them from: the first one no more than 512 across.
+    bool want_envcdf = envlatlmode && configspec.get_int_attribute ("maketx:envcdf");
+    auto add_envcdf = [&](const ImageBuf &level, ImageSpec &spec) {
+        if (! want_envcdf || spec.width > 512)
+            return;
+        want_envcdf = false;
+        std::vector<float> pixels (spec.image_pixels() * spec.nchannels);
+        std::vector<float> marginal, conditional;
+        level.get_pixels (get_roi (level.spec()), TypeDesc::FLOAT, &pixels[0]);
+        pvt::env_cdf_build (&pixels[0], spec.width, spec.height,
+                            spec.nchannels, marginal, conditional);
+        std::string cdf = pvt::env_cdf_encode (spec.width, spec.height,
+                                               marginal, conditional);
+        if (out->supports ("arbitrary_metadata")) {
+            spec.attribute ("oiio:EnvCDF", cdf);
+        } else {
+            std::string desc = spec.get_string_attribute ("ImageDescription");
+            if (desc.length())
+                desc += " ";
+            spec.attribute ("ImageDescription", desc + "oiio:EnvCDF=" + cdf);
+        }
+    };
+    add_envcdf (*img, outspec);
+
     Timer writetimer;
     if (! out->open (outputfilename.c_str(), outspec)) {
         outstream << "maketx ERROR: Could not open \"" << outputfilename
@@ -580,16 +1051,45 @@ write_mipmap (ImageBufAlgo::MakeTextureMode mode,
         outstream << "  Filter \"" << filtername << "\"\n";
         outstream << "  Top level is " << formatres(outspec) << std::endl;
     }
+    stat_writetime += writetimer();
 
-    if (! img->write (out)) {
+    // Trick: to get the MIP level resizes working properly, we doctor
+    // the big image to have its display and pixel windows match (and
+    // the smaller levels are made that way).  Don't worry, the texture
+    // engine doesn't care what the upper MIP levels have for the window
+    // sizes, it uses level 0 to determine the relatinship between texture
+    // 0-1 space (display window) and the pixels.  Do it now, because the
+    // level will be being written while the next one is computed from it.
+    if (mipmap)
+        img->set_full (img->xbegin(), img->xend(), img->ybegin(),
+                       img->yend(), img->zbegin(), img->zend());
+
+    // Each level is compressed and written on its own thread while the
+    // next level is computed from it, so the two overlap.  The writer
+    // holds its own reference to the level, and the level is never
+    // modified in place while it's being written.
+    double writetime = 0.0;
+    auto write_level = [&](std::shared_ptr<ImageBuf> level) {
+        return std::async (std::launch::async, [&writetime, out, level](){
+            Timer timer;
+            bool ok = level->write (out);
+            writetime += timer();
+            return ok;
+        });
+    };
+    auto finish_level = [&](std::future<bool> &writing,
+                            const ImageBuf &level) -> bool {
+        if (writing.get())
+            return true;
         // ImageBuf::write transfers any errors from the ImageOutput to
         // the ImageBuf.
-        outstream << "maketx ERROR: Write failed \" : " << img->geterror() << "\n";
+        outstream << "maketx ERROR writing \"" << outputfilename
+                  << "\" : " << level.geterror() << "\n";
         out->close ();
         return false;
-    }
-
-    stat_writetime += writetimer();
+    };
+    std::shared_ptr<ImageBuf> writing_level = img;
+    std::future<bool> writing = write_level (img);
 
     if (mipmap) {  // Mipmap levels:
         if (verbose)
@@ -639,21 +1139,24 @@ write_mipmap (ImageBufAlgo::MakeTextureMode mode,
                     configspec.get_int_attribute("maketx:forcefloat", 1))
                     smallspec.set_format (TypeDesc::FLOAT);
 
-                // Trick: to get the resize working properly, we reset
-                // both display and pixel windows to match, and have 0
-                // offset, AND doctor the big image to have its display
-                // and pixel windows match.  Don't worry, the texture
-                // engine doesn't care what the upper MIP levels have
-                // for the window sizes, it uses level 0 to determine
-                // the relatinship between texture 0-1 space (display
-                // window) and the pixels.
+                // Reset both display and pixel windows to match, and
+                // have 0 offset (see the trick explained above).
                 smallspec.x = 0;
                 smallspec.y = 0;
                 smallspec.full_x = 0;
                 smallspec.full_y = 0;
+                // The tile stats and environment CDF each describe only
+                // the level they were stored with.
+                smallspec.erase_attribute ("oiio:TileStats");
+                smallspec.erase_attribute ("oiio:EnvCDF");
+                std::string desc = smallspec.get_string_attribute ("ImageDescription");
+                if (desc.find ("oiio:TileStats=") != std::string::npos ||
+                    desc.find ("oiio:EnvCDF=") != std::string::npos) {
+                    erase_hint (desc, "oiio:TileStats=");
+                    erase_hint (desc, "oiio:EnvCDF=");
+                    smallspec.attribute ("ImageDescription", desc);
+                }
                 small->reset (smallspec);  // Realocate with new size
-                img->set_full (img->xbegin(), img->xend(), img->ybegin(),
-                               img->yend(), img->zbegin(), img->zend());
 
                 if (filtername == "box" && !orig_was_overscan && sharpen <= 0.0f) {
                     ImageBufAlgo::parallel_image (OIIO::bind(resize_block, OIIO::ref(*small), OIIO::cref(*img), _1, envlatlmode, allow_shift),
@@ -675,8 +1178,12 @@ write_mipmap (ImageBufAlgo::MakeTextureMode mode,
                         }
                         outstream << "\n";
                     }
-                    if (do_highlight_compensation)
-                        ImageBufAlgo::rangecompress (*img, *img);
+                    if (do_highlight_compensation) {
+                        // Not in place: img may still be being written.
+                        std::shared_ptr<ImageBuf> comp (new ImageBuf);
+                        ImageBufAlgo::rangecompress (*comp, *img);
+                        std::swap (img, comp);
+                    }
                     if (sharpen > 0.0f && sharpen_first) {
                         std::shared_ptr<ImageBuf> sharp (new ImageBuf);
                         bool uok = ImageBufAlgo::unsharp_mask (*sharp, *img,
@@ -708,7 +1215,12 @@ write_mipmap (ImageBufAlgo::MakeTextureMode mode,
             outspec.set_format (outputdatatype);
             if (envlatlmode && src_samples_border)
                 fix_latl_edges (*small);
+            add_envcdf (*small, outspec);
 
+            // The previous level must be all written before we can
+            // append the new one.
+            if (! finish_level (writing, *writing_level))
+                return false;
             Timer writetimer;
             // If the format explicitly supports MIP-maps, use that,
             // otherwise try to simulate MIP-mapping with multi-image.
@@ -719,15 +1231,9 @@ write_mipmap (ImageBufAlgo::MakeTextureMode mode,
                           << "\" : " << out->geterror() << "\n";
                 return false;
             }
-            if (! small->write (out)) {
-                // ImageBuf::write transfers any errors from the
-                // ImageOutput to the ImageBuf.
-                outstream << "maketx ERROR writing \"" << outputfilename
-                          << "\" : " << small->geterror() << "\n";
-                out->close ();
-                return false;
-            }
             stat_writetime += writetimer();
+            writing_level = small;
+            writing = write_level (small);
             if (verbose) {
                 size_t mem = Sysutil::memory_used(true);
                 peak_mem = std::max (peak_mem, mem);
@@ -739,6 +1245,9 @@ write_mipmap (ImageBufAlgo::MakeTextureMode mode,
             std::swap (img, small);
         }
     }
+    if (! finish_level (writing, *writing_level))
+        return false;
+    stat_writetime += writetime;
 
     if (verbose)
         outstream << "  Wrote file: " << outputfilename << "  ("
@@ -799,9 +1308,10 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
         // No buffer supplied -- create one to read the file
         src.reset (new ImageBuf(filename));
         src->init_spec (filename, 0, 0); // force it to get the spec, not read
-    } else if (input->cachedpixels()) {
+    } else if (input->cachedpixels() || ! input->localpixels()) {
         // Image buffer supplied that's backed by ImageCache -- create a
-        // copy (very light weight, just another cache reference)
+        // copy (very light weight, just another cache reference) -- or
+        // that is held in local tiles, which we can't wrap.
         src.reset (new ImageBuf(*input));
     } else {
         // Image buffer supplied that has pixels -- wrap it
@@ -894,13 +1404,14 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
     if (configspec.get_int_attribute("maketx:prman_options"))
         out_dataformat = set_prman_options (out_dataformat, configspec);
     else if (configspec.get_int_attribute("maketx:oiio_options"))
-        out_dataformat = set_oiio_options (out_dataformat, configspec);
+        out_dataformat = set_oiio_options (out_dataformat,
+                                           src->spec().nchannels, configspec);
 
     // Read the full file locally if it's less than 1 GB, otherwise
     // allow the ImageBuf to use ImageCache to manage memory.
     int local_mb_thresh = configspec.get_int_attribute("maketx:read_local_MB",
                                                     1024);
-    bool read_local = (src->spec().image_bytes() < imagesize_t(local_mb_thresh * 1024*1024));
+    bool read_local = (src->spec().image_bytes() < imagesize_t(local_mb_thresh) * 1024*1024);
 
     bool verbose = configspec.get_int_attribute ("maketx:verbose") != 0;
     double misc_time_1 = alltime.lap();
@@ -936,10 +1447,21 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
     bool constant_color_detect = configspec.get_int_attribute("maketx:constant_color_detect");
     bool opaque_detect = configspec.get_int_attribute("maketx:opaque_detect");
     bool compute_average_color = configspec.get_int_attribute("maketx:compute_average", 1);
-    ImageBufAlgo::PixelStats pixel_stats;
-    bool compute_stats = (constant_color_detect || opaque_detect || compute_average_color);
-    if (compute_stats)
-        ImageBufAlgo::computePixelStats (pixel_stats, *src);
+    bool monochrome_detect = configspec.get_int_attribute("maketx:monochrome_detect");
+    TypeDesc::BASETYPE srcbase = TypeDesc::BASETYPE (src->spec().format.basetype);
+    bool checknan = configspec.get_int_attribute("maketx:checknan") &&
+                    (srcbase == TypeDesc::FLOAT || srcbase == TypeDesc::HALF ||
+                     srcbase == TypeDesc::DOUBLE);
+    bool compute_stats = (constant_color_detect || opaque_detect ||
+                          compute_average_color || checknan);
+    // One pass gathers the stats and the monochrome and NaN checks.
+    SourceAnalysis analysis;
+    if (compute_stats || monochrome_detect)
+        analyze_source (*src, analysis, compute_stats,
+                        compute_average_color || checknan,
+                        constant_color_detect, opaque_detect,
+                        monochrome_detect);
+    ImageBufAlgo::PixelStats &pixel_stats (analysis.stats);
 
     // If requested - and we're a constant color - make a tiny texture instead
     // Only safe if the full/display window is the same as the data window.
@@ -947,7 +1469,7 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
     // wrap mode at runtime.
     std::vector<float> constantColor(src->nchannels());
     bool isConstantColor = false;
-    if (compute_stats &&
+    if ((constant_color_detect || opaque_detect || compute_average_color) &&
         src->spec().x == 0 && src->spec().y == 0 && src->spec().z == 0 &&
         src->spec().full_x == 0 && src->spec().full_y == 0 &&
         src->spec().full_z == 0 && src->spec().full_width == src->spec().width &&
@@ -992,10 +1514,9 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
     }
 
     // If requested - and we're a monochrome image - drop the extra channels
-    if (configspec.get_int_attribute("maketx:monochrome_detect") &&
+    if (monochrome_detect && analysis.monochrome &&
           nchannels <= 0 &&
-          src->nchannels() == 3 && src->spec().alpha_channel < 0 &&  // RGB only
-          ImageBufAlgo::isMonochrome(*src)) {
+          src->nchannels() == 3 && src->spec().alpha_channel < 0) {  // RGB only
         if (verbose)
             outstream << "  Monochrome image detected. Converting to single channel texture.\n";
         std::shared_ptr<ImageBuf> newsrc (new ImageBuf(src->spec()));
@@ -1191,11 +1712,12 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
         outstream << "  Warning: " << pixelsFixed << " nan/inf pixels fixed.\n";
 
     // If --checknan was used and it's a floating point image, check for
-    // nonfinite (NaN or Inf) values and abort if they are found.
-    if (configspec.get_int_attribute("maketx:checknan") &&
-                    (srcspec.format.basetype == TypeDesc::FLOAT ||
-                     srcspec.format.basetype == TypeDesc::HALF ||
-                     srcspec.format.basetype == TypeDesc::DOUBLE)) {
+    // nonfinite (NaN or Inf) values and abort if they are found.  The
+    // analysis pass already knows whether there are any, unless they may
+    // have been fixed since; only then, or to locate them for the error
+    // message, do we need another look at the pixels.
+    if (checknan && (analysis.nonfinite ||
+                     fixmode != ImageBufAlgo::NONFINITE_NONE)) {
         int found_nonfinite = 0;
         ImageBufAlgo::parallel_image (OIIO::bind(check_nan_block, OIIO::ref(*src), _1, OIIO::ref(found_nonfinite)),
                                       OIIO::get_roi(srcspec));
@@ -1233,18 +1755,16 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
             ccSrc.reset (new ImageBuf (floatSpec));
         }
 
-        ColorConfig colorconfig;
-        if (colorconfig.error()) {
-            outstream << "Error Creating ColorConfig\n";
-            outstream << colorconfig.geterror() << std::endl;
-            return false;
-        }
-        
-        ColorProcessor * processor = colorconfig.createColorProcessor (
-            incolorspace.c_str(), outcolorspace.c_str());
-        if (!processor || colorconfig.error()) {
+        // Use the shared default color configuration and its cached
+        // processors, so that converting many textures (concurrently or
+        // one after another) reads the config and builds the transform
+        // only once.
+        std::string err;
+        const ColorProcessor *processor = pvt::colorprocessor_create (NULL,
+                                incolorspace, outcolorspace, "", "", err);
+        if (! processor) {
             outstream << "Error Creating Color Processor." << std::endl;
-            outstream << colorconfig.geterror() << std::endl;
+            outstream << err << std::endl;
             return false;
         }
         
@@ -1273,9 +1793,6 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
             }
         }
 
-        ColorConfig::deleteColorProcessor(processor);
-        processor = NULL;
-
         // swap the color-converted buffer and src (making src be the
         // working master that's color converted).
         std::swap (src, ccSrc);
@@ -1380,6 +1897,8 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
             std::string ("AverageColor=(\\[?") + fp_number_pattern + ",?)+\\]?[ ]*";
         desc = boost::regex_replace (desc, boost::regex(constcolor_pattern), "");
         desc = boost::regex_replace (desc, boost::regex(average_pattern), "");
+        erase_hint (desc, "oiio:TileStats=");
+        erase_hint (desc, "oiio:EnvCDF=");
         updatedDesc = true;
     }
     
@@ -1414,6 +1933,30 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
     }
     double stat_hashtime = alltime.lap();
     STATUS ("SHA-1 hash", stat_hashtime);
+
+    // In incremental mode, leave an existing texture alone if it was made
+    // with identical command line arguments from identical pixels, going by
+    // the hash it recorded, even if the source file has been rewritten
+    // since.  Only the source is read and hashed; no MIP levels are
+    // filtered and nothing is encoded or written.
+    if (configspec.get_int_attribute ("maketx:incremental") &&
+        hash_digest.size() && Filesystem::exists (outputfilename)) {
+        std::string lasthash, lastcmdline;
+        if (ImageInput *in = ImageInput::open (outputfilename)) {
+            lasthash = in->spec().get_string_attribute ("oiio:SHA-1");
+            lastcmdline = in->spec().get_string_attribute ("Software");
+            ImageInput::destroy (in);
+        }
+        std::string newcmdline = configspec.get_string_attribute("maketx:full_command_line");
+        if (lasthash == hash_digest && lastcmdline == newcmdline) {
+            outstream << "maketx: no update required for \""
+                      << outputfilename << "\" (pixels unchanged)\n";
+            if (updatemode && from_filename)
+                Filesystem::last_write_time (outputfilename, in_time);
+            delete out;
+            return true;
+        }
+    }
   
     if (isConstantColor) {
         std::ostringstream os; // Emulate a JSON array
@@ -1455,6 +1998,24 @@ make_texture_impl (ImageBufAlgo::MakeTextureMode mode,
             outstream << "  AverageColor: " << os.str() << std::endl;
     }
 
+    if (configspec.get_int_attribute ("maketx:tile_stats")) {
+        std::string stats = tile_stats_string (*toplevel,
+                                               dstspec.tile_width,
+                                               dstspec.tile_height);
+        if (out->supports("arbitrary_metadata")) {
+            dstspec.attribute ("oiio:TileStats", stats);
+        } else {
+            if (desc.length())
+                desc += " ";
+            desc += "oiio:TileStats=";
+            desc += stats;
+            updatedDesc = true;
+        }
+        if (verbose)
+            outstream << "  TileStats: " << stats.size()
+                      << " bytes of per-tile average, min, max\n";
+    }
+
     if (updatedDesc) {
         dstspec.attribute ("ImageDescription", desc);
     }
@@ -1543,6 +2104,83 @@ ImageBufAlgo::make_texture (ImageBufAlgo::MakeTextureMode mode,
 
 
 
+bool
+ImageBufAlgo::make_texture_batch (ImageBufAlgo::MakeTextureMode mode,
+                                  const std::vector<std::string> &filenames,
+                                  const std::vector<std::string> &outputfilenames,
+                                  const ImageSpec &configspec,
+                                  std::ostream *outstream_ptr,
+                                  int njobs)
+{
+    std::stringstream localstream; // catch output when user doesn't want it
+    std::ostream &outstream (outstream_ptr ? *outstream_ptr : localstream);
+    Timer alltime;
+    int ntex = (int) filenames.size();
+    if (ntex == 0)
+        return true;
+    if (njobs <= 0) {
+        // Each conversion is itself multithreaded, so a few at once are
+        // enough to fill the gaps while others are reading or writing.
+        njobs = std::max (2, (int)Sysutil::hardware_concurrency() / 4);
+    }
+    njobs = std::min (njobs, ntex);
+
+    // Start the biggest inputs first, so that a large one is not left
+    // running by itself at the end.
+    std::vector<uint64_t> insize (ntex, 0);
+    std::vector<int> order (ntex);
+    for (int i = 0; i < ntex; ++i) {
+        order[i] = i;
+        if (Filesystem::exists (filenames[i]))
+            insize[i] = Filesystem::file_size (filenames[i]);
+    }
+    std::stable_sort (order.begin(), order.end(),
+                      [&](int a, int b){ return insize[a] > insize[b]; });
+
+    atomic_int next (0), nfailed (0);
+    auto worker = [&]() {
+        for (int n; (n = next++) < ntex; ) {
+            int i = order[n];
+            std::string out = i < (int)outputfilenames.size()
+                            ? outputfilenames[i] : std::string();
+            // Gather each job's messages and print them together, so
+            // that concurrent jobs don't interleave their output.
+            std::stringstream jobstream;
+            bool ok = make_texture_impl (mode, NULL, filenames[i], out,
+                                         configspec, &jobstream);
+            if (! ok)
+                ++nfailed;
+            spin_lock lock (maketx_mutex);
+            outstream << jobstream.str();
+            outstream.flush ();
+        }
+    };
+    thread_group workers;
+    for (int j = 1; j < njobs; ++j)
+        workers.create_thread (worker);
+    worker ();
+    workers.join_all ();
+
+    double all = alltime();
+    if (configspec.get_int_attribute ("maketx:verbose") ||
+        configspec.get_int_attribute ("maketx:runstats")) {
+        uint64_t total = 0;
+        for (auto s : insize)
+            total += s;
+        outstream << Strutil::format ("maketx batch: %d textures (%d failed) "
+                                      "in %s, %d at a time\n", ntex,
+                                      int(nfailed), Strutil::timeintervalformat(all,2),
+                                      njobs);
+        if (all > 0.0)
+            outstream << Strutil::format ("  throughput: %.2f textures/s, "
+                                          "%s/s of input\n", ntex/all,
+                                          Strutil::memformat(size_t(total/all)));
+    }
+    return nfailed == 0;
+}
+
+
+
 bool
 ImageBufAlgo::make_texture (ImageBufAlgo::MakeTextureMode mode,
                             const ImageBuf &input,
@@ -0,0 +1,364 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+#ifndef OPENIMAGEIO_PALETTE_PVT_H
+#define OPENIMAGEIO_PALETTE_PVT_H
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "OpenImageIO/dassert.h"
+#include "OpenImageIO/oiioversion.h"
+#include "OpenImageIO/parallel.h"
+#include "OpenImageIO/simd.h"
+
+
+/*
+Color palette helpers shared by the plugins for indexed-color formats.
+
+On input, index data of 1, 2, 4 or 8 bits per pixel is expanded through
+a 256 entry table of packed RGBA bytes, so that each pixel costs one
+32 bit load (an AVX2 gather of eight at a time where available) rather
+than a separate lookup per channel.
+
+On output, Quantizer picks a palette for RGB(A) 8 bit pixels by median
+cut over a 5-5-5 color histogram that is gathered in parallel, and
+answers nearest-color queries from a precomputed 6-6-6 lookup table.
+*/
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace palette_pvt {
+
+/// Up to 256 colors stored as RGBA bytes in memory order.  Entries that
+/// are never set are opaque black, so out of range indices in a damaged
+/// file are harmless.
+struct Palette {
+    uint32_t entry[256];
+
+    Palette () { clear (); }
+
+    void clear () {
+        const unsigned char black[4] = { 0, 0, 0, 255 };
+        for (int i = 0; i < 256; ++i)
+            memcpy (&entry[i], black, 4);
+    }
+
+    void set (int i, unsigned char r, unsigned char g, unsigned char b,
+              unsigned char a = 255) {
+        if (i >= 0 && i < 256) {
+            const unsigned char c[4] = { r, g, b, a };
+            memcpy (&entry[i], c, 4);
+        }
+    }
+};
+
+
+
+/// Unpack n indices of bits (1, 2, 4 or 8) each, packed most significant
+/// bits first as every indexed format we read does, into one byte each.
+inline void
+unpack_indices (const unsigned char *in, int bits, int64_t n,
+                unsigned char *out)
+{
+    if (bits == 8) {
+        memcpy (out, in, size_t(n));
+        return;
+    }
+    const int per_byte = 8 / bits;
+    const unsigned char mask = (unsigned char)((1 << bits) - 1);
+    int64_t i = 0;
+    for ( ; i + per_byte <= n; i += per_byte, ++in)
+        for (int k = 0; k < per_byte; ++k)
+            out[i+k] = (*in >> (8 - bits * (k+1))) & mask;
+    for (int k = 0; i < n; ++i, ++k)
+        out[i] = (*in >> (8 - bits * (k+1))) & mask;
+}
+
+
+
+/// Expand n 8 bit indices through the palette into nchannels (3 or 4)
+/// bytes per pixel.
+inline void
+expand (const Palette &pal, const unsigned char *idx, int64_t n,
+        int nchannels, unsigned char *out)
+{
+    int64_t i = 0;
+    if (nchannels == 4) {
+#if OIIO_SIMD_AVX >= 2
+        for ( ; i + 8 <= n; i += 8) {
+            __m256i v = _mm256_cvtepu8_epi32 (
+                            _mm_loadl_epi64 ((const __m128i *)(idx + i)));
+            v = _mm256_i32gather_epi32 ((const int *)pal.entry, v, 4);
+            _mm256_storeu_si256 ((__m256i *)(out + 4*i), v);
+        }
+#endif
+        for ( ; i < n; ++i)
+            memcpy (out + 4*i, &pal.entry[idx[i]], 4);
+        return;
+    }
+
+    DASSERT (nchannels == 3);
+#if OIIO_SIMD_AVX >= 2
+    // Gather eight RGBA entries, squeeze each 128 bit half to 12 bytes of
+    // RGB, and store the halves overlapping.  The last store writes 4
+    // bytes past the pixels, so stop while there's room for that.
+    const __m256i squeeze = _mm256_setr_epi8 (
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    for ( ; i + 10 <= n; i += 8) {
+        __m256i v = _mm256_cvtepu8_epi32 (
+                        _mm_loadl_epi64 ((const __m128i *)(idx + i)));
+        v = _mm256_i32gather_epi32 ((const int *)pal.entry, v, 4);
+        v = _mm256_shuffle_epi8 (v, squeeze);
+        _mm_storeu_si128 ((__m128i *)(out + 3*i), _mm256_castsi256_si128 (v));
+        _mm_storeu_si128 ((__m128i *)(out + 3*i + 12),
+                          _mm256_extracti128_si256 (v, 1));
+    }
+#endif
+    // Four byte copies that overlap the next pixel, except for the last.
+    for ( ; i + 1 < n; ++i)
+        memcpy (out + 3*i, &pal.entry[idx[i]], 4);
+    if (i < n)
+        memcpy (out + 3*i, &pal.entry[idx[i]], 3);
+}
+
+
+
+/// Expand n indices of bits (1, 2, 4 or 8) each through the palette into
+/// nchannels (3 or 4) bytes per pixel.
+inline void
+expand_packed (const Palette &pal, const unsigned char *in, int bits,
+               int64_t n, int nchannels, unsigned char *out)
+{
+    if (bits == 8) {
+        expand (pal, in, n, nchannels, out);
+        return;
+    }
+    // Unpack through a small stack buffer, a whole number of input
+    // bytes at a time.
+    unsigned char idx[1024];
+    const int per_byte = 8 / bits;
+    for (int64_t i = 0; i < n; i += 1024) {
+        int64_t m = std::min (n - i, int64_t(1024));
+        unpack_indices (in + i / per_byte, bits, m, idx);
+        expand (pal, idx, m, nchannels, out + i * nchannels);
+    }
+}
+
+
+
+/// Chooses a palette for 8 bit RGBA pixels (alpha is ignored) and maps
+/// colors to their nearest palette entry.
+class Quantizer {
+public:
+    Quantizer () : m_ncolors(0) { }
+
+    /// Choose at most maxcolors (no more than 256) colors representing
+    /// the npixels pixels.
+    void build (const unsigned char *rgba, int64_t npixels, int maxcolors);
+
+    /// Number of palette colors chosen by build().
+    int size () const { return m_ncolors; }
+
+    /// RGB of palette entry i.
+    const unsigned char *color (int i) const { return m_colors[i]; }
+
+    /// Index of the palette entry nearest to the color.
+    int nearest (int r, int g, int b) const {
+        return m_map[((r >> 2) << 12) | ((g >> 2) << 6) | (b >> 2)];
+    }
+
+private:
+    struct Bin {
+        uint64_t n, r, g, b;
+        unsigned char c[3];     // 5 bit coordinates of the bin
+    };
+    struct Box {
+        size_t begin, end;      // range of m_bins
+        uint64_t n;
+        int axis, extent;       // longest axis and its length in bins
+    };
+
+    void measure (Box &box) const;
+
+    std::vector<Bin> m_bins;
+    unsigned char m_colors[256][3];
+    int m_ncolors;
+    std::vector<unsigned char> m_map;   // 6-6-6 RGB -> nearest entry
+};
+
+
+
+inline void
+Quantizer::measure (Box &box) const
+{
+    int lo[3] = { 31, 31, 31 }, hi[3] = { 0, 0, 0 };
+    box.n = 0;
+    for (size_t i = box.begin; i < box.end; ++i) {
+        box.n += m_bins[i].n;
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = std::min (lo[a], int(m_bins[i].c[a]));
+            hi[a] = std::max (hi[a], int(m_bins[i].c[a]));
+        }
+    }
+    box.axis = 0;
+    for (int a = 1; a < 3; ++a)
+        if (hi[a] - lo[a] > hi[box.axis] - lo[box.axis])
+            box.axis = a;
+    box.extent = hi[box.axis] - lo[box.axis];
+}
+
+
+
+inline void
+Quantizer::build (const unsigned char *rgba, int64_t npixels, int maxcolors)
+{
+    maxcolors = std::max (1, std::min (maxcolors, 256));
+
+    // Histogram over 5-5-5 bins, one partial histogram per chunk of
+    // pixels.  Chunks hold at most 2^24 pixels so the 32 bit sums can't
+    // overflow.
+    struct Partial { uint32_t n, r, g, b; };
+    const int nbins = 1 << 15;
+    const int64_t maxchunk = int64_t(1) << 24;
+    int64_t nchunks = std::min ((npixels + 65535) / 65536,
+                                int64_t(2 * default_thread_pool()->size()));
+    nchunks = std::max (nchunks, (npixels + maxchunk - 1) / maxchunk);
+    nchunks = std::max (nchunks, int64_t(1));
+    const int64_t chunk = (npixels + nchunks - 1) / nchunks;
+    std::vector<Partial> partial (size_t(nchunks * nbins), Partial());
+    parallel_for_chunked (0, npixels, chunk, [&](int64_t b, int64_t e) {
+        Partial *h = &partial[size_t(b / chunk * nbins)];
+        for (const unsigned char *p = rgba + 4*b; b < e; ++b, p += 4) {
+            Partial &bin (h[((p[0] >> 3) << 10) | ((p[1] >> 3) << 5) | (p[2] >> 3)]);
+            bin.n += 1;
+            bin.r += p[0];
+            bin.g += p[1];
+            bin.b += p[2];
+        }
+    });
+
+    m_bins.clear ();
+    for (int i = 0; i < nbins; ++i) {
+        Bin bin = { 0, 0, 0, 0, { (unsigned char)(i >> 10),
+                                  (unsigned char)((i >> 5) & 31),
+                                  (unsigned char)(i & 31) } };
+        for (int64_t c = 0; c < nchunks; ++c) {
+            const Partial &p (partial[size_t(c * nbins + i)]);
+            bin.n += p.n;  bin.r += p.r;  bin.g += p.g;  bin.b += p.b;
+        }
+        if (bin.n)
+            m_bins.push_back (bin);
+    }
+
+    // Median cut: keep splitting the box with the most pixels times
+    // extent, at the pixel median of its longest axis.
+    std::vector<Box> boxes;
+    if (! m_bins.empty()) {
+        Box all = { 0, m_bins.size(), 0, 0, 0 };
+        measure (all);
+        boxes.push_back (all);
+    }
+    while (int(boxes.size()) < maxcolors) {
+        int best = -1;
+        uint64_t bestscore = 0;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            uint64_t score = boxes[i].n * uint64_t(boxes[i].extent);
+            if (boxes[i].end - boxes[i].begin > 1 && score > bestscore) {
+                best = int(i);
+                bestscore = score;
+            }
+        }
+        if (best < 0)
+            break;    // every box is down to a single bin
+        Box &box (boxes[best]);
+        const int axis = box.axis;
+        std::sort (m_bins.begin() + box.begin, m_bins.begin() + box.end,
+                   [axis](const Bin &a, const Bin &b) {
+                       return a.c[axis] < b.c[axis];
+                   });
+        size_t split = box.begin + 1;
+        uint64_t below = m_bins[box.begin].n;
+        while (split + 1 < box.end && below + m_bins[split].n <= box.n / 2)
+            below += m_bins[split++].n;
+        Box upper = { split, box.end, 0, 0, 0 };
+        box.end = split;
+        measure (box);
+        measure (upper);
+        boxes.push_back (upper);
+    }
+
+    m_ncolors = std::max (1, int(boxes.size()));
+    memset (m_colors, 0, sizeof(m_colors));
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        uint64_t n = 0, r = 0, g = 0, b = 0;
+        for (size_t j = boxes[i].begin; j < boxes[i].end; ++j) {
+            n += m_bins[j].n;  r += m_bins[j].r;
+            g += m_bins[j].g;  b += m_bins[j].b;
+        }
+        m_colors[i][0] = (unsigned char)((r + n/2) / n);
+        m_colors[i][1] = (unsigned char)((g + n/2) / n);
+        m_colors[i][2] = (unsigned char)((b + n/2) / n);
+    }
+
+    // Nearest palette entry for the center of every 6-6-6 cell.
+    m_map.resize (1 << 18);
+    parallel_for (0, 64, [&](int64_t r6) {
+        const int r = int(r6) * 4 + 2;
+        for (int g6 = 0; g6 < 64; ++g6) {
+            const int g = g6 * 4 + 2;
+            unsigned char *map = &m_map[(r6 << 12) | (g6 << 6)];
+            for (int b6 = 0; b6 < 64; ++b6) {
+                const int b = b6 * 4 + 2;
+                int best = 0, bestdist = 1 << 30;
+                for (int i = 0; i < m_ncolors; ++i) {
+                    int dr = r - m_colors[i][0];
+                    int dg = g - m_colors[i][1];
+                    int db = b - m_colors[i][2];
+                    int d = dr*dr + dg*dg + db*db;
+                    if (d < bestdist) {
+                        best = i;
+                        bestdist = d;
+                    }
+                }
+                map[b6] = (unsigned char) best;
+            }
+        }
+    });
+}
+
+}  // end namespace palette_pvt
+
+OIIO_NAMESPACE_END
+
+#endif // OPENIMAGEIO_PALETTE_PVT_H
@@ -0,0 +1,249 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+#ifndef OPENIMAGEIO_RLE_PVT_H
+#define OPENIMAGEIO_RLE_PVT_H
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "OpenImageIO/oiioversion.h"
+#include "OpenImageIO/simd.h"
+
+
+/*
+Run-length encoding shared by the plugins for the older formats whose
+pixel data is a sequence of "packets": a header byte giving a count and
+whether this is a run of one repeated value or a literal span of
+values, followed by the value or values.  The formats differ mainly in
+how the header is laid out (see RLEStyle), and in what a "value" is --
+a whole pixel (Targa) or a single byte of one channel (IFF, RLA, SGI).
+All the work is in units of unitbytes bytes.
+
+Runs are found by comparing the data against itself shifted by one unit
+(a run is where every byte matches the one a unit later), 16 bytes at a
+time with SIMD where available.  Literals and run fills are memcpy.
+*/
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace rle_pvt {
+
+enum RLEStyle {
+    HighBitRun,     ///< Targa, IFF: hi bit set = run; count = (h&0x7f)+1
+    HighBitLiteral, ///< SGI: hi bit set = literal; count = h&0x7f; 0 ends
+    SignedCount     ///< RLA: h >= 0 is a run of h+1, h < 0 literal of -h
+};
+
+
+
+/// Return how many of the first len bytes of a and b are the same.
+inline size_t
+matching_bytes (const unsigned char *a, const unsigned char *b, size_t len)
+{
+    size_t i = 0;
+#if OIIO_SIMD_SSE
+    for ( ; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128 ((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128 ((const __m128i *)(b + i));
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (x, y)) != 0xffff)
+            break;  // the difference is somewhere in these 16
+    }
+#endif
+    while (i < len && a[i] == b[i])
+        ++i;
+    return i;
+}
+
+
+
+/// Return the length (at least 1, at most min(n,maxrun)) of the run of
+/// identical units starting at p, where n units are available.
+inline size_t
+run_length (const unsigned char *p, size_t n, int unitbytes, size_t maxrun)
+{
+    n = std::min (n, maxrun);
+    if (n < 2 || memcmp (p, p + unitbytes, unitbytes))
+        return 1;   // the common early out, not worth the setup
+    size_t len = (n - 1) * unitbytes;
+    return 1 + matching_bytes (p, p + unitbytes, len) / unitbytes;
+}
+
+
+
+/// Fill count units of out with copies of the unit at value.
+inline void
+fill (unsigned char *out, const unsigned char *value, int unitbytes,
+      size_t count)
+{
+    if (! count)
+        return;
+    if (unitbytes == 1) {
+        memset (out, *value, count);
+        return;
+    }
+    // Copy the unit once, then keep doubling what we've filled
+    size_t total = count * unitbytes, done = unitbytes;
+    memcpy (out, value, unitbytes);
+    while (done < total) {
+        size_t n = std::min (done, total - done);
+        memcpy (out + done, out, n);
+        done += n;
+    }
+}
+
+
+
+/// Longest run and literal a packet of the given style can hold.
+inline size_t
+max_packet (RLEStyle style)
+{
+    // N.B. SGI counts are only 7 bits; an RLA literal of 128 (count
+    // -128) would be legal, but trips up some readers.
+    return style == HighBitRun ? 128 : 127;
+}
+
+
+
+/// Decode packets of the given style from the inlen bytes at in, until
+/// nunits units have been written to out.  A packet running past the
+/// end of out is truncated.  Return the number of bytes of in that were
+/// used (for HighBitLiteral, including the terminating 0 count, if
+/// present), or 0 if in ran out or was malformed before out was full.
+inline size_t
+decode (RLEStyle style, const unsigned char *in, size_t inlen,
+        unsigned char *out, size_t nunits, int unitbytes)
+{
+    const unsigned char *inbegin = in, *inend = in + inlen;
+    unsigned char *outend = out + nunits * unitbytes;
+    // SGI's 16 bit flavor also has 16 bit headers (big-endian)
+    int headerbytes = (style == HighBitLiteral) ? unitbytes : 1;
+    while (out < outend) {
+        if (inend - in < headerbytes)
+            return 0;
+        int h = in[headerbytes-1];
+        in += headerbytes;
+        bool run;
+        size_t count;
+        if (style == HighBitRun) {
+            run = (h & 0x80) != 0;
+            count = (h & 0x7f) + 1;
+        } else if (style == HighBitLiteral) {
+            run = (h & 0x80) == 0;
+            count = h & 0x7f;
+            if (! count)
+                return 0;   // terminated early
+        } else {
+            run = (signed char)h >= 0;
+            count = run ? size_t(h) + 1 : size_t(-(signed char)h);
+        }
+        size_t bytes = std::min (count * unitbytes, size_t(outend - out));
+        if (run) {
+            if (size_t(inend - in) < size_t(unitbytes))
+                return 0;
+            fill (out, in, unitbytes, bytes / unitbytes);
+            in += unitbytes;
+        } else {
+            if (size_t(inend - in) < bytes)
+                return 0;
+            memcpy (out, in, bytes);
+            in += count * unitbytes;  // skip any truncated remainder
+            if (in > inend)
+                in = inend;
+        }
+        out += bytes;
+    }
+    if (style == HighBitLiteral && inend - in >= headerbytes &&
+            (in[headerbytes-1] & 0x7f) == 0)
+        in += headerbytes;   // consume the terminator
+    return size_t (in - inbegin);
+}
+
+
+
+/// Run-length encode nunits units of unitbytes each from in, in the
+/// given style, appending the packets to out.  (HighBitLiteral output
+/// gets its terminating 0 count.)
+inline void
+encode (RLEStyle style, const unsigned char *in, size_t nunits,
+        int unitbytes, std::vector<unsigned char> &out)
+{
+    const size_t maxpacket = max_packet (style);
+    int headerbytes = (style == HighBitLiteral) ? unitbytes : 1;
+    // A run of two single bytes saves nothing over leaving them in a
+    // literal, but a run of two pixels does.
+    const size_t minrun = (unitbytes > 1) ? 2 : 3;
+    auto header = [&](bool run, size_t count) {
+        int h;
+        if (count == 0)
+            h = 0;    // SGI terminator
+        else if (style == HighBitRun)
+            h = int(count - 1) | (run ? 0x80 : 0);
+        else if (style == HighBitLiteral)
+            h = int(count) | (run ? 0 : 0x80);
+        else
+            h = run ? int(count - 1) : (256 - int(count));
+        for (int i = 1; i < headerbytes; ++i)
+            out.push_back (0);
+        out.push_back ((unsigned char) h);
+    };
+    auto literal = [&](size_t begin, size_t end) {
+        while (begin < end) {
+            size_t count = std::min (end - begin, maxpacket);
+            header (false, count);
+            const unsigned char *p = in + begin * unitbytes;
+            out.insert (out.end(), p, p + count * unitbytes);
+            begin += count;
+        }
+    };
+    size_t litbegin = 0, i = 0;
+    while (i < nunits) {
+        const unsigned char *p = in + i * unitbytes;
+        size_t r = run_length (p, nunits - i, unitbytes, maxpacket);
+        if (r >= minrun) {
+            literal (litbegin, i);
+            header (true, r);
+            out.insert (out.end(), p, p + unitbytes);
+            litbegin = i + r;
+        }
+        i += r;
+    }
+    literal (litbegin, nunits);
+    if (style == HighBitLiteral)
+        header (false, 0);
+}
+
+}  // end namespace rle_pvt
+
+OIIO_NAMESPACE_END
+
+#endif  // OPENIMAGEIO_RLE_PVT_H
@@ -30,6 +30,7 @@
 
 
 #include <iostream>
+#include <unordered_map>
 
 #include <boost/regex.hpp>
 
@@ -150,6 +151,30 @@ static XMPtag xmptag [] = {
 
 
 
+// Utility: find the xmptag entry for an xml name (case insensitively),
+// or NULL if it's not one we know.  The table is indexed on first use,
+// so each attribute costs a hash lookup rather than a scan of the table.
+static const XMPtag *
+xmp_tag_lookup (const char *xmlname)
+{
+    typedef std::unordered_map<std::string, const XMPtag *> TagIndex;
+    static const TagIndex index = [](){
+        TagIndex t;
+        for (int i = 0;  xmptag[i].xmpname;  ++i) {
+            std::string name (xmptag[i].xmpname);
+            Strutil::to_lower (name);
+            t.insert (std::make_pair (name, &xmptag[i]));  // first one wins
+        }
+        return t;
+    }();
+    std::string name (xmlname);
+    Strutil::to_lower (name);
+    TagIndex::const_iterator found = index.find (name);
+    return found == index.end() ? NULL : found->second;
+}
+
+
+
 // Utility: add an attribute to the spec with the given xml name and
 // value.  Search for it in xmptag, and if found that will tell us what
 // the type is supposed to be, as well as any special handling.  If not
@@ -160,55 +185,53 @@ add_attrib (ImageSpec &spec, const char *xmlname, const char *xmlvalue)
 #if DEBUG_XMP_READ
     std::cerr << "add_attrib " << xmlname << ": '" << xmlvalue << "'\n";
 #endif
-    for (int i = 0;  xmptag[i].xmpname;  ++i) {
-        if (Strutil::iequals (xmptag[i].xmpname, xmlname)) {
-            if (! xmptag[i].oiioname || ! xmptag[i].oiioname[0])
-                return;   // ignore it purposefully
-            if (xmptag[i].oiiotype == TypeDesc::STRING) {
-                std::string val;
-                if (xmptag[i].special & (IsList|IsSeq)) {
-                    // Special case -- append it to a list
-                    std::vector<std::string> items;
-                    ImageIOParameter *p = spec.find_attribute (xmptag[i].oiioname, TypeDesc::STRING); 
-                    bool dup = false;
-                    if (p) {
-                        Strutil::split (*(const char **)p->data(), items, ";");
-                        for (size_t item = 0;  item < items.size();  ++item) {
-                            items[item] = Strutil::strip (items[item]);
-                            dup |= (items[item] == xmlvalue);
-                        }
-                        dup |= (xmlvalue == std::string(*(const char **)p->data()));
+    if (const XMPtag *tag = xmp_tag_lookup (xmlname)) {
+        if (! tag->oiioname || ! tag->oiioname[0])
+            return;   // ignore it purposefully
+        if (tag->oiiotype == TypeDesc::STRING) {
+            std::string val;
+            if (tag->special & (IsList|IsSeq)) {
+                // Special case -- append it to a list
+                std::vector<std::string> items;
+                ImageIOParameter *p = spec.find_attribute (tag->oiioname, TypeDesc::STRING); 
+                bool dup = false;
+                if (p) {
+                    Strutil::split (*(const char **)p->data(), items, ";");
+                    for (size_t item = 0;  item < items.size();  ++item) {
+                        items[item] = Strutil::strip (items[item]);
+                        dup |= (items[item] == xmlvalue);
                     }
-                    if (! dup)
-                        items.push_back (xmlvalue);
-                    val = Strutil::join (items, "; ");
-                } else {
-                    val = xmlvalue;
+                    dup |= (xmlvalue == std::string(*(const char **)p->data()));
                 }
-                spec.attribute (xmptag[i].oiioname, val);
-                return;
-            } else if (xmptag[i].oiiotype == TypeDesc::INT) {
-                if (xmptag[i].special & IsBool)
-                    spec.attribute (xmptag[i].oiioname, (int)Strutil::iequals(xmlvalue,"true"));
-                else  // ordinary int
-                    spec.attribute (xmptag[i].oiioname, (int)atoi(xmlvalue));
-                return;
-            } else if (xmptag[i].oiiotype == TypeDesc::FLOAT) {
-                float f = atoi (xmlvalue);
-                const char *slash = strchr (xmlvalue, '/');
-                if (slash)  // It's rational!
-                    f /= (float) atoi (slash+1);
-                spec.attribute (xmptag[i].oiioname, f);
-                return;
+                if (! dup)
+                    items.push_back (xmlvalue);
+                val = Strutil::join (items, "; ");
+            } else {
+                val = xmlvalue;
             }
-#if (!defined(NDEBUG) || DEBUG_XMP_READ)
-            else {
-                std::cerr << "iptc xml add_attrib unknown type " << xmlname 
-                          << ' ' << xmptag[i].oiiotype.c_str() << "\n";
-            }
-#endif
+            spec.attribute (tag->oiioname, val);
+            return;
+        } else if (tag->oiiotype == TypeDesc::INT) {
+            if (tag->special & IsBool)
+                spec.attribute (tag->oiioname, (int)Strutil::iequals(xmlvalue,"true"));
+            else  // ordinary int
+                spec.attribute (tag->oiioname, (int)atoi(xmlvalue));
             return;
+        } else if (tag->oiiotype == TypeDesc::FLOAT) {
+            float f = atoi (xmlvalue);
+            const char *slash = strchr (xmlvalue, '/');
+            if (slash)  // It's rational!
+                f /= (float) atoi (slash+1);
+            spec.attribute (tag->oiioname, f);
+            return;
+        }
+#if (!defined(NDEBUG) || DEBUG_XMP_READ)
+        else {
+            std::cerr << "iptc xml add_attrib unknown type " << xmlname 
+                      << ' ' << tag->oiiotype.c_str() << "\n";
         }
+#endif
+        return;
     }
     // Catch-all for unrecognized things -- just add them!
     spec.attribute (xmlname, xmlvalue);
@@ -306,13 +329,15 @@ decode_xmp (const std::string &xml, ImageSpec &spec)
         return true;
     for (size_t startpos = 0, endpos = 0;
          extract_middle (xml, endpos, "<rdf:Description", "</rdf:Description>", startpos, endpos);  ) {
-        // Turn that middle section into an XML document
-        std::string rdf (xml, startpos, endpos-startpos);  // scooch in
+        // Turn that middle section into an XML document (pugixml makes
+        // its own copy, so there's no need to cut it out first)
+        const char *rdf = xml.data() + startpos;
+        size_t rdflen = endpos - startpos;
 #if DEBUG_XMP_READ
-        std::cerr << "RDF is:\n---\n" << rdf << "\n---\n";
+        std::cerr << "RDF is:\n---\n" << std::string(rdf, rdflen) << "\n---\n";
 #endif
         pugi::xml_document doc;
-        pugi::xml_parse_result parse_result = doc.load_buffer (&rdf[0], rdf.size());
+        pugi::xml_parse_result parse_result = doc.load_buffer (rdf, rdflen);
         if (! parse_result) {
 #if DEBUG_XMP_READ
             std::cerr << "Error parsing XML\n";
@@ -50,6 +50,9 @@
 #include "OpenImageIO/imagecache.h"
 #include "imagecache_pvt.h"
 #include "texture_pvt.h"
+#include "imageio_pvt.h"
+
+#define TEX_FAST_MATH 1
 
 
 /*
@@ -278,18 +281,17 @@ TextureSystemImpl::environment (TextureHandle *texture_handle,
         dresultds += beginactive*nchannels;
         dresultdt += beginactive*nchannels;
     }
-    for (int i = beginactive;  i < endactive;  ++i) {
-        if (runflags[i]) {
-            TextureOpt opt (options, i);
-            ok &= environment (texture_handle, thread_info,
-                               opt, R[i], dRdx[i], dRdy[i],
-                               nchannels, result, dresultds, dresultdt);
-        }
-        result += nchannels;
-        if (dresultds) {
-            dresultds += nchannels;
-            dresultdt += nchannels;
-        }
+    // Visit the points in order of direction so neighbors share tiles.
+    std::vector<int> order;
+    spatial_batch_order (runflags, beginactive, endactive, R, true, order);
+    for (int i : order) {
+        TextureOpt opt (options, i);
+        int offset = (i-beginactive)*nchannels;
+        ok &= environment (texture_handle, thread_info,
+                           opt, R[i], dRdx[i], dRdy[i], nchannels,
+                           result + offset,
+                           dresultds ? dresultds + offset : NULL,
+                           dresultds ? dresultdt + offset : NULL);
     }
     return ok;
 }
@@ -301,6 +303,17 @@ TextureSystemImpl::environment (TextureHandle *texture_handle,
 inline void
 vector_to_latlong (const Imath::V3f& R, bool y_is_up, float &s, float &t)
 {
+#ifdef TEX_FAST_MATH
+    // fast_atan2's error (under 1e-5 radians) is far below a texel of any
+    // practical latlong map.
+    if (y_is_up) {
+        s = fast_atan2 (-R[0], R[2]) * float(0.5*M_1_PI) + 0.5f;
+        t = 0.5f - fast_atan2 (R[1], sqrtf(R[2]*R[2]+R[0]*R[0])) * float(M_1_PI);
+    } else {
+        s = fast_atan2 (R[1], R[0]) * float(0.5*M_1_PI) + 0.5f;
+        t = 0.5f - fast_atan2 (R[2], sqrtf(R[0]*R[0]+R[1]*R[1])) * float(M_1_PI);
+    }
+#else
     if (y_is_up) {
         s = atan2f (-R[0], R[2]) / (2.0f*(float)M_PI) + 0.5f;
         t = 0.5f - atan2f(R[1], hypotf(R[2],-R[0])) / (float)M_PI;
@@ -308,6 +321,7 @@ vector_to_latlong (const Imath::V3f& R, bool y_is_up, float &s, float &t)
         s = atan2f (R[1], R[0]) / (2.0f*(float)M_PI) + 0.5f;
         t = 0.5f - atan2f(R[2], hypotf(R[0],R[1])) / (float)M_PI;
     }
+#endif
     // learned from experience, beware NaNs
     if (isnan(s))
 	s = 0.0f;
@@ -316,6 +330,27 @@ vector_to_latlong (const Imath::V3f& R, bool y_is_up, float &s, float &t)
 }
 
 
+#ifdef TEX_FAST_MATH
+/// Convert 4 direction vectors (given as their x, y and z components) to
+/// latlong st coordinates at once.
+inline void
+vector_to_latlong (const float4& Rx, const float4& Ry, const float4& Rz,
+                   bool y_is_up, float4 &s, float4 &t)
+{
+    if (y_is_up) {
+        s = madd (fast_atan2 (-Rx, Rz), float4(float(0.5*M_1_PI)), float4(0.5f));
+        t = float4(0.5f) - fast_atan2 (Ry, sqrt(Rz*Rz+Rx*Rx)) * float4(float(M_1_PI));
+    } else {
+        s = madd (fast_atan2 (Ry, Rx), float4(float(0.5*M_1_PI)), float4(0.5f));
+        t = float4(0.5f) - fast_atan2 (Rz, sqrt(Rx*Rx+Ry*Ry)) * float4(float(M_1_PI));
+    }
+    // learned from experience, beware NaNs
+    s = select (s == s, s, float4::Zero());
+    t = select (t == t, t, float4::Zero());
+}
+#endif
+
+
 
 bool
 TextureSystemImpl::environment (ustring filename, TextureOpt &options,
@@ -341,6 +376,7 @@ TextureSystemImpl::environment (TextureHandle *texture_handle_,
                                 int nchannels, float *result,
                                 float *dresultds, float *dresultdt)
 {
+    OIIO_TRACE_ZONE ("TextureSystem::environment");
     // Handle >4 channel lookups by recursion.
     if (nchannels > 4) {
         int save_firstchannel = options.firstchannel;
@@ -397,14 +433,27 @@ TextureSystemImpl::environment (TextureHandle *texture_handle_,
     if (!(dresultds && dresultdt))
         dresultds = dresultdt = NULL;
 
+    // Point sampling (no derivatives, no blur) always lands on a single
+    // sample of the finest level, so skip all of the filter math.
+    if (_dRdx == Imath::V3f(0.0f) && _dRdy == Imath::V3f(0.0f) &&
+        options.sblur == 0.0f && options.tblur == 0.0f)
+        return environment_point (*texturefile, thread_info, options, _R,
+                                  nchannels, actualchannels, result,
+                                  dresultds, dresultdt);
+
     // Calculate unit-length vectors in the direction of R, R+dRdx, R+dRdy.
     // These define the ellipse we're filtering over.
     Imath::V3f R  = _R;  R.normalize();       // center
     Imath::V3f Rx = _R + _dRdx;  Rx.normalize();  // x axis of the ellipse
     Imath::V3f Ry = _R + _dRdy;  Ry.normalize();  // y axis of the ellipse
     // angles formed by the ellipse axes.
+#ifdef TEX_FAST_MATH
+    float xfilt_noblur = std::max (fast_acos(R.dot(Rx)), 1e-8f);
+    float yfilt_noblur = std::max (fast_acos(R.dot(Ry)), 1e-8f);
+#else
     float xfilt_noblur = std::max (safe_acos(R.dot(Rx)), 1e-8f);
     float yfilt_noblur = std::max (safe_acos(R.dot(Ry)), 1e-8f);
+#endif
     int naturalres = int((float)M_PI / std::min (xfilt_noblur, yfilt_noblur));
     // FIXME -- figure naturalres sepearately for s and t
     // FIXME -- ick, why is it x and y at all, shouldn't it be s and t?
@@ -451,7 +500,8 @@ TextureSystemImpl::environment (TextureHandle *texture_handle_,
 
     TextureOpt::MipMode mipmode = options.mipmode;
     bool aniso = (mipmode == TextureOpt::MipModeDefault ||
-                  mipmode == TextureOpt::MipModeAniso);
+                  mipmode == TextureOpt::MipModeAniso ||
+                  mipmode == TextureOpt::MipModeEWA);
 
     float aspect, trueaspect, filtwidth;
     int nsamples;
@@ -474,10 +524,26 @@ TextureSystemImpl::environment (TextureHandle *texture_handle_,
     // FIXME -- assuming latlong
     bool ok = true;
     float pos = -0.5f + 0.5f * invsamples;
+#ifdef TEX_FAST_MATH
+    float4 s4, t4;
+#endif
     for (int sample = 0;  sample < nsamples;  ++sample, pos += invsamples) {
-        Imath::V3f Rsamp = R + pos*Rmajor;
         float s, t;
+#ifdef TEX_FAST_MATH
+        if ((sample & 3) == 0) {
+            // Find the st of the next 4 samples along the major axis
+            float4 p = madd (float4::Iota(), float4(invsamples), float4(pos));
+            vector_to_latlong (madd (p, float4(Rmajor[0]), float4(R[0])),
+                               madd (p, float4(Rmajor[1]), float4(R[1])),
+                               madd (p, float4(Rmajor[2]), float4(R[2])),
+                               texturefile->m_y_up, s4, t4);
+        }
+        s = s4[sample & 3];
+        t = t4[sample & 3];
+#else
+        Imath::V3f Rsamp = R + pos*Rmajor;
         vector_to_latlong (Rsamp, texturefile->m_y_up, s, t);
+#endif
 
         // Determine the MIP-map level(s) we need: we will blend
         //  data(miplevel[0]) * (1-levelblend) + data(miplevel[1]) * levelblend
@@ -577,6 +643,227 @@ TextureSystemImpl::environment (TextureHandle *texture_handle_,
 
 
 
+bool
+TextureSystemImpl::environment_point (TextureFile &texturefile,
+                                      PerThreadInfo *thread_info,
+                                      TextureOpt &options, const Imath::V3f &R,
+                                      int nchannels, int actualchannels,
+                                      float *result,
+                                      float *dresultds, float *dresultdt)
+{
+    // This is what environment() would do for a single sample with an
+    // infinitesimal filter, which always lands on MIP level 0.
+    ImageCacheStatistics &stats (thread_info->m_stats);
+    sampler_prototype sampler;
+    switch (options.interpmode) {
+    case TextureOpt::InterpClosest :
+        sampler = &TextureSystemImpl::sample_closest;
+        ++stats.closest_interps;
+        break;
+    case TextureOpt::InterpBilinear :
+        sampler = &TextureSystemImpl::sample_bilinear;
+        ++stats.bilinear_interps;
+        break;
+    default:   // Bicubic, and SmartBicubic at the finest level
+        sampler = &TextureSystemImpl::sample_bicubic;
+        ++stats.cubic_interps;
+        break;
+    }
+    Imath::V3f Rn = R;  Rn.normalize();
+    float s, t;
+    vector_to_latlong (Rn, texturefile.m_y_up, s, t);
+    OIIO_SIMD4_ALIGN float sval[4] = { s, 0.0f, 0.0f, 0.0f };
+    OIIO_SIMD4_ALIGN float tval[4] = { t, 0.0f, 0.0f, 0.0f };
+    OIIO_SIMD4_ALIGN float weight[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    float4 r, drds, drdt;
+    bool ok = (this->*sampler) (1, sval, tval, 0, texturefile, thread_info,
+                                options, nchannels, actualchannels, weight,
+                                &r, dresultds ? &drds : NULL,
+                                dresultds ? &drdt : NULL);
+    for (int c = 0; c < nchannels; ++c)
+        result[c] += r[c];
+    if (dresultds) {
+        for (int c = 0; c < nchannels; ++c) {
+            dresultds[c] += drds[c];
+            dresultdt[c] += drdt[c];
+        }
+    }
+    ++stats.aniso_probes;
+    ++stats.aniso_queries;
+
+    const ImageSpec &spec (texturefile.spec(options.subimage, 0));
+    if (actualchannels < nchannels && options.firstchannel == 0 && m_gray_to_rgb)
+        fill_gray_channels (spec, nchannels, result, dresultds, dresultdt);
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::environment_cdf (ustring filename, int subimage,
+                                    int &width, int &height,
+                                    std::vector<float> &marginal,
+                                    std::vector<float> &conditional)
+{
+    PerThreadInfo *thread_info = m_imagecache->get_perthread_info ();
+    TextureFile *texturefile = find_texturefile (filename, thread_info);
+    texturefile = verify_texturefile (texturefile, thread_info);
+    if (! texturefile  ||  texturefile->broken())
+        return false;
+    if (subimage < 0 || subimage >= texturefile->subimages()) {
+        error ("Unknown subimage %d in texture \"%s\"", subimage, filename);
+        return false;
+    }
+    if (texturefile->textureformat() != TexFormatLatLongEnv) {
+        error ("\"%s\" is not a latlong environment map", filename);
+        return false;
+    }
+    ImageCacheFile::SubimageInfo &subinfo (texturefile->subimageinfo(subimage));
+    {
+        spin_lock lock (subinfo.env_cdf_mutex);
+        if (! subinfo.env_marginal.empty()) {
+            width = subinfo.env_cdf_width;
+            height = subinfo.env_cdf_height;
+            marginal = subinfo.env_marginal;
+            conditional = subinfo.env_conditional;
+            return true;
+        }
+    }
+
+    // First request: build the tables without holding the lock (it
+    // involves reading a whole MIP level), then install them.
+    // Use the finest level that is no more than 512 wide.
+    int level = 0, nlevels = subinfo.miplevels();
+    while (level < nlevels-1 && subinfo.spec(level).width > 512)
+        ++level;
+    const ImageSpec &spec (subinfo.spec(level));
+    int w = spec.width, h = spec.height, nc = spec.nchannels;
+    std::vector<float> mcdf, ccdf;
+
+    // If maketx --envcdf stored the tables with that level, they need
+    // only be decoded, without reading any pixels.
+    string_view stored = spec.get_string_attribute ("oiio:EnvCDF");
+    if (stored.empty()) {
+        string_view desc = spec.get_string_attribute ("ImageDescription");
+        size_t found = desc.find ("oiio:EnvCDF=");
+        if (found != string_view::npos) {
+            stored = desc.substr (found + 12);
+            stored = stored.substr (0, stored.find (' '));
+        }
+    }
+    int sw, sh;
+    if (stored.empty() ||
+          ! pvt::env_cdf_decode (stored, sw, sh, mcdf, ccdf) ||
+          sw != w || sh != h) {
+        std::vector<float> pixels ((size_t)w * h * nc);
+        if (! m_imagecache->get_pixels (texturefile, thread_info, subimage,
+                                        level, spec.x, spec.x+w, spec.y,
+                                        spec.y+h, spec.z, spec.z+1,
+                                        TypeDesc::FLOAT, &pixels[0])) {
+            error ("%s", m_imagecache->geterror());
+            return false;
+        }
+        pvt::env_cdf_build (&pixels[0], w, h, nc, mcdf, ccdf);
+    }
+
+    spin_lock lock (subinfo.env_cdf_mutex);
+    if (subinfo.env_marginal.empty()) {
+        subinfo.env_cdf_width = w;
+        subinfo.env_cdf_height = h;
+        subinfo.env_marginal.swap (mcdf);
+        subinfo.env_conditional.swap (ccdf);
+    }
+    width = subinfo.env_cdf_width;
+    height = subinfo.env_cdf_height;
+    marginal = subinfo.env_marginal;
+    conditional = subinfo.env_conditional;
+    return true;
+}
+
+
+
+void
+env_cdf_build (const float *pixels, int w, int h, int nc,
+                    std::vector<float> &mcdf, std::vector<float> &ccdf)
+{
+    mcdf.assign (h+1, 0.0f);
+    ccdf.assign ((size_t)h * (w+1), 0.0f);
+    for (int y = 0;  y < h;  ++y) {
+        // Rows near the poles cover less solid angle.
+        float rowweight = sinf (float(M_PI) * (y + 0.5f) / h);
+        float *row = &ccdf[(size_t)y * (w+1)];
+        const float *p = &pixels[(size_t)y * w * nc];
+        row[0] = 0.0f;
+        for (int x = 0;  x < w;  ++x, p += nc) {
+            float lum = nc >= 3 ? 0.2126f*p[0] + 0.7152f*p[1] + 0.0722f*p[2]
+                                : p[0];
+            row[x+1] = row[x] + std::max (lum, 0.0f);
+        }
+        float rowsum = row[w];
+        for (int x = 1;  x <= w;  ++x)
+            row[x] = rowsum > 0.0f ? row[x] / rowsum : float(x) / w;
+        mcdf[y+1] = mcdf[y] + rowsum * rowweight;
+    }
+    float total = mcdf[h];
+    for (int y = 1;  y <= h;  ++y)
+        mcdf[y] = total > 0.0f ? mcdf[y] / total : float(y) / h;
+}
+
+
+
+std::string
+env_cdf_encode (int w, int h, const std::vector<float> &mcdf,
+                     const std::vector<float> &ccdf)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string s = Strutil::format ("%d,%d,", w, h);
+    size_t header = s.size();
+    s.resize (header + 4 * (mcdf.size() + ccdf.size()));
+    char *d = &s[header];
+    for (int t = 0;  t < 2;  ++t)
+        for (float v : (t == 0 ? mcdf : ccdf)) {
+            // Rounding is monotonic, so the CDFs stay nondecreasing.
+            unsigned int q = (unsigned int) (clamp (v, 0.0f, 1.0f) * 65535.0f + 0.5f);
+            *d++ = hex[(q >> 12) & 15];
+            *d++ = hex[(q >> 8) & 15];
+            *d++ = hex[(q >> 4) & 15];
+            *d++ = hex[q & 15];
+        }
+    return s;
+}
+
+
+
+bool
+env_cdf_decode (string_view s, int &w, int &h,
+                     std::vector<float> &mcdf, std::vector<float> &ccdf)
+{
+    if (! (Strutil::parse_int (s, w) && Strutil::parse_char (s, ',') &&
+           Strutil::parse_int (s, h) && Strutil::parse_char (s, ',')))
+        return false;
+    size_t nm = size_t(h) + 1, nc = size_t(h) * (size_t(w) + 1);
+    if (w < 1 || h < 1 || s.size() != 4 * (nm + nc))
+        return false;
+    mcdf.resize (nm);
+    ccdf.resize (nc);
+    const char *p = s.data();
+    for (size_t i = 0;  i < nm + nc;  ++i) {
+        unsigned int q = 0;
+        for (int k = 0;  k < 4;  ++k, ++p) {
+            char c = *p;
+            int digit = (c >= '0' && c <= '9') ? c - '0'
+                      : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+            if (digit < 0)
+                return false;
+            q = (q << 4) | digit;
+        }
+        (i < nm ? mcdf[i] : ccdf[i-nm]) = q * (1.0f / 65535.0f);
+    }
+    return true;
+}
+
+
+
 }  // end namespace pvt
 
 OIIO_NAMESPACE_END
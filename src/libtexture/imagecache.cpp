@@ -34,26 +34,42 @@
 #include <vector>
 #include <cstring>
 #include <memory>
+#include <array>
+#include <algorithm>
 
 #include <OpenEXR/ImathMatrix.h>
 
+#include <zlib.h>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
 #include "OpenImageIO/dassert.h"
 #include "OpenImageIO/typedesc.h"
 #include "OpenImageIO/varyingref.h"
 #include "OpenImageIO/ustring.h"
 #include "OpenImageIO/filesystem.h"
+#include "OpenImageIO/hash.h"
 #include "OpenImageIO/thread.h"
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/strutil.h"
 #include "OpenImageIO/sysutil.h"
 #include "OpenImageIO/timer.h"
 #include "OpenImageIO/optparser.h"
+#include "OpenImageIO/parallel.h"
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/imagebuf.h"
 #include "OpenImageIO/imagecache.h"
 #include "OpenImageIO/texture.h"
 #include "OpenImageIO/simd.h"
 #include "imagecache_pvt.h"
+#include "../field3d.imageio/field3d_backdoor.h"
 
 
 OIIO_NAMESPACE_BEGIN
@@ -84,6 +100,8 @@ static ustring s_subimages ("subimages"), s_miplevels ("miplevels");
 static ustring s_datawindow ("datawindow"), s_displaywindow ("displaywindow");
 static ustring s_averagecolor ("averagecolor"), s_averagealpha ("averagealpha");
 static ustring s_constantcolor ("constantcolor"), s_constantalpha ("constantalpha");
+static ustring s_tile_stats_grid ("tile_stats_grid"), s_tile_average ("tile_average");
+static ustring s_tile_min ("tile_min"), s_tile_max ("tile_max");
 
 
 // Functor to compare filenames
@@ -128,6 +146,51 @@ redundantbytes_compare (const ImageCacheFileRef &a, const ImageCacheFileRef &b)
 }
 
 
+// Adds the time between its construction and destruction to a latency
+// histogram (if there is one).
+class LatencyTimer {
+public:
+    LatencyTimer (LatencyHistogram *hist) : m_hist(hist) { }
+    ~LatencyTimer () { if (m_hist) m_hist->add (m_timer()); }
+private:
+    LatencyHistogram *m_hist;
+    Timer m_timer;
+};
+
+
+// Append a string to a JSON document, quoted and escaped.
+static void
+append_json_string (std::string &out, string_view s)
+{
+    out += '\"';
+    for (unsigned char c : s) {
+        if (c == '\"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c < 0x20) {
+            out += Strutil::format ("\\u%04x", int(c));
+        } else {
+            out += c;
+        }
+    }
+    out += '\"';
+}
+
+
+static void
+append_json_histogram (std::string &out, const char *name,
+                       const LatencyHistogram &h)
+{
+    out += Strutil::format ("\"%s\":{\"bucket_us\":[", name);
+    for (int i = 0; i < LatencyHistogram::nbuckets-1; ++i)
+        out += Strutil::format ("%s%lld", i ? "," : "", 1LL << i);
+    out += "],\"counts\":[";
+    for (int i = 0; i < LatencyHistogram::nbuckets; ++i)
+        out += Strutil::format ("%s%lld", i ? "," : "", h.count[i]);
+    out += "]}";
+}
+
+
 };  // end anonymous namespace
 
 
@@ -141,6 +204,7 @@ ImageCacheStatistics::init ()
     // ImageCache stats:
     find_tile_calls = 0;
     find_tile_microcache_misses = 0;
+    find_tile_tiletable_hits = 0;
     find_tile_cache_misses = 0;
 //    tiles_created = 0;
 //    tiles_current = 0;
@@ -158,6 +222,19 @@ ImageCacheStatistics::init ()
     tile_locking_time = 0;
     find_file_time = 0;
     find_tile_time = 0;
+    tiles_evicted_clock = 0;
+    tiles_evicted_gclock = 0;
+    tiles_prefetched = 0;
+    tiles_constant = 0;
+    tiles_constant_bytes = 0;
+    compressed_tile_hits = 0;
+    compressed_tile_misses = 0;
+    disk_tile_hits = 0;
+    disk_tile_misses = 0;
+    disk_tiles_written = 0;
+    disk_tiles_mapped = 0;
+    tile_read_latency.init ();
+    file_open_latency.init ();
 
     // TextureSystem stats:
     texture_queries = 0;
@@ -186,6 +263,7 @@ ImageCacheStatistics::merge (const ImageCacheStatistics &s)
     // ImageCache stats:
     find_tile_calls += s.find_tile_calls;
     find_tile_microcache_misses += s.find_tile_microcache_misses;
+    find_tile_tiletable_hits += s.find_tile_tiletable_hits;
     find_tile_cache_misses += s.find_tile_cache_misses;
 //    tiles_created += s.tiles_created;
 //    tiles_current += s.tiles_current;
@@ -203,6 +281,19 @@ ImageCacheStatistics::merge (const ImageCacheStatistics &s)
     tile_locking_time += s.tile_locking_time;
     find_file_time += s.find_file_time;
     find_tile_time += s.find_tile_time;
+    tiles_evicted_clock += s.tiles_evicted_clock;
+    tiles_evicted_gclock += s.tiles_evicted_gclock;
+    tiles_prefetched += s.tiles_prefetched;
+    tiles_constant += s.tiles_constant;
+    tiles_constant_bytes += s.tiles_constant_bytes;
+    compressed_tile_hits += s.compressed_tile_hits;
+    compressed_tile_misses += s.compressed_tile_misses;
+    disk_tile_hits += s.disk_tile_hits;
+    disk_tile_misses += s.disk_tile_misses;
+    disk_tiles_written += s.disk_tiles_written;
+    disk_tiles_mapped += s.disk_tiles_mapped;
+    tile_read_latency.merge (s.tile_read_latency);
+    file_open_latency.merge (s.file_open_latency);
 
     // TextureSystem stats:
     texture_queries += s.texture_queries;
@@ -286,15 +377,21 @@ ImageCacheFile::ImageCacheFile (ImageCacheImpl &imagecache,
       m_envlayout(LayoutTexture), m_y_up(false), m_sample_border(false),
       m_is_udim(false),
       m_tilesread(0), m_bytesread(0),
-      m_redundant_tiles(0), m_redundant_bytesread(0),
+      m_redundant_tiles(0), m_redundant_bytesread(0), m_tilehits(0),
       m_timesopened(0), m_iotime(0),
       m_mipused(false), m_validspec(false), m_errors_issued(0),
+      m_generation(imagecache.generation()),
       m_imagecache(imagecache), m_duplicate(NULL),
       m_total_imagesize(0),
       m_total_imagesize_ondisk(0),
       m_inputcreator(creator),
       m_configspec(config ? new ImageSpec(*config) : NULL)
 {
+    m_in_lru = false;
+    m_subimages_initialized = 0;
+    m_subimage_index_complete = false;
+    m_concurrent_tiles = false;
+    m_concurrent_reads = 0;
     m_filename_original = m_filename;
     m_filename = imagecache.resolve_filename (m_filename_original.string());
     // N.B. the file is not opened, the ImageInput is NULL.  This is
@@ -314,6 +411,10 @@ ImageCacheFile::ImageCacheFile (ImageCacheImpl &imagecache,
             m_filename.find("<u>") != m_filename.npos ||
             m_filename.find("<v>") != m_filename.npos)) {
         m_is_udim = true;
+        const int n = UdimDirectU * UdimDirectV;
+        m_udim_direct.reset (new std::atomic<ImageCacheFile*> [n]);
+        for (int i = 0;  i < n;  ++i)
+            m_udim_direct[i].store (NULL, std::memory_order_relaxed);
     }
 }
 
@@ -394,6 +495,40 @@ ImageCacheFile::SubimageInfo::init (const ImageSpec &spec, bool forcefloat)
         if (average_color.size() == size_t(spec.nchannels))
             has_average_color = true;
     }
+
+    // See if there are per-tile stats (from maketx --tilestats), either
+    // as metadata or as a hint in the ImageDescription.
+    string_view tilestats = spec.get_string_attribute ("oiio:TileStats");
+    if (from_maketx && tilestats.empty()) {
+        string_view desc = spec.get_string_attribute ("ImageDescription");
+        size_t found = desc.find ("oiio:TileStats=");
+        if (found != string_view::npos) {
+            tilestats = desc.substr (found + 15);
+            tilestats = tilestats.substr (0, tilestats.find (' '));
+        }
+    }
+    if (from_maketx && tilestats.size()) {
+        int grid[5];
+        bool ok = true;
+        for (int i = 0;  i < 5 && ok;  ++i)
+            ok = Strutil::parse_int (tilestats, grid[i]) &&
+                 Strutil::parse_char (tilestats, ',');
+        size_t n = ok ? 3 * size_t(grid[2]) * grid[3] * grid[4] : 0;
+        ok &= (grid[4] == spec.nchannels && n > 0);
+        if (ok) {
+            tile_stats.reserve (n);
+            float val;
+            while (tile_stats.size() < n && Strutil::parse_float (tilestats, val)) {
+                tile_stats.push_back (val);
+                if (! Strutil::parse_char (tilestats, ','))
+                    break;
+            }
+        }
+        if (ok && tile_stats.size() == n)
+            std::copy (grid, grid+4, tile_stats_grid);
+        else
+            tile_stats.clear ();
+    }
 }
 
 
@@ -410,6 +545,9 @@ ImageCacheFile::open (ImageCachePerThreadInfo *thread_info)
     if (m_broken)        // Already failed an open -- it's broken
         return false;
 
+    OIIO_TRACE_ZONE ("ImageCache::open", m_filename.c_str());
+    LatencyTimer latency (thread_info ? &thread_info->m_stats.file_open_latency
+                                      : NULL);
     if (m_inputcreator)
         m_input.reset (m_inputcreator());
     else
@@ -452,8 +590,10 @@ ImageCacheFile::open (ImageCachePerThreadInfo *thread_info)
         return false;
     }
     m_fileformat = ustring (m_input->format_name());
-    ++m_timesopened;
-    m_imagecache.incr_open_files ();
+    m_concurrent_tiles = m_input->supports ("concurrent_tiles");
+    m_imagecache.incr_open_files (m_timesopened++ > 0);
+    if (m_imagecache.open_file_lru())
+        m_imagecache.lru_touch (this);
     use ();
 
     // If we are simply re-opening a closed file, and the spec is still
@@ -462,9 +602,15 @@ ImageCacheFile::open (ImageCachePerThreadInfo *thread_info)
         return true;
 
     // From here on, we know that we've opened this file for the very
-    // first time.  So read all the subimages, fill out all the fields
-    // of the ImageCacheFile.
+    // first time.  So read the subimages and fill out all the fields of
+    // the ImageCacheFile.  If the reader can say how many subimages there
+    // are without visiting them (multi-part OpenEXR can), just read the
+    // first now, and leave each of the others to init_subimage() the
+    // first time it's used, so that opening a file with dozens of parts
+    // doesn't cost a header parse and MIP walk for every one of them.
     m_subimages.clear ();
+    m_subimages_initialized = 0;
+    m_subimage_index_complete = false;
     int nsubimages = 0;
 
     // Since each subimage can potentially have its own mipmap levels,
@@ -472,116 +618,22 @@ ImageCacheFile::open (ImageCachePerThreadInfo *thread_info)
     imagesize_t old_total_imagesize = m_total_imagesize;
     imagesize_t old_total_imagesize_ondisk = m_total_imagesize_ondisk;
     m_total_imagesize = 0;
+    int ncounted = m_input->supports ("subimage_count");
+    if (ncounted > 1)
+        m_subimages.resize (ncounted);
     do {
-        m_subimages.resize (nsubimages+1);
-        SubimageInfo &si (subimageinfo(nsubimages));
-        int nmip = 0;
-        do {
-            tempspec = nativespec;
-            if (nmip == 0) {
-                // Things to do on MIP level 0, i.e. once per subimage
-                si.init (tempspec, imagecache().forcefloat());
-            }
-            if (tempspec.tile_width == 0 || tempspec.tile_height == 0) {
-                si.untiled = true;
-                int autotile = imagecache().autotile();
-                if (autotile) {
-                    // Automatically make it appear as if it's tiled
-                    if (imagecache().autoscanline()) {
-                        tempspec.tile_width = tempspec.width;
-                    } else {
-                        tempspec.tile_width = std::min (tempspec.width, autotile);
-                    }
-                    tempspec.tile_height = std::min (tempspec.height, autotile);
-                    tempspec.tile_depth = std::min (std::max(tempspec.depth,1), autotile);
-                } else {
-                    // Don't auto-tile -- which really means, make it look like
-                    // a single tile that's as big as the whole image.
-                    // We round to a power of 2 because the texture system
-                    // currently requires power of 2 tile sizes.
-                    tempspec.tile_width = tempspec.width;
-                    tempspec.tile_height = tempspec.height;
-                    tempspec.tile_depth = tempspec.depth;
-                }
-            }
-//            thread_info->m_stats.files_totalsize += tempspec.image_bytes();
-            m_total_imagesize += tempspec.image_bytes();
-            // All MIP levels need the same number of channels
-            if (nmip > 0 && tempspec.nchannels != spec(nsubimages,0).nchannels) {
-                // No idea what to do with a subimage that doesn't have the
-                // same number of channels as the others, so just skip it.
-                close ();
-                m_broken = true;
-                invalidate_spec ();
-                return false;
-            }
-            // ImageCache can't store differing formats per channel
-            tempspec.channelformats.clear();
-            LevelInfo levelinfo (tempspec, nativespec);
-            si.levels.push_back (levelinfo);
-            ++nmip;
-        } while (m_input->seek_subimage (nsubimages, nmip, nativespec));
-
-        // Special work for non-MIPmapped images -- but only if "automip"
-        // is on, it's a non-mipmapped image, and it doesn't have a
-        // "textureformat" attribute (because that would indicate somebody
-        // constructed it as texture and specifically wants it un-mipmapped).
-        // But not volume textures -- don't auto MIP them for now.
-        if (nmip == 1 && !si.volume && 
-            (tempspec.width > 1 || tempspec.height > 1 || tempspec.depth > 1))
-            si.unmipped = true;
-        if (si.unmipped && imagecache().automip() &&
-            ! tempspec.find_attribute ("textureformat", TypeDesc::TypeString)) {
-            int w = tempspec.full_width;
-            int h = tempspec.full_height;
-            int d = tempspec.full_depth;
-            while (w > 1 || h > 1 || d > 1) {
-                w = std::max (1, w/2);
-                h = std::max (1, h/2);
-                d = std::max (1, d/2);
-                ImageSpec s = tempspec;
-                s.width = w;
-                s.height = h;
-                s.depth = d;
-                s.full_width = w;
-                s.full_height = h;
-                s.full_depth = d;
-                if (imagecache().autotile()) {
-                    if (imagecache().autoscanline()) {
-                       s.tile_width = w;
-                    } else {
-                       s.tile_width = std::min (imagecache().autotile(), w);
-                    }
-                    s.tile_height = std::min (imagecache().autotile(), h);
-                    s.tile_depth = std::min (imagecache().autotile(), d);
-                } else {
-                    s.tile_width = w;
-                    s.tile_height = h;
-                    s.tile_depth = d;
-                }
-                ++nmip;
-                LevelInfo levelinfo (s, s);
-                si.levels.push_back (levelinfo);
-            }
-        }
-        if (si.untiled && ! imagecache().accept_untiled()) {
-            imagecache().error ("%s was untiled, rejecting", m_filename);
-            m_broken = true;
-            invalidate_spec ();
-            m_input.reset ();
-            return false;
-        }
-        if (si.unmipped && ! imagecache().accept_unmipped()) {
-            imagecache().error ("%s was not MIP-mapped, rejecting", m_filename);
+        if (ncounted <= 1)
+            m_subimages.resize (nsubimages+1);
+        if (! read_subimage_levels (nsubimages, nativespec)) {
+            close ();
             m_broken = true;
             invalidate_spec ();
-            m_input.reset ();
             return false;
         }
-
         ++nsubimages;
-    } while (m_input->seek_subimage (nsubimages, 0, nativespec));
-    ASSERT ((size_t)nsubimages == m_subimages.size());
+    } while (ncounted <= 1 &&
+             m_input->seek_subimage (nsubimages, 0, nativespec));
+    ASSERT (ncounted > 1 || (size_t)nsubimages == m_subimages.size());
 
     if (Filesystem::exists(m_filename.string()))
         m_total_imagesize_ondisk = imagesize_t(Filesystem::file_size (m_filename));
@@ -594,15 +646,146 @@ ImageCacheFile::open (ImageCachePerThreadInfo *thread_info)
     thread_info->m_stats.files_totalsize_ondisk += m_total_imagesize_ondisk;
 
     init_from_spec ();  // Fill in the rest of the fields
+    // Only now, with every field final, let lock-free readers see the
+    // subimages we read.
+    for (int s = 0;  s < nsubimages;  ++s)
+        m_subimages[s].initialized.store (true, std::memory_order_release);
+    return true;
+}
+
+
+
+bool
+ImageCacheFile::read_subimage_levels (int subimage, ImageSpec &nativespec)
+{
+    SubimageInfo &si (m_subimages[subimage]);
+    ImageSpec tempspec;
+    int nmip = 0;
+    do {
+        tempspec = nativespec;
+        if (nmip == 0) {
+            // Things to do on MIP level 0, i.e. once per subimage
+            si.init (tempspec, imagecache().forcefloat());
+        }
+        if (tempspec.tile_width == 0 || tempspec.tile_height == 0) {
+            si.untiled = true;
+            int autotile = imagecache().autotile();
+            if (autotile) {
+                // Automatically make it appear as if it's tiled
+                if (imagecache().autoscanline()) {
+                    tempspec.tile_width = tempspec.width;
+                } else {
+                    tempspec.tile_width = std::min (tempspec.width, autotile);
+                }
+                tempspec.tile_height = std::min (tempspec.height, autotile);
+                tempspec.tile_depth = std::min (std::max(tempspec.depth,1), autotile);
+            } else {
+                // Don't auto-tile -- which really means, make it look like
+                // a single tile that's as big as the whole image.
+                // We round to a power of 2 because the texture system
+                // currently requires power of 2 tile sizes.
+                tempspec.tile_width = tempspec.width;
+                tempspec.tile_height = tempspec.height;
+                tempspec.tile_depth = tempspec.depth;
+            }
+        }
+//        thread_info->m_stats.files_totalsize += tempspec.image_bytes();
+        m_total_imagesize += tempspec.image_bytes();
+        // All MIP levels need the same number of channels
+        if (nmip > 0 && tempspec.nchannels != si.spec(0).nchannels) {
+            // No idea what to do with a subimage that doesn't have the
+            // same number of channels as the others, so just skip it.
+            return false;
+        }
+        // ImageCache can't store differing formats per channel
+        tempspec.channelformats.clear();
+        LevelInfo levelinfo (tempspec, nativespec);
+        si.levels.push_back (levelinfo);
+        ++nmip;
+    } while (m_input->seek_subimage (subimage, nmip, nativespec));
+
+    // Special work for non-MIPmapped images -- but only if "automip"
+    // is on, it's a non-mipmapped image, and it doesn't have a
+    // "textureformat" attribute (because that would indicate somebody
+    // constructed it as texture and specifically wants it un-mipmapped).
+    // But not volume textures -- don't auto MIP them for now.
+    if (nmip == 1 && !si.volume && 
+        (tempspec.width > 1 || tempspec.height > 1 || tempspec.depth > 1))
+        si.unmipped = true;
+    if (si.unmipped && imagecache().automip() &&
+        ! tempspec.find_attribute ("textureformat", TypeDesc::TypeString)) {
+        int w = tempspec.full_width;
+        int h = tempspec.full_height;
+        int d = tempspec.full_depth;
+        while (w > 1 || h > 1 || d > 1) {
+            w = std::max (1, w/2);
+            h = std::max (1, h/2);
+            d = std::max (1, d/2);
+            ImageSpec s = tempspec;
+            s.width = w;
+            s.height = h;
+            s.depth = d;
+            s.full_width = w;
+            s.full_height = h;
+            s.full_depth = d;
+            if (imagecache().autotile()) {
+                if (imagecache().autoscanline()) {
+                   s.tile_width = w;
+                } else {
+                   s.tile_width = std::min (imagecache().autotile(), w);
+                }
+                s.tile_height = std::min (imagecache().autotile(), h);
+                s.tile_depth = std::min (imagecache().autotile(), d);
+            } else {
+                s.tile_width = w;
+                s.tile_height = h;
+                s.tile_depth = d;
+            }
+            ++nmip;
+            LevelInfo levelinfo (s, s);
+            si.levels.push_back (levelinfo);
+        }
+    }
+    if (si.untiled && ! imagecache().accept_untiled()) {
+        imagecache().error ("%s was untiled, rejecting", m_filename);
+        return false;
+    }
+    if (si.unmipped && ! imagecache().accept_unmipped()) {
+        imagecache().error ("%s was not MIP-mapped, rejecting", m_filename);
+        return false;
+    }
+
+    ++m_subimages_initialized;
     return true;
 }
 
 
 
+// Clamp the full (display) window of each level to the data window.
+static void
+clamp_full_windows (ImageCacheFile::SubimageInfo &si)
+{
+    for (int m = 0, nmip = si.miplevels();  m < nmip;  ++m) {
+        ImageSpec &spec (si.spec(m));
+        if (spec.full_width > spec.width)
+            spec.full_width = spec.width;
+        if (spec.full_height > spec.height)
+            spec.full_height = spec.height;
+        if (spec.full_depth > spec.depth)
+            spec.full_depth = spec.depth;
+    }
+}
+
+
+
 void
 ImageCacheFile::init_from_spec ()
 {
-    const ImageSpec &spec (this->spec(0,0));
+    // Called by open() before it publishes the subimages it read (the
+    // first m_subimages_initialized of them), so go straight to
+    // m_subimages rather than through the accessors that would try to
+    // read them again.
+    const ImageSpec &spec (m_subimages[0].spec(0));
     const ImageIOParameter *p;
 
     // FIXME -- this should really be per-subimage
@@ -618,19 +801,11 @@ ImageCacheFile::init_from_spec ()
                 break;
             }
         // For textures marked as such, doctor the full_width/full_height to
-        // not be non-sensical.
+        // not be non-sensical.  (Subimages not read yet get this done by
+        // init_subimage.)
         if (m_texformat == TexFormatTexture) {
-            for (int s = 0;  s < subimages();  ++s) {
-                for (int m = 0;  m < miplevels(s);  ++m) {
-                    ImageSpec &spec (this->spec(s,m));
-                    if (spec.full_width > spec.width)
-                        spec.full_width = spec.width;
-                    if (spec.full_height > spec.height)
-                        spec.full_height = spec.height;
-                    if (spec.full_depth > spec.depth)
-                        spec.full_depth = spec.depth;
-                }
-            }
+            for (int s = 0;  s < m_subimages_initialized;  ++s)
+                clamp_full_windows (m_subimages[s]);
         }
     }
 
@@ -694,27 +869,130 @@ ImageCacheFile::init_from_spec ()
 
     m_mod_time = Filesystem::last_write_time (m_filename.string());
 
-    // Set all mipmap level read counts to zero
+    // Set all mipmap level read counts to zero.  Leave room for as many
+    // levels as any image could have, so that init_subimage growing it
+    // never moves it out from under a reader.
     int maxmip = 1;
-    for (int s = 0, nsubimages = subimages();  s < nsubimages;  ++s)
-        maxmip = std::max (maxmip, miplevels(s));
+    for (int s = 0;  s < m_subimages_initialized;  ++s)
+        maxmip = std::max (maxmip, m_subimages[s].miplevels());
     m_mipreadcount.clear ();
+    m_mipreadcount.reserve (std::max (maxmip, 32));
     m_mipreadcount.resize(maxmip, 0);
 
+    m_subimage_index.clear ();
+    if (m_subimages_initialized == subimages())
+        index_subimages ();
+
     DASSERT (! m_broken);
     m_validspec = true;
 }
 
 
 
+void
+ImageCacheFile::index_subimages ()
+{
+    // Index the named subimages so that lookups by name don't have to
+    // scan the whole list. If names repeat, the first one wins.
+    m_subimage_index.clear ();
+    for (int s = 0, nsubimages = subimages();  s < nsubimages;  ++s) {
+        if (m_subimages[s].subimagename)
+            m_subimage_index.insert (std::make_pair (m_subimages[s].subimagename, s));
+    }
+    m_subimage_index_complete.store (true, std::memory_order_release);
+}
+
+
+
+void
+ImageCacheFile::init_subimage (int subimage)
+{
+    ImageCachePerThreadInfo *thread_info = m_imagecache.get_perthread_info ();
+    recursive_lock_guard guard (m_input_mutex);
+    if (m_subimages[subimage].initialized.load (std::memory_order_acquire))
+        return;   // Somebody else got to it while we waited for the lock
+
+    if (! m_input && !m_broken) {
+        // Re-opening a closed file -- same dance as read_tile to make
+        // sure there are enough file handles without deadlocking.
+        m_input_mutex.unlock ();
+        imagecache().check_max_files (thread_info);
+        m_input_mutex.lock ();
+        if (m_subimages[subimage].initialized.load (std::memory_order_acquire))
+            return;
+    }
+
+    SubimageInfo &si (m_subimages[subimage]);
+    imagesize_t old_total_imagesize = m_total_imagesize;
+    ImageSpec nativespec;
+    bool ok = open (thread_info) &&
+              m_input->seek_subimage (subimage, 0, nativespec);
+    if (! ok) {
+        if (m_input)
+            imagecache().error ("%s", m_input->geterror());
+    } else {
+        si.levels.clear ();
+        ok = read_subimage_levels (subimage, nativespec);
+    }
+    if (! ok) {
+        // Leave something that won't trip up a caller that already got
+        // past the broken() check (a copy of subimage 0's levels), but
+        // fail all lookups from now on.
+        m_broken = true;
+        const SubimageInfo &si0 (m_subimages[0]);
+        si.init (si0.nativespec(0), imagecache().forcefloat());
+        si.untiled = si0.untiled;
+        si.unmipped = si0.unmipped;
+        si.levels.clear ();
+        for (const LevelInfo &level : si0.levels)
+            si.levels.push_back (level);
+        ++m_subimages_initialized;
+    } else {
+        const ImageSpec &spec0 (m_subimages[0].spec(0));
+        if (m_texformat == TexFormatTexture &&
+            spec0.find_attribute ("textureformat", TypeDesc::STRING))
+            clamp_full_windows (si);
+        if (m_mipreadcount.size() < si.levels.size())
+            m_mipreadcount.resize (si.levels.size(), 0);
+    }
+    // Last, after every change to si, so lock-free readers that see the
+    // flag also see the finished levels.
+    si.initialized.store (true, std::memory_order_release);
+    thread_info->m_stats.files_totalsize += m_total_imagesize - old_total_imagesize;
+    if (m_subimages_initialized == subimages())
+        index_subimages ();
+}
+
+
+
+int
+ImageCacheFile::find_subimage (ustring subimagename)
+{
+    recursive_lock_guard guard (m_input_mutex);
+    if (m_subimage_index_complete) {
+        SubimageIndexMap::const_iterator found = m_subimage_index.find (subimagename);
+        return found == m_subimage_index.end() ? -1 : found->second;
+    }
+    for (int s = 0, nsubimages = subimages();  s < nsubimages;  ++s)
+        if (subimageinfo(s).subimagename == subimagename)
+            return s;
+    return -1;
+}
+
+
+
 bool
 ImageCacheFile::read_tile (ImageCachePerThreadInfo *thread_info,
                            int subimage, int miplevel, int x, int y, int z,
                            int chbegin, int chend,
                            TypeDesc format, void *data)
 {
+    OIIO_TRACE_ZONE ("ImageCache::read_tile", m_filename.c_str());
     ASSERT (chend > chbegin);
+    LatencyTimer latency (&thread_info->m_stats.tile_read_latency);
+    Timer locktimer;
     recursive_lock_guard guard (m_input_mutex);
+    thread_info->m_stats.file_locking_time += locktimer();
 
     if (! m_input && !m_broken) {
         // The file is already in the file cache, but the handle is
@@ -732,16 +1010,18 @@ ImageCacheFile::read_tile (ImageCachePerThreadInfo *thread_info,
     bool ok = open (thread_info);
     if (! ok)
         return false;
+    if (imagecache().open_file_lru())
+        imagecache().lru_touch (this);
 
     // Mark if we ever use a mip level that's not the first
     if (miplevel > 0)
         m_mipused = true;
 
+    SubimageInfo &subinfo (subimageinfo(subimage));
+
     // count how many times this mipmap level was read
     m_mipreadcount[miplevel]++;
 
-    SubimageInfo &subinfo (subimageinfo(subimage));
-
     // Special case for un-MIP-mapped
     if (subinfo.unmipped && miplevel != 0) {
         // For a non-base mip level of an unmipped file, release the
@@ -769,6 +1049,48 @@ ImageCacheFile::read_tile (ImageCachePerThreadInfo *thread_info,
     if (m_input->current_subimage() != subimage ||
         m_input->current_miplevel() != miplevel)
         ok = m_input->seek_subimage (subimage, miplevel, tmp);
+
+    // If the plugin can read tiles of one file from many threads at
+    // once, let go of the lock for the read itself so that other threads
+    // needing tiles from this file can fetch and decode theirs alongside
+    // us.  The seek above makes sure the plugin has seen this level.  If
+    // it declines, fall back to the ordinary locked read below.
+    if (ok && m_concurrent_tiles) {
+        const ImageSpec &spec (this->spec(subimage, miplevel));
+        ++m_concurrent_reads;
+        unlock_input_mutex ();
+        bool cok = m_input->read_tiles_concurrent (subimage, miplevel,
+                                    x, x+spec.tile_width, y, y+spec.tile_height,
+                                    z, z+std::max(1,spec.tile_depth),
+                                    chbegin, chend, format, data);
+        --m_concurrent_reads;
+        lock_input_mutex ();
+        if (cok) {
+            size_t b = spec.tile_bytes();
+            thread_info->m_stats.bytes_read += b;
+            m_bytesread += b;
+            ++m_tilesread;
+            return true;
+        }
+    }
+
+    // If the tiles to the right of this one are also not yet in the
+    // cache, read them along with it in one request.
+    if (ok && imagecache().max_tile_batch() > 1) {
+        const ImageSpec &spec (m_input->spec());
+        int ntiles = 1;
+        for (int xx = x + spec.tile_width;
+             ntiles < imagecache().max_tile_batch() && xx < spec.x+spec.width;
+             xx += spec.tile_width, ++ntiles) {
+            TileID id (*this, subimage, miplevel, xx, y, z, chbegin, chend);
+            if (imagecache().tile_in_cache (id, thread_info))
+                break;
+        }
+        if (ntiles > 1)
+            return read_tiled_batch (thread_info, subimage, miplevel, x, y, z,
+                                     chbegin, chend, ntiles, format, data);
+    }
+
     if (ok) {
         for (int tries = 0; tries <= imagecache().failure_retries(); ++tries) {
             const ImageSpec &spec (m_input->spec());
@@ -805,6 +1127,78 @@ ImageCacheFile::read_tile (ImageCachePerThreadInfo *thread_info,
 
 
 
+std::shared_ptr<const char>
+ImageCacheFile::constant_tile (int subimage, int miplevel, int x, int y, int z,
+                               int chbegin, int chend, size_t size)
+{
+    static ustring s_field3d ("field3d");
+    if (m_fileformat != s_field3d || miplevel != 0 ||
+            subimageinfo(subimage).untiled)
+        return std::shared_ptr<const char>();
+    TypeDesc cachetype = datatype (subimage);
+    int nc = chend - chbegin;
+    std::vector<char> pixel (nc * cachetype.size());
+    {
+        recursive_lock_guard guard (m_input_mutex);
+        // Don't reopen a closed file just to ask -- the ordinary read
+        // will do that, and later tiles will get the benefit.
+        if (! m_input)
+            return std::shared_ptr<const char>();
+        ImageSpec tmp;
+        if ((m_input->current_subimage() != subimage ||
+             m_input->current_miplevel() != miplevel) &&
+            ! m_input->seek_subimage (subimage, miplevel, tmp))
+            return std::shared_ptr<const char>();
+        const ImageSpec &nativespec (m_input->spec());
+        std::vector<char> value (nativespec.pixel_bytes (true));
+        f3dpvt::Field3DInput_Interface *f3di =
+            (f3dpvt::Field3DInput_Interface *) m_input.get();
+        if (! f3di->constant_tile (x, y, z, &value[0]))
+            return std::shared_ptr<const char>();
+        convert_types (nativespec.format,
+                       &value[chbegin * nativespec.format.size()],
+                       cachetype, &pixel[0], nc);
+    }
+
+    return shared_constant_tile (subimage, miplevel, chbegin, chend,
+                                 &pixel[0], size);
+}
+
+
+
+std::shared_ptr<const char>
+ImageCacheFile::shared_constant_tile (int subimage, int miplevel,
+                                      int chbegin, int chend,
+                                      const char *pixel, size_t size)
+{
+    const ImageSpec &spec (this->spec (subimage, miplevel));
+    size_t pixelsize = (chend - chbegin) * datatype(subimage).size();
+    std::string key = Strutil::format ("%d %d %d %d:", subimage, miplevel,
+                                       chbegin, chend);
+    key.append (pixel, pixelsize);
+    spin_lock lock (m_constant_tiles_mutex);
+    std::weak_ptr<const char> &slot (m_constant_tiles[key]);
+    std::shared_ptr<const char> shared = slot.lock ();
+    if (! shared) {
+        char *buf = new char [size];
+        size_t npixels = spec.tile_pixels();
+        for (size_t i = 0; i < npixels; ++i)
+            memcpy (buf + i * pixelsize, pixel, pixelsize);
+        memset (buf + npixels * pixelsize, 0, size - npixels * pixelsize);
+        // The shared buffer is charged to the cache once, not per tile
+        ImageCacheImpl *ic = &imagecache();
+        ic->incr_mem (size);
+        shared.reset (buf, [ic, size](char *p){
+            ic->decr_mem (size);
+            delete [] p;
+        });
+        slot = shared;
+    }
+    return shared;
+}
+
+
+
 bool
 ImageCacheFile::read_unmipped (ImageCachePerThreadInfo *thread_info,
                                int subimage, int miplevel,
@@ -899,6 +1293,77 @@ ImageCacheFile::read_unmipped (ImageCachePerThreadInfo *thread_info,
 
 
 
+// Helper routine for read_tile that reads a whole row of ntiles tiles,
+// starting with the one at (x,y,z), in a single read_tiles call (which
+// readers can turn into one read_native_tiles).  The first tile is
+// returned in data, and the rest are added to the cache.
+bool
+ImageCacheFile::read_tiled_batch (ImageCachePerThreadInfo *thread_info,
+                                  int subimage, int miplevel,
+                                  int x, int y, int z, int chbegin, int chend,
+                                  int ntiles, TypeDesc format, void *data)
+{
+    // N.B. No need to lock the input mutex, since this is only called
+    // from read_tile, which already holds the lock.
+    const ImageSpec &spec (m_input->spec());
+    int tw = spec.tile_width, th = spec.tile_height;
+    int td = std::max (1, spec.tile_depth);
+    int nchans = chend - chbegin;
+    stride_t pixelsize = stride_t (nchans * format.size());
+    stride_t rowbytes = pixelsize * tw * ntiles;
+    // Full tiles at the right edge of the image extend past it, so the
+    // buffer is always a whole number of tiles wide.
+    std::unique_ptr<char[]> buf (new char [rowbytes * th * td]);
+    bool ok = false;
+    for (int tries = 0; tries <= imagecache().failure_retries(); ++tries) {
+        ok = m_input->read_tiles (x, x+tw*ntiles, y, y+th, z, z+td,
+                                  chbegin, chend, format, &buf[0],
+                                  pixelsize, rowbytes, rowbytes*th);
+        if (ok) {
+            if (tries)   // succeeded, but only after a failure!
+                ++thread_info->m_stats.tile_retry_success;
+            (void) m_input->geterror ();  // Eat the errors
+            break;
+        }
+        if (tries < imagecache().failure_retries())
+            Sysutil::usleep (1000 * 100);  // 100 ms
+    }
+    if (! ok) {
+        std::string err = m_input->geterror();
+        if (!err.empty() && errors_should_issue())
+            imagecache().error ("%s", err);
+        return false;
+    }
+    size_t b = ntiles * this->spec(subimage,miplevel).tile_bytes();
+    thread_info->m_stats.bytes_read += b;
+    m_bytesread += b;
+    m_tilesread += ntiles;
+
+    // The tile we were asked for goes to the caller
+    convert_image (nchans, tw, th, td, &buf[0], format,
+                   pixelsize, rowbytes, rowbytes*th, data, format,
+                   AutoStride, AutoStride, AutoStride);
+
+    // As in read_untiled, we MUST release the input lock before adding
+    // tiles to the cache, in case another thread is already reading one
+    // of them and needs the lock to finish.
+    unlock_input_mutex ();
+    for (int i = 1;  i < ntiles;  ++i) {
+        TileID id (*this, subimage, miplevel, x+i*tw, y, z, chbegin, chend);
+        if (! imagecache().tile_in_cache (id, thread_info)) {
+            ImageCacheTileRef tile;
+            tile = new ImageCacheTile (id, &buf[i*tw*pixelsize], format,
+                                       pixelsize, rowbytes, rowbytes*th);
+            imagecache().add_tile_to_cache (tile, thread_info);
+        }
+    }
+    // read_tile handed us the mutex locked and expects it back that way.
+    lock_input_mutex ();
+    return true;
+}
+
+
+
 // Helper routine for read_tile that handles the rare (but tricky) case
 // of reading a "tile" from a file that's scanline-oriented.
 bool
@@ -1030,8 +1495,16 @@ ImageCacheFile::close ()
 {
     // N.B. close() does not need to lock the m_input_mutex, because close()
     // itself is only called by routines that hold the lock.
+    if (m_in_lru)
+        m_imagecache.lru_remove (this);
+    // Reads that were started without the lock must finish first
+    while (m_concurrent_reads > 0)
+        yield ();
     if (opened()) {
-        m_input->close ();
+        if (m_imagecache.open_file_lru())
+            m_imagecache.close_async (m_input);
+        else
+            m_input->close ();
         m_input.reset ();
         m_imagecache.decr_open_files ();
     }
@@ -1077,7 +1550,7 @@ ImageCacheFile::get_average_color (float *avg, int subimage,
 {
     if (subimage < 0 || subimage > subimages())
         return false;   // invalid subimage
-    SubimageInfo &si (m_subimages[subimage]);
+    SubimageInfo &si (subimageinfo(subimage));
 
     if (! si.has_average_color) {
         // try to figure it out by grabbing the single pixel at the 1x1
@@ -1139,18 +1612,25 @@ ImageCacheImpl::find_file (ustring filename,
 #if IMAGECACHE_TIME_STATS
         Timer timer;
 #endif
-        size_t bin = m_files.lock_bin (filename);
-        FilenameMap::iterator found = m_files.find (filename, false);
-        if (found) {
-            tf = found->second.get();
+        // Entries are never removed from the file cache, so if it's there
+        // already, a lookup under the shared bin lock is all we need.
+        ImageCacheFileRef ref;
+        if (m_files.retrieve (filename, ref)) {
+            tf = ref.get();
         } else {
-            // No such entry in the file cache.  Add it, but don't open yet.
-            tf = new ImageCacheFile (*this, thread_info, filename, creator,
-                                     config);
-            m_files.insert (filename, tf, false);
-            newfile = true;
+            size_t bin = m_files.lock_bin (filename);
+            FilenameMap::iterator found = m_files.find (filename, false);
+            if (found) {
+                tf = found->second.get();
+            } else {
+                // No such entry in the file cache.  Add it, but don't open yet.
+                tf = new ImageCacheFile (*this, thread_info, filename, creator,
+                                         config);
+                m_files.insert (filename, tf, false);
+                newfile = true;
+            }
+            m_files.unlock_bin (bin);
         }
-        m_files.unlock_bin (bin);
 
         if (newfile) {
             check_max_files (thread_info);
@@ -1183,6 +1663,20 @@ ImageCacheImpl::verify_file (ImageCacheFile *tf,
         return tf;
     }
 
+    // invalidate_all(force) leaves it to each file to invalidate itself
+    // when next used.  Like invalidate(), advance the file's generation
+    // afterwards, so tiles read from the old file in the meantime are
+    // stale.
+    if (tf->generation() < m_all_generation) {
+        recursive_lock_guard guard (tf->m_input_mutex);
+        if (tf->generation() < m_all_generation) {
+            if (disk_tiles_enabled() && ! tf->broken())
+                invalidate_disk_tiles (*tf);
+            tf->invalidate ();
+            tf->generation (++m_generation);
+        }
+    }
+
     // Open the file if it's never been opened before.
     // No need to have the file cache locked for this, though we lock
     // the tf->m_input_mutex if we need to open it.
@@ -1220,8 +1714,12 @@ ImageCacheImpl::verify_file (ImageCacheFile *tf,
                               tf->m_envlayout == dup->m_envlayout &&
                               tf->m_y_up == dup->m_y_up &&
                               tf->m_sample_border == dup->m_sample_border);
+                    // Only compare the subimages both have read so far;
+                    // don't read them all just to look for a duplicate.
                     for (int s = 0, e = tf->subimages(); match && s < e; ++s) {
-                        match &= (tf->datatype(s) == dup->datatype(s));
+                        if (tf->subimage_initialized(s) &&
+                            dup->subimage_initialized(s))
+                            match &= (tf->datatype(s) == dup->datatype(s));
                     }
                     if (match) {
                         tf->duplicate (dup);
@@ -1277,6 +1775,74 @@ ImageCacheImpl::clear_fingerprints ()
 
 
 
+void
+ImageCacheImpl::lru_touch (ImageCacheFile *file)
+{
+    spin_lock lock (m_open_lru_mutex);
+    if (file->m_in_lru) {
+        m_open_lru.splice (m_open_lru.begin(), m_open_lru, file->m_lru_pos);
+    } else {
+        file->m_lru_pos = m_open_lru.insert (m_open_lru.begin(), file);
+        file->m_in_lru = true;
+    }
+}
+
+
+
+void
+ImageCacheImpl::lru_remove (ImageCacheFile *file)
+{
+    spin_lock lock (m_open_lru_mutex);
+    if (file->m_in_lru) {
+        m_open_lru.erase (file->m_lru_pos);
+        file->m_in_lru = false;
+    }
+}
+
+
+
+void
+ImageCacheImpl::close_async (std::shared_ptr<ImageInput> &input)
+{
+    spin_lock lock (m_close_mutex);
+    if (! m_close_pool)
+        m_close_pool.reset (new thread_pool (1));
+    std::shared_ptr<ImageInput> in (input);
+    m_close_pool->push ([in](int){ in->close (); });
+}
+
+
+
+void
+ImageCacheImpl::check_max_files_lru (ImageCachePerThreadInfo *thread_info)
+{
+    // Close least recently used files until we're under the limit.  A
+    // file whose mutex is held is busy (maybe even reading on our
+    // behalf); it goes to the front of the list rather than making us
+    // wait.  Give up after looking at every open file once.
+    size_t tries = 0;
+    while (m_stat_open_files_current >= m_max_open_files) {
+        ImageCacheFile *file = NULL;
+        {
+            spin_lock lock (m_open_lru_mutex);
+            if (m_open_lru.empty() || tries++ >= m_open_lru.size())
+                break;
+            file = m_open_lru.back();
+        }
+        if (file->m_input_mutex.try_lock()) {
+            file->close ();   // also takes it out of the list
+            file->m_input_mutex.unlock ();
+        } else {
+            spin_lock lock (m_open_lru_mutex);
+            if (file->m_in_lru && file == m_open_lru.back())
+                m_open_lru.splice (m_open_lru.begin(), m_open_lru,
+                                   file->m_lru_pos);
+        }
+    }
+}
+
+
+
 void
 ImageCacheImpl::check_max_files (ImageCachePerThreadInfo *thread_info)
 {
@@ -1291,6 +1857,11 @@ ImageCacheImpl::check_max_files (ImageCachePerThreadInfo *thread_info)
     if (m_stat_open_files_current < m_max_open_files)
         return;
 
+    if (m_open_file_lru) {
+        check_max_files_lru (thread_info);
+        return;
+    }
+
     // Try to grab the file_sweep_mutex lock. If somebody else holds it,
     // just return -- leave the handle limit enforcement to whomever is
     // already in this function, no need for two threads to do it at
@@ -1372,11 +1943,14 @@ ImageCacheImpl::set_min_cache_size (long long newsize)
 ImageCacheTile::ImageCacheTile (const TileID &id,
                                 ImageCachePerThreadInfo *thread_info,
                                 bool read_now)
-    : m_id (id), m_valid(true) // , m_used(true)
+    : m_id (id), m_data(NULL), m_mapped(NULL), m_mapped_size(0),
+      m_valid(true) // , m_used(true)
 {
     m_used = true;
+    m_pins = 0;
     m_pixels_ready = false;
     m_pixels_size = 0;
+    m_generation = id.file().imagecache().generation();
     if (read_now) {
         read (thread_info);
     }
@@ -1388,10 +1962,12 @@ ImageCacheTile::ImageCacheTile (const TileID &id,
 ImageCacheTile::ImageCacheTile (const TileID &id, const void *pels,
                     TypeDesc format,
                     stride_t xstride, stride_t ystride, stride_t zstride)
-    : m_id (id) // , m_used(true)
+    : m_id (id), m_mapped(NULL), m_mapped_size(0) // , m_used(true)
 {
     m_used = true;
+    m_pins = 0;
     m_pixels_size = 0;
+    m_generation = id.file().imagecache().generation();
     ImageCacheFile &file (m_id.file ());
     const ImageSpec &spec (file.spec(id.subimage(), id.miplevel()));
     m_channelsize = file.datatype(id.subimage()).size();
@@ -1400,6 +1976,7 @@ ImageCacheTile::ImageCacheTile (const TileID &id, const void *pels,
     ASSERT_MSG (size > 0 && memsize() == 0, "size was %llu, memsize = %llu",
                 (unsigned long long)size, (unsigned long long)memsize());
     m_pixels.reset (new char [m_pixels_size = size]);
+    m_data = m_pixels.get();
     m_valid = convert_image (id.nchannels(), spec.tile_width, spec.tile_height,
                              spec.tile_depth, pels, format, xstride, ystride,
                              zstride, &m_pixels[0], file.datatype(id.subimage()),
@@ -1414,6 +1991,8 @@ ImageCacheTile::ImageCacheTile (const TileID &id, const void *pels,
 
 ImageCacheTile::~ImageCacheTile ()
 {
+    if (m_mapped)
+        m_id.file().imagecache().unmap_disk_tile (m_mapped, m_mapped_size);
     m_id.file().imagecache().decr_tiles (memsize ());
 }
 
@@ -1432,6 +2011,20 @@ ImageCacheTile::memsize_needed () const
 
 
 
+// Are all npixels*pixelsize bytes of data a repetition of its first
+// pixel?  That's the same as the buffer matching itself shifted by one
+// pixel, which memcmp checks with wide compares and gives up on at the
+// first difference -- usually within the first few pixels for tiles
+// that aren't constant.
+static inline bool
+pixels_constant (const char *data, size_t bytes, size_t pixelsize)
+{
+    return bytes <= pixelsize ||
+           memcmp (data, data + pixelsize, bytes - pixelsize) == 0;
+}
+
+
+
 void
 ImageCacheTile::read (ImageCachePerThreadInfo *thread_info)
 {
@@ -1440,16 +2033,67 @@ ImageCacheTile::read (ImageCachePerThreadInfo *thread_info)
     m_pixelsize = m_id.nchannels() * m_channelsize;
     size_t size = memsize_needed ();
     ASSERT (memsize() == 0 && size > OIIO_SIMD_MAX_SIZE_BYTES);
+    // Empty blocks of sparse volumes all point to one shared tile of
+    // their value, instead of each allocating and filling its own.
+    m_shared = file.constant_tile (m_id.subimage(), m_id.miplevel(),
+                                   m_id.x(), m_id.y(), m_id.z(),
+                                   m_id.chbegin(), m_id.chend(), size);
+    if (m_shared) {
+        m_data = m_shared.get();
+        m_valid = true;
+        m_pixels_ready = true;
+        return;
+    }
+    // If another process (or we, earlier) already decoded this tile into
+    // the shared tile_cache_dir, use that instead of reading the file --
+    // if asked, by pointing right into a mapping of it, without copying.
+    ImageCacheImpl &imagecache (file.imagecache());
+    if (imagecache.disk_tiles_enabled() && imagecache.mmap_tiles() &&
+        imagecache.map_disk_tile (m_id, size - OIIO_SIMD_MAX_SIZE_BYTES,
+                                  m_mapped, m_mapped_size, m_data,
+                                  thread_info)) {
+        m_valid = true;
+        m_pixels_ready = true;
+        return;
+    }
     m_pixels.reset (new char [m_pixels_size = size]);
+    m_data = m_pixels.get();
     // Clear the end pad values so there aren't NaNs sucked up by simd loads
     memset (m_pixels.get() + size - OIIO_SIMD_MAX_SIZE_BYTES,
             0, OIIO_SIMD_MAX_SIZE_BYTES);
-    m_valid = file.read_tile (thread_info, m_id.subimage(), m_id.miplevel(),
-                              m_id.x(), m_id.y(), m_id.z(),
-                              m_id.chbegin(), m_id.chend(),
-                              file.datatype(m_id.subimage()), &m_pixels[0]);
-    m_id.file().imagecache().incr_mem (size);
-    if (m_valid) {
+    bool fromdisk = imagecache.disk_tiles_enabled() &&
+        imagecache.read_disk_tile (m_id, &m_pixels[0],
+                                   size - OIIO_SIMD_MAX_SIZE_BYTES, thread_info);
+    if (fromdisk) {
+        m_valid = true;
+    } else {
+        m_valid = file.read_tile (thread_info, m_id.subimage(), m_id.miplevel(),
+                                  m_id.x(), m_id.y(), m_id.z(),
+                                  m_id.chbegin(), m_id.chend(),
+                                  file.datatype(m_id.subimage()), &m_pixels[0]);
+        if (m_valid && imagecache.disk_tiles_enabled())
+            imagecache.write_disk_tile (m_id, &m_pixels[0],
+                                        size - OIIO_SIMD_MAX_SIZE_BYTES,
+                                        thread_info);
+    }
+    // A tile that turns out to be all one value (masks, uniform maps,
+    // padding) gives back its pixels and shares the file's one buffer
+    // of that value instead.
+    if (m_valid &&
+        pixels_constant (&m_pixels[0], size - OIIO_SIMD_MAX_SIZE_BYTES,
+                         m_pixelsize)) {
+        m_shared = file.shared_constant_tile (m_id.subimage(), m_id.miplevel(),
+                                              m_id.chbegin(), m_id.chend(),
+                                              &m_pixels[0], size);
+        m_data = m_shared.get();
+        m_pixels.reset ();
+        m_pixels_size = 0;
+        ++thread_info->m_stats.tiles_constant;
+        thread_info->m_stats.tiles_constant_bytes += size;
+    } else {
+        imagecache.incr_mem (size);
+    }
+    if (m_valid && ! fromdisk) {
         // Figure out if 
         ImageCacheFile::LevelInfo &lev (file.levelinfo (m_id.subimage(), m_id.miplevel()));
         int whichtile = ((m_id.x() - lev.spec.x) / lev.spec.tile_width)
@@ -1504,7 +2148,7 @@ ImageCacheTile::data (int x, int y, int z, int c) const
         return NULL;
     size_t offset = ((z * h + y) * w + x) * pixelsize()
                   + (c-m_id.chbegin()) * channelsize();
-    return (const void *)&m_pixels[offset];
+    return (const void *)(m_data + offset);
 }
 
 
@@ -1546,11 +2190,28 @@ ImageCacheImpl::init ()
     m_deduplicate = true;
     m_unassociatedalpha = false;
     m_failure_retries = 0;
+    m_max_tile_batch = 1;
+    m_microcache_size = 0;
+    m_open_file_lru = false;
+    m_stat_file_reopens = 0;
+    m_mmap_tiles = false;
+    m_mem_mapped = 0;
     m_latlong_y_up_default = true;
     m_Mw2c.makeIdentity();
     m_mem_used = 0;
     m_statslevel = 0;
     m_max_errors_per_file = 100;
+    m_eviction_policy = EvictClock;
+    m_tile_shards.reset (new TileSweepShard[m_tilecache.nbins()]);
+    m_tile_shard_next = 0;
+    m_prefetch_threads = 2;
+    m_pinned_bytes = 0;
+    m_max_pinned_MB = 0.0f;
+    m_gather_threads = 1;
+    m_lockfree_tiles = 0;
+    m_tile_epoch = 1;
+    m_generation = 1;
+    m_all_generation = 0;
     m_stat_tiles_created = 0;
     m_stat_tiles_current = 0;
     m_stat_tiles_peak = 0;
@@ -1568,8 +2229,19 @@ ImageCacheImpl::init ()
 
 ImageCacheImpl::~ImageCacheImpl ()
 {
+    // Finish any prefetches still in the queue before tearing anything
+    // else down.
+    m_prefetch_pool.reset ();
     printstats ();
+    m_pinned.clear ();   // Drop pinned tiles while the cache is intact
     erase_perthread_info ();
+    // Wait for background closes, and from here on close files directly.
+    // The files outlive the LRU list, so make sure they won't use it.
+    m_close_pool.reset ();
+    m_open_file_lru = false;
+    for (ImageCacheFile *file : m_open_lru)
+        file->m_in_lru = false;
+    m_open_lru.clear ();
 }
 
 
@@ -1637,8 +2309,10 @@ ImageCacheImpl::onefile_stat_line (const ImageCacheFileRef &file,
         out << " DUPLICATES " << file->duplicate()->filename();
         return out.str();
     }
+    // Subimages nobody has used yet haven't been read, and aren't worth
+    // reading just to report on them.
     for (int s = 0;  s < file->subimages();  ++s)
-        if (file->subimageinfo(s).untiled) {
+        if (file->subimage_initialized(s) && file->subimageinfo(s).untiled) {
             out << " UNTILED";
             break;
         }
@@ -1646,14 +2320,16 @@ ImageCacheImpl::onefile_stat_line (const ImageCacheFileRef &file,
         // FIXME -- we should directly measure whether we ever automipped
         // this file.  This is a little inexact.
         for (int s = 0;  s < file->subimages();  ++s)
-            if (file->subimageinfo(s).unmipped) {
+            if (file->subimage_initialized(s) &&
+                file->subimageinfo(s).unmipped) {
                 out << " UNMIPPED";
                 break;
             }
     }
     if (! file->mipused()) {
         for (int s = 0;  s < file->subimages();  ++s)
-            if (! file->subimageinfo(s).unmipped) {
+            if (file->subimage_initialized(s) &&
+                ! file->subimageinfo(s).unmipped) {
                 out << " MIP-UNUSED";
                 break;
             }
@@ -1704,6 +2380,8 @@ ImageCacheImpl::getstats (int level) const
             bool found_untiled = false, found_unmipped = false;
             bool found_const = true;
             for (int s = 0, send = file->subimages();  s < send;  ++s) {
+                if (! file->subimage_initialized(s))
+                    continue;
                 const ImageCacheFile::SubimageInfo &si (file->subimageinfo(s));
                 found_untiled |= si.untiled;
                 found_unmipped |= si.unmipped;
@@ -1743,6 +2421,9 @@ ImageCacheImpl::getstats (int level) const
         INTOPT(deduplicate);
         INTOPT(unassociatedalpha);
         INTOPT(failure_retries);
+        BOOLOPT(lockfree_tiles);
+        if (m_eviction_policy == EvictGClock)
+            opt += "eviction_policy=\"gclock\" ";
 #undef BOOLOPT
 #undef INTOPT
 #undef STROPT
@@ -1751,6 +2432,8 @@ ImageCacheImpl::getstats (int level) const
         if (stats.unique_files) {
             out << "  Images : " << stats.unique_files << " unique\n";
             out << "    ImageInputs : " << m_stat_open_files_created << " created, " << m_stat_open_files_current << " current, " << m_stat_open_files_peak << " peak\n";
+            if (m_stat_file_reopens)
+                out << "      (" << m_stat_file_reopens << " re-opened after being closed to stay within max_open_files)\n";
             out << "    Total pixel data size of all images referenced : " << Strutil::memformat (stats.files_totalsize) << "\n";
             out << "    Total actual file size of all images referenced : " << Strutil::memformat (stats.files_totalsize_ondisk) << "\n";
             out << "    Pixel data read : " << Strutil::memformat (stats.bytes_read) << "\n";
@@ -1781,11 +2464,47 @@ ImageCacheImpl::getstats (int level) const
             out << "  Tiles: " << m_stat_tiles_created << " created, " << m_stat_tiles_current << " current, " << m_stat_tiles_peak << " peak\n";
             out << "    total tile requests : " << stats.find_tile_calls << "\n";
             out << "    micro-cache misses : " << stats.find_tile_microcache_misses << " (" << 100.0*(double)stats.find_tile_microcache_misses/(double)stats.find_tile_calls << "%)\n";
+            if (stats.find_tile_tiletable_hits)
+                out << "      hits in " << m_microcache_size << "-entry tables : " << stats.find_tile_tiletable_hits << " (" << 100.0*(double)stats.find_tile_tiletable_hits/(double)stats.find_tile_calls << "%)\n";
             out << "    main cache misses : " << stats.find_tile_cache_misses << " (" << 100.0*(double)stats.find_tile_cache_misses/(double)stats.find_tile_calls << "%)\n";
             out << "    redundant reads: " << (unsigned long long) total_redundant_tiles
                 << " tiles, " << Strutil::memformat (total_redundant_bytes) << "\n";
+            if (stats.tiles_evicted_clock || stats.tiles_evicted_gclock)
+                out << "    tiles evicted : " << stats.tiles_evicted_clock
+                    << " by clock, " << stats.tiles_evicted_gclock
+                    << " by gclock\n";
+            if (stats.tiles_prefetched)
+                out << "    tiles prefetched : " << stats.tiles_prefetched << "\n";
+            if (stats.tiles_constant)
+                out << "    constant tiles : " << stats.tiles_constant
+                    << " (" << Strutil::memformat (stats.tiles_constant_bytes)
+                    << " not allocated)\n";
         }
         out << "    Peak cache memory : " << Strutil::memformat (m_mem_used) << "\n";
+        if (m_pinned_bytes)
+            out << "    Pinned tile memory : "
+                << Strutil::memformat (m_pinned_bytes) << "\n";
+        if (disk_tiles_enabled()) {
+            out << "  Shared tile cache dir " << m_tile_cache_dir << "\n";
+            out << "    hits : " << stats.disk_tile_hits << ", misses : "
+                << stats.disk_tile_misses << ", tiles written : "
+                << stats.disk_tiles_written << "\n";
+            if (stats.disk_tiles_mapped)
+                out << "    tiles mapped : " << stats.disk_tiles_mapped
+                    << " (" << Strutil::memformat (m_mem_mapped)
+                    << " currently)\n";
+        }
+        if (m_compressed_tiles.enabled()) {
+            const CompressedTileStore &ct (m_compressed_tiles);
+            out << "  Compressed tile tier: " << ct.stored() << " tiles stored, "
+                << ct.ntiles() << " current\n";
+            out << "    hits : " << stats.compressed_tile_hits << ", misses : "
+                << stats.compressed_tile_misses << "\n";
+            out << "    memory : " << Strutil::memformat (ct.memory())
+                << " current (holding " << Strutil::memformat (ct.rawmemory())
+                << " of pixels), " << Strutil::memformat (ct.peak_memory())
+                << " peak, " << Strutil::memformat (ct.max_memory()) << " max\n";
+        }
         if (stats.tile_locking_time > 0.001)
             out << "    Tile mutex locking time : " << Strutil::timeintervalformat (stats.tile_locking_time) << "\n";
         if (stats.find_tile_time > 0.001)
@@ -1930,33 +2649,137 @@ ImageCacheImpl::getstats (int level) const
 
 
 
-void
-ImageCacheImpl::printstats () const
+std::string
+ImageCacheImpl::getstats_json (int level) const
 {
-    if (m_statslevel == 0)
-        return;
-    std::cout << getstats (m_statslevel) << "\n\n";
+    std::string out ("{");
+    append_stats_json (out, level);
+    out += "}";
+    return out;
 }
 
 
 
 void
-ImageCacheImpl::reset_stats ()
+ImageCacheImpl::append_stats_json (std::string &out, int level) const
 {
-    {
-        spin_lock lock (m_perthread_info_mutex);
-        for (size_t i = 0;  i < m_all_perthread_info.size();  ++i)
-            m_all_perthread_info[i]->m_stats.init ();
-    }
+    ImageCacheStatistics stats;
+    mergestats (stats);
 
-    {
+    out += Strutil::format ("\"imagecache\":{\"version\":\"%s\"",
+                            OIIO_VERSION_STRING);
+    out += Strutil::format (",\"files\":{\"unique\":%d,\"open_created\":%d,"
+                            "\"open_current\":%d,\"open_peak\":%d,"
+                            "\"reopens\":%d,\"image_size\":%lld,"
+                            "\"file_size\":%lld}",
+                            stats.unique_files, m_stat_open_files_created.load(),
+                            m_stat_open_files_current.load(),
+                            m_stat_open_files_peak.load(),
+                            m_stat_file_reopens.load(),
+                            stats.files_totalsize, stats.files_totalsize_ondisk);
+    out += Strutil::format (",\"tiles\":{\"created\":%d,\"current\":%d,"
+                            "\"peak\":%d,\"requests\":%lld,"
+                            "\"microcache_misses\":%lld,"
+                            "\"tiletable_hits\":%lld,"
+                            "\"main_cache_misses\":%d,"
+                            "\"evicted_clock\":%lld,\"evicted_gclock\":%lld,"
+                            "\"prefetched\":%lld,\"retry_success\":%d}",
+                            m_stat_tiles_created.load(),
+                            m_stat_tiles_current.load(),
+                            m_stat_tiles_peak.load(), stats.find_tile_calls,
+                            stats.find_tile_microcache_misses,
+                            stats.find_tile_tiletable_hits,
+                            stats.find_tile_cache_misses,
+                            stats.tiles_evicted_clock,
+                            stats.tiles_evicted_gclock,
+                            stats.tiles_prefetched, stats.tile_retry_success);
+    out += Strutil::format (",\"memory\":{\"used\":%lld,\"max\":%lld,"
+                            "\"mapped\":%lld},\"bytes_read\":%lld",
+                            m_mem_used.load(), (long long)m_max_memory_bytes,
+                            m_mem_mapped.load(), stats.bytes_read);
+    out += Strutil::format (",\"compressed_tiles\":{\"hits\":%lld,"
+                            "\"misses\":%lld},\"disk_tiles\":{\"hits\":%lld,"
+                            "\"misses\":%lld,\"written\":%lld,"
+                            "\"mapped\":%lld}",
+                            stats.compressed_tile_hits,
+                            stats.compressed_tile_misses,
+                            stats.disk_tile_hits, stats.disk_tile_misses,
+                            stats.disk_tiles_written, stats.disk_tiles_mapped);
+    // Times are in seconds, summed over all threads.
+    out += Strutil::format (",\"time\":{\"fileio\":%.9g,\"fileopen\":%.9g,"
+                            "\"file_locking\":%.9g,\"find_file\":%.9g,"
+                            "\"find_tile\":%.9g}",
+                            stats.fileio_time, stats.fileopen_time,
+                            stats.file_locking_time, stats.find_file_time,
+                            stats.find_tile_time);
+    out += ",";
+    append_json_histogram (out, "tile_read_latency", stats.tile_read_latency);
+    out += ",";
+    append_json_histogram (out, "file_open_latency", stats.file_open_latency);
+
+    if (level >= 2) {
+        out += ",\"per_file\":[";
+        bool first = true;
         for (FilenameMap::iterator f = m_files.begin(); f != m_files.end(); ++f) {
             const ImageCacheFileRef &file (f->second);
-            file->m_timesopened = 0;
-            file->m_tilesread = 0;
-            file->m_bytesread = 0;
-            file->m_iotime = 0;
-        }
+            if (file->is_udim())
+                continue;
+            out += first ? "{\"name\":" : ",{\"name\":";
+            first = false;
+            append_json_string (out, file->filename());
+            out += Strutil::format (",\"broken\":%s,\"opens\":%llu,"
+                                    "\"tiles_read\":%llu,\"tile_hits\":%lld,"
+                                    "\"bytes_read\":%llu,"
+                                    "\"redundant_tiles\":%llu,"
+                                    "\"io_time\":%.9g,\"mip_reads\":[",
+                                    file->broken() ? "true" : "false",
+                                    (unsigned long long) file->timesopened(),
+                                    (unsigned long long) file->tilesread(),
+                                    file->tilehits(),
+                                    (unsigned long long) file->bytesread(),
+                                    (unsigned long long) file->redundant_tiles(),
+                                    file->iotime());
+            const std::vector<size_t> &mipreads (file->mipreadcount());
+            for (size_t m = 0; m < mipreads.size(); ++m)
+                out += Strutil::format ("%s%llu", m ? "," : "",
+                                        (unsigned long long) mipreads[m]);
+            out += "]}";
+        }
+        out += "]";
+    }
+    out += "}";
+}
+
+
+
+void
+ImageCacheImpl::printstats () const
+{
+    if (m_statslevel == 0)
+        return;
+    std::cout << getstats (m_statslevel) << "\n\n";
+}
+
+
+
+void
+ImageCacheImpl::reset_stats ()
+{
+    {
+        spin_lock lock (m_perthread_info_mutex);
+        for (size_t i = 0;  i < m_all_perthread_info.size();  ++i)
+            m_all_perthread_info[i]->m_stats.init ();
+    }
+
+    {
+        for (FilenameMap::iterator f = m_files.begin(); f != m_files.end(); ++f) {
+            const ImageCacheFileRef &file (f->second);
+            file->m_timesopened = 0;
+            file->m_tilesread = 0;
+            file->m_bytesread = 0;
+            file->m_iotime = 0;
+            file->m_tilehits = 0;
+        }
     }
 }
 
@@ -2012,6 +2835,40 @@ ImageCacheImpl::attribute (string_view name, TypeDesc type,
     else if (name == "max_errors_per_file" && type == TypeDesc::INT) {
         m_max_errors_per_file = *(const int *)val;
     }
+    else if (name == "prefetch_threads" && type == TypeDesc::INT) {
+        int n = std::max (1, *(const int *)val);
+        spin_lock lock (m_prefetch_mutex);
+        if (n != m_prefetch_threads) {
+            // Let the old pool finish its queue; the next prefetch will
+            // start a new pool of the new size.
+            m_prefetch_pool.reset ();
+            m_prefetch_threads = n;
+        }
+    }
+    else if (name == "max_pinned_MB" && type == TypeDesc::FLOAT) {
+        m_max_pinned_MB = std::max (0.0f, *(const float *)val);
+    }
+    else if (name == "max_pinned_MB" && type == TypeDesc::INT) {
+        m_max_pinned_MB = std::max (0.0f, float(*(const int *)val));
+    }
+    else if (name == "gather_threads" && type == TypeDesc::INT) {
+        m_gather_threads = std::max (0, *(const int *)val);
+    }
+    else if (name == "lockfree_tiles" && type == TypeDesc::INT) {
+        int on = (*(const int *)val != 0);
+        if (on && ! m_tileindex.initialized()) {
+            // Size the index to comfortably hold as many 64x64x4 byte
+            // tiles as fit in the memory limit; tiles in overfull
+            // buckets just aren't indexed.
+            size_t ntiles = size_t(m_max_memory_bytes / (64*64*4));
+            m_tileindex.init (std::max (ntiles / 4, size_t(1024)));
+        }
+        if (on != m_lockfree_tiles) {
+            m_lockfree_tiles = on;
+            if (! on)
+                m_tileindex.clear ();
+        }
+    }
     else if (name == "autotile" && type == TypeDesc::INT) {
         int a = pow2roundup (*(const int *)val);  // guarantee pow2
         // Clamp to minimum 8x8 tiles to protect against stupid user who
@@ -2085,15 +2942,49 @@ ImageCacheImpl::attribute (string_view name, TypeDesc type,
     else if (name == "failure_retries" && type == TypeDesc::INT) {
         m_failure_retries = *(const int *)val;
     }
+    else if (name == "max_compressed_memory_MB" && type == TypeDesc::FLOAT) {
+        float size = *(const float *)val;
+        m_compressed_tiles.max_memory ((long long) (std::max (size, 0.0f) * 1024 * 1024));
+    }
+    else if (name == "max_compressed_memory_MB" && type == TypeDesc::INT) {
+        float size = *(const int *)val;
+        m_compressed_tiles.max_memory ((long long) (std::max (size, 0.0f) * 1024 * 1024));
+    }
+    else if (name == "max_tile_batch" && type == TypeDesc::INT) {
+        m_max_tile_batch = std::max (1, *(const int *)val);
+    }
+    else if (name == "microcache_size" && type == TypeDesc::INT) {
+        int n = Imath::clamp (*(const int *)val, 0, 1024);
+        n = n ? pow2roundup (n) : 0;
+        if (n != m_microcache_size) {
+            m_microcache_size = n;
+            // Threads will resize their tables as they next purge
+            purge_perthread_microcaches ();
+        }
+    }
     else if (name == "latlong_up" && type == TypeDesc::STRING) {
         bool y_up = ! strcmp ("y", *(const char **)val);
         if (y_up != m_latlong_y_up_default) {
             m_latlong_y_up_default = y_up;
             do_invalidate = true;
         }
+    } else if (name == "open_file_lru" && type == TypeDesc::INT) {
+        m_open_file_lru = *(const int *)val != 0;
+    } else if (name == "mmap_tiles" && type == TypeDesc::INT) {
+        m_mmap_tiles = *(const int *)val != 0;
+    } else if (name == "tile_cache_dir" && type == TypeDesc::STRING) {
+        m_tile_cache_dir = ustring (*(const char **)val);
     } else if (name == "substitute_image" && type == TypeDesc::STRING) {
         m_substitute_image = ustring (*(const char **)val);
         do_invalidate = true;
+    } else if (name == "eviction_policy" && type == TypeDesc::STRING) {
+        string_view policy (*(const char **)val);
+        if (policy == "clock")
+            m_eviction_policy = EvictClock;
+        else if (policy == "gclock")
+            m_eviction_policy = EvictGClock;
+        else
+            return false;
     } else {
         // Otherwise, unknown name
         return false;
@@ -2131,6 +3022,17 @@ ImageCacheImpl::getattribute (string_view name, TypeDesc type,
     ATTR_DECODE ("deduplicate", int, m_deduplicate);
     ATTR_DECODE ("unassociatedalpha", int, m_unassociatedalpha);
     ATTR_DECODE ("failure_retries", int, m_failure_retries);
+    ATTR_DECODE ("max_tile_batch", int, m_max_tile_batch);
+    ATTR_DECODE ("mmap_tiles", int, m_mmap_tiles);
+    ATTR_DECODE ("open_file_lru", int, m_open_file_lru);
+    ATTR_DECODE ("max_compressed_memory_MB", float, m_compressed_tiles.max_memory()/(1024.0*1024.0));
+    ATTR_DECODE ("max_compressed_memory_MB", int, m_compressed_tiles.max_memory()/(1024*1024));
+    ATTR_DECODE ("microcache_size", int, m_microcache_size);
+    ATTR_DECODE ("lockfree_tiles", int, m_lockfree_tiles.load());
+    ATTR_DECODE ("prefetch_threads", int, m_prefetch_threads);
+    ATTR_DECODE ("max_pinned_MB", float, max_pinned_bytes()/(1024.0*1024.0));
+    ATTR_DECODE ("max_pinned_MB", int, max_pinned_bytes()/(1024*1024));
+    ATTR_DECODE ("gather_threads", int, m_gather_threads);
     ATTR_DECODE ("total_files", int, m_files.size());
 
     // The cases that don't fit in the simple ATTR_DECODE scheme
@@ -2156,10 +3058,19 @@ ImageCacheImpl::getattribute (string_view name, TypeDesc type,
         *(const char **)val = ustring (m_latlong_y_up_default ? "y" : "z").c_str();
         return true;
     }
+    if (name == "tile_cache_dir" && type == TypeDesc::STRING) {
+        *(const char **)val = m_tile_cache_dir.c_str();
+        return true;
+    }
     if (name == "substitute_image" && type == TypeDesc::STRING) {
         *(const char **)val = m_substitute_image.c_str();
         return true;
     }
+    if (name == "eviction_policy" && type == TypeDesc::STRING) {
+        *(const char **)val = ustring (m_eviction_policy == EvictGClock
+                                       ? "gclock" : "clock").c_str();
+        return true;
+    }
     if (name == "all_filenames" && type.basetype == TypeDesc::STRING &&
             type.is_sized_array()) {
         ustring *names = (ustring *) val;
@@ -2173,12 +3084,14 @@ ImageCacheImpl::getattribute (string_view name, TypeDesc type,
     if (Strutil::starts_with(name, "stat:")) {
         // Stats we can just grab
         ATTR_DECODE ("stat:cache_memory_used", long long, m_mem_used);
+        ATTR_DECODE ("stat:pinned_bytes", long long, m_pinned_bytes);
         ATTR_DECODE ("stat:tiles_created", int, m_stat_tiles_created);
         ATTR_DECODE ("stat:tiles_current", int, m_stat_tiles_current);
         ATTR_DECODE ("stat:tiles_peak", int, m_stat_tiles_peak);
         ATTR_DECODE ("stat:open_files_created", int, m_stat_open_files_created);
         ATTR_DECODE ("stat:open_files_current", int, m_stat_open_files_current);
         ATTR_DECODE ("stat:open_files_peak", int, m_stat_open_files_peak);
+        ATTR_DECODE ("stat:file_reopens", int, m_stat_file_reopens);
 
         // All the other stats are those that need to be summed from all
         // the threads.
@@ -2186,6 +3099,7 @@ ImageCacheImpl::getattribute (string_view name, TypeDesc type,
         mergestats (stats);
         ATTR_DECODE ("stat:find_tile_calls", long long, stats.find_tile_calls);
         ATTR_DECODE ("stat:find_tile_microcache_misses", long long, stats.find_tile_microcache_misses);
+        ATTR_DECODE ("stat:find_tile_tiletable_hits", long long, stats.find_tile_tiletable_hits);
         ATTR_DECODE ("stat:find_tile_cache_misses", int, stats.find_tile_cache_misses);
         ATTR_DECODE ("stat:files_totalsize", long long, stats.files_totalsize); // Old name
         ATTR_DECODE ("stat:image_size", long long, stats.files_totalsize);
@@ -2198,6 +3112,22 @@ ImageCacheImpl::getattribute (string_view name, TypeDesc type,
         ATTR_DECODE ("stat:tile_locking_time", float, stats.tile_locking_time);
         ATTR_DECODE ("stat:find_file_time", float, stats.find_file_time);
         ATTR_DECODE ("stat:find_tile_time", float, stats.find_tile_time);
+        ATTR_DECODE ("stat:tiles_evicted", long long,
+                     stats.tiles_evicted_clock + stats.tiles_evicted_gclock);
+        ATTR_DECODE ("stat:tiles_evicted_clock", long long, stats.tiles_evicted_clock);
+        ATTR_DECODE ("stat:tiles_evicted_gclock", long long, stats.tiles_evicted_gclock);
+        ATTR_DECODE ("stat:tiles_prefetched", long long, stats.tiles_prefetched);
+        ATTR_DECODE ("stat:tiles_constant", long long, stats.tiles_constant);
+        ATTR_DECODE ("stat:tiles_constant_bytes", long long, stats.tiles_constant_bytes);
+        ATTR_DECODE ("stat:compressed_tile_hits", long long, stats.compressed_tile_hits);
+        ATTR_DECODE ("stat:compressed_tile_misses", long long, stats.compressed_tile_misses);
+        ATTR_DECODE ("stat:compressed_tiles_current", int, m_compressed_tiles.ntiles());
+        ATTR_DECODE ("stat:compressed_memory_used", long long, m_compressed_tiles.memory());
+        ATTR_DECODE ("stat:disk_tile_hits", long long, stats.disk_tile_hits);
+        ATTR_DECODE ("stat:disk_tile_misses", long long, stats.disk_tile_misses);
+        ATTR_DECODE ("stat:disk_tiles_written", long long, stats.disk_tiles_written);
+        ATTR_DECODE ("stat:disk_tiles_mapped", long long, stats.disk_tiles_mapped);
+        ATTR_DECODE ("stat:mapped_memory", long long, m_mem_mapped);
     }
 
     return false;
@@ -2210,11 +3140,32 @@ bool
 ImageCacheImpl::find_tile_main_cache (const TileID &id, ImageCacheTileRef &tile,
                            ImageCachePerThreadInfo *thread_info)
 {
+    OIIO_TRACE_ZONE ("ImageCache::find_tile");
     DASSERT (! id.file().broken());
     ImageCacheStatistics &stats (thread_info->m_stats);
 
     ++stats.find_tile_microcache_misses;
 
+    if (m_lockfree_tiles) {
+        // Look in the lock-free index.  While our epoch is set, no tile
+        // we can see in the index will be freed (see retire_tile), which
+        // gives us time to take our own reference to it.
+        thread_info->epoch = m_tile_epoch.load();
+        ImageCacheTile *t = m_tileindex.find (id, id.hash());
+        if (t && tile_stale (t))
+            t = NULL;   // look in the main cache, which will replace it
+        if (t)
+            tile = t;
+        thread_info->epoch = 0;
+        if (t) {
+            id.file().register_tile_hit ();
+            tile->wait_pixels_ready ();
+            tile->use ();
+            DASSERT (id == tile->id());
+            return true;
+        }
+    }
+
     {
 #if IMAGECACHE_TIME_STATS
         Timer timer1;
@@ -2223,9 +3174,22 @@ ImageCacheImpl::find_tile_main_cache (const TileID &id, ImageCacheTileRef &tile,
 #if IMAGECACHE_TIME_STATS
         stats.find_tile_time += timer1();
 #endif
-        if (found) {
+        if (found && tile_stale ((*found).second.get())) {
+            // Left over from before an invalidate.  Erase it, and read
+            // the tile afresh below.  (If another thread beat us to
+            // replacing it, we may erase its fresh tile instead, which
+            // costs only a redundant read.)
+            found.unlock ();
+            erase_tile (id);
+            reclaim_retired_tiles ();
+        } else if (found) {
             tile = (*found).second;
+            // Tiles that went into the cache before the lock-free index
+            // was turned on (or didn't fit) get another chance to be
+            // indexed while we hold the bin lock.
+            publish_tile (tile.get());
             found.unlock();  // release the lock
+            id.file().register_tile_hit ();
             // We found the tile in the cache, but we need to make sure we
             // wait until the pixels are ready to read.  We purposely have
             // released the lock (above) before calling wait_pixels_ready,
@@ -2243,6 +3207,13 @@ ImageCacheImpl::find_tile_main_cache (const TileID &id, ImageCacheTileRef &tile,
 
     ++stats.find_tile_cache_misses;
 
+    // Maybe it was evicted, but is still in the compressed tier.
+    if (m_compressed_tiles.enabled() &&
+        find_compressed_tile (id, tile, thread_info)) {
+        add_tile_to_cache (tile, thread_info);
+        return tile->valid();
+    }
+
     // Yes, we're creating and reading a tile with no lock -- this is to
     // prevent all the other threads from blocking because of our
     // expensive disk read.  We believe this is safe, since underneath
@@ -2273,7 +3244,14 @@ ImageCacheImpl::add_tile_to_cache (ImageCacheTileRef &tile,
         // Protect us from using too much memory if another thread added the
         // same tile just before us
         TileCache::iterator found = m_tilecache.find (tile->id());
-        if (found != m_tilecache.end ()) {
+        bool stale = (found != m_tilecache.end () &&
+                      tile_stale ((*found).second.get()));
+        if (stale) {
+            // Replace a tile left over from before an invalidate.
+            found.unlock ();
+            erase_tile (tile->id());
+        }
+        if (found != m_tilecache.end () && ! stale) {
             // Already added!  Use the other one, discard ours.
             tile = (*found).second;
             found.unlock ();
@@ -2282,7 +3260,16 @@ ImageCacheImpl::add_tile_to_cache (ImageCacheTileRef &tile,
             // Still not in cache, add ours to the cache.
             // N.B. at this time, we do not hold any locks.
             check_max_mem (thread_info);
-            m_tilecache.insert (tile->id(), tile);
+            if (m_lockfree_tiles) {
+                // Insert and index the tile under the same bin lock, so
+                // that the index never refers to a tile not in the cache.
+                size_t bin = m_tilecache.lock_bin (tile->id());
+                m_tilecache.insert (tile->id(), tile, false);
+                publish_tile (tile.get());
+                m_tilecache.unlock_bin (bin);
+            } else {
+                m_tilecache.insert (tile->id(), tile);
+            }
         }
     }
 
@@ -2321,6 +3308,12 @@ ImageCacheImpl::check_max_mem (ImageCachePerThreadInfo *thread_info)
     // Early out if we aren't exceeding the tile memory limit
     if (m_mem_used < (long long)m_max_memory_bytes)
         return;
+    OIIO_TRACE_ZONE ("ImageCache::evict");
+
+    if (m_eviction_policy == EvictGClock) {
+        check_max_mem_sharded (thread_info);
+        return;
+    }
 
     // Try to grab the tile_sweep_mutex lock. If somebody else holds it,
     // just return -- leave the memory limit enforcement to whomever is
@@ -2369,20 +3362,30 @@ ImageCacheImpl::check_max_mem (ImageCachePerThreadInfo *thread_info)
             break;
         DASSERT (sweep->second);
 
-        if (! sweep->second->release ()) {
+        if (tile_stale (sweep->second.get()) || ! sweep->second->release ()) {
             // This is a tile we should delete.  To keep iterating
             // safely, we have a good trick:
             // 1. remember the TileID of the tile to delete
             TileID todelete = sweep->first;
             size_t size = sweep->second->memsize();
+            ImageCacheTileRef victim;
+            if (m_compressed_tiles.enabled())
+                victim = sweep->second;
             ASSERT (m_mem_used >= (long long)size);
             // 2. Increment the iterator to the next item to be visited
             // in the cache and then unlock it (since it can't be locked
             // for the subsequent erase() call).
             ++sweep;
             sweep.unlock ();
-            // 3. Erase the tile we wish to delete
-            m_tilecache.erase (todelete);
+            // 3. Erase the tile we wish to delete (if it was in the
+            // lock-free index, it isn't freed until it's safe to do so)
+            erase_tile (todelete);
+            if (victim) {
+                save_evicted_tile (victim.get());
+                victim = NULL;
+            }
+            reclaim_retired_tiles ();
+            ++thread_info->m_stats.tiles_evicted_clock;
                 // std::cerr << "  Freed tile, recovering " << size << "\n";
             // 4. Re-lock the iterator, which now points to the next
             // item the from the cache to examine.
@@ -2407,6 +3410,590 @@ ImageCacheImpl::check_max_mem (ImageCachePerThreadInfo *thread_info)
 
 
 
+void
+ImageCacheImpl::check_max_mem_sharded (ImageCachePerThreadInfo *thread_info)
+{
+    // Rather than one clock hand for the whole cache, guarded by a single
+    // mutex, each bin of the tile cache has its own.  A thread that needs
+    // to free memory tries the shards round-robin, skipping any shard
+    // another thread is already sweeping, so several threads can evict
+    // at once without waiting on each other.
+    size_t nshards = m_tilecache.nbins();
+    for (size_t tries = 0;  tries < nshards;  ++tries) {
+        long long excess = m_mem_used - (long long)m_max_memory_bytes;
+        if (excess < 0)
+            break;
+        size_t s = size_t(m_tile_shard_next++) % nshards;
+        TileSweepShard &shard (m_tile_shards[s]);
+        if (! shard.mutex.try_lock())
+            continue;
+        sweep_shard (s, excess, thread_info);
+        shard.mutex.unlock ();
+    }
+}
+
+
+
+void
+ImageCacheImpl::sweep_shard (size_t s, long long excess,
+                             ImageCachePerThreadInfo *thread_info)
+{
+    // Each pass of the shard's clock hand takes away one use from every
+    // tile it passes, and evicts tiles with none left.  Tiles that are
+    // used over and over (up to ImageCacheTile::max_use_count times
+    // between passes) survive several passes, while tiles touched just
+    // once -- such as by a scan through a big shadow map -- are the first
+    // to go rather than pushing out the hot working set.
+    TileSweepShard &shard (m_tile_shards[s]);
+    std::vector<ImageCacheTileRef> victims;
+    long long freed = 0;
+    {
+        TileCache::iterator sweep = m_tilecache.end();
+        if (! shard.sweep_id.empty())
+            sweep = m_tilecache.find (shard.sweep_id);
+        if (! sweep)
+            sweep = m_tilecache.bin_begin (s);
+        for (int pass = 0;  freed <= excess; ) {
+            if (! sweep) {
+                // Ran off the end of the shard, go back to its beginning
+                if (++pass > ImageCacheTile::max_use_count)
+                    break;
+                sweep.clear ();   // release the bin lock before relocking
+                sweep = m_tilecache.bin_begin (s);
+                if (! sweep)
+                    break;   // empty shard
+            }
+            ImageCacheTileRef &tile (sweep->second);
+            if ((tile_stale (tile.get()) || ! tile->release (true)) &&
+                  (pass == 0 || std::find (victims.begin(), victims.end(),
+                                           tile) == victims.end())) {
+                victims.push_back (tile);
+                freed += tile->memsize();
+            }
+            sweep.incr_no_lock ();
+        }
+        shard.sweep_id = sweep ? sweep->first : TileID();
+        // N.B. the sweep iterator goes out of scope here, releasing the
+        // lock on the bin before we erase anything from it.
+    }
+
+    thread_info->m_stats.tiles_evicted_gclock += victims.size();
+    for (ImageCacheTileRef &tile : victims) {
+        erase_tile (tile->id());
+        save_evicted_tile (tile.get());
+        tile = NULL;
+    }
+    reclaim_retired_tiles ();
+}
+
+
+
+void
+TileLookupIndex::init (size_t nbuckets)
+{
+    ASSERT (! initialized());
+    nbuckets = std::max (size_t(pow2roundup (int(nbuckets))), size_t(2));
+    m_buckets.reset (new Bucket[nbuckets]);
+    for (size_t b = 0;  b < nbuckets;  ++b)
+        for (int i = 0;  i < bucket_size;  ++i)
+            m_buckets[b].slot[i] = NULL;
+    m_mask = nbuckets - 1;
+}
+
+
+
+bool
+TileLookupIndex::publish (ImageCacheTile *tile, size_t hash)
+{
+    Bucket &b (m_buckets[bucket(hash)]);
+    for (int i = 0;  i < bucket_size;  ++i) {
+        ImageCacheTile *t = b.slot[i].load();
+        if (t == tile)
+            return true;   // already there
+        if (t == NULL && b.slot[i].compare_exchange_strong (t, tile))
+            return true;
+    }
+    return false;
+}
+
+
+
+void
+TileLookupIndex::unpublish (ImageCacheTile *tile, size_t hash)
+{
+    Bucket &b (m_buckets[bucket(hash)]);
+    for (int i = 0;  i < bucket_size;  ++i) {
+        ImageCacheTile *t = tile;
+        if (b.slot[i].compare_exchange_strong (t, NULL))
+            return;
+    }
+}
+
+
+
+void
+TileLookupIndex::clear ()
+{
+    for (size_t b = 0;  initialized() && b <= m_mask;  ++b)
+        for (int i = 0;  i < bucket_size;  ++i)
+            m_buckets[b].slot[i] = NULL;
+}
+
+
+
+void
+ImageCacheImpl::erase_tile (const TileID &id)
+{
+    if (! m_tileindex.initialized()) {
+        m_tilecache.erase (id);
+        return;
+    }
+    // Remove the tile from the cache and the index together, under the
+    // bin lock, but don't let the tile be freed yet -- a lock-free
+    // lookup may have found it in the index an instant ago.
+    ImageCacheTileRef tile;
+    size_t bin = m_tilecache.lock_bin (id);
+    if (m_tilecache.retrieve (id, tile, false)) {
+        m_tilecache.erase (id, false);
+        m_tileindex.unpublish (tile.get(), id.hash());
+    }
+    m_tilecache.unlock_bin (bin);
+    if (tile)
+        retire_tile (tile);
+}
+
+
+
+void
+ImageCacheImpl::retire_tile (const ImageCacheTileRef &tile)
+{
+    // Any lookup that began before the epoch advances might still see
+    // the tile; any lookup that begins after will not find it.
+    long long epoch = m_tile_epoch.fetch_add (1);
+    spin_lock lock (m_retired_tiles_mutex);
+    m_retired_tiles.push_back (std::make_pair (epoch, tile));
+}
+
+
+
+void
+ImageCacheImpl::reclaim_retired_tiles ()
+{
+    if (! m_tileindex.initialized())
+        return;
+    // Find the oldest epoch of any lock-free lookup in progress.
+    long long oldest = m_tile_epoch.load();
+    {
+        spin_lock lock (m_perthread_info_mutex);
+        for (size_t i = 0;  i < m_all_perthread_info.size();  ++i) {
+            if (! m_all_perthread_info[i])
+                continue;   // erased or destroyed
+            long long e = m_all_perthread_info[i]->epoch.load();
+            if (e)
+                oldest = std::min (oldest, e);
+        }
+    }
+    // Tiles retired before that epoch can't be seen by anyone.  Move
+    // them to a local list so they are freed after we drop our lock.
+    std::vector<ImageCacheTileRef> dead;
+    {
+        spin_lock lock (m_retired_tiles_mutex);
+        size_t n = 0;
+        for (size_t i = 0;  i < m_retired_tiles.size();  ++i) {
+            if (m_retired_tiles[i].first < oldest)
+                dead.push_back (m_retired_tiles[i].second);
+            else
+                m_retired_tiles[n++] = m_retired_tiles[i];
+        }
+        m_retired_tiles.resize (n);
+    }
+}
+
+
+
+void
+CompressedTileStore::max_memory (long long bytes)
+{
+    spin_lock lock (m_mutex);
+    m_max_memory = std::max (bytes, 0LL);
+    enforce_budget ();
+}
+
+
+
+void
+CompressedTileStore::store (const TileID &id, const void *pixels,
+                            size_t size, int channelsize, int generation)
+{
+    if (! enabled())
+        return;
+    // Shuffle the bytes so that the first byte of every channel value
+    // comes first, then all the second bytes, and so on.  The high bytes
+    // of neighboring float or half values are usually similar, so this
+    // makes the data far more compressible by a fast deflate.
+    const unsigned char *src = (const unsigned char *) pixels;
+    std::unique_ptr<unsigned char[]> shuffled;
+    if (channelsize > 1) {
+        shuffled.reset (new unsigned char [size]);
+        size_t nvals = size / channelsize;
+        for (int b = 0;  b < channelsize;  ++b)
+            for (size_t i = 0;  i < nvals;  ++i)
+                shuffled[b*nvals + i] = src[i*channelsize + b];
+        src = shuffled.get();
+    }
+    uLongf csize = compressBound (uLong(size));
+    std::unique_ptr<char[]> buf (new char [csize]);
+    if (compress2 ((Bytef *)buf.get(), &csize, src, uLong(size),
+                   Z_BEST_SPEED) != Z_OK)
+        return;
+    Entry entry;
+    entry.data.reset (new char [csize]);
+    memcpy (entry.data.get(), buf.get(), csize);
+    entry.size = csize;
+    entry.rawsize = size;
+    entry.channelsize = channelsize;
+    entry.generation = generation;
+
+    spin_lock lock (m_mutex);
+    EntryMap::iterator old = m_tiles.find (id);
+    if (old != m_tiles.end())
+        erase (old);
+    entry.seq = m_next_seq++;
+    m_order.push_back (std::make_pair (id, entry.seq));
+    m_memory += entry.size;
+    m_rawmemory += entry.rawsize;
+    m_peak_memory = std::max (m_peak_memory, m_memory);
+    ++m_stored;
+    m_tiles.insert (std::make_pair (id, std::move(entry)));
+    enforce_budget ();
+}
+
+
+
+bool
+CompressedTileStore::retrieve (const TileID &id, void *pixels, size_t size,
+                               int &generation)
+{
+    Entry entry;
+    {
+        spin_lock lock (m_mutex);
+        EntryMap::iterator e = m_tiles.find (id);
+        if (e == m_tiles.end())
+            return false;
+        entry.data = std::move (e->second.data);
+        entry.size = e->second.size;
+        entry.rawsize = e->second.rawsize;
+        entry.channelsize = e->second.channelsize;
+        generation = e->second.generation;
+        erase (e);
+    }
+    // Decompress and unshuffle outside the lock.
+    if (entry.rawsize > size)
+        return false;
+    int channelsize = entry.channelsize;
+    std::unique_ptr<unsigned char[]> shuffled;
+    unsigned char *dst = (unsigned char *) pixels;
+    if (channelsize > 1) {
+        shuffled.reset (new unsigned char [entry.rawsize]);
+        dst = shuffled.get();
+    }
+    uLongf rawsize = uLongf (entry.rawsize);
+    if (uncompress (dst, &rawsize, (const Bytef *)entry.data.get(),
+                    uLong(entry.size)) != Z_OK || rawsize != entry.rawsize)
+        return false;
+    if (channelsize > 1) {
+        unsigned char *out = (unsigned char *) pixels;
+        size_t nvals = entry.rawsize / channelsize;
+        for (int b = 0;  b < channelsize;  ++b)
+            for (size_t i = 0;  i < nvals;  ++i)
+                out[i*channelsize + b] = shuffled[b*nvals + i];
+    }
+    return true;
+}
+
+
+
+void
+CompressedTileStore::invalidate (const ImageCacheFile *file)
+{
+    spin_lock lock (m_mutex);
+    if (! file) {
+        m_tiles.clear ();
+        m_order.clear ();
+        m_memory = 0;
+        m_rawmemory = 0;
+        return;
+    }
+    for (EntryMap::iterator e = m_tiles.begin();  e != m_tiles.end(); ) {
+        EntryMap::iterator next = e;
+        ++next;
+        if (e->first.file_ptr() == file)
+            erase (e);
+        e = next;
+    }
+}
+
+
+
+void
+CompressedTileStore::enforce_budget ()
+{
+    while (m_memory > m_max_memory && ! m_order.empty()) {
+        EntryMap::iterator e = m_tiles.find (m_order.front().first);
+        if (e != m_tiles.end() && e->second.seq == m_order.front().second)
+            erase (e);
+        m_order.pop_front ();
+    }
+    if (m_tiles.empty())
+        m_order.clear ();   // Don't let stale records pile up
+}
+
+
+
+void
+CompressedTileStore::erase (EntryMap::iterator e)
+{
+    m_memory -= e->second.size;
+    m_rawmemory -= e->second.rawsize;
+    m_tiles.erase (e);
+}
+
+
+
+void
+ImageCacheImpl::save_evicted_tile (const ImageCacheTile *tile)
+{
+    // Constant tiles share one buffer and are free to rebuild, and they
+    // have no memsize() of their own, so never compress them.
+    if (! m_compressed_tiles.enabled() || ! tile->valid() ||
+        ! tile->pixels_ready() || tile->mapped() || tile->constant() ||
+        tile_stale (tile))
+        return;
+    const TileID &id (tile->id());
+    m_compressed_tiles.store (id, tile->data(),
+                              tile->memsize_needed() - OIIO_SIMD_MAX_SIZE_BYTES,
+                              (int) tile->file().datatype(id.subimage()).size(),
+                              tile->generation());
+}
+
+
+
+bool
+ImageCacheImpl::find_compressed_tile (const TileID &id, ImageCacheTileRef &tile,
+                                      ImageCachePerThreadInfo *thread_info)
+{
+    const ImageSpec &spec (id.file().spec (id.subimage(), id.miplevel()));
+    TypeDesc format = id.file().datatype (id.subimage());
+    size_t size = spec.tile_pixels() * id.nchannels() * format.size();
+    std::unique_ptr<char[]> pixels (new char [size]);
+    int generation = 0;
+    if (! m_compressed_tiles.retrieve (id, pixels.get(), size, generation)) {
+        ++thread_info->m_stats.compressed_tile_misses;
+        return false;
+    }
+    ImageCacheTileRef t = new ImageCacheTile (id, pixels.get(), format,
+                                              AutoStride, AutoStride, AutoStride);
+    t->generation (generation);
+    if (tile_stale (t.get())) {
+        // Compressed before its file was invalidated
+        ++thread_info->m_stats.compressed_tile_misses;
+        return false;
+    }
+    ++thread_info->m_stats.compressed_tile_hits;
+    tile = t;
+    return true;
+}
+
+
+
+namespace {
+
+// Each tile in the tile_cache_dir is a small header followed by the raw
+// pixels, exactly as they are held in memory, so that the file may be
+// read (or mapped) directly into a tile.
+struct DiskTileHeader {
+    char magic[8];          // "OIIOTILE"
+    uint64_t size;          // Bytes of pixel data that follow
+};
+
+static const char disk_tile_magic[8] = { 'O','I','I','O','T','I','L','E' };
+
+}  // end anonymous namespace
+
+
+
+std::string
+ImageCacheImpl::disk_tile_dir (const ImageCacheFile &file) const
+{
+    ustring dir = m_tile_cache_dir;
+    if (dir.empty())
+        return std::string();
+    std::string key;
+    if (m_deduplicate && ! file.fingerprint().empty()) {
+        key = file.fingerprint().string();
+    } else {
+        std::string s = Strutil::format ("%s %lld", file.filename(),
+                                         (long long) file.mod_time());
+        key = SHA1::digest (s.data(), s.size());
+    }
+    return Strutil::format ("%s/%s", dir, key);
+}
+
+
+
+std::string
+ImageCacheImpl::disk_tile_path (const TileID &id) const
+{
+    const ImageCacheFile &file (id.file());
+    const ImageSpec &spec (file.spec (id.subimage(), id.miplevel()));
+    // Name the tile by everything that could change the pixels we would
+    // decode for it, including the settings that alter how files are read.
+    return Strutil::format ("%s/%d_%d_%d_%d_%d_c%d-%d_%s_%dx%dx%d%s.tile",
+                            disk_tile_dir (file), id.subimage(),
+                            id.miplevel(), id.x(), id.y(), id.z(),
+                            id.chbegin(), id.chend(),
+                            file.datatype(id.subimage()),
+                            spec.tile_width, spec.tile_height,
+                            spec.tile_depth, m_unassociatedalpha ? "_u" : "");
+}
+
+
+
+bool
+ImageCacheImpl::read_disk_tile (const TileID &id, void *pixels, size_t size,
+                                ImageCachePerThreadInfo *thread_info)
+{
+    std::string path = disk_tile_path (id);
+    FILE *fd = path.size() ? Filesystem::fopen (path, "rb") : NULL;
+    bool ok = false;
+    if (fd) {
+        DiskTileHeader header;
+        ok = fread (&header, sizeof(header), 1, fd) == 1 &&
+             ! memcmp (header.magic, disk_tile_magic, sizeof(disk_tile_magic)) &&
+             header.size == size &&
+             fread (pixels, 1, size, fd) == size;
+        fclose (fd);
+    }
+    if (ok)
+        ++thread_info->m_stats.disk_tile_hits;
+    else
+        ++thread_info->m_stats.disk_tile_misses;
+    return ok;
+}
+
+
+
+void
+ImageCacheImpl::write_disk_tile (const TileID &id, const void *pixels,
+                                 size_t size,
+                                 ImageCachePerThreadInfo *thread_info)
+{
+    std::string dir = disk_tile_dir (id.file());
+    std::string err;
+    if (dir.empty() ||
+        (! Filesystem::is_directory (dir) &&
+         ! Filesystem::create_directory (dir, err) &&
+         ! Filesystem::is_directory (dir)))  // maybe somebody else made it
+        return;
+    // Write to a uniquely named file, then rename it into place, so that
+    // other processes never see a partially written tile.
+    std::string path = disk_tile_path (id);
+    std::string tmppath = path + "." + Filesystem::unique_path();
+    FILE *fd = Filesystem::fopen (tmppath, "wb");
+    if (! fd)
+        return;
+    DiskTileHeader header;
+    memcpy (header.magic, disk_tile_magic, sizeof(disk_tile_magic));
+    header.size = size;
+    // Follow the pixels with zeroes, so that a mapped tile has the same
+    // pad for SIMD loads as the tiles we allocate.
+    static const char pad[OIIO_SIMD_MAX_SIZE_BYTES] = { 0 };
+    bool ok = fwrite (&header, sizeof(header), 1, fd) == 1 &&
+              fwrite (pixels, 1, size, fd) == size &&
+              fwrite (pad, 1, sizeof(pad), fd) == sizeof(pad);
+    ok &= (fclose (fd) == 0);
+    if (ok && Filesystem::rename (tmppath, path, err))
+        ++thread_info->m_stats.disk_tiles_written;
+    else
+        Filesystem::remove (tmppath, err);
+}
+
+
+
+bool
+ImageCacheImpl::map_disk_tile (const TileID &id, size_t size, void* &mapping,
+                               size_t &mapping_size, const char* &pixels,
+                               ImageCachePerThreadInfo *thread_info)
+{
+    std::string path = disk_tile_path (id);
+    size_t needed = sizeof(DiskTileHeader) + size + OIIO_SIMD_MAX_SIZE_BYTES;
+    if (path.empty() || Filesystem::file_size (path) < needed)
+        return false;   // Not there, or written without the SIMD pad
+    void *m = NULL;
+#ifdef _WIN32
+    HANDLE fh = CreateFileW (Strutil::utf8_to_utf16(path).c_str(),
+                             GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                             NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fh == INVALID_HANDLE_VALUE)
+        return false;
+    HANDLE mh = CreateFileMapping (fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mh) {
+        m = MapViewOfFile (mh, FILE_MAP_READ, 0, 0, needed);
+        CloseHandle (mh);
+    }
+    CloseHandle (fh);
+#else
+    int fd = ::open (path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    m = mmap (NULL, needed, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED)
+        m = NULL;
+    ::close (fd);
+#endif
+    if (! m)
+        return false;
+    const DiskTileHeader *header = (const DiskTileHeader *) m;
+    if (memcmp (header->magic, disk_tile_magic, sizeof(disk_tile_magic)) ||
+        header->size != size) {
+        unmap_disk_tile (m, needed);
+        return false;
+    }
+    mapping = m;
+    mapping_size = needed;
+    pixels = (const char *)m + sizeof(DiskTileHeader);
+    m_mem_mapped += needed;
+    ++thread_info->m_stats.disk_tile_hits;
+    ++thread_info->m_stats.disk_tiles_mapped;
+    return true;
+}
+
+
+
+void
+ImageCacheImpl::unmap_disk_tile (void *mapping, size_t mapping_size)
+{
+#ifdef _WIN32
+    UnmapViewOfFile (mapping);
+#else
+    munmap (mapping, mapping_size);
+#endif
+    m_mem_mapped -= mapping_size;
+}
+
+
+
+void
+ImageCacheImpl::invalidate_disk_tiles (const ImageCacheFile &file)
+{
+    std::string dir = disk_tile_dir (file);
+    std::string err;
+    if (dir.size() && Filesystem::is_directory (dir))
+        Filesystem::remove_all (dir, err);
+}
+
+
+
 std::string
 ImageCacheImpl::resolve_filename (const std::string &filename) const
 {
@@ -2634,6 +4221,25 @@ ImageCacheImpl::get_image_info (ImageCacheFile *file,
         else
             return false;   // Fail if it's not a constant image
     }
+    if (dataname == s_tile_stats_grid && datatype == TypeDesc(TypeDesc::INT,4)) {
+        const ImageCacheFile::SubimageInfo &si (file->subimageinfo(subimage));
+        if (si.tile_stats.empty())
+            return false;   // Fail if there are no per-tile stats
+        memcpy (data, si.tile_stats_grid, 4*sizeof(int));
+        return true;
+    }
+    if ((dataname == s_tile_average || dataname == s_tile_min ||
+         dataname == s_tile_max) && datatype.basetype == TypeDesc::FLOAT) {
+        // The average, min, and max blocks are each a third of the stats,
+        // and the caller must ask for exactly one block.
+        const ImageCacheFile::SubimageInfo &si (file->subimageinfo(subimage));
+        size_t n = si.tile_stats.size() / 3;
+        if (n == 0 || size_t(datatype.numelements() * datatype.aggregate) != n)
+            return false;
+        int which = (dataname == s_tile_average) ? 0 : (dataname == s_tile_min ? 1 : 2);
+        memcpy (data, &si.tile_stats[which*n], n*sizeof(float));
+        return true;
+    }
 
     // general case -- handle anything else that's able to be found by
     // spec.find_attribute().
@@ -2750,11 +4356,7 @@ ImageCacheImpl::imagespec (ImageCacheFile *file,
 int
 ImageCacheImpl::subimage_from_name (ImageCacheFile *file, ustring subimagename)
 {
-    for (int s = 0, send = file->subimages();  s < send;  ++s) {
-        if (file->subimageinfo(s).subimagename == subimagename)
-            return s;
-    }
-    return -1;  // No matching subimage name
+    return file->subimage_index (subimagename);
 }
 
 
@@ -2849,7 +4451,6 @@ ImageCacheImpl::get_pixels (ImageCacheFile *file,
     if (! thread_info)
         thread_info = get_perthread_info ();
     const ImageSpec &spec (file->spec(subimage, miplevel));
-    bool ok = true;
 
     // Compute channels and stride if not given (assume all channels,
     // contiguous data layout for strides).
@@ -2863,10 +4464,75 @@ ImageCacheImpl::get_pixels (ImageCacheFile *file,
         cache_chbegin = 0;
         cache_chend = spec.nchannels;
     }
-    int cache_nchans = cache_chend - cache_chbegin;
     ImageSpec::auto_stride (xstride, ystride, zstride, format, result_nchans,
                             xend-xbegin, yend-ybegin);
 
+    // For a region spanning several rows of tiles, hand out bands of
+    // whole tile rows to the thread pool, each gathering (and missing,
+    // and converting) its own tiles with its own per-thread info.
+    int nthreads = m_gather_threads;
+    if (nthreads != 1 && yend - ybegin > spec.tile_height) {
+        int ty0 = ybegin - ((ybegin - spec.y) % spec.tile_height);
+        if (ty0 > ybegin)
+            ty0 -= spec.tile_height;   // ybegin above the data window
+        int nbands = (yend - ty0 + spec.tile_height - 1) / spec.tile_height;
+        if (nthreads <= 0)
+            nthreads = default_thread_pool()->size() + 1;
+        nthreads = std::min (nthreads, nbands);
+        if (nthreads > 1) {
+            atomic_int nfailed (0);
+            spin_mutex err_mutex;
+            std::string errors;
+            parallel_for_chunked (0, nbands, (nbands+nthreads-1)/nthreads,
+                                  [&](int64_t b, int64_t e) {
+                int y0 = std::max (ybegin, ty0 + int(b) * spec.tile_height);
+                int y1 = std::min (yend, ty0 + int(e) * spec.tile_height);
+                if (! get_pixels_rows (file, get_perthread_info(),
+                                       subimage, miplevel, xbegin, xend,
+                                       y0, y1, zbegin, zend, chbegin, chend,
+                                       format, (char *)result + (y0-ybegin)*ystride,
+                                       xstride, ystride, zstride,
+                                       cache_chbegin, cache_chend)) {
+                    ++nfailed;
+                    // Errors are per-thread; carry them back to the caller.
+                    std::string err = geterror ();
+                    spin_lock lock (err_mutex);
+                    if (err.size() && errors.size())
+                        errors += '\n';
+                    errors += err;
+                }
+            });
+            if (errors.size())
+                error ("%s", errors);
+            return nfailed == 0;
+        }
+    }
+
+    return get_pixels_rows (file, thread_info, subimage, miplevel,
+                            xbegin, xend, ybegin, yend, zbegin, zend,
+                            chbegin, chend, format, result,
+                            xstride, ystride, zstride,
+                            cache_chbegin, cache_chend);
+}
+
+
+
+bool
+ImageCacheImpl::get_pixels_rows (ImageCacheFile *file,
+                                 ImageCachePerThreadInfo *thread_info,
+                                 int subimage, int miplevel,
+                                 int xbegin, int xend, int ybegin, int yend,
+                                 int zbegin, int zend, int chbegin, int chend,
+                                 TypeDesc format, void *result,
+                                 stride_t xstride, stride_t ystride,
+                                 stride_t zstride,
+                                 int cache_chbegin, int cache_chend)
+{
+    const ImageSpec &spec (file->spec(subimage, miplevel));
+    bool ok = true;
+    int result_nchans = chend - chbegin;
+    int cache_nchans = cache_chend - cache_chbegin;
+
     // result_pixelsize, scanlinesize, and zplanesize assume contiguous
     // layout.  This may or may not be the same as the strides passed by
     // the caller.
@@ -3114,6 +4780,351 @@ ImageCacheImpl::add_tile (ustring filename, int subimage, int miplevel,
 
 
 
+bool
+ImageCacheImpl::prefetch_tiles (ustring filename, int subimage, int miplevel,
+                                ROI roi)
+{
+    ImageCachePerThreadInfo *thread_info = get_perthread_info ();
+    ImageCacheFile *file = find_file (filename, thread_info);
+    if (! file) {
+        error ("Image file \"%s\" not found", filename);
+        return false;
+    }
+    return prefetch_tiles (file, thread_info, subimage, miplevel, roi);
+}
+
+
+
+template<class FUNC>
+bool
+ImageCacheImpl::foreach_tile_in_roi (const char *caller, ImageCacheFile *file,
+                                     int subimage, int miplevel, ROI roi,
+                                     FUNC func)
+{
+    if (! file || file->broken() || file->is_udim())
+        return false;
+    if (subimage < 0 || subimage >= file->subimages() ||
+        miplevel < 0 || miplevel >= file->miplevels(subimage)) {
+        error ("%s asked for nonexistant subimage %d, MIP level %d of \"%s\"",
+               caller, subimage, miplevel, file->filename());
+        return false;
+    }
+    const ImageSpec &spec (file->spec(subimage,miplevel));
+    int chbegin = roi.chbegin, chend = roi.chend;
+    if (chend < chbegin)
+        chend = spec.nchannels;
+    roi = roi_intersection (roi, get_roi(spec));
+    if (roi.npixels() <= 0)
+        return true;   // Nothing to do
+
+    // Snap the region to tile boundaries
+    int xbegin = spec.x + ((roi.xbegin - spec.x) / spec.tile_width) * spec.tile_width;
+    int ybegin = spec.y + ((roi.ybegin - spec.y) / spec.tile_height) * spec.tile_height;
+    int zbegin = spec.z + ((roi.zbegin - spec.z) / spec.tile_depth) * spec.tile_depth;
+    for (int z = zbegin;  z < roi.zend;  z += spec.tile_depth)
+        for (int y = ybegin;  y < roi.yend;  y += spec.tile_height)
+            for (int x = xbegin;  x < roi.xend;  x += spec.tile_width)
+                func (TileID (*file, subimage, miplevel, x, y, z,
+                              chbegin, chend));
+    return true;
+}
+
+
+
+bool
+ImageCacheImpl::prefetch_tiles (ImageHandle *file, Perthread *thread_info,
+                                int subimage, int miplevel, ROI roi)
+{
+    if (! thread_info)
+        thread_info = get_perthread_info ();
+    file = verify_file (file, thread_info);
+    // Find the missing tiles without holding m_prefetch_mutex (the walk
+    // can read headers and does a cache lookup per tile), then take it
+    // just long enough to queue them.
+    std::vector<TileID> missing;
+    bool ok = foreach_tile_in_roi ("prefetch_tiles", file, subimage, miplevel,
+                                   roi, [&](const TileID &id){
+        if (! tile_in_cache (id, thread_info))
+            missing.push_back (id);
+    });
+    if (missing.empty())
+        return ok;
+    spin_lock lock (m_prefetch_mutex);
+    if (! m_prefetch_pool)
+        m_prefetch_pool.reset (new thread_pool (m_prefetch_threads));
+    for (const TileID &id : missing)
+        m_prefetch_pool->push ([this,id](int){
+            prefetch_one_tile (id);
+        });
+    return ok;
+}
+
+
+
+void
+ImageCacheImpl::prefetch_one_tile (const TileID &id)
+{
+    // Somebody may have needed the tile (or asked to prefetch it again)
+    // since the prefetch was queued.
+    ImageCachePerThreadInfo *thread_info = get_perthread_info ();
+    if (tile_in_cache (id, thread_info))
+        return;
+    // Insert the tile before reading its pixels (as find_tile_main_cache
+    // does when read_before_insert is off), so a lookup that comes along
+    // while we're reading will wait for us rather than read it again.
+    ImageCacheTileRef tile = new ImageCacheTile (id, thread_info, false);
+    ImageCacheTile *ourtile = tile.get();
+    add_tile_to_cache (tile, thread_info);
+    if (tile.get() == ourtile)   // not beaten to it by another thread
+        ++thread_info->m_stats.tiles_prefetched;
+}
+
+
+
+bool
+ImageCacheImpl::pin_tiles (ustring filename, int subimage, int miplevel,
+                           ROI roi)
+{
+    ImageCachePerThreadInfo *thread_info = get_perthread_info ();
+    ImageCacheFile *file = find_file (filename, thread_info);
+    if (! file) {
+        error ("Image file \"%s\" not found", filename);
+        return false;
+    }
+    return pin_tiles (file, thread_info, subimage, miplevel, roi);
+}
+
+
+
+bool
+ImageCacheImpl::pin_tiles (ImageHandle *file, Perthread *thread_info,
+                           int subimage, int miplevel, ROI roi)
+{
+    if (! thread_info)
+        thread_info = get_perthread_info ();
+    file = verify_file (file, thread_info);
+    bool ok = true, full = false;
+    bool found = foreach_tile_in_roi ("pin_tiles", file, subimage, miplevel,
+                                      roi, [&](const TileID &id){
+        if (full)
+            return;
+        if (! find_tile (id, thread_info)) {
+            ok = false;   // find_tile issued the error
+            return;
+        }
+        ImageCacheTileRef tile (thread_info->tile);
+        spin_lock lock (m_pinned_mutex);
+        PinnedTile &pin (m_pinned[id]);
+        if (pin.tile != tile) {
+            // Not pinned yet, or what we pinned has since been replaced
+            // in the cache -- move the pins over to the tile in use now.
+            long long bytes = (long long) tile->memsize();
+            if (pin.tile)
+                bytes -= (long long) pin.tile->memsize();
+            if (m_pinned_bytes + bytes > max_pinned_bytes()) {
+                if (! pin.tile)
+                    m_pinned.erase (id);
+                full = true;
+                return;
+            }
+            if (pin.tile)
+                pin.tile->unpin ();
+            tile->pin ();
+            pin.tile = tile;
+            m_pinned_bytes += bytes;
+        }
+        ++pin.count;
+    });
+    if (full)
+        error ("pin_tiles of \"%s\" would pin more than max_pinned_MB (%d MB)",
+               file->filename(), int(max_pinned_bytes() / (1024*1024)));
+    return found && ok && ! full;
+}
+
+
+
+bool
+ImageCacheImpl::unpin_tiles (ustring filename, int subimage, int miplevel,
+                             ROI roi)
+{
+    ImageCachePerThreadInfo *thread_info = get_perthread_info ();
+    ImageCacheFile *file = find_file (filename, thread_info);
+    if (! file) {
+        error ("Image file \"%s\" not found", filename);
+        return false;
+    }
+    return unpin_tiles (file, thread_info, subimage, miplevel, roi);
+}
+
+
+
+bool
+ImageCacheImpl::unpin_tiles (ImageHandle *file, Perthread *thread_info,
+                             int subimage, int miplevel, ROI roi)
+{
+    if (! thread_info)
+        thread_info = get_perthread_info ();
+    file = verify_file (file, thread_info);
+    return foreach_tile_in_roi ("unpin_tiles", file, subimage, miplevel,
+                                roi, [&](const TileID &id){
+        spin_lock lock (m_pinned_mutex);
+        auto found = m_pinned.find (id);
+        if (found == m_pinned.end())
+            return;
+        PinnedTile &pin (found->second);
+        if (--pin.count == 0) {
+            pin.tile->unpin ();
+            m_pinned_bytes -= (long long) pin.tile->memsize();
+            m_pinned.erase (found);
+        }
+    });
+}
+
+
+
+static const char manifest_magic[] = "# OpenImageIO ImageCache manifest 1";
+
+
+
+bool
+ImageCacheImpl::save_manifest (string_view filename)
+{
+    // Record the TileIDs of all resident tiles, grouped by file.  As in
+    // invalidate(), we hold no locks while walking the tile cache.
+    std::unordered_map<const ImageCacheFile *, std::vector<TileID> > tiles;
+    for (TileCache::iterator t = m_tilecache.begin(), e = m_tilecache.end();
+         t != e;  ++t) {
+        const TileID &id (t->second->id());
+        tiles[&id.file()].push_back (id);
+    }
+
+    // Files are listed hottest first (by tile reads over the session, the
+    // sum of the mipreadcount), so a warm start prefetches them first.
+    // Files with no resident tiles are still listed, which at least gets
+    // them opened ahead of time.
+    std::vector<std::pair<size_t,const ImageCacheFile *> > files;
+    for (FilenameMap::iterator f = m_files.begin(); f != m_files.end(); ++f) {
+        const ImageCacheFile *file = f->second.get();
+        if (file->broken() || file->is_udim())
+            continue;
+        size_t reads = 0;
+        for (size_t r : file->mipreadcount())
+            reads += r;
+        if (reads || tiles.count (file))
+            files.emplace_back (reads, file);
+    }
+    std::stable_sort (files.begin(), files.end(),
+                      [](const std::pair<size_t,const ImageCacheFile *> &a,
+                         const std::pair<size_t,const ImageCacheFile *> &b) {
+                          return a.first > b.first;
+                      });
+
+    OIIO::ofstream out;
+    Filesystem::open (out, filename);
+    if (! out) {
+        error ("Could not open manifest \"%s\" for writing", filename);
+        return false;
+    }
+    out << manifest_magic << "\n";
+    for (auto &f : files) {
+        out << "file " << f.first << " " << f.second->filename() << "\n";
+        for (const TileID &id : tiles[f.second])
+            out << Strutil::format ("tile %d %d %d %d %d %d %d\n",
+                                    id.subimage(), id.miplevel(),
+                                    id.x(), id.y(), id.z(),
+                                    id.chbegin(), id.chend());
+    }
+    out.close ();
+    if (! out) {
+        error ("Could not write manifest \"%s\"", filename);
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+ImageCacheImpl::load_manifest (string_view filename)
+{
+    std::string text;
+    if (! Filesystem::read_text_file (filename, text)) {
+        error ("Could not read manifest \"%s\"", filename);
+        return false;
+    }
+    std::vector<string_view> lines;
+    Strutil::split (text, lines, "\n");
+    if (lines.empty() || Strutil::strip(lines[0]) != manifest_magic) {
+        error ("\"%s\" is not an ImageCache manifest", filename);
+        return false;
+    }
+
+    // Parse it all up front, then queue one task per file on the
+    // prefetch pool: open the file, then read any of its listed tiles
+    // that still make sense for it and aren't already in cache.
+    struct FileTiles {
+        ustring name;
+        std::vector<std::array<int,7> > tiles;
+    };
+    std::vector<FileTiles> files;
+    for (size_t i = 1; i < lines.size(); ++i) {
+        string_view line = Strutil::strip (lines[i]);
+        if (Strutil::parse_prefix (line, "file ")) {
+            int reads = 0;
+            Strutil::parse_int (line, reads);
+            Strutil::skip_whitespace (line);
+            if (line.size()) {
+                files.emplace_back ();
+                files.back().name = ustring (line);
+            }
+        } else if (Strutil::parse_prefix (line, "tile ") && files.size()) {
+            std::array<int,7> t;
+            bool ok = true;
+            for (int &v : t)
+                ok &= Strutil::parse_int (line, v);
+            if (ok)
+                files.back().tiles.push_back (t);
+        }
+    }
+
+    spin_lock lock (m_prefetch_mutex);
+    if (! m_prefetch_pool)
+        m_prefetch_pool.reset (new thread_pool (m_prefetch_threads));
+    for (FileTiles &f : files) {
+        std::shared_ptr<FileTiles> ft (new FileTiles (std::move (f)));
+        m_prefetch_pool->push ([this,ft](int){
+            ImageCachePerThreadInfo *thread_info = get_perthread_info ();
+            ImageCacheFile *file = find_file (ft->name, thread_info);
+            file = file ? verify_file (file, thread_info) : NULL;
+            if (! file || file->broken() || file->is_udim())
+                return;
+            for (auto &t : ft->tiles) {
+                int subimage = t[0], miplevel = t[1];
+                if (subimage < 0 || subimage >= file->subimages() ||
+                    miplevel < 0 || miplevel >= file->miplevels(subimage))
+                    continue;
+                // The file may have changed since the manifest was
+                // written; only take tiles that are still its tiles.
+                const ImageSpec &spec (file->spec(subimage, miplevel));
+                int x = t[2], y = t[3], z = t[4], chbegin = t[5], chend = t[6];
+                if (x < spec.x || x >= spec.x+spec.width ||
+                    y < spec.y || y >= spec.y+spec.height ||
+                    z < spec.z || z >= spec.z+std::max(spec.depth,1) ||
+                    (x - spec.x) % spec.tile_width ||
+                    (y - spec.y) % spec.tile_height ||
+                    (z - spec.z) % spec.tile_depth ||
+                    chbegin < 0 || chend > spec.nchannels || chend <= chbegin)
+                    continue;
+                prefetch_one_tile (TileID (*file, subimage, miplevel,
+                                           x, y, z, chbegin, chend));
+            }
+        });
+    }
+    return true;
+}
+
+
+
 void
 ImageCacheImpl::invalidate (ustring filename)
 {
@@ -3126,23 +5137,22 @@ ImageCacheImpl::invalidate (ustring filename)
             return;  // no such file
     }
 
-    // Iterate over the entire tilecache, record the TileID's of all
-    // tiles that are from the file we are invalidating.
-    std::vector<TileID> tiles_to_delete;
-    for (TileCache::iterator tci = m_tilecache.begin(), e = m_tilecache.end();
-             tci != e;  ++tci) {
-        if (&(*tci).second->file() == file)
-            tiles_to_delete.push_back ((*tci).second->id());
-    }
-    // N.B. at this point, we hold no locks!
-
-    // Safely erase all the tiles we found
-    for (const TileID &id : tiles_to_delete)
-        m_tilecache.erase (id);
+    // Drop its tiles in the shared tile_cache_dir (which other processes
+    // would otherwise keep using if the file changed without changing
+    // its modification time).
+    if (disk_tiles_enabled() && ! file->broken())
+        invalidate_disk_tiles (*file);
 
     // Invalidate the file itself (close it and clear its spec)
     file->invalidate ();
 
+    // Rather than find and erase all of its tiles (in the tile cache, the
+    // compressed tier, and every thread's microcache), just advance the
+    // file's generation, which makes all of its existing tiles stale (see
+    // tile_stale).  We do this after closing the file, so that a tile
+    // read from the old file in the meantime is stale, too.
+    file->generation (++m_generation);
+
     // Remove the fingerprint corresponding to this file
     {
         spin_lock lock (m_fingerprints_mutex);
@@ -3150,8 +5160,6 @@ ImageCacheImpl::invalidate (ustring filename)
         if (f != m_fingerprints.end())
             m_fingerprints.erase (f);
     }
-
-    purge_perthread_microcaches ();
 }
 
 
@@ -3162,23 +5170,16 @@ ImageCacheImpl::invalidate_all (bool force)
     // Special case: invalidate EVERYTHING -- we can take some shortcuts
     // to do it all in one shot.
     if (force) {
-        // Clear the whole tile cache
-        std::vector<TileID> tiles_to_delete;
-        for (TileCache::iterator t = m_tilecache.begin(), e = m_tilecache.end();
-             t != e;  ++t) {
-            tiles_to_delete.push_back (t->second->id());
-        }
-        for (const TileID &id : tiles_to_delete)
-            m_tilecache.erase (id);
-        // Invalidate (close and clear spec) all individual files
-        for (FilenameMap::iterator fileit = m_files.begin(), e = m_files.end();
-                 fileit != e;  ++fileit) {
-            fileit->second->invalidate ();
-        }
+        // Advancing the generation of the whole cache makes every tile
+        // stale at once.  Each file notices, the next time it is
+        // verified, that it must be closed and reopened (see
+        // verify_file).
+        m_all_generation = ++m_generation;
+        // The compressed tier is off the lookup path, so just empty it
+        // now rather than let its stale tiles linger until retrieved.
+        m_compressed_tiles.invalidate (NULL);
         // Clear fingerprints list
         clear_fingerprints ();
-        // Mark the per-thread microcaches as invalid
-        purge_perthread_microcaches ();
         return;
     }
 
@@ -3206,6 +5207,10 @@ ImageCacheImpl::invalidate_all (bool force)
             continue;
         }
         for (int s = 0;  s < f->subimages();  ++s) {
+            // Subimages not read yet will see the current settings
+            // whenever they are read.
+            if (! f->subimage_initialized(s))
+                continue;
             const ImageCacheFile::SubimageInfo &sub (f->subimageinfo(s));
             // Invalidate if any unmipped subimage didn't automip but
             // automip is now on, or did automip but automip is now off.
@@ -3235,9 +5240,6 @@ ImageCacheImpl::invalidate_all (bool force)
         // fprintf (stderr, "Invalidating %s\n", f.c_str());
         invalidate (f);
     }
-
-    // Mark the per-thread microcaches as invalid
-    purge_perthread_microcaches ();
 }
 
 
@@ -3259,6 +5261,47 @@ ImageCacheImpl::resolve_udim (ImageCacheFile *udimfile, float &s, float &t)
     s = s - utile;
     t = t - vtile;
 
+    // Here's the one spot where we do string manipulation -- only the
+    // first time a particular tiled region is needed. Just go ahead and
+    // do all possible substitutions we support!  find_file doesn't open
+    // the file, so each concrete file is only opened when a lookup
+    // actually lands in it.
+    auto concrete_file = [&]() -> ImageCacheFile* {
+        ustring realname = udimfile->filename();
+        int udim_tile = 1001 + utile + 10*vtile;
+        realname = Strutil::replace (realname, "<UDIM>",
+                                     Strutil::format("%04d", udim_tile), true);
+        realname = Strutil::replace (realname, "<u>",
+                                     Strutil::format("u%d", utile), true);
+        realname = Strutil::replace (realname, "<v>",
+                                     Strutil::format("v%d", vtile), true);
+        realname = Strutil::replace (realname, "<U>",
+                                     Strutil::format("u%d", utile+1), true);
+        realname = Strutil::replace (realname, "<V>",
+                                     Strutil::format("v%d", vtile+1), true);
+        return find_file (realname, get_perthread_info());
+    };
+
+    // Common case: a tile in the 1001-1999 range, which we can find in the
+    // direct table without any locking.
+    if (utile < ImageCacheFile::UdimDirectU &&
+        vtile < ImageCacheFile::UdimDirectV && udimfile->m_udim_direct) {
+        std::atomic<ImageCacheFile*> &entry
+            (udimfile->m_udim_direct[vtile*ImageCacheFile::UdimDirectU + utile]);
+        ImageCacheFile *realfile = entry.load (std::memory_order_acquire);
+        if (! realfile) {
+            // First lookup in this tile.  If another thread is racing us,
+            // find_file will have handed us both the same file anyway,
+            // but keep whichever got there first.
+            ImageCacheFile *expected = NULL;
+            realfile = concrete_file ();
+            if (! entry.compare_exchange_strong (expected, realfile,
+                                                 std::memory_order_acq_rel))
+                realfile = expected;
+        }
+        return realfile;
+    }
+
     // Synthesized a single combined ID that we'll use as an index.
     uint64_t id = (uint64_t(vtile) << 32) + uint64_t(utile);
 
@@ -3276,22 +5319,7 @@ ImageCacheImpl::resolve_udim (ImageCacheFile *udimfile, float &s, float &t)
     // If that didn't work, get a write lock and we'll make the entry for
     // the first time.
     if (! realfile) {
-        // Here's the one spot where we do string manipulation -- only the
-        // first time a particular tiled region is needed. Just go ahead and
-        // do all possible substitutions we support!
-        ustring realname = udimfile->filename();
-        int udim_tile = 1001 + utile + 10*vtile;
-        realname = Strutil::replace (realname, "<UDIM>",
-                                     Strutil::format("%04d", udim_tile), true);
-        realname = Strutil::replace (realname, "<u>",
-                                     Strutil::format("u%d", utile), true);
-        realname = Strutil::replace (realname, "<v>",
-                                     Strutil::format("v%d", vtile), true);
-        realname = Strutil::replace (realname, "<U>",
-                                     Strutil::format("u%d", utile+1), true);
-        realname = Strutil::replace (realname, "<V>",
-                                     Strutil::format("v%d", vtile+1), true);
-        realfile = find_file (realname, get_perthread_info());
+        realfile = concrete_file ();
         // Now grab the actual write lock, and double check that it hasn't
         // been added by another thread during the brief time when we
         // weren't holding any lock.
@@ -3313,6 +5341,7 @@ ImageCachePerThreadInfo *
 ImageCacheImpl::create_thread_info ()
 {
     ImageCachePerThreadInfo *p = new ImageCachePerThreadInfo;
+    p->tiletable_size (m_microcache_size);
     // printf ("New perthread %p\n", (void *)p);
     spin_lock lock (m_perthread_info_mutex);
     m_all_perthread_info.push_back (p);
@@ -3346,6 +5375,7 @@ ImageCacheImpl::get_perthread_info (ImageCachePerThreadInfo *p)
         p = m_perthread_info.get();
     if (! p) {
         p = new ImageCachePerThreadInfo;
+        p->tiletable_size (m_microcache_size);
         m_perthread_info.reset (p);
         // printf ("New perthread %p\n", (void *)p);
         spin_lock lock (m_perthread_info_mutex);
@@ -3355,8 +5385,9 @@ ImageCacheImpl::get_perthread_info (ImageCachePerThreadInfo *p)
     if (p->purge) {  // has somebody requested a tile purge?
         // This is safe, because it's our thread.
         spin_lock lock (m_perthread_info_mutex);
-        p->tile = NULL;
-        p->lasttile = NULL;
+        p->purge_tiles ();
+        if (p->tiletable.size() != size_t(m_microcache_size))
+            p->tiletable_size (m_microcache_size);
         p->purge = 0;
         for (int i = 0;  i < ImageCachePerThreadInfo::nlastfile;  ++i) {
             p->last_filename[i] = ustring();
@@ -3376,8 +5407,7 @@ ImageCacheImpl::erase_perthread_info ()
         ImageCachePerThreadInfo *p = m_all_perthread_info[i];
         if (p) {
             // Clear the microcache.
-            p->tile = NULL;
-            p->lasttile = NULL;
+            p->purge_tiles ();
             if (p->shared) {
                 // Pointed to by both thread-specific-ptr and our list.
                 // Just remove from out list, then ownership is only
@@ -3400,8 +5430,7 @@ ImageCacheImpl::cleanup_perthread_info (ImageCachePerThreadInfo *p)
     spin_lock lock (m_perthread_info_mutex);
     if (p) {
         // Clear the microcache.
-        p->tile = NULL;
-        p->lasttile = NULL;
+        p->purge_tiles ();
         if (! p->shared)  // If we own it, delete it
             delete p;
         else
@@ -40,6 +40,12 @@
 #include <boost/thread/tss.hpp>
 #include <boost/container/flat_map.hpp>
 
+#include <cmath>
+#include <deque>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
 #include <OpenEXR/half.h>
 
 #include "OpenImageIO/export.h"
@@ -47,6 +53,7 @@
 #include "OpenImageIO/refcnt.h"
 #include "OpenImageIO/hash.h"
 #include "OpenImageIO/imagebuf.h"
+#include "OpenImageIO/trace.h"
 #include "OpenImageIO/unordered_map_concurrent.h"
 
 
@@ -66,7 +73,7 @@ namespace pvt {
 
 // Should we compute and store shadow matrices? Not if we don't support
 // shadow maps!
-#define USE_SHADOW_MATRICES 0
+#define USE_SHADOW_MATRICES 1
 
 
 using boost::thread_specific_ptr;
@@ -85,6 +92,33 @@ typedef unordered_map<uint64_t,ImageCacheFile*> UdimLookupMap;
 
 
 
+/// Counts of latencies in power-of-two buckets: bucket 0 holds times
+/// under 1 microsecond, bucket i holds [2^(i-1), 2^i) microseconds, and
+/// the last bucket holds everything from about 1 second up.
+struct LatencyHistogram {
+    enum { nbuckets = 22 };
+    long long count[nbuckets];
+
+    LatencyHistogram () { init (); }
+    void init () {
+        for (int i = 0; i < nbuckets; ++i)
+            count[i] = 0;
+    }
+    void add (double seconds) {
+        double us = seconds * 1.0e6;
+        int e = 0;
+        if (us >= 1.0)
+            std::frexp (us, &e);   // 2^(e-1) <= us < 2^e
+        ++count[std::min (e, int(nbuckets)-1)];
+    }
+    void merge (const LatencyHistogram &h) {
+        for (int i = 0; i < nbuckets; ++i)
+            count[i] += h.count[i];
+    }
+};
+
+
+
 /// Structure to hold IC and TS statistics.  We combine into a single
 /// structure to minimize the number of costly thread_specific_ptr
 /// retrievals.  If somebody is using the ImageCache without a
@@ -94,6 +128,7 @@ struct ImageCacheStatistics {
     // First, the ImageCache-specific fields:
     long long find_tile_calls;
     long long find_tile_microcache_misses;
+    long long find_tile_tiletable_hits;
     int find_tile_cache_misses;
     long long files_totalsize;
     long long files_totalsize_ondisk;
@@ -113,6 +148,19 @@ struct ImageCacheStatistics {
     double tile_locking_time;
     double find_file_time;
     double find_tile_time;
+    long long tiles_evicted_clock;
+    long long tiles_evicted_gclock;
+    long long tiles_prefetched;
+    long long tiles_constant;
+    long long tiles_constant_bytes;
+    long long compressed_tile_hits;
+    long long compressed_tile_misses;
+    long long disk_tile_hits;
+    long long disk_tile_misses;
+    long long disk_tiles_written;
+    long long disk_tiles_mapped;
+    LatencyHistogram tile_read_latency;   // ImageCacheFile::read_tile
+    LatencyHistogram file_open_latency;   // ImageCacheFile::open
 
     // TextureSystem-specific fields below:
     long long texture_queries;
@@ -160,7 +208,7 @@ public:
     bool broken () const { return m_broken; }
     int subimages () const { return (int)m_subimages.size(); }
     int miplevels (int subimage) const {
-        return (int)m_subimages[subimage].levels.size();
+        return (int)subimageinfo(subimage).levels.size();
     }
     const ImageSpec & spec (int subimage, int miplevel) const {
         return levelinfo(subimage,miplevel).spec;
@@ -177,7 +225,7 @@ public:
     TextureOpt::Wrap swrap () const { return m_swrap; }
     TextureOpt::Wrap twrap () const { return m_twrap; }
     TextureOpt::Wrap rwrap () const { return m_rwrap; }
-    TypeDesc datatype (int subimage) const { return m_subimages[subimage].datatype; }
+    TypeDesc datatype (int subimage) const { return subimageinfo(subimage).datatype; }
     ImageCacheImpl &imagecache () const { return m_imagecache; }
     ImageInput *imageinput () const { return m_input.get(); }
     ImageInput::Creator creator () const { return m_inputcreator; }
@@ -188,6 +236,22 @@ public:
                     int subimage, int miplevel, int x, int y, int z,
                     int chbegin, int chend, TypeDesc format, void *data);
 
+    /// If the reader can tell, without reading, that the tile is all one
+    /// value (an empty block of a sparse Field3D volume), return a buffer
+    /// of size bytes holding that tile in the cache's data format.  All
+    /// such tiles with the same value share the one buffer.  Otherwise
+    /// return an empty pointer and the tile must be read as usual.
+    std::shared_ptr<const char> constant_tile (int subimage, int miplevel,
+                                   int x, int y, int z,
+                                   int chbegin, int chend, size_t size);
+
+    /// Return the buffer (of size bytes, tile filled with the given
+    /// pixel value in the cache's data format) shared by all constant
+    /// tiles of this file with that value, creating it if need be.
+    std::shared_ptr<const char> shared_constant_tile (int subimage,
+                                   int miplevel, int chbegin, int chend,
+                                   const char *pixel, size_t size);
+
     /// Mark the file as recently used.
     ///
     void use (void) { m_used = true; }
@@ -197,10 +261,10 @@ public:
     /// file and return true.
     void release (void);
 
-    size_t channelsize (int subimage) const { return m_subimages[subimage].channelsize; }
-    size_t pixelsize (int subimage) const { return m_subimages[subimage].pixelsize; }
+    size_t channelsize (int subimage) const { return subimageinfo(subimage).channelsize; }
+    size_t pixelsize (int subimage) const { return subimageinfo(subimage).pixelsize; }
     TypeDesc::BASETYPE pixeltype (int subimage) const {
-        return (TypeDesc::BASETYPE) m_subimages[subimage].datatype.basetype;
+        return (TypeDesc::BASETYPE) subimageinfo(subimage).datatype.basetype;
     }
     bool mipused (void) const { return m_mipused; }
     bool sample_border (void) const { return m_sample_border; }
@@ -209,11 +273,18 @@ public:
 
     void invalidate ();
 
+    /// The cache generation as of which this file was last invalidated
+    /// (or created).  Its tiles from earlier generations are stale.
+    int generation () const { return m_generation; }
+    void generation (int g) { m_generation = g; }
+
     size_t timesopened () const { return m_timesopened; }
     size_t tilesread () const { return m_tilesread; }
     imagesize_t bytesread () const { return m_bytesread; }
     double & iotime () { return m_iotime; }
     size_t redundant_tiles () const { return (size_t) m_redundant_tiles.load(); }
+    long long tilehits () const { return m_tilehits.load(); }
+    void register_tile_hit () { m_tilehits += 1; }
     imagesize_t redundant_bytesread () const { return (imagesize_t) m_redundant_bytesread.load(); }
     void register_redundant_tile (imagesize_t bytesread) {
         m_redundant_tiles += 1;
@@ -260,20 +331,43 @@ public:
         bool has_average_color;         ///< We have an average color
         std::vector<float> average_color; ///< Average color
         spin_mutex average_color_mutex; ///< protect average_color
+        int tile_stats_grid[4];         ///< Cell w, h, cells across, down
+        std::vector<float> tile_stats;  ///< Per-cell avg, then min, then max
+        // Importance sampling tables for latlong environment maps, built
+        // on first request by TextureSystem::environment_cdf().
+        int env_cdf_width, env_cdf_height; ///< Resolution of the tables
+        std::vector<float> env_marginal;   ///< height+1 row CDF
+        std::vector<float> env_conditional;///< height*(width+1) column CDFs
+        spin_mutex env_cdf_mutex;       ///< protect the env tables
 
         // The scale/offset accounts for crops or overscans, converting
         // 0-1 texture space relative to the "display/full window" into 
         // 0-1 relative to the "pixel window".
         float sscale, soffset, tscale, toffset;
         ustring subimagename;
+        // Set (release) only once the levels are complete, so a reader
+        // that sees it (acquire) without the lock sees finished data.
+        // Copyable because SubimageInfo lives in a std::vector; copies
+        // only happen while open() fills in the file, before any reader.
+        struct CopyableAtomicBool : public std::atomic<bool> {
+            CopyableAtomicBool (bool v=false) : std::atomic<bool>(v) { }
+            CopyableAtomicBool (const CopyableAtomicBool &a)
+                : std::atomic<bool>(a.load(std::memory_order_relaxed)) { }
+            CopyableAtomicBool& operator= (const CopyableAtomicBool &a) {
+                store (a.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                return *this;
+            }
+        };
+        CopyableAtomicBool initialized; ///< Levels are read and final
 
         SubimageInfo () : datatype(TypeDesc::UNKNOWN),
                           channelsize(0), pixelsize(0),
                           untiled(false), unmipped(false), volume(false),
                           full_pixel_range(false),
                           is_constant_image(false), has_average_color(false),
-                          sscale(1.0f), soffset(0.0f),
-                          tscale(1.0f), toffset(0.0f) { }
+                          tile_stats_grid(), env_cdf_width(0),
+                          env_cdf_height(0), sscale(1.0f), soffset(0.0f),
+                          tscale(1.0f), toffset(0.0f), initialized(false) { }
         void init (const ImageSpec &spec, bool forcefloat);
         ImageSpec &spec (int m) { return levels[m].spec; }
         const ImageSpec &spec (int m) const { return levels[m].spec; }
@@ -281,21 +375,45 @@ public:
         int miplevels () const { return (int) levels.size(); }
     };
 
+    /// Return the info for the subimage, reading its MIP levels from the
+    /// file first if nobody has needed them yet.
     const SubimageInfo &subimageinfo (int subimage) const {
+        DASSERT ((int)m_subimages.size() > subimage);
+        if (! m_subimages[subimage].initialized.load (std::memory_order_acquire))
+            const_cast<ImageCacheFile *>(this)->init_subimage (subimage);
+        return m_subimages[subimage];
+    }
+    SubimageInfo &subimageinfo (int subimage) {
+        DASSERT ((int)m_subimages.size() > subimage);
+        if (! m_subimages[subimage].initialized.load (std::memory_order_acquire))
+            init_subimage (subimage);
         return m_subimages[subimage];
     }
 
-    SubimageInfo &subimageinfo (int subimage) { return m_subimages[subimage]; }
+    /// Has the subimage been read yet?  For callers (such as statistics)
+    /// that would rather skip a subimage than cause it to be read.
+    bool subimage_initialized (int subimage) const {
+        return m_subimages[subimage].initialized.load (std::memory_order_acquire);
+    }
+
+    /// Return the index of the subimage whose "oiio:subimagename" is
+    /// the given name, or -1 if there is no such subimage.
+    int subimage_index (ustring subimagename) const {
+        if (! m_subimage_index_complete.load (std::memory_order_acquire))
+            return const_cast<ImageCacheFile *>(this)->find_subimage (subimagename);
+        SubimageIndexMap::const_iterator found = m_subimage_index.find (subimagename);
+        return found == m_subimage_index.end() ? -1 : found->second;
+    }
 
     const LevelInfo &levelinfo (int subimage, int miplevel) const {
-        DASSERT ((int)m_subimages.size() > subimage);
-        DASSERT ((int)m_subimages[subimage].levels.size() > miplevel);
-        return m_subimages[subimage].levels[miplevel];
+        const SubimageInfo &si (subimageinfo(subimage));
+        DASSERT ((int)si.levels.size() > miplevel);
+        return si.levels[miplevel];
     }
     LevelInfo &levelinfo (int subimage, int miplevel) {
-        DASSERT ((int)m_subimages.size() > subimage);
-        DASSERT ((int)m_subimages[subimage].levels.size() > miplevel);
-        return m_subimages[subimage].levels[miplevel];
+        SubimageInfo &si (subimageinfo(subimage));
+        DASSERT ((int)si.levels.size() > miplevel);
+        return si.levels[miplevel];
     }
 
     /// Do we currently have a valid spec?
@@ -309,6 +427,8 @@ public:
     void invalidate_spec () {
         m_validspec = false;
         m_subimages.clear ();
+        m_subimages_initialized = 0;
+        m_subimage_index_complete = false;
     }
 
     /// Should we print an error message? Keeps track of whether the
@@ -323,6 +443,15 @@ private:
     bool m_broken;                  ///< has errors; can't be used properly
     std::shared_ptr<ImageInput> m_input; ///< Open ImageInput, NULL if closed
     std::vector<SubimageInfo> m_subimages;  ///< Info on each subimage
+    typedef std::unordered_map<ustring,int,ustringHash> SubimageIndexMap;
+    SubimageIndexMap m_subimage_index; ///< Subimage name -> index
+    // When the reader can count its subimages without visiting them,
+    // open() reads only the first one and the others are read by
+    // init_subimage() when first used (under m_input_mutex).  Until all
+    // are read, name lookups scan under the lock instead of using
+    // m_subimage_index.
+    int m_subimages_initialized;    ///< How many subimages have been read
+    std::atomic<bool> m_subimage_index_complete; ///< m_subimage_index usable?
     TexFormat m_texformat;          ///< Which texture format
     TextureOpt::Wrap m_swrap;       ///< Default wrap modes
     TextureOpt::Wrap m_twrap;       ///< Default wrap modes
@@ -342,12 +471,14 @@ private:
     imagesize_t m_bytesread;        ///< Bytes read from this file
     atomic_ll m_redundant_tiles;    ///< Redundant tile reads
     atomic_ll m_redundant_bytesread;///< Redundant bytes read
+    atomic_ll m_tilehits;           ///< Main cache hits on its tiles
     size_t m_timesopened;           ///< Separate times we opened this file
     double m_iotime;                ///< I/O time for this file
     bool m_mipused;                 ///< MIP level >0 accessed
     volatile bool m_validspec;      ///< If false, reread spec upon open
     mutable int m_errors_issued;    ///< Errors issued for this file
     std::vector<size_t> m_mipreadcount; ///< Tile reads per mip level
+    atomic_int m_generation;        ///< Generation of last invalidate
     ImageCacheImpl &m_imagecache;   ///< Back pointer for ImageCache
     mutable recursive_mutex m_input_mutex; ///< Mutex protecting the ImageInput
     std::time_t m_mod_time;         ///< Time file was last updated
@@ -359,6 +490,26 @@ private:
     std::unique_ptr<ImageSpec> m_configspec; // Optional configuration hints
     UdimLookupMap m_udim_lookup;    ///< Used for decoding udim tiles
                                     // protected by mutex elsewhere!
+    // Direct, lock-free lookup of the concrete files for the usual UDIM
+    // range 1001-1999 (u < UdimDirectU, v < UdimDirectV), indexed by
+    // v*UdimDirectU+u.  Each entry is set once, the first time that tile
+    // is needed.  Tiles outside the range go through m_udim_lookup.
+    enum { UdimDirectU = 10, UdimDirectV = 100 };
+    std::unique_ptr<std::atomic<ImageCacheFile*>[]> m_udim_direct;
+    // Our place in the ImageCache's LRU list of open files (when
+    // "open_file_lru" is on).  Only changed with m_input_mutex held.
+    bool m_in_lru;                  ///< Are we in the LRU list?
+    std::list<ImageCacheFile*>::iterator m_lru_pos; ///< Where in the list
+    // When the ImageInput supports("concurrent_tiles"), tile reads are
+    // done with read_tiles_concurrent and without holding m_input_mutex,
+    // so threads wanting different tiles of one file don't queue up.
+    // close() waits for any such reads still in flight.
+    bool m_concurrent_tiles;        ///< Use read_tiles_concurrent?
+    atomic_int m_concurrent_reads;  ///< Concurrent reads in progress
+    // Shared pixels of constant tiles, keyed by level, channel range and
+    // value.  Weak, so that a buffer goes away with the last tile using it.
+    spin_mutex m_constant_tiles_mutex;
+    std::unordered_map<std::string, std::weak_ptr<const char> > m_constant_tiles;
 
 
     /// We will need to read pixels from the file, so be sure it's
@@ -380,6 +531,10 @@ private:
     /// Load the requested tile, from a file that's not really tiled.
     /// Preconditions: the ImageInput is already opened, and we already did
     /// a seek_subimage to the right subimage and MIP level.
+    bool read_tiled_batch (ImageCachePerThreadInfo *thread_info,
+                           int subimage, int miplevel, int x, int y, int z,
+                           int chbegin, int chend, int ntiles,
+                           TypeDesc format, void *data);
     bool read_untiled (ImageCachePerThreadInfo *thread_info,
                        int subimage, int miplevel, int x, int y, int z,
                        int chbegin, int chend, TypeDesc format, void *data);
@@ -405,6 +560,23 @@ private:
     // file. But it will require a bigger refactor to fix that.
     void init_from_spec ();
 
+    /// Fill in m_subimages[subimage] -- all its MIP levels -- from
+    /// nativespec, the spec of its level 0 that the ImageInput has
+    /// already seeked to.  Return false (having issued the error) if the
+    /// cache can't use the subimage.
+    bool read_subimage_levels (int subimage, ImageSpec &nativespec);
+
+    /// Read a subimage that open() skipped, the first time it's needed.
+    /// Thread-safe; marks the file broken if it goes wrong.
+    void init_subimage (int subimage);
+
+    /// Subimage name lookup for when not every subimage has been read:
+    /// scan in order, reading subimages as needed, under the lock.
+    int find_subimage (ustring subimagename);
+
+    /// Build m_subimage_index, once every subimage has been read.
+    void index_subimages ();
+
     friend class ImageCacheImpl;
     friend class TextureSystemImpl;
 };
@@ -559,7 +731,7 @@ public:
     void read (ImageCachePerThreadInfo *thread_info);
 
     /// Return pointer to the raw pixel data
-    const void *data (void) const { return &m_pixels[0]; }
+    const void *data (void) const { return m_data; }
 
     /// Return pointer to the pixel data for a particular pixel.  Be
     /// extremely sure the pixel is within this tile!
@@ -567,22 +739,22 @@ public:
 
     /// Return pointer to the floating-point pixel data
     const float *floatdata (void) const {
-        return (const float *) &m_pixels[0];
+        return (const float *) m_data;
     }
 
     /// Return a pointer to the character data
     const unsigned char *bytedata (void) const {
-        return (unsigned char *) &m_pixels[0];
+        return (const unsigned char *) m_data;
     }
 
     /// Return a pointer to unsigned short data
     const unsigned short *ushortdata (void) const {
-        return (unsigned short *) &m_pixels[0];
+        return (const unsigned short *) m_data;
     }
 
     /// Return a pointer to half data
     const half *halfdata (void) const {
-        return (half *) &m_pixels[0];
+        return (const half *) m_data;
     }
 
     /// Return the id for this tile.
@@ -592,33 +764,62 @@ public:
     const ImageCacheFile & file () const { return m_id.file(); }
 
     /// Return the actual allocated memory size for this tile's pixels.
-    ///
+    /// (Zero if the pixels are mapped from a file, or shared with other
+    /// constant tiles.)
     size_t memsize () const {
         return m_pixels_size;
     }
 
+    /// Are the pixels mapped from a file in the tile_cache_dir, rather
+    /// than held in memory we allocated?
+    bool mapped () const { return m_mapped != NULL; }
+
+    /// Is every pixel of the tile the same value?  If so, its pixels
+    /// are shared with all the other tiles of the file with that value.
+    bool constant () const { return m_shared != nullptr; }
+
     /// Return the space that will be needed for this tile's pixels.
     ///
     size_t memsize_needed () const;
 
-    /// Mark the tile as recently used.
-    ///
-    void use () { m_used = 1; }
+    /// Maximum use count kept for frequency-aware eviction.
+    static const int max_use_count = 3;
 
-    /// Mark the tile as not recently used, return its previous value.
-    ///
-    bool release () {
-        if (! pixels_ready() || ! valid())
+    /// Mark the tile as recently used.  We count uses (up to
+    /// max_use_count), so that frequency-aware eviction can tell tiles
+    /// that are used over and over from those touched only once.
+    void use () {
+        int u = m_used.load();
+        if (u < max_use_count)
+            m_used.compare_exchange_strong (u, u+1);
+    }
+
+    /// Mark the tile as less recently used, return true if it had been
+    /// used since the last release (and thus should stay in the cache).
+    /// If by_frequency is false (plain clock), any recent use earns the
+    /// tile one more trip around the clock; if true, each recorded use
+    /// does.  Pinned tiles always stay.
+    bool release (bool by_frequency = false) {
+        if (! pixels_ready() || ! valid() || pinned())
             return true;  // Don't really release invalid or unready tiles
-        // If m_used is 1, set it to zero and return true.  If it was already
-        // zero, it's fine and return false.
-        return atomic_compare_and_exchange ((volatile int *)&m_used, 1, 0);
+        int u = m_used.load();
+        while (u > 0) {
+            if (m_used.compare_exchange_weak (u, by_frequency ? u-1 : 0))
+                return true;
+        }
+        return false;
     }
 
     /// Has this tile been recently used?
     ///
     int used (void) const { return m_used; }
 
+    /// Pin and unpin the tile (see ImageCacheImpl::pin_tiles); eviction
+    /// passes over it while it's pinned.
+    void pin () { m_pins += 1; }
+    void unpin () { m_pins -= 1; }
+    bool pinned () const { return m_pins.load() > 0; }
+
     bool valid (void) const { return m_valid; }
 
     /// Are the pixels ready for use?  If false, they're still being
@@ -632,15 +833,26 @@ public:
     int channelsize () const { return m_channelsize; }
     int pixelsize () const { return m_pixelsize; }
 
+    /// The cache generation when the tile was made (see
+    /// ImageCacheImpl::tile_stale).
+    int generation () const { return m_generation; }
+    void generation (int g) { m_generation = g; }
+
 private:
     TileID m_id;                  ///< ID of this tile
     std::unique_ptr<char[]> m_pixels;  ///< The pixel data
+    std::shared_ptr<const char> m_shared; ///< Pixels shared by constant tiles
     size_t m_pixels_size;         ///< How much m_pixels has allocated
+    const char *m_data;           ///< Pixels (in m_pixels or the mapping)
+    void *m_mapped;               ///< File mapping holding pixels, or NULL
+    size_t m_mapped_size;         ///< Size of the mapping
     int m_channelsize;            ///< How big is each channel (bytes)
     int m_pixelsize;              ///< How big is each pixel (bytes)
     bool m_valid;                 ///< Valid pixels
     volatile bool m_pixels_ready; ///< The pixels have been read from disk
-    atomic_int m_used;            ///< Used recently
+    atomic_int m_used;            ///< Use count (recent uses, if clock)
+    atomic_int m_pins;            ///< Pinned (> 0) against eviction
+    int m_generation;             ///< Cache generation when made
 };
 
 
@@ -656,6 +868,135 @@ typedef intrusive_ptr<ImageCacheTile> ImageCacheTileRef;
 typedef unordered_map_concurrent<TileID, ImageCacheTileRef, TileID::Hasher, std::equal_to<TileID>, 32> TileCache;
 
 
+
+/// Optional lock-free index that sits in front of the main TileCache, so
+/// that tile cache hits don't need to lock a TileCache bin.  It's a
+/// fixed-size, open-addressed table of raw tile pointers, grouped into
+/// cache-line-sized buckets selected by the TileID's hash.  Lookups just
+/// scan one bucket without locking; publish and unpublish use CAS on
+/// individual slots.  If a tile's bucket is full, the tile simply isn't
+/// indexed, and lookups for it fall back to the TileCache.
+///
+/// The index holds no references.  Tiles are only published or
+/// unpublished while their TileCache bin is locked (so the index never
+/// contains a tile that the TileCache does not), and a tile removed from
+/// the index must not be freed until no reader could still be looking at
+/// it -- see ImageCacheImpl::retire_tile().
+class TileLookupIndex {
+public:
+    TileLookupIndex () : m_mask(0) { }
+
+    /// Allocate the index to hold (at least) the given number of
+    /// buckets.  This may only be done once, before any lookups.
+    void init (size_t nbuckets);
+
+    /// Has the index been allocated?
+    bool initialized () const { return m_mask != 0; }
+
+    /// Return the indexed tile with the given id and hash, or NULL if it
+    /// is not in the index.
+    ImageCacheTile *find (const TileID &id, size_t hash) const {
+        const Bucket &b (m_buckets[bucket(hash)]);
+        for (int i = 0;  i < bucket_size;  ++i) {
+            ImageCacheTile *t = b.slot[i].load();
+            if (t && t->id() == id)
+                return t;
+        }
+        return NULL;
+    }
+
+    /// Add the tile to the index, return true if it was added (or was
+    /// already there), false if its bucket was full.
+    bool publish (ImageCacheTile *tile, size_t hash);
+
+    /// Remove the tile from the index, if it's there.
+    void unpublish (ImageCacheTile *tile, size_t hash);
+
+    /// Remove all tiles from the index (but don't deallocate it).
+    void clear ();
+
+private:
+    static const int bucket_size = 8;   // pointers per bucket (64 bytes)
+    struct Bucket {
+        atomic<ImageCacheTile *> slot[bucket_size];
+    };
+    std::unique_ptr<Bucket[]> m_buckets;
+    size_t m_mask;
+
+    size_t bucket (size_t hash) const {
+        return size_t(murmur::fmix (uint64_t(hash))) & m_mask;
+    }
+};
+
+
+/// Second tier of tile storage: tiles evicted from the main TileCache may
+/// be kept here in compressed form, within their own memory budget, so
+/// that a later miss can decompress them rather than go back to the file.
+/// Each stored tile is held by only one of the tiers at a time: retrieve()
+/// removes it from here (it goes back into the TileCache).  When the
+/// budget is exceeded, the tiles that were stored longest ago are dropped.
+/// All methods are thread-safe.
+class CompressedTileStore {
+public:
+    CompressedTileStore () : m_max_memory(0), m_memory(0), m_peak_memory(0),
+                             m_rawmemory(0), m_stored(0), m_next_seq(0) { }
+
+    /// Set the memory budget in bytes (0 disables the tier and empties it).
+    void max_memory (long long bytes);
+    long long max_memory () const { return m_max_memory; }
+    bool enabled () const { return m_max_memory > 0; }
+
+    /// Compress and store the pixels of a tile (whose channels are each
+    /// channelsize bytes), remembering the generation of the tile.
+    void store (const TileID &id, const void *pixels, size_t size,
+                int channelsize, int generation);
+
+    /// If the tile is stored, decompress it into pixels (which must have
+    /// room for the size that was stored), retrieve the generation it was
+    /// stored with, remove it, and return true.
+    bool retrieve (const TileID &id, void *pixels, size_t size,
+                   int &generation);
+
+    /// Throw away all stored tiles of the given file, or of all files if
+    /// file is NULL.
+    void invalidate (const ImageCacheFile *file);
+
+    long long memory () const { return m_memory; }
+    long long peak_memory () const { return m_peak_memory; }
+    long long rawmemory () const { return m_rawmemory; }
+    long long stored () const { return m_stored; }
+    size_t ntiles () const { spin_lock lock (m_mutex); return m_tiles.size(); }
+
+private:
+    struct Entry {
+        std::unique_ptr<char[]> data;   ///< Compressed bytes
+        size_t size;                    ///< Size of compressed data
+        size_t rawsize;                 ///< Size when uncompressed
+        int channelsize;                ///< Bytes per channel (for shuffle)
+        int generation;                 ///< Generation of the tile
+        long long seq;                  ///< When it was stored
+    };
+    typedef std::unordered_map<TileID, Entry, TileID::Hasher> EntryMap;
+
+    mutable spin_mutex m_mutex;         ///< Protect everything below
+    EntryMap m_tiles;                   ///< The stored tiles
+    /// Stored tiles in the order they were stored; entries whose seq no
+    /// longer matches have since been retrieved or replaced.
+    std::deque<std::pair<TileID,long long> > m_order;
+    long long m_max_memory;             ///< Budget (bytes)
+    long long m_memory;                 ///< Compressed bytes held
+    long long m_peak_memory;            ///< Most compressed bytes held
+    long long m_rawmemory;              ///< Uncompressed size of what we hold
+    long long m_stored;                 ///< Total tiles ever stored
+    long long m_next_seq;
+
+    // Drop the oldest tiles until we fit our budget.  Caller holds m_mutex.
+    void enforce_budget ();
+    void erase (EntryMap::iterator e);
+};
+
+
+
 /// A very small amount of per-thread data that saves us from locking
 /// the mutex quite as often.  We store things here used by both
 /// ImageCache and TextureSystem, so they don't each need a costly
@@ -670,23 +1011,44 @@ public:
     int next_last_file;
     // We have a two-tile "microcache", storing the last two tiles needed.
     ImageCacheTileRef tile, lasttile;
+    // Optionally, a bigger direct-mapped table of recent tiles, indexed
+    // by TileID hash, for when neither tile nor lasttile matches.
+    std::vector<ImageCacheTileRef> tiletable;
+    size_t tiletable_mask;
     atomic_int purge;   // If set, tile ptrs need purging!
+    atomic_ll epoch;    // Nonzero while inside a lock-free tile lookup
     ImageCacheStatistics m_stats;
     bool shared;   // Pointed to both by the IC and the thread_specific_ptr
 
     ImageCachePerThreadInfo ()
-        : next_last_file(0), shared(false)
+        : next_last_file(0), tiletable_mask(0), shared(false)
     {
         // std::cout << "Creating PerThreadInfo " << (void*)this << "\n";
         for (int i = 0;  i < nlastfile;  ++i)
             last_file[i] = NULL;
         purge = 0;
+        epoch = 0;
     }
 
     ~ImageCachePerThreadInfo () {
         // std::cout << "Destroying PerThreadInfo " << (void*)this << "\n";
     }
 
+    // Release all the tiles held by our microcaches.
+    void purge_tiles () {
+        tile = NULL;
+        lasttile = NULL;
+        for (auto &t : tiletable)
+            t = NULL;
+    }
+
+    // Resize the tile table to n entries (a power of 2), or none if n==0.
+    void tiletable_size (int n) {
+        tiletable.clear ();
+        tiletable.resize (n);
+        tiletable_mask = n ? n-1 : 0;
+    }
+
     // Add a new filename/fileptr pair to our microcache
     void filename (ustring n, ImageCacheFile *f) {
         last_filename[next_last_file] = n;
@@ -764,12 +1126,41 @@ public:
     const std::string &plugin_searchpath () const { return m_plugin_searchpath; }
     int autotile () const { return m_autotile; }
     bool autoscanline () const { return m_autoscanline; }
+    int gather_threads () const { return m_gather_threads; }
     bool automip () const { return m_automip; }
     bool forcefloat () const { return m_forcefloat; }
     bool accept_untiled () const { return m_accept_untiled; }
     bool accept_unmipped () const { return m_accept_unmipped; }
     bool unassociatedalpha () const { return m_unassociatedalpha; }
     int failure_retries () const { return m_failure_retries; }
+    int max_tile_batch () const { return m_max_tile_batch; }
+
+    /// Is there a "tile_cache_dir" for tiles shared with other processes?
+    bool disk_tiles_enabled () const { return ! m_tile_cache_dir.empty(); }
+
+    /// Try to read the tile's pixels (size bytes) from the tile_cache_dir,
+    /// returning true if it was there.
+    bool read_disk_tile (const TileID &id, void *pixels, size_t size,
+                         ImageCachePerThreadInfo *thread_info);
+
+    /// Should tiles found in the tile_cache_dir be memory-mapped rather
+    /// than read into memory?
+    bool mmap_tiles () const { return m_mmap_tiles; }
+
+    /// Try to memory-map the tile's pixels (size bytes) from the
+    /// tile_cache_dir.  If successful, return true and store the
+    /// mapping and where its pixels start.
+    bool map_disk_tile (const TileID &id, size_t size, void* &mapping,
+                        size_t &mapping_size, const char* &pixels,
+                        ImageCachePerThreadInfo *thread_info);
+
+    /// Release a mapping made by map_disk_tile.
+    void unmap_disk_tile (void *mapping, size_t mapping_size);
+
+    /// Save the tile's pixels (size bytes) in the tile_cache_dir, for
+    /// any process that needs it later.
+    void write_disk_tile (const TileID &id, const void *pixels, size_t size,
+                          ImageCachePerThreadInfo *thread_info);
     bool latlong_y_up_default () const { return m_latlong_y_up_default; }
     void get_commontoworld (Imath::M44f &result) const {
         result = m_Mc2w;
@@ -876,7 +1267,8 @@ public:
     bool tile_in_cache (const TileID &id,
                         ImageCachePerThreadInfo *thread_info) {
         TileCache::iterator found = m_tilecache.find (id);
-        return (found != m_tilecache.end());
+        return (found != m_tilecache.end() &&
+                ! tile_stale ((*found).second.get()));
     }
 
     /// Add the tile to the cache.  This will also enforce cache memory
@@ -884,6 +1276,19 @@ public:
     void add_tile_to_cache (ImageCacheTileRef &tile,
                             ImageCachePerThreadInfo *thread_info);
 
+    /// The current generation.  Each invalidation advances it.
+    int generation () const { return m_generation; }
+
+    /// Is the tile left over from before its file (or the whole cache)
+    /// was invalidated?  Rather than hunting down and erasing all of a
+    /// file's tiles when it is invalidated, we just advance the
+    /// generation; lookups pass over stale tiles and replace them, and
+    /// the eviction sweep frees them first.
+    bool tile_stale (const ImageCacheTile *tile) const {
+        int g = tile->generation();
+        return g < tile->file().generation() || g < m_all_generation;
+    }
+
     /// Find the tile specified by id.  If found, return true and place
     /// the tile ref in thread_info->tile; if not found, return false.
     /// Try to avoid looking to the big cache (and locking) most of the
@@ -894,7 +1299,7 @@ public:
         ++thread_info->m_stats.find_tile_calls;
         ImageCacheTileRef &tile (thread_info->tile);
         if (tile) {
-            if (tile->id() == id) {
+            if (tile->id() == id && ! tile_stale (tile.get())) {
                 tile->use ();
                 return true;    // already have the tile we want
             }
@@ -902,10 +1307,24 @@ public:
             // and last tile.  Then the new one will either match,
             // or we'll fall through and replace tile.
             tile.swap (thread_info->lasttile);
-            if (tile && tile->id() == id) {
+            if (tile && tile->id() == id && ! tile_stale (tile.get())) {
+                tile->use ();
+                return true;
+            }
+        }
+        if (! thread_info->tiletable.empty()) {
+            // Try the bigger table, and remember what we find there.
+            ImageCacheTileRef &entry (thread_info->tiletable[id.hash() & thread_info->tiletable_mask]);
+            if (entry && entry->id() == id && ! tile_stale (entry.get())) {
+                tile = entry;
                 tile->use ();
+                ++thread_info->m_stats.find_tile_tiletable_hits;
                 return true;
             }
+            bool ok = find_tile_main_cache (id, tile, thread_info);
+            if (ok)
+                entry = tile;
+            return ok;
         }
         return find_tile_main_cache (id, tile, thread_info);
         // N.B. find_tile_main_cache marks the tile as used
@@ -927,6 +1346,20 @@ public:
                            TypeDesc format, const void *buffer,
                            stride_t xstride, stride_t ystride,
                            stride_t zstride);
+    virtual bool prefetch_tiles (ustring filename, int subimage,
+                                 int miplevel, ROI roi);
+    virtual bool prefetch_tiles (ImageHandle *file, Perthread *thread_info,
+                                 int subimage, int miplevel, ROI roi);
+    virtual bool pin_tiles (ustring filename, int subimage, int miplevel,
+                            ROI roi);
+    virtual bool pin_tiles (ImageHandle *file, Perthread *thread_info,
+                            int subimage, int miplevel, ROI roi);
+    virtual bool unpin_tiles (ustring filename, int subimage, int miplevel,
+                              ROI roi);
+    virtual bool unpin_tiles (ImageHandle *file, Perthread *thread_info,
+                              int subimage, int miplevel, ROI roi);
+    virtual bool save_manifest (string_view filename);
+    virtual bool load_manifest (string_view filename);
 
     /// Return the numerical subimage index for the given subimage name,
     /// as stored in the "oiio:subimagename" metadata.  Return -1 if no
@@ -935,7 +1368,11 @@ public:
 
     virtual std::string geterror () const;
     virtual std::string getstats (int level=1) const;
+    virtual std::string getstats_json (int level=1) const;
     virtual void reset_stats ();
+
+    /// Append the "imagecache" member of the getstats_json object.
+    void append_stats_json (std::string &out, int level) const;
     virtual void invalidate (ustring filename);
     virtual void invalidate_all (bool force=false);
 
@@ -946,8 +1383,11 @@ public:
     void operator delete (void *todel) { ::delete ((char *)todel); }
 
     /// Called when a new file is opened, so that the system can track
-    /// the number of simultaneously-opened files.
-    void incr_open_files (void) {
+    /// the number of simultaneously-opened files.  Reopen is true if
+    /// the file had been opened before.
+    void incr_open_files (bool reopen = false) {
+        if (reopen)
+            ++m_stat_file_reopens;
         ++m_stat_open_files_created;
         atomic_max (m_stat_open_files_peak, ++m_stat_open_files_current);
     }
@@ -958,6 +1398,22 @@ public:
         --m_stat_open_files_current;
     }
 
+    /// Are open files kept in an LRU list, and closed in the background?
+    bool open_file_lru () const { return m_open_file_lru; }
+
+    /// Move the (open) file to the most recently used end of the LRU
+    /// list, adding it if it isn't there.  Caller holds the file's
+    /// m_input_mutex.
+    void lru_touch (ImageCacheFile *file);
+
+    /// Remove the file from the LRU list, if it's there.  Caller holds
+    /// the file's m_input_mutex.
+    void lru_remove (ImageCacheFile *file);
+
+    /// Close the ImageInput on a background thread, so the calling
+    /// thread doesn't wait for it.
+    void close_async (std::shared_ptr<ImageInput> &input);
+
     /// Called when a new tile is created, to update all the stats.
     ///
     void incr_tiles (size_t size) {
@@ -972,6 +1428,12 @@ public:
         m_mem_used += size;
     }
 
+    /// Called when pixel memory that is not a tile's own is freed.
+    void decr_mem (size_t size) {
+        m_mem_used -= size;
+        DASSERT (m_mem_used >= 0);
+    }
+
     /// Called when a tile is destroyed, to update all the stats.
     ///
     void decr_tiles (size_t size) {
@@ -1013,6 +1475,10 @@ public:
     /// Enforce the max number of open files.
     void check_max_files (ImageCachePerThreadInfo *thread_info);
 
+    /// Enforce the max number of open files by closing the least
+    /// recently used ones (used by check_max_files if open_file_lru).
+    void check_max_files_lru (ImageCachePerThreadInfo *thread_info);
+
     // For virtual UDIM-like files, adjust s and t and return the concrete
     // ImageCacheFile pointer for the tile it's on.
     ImageCacheFile *resolve_udim (ImageCacheFile *file, float &s, float &t);
@@ -1026,9 +1492,70 @@ private:
     bool find_tile_main_cache (const TileID &id, ImageCacheTileRef &tile,
                                ImageCachePerThreadInfo *thread_info);
 
+    /// The serial heart of get_pixels: gather the already-validated
+    /// region (explicit channels and strides) one tile at a time using
+    /// thread_info for the lookups.
+    bool get_pixels_rows (ImageCacheFile *file,
+                          ImageCachePerThreadInfo *thread_info,
+                          int subimage, int miplevel, int xbegin, int xend,
+                          int ybegin, int yend, int zbegin, int zend,
+                          int chbegin, int chend, TypeDesc format, void *result,
+                          stride_t xstride, stride_t ystride, stride_t zstride,
+                          int cache_chbegin, int cache_chend);
+
     /// Enforce the max memory for tile data.
     void check_max_mem (ImageCachePerThreadInfo *thread_info);
 
+    /// Enforce the max memory for tile data using the sharded,
+    /// frequency-aware "gclock" eviction policy.
+    void check_max_mem_sharded (ImageCachePerThreadInfo *thread_info);
+
+    /// Sweep one shard (TileCache bin) for the "gclock" policy, evicting
+    /// tiles until at least 'excess' bytes have been freed or the shard
+    /// has no more tiles to give.  The caller holds the shard's mutex.
+    void sweep_shard (size_t shard, long long excess,
+                      ImageCachePerThreadInfo *thread_info);
+
+    /// Add the tile to the lock-free tile index.  The caller must hold
+    /// the lock on the tile's TileCache bin.
+    void publish_tile (ImageCacheTile *tile) {
+        if (m_lockfree_tiles)
+            m_tileindex.publish (tile, tile->id().hash());
+    }
+
+    /// Remove the tile with the given id from the tile cache (and the
+    /// lock-free index, if it's in use).
+    void erase_tile (const TileID &id);
+
+    /// Hold on to a tile that was removed from the lock-free index until
+    /// no lock-free lookup could still be using it.
+    void retire_tile (const ImageCacheTileRef &tile);
+
+    /// Free any retired tiles that can no longer be seen by lock-free
+    /// lookups in progress.
+    void reclaim_retired_tiles ();
+
+    /// A tile is being evicted from the tile cache; save it in the
+    /// compressed tier, if that's enabled.
+    void save_evicted_tile (const ImageCacheTile *tile);
+
+    /// Try to make the tile from the compressed tier.  Return true and
+    /// store it in tile if successful.
+    bool find_compressed_tile (const TileID &id, ImageCacheTileRef &tile,
+                               ImageCachePerThreadInfo *thread_info);
+
+    /// The directory under tile_cache_dir for all tiles of the file.
+    /// It's named by the file's fingerprint if we are deduplicating,
+    /// otherwise by a hash of its name and modification time, so that
+    /// a changed file will not find stale tiles.
+    std::string disk_tile_dir (const ImageCacheFile &file) const;
+
+    /// The file in tile_cache_dir that holds the tile.
+    std::string disk_tile_path (const TileID &id) const;
+
+    /// Remove the file's tiles from the tile_cache_dir.
+    void invalidate_disk_tiles (const ImageCacheFile &file);
+
     /// Internal statistics printing routine
     ///
     void printstats () const;
@@ -1049,6 +1576,10 @@ private:
     /// Clear all the per-thread microcaches.
     void purge_perthread_microcaches ();
 
+    /// Read the tile into the cache, if it isn't already there.  This is
+    /// the task run by the prefetch threads.
+    void prefetch_one_tile (const TileID &id);
+
     /// Clear the fingerprint list, thread-safe.
     void clear_fingerprints ();
 
@@ -1070,14 +1601,25 @@ private:
     bool m_deduplicate;          ///< Detect duplicate files?
     bool m_unassociatedalpha;    ///< Keep unassociated alpha files as they are?
     int m_failure_retries;       ///< Times to re-try disk failures
+    int m_max_tile_batch;        ///< Max missing tiles to read in one call
+    int m_microcache_size;       ///< Entries in per-thread tile tables
     bool m_latlong_y_up_default; ///< Is +y the default "up" for latlong?
     Imath::M44f m_Mw2c;          ///< world-to-"common" matrix
     Imath::M44f m_Mc2w;          ///< common-to-world matrix
     ustring m_substitute_image;  ///< Substitute this image for all others
+    ustring m_tile_cache_dir;    ///< Dir of tiles shared across processes
+    bool m_mmap_tiles;           ///< Map tiles from m_tile_cache_dir?
+    atomic_ll m_mem_mapped;      ///< Bytes of tiles mapped from files
 
     mutable FilenameMap m_files; ///< Map file names to ImageCacheFile's
     ustring m_file_sweep_name;   ///< Sweeper for "clock" paging algorithm
     spin_mutex m_file_sweep_mutex; ///< Ensure only one in check_max_files
+    bool m_open_file_lru;        ///< Use the LRU below, close in background?
+    std::list<ImageCacheFile*> m_open_lru; ///< Open files, most recent first
+    spin_mutex m_open_lru_mutex; ///< Protect m_open_lru
+    std::unique_ptr<thread_pool> m_close_pool; ///< Closes files for us
+    spin_mutex m_close_mutex;    ///< Protect m_close_pool
+    atomic_int m_stat_file_reopens; ///< Opens of files that had been closed
 
     spin_mutex m_fingerprints_mutex; ///< Protect m_fingerprints
     FingerprintMap m_fingerprints;  ///< Map fingerprints to files
@@ -1086,6 +1628,65 @@ private:
     TileID m_tile_sweep_id;      ///< Sweeper for "clock" paging algorithm
     spin_mutex m_tile_sweep_mutex; ///< Ensure only one in check_max_mem
 
+    /// Tile eviction policies
+    enum EvictionPolicy {
+        EvictClock,     ///< Global clock sweep, one-bit "recently used"
+        EvictGClock     ///< Per-bin clock sweeps, counting uses
+    };
+    atomic_int m_eviction_policy; ///< Which EvictionPolicy to use (set by
+                                  ///< attribute() while others evict)
+    /// Each TileCache bin is an eviction shard for EvictGClock, with its
+    /// own clock hand and mutex.
+    struct TileSweepShard {
+        spin_mutex mutex;        ///< Ensure only one thread sweeps the shard
+        TileID sweep_id;         ///< Where the shard's clock hand is
+    };
+    std::unique_ptr<TileSweepShard[]> m_tile_shards;
+    atomic_int m_tile_shard_next; ///< Next shard to try to evict from
+
+    int m_prefetch_threads;      ///< Number of threads for m_prefetch_pool
+    std::unique_ptr<thread_pool> m_prefetch_pool; ///< Reads prefetched tiles
+    spin_mutex m_prefetch_mutex;  ///< Protect m_prefetch_pool
+
+    /// Each tile pinned by pin_tiles, referenced so that unpin_tiles
+    /// finds the very tile it pinned even if the cache has since
+    /// replaced it (after an invalidate), and with how many pins are
+    /// outstanding.  The tile itself is pinned once, however many.
+    struct PinnedTile {
+        ImageCacheTileRef tile;
+        int count;
+        PinnedTile () : count(0) { }
+    };
+    std::unordered_map<TileID, PinnedTile, TileID::Hasher> m_pinned;
+    spin_mutex m_pinned_mutex;   ///< Protect m_pinned
+    atomic_ll m_pinned_bytes;    ///< Pixel memory of pinned tiles
+    float m_max_pinned_MB;       ///< Limit on m_pinned_bytes, 0 = auto
+    long long max_pinned_bytes () const {
+        return m_max_pinned_MB > 0.0f
+             ? (long long)(m_max_pinned_MB * 1024.0f * 1024.0f)
+             : m_max_memory_bytes / 2;
+    }
+    /// Iterate roi (within the level's data window) over the corners of
+    /// the tiles of the given file, subimage and MIP level that it
+    /// touches, calling func(TileID).  Return false, having issued an
+    /// error naming caller, if the file or level is no good.
+    template<class FUNC>
+    bool foreach_tile_in_roi (const char *caller, ImageCacheFile *file,
+                              int subimage, int miplevel, ROI roi,
+                              FUNC func);
+    int m_gather_threads;        ///< Threads for big get_pixels (0 = all)
+
+    CompressedTileStore m_compressed_tiles; ///< Tier for evicted tiles
+
+    atomic_int m_lockfree_tiles; ///< Use the lock-free tile index?
+    TileLookupIndex m_tileindex; ///< Lock-free index in front of m_tilecache
+    atomic_ll m_tile_epoch;      ///< Advances each time a tile is retired
+    atomic_int m_generation;     ///< Advances with each invalidation
+    atomic_int m_all_generation; ///< Generation of last invalidate_all(force)
+    spin_mutex m_retired_tiles_mutex; ///< Protect m_retired_tiles
+    /// Tiles removed from the index, with the epoch of their removal
+    std::vector<std::pair<long long,ImageCacheTileRef> > m_retired_tiles;
+
     atomic_ll m_mem_used;        ///< Memory being used for tiles
     int m_statslevel;            ///< Statistics level
     int m_max_errors_per_file;   ///< Max errors to print for each file.
@@ -0,0 +1,312 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+#include <cmath>
+#include <vector>
+
+#include <OpenEXR/ImathMatrix.h>
+
+#include "OpenImageIO/dassert.h"
+#include "OpenImageIO/typedesc.h"
+#include "OpenImageIO/varyingref.h"
+#include "OpenImageIO/ustring.h"
+#include "OpenImageIO/fmath.h"
+#include "OpenImageIO/simd.h"
+#include "OpenImageIO/texture.h"
+#include "OpenImageIO/imagecache.h"
+
+#include "imagecache_pvt.h"
+#include "texture_pvt.h"
+
+OIIO_NAMESPACE_BEGIN
+using namespace pvt;
+using namespace simd;
+
+
+namespace {  // anonymous
+
+// Convert the depth stored at offset of a tile of the given pixel type.
+OIIO_FORCEINLINE float
+load_depth (const ImageCacheTile *tile, TypeDesc::BASETYPE pixeltype,
+            int offset)
+{
+    switch (pixeltype) {
+    case TypeDesc::FLOAT  : return tile->floatdata()[offset];
+    case TypeDesc::HALF   : return float (tile->halfdata()[offset]);
+    case TypeDesc::UINT16 : return tile->ushortdata()[offset] * (1.0f/65535.0f);
+    default :
+        DASSERT (pixeltype == TypeDesc::UINT8);
+        return tile->bytedata()[offset] * (1.0f/255.0f);
+    }
+}
+
+};  // end anonymous namespace
+
+
+namespace pvt {   // namespace pvt
+
+
+
+bool
+TextureSystemImpl::shadow (ustring filename, TextureOpt &options,
+                           const Imath::V3f &P, const Imath::V3f &dPdx,
+                           const Imath::V3f &dPdy, float *result,
+                           float *dresultds, float *dresultdt)
+{
+    PerThreadInfo *thread_info = m_imagecache->get_perthread_info ();
+    TextureFile *texturefile = find_texturefile (filename, thread_info);
+    return shadow ((TextureHandle *)texturefile, (Perthread *)thread_info,
+                   options, P, dPdx, dPdy, result, dresultds, dresultdt);
+}
+
+
+
+bool
+TextureSystemImpl::shadow (TextureHandle *texture_handle_,
+                           Perthread *thread_info_, TextureOpt &options,
+                           const Imath::V3f &P, const Imath::V3f &dPdx,
+                           const Imath::V3f &dPdy, float *result,
+                           float *dresultds, float *dresultdt)
+{
+    PerThreadInfo *thread_info = m_imagecache->get_perthread_info((PerThreadInfo *)thread_info_);
+    TextureFile *texturefile = verify_texturefile ((TextureFile *)texture_handle_, thread_info);
+    ImageCacheStatistics &stats (thread_info->m_stats);
+    ++stats.shadow_batches;
+    ++stats.shadow_queries;
+
+    if (! texturefile  ||  texturefile->broken())
+        return missing_texture (options, 1, result, dresultds, dresultdt);
+    return shadow_lookup (*texturefile, thread_info, options, P, dPdx, dPdy,
+                          result, dresultds, dresultdt);
+}
+
+
+
+bool
+TextureSystemImpl::shadow (ustring filename, TextureOptions &options,
+                           Runflag *runflags, int beginactive, int endactive,
+                           VaryingRef<Imath::V3f> P,
+                           VaryingRef<Imath::V3f> dPdx,
+                           VaryingRef<Imath::V3f> dPdy,
+                           float *result, float *dresultds, float *dresultdt)
+{
+    Perthread *thread_info = get_perthread_info();
+    TextureHandle *texture_handle = get_texture_handle (filename, thread_info);
+    return shadow (texture_handle, thread_info, options,
+                   runflags, beginactive, endactive,
+                   P, dPdx, dPdy, result, dresultds, dresultdt);
+}
+
+
+
+bool
+TextureSystemImpl::shadow (TextureHandle *texture_handle_,
+                           Perthread *thread_info_, TextureOptions &options,
+                           Runflag *runflags, int beginactive, int endactive,
+                           VaryingRef<Imath::V3f> P,
+                           VaryingRef<Imath::V3f> dPdx,
+                           VaryingRef<Imath::V3f> dPdy,
+                           float *result, float *dresultds, float *dresultdt)
+{
+    PerThreadInfo *thread_info = m_imagecache->get_perthread_info((PerThreadInfo *)thread_info_);
+    TextureFile *texturefile = verify_texturefile ((TextureFile *)texture_handle_, thread_info);
+    ImageCacheStatistics &stats (thread_info->m_stats);
+    ++stats.shadow_batches;
+
+    bool ok = true;
+    // Visit the points in order of position so neighbors share tiles.
+    std::vector<int> order;
+    spatial_batch_order (runflags, beginactive, endactive, P, false, order);
+    stats.shadow_queries += order.size();
+    for (int i : order) {
+        TextureOpt opt (options, i);
+        float *dsi = dresultds ? dresultds + i : NULL;
+        float *dti = dresultdt ? dresultdt + i : NULL;
+        if (! texturefile  ||  texturefile->broken())
+            ok &= missing_texture (opt, 1, result + i, dsi, dti);
+        else
+            ok &= shadow_lookup (*texturefile, thread_info, opt, P[i],
+                                 dPdx[i], dPdy[i], result + i, dsi, dti);
+    }
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::shadow_lookup (TextureFile &texturefile,
+                                  PerThreadInfo *thread_info,
+                                  TextureOpt &options, const Imath::V3f &P,
+                                  const Imath::V3f &dPdx,
+                                  const Imath::V3f &dPdy, float *result,
+                                  float *dresultds, float *dresultdt)
+{
+    // Shadow lookups are not differentiable.
+    result[0] = 0.0f;
+    if (dresultds)
+        dresultds[0] = 0.0f;
+    if (dresultdt)
+        dresultdt[0] = 0.0f;
+
+    if (texturefile.textureformat() != TexFormatShadow) {
+        error ("\"%s\" is not a shadow map", texturefile.filename());
+        return false;
+    }
+    if (options.subimagename) {
+        // If subimage was specified by name, figure out its index.
+        int si = m_imagecache->subimage_from_name (&texturefile, options.subimagename);
+        if (si < 0) {
+            error ("Unknown subimage \"%s\" in shadow map \"%s\"",
+                   options.subimagename, texturefile.filename());
+            return false;
+        }
+        options.subimage = si;
+        options.subimagename.clear();
+    }
+    if (options.subimage < 0 || options.subimage >= texturefile.subimages()) {
+        error ("Unknown subimage %d in shadow map \"%s\"", options.subimage,
+               texturefile.filename());
+        return false;
+    }
+
+    // Depth of P as seen from the light.  Nothing behind the light can be
+    // in its shadow.
+    Imath::V3f Plight;
+    texturefile.m_Mlocal.multVecMatrix (P, Plight);
+    if (Plight.z <= 0.0f)
+        return true;
+
+    // Project P and its differentials onto the map: screen space [-1,1]
+    // becomes st [0,1], with t running down.
+    Imath::V3f Pscr, Pscr_dx, Pscr_dy;
+    texturefile.m_Mproj.multVecMatrix (P, Pscr);
+    texturefile.m_Mproj.multVecMatrix (P + dPdx, Pscr_dx);
+    texturefile.m_Mproj.multVecMatrix (P + dPdy, Pscr_dy);
+    float s = 0.5f * (Pscr.x + 1.0f);
+    float t = 0.5f * (1.0f - Pscr.y);
+    if (! (s >= 0.0f && s <= 1.0f && t >= 0.0f && t <= 1.0f))
+        return true;   // Outside the map: unoccluded
+    float dsdx = 0.5f * (Pscr_dx.x - Pscr.x), dtdx = 0.5f * (Pscr.y - Pscr_dx.y);
+    float dsdy = 0.5f * (Pscr_dy.x - Pscr.x), dtdy = 0.5f * (Pscr.y - Pscr_dy.y);
+
+    const ImageSpec &spec (texturefile.spec (options.subimage, 0));
+    float sfilt = std::max (fabsf(dsdx), fabsf(dsdy)) * options.swidth + options.sblur;
+    float tfilt = std::max (fabsf(dtdx), fabsf(dtdy)) * options.twidth + options.tblur;
+    result[0] = shadow_pcf (texturefile, thread_info, options,
+                            s * spec.width + spec.x - 0.5f,
+                            t * spec.height + spec.y - 0.5f,
+                            sfilt * spec.width, tfilt * spec.height,
+                            Plight.z - options.bias);
+    return true;
+}
+
+
+
+float
+TextureSystemImpl::shadow_pcf (TextureFile &texturefile,
+                               PerThreadInfo *thread_info,
+                               TextureOpt &options, float sc, float tc,
+                               float swidth, float twidth, float depth)
+{
+    const ImageSpec &spec (texturefile.spec (options.subimage, 0));
+    TypeDesc::BASETYPE pixeltype = texturefile.pixeltype (options.subimage);
+    wrap_impl clamp_func = wrap_functions[(int)TextureOpt::WrapClamp];
+
+    // An n x n kernel of taps: 8x8 for footprints wider than 4 texels or
+    // when more than 16 samples are asked for, else 4x4.  Footprints wider
+    // than the kernel spread the taps apart rather than adding more.
+    const int n = (std::max (swidth, twidth) > 4.0f || options.samples > 16) ? 8 : 4;
+    int sstep = std::max (1, (int) ceilf (swidth / n));
+    int tstep = std::max (1, (int) ceilf (twidth / n));
+    int s0 = ifloor (sc) - (n/2 - 1) * sstep;
+    int t0 = ifloor (tc) - (n/2 - 1) * tstep;
+
+    // Separable tent weights over the kernel, centered on (sc,tc), so the
+    // result varies smoothly as the lookup moves across texels.
+    float sweight[8], tweight[8];
+    float sinvradius = 1.0f / ((n/2) * sstep);
+    float tinvradius = 1.0f / ((n/2) * tstep);
+    for (int i = 0;  i < n;  ++i) {
+        sweight[i] = std::max (0.0f, 1.0f - fabsf (s0 + i*sstep - sc) * sinvradius);
+        tweight[i] = std::max (0.0f, 1.0f - fabsf (t0 + i*tstep - tc) * tinvradius);
+    }
+
+    int tile_chbegin = 0, tile_chend = spec.nchannels;
+    if (spec.nchannels > m_max_tile_channels) {
+        tile_chbegin = options.firstchannel;
+        tile_chend = options.firstchannel+1;
+    }
+    TileID id (texturefile, options.subimage, 0, 0, 0, 0,
+               tile_chbegin, tile_chend);
+    int tilex = -1, tiley = -1;   // origin of the tile we're holding
+    const ImageCacheTile *tile = NULL;
+
+    float4 d (depth);
+    float4 occluded = float4::Zero(), total = float4::Zero();
+    for (int j = 0;  j < n;  ++j) {
+        int ttex = t0 + j*tstep;
+        clamp_func (ttex, spec.y, spec.height);
+        int tile_t = (ttex - spec.y) % spec.tile_height;
+        // Gather the row of depths, then compare them 4 at a time.
+        float rowdepth[8];
+        for (int i = 0;  i < n;  ++i) {
+            int stex = s0 + i*sstep;
+            clamp_func (stex, spec.x, spec.width);
+            int tile_s = (stex - spec.x) % spec.tile_width;
+            if (stex - tile_s != tilex || ttex - tile_t != tiley) {
+                tilex = stex - tile_s;
+                tiley = ttex - tile_t;
+                id.xy (tilex, tiley);
+                if (! find_tile (id, thread_info) || ! thread_info->tile) {
+                    error ("%s", m_imagecache->geterror());
+                    return 0.0f;
+                }
+                tile = thread_info->tile.get();
+            }
+            int offset = id.nchannels() * (tile_t * spec.tile_width + tile_s)
+                           + (options.firstchannel - id.chbegin());
+            rowdepth[i] = load_depth (tile, pixeltype, offset);
+        }
+        float4 tw (tweight[j]);
+        for (int i = 0;  i < n;  i += 4) {
+            float4 w = tw * float4 (sweight + i);
+            occluded += blend0 (w, float4 (rowdepth + i) < d);
+            total += w;
+        }
+    }
+    float wsum = reduce_add (total);
+    return wsum > 0.0f ? reduce_add (occluded) / wsum : 0.0f;
+}
+
+
+}  // end namespace pvt
+
+OIIO_NAMESPACE_END
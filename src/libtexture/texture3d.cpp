@@ -74,6 +74,29 @@ OIIO_FORCEINLINE float half2float (half val) {
 }
 
 
+// Convert the (up to) 4 channels of the texel at p, stored as T, to float.
+template<typename T> OIIO_FORCEINLINE simd::float4 load_texel4 (const unsigned char *p);
+template<> OIIO_FORCEINLINE simd::float4 load_texel4<unsigned char> (const unsigned char *p) {
+    return simd::float4(p) * simd::float4(1.0f/255.0f);
+}
+template<> OIIO_FORCEINLINE simd::float4 load_texel4<unsigned short> (const unsigned char *p) {
+    return simd::float4((const unsigned short *)p) * simd::float4(1.0f/65535.0f);
+}
+template<> OIIO_FORCEINLINE simd::float4 load_texel4<half> (const unsigned char *p) {
+    return simd::float4((const half *)p);
+}
+template<> OIIO_FORCEINLINE simd::float4 load_texel4<float> (const unsigned char *p) {
+    return simd::float4((const float *)p);
+}
+
+// accum[0..n-1] += val[0..n-1].  The result arrays of the volume lookups
+// aren't padded, so we can't just do a float4 store.
+OIIO_FORCEINLINE void store_accum (float *accum, int n, const simd::float4 &val) {
+    for (int c = 0;  c < n;  ++c)
+        accum[c] += val[c];
+}
+
+
 }  // end anonymous namespace
 
 namespace pvt {   // namespace pvt
@@ -111,6 +134,7 @@ TextureSystemImpl::texture3d (TextureHandle *texture_handle_,
                               float *dresultds, float *dresultdt,
                               float *dresultdr)
 {
+    OIIO_TRACE_ZONE ("TextureSystem::texture3d");
     // Handle >4 channel lookups by recursion.
     if (nchannels > 4) {
         int save_firstchannel = options.firstchannel;
@@ -142,6 +166,7 @@ TextureSystemImpl::texture3d (TextureHandle *texture_handle_,
         &TextureSystemImpl::texture3d_lookup_nomip,
         &TextureSystemImpl::texture3d_lookup_trilinear_mipmap,
         &TextureSystemImpl::texture3d_lookup_trilinear_mipmap,
+        &TextureSystemImpl::texture3d_lookup,
         &TextureSystemImpl::texture3d_lookup
     };
     texture3d_lookup_prototype lookup = lookup_functions[(int)options.mipmode];
@@ -264,19 +289,18 @@ TextureSystemImpl::texture3d (TextureHandle *texture_handle,
         dresultds += beginactive*nchannels;
         dresultdt += beginactive*nchannels;
     }
-    for (int i = beginactive;  i < endactive;  ++i) {
-        if (runflags[i]) {
-            TextureOpt opt (options, i);
-            ok &= texture3d (texture_handle, thread_info, opt,
-                             P[i], dPdx[i], dPdy[i], dPdz[i],
-                             4, result, dresultds, dresultdt, dresultdr);
-        }
-        result += nchannels;
-        if (dresultds) {
-            dresultds += nchannels;
-            dresultdt += nchannels;
-            dresultdr += nchannels;
-        }
+    // Visit the points in spatial order so neighbors share tiles.
+    std::vector<int> order;
+    spatial_batch_order (runflags, beginactive, endactive, P, false, order);
+    for (int i : order) {
+        TextureOpt opt (options, i);
+        int offset = (i-beginactive)*nchannels;
+        ok &= texture3d (texture_handle, thread_info, opt,
+                         P[i], dPdx[i], dPdy[i], dPdz[i],
+                         4, result + offset,
+                         dresultds ? dresultds + offset : NULL,
+                         dresultds ? dresultdt + offset : NULL,
+                         dresultds ? dresultdr + offset : NULL);
     }
     return ok;
 }
@@ -576,148 +600,41 @@ TextureSystemImpl::accum3d_sample_bilinear (const Imath::V3f &P, int miplevel,
             }
         }
     }
-    // FIXME -- optimize the above loop by unrolling
-
-    if (pixeltype == TypeDesc::UINT8) {
-        for (int c = 0;  c < actualchannels;  ++c)
-            accum[c] += weight * trilerp (uchar2float(texel[0][0][0][c]), uchar2float(texel[0][0][1][c]),
-                                          uchar2float(texel[0][1][0][c]), uchar2float(texel[0][1][1][c]),
-                                          uchar2float(texel[1][0][0][c]), uchar2float(texel[1][0][1][c]),
-                                          uchar2float(texel[1][1][0][c]), uchar2float(texel[1][1][1][c]),
-                                          sfrac, tfrac, rfrac);
-        if (daccumds) {
-            float scalex = weight * spec.full_width;
-            float scaley = weight * spec.full_height;
-            float scalez = weight * spec.full_depth;
-            for (int c = 0;  c < actualchannels;  ++c) {
-                daccumds[c] += scalex * bilerp(
-                    uchar2float(texel[0][0][1][c]) - uchar2float(texel[0][0][0][c]),
-                    uchar2float(texel[0][1][1][c]) - uchar2float(texel[0][1][0][c]),
-                    uchar2float(texel[1][0][1][c]) - uchar2float(texel[1][0][0][c]),
-                    uchar2float(texel[1][1][1][c]) - uchar2float(texel[1][1][0][c]),
-                    tfrac, rfrac
-                );
-                daccumdt[c] += scaley * bilerp(
-                    uchar2float(texel[0][1][0][c]) - uchar2float(texel[0][0][0][c]),
-                    uchar2float(texel[0][1][1][c]) - uchar2float(texel[0][0][1][c]),
-                    uchar2float(texel[1][1][0][c]) - uchar2float(texel[1][0][0][c]),
-                    uchar2float(texel[1][1][1][c]) - uchar2float(texel[1][0][1][c]),
-                    sfrac, rfrac
-                );
-                daccumdr[c] += scalez * bilerp(
-                    uchar2float(texel[0][1][0][c]) - uchar2float(texel[1][1][0][c]),
-                    uchar2float(texel[0][1][1][c]) - uchar2float(texel[1][1][1][c]),
-                    uchar2float(texel[0][0][1][c]) - uchar2float(texel[1][0][0][c]),
-                    uchar2float(texel[0][1][1][c]) - uchar2float(texel[1][1][1][c]),
-                    sfrac, tfrac
-                );
-            }
-        }
-    } else if (pixeltype == TypeDesc::UINT16) {
-        for (int c = 0;  c < actualchannels;  ++c)
-            accum[c] += weight * trilerp (ushort2float(((const uint16_t *)texel[0][0][0])[c]), ushort2float(((const uint16_t *)texel[0][0][1])[c]),
-                                          ushort2float(((const uint16_t *)texel[0][1][0])[c]), ushort2float(((const uint16_t *)texel[0][1][1])[c]),
-                                          ushort2float(((const uint16_t *)texel[1][0][0])[c]), ushort2float(((const uint16_t *)texel[1][0][1])[c]),
-                                          ushort2float(((const uint16_t *)texel[1][1][0])[c]), ushort2float(((const uint16_t *)texel[1][1][1])[c]),
-                                          sfrac, tfrac, rfrac);
-        if (daccumds) {
-            float scalex = weight * spec.full_width;
-            float scaley = weight * spec.full_height;
-            float scalez = weight * spec.full_depth;
-            for (int c = 0;  c < actualchannels;  ++c) {
-                daccumds[c] += scalex * bilerp(
-                    ushort2float(((const uint16_t *)texel[0][0][1])[c]) - ushort2float(((const uint16_t *)texel[0][0][0])[c]),
-                    ushort2float(((const uint16_t *)texel[0][1][1])[c]) - ushort2float(((const uint16_t *)texel[0][1][0])[c]),
-                    ushort2float(((const uint16_t *)texel[1][0][1])[c]) - ushort2float(((const uint16_t *)texel[1][0][0])[c]),
-                    ushort2float(((const uint16_t *)texel[1][1][1])[c]) - ushort2float(((const uint16_t *)texel[1][1][0])[c]),
-                    tfrac, rfrac
-                );
-                daccumdt[c] += scaley * bilerp(
-                    ushort2float(((const uint16_t *)texel[0][1][0])[c]) - ushort2float(((const uint16_t *)texel[0][0][0])[c]),
-                    ushort2float(((const uint16_t *)texel[0][1][1])[c]) - ushort2float(((const uint16_t *)texel[0][0][1])[c]),
-                    ushort2float(((const uint16_t *)texel[1][1][0])[c]) - ushort2float(((const uint16_t *)texel[1][0][0])[c]),
-                    ushort2float(((const uint16_t *)texel[1][1][1])[c]) - ushort2float(((const uint16_t *)texel[1][0][1])[c]),
-                    sfrac, rfrac
-                );
-                daccumdr[c] += scalez * bilerp(
-                    ushort2float(((const uint16_t *)texel[0][1][0])[c]) - ushort2float(((const uint16_t *)texel[1][1][0])[c]),
-                    ushort2float(((const uint16_t *)texel[0][1][1])[c]) - ushort2float(((const uint16_t *)texel[1][1][1])[c]),
-                    ushort2float(((const uint16_t *)texel[0][0][1])[c]) - ushort2float(((const uint16_t *)texel[1][0][0])[c]),
-                    ushort2float(((const uint16_t *)texel[0][1][1])[c]) - ushort2float(((const uint16_t *)texel[1][1][1])[c]),
-                    sfrac, tfrac
-                );
-            }
-        }
-    } else if (pixeltype == TypeDesc::HALF) {
-        for (int c = 0;  c < actualchannels;  ++c)
-            accum[c] += weight * trilerp (half2float(((const half *)texel[0][0][0])[c]), half2float(((const half *)texel[0][0][1])[c]),
-                                          half2float(((const half *)texel[0][1][0])[c]), half2float(((const half *)texel[0][1][1])[c]),
-                                          half2float(((const half *)texel[1][0][0])[c]), half2float(((const half *)texel[1][0][1])[c]),
-                                          half2float(((const half *)texel[1][1][0])[c]), half2float(((const half *)texel[1][1][1])[c]),
-                                          sfrac, tfrac, rfrac);
-        if (daccumds) {
-            float scalex = weight * spec.full_width;
-            float scaley = weight * spec.full_height;
-            float scalez = weight * spec.full_depth;
-            for (int c = 0;  c < actualchannels;  ++c) {
-                daccumds[c] += scalex * bilerp(
-                    half2float(((const half *)texel[0][0][1])[c]) - half2float(((const half *)texel[0][0][0])[c]),
-                    half2float(((const half *)texel[0][1][1])[c]) - half2float(((const half *)texel[0][1][0])[c]),
-                    half2float(((const half *)texel[1][0][1])[c]) - half2float(((const half *)texel[1][0][0])[c]),
-                    half2float(((const half *)texel[1][1][1])[c]) - half2float(((const half *)texel[1][1][0])[c]),
-                    tfrac, rfrac
-                );
-                daccumdt[c] += scaley * bilerp(
-                    half2float(((const half *)texel[0][1][0])[c]) - half2float(((const half *)texel[0][0][0])[c]),
-                    half2float(((const half *)texel[0][1][1])[c]) - half2float(((const half *)texel[0][0][1])[c]),
-                    half2float(((const half *)texel[1][1][0])[c]) - half2float(((const half *)texel[1][0][0])[c]),
-                    half2float(((const half *)texel[1][1][1])[c]) - half2float(((const half *)texel[1][0][1])[c]),
-                    sfrac, rfrac
-                );
-                daccumdr[c] += scalez * bilerp(
-                    half2float(((const half *)texel[0][1][0])[c]) - half2float(((const half *)texel[1][1][0])[c]),
-                    half2float(((const half *)texel[0][1][1])[c]) - half2float(((const half *)texel[1][1][1])[c]),
-                    half2float(((const half *)texel[0][0][1])[c]) - half2float(((const half *)texel[1][0][0])[c]),
-                    half2float(((const half *)texel[0][1][1])[c]) - half2float(((const half *)texel[1][1][1])[c]),
-                    sfrac, tfrac
-                );
-            }
-        }
-    } else {
-        // General case for float tiles
-        trilerp_mad ((const float *)texel[0][0][0], (const float *)texel[0][0][1],
-                     (const float *)texel[0][1][0], (const float *)texel[0][1][1],
-                     (const float *)texel[1][0][0], (const float *)texel[1][0][1],
-                     (const float *)texel[1][1][0], (const float *)texel[1][1][1],
-                     sfrac, tfrac, rfrac, weight, actualchannels, accum);
-        if (daccumds) {
-            float scalex = weight * spec.full_width;
-            float scaley = weight * spec.full_height;
-            float scalez = weight * spec.full_depth;
-            for (int c = 0;  c < actualchannels;  ++c) {
-                daccumds[c] += scalex * bilerp(
-                    ((const float *) texel[0][0][1])[c] - ((const float *) texel[0][0][0])[c],
-                    ((const float *) texel[0][1][1])[c] - ((const float *) texel[0][1][0])[c],
-                    ((const float *) texel[1][0][1])[c] - ((const float *) texel[1][0][0])[c],
-                    ((const float *) texel[1][1][1])[c] - ((const float *) texel[1][1][0])[c],
-                    tfrac, rfrac
-                );
-                daccumdt[c] += scaley * bilerp(
-                    ((const float *) texel[0][1][0])[c] - ((const float *) texel[0][0][0])[c],
-                    ((const float *) texel[0][1][1])[c] - ((const float *) texel[0][0][1])[c],
-                    ((const float *) texel[1][1][0])[c] - ((const float *) texel[1][0][0])[c],
-                    ((const float *) texel[1][1][1])[c] - ((const float *) texel[1][0][1])[c],
-                    sfrac, rfrac
-                );
-                daccumdr[c] += scalez * bilerp(
-                    ((const float *) texel[0][1][0])[c] - ((const float *) texel[1][1][0])[c],
-                    ((const float *) texel[0][1][1])[c] - ((const float *) texel[1][1][1])[c],
-                    ((const float *) texel[0][0][1])[c] - ((const float *) texel[1][0][0])[c],
-                    ((const float *) texel[0][1][1])[c] - ((const float *) texel[1][1][1])[c],
-                    sfrac, tfrac
-                );
-            }
-        }
+    // Convert the 8 corner texels to float4 once each, then do all the
+    // interpolation 4 channels at a time.
+    simd::float4 (*load) (const unsigned char *);
+    switch (pixeltype) {
+    case TypeDesc::UINT8  : load = load_texel4<unsigned char>;  break;
+    case TypeDesc::UINT16 : load = load_texel4<unsigned short>; break;
+    case TypeDesc::HALF   : load = load_texel4<half>;           break;
+    default               : load = load_texel4<float>;          break;
+    }
+    simd::float4 v[2][2][2];
+    for (int k = 0;  k < 2;  ++k)
+        for (int j = 0;  j < 2;  ++j)
+            for (int i = 0;  i < 2;  ++i)
+                v[k][j][i] = load (texel[k][j][i]);
+
+    store_accum (accum, actualchannels, simd::float4(weight) *
+                 trilerp (v[0][0][0], v[0][0][1], v[0][1][0], v[0][1][1],
+                          v[1][0][0], v[1][0][1], v[1][1][0], v[1][1][1],
+                          sfrac, tfrac, rfrac));
+    if (daccumds) {
+        simd::float4 scalex (weight * spec.full_width);
+        simd::float4 scaley (weight * spec.full_height);
+        simd::float4 scalez (weight * spec.full_depth);
+        store_accum (daccumds, actualchannels, scalex * bilerp (
+                         v[0][0][1] - v[0][0][0], v[0][1][1] - v[0][1][0],
+                         v[1][0][1] - v[1][0][0], v[1][1][1] - v[1][1][0],
+                         tfrac, rfrac));
+        store_accum (daccumdt, actualchannels, scaley * bilerp (
+                         v[0][1][0] - v[0][0][0], v[0][1][1] - v[0][0][1],
+                         v[1][1][0] - v[1][0][0], v[1][1][1] - v[1][0][1],
+                         sfrac, rfrac));
+        store_accum (daccumdr, actualchannels, scalez * bilerp (
+                         v[0][1][0] - v[1][1][0], v[0][1][1] - v[1][1][1],
+                         v[0][0][1] - v[1][0][0], v[0][1][1] - v[1][1][1],
+                         sfrac, tfrac));
     }
 
     // Add appropriate amount of "fill" color to extra channels in
@@ -36,8 +36,15 @@
 #ifndef OPENIMAGEIO_TEXTURE_PVT_H
 #define OPENIMAGEIO_TEXTURE_PVT_H
 
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "OpenImageIO/texture.h"
 #include "OpenImageIO/simd.h"
+#include "OpenImageIO/thread.h"
 
 OIIO_NAMESPACE_BEGIN
 
@@ -57,6 +64,61 @@ class ImageCacheTileRef;
 
 
 
+/// Layout of the texture lookup trace written when the TextureSystem
+/// "trace_file" attribute is set, and played back by testtex --replay.
+/// The file starts with the 8 bytes of texture_trace_magic, and every
+/// record after that starts with a one byte tag:
+///   'F'  uint32 id, uint32 length, then that many bytes of file name.
+///        Names the texture that later lookups refer to by id.
+///   'T'  a TraceLookup: one 2D texture lookup.
+/// Everything is in native byte order.
+static const char texture_trace_magic[] = "OIIOTRC1";
+
+struct TraceLookup {
+    uint32_t file;                    ///< id from an earlier 'F' record
+    float s, t, dsdx, dtdx, dsdy, dtdy;
+    int32_t firstchannel, subimage, anisotropic;
+    uint8_t nchannels, derivs;        ///< derivs: were derivatives asked for
+    uint8_t swrap, twrap, mipmode, interpmode, conservative_filter, pad;
+    float sblur, tblur, swidth, twidth, fill;
+};
+
+
+
+/// Records texture lookups to a trace file.  Lookups from all threads
+/// are appended to one buffer under a lock, so capturing slows down a
+/// heavily threaded renderer; it is meant for gathering benchmarks, not
+/// for production use.
+class TextureTrace {
+public:
+    TextureTrace () : m_file(NULL), m_active(0) { }
+    ~TextureTrace () { close (); }
+
+    /// Start writing a new trace to filename, ending any previous one.
+    bool open (const std::string &filename);
+    /// Flush and close the trace file, if one is open.
+    void close ();
+    bool active () const { return m_active != 0; }
+    const std::string &filename () const { return m_filename; }
+
+    void record (const ImageCacheFile *file, const TextureOpt &options,
+                 float s, float t, float dsdx, float dtdx,
+                 float dsdy, float dtdy, int nchannels, bool derivs);
+
+private:
+    void close_locked ();
+    void flush_locked ();
+
+    spin_mutex m_mutex;
+    FILE *m_file;
+    atomic_int m_active;
+    std::string m_filename;
+    std::vector<char> m_buf;          ///< records not yet written
+    std::unordered_map<const ImageCacheFile *, uint32_t> m_ids;
+};
+
+
+
 /// Working implementation of the abstract TextureSystem class.
 ///
 class TextureSystemImpl : public TextureSystem {
@@ -136,6 +198,10 @@ public:
         return texture_handle && ! ((TextureFile *)texture_handle)->broken();
     }
 
+    virtual int get_subimage_index (TextureHandle *texture_handle,
+                                    Perthread *thread_info,
+                                    ustring subimagename);
+
     virtual bool texture (ustring filename, TextureOpt &options,
                           float s, float t, float dsdx, float dtdx,
                           float dsdy, float dtdy,
@@ -200,25 +266,19 @@ public:
     virtual bool shadow (ustring filename, TextureOpt &options,
                          const Imath::V3f &P, const Imath::V3f &dPdx,
                          const Imath::V3f &dPdy, float *result,
-                         float *dresultds=NULL, float *dresultdt=NULL) {
-        return false;
-    }
+                         float *dresultds=NULL, float *dresultdt=NULL);
     virtual bool shadow (TextureHandle *texture_handle, Perthread *thread_info,
                          TextureOpt &options,
                          const Imath::V3f &P, const Imath::V3f &dPdx,
                          const Imath::V3f &dPdy, float *result,
-                         float *dresultds=NULL, float *dresultdt=NULL) {
-        return false;
-    }
+                         float *dresultds=NULL, float *dresultdt=NULL);
     virtual bool shadow (ustring filename, TextureOptions &options,
                          Runflag *runflags, int beginactive, int endactive,
                          VaryingRef<Imath::V3f> P,
                          VaryingRef<Imath::V3f> dPdx,
                          VaryingRef<Imath::V3f> dPdy,
                          float *result,
-                         float *dresultds=NULL, float *dresultdt=NULL) {
-        return false;
-    }
+                         float *dresultds=NULL, float *dresultdt=NULL);
     virtual bool shadow (TextureHandle *texture_handle, Perthread *thread_info,
                          TextureOptions &options,
                          Runflag *runflags, int beginactive, int endactive,
@@ -226,9 +286,7 @@ public:
                          VaryingRef<Imath::V3f> dPdx,
                          VaryingRef<Imath::V3f> dPdy,
                          float *result,
-                         float *dresultds=NULL, float *dresultdt=NULL) {
-        return false;
-    }
+                         float *dresultds=NULL, float *dresultdt=NULL);
 
 
     virtual bool environment (ustring filename, TextureOpt &options,
@@ -292,8 +350,29 @@ public:
                              int chbegin, int chend,
                              TypeDesc format, void *result);
 
+    virtual bool prefetch_tiles (ustring filename, int subimage, int miplevel,
+                                 float smin, float smax,
+                                 float tmin, float tmax);
+
+    virtual bool environment_cdf (ustring filename, int subimage,
+                                  int &width, int &height,
+                                  std::vector<float> &marginal,
+                                  std::vector<float> &conditional);
+
+    virtual bool texture_footprint (ustring filename, TextureOpt &options,
+                                    float s, float t, float dsdx, float dtdx,
+                                    float dsdy, float dtdy,
+                                    TextureFootprint &footprint);
+    virtual bool texture_footprint (TextureHandle *texture_handle,
+                                    Perthread *thread_info,
+                                    TextureOpt &options,
+                                    float s, float t, float dsdx, float dtdx,
+                                    float dsdy, float dtdy,
+                                    TextureFootprint &footprint);
+
     virtual std::string geterror () const;
     virtual std::string getstats (int level=1, bool icstats=true) const;
+    virtual std::string getstats_json (int level=1, bool icstats=true) const;
     virtual void reset_stats ();
 
     virtual void invalidate (ustring filename);
@@ -362,6 +441,17 @@ private:
              float _dsdy, float _dtdy,
              float *result, float *dresultds, float *resultdt);
 
+    /// The rest of a texture() call for one point, once the file, the
+    /// subimage and the wrap modes have been resolved and st remapped:
+    /// pick the lookup function for the mip mode, call it, and store the
+    /// results (which need not be float4-sized or aligned).
+    bool texture_resolved (TextureFile &texfile, PerThreadInfo *thread_info,
+                           TextureOpt &options, const ImageSpec &spec,
+                           int nchannels, int actualchannels,
+                           float s, float t, float dsdx, float dtdx,
+                           float dsdy, float dtdy, float *result,
+                           float *dresultds, float *dresultdt);
+
     /// Look up texture from just ONE point
     ///
     bool texture_lookup (TextureFile &texfile, PerThreadInfo *thread_info, 
@@ -389,6 +479,28 @@ private:
                          float _dsdx, float _dtdx,
                          float _dsdy, float _dtdy,
                          float *result, float *dresultds, float *resultdt);
+
+    /// Look up texture from just ONE point, with an elliptical weighted
+    /// average (Gaussian) filter over the texels of one or two MIP levels
+    /// (MipModeEWA).
+    bool texture_lookup_ewa (TextureFile &texfile,
+                         PerThreadInfo *thread_info, 
+                         TextureOpt &options,
+                         int nchannels_result, int actualchannels,
+                         float _s, float _t,
+                         float _dsdx, float _dtdx,
+                         float _dsdy, float _dtdy,
+                         float *result, float *dresultds, float *resultdt);
+
+    /// Accumulate the normalized EWA-filtered color of one MIP level, for
+    /// the ellipse centered at (s,t) with the given full axis lengths and
+    /// major axis direction (costheta,sintheta).  Returns the number of
+    /// texels visited in 'ntexels'.
+    bool sample_ewa (float s, float t, float majorlength, float minorlength,
+                     float costheta, float sintheta, int level,
+                     TextureFile &texturefile, PerThreadInfo *thread_info,
+                     TextureOpt &options, int nchannels_result,
+                     int actualchannels, simd::float4 *accum, int &ntexels);
     
     // For the samplers, it's guaranteed that all float* inputs and outputs
     // are padded to length 'simd' and aligned to a simd*4-byte boundary
@@ -414,6 +526,16 @@ private:
                           int nchannels_result, int actualchannels,
                           const float *weight, simd::float4 *accum,
                           simd::float4 *daccumds, simd::float4 *daccumdt);
+    // The body of sample_bilinear, specialized for the tile's texel type
+    // and for the number of channels read (NCH = 1, 3, 4, or 0 for any
+    // other count).  sample_bilinear picks one of these per lookup.
+    template<typename T, int NCH>
+    bool sample_bilinear_kernel (int nsamples, const float *s, const float *t,
+                          int level, TextureFile &texturefile,
+                          PerThreadInfo *thread_info, TextureOpt &options,
+                          int nchannels_result, int actualchannels,
+                          const float *weight, simd::float4 *accum,
+                          simd::float4 *daccumds, simd::float4 *daccumdt);
     bool sample_bicubic  (int nsamples, const float *s, const float *t,
                           int level, TextureFile &texturefile,
                           PerThreadInfo *thread_info, TextureOpt &options,
@@ -467,6 +589,20 @@ private:
     static float anisotropic_aspect (float &majorlength, float &minorlength,
                                      TextureOpt& options, float &trueaspect);
 
+    /// Compute the filter ellipse for the (width-adjusted) derivatives,
+    /// with blur and the aniso limit applied, and the MIP levels and
+    /// weights to use for it, as chosen for a minor axis 1/levelscale as
+    /// long.  This is the level selection shared by texture_lookup
+    /// (levelscale 1), texture_lookup_ewa and texture_footprint.
+    static void ellipse_miplevels (TextureFile &texturefile,
+                                   TextureOpt &options,
+                                   float dsdx, float dtdx,
+                                   float dsdy, float dtdy, float levelscale,
+                                   float &majorlength, float &minorlength,
+                                   float &theta, float &aspect,
+                                   float &trueaspect, int *miplevel,
+                                   float *levelweight);
+
     /// Convert texture coordinates (s,t), which range on 0-1 for the
     /// "full" image boundary, to texel coordinates (i+ifrac,j+jfrac)
     /// where (i,j) is the texel to the immediate upper left of the
@@ -477,12 +613,64 @@ private:
                       const ImageSpec &spec, int &i, int &j,
                       float &ifrac, float &jfrac);
 
+    /// The environment() lookup for a direction with no derivatives and
+    /// no blur: a single sample of the finest level.  The results
+    /// (already zeroed, nchannels long) are accumulated into.
+    bool environment_point (TextureFile &texturefile,
+                            PerThreadInfo *thread_info, TextureOpt &options,
+                            const Imath::V3f &R, int nchannels,
+                            int actualchannels, float *result,
+                            float *dresultds, float *dresultdt);
+
+    /// Shadow lookup for one point of an already verified texture file.
+    bool shadow_lookup (TextureFile &texturefile, PerThreadInfo *thread_info,
+                        TextureOpt &options, const Imath::V3f &P,
+                        const Imath::V3f &dPdx, const Imath::V3f &dPdy,
+                        float *result, float *dresultds, float *dresultdt);
+
+    /// Percentage-closer filter of the shadow map: the weighted fraction
+    /// of the depths in a footprint of swidth x twidth texels, centered
+    /// on continuous texel coordinates (sc,tc), that are nearer to the
+    /// light than depth.
+    float shadow_pcf (TextureFile &texturefile, PerThreadInfo *thread_info,
+                      TextureOpt &options, float sc, float tc,
+                      float swidth, float twidth, float depth);
+
     /// Called when the requested texture is missing, fills in the
     /// results.
     bool missing_texture (TextureOpt &options, int nchannels, float *result,
                           float *dresultds, float *dresultdt,
                           float *dresultdr=NULL);
 
+    /// Fill order with the indices of the active points of a batch, in
+    /// the order they should be looked up.  If m_sort_batches, they are
+    /// sorted by key(i), so that points that are likely to need the same
+    /// tiles are looked up one after another and mostly find them in the
+    /// tile microcache.  Points with equal keys keep their original order.
+    template<class KeyFunc>
+    void batch_order (Runflag *runflags, int beginactive, int endactive,
+                      std::vector<int> &order, KeyFunc key) const {
+        order.clear ();
+        for (int i = beginactive;  i < endactive;  ++i)
+            if (runflags[i])
+                order.push_back (i);
+        if (! m_sort_batches || order.size() < 3)
+            return;
+        std::vector<std::pair<uint64_t,int> > keyed (order.size());
+        for (size_t j = 0, n = order.size();  j < n;  ++j)
+            keyed[j] = std::make_pair (uint64_t(key(order[j])), order[j]);
+        std::sort (keyed.begin(), keyed.end());
+        for (size_t j = 0, n = order.size();  j < n;  ++j)
+            order[j] = keyed[j].second;
+    }
+
+    /// batch_order for lookups by position (texture3d) or direction
+    /// (environment, with normalize=true): sort the points along a
+    /// Morton curve through the bounding box of the batch's P.
+    void spatial_batch_order (Runflag *runflags, int beginactive,
+                              int endactive, VaryingRef<Imath::V3f> P,
+                              bool normalize, std::vector<int> &order) const;
+
     /// Handle gray-to-RGB promotion.
     void fill_gray_channels (const ImageSpec &spec, int nchannels,
                              float *result, float *dresultds, float *dresultdt,
@@ -532,6 +720,8 @@ private:
     Imath::M44f m_Mc2w;          ///< common-to-world matrix
     bool m_gray_to_rgb;          ///< automatically copy gray to rgb channels?
     bool m_flip_t;               ///< Flip direction of t coord?
+    bool m_sort_batches;         ///< Reorder batches for tile coherence?
+    float m_ewa_quality;         ///< Texel density for MipModeEWA
     int m_max_tile_channels;     ///< narrow tile ID channel range when
                                  ///<   the file has more channels
     /// Saved error string, per-thread
@@ -539,6 +729,7 @@ private:
     mutable thread_specific_ptr< std::string > m_errormessage;
     Filter1D *hq_filter;         ///< Better filter for magnification
     int m_statslevel;
+    TextureTrace m_trace;        ///< Lookup capture ("trace_file")
     friend class TextureSystem;
 };
 
@@ -37,18 +37,21 @@
 
 #include <OpenEXR/half.h>
 #include <OpenEXR/ImathMatrix.h>
+#include <OpenEXR/ImathBox.h>
 
 #include "OpenImageIO/dassert.h"
 #include "OpenImageIO/typedesc.h"
 #include "OpenImageIO/varyingref.h"
 #include "OpenImageIO/ustring.h"
 #include "OpenImageIO/strutil.h"
+#include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/sysutil.h"
 #include "OpenImageIO/thread.h"
 #include "OpenImageIO/fmath.h"
 #include "OpenImageIO/simd.h"
 #include "OpenImageIO/filter.h"
 #include "OpenImageIO/optparser.h"
+#include "OpenImageIO/parallel.h"
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/texture.h"
 #include "OpenImageIO/imagecache.h"
@@ -95,6 +98,40 @@ OIIO_FORCEINLINE float4 half2float4 (const half *h) {
 }
 
 
+// Convert the texel at p, stored as T, to float.  The NCH==1 flavor only
+// touches the first channel and leaves the rest zero; callers mask off
+// the unused channels either way.
+template<typename T> OIIO_FORCEINLINE float4 load_texel4 (const unsigned char *p);
+template<> OIIO_FORCEINLINE float4 load_texel4<unsigned char> (const unsigned char *p) {
+    return uchar2float4 (p);
+}
+template<> OIIO_FORCEINLINE float4 load_texel4<unsigned short> (const unsigned char *p) {
+    return ushort2float4 ((const unsigned short *)p);
+}
+template<> OIIO_FORCEINLINE float4 load_texel4<half> (const unsigned char *p) {
+    return half2float4 ((const half *)p);
+}
+template<> OIIO_FORCEINLINE float4 load_texel4<float> (const unsigned char *p) {
+    return float4 ((const float *)p);
+}
+
+template<typename T> OIIO_FORCEINLINE float load_texel1 (const unsigned char *p) {
+    return float (*(const T *)p);
+}
+template<> OIIO_FORCEINLINE float load_texel1<unsigned char> (const unsigned char *p) {
+    return uchar2float (*p);
+}
+template<> OIIO_FORCEINLINE float load_texel1<unsigned short> (const unsigned char *p) {
+    return float (*(const unsigned short *)p) * (1.0f/65535.0f);
+}
+
+template<typename T, int NCH>
+OIIO_FORCEINLINE float4 load_texel (const unsigned char *p) {
+    return NCH == 1 ? float4 (load_texel1<T>(p), 0.0f, 0.0f, 0.0f)
+                    : load_texel4<T>(p);
+}
+
+
 static const OIIO_SIMD4_ALIGN mask4 channel_masks[5] = {
     mask4(false, false, false, false),
     mask4(true,  false, false, false),
@@ -344,6 +381,8 @@ TextureSystemImpl::init ()
     m_Mw2c.makeIdentity();
     m_gray_to_rgb = false;
     m_flip_t = false;
+    m_sort_batches = true;
+    m_ewa_quality = 1.0f;
     m_max_tile_channels = 5;
     delete hq_filter;
     hq_filter = Filter1D::create ("b-spline", 4);
@@ -426,6 +465,36 @@ TextureSystemImpl::getstats (int level, bool icstats) const
 
 
 
+std::string
+TextureSystemImpl::getstats_json (int level, bool icstats) const
+{
+    ImageCacheStatistics stats;
+    m_imagecache->mergestats (stats);
+
+    std::string out = Strutil::format (
+        "{\"texture\":{\"texture_queries\":%lld,\"texture_batches\":%lld,"
+        "\"texture3d_queries\":%lld,\"texture3d_batches\":%lld,"
+        "\"shadow_queries\":%lld,\"shadow_batches\":%lld,"
+        "\"environment_queries\":%lld,\"environment_batches\":%lld,"
+        "\"closest_interps\":%lld,\"bilinear_interps\":%lld,"
+        "\"cubic_interps\":%lld,\"aniso_queries\":%lld,"
+        "\"aniso_probes\":%lld,\"max_aniso\":%.9g}",
+        stats.texture_queries, stats.texture_batches,
+        stats.texture3d_queries, stats.texture3d_batches,
+        stats.shadow_queries, stats.shadow_batches,
+        stats.environment_queries, stats.environment_batches,
+        stats.closest_interps, stats.bilinear_interps, stats.cubic_interps,
+        stats.aniso_queries, stats.aniso_probes, stats.max_aniso);
+    if (icstats) {
+        out += ",";
+        m_imagecache->append_stats_json (out, level);
+    }
+    out += "}";
+    return out;
+}
+
+
+
 void
 TextureSystemImpl::printstats () const
 {
@@ -445,6 +514,106 @@ TextureSystemImpl::reset_stats ()
 
 
 
+bool
+TextureTrace::open (const std::string &filename)
+{
+    spin_lock lock (m_mutex);
+    close_locked ();
+    m_file = Filesystem::fopen (filename, "wb");
+    if (! m_file)
+        return false;
+    m_filename = filename;
+    m_buf.assign (texture_trace_magic, texture_trace_magic + 8);
+    m_active = 1;
+    return true;
+}
+
+
+
+void
+TextureTrace::close ()
+{
+    spin_lock lock (m_mutex);
+    close_locked ();
+}
+
+
+
+void
+TextureTrace::close_locked ()
+{
+    m_active = 0;
+    if (m_file) {
+        flush_locked ();
+        fclose (m_file);
+        m_file = NULL;
+    }
+    m_filename.clear ();
+    m_ids.clear ();
+}
+
+
+
+void
+TextureTrace::flush_locked ()
+{
+    if (m_file && m_buf.size())
+        fwrite (&m_buf[0], 1, m_buf.size(), m_file);
+    m_buf.clear ();
+}
+
+
+
+void
+TextureTrace::record (const ImageCacheFile *file, const TextureOpt &options,
+                      float s, float t, float dsdx, float dtdx,
+                      float dsdy, float dtdy, int nchannels, bool derivs)
+{
+    TraceLookup rec;
+    memset (&rec, 0, sizeof(rec));
+    rec.s = s;  rec.t = t;
+    rec.dsdx = dsdx;  rec.dtdx = dtdx;
+    rec.dsdy = dsdy;  rec.dtdy = dtdy;
+    rec.firstchannel = options.firstchannel;
+    rec.subimage = options.subimage;
+    rec.anisotropic = options.anisotropic;
+    rec.nchannels = (uint8_t) nchannels;
+    rec.derivs = derivs;
+    rec.swrap = (uint8_t) options.swrap;
+    rec.twrap = (uint8_t) options.twrap;
+    rec.mipmode = (uint8_t) options.mipmode;
+    rec.interpmode = (uint8_t) options.interpmode;
+    rec.conservative_filter = options.conservative_filter;
+    rec.sblur = options.sblur;  rec.tblur = options.tblur;
+    rec.swidth = options.swidth;  rec.twidth = options.twidth;
+    rec.fill = options.fill;
+
+    spin_lock lock (m_mutex);
+    if (! m_file)
+        return;
+    auto found = m_ids.find (file);
+    if (found == m_ids.end()) {
+        rec.file = (uint32_t) m_ids.size();
+        m_ids[file] = rec.file;
+        ustring name = file ? file->filename() : ustring();
+        uint32_t len = (uint32_t) name.length();
+        m_buf.push_back ('F');
+        m_buf.insert (m_buf.end(), (const char *)&rec.file,
+                      (const char *)&rec.file + 4);
+        m_buf.insert (m_buf.end(), (const char *)&len, (const char *)&len + 4);
+        m_buf.insert (m_buf.end(), name.c_str(), name.c_str() + len);
+    } else {
+        rec.file = found->second;
+    }
+    m_buf.push_back ('T');
+    m_buf.insert (m_buf.end(), (const char *)&rec,
+                  (const char *)&rec + sizeof(rec));
+    if (m_buf.size() >= (1 << 20))
+        flush_locked ();
+}
+
+
+
 bool
 TextureSystemImpl::attribute (string_view name, TypeDesc type,
                               const void *val)
@@ -473,10 +642,30 @@ TextureSystemImpl::attribute (string_view name, TypeDesc type,
         m_flip_t = *(const int *)val;
         return true;
     }
+    if (name == "sort_batches" && type == TypeDesc::TypeInt) {
+        m_sort_batches = *(const int *)val;
+        return true;
+    }
+    if (name == "ewa_quality" && type == TypeDesc::TypeFloat) {
+        m_ewa_quality = Imath::clamp (*(const float *)val, 0.25f, 8.0f);
+        return true;
+    }
     if (name == "m_max_tile_channels" && type == TypeDesc::TypeInt) {
         m_max_tile_channels = *(const int *)val;
         return true;
     }
+    if (name == "trace_file" && type == TypeDesc::STRING) {
+        const char *filename = *(const char **)val;
+        if (filename && filename[0]) {
+            if (! m_trace.open (filename)) {
+                error ("Could not open texture trace file \"%s\"", filename);
+                return false;
+            }
+        } else {
+            m_trace.close ();
+        }
+        return true;
+    }
     if (name == "statistics:level" && type == TypeDesc::TypeInt) {
         m_statslevel = *(const int *)val;
         // DO NOT RETURN! pass the same message to the image cache
@@ -511,10 +700,22 @@ TextureSystemImpl::getattribute (string_view name, TypeDesc type,
         *(int *)val = m_flip_t;
         return true;
     }
+    if (name == "sort_batches" && type == TypeDesc::TypeInt) {
+        *(int *)val = m_sort_batches;
+        return true;
+    }
+    if (name == "ewa_quality" && type == TypeDesc::TypeFloat) {
+        *(float *)val = m_ewa_quality;
+        return true;
+    }
     if (name == "m_max_tile_channels" && type == TypeDesc::TypeInt) {
         *(int *)val = m_max_tile_channels;
         return true;
     }
+    if (name == "trace_file" && type == TypeDesc::STRING) {
+        *(const char **)val = ustring(m_trace.filename()).c_str();
+        return true;
+    }
 
     // If not one of these, maybe it's an attribute meant for the image cache?
     return m_imagecache->getattribute (name, type, val);
@@ -567,6 +768,21 @@ TextureSystemImpl::get_texture_info (TextureHandle *texture_handle,
 
 
 
+int
+TextureSystemImpl::get_subimage_index (TextureHandle *texture_handle,
+                                       Perthread *thread_info_,
+                                       ustring subimagename)
+{
+    PerThreadInfo *thread_info = m_imagecache->get_perthread_info((PerThreadInfo *)thread_info_);
+    TextureFile *texturefile = verify_texturefile ((TextureFile *)texture_handle,
+                                                   thread_info);
+    if (! texturefile || texturefile->broken())
+        return -1;
+    return m_imagecache->subimage_from_name (texturefile, subimagename);
+}
+
+
+
 bool
 TextureSystemImpl::get_imagespec (ustring filename, int subimage,
                                   ImageSpec &spec)
@@ -641,7 +857,8 @@ TextureSystemImpl::get_texels (ustring filename, TextureOpt &options,
         error ("Texture file \"%s\" not found", filename);
         return false;
     }
-    return get_texels (filename, options, miplevel, xbegin, xend,
+    return get_texels ((TextureHandle *)texfile, (Perthread *)thread_info,
+                       options, miplevel, xbegin, xend,
                        ybegin, yend, zbegin, zend, chbegin, chend,
                        format, result);
 }
@@ -695,53 +912,95 @@ TextureSystemImpl::get_texels (TextureHandle *texture_handle_,
         tile_chbegin = chbegin;
         tile_chend = chbegin+actualchannels;
     }
-    TileID tileid (*texfile, subimage, miplevel, 0, 0, 0,
-                   tile_chbegin, tile_chend);
     size_t formatchannelsize = format.size();
     size_t formatpixelsize = nchannels * formatchannelsize;
     size_t scanlinesize = (xend-xbegin) * formatpixelsize;
     size_t zplanesize = (yend-ybegin) * scanlinesize;
-    bool ok = true;
-    for (int z = zbegin;  z < zend;  ++z) {
-        if (z < spec.z || z >= (spec.z+std::max(spec.depth,1))) {
-            // nonexistant planes
-            memset (result, 0, zplanesize);
-            result = (void *) ((char *) result + zplanesize);
-            continue;
-        }
-        tileid.z (z - ((z - spec.z) % std::max (1, spec.tile_depth)));
-        for (int y = ybegin;  y < yend;  ++y) {
-            if (y < spec.y || y >= (spec.y+spec.height)) {
-                // nonexistant scanlines
-                memset (result, 0, scanlinesize);
-                result = (void *) ((char *) result + scanlinesize);
+
+    // Fill scanlines [y0,y1) of every plane, using thread_info for the
+    // tile lookups.
+    auto gather = [&](PerThreadInfo *thread_info, int y0, int y1) -> bool {
+        TileID tileid (*texfile, subimage, miplevel, 0, 0, 0,
+                       tile_chbegin, tile_chend);
+        bool ok = true;
+        for (int z = zbegin;  z < zend;  ++z) {
+            char *zptr = (char *)result + (z-zbegin) * zplanesize;
+            if (z < spec.z || z >= (spec.z+std::max(spec.depth,1))) {
+                // nonexistant planes
+                memset (zptr + (y0-ybegin) * scanlinesize, 0,
+                        (y1-y0) * scanlinesize);
                 continue;
             }
-            tileid.y (y - ((y - spec.y) % spec.tile_height));
-            for (int x = xbegin;  x < xend;  ++x) {
-                if (x < spec.x || x >= (spec.x+spec.width)) {
-                    // nonexistant columns
-                    memset (result, 0, formatpixelsize);
-                    result = (void *) ((char *) result + formatpixelsize);
+            tileid.z (z - ((z - spec.z) % std::max (1, spec.tile_depth)));
+            for (int y = y0;  y < y1;  ++y) {
+                char *ptr = zptr + (y-ybegin) * scanlinesize;
+                if (y < spec.y || y >= (spec.y+spec.height)) {
+                    // nonexistant scanlines
+                    memset (ptr, 0, scanlinesize);
                     continue;
                 }
-                tileid.x (x - ((x - spec.x) % spec.tile_width));
-                ok &= find_tile (tileid, thread_info);
-                TileRef &tile (thread_info->tile);
-                const char *data;
-                if (tile && (data = (const char *)tile->data (x, y, z, chbegin))) {
-                    convert_types (texfile->datatype(subimage), data,
-                                   format, result, actualchannels);
-                    for (int c = actualchannels;  c < nchannels;  ++c)
-                        convert_types (TypeDesc::FLOAT, &options.fill, format,
-                                       (char *)result+c*formatchannelsize, 1);
-                } else {
-                    memset (result, 0, formatpixelsize);
+                tileid.y (y - ((y - spec.y) % spec.tile_height));
+                for (int x = xbegin;  x < xend;  ++x, ptr += formatpixelsize) {
+                    if (x < spec.x || x >= (spec.x+spec.width)) {
+                        // nonexistant columns
+                        memset (ptr, 0, formatpixelsize);
+                        continue;
+                    }
+                    tileid.x (x - ((x - spec.x) % spec.tile_width));
+                    ok &= find_tile (tileid, thread_info);
+                    TileRef &tile (thread_info->tile);
+                    const char *data;
+                    if (tile && (data = (const char *)tile->data (x, y, z, chbegin))) {
+                        convert_types (texfile->datatype(subimage), data,
+                                       format, ptr, actualchannels);
+                        for (int c = actualchannels;  c < nchannels;  ++c)
+                            convert_types (TypeDesc::FLOAT, &options.fill, format,
+                                           ptr+c*formatchannelsize, 1);
+                    } else {
+                        memset (ptr, 0, formatpixelsize);
+                    }
                 }
-                result = (void *) ((char *) result + formatpixelsize);
             }
         }
+        return ok;
+    };
+
+    // As in ImageCache::get_pixels, a region spanning several rows of
+    // tiles may be split into bands of tile rows across the thread pool
+    // (see the "gather_threads" attribute).
+    int nthreads = m_imagecache->gather_threads();
+    if (nthreads != 1 && yend - ybegin > spec.tile_height) {
+        int ty0 = ybegin - ((ybegin - spec.y) % spec.tile_height);
+        if (ty0 > ybegin)
+            ty0 -= spec.tile_height;   // ybegin above the data window
+        int nbands = (yend - ty0 + spec.tile_height - 1) / spec.tile_height;
+        if (nthreads <= 0)
+            nthreads = default_thread_pool()->size() + 1;
+        nthreads = std::min (nthreads, nbands);
+        if (nthreads > 1) {
+            atomic_int nfailed (0);
+            spin_mutex err_mutex;
+            std::string errors;
+            parallel_for_chunked (0, nbands, (nbands+nthreads-1)/nthreads,
+                                  [&](int64_t b, int64_t e) {
+                int y0 = std::max (ybegin, ty0 + int(b) * spec.tile_height);
+                int y1 = std::min (yend, ty0 + int(e) * spec.tile_height);
+                if (! gather (m_imagecache->get_perthread_info(), y0, y1)) {
+                    ++nfailed;
+                    // Errors are per-thread; carry them back to the caller.
+                    std::string err = m_imagecache->geterror ();
+                    spin_lock lock (err_mutex);
+                    if (err.size() && errors.size())
+                        errors += '\n';
+                    errors += err;
+                }
+            });
+            if (errors.size())
+                error ("%s", errors);
+            return nfailed == 0;
+        }
     }
+    bool ok = gather (thread_info, ybegin, yend);
     if (! ok) {
         std::string err = m_imagecache->geterror();
         if (! err.empty())
@@ -752,6 +1011,37 @@ TextureSystemImpl::get_texels (TextureHandle *texture_handle_,
 
 
 
+bool
+TextureSystemImpl::prefetch_tiles (ustring filename, int subimage,
+                                   int miplevel, float smin, float smax,
+                                   float tmin, float tmax)
+{
+    PerThreadInfo *thread_info = m_imagecache->get_perthread_info ();
+    TextureFile *texfile = find_texturefile (filename, thread_info);
+    texfile = verify_texturefile (texfile, thread_info);
+    if (! texfile)
+        return false;
+    if (subimage < 0 || subimage >= texfile->subimages() ||
+        miplevel < 0 || miplevel >= texfile->miplevels(subimage)) {
+        error ("prefetch_tiles asked for nonexistant subimage %d, MIP level %d of \"%s\"",
+               subimage, miplevel, texfile->filename());
+        return false;
+    }
+    // Map (s,t) to texels, with a texel of slop all around for the
+    // filter footprint.
+    const ImageSpec &spec (texfile->spec(subimage, miplevel));
+    ROI roi (ifloor (smin * spec.width) + spec.x - 1,
+             ifloor (smax * spec.width) + spec.x + 2,
+             ifloor (tmin * spec.height) + spec.y - 1,
+             ifloor (tmax * spec.height) + spec.y + 2,
+             spec.z, spec.z + std::max (spec.depth, 1),
+             0, spec.nchannels);
+    return m_imagecache->prefetch_tiles (texfile, thread_info,
+                                         subimage, miplevel, roi);
+}
+
+
+
 std::string
 TextureSystemImpl::geterror () const
 {
@@ -897,19 +1187,188 @@ TextureSystemImpl::texture (TextureHandle *texture_handle,
         dresultds += beginactive*nchannels;
         dresultdt += beginactive*nchannels;
     }
-    for (int i = beginactive;  i < endactive;  ++i) {
-        if (runflags[i]) {
-            TextureOpt opt (options, i);
-            ok &= texture (texture_handle, thread_info,
-                           opt, s[i], t[i], dsdx[i], dtdx[i],
-                           dsdy[i], dtdy[i], nchannels,
-                           result, dresultds, dresultdt);
+    TextureFile *texturefile = (TextureFile *)texture_handle;
+    if (texturefile->is_udim() || nchannels > 4) {
+        // Each point of a UDIM texture may come from a different file,
+        // and more than 4 channels are done 4 at a time, so just do the
+        // points one at a time.
+        for (int i = beginactive;  i < endactive;  ++i) {
+            if (runflags[i]) {
+                TextureOpt opt (options, i);
+                ok &= texture (texture_handle, thread_info,
+                               opt, s[i], t[i], dsdx[i], dtdx[i],
+                               dsdy[i], dtdy[i], nchannels,
+                               result, dresultds, dresultdt);
+            }
+            result += nchannels;
+            if (dresultds) {
+                dresultds += nchannels;
+                dresultdt += nchannels;
+            }
         }
-        result += nchannels;
-        if (dresultds) {
-            dresultds += nchannels;
-            dresultdt += nchannels;
+        return ok;
+    }
+
+    if (m_trace.active()) {
+        for (int i = beginactive;  i < endactive;  ++i)
+            if (runflags[i])
+                m_trace.record (texturefile, TextureOpt (options, i),
+                                s[i], t[i], dsdx[i], dtdx[i], dsdy[i], dtdy[i],
+                                nchannels, dresultds != NULL);
+    }
+
+    // Everything that is the same for the whole batch -- finding the
+    // file, the subimage, the wrap modes, and how to remap st -- is done
+    // just once, rather than for every point.
+    PerThreadInfo *thread_info_ = m_imagecache->get_perthread_info((PerThreadInfo *)thread_info);
+    texturefile = verify_texturefile (texturefile, thread_info_);
+
+    ImageCacheStatistics &stats (thread_info_->m_stats);
+    ++stats.texture_batches;
+    for (int i = beginactive;  i < endactive;  ++i)
+        if (runflags[i])
+            ++stats.texture_queries;
+
+    if (! texturefile  ||  texturefile->broken()) {
+        for (int i = beginactive;  i < endactive;  ++i) {
+            if (runflags[i]) {
+                TextureOpt opt (options, i);
+                ok &= missing_texture (opt, nchannels, result + (i-beginactive)*nchannels,
+                                       dresultds ? dresultds + (i-beginactive)*nchannels : NULL,
+                                       dresultdt ? dresultdt + (i-beginactive)*nchannels : NULL);
+            }
+        }
+        return ok;
+    }
+
+    int subimage = options.subimage;
+    if (options.subimagename) {
+        // If subimage was specified by name, figure out its index.
+        subimage = m_imagecache->subimage_from_name (texturefile, options.subimagename);
+        if (subimage < 0) {
+            error ("Unknown subimage \"%s\" in texture \"%s\"",
+                   options.subimagename, texturefile->filename());
+            return false;
+        }
+    }
+
+    const ImageCacheFile::SubimageInfo &subinfo (texturefile->subimageinfo(subimage));
+    const ImageSpec &spec (texturefile->spec(subimage, 0));
+
+    int actualchannels = Imath::clamp (spec.nchannels - options.firstchannel, 0, nchannels);
+
+    // Figure out the wrap functions
+    TextureOpt::Wrap swrap = (TextureOpt::Wrap)options.swrap;
+    TextureOpt::Wrap twrap = (TextureOpt::Wrap)options.twrap;
+    if (swrap == TextureOpt::WrapDefault)
+        swrap = (TextureOpt::Wrap)texturefile->swrap();
+    if (swrap == TextureOpt::WrapPeriodic && ispow2(spec.width))
+        swrap = TextureOpt::WrapPeriodicPow2;
+    if (twrap == TextureOpt::WrapDefault)
+        twrap = (TextureOpt::Wrap)texturefile->twrap();
+    if (twrap == TextureOpt::WrapPeriodic && ispow2(spec.height))
+        twrap = TextureOpt::WrapPeriodicPow2;
+
+    if (subinfo.is_constant_image && swrap != TextureOpt::WrapBlack &&
+          twrap != TextureOpt::WrapBlack) {
+        // Lookup of constant color texture, non-black wrap -- skip all the
+        // hard stuff.
+        for (int i = beginactive;  i < endactive;  ++i) {
+            if (! runflags[i])
+                continue;
+            float *r = result + (i-beginactive)*nchannels;
+            for (int c = 0; c < actualchannels; ++c)
+                r[c] = subinfo.average_color[c+options.firstchannel];
+            for (int c = actualchannels; c < nchannels; ++c)
+                r[c] = options.fill[i];
+            float *drds = NULL, *drdt = NULL;
+            if (dresultds) {
+                // Derivs are always 0 from a constant texture lookup
+                drds = dresultds + (i-beginactive)*nchannels;
+                drdt = dresultdt + (i-beginactive)*nchannels;
+                for (int c = 0; c < nchannels; ++c)
+                    drds[c] = drdt[c] = 0.0f;
+            }
+            if (actualchannels < nchannels && options.firstchannel == 0 && m_gray_to_rgb)
+                fill_gray_channels (spec, nchannels, r, drds, drdt);
         }
+        return true;
+    }
+
+    // The flip and the overscan/crop remapping of st are the same affine
+    // map for every point:  s' = s*sscale + soffset,
+    // t' = (tflip + tsign*t)*tscale + toffset (tflip, tsign = 1, -1 if
+    // flipping, else 0, 1), with the derivatives scaled to match.  Apply
+    // it to 8 points at a time.  These are the same operations, in the
+    // same order, as the one-point texture() does, so the results match.
+    float sscale = 1.0f, soffset = 0.0f, tscale = 1.0f, toffset = 0.0f;
+    if (! subinfo.full_pixel_range) {
+        sscale = subinfo.sscale;  soffset = subinfo.soffset;
+        tscale = subinfo.tscale;  toffset = subinfo.toffset;
+    }
+    float8 ssc (sscale), soff (soffset), tsc (tscale), toff (toffset);
+    float8 tflip (m_flip_t ? 1.0f : 0.0f), tsign (m_flip_t ? -1.0f : 1.0f);
+    int npoints = endactive - beginactive;
+    int npadded = round_to_multiple_of_pow2 (npoints, 8);
+    std::vector<float> coords (6 * npadded);
+    float *sb = &coords[0],  *tb = sb + npadded;
+    float *dsdxb = tb + npadded,  *dtdxb = dsdxb + npadded;
+    float *dsdyb = dtdxb + npadded,  *dtdyb = dsdyb + npadded;
+    for (int j = 0;  j < npadded;  ++j) {
+        int i = beginactive + std::min (j, npoints-1);  // pad with the last
+        sb[j] = s[i];        tb[j] = t[i];
+        dsdxb[j] = dsdx[i];  dtdxb[j] = dtdx[i];
+        dsdyb[j] = dsdy[i];  dtdyb[j] = dtdy[i];
+    }
+    for (int j = 0;  j < npadded;  j += 8) {
+        float8 S (sb+j), T (tb+j), DSDX (dsdxb+j), DTDX (dtdxb+j);
+        float8 DSDY (dsdyb+j), DTDY (dtdyb+j);
+        if (! subinfo.full_pixel_range) {
+            S = S * ssc + soff;
+            DSDX *= ssc;
+            DSDY *= ssc;
+        }
+        if (m_flip_t || ! subinfo.full_pixel_range) {
+            T = (tflip + tsign * T) * tsc + toff;
+            DTDX = (DTDX * tsign) * tsc;
+            DTDY = (DTDY * tsign) * tsc;
+        }
+        S.store (sb+j);        T.store (tb+j);
+        DSDX.store (dsdxb+j);  DTDX.store (dtdxb+j);
+        DSDY.store (dsdyb+j);  DTDY.store (dtdyb+j);
+    }
+
+    // Look the points up grouped by which tile (of roughly the MIP level
+    // their footprint will select) their st falls in.
+    std::vector<int> order;
+    int res = std::max (spec.width, spec.height);
+    int tw = std::max (spec.tile_width, 1), th = std::max (spec.tile_height, 1);
+    batch_order (runflags, beginactive, endactive, order, [&](int i) {
+        int j = i - beginactive;
+        float d = std::max (std::max (fabsf(dsdxb[j]), fabsf(dsdyb[j])),
+                            std::max (fabsf(dtdxb[j]), fabsf(dtdyb[j])));
+        int level = Imath::clamp ((int) fast_log2 (std::max (d * res, 1.0f)), 0, 31);
+        int64_t x = ifloor (sb[j] * spec.width) >> level;
+        int64_t y = ifloor (tb[j] * spec.height) >> level;
+        return (uint64_t(level) << 56) |
+               (uint64_t((y / th) & 0xfffffff) << 28) |
+               uint64_t((x / tw) & 0xfffffff);
+    });
+
+    for (int i : order) {
+        int j = i - beginactive;
+        TextureOpt opt (options, i);
+        opt.subimage = subimage;
+        opt.subimagename.clear ();
+        opt.swrap = swrap;
+        opt.twrap = twrap;
+        int offset = j * nchannels;
+        ok &= texture_resolved (*texturefile, thread_info_, opt, spec,
+                                nchannels, actualchannels, sb[j], tb[j],
+                                dsdxb[j], dtdxb[j], dsdyb[j], dtdyb[j],
+                                result + offset,
+                                dresultds ? dresultds + offset : NULL,
+                                dresultdt ? dresultdt + offset : NULL);
     }
     return ok;
 }
@@ -940,6 +1399,7 @@ TextureSystemImpl::texture (TextureHandle *texture_handle_,
                             int nchannels, float *result,
                             float *dresultds, float *dresultdt)
 {
+    OIIO_TRACE_ZONE ("TextureSystem::texture");
     // Handle >4 channel lookups by recursion.
     if (nchannels > 4) {
         int save_firstchannel = options.firstchannel;
@@ -960,15 +1420,10 @@ TextureSystemImpl::texture (TextureHandle *texture_handle_,
         return true;
     }
 
-    static const texture_lookup_prototype lookup_functions[] = {
-        // Must be in the same order as Mipmode enum
-        &TextureSystemImpl::texture_lookup,
-        &TextureSystemImpl::texture_lookup_nomip,
-        &TextureSystemImpl::texture_lookup_trilinear_mipmap,
-        &TextureSystemImpl::texture_lookup_trilinear_mipmap,
-        &TextureSystemImpl::texture_lookup
-    };
-    texture_lookup_prototype lookup = lookup_functions[(int)options.mipmode];
+    if (m_trace.active())
+        m_trace.record ((TextureFile *)texture_handle_, options,
+                        s, t, dsdx, dtdx, dsdy, dtdy, nchannels,
+                        dresultds != NULL);
 
     PerThreadInfo *thread_info = m_imagecache->get_perthread_info((PerThreadInfo *)thread_info_);
     TextureFile *texturefile = (TextureFile *)texture_handle_;
@@ -1047,6 +1502,77 @@ TextureSystemImpl::texture (TextureHandle *texture_handle_,
         dtdy *= subinfo.tscale;
     }
 
+    return texture_resolved (*texturefile, thread_info, options, spec,
+                             nchannels, actualchannels, s, t, dsdx, dtdx,
+                             dsdy, dtdy, result, dresultds, dresultdt);
+}
+
+
+
+namespace {
+
+// Spread the low 10 bits of x out to every third bit.
+inline uint32_t
+morton_spread3 (uint32_t x)
+{
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x <<  8)) & 0x0300f00f;
+    x = (x | (x <<  4)) & 0x030c30c3;
+    x = (x | (x <<  2)) & 0x09249249;
+    return x;
+}
+
+}  // end anonymous namespace
+
+
+
+void
+TextureSystemImpl::spatial_batch_order (Runflag *runflags, int beginactive,
+                                        int endactive, VaryingRef<Imath::V3f> P,
+                                        bool normalize,
+                                        std::vector<int> &order) const
+{
+    Imath::Box<Imath::V3f> bounds;
+    if (m_sort_batches) {
+        for (int i = beginactive;  i < endactive;  ++i)
+            if (runflags[i])
+                bounds.extendBy (normalize ? P[i].normalized() : P[i]);
+    }
+    Imath::V3f size = bounds.max - bounds.min;
+    Imath::V3f scale (size.x > 0.0f ? 1023.0f / size.x : 0.0f,
+                      size.y > 0.0f ? 1023.0f / size.y : 0.0f,
+                      size.z > 0.0f ? 1023.0f / size.z : 0.0f);
+    batch_order (runflags, beginactive, endactive, order, [&](int i) {
+        Imath::V3f p = ((normalize ? P[i].normalized() : P[i]) - bounds.min) * scale;
+        return morton_spread3 (uint32_t(p.x)) |
+               (morton_spread3 (uint32_t(p.y)) << 1) |
+               (morton_spread3 (uint32_t(p.z)) << 2);
+    });
+}
+
+
+
+bool
+TextureSystemImpl::texture_resolved (TextureFile &texturefile,
+                                     PerThreadInfo *thread_info,
+                                     TextureOpt &options, const ImageSpec &spec,
+                                     int nchannels, int actualchannels,
+                                     float s, float t, float dsdx, float dtdx,
+                                     float dsdy, float dtdy, float *result,
+                                     float *dresultds, float *dresultdt)
+{
+    static const texture_lookup_prototype lookup_functions[] = {
+        // Must be in the same order as Mipmode enum
+        &TextureSystemImpl::texture_lookup,
+        &TextureSystemImpl::texture_lookup_nomip,
+        &TextureSystemImpl::texture_lookup_trilinear_mipmap,
+        &TextureSystemImpl::texture_lookup_trilinear_mipmap,
+        &TextureSystemImpl::texture_lookup,
+        &TextureSystemImpl::texture_lookup_ewa
+    };
+    texture_lookup_prototype lookup = lookup_functions[(int)options.mipmode];
+
     bool ok;
     // Everything from the lookup function on down will assume that there
     // is space for a float4 in all of the result locations, so if that's
@@ -1066,7 +1592,7 @@ TextureSystemImpl::texture (TextureHandle *texture_handle_,
             dresultds = (float *)&dresultds_simd;
             dresultdt = (float *)&dresultdt_simd;
         }
-        ok = (this->*lookup) (*texturefile, thread_info, options,
+        ok = (this->*lookup) (texturefile, thread_info, options,
                               nchannels, actualchannels,
                               s, t, dsdx, dtdx, dsdy, dtdy, (float *)&result_simd,
                               dresultds, dresultdt);
@@ -1082,7 +1608,7 @@ TextureSystemImpl::texture (TextureHandle *texture_handle_,
         }
     } else {
         // All provided output slots are aligned 4-floats, use them directly
-        ok = (this->*lookup) (*texturefile, thread_info, options,
+        ok = (this->*lookup) (texturefile, thread_info, options,
                               nchannels, actualchannels,
                               s, t, dsdx, dtdx, dsdy, dtdy, result,
                               dresultds, dresultdt);
@@ -1284,6 +1810,22 @@ compute_miplevels (TextureSystemImpl::TextureFile &texturefile,
 
 
 
+// The isotropic filter width used by texture_lookup_trilinear_mipmap
+// (and texture_footprint) for the given width-adjusted derivatives.
+inline float
+trilinear_filtwidth (const TextureOpt &options, float dsdx, float dtdx,
+                     float dsdy, float dtdy)
+{
+    float sfilt = std::max (fabsf(dsdx), fabsf(dsdy));
+    float tfilt = std::max (fabsf(dtdx), fabsf(dtdy));
+    float filtwidth = options.conservative_filter ? std::max (sfilt, tfilt)
+                                                  : std::min (sfilt, tfilt);
+    // account for blur
+    return filtwidth + std::max (options.sblur, options.tblur);
+}
+
+
+
 bool
 TextureSystemImpl::texture_lookup_trilinear_mipmap (TextureFile &texturefile,
                             PerThreadInfo *thread_info,
@@ -1308,12 +1850,7 @@ TextureSystemImpl::texture_lookup_trilinear_mipmap (TextureFile &texturefile,
     //    data(miplevel[0]) * (1-levelblend) + data(miplevel[1]) * levelblend
     int miplevel[2] = { -1, -1 };
     float levelweight[2] = { 0, 0 };
-    float sfilt = std::max (fabsf(dsdx), fabsf(dsdy));
-    float tfilt = std::max (fabsf(dtdx), fabsf(dtdy));
-    float filtwidth = options.conservative_filter ? std::max (sfilt, tfilt)
-                                                  : std::min (sfilt, tfilt);
-    // account for blur
-    filtwidth += std::max (options.sblur, options.tblur);
+    float filtwidth = trilinear_filtwidth (options, dsdx, dtdx, dsdy, dtdy);
     float aspect = 1.0f;
     compute_miplevels (texturefile, options, filtwidth, filtwidth, aspect,
                        miplevel, levelweight);
@@ -1490,6 +2027,25 @@ compute_ellipse_sampling (float aspect, float theta,
 
 
 
+void
+TextureSystemImpl::ellipse_miplevels (TextureFile &texturefile,
+                                      TextureOpt &options,
+                                      float dsdx, float dtdx,
+                                      float dsdy, float dtdy, float levelscale,
+                                      float &majorlength, float &minorlength,
+                                      float &theta, float &aspect,
+                                      float &trueaspect, int *miplevel,
+                                      float *levelweight)
+{
+    ellipse_axes (dsdx, dtdx, dsdy, dtdy, majorlength, minorlength, theta);
+    adjust_blur (majorlength, minorlength, theta, options.sblur, options.tblur);
+    aspect = anisotropic_aspect (majorlength, minorlength, options, trueaspect);
+    compute_miplevels (texturefile, options, majorlength / levelscale,
+                       minorlength / levelscale, aspect, miplevel, levelweight);
+}
+
+
+
 bool
 TextureSystemImpl::texture_lookup (TextureFile &texturefile,
                             PerThreadInfo *thread_info,
@@ -1524,16 +2080,11 @@ TextureSystemImpl::texture_lookup (TextureFile &texturefile,
     // better, but for scenes with lots of grazing angles, it can greatly
     // increase the average anisotropy, therefore the number of bilinear
     // or bicubic texture probes, and therefore runtime!
-    ellipse_axes (dsdx, dtdx, dsdy, dtdy, majorlength, minorlength, theta);
-
-    adjust_blur (majorlength, minorlength, theta, options.sblur, options.tblur);
-
     float aspect, trueaspect;
-    aspect = anisotropic_aspect (majorlength, minorlength, options, trueaspect);
-
     int miplevel[2] = { -1, -1 };
     float levelweight[2] = { 0, 0 };
-    compute_miplevels (texturefile, options, majorlength, minorlength, aspect,
+    ellipse_miplevels (texturefile, options, dsdx, dtdx, dsdy, dtdy, 1.0f,
+                       majorlength, minorlength, theta, aspect, trueaspect,
                        miplevel, levelweight);
 
     float *lineweight = ALLOCA (float, round_to_multiple_of_pow2(2*options.anisotropic, 4));
@@ -1658,6 +2209,423 @@ TextureSystemImpl::texture_lookup (TextureFile &texturefile,
 
 
 
+namespace {
+
+// Gaussian weights for the EWA filter, indexed by the squared elliptical
+// radius r^2 in [0,1).  The falloff matches what compute_ellipse_sampling
+// uses along the major axis.
+struct EWAWeightTable {
+    enum { size = 128 };
+    float w[size];
+    EWAWeightTable () {
+        for (int i = 0;  i < size;  ++i)
+            w[i] = expf (-2.0f * (i + 0.5f) / size);
+    }
+};
+static EWAWeightTable ewa_weights;
+
+}  // end anonymous namespace
+
+
+
+// Semi-axis vectors a (major) and b (minor) of the EWA ellipse, in the
+// texel coordinates of a level with resolution (sres,tres).  Never let
+// either axis be shorter than one texel, or the ellipse might fall
+// between texel centers.
+inline void
+ewa_axes (float majorlength, float minorlength, float costheta,
+          float sintheta, float sres, float tres,
+          float &ax, float &ay, float &bx, float &by)
+{
+    ax = 0.5f * majorlength * costheta * sres;
+    ay = 0.5f * majorlength * sintheta * tres;
+    bx = -0.5f * minorlength * sintheta * sres;
+    by = 0.5f * minorlength * costheta * tres;
+    float alen = sqrtf (ax*ax + ay*ay), blen = sqrtf (bx*bx + by*by);
+    if (alen < 1.0e-6f || blen < 1.0e-6f) {
+        ax = 1.0f;  ay = 0.0f;  bx = 0.0f;  by = 1.0f;
+    } else {
+        if (alen < 1.0f) { ax /= alen;  ay /= alen; }
+        if (blen < 1.0f) { bx /= blen;  by /= blen; }
+    }
+}
+
+
+
+// Half-extents in texels of the bounding box of the EWA ellipse with the
+// given semi-axes.  aniso clamping already bounds its size, but guard
+// against runaway loops anyway.
+inline void
+ewa_extent (const TextureOpt &options, float ax, float ay, float bx, float by,
+            float &sext, float &text)
+{
+    float maxext = 4.0f * options.anisotropic + 4.0f;
+    sext = std::min (sqrtf (ax*ax + bx*bx), maxext);
+    text = std::min (sqrtf (ay*ay + by*by), maxext);
+}
+
+
+
+bool
+TextureSystemImpl::texture_lookup_ewa (TextureFile &texturefile,
+                            PerThreadInfo *thread_info,
+                            TextureOpt &options,
+                            int nchannels_result, int actualchannels,
+                            float s, float t,
+                            float dsdx, float dtdx,
+                            float dsdy, float dtdy,
+                            float *result, float *dresultds, float *dresultdt)
+{
+    DASSERT ((dresultds == NULL) == (dresultdt == NULL));
+    // The EWA filter doesn't compute derivatives of the result, so use
+    // the line-of-probes anisotropic filter when they're requested.
+    if (dresultds)
+        return texture_lookup (texturefile, thread_info, options,
+                               nchannels_result, actualchannels,
+                               s, t, dsdx, dtdx, dsdy, dtdy,
+                               result, dresultds, dresultdt);
+
+    adjust_width (dsdx, dtdx, dsdy, dtdy, options.swidth, options.twidth);
+
+    // Pick the level(s) where the minor axis spans about 1/ewa_quality of
+    // a texel.  sample_ewa never lets the ellipse get narrower than one
+    // texel, so lower quality means coarser levels and fewer texels.
+    float majorlength, minorlength, theta;
+    float aspect, trueaspect;
+    int miplevel[2] = { -1, -1 };
+    float levelweight[2] = { 0, 0 };
+    ellipse_miplevels (texturefile, options, dsdx, dtdx, dsdy, dtdy,
+                       m_ewa_quality, majorlength, minorlength, theta,
+                       aspect, trueaspect, miplevel, levelweight);
+    float sintheta, costheta;
+    sincos (theta, &sintheta, &costheta);
+
+    bool ok = true;
+    int npointson = 0, ntexels = 0;
+    float4 r_sum;
+    r_sum.clear();
+    for (int level = 0;  level < 2;  ++level) {
+        if (! levelweight[level])  // No contribution from this level, skip it
+            continue;
+        ++npointson;
+        float4 r;
+        int n = 0;
+        ok &= sample_ewa (s, t, majorlength, minorlength, costheta, sintheta,
+                          miplevel[level], texturefile, thread_info, options,
+                          nchannels_result, actualchannels, &r, n);
+        ntexels += n;
+        r_sum += float4(levelweight[level]) * r;
+    }
+    *(simd::float4 *)(result) = r_sum;
+
+    // Update stats
+    ImageCacheStatistics &stats (thread_info->m_stats);
+    stats.aniso_queries += npointson;
+    stats.aniso_probes += ntexels;
+    if (trueaspect > stats.max_aniso)
+        stats.max_aniso = trueaspect;
+    stats.closest_interps += ntexels;
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::sample_ewa (float s, float t,
+                               float majorlength, float minorlength,
+                               float costheta, float sintheta, int miplevel,
+                               TextureFile &texturefile,
+                               PerThreadInfo *thread_info,
+                               TextureOpt &options,
+                               int nchannels_result, int actualchannels,
+                               float4 *accum_, int &ntexels)
+{
+    const ImageSpec &spec (texturefile.spec (options.subimage, miplevel));
+    const ImageCacheFile::LevelInfo &levelinfo (texturefile.levelinfo(options.subimage,miplevel));
+    float4 (*load) (const unsigned char *);
+    switch (texturefile.pixeltype(options.subimage)) {
+    case TypeDesc::UINT8  : load = load_texel4<unsigned char>;  break;
+    case TypeDesc::UINT16 : load = load_texel4<unsigned short>; break;
+    case TypeDesc::HALF   : load = load_texel4<half>;           break;
+    default               : load = load_texel4<float>;          break;
+    }
+    wrap_impl swrap_func = wrap_functions[(int)options.swrap];
+    wrap_impl twrap_func = wrap_functions[(int)options.twrap];
+    size_t channelsize = texturefile.channelsize(options.subimage);
+    int tile_chbegin = 0, tile_chend = spec.nchannels;
+    if (spec.nchannels > m_max_tile_channels) {
+        // For files with many channels, narrow the range we cache
+        tile_chbegin = options.firstchannel;
+        tile_chend = options.firstchannel+actualchannels;
+    }
+    TileID id (texturefile, options.subimage, miplevel, 0, 0, 0,
+               tile_chbegin, tile_chend);
+    int chanoffset = (options.firstchannel - id.chbegin()) * channelsize;
+
+    // Ellipse center and semi-axis vectors a (major) and b (minor), in
+    // the texel coordinates of this level (same mapping as st_to_texel).
+    float sres = spec.width, tres = spec.height;
+    float sc, tc;
+    if (texturefile.m_sample_border == 0) {
+        sc = s * sres + spec.x - 0.5f;
+        tc = t * tres + spec.y - 0.5f;
+    } else {
+        sres -= 1.0f;  tres -= 1.0f;
+        sc = s * sres + spec.x;
+        tc = t * tres + spec.y;
+    }
+    float ax, ay, bx, by;
+    ewa_axes (majorlength, minorlength, costheta, sintheta, sres, tres,
+              ax, ay, bx, by);
+    // With p = u*a + v*b, the ellipse is u^2 + v^2 < 1, which expands to
+    // A*x^2 + B*x*y + C*y^2 < 1 for the texel offset (x,y) from center.
+    float det = ax * by - ay * bx;
+    float invdet2 = 1.0f / (det * det);
+    float A = (ay*ay + by*by) * invdet2;
+    float B = -2.0f * (ax*ay + bx*by) * invdet2;
+    float C = (ax*ax + bx*bx) * invdet2;
+    float sext, text;
+    ewa_extent (options, ax, ay, bx, by, sext, text);
+    int x0 = (int) ceilf (sc - sext), x1 = (int) floorf (sc + sext);
+    int y0 = (int) ceilf (tc - text), y1 = (int) floorf (tc + text);
+
+    float4 accum;
+    accum.clear();
+    float sumw = 0.0f, validw = 0.0f;
+    int n = 0;
+    bool allok = true;
+    static OIIO_SIMD4_ALIGN const float iota_start[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const float4 iota (iota_start);
+    const float4 A4 (A), C4 (C), one (1.0f), lutscale (float(EWAWeightTable::size));
+    for (int y = y0;  y <= y1;  ++y) {
+        float dy = float(y) - tc;
+        float4 By = float4(B * dy), Cyy = C4 * float4(dy * dy);
+        int ty = y;
+        bool tvalid = twrap_func (ty, spec.y, spec.height);
+        if (! levelinfo.full_pixel_range)
+            tvalid &= (ty >= spec.y && ty < (spec.y+spec.height));
+        for (int x = x0;  x <= x1;  x += 4) {
+            // Evaluate the ellipse equation for 4 texels at once.
+            float4 dx = iota + float4(float(x) - sc);
+            float4 r2 = (A4 * dx + By) * dx + Cyy;
+            mask4 inside = (r2 < one) & (dx <= float4(float(x1) - sc));
+            if (none (inside))
+                continue;
+            int4 index = int4 (r2 * lutscale);
+            for (int k = 0;  k < 4;  ++k) {
+                if (! inside[k])
+                    continue;
+                float w = ewa_weights.w[index[k]];
+                sumw += w;
+                int tx = x + k;
+                bool svalid = swrap_func (tx, spec.x, spec.width);
+                if (! levelinfo.full_pixel_range)
+                    svalid &= (tx >= spec.x && tx < (spec.x+spec.width));
+                if (! (svalid & tvalid))
+                    continue;   // black wrap: weight counts, color doesn't
+                int tile_s = (tx - spec.x) % spec.tile_width;
+                int tile_t = (ty - spec.y) % spec.tile_height;
+                id.xy (tx - tile_s, ty - tile_t);
+                bool ok = find_tile (id, thread_info);
+                if (! ok)
+                    error ("%s", m_imagecache->geterror());
+                TileRef &tile (thread_info->tile);
+                if (! tile  ||  ! ok) {
+                    allok = false;
+                    continue;
+                }
+                int offset = tile->pixelsize() * (tile_t * spec.tile_width + tile_s)
+                           + chanoffset;
+                accum += float4(w) * load (tile->bytedata() + offset);
+                validw += w;
+                ++n;
+            }
+        }
+    }
+    ntexels = n;
+
+    float norm = sumw > 0.0f ? 1.0f / sumw : 0.0f;
+    simd::mask4 channel_mask = channel_masks[actualchannels];
+    accum = blend0(accum * float4(norm), channel_mask);
+    float filled = validw * norm;
+    if (filled > 0.0f && nchannels_result > actualchannels && options.fill) {
+        // Add the weighted fill color
+        accum += blend0not(float4(filled * options.fill), channel_mask);
+    }
+    *accum_ = accum;
+    return allok;
+}
+
+
+
+bool
+TextureSystemImpl::texture_footprint (ustring filename, TextureOpt &options,
+                                      float s, float t, float dsdx, float dtdx,
+                                      float dsdy, float dtdy,
+                                      TextureFootprint &footprint)
+{
+    Perthread *thread_info = get_perthread_info();
+    TextureHandle *texture_handle = get_texture_handle (filename, thread_info);
+    return texture_footprint (texture_handle, thread_info, options,
+                              s, t, dsdx, dtdx, dsdy, dtdy, footprint);
+}
+
+
+
+bool
+TextureSystemImpl::texture_footprint (TextureHandle *texture_handle_,
+                                      Perthread *thread_info_,
+                                      TextureOpt &options,
+                                      float s, float t, float dsdx, float dtdx,
+                                      float dsdy, float dtdy,
+                                      TextureFootprint &footprint)
+{
+    footprint = TextureFootprint();
+    PerThreadInfo *thread_info = m_imagecache->get_perthread_info((PerThreadInfo *)thread_info_);
+    TextureFile *texturefile = (TextureFile *)texture_handle_;
+    if (texturefile && texturefile->is_udim())
+        texturefile = m_imagecache->resolve_udim (texturefile, s, t);
+    texturefile = verify_texturefile (texturefile, thread_info);
+    if (! texturefile  ||  texturefile->broken())
+        return false;
+
+    // The same st and option setup as texture().
+    TextureOpt opt (options);
+    if (opt.subimagename) {
+        int si = m_imagecache->subimage_from_name (texturefile, opt.subimagename);
+        if (si < 0) {
+            error ("Unknown subimage \"%s\" in texture \"%s\"",
+                   opt.subimagename, texturefile->filename());
+            return false;
+        }
+        opt.subimage = si;
+        opt.subimagename.clear();
+    }
+    if (opt.subimage < 0 || opt.subimage >= texturefile->subimages()) {
+        error ("Unknown subimage %d in texture \"%s\"",
+               opt.subimage, texturefile->filename());
+        return false;
+    }
+    footprint.filename = texturefile->filename();
+    footprint.subimage = opt.subimage;
+    const ImageCacheFile::SubimageInfo &subinfo (texturefile->subimageinfo(opt.subimage));
+    if (opt.swrap == TextureOpt::WrapDefault)
+        opt.swrap = (TextureOpt::Wrap)texturefile->swrap();
+    if (opt.twrap == TextureOpt::WrapDefault)
+        opt.twrap = (TextureOpt::Wrap)texturefile->twrap();
+    if (subinfo.is_constant_image && opt.swrap != TextureOpt::WrapBlack &&
+          opt.twrap != TextureOpt::WrapBlack)
+        return true;   // Answered from the average color, reads no tiles
+    if (m_flip_t) {
+        t = 1.0f - t;
+        dtdx *= -1.0f;
+        dtdy *= -1.0f;
+    }
+    if (! subinfo.full_pixel_range) {  // remap st for overscan or crop
+        s = s * subinfo.sscale + subinfo.soffset;
+        dsdx *= subinfo.sscale;
+        dsdy *= subinfo.sscale;
+        t = t * subinfo.tscale + subinfo.toffset;
+        dtdx *= subinfo.tscale;
+        dtdy *= subinfo.tscale;
+    }
+
+    // Choose levels exactly as the lookup function for this mip mode
+    // does, and find how far from (s,t) its samples reach.
+    int miplevel[2] = { -1, -1 };
+    float levelweight[2] = { 0, 0 };
+    float sradius = 0.0f, tradius = 0.0f;   // in st units
+    bool ewa = false;
+    float majorlength = 0.0f, minorlength = 0.0f, theta = 0.0f;
+    switch (opt.mipmode) {
+    case TextureOpt::MipModeNoMIP :
+        miplevel[0] = 0;
+        levelweight[0] = 1.0f;
+        break;
+    case TextureOpt::MipModeOneLevel :
+    case TextureOpt::MipModeTrilinear : {
+        adjust_width (dsdx, dtdx, dsdy, dtdy, opt.swidth, opt.twidth);
+        float filtwidth = trilinear_filtwidth (opt, dsdx, dtdx, dsdy, dtdy);
+        float aspect = 1.0f;
+        compute_miplevels (*texturefile, opt, filtwidth, filtwidth, aspect,
+                           miplevel, levelweight);
+        break;
+    }
+    case TextureOpt::MipModeEWA :
+        ewa = true;
+        // FALLTHROUGH
+    default : {
+        adjust_width (dsdx, dtdx, dsdy, dtdy, opt.swidth, opt.twidth);
+        float aspect, trueaspect;
+        ellipse_miplevels (*texturefile, opt, dsdx, dtdx, dsdy, dtdy,
+                           ewa ? m_ewa_quality : 1.0f, majorlength,
+                           minorlength, theta, aspect, trueaspect,
+                           miplevel, levelweight);
+        if (! ewa) {
+            float smajor, tmajor, invsamples;
+            compute_ellipse_sampling (aspect, theta, majorlength, minorlength,
+                                      smajor, tmajor, invsamples);
+            // Samples are at s + p*smajor/2, |p| <= 1-invsamples
+            sradius = 0.5f * fabsf(smajor) * (1.0f - invsamples);
+            tradius = 0.5f * fabsf(tmajor) * (1.0f - invsamples);
+        }
+        break;
+    }
+    }
+
+    for (int level = 0;  level < 2;  ++level) {
+        if (! levelweight[level])
+            continue;
+        int lev = miplevel[level];
+        const ImageSpec &spec (texturefile->spec (opt.subimage, lev));
+        float sres = spec.width, tres = spec.height;
+        float sc = s * sres + spec.x - 0.5f, tc = t * tres + spec.y - 0.5f;
+        if (texturefile->m_sample_border) {
+            sres -= 1.0f;  tres -= 1.0f;
+            sc = s * sres + spec.x;
+            tc = t * tres + spec.y;
+        }
+        float sext = sradius * sres, text = tradius * tres;
+        if (ewa) {
+            float sintheta, costheta, ax, ay, bx, by;
+            sincos (theta, &sintheta, &costheta);
+            ewa_axes (majorlength, minorlength, costheta, sintheta,
+                      sres, tres, ax, ay, bx, by);
+            ewa_extent (opt, ax, ay, bx, by, sext, text);
+        }
+        // Widen by the reach of a bicubic kernel, which covers the
+        // closest and bilinear ones as well.
+        int tw = std::max (spec.tile_width, 1), th = std::max (spec.tile_height, 1);
+        int xbegin = ifloor (sc - sext) - 1, xend = ifloor (sc + sext) + 3;
+        int ybegin = ifloor (tc - text) - 1, yend = ifloor (tc + text) + 3;
+        xbegin = std::max (xbegin, spec.x);
+        ybegin = std::max (ybegin, spec.y);
+        xend = std::min (xend, spec.x + spec.width);
+        yend = std::min (yend, spec.y + spec.height);
+        if (xbegin >= xend || ybegin >= yend) {
+            // Entirely outside the data window: only wrapping brings it
+            // back in, so conservatively report the whole level.
+            xbegin = spec.x;  xend = spec.x + spec.width;
+            ybegin = spec.y;  yend = spec.y + spec.height;
+        }
+        // Round out to tile boundaries.
+        xbegin = spec.x + ((xbegin - spec.x) / tw) * tw;
+        ybegin = spec.y + ((ybegin - spec.y) / th) * th;
+        xend = spec.x + std::min (((xend - spec.x + tw - 1) / tw) * tw, spec.width);
+        yend = spec.y + std::min (((yend - spec.y + th - 1) / th) * th, spec.height);
+        int n = footprint.nlevels++;
+        footprint.miplevel[n] = lev;
+        footprint.levelweight[n] = levelweight[level];
+        footprint.xbegin[n] = xbegin;  footprint.xend[n] = xend;
+        footprint.ybegin[n] = ybegin;  footprint.yend[n] = yend;
+        footprint.ntiles[n] = ((xend - xbegin + tw - 1) / tw) *
+                              ((yend - ybegin + th - 1) / th);
+    }
+    return true;
+}
+
+
+
 const float *
 TextureSystemImpl::pole_color (TextureFile &texturefile,
                                PerThreadInfo *thread_info,
@@ -1922,10 +2890,49 @@ TextureSystemImpl::sample_bilinear (int nsamples, const float *s_,
                                     int nchannels_result, int actualchannels,
                                     const float *weight_,
                                     float4 *accum_, float4 *daccumds_, float4 *daccumdt_)
+{
+    // Pick the kernel for this texel type and channel count, so that the
+    // per-sample loop doesn't have to branch on them.
+#define BILINEAR_KERNELS(T) \
+        { &TextureSystemImpl::sample_bilinear_kernel<T,0>, \
+          &TextureSystemImpl::sample_bilinear_kernel<T,1>, \
+          &TextureSystemImpl::sample_bilinear_kernel<T,3>, \
+          &TextureSystemImpl::sample_bilinear_kernel<T,4> }
+    static const sampler_prototype kernels[4][4] = {
+        BILINEAR_KERNELS(unsigned char), BILINEAR_KERNELS(unsigned short),
+        BILINEAR_KERNELS(half), BILINEAR_KERNELS(float)
+    };
+#undef BILINEAR_KERNELS
+    int typeindex;
+    switch (texturefile.pixeltype(options.subimage)) {
+    case TypeDesc::UINT8  : typeindex = 0; break;
+    case TypeDesc::UINT16 : typeindex = 1; break;
+    case TypeDesc::HALF   : typeindex = 2; break;
+    default               : typeindex = 3; break;
+    }
+    int chanindex = actualchannels == 1 ? 1 : actualchannels == 3 ? 2
+                  : actualchannels == 4 ? 3 : 0;
+    return (this->*kernels[typeindex][chanindex])
+               (nsamples, s_, t_, miplevel, texturefile, thread_info, options,
+                nchannels_result, actualchannels, weight_,
+                accum_, daccumds_, daccumdt_);
+}
+
+
+
+template<typename T, int NCH>
+bool
+TextureSystemImpl::sample_bilinear_kernel (int nsamples, const float *s_,
+                                    const float *t_, int miplevel,
+                                    TextureFile &texturefile,
+                                    PerThreadInfo *thread_info,
+                                    TextureOpt &options,
+                                    int nchannels_result, int actualchannels,
+                                    const float *weight_,
+                                    float4 *accum_, float4 *daccumds_, float4 *daccumdt_)
 {
     const ImageSpec &spec (texturefile.spec (options.subimage, miplevel));
     const ImageCacheFile::LevelInfo &levelinfo (texturefile.levelinfo(options.subimage,miplevel));
-    TypeDesc::BASETYPE pixeltype = texturefile.pixeltype(options.subimage);
     wrap_impl swrap_func = wrap_functions[(int)options.swrap];
     wrap_impl twrap_func = wrap_functions[(int)options.twrap];
     wrap_impl_simd wrap_func = (swrap_func == twrap_func) ? wrap_functions_simd[(int)options.swrap] : NULL;
@@ -2012,6 +3019,7 @@ TextureSystemImpl::sample_bilinear (int nsamples, const float *s_,
         bool s_onetile = (tile_st[S0] != tilewhmask[S0]) & (sttex[S0]+1 == sttex[S1]);
         bool t_onetile = (tile_st[T0] != tilewhmask[T0]) & (sttex[T0]+1 == sttex[T1]);
         bool onetile = (s_onetile & t_onetile);
+        bool constant = false;
         if (onetile && all(stvalid)) {
             // Shortcut if all the texels we need are on the same tile
             id.xy (sttex[S0] - tile_st[S0], sttex[T0] - tile_st[T0]);
@@ -2025,31 +3033,14 @@ TextureSystemImpl::sample_bilinear (int nsamples, const float *s_,
             int offset = pixelsize * (tile_st[T0] * spec.tile_width + tile_st[S0]);
             const unsigned char *p = tile->bytedata() + offset 
                                    + channelsize * (firstchannel - id.chbegin());
-            if (pixeltype == TypeDesc::UINT8) {
-                texel_simd[0][0] = uchar2float4 (p);
-                texel_simd[0][1] = uchar2float4 (p+pixelsize);
-                p += pixelsize * spec.tile_width;
-                texel_simd[1][0] = uchar2float4 (p);
-                texel_simd[1][1] = uchar2float4 (p+pixelsize);
-            } else if (pixeltype == TypeDesc::UINT16) {
-                texel_simd[0][0] = ushort2float4 ((uint16_t *)p);
-                texel_simd[0][1] = ushort2float4 ((uint16_t *)(p+pixelsize));
-                p += pixelsize * spec.tile_width;
-                texel_simd[1][0] = ushort2float4 ((uint16_t *)p);
-                texel_simd[1][1] = ushort2float4 ((uint16_t *)(p+pixelsize));
-            } else if (pixeltype == TypeDesc::HALF) {
-                texel_simd[0][0] = half2float4 ((half *)p);
-                texel_simd[0][1] = half2float4 ((half *)(p+pixelsize));
+            texel_simd[0][0] = load_texel<T,NCH> (p);
+            // A constant tile needs just the one texel, and no filtering
+            constant = tile->constant();
+            if (! constant) {
+                texel_simd[0][1] = load_texel<T,NCH> (p+pixelsize);
                 p += pixelsize * spec.tile_width;
-                texel_simd[1][0] = half2float4 ((half *)p);
-                texel_simd[1][1] = half2float4 ((half *)(p+pixelsize));
-            } else {
-                DASSERT (pixeltype == TypeDesc::FLOAT);
-                texel_simd[0][0].load ((const float *)p);
-                texel_simd[0][1].load ((const float *)(p+pixelsize));
-                p += pixelsize * spec.tile_width;
-                texel_simd[1][0].load ((const float *)p);
-                texel_simd[1][1].load ((const float *)(p+pixelsize));
+                texel_simd[1][0] = load_texel<T,NCH> (p);
+                texel_simd[1][1] = load_texel<T,NCH> (p+pixelsize);
             }
         } else {
             bool noreusetile = (options.swrap == TextureOpt::WrapMirror);
@@ -2087,16 +3078,7 @@ TextureSystemImpl::sample_bilinear (int nsamples, const float *s_,
                     int offset = pixelsize * (tile_t * spec.tile_width + tile_s);
                     offset += (firstchannel - id.chbegin()) * channelsize;
                     DASSERT (offset < spec.tile_width*spec.tile_height*spec.tile_depth*pixelsize);
-                    if (pixeltype == TypeDesc::UINT8)
-                        texel_simd[j][i] = uchar2float4 ((const unsigned char *)(tile->bytedata() + offset));
-                    else if (pixeltype == TypeDesc::UINT16)
-                        texel_simd[j][i] = ushort2float4 ((const unsigned short *)(tile->bytedata() + offset));
-                    else if (pixeltype == TypeDesc::HALF)
-                        texel_simd[j][i] = half2float4 ((const half *)(tile->bytedata() + offset));
-                    else {
-                        DASSERT (pixeltype == TypeDesc::FLOAT);
-                        texel_simd[j][i].load ((const float *)(tile->bytedata() + offset));
-                    }
+                    texel_simd[j][i] = load_texel<T,NCH> (tile->bytedata() + offset);
                 }
             }
         }
@@ -2115,6 +3097,11 @@ TextureSystemImpl::sample_bilinear (int nsamples, const float *s_,
         }
     
         simd::float4 weight_simd = weight;
+        if (constant) {
+            // All texels valid and equal: no fill, zero derivatives
+            accum += weight_simd * texel_simd[0][0];
+            continue;
+        }
         accum += weight_simd * bilerp(texel_simd[0][0], texel_simd[0][1],
                                        texel_simd[1][0], texel_simd[1][1],
                                        sfrac, tfrac);
@@ -2361,6 +3348,7 @@ TextureSystemImpl::sample_bicubic (int nsamples, const float *s_,
             t_onetile &= all (ttex == (simd::shuffle<0>(ttex)+(*(int4 *)iota)));
         }
         bool onetile = (s_onetile & t_onetile);
+        bool constant = false;
         if (onetile & allvalid) {
             // Shortcut if all the texels we need are on the same tile
             id.xy (stex[0] - tile_s, ttex[0] - tile_t);
@@ -2376,7 +3364,18 @@ TextureSystemImpl::sample_bicubic (int nsamples, const float *s_,
             int offset = pixelsize * (tile_t * spec.tile_width + tile_s);
             const unsigned char *base = tile->bytedata() + offset + firstchannel_offset_bytes;
             DASSERT (tile->data());
-            if (pixeltype == TypeDesc::UINT8) {
+            constant = tile->constant();
+            if (constant) {
+                // A constant tile needs just the one texel, and no filtering
+                if (pixeltype == TypeDesc::UINT8)
+                    texel_simd[0][0] = uchar2float4 (base);
+                else if (pixeltype == TypeDesc::UINT16)
+                    texel_simd[0][0] = ushort2float4 ((const uint16_t *)base);
+                else if (pixeltype == TypeDesc::HALF)
+                    texel_simd[0][0] = half2float4 ((const half *)base);
+                else
+                    texel_simd[0][0].load ((const float *)base);
+            } else if (pixeltype == TypeDesc::UINT8) {
                 for (int j = 0, j_offset = 0;  j < 4;  ++j, j_offset += pixelsize*spec.tile_width)
                     for (int i = 0, i_offset = j_offset;  i < 4;  ++i, i_offset += pixelsize)
                         texel_simd[j][i] = uchar2float4 (base + i_offset);
@@ -2454,6 +3453,11 @@ TextureSystemImpl::sample_bicubic (int nsamples, const float *s_,
                 fade_to_pole (tt, (float *)&accum, weight, texturefile, thread_info,
                               levelinfo, options, miplevel, actualchannels);
         }
+        if (constant) {
+            // All texels valid and equal: no fill, zero derivatives
+            accum += simd::float4(weight) * texel_simd[0][0];
+            continue;
+        }
     
         // We use a formulation of cubic B-spline evaluation that reduces to
         // lerps.  It's tricky to follow, but the references are:
@@ -30,6 +30,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <algorithm>
@@ -42,6 +43,7 @@
 #include "OpenImageIO/ustring.h"
 #include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/refcnt.h"
+#include "OpenImageIO/thread.h"
 
 #ifdef _WIN32
 // # include <windows.h>   // Already done by platform.h
@@ -49,6 +51,7 @@
 # include <direct.h>
 #else
 # include <unistd.h>
+# include <fcntl.h>
 #endif
 
 #include <boost/filesystem.hpp>
@@ -993,4 +996,429 @@ Filesystem::scan_for_matching_filenames(const std::string &pattern_,
     return true;
 }
 
+
+
+static int64_t
+ftell64 (FILE *file)
+{
+#ifdef _MSC_VER
+    return _ftelli64 (file);
+#else
+    return ftello (file);
+#endif
+}
+
+
+
+static int
+fseek64 (FILE *file, int64_t pos)
+{
+#ifdef _MSC_VER
+    return _fseeki64 (file, __int64(pos), SEEK_SET);
+#else
+    return fseeko (file, off_t(pos), SEEK_SET);
+#endif
+}
+
+
+
+Filesystem::IOFile::IOFile (string_view filename, Mode mode)
+    : IOProxy (filename, mode)
+{
+    m_file = Filesystem::fopen (filename, mode == Write ? "wb" : "rb");
+    if (! m_file)
+        m_mode = Closed;
+    m_auto_close = true;
+    if (m_mode == Read)
+        m_size = (size_t) Filesystem::file_size (filename);
+}
+
+
+
+Filesystem::IOFile::IOFile (FILE *file, Mode mode)
+    : IOProxy ("", mode), m_file(file)
+{
+    if (m_mode == Read && m_file) {
+        m_pos = ftell64 (m_file);
+        fseek (m_file, 0, SEEK_END);
+        m_size = (size_t) ftell64 (m_file);
+        fseek64 (m_file, m_pos);
+    }
+}
+
+
+
+Filesystem::IOFile::~IOFile ()
+{
+    if (m_auto_close)
+        close ();
+}
+
+
+
+void
+Filesystem::IOFile::close ()
+{
+    if (m_file) {
+        fclose (m_file);
+        m_file = NULL;
+    }
+    m_auto_close = false;
+    m_mode = Closed;
+}
+
+
+
+bool
+Filesystem::IOFile::seek (int64_t offset)
+{
+    if (! m_file)
+        return false;
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_pos = offset;
+    return fseek64 (m_file, offset) == 0;
+}
+
+
+
+size_t
+Filesystem::IOFile::read (void *buf, size_t size)
+{
+    if (! m_file || ! size || m_mode != Read)
+        return 0;
+    std::lock_guard<std::mutex> lock (m_mutex);
+    size_t r = fread (buf, 1, size, m_file);
+    m_pos += r;
+    return r;
+}
+
+
+
+size_t
+Filesystem::IOFile::write (const void *buf, size_t size)
+{
+    if (! m_file || ! size || m_mode != Write)
+        return 0;
+    std::lock_guard<std::mutex> lock (m_mutex);
+    size_t r = fwrite (buf, 1, size, m_file);
+    m_pos += r;
+    m_size = std::max (m_size, size_t(m_pos));
+    return r;
+}
+
+
+
+size_t
+Filesystem::IOFile::pread (void *buf, size_t size, int64_t offset)
+{
+    if (! m_file || ! size || offset < 0 || m_mode != Read)
+        return 0;
+#ifdef _WIN32
+    // No positional reads on a FILE*, so seek and restore under the lock.
+    std::lock_guard<std::mutex> lock (m_mutex);
+    int64_t origpos = ftell64 (m_file);
+    fseek64 (m_file, offset);
+    size_t r = fread (buf, 1, size, m_file);
+    fseek64 (m_file, origpos);
+    return r;
+#else
+    int fd = fileno (m_file);
+    size_t r = 0;
+    while (r < size) {
+        ssize_t n = ::pread (fd, (char *)buf + r, size - r, off_t(offset + r));
+        if (n <= 0)
+            break;
+        r += size_t(n);
+    }
+    return r;
+#endif
+}
+
+
+
+size_t
+Filesystem::IOFile::pwrite (const void *buf, size_t size, int64_t offset)
+{
+    if (! m_file || ! size || offset < 0 || m_mode != Write)
+        return 0;
+    std::lock_guard<std::mutex> lock (m_mutex);
+    int64_t origpos = ftell64 (m_file);
+    fseek64 (m_file, offset);
+    size_t r = fwrite (buf, 1, size, m_file);
+    fseek64 (m_file, origpos);
+    m_size = std::max (m_size, size_t(offset + r));
+    return r;
+}
+
+
+
+size_t
+Filesystem::IOFile::size () const
+{
+    return m_size;
+}
+
+
+
+void
+Filesystem::IOFile::flush ()
+{
+    if (m_file)
+        fflush (m_file);
+}
+
+
+
+size_t
+Filesystem::IOVecOutput::read (void *buf, size_t size)
+{
+    size = pread (buf, size, m_pos);
+    m_pos += size;
+    return size;
+}
+
+
+
+size_t
+Filesystem::IOVecOutput::write (const void *buf, size_t size)
+{
+    size = pwrite (buf, size, m_pos);
+    m_pos += size;
+    return size;
+}
+
+
+
+size_t
+Filesystem::IOVecOutput::pread (void *buf, size_t size, int64_t offset)
+{
+    std::lock_guard<std::mutex> lock (m_mutex);
+    if (offset < 0 || size_t(offset) >= m_buf.size())
+        return 0;
+    size = std::min (size, m_buf.size() - size_t(offset));
+    memcpy (buf, &m_buf[offset], size);
+    return size;
+}
+
+
+
+size_t
+Filesystem::IOVecOutput::pwrite (const void *buf, size_t size, int64_t offset)
+{
+    if (offset < 0 || ! size)
+        return 0;
+    std::lock_guard<std::mutex> lock (m_mutex);
+    if (m_buf.size() < size_t(offset) + size)
+        m_buf.resize (size_t(offset) + size);
+    memcpy (&m_buf[offset], buf, size);
+    return size;
+}
+
+
+
+size_t
+Filesystem::IOMemReader::read (void *buf, size_t size)
+{
+    size = pread (buf, size, m_pos);
+    m_pos += size;
+    return size;
+}
+
+
+
+size_t
+Filesystem::IOMemReader::pread (void *buf, size_t size, int64_t offset)
+{
+    if (offset < 0 || size_t(offset) >= m_size)
+        return 0;
+    size = std::min (size, m_size - size_t(offset));
+    memcpy (buf, m_buf + offset, size);
+    return size;
+}
+
+
+
+class Filesystem::SequenceReadahead::Impl {
+public:
+    struct Frame {
+        bool started = false;
+        size_t bytes = 0;                  // counted against the limit
+        std::future<void> done;            // valid while a read is queued
+        std::vector<unsigned char> data;   // whole file, if buffering
+        std::unique_ptr<IOMemReader> proxy;
+    };
+
+    Impl (const std::vector<std::string> &filenames, int frames_ahead,
+          size_t memory_limit, bool buffer)
+        : m_filenames(filenames), m_frames(filenames.size()),
+          m_frames_ahead(frames_ahead), m_memory_limit(memory_limit),
+          m_buffer(buffer) {}
+
+    ~Impl () {
+        for (auto& f : m_frames)
+            wait (f);
+    }
+
+    // Wait for the frame's read to finish, helping out with the pool's
+    // queue meanwhile (which also covers a pool with no worker threads).
+    static void wait (Frame &f) {
+        if (! f.done.valid())
+            return;
+        while (f.done.wait_for (std::chrono::milliseconds(0))
+                   != std::future_status::ready) {
+            if (! default_thread_pool()->run_one_task())
+                yield ();
+        }
+        f.done.get ();
+    }
+
+    void start (int index) {
+        Frame &f (m_frames[index]);
+        f.bytes = (size_t) Filesystem::file_size (m_filenames[index]);
+        if (m_bytes_ahead + f.bytes > m_memory_limit)
+            return;   // try again when earlier frames are released
+        f.started = true;
+        m_bytes_ahead += f.bytes;
+        Frame *frame = &f;
+        const std::string *filename = &m_filenames[index];
+        bool buffer = m_buffer;
+        f.done = default_thread_pool()->push ([=](int /*id*/){
+            fetch (*filename, *frame, buffer);
+        });
+    }
+
+    void release (int index) {
+        Frame &f (m_frames[index]);
+        if (! f.started)
+            return;
+        wait (f);
+        f.proxy.reset ();
+        std::vector<unsigned char>().swap (f.data);
+        m_bytes_ahead -= f.bytes;
+        f.started = false;
+    }
+
+    static void fetch (const std::string &filename, Frame &f, bool buffer) {
+        if (buffer) {
+            f.data.resize (f.bytes);
+            size_t n = f.bytes ? read_bytes (filename, &f.data[0], f.bytes) : 0;
+            if (n != f.bytes)
+                std::vector<unsigned char>().swap (f.data);
+            return;
+        }
+#if defined(POSIX_FADV_WILLNEED)
+        // Let the OS read the file into its cache asynchronously.
+        int fd = ::open (filename.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+            ::close (fd);
+        }
+#else
+        // No way to hint, so read it through to warm the OS cache.
+        if (FILE *file = Filesystem::fopen (filename, "rb")) {
+            std::unique_ptr<char[]> scratch (new char [1<<20]);
+            while (fread (scratch.get(), 1, 1<<20, file) == (1<<20))
+                ;
+            fclose (file);
+        }
+#endif
+    }
+
+    std::vector<std::string> m_filenames;
+    std::vector<Frame> m_frames;
+    int m_frames_ahead;
+    size_t m_memory_limit;
+    bool m_buffer;
+    size_t m_bytes_ahead = 0;
+};
+
+
+
+Filesystem::SequenceReadahead::SequenceReadahead (
+        const std::vector<std::string> &filenames, int frames_ahead,
+        size_t memory_limit, bool buffer)
+    : m_impl (new Impl (filenames, frames_ahead, memory_limit, buffer))
+{
+}
+
+
+
+Filesystem::SequenceReadahead::SequenceReadahead (
+        const std::string &pattern, string_view framespec,
+        int frames_ahead, size_t memory_limit, bool buffer)
+{
+    std::vector<int> numbers;
+    std::vector<std::string> filenames;
+    if (enumerate_sequence (framespec, numbers))
+        enumerate_file_sequence (pattern, numbers, filenames);
+    m_impl.reset (new Impl (filenames, frames_ahead, memory_limit, buffer));
+}
+
+
+
+Filesystem::SequenceReadahead::~SequenceReadahead ()
+{
+}
+
+
+
+int
+Filesystem::SequenceReadahead::nframes () const
+{
+    return (int) m_impl->m_filenames.size();
+}
+
+
+
+const std::string&
+Filesystem::SequenceReadahead::filename (int index) const
+{
+    return m_impl->m_filenames[index];
+}
+
+
+
+void
+Filesystem::SequenceReadahead::advance (int index)
+{
+    Impl &impl (*m_impl);
+    int n = nframes();
+    int last = std::min (index + impl.m_frames_ahead, n - 1);
+    // Drop whatever is outside the window, including frames left behind
+    // by a jump backwards.
+    for (int i = 0; i < n; ++i)
+        if (i < index || i > last)
+            impl.release (i);
+    for (int i = std::max (index, 0) + 1; i <= last; ++i)
+        if (! impl.m_frames[i].started)
+            impl.start (i);
+}
+
+
+
+Filesystem::IOProxy*
+Filesystem::SequenceReadahead::ioproxy (int index)
+{
+    Impl &impl (*m_impl);
+    if (! impl.m_buffer || index < 0 || index >= nframes())
+        return NULL;
+    Impl::Frame &f (impl.m_frames[index]);
+    if (! f.started)
+        return NULL;
+    Impl::wait (f);
+    if (f.data.size() != f.bytes || ! f.bytes)
+        return NULL;   // the read failed
+    if (! f.proxy)
+        f.proxy.reset (new IOMemReader (&f.data[0], f.data.size()));
+    return f.proxy.get();
+}
+
+
+
+size_t
+Filesystem::SequenceReadahead::bytes_ahead () const
+{
+    return m_impl->m_bytes_ahead;
+}
+
 OIIO_NAMESPACE_END
@@ -441,6 +441,98 @@ void test_scan_sequences ()
 
 
 
+void test_ioproxy ()
+{
+    std::cout << "Testing IOProxy:\n";
+    const char *text = "Now is the time for all good men";
+    size_t len = strlen (text);
+
+    // Write to a vector, read it back through a memory reader
+    std::vector<unsigned char> buf;
+    Filesystem::IOVecOutput vecout (buf);
+    OIIO_CHECK_EQUAL (vecout.write (text, 7), 7);
+    OIIO_CHECK_EQUAL (vecout.write (text+7, len-7), len-7);
+    OIIO_CHECK_EQUAL (buf.size(), len);
+    OIIO_CHECK_EQUAL (vecout.pwrite ("N", 1, 0), 1);
+    OIIO_CHECK_EQUAL (vecout.tell(), (int64_t)len);
+
+    Filesystem::IOMemReader mem (&buf[0], buf.size());
+    char in[64] = { 0 };
+    OIIO_CHECK_EQUAL (mem.read (in, 3), 3);
+    OIIO_CHECK_EQUAL (std::string(in, 3), "Now");
+    OIIO_CHECK_EQUAL (mem.pread (in, 4, 7), 4);
+    OIIO_CHECK_EQUAL (std::string(in, 4), "the ");
+    OIIO_CHECK_EQUAL (mem.tell(), 3);
+    OIIO_CHECK_ASSERT (mem.seek (-3, SEEK_END));
+    OIIO_CHECK_EQUAL (mem.read (in, 10), 3);
+    OIIO_CHECK_EQUAL (std::string(in, 3), "men");
+
+    // Round trip through a real file
+    {
+        Filesystem::IOFile out ("testioproxy", Filesystem::IOProxy::Write);
+        OIIO_CHECK_ASSERT (out.opened());
+        OIIO_CHECK_EQUAL (out.write (text, len), len);
+    }
+    Filesystem::IOFile file ("testioproxy", Filesystem::IOProxy::Read);
+    OIIO_CHECK_ASSERT (file.opened());
+    OIIO_CHECK_EQUAL (file.size(), len);
+    OIIO_CHECK_EQUAL (file.pread (in, 4, 11), 4);
+    OIIO_CHECK_EQUAL (std::string(in, 4), "time");
+    OIIO_CHECK_EQUAL (file.read (in, 3), 3);
+    OIIO_CHECK_EQUAL (std::string(in, 3), "Now");
+    file.close ();
+    Filesystem::remove ("testioproxy");
+}
+
+
+
+void test_sequence_readahead ()
+{
+    std::cout << "Testing SequenceReadahead:\n";
+    std::vector<std::string> filenames;
+    for (int i = 1; i <= 4; ++i) {
+        std::string name = Strutil::format ("testreadahead.%04d.dat", i);
+        OIIO::ofstream out;
+        Filesystem::open (out, name);
+        out << "frame " << i;
+        filenames.push_back (name);
+    }
+
+    // Unbuffered: just keeps the right frames in the window
+    {
+        Filesystem::SequenceReadahead seq ("testreadahead.%04d.dat", "1-4");
+        OIIO_CHECK_EQUAL (seq.nframes(), 4);
+        OIIO_CHECK_EQUAL (seq.filename(1), filenames[1]);
+        seq.advance (0);
+        OIIO_CHECK_EQUAL (seq.bytes_ahead(), 14);   // frames 2 and 3
+        OIIO_CHECK_ASSERT (seq.ioproxy (1) == NULL);
+    }
+
+    // Buffered, with room for just one frame ahead
+    Filesystem::SequenceReadahead seq (filenames, 2, 7, true);
+    seq.advance (0);
+    OIIO_CHECK_EQUAL (seq.bytes_ahead(), 7);
+    OIIO_CHECK_ASSERT (seq.ioproxy (0) == NULL);
+    Filesystem::IOProxy *proxy = seq.ioproxy (1);
+    OIIO_CHECK_ASSERT (proxy != NULL);
+    if (proxy) {
+        char in[8] = { 0 };
+        OIIO_CHECK_EQUAL (proxy->size(), 7);
+        OIIO_CHECK_EQUAL (proxy->read (in, 7), 7);
+        OIIO_CHECK_EQUAL (std::string(in, 7), "frame 2");
+    }
+    seq.advance (1);
+    OIIO_CHECK_ASSERT (seq.ioproxy (1) != NULL);
+    OIIO_CHECK_ASSERT (seq.ioproxy (2) == NULL);  // over the limit
+    seq.advance (3);
+    OIIO_CHECK_EQUAL (seq.bytes_ahead(), 0);
+
+    for (auto&& f : filenames)
+        Filesystem::remove (f);
+}
+
+
+
 int main (int argc, char *argv[])
 {
     test_filename_decomposition ();
@@ -448,6 +540,8 @@ int main (int argc, char *argv[])
     test_file_status ();
     test_frame_sequences ();
     test_scan_sequences ();
+    test_ioproxy ();
+    test_sequence_readahead ();
 
     return unit_test_failures;
 }
@@ -96,6 +96,73 @@ void time_filter (Filter1D *f, const FilterDesc *filtdesc, size_t n)
 
 
 
+void time_filter_batch (Filter1D *f, const FilterDesc *filtdesc,
+                        const std::vector<float> &x, std::vector<float> &y)
+{
+    f->eval (&y[0], &x[0], int(x.size()));
+    DoNotOptimize (y[0]);
+}
+
+
+
+void time_filter_table (const FilterTable *f, const std::vector<float> &x,
+                        std::vector<float> &y)
+{
+    f->eval (&y[0], &x[0], int(x.size()));
+    DoNotOptimize (y[0]);
+}
+
+
+
+// The batched forms must match the scalar ones exactly, and the table
+// must be close to the filter everywhere except at discontinuities.
+void test_batched_filters ()
+{
+    const int n = 1000;
+    for (int i = 0, e = Filter1D::num_filters(); i < e; ++i) {
+        FilterDesc filtdesc;
+        Filter1D::get_filterdesc (i, &filtdesc);
+        Filter1D *f = Filter1D::create (filtdesc.name, filtdesc.width);
+        std::vector<float> x (n), y (n);
+        for (int j = 0; j < n; ++j)
+            x[j] = (j - n/2) * (filtdesc.width / n) * 1.1f;
+        f->eval (&y[0], &x[0], n);
+        FilterTable table (f);
+        float maxerr = 0.0f;
+        bool same = true;
+        for (int j = 0; j < n; ++j) {
+            same &= (y[j] == (*f)(x[j]));
+            // Skip the edges, where box and gaussian jump to zero.
+            if (fabsf(x[j]) < table.radius() - 0.01f)
+                maxerr = std::max (maxerr, fabsf (table(x[j]) - y[j]));
+        }
+        OIIO_CHECK_ASSERT (same);
+        OIIO_CHECK_ASSERT (maxerr < 1.0e-3f * (*f)(0.0f));
+        Filter1D::destroy (f);
+    }
+    for (int i = 0, e = Filter2D::num_filters(); i < e; ++i) {
+        FilterDesc filtdesc;
+        Filter2D::get_filterdesc (i, &filtdesc);
+        Filter2D *f = Filter2D::create (filtdesc.name, filtdesc.width,
+                                        filtdesc.width);
+        std::vector<float> x (n), y (n), yx (n), yy (n);
+        for (int j = 0; j < n; ++j)
+            x[j] = (j - n/2) * (filtdesc.width / n) * 1.1f;
+        float row = 0.1f * filtdesc.width;
+        f->eval (&y[0], &x[0], row, n);
+        f->xfilt (&yx[0], &x[0], n);
+        f->yfilt (&yy[0], &x[0], n);
+        bool same = true;
+        for (int j = 0; j < n; ++j)
+            same &= (y[j] == (*f)(x[j], row) && yx[j] == f->xfilt(x[j])
+                     && yy[j] == f->yfilt(x[j]));
+        OIIO_CHECK_ASSERT (same);
+        Filter2D::destroy (f);
+    }
+}
+
+
+
 int
 main (int argc, char *argv[])
 {
@@ -140,13 +207,27 @@ main (int argc, char *argv[])
         size_t ncalls = 1000000;
         float time = time_trial (bind (time_filter, f, &filtdesc, ncalls),
                                  ntrials, iterations) / iterations;
-        std::cout << Strutil::format ("%-15s %7.1f Mcalls/sec",
-                                      filtdesc.name, (ncalls/1.0e6)/time) << std::endl;
+        std::vector<float> xs (ncalls), ys (ncalls);
+        for (size_t j = 0; j < ncalls; ++j)
+            xs[j] = j * ((filtdesc.width/2.0f) / ncalls);
+        float btime = time_trial (bind (time_filter_batch, f, &filtdesc,
+                                        std::cref(xs), std::ref(ys)),
+                                  ntrials, iterations) / iterations;
+        FilterTable table (f);
+        float ttime = time_trial (bind (time_filter_table, &table,
+                                        std::cref(xs), std::ref(ys)),
+                                  ntrials, iterations) / iterations;
+        std::cout << Strutil::format ("%-15s %7.1f Mcalls/sec, batched %7.1f, table %7.1f",
+                                      filtdesc.name, (ncalls/1.0e6)/time,
+                                      (ncalls/1.0e6)/btime,
+                                      (ncalls/1.0e6)/ttime) << std::endl;
 
         Filter1D::destroy (f);
     }
 
     graph.write ("filters.tif");
 
+    test_batched_filters ();
+
     return unit_test_failures != 0;
 }
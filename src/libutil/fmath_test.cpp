@@ -173,6 +173,74 @@ void test_convert_type (double tolerance = 1e-6)
 
 
 
+// Convert whole arrays of every T value to F and back (exercising the
+// SIMD paths and their scalar tails), make sure they match the
+// single-value conversions and survive the round trip.
+template<typename T, typename F>
+void test_convert_type_array ()
+{
+    size_t n = size_t(std::numeric_limits<T>::max()) + 1;
+    std::vector<T> in (n), out (n);
+    std::vector<F> f (n);
+    for (size_t i = 0;  i < n;  ++i)
+        in[i] = (T)i;
+    for (size_t len : { n, n-1, n-3, size_t(5) }) {
+        convert_type (&in[0], &f[0], len);
+        convert_type (&f[0], &out[0], len);
+        int bad = 0;
+        for (size_t i = 0;  i < len;  ++i)
+            if (out[i] != in[i] || f[i] != convert_type<T,F>(in[i]))
+                ++bad;
+        OIIO_CHECK_EQUAL (bad, 0);
+    }
+}
+
+
+// The half <-> float array conversions must give the same results as
+// Imath's per-value conversion, rounding included.
+void test_convert_half_array ()
+{
+    std::cout << "round trip convert arrays of half <-> float\n";
+    // Every half bit pattern except NaNs, whose payloads may differ.
+    std::vector<half> h;
+    for (int i = 0;  i < 0x10000;  ++i) {
+        half v;
+        v.setBits ((unsigned short)i);
+        if (! v.isNan())
+            h.push_back (v);
+    }
+    size_t n = h.size();
+    std::vector<float> f (n);
+    std::vector<half> out (n);
+    convert_type (&h[0], &f[0], n);
+    convert_type (&f[0], &out[0], n);
+    int bad = 0;
+    for (size_t i = 0;  i < n;  ++i)
+        if (f[i] != float(h[i]) || out[i].bits() != h[i].bits())
+            ++bad;
+    OIIO_CHECK_EQUAL (bad, 0);
+    // Floats that aren't representable, including subnormals, overflow,
+    // and values exactly between two halfs, round like half(float).
+    std::vector<float> in;
+    for (int e = -26;  e <= 17;  ++e)
+        for (int m = 0;  m < 64;  ++m) {
+            float v = ldexpf (1.0f + m/64.0f + 1.0f/2048.0f, e);
+            in.push_back (v);
+            in.push_back (-v);
+            in.push_back (nextafterf (v, 0.0f));
+        }
+    n = in.size();
+    out.resize (n);
+    convert_type (&in[0], &out[0], n);
+    bad = 0;
+    for (size_t i = 0;  i < n;  ++i)
+        if (out[i].bits() != half(in[i]).bits())
+            ++bad;
+    OIIO_CHECK_EQUAL (bad, 0);
+}
+
+
+
 template<typename S, typename D>
 void do_convert_type (const std::vector<S> &svec, std::vector<D> &dvec)
 {
@@ -290,6 +358,10 @@ int main (int argc, char *argv[])
     test_convert_type<double,long> ();
     std::cout << "round trip convert float/unsigned int/float\n";
     test_convert_type<float, unsigned int> ();
+    std::cout << "round trip convert arrays of unsigned char/unsigned short <-> float\n";
+    test_convert_type_array<unsigned char,float> ();
+    test_convert_type_array<unsigned short,float> ();
+    test_convert_half_array ();
 
     benchmark_convert_type<unsigned char, float> ();
     benchmark_convert_type<float, unsigned char> ();
@@ -83,6 +83,10 @@ getargs (int argc, char *argv[])
 
 
 
+void do_nothing (int thread_id) { }
+
+
+
 void
 time_parallel_for ()
 {
@@ -112,6 +116,48 @@ time_parallel_for ()
 
 
 
+// Measure the cost of handing work to the pool: the round trip latency of
+// pushing one empty task and waiting for its result, the throughput of
+// pushing many empty tasks and waiting on them all, and that of
+// parallel_for_chunked with one item per chunk.
+void
+time_task_dispatch ()
+{
+    std::cout << "\nTiming task dispatch through the thread pool:\n";
+    thread_pool *pool (default_thread_pool());
+    pool->resize (numthreads);
+    const int ntasks = 1000;
+    int its = std::max (1, iterations / ntasks);
+
+    auto roundtrip = [=](){
+        for (int i = 0; i < ntasks; ++i)
+            pool->push ([](int id){ return id; }).wait ();
+    };
+    double range;
+    double t = time_trial (roundtrip, ntrials, its, &range);
+    std::cout << Strutil::format ("  latency     %8.2f us/task (push, wait)\n",
+                                  1.0e6 * t / (double(its) * ntasks));
+
+    auto burst = [=](){
+        task_set<void> tasks (pool);
+        for (int i = 0; i < ntasks; ++i)
+            tasks.push (pool->push (do_nothing));
+        tasks.wait ();
+    };
+    t = time_trial (burst, ntrials, its, &range);
+    std::cout << Strutil::format ("  throughput  %8.0f tasks/sec (push many, wait all)\n",
+                                  double(its) * ntasks / t);
+
+    auto chunked = [=](){
+        parallel_for_chunked (0, ntasks, 1, [](int id, int64_t b, int64_t e){ });
+    };
+    t = time_trial (chunked, ntrials, its, &range);
+    std::cout << Strutil::format ("  chunked     %8.0f chunks/sec (parallel_for_chunked, 1 per chunk)\n",
+                                  double(its) * ntasks / t);
+}
+
+
+
 void
 test_parallel_for ()
 {
@@ -135,6 +181,29 @@ test_parallel_for ()
 
 
 
+void
+test_parallel_for_2d ()
+{
+    // Every cell of a range that the chunks don't divide evenly is visited
+    // exactly once.
+    const int w = 203, h = 77;
+    std::vector<atomic_int> counts (w * h);
+    for (auto& c : counts)
+        c = 0;
+    parallel_for_2d (3, 3+w, 16, -5, -5+h, 10,
+                     [&](int64_t xb, int64_t xe, int64_t yb, int64_t ye){
+        for (int64_t y = yb; y < ye; ++y)
+            for (int64_t x = xb; x < xe; ++x)
+                counts[(y+5) * w + (x-3)] += 1;
+    });
+    int bad = 0;
+    for (auto& c : counts)
+        bad += (c != 1);
+    OIIO_CHECK_EQUAL (bad, 0);
+}
+
+
+
 void
 test_thread_pool_recursion ()
 {
@@ -174,9 +243,12 @@ main (int argc, char **argv)
     std::cout << "hw threads = " << Sysutil::hardware_concurrency() << "\n";
 
     test_parallel_for ();
+    test_parallel_for_2d ();
 
     time_parallel_for ();
 
+    time_task_dispatch ();
+
     test_thread_pool_recursion ();
 
     return unit_test_failures;
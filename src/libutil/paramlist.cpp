@@ -30,9 +30,11 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <unordered_map>
 
 #include "OpenImageIO/dassert.h"
 #include "OpenImageIO/ustring.h"
+#include "OpenImageIO/strutil.h"
 #include "OpenImageIO/paramlist.h"
 
 
@@ -105,23 +107,91 @@ ParamValue::clear_value ()
 
 
 
-ParamValueList::const_iterator
-ParamValueList::find (ustring name, TypeDesc type, bool casesensitive) const
+// Below this many entries, a linear scan is cheaper than building and
+// probing the index.
+static const size_t index_min_entries = 16;
+
+
+
+struct ParamValueList::Index {
+    // Position of the first entry with each name, and with each
+    // lowercased name for case-insensitive searches.
+    std::unordered_map<ustring,size_t,ustringHash> exact, lower;
+};
+
+
+
+static ustring
+lowercase (string_view name)
 {
+    std::string s (name);
+    Strutil::to_lower (s);
+    return ustring (s);
+}
+
+
+
+std::shared_ptr<const ParamValueList::Index>
+ParamValueList::index () const
+{
+    std::shared_ptr<const Index> idx = std::atomic_load (&m_index);
+    if (! idx) {
+        // Concurrent searches may each build one; they're identical, and
+        // whichever is stored last is kept.
+        std::shared_ptr<Index> newidx (new Index);
+        newidx->exact.reserve (size());
+        newidx->lower.reserve (size());
+        for (size_t i = 0, e = size(); i < e; ++i) {
+            ustring name = m_vals[i].name();
+            newidx->exact.emplace (name, i);   // emplace keeps the first
+            newidx->lower.emplace (lowercase (name), i);
+        }
+        idx = newidx;
+        std::atomic_store (&m_index, idx);
+    }
+    return idx;
+}
+
+
+
+size_t
+ParamValueList::find_index (ustring name, TypeDesc type,
+                            bool casesensitive) const
+{
+    size_t start = 0, n = size();
+    if (n >= index_min_entries) {
+        // The index tells us the first entry with the name. Scan from
+        // there, which checks the type and (should an entry have been
+        // renamed in place) that the name still matches.
+        std::shared_ptr<const Index> idx = index();
+        auto &map (casesensitive ? idx->exact : idx->lower);
+        auto found = map.find (casesensitive ? name : lowercase (name));
+        if (found == map.end())
+            return n;
+        start = found->second;
+    }
     if (casesensitive) {
-        for (const_iterator i = cbegin(), e = cend(); i != e; ++i) {
-            if (i->name() == name &&
-                  (type == TypeDesc::UNKNOWN || type == i->type()))
+        for (size_t i = start; i < n; ++i) {
+            if (m_vals[i].name() == name &&
+                  (type == TypeDesc::UNKNOWN || type == m_vals[i].type()))
                 return i;
         }
     } else {
-        for (const_iterator i = cbegin(), e = cend(); i != e; ++i) {
-            if (Strutil::iequals (i->name(), name) &&
-                  (type == TypeDesc::UNKNOWN || type == i->type()))
+        for (size_t i = start; i < n; ++i) {
+            if (Strutil::iequals (m_vals[i].name(), name) &&
+                  (type == TypeDesc::UNKNOWN || type == m_vals[i].type()))
                 return i;
         }
     }
-    return cend();
+    return n;
+}
+
+
+
+ParamValueList::const_iterator
+ParamValueList::find (ustring name, TypeDesc type, bool casesensitive) const
+{
+    return cbegin() + find_index (name, type, casesensitive);
 }
 
 
@@ -129,14 +199,13 @@ ParamValueList::find (ustring name, TypeDesc type, bool casesensitive) const
 ParamValueList::const_iterator
 ParamValueList::find (string_view name, TypeDesc type, bool casesensitive) const
 {
-    if (casesensitive) {
+    if (casesensitive || size() >= index_min_entries)
         return find (ustring(name), type, casesensitive);
-    } else {
-        for (const_iterator i = cbegin(), e = cend(); i != e; ++i) {
-            if (Strutil::iequals (i->name(), name) &&
-                  (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
-        }
+    // Short list, case-insensitive: don't bother making a ustring.
+    for (const_iterator i = cbegin(), e = cend(); i != e; ++i) {
+        if (Strutil::iequals (i->name(), name) &&
+              (type == TypeDesc::UNKNOWN || type == i->type()))
+            return i;
     }
     return cend();
 }
@@ -146,20 +215,7 @@ ParamValueList::find (string_view name, TypeDesc type, bool casesensitive) const
 ParamValueList::iterator
 ParamValueList::find (ustring name, TypeDesc type, bool casesensitive)
 {
-    if (casesensitive) {
-        for (iterator i = begin(), e = end(); i != e; ++i) {
-            if (i->name() == name &&
-                  (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
-        }
-    } else {
-        for (iterator i = begin(), e = end(); i != e; ++i) {
-            if (Strutil::iequals (i->name(), name) &&
-                  (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
-        }
-    }
-    return end();
+    return begin() + find_index (name, type, casesensitive);
 }
 
 
@@ -167,16 +223,8 @@ ParamValueList::find (ustring name, TypeDesc type, bool casesensitive)
 ParamValueList::iterator
 ParamValueList::find (string_view name, TypeDesc type, bool casesensitive)
 {
-    if (casesensitive) {
-        return find (ustring(name), type, casesensitive);
-    } else {
-        for (iterator i = begin(), e = end(); i != e; ++i) {
-            if (Strutil::iequals (i->name(), name) &&
-                  (type == TypeDesc::UNKNOWN || type == i->type()))
-                return i;
-        }
-    }
-    return end();
+    const ParamValueList *self = this;
+    return begin() + (self->find (name, type, casesensitive) - cbegin());
 }
 
 
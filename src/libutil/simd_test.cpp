@@ -217,6 +217,18 @@ template<> inline bool8 mkvec<bool8> (bool a, bool b, bool c, bool d) {
     return bool8(a,b,c,d,a,b,c,d);
 }
 
+template<> inline float16 mkvec<float16> (float a, float b, float c, float d) {
+    return float16(a,b,c,d,a,b,c,d,a,b,c,d,a,b,c,d);
+}
+
+template<> inline int16 mkvec<int16> (int a, int b, int c, int d) {
+    return int16(a,b,c,d,a,b,c,d,a,b,c,d,a,b,c,d);
+}
+
+template<> inline bool16 mkvec<bool16> (bool a, bool b, bool c, bool d) {
+    return bool16(a,b,c,d,a,b,c,d,a,b,c,d,a,b,c,d);
+}
+
 
 
 template<typename VEC>
@@ -249,6 +261,21 @@ template<> inline float3 mkvec<float3> (float a, float b, float c, float d,
     return float3(a,b,c);
 }
 
+template<> inline float16 mkvec<float16> (float a, float b, float c, float d,
+                                          float e, float f, float g, float h) {
+    return float16(a,b,c,d,e,f,g,h,a,b,c,d,e,f,g,h);
+}
+
+template<> inline int16 mkvec<int16> (int a, int b, int c, int d,
+                                      int e, int f, int g, int h) {
+    return int16(a,b,c,d,e,f,g,h,a,b,c,d,e,f,g,h);
+}
+
+template<> inline bool16 mkvec<bool16> (bool a, bool b, bool c, bool d,
+                                        bool e, bool f, bool g, bool h) {
+    return bool16(a,b,c,d,e,f,g,h,a,b,c,d,e,f,g,h);
+}
+
 
 template<typename VEC>
 inline int loadstore_vec (int dummy) {
@@ -326,16 +353,17 @@ void test_loadstore ()
 {
     typedef typename VEC::value_t ELEM;
     test_heading ("loadstore ", VEC::type_name());
-    VEC C1234 = mkvec<VEC>(1, 2, 3, 4, 5, 6, 7, 8);
+    VEC C1234 = VEC::Iota (1);
     // VEC C0 (0);
-    ELEM partial[] = { 101, 102, 103, 104, 105, 106, 107, 108 };
+    ELEM partial[] = { 101, 102, 103, 104, 105, 106, 107, 108,
+                       109, 110, 111, 112, 113, 114, 115, 116 };
     for (int i = 1; i <= VEC::elements; ++i) {
         VEC a (ELEM(0));
         a.load (partial, i);
         for (int j = 0; j < VEC::elements; ++j)
             OIIO_CHECK_EQUAL (a[j], j<i ? partial[j] : ELEM(0));
         std::cout << "  partial load " << i << " : " << a << "\n";
-        ELEM stored[] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        ELEM stored[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
         C1234.store (stored, i);
         for (int j = 0; j < VEC::elements; ++j)
             OIIO_CHECK_EQUAL (stored[j], j<i ? ELEM(j+1) : ELEM(0));
@@ -347,10 +375,10 @@ void test_loadstore ()
 
     {
     // Check load from integers
-    unsigned short us1234[] = {1, 2, 3, 4, 5, 6, 7, 8};
-    short s1234[]           = {1, 2, 3, 4, 5, 6, 7, 8};
-    unsigned char uc1234[]  = {1, 2, 3, 4, 5, 6, 7, 8};
-    char c1234[]            = {1, 2, 3, 4, 5, 6, 7, 8};
+    unsigned short us1234[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    short s1234[]           = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    unsigned char uc1234[]  = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    char c1234[]            = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
     OIIO_CHECK_SIMD_EQUAL (VEC(us1234), C1234);
     OIIO_CHECK_SIMD_EQUAL (VEC( s1234), C1234);
     OIIO_CHECK_SIMD_EQUAL (VEC(uc1234), C1234);
@@ -359,6 +387,11 @@ void test_loadstore ()
 
 #if OIIO_CPLUSPLUS_VERSION >= 11  /* So easy with lambdas */
     benchmark ("load/store", loadstore_vec<VEC>, 0, VEC::elements);
+    if (VEC::elements > 8) {
+        benchmark ("load/store, 16 comps", loadstore_vec_N<VEC, 16>, 0, 16);
+        benchmark ("load/store, 13 comps", loadstore_vec_N<VEC, 13>, 0, 13);
+        benchmark ("load/store, 9 comps", loadstore_vec_N<VEC, 9>, 0, 9);
+    }
     if (VEC::elements > 4) {
         benchmark ("load/store, 8 comps", loadstore_vec_N<VEC, 8>, 0, 8);
         benchmark ("load/store, 7 comps", loadstore_vec_N<VEC, 7>, 0, 7);
@@ -540,6 +573,76 @@ void test_component_access<bool8> ()
 
 
 
+template<>
+void test_component_access<bool16> ()
+{
+    typedef bool16 VEC;
+    typedef VEC::value_t ELEM;
+    test_heading ("component_access ", VEC::type_name());
+
+    bool vals[] = { false, true, true, true, false, false, true, true,
+                    true, false, false, true, true, false, true, false };
+    VEC a (vals);
+    for (int i = 0; i < VEC::elements; ++i)
+        OIIO_CHECK_EQUAL (bool(a[i]), vals[i]);
+    OIIO_CHECK_EQUAL (a.bitmask(), 0x59ce);
+    OIIO_CHECK_SIMD_EQUAL (VEC::from_bitmask(0x59ce), a);
+    OIIO_CHECK_SIMD_EQUAL (VEC(a.lo(), a.hi()), a);
+    OIIO_CHECK_EQUAL (extract<0>(a), false);
+    OIIO_CHECK_EQUAL (extract<1>(a), true);
+    OIIO_CHECK_EQUAL (extract<8>(a), true);
+    OIIO_CHECK_EQUAL (extract<15>(a), false);
+    OIIO_CHECK_SIMD_EQUAL (insert<0>(a, ELEM(true)), VEC::from_bitmask(0x59cf));
+    OIIO_CHECK_SIMD_EQUAL (insert<1>(a, ELEM(false)), VEC::from_bitmask(0x59cc));
+    OIIO_CHECK_SIMD_EQUAL (insert<9>(a, ELEM(true)), VEC::from_bitmask(0x5bce));
+    OIIO_CHECK_SIMD_EQUAL (insert<14>(a, ELEM(false)), VEC::from_bitmask(0x19ce));
+    OIIO_CHECK_SIMD_EQUAL (VEC(int16::Iota(-1)), VEC::from_bitmask(0xfffd));
+}
+
+
+
+// The 16-wide types can't use the 8-value mkvec idiom of
+// test_component_access, since they replicate the 8 values.
+template<typename VEC>
+void test_component_access16 ()
+{
+    typedef typename VEC::value_t ELEM;
+    test_heading ("component_access ", VEC::type_name());
+
+    const ELEM vals[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+    VEC a (vals);
+    for (int i = 0; i < VEC::elements; ++i)
+        OIIO_CHECK_EQUAL (a[i], vals[i]);
+    OIIO_CHECK_SIMD_EQUAL (a, VEC::Iota());
+    OIIO_CHECK_SIMD_EQUAL (VEC(a.lo(), a.hi()), a);
+    OIIO_CHECK_EQUAL (a.hi()[0], 8);
+
+    OIIO_CHECK_EQUAL (extract<0>(a), 0);
+    OIIO_CHECK_EQUAL (extract<3>(a), 3);
+    OIIO_CHECK_EQUAL (extract<6>(a), 6);
+    OIIO_CHECK_EQUAL (extract<9>(a), 9);
+    OIIO_CHECK_EQUAL (extract<15>(a), 15);
+    for (int i = 0; i < VEC::elements; ++i) {
+        VEC t = a;
+        t[i] = ELEM(42);
+        for (int j = 0; j < VEC::elements; ++j)
+            OIIO_CHECK_EQUAL (t[j], j == i ? ELEM(42) : vals[j]);
+    }
+    { VEC t = a; t[0] = 42;  OIIO_CHECK_SIMD_EQUAL (insert<0>(a, ELEM(42)), t); }
+    { VEC t = a; t[5] = 42;  OIIO_CHECK_SIMD_EQUAL (insert<5>(a, ELEM(42)), t); }
+    { VEC t = a; t[10] = 42; OIIO_CHECK_SIMD_EQUAL (insert<10>(a, ELEM(42)), t); }
+    { VEC t = a; t[15] = 42; OIIO_CHECK_SIMD_EQUAL (insert<15>(a, ELEM(42)), t); }
+
+#if OIIO_CPLUSPLUS_VERSION >= 11  /* So easy with lambdas */
+    benchmark2 ("operator[i]", [&](const VEC& v, int i){ return v[i]; },  a, 2, 1 /*work*/);
+    benchmark2 ("extract<2> ", [&](const VEC& v, int i){ return extract<2>(v); },  a, 2, 1 /*work*/);
+    benchmark2 ("extract<12> ", [&](const VEC& v, int i){ return extract<12>(v); },  a, 12, 1 /*work*/);
+    benchmark2 ("insert<2> ", [&](const VEC& v, ELEM i){ return insert<2>(v, i); }, a, ELEM(1), 1 /*work*/);
+#endif
+}
+
+
+
 template<typename T> inline T do_add (const T &a, const T &b) { return a+b; }
 template<typename T> inline T do_sub (const T &a, const T &b) { return a-b; }
 template<typename T> inline T do_mul (const T &a, const T &b) { return a*b; }
@@ -677,12 +780,18 @@ void test_bitwise_bool ()
     typedef int ELEM;
     test_heading ("bitwise ", VEC::type_name());
 
-    bool A[]   = { true,  true,  false, false, false, false, true,  true  };
-    bool B[]   = { true,  false, true,  false, true,  false, true,  false };
-    bool AND[] = { true,  false, false, false, false, false, true,  false };
-    bool OR[]  = { true,  true,  true,  false, true,  false, true,  true  };
-    bool XOR[] = { false, true,  true,  false, true,  false, false, true  };
-    bool NOT[] = { false, false, true,  true,  true,  true,  false, false  };
+    bool A[]   = { true,  true,  false, false, false, false, true,  true,
+                   true,  true,  false, false, false, false, true,  true  };
+    bool B[]   = { true,  false, true,  false, true,  false, true,  false,
+                   true,  false, true,  false, true,  false, true,  false };
+    bool AND[] = { true,  false, false, false, false, false, true,  false,
+                   true,  false, false, false, false, false, true,  false };
+    bool OR[]  = { true,  true,  true,  false, true,  false, true,  true,
+                   true,  true,  true,  false, true,  false, true,  true  };
+    bool XOR[] = { false, true,  true,  false, true,  false, false, true,
+                   false, true,  true,  false, true,  false, false, true  };
+    bool NOT[] = { false, false, true,  true,  true,  true,  false, false,
+                   false, false, true,  true,  true,  true,  false, false };
     VEC a(A), b(B), rand(AND), ror(OR), rxor(XOR), rnot(NOT);
     OIIO_CHECK_SIMD_EQUAL (a & b, rand);
     OIIO_CHECK_SIMD_EQUAL (a | b, ror);
@@ -723,12 +832,12 @@ void test_comparisons ()
     test_heading ("comparisons ", VEC::type_name());
 
     VEC a = VEC::Iota();
-    bool lt2[] = { 1, 1, 0, 0, 0, 0, 0, 0 };
-    bool gt2[] = { 0, 0, 0, 1, 1, 1, 1, 1 };
-    bool le2[] = { 1, 1, 1, 0, 0, 0, 0, 0 };
-    bool ge2[] = { 0, 0, 1, 1, 1, 1, 1, 1 };
-    bool eq2[] = { 0, 0, 1, 0, 0, 0, 0, 0 };
-    bool ne2[] = { 1, 1, 0, 1, 1, 1, 1, 1 };
+    bool lt2[] = { 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    bool gt2[] = { 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+    bool le2[] = { 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    bool ge2[] = { 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+    bool eq2[] = { 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    bool ne2[] = { 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
     OIIO_CHECK_SIMD_EQUAL ((a < 2), bool_t(lt2));
     OIIO_CHECK_SIMD_EQUAL ((a > 2), bool_t(gt2));
     OIIO_CHECK_SIMD_EQUAL ((a <= 2), bool_t(le2));
@@ -826,23 +935,24 @@ void test_blend ()
     VEC a = VEC::Iota (1);
     VEC b = VEC::Iota (10);
     bool_t f(false), t(true);
-    bool tf_values[] = { true, false, true, false, true, false, true, false };
+    bool tf_values[] = { true, false, true, false, true, false, true, false,
+                         true, false, true, false, true, false, true, false };
     bool_t tf ((bool *)tf_values);
 
     OIIO_CHECK_SIMD_EQUAL (blend (a, b, f), a);
     OIIO_CHECK_SIMD_EQUAL (blend (a, b, t), b);
 
-    ELEM r1[] = { 10, 2, 12, 4, 14, 6, 16, 8 };
+    ELEM r1[] = { 10, 2, 12, 4, 14, 6, 16, 8, 18, 10, 20, 12, 22, 14, 24, 16 };
     OIIO_CHECK_SIMD_EQUAL (blend (a, b, tf), VEC(r1));
 
     OIIO_CHECK_SIMD_EQUAL (blend0 (a, f), VEC::Zero());
     OIIO_CHECK_SIMD_EQUAL (blend0 (a, t), a);
-    ELEM r2[] = { 1, 0, 3, 0, 5, 0, 7, 0 };
+    ELEM r2[] = { 1, 0, 3, 0, 5, 0, 7, 0, 9, 0, 11, 0, 13, 0, 15, 0 };
     OIIO_CHECK_SIMD_EQUAL (blend0 (a, tf), VEC(r2));
 
     OIIO_CHECK_SIMD_EQUAL (blend0not (a, f), a);
     OIIO_CHECK_SIMD_EQUAL (blend0not (a, t), VEC::Zero());
-    ELEM r3[] = { 0, 2, 0, 4, 0, 6, 0, 8 };
+    ELEM r3[] = { 0, 2, 0, 4, 0, 6, 0, 8, 0, 10, 0, 12, 0, 14, 0, 16 };
     OIIO_CHECK_SIMD_EQUAL (blend0not (a, tf), VEC(r3));
 
 #if OIIO_CPLUSPLUS_VERSION >= 11  /* So easy with lambdas */
@@ -1025,6 +1135,15 @@ void test_constants ()
     OIIO_CHECK_SIMD_EQUAL (float8::Iota(3.0f), float8(3,4,5,6,7,8,9,10));
     OIIO_CHECK_SIMD_EQUAL (float8::Iota(3.0f,2.0f), float8(3,5,7,9,11,13,15,17));
 
+    OIIO_CHECK_SIMD_EQUAL (bool16::False(), bool16(false));
+    OIIO_CHECK_SIMD_EQUAL (bool16::True(), bool16(true));
+    OIIO_CHECK_SIMD_EQUAL (int16::Zero(), int16(0));
+    OIIO_CHECK_SIMD_EQUAL (int16::NegOne(), int16(-1));
+    OIIO_CHECK_SIMD_EQUAL (float16::Zero(), float16(0.0f));
+    OIIO_CHECK_SIMD_EQUAL (float16::One(), float16(1.0f));
+    OIIO_CHECK_SIMD_EQUAL (float16::Iota(3.0f,2.0f),
+                           float16(float8::Iota(3.0f,2.0f), float8::Iota(19.0f,2.0f)));
+
 #if OIIO_CPLUSPLUS_VERSION >= 11  /* So easy with lambdas */
     benchmark ("float4 = float(const)", [](float f){ return float4(f); }, 1.0f);
     benchmark ("float4 = Zero()", [](int){ return float4::Zero(); }, 0);
@@ -1090,6 +1209,18 @@ void test_mathfuncs ()
                 mkvec<VEC>(fast_log(expA[0]), fast_log(expA[1]), fast_log(expA[2]), fast_log(expA[3])));
     OIIO_CHECK_SIMD_EQUAL_THRESH (fast_pow_pos(VEC(2.0f), A),
                            mkvec<VEC>(0.5f, 1.0f, 2.0f, 22.62741699796952f), 0.0001f);
+    VEC C = mkvec<VEC> (-1.0f, -0.25f, 0.5f, 1.0f);
+    OIIO_CHECK_SIMD_EQUAL_THRESH (fast_acos(C),
+                mkvec<VEC>(fast_acos(C[0]), fast_acos(C[1]), fast_acos(C[2]), fast_acos(C[3])), 1e-6f);
+    OIIO_CHECK_SIMD_EQUAL_THRESH (fast_atan2(C, A),
+                mkvec<VEC>(fast_atan2(C[0],A[0]), fast_atan2(C[1],A[1]),
+                           fast_atan2(C[2],A[2]), fast_atan2(C[3],A[3])), 1e-6f);
+    VEC P = mkvec<VEC> (3.0f, 2.0f, 0.5f, 0.0f);
+    OIIO_CHECK_SIMD_EQUAL_THRESH (fast_safe_pow(C, P),
+                mkvec<VEC>(-1.0f, 0.0625f, 0.70710678f, 1.0f), 0.0001f);
+    OIIO_CHECK_SIMD_EQUAL_THRESH (fast_safe_pow(expA, P),
+                mkvec<VEC>(fast_safe_pow(expA[0],P[0]), fast_safe_pow(expA[1],P[1]),
+                           fast_safe_pow(expA[2],P[2]), fast_safe_pow(expA[3],P[3])), 0.0001f);
 
     OIIO_CHECK_SIMD_EQUAL (safe_div(mkvec<VEC>(1.0f,2.0f,3.0f,4.0f), mkvec<VEC>(2.0f,0.0f,2.0f,0.0f)),
                            mkvec<VEC>(0.5f,0.0f,1.5f,0.0f));
@@ -1112,6 +1243,11 @@ void test_mathfuncs ()
     benchmark ("simd::fast_log", fast_log<VEC>, VEC(0.67f));
     benchmark2 ("float powf", powf, 0.67f, 0.67f);
     benchmark2 ("simd fast_pow_pos", [](VEC& x,VEC& y){ return fast_pow_pos(x,y); }, VEC(0.67f), VEC(0.67f));
+    benchmark2 ("simd fast_safe_pow", [](VEC& x,VEC& y){ return fast_safe_pow(x,y); }, VEC(0.67f), VEC(0.67f));
+    benchmark ("float acosf", acosf, 0.67f);
+    benchmark ("simd fast_acos", [](VEC& v){ return fast_acos(v); }, VEC(0.67f));
+    benchmark2 ("float atan2f", atan2f, 0.67f, 0.5f);
+    benchmark2 ("simd fast_atan2", [](VEC& y,VEC& x){ return fast_atan2(y,x); }, VEC(0.67f), VEC(0.5f));
     benchmark ("float sqrt", sqrtf, 4.0f);
     benchmark ("simd::sqrt", [](VEC& v){ return sqrt(v); }, mkvec<VEC>(1.0f,4.0f,9.0f,16.0f));
     benchmark ("float rsqrt", rsqrtf, 4.0f);
@@ -1340,6 +1476,15 @@ main (int argc, char *argv[])
     test_fused<float8> ();
     test_mathfuncs<float8>();
 
+    category_heading ("float16");
+    test_loadstore<float16> ();
+    test_component_access16<float16> ();
+    test_arithmetic<float16> ();
+    test_comparisons<float16> ();
+    test_blend<float16> ();
+    test_fused<float16> ();
+    test_mathfuncs<float16>();
+
     category_heading ("int4");
     test_loadstore<int4> ();
     test_component_access<int4> ();
@@ -1365,6 +1510,17 @@ main (int argc, char *argv[])
     test_vint_to_uint8s<int8> ();
     test_shift<int8> ();
 
+    category_heading ("int16");
+    test_loadstore<int16> ();
+    test_component_access16<int16> ();
+    test_arithmetic<int16> ();
+    test_bitwise_int<int16> ();
+    test_comparisons<int16> ();
+    test_blend<int16> ();
+    test_vint_to_uint16s<int16> ();
+    test_vint_to_uint8s<int16> ();
+    test_shift<int16> ();
+
     category_heading ("bool4");
     test_shuffle4<bool4> ();
     test_component_access<bool4> ();
@@ -1375,6 +1531,10 @@ main (int argc, char *argv[])
     test_component_access<bool8> ();
     test_bitwise_bool<bool8> ();
 
+    category_heading ("bool16");
+    test_component_access<bool16> ();
+    test_bitwise_bool<bool16> ();
+
     category_heading ("Odds and ends");
     test_constants();
     test_special();
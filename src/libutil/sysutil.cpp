@@ -545,6 +545,50 @@ Sysutil::physical_concurrency ()
 
 
 
+std::vector<std::vector<int>>
+Sysutil::numa_node_cpus ()
+{
+    std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+    // Each node's cpulist is a comma-separated list of CPUs and ranges,
+    // like "0-15,64-79".
+    for (int n = 0;  ;  ++n) {
+        std::string path = Strutil::format ("/sys/devices/system/node/node%d/cpulist", n);
+        FILE *f = fopen (path.c_str(), "r");
+        if (! f)
+            break;
+        char buf[4096];
+        size_t len = fread (buf, 1, sizeof(buf)-1, f);
+        fclose (f);
+        buf[len] = 0;
+        std::vector<int> cpus;
+        string_view list (buf);
+        while (list.size()) {
+            int lo, hi;
+            if (! Strutil::parse_int (list, lo))
+                break;
+            hi = lo;
+            if (Strutil::parse_char (list, '-') && ! Strutil::parse_int (list, hi))
+                break;
+            for (int c = lo;  c <= hi;  ++c)
+                cpus.push_back (c);
+            if (! Strutil::parse_char (list, ','))
+                break;
+        }
+        if (cpus.size())
+            nodes.push_back (cpus);
+    }
+#endif
+    if (nodes.empty()) {
+        nodes.resize (1);
+        for (int c = 0, e = int(hardware_concurrency());  c < e;  ++c)
+            nodes[0].push_back (c);
+    }
+    return nodes;
+}
+
+
+
 size_t
 Sysutil::max_open_files ()
 {
@@ -44,11 +44,17 @@
 #define _ENABLE_ATOMIC_ALIGNMENT_FIX /* Avoid MSVS error, ugh */
 #endif
 
+#include <algorithm>
 #include <exception>
 #include <functional>
 #include <future>
 #include <memory>
 
+#ifdef __linux__
+# include <pthread.h>
+# include <sched.h>
+#endif
+
 // Use boost::lockfree::queue for the task queue
 #include <boost/lockfree/queue.hpp>
 
@@ -76,6 +82,20 @@ public:
 
     std::thread & get_thread(int i) { return *this->threads[i]; }
 
+    void set_affinity (thread_pool::Affinity a) {
+        this->affinity = a;
+        for (int i = 0, n = this->size(); i < n; ++i)
+            this->apply_affinity (i);
+    }
+
+    thread_pool::Affinity get_affinity () const { return this->affinity; }
+
+    int numa_node (int i) const {
+        if (this->affinity == thread_pool::AffinityNone || i < 0)
+            return -1;
+        return i % int(this->nodes.size());
+    }
+
     // change the number of threads in the pool
     // should be called from one thread, otherwise be careful to not interleave, also with this->stop()
     // nThreads must be >= 0
@@ -95,6 +115,7 @@ public:
             else {  // the number of threads is decreased
                 for (int i = oldNThreads - 1; i >= nThreads; --i) {
                     *this->flags[i] = true;  // this thread will finish
+                    forget_worker (this->threads[i]->get_id());
                     this->threads[i]->detach();
                 }
                 {
@@ -158,6 +179,8 @@ public:
         this->clear_queue();
         this->threads.clear();
         this->flags.clear();
+        spin_lock lock (this->worker_ids_mutex);
+        this->worker_ids.clear();
     }
 
     template<typename F, typename... Rest>
@@ -168,9 +191,7 @@ public:
         auto _f = new std::function<void(int id)>([pck](int id) {
             (*pck)(id);
         });
-        this->q.push(_f);
-        std::unique_lock<std::mutex> lock(this->mutex);
-        this->cv.notify_one();
+        this->push_queue_and_notify(_f);
         return pck->get_future();
     }
 
@@ -182,16 +203,21 @@ public:
         auto _f = new std::function<void(int id)>([pck](int id) {
             (*pck)(id);
         });
-        this->q.push(_f);
-        std::unique_lock<std::mutex> lock(this->mutex);
-        this->cv.notify_one();
+        this->push_queue_and_notify(_f);
         return pck->get_future();
     }
 
+    // The queue itself is lock-free, so only take the mutex to wake a
+    // parked worker, and only if there is one. The fence orders our push
+    // before the read of nWaiting, pairing with the one in set_thread, so
+    // that a worker about to park either sees the task or gets notified.
     void push_queue_and_notify (std::function<void(int id)> *f) {
         this->q.push(f);
-        std::unique_lock<std::mutex> lock(this->mutex);
-        this->cv.notify_one();
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        if (this->nWaiting.load() > 0) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->cv.notify_one();
+        }
     }
 
     // If any tasks are on the queue, pop and run one with the calling
@@ -204,6 +230,13 @@ public:
         return isPop;
     }
 
+    bool this_thread_is_in_pool () const {
+        std::thread::id id = std::this_thread::get_id();
+        spin_lock lock (this->worker_ids_mutex);
+        return std::find (this->worker_ids.begin(), this->worker_ids.end(),
+                          id) != this->worker_ids.end();
+    }
+
 private:
     Impl (const Impl  &) = delete;
     Impl (Impl  &&) = delete;
@@ -225,9 +258,19 @@ private:
                     else
                         isPop = this->q.pop(_f);
                 }
-                // the queue is empty here, wait for the next command
+                // the queue is empty here. Fine-grained work tends to
+                // arrive in bursts, so spin briefly before parking, which
+                // costs the pusher a lock and a wakeup.
+                for (int spin = 0; spin < spin_count && !isPop && !_flag; ++spin) {
+                    pause (spin < 16 ? 1 : 4);
+                    isPop = this->q.pop(_f);
+                }
+                if (isPop)
+                    continue;
+                // still empty, wait for the next command
                 std::unique_lock<std::mutex> lock(this->mutex);
                 ++this->nWaiting;
+                std::atomic_thread_fence (std::memory_order_seq_cst);
                 this->cv.wait(lock, [this, &_f, &isPop, &_flag](){ isPop = this->q.pop(_f); return isPop || this->isDone || _flag; });
                 --this->nWaiting;
                 if (!isPop)
@@ -235,9 +278,55 @@ private:
             }
         };
         this->threads[i].reset(new std::thread(f));  // compiler may not support std::make_unique()
+        if (this->affinity != thread_pool::AffinityNone)
+            this->apply_affinity (i);
+        spin_lock lock (this->worker_ids_mutex);
+        this->worker_ids.push_back (this->threads[i]->get_id());
+    }
+
+    // Restrict worker i to the CPUs its Affinity calls for, or let it run
+    // anywhere again for AffinityNone.
+    void apply_affinity (int i) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO (&set);
+        int nn = int(this->nodes.size());
+        const std::vector<int> &node (this->nodes[i % nn]);
+        if (this->affinity == thread_pool::AffinityNone) {
+            for (auto &n : this->nodes)
+                for (int c : n)
+                    if (c < CPU_SETSIZE)
+                        CPU_SET (c, &set);
+        } else if (this->affinity == thread_pool::AffinityNUMA) {
+            for (int c : node)
+                if (c < CPU_SETSIZE)
+                    CPU_SET (c, &set);
+        } else {
+            int c = node[(i / nn) % node.size()];
+            if (c < CPU_SETSIZE)
+                CPU_SET (c, &set);
+        }
+        if (CPU_COUNT (&set))
+            pthread_setaffinity_np (this->threads[i]->native_handle(),
+                                    sizeof(set), &set);
+#endif
     }
 
-    void init() { this->nWaiting = 0; this->isStop = false; this->isDone = false; }
+    void init() {
+        this->nodes = Sysutil::numa_node_cpus();
+        this->affinity = thread_pool::AffinityNone;
+        this->nWaiting = 0; this->isStop = false; this->isDone = false;
+        // With a single core, a spinning worker only delays the thread
+        // that would push the next task.
+        this->spin_count = Sysutil::hardware_concurrency() > 1 ? 256 : 0;
+    }
+
+    void forget_worker (std::thread::id id) {
+        spin_lock lock (this->worker_ids_mutex);
+        auto it = std::find (this->worker_ids.begin(), this->worker_ids.end(), id);
+        if (it != this->worker_ids.end())
+            this->worker_ids.erase (it);
+    }
 
     std::vector<std::unique_ptr<std::thread>> threads;
     std::vector<std::shared_ptr<std::atomic<bool>>> flags;
@@ -245,8 +334,13 @@ private:
     std::atomic<bool> isDone;
     std::atomic<bool> isStop;
     std::atomic<int> nWaiting;  // how many threads are waiting
+    int spin_count;  // how many times an idle worker polls before parking
+    std::vector<std::vector<int>> nodes;  // CPUs of each NUMA node
+    thread_pool::Affinity affinity;
     std::mutex mutex;
     std::condition_variable cv;
+    std::vector<std::thread::id> worker_ids;  // ids of the pool's threads
+    mutable spin_mutex worker_ids_mutex;
 };
 
 
@@ -292,6 +386,38 @@ thread_pool::idle () const
 
 
 
+void
+thread_pool::set_affinity (Affinity a)
+{
+    m_impl->set_affinity (a);
+}
+
+
+
+thread_pool::Affinity
+thread_pool::affinity () const
+{
+    return m_impl->get_affinity ();
+}
+
+
+
+int
+thread_pool::numa_node (int thread_id) const
+{
+    return m_impl->numa_node (thread_id);
+}
+
+
+
+bool
+thread_pool::this_thread_is_in_pool () const
+{
+    return m_impl->this_thread_is_in_pool ();
+}
+
+
+
 bool
 thread_pool::run_one_task ()
 {
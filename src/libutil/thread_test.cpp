@@ -153,6 +153,76 @@ time_thread_pool ()
 
 
 
+// Check that then() continuations run only after all the tasks they
+// depend on, and that a pool task waiting on work it pushed runs that
+// work itself rather than deadlocking a one-thread pool.
+void
+test_task_set_then ()
+{
+    std::cout << "\nTesting task_set continuations\n";
+    thread_pool *pool (default_thread_pool());
+    const int n = 100;
+    atomic_int decoded (0), converted (0), written (0);
+    int decoded_seen = -1, converted_seen = -1;
+    {
+        task_set<void> decode (pool), convert (pool), write (pool);
+        for (int i = 0; i < n; ++i)
+            decode.submit ([&](int id){ ++decoded; });
+        decode.then ([&](int id){
+            decoded_seen = decoded;
+            for (int i = 0; i < n; ++i)
+                convert.submit ([&](int id){ ++converted; });
+        }, convert);
+        convert.then ([&](int id){
+            converted_seen = converted;
+            ++written;
+        }, write);
+        write.wait ();
+        OIIO_CHECK_EQUAL (written, 1);
+    }
+    OIIO_CHECK_EQUAL (decoded_seen, n);
+    OIIO_CHECK_EQUAL (converted_seen, n);
+
+    thread_pool small (1);
+    auto outer = small.push ([&](int id){
+        auto inner = small.push ([](int id){ return 42; });
+        small.wait_for (inner);
+        return inner.get() + 1;
+    });
+    OIIO_CHECK_EQUAL (outer.get(), 43);
+}
+
+
+
+// Binding workers to NUMA nodes deals them out in turn, and a bound pool
+// still runs its tasks.
+void
+test_affinity ()
+{
+    std::cout << "\nTesting thread pool affinity\n";
+    int nnodes = int (Sysutil::numa_node_cpus().size());
+    std::cout << "  " << nnodes << " NUMA node(s)\n";
+    OIIO_CHECK_ASSERT (nnodes >= 1);
+    thread_pool pool (4);
+    OIIO_CHECK_EQUAL (pool.affinity(), thread_pool::AffinityNone);
+    OIIO_CHECK_EQUAL (pool.numa_node (0), -1);
+    pool.set_affinity (thread_pool::AffinityCPU);
+    OIIO_CHECK_EQUAL (pool.numa_node (-1), -1);
+    OIIO_CHECK_EQUAL (pool.numa_node (0), 0);
+    OIIO_CHECK_EQUAL (pool.numa_node (3), 3 % nnodes);
+    atomic_int count (0);
+    {
+        task_set<void> tasks (&pool);
+        for (int i = 0; i < 100; ++i)
+            tasks.submit ([&](int id){ ++count; });
+    }
+    OIIO_CHECK_EQUAL (count, 100);
+    pool.set_affinity (thread_pool::AffinityNone);
+    OIIO_CHECK_EQUAL (pool.numa_node (0), -1);
+}
+
+
+
 int
 main (int argc, char **argv)
 {
@@ -170,6 +240,8 @@ main (int argc, char **argv)
 
     time_thread_group ();
     time_thread_pool ();
+    test_task_set_then ();
+    test_affinity ();
 
     return unit_test_failures;
 }
@@ -0,0 +1,309 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "OpenImageIO/trace.h"
+#include "OpenImageIO/thread.h"
+#include "OpenImageIO/strutil.h"
+#include "OpenImageIO/filesystem.h"
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace {
+
+struct Zone {
+    const char *name;
+    const char *detail;
+    unsigned long long begin, end;
+};
+
+
+// The zones recorded by one thread.  The vector grows as needed up to
+// the buffer size, after which it's used as a ring.  Only its own thread
+// records into it; the lock is for the (rare) readers.
+struct ThreadZones {
+    ThreadZones (int id, size_t capacity) : id(id), capacity(capacity) { }
+    int id;
+    size_t capacity;
+    size_t next = 0;        // where the next zone goes once we wrap
+    std::vector<Zone> zones;
+    spin_mutex mutex;
+
+    void add (const Zone &z) {
+        spin_lock lock (mutex);
+        if (zones.size() < capacity) {
+            zones.push_back (z);
+        } else if (capacity) {
+            zones[next] = z;
+            if (++next == capacity)
+                next = 0;
+        }
+    }
+};
+
+
+struct TraceState {
+    TraceState () {
+        // Pair a timestamp with the steady clock, so we can later work
+        // out how long a tick is.
+        start_ticks = Trace::timestamp();
+        start_clock = std::chrono::steady_clock::now();
+        const char *env = getenv ("OIIO_TRACE");
+        if (env && env[0]) {
+            exit_file = env;
+            on = true;
+        }
+    }
+    ~TraceState () {
+        if (exit_file.size())
+            Trace::write (exit_file);
+    }
+
+    atomic_int on { 0 };
+    atomic_int capacity { 65536 };
+    mutex threads_mutex;            // guards threads and exit_file
+    std::vector<std::unique_ptr<ThreadZones> > threads;
+    std::string exit_file;
+    unsigned long long start_ticks;
+    std::chrono::steady_clock::time_point start_clock;
+};
+
+
+static TraceState &
+state ()
+{
+    // Constructed on first use, so zones recorded during static
+    // initialization elsewhere find it ready.
+    static TraceState s;
+    return s;
+}
+
+
+// The calling thread's zones, allocated on its first zone.
+static thread_local ThreadZones *my_zones = NULL;
+
+static ThreadZones *
+thread_zones ()
+{
+    if (! my_zones) {
+        TraceState &s (state());
+        lock_guard lock (s.threads_mutex);
+        s.threads.emplace_back (new ThreadZones (int(s.threads.size()),
+                                                 size_t(s.capacity.load())));
+        my_zones = s.threads.back().get();
+    }
+    return my_zones;
+}
+
+
+// Seconds per tick of Trace::timestamp().
+static double
+seconds_per_tick ()
+{
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || \
+    defined(__i386__) || defined(__x86_64__)
+    // Compare the time stamp counter with the steady clock over the time
+    // since we started, waiting a bit if that's too short to be accurate.
+    TraceState &s (state());
+    unsigned long long ticks;
+    double secs;
+    do {
+        ticks = Trace::timestamp() - s.start_ticks;
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                             - s.start_clock).count();
+    } while (secs < 0.01);
+    return ticks ? secs / double(ticks) : 1.0e-9;
+#else
+    return 1.0e-9;   // timestamp() is in nanoseconds
+#endif
+}
+
+
+static void
+append_json_string (std::string &out, const char *s)
+{
+    out += '\"';
+    for ( ; *s; ++s) {
+        unsigned char c = *s;
+        if (c == '\"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c < 0x20) {
+            out += Strutil::format ("\\u%04x", int(c));
+        } else {
+            out += c;
+        }
+    }
+    out += '\"';
+}
+
+}  // end anon namespace
+
+
+
+void
+Trace::enable (bool on)
+{
+    state().on = on;
+}
+
+
+
+bool
+Trace::enabled ()
+{
+    return state().on.load() != 0;
+}
+
+
+
+void
+Trace::set_buffer_size (int zones_per_thread)
+{
+    state().capacity = std::max (zones_per_thread, 0);
+}
+
+
+
+int
+Trace::buffer_size ()
+{
+    return state().capacity.load();
+}
+
+
+
+void
+Trace::record (const char *name, const char *detail,
+               unsigned long long begin, unsigned long long end)
+{
+    Zone z = { name, detail, begin, end };
+    thread_zones()->add (z);
+}
+
+
+
+void
+Trace::clear ()
+{
+    TraceState &s (state());
+    lock_guard lock (s.threads_mutex);
+    for (auto &t : s.threads) {
+        spin_lock tlock (t->mutex);
+        t->zones.clear ();
+        t->next = 0;
+        t->capacity = size_t(s.capacity.load());
+    }
+}
+
+
+
+size_t
+Trace::size ()
+{
+    TraceState &s (state());
+    lock_guard lock (s.threads_mutex);
+    size_t n = 0;
+    for (auto &t : s.threads) {
+        spin_lock tlock (t->mutex);
+        n += t->zones.size();
+    }
+    return n;
+}
+
+
+
+bool
+Trace::write (string_view filename)
+{
+    TraceState &s (state());
+    double scale = seconds_per_tick() * 1.0e6;   // ticks -> microseconds
+    std::string out;
+    out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    {
+        lock_guard lock (s.threads_mutex);
+        for (auto &t : s.threads) {
+            spin_lock tlock (t->mutex);
+            if (t->zones.empty())
+                continue;
+            out += Strutil::format ("%s{\"name\":\"thread_name\",\"ph\":\"M\","
+                                    "\"pid\":1,\"tid\":%d,\"args\":{\"name\":"
+                                    "\"thread %d\"}}",
+                                    first ? "" : ",\n", t->id, t->id);
+            first = false;
+            for (const Zone &z : t->zones) {
+                // Timestamps are relative to when tracing started up.
+                double ts = double((long long)(z.begin - s.start_ticks)) * scale;
+                double dur = double(z.end - z.begin) * scale;
+                out += ",\n{\"name\":";
+                append_json_string (out, z.name);
+                out += Strutil::format (",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                                        "\"ts\":%.3f,\"dur\":%.3f",
+                                        t->id, ts, dur);
+                if (z.detail) {
+                    out += ",\"args\":{\"detail\":";
+                    append_json_string (out, z.detail);
+                    out += "}";
+                }
+                out += "}";
+            }
+        }
+    }
+    out += "\n]}\n";
+
+    FILE *f = Filesystem::fopen (filename, "wb");
+    if (! f)
+        return false;
+    bool ok = fwrite (out.data(), 1, out.size(), f) == out.size();
+    ok &= (fclose (f) == 0);
+    return ok;
+}
+
+
+
+void
+Trace::write_at_exit (string_view filename)
+{
+    TraceState &s (state());
+    lock_guard lock (s.threads_mutex);
+    s.exit_file = filename;
+}
+
+
+OIIO_NAMESPACE_END
@@ -0,0 +1,138 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Make sure the zones in this file are compiled in, whatever the build.
+#undef OIIO_TRACING
+#define OIIO_TRACING 1
+#include "OpenImageIO/trace.h"
+#include "OpenImageIO/thread.h"
+#include "OpenImageIO/strutil.h"
+#include "OpenImageIO/filesystem.h"
+#include "OpenImageIO/unittest.h"
+
+OIIO_NAMESPACE_USING;
+
+
+
+static void
+inner ()
+{
+    OIIO_TRACE_ZONE ("inner", "some \"detail\"");
+}
+
+
+static void
+outer ()
+{
+    OIIO_TRACE_ZONE ("outer");
+    inner ();
+    inner ();
+}
+
+
+
+static void
+test_zones ()
+{
+    std::cout << "Testing zones\n";
+    Trace::clear ();
+    Trace::enable (false);
+    outer ();
+    OIIO_CHECK_EQUAL (Trace::size(), 0);   // nothing while disabled
+
+    Trace::enable ();
+    OIIO_CHECK_ASSERT (Trace::enabled());
+    outer ();
+    OIIO_CHECK_EQUAL (Trace::size(), 3);
+    Trace::enable (false);
+}
+
+
+
+static void
+test_threads_and_wrap ()
+{
+    std::cout << "Testing multiple threads and buffer wrap\n";
+    Trace::clear ();
+    Trace::set_buffer_size (100);
+    Trace::enable ();
+    thread_group threads;
+    for (int t = 0;  t < 4;  ++t)
+        threads.create_thread ([](){ for (int i = 0; i < 10; ++i) outer(); });
+    threads.join_all ();
+    OIIO_CHECK_EQUAL (Trace::size(), 4*30);
+    // Overflowing a thread's buffer keeps only the most recent zones
+    threads.create_thread ([](){ for (int i = 0; i < 100; ++i) outer(); });
+    threads.join_all ();
+    OIIO_CHECK_EQUAL (Trace::size(), 4*30 + 100);
+    Trace::enable (false);
+    Trace::set_buffer_size (65536);
+}
+
+
+
+static void
+test_write ()
+{
+    std::cout << "Testing write\n";
+    Trace::clear ();   // also resets the buffer sizes
+    Trace::enable ();
+    outer ();
+    Trace::enable (false);
+    const char *filename = "trace_test.json";
+    OIIO_CHECK_ASSERT (Trace::write (filename));
+    std::ifstream in (filename);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    std::string json = contents.str();
+    OIIO_CHECK_ASSERT (Strutil::starts_with (json, "{\"displayTimeUnit\""));
+    OIIO_CHECK_ASSERT (Strutil::contains (json, "\"name\":\"outer\",\"ph\":\"X\""));
+    OIIO_CHECK_ASSERT (Strutil::contains (json, "\"args\":{\"detail\":\"some \\\"detail\\\"\"}"));
+    OIIO_CHECK_ASSERT (Strutil::ends_with (json, "]}\n"));
+    Filesystem::remove (filename);
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+    test_zones ();
+    test_threads_and_wrap ();
+    test_write ();
+    return unit_test_failures;
+}
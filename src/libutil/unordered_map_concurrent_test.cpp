@@ -0,0 +1,215 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "OpenImageIO/unordered_map_concurrent.h"
+#include "OpenImageIO/thread.h"
+#include "OpenImageIO/strutil.h"
+#include "OpenImageIO/sysutil.h"
+#include "OpenImageIO/timer.h"
+#include "OpenImageIO/argparse.h"
+#include "OpenImageIO/ustring.h"
+
+#include "OpenImageIO/unittest.h"
+
+
+OIIO_NAMESPACE_USING;
+
+// Test unordered_map_concurrent: first that entries survive the bins
+// growing (and being moved, a few at a time, into their bigger maps),
+// then time a read-heavy mix of retrieve and insert from a growing
+// number of threads.
+
+static int nentries = 1000000;
+static int read_write_ratio = 99;
+static int iterations = 4000000;
+static int numthreads = 16;
+static int ntrials = 1;
+static bool verbose = false;
+static bool wedge = false;
+
+typedef unordered_map_concurrent<int, int, std::hash<int>,
+                                 std::equal_to<int>, 16> IntMap;
+
+
+
+static void
+test_growth ()
+{
+    std::cout << "test growth\n";
+    IntMap map;
+    const int n = 100000;
+    for (int i = 0;  i < n;  ++i)
+        OIIO_CHECK_ASSERT (map.insert (i, 3*i));
+    OIIO_CHECK_EQUAL (map.size(), size_t(n));
+    OIIO_CHECK_ASSERT (! map.insert (17, 0));   // already there
+
+    int missing = 0, wrong = 0;
+    for (int i = 0;  i < n;  ++i) {
+        int v = -1;
+        if (! map.retrieve (i, v))
+            ++missing;
+        else if (v != 3*i)
+            ++wrong;
+    }
+    OIIO_CHECK_EQUAL (missing, 0);
+    OIIO_CHECK_EQUAL (wrong, 0);
+    {
+        IntMap::iterator it = map.find (12345);
+        OIIO_CHECK_ASSERT (it && it->second == 3*12345);
+    }
+
+    // Iteration must visit every entry exactly once, wherever it lives
+    std::vector<char> seen (n, 0);
+    size_t count = 0;
+    for (IntMap::iterator it = map.begin();  it != map.end();  ++it) {
+        ++count;
+        if (it->first >= 0 && it->first < n)
+            ++seen[it->first];
+    }
+    OIIO_CHECK_EQUAL (count, size_t(n));
+    OIIO_CHECK_EQUAL (std::count (seen.begin(), seen.end(), 1), n);
+
+    for (int i = 0;  i < n;  i += 2)
+        map.erase (i);
+    OIIO_CHECK_EQUAL (map.size(), size_t(n/2));
+    int v;
+    OIIO_CHECK_ASSERT (! map.retrieve (100, v));
+    OIIO_CHECK_ASSERT (map.retrieve (101, v) && v == 303);
+}
+
+
+
+static IntMap *benchmap = NULL;
+static atomic_int next_key;
+
+static void
+do_lookups (int iterations)
+{
+    int found = 0;
+    for (int i = 0;  i < iterations;  ++i) {
+        if ((i % (read_write_ratio+1)) == read_write_ratio) {
+            benchmap->insert (next_key++, i);
+        } else {
+            int v;
+            found += benchmap->retrieve ((i * 7919) % nentries, v);
+        }
+    }
+    if (found < 0)   // meaningless, keeps the lookups from being elided
+        std::cout << found;
+}
+
+
+
+static void
+test_lookups (int numthreads, int iterations)
+{
+    thread_group threads;
+    for (int i = 0;  i < numthreads;  ++i)
+        threads.create_thread (do_lookups, iterations);
+    threads.join_all ();
+}
+
+
+
+static void
+getargs (int argc, char *argv[])
+{
+    bool help = false;
+    ArgParse ap;
+    ap.options ("unordered_map_concurrent_test\n"
+                OIIO_INTRO_STRING "\n"
+                "Usage:  unordered_map_concurrent_test [options]",
+                // "%*", parse_files, "",
+                "--help", &help, "Print help message",
+                "-v", &verbose, "Verbose mode",
+                "--threads %d", &numthreads,
+                    ustring::format("Number of threads (default: %d)", numthreads).c_str(),
+                "--iters %d", &iterations,
+                    ustring::format("Number of iterations (default: %d)", iterations).c_str(),
+                "--entries %d", &nentries,
+                    ustring::format("Initial entries in the map (default: %d)", nentries).c_str(),
+                "--trials %d", &ntrials, "Number of trials",
+                "--rwratio %d", &read_write_ratio,
+                    ustring::format("Reader::writer ratio (default: %d)", read_write_ratio).c_str(),
+                "--wedge", &wedge, "Do a wedge test",
+                NULL);
+    if (ap.parse (argc, (const char**)argv) < 0) {
+        std::cerr << ap.geterror() << std::endl;
+        ap.usage ();
+        exit (EXIT_FAILURE);
+    }
+    if (help) {
+        ap.usage ();
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+
+int main (int argc, char *argv[])
+{
+    getargs (argc, argv);
+
+    test_growth ();
+
+    IntMap map;
+    benchmap = &map;
+    for (int i = 0;  i < nentries;  ++i)
+        map.insert (i, i);
+    next_key = nentries;
+
+    std::cout << "hw threads = " << Sysutil::hardware_concurrency() << "\n";
+    std::cout << "reader:writer ratio = " << read_write_ratio << ":1\n";
+    std::cout << "threads\ttime (best of " << ntrials << ")\n";
+    std::cout << "-------\t----------\n";
+
+    static int threadcounts[] = { 1, 2, 4, 8, 12, 16, 20, 24, 28, 32, 64, 128, 1024, 1<<30 };
+    for (int i = 0; threadcounts[i] <= numthreads; ++i) {
+        int nt = wedge ? threadcounts[i] : numthreads;
+        int its = iterations/nt;
+
+        double range;
+        double t = time_trial (std::bind(test_lookups,nt,its),
+                               ntrials, &range);
+
+        std::cout << Strutil::format ("%2d\t%s\t%5.2f Mlookups/s, range %.1f\t(%d iters/thread)\n",
+                                      nt, Strutil::timeintervalformat(t),
+                                      double(its)*nt/t*1.0e-6, range, its);
+        if (! wedge)
+            break;    // don't loop if we're not wedging
+    }
+
+    return unit_test_failures;
+}
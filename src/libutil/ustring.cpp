@@ -43,12 +43,12 @@ OIIO_NAMESPACE_BEGIN
 typedef mutex ustring_mutex_t;
 typedef lock_guard ustring_read_lock_t;
 typedef lock_guard ustring_write_lock_t;
-#elif 0
-// Use spin locks
+#elif 1
+// Use spin locks (only inserts lock; lookups don't, see TableRepMap)
 typedef spin_mutex ustring_mutex_t;
 typedef spin_lock ustring_read_lock_t;
 typedef spin_lock ustring_write_lock_t;
-#elif 1
+#elif 0
 // Use rw spin locks
 typedef spin_rw_mutex ustring_mutex_t;
 typedef spin_rw_read_lock ustring_read_lock_t;
@@ -61,16 +61,25 @@ typedef null_lock<null_mutex> ustring_write_lock_t;
 #endif
 
 
+// Open-addressed hash table of TableRep pointers.  Lookups take no lock
+// at all: insert() (which does lock, so there is one writer at a time)
+// only ever fills empty slots, publishing each fully constructed TableRep
+// with a release store, and when it grows it publishes a whole new table
+// the same way.  An outgrown table is never freed (like the TableReps
+// themselves, it simply leaks), so a lookup still probing it sees only
+// valid entries; at worst it misses a string that was just added, in
+// which case make_unique goes on to insert(), which finds it under the
+// lock.  Keeping the old tables costs at most as much again as the
+// current one.
 // NOTE: BASE_CAPACITY must be a power of 2
 template <unsigned BASE_CAPACITY = 1 << 20, unsigned POOL_SIZE = 4 << 20>
 struct TableRepMap {
     TableRepMap() :
-        mask(BASE_CAPACITY - 1),
-        entries(static_cast<ustring::TableRep**>(calloc(BASE_CAPACITY, sizeof(ustring::TableRep*)))),
+        table(new_table(BASE_CAPACITY)),
         num_entries(0),
         pool(static_cast<char*>(malloc(POOL_SIZE))),
         pool_offset(0),
-        memory_usage(sizeof(*this) + POOL_SIZE + sizeof(ustring::TableRep*) * BASE_CAPACITY),
+        memory_usage(sizeof(*this) + POOL_SIZE + sizeof(Table) + sizeof(Entry) * BASE_CAPACITY),
         num_lookups(0) {}
 
     ~TableRepMap() { /* just let memory leak */ }
@@ -91,7 +100,6 @@ struct TableRepMap {
     }
 
     const char* lookup(string_view str, size_t hash) {
-        ustring_read_lock_t lock(mutex);
 #if 0
         // NOTE: this simple increment adds a substantial amount of overhead
         // so keep it off by default, unless the user really wants it
@@ -99,63 +107,81 @@ struct TableRepMap {
         // can skew the number of lookups compared to release builds
         ++num_lookups;
 #endif
-        size_t pos = hash & mask, dist = 0;
+        const Table *t = table.load(std::memory_order_acquire);
+        size_t pos = hash & t->mask, dist = 0;
         for (;;) {
-            if (entries[pos] == 0) return 0;
-            if (entries[pos]->hashed == hash &&
-                entries[pos]->length == str.length() &&
-                strncmp(entries[pos]->c_str(), str.data(), str.length()) == 0)
-                return entries[pos]->c_str();
+            const ustring::TableRep *rep = t->entries[pos].load(std::memory_order_acquire);
+            if (rep == 0) return 0;
+            if (rep->hashed == hash &&
+                rep->length == str.length() &&
+                strncmp(rep->c_str(), str.data(), str.length()) == 0)
+                return rep->c_str();
             ++dist;
-            pos = (pos + dist) & mask; // quadratic probing
+            pos = (pos + dist) & t->mask; // quadratic probing
         }
     }
 
     const char* insert(string_view str, size_t hash) {
         ustring_write_lock_t lock(mutex);
-        size_t pos = hash & mask, dist = 0;
+        Table *t = table.load(std::memory_order_relaxed);
+        size_t pos = hash & t->mask, dist = 0;
         for (;;) {
-            if (entries[pos] == 0) break; // found insert pos
-            if (entries[pos]->hashed == hash &&
-                entries[pos]->length == str.length() &&
-                strncmp(entries[pos]->c_str(), str.data(), str.length()) == 0)
-                return entries[pos]->c_str(); // same string is already inserted, return the one that is already in the table
+            const ustring::TableRep *rep = t->entries[pos].load(std::memory_order_relaxed);
+            if (rep == 0) break; // found insert pos
+            if (rep->hashed == hash &&
+                rep->length == str.length() &&
+                strncmp(rep->c_str(), str.data(), str.length()) == 0)
+                return rep->c_str(); // same string is already inserted, return the one that is already in the table
             ++dist;
-            pos = (pos + dist) & mask; // quadratic probing
+            pos = (pos + dist) & t->mask; // quadratic probing
         }
 
         ustring::TableRep* rep = make_rep(str, hash);
-        entries[pos] = rep;
+        t->entries[pos].store(rep, std::memory_order_release);
         ++num_entries;
-        if (2 * num_entries > mask) grow(); // maintain 0.5 load factor
+        if (2 * num_entries > t->mask) grow(); // maintain 0.5 load factor
         return rep->c_str();                // rep is now in the table
     }
 
 private:
+    typedef std::atomic<ustring::TableRep*> Entry;
+    struct Table {
+        size_t mask;
+        Entry *entries;
+    };
+
+    static Table* new_table(size_t capacity) {
+        // N.B. calloc'ed memory is a valid array of null atomic pointers
+        Table *t = new Table;
+        t->mask = capacity - 1;
+        t->entries = static_cast<Entry*>(calloc(capacity, sizeof(Entry)));
+        return t;
+    }
+
     void grow() {
-        size_t new_mask = mask * 2 + 1;
+        Table *old_table = table.load(std::memory_order_relaxed);
+        size_t new_mask = old_table->mask * 2 + 1;
 
-        // NOTE: only increment by half because we are doubling the entries and freeing the old
-        memory_usage += (mask + 1) * sizeof(ustring::TableRep*);
+        // NOTE: the old table is kept (see above), so count all of the new
+        memory_usage += sizeof(Table) + (new_mask + 1) * sizeof(Entry);
 
-        ustring::TableRep** new_entries = static_cast<ustring::TableRep**>(calloc(new_mask + 1, sizeof(ustring::TableRep*)));
+        Table *new_t = new_table(new_mask + 1);
         size_t to_copy = num_entries;
         for (size_t i = 0; to_copy != 0; i++) {
-            if (entries[i] == 0)  continue;
-            size_t pos = entries[i]->hashed & new_mask, dist = 0;
+            ustring::TableRep *rep = old_table->entries[i].load(std::memory_order_relaxed);
+            if (rep == 0)  continue;
+            size_t pos = rep->hashed & new_mask, dist = 0;
             for (;;) {
-                if (new_entries[pos] == 0)
+                if (new_t->entries[pos].load(std::memory_order_relaxed) == 0)
                     break;
                 ++dist;
                 pos = (pos + dist) & new_mask; // quadratic probing
             }
-            new_entries[pos] = entries[i];
+            new_t->entries[pos].store(rep, std::memory_order_relaxed);
             to_copy--;
         }
 
-        free(entries);
-        entries = new_entries;
-        mask    = new_mask;
+        table.store(new_t, std::memory_order_release);
     }
 
     ustring::TableRep* make_rep(string_view str, size_t hash) {
@@ -179,9 +205,8 @@ private:
         return result;
     }
 
+    OIIO_CACHE_ALIGN std::atomic<Table*> table;
     OIIO_CACHE_ALIGN ustring_mutex_t mutex;
-    size_t mask;
-    ustring::TableRep** entries;
     size_t num_entries;
     char* pool;
     size_t pool_offset;
@@ -32,6 +32,8 @@
 #include <iostream>
 #include <cstdio>
 #include <functional>
+#include <vector>
+#include <algorithm>
 
 #include "OpenImageIO/thread.h"
 #include "OpenImageIO/ustring.h"
@@ -85,6 +87,51 @@ void test_ustring_lock (int numthreads, int iterations)
 
 
 
+// Measure how well looking up strings that are already in the table (the
+// common case, for example when the same names are made over and over
+// while setting up each frame) scales with the number of threads.  Each
+// thread looks up every string many times, and checks that it gets back
+// the same unique characters.
+static void
+test_ustring_lookup_contention (int iterations)
+{
+    const int nstrings = 10000;
+    std::vector<std::string> names;
+    std::vector<const char *> uniques;
+    for (int i = 0;  i < nstrings;  ++i) {
+        names.push_back (Strutil::format ("material_%d/param_%d", i/16, i%16));
+        uniques.push_back (ustring(names.back()).c_str());
+    }
+
+    std::cout << "\nLookups of existing ustrings:\n";
+    std::cout << "threads\tMlookups/sec (total)\n";
+    std::cout << "-------\t----------\n";
+    for (int nt = 1;  nt <= 64;  nt *= 2) {
+        int its = std::max (1, iterations / nt);
+        atomic_int failures (0);
+        auto func = [&](){
+            int fails = 0;
+            for (int i = 0;  i < its;  ++i) {
+                int s = i % nstrings;
+                if (ustring(names[s]).c_str() != uniques[s])
+                    ++fails;
+            }
+            failures += fails;
+        };
+        Timer timer;
+        thread_group threads;
+        for (int t = 0;  t < nt;  ++t)
+            threads.create_thread (func);
+        threads.join_all ();
+        double time = timer();
+        OIIO_CHECK_EQUAL (failures, 0);
+        std::cout << Strutil::format ("%2d\t%7.2f\n", nt,
+                                      (double(its) * nt / 1.0e6) / time);
+    }
+}
+
+
+
 static void
 getargs (int argc, char *argv[])
 {
@@ -144,6 +191,8 @@ int main (int argc, char *argv[])
             break;    // don't loop if we're not wedging
     }
 
+    test_ustring_lookup_contention (iterations);
+
     if (verbose)
         std::cout << "\n" << ustring::getstats() << "\n";
 
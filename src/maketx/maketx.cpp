@@ -62,6 +62,9 @@ static std::string outputfilename;
 static bool verbose = false;
 static bool runstats = false;
 static int nthreads = 0;    // default: use #cores threads if available
+static int maxmem_MB = 0;   // default: no memory bound
+static std::string batchfile;
+static int batchjobs = 0;   // default: pick from the number of cores
 
 // Conversion modes.  If none are true, we just make an ordinary texture.
 static bool mipmapmode = false;
@@ -183,6 +186,7 @@ getargs (int argc, char *argv[], ImageSpec &configspec)
     int tile[3] = { 64, 64, 1 };  // FIXME if we ever support volume MIPmaps
     std::string compression = "zip";
     bool updatemode = false;
+    bool incremental = false;
     bool checknan = false;
     std::string fixnan; // none, black, box3
     bool set_full_to_pixels = false;
@@ -202,6 +206,8 @@ getargs (int argc, char *argv[], ImageSpec &configspec)
     bool monochrome_detect = false;
     bool opaque_detect = false;
     bool compute_average = true;
+    bool tile_stats = false;
+    bool envcdf = false;
     int nchannels = -1;
     bool prman = false;
     bool oiio = false;
@@ -225,7 +231,11 @@ getargs (int argc, char *argv[], ImageSpec &configspec)
                   "-v", &verbose, "Verbose status messages",
                   "-o %s", &outputfilename, "Output filename",
                   "--threads %d", &nthreads, "Number of threads (default: #cores)",
+                  "--maxmem %d", &maxmem_MB, "Bound memory use to about this many MB, spilling big images to scratch files (default: 0 = no bound)",
+                  "--batch %s", &batchfile, "Convert every texture listed in this file (one \"input [output]\" per line)",
+                  "--batchjobs %d", &batchjobs, "Number of textures to convert at once with --batch (default: 0 = automatic)",
                   "-u", &updatemode, "Update mode",
+                  "--incremental", &incremental, "Incremental mode (skip if the pixels are unchanged)",
                   "--format %s", &fileformatname, "Specify output file format (default: guess from extension)",
                   "--nchannels %d", &nchannels, "Specify the number of output image channels.",
                   "--chnames %s", &channelnames, "Rename channels (comma-separated)",
@@ -268,6 +278,7 @@ getargs (int argc, char *argv[], ImageSpec &configspec)
                   "--monochrome-detect", &monochrome_detect, "Create 1-channel textures from monochrome inputs",
                   "--opaque-detect", &opaque_detect, "Drop alpha channel that is always 1.0",
                   "--no-compute-average %!", &compute_average, "Don't compute and store average color",
+                  "--tilestats", &tile_stats, "Compute and store the average, min, and max of each tile",
                   "--ignore-unassoc", &ignore_unassoc, "Ignore unassociated alpha tags in input (don't autoconvert)",
                   "--runstats", &runstats, "Print runtime statistics",
                   "--stats", &runstats, "", // DEPRECATED 1.6
@@ -276,6 +287,7 @@ getargs (int argc, char *argv[], ImageSpec &configspec)
                   "--shadow", &shadowmode, "Create shadow map",
                   "--envlatl", &envlatlmode, "Create lat/long environment map",
                   "--lightprobe", &lightprobemode, "Create lat/long environment map from a light probe",
+                  "--envcdf", &envcdf, "Store importance-sampling tables with a lat/long environment map",
 //                  "--envcube", &envcubemode, "Create cubic env map (file order: px, nx, py, ny, pz, nz) (UNIMP)",
                   "<SEPARATOR>", colortitle_help_string().c_str(),
                   "--colorconvert %s %s", &incolorspace, &outcolorspace,
@@ -296,7 +308,7 @@ getargs (int argc, char *argv[], ImageSpec &configspec)
         ap.usage ();
         exit (EXIT_FAILURE);
     }
-    if (filenames.empty()) {
+    if (filenames.empty() && batchfile.empty()) {
         ap.briefusage ();
         std::cout << "\nFor detailed help: maketx --help\n";
         exit (EXIT_SUCCESS);
@@ -319,7 +331,13 @@ getargs (int argc, char *argv[], ImageSpec &configspec)
         exit (EXIT_FAILURE);
     }
 
-    if (filenames.size() != 1) {
+    if (batchfile.size()) {
+        if (filenames.size() || outputfilename.size()) {
+            std::cerr << "maketx ERROR: with --batch, the input and output "
+                      << "filenames come from the batch file\n";
+            exit (EXIT_FAILURE);
+        }
+    } else if (filenames.size() != 1) {
         std::cerr << "maketx ERROR: requires exactly one input filename\n";
         exit (EXIT_FAILURE);
     }
@@ -369,10 +387,17 @@ getargs (int argc, char *argv[], ImageSpec &configspec)
     configspec.attribute ("maketx:resize", doresize);
     configspec.attribute ("maketx:nomipmap", nomipmap);
     configspec.attribute ("maketx:updatemode", updatemode);
+    if (maxmem_MB > 0) {
+        // Images bigger than half the budget are read through the cache.
+        configspec.attribute ("maketx:read_local_MB", std::max (1, maxmem_MB/2));
+    }
+    configspec.attribute ("maketx:incremental", incremental);
     configspec.attribute ("maketx:constant_color_detect", constant_color_detect);
     configspec.attribute ("maketx:monochrome_detect", monochrome_detect);
     configspec.attribute ("maketx:opaque_detect", opaque_detect);
     configspec.attribute ("maketx:compute_average", compute_average);
+    configspec.attribute ("maketx:tile_stats", tile_stats);
+    configspec.attribute ("maketx:envcdf", envcdf);
     configspec.attribute ("maketx:unpremult", unpremult);
     configspec.attribute ("maketx:incolorspace", incolorspace);
     configspec.attribute ("maketx:outcolorspace", outcolorspace);
@@ -455,6 +480,14 @@ main (int argc, char *argv[])
     ImageCache *ic = ImageCache::create ();  // get the shared one
     ic->attribute ("forcefloat", 1);   // Force float upon read
     ic->attribute ("max_memory_MB", 1024.0);  // 1 GB cache
+    if (maxmem_MB > 0) {
+        // Split the memory budget: a quarter for the cache, and half for
+        // the pixels of the ImageBufs (source, MIP levels, and any
+        // scratch copies), beyond which they are backed by scratch files
+        // and paged in and out as they are used.
+        ic->attribute ("max_memory_MB", std::min (1024.0f, maxmem_MB/4.0f));
+        OIIO::attribute ("imagebuf:spill_MB", std::max (1, maxmem_MB/2));
+    }
 
     ImageBufAlgo::MakeTextureMode mode = ImageBufAlgo::MakeTxTexture;
     if (shadowmode)
@@ -463,9 +496,39 @@ main (int argc, char *argv[])
         mode = ImageBufAlgo::MakeTxEnvLatl;
     if (lightprobemode)
         mode = ImageBufAlgo::MakeTxEnvLatlFromLightProbe;
-    bool ok = ImageBufAlgo::make_texture (mode, filenames[0],
-                                          outputfilename, configspec,
-                                          &std::cout);
+    bool ok;
+    if (batchfile.size()) {
+        // Each non-blank line that isn't a comment names an input file and,
+        // optionally, the texture to make from it.
+        std::string list;
+        if (! Filesystem::read_text_file (batchfile, list)) {
+            std::cerr << "maketx ERROR: could not read batch file \""
+                      << batchfile << "\"\n";
+            return EXIT_FAILURE;
+        }
+        std::vector<std::string> lines, inputs, outputs;
+        Strutil::split (list, lines, "\n");
+        for (auto &line : lines) {
+            std::vector<std::string> words;
+            Strutil::split (line, words);
+            if (words.empty() || words[0][0] == '#')
+                continue;
+            if (words.size() > 2) {
+                std::cerr << "maketx ERROR: malformed batch file line \""
+                          << line << "\"\n";
+                return EXIT_FAILURE;
+            }
+            inputs.push_back (words[0]);
+            outputs.push_back (words.size() > 1 ? words[1] : std::string());
+        }
+        ok = ImageBufAlgo::make_texture_batch (mode, inputs, outputs,
+                                               configspec, &std::cout,
+                                               batchjobs);
+    } else {
+        ok = ImageBufAlgo::make_texture (mode, filenames[0],
+                                         outputfilename, configspec,
+                                         &std::cout);
+    }
     if (runstats)
         std::cout << "\n" << ic->getstats();
 
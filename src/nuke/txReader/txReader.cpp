@@ -7,6 +7,7 @@
 #include "DDImage/Row.h"
 
 #include "OpenImageIO/imageio.h"
+#include "OpenImageIO/imagecache.h"
 
 
 using namespace DD::Image;
@@ -16,10 +17,10 @@ using namespace DD::Image;
  * TODO:
  * - Look into using the planar Reader API in Nuke 8, which may map better to
  *      TIFF/OIIO.
- * - It would be nice to have a way to read in a region, rather than the whole
- *      image, but this would require access to the Read's request region,
- *      which isn't currently possible. A feature request for this is logged
- *      with The Foundry as Bug 46237.
+ * - Pixels are fetched through the shared ImageCache one row span at a time,
+ *      so only the tiles overlapping the region Nuke actually asks for are
+ *      ever read. Access to the Read's full request region (Bug 46237 with
+ *      The Foundry) would let us prefetch whole tile rows instead.
  */
 
 
@@ -36,6 +37,8 @@ static const char* const EMPTY[] = {NULL};
 class TxReaderFormat : public ReaderFormat {
     int mipLevel_;
     int mipEnumIndex_;
+    bool autoMip_;
+    int cacheSizeMB_;
     Knob* mipLevelKnob_;
     Knob* mipLevelEnumKnob_;
 
@@ -43,6 +46,8 @@ public:
     TxReaderFormat() :
         mipLevel_(0),
         mipEnumIndex_(0),
+        autoMip_(true),
+        cacheSizeMB_(1024),
         mipLevelKnob_(NULL),
         mipLevelEnumKnob_(NULL)
     { }
@@ -61,6 +66,17 @@ public:
         SetFlags(cb, Knob::EXPAND_TO_WIDTH | Knob::DO_NOT_WRITE | Knob::NO_RERENDER);
         Tooltip(cb, "The mip level to read from the file. Currently, this will "
                 "be resampled to fill the same resolution as the base image.");
+
+        Bool_knob(cb, &autoMip_, "tx_auto_mip", "proxy mip selection");
+        Tooltip(cb, "In proxy mode, read the smallest mip level that still "
+                "covers the proxy resolution, if it is coarser than the "
+                "mip level chosen above.");
+
+        Int_knob(cb, &cacheSizeMB_, "tx_cache_size", "cache size (MB)");
+        SetFlags(cb, Knob::NO_RERENDER | Knob::NO_ANIMATION);
+        Tooltip(cb, "Memory limit of the texture tile cache. The cache is "
+                "shared by every tx Read in the session, so the most "
+                "recently opened file sets the limit for all of them.");
     }
 
     int knob_changed(Knob* k) {
@@ -69,9 +85,14 @@ public:
         return 1;
     }
 
-    void append(Hash& hash) { hash.append(mipLevel_); }
+    void append(Hash& hash) {
+        hash.append(mipLevel_);
+        hash.append(autoMip_);
+    }
 
     inline int mipLevel() { return mipLevel_; }
+    inline bool autoMip() { return autoMip_; }
+    inline int cacheSizeMB() { return cacheSizeMB_; }
 
     void setMipLabels(std::vector<std::string> items) {
         if (mipLevelEnumKnob_) {
@@ -88,12 +109,13 @@ public:
 
 
 class txReader : public Reader {
-    ImageInput* oiioInput_;
+    ImageCache* cache_;     // Shared by all tx Reads; never destroyed here
+    ustring filename_;
     TxReaderFormat* txFmt_;
 
-    int chanCount_, lastMipLevel_;
-    bool haveImage_, flip_;
-    std::vector<float> imageBuf_;
+    int chanCount_, mipLevel_;
+    bool flip_;
+    std::vector<ImageSpec> mipSpecs_;
     std::map<Channel, int> chanMap_;
 
     MetaData::Bundle meta_;
@@ -192,26 +214,54 @@ class txReader : public Reader {
         info_.channels(mask);
     }
 
+    // Pick the coarsest mip level that still has at least as many pixels
+    // as the proxy resolution Nuke is rendering at.
+    int proxyMipLevel() const {
+        const OutputContext& ctx = iop->outputContext();
+        if (!ctx.proxy())
+            return 0;
+        const double scale = std::min(ctx.scale_x(), ctx.scale_y());
+        if (scale >= 1.0)
+            return 0;
+        const double needW = width() * scale, needH = height() * scale;
+        int level = 0;
+        while (level + 1 < int(mipSpecs_.size()) &&
+               mipSpecs_[level + 1].width >= needW &&
+               mipSpecs_[level + 1].height >= needH)
+            ++level;
+        return level;
+    }
+
+    // Map a coordinate of the base image onto a mip level of size mipSize.
+    static inline int mipCoord(int v, int mipSize, int size) {
+        return int((long long)v * mipSize / size);
+    }
+
 public:
     txReader(Read* iop) : Reader(iop),
+            cache_(NULL),
+            filename_(filename()),
             chanCount_(0),
-            lastMipLevel_(-1),
-            haveImage_(false),
+            mipLevel_(0),
             flip_(false)
     {
         txFmt_ = dynamic_cast<TxReaderFormat*>(iop->handler());
 
         OIIO::attribute("threads", (int)Thread::numThreads / 2);
 
-        oiioInput_ = ImageInput::open(filename());
-        if (!oiioInput_) {
+        cache_ = ImageCache::create(true /* shared */);
+        cache_->attribute("max_memory_MB", float(txFmt_->cacheSizeMB()));
+        // A new Reader means the file was (re)opened by the Read, so make
+        // sure we don't serve tiles cached from an older version of it.
+        cache_->invalidate(filename_);
+
+        ImageSpec baseSpec;
+        if (!cache_->get_imagespec(filename_, baseSpec, 0, 0)) {
             iop->internalError("OIIO: Failed to open file %s: %s", filename(),
-                               geterror().c_str());
+                               cache_->geterror().c_str());
             return;
         }
 
-        const ImageSpec& baseSpec = oiioInput_->spec();
-
         if (!(baseSpec.width * baseSpec.height)) {
             iop->internalError("tx file has one or more zero dimensions "
                                "(%d x %d)", baseSpec.width, baseSpec.height);
@@ -219,7 +269,10 @@ public:
         }
 
         chanCount_ = baseSpec.nchannels;
-        const bool isEXR = strcmp(oiioInput_->format_name(), "openexr") == 0;
+        ustring fileformat;
+        cache_->get_image_info(filename_, 0, 0, ustring("fileformat"),
+                               TypeDesc::STRING, &fileformat);
+        const bool isEXR = fileformat == "openexr";
 
         if (isEXR) {
             float pixAspect = baseSpec.get_float_attribute("PixelAspectRatio", 0);
@@ -246,105 +299,90 @@ public:
         std::vector<std::string> mipLabels;
         std::ostringstream buf;
         ImageSpec mipSpec(baseSpec);
-        int mipLevel = 0;
         while (true) {
+            const int mipLevel = int(mipSpecs_.size());
+            mipSpecs_.push_back(mipSpec);
             buf << mipLevel << " - " << mipSpec.width << 'x' << mipSpec.height;
             mipLabels.push_back(buf.str());
-            if (oiioInput_->seek_subimage(0, mipLevel + 1, mipSpec)) {
+            if (cache_->get_imagespec(filename_, mipSpec, 0, mipLevel + 1)) {
                 buf.str(std::string());
                 buf.clear();
-                mipLevel++;
             }
             else
                 break;
         }
+        cache_->geterror();  // Clear the error from probing past the last level
 
-        meta_.setData("tx/mip_levels", mipLevel + 1);
+        meta_.setData("tx/mip_levels", int(mipSpecs_.size()));
 
         txFmt_->setMipLabels(mipLabels);
     }
 
-    virtual ~txReader() {
-        if (oiioInput_)
-            oiioInput_->close();
-        delete oiioInput_;
-        oiioInput_ = NULL;
-    }
-
     void open() {
-        if (lastMipLevel_ != txFmt_->mipLevel()) {
-            ImageSpec mipSpec;
-            if (!oiioInput_->seek_subimage(0, txFmt_->mipLevel(), mipSpec)) {
-                iop->internalError("Failed to seek to mip level %d: %s",
-                        txFmt_->mipLevel(), oiioInput_->geterror().c_str());
-                return;
-            }
+        if (mipSpecs_.empty())
+            return;
 
-            if (txFmt_->mipLevel() && mipSpec.nchannels != chanCount_) {
-                iop->internalError("txReader does not support mip levels with "
-                                   "different channel counts");
-                return;
-            }
+        int level = std::min(txFmt_->mipLevel(), int(mipSpecs_.size()) - 1);
+        if (txFmt_->autoMip())
+            level = std::max(level, proxyMipLevel());
 
-            lastMipLevel_ = txFmt_->mipLevel();
-            haveImage_ = false;
+        if (level && mipSpecs_[level].nchannels != chanCount_) {
+            iop->internalError("txReader does not support mip levels with "
+                               "different channel counts");
+            return;
         }
 
-        if (!haveImage_) {
-            const int needSize = oiioInput_->spec().width
-                                * oiioInput_->spec().height
-                                * oiioInput_->spec().nchannels;
-            if (size_t(needSize) > imageBuf_.size())
-                imageBuf_.resize(needSize);
-            oiioInput_->read_image(&imageBuf_[0]);
-            haveImage_ = true;
-        }
+        mipLevel_ = level;
     }
 
     void engine(int y, int x, int r, ChannelMask channels, Row& row) {
-        if (!haveImage_)
-            iop->internalError("engine called, but haveImage_ is false");
-
-        if (aborted()) {
+        if (aborted() || mipSpecs_.empty()) {
             row.erase(channels);
             return;
         }
 
         const bool doAlpha = channels.contains(Chan_Alpha);
+        const ImageSpec& spec = mipSpecs_[mipLevel_];
 
         if (flip_)
             y = height() - y - 1;
 
-        if (lastMipLevel_) {  // Mip level other than 0
-            const int mipW = oiioInput_->spec().width;
-            const int mipMult = width() / mipW;
+        // Only the span [x,r) of this row is fetched, so the cache touches
+        // just the tiles that overlap the region being rendered.
+        const int mipY = mipCoord(y, spec.height, height());
+        const int mipX = mipCoord(x, spec.width, width());
+        const int mipR = mipCoord(r - 1, spec.width, width()) + 1;
+        const int mipW = mipR - mipX;
+
+        std::vector<float> pixels(mipW * chanCount_);
+        if (!cache_->get_pixels(filename_, 0, mipLevel_,
+                                spec.x + mipX, spec.x + mipR,
+                                spec.y + mipY, spec.y + mipY + 1,
+                                spec.z, spec.z + 1,
+                                TypeDesc::FLOAT, &pixels[0])) {
+            iop->internalError("OIIO: Failed to read %s: %s", filename(),
+                               cache_->geterror().c_str());
+            row.erase(channels);
+            return;
+        }
 
-            y = y * oiioInput_->spec().height / height();
-            const int bufX = x ? x / mipMult : 0;
-            const int bufR = r / mipMult;
-            const int bufW = bufR - bufX;
+        const float* alpha = doAlpha ? &pixels[chanMap_[Chan_Alpha]] : NULL;
 
-            std::vector<float> chanBuf(bufW);
-            float* chanStart = &chanBuf[0];
-            const int bufStart = y * mipW * chanCount_ + bufX * chanCount_;
-            const float* alpha = doAlpha ? &imageBuf_[bufStart + chanMap_[Chan_Alpha]] : NULL;
+        if (mipW == r - x) {  // One mip pixel per output pixel
             foreach (z, channels) {
-                from_float(z, &chanBuf[0], &imageBuf_[bufStart + chanMap_[z]],
-                           alpha, bufW, chanCount_);
-
-                float* OUT = row.writable(z);
-                for (int stride = 0, c = 0; stride < bufW; stride++, c = 0)
-                    for (; c < mipMult; c++)
-                        *OUT++ = *(chanStart + stride);
+                from_float(z, row.writable(z) + x, &pixels[chanMap_[z]],
+                           alpha, mipW, chanCount_);
             }
         }
-        else {  // Mip level 0
-            const int pixStart = y * width() * chanCount_ + x * chanCount_;
-            const float* alpha = doAlpha ? &imageBuf_[pixStart + chanMap_[Chan_Alpha]] : NULL;
-
+        else {  // Coarser mip level, replicate to fill the base resolution
+            std::vector<float> chanBuf(mipW);
             foreach (z, channels) {
-                from_float(z, row.writable(z) + x, &imageBuf_[pixStart + chanMap_[z]],
-                           alpha, r - x, chanCount_);
+                from_float(z, &chanBuf[0], &pixels[chanMap_[z]],
+                           alpha, mipW, chanCount_);
+
+                float* OUT = row.writable(z);
+                for (int X = x; X < r; ++X)
+                    OUT[X] = chanBuf[mipCoord(X, spec.width, width()) - mipX];
             }
         }
     }
@@ -131,7 +131,12 @@ OiioTool::do_action_diff (ImageRec &ir0, ImageRec &ir1,
                 yee_failures = ImageBufAlgo::compare_Yee (img0, img1, cr);
                 break;
             default:
-                ImageBufAlgo::compare (img0, img1, ot.diff_failthresh, ot.diff_warnthresh, cr);
+                if (ot.diff_failfast)
+                    ImageBufAlgo::compare (img0, img1, ot.diff_failthresh, ot.diff_warnthresh,
+                                           imagesize_t(ot.diff_failpercent/100.0 * npels),
+                                           ot.diff_hardfail, cr);
+                else
+                    ImageBufAlgo::compare (img0, img1, ot.diff_failthresh, ot.diff_warnthresh, cr);
                 break;
             }
 
@@ -186,6 +191,8 @@ OiioTool::do_action_diff (ImageRec &ir0, ImageRec &ir1,
                               << std::setprecision(3) << (100.0*yee_failures / npels) 
                               << std::setprecision(precis)
                               << "%) failed the perceptual test\n";
+                if (ot.diff_failfast && ret == DiffErrFail && perceptual != 1)
+                    std::cout << "  (--failfast: stopped once it failed, so these are for part of the image)\n";
             }
 
         }
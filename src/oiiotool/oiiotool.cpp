@@ -41,6 +41,7 @@
 #include <utility>
 #include <ctype.h>
 #include <map>
+#include <fstream>
 
 #include <boost/regex.hpp>
 
@@ -56,6 +57,8 @@
 #include "OpenImageIO/filter.h"
 #include "OpenImageIO/color.h"
 #include "OpenImageIO/timer.h"
+#include "OpenImageIO/thread.h"
+#include "OpenImageIO/parallel.h"
 
 #include "oiiotool.h"
 
@@ -64,7 +67,18 @@ using namespace OiioTool;
 using namespace ImageBufAlgo;
 
 
+// Each thread has its own Oiiotool state, so that --parallel-frames can
+// run the command lines of several frames at once.
+#if OIIO_MSVS_BEFORE_2015
 static Oiiotool ot;
+#define OIIOTOOL_PARALLEL_FRAMES 0
+#else
+static thread_local Oiiotool ot;
+#define OIIOTOOL_PARALLEL_FRAMES 1
+#endif
+
+// How many frames of a sequence are being processed at once.
+static int parallel_frames = 1;
 
 
 // Macro to fully set up the "action" function that straightforwardly
@@ -108,6 +122,8 @@ static Oiiotool ot;
         if (ot.postpone_callback (ninputs, action_##name, argc, argv)) \
             return 0;                                                  \
         ASSERT (argc == nargs);                                        \
+        if (fuse_image_color_op (#name, argc, argv))                   \
+            return 0;                                                  \
         OiiotoolImageColorOp<IBAbinary_img_col> op (impl, ot, #name,   \
                                               argc, argv, ninputs);    \
         return op();                                                   \
@@ -125,13 +141,166 @@ Oiiotool::Oiiotool ()
       total_imagecache_readtime (0.0),
       enable_function_timing(true),
       peak_memory(0),
-      num_outputs(0), printed_info(false)
+      num_outputs(0), printed_info(false),
+      thread_index(0), optimer_depth(0)
 {
     clear_options ();
 }
 
 
 
+void
+Oiiotool::merge_stats (const Oiiotool &other)
+{
+    if (other.return_value != EXIT_SUCCESS)
+        return_value = other.return_value;
+    total_imagecache_readtime += other.total_imagecache_readtime;
+    for (auto&& f : other.function_times)
+        function_times[f.first] += f.second;
+    peak_memory = std::max (peak_memory, other.peak_memory);
+    num_outputs += other.num_outputs;
+    printed_info |= other.printed_info;
+    op_profiles.insert (op_profiles.end(), other.op_profiles.begin(),
+                        other.op_profiles.end());
+    if (runstats_trace.empty())
+        runstats_trace = other.runstats_trace;
+    // Options that main() consults when the sequence is done
+    runstats |= other.runstats;
+    dryrun |= other.dryrun;
+    printinfo |= other.printinfo;
+    printstats |= other.printstats;
+    dumpdata |= other.dumpdata;
+}
+
+
+
+// All the OpTimers, on every thread, measure from the same origin so that
+// the trace lines up.
+static Timer optimer_origin;
+
+
+
+OpTimer::OpTimer (Oiiotool &ot)
+    : m_ot(ot), m_timer(ot.enable_function_timing),
+      m_start(optimer_origin()), m_cpu_start(std::clock()),
+      m_bytes_read(0), m_tile_lookups(0), m_tile_misses(0)
+{
+    if (ot.imagecache) {
+        int misses = 0;
+        ot.imagecache->getattribute ("stat:bytes_read", TypeDesc::INT64, &m_bytes_read);
+        ot.imagecache->getattribute ("stat:find_tile_calls", TypeDesc::INT64, &m_tile_lookups);
+        ot.imagecache->getattribute ("stat:find_tile_cache_misses", misses);
+        m_tile_misses = misses;
+    }
+    // Nested timers (e.g. an input read inside another command) leave the
+    // outer command's pixel memory peak alone.
+    if (ot.optimer_depth++ == 0)
+        OIIO::attribute ("stat:imagebuf:local_peak_bytes", 0);
+}
+
+
+
+void
+Oiiotool::record_op (string_view command, const OpTimer &timer,
+                     long long bytes_written)
+{
+    double wall = timer();
+    function_times[command] += wall;
+    if (! runstats)
+        return;
+    OpProfile p;
+    p.command = command;
+    p.thread = thread_index;
+    p.start = timer.m_start;
+    p.wall = wall;
+    p.cpu = double(std::clock() - timer.m_cpu_start) / CLOCKS_PER_SEC;
+    p.bytes_read = 0;
+    p.tile_lookups = 0;
+    p.tile_misses = 0;
+    if (imagecache) {
+        int misses = 0;
+        imagecache->getattribute ("stat:bytes_read", TypeDesc::INT64, &p.bytes_read);
+        imagecache->getattribute ("stat:find_tile_calls", TypeDesc::INT64, &p.tile_lookups);
+        imagecache->getattribute ("stat:find_tile_cache_misses", misses);
+        p.bytes_read -= timer.m_bytes_read;
+        p.tile_lookups -= timer.m_tile_lookups;
+        p.tile_misses = misses - timer.m_tile_misses;
+    }
+    p.bytes_written = bytes_written;
+    p.peak_pixel_memory = 0;
+    OIIO::getattribute ("stat:imagebuf:local_peak_bytes", TypeDesc::INT64,
+                        &p.peak_pixel_memory);
+    op_profiles.push_back (p);
+}
+
+
+
+static std::string
+json_escape (string_view s)
+{
+    std::string r;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            r += '\\';
+        if ((unsigned char)c < 0x20)
+            r += Strutil::format ("\\u%04x", int(c));
+        else
+            r += c;
+    }
+    return r;
+}
+
+
+
+void
+Oiiotool::print_op_profiles ()
+{
+    if (op_profiles.empty())
+        return;
+    std::cout << "  Per-command statistics:\n";
+    std::cout << Strutil::format ("      %-14s %8s %8s %10s %10s %7s %10s\n",
+                                  "command", "wall", "cpu", "read",
+                                  "written", "IC hit", "pixel mem");
+    for (auto&& p : op_profiles) {
+        std::string hits = p.tile_lookups
+            ? Strutil::format ("%.1f%%", 100.0 * (1.0 - double(p.tile_misses) / p.tile_lookups))
+            : std::string("-");
+        std::cout << Strutil::format ("      %-14s %8.3f %8.3f %10s %10s %7s %10s\n",
+                                      p.command, p.wall, p.cpu,
+                                      Strutil::memformat (p.bytes_read),
+                                      Strutil::memformat (p.bytes_written),
+                                      hits, Strutil::memformat (p.peak_pixel_memory));
+    }
+
+    if (runstats_trace.empty())
+        return;
+    // Chrome trace event format: one complete ("X") event per command, in
+    // microseconds, one "thread" per --parallel-frames worker.
+    std::ofstream out;
+    Filesystem::open (out, runstats_trace);
+    if (! out) {
+        error ("--runstats-trace", Strutil::format ("Could not open \"%s\"", runstats_trace));
+        return;
+    }
+    out << "{\"traceEvents\":[\n";
+    for (size_t i = 0; i < op_profiles.size(); ++i) {
+        const OpProfile &p (op_profiles[i]);
+        out << Strutil::format ("{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.0f,"
+                                "\"dur\":%.0f,\"pid\":1,\"tid\":%d,\"args\":{"
+                                "\"cpu\":%.6f,\"bytes_read\":%lld,"
+                                "\"bytes_written\":%lld,\"tile_lookups\":%lld,"
+                                "\"tile_misses\":%lld,\"peak_pixel_memory\":%lld}}%s\n",
+                                json_escape (p.command), p.start * 1.0e6,
+                                p.wall * 1.0e6, p.thread, p.cpu, p.bytes_read,
+                                p.bytes_written, p.tile_lookups, p.tile_misses,
+                                p.peak_pixel_memory,
+                                i + 1 < op_profiles.size() ? "," : "");
+    }
+    out << "]}\n";
+}
+
+
+
 void
 Oiiotool::clear_options ()
 {
@@ -139,6 +308,7 @@ Oiiotool::clear_options ()
     debug = false;
     dryrun = false;
     runstats = false;
+    runstats_trace.clear ();
     noclobber = false;
     allsubimages = false;
     printinfo = false;
@@ -146,10 +316,12 @@ Oiiotool::clear_options ()
     dumpdata = false;
     dumpdata_showempty = true;
     hash = false;
+    fasthash = false;
     updatemode = false;
     autoorient = false;
     autocc = false;
     nativeread = false;
+    fuse = true;
     cachesize = 4096;
     autotile = 4096;
     full_command_line.clear ();
@@ -179,6 +351,7 @@ Oiiotool::clear_options ()
     diff_failthresh = 1.0e-6f;
     diff_failpercent = 0;
     diff_hardfail = std::numeric_limits<float>::max();
+    diff_failfast = false;
     m_pending_callback = NULL;
     m_pending_argc = 0;
 }
@@ -206,7 +379,8 @@ format_resolution (int w, int h, int d, int x, int y, int z)
 
 
 bool
-Oiiotool::read (ImageRecRef img, ReadPolicy readpolicy)
+Oiiotool::read (ImageRecRef img, ReadPolicy readpolicy,
+                string_view channel_set)
 {
     // If the image is already elaborated, take an early out, both to
     // save time, but also because we only want to do the format and
@@ -214,6 +388,17 @@ Oiiotool::read (ImageRecRef img, ReadPolicy readpolicy)
     if (img->elaborated())
         return true;
 
+    // A pending chain of fused point-wise ops: evaluate it now. It's not
+    // a file read, so none of the adjustments below apply.
+    if (img->pending()) {
+        OpTimer timer (*this);
+        bool ok = img->read (readpolicy);
+        record_op ("fused ops", timer);
+        if (! ok)
+            error ("fused ops", img->geterror());
+        return ok;
+    }
+
     // Cause the ImageRec to get read.  Try to compute how long it took.
     // Subtract out ImageCache time, to avoid double-accounting it later.
     float pre_ic_time, post_ic_time;
@@ -221,7 +406,12 @@ Oiiotool::read (ImageRecRef img, ReadPolicy readpolicy)
     total_readtime.start ();
     if (ot.nativeread)
         readpolicy = ReadPolicy (readpolicy | ReadNative);
-    bool ok = img->read (readpolicy);
+    bool ok = img->read (readpolicy, channel_set);
+    // The other subimages and MIP levels are read as they're used, but
+    // read the first one now (unless asked not to), so that we report
+    // any problem with the file right away.
+    if (ok && ! (readpolicy & ReadDeferred))
+        ok = img->elaborate (0, 0);
     total_readtime.stop ();
     imagecache->getattribute ("stat:fileio_time", post_ic_time);
     total_imagecache_readtime += post_ic_time - pre_ic_time;
@@ -229,7 +419,7 @@ Oiiotool::read (ImageRecRef img, ReadPolicy readpolicy)
     // If this is the first tiled image we have come across, use it to
     // set our tile size (unless the user explicitly set a tile size, or
     // explicitly instructed scanline output).
-    const ImageSpec &nspec ((*img)().nativespec());
+    const ImageSpec &nspec (*img->nativespec());
     if (nspec.tile_width && ! output_tilewidth && ! ot.output_scanline) {
         output_tilewidth = nspec.tile_width;
         output_tileheight = nspec.tile_height;
@@ -256,6 +446,80 @@ Oiiotool::read (ImageRecRef img, ReadPolicy readpolicy)
 
 
 
+// Point-wise ops (arithmetic with constants, clamp, colorconvert) that
+// apply to just the first subimage are not run right away. Instead, the
+// result is a lazy ImageRec holding the source image and a PixelPipeline,
+// and each following point-wise command just appends to that pipeline.
+// The whole chain is computed in a single pass, with no intermediate
+// images, when the result is first read.  Return true if the command
+// was handled this way, false if the caller should run it as usual.
+static bool
+fuse_pointwise (string_view opname, string_view command,
+                const std::function<void(ImageBufAlgo::PixelPipeline &ops,
+                                         const ImageSpec &spec)> &record)
+{
+    if (! ot.fuse || ! ot.curimg)
+        return false;
+    std::map<std::string,std::string> options;
+    options["allsubimages"] = ot.allsubimages ? "1" : "0";
+    ot.extract_options (options, command);
+    if (Strutil::from_string<int>(options["allsubimages"]))
+        return false;
+    // Only fuse an image nothing else refers to (on the stack or by a
+    // label), since otherwise it could be altered in place before the
+    // chain is evaluated.
+    if (ot.curimg.use_count() != 1)
+        return false;
+    ImageRecRef src = ot.curimg;
+    ImageBufAlgo::PixelPipeline ops;
+    if (src->pending()) {
+        ops = src->pending_ops();
+        src = src->pending_src();
+    } else {
+        if (! ot.read (src) || (*src)(0,0).deep())
+            return false;
+    }
+    record (ops, *src->spec(0,0));
+    ot.pop ();
+    ot.push (new ImageRec (opname, src, ops));
+    return true;
+}
+
+
+
+static bool
+fuse_image_color_op (string_view opname, int argc, const char *argv[])
+{
+    typedef ImageBufAlgo::PixelPipeline PP;
+    PP& (PP::*op)(array_view<const float>) = NULL;
+    if (opname == "addc")
+        op = &PP::add;
+    else if (opname == "subc")
+        op = &PP::sub;
+    else if (opname == "mulc")
+        op = &PP::mul;
+    else if (opname == "divc")
+        op = &PP::div;
+    else if (opname == "powc")
+        op = &PP::pow;
+    else
+        return false;
+    string_view command = ot.express (argv[0]);
+    string_view arg = ot.express (argv[1]);
+    return fuse_pointwise (opname, command,
+                           [&](PP &ops, const ImageSpec &spec) {
+        // Same values as OiiotoolImageColorOp would use
+        int nchans = spec.nchannels;
+        std::vector<float> val (nchans, 0.0f);
+        int nvals = Strutil::extract_from_list_string (val, arg);
+        val.resize (nvals);
+        val.resize (nchans, val.size() == 1 ? val.back() : 0.0f);
+        (ops.*op) (val);
+    });
+}
+
+
+
 bool
 Oiiotool::postpone_callback (int required_images, CallbackFunction func,
                              int argc, const char *argv[])
@@ -346,6 +610,12 @@ set_threads (int argc, const char *argv[])
 {
     ASSERT (argc == 2);
     int nthreads = atoi(argv[1]);
+    if (parallel_frames > 1) {
+        // Split the budget among the frames running at once
+        if (nthreads <= 0)
+            nthreads = int(Sysutil::hardware_concurrency());
+        nthreads = std::max (1, nthreads / parallel_frames);
+    }
     OIIO::attribute ("threads", nthreads);
     OIIO::attribute ("exr_threads", nthreads);
     return 0;
@@ -1503,7 +1773,7 @@ set_origin (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, set_origin, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     string_view origin  = ot.express (argv[1]);
 
@@ -1537,7 +1807,7 @@ set_origin (int argc, const char *argv[])
             A->metadata_modified (true);
         }
     }
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -1548,7 +1818,7 @@ set_fullsize (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, set_fullsize, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     string_view size    = ot.express (argv[1]);
 
@@ -1574,7 +1844,7 @@ set_fullsize (int argc, const char *argv[])
         ibspec.full_height = h;
         A->metadata_modified (true);
     }
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -1585,7 +1855,7 @@ set_full_to_pixels (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, set_full_to_pixels, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     ot.read ();
@@ -1611,7 +1881,7 @@ set_full_to_pixels (int argc, const char *argv[])
         }
     }
     A->metadata_modified (true);
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -1666,7 +1936,27 @@ public:
     string_view fromspace, tospace;
 };
 
-OP_CUSTOMCLASS (colorconvert, OpColorConvert, 1);
+static int
+action_colorconvert (int argc, const char *argv[])
+{
+    if (ot.postpone_callback (1, action_colorconvert, argc, argv))
+        return 0;
+    string_view command = ot.express (argv[0]);
+    std::string fromspace = ot.express (argv[1]);
+    std::string tospace = ot.express (argv[2]);
+    if (fromspace != tospace &&
+        fuse_pointwise ("colorconvert", command,
+                        [&](ImageBufAlgo::PixelPipeline &ops,
+                            const ImageSpec &spec) {
+            std::map<std::string,std::string> options;
+            ot.extract_options (options, command);
+            ops.colorconvert (fromspace, tospace, false, options["key"],
+                              options["value"], &ot.colorconfig);
+        }))
+        return 0;
+    OpColorConvert op (ot, "colorconvert", argc, argv);
+    return op();
+}
 
 
 
@@ -1775,7 +2065,7 @@ action_unmip (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_unmip, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     ot.read ();
@@ -1788,7 +2078,7 @@ action_unmip (int argc, const char *argv[])
 
     ImageRecRef newimg (new ImageRec (*ot.curimg, -1, 0, true, true));
     ot.curimg = newimg;
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -1799,7 +2089,7 @@ set_channelnames (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, set_channelnames, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command    = ot.express (argv[0]);
     string_view channelarg = ot.express (argv[1]);
 
@@ -1835,7 +2125,7 @@ set_channelnames (int argc, const char *argv[])
            A->update_spec_from_imagebuf(s,m);
         }
     }
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -1941,18 +2231,40 @@ action_channels (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_channels, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command  = ot.express (argv[0]);
     string_view chanlist = ot.express (argv[1]);
 
     ImageRecRef A (ot.pop());
-    ot.read (A);
 
     if (chanlist == "RGB")   // Fix common synonyms/mistakes
         chanlist = "R,G,B";
     else if (chanlist == "RGBA")
         chanlist = "R,G,B,A";
 
+    // An image that's still only a file name, when we want just its
+    // first subimage: read only the requested channels in the first place.
+    // (Unless something else refers to it and will want all of them.)
+    const ImageSpec *filespec = NULL;
+    if (! A->elaborated() && ! A->pending() && ! ot.allsubimages &&
+          A.use_count() == 1)
+        filespec = ot.imagecache->imagespec (ustring(A->name()), 0, 0);
+    if (filespec) {
+        std::vector<std::string> newchannelnames;
+        std::vector<int> channels;
+        std::vector<float> values;
+        if (decode_channel_set (*filespec, chanlist,
+                                newchannelnames, channels, values) &&
+              ot.read (A, ReadDefault, chanlist)) {
+            ImageRecRef R (new ImageRec (*A, 0, 0, true, true));
+            R->pixels_modified (true);
+            ot.push (R);
+            ot.record_op (command, timer);
+            return 0;
+        }
+    }
+    ot.read (A);
+
     // Decode the channel set, make the full list of ImageSpec's we'll
     // need to describe the new ImageRec with the altered channels.
     std::vector<int> allmiplevels;
@@ -2006,7 +2318,7 @@ action_channels (int argc, const char *argv[])
         }
     }
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2017,7 +2329,7 @@ action_chappend (int argc, const char *argv[])
 {
     if (ot.postpone_callback (2, action_chappend, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command  = ot.express (argv[0]);
 
     ImageRecRef B (ot.pop());
@@ -2050,7 +2362,7 @@ action_chappend (int argc, const char *argv[])
             R->update_spec_from_imagebuf(s,m);
         }
     }
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2061,7 +2373,7 @@ action_selectmip (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_selectmip, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     int miplevel = Strutil::from_string<int> (ot.express(argv[1]));
 
@@ -2075,7 +2387,7 @@ action_selectmip (int argc, const char *argv[])
 
     ImageRecRef newimg (new ImageRec (*ot.curimg, -1, miplevel, true, true));
     ot.curimg = newimg;
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2086,8 +2398,9 @@ action_select_subimage (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_select_subimage, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
-    ot.read ();
+    OpTimer timer (ot);
+    // Only the chosen subimage will need its pixels read
+    ot.read (ReadDeferred);
 
     string_view command = ot.express (argv[0]);
     int subimage = 0;
@@ -2106,7 +2419,7 @@ action_select_subimage (int argc, const char *argv[])
         // The subimage specification wasn't an integer. Assume it's a name.
         subimage = -1;
         for (int i = 0, n = ot.curimg->subimages(); i < n; ++i) {
-            string_view siname = ot.curimg->spec(i)->get_string_attribute("oiio:subimagename");
+            string_view siname = ot.curimg->nativespec(i)->get_string_attribute("oiio:subimagename");
             if (siname == whichsubimage) {
                 subimage = i;
                 break;
@@ -2125,7 +2438,7 @@ action_select_subimage (int argc, const char *argv[])
     
     ImageRecRef A = ot.pop();
     ot.push (new ImageRec (*A, subimage));
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2136,7 +2449,7 @@ action_subimage_split (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_subimage_split, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     ImageRecRef A = ot.pop();
@@ -2146,7 +2459,7 @@ action_subimage_split (int argc, const char *argv[])
     for (int subimage = 0;  subimage <  A->subimages();  ++subimage)
         ot.push (new ImageRec (*A, subimage));
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2200,12 +2513,12 @@ action_subimage_append (int argc, const char *argv[])
 {
     if (ot.postpone_callback (2, action_subimage_append, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     action_subimage_append_n (2, command);
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2216,12 +2529,12 @@ action_subimage_append_all (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_subimage_append_all, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     action_subimage_append_n (int(ot.image_stack.size()+1), command);
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2232,7 +2545,7 @@ action_colorcount (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_colorcount, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command  = ot.express (argv[0]);
     string_view colorarg = ot.express (argv[1]);
 
@@ -2271,7 +2584,7 @@ action_colorcount (int argc, const char *argv[])
         ot.error (command, (*ot.curimg)(0,0).geterror());
     }
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2282,7 +2595,7 @@ action_rangecheck (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_rangecheck, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command  = ot.express (argv[0]);
     string_view lowarg   = ot.express (argv[1]);
     string_view higharg  = ot.express (argv[2]);
@@ -2307,7 +2620,7 @@ action_rangecheck (int argc, const char *argv[])
         ot.error (command, (*ot.curimg)(0,0).geterror());
     }
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2318,7 +2631,7 @@ action_diff (int argc, const char *argv[])
 {
     if (ot.postpone_callback (2, action_diff, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     int ret = do_action_diff (*ot.image_stack.back(), *ot.curimg, ot);
@@ -2329,7 +2642,7 @@ action_diff (int argc, const char *argv[])
         ot.error (command);
 
     ot.printed_info = true; // because taking the diff has output
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2340,7 +2653,7 @@ action_pdiff (int argc, const char *argv[])
 {
     if (ot.postpone_callback (2, action_pdiff, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     int ret = do_action_diff (*ot.image_stack.back(), *ot.curimg, ot, 1);
@@ -2350,7 +2663,7 @@ action_pdiff (int argc, const char *argv[])
     if (ret != DiffErrOK && ret != DiffErrWarn && ret != DiffErrFail)
         ot.error (command);
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2369,7 +2682,21 @@ BINARY_IMAGE_COLOR_OP (divc, ImageBufAlgo::div, 1);
 BINARY_IMAGE_COLOR_OP (absdiffc, ImageBufAlgo::absdiff, 0);
 BINARY_IMAGE_COLOR_OP (powc, ImageBufAlgo::pow, 1.0f);
 
-UNARY_IMAGE_OP (abs, ImageBufAlgo::abs);
+static int
+action_abs (int argc, const char *argv[])
+{
+    if (ot.postpone_callback (1, action_abs, argc, argv))
+        return 0;
+    ASSERT (argc == 1);
+    if (fuse_pointwise ("abs", ot.express (argv[0]),
+                        [](ImageBufAlgo::PixelPipeline &ops,
+                           const ImageSpec &) { ops.abs(); }))
+        return 0;
+    OiiotoolSimpleUnaryOp<IBAunary> op (ImageBufAlgo::abs, ot, "abs",
+                                        argc, argv, 1);
+    return op();
+}
+
 UNARY_IMAGE_OP (unpremult, ImageBufAlgo::unpremult);
 UNARY_IMAGE_OP (premult, ImageBufAlgo::premult);
 
@@ -2457,7 +2784,7 @@ action_chsum (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_chsum, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     ImageRecRef A (ot.pop());
@@ -2479,7 +2806,7 @@ action_chsum (int argc, const char *argv[])
         R->update_spec_from_imagebuf (s);
     }
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2525,7 +2852,7 @@ action_reorient (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_reorient, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     // Make sure time in the rotate functions is charged to reorient
@@ -2555,7 +2882,7 @@ action_reorient (int argc, const char *argv[])
         ot.push (A);
     }
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     ot.enable_function_timing = old_enable_function_timing;
     return 0;
 }
@@ -2615,6 +2942,32 @@ OP_CUSTOMCLASS (warp, OpWarp, 1);
 
 
 
+class OpSTWarp : public OiiotoolOp {
+public:
+    OpSTWarp (Oiiotool &ot, string_view opname, int argc, const char *argv[])
+        : OiiotoolOp (ot, opname, argc, argv, 2) {}
+    virtual void option_defaults () {
+        options["chan_s"] = "0";
+        options["chan_t"] = "1";
+        options["flip_s"] = "0";
+        options["flip_t"] = "0";
+    };
+    virtual int impl (ImageBuf **img) {
+        std::string filtername = options["filter"];
+        int chan_s = Strutil::from_string<int>(options["chan_s"]);
+        int chan_t = Strutil::from_string<int>(options["chan_t"]);
+        bool flip_s = Strutil::from_string<int>(options["flip_s"]);
+        bool flip_t = Strutil::from_string<int>(options["flip_t"]);
+        return ImageBufAlgo::st_warp (*img[0], *img[1], *img[2],
+                                      filtername, 0.0f, chan_s, chan_t,
+                                      flip_s, flip_t);
+    }
+};
+
+OP_CUSTOMCLASS (st_warp, OpSTWarp, 2);
+
+
+
 class OpCshift : public OiiotoolOp {
 public:
     OpCshift (Oiiotool &ot, string_view opname, int argc, const char *argv[])
@@ -2673,7 +3026,7 @@ static int
 action_create (int argc, const char *argv[])
 {
     ASSERT (argc == 3);
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     string_view size    = ot.express (argv[1]);
     int nchans = Strutil::from_string<int> (ot.express(argv[2]));
@@ -2697,7 +3050,7 @@ action_create (int argc, const char *argv[])
     if (ot.curimg)
         ot.image_stack.push_back (ot.curimg);
     ot.curimg = img;
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2707,7 +3060,7 @@ static int
 action_pattern (int argc, const char *argv[])
 {
     ASSERT (argc == 4);
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     std::string pattern = ot.express (argv[1]);
     std::string size    = ot.express (argv[2]);
@@ -2817,7 +3170,7 @@ action_pattern (int argc, const char *argv[])
     }
     if (! ok)
         ot.error (command, ib.geterror());
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2845,7 +3198,7 @@ static int
 action_capture (int argc, const char *argv[])
 {
     ASSERT (argc == 1);
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     std::map<std::string,std::string> options;
     ot.extract_options (options, command);
@@ -2858,7 +3211,7 @@ action_capture (int argc, const char *argv[])
     ImageRecRef img (new ImageRec ("capture", ib.spec(), ot.imagecache));
     (*img)().copy (ib);
     ot.push (img);
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2869,7 +3222,7 @@ action_crop (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_crop, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     string_view size    = ot.express (argv[1]);
 
@@ -2915,7 +3268,7 @@ action_crop (int argc, const char *argv[])
         }
     }
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2926,7 +3279,7 @@ action_croptofull (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_croptofull, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     ot.read ();
@@ -2950,7 +3303,7 @@ action_croptofull (int argc, const char *argv[])
             R->update_spec_from_imagebuf (s, 0);
         }
     }
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -2961,7 +3314,7 @@ action_trim (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_trim, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     ot.read ();
@@ -2999,7 +3352,7 @@ action_trim (int argc, const char *argv[])
             R->update_spec_from_imagebuf (s, 0);
         }
     }
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -3010,7 +3363,7 @@ action_cut (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_cut, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     string_view size    = ot.express (argv[1]);
 
@@ -3034,7 +3387,7 @@ action_cut (int argc, const char *argv[])
 
     ot.push (R);
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -3124,7 +3477,7 @@ action_fit (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_fit, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     bool old_enable_function_timing = ot.enable_function_timing;
     ot.enable_function_timing = false;
     string_view command = ot.express (argv[0]);
@@ -3243,7 +3596,7 @@ action_fit (int argc, const char *argv[])
         action_croptofull (1, argv);
     }
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     ot.enable_function_timing = old_enable_function_timing;
     return 0;
 }
@@ -3255,7 +3608,7 @@ action_pixelaspect (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_pixelaspect, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     bool old_enable_function_timing = ot.enable_function_timing;
     ot.enable_function_timing = false;
     string_view command = ot.express (argv[0]);
@@ -3334,7 +3687,7 @@ action_pixelaspect (int argc, const char *argv[])
         // Now A,Aspec are for the NEW resized top of stack
     }
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     ot.enable_function_timing = old_enable_function_timing;
     return 0;
 }
@@ -3361,12 +3714,20 @@ public:
         : OiiotoolOp (ot, opname, argc, argv, 1) {}
     virtual void option_defaults () {
         options["kernel"] = "gaussian";
+        options["fast"] = "0";
     };
     virtual int impl (ImageBuf **img) {
         string_view kernopt = options["kernel"];
         float w = 1.0f, h = 1.0f;
         if (sscanf (args[1].c_str(), "%fx%f", &w, &h) != 2)
             ot.error (opname(), Strutil::format ("Unknown size %s", args[1]));
+        // fast=1 (or fast=iir) picks the recursive gaussian, fast=box the
+        // stacked box filters. Only the gaussian has a fast version.
+        string_view fast = options["fast"];
+        if (kernopt == "gaussian" && fast.size() && fast != "0") {
+            string_view method = (fast == "box") ? "box" : "iir";
+            return ImageBufAlgo::blur (*img[0], *img[1], w, h, method);
+        }
         ImageBuf Kernel;
         if (! ImageBufAlgo::make_kernel (Kernel, kernopt, w, h))
             ot.error (opname(), Kernel.geterror());
@@ -3479,7 +3840,7 @@ action_fixnan (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_fixnan, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command  = ot.express (argv[0]);
     string_view modename = ot.express (argv[1]);
 
@@ -3509,7 +3870,7 @@ action_fixnan (int argc, const char *argv[])
         }
     }
              
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -3520,7 +3881,7 @@ action_fillholes (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_fillholes, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     // Read and copy the top-of-stack image
@@ -3535,7 +3896,7 @@ action_fillholes (int argc, const char *argv[])
     if (! ok)
         ot.error (command, Rib.geterror());
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -3546,7 +3907,7 @@ action_paste (int argc, const char *argv[])
 {
     if (ot.postpone_callback (2, action_paste, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command  = ot.express (argv[0]);
     string_view position = ot.express (argv[1]);
 
@@ -3567,7 +3928,7 @@ action_paste (int argc, const char *argv[])
     bool ok = ImageBufAlgo::paste ((*R)(), x, y, 0, 0, (*FG)());
     if (! ok)
         ot.error (command, (*R)().geterror());
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -3576,7 +3937,7 @@ action_paste (int argc, const char *argv[])
 static int
 action_mosaic (int argc, const char *argv[])
 {
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
 
     // Mosaic is tricky. We have to parse the argument before we know
     // how many images it wants to pull off the stack.
@@ -3601,12 +3962,30 @@ action_mosaic (int argc, const char *argv[])
         ot.push (blank_img);
     }
 
-    int widest = 0, highest = 0, nchannels = 0;
     std::vector<ImageRecRef> images (nimages);
     for (int i = nimages-1;  i >= 0;  --i) {
-        ImageRecRef img = ot.pop();
-        images[i] = img;
-        ot.read (img);
+        images[i] = ot.pop();
+        ot.read (images[i], ReadDeferred);
+    }
+
+    // Read the pixels of all the cells at once, each distinct image just
+    // once (the same one may be in several cells).
+    std::vector<ImageRecRef> distinct (images);
+    std::sort (distinct.begin(), distinct.end());
+    distinct.erase (std::unique (distinct.begin(), distinct.end()),
+                    distinct.end());
+    std::vector<char> readok (distinct.size());
+    parallel_for (0, int64_t(distinct.size()), [&](int64_t i){
+        readok[i] = distinct[i]->elaborate (0, 0);
+    });
+    for (size_t i = 0; i < distinct.size(); ++i)
+        if (! readok[i]) {
+            ot.error (command, distinct[i]->geterror());
+            return 0;
+        }
+
+    int widest = 0, highest = 0, nchannels = 0;
+    for (auto&& img : images) {
         widest = std::max (widest, img->spec()->full_width);
         highest = std::max (highest, img->spec()->full_height);
         nchannels = std::max (nchannels, img->spec()->nchannels);
@@ -3623,19 +4002,22 @@ action_mosaic (int argc, const char *argv[])
     ImageRecRef R (new ImageRec ("mosaic", Rspec, ot.imagecache));
     ot.push (R);
 
-    ImageBufAlgo::zero ((*R)());
-    for (int j = 0;  j < yimages;  ++j) {
-        int y = j * (highest + pad);
-        for (int i = 0;  i < ximages;  ++i) {
-            int x = i * (widest + pad);
-            bool ok = ImageBufAlgo::paste ((*R)(), x, y, 0, 0,
-                                           (*images[j*ximages+i])(0));
-            if (! ok)
-                ot.error (command, (*R)().geterror());
-        }
-    }
+    // The cells don't overlap, so each one is pasted into its place by
+    // its own task.
+    ImageBuf &Rib ((*R)());
+    ImageBufAlgo::zero (Rib);
+    std::vector<char> pasteok (nimages);
+    parallel_for (0, int64_t(nimages), [&](int64_t c){
+        int x = int(c % ximages) * (widest + pad);
+        int y = int(c / ximages) * (highest + pad);
+        const ImageRec &cell (*images[c]);
+        pasteok[c] = ImageBufAlgo::paste (Rib, x, y, 0, 0, cell(0),
+                                          ROI::All(), 1);
+    });
+    if (std::find (pasteok.begin(), pasteok.end(), 0) != pasteok.end())
+        ot.error (command, Rib.geterror());
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -3667,7 +4049,7 @@ action_zover (int argc, const char *argv[])
 {
     if (ot.postpone_callback (2, action_zover, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
     // Get optional flags
@@ -3700,7 +4082,7 @@ action_zover (int argc, const char *argv[])
     bool ok = ImageBufAlgo::zover (Rib, Aib, Bib, z_zeroisinf);
     if (! ok)
         ot.error (command, Rib.geterror());
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 #endif
@@ -3744,7 +4126,7 @@ action_fill (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_fill, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     string_view size    = ot.express (argv[1]);
 
@@ -3799,7 +4181,7 @@ action_fill (int argc, const char *argv[])
     if (! ok)
         ot.error (command, Rib.geterror());
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -3810,9 +4192,29 @@ action_clamp (int argc, const char *argv[])
 {
     if (ot.postpone_callback (1, action_clamp, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
 
+    // Fused into a pipeline, the values are worked out the same way as
+    // for subimage 0 below.
+    if (fuse_pointwise ("clamp", command,
+                        [&](ImageBufAlgo::PixelPipeline &ops,
+                            const ImageSpec &spec) {
+            const float big = std::numeric_limits<float>::max();
+            std::vector<float> min (spec.nchannels, -big);
+            std::vector<float> max (spec.nchannels, big);
+            std::map<std::string,std::string> options;
+            options["clampalpha"] = "0";  // initialize
+            ot.extract_options (options, command);
+            Strutil::extract_from_list_string (min, options["min"]);
+            Strutil::extract_from_list_string (max, options["max"]);
+            bool clampalpha01 = strtol (options["clampalpha"].c_str(), NULL, 10) != 0;
+            ops.clamp (min, max, clampalpha01);
+        })) {
+        ot.record_op (command, timer);
+        return 0;
+    }
+
     ImageRecRef A = ot.pop();
     ot.read (A);
     ImageRecRef R (new ImageRec (*A, ot.allsubimages ? -1 : 0,
@@ -3840,7 +4242,7 @@ action_clamp (int argc, const char *argv[])
         }
     }
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -3984,7 +4386,7 @@ action_histogram (int argc, const char *argv[])
     ASSERT (argc == 3);
     if (ot.postpone_callback (1, action_histogram, argc, argv))
         return 0;
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     string_view command = ot.express (argv[0]);
     string_view size = ot.express(argv[1]);
     int channel = Strutil::from_string<int> (ot.express(argv[2]));
@@ -4026,7 +4428,7 @@ action_histogram (int argc, const char *argv[])
     if (! ok)
         ot.error (command, Rib.geterror());
 
-    ot.function_times[command] += timer();
+    ot.record_op (command, timer);
     return 0;
 }
 
@@ -4064,7 +4466,7 @@ input_file (int argc, const char *argv[])
             ot.process_pending ();
             break;
         }
-        Timer timer (ot.enable_function_timing);
+        OpTimer timer (ot);
         int exists = 1;
         if (ot.input_config_set) {
             // User has set some input configuration, so seed the cache with
@@ -4106,6 +4508,12 @@ input_file (int argc, const char *argv[])
             std::cout << "Reading " << filename << "\n";
         ot.push (ImageRecRef (new ImageRec (filename, ot.imagecache)));
         ot.curimg->input_dataformat (input_dataformat);
+        // Unless we're just here to print about the file, start reading
+        // it in the background while the commands before its first use
+        // run.
+        if (! readnow && ! (printinfo || ot.printstats || ot.dumpdata ||
+                            ot.hash || ot.fasthash))
+            ot.curimg->prefetch (ot.nativeread ? ReadNative : ReadDefault);
         if (readnow) {
             ot.curimg->read (ReadNoCache, channel_set);
             // If we do not yet have an expected output format, set it based on
@@ -4123,7 +4531,7 @@ input_file (int argc, const char *argv[])
                 }
             }
         }
-        if (printinfo || ot.printstats || ot.dumpdata || ot.hash) {
+        if (printinfo || ot.printstats || ot.dumpdata || ot.hash || ot.fasthash) {
             OiioTool::print_info_options pio;
             pio.verbose = ot.verbose || printinfo > 1 || ot.printinfo_verbose;
             pio.subimages = ot.allsubimages;
@@ -4131,6 +4539,7 @@ input_file (int argc, const char *argv[])
             pio.dumpdata = ot.dumpdata;
             pio.dumpdata_showempty = ot.dumpdata_showempty;
             pio.compute_sha1 = ot.hash;
+            pio.compute_xxhash = ot.fasthash;
             pio.metamatch = ot.printinfo_metamatch;
             pio.nometamatch = ot.printinfo_nometamatch;
             pio.infoformat = infoformat;
@@ -4141,7 +4550,7 @@ input_file (int argc, const char *argv[])
                 ot.error ("read", error);
             ot.printed_info = true;
         }
-        ot.function_times["input"] += timer();
+        ot.record_op ("input", timer);
         if (ot.autoorient) {
             int action_reorient (int argc, const char *argv[]);
             const char *argv[] = { "--reorient" };
@@ -4208,6 +4617,8 @@ prep_texture_config (ImageSpec &configspec,
                           get_value_override(fileoptions["nomipmap"], 0));
     configspec.attribute ("maketx:updatemode",
                           get_value_override(fileoptions["updatemode"], 0));
+    configspec.attribute ("maketx:incremental",
+                          get_value_override(fileoptions["incremental"], 0));
     configspec.attribute ("maketx:constant_color_detect",
                           get_value_override(fileoptions["constant_color_detect"], 0));
     configspec.attribute ("maketx:monochrome_detect",
@@ -4216,6 +4627,10 @@ prep_texture_config (ImageSpec &configspec,
                           get_value_override(fileoptions["opaque_detect"], 0));
     configspec.attribute ("maketx:compute_average",
                           get_value_override(fileoptions["compute_average"], 1));
+    configspec.attribute ("maketx:tile_stats",
+                          get_value_override(fileoptions["tile_stats"], 0));
+    configspec.attribute ("maketx:envcdf",
+                          get_value_override(fileoptions["envcdf"], 0));
     configspec.attribute ("maketx:unpremult",
                           get_value_override(fileoptions["unpremult"], 0));
     configspec.attribute ("maketx:incolorspace",
@@ -4252,10 +4667,158 @@ prep_texture_config (ImageSpec &configspec,
 
 
 
+// Can subimage s, MIP level m of ir be written by copying the input
+// file's compressed data across (ImageOutput::copy_image), rather than
+// encoding its pixels again? Only if the pixels came unaltered from an
+// OpenEXR file and the output asks for the same layout.
+static bool
+raw_copy_candidate (ImageRec &ir, int s, int m, const ImageSpec &outspec,
+                    ImageOutput *out)
+{
+    if (string_view(out->format_name()) != "openexr" || ir.pixels_modified())
+        return false;
+    const ImageBuf &ib (ir(s,m));
+    if (ib.name() != ir.name() || ib.file_format_name() != "openexr")
+        return false;
+    const ImageSpec &native (ib.nativespec());
+    return outspec.format == native.format &&
+           outspec.channelformats == native.channelformats &&
+           outspec.channelnames == native.channelnames &&
+           outspec.x == native.x && outspec.y == native.y &&
+           outspec.width == native.width && outspec.height == native.height &&
+           outspec.tile_width == native.tile_width &&
+           outspec.tile_height == native.tile_height &&
+           outspec.get_string_attribute("compression") ==
+               native.get_string_attribute("compression");
+}
+
+
+
+// Can the pending chain of fused point-wise ops in ir be written by
+// streaming it into the file a band of scanlines (or a row of tiles) at
+// a time, rather than computing the whole result image first? Only if
+// none of output_file's automatic adjustments would apply to it.
+static bool
+stream_candidate (const ImageRec &ir, ImageOutput *out,
+                  std::map<std::string,std::string> &fileoptions)
+{
+    if (! ir.pending() || ot.dryrun ||
+        get_value_override (fileoptions["autotrim"], ot.output_autotrim) ||
+        get_value_override (fileoptions["autocc"], ot.autocc) ||
+        get_value_override (fileoptions["dither"], ot.output_dither))
+        return false;
+    const ImageBuf &src ((*ir.pending_src())(0,0));
+    const ImageSpec &spec (src.spec());
+    if (src.deep() || spec.depth > 1 ||
+        (spec.nchannels > 4 && ! out->supports("nchannels")) ||
+        (spec.nchannels > 3 && ! out->supports("alpha")))
+        return false;
+    int autocrop = get_value_override (fileoptions["autocrop"], ot.output_autocrop);
+    if (autocrop && ! out->supports ("displaywindow") &&
+        (spec.x != spec.full_x || spec.y != spec.full_y ||
+         spec.width != spec.full_width || spec.height != spec.full_height))
+        return false;
+    if (autocrop && ! out->supports ("negativeorigin") &&
+        (spec.x < 0 || spec.y < 0 || spec.z < 0))
+        return false;
+    return true;
+}
+
+
+
+// Write the pending chain of point-wise ops in ir to out, computing one
+// band of the result while the band before it is being written, so the
+// full result is never held in memory and the encoding overlaps the
+// math.  The source pixels come through the ImageCache as needed.
+static bool
+output_streaming (string_view command, string_view filename,
+                  const ImageRec &ir, ImageOutput *out,
+                  bool supports_tiles,
+                  std::map<std::string,std::string> &fileoptions)
+{
+    const ImageBuf &src ((*ir.pending_src())(0,0));
+    const ImageBufAlgo::PixelPipeline &ops (ir.pending_ops());
+    ROI all = src.roi();
+
+    // The first band tells us what the pipeline makes of the source spec
+    // (data format, color space metadata).
+    ImageSpec spec;
+    if (supports_tiles && ot.output_tilewidth && ! ot.output_scanline)
+        spec.tile_height = ot.output_tileheight;
+    int bandheight = spec.tile_height
+                   ? spec.tile_height * std::max (1, 64 / spec.tile_height) : 64;
+    ROI roi = all;
+    roi.yend = std::min (all.ybegin + bandheight, all.yend);
+    ImageBufRef band (new ImageBuf);
+    if (! ops.apply (*band, src, roi)) {
+        ot.error (command, band->geterror());
+        return false;
+    }
+    spec = band->spec();
+    spec.y = all.ybegin;
+    spec.height = all.height();
+    adjust_output_options (filename, spec, ot, supports_tiles, fileoptions);
+    spec.erase_attribute ("textureformat");
+    if (! out->open (filename, spec)) {
+        std::string err = out->geterror();
+        ot.error (command, err.size() ? err.c_str() : "unknown error");
+        return false;
+    }
+
+    bool tiled = spec.tile_width != 0;
+    thread_pool *pool = default_thread_pool();
+    std::future<bool> writing;
+    auto finish_write = [&]() -> bool {
+        if (! writing.valid())
+            return true;
+        while (writing.wait_for (std::chrono::milliseconds(0)) != std::future_status::ready)
+            if (! pool->run_one_task())
+                yield ();
+        return writing.get();
+    };
+    bool ok = true;
+    while (ok) {
+        ok = finish_write ();
+        if (! ok)
+            break;
+        writing = pool->push ([=](int /*id*/){
+            const ImageSpec &bspec (band->spec());
+            return tiled
+                ? out->write_tiles (bspec.x, bspec.x+bspec.width,
+                                    bspec.y, bspec.y+bspec.height,
+                                    bspec.z, bspec.z+1,
+                                    bspec.format, band->localpixels())
+                : out->write_scanlines (bspec.y, bspec.y+bspec.height,
+                                        bspec.z, bspec.format,
+                                        band->localpixels());
+        });
+        if (roi.yend >= all.yend)
+            break;
+        roi.ybegin = roi.yend;
+        roi.yend = std::min (roi.ybegin + bandheight, all.yend);
+        band.reset (new ImageBuf);
+        if (! ops.apply (*band, src, roi)) {
+            ot.error (command, band->geterror());
+            finish_write ();
+            out->close ();
+            return false;
+        }
+        ot.check_peak_memory ();
+    }
+    if (! finish_write ())
+        ok = false;
+    if (! ok)
+        ot.error (command, out->geterror());
+    out->close ();
+    return ok;
+}
+
+
+
 static int
 output_file (int argc, const char *argv[])
 {
-    Timer timer (ot.enable_function_timing);
+    OpTimer timer (ot);
     ot.total_writetime.start();
     string_view command = ot.express (argv[0]);
     string_view filename = ot.express (argv[1]);
@@ -4321,6 +4884,25 @@ output_file (int argc, const char *argv[])
     bool supports_displaywindow = out->supports ("displaywindow");
     bool supports_negativeorigin = out->supports ("negativeorigin");
     bool supports_tiles = out->supports ("tiles") || ot.output_force_tiles;
+
+    if (! do_tex && ! do_latlong &&
+          stream_candidate (*ot.curimg, out, fileoptions)) {
+        if (ot.debug || ot.verbose)
+            std::cout << "Writing " << filename << " (streamed)\n";
+        ImageRecRef ir (ot.curimg);
+        bool ok = output_streaming (command, filename, *ir, out,
+                                    supports_tiles, fileoptions);
+        delete out;
+        if (ot.output_adjust_time && ok)
+            Filesystem::last_write_time (filename, ir->pending_src()->time());
+        ot.check_peak_memory();
+        ir->was_output (true);
+        ot.total_writetime.stop();
+        ot.record_op (command, timer, ok ? Filesystem::file_size (filename) : 0);
+        ot.num_outputs += 1;
+        return 0;
+    }
+
     ot.read ();
     ImageRecRef saveimg = ot.curimg;
     ImageRecRef ir (ot.curimg);
@@ -4511,6 +5093,7 @@ output_file (int argc, const char *argv[])
         }
 
         // Output all the subimages and MIP levels
+        std::unique_ptr<ImageInput> rawin;  // for raw copies, if possible
         for (int s = 0, send = ir->subimages();  s < send;  ++s) {
             for (int m = 0, mend = ir->miplevels(s);  m < mend && ok;  ++m) {
                 ImageSpec spec = *ir->spec(s,m);
@@ -4523,7 +5106,23 @@ output_file (int argc, const char *argv[])
                         break;
                     }
                 }
-                if (! (*ir)(s,m).write (out)) {
+                // Untouched pixels from a file of the same kind may be
+                // copied over without decoding them.
+                ImageSpec rawspec;
+                if (raw_copy_candidate (*ir, s, m, spec, out)) {
+                    if (! rawin)
+                        rawin.reset (ImageInput::open (ir->name()));
+                    if (rawin && ! rawin->seek_subimage (s, m, rawspec))
+                        rawin.reset ();
+                }
+                if (rawin && rawin->current_subimage() == s &&
+                      rawin->current_miplevel() == m) {
+                    if (! out->copy_image (rawin.get())) {
+                        ot.error (command, out->geterror());
+                        ok = false;
+                        break;
+                    }
+                } else if (! (*ir)(s,m).write (out)) {
                     ot.error (command, (*ir)(s,m).geterror());
                     ok = false;
                     break;
@@ -4569,7 +5168,7 @@ output_file (int argc, const char *argv[])
     ot.curimg->was_output (true);
     ot.total_writetime.stop();
     double optime = timer();
-    ot.function_times[command] += optime;
+    ot.record_op (command, timer, ok ? Filesystem::file_size (filename) : 0);
     ot.num_outputs += 1;
 
     if (ot.debug)
@@ -4734,6 +5333,8 @@ getargs (int argc, char *argv[])
                 "-n", &ot.dryrun, "No saved output (dry run)",
                 "--debug", &ot.debug, "Debug mode",
                 "--runstats", &ot.runstats, "Print runtime statistics",
+                "--runstats-trace %s", &ot.runstats_trace,
+                    "Also write the --runstats command timings to this Chrome trace (JSON) file",
                 "-a", &ot.allsubimages, "Do operations on all subimages/miplevels",
                 "--info %@", set_printinfo, NULL, "Print resolution and basic info on all inputs, detailed metadata if -v is also used (options: format=xml:verbose=1)",
                 "--metamatch %s", &ot.printinfo_metamatch,
@@ -4743,6 +5344,7 @@ getargs (int argc, char *argv[])
                 "--stats", &ot.printstats, "Print pixel statistics on all inputs",
                 "--dumpdata %@", set_dumpdata, NULL, "Print all pixel data values (options: empty=0)",
                 "--hash", &ot.hash, "Print SHA-1 hash of each input image",
+                "--fasthash", &ot.fasthash, "Print fast (xxHash64, not cryptographic) hash of each input image",
                 "--colorcount %@ %s", action_colorcount, NULL,
                     "Count of how many pixels have the given color (argument: color;color;...) (options: eps=color)",
                 "--rangecheck %@ %s %s", action_rangecheck, NULL, NULL,
@@ -4752,6 +5354,7 @@ getargs (int argc, char *argv[])
                 "--noclobber", &ot.noclobber, "", // synonym
                 "--threads %@ %d", set_threads, NULL, "Number of threads (default 0 == #cores)",
                 "--frames %s", NULL, "Frame range for '#' or printf-style wildcards",
+                "--parallel-frames %d", NULL, "Number of frames of a sequence to process at once (default 1)",
                 "--framepadding %d", NULL, "Frame number padding digits (ignored when using printf-style wildcards)",
                 "--views %s", NULL, "Views for %V/%v wildcards (comma-separated, defaults to left,right)",
                 "--wildcardoff", NULL, "Disable numeric wildcard expansion for subsequent command line arguments",
@@ -4762,6 +5365,7 @@ getargs (int argc, char *argv[])
                 "--auto-orient", &ot.autoorient, "", // symonym for --autoorient
                 "--autocc", &ot.autocc, "Automatically color convert based on filename",
                 "--noautocc %!", &ot.autocc, "Turn off automatic color conversion",
+                "--nofuse %!", &ot.fuse, "Run each point-wise op separately rather than fusing runs of them into one pass",
                 "--native %@", set_native, &ot.nativeread, "Keep native pixel data type (bypass cache if necessary)",
                 "--cache %@ %d", set_cachesize, &ot.cachesize, "ImageCache size (in MB: default=4096)",
                 "--autotile %@ %d", set_autotile, &ot.autotile, "Autotile size for cached images (default=4096)",
@@ -4817,6 +5421,7 @@ getargs (int argc, char *argv[])
                 "--fail %g", &ot.diff_failthresh, "Failure threshold difference (0.000001)",
                 "--failpercent %g", &ot.diff_failpercent, "Allow this percentage of failures in diff (0)",
                 "--hardfail %g", &ot.diff_hardfail, "Fail diff if any one pixel exceeds this error (infinity)",
+                "--failfast", &ot.diff_failfast, "Stop diff as soon as the failure limits are exceeded",
                 "--warn %g", &ot.diff_warnthresh, "Warning threshold difference (0.00001)",
                 "--warnpercent %g", &ot.diff_warnpercent, "Allow this percentage of warnings in diff (0)",
                 "--hardwarn %g", &ot.diff_hardwarn, "Warn if any one pixel difference exceeds this error (infinity)",
@@ -4879,10 +5484,11 @@ getargs (int argc, char *argv[])
                 "--pixelaspect %@ %g", action_pixelaspect, NULL, "Scale up the image's width or height to match the given pixel aspect ratio (options: filter=%s)",
                 "--rotate %@ %g", action_rotate, NULL, "Rotate pixels (argument is degrees clockwise) around the center of the display window (options: filter=%s, center=%f,%f, recompute_roi=%d",
                 "--warp %@ %s", action_warp, NULL, "Warp pixels (argument is a 3x3 matrix, separated by commas) (options: filter=%s, recompute_roi=%d)",
+                "--st_warp %@", action_st_warp, NULL, "Warp the next-to-top image by the STMap on top of the stack (options: filter=%s, chan_s=%d, chan_t=%d, flip_s=%d, flip_t=%d)",
                 "--convolve %@", action_convolve, NULL,
                     "Convolve with a kernel",
                 "--blur %@ %s", action_blur, NULL,
-                    "Blur the image (arg: WxH; options: kernel=name)",
+                    "Blur the image (arg: WxH; options: kernel=name, fast=0|1|box)",
                 "--median %@ %s", action_median, NULL,
                     "Median filter the image (arg: WxH)",
                 "--dilate %@ %s", action_dilate, NULL,
@@ -5029,6 +5635,10 @@ handle_sequence (int argc, const char **argv)
         else if ((strarg == "--frames" || strarg == "-frames") && a < argc-1) {
             framespec = argv[++a];
         }
+        else if ((strarg == "--parallel-frames" || strarg == "-parallel-frames")
+                 && a < argc-1) {
+            parallel_frames = std::max (1, atoi (argv[++a]));
+        }
         else if ((strarg == "--framepadding" || strarg == "-framepadding")
                  && a < argc-1) {
             int f = atoi (argv[++a]);
@@ -5119,36 +5729,95 @@ handle_sequence (int argc, const char **argv)
         }
     }
 
+#if ! OIIOTOOL_PARALLEL_FRAMES
+    parallel_frames = 1;
+#endif
+    parallel_frames = std::min (parallel_frames, std::max (1, int(nfilenames)));
+
+    // Have the files of the next few frames of each input sequence
+    // fetched while we work on the current ones.
+    std::vector<std::unique_ptr<Filesystem::SequenceReadahead> > readahead;
+    for (size_t j = 0;  j < sequence_args.size() && nfilenames > 1;  ++j)
+        if (! sequence_is_output[j])
+            readahead.emplace_back (new Filesystem::SequenceReadahead (
+                                        filenames[sequence_args[j]],
+                                        std::max (2, parallel_frames)));
+
     // OK, now we just call getargs once for each item in the sequences,
     // substituting the i-th sequence entry for its respective argument
-    // every time.
-    std::vector<const char *> seq_argv (argv, argv+argc+1);
-    for (size_t i = 0;  i < nfilenames;  ++i) {
-        if (ot.debug)
-            std::cout << "SEQUENCE " << i << "\n";
-        for (size_t j = 0;  j < sequence_args.size();  ++j) {
-            size_t a = sequence_args[j];
-            seq_argv[a] = filenames[a][i].c_str();
-            if (ot.debug)
-                std::cout << "  " << argv[a] << " -> " << seq_argv[a] << "\n";
+    // every time.  With --parallel-frames, that many threads each take the
+    // next frame not yet claimed, using their own Oiiotool state and the
+    // shared ImageCache, with the thread budget for the IBA operations
+    // divided among them.
+    mutex frame_mutex;
+    size_t next_frame = 0;
+    atomic_int worker_count (0);
+    auto run_frames = [&](Oiiotool *main_ot) {
+        if (main_ot != &ot) {
+            ot.imagecache = main_ot->imagecache;
+            ot.debug = main_ot->debug;
+            ot.thread_index = int(worker_count++) + 1;
         }
+        std::vector<const char *> seq_argv (argv, argv+argc+1);
+        while (1) {
+            size_t i;
+            {
+                lock_guard lock (frame_mutex);
+                if (next_frame >= nfilenames)
+                    break;
+                i = next_frame++;
+                for (auto& r : readahead)
+                    r->advance ((int)i);
+            }
+            if (ot.debug)
+                std::cout << "SEQUENCE " << i << "\n";
+            for (size_t j = 0;  j < sequence_args.size();  ++j) {
+                size_t a = sequence_args[j];
+                seq_argv[a] = filenames[a][i].c_str();
+                if (ot.debug)
+                    std::cout << "  " << argv[a] << " -> " << seq_argv[a] << "\n";
+            }
 
-        ot.clear_options (); // Careful to reset all command line options!
-        getargs (argc, (char **)&seq_argv[0]);
+            ot.clear_options (); // Careful to reset all command line options!
+            getargs (argc, (char **)&seq_argv[0]);
 
-        ot.process_pending ();
-        if (ot.pending_callback())
-            ot.warning (Strutil::format ("pending '%s' command never executed", ot.pending_callback_name()));
-        // Clear the stack at the end of each iteration
-        ot.curimg.reset ();
-        ot.image_stack.clear();
-
-        if (ot.runstats)
-            std::cout << "End iteration " << i << ": "
-                    << Strutil::timeintervalformat(ot.total_runtime(),2) << "  "
-                    << Strutil::memformat(Sysutil::memory_used()) << "\n";
-        if (ot.debug)
-            std::cout << "\n";
+            ot.process_pending ();
+            if (ot.pending_callback())
+                ot.warning (Strutil::format ("pending '%s' command never executed", ot.pending_callback_name()));
+            // Clear the stack at the end of each iteration
+            ot.curimg.reset ();
+            ot.image_stack.clear();
+
+            if (ot.runstats)
+                std::cout << "End iteration " << i << ": "
+                        << Strutil::timeintervalformat(ot.total_runtime(),2) << "  "
+                        << Strutil::memformat(Sysutil::memory_used()) << "\n";
+            if (ot.debug)
+                std::cout << "\n";
+        }
+        if (main_ot != &ot) {
+            ot.check_peak_memory ();
+            lock_guard lock (frame_mutex);
+            main_ot->merge_stats (ot);
+        }
+    };
+
+    if (parallel_frames > 1) {
+        int threads = 0;
+        OIIO::getattribute ("threads", threads);
+        int frame_threads = std::max (1, (threads > 0 ? threads
+                              : int(Sysutil::hardware_concurrency())) / parallel_frames);
+        OIIO::attribute ("threads", frame_threads);
+        OIIO::attribute ("exr_threads", frame_threads);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < parallel_frames; ++t)
+            workers.emplace_back (run_frames, &ot);
+        for (auto& w : workers)
+            w.join ();
+        OIIO::attribute ("threads", threads);
+        OIIO::attribute ("exr_threads", threads);
+    } else {
+        run_frames (&ot);
     }
 
     return true;
@@ -5156,24 +5825,10 @@ handle_sequence (int argc, const char **argv)
 
 
 
-int
-main (int argc, char *argv[])
+// Run one oiiotool command line, once the ImageCache is set up.
+static int
+run_command_line (int argc, char *argv[])
 {
-#if OIIO_MSVS_BEFORE_2015
-     // When older Visual Studio is used, float values in scientific foramt
-     // are printed with three digit exponent. We change this behaviour to
-     // fit Linux way.
-    _set_output_format (_TWO_DIGIT_EXPONENT);
-#endif
-
-    ot.imagecache = ImageCache::create (false);
-    ASSERT (ot.imagecache);
-    ot.imagecache->attribute ("forcefloat", 1);
-    ot.imagecache->attribute ("max_memory_MB", float(ot.cachesize));
-    ot.imagecache->attribute ("autotile", ot.autotile);
-    ot.imagecache->attribute ("autoscanline", int(ot.autotile ? 1 : 0));
-
-    Filesystem::convert_native_arguments (argc, (const char **)argv);
     if (handle_sequence (argc, (const char **)argv)) {
         // Deal with sequence
 
@@ -5210,6 +5865,7 @@ main (int argc, char *argv[])
             unaccounted -= t;
         }
         std::cout << Strutil::format (timeformat, "unaccounted", std::max(unaccounted, 0.0));
+        ot.print_op_profiles ();
         ot.check_peak_memory ();
         std::cout << "  Peak memory:    " << Strutil::memformat(ot.peak_memory) << "\n";
         std::cout << "  Current memory: " << Strutil::memformat(Sysutil::memory_used()) << "\n";
@@ -5218,3 +5874,56 @@ main (int argc, char *argv[])
 
     return ot.return_value;
 }
+
+
+
+// For --server: each request runs in a process forked from the server,
+// so its clocks need to start now, not when the server did.
+static int
+run_served_command_line (int argc, char *argv[])
+{
+    ot.total_runtime.reset ();
+    ot.total_runtime.start ();
+    optimer_origin.reset ();
+    optimer_origin.start ();
+    return run_command_line (argc, argv);
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+#if OIIO_MSVS_BEFORE_2015
+     // When older Visual Studio is used, float values in scientific foramt
+     // are printed with three digit exponent. We change this behaviour to
+     // fit Linux way.
+    _set_output_format (_TWO_DIGIT_EXPONENT);
+#endif
+
+    // "oiiotool --client SOCKET args..." hands the rest of the command
+    // line to a running "oiiotool --server SOCKET".
+    if (argc >= 3 && ! strcmp (argv[1], "--client")) {
+        std::string socketpath = argv[2];
+        argv[2] = argv[0];   // so the server sees "oiiotool args..."
+        return run_client (socketpath, argc-2, argv+2);
+    }
+
+    ot.imagecache = ImageCache::create (false);
+    ASSERT (ot.imagecache);
+    ot.imagecache->attribute ("forcefloat", 1);
+    ot.imagecache->attribute ("max_memory_MB", float(ot.cachesize));
+    ot.imagecache->attribute ("autotile", ot.autotile);
+    ot.imagecache->attribute ("autoscanline", int(ot.autotile ? 1 : 0));
+
+    // "oiiotool --server SOCKET" does the start-up work that every
+    // command line needs now, then serves command lines until killed.
+    if (argc >= 3 && ! strcmp (argv[1], "--server")) {
+        std::string formats;
+        OIIO::getattribute ("format_list", formats);  // catalogs the plugins
+        return run_server (argv[2], run_served_command_line);
+    }
+
+    Filesystem::convert_native_arguments (argc, (const char **)argv);
+    return run_command_line (argc, argv);
+}
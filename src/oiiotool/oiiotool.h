@@ -31,9 +31,12 @@
 
 #ifndef OIIOTOOL_H
 
+#include <ctime>
+#include <future>
 #include <memory>
 
 #include "OpenImageIO/imagebuf.h"
+#include "OpenImageIO/imagebufalgo.h"
 #include "OpenImageIO/timer.h"
 #include "OpenImageIO/sysutil.h"
 
@@ -43,6 +46,8 @@ namespace OiioTool {
 
 typedef int (*CallbackFunction)(int argc,const char*argv[]);
 
+class OpTimer;
+
 class ImageRec;
 typedef std::shared_ptr<ImageRec> ImageRecRef;
 
@@ -58,6 +63,8 @@ enum ReadPolicy {
                            //<   but still subject to format conversion.
     ReadNativeNoCache = 3, //< No cache, no conversion. Do it all now.
                            //<   You better know what you're doing.
+    ReadDeferred = 4,      //< Don't read even the first subimage until
+                           //<   its pixels or spec are used.
 };
 
 
@@ -76,10 +83,12 @@ public:
     bool dumpdata;
     bool dumpdata_showempty;
     bool hash;
+    bool fasthash;
     bool updatemode;
     bool autoorient;
     bool autocc;                      // automatically color correct
     bool nativeread;                  // force native data type reads
+    bool fuse;                        // fuse runs of point-wise ops
     int cachesize;
     int autotile;
     std::string full_command_line;
@@ -114,6 +123,7 @@ public:
     float diff_failthresh;
     float diff_failpercent;
     float diff_hardfail;
+    bool diff_failfast;               // stop diff at the first failures
 
     // Internal state
     ImageRecRef curimg;                      // current image
@@ -132,15 +142,45 @@ public:
     size_t peak_memory;
     int num_outputs;                         // Count of outputs written
     bool printed_info;                       // printed info at some point
+    std::string runstats_trace;              // Chrome trace file to write
+    int thread_index;                        // For --parallel-frames
+    int optimer_depth;                       // Count of running OpTimers
+
+    // What --runstats reports about each command that was run
+    struct OpProfile {
+        std::string command;
+        int thread;
+        double start, wall, cpu;             // Seconds
+        long long bytes_read, bytes_written;
+        long long tile_lookups, tile_misses; // ImageCache, during the op
+        long long peak_pixel_memory;         // Held by ImageBufs
+    };
+    std::vector<OpProfile> op_profiles;
 
     Oiiotool ();
 
     void clear_options ();
 
+    // Fold the results and statistics of another Oiiotool (such as one
+    // that processed some frames of a sequence on another thread) into
+    // this one.
+    void merge_stats (const Oiiotool &other);
+
+    // Add the command's time to function_times and its profile to
+    // op_profiles.
+    void record_op (string_view command, const OpTimer &timer,
+                    long long bytes_written = 0);
+
+    // Print the per-command profile table, and write the Chrome trace
+    // file if one was requested.
+    void print_op_profiles ();
+
     /// Force img to be read at this point.  Use this wrapper, don't directly
     /// call img->read(), because there's extra work done here specific to
     /// oiiotool.
-    bool read (ImageRecRef img, ReadPolicy readpolicy = ReadDefault);
+    /// If channel_set is not empty, only those channels are read.
+    bool read (ImageRecRef img, ReadPolicy readpolicy = ReadDefault,
+               string_view channel_set = "");
     // Read the current image
     bool read (ReadPolicy readpolicy = ReadDefault) {
         if (curimg)
@@ -242,6 +282,27 @@ private:
 };
 
 
+/// Times one command: a Timer that also notes the CPU time, the
+/// ImageCache activity and the ImageBuf pixel memory while it runs, for
+/// Oiiotool::record_op.
+class OpTimer {
+public:
+    OpTimer (Oiiotool &ot);
+    ~OpTimer () { --m_ot.optimer_depth; }
+    double operator() () const { return m_timer(); }
+    void start () { m_timer.start(); }
+    void stop () { m_timer.stop(); }
+private:
+    Oiiotool &m_ot;
+    Timer m_timer;
+    double m_start;
+    std::clock_t m_cpu_start;
+    long long m_bytes_read, m_tile_lookups, m_tile_misses;
+    friend class Oiiotool;
+};
+
+
+
 typedef std::shared_ptr<ImageBuf> ImageBufRef;
 
 
@@ -310,6 +371,12 @@ public:
 
     enum WinMerge { WinMergeUnion, WinMergeIntersection, WinMergeA, WinMergeB };
 
+    // Initialize a lazily evaluated ImageRec whose first subimage will be
+    // the first subimage of src with the point-wise ops applied. Nothing
+    // is computed until it is read.
+    ImageRec (const std::string &name, ImageRecRef src,
+              const ImageBufAlgo::PixelPipeline &ops);
+
     // Initialize a new ImageRec based on two exemplars.  Initialize
     // just the single subimage_to_copy if >= 0, or all subimages if <0.
     // The two WinMerge parameters pixwin and fullwin, dictate the
@@ -353,26 +420,62 @@ public:
     // it's lazily kept as name only, without reading the file.)
     bool elaborated () const { return m_elaborated; }
 
+    // Is this a not-yet-evaluated chain of point-wise ops?  If so, the
+    // source image and the ops are available.
+    bool pending () const { return (bool)m_pending_src; }
+    ImageRecRef pending_src () const { return m_pending_src; }
+    const ImageBufAlgo::PixelPipeline &pending_ops () const {
+        return m_pending_ops;
+    }
+
+    // Read an image from a file.  This only learns how many subimages
+    // and MIP levels it has; the pixels of each one (just the channels in
+    // channel_set, if it's not empty) are read when it's first accessed
+    // through operator() or spec(), or by elaborate().
     bool read (ReadPolicy readpolicy = ReadDefault,
                string_view channel_set = "");
 
+    // Read the given subimage and MIP level now, if it was deferred.
+    // Return false if that read failed.
+    bool elaborate (int subimg=0, int mip=0) const {
+        if (subimg < subimages() && mip < miplevels(subimg)
+              && ! m_subimages[subimg].m_miplevels[mip])
+            return read_level (subimg, mip);
+        return true;
+    }
+
     // ir(subimg,mip) references a specific MIP level of a subimage
     // ir(subimg) references the first MIP level of a subimage
     // ir() references the first MIP level of the first subimage
     ImageBuf& operator() (int subimg=0, int mip=0) {
+        elaborate (subimg, mip);
         return *m_subimages[subimg][mip];
     }
     const ImageBuf& operator() (int subimg=0, int mip=0) const {
+        elaborate (subimg, mip);
         return *m_subimages[subimg][mip];
     }
 
     ImageSpec * spec (int subimg=0, int mip=0) {
+        elaborate (subimg, mip);
         return subimg < subimages() ? m_subimages[subimg].spec(mip) : NULL;
     }
     const ImageSpec * spec (int subimg=0, int mip=0) const {
+        elaborate (subimg, mip);
         return subimg < subimages() ? m_subimages[subimg].spec(mip) : NULL;
     }
 
+    // The spec of a subimage and MIP level as it is in the file, without
+    // reading it if it was deferred.
+    const ImageSpec * nativespec (int subimg=0, int mip=0) const;
+
+    // Start reading the first subimage of the file on another thread, the
+    // way a later read(readpolicy) would, so that the I/O overlaps with
+    // the commands that run before the image is used.  If it ends up read
+    // differently (another policy, a channel set), the prefetched pixels
+    // are discarded.
+    void prefetch (ReadPolicy readpolicy = ReadDefault);
+
     bool was_output () const { return m_was_output; }
     void was_output (bool val) { m_was_output = val; }
     bool metadata_modified () const { return m_metadata_modified; }
@@ -400,6 +503,7 @@ public:
     // ImageBuf's spec may have been modified in place.  We need to
     // update the outer copy held by the SubimageRec.
     void update_spec_from_imagebuf (int subimg=0, int mip=0) {
+        elaborate (subimg, mip);
         *m_subimages[subimg].spec(mip) = m_subimages[subimg][mip]->spec();
         metadata_modified (true);
     }
@@ -425,15 +529,31 @@ private:
     bool m_metadata_modified;
     bool m_pixels_modified;
     bool m_was_output;
-    std::vector<SubimageRec> m_subimages;
+    // Mutable because deferred levels are read even through const access
+    mutable std::vector<SubimageRec> m_subimages;
     std::time_t m_time;  //< Modification time of the input file
     TypeDesc m_input_dataformat;
+    ReadPolicy m_readpolicy = ReadDefault;  //< For the deferred reads
+    std::string m_channel_set;
+    struct LevelRead { ImageBufRef ib; bool ok; std::string err; };
+    mutable std::shared_future<LevelRead> m_prefetch;
+    ReadPolicy m_prefetch_policy = ReadDefault;
     ImageCache *m_imagecache;
+    ImageRecRef m_pending_src;
+    ImageBufAlgo::PixelPipeline m_pending_ops;
     mutable std::string m_err;
 
     // Add to the error message
     void append_error (string_view message) const;
 
+    // Read one subimage and MIP level from the file.
+    bool read_level (int s, int m) const;
+    static LevelRead read_imagebuf (const std::string &name,
+                                    ImageCache *imagecache, int s, int m,
+                                    ReadPolicy readpolicy,
+                                    const std::string &channel_set,
+                                    TypeDesc input_dataformat);
+
 };
 
 
@@ -445,6 +565,7 @@ struct print_info_options {
     bool sum;
     bool subimages;
     bool compute_sha1;
+    bool compute_xxhash;
     bool compute_stats;
     bool dumpdata;
     bool dumpdata_showempty;
@@ -455,7 +576,8 @@ struct print_info_options {
 
     print_info_options ()
         : verbose(false), filenameprefix(false), sum(false), subimages(false),
-          compute_sha1(false), compute_stats(false), dumpdata(false),
+          compute_sha1(false), compute_xxhash(false), compute_stats(false),
+          dumpdata(false),
           dumpdata_showempty(true), namefieldlength(20)
     {}
 };
@@ -505,6 +627,16 @@ bool decode_channel_set (const ImageSpec &spec, string_view chanlist,
                     std::vector<std::string> &newchannelnames,
                     std::vector<int> &channels, std::vector<float> &values);
 
+// Listen on the Unix domain socket at socketpath and, for each command
+// line sent by run_client, call run(argc,argv) in a forked process that
+// has the client's stdin/stdout/stderr and working directory.  Only
+// returns if the server can't go on.
+int run_server (string_view socketpath, int (*run)(int argc, char *argv[]));
+
+// Send the command line to the server at socketpath, which runs it with
+// this process's stdin/stdout/stderr.  Return its exit status.
+int run_client (string_view socketpath, int argc, char *argv[]);
+
 
 
 // Helper template -- perform the action on each spec in the ImageRec.
@@ -562,7 +694,7 @@ public:
     virtual int operator() () {
         // Set up a timer to automatically record how much time is spent in
         // every class of operation.
-        Timer timer (ot.enable_function_timing);
+        OpTimer timer (ot);
         if (ot.debug) {
             std::cout << "Performing '" << opname() << "'";
             if (nargs() > 1)
@@ -623,7 +755,7 @@ public:
 
         // Add the time we spent to the stats total for this op type.
         double optime = timer();
-        ot.function_times[opname()] += optime;
+        ot.record_op (opname(), timer);
         if (ot.debug) {
             Strutil::printf ("    %s took %s  (total time %s, mem %s)\n",
                              opname(), Strutil::timeintervalformat(optime,2),
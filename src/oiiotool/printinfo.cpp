@@ -100,6 +100,43 @@ compute_sha1 (Oiiotool &ot, ImageInput *input)
 
 
 
+// Fast non-cryptographic hash of the pixels, computed in parallel blocks
+// by ImageBufAlgo::computePixelHashXX64.
+static std::string
+compute_xxhash (Oiiotool &ot, ImageInput *input)
+{
+    const ImageSpec &spec (input->spec());
+    if (spec.deep) {
+        DeepData dd;
+        if (! input->read_native_deep_image (dd)) {
+            ot.error ("    xxHash64: unable to compute, could not read image\n");
+            return std::string();
+        }
+        std::vector<unsigned long long> h (2);
+        h[0] = xxhash::XXH64 (dd.all_samples().data(),
+                              dd.all_samples().size() * sizeof(unsigned int));
+        h[1] = xxhash::XXH64 (dd.all_data().data(), dd.all_data().size());
+        return Strutil::format ("%016llX",
+                                xxhash::XXH64 (&h[0], h.size()*sizeof(h[0])));
+    }
+    ImageSpec bufspec = spec;
+    bufspec.channelformats.clear ();
+    imagesize_t size = bufspec.image_bytes ();
+    if (size >= std::numeric_limits<size_t>::max()) {
+        ot.error ("    xxHash64: unable to compute, image is too big\n");
+        return std::string();
+    }
+    std::unique_ptr<char[]> buf (new char [std::max (size, imagesize_t(1))]);
+    if (size && ! input->read_image (bufspec.format, &buf[0])) {
+        ot.error ("    xxHash64: unable to compute, could not read image\n");
+        return std::string();
+    }
+    ImageBuf img (bufspec, &buf[0]);
+    return ImageBufAlgo::computePixelHashXX64 (img);
+}
+
+
+
 static void
 dump_data (ImageInput *input, const print_info_options &opt)
 {
@@ -538,6 +575,14 @@ print_info_subimage (Oiiotool &ot,
         else if (serformat == ImageSpec::SerialText)
             lines.insert (lines.begin()+1, format("<SHA1>%s</SHA1>", sha));
     }
+    if (opt.compute_xxhash && (opt.metamatch.empty() ||
+                               boost::regex_search ("xxhash64", field_re))) {
+        std::string h = compute_xxhash (ot, input);
+        if (serformat == ImageSpec::SerialText)
+            lines.insert (lines.begin()+1, format("    xxHash64: %s", h));
+        else if (serformat == ImageSpec::SerialXML)
+            lines.insert (lines.begin()+1, format("<xxHash64>%s</xxHash64>", h));
+    }
 
     // Count MIP levels
     if (printres && nmip > 1) {
@@ -664,8 +709,14 @@ OiioTool::print_info (Oiiotool &ot,
 {
     using Strutil::format;
     error.clear();
-    ImageSpec *config = ot.input_config_set ? &ot.input_config : NULL;
-    ImageInput *input = ImageInput::open (filename.c_str(), config);
+    // Unless we need the pixels (for hashes or dumping the data), only
+    // ask for the header.  Stats are computed from a separate read.
+    ImageSpec config;
+    if (ot.input_config_set)
+        config = ot.input_config;
+    if (! opt.compute_sha1 && ! opt.compute_xxhash && ! opt.dumpdata)
+        config.attribute ("oiio:headeronly", 1);
+    ImageInput *input = ImageInput::open (filename.c_str(), &config);
     if (! input) {
         error = geterror();
         if (error.empty())
@@ -0,0 +1,319 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+// oiiotool --server: a long-lived oiiotool process that runs the command
+// lines sent to it by "oiiotool --client", so the start-up work (plugin
+// catalog, OCIO config, ImageCache setup) is paid once.
+//
+// Each request is run in a process forked from the warm server, with the
+// client's own stdin/stdout/stderr (passed over the socket) and working
+// directory, so everything it prints and its exit status are exactly
+// what a normal oiiotool run would give, and nothing one command line
+// does can leak into the next.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+# include <signal.h>
+# include <sys/socket.h>
+# include <sys/types.h>
+# include <sys/un.h>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+
+#include "OpenImageIO/filesystem.h"
+#include "OpenImageIO/strutil.h"
+
+#include "oiiotool.h"
+
+OIIO_NAMESPACE_USING
+using namespace OiioTool;
+
+
+
+#ifndef _WIN32
+
+namespace {
+
+// Fill in a sockaddr_un for the socket path, or return false if the path
+// is too long to fit.
+bool
+socket_address (string_view path, sockaddr_un &addr)
+{
+    memset (&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        return false;
+    memcpy (addr.sun_path, path.data(), path.size());
+    return true;
+}
+
+
+
+bool
+write_all (int fd, const void *data, size_t size)
+{
+    const char *p = (const char *)data;
+    while (size) {
+        ssize_t n = ::write (fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+
+
+bool
+read_all (int fd, void *data, size_t size)
+{
+    char *p = (char *)data;
+    while (size) {
+        ssize_t n = ::read (fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+
+
+// A request is one message carrying the client's stdin, stdout and
+// stderr descriptors and the length of what follows: the working
+// directory and then each argument, all nul-terminated.
+bool
+send_request (int sock, const std::string &payload)
+{
+    uint32_t len = (uint32_t) payload.size();
+    iovec iov;
+    iov.iov_base = &len;
+    iov.iov_len = sizeof(len);
+    int fds[3] = { 0, 1, 2 };
+    char control[CMSG_SPACE(sizeof(fds))];
+    memset (control, 0, sizeof(control));
+    msghdr msg;
+    memset (&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (sizeof(fds));
+    memcpy (CMSG_DATA(cmsg), fds, sizeof(fds));
+    if (sendmsg (sock, &msg, 0) != (ssize_t)sizeof(len))
+        return false;
+    return write_all (sock, payload.data(), payload.size());
+}
+
+
+
+bool
+receive_request (int sock, int fds[3], std::string &payload)
+{
+    uint32_t len = 0;
+    iovec iov;
+    iov.iov_base = &len;
+    iov.iov_len = sizeof(len);
+    char control[CMSG_SPACE(3*sizeof(int))];
+    msghdr msg;
+    memset (&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg (sock, &msg, 0) != (ssize_t)sizeof(len))
+        return false;
+    cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+    if (! cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+        cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN (3*sizeof(int)))
+        return false;
+    memcpy (fds, CMSG_DATA(cmsg), 3*sizeof(int));
+    payload.resize (len);
+    return len == 0 || read_all (sock, &payload[0], len);
+}
+
+
+
+// Run one client's request, in the forked child.  Never returns.
+void
+run_request (int client, int (*run)(int argc, char *argv[]))
+{
+    int fds[3];
+    std::string payload;
+    if (! receive_request (client, fds, payload))
+        _exit (EXIT_FAILURE);
+    std::vector<char *> args;
+    for (size_t i = 0; i < payload.size(); i += strlen(&payload[i]) + 1)
+        args.push_back (&payload[i]);
+    if (args.size() < 2 || chdir (args[0]) != 0)
+        _exit (EXIT_FAILURE);
+    // Take the client's place: its descriptors and working directory,
+    // and a process of its own for the exit status.
+    for (int i = 0; i < 3; ++i) {
+        dup2 (fds[i], i);
+        close (fds[i]);
+    }
+    signal (SIGCHLD, SIG_DFL);
+    pid_t pid = fork ();
+    if (pid == 0) {
+        close (client);
+        args.push_back (NULL);
+        exit (run (int(args.size()) - 2, &args[1]));
+    }
+    int status = 0, result = EXIT_FAILURE;
+    if (pid > 0 && waitpid (pid, &status, 0) == pid)
+        result = WIFEXITED(status) ? WEXITSTATUS(status)
+                                   : 128 + WTERMSIG(status);
+    int32_t reply = result;
+    write_all (client, &reply, sizeof(reply));
+    _exit (EXIT_SUCCESS);
+}
+
+}  // end anon namespace
+
+
+
+int
+OiioTool::run_server (string_view socketpath,
+                      int (*run)(int argc, char *argv[]))
+{
+    sockaddr_un addr;
+    if (! socket_address (socketpath, addr)) {
+        std::cerr << "oiiotool: socket path too long: " << socketpath << "\n";
+        return EXIT_FAILURE;
+    }
+    int sock = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        std::cerr << "oiiotool: could not create socket: " << strerror(errno) << "\n";
+        return EXIT_FAILURE;
+    }
+    unlink (addr.sun_path);   // a stale socket from an earlier server
+    if (bind (sock, (sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen (sock, 64) != 0) {
+        std::cerr << "oiiotool: could not listen on " << socketpath
+                  << ": " << strerror(errno) << "\n";
+        close (sock);
+        return EXIT_FAILURE;
+    }
+    // The per-request processes are never waited on by the server.
+    signal (SIGCHLD, SIG_IGN);
+    while (1) {
+        int client = accept (sock, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            std::cerr << "oiiotool: accept failed: " << strerror(errno) << "\n";
+            break;
+        }
+        pid_t pid = fork ();
+        if (pid == 0) {
+            close (sock);
+            run_request (client, run);
+        }
+        if (pid < 0)
+            std::cerr << "oiiotool: fork failed: " << strerror(errno) << "\n";
+        close (client);
+    }
+    close (sock);
+    unlink (addr.sun_path);
+    return EXIT_FAILURE;
+}
+
+
+
+int
+OiioTool::run_client (string_view socketpath, int argc, char *argv[])
+{
+    sockaddr_un addr;
+    int sock = -1;
+    if (socket_address (socketpath, addr))
+        sock = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0 || connect (sock, (sockaddr *)&addr, sizeof(addr)) != 0) {
+        std::cerr << "oiiotool: could not connect to server " << socketpath
+                  << ": " << strerror(errno) << "\n";
+        if (sock >= 0)
+            close (sock);
+        return EXIT_FAILURE;
+    }
+    std::string payload = Filesystem::current_path ();
+    payload += '\0';
+    for (int i = 0; i < argc; ++i) {
+        payload += argv[i];
+        payload += '\0';
+    }
+    int32_t result = EXIT_FAILURE;
+    if (! send_request (sock, payload) ||
+        ! read_all (sock, &result, sizeof(result))) {
+        std::cerr << "oiiotool: lost the connection to server " << socketpath << "\n";
+        result = EXIT_FAILURE;
+    }
+    close (sock);
+    return result;
+}
+
+#else
+
+int
+OiioTool::run_server (string_view socketpath,
+                      int (*run)(int argc, char *argv[]))
+{
+    std::cerr << "oiiotool: --server is not supported on this platform\n";
+    return EXIT_FAILURE;
+}
+
+
+
+int
+OiioTool::run_client (string_view socketpath, int argc, char *argv[])
+{
+    std::cerr << "oiiotool: --client is not supported on this platform\n";
+    return EXIT_FAILURE;
+}
+
+#endif
@@ -72,6 +72,12 @@
 #include <OpenEXR/ImfDeepFrameBuffer.h>
 #include <OpenEXR/ImfDoubleAttribute.h>
 #endif
+#if defined(OPENEXR_VERSION_MAJOR) && \
+    (OPENEXR_VERSION_MAJOR*10000+OPENEXR_VERSION_MINOR*100+OPENEXR_VERSION_PATCH) >= 20300
+// OpenEXR 2.3 lets us supply the threads that run its tasks
+#include <OpenEXR/IlmThreadPool.h>
+#define OIIO_EXR_THREAD_PROVIDER 1
+#endif
 
 #ifdef __GNUC__
 #pragma GCC visibility pop
@@ -140,18 +146,53 @@ private:
 
 
 
+// Input stream that reads through a caller-supplied Filesystem::IOProxy.
+// Each stream keeps its own position and reads with pread, so several
+// streams (such as the concurrent tile readers) may share one proxy.
+class OpenEXRProxyInputStream : public Imf::IStream
+{
+public:
+    OpenEXRProxyInputStream (const char *filename, Filesystem::IOProxy *io)
+        : Imf::IStream (filename), m_io(io), m_pos(0) { }
+    virtual bool read (char c[], int n) {
+        size_t r = m_io->pread (c, size_t(n), m_pos);
+        m_pos += r;
+        if (r != size_t(n))
+            throw Iex::InputExc ("Unexpected end of file.");
+        return true;
+    }
+    virtual Imath::Int64 tellg () { return m_pos; }
+    virtual void seekg (Imath::Int64 pos) { m_pos = int64_t(pos); }
+    virtual void clear () { }
+
+private:
+    Filesystem::IOProxy *m_io;
+    int64_t m_pos;
+};
+
+
+
 class OpenEXRInput : public ImageInput {
 public:
     OpenEXRInput ();
     virtual ~OpenEXRInput () { close(); }
     virtual const char * format_name (void) const { return "openexr"; }
     virtual int supports (string_view feature) const {
+        if (feature == "subimage_count")   // known as soon as it's open
+            return m_input_stream ? m_nsubimages : 0;
         return (feature == "arbitrary_metadata"
              || feature == "exif"   // Because of arbitrary_metadata
-             || feature == "iptc"); // Because of arbitrary_metadata
+             || feature == "iptc"   // Because of arbitrary_metadata
+             || feature == "ioproxy"
+#ifdef USE_OPENEXR_VERSION2
+             || feature == "concurrent_tiles"
+#endif
+             );
     }
     virtual bool valid_file (const std::string &filename) const;
     virtual bool open (const std::string &name, ImageSpec &newspec);
+    virtual bool open (const std::string &name, ImageSpec &newspec,
+                       const ImageSpec &config);
     virtual bool close ();
     virtual int current_subimage (void) const { return m_subimage; }
     virtual int current_miplevel (void) const { return m_miplevel; }
@@ -166,14 +207,39 @@ public:
     virtual bool read_native_tiles (int xbegin, int xend, int ybegin, int yend,
                                     int zbegin, int zend,
                                     int chbegin, int chend, void *data);
+    virtual bool read_scanlines (int ybegin, int yend, int z,
+                                 int chbegin, int chend,
+                                 TypeDesc format, void *data,
+                                 stride_t xstride=AutoStride,
+                                 stride_t ystride=AutoStride);
+    virtual bool read_tiles (int xbegin, int xend, int ybegin, int yend,
+                             int zbegin, int zend,
+                             int chbegin, int chend, TypeDesc format,
+                             void *data, stride_t xstride=AutoStride,
+                             stride_t ystride=AutoStride,
+                             stride_t zstride=AutoStride);
+    virtual bool read_tiles_concurrent (int subimage, int miplevel,
+                                        int xbegin, int xend,
+                                        int ybegin, int yend,
+                                        int zbegin, int zend,
+                                        int chbegin, int chend,
+                                        TypeDesc format, void *data);
     virtual bool read_native_deep_scanlines (int ybegin, int yend, int z,
                                              int chbegin, int chend,
                                              DeepData &deepdata);
+#ifdef USE_OPENEXR_VERSION2
+    Imf::InputPart *scanline_input_part () const { return m_scanline_input_part; }
+    Imf::TiledInputPart *tiled_input_part () const { return m_tiled_input_part; }
+#endif
     virtual bool read_native_deep_tiles (int xbegin, int xend,
                                          int ybegin, int yend,
                                          int zbegin, int zend,
                                          int chbegin, int chend,
                                          DeepData &deepdata);
+    virtual bool read_native_deep_sample_counts (int xbegin, int xend,
+                                                 int ybegin, int yend,
+                                                 int zbegin, int zend,
+                                                 unsigned int *counts);
 
 private:
     struct PartInfo {
@@ -197,7 +263,8 @@ private:
     };
 
     std::vector<PartInfo> m_parts;        ///< Image parts
-    OpenEXRInputStream *m_input_stream;   ///< Stream for input file
+    Imf::IStream *m_input_stream;         ///< Stream for input file
+    Filesystem::IOProxy *m_io;            ///< Caller's I/O proxy, if any
 #ifdef USE_OPENEXR_VERSION2
     Imf::MultiPartInputFile *m_input_multipart;   ///< Multipart input
     Imf::InputPart *m_scanline_input_part;
@@ -216,9 +283,37 @@ private:
     int m_subimage;                       ///< What subimage are we looking at?
     int m_nsubimages;                     ///< How many subimages are there?
     int m_miplevel;                       ///< What MIP level are we looking at?
+    std::string m_filename;               ///< Name of the open file
+
+    // Extra handles on the same file, used by read_tiles_concurrent so
+    // that several threads can each fetch and decompress their own tiles
+    // instead of queueing behind one Imf::TiledInputFile.  They are
+    // opened on demand, reused, and only freed by close().
+    struct TileReader {
+#ifdef USE_OPENEXR_VERSION2
+        std::unique_ptr<Imf::IStream> stream;
+        std::unique_ptr<Imf::MultiPartInputFile> multipart;
+        std::unique_ptr<Imf::TiledInputPart> part;
+#endif
+        int subimage = -1;
+    };
+    std::vector<TileReader *> m_idle_tile_readers;
+    int m_ntile_readers;                  ///< Tile readers in existence
+    spin_mutex m_tile_readers_mutex;
+
+    TileReader *acquire_tile_reader (int subimage);
+    void release_tile_reader (TileReader *reader, bool ok);
+
+    // Can OpenEXR itself convert channels [chbegin,chend) of the subimage
+    // to 'format' as it decodes, producing the same values as OIIO's own
+    // conversion?  This is true for half and float in either direction,
+    // which lets us hand the caller's buffer straight to the library.
+    bool library_converts (int subimage, TypeDesc format,
+                           int chbegin, int chend) const;
 
     void init () {
         m_input_stream = NULL;
+        m_io = NULL;
         m_input_multipart = NULL;
         m_scanline_input_part = NULL;
         m_tiled_input_part = NULL;
@@ -228,6 +323,8 @@ private:
         m_input_tiled = NULL;
         m_subimage = -1;
         m_miplevel = -1;
+        m_filename.clear ();
+        m_ntile_readers = 0;
     }
 };
 
@@ -247,6 +344,9 @@ openexr_input_imageio_create ()
 OIIO_EXPORT const char * openexr_input_extensions[] = {
     "exr", "sxr", "mxr", NULL
 };
+OIIO_EXPORT const char * openexr_input_magic[] = {
+    "762f3101", NULL
+};
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -313,6 +413,53 @@ static StringMap exr_tag_to_oiio_std;
 
 namespace pvt {
 
+#ifdef OIIO_EXR_THREAD_PROVIDER
+// Run OpenEXR's decompression and compression tasks on OIIO's default
+// thread pool, instead of letting IlmThread spin up a second full set of
+// threads that compete with ours (and with the application's) for cores.
+// The thread count it reports is still "exr_threads", which is what
+// OpenEXR uses to decide how many line/tile buffers each file keeps in
+// flight, so it also bounds the concurrency of any single file.
+class OIIOExrThreadProvider : public IlmThread::ThreadPoolProvider {
+public:
+    OIIOExrThreadProvider (int nthreads) : m_nthreads(nthreads), m_pending(0) { }
+    virtual int numThreads () const { return m_nthreads; }
+    virtual void setNumThreads (int nthreads) { m_nthreads = nthreads; }
+    virtual void addTask (IlmThread::Task *task) {
+        thread_pool *pool = default_thread_pool();
+        // A pool thread that is reading an exr file will block until its
+        // tasks are done, so if it pushed them to the pool, enough such
+        // readers could deadlock it. Let it run them itself instead.
+        if (pool->this_thread_is_in_pool()) {
+            run (task);
+            return;
+        }
+        ++m_pending;
+        pool->push ([this,task](int /*id*/){
+            run (task);
+            --m_pending;
+        });
+    }
+    virtual void finish () {
+        // Called before the provider is replaced or destroyed
+        while (m_pending > 0)
+            if (! default_thread_pool()->run_one_task())
+                yield ();
+    }
+private:
+    static void run (IlmThread::Task *task) {
+        IlmThread::TaskGroup *group = task->group();
+        task->execute ();
+        delete task;
+        group->finishOneTask ();
+    }
+    int m_nthreads;
+    atomic_int m_pending;
+};
+#endif
+
+
+
 void set_exr_threads ()
 {
     static int exr_threads = 0;  // lives in exrinput.cpp
@@ -331,10 +478,26 @@ void set_exr_threads ()
     spin_lock lock (exr_threads_mutex);
     if (exr_threads != oiio_threads) {
         exr_threads = oiio_threads;
+#ifdef OIIO_EXR_THREAD_PROVIDER
+        if (exr_threads > 0) {
+            // The pool takes ownership of the provider
+            IlmThread::ThreadPool::globalThreadPool().setThreadProvider (
+                new OIIOExrThreadProvider (exr_threads));
+            return;
+        }
+#endif
         Imf::setGlobalThreadCount (exr_threads);
     }
 }
 
+#ifdef USE_OPENEXR_VERSION2
+// Give OpenEXROutput::copy_image the OpenEXR objects reading the current
+// subimage of 'in', if it is one of ours, so that it can copy the raw
+// compressed chunks.  Return false if it's not an OpenEXR input.
+bool exr_input_parts (ImageInput *in, Imf::InputPart *&scanline,
+                      Imf::TiledInputPart *&tiled);
+#endif
+
 } // namespace pvt
 
 
@@ -354,26 +517,56 @@ OpenEXRInput::valid_file (const std::string &filename) const
 
 
 
+bool
+OpenEXRInput::open (const std::string &name, ImageSpec &newspec,
+                    const ImageSpec &config)
+{
+    const ImageIOParameter *p = config.find_attribute ("oiio:ioproxy",
+                                                       TypeDesc::PTR);
+    if (p)
+        m_io = *(Filesystem::IOProxy **)p->data();
+    return open (name, newspec);
+}
+
+
+
 bool
 OpenEXRInput::open (const std::string &name, ImageSpec &newspec)
 {
-    // Quick check to reject non-exr files
-    if (! Filesystem::is_regular (name)) {
-        error ("Could not open file \"%s\"", name.c_str());
-        return false;
-    }
-    bool tiled;
-    if (! Imf::isOpenExrFile (name.c_str(), tiled)) {
-        error ("\"%s\" is not an OpenEXR file", name.c_str());
-        return false;
+    bool tiled = false;
+    if (m_io) {
+        // Check the magic number and the version field's tiled bit
+        // ourselves, since there is no file for Imf to inspect.
+        unsigned char header[8];
+        if (m_io->pread (header, sizeof(header), 0) != sizeof(header)
+              || header[0] != 0x76 || header[1] != 0x2f
+              || header[2] != 0x31 || header[3] != 0x01) {
+            error ("\"%s\" is not an OpenEXR file", name.c_str());
+            return false;
+        }
+        tiled = (header[5] & 0x02) != 0;
+    } else {
+        // Quick check to reject non-exr files
+        if (! Filesystem::is_regular (name)) {
+            error ("Could not open file \"%s\"", name.c_str());
+            return false;
+        }
+        if (! Imf::isOpenExrFile (name.c_str(), tiled)) {
+            error ("\"%s\" is not an OpenEXR file", name.c_str());
+            return false;
+        }
     }
 
     pvt::set_exr_threads ();
 
     m_spec = ImageSpec(); // Clear everything with default constructor
+    m_filename = name;
     
     try {
-        m_input_stream = new OpenEXRInputStream (name.c_str());
+        if (m_io)
+            m_input_stream = new OpenEXRProxyInputStream (name.c_str(), m_io);
+        else
+            m_input_stream = new OpenEXRInputStream (name.c_str());
     } catch (const std::exception &e) {
         m_input_stream = NULL;
         error ("OpenEXR exception: %s", e.what());
@@ -979,6 +1172,9 @@ OpenEXRInput::close ()
     delete m_input_scanline;
     delete m_input_tiled;
     delete m_input_stream;
+    for (auto r : m_idle_tile_readers)
+        delete r;
+    m_idle_tile_readers.clear ();
     init ();  // Reset to initial state
     return true;
 }
@@ -1060,6 +1256,75 @@ OpenEXRInput::read_native_scanlines (int ybegin, int yend, int z,
 
 
 
+bool
+OpenEXRInput::library_converts (int subimage, TypeDesc format,
+                                int chbegin, int chend) const
+{
+    if (format != TypeDesc::HALF && format != TypeDesc::FLOAT)
+        return false;
+    if (subimage < 0 || subimage >= (int)m_parts.size())
+        return false;
+    const PartInfo &part (m_parts[subimage]);
+    for (int c = chbegin;  c < chend;  ++c)
+        if (part.pixeltype[c] != Imf::HALF && part.pixeltype[c] != Imf::FLOAT)
+            return false;
+    return true;
+}
+
+
+
+bool
+OpenEXRInput::read_scanlines (int ybegin, int yend, int z,
+                              int chbegin, int chend,
+                              TypeDesc format, void *data,
+                              stride_t xstride, stride_t ystride)
+{
+    chend = clamp (chend, chbegin+1, m_spec.nchannels);
+    if (! (m_input_scanline || m_scanline_input_part) ||
+        ! library_converts (m_subimage, format, chbegin, chend))
+        return ImageInput::read_scanlines (ybegin, yend, z, chbegin, chend,
+                                           format, data, xstride, ystride);
+
+    // Let OpenEXR convert half <-> float while it decodes, writing
+    // directly into the caller's buffer with the caller's strides, rather
+    // than reading native data into a temporary and converting after.
+    yend = std::min (yend, m_spec.y+m_spec.height);
+    int nchans = chend - chbegin;
+    stride_t zstride = AutoStride;
+    m_spec.auto_stride (xstride, ystride, zstride, format, nchans,
+                        m_spec.width, m_spec.height);
+    Imf::PixelType pixeltype = (format == TypeDesc::HALF) ? Imf::HALF
+                                                          : Imf::FLOAT;
+    char *buf = (char *)data - m_spec.x * xstride - ybegin * ystride;
+
+    try {
+        Imf::FrameBuffer frameBuffer;
+        for (int c = chbegin;  c < chend;  ++c)
+            frameBuffer.insert (m_spec.channelnames[c].c_str(),
+                                Imf::Slice (pixeltype,
+                                            buf + (c-chbegin)*format.size(),
+                                            xstride, ystride));
+        if (m_input_scanline) {
+            m_input_scanline->setFrameBuffer (frameBuffer);
+            m_input_scanline->readPixels (ybegin, yend-1);
+#ifdef USE_OPENEXR_VERSION2
+        } else if (m_scanline_input_part) {
+            m_scanline_input_part->setFrameBuffer (frameBuffer);
+            m_scanline_input_part->readPixels (ybegin, yend-1);
+#endif
+        }
+    } catch (const std::exception &e) {
+        error ("Failed OpenEXR read: %s", e.what());
+        return false;
+    } catch (...) {   // catch-all for edge cases or compiler bugs
+        error ("Failed OpenEXR read: unknown exception");
+        return false;
+    }
+    return true;
+}
+
+
+
 bool
 OpenEXRInput::read_native_tile (int x, int y, int z, void *data)
 {
@@ -1176,6 +1441,247 @@ OpenEXRInput::read_native_tiles (int xbegin, int xend, int ybegin, int yend,
 
 
 
+bool
+OpenEXRInput::read_tiles (int xbegin, int xend, int ybegin, int yend,
+                          int zbegin, int zend,
+                          int chbegin, int chend, TypeDesc format,
+                          void *data, stride_t xstride,
+                          stride_t ystride, stride_t zstride)
+{
+    chend = clamp (chend, chbegin+1, m_spec.nchannels);
+    // OpenEXR writes whole tiles, so the direct path is only safe when
+    // the caller asked for a whole number of them.
+    int nxtiles = (xend - xbegin + m_spec.tile_width - 1) / m_spec.tile_width;
+    int nytiles = (yend - ybegin + m_spec.tile_height - 1) / m_spec.tile_height;
+    if (! (m_input_tiled || m_tiled_input_part) ||
+        ! m_spec.valid_tile_range (xbegin, xend, ybegin, yend, zbegin, zend) ||
+        (xend-xbegin) != nxtiles*m_spec.tile_width ||
+        (yend-ybegin) != nytiles*m_spec.tile_height ||
+        (zend-zbegin) > 1 ||
+        ! library_converts (m_subimage, format, chbegin, chend))
+        return ImageInput::read_tiles (xbegin, xend, ybegin, yend, zbegin, zend,
+                                       chbegin, chend, format, data,
+                                       xstride, ystride, zstride);
+
+    int nchans = chend - chbegin;
+    m_spec.auto_stride (xstride, ystride, zstride, format, nchans,
+                        xend-xbegin, yend-ybegin);
+    Imf::PixelType pixeltype = (format == TypeDesc::HALF) ? Imf::HALF
+                                                          : Imf::FLOAT;
+    int firstxtile = (xbegin-m_spec.x) / m_spec.tile_width;
+    int firstytile = (ybegin-m_spec.y) / m_spec.tile_height;
+    char *buf = (char *)data - xbegin * xstride - ybegin * ystride;
+
+    try {
+        Imf::FrameBuffer frameBuffer;
+        for (int c = chbegin;  c < chend;  ++c)
+            frameBuffer.insert (m_spec.channelnames[c].c_str(),
+                                Imf::Slice (pixeltype,
+                                            buf + (c-chbegin)*format.size(),
+                                            xstride, ystride));
+        if (m_input_tiled) {
+            m_input_tiled->setFrameBuffer (frameBuffer);
+            m_input_tiled->readTiles (firstxtile, firstxtile+nxtiles-1,
+                                      firstytile, firstytile+nytiles-1,
+                                      m_miplevel, m_miplevel);
+#ifdef USE_OPENEXR_VERSION2
+        } else if (m_tiled_input_part) {
+            m_tiled_input_part->setFrameBuffer (frameBuffer);
+            m_tiled_input_part->readTiles (firstxtile, firstxtile+nxtiles-1,
+                                           firstytile, firstytile+nytiles-1,
+                                           m_miplevel, m_miplevel);
+#endif
+        }
+    } catch (const std::exception &e) {
+        error ("Failed OpenEXR read: %s", e.what());
+        return false;
+    } catch (...) {   // catch-all for edge cases or compiler bugs
+        error ("Failed OpenEXR read: unknown exception");
+        return false;
+    }
+    return true;
+}
+
+
+
+#ifdef USE_OPENEXR_VERSION2
+bool
+pvt::exr_input_parts (ImageInput *in, Imf::InputPart *&scanline,
+                      Imf::TiledInputPart *&tiled)
+{
+    OpenEXRInput *exrin = NULL;
+    if (in && string_view(in->format_name()) == "openexr")
+        exrin = dynamic_cast<OpenEXRInput *>(in);
+    if (! exrin)
+        return false;
+    scanline = exrin->scanline_input_part ();
+    tiled = exrin->tiled_input_part ();
+    return scanline || tiled;
+}
+#endif
+
+
+
+OpenEXRInput::TileReader *
+OpenEXRInput::acquire_tile_reader (int subimage)
+{
+#ifdef USE_OPENEXR_VERSION2
+    // Enough handles to keep every core busy decompressing, but bounded
+    // so that a heavily shared texture doesn't eat file descriptors.
+    const int max_readers = clamp (int(Sysutil::hardware_concurrency()), 1, 8);
+    TileReader *reader = NULL;
+    while (! reader) {
+        {
+            spin_lock lock (m_tile_readers_mutex);
+            // Prefer an idle reader that is already on this subimage
+            for (size_t i = 0, e = m_idle_tile_readers.size(); i < e; ++i) {
+                if (m_idle_tile_readers[i]->subimage == subimage) {
+                    reader = m_idle_tile_readers[i];
+                    m_idle_tile_readers[i] = m_idle_tile_readers.back();
+                    m_idle_tile_readers.pop_back ();
+                    return reader;
+                }
+            }
+            if (m_idle_tile_readers.size()) {
+                reader = m_idle_tile_readers.back();
+                m_idle_tile_readers.pop_back ();
+            } else if (m_ntile_readers < max_readers) {
+                reader = new TileReader;
+                ++m_ntile_readers;
+            }
+        }
+        if (! reader)
+            yield ();
+    }
+
+    // Open outside the lock, this reads the file's headers
+    try {
+        if (! reader->multipart) {
+            if (m_io)
+                reader->stream.reset (new OpenEXRProxyInputStream (m_filename.c_str(), m_io));
+            else
+                reader->stream.reset (new OpenEXRInputStream (m_filename.c_str()));
+            reader->multipart.reset (new Imf::MultiPartInputFile (*reader->stream));
+        }
+        reader->part.reset (new Imf::TiledInputPart (*reader->multipart, subimage));
+        reader->subimage = subimage;
+    } catch (...) {
+        release_tile_reader (reader, false);
+        return NULL;
+    }
+    return reader;
+#else
+    return NULL;
+#endif
+}
+
+
+
+void
+OpenEXRInput::release_tile_reader (TileReader *reader, bool ok)
+{
+    spin_lock lock (m_tile_readers_mutex);
+    if (ok) {
+        m_idle_tile_readers.push_back (reader);
+    } else {
+        // Something went wrong with this handle, don't reuse it
+        delete reader;
+        --m_ntile_readers;
+    }
+}
+
+
+
+bool
+OpenEXRInput::read_tiles_concurrent (int subimage, int miplevel,
+                                     int xbegin, int xend,
+                                     int ybegin, int yend,
+                                     int zbegin, int zend,
+                                     int chbegin, int chend,
+                                     TypeDesc format, void *data)
+{
+#ifdef USE_OPENEXR_VERSION2
+    // N.B. Only immutable per-part state may be used here, never m_spec
+    // or anything else that seek_subimage changes.
+    if (subimage < 0 || subimage >= m_nsubimages)
+        return false;
+    const PartInfo &part (m_parts[subimage]);
+    const ImageSpec &spec (part.spec);
+    if (! part.initialized || spec.deep || ! spec.tile_width ||
+        miplevel < 0 || miplevel >= part.nmiplevels)
+        return false;
+    chend = clamp (chend, chbegin+1, spec.nchannels);
+    int nchans = chend - chbegin;
+    int tw = spec.tile_width, th = spec.tile_height;
+    int x0 = part.top_datawindow.min.x, y0 = part.top_datawindow.min.y;
+    if ((xbegin-x0) % tw || (ybegin-y0) % th ||
+        (xend-xbegin) % tw || (yend-ybegin) % th || (zend-zbegin) != 1)
+        return false;
+    int firstxtile = (xbegin-x0) / tw, nxtiles = (xend-xbegin) / tw;
+    int firstytile = (ybegin-y0) / th, nytiles = (yend-ybegin) / th;
+
+    // Decide what OpenEXR should hand us. If it can do the conversion
+    // itself, it decodes straight into the caller's buffer; otherwise we
+    // take the native data and convert afterwards.
+    TypeDesc nativeformat = spec.channelformats.size() ? TypeDesc::UNKNOWN
+                                                       : spec.format;
+    if (format == nativeformat)
+        format = TypeDesc::UNKNOWN;
+    bool library = (format != TypeDesc::UNKNOWN &&
+                    library_converts (subimage, format, chbegin, chend));
+    bool converting = (format != TypeDesc::UNKNOWN && ! library);
+    if (converting && nativeformat == TypeDesc::UNKNOWN)
+        return false;   // mixed channel types, let the caller handle it
+    size_t pixelbytes = library ? nchans * format.size()
+                                : spec.pixel_bytes (chbegin, chend, true);
+    size_t rowbytes = pixelbytes * (xend-xbegin);
+    std::unique_ptr<char[]> tmp;
+    char *dst = (char *)data;
+    if (converting) {
+        tmp.reset (new char [rowbytes * (yend-ybegin)]);
+        dst = tmp.get();
+    }
+    char *buf = dst - xbegin * pixelbytes - ybegin * rowbytes;
+
+    TileReader *reader = acquire_tile_reader (subimage);
+    if (! reader)
+        return false;
+    bool ok = true;
+    try {
+        Imf::FrameBuffer frameBuffer;
+        size_t chanoffset = 0;
+        for (int c = chbegin;  c < chend;  ++c) {
+            Imf::PixelType pixeltype = part.pixeltype[c];
+            size_t chanbytes = spec.channelformat(c).size();
+            if (library) {
+                pixeltype = (format == TypeDesc::HALF) ? Imf::HALF : Imf::FLOAT;
+                chanbytes = format.size();
+            }
+            frameBuffer.insert (spec.channelnames[c].c_str(),
+                                Imf::Slice (pixeltype, buf + chanoffset,
+                                            pixelbytes, rowbytes));
+            chanoffset += chanbytes;
+        }
+        reader->part->setFrameBuffer (frameBuffer);
+        reader->part->readTiles (firstxtile, firstxtile+nxtiles-1,
+                                 firstytile, firstytile+nytiles-1,
+                                 miplevel, miplevel);
+    } catch (...) {
+        ok = false;
+    }
+    release_tile_reader (reader, ok);
+    if (ok && converting)
+        ok = convert_image (nchans, xend-xbegin, yend-ybegin, 1,
+                            dst, nativeformat, AutoStride, AutoStride, AutoStride,
+                            data, format, AutoStride, AutoStride, AutoStride);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+
+
 bool
 OpenEXRInput::read_native_deep_scanlines (int ybegin, int yend, int z,
                                           int chbegin, int chend,
@@ -1331,4 +1837,56 @@ OpenEXRInput::read_native_deep_tiles (int xbegin, int xend,
 }
 
 
+
+bool
+OpenEXRInput::read_native_deep_sample_counts (int xbegin, int xend,
+                                              int ybegin, int yend,
+                                              int zbegin, int zend,
+                                              unsigned int *counts)
+{
+    if (m_deep_scanline_input_part == NULL && m_deep_tiled_input_part == NULL)
+        return false;
+
+#ifdef USE_OPENEXR_VERSION2
+    try {
+        // Only the count slice goes in the framebuffer, so no samples
+        // are decoded.
+        size_t width = (xend - xbegin);
+        Imf::DeepFrameBuffer frameBuffer;
+        Imf::Slice countslice (Imf::UINT,
+                               (char *)(counts - xbegin - ybegin*width),
+                               sizeof(unsigned int),
+                               sizeof(unsigned int) * width);
+        frameBuffer.insertSampleCountSlice (countslice);
+        if (m_deep_tiled_input_part) {
+            m_deep_tiled_input_part->setFrameBuffer (frameBuffer);
+            int xtiles = round_to_multiple (xend-xbegin, m_spec.tile_width) / m_spec.tile_width;
+            int ytiles = round_to_multiple (yend-ybegin, m_spec.tile_height) / m_spec.tile_height;
+            int firstxtile = (xbegin - m_spec.x) / m_spec.tile_width;
+            int firstytile = (ybegin - m_spec.y) / m_spec.tile_height;
+            m_deep_tiled_input_part->readPixelSampleCounts (
+                    firstxtile, firstxtile+xtiles-1,
+                    firstytile, firstytile+ytiles-1);
+        } else {
+            if (xbegin != m_spec.x || xend != m_spec.x+m_spec.width)
+                return false;   // scanline files count whole scanlines
+            m_deep_scanline_input_part->setFrameBuffer (frameBuffer);
+            m_deep_scanline_input_part->readPixelSampleCounts (ybegin, yend-1);
+        }
+    } catch (const std::exception &e) {
+        error ("Failed OpenEXR read: %s", e.what());
+        return false;
+    } catch (...) {   // catch-all for edge cases or compiler bugs
+        error ("Failed OpenEXR read: unknown exception");
+        return false;
+    }
+
+    return true;
+
+#else
+    return false;
+#endif
+}
+
+
 OIIO_PLUGIN_NAMESPACE_END
@@ -30,6 +30,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
 #include <errno.h>
 #include <fstream>
@@ -131,6 +132,30 @@ private:
 
 
 
+// Output stream that writes through a caller-supplied Filesystem::IOProxy.
+// OpenEXR seeks back to fill in offset tables, so the stream tracks its
+// own position and uses pwrite.
+class OpenEXRProxyOutputStream : public Imf::OStream
+{
+public:
+    OpenEXRProxyOutputStream (const char *filename, Filesystem::IOProxy *io)
+        : Imf::OStream(filename), m_io(io), m_pos(0) { }
+    virtual void write (const char c[], int n) {
+        size_t w = m_io->pwrite (c, size_t(n), m_pos);
+        m_pos += w;
+        if (w != size_t(n))
+            throw Iex::ErrnoExc ("File output failed.");
+    }
+    virtual Imath::Int64 tellp () { return m_pos; }
+    virtual void seekp (Imath::Int64 pos) { m_pos = int64_t(pos); }
+
+private:
+    Filesystem::IOProxy *m_io;
+    int64_t m_pos;
+};
+
+
+
 class OpenEXROutput : public ImageOutput {
 public:
     OpenEXROutput ();
@@ -159,9 +184,10 @@ public:
     virtual bool write_deep_tiles (int xbegin, int xend, int ybegin, int yend,
                                    int zbegin, int zend,
                                    const DeepData &deepdata);
+    virtual bool copy_image (ImageInput *in);
 
 private:
-    OpenEXROutputStream *m_output_stream; ///< Stream for output file
+    Imf::OStream *m_output_stream;        ///< Stream for output file
     Imf::OutputFile *m_output_scanline;   ///< Input for scanline files
     Imf::TiledOutputFile *m_output_tiled; ///< Input for tiled files
 #ifdef USE_OPENEXR_VERSION2
@@ -183,6 +209,14 @@ private:
     int m_nsubimages;                     ///< How many subimages are there?
     int m_miplevel;                       ///< What miplevel we're writing now
     int m_nmiplevels;                     ///< How many mip levels are there?
+    int m_raw_copied_subimage;            ///< Subimage raw-copied, all levels
+    // Small scanline writes are gathered into batches of m_write_chunk
+    // scanlines before handing them to OpenEXR, so that it can compress
+    // many line buffers at once on its threads instead of one at a time.
+    int m_write_chunk;                    ///< Scanlines per batch (0 = off)
+    int m_buffered_ybegin;                ///< First scanline in the batch
+    int m_buffered_lines;                 ///< Scanlines in the batch
+    std::vector<unsigned char> m_linebuffer; ///< The batch, native layout
     std::vector<Imf::PixelType> m_pixeltype; ///< Imf pixel type for each
                                              ///<   channel of current subimage
     std::vector<unsigned char> m_scratch; ///< Scratch space for us to use
@@ -201,6 +235,11 @@ private:
         m_deep_tiled_output_part = NULL;
         m_subimage = -1;
         m_miplevel = -1;
+        m_raw_copied_subimage = -1;
+        m_write_chunk = 0;
+        m_buffered_ybegin = 0;
+        m_buffered_lines = 0;
+        std::vector<unsigned char>().swap (m_linebuffer);
         std::vector<ImageSpec>().swap (m_subimagespecs);  // clear and free
         std::vector<Imf::Header>().swap (m_headers);
     }
@@ -212,6 +251,16 @@ private:
     // Fill in m_pixeltype based on the spec
     void compute_pixeltypes (const ImageSpec &spec);
 
+    // Decide m_write_chunk for the current subimage
+    void setup_write_chunk ();
+
+    // Hand nscanlines of contiguous native data, starting at ybegin, to
+    // OpenEXR.
+    bool write_native_scanlines (int ybegin, int yend, const void *data);
+
+    // Write out any scanlines gathered in m_linebuffer
+    bool flush_scanlines ();
+
     // Add a parameter to the output
     bool put_parameter (const std::string &name, TypeDesc type,
                         const void *data, Imf::Header &header);
@@ -223,6 +272,18 @@ private:
     // Helper: if the channel names are nonsensical, fix them to keep the
     // app from shooting itself in the foot.
     void sanity_check_channelnames ();
+
+    // Open the output stream: through the "oiio:ioproxy" in the spec if
+    // there is one, otherwise the named file.
+    static Imf::OStream *new_output_stream (const std::string &name,
+                                            const ImageSpec &spec) {
+        const ImageIOParameter *p = spec.find_attribute ("oiio:ioproxy",
+                                                         TypeDesc::PTR);
+        if (p)
+            return new OpenEXRProxyOutputStream (name.c_str(),
+                                *(Filesystem::IOProxy **)p->data());
+        return new OpenEXROutputStream (name.c_str());
+    }
 };
 
 
@@ -260,6 +321,10 @@ static std::string format_string ("openexr");
 
 namespace pvt {
 void set_exr_threads ();
+#ifdef USE_OPENEXR_VERSION2
+bool exr_input_parts (ImageInput *in, Imf::InputPart *&scanline,
+                      Imf::TiledInputPart *&tiled);
+#endif
 
 // format-specific metadata prefixes
 static std::vector<std::string> format_prefixes;
@@ -320,6 +385,8 @@ OpenEXROutput::supports (string_view feature) const
         return true;
     if (feature == "iptc")   // Because of arbitrary_metadata
         return true;
+    if (feature == "ioproxy")
+        return true;
 #ifdef USE_OPENEXR_VERSION2
     if (feature == "multiimage")
         return true;  // N.B. But OpenEXR does not support "appendsubimage"
@@ -362,7 +429,7 @@ OpenEXROutput::open (const std::string &name, const ImageSpec &userspec,
             return false;
 
         try {
-            m_output_stream = new OpenEXROutputStream (name.c_str());
+            m_output_stream = new_output_stream (name, m_spec);
             if (m_spec.tile_width) {
                 m_output_tiled = new Imf::TiledOutputFile (*m_output_stream,
                                                            m_headers[m_subimage]);
@@ -386,6 +453,7 @@ OpenEXROutput::open (const std::string &name, const ImageSpec &userspec,
             return false;
         }
 
+        setup_write_chunk ();
         return true;
     }
 
@@ -404,6 +472,8 @@ OpenEXROutput::open (const std::string &name, const ImageSpec &userspec,
             return false;
         }
         // Close the current subimage, open the next one
+        if (! flush_scanlines ())
+            return false;
         try {
             if (m_tiled_output_part) {
                 delete m_tiled_output_part;
@@ -439,6 +509,7 @@ OpenEXROutput::open (const std::string &name, const ImageSpec &userspec,
         m_spec = m_subimagespecs[m_subimage];
         sanity_check_channelnames ();
         compute_pixeltypes(m_spec);
+        setup_write_chunk ();
         return true;
 #else
         // OpenEXR 1.x does not support subimages (multi-part)
@@ -528,14 +599,17 @@ OpenEXROutput::open (const std::string &name, int subimages,
 
     // Create an ImfMultiPartOutputFile
     try {
-        // m_output_stream = new OpenEXROutputStream (name.c_str());
-        // m_output_multipart = new Imf::MultiPartOutputFile (*m_output_stream,
-        //                                          &m_headers[0], subimages);
         // FIXME: Oops, looks like OpenEXR 2.0 currently lacks a
-        // MultiPartOutputFile ctr that takes an OStream, so we can't
-        // do this quite yet.
-        m_output_multipart = new Imf::MultiPartOutputFile (name.c_str(),
+        // MultiPartOutputFile ctr that takes an OStream, so we only use
+        // one when the caller handed us an I/O proxy, which needs it.
+        if (m_spec.find_attribute ("oiio:ioproxy", TypeDesc::PTR)) {
+            m_output_stream = new_output_stream (name, m_spec);
+            m_output_multipart = new Imf::MultiPartOutputFile (*m_output_stream,
                                                  &m_headers[0], subimages);
+        } else {
+            m_output_multipart = new Imf::MultiPartOutputFile (name.c_str(),
+                                                 &m_headers[0], subimages);
+        }
     } catch (const std::exception &e) {
         delete m_output_stream;
         m_output_stream = NULL;
@@ -579,6 +653,7 @@ OpenEXROutput::open (const std::string &name, int subimages,
         return false;
     }
 
+    setup_write_chunk ();
     return true;
 #else
     // No support for OpenEXR 2.x -- one subimage only
@@ -881,6 +956,7 @@ static ExrMeta exr_meta_translation[] = {
     ExrMeta ("version"),
     ExrMeta ("chunkCount"),
     ExrMeta ("maxSamplesPerPixel"),
+    ExrMeta ("openexr:write_chunk"),   // a hint to us, not file metadata
     ExrMeta ()  // empty name signifies end of list
 };
 
@@ -1278,6 +1354,9 @@ OpenEXROutput::sanity_check_channelnames ()
 bool
 OpenEXROutput::close ()
 {
+    if (! flush_scanlines ())
+        return false;
+
     // FIXME: if the use pattern for mipmaps is open(), open(append),
     // ... close(), then we don't have to leave the file open with this
     // trickery.  That's only necessary if it's open(), close(),
@@ -1306,28 +1385,66 @@ bool
 OpenEXROutput::write_scanline (int y, int z, TypeDesc format,
                                const void *data, stride_t xstride)
 {
-    if (! (m_output_scanline || m_scanline_output_part)) {
-        error ("called OpenEXROutput::write_scanline without an open file");
-        return false;
+    return write_scanlines (y, y+1, z, format, data, xstride, AutoStride);
+}
+
+
+
+void
+OpenEXROutput::setup_write_chunk ()
+{
+    m_write_chunk = 0;
+    m_buffered_lines = 0;
+    if (m_spec.tile_width || m_spec.deep)
+        return;
+    int chunk = m_spec.get_int_attribute ("openexr:write_chunk", -1);
+    if (chunk < 0) {
+        // By default, batch enough scanlines to give each of OpenEXR's
+        // threads one line buffer to compress.
+        int exr_threads = 0;
+        OIIO::getattribute ("exr_threads", exr_threads);
+        if (exr_threads == 0)
+            exr_threads = Sysutil::hardware_concurrency();
+        int lines = 1;   // scanlines per compressed block
+        switch (m_headers[m_subimage].compression()) {
+        case Imf::ZIP_COMPRESSION   : lines = 16; break;
+        case Imf::PIZ_COMPRESSION   : lines = 32; break;
+        case Imf::PXR24_COMPRESSION : lines = 16; break;
+#ifdef IMF_B44_COMPRESSION
+        case Imf::B44_COMPRESSION   :
+        case Imf::B44A_COMPRESSION  : lines = 32; break;
+#endif
+#if defined(OPENEXR_VERSION_MAJOR) && \
+    (OPENEXR_VERSION_MAJOR*10000+OPENEXR_VERSION_MINOR*100+OPENEXR_VERSION_PATCH) >= 20200
+        case Imf::DWAA_COMPRESSION  : lines = 32; break;
+        case Imf::DWAB_COMPRESSION  : lines = 256; break;
+#endif
+        default: break;
+        }
+        chunk = exr_threads > 1 ? lines * exr_threads : 0;
     }
+    // Never hold more than 64 MB, or more than the whole image
+    imagesize_t scanlinebytes = std::max (imagesize_t(1), m_spec.scanline_bytes(true));
+    chunk = std::min (chunk, int(std::max (imagesize_t(1), (64*1024*1024) / scanlinebytes)));
+    chunk = std::min (chunk, m_spec.height);
+    m_write_chunk = (chunk > 1) ? chunk : 0;
+}
 
-    bool native = (format == TypeDesc::UNKNOWN);
-    size_t pixel_bytes = m_spec.pixel_bytes (true);  // native
-    if (native && xstride == AutoStride)
-        xstride = (stride_t) pixel_bytes;
-    m_spec.auto_stride (xstride, format, spec().nchannels);
-    data = to_native_scanline (format, data, xstride, m_scratch);
 
+
+bool
+OpenEXROutput::write_native_scanlines (int ybegin, int yend, const void *data)
+{
     // Compute where OpenEXR needs to think the full buffers starts.
     // OpenImageIO requires that 'data' points to where client stored
     // the bytes to be written, but OpenEXR's frameBuffer.insert() wants
     // where the address of the "virtual framebuffer" for the whole
     // image.
-    imagesize_t scanlinebytes = m_spec.scanline_bytes (native);
+    imagesize_t scanlinebytes = m_spec.scanline_bytes(true);
+    size_t pixel_bytes = m_spec.pixel_bytes (true);
     char *buf = (char *)data
               - m_spec.x * pixel_bytes
-              - y * scanlinebytes;
-
+              - ybegin * scanlinebytes;
     try {
         Imf::FrameBuffer frameBuffer;
         size_t chanoffset = 0;
@@ -1341,14 +1458,14 @@ OpenEXROutput::write_scanline (int y, int z, TypeDesc format,
         }
         if (m_output_scanline) {
             m_output_scanline->setFrameBuffer (frameBuffer);
-            m_output_scanline->writePixels (1);
+            m_output_scanline->writePixels (yend-ybegin);
 #ifdef USE_OPENEXR_VERSION2
         } else if (m_scanline_output_part) {
             m_scanline_output_part->setFrameBuffer (frameBuffer);
-            m_scanline_output_part->writePixels (1);
+            m_scanline_output_part->writePixels (yend-ybegin);
 #endif
         } else {
-            error ("Attempt to write scanline to a non-scanline file.");
+            error ("Attempt to write scanlines to a non-scanline file.");
             return false;
         }
     } catch (const std::exception &e) {
@@ -1358,10 +1475,19 @@ OpenEXROutput::write_scanline (int y, int z, TypeDesc format,
         error ("Failed OpenEXR write: unknown exception");
         return false;
     }
+    return true;
+}
 
-    // FIXME -- can we checkpoint the file?
 
-    return true;
+
+bool
+OpenEXROutput::flush_scanlines ()
+{
+    if (! m_buffered_lines)
+        return true;
+    int ybegin = m_buffered_ybegin, nlines = m_buffered_lines;
+    m_buffered_lines = 0;
+    return write_native_scanlines (ybegin, ybegin+nlines, &m_linebuffer[0]);
 }
 
 
@@ -1386,6 +1512,38 @@ OpenEXROutput::write_scanlines (int ybegin, int yend, int z,
     m_spec.auto_stride (xstride, ystride, zstride, format, m_spec.nchannels,
                         m_spec.width, m_spec.height);
 
+    // Scanlines that don't continue the batch in progress go after it
+    if (m_buffered_lines && ybegin != m_buffered_ybegin+m_buffered_lines &&
+          ! flush_scanlines ())
+        return false;
+
+    // Gather writes smaller than the batch size into m_linebuffer, and
+    // hand them to OpenEXR only once we have a full batch (or reach the
+    // end of the image).
+    if (m_write_chunk && (yend-ybegin) < m_write_chunk) {
+        m_linebuffer.resize (m_write_chunk * scanlinebytes);
+        while (ybegin < yend) {
+            if (! m_buffered_lines)
+                m_buffered_ybegin = ybegin;
+            int n = std::min (yend-ybegin, m_write_chunk-m_buffered_lines);
+            const void *d = to_native_rectangle (m_spec.x, m_spec.x+m_spec.width,
+                                                 ybegin, ybegin+n, z, z+1,
+                                                 format, data,
+                                                 xstride, ystride, zstride,
+                                                 m_scratch);
+            memcpy (&m_linebuffer[m_buffered_lines*scanlinebytes], d,
+                    n*scanlinebytes);
+            m_buffered_lines += n;
+            ybegin += n;
+            data = (const char *)data + ystride*n;
+            if ((m_buffered_lines == m_write_chunk ||
+                 m_buffered_ybegin+m_buffered_lines == m_spec.y+m_spec.height) &&
+                  ! flush_scanlines ())
+                return false;
+        }
+        return true;
+    }
+
     const imagesize_t limit = 16*1024*1024;   // Allocate 16 MB, or 1 scanline
     int chunk = std::max (1, int(limit / scanlinebytes));
 
@@ -1397,46 +1555,8 @@ OpenEXROutput::write_scanlines (int ybegin, int yend, int z,
                                              ybegin, y1, z, z+1, format, data,
                                              xstride, ystride, zstride,
                                              m_scratch);
-
-        // Compute where OpenEXR needs to think the full buffers starts.
-        // OpenImageIO requires that 'data' points to where client stored
-        // the bytes to be written, but OpenEXR's frameBuffer.insert() wants
-        // where the address of the "virtual framebuffer" for the whole
-        // image.
-        char *buf = (char *)d
-                  - m_spec.x * pixel_bytes
-                  - ybegin * scanlinebytes;
-        try {
-            Imf::FrameBuffer frameBuffer;
-            size_t chanoffset = 0;
-            for (int c = 0;  c < m_spec.nchannels;  ++c) {
-                size_t chanbytes = m_spec.channelformat(c).size();
-                frameBuffer.insert (m_spec.channelnames[c].c_str(),
-                                    Imf::Slice (m_pixeltype[c],
-                                                buf + chanoffset,
-                                                pixel_bytes, scanlinebytes));
-                chanoffset += chanbytes;
-            }
-            if (m_output_scanline) {
-                m_output_scanline->setFrameBuffer (frameBuffer);
-                m_output_scanline->writePixels (nscanlines);
-#ifdef USE_OPENEXR_VERSION2
-            } else if (m_scanline_output_part) {
-                m_scanline_output_part->setFrameBuffer (frameBuffer);
-                m_scanline_output_part->writePixels (nscanlines);
-#endif
-            } else {
-                error ("Attempt to write scanlines to a non-scanline file.");
-                return false;
-            }
-        } catch (const std::exception &e) {
-            error ("Failed OpenEXR write: %s", e.what());
-            return false;
-        } catch (...) {  // catch-all for edge cases or compiler bugs
-            error ("Failed OpenEXR write: unknown exception");
+        if (! write_native_scanlines (ybegin, y1, d))
             return false;
-        }
-
         data = (const char *)data + ystride*nscanlines;
     }
 
@@ -1573,6 +1693,50 @@ OpenEXROutput::write_tiles (int xbegin, int xend, int ybegin, int yend,
 
 
 
+bool
+OpenEXROutput::copy_image (ImageInput *in)
+{
+#ifdef USE_OPENEXR_VERSION2
+    // A raw copy of a tiled part brings all of its MIP levels along with
+    // level 0, so there is nothing left to do for the others.
+    if (m_raw_copied_subimage == m_subimage && m_miplevel > 0)
+        return true;
+
+    // If the input is also an OpenEXR file, and its current part has the
+    // same layout and compression as ours, copy the compressed chunks
+    // straight across without decoding and re-encoding the pixels.
+    // copyPixels checks the headers before writing anything, and throws
+    // if they aren't compatible, in which case we just do it the long way.
+    Imf::InputPart *inscanline = NULL;
+    Imf::TiledInputPart *intiled = NULL;
+    if (in && m_miplevel == 0 && in->current_miplevel() == 0 &&
+          pvt::exr_input_parts (in, inscanline, intiled)) {
+        try {
+            bool copied = true;
+            if (intiled && m_output_tiled)
+                m_output_tiled->copyPixels (*intiled);
+            else if (intiled && m_tiled_output_part)
+                m_tiled_output_part->copyPixels (*intiled);
+            else if (inscanline && m_output_scanline)
+                m_output_scanline->copyPixels (*inscanline);
+            else if (inscanline && m_scanline_output_part)
+                m_scanline_output_part->copyPixels (*inscanline);
+            else
+                copied = false;
+            if (copied) {
+                m_raw_copied_subimage = m_subimage;
+                return true;
+            }
+        } catch (...) {
+            // Incompatible headers -- fall back to the generic copy
+        }
+    }
+#endif
+    return ImageOutput::copy_image (in);
+}
+
+
+
 bool
 OpenEXROutput::write_deep_scanlines (int ybegin, int yend, int z,
                                      const DeepData &deepdata)
@@ -285,6 +285,33 @@ read_into_buffer (png_structp& sp, png_infop& ip, ImageSpec& spec,
 
 
 
+/// libpng read/write/flush callbacks for files accessed through a
+/// Filesystem::IOProxy, which is the io_ptr.
+inline void
+read_proxy (png_structp sp, png_bytep data, png_size_t length)
+{
+    Filesystem::IOProxy *io = (Filesystem::IOProxy *) png_get_io_ptr (sp);
+    if (io->read (data, length) != length)
+        png_error (sp, "Read error");
+}
+
+inline void
+write_proxy (png_structp sp, png_bytep data, png_size_t length)
+{
+    Filesystem::IOProxy *io = (Filesystem::IOProxy *) png_get_io_ptr (sp);
+    if (io->write (data, length) != length)
+        png_error (sp, "Write error");
+}
+
+inline void
+flush_proxy (png_structp sp)
+{
+    Filesystem::IOProxy *io = (Filesystem::IOProxy *) png_get_io_ptr (sp);
+    io->flush ();
+}
+
+
+
 /// Reads the next scanline from an open PNG file into the indicated buffer.
 /// \return empty string on success, error message on failure.
 ///
@@ -303,6 +330,27 @@ read_next_scanline (png_structp& sp, void *buffer)
 
 
 
+/// Reads the next nrows scanlines, ystride bytes apart, from an open PNG
+/// file into the indicated buffer.
+/// \return empty string on success, error message on failure.
+///
+inline const std::string
+read_next_scanlines (png_structp& sp, void *buffer, int nrows,
+                     stride_t ystride)
+{
+    // Must call this setjmp in every function that does PNG reads
+    if (setjmp (png_jmpbuf (sp)))
+        return "PNG library error";
+
+    for (int r = 0;  r < nrows;  ++r)
+        png_read_row (sp, (png_bytep)buffer + r*ystride, NULL);
+
+    // success
+    return "";
+}
+
+
+
 /// Destroys a PNG read struct.
 ///
 inline void
@@ -42,6 +42,7 @@
 #include "OpenImageIO/thread.h"
 #include "OpenImageIO/strutil.h"
 #include "OpenImageIO/fmath.h"
+#include "OpenImageIO/parallel.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -57,11 +58,17 @@ public:
                        const ImageSpec &config);
     virtual bool close ();
     virtual int current_subimage (void) const { return m_subimage; }
+    virtual int supports (string_view feature) const {
+        return (feature == "ioproxy");
+    }
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
 
 private:
     std::string m_filename;           ///< Stash the filename
     FILE *m_file;                     ///< Open image handle
+    Filesystem::IOProxy *m_io;        ///< Caller's I/O proxy, if any
     png_structp m_png;                ///< PNG read structure pointer
     png_infop m_info;                 ///< PNG image info structure pointer
     int m_bit_depth;                  ///< PNG bit depth
@@ -78,6 +85,7 @@ private:
     void init () {
         m_subimage = -1;
         m_file = NULL;
+        m_io = NULL;
         m_png = NULL;
         m_info = NULL;
         m_buf.clear ();
@@ -89,6 +97,13 @@ private:
     ///
     bool readimg ();
 
+    /// Helper: get scanlines [y0,y1) (relative to the data window) into
+    /// data, streaming rows for non-interlaced files.
+    bool read_rows (int y0, int y1, void *data);
+
+    /// Helper: associate alpha for nrows rows of data, unless asked not to.
+    void associate_alpha (void *data, int nrows);
+
     /// Extract the background color.
     ///
     bool get_background (float *red, float *green, float *blue);
@@ -110,6 +125,9 @@ OIIO_EXPORT const char* png_imageio_library_version () {
 OIIO_EXPORT const char * png_input_extensions[] = {
     "png", NULL
 };
+OIIO_EXPORT const char * png_input_magic[] = {
+    "89504e470d0a1a0a", NULL
+};
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -136,14 +154,20 @@ PNGInput::open (const std::string &name, ImageSpec &newspec)
     m_filename = name;
     m_subimage = 0;
 
-    m_file = Filesystem::fopen (name, "rb");
-    if (! m_file) {
-        error ("Could not open file \"%s\"", name.c_str());
-        return false;
-    }
-
     unsigned char sig[8];
-    if (fread (sig, 1, sizeof(sig), m_file) != sizeof(sig)) {
+    size_t nsig = 0;
+    if (m_io) {
+        m_io->seek (0);
+        nsig = m_io->read (sig, sizeof(sig));
+    } else {
+        m_file = Filesystem::fopen (name, "rb");
+        if (! m_file) {
+            error ("Could not open file \"%s\"", name.c_str());
+            return false;
+        }
+        nsig = fread (sig, 1, sizeof(sig), m_file);
+    }
+    if (nsig != sizeof(sig)) {
         error ("Not a PNG file");
         return false;   // Read failed
     }
@@ -160,7 +184,10 @@ PNGInput::open (const std::string &name, ImageSpec &newspec)
         return false;
     }
 
-    png_init_io (m_png, m_file);
+    if (m_io)
+        png_set_read_fn (m_png, m_io, PNG_pvt::read_proxy);
+    else
+        png_init_io (m_png, m_file);
     png_set_sig_bytes (m_png, 8);  // already read 8 bytes
 
     PNG_pvt::read_info (m_png, m_info, m_bit_depth, m_color_type,
@@ -182,6 +209,10 @@ PNGInput::open (const std::string &name, ImageSpec &newspec,
     // Check 'config' for any special requests
     if (config.get_int_attribute("oiio:UnassociatedAlpha", 0) == 1)
         m_keep_unassociated_alpha = true;
+    const ImageIOParameter *p = config.find_attribute ("oiio:ioproxy",
+                                                       TypeDesc::PTR);
+    if (p)
+        m_io = *(Filesystem::IOProxy **)p->data();
     return open (name, newspec);
 }
 
@@ -255,32 +286,33 @@ associateAlpha (T * data, int size, int channels, int alpha_channel, float gamma
 
 
 bool
-PNGInput::read_native_scanline (int y, int z, void *data)
+PNGInput::read_rows (int y0, int y1, void *data)
 {
-    y -= m_spec.y;
-    if (y < 0 || y >= m_spec.height)   // out of range scanline
-        return false;
-
+    size_t size = spec().scanline_bytes();
     if (m_interlace_type != 0) {
         // Interlaced.  Punt and read the whole image
-        if (m_buf.empty ())
-            readimg ();
-        size_t size = spec().scanline_bytes();
-        memcpy (data, &m_buf[0] + y * size, size);
+        if (m_buf.empty () && ! readimg ())
+            return false;
+        memcpy (data, &m_buf[0] + y0 * size, (y1 - y0) * size);
     } else {
-        // Not an interlaced image -- read just one row
-        if (m_next_scanline > y) {
+        // Not an interlaced image -- stream the rows
+        if (m_next_scanline > y0) {
             // User is trying to read an earlier scanline than the one we're
             // up to.  Easy fix: close the file and re-open.
             ImageSpec dummyspec;
             int subimage = current_subimage();
-            if (! close ()  ||
-                ! open (m_filename, dummyspec)  ||
+            Filesystem::IOProxy *io = m_io;   // close() forgets it
+            bool keep_unassoc = m_keep_unassociated_alpha;
+            if (! close ())
+                return false;
+            m_io = io;
+            m_keep_unassociated_alpha = keep_unassoc;
+            if (! open (m_filename, dummyspec)  ||
                 ! seek_subimage (subimage, dummyspec))
                 return false;    // Somehow, the re-open failed
             assert (m_next_scanline == 0 && current_subimage() == subimage);
         }
-        while (m_next_scanline <= y) {
+        while (m_next_scanline < y0) {
             // Keep reading until we're read the scanline we really need
             // std::cerr << "reading scanline " << m_next_scanline << "\n";
             std::string s = PNG_pvt::read_next_scanline (m_png, data);
@@ -291,22 +323,67 @@ PNGInput::read_native_scanline (int y, int z, void *data)
             }
             ++m_next_scanline;
         }
+        // Then decode the requested rows straight into the caller's
+        // buffer, one at a time, never holding more than that.
+        std::string s = PNG_pvt::read_next_scanlines (m_png, data, y1 - y0,
+                                                      stride_t(size));
+        if (s.length ()) {
+            close ();
+            error ("%s", s.c_str ());
+            return false;
+        }
+        m_next_scanline = y1;
     }
+    return true;
+}
+
 
+
+void
+PNGInput::associate_alpha (void *data, int nrows)
+{
     // PNG specifically dictates unassociated (un-"premultiplied") alpha.
     // Convert to associated unless we were requested not to do so.
-    if (m_spec.alpha_channel != -1 && !m_keep_unassociated_alpha) {
-        float gamma = m_spec.get_float_attribute ("oiio:Gamma", 1.0f);
+    if (m_spec.alpha_channel == -1 || m_keep_unassociated_alpha)
+        return;
+    float gamma = m_spec.get_float_attribute ("oiio:Gamma", 1.0f);
+    size_t size = spec().scanline_bytes();
+    // With gamma this is a pow() per pixel, which costs more than the
+    // decoding, so split big blocks of rows across threads.
+    int64_t minrows = std::max (1, 16384 / std::max (1, m_spec.width));
+    bool split = threads() != 1 && nrows > 2*minrows;
+    parallel_for_chunked (0, nrows, split ? minrows : nrows,
+                          [&](int, int64_t ybegin, int64_t yend) {
+        char *d = (char *)data + ybegin * size;
+        int n = int(yend - ybegin) * m_spec.width;
         if (m_spec.format == TypeDesc::UINT16)
-            associateAlpha ((unsigned short *)data, m_spec.width,
-                            m_spec.nchannels, m_spec.alpha_channel, 
-                            gamma);
+            associateAlpha ((unsigned short *)d, n, m_spec.nchannels,
+                            m_spec.alpha_channel, gamma);
         else
-            associateAlpha ((unsigned char *)data, m_spec.width,
-                            m_spec.nchannels, m_spec.alpha_channel, 
-                            gamma);
-    }
+            associateAlpha ((unsigned char *)d, n, m_spec.nchannels,
+                            m_spec.alpha_channel, gamma);
+    });
+}
+
 
+
+bool
+PNGInput::read_native_scanline (int y, int z, void *data)
+{
+    return read_native_scanlines (y, y+1, z, data);
+}
+
+
+
+bool
+PNGInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    int y0 = ybegin - m_spec.y, y1 = yend - m_spec.y;
+    if (y0 < 0 || y1 > m_spec.height || y1 <= y0)   // out of range
+        return false;
+    if (! read_rows (y0, y1, data))
+        return false;
+    associate_alpha (data, y1 - y0);
     return true;
 }
 
@@ -49,7 +49,7 @@ public:
     virtual ~PNGOutput ();
     virtual const char * format_name (void) const { return "png"; }
     virtual int supports (string_view feature) const {
-        return (feature == "alpha");
+        return (feature == "alpha" || feature == "ioproxy");
     }
     virtual bool open (const std::string &name, const ImageSpec &spec,
                        OpenMode mode=Create);
@@ -63,6 +63,7 @@ public:
 private:
     std::string m_filename;           ///< Stash the filename
     FILE *m_file;                     ///< Open image handle
+    Filesystem::IOProxy *m_io;        ///< Caller's I/O proxy, if any
     png_structp m_png;                ///< PNG read structure pointer
     png_infop m_info;                 ///< PNG image info structure pointer
     unsigned int m_dither;
@@ -76,6 +77,7 @@ private:
     // Initialize private members to pre-opened state
     void init (void) {
         m_file = NULL;
+        m_io = NULL;
         m_png = NULL;
         m_info = NULL;
         m_convert_alpha = true;
@@ -139,10 +141,16 @@ PNGOutput::open (const std::string &name, const ImageSpec &userspec,
     if (m_spec.format != TypeDesc::UINT8 && m_spec.format != TypeDesc::UINT16)
         m_spec.set_format (TypeDesc::UINT8);
 
-    m_file = Filesystem::fopen (name, "wb");
-    if (! m_file) {
-        error ("Could not open file \"%s\"", name.c_str());
-        return false;
+    const ImageIOParameter *p = m_spec.find_attribute ("oiio:ioproxy",
+                                                       TypeDesc::PTR);
+    if (p) {
+        m_io = *(Filesystem::IOProxy **)p->data();
+    } else {
+        m_file = Filesystem::fopen (name, "wb");
+        if (! m_file) {
+            error ("Could not open file \"%s\"", name.c_str());
+            return false;
+        }
     }
 
     std::string s = PNG_pvt::create_write_struct (m_png, m_info,
@@ -153,7 +161,11 @@ PNGOutput::open (const std::string &name, const ImageSpec &userspec,
         return false;
     }
 
-    png_init_io (m_png, m_file);
+    if (m_io)
+        png_set_write_fn (m_png, m_io, PNG_pvt::write_proxy,
+                          PNG_pvt::flush_proxy);
+    else
+        png_init_io (m_png, m_file);
     png_set_compression_level (m_png, std::max (std::min (m_spec.get_int_attribute ("png:compressionLevel", 6/* medium speed vs size tradeoff */), Z_BEST_COMPRESSION), Z_NO_COMPRESSION));
     std::string compression = m_spec.get_string_attribute ("compression");
     if (compression.empty ()) {
@@ -200,7 +212,7 @@ PNGOutput::open (const std::string &name, const ImageSpec &userspec,
 bool
 PNGOutput::close ()
 {
-    if (! m_file) {   // already closed
+    if (! m_file && ! m_io) {   // already closed
         init ();
         return true;
     }
@@ -218,7 +230,8 @@ PNGOutput::close ()
         PNG_pvt::finish_image (m_png);
     PNG_pvt::destroy_write_struct (m_png, m_info);
 
-    fclose (m_file);
+    if (m_file)
+        fclose (m_file);
     m_file = NULL;
 
     init ();      // re-initialize
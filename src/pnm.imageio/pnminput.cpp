@@ -31,6 +31,8 @@
 #include <string>
 #include <fstream>
 #include <cstdlib>
+#include <vector>
+#include <algorithm>
 
 #include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/fmath.h"
@@ -47,6 +49,9 @@ public:
     virtual bool close ();
     virtual int current_subimage (void) const { return 0; }
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
+    virtual bool raw_pixel_layout (int64_t &offset, stride_t &ystride);
 
 private:
     enum PNMType {
@@ -55,13 +60,17 @@ private:
 
     OIIO::ifstream m_file;
     std::streampos m_header_end_pos; // file position after the header
-    std::string m_current_line; ///< Buffer the image pixels
-    const char * m_pos;
     PNMType m_pnm_type;
     unsigned int m_max_val;
     float m_scaling_factor;
-
-    bool read_file_scanline (void * data, int y);
+    std::vector<unsigned char> m_buf; ///< Packed P4 rows, skipped rows
+    std::vector<char> m_text;   ///< ASCII pixel data, NUL terminated
+    size_t m_text_pos;          ///< Parse position within m_text
+    int m_text_row;             ///< Next scanline to be parsed from m_text
+
+    bool read_binary_scanlines (int ybegin, int yend, void *data);
+    bool read_ascii_scanline (int y, void *data);
+    bool load_ascii ();
     bool read_file_header ();
 };
 
@@ -83,65 +92,6 @@ OIIO_PLUGIN_EXPORTS_BEGIN
 OIIO_PLUGIN_EXPORTS_END
 
 
-inline bool
-nextLine (std::istream &file, std::string &current_line, const char * &pos)
-{   
-    if (!file.good())
-        return false;
-    getline (file, current_line);
-    if (file.fail())
-        return false;
-    pos = current_line.c_str();
-    return true;
-}
-
-
-
-inline const char * 
-nextToken (std::istream &file, std::string &current_line, const char * &pos)
-{		
-    while (1) {
-        while (isspace (*pos)) 
-            pos++;
-        if (*pos)
-            break;
-        else 
-            nextLine (file, current_line, pos);
-    }
-    return pos;
-}
-
-
-
-inline const char *
-skipComments (std::istream &file, std::string &current_line,
-              const char * & pos, char comment = '#')
-{		
-    while (1) {
-        nextToken (file, current_line, pos);
-        if (*pos == comment)
-            nextLine (file, current_line, pos);
-        else 
-            break;
-    }
-    return pos;
-}
-
-
-
-inline bool
-nextVal (std::istream & file, std::string &current_line,
-         const char * &pos, int &val, char comment = '#')
-{
-    skipComments (file, current_line, pos, comment);
-    if (!isdigit (*pos))
-        return false;
-    val = strtol (pos,(char**) &pos, 10);
-    return true;
-}
-
-
-
 template <class T> 
 inline void 
 invert (const T *read, T *write, imagesize_t nvals)
@@ -152,21 +102,44 @@ invert (const T *read, T *write, imagesize_t nvals)
 
 
 
-template <class T> 
-inline bool 
-ascii_to_raw (std::istream &file, std::string &current_line, const char * &pos,
-              T *write, imagesize_t nvals, T max)
+/// Parse nvals plain (ASCII) samples starting at pos, rescaling them
+/// from [0,max] to the full range of T.  Comments run from '#' to the end
+/// of the line.  If bits is true, every sample is a single '0' or '1'
+/// character that need not be separated from its neighbors (plain PBM).
+/// The text must be NUL terminated.
+template <class T>
+inline bool
+ascii_to_raw (const char * &pos, T *write, imagesize_t nvals,
+              unsigned int max, bool bits = false)
 {
-    if (max)
-        for (imagesize_t i=0; i < nvals; i++) {
-            int tmp;
-            if (!nextVal (file, current_line, pos, tmp))
-                return false;
-            write[i] = std::min ((int)max, tmp) * std::numeric_limits<T>::max() / max;
+    const unsigned int tmax = std::numeric_limits<T>::max();
+    if (! max) {
+        for (imagesize_t i=0; i < nvals; i++)
+            write[i] = T(tmax);
+        return true;
+    }
+    const char *p = pos;
+    for (imagesize_t i=0; i < nvals; i++) {
+        while (1) {
+            while (*p == ' ' || (*p >= '\t' && *p <= '\r'))
+                ++p;
+            if (*p != '#')
+                break;
+            while (*p && *p != '\n')
+                ++p;
         }
-    else
-        for (imagesize_t i=0; i < nvals; i++) 
-            write[i] = std::numeric_limits<T>::max();
+        if (*p < '0' || *p > '9')
+            return false;
+        unsigned int val = 0;
+        if (bits)
+            val = *p++ - '0';
+        else
+            for ( ; *p >= '0' && *p <= '9'; ++p)
+                if (val <= max)  // saturate rather than overflow
+                    val = val * 10 + (*p - '0');
+        write[i] = T(std::min (max, val) * tmax / max);
+    }
+    pos = p;
     return true;
 }
 
@@ -176,10 +149,12 @@ template <class T>
 inline void 
 raw_to_raw (const T *read, T *write, imagesize_t nvals, T max)
 {
+    // Unsigned math: 16 bit values times 65535 overflow an int.
+    const unsigned int tmax = std::numeric_limits<T>::max();
     if (max)
         for (imagesize_t i=0; i < nvals; i++) {
-            int tmp = read[i];
-            write[i] = std::min ((int)max, tmp) * std::numeric_limits<T>::max() / max;
+            unsigned int tmp = read[i];
+            write[i] = T(std::min ((unsigned int)max, tmp) * tmax / max);
         }
     else
         for (imagesize_t i=0; i < nvals; i++) 
@@ -211,6 +186,8 @@ unpack_floats(const unsigned char * read, float * write, imagesize_t numsamples,
     }
 
     float absfactor = fabs(scaling_factor);
+    if (absfactor == 1.0f && write == read_floats)
+        return;
     for(imagesize_t i = 0; i < numsamples; i++) {
         write[i] = absfactor * read_floats[i];
     }
@@ -243,79 +220,106 @@ read_int (std::istream &in, T &dest, char comment='#')
 
 
 
-bool 
-PNMInput::read_file_scanline (void * data, int y)
+bool
+PNMInput::read_binary_scanlines (int ybegin, int yend, void *data)
 {
+    // Binary rows have a fixed size, so the whole block of scanlines is
+    // read with a single call straight into the caller's buffer and then
+    // converted in place.
     try {
 
-    std::vector<unsigned char> buf;
-    bool good = true;
     if (!m_file)
         return false;
-    int nsamples = m_spec.width * m_spec.nchannels;
-
-    // PFM files are bottom-to-top, so we need to seek to the right spot
-    if (m_pnm_type == PF || m_pnm_type == Pf) {
-        int file_scanline = m_spec.height - 1 - (y-m_spec.y);
-        std::streampos offset = file_scanline * m_spec.scanline_bytes();
-        m_file.seekg (m_header_end_pos + offset, std::ios_base::beg);
+    const int nrows = yend - ybegin;
+    const imagesize_t sl = m_spec.scanline_bytes();
+    const imagesize_t nsamples = imagesize_t(m_spec.width) * m_spec.nchannels;
+    const bool pfm = (m_pnm_type == PF || m_pnm_type == Pf);
+    const imagesize_t filerow = (m_pnm_type == P4) ? (m_spec.width + 7) / 8 : sl;
+
+    // PFM files are bottom-to-top, so the block starts at the file row
+    // holding scanline yend-1.
+    int firstrow = pfm ? m_spec.height - (yend - m_spec.y) : ybegin - m_spec.y;
+    m_file.clear ();
+    m_file.seekg (m_header_end_pos + std::streamoff (firstrow * filerow),
+                  std::ios_base::beg);
+
+    char *dst = (char *) data;
+    if (m_pnm_type == P4) {
+        m_buf.resize (filerow * nrows);
+        m_file.read ((char *)&m_buf[0], filerow * nrows);
+    } else {
+        m_file.read (dst, sl * nrows);
     }
-
-    if ((m_pnm_type >= P4 && m_pnm_type <= P6) || m_pnm_type == PF || m_pnm_type == Pf){
-        int numbytes;
-        if (m_pnm_type == P4)
-            numbytes = (m_spec.width + 7) / 8;
-        else if(m_pnm_type == PF || m_pnm_type == Pf)
-            numbytes = m_spec.nchannels * 4 * m_spec.width;
-        else
-            numbytes = m_spec.scanline_bytes();
-        buf.resize (numbytes);
-        m_file.read ((char*)&buf[0], numbytes);
-        if (!m_file.good())
-            return false;
+    if (!m_file.good()) {
+        error ("Read error: hit end of file in scanlines %d-%d",
+               ybegin, yend-1);
+        return false;
     }
 
     switch (m_pnm_type) {
-        //Ascii 
-        case P1:
-            good &= ascii_to_raw (m_file, m_current_line, m_pos, (unsigned char *) data,
-                                  nsamples, (unsigned char)m_max_val);
-            invert ((unsigned char *)data, (unsigned char *)data, nsamples); 
-            break;
-        case P2:
-        case P3:
-            if (m_max_val > std::numeric_limits<unsigned char>::max())
-                good &= ascii_to_raw (m_file, m_current_line, m_pos, (unsigned short *) data,
-                                      nsamples, (unsigned short)m_max_val);
-            else 
-                good &= ascii_to_raw (m_file, m_current_line, m_pos, (unsigned char *) data,
-                                      nsamples, (unsigned char)m_max_val);
-            break;
-        //Raw
         case P4:
-            unpack (&buf[0], (unsigned char *)data, nsamples);
+            for (int r = 0; r < nrows; ++r)
+                unpack (&m_buf[r * filerow], (unsigned char *)dst + r * sl,
+                        nsamples);
             break;
         case P5:
         case P6:
             if (m_max_val > std::numeric_limits<unsigned char>::max()) {
-                if (littleendian())
-                    swap_endian ((unsigned short *)&buf[0], nsamples);
-                raw_to_raw ((unsigned short *)&buf[0], (unsigned short *) data, 
-                            nsamples, (unsigned short)m_max_val);
-            } else {
-                raw_to_raw ((unsigned char *)&buf[0], (unsigned char *) data, 
-                            nsamples, (unsigned char)m_max_val);
+                unsigned short *p = (unsigned short *)dst;
+                for (int r = 0; r < nrows; ++r, p += nsamples) {
+                    if (littleendian())
+                        swap_endian (p, int(nsamples));
+                    if (m_max_val != 65535)
+                        raw_to_raw (p, p, nsamples, (unsigned short)m_max_val);
+                }
+            } else if (m_max_val != 255) {
+                raw_to_raw ((unsigned char *)dst, (unsigned char *)dst,
+                            nsamples * nrows, (unsigned char)m_max_val);
             }
             break;
-        //Floating point
         case Pf:
         case PF:
-            unpack_floats(&buf[0], (float *)data, nsamples, m_scaling_factor);
+            for (int i = 0, j = nrows - 1; i < j; ++i, --j)
+                std::swap_ranges (dst + i * sl, dst + (i + 1) * sl, dst + j * sl);
+            for (int r = 0; r < nrows; ++r)
+                unpack_floats ((unsigned char *)dst + r * sl,
+                               (float *)(dst + r * sl), nsamples,
+                               m_scaling_factor);
             break;
         default:
             return false;
     }
-    return good;
+    return true;
+
+    }
+    catch (const std::exception &e) {
+        error ("PNM exception: %s", e.what());
+        return false;
+    }
+}
+
+
+
+bool
+PNMInput::load_ascii ()
+{
+    // The plain formats have no fixed row size, so the pixel text is
+    // pulled into memory once and parsed from there.
+    try {
+
+    if (!m_file)
+        return false;
+    m_file.clear ();
+    m_file.seekg (0, std::ios_base::end);
+    std::streamoff size = m_file.tellg () - m_header_end_pos;
+    m_file.seekg (m_header_end_pos, std::ios_base::beg);
+    m_text.resize (size_t(std::max (size, std::streamoff(0))) + 1);
+    m_file.read (&m_text[0], m_text.size() - 1);
+    m_text.resize (size_t(m_file.gcount()) + 1);
+    m_text.back() = 0;
+    m_text_pos = 0;
+    m_text_row = 0;
+    return true;
 
     }
     catch (const std::exception &e) {
@@ -326,6 +330,77 @@ PNMInput::read_file_scanline (void * data, int y)
 
 
 
+bool
+PNMInput::read_ascii_scanline (int y, void *data)
+{
+    if (m_text.empty() && !load_ascii())
+        return false;
+
+    y -= m_spec.y;
+    if (y < m_text_row) {      // Going backwards -- start over
+        m_text_pos = 0;
+        m_text_row = 0;
+    }
+
+    const imagesize_t nsamples = imagesize_t(m_spec.width) * m_spec.nchannels;
+    const bool wide = m_max_val > std::numeric_limits<unsigned char>::max();
+    const char *pos = &m_text[m_text_pos];
+    for ( ; m_text_row <= y; ++m_text_row) {
+        // Rows before y are parsed into scratch space and discarded.
+        void *dst = data;
+        if (m_text_row < y) {
+            m_buf.resize (m_spec.scanline_bytes());
+            dst = &m_buf[0];
+        }
+        bool ok;
+        if (wide)
+            ok = ascii_to_raw (pos, (unsigned short *)dst, nsamples, m_max_val);
+        else
+            ok = ascii_to_raw (pos, (unsigned char *)dst, nsamples, m_max_val,
+                               m_pnm_type == P1);
+        if (!ok) {
+            error ("Read error: bad or missing pixel data in scanline %d",
+                   m_text_row + m_spec.y);
+            return false;
+        }
+        m_text_pos = pos - &m_text[0];
+    }
+
+    if (m_pnm_type == P1)
+        invert ((unsigned char *)data, (unsigned char *)data, nsamples);
+    return true;
+}
+
+
+
+bool
+PNMInput::raw_pixel_layout (int64_t &offset, stride_t &ystride)
+{
+    // Binary files whose samples need neither rescaling nor byte swapping
+    // hold exactly the native pixels right after the header -- top to
+    // bottom for PGM/PPM, bottom to top for PFM.
+    int64_t start = (int64_t) std::streamoff (m_header_end_pos);
+    stride_t sl = (stride_t) m_spec.scanline_bytes();
+    if (m_pnm_type == P5 || m_pnm_type == P6) {
+        if (m_max_val != 255 && !(m_max_val == 65535 && bigendian()))
+            return false;
+        offset = start;
+        ystride = sl;
+        return true;
+    }
+    if (m_pnm_type == PF || m_pnm_type == Pf) {
+        if (fabsf (m_scaling_factor) != 1.0f ||
+            (m_scaling_factor < 0) != littleendian())
+            return false;
+        offset = start + (m_spec.height - 1) * sl;
+        ystride = -sl;
+        return true;
+    }
+    return false;
+}
+
+
+
 bool
 PNMInput::read_file_header ()
 {
@@ -452,8 +527,9 @@ PNMInput::open (const std::string &name, ImageSpec &newspec)
     
     Filesystem::open (m_file, name, std::ios::in|std::ios::binary);
  
-    m_current_line = "";
-    m_pos = m_current_line.c_str();
+    m_text.clear ();
+    m_text_pos = 0;
+    m_text_row = 0;
 
     if (!read_file_header())
         return false;
@@ -468,6 +544,8 @@ bool
 PNMInput::close ()
 {
     m_file.close();
+    m_text.clear ();
+    m_buf.clear ();
     return true;
 }
 
@@ -475,12 +553,28 @@ PNMInput::close ()
 
 bool
 PNMInput::read_native_scanline (int y, int z, void *data)
+{
+    return read_native_scanlines (y, y+1, z, data);
+}
+
+
+
+bool
+PNMInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
 {
     if (z)
         return false;
-    if (!read_file_scanline (data, y))
+    yend = std::min (yend, m_spec.y + m_spec.height);
+    if (ybegin < m_spec.y || ybegin >= yend)
         return false;
-    return true;
+    if (m_pnm_type >= P1 && m_pnm_type <= P3) {
+        char *dst = (char *) data;
+        for (int y = ybegin; y < yend; ++y, dst += m_spec.scanline_bytes())
+            if (!read_ascii_scanline (y, dst))
+                return false;
+        return true;
+    }
+    return read_binary_scanlines (ybegin, yend, data);
 }
 
 OIIO_PLUGIN_NAMESPACE_END
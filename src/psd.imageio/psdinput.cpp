@@ -34,6 +34,8 @@
 #include <map>
 #include <functional>
 
+#include "OpenImageIO/parallel.h"
+
 #include "psd_pvt.h"
 #include "jpeg_memory_src.h"
 
@@ -58,6 +60,8 @@ public:
     virtual int current_subimage () const { return m_subimage; }
     virtual bool seek_subimage (int subimage, int miplevel, ImageSpec &newspec);
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
 
 private:
     enum ColorMode {
@@ -140,6 +144,12 @@ private:
         uint16_t compression;
         std::vector<uint32_t> rle_lengths;
         std::vector<std::streampos> row_pos;
+        //For layer channels, the RLE lengths (and so row_pos) are only
+        //read once the layer is selected; until then this is where the
+        //lengths table starts and how many rows it has.
+        std::streampos rle_pos;
+        uint32_t rle_rows = 0;
+        bool rows_loaded = true;
     };
 
     struct Layer {
@@ -207,6 +217,8 @@ private:
     //psd:RawData config option, indicates that the user wants the raw,
     //unconverted channel data
     bool m_WantRaw;
+    //oiio:headeronly config option, skip decoding the thumbnail
+    bool m_headeronly;
     TypeDesc m_type_desc;
     //This holds all the ChannelInfos for all subimages
     //Example: m_channels[subimg][channel]
@@ -288,6 +300,8 @@ private:
     bool load_layer_channels (Layer &layer);
     bool load_layer_channel (Layer &layer, ChannelInfo &channel_info);
     bool read_rle_lengths (uint32_t height, std::vector<uint32_t> &rle_lengths);
+    //Read the deferred RLE lengths of a layer channel and set up row_pos
+    bool load_channel_rows (ChannelInfo &channel_info);
 
     //Global Mask Info
     bool load_global_mask_info ();
@@ -305,6 +319,12 @@ private:
 
     //Read a row of channel data
     bool read_channel_row (const ChannelInfo &channel_info, uint32_t row, char *data);
+    //Read rows [ybegin,yend) of channel data with one file read, and
+    //decompress them in parallel
+    bool read_channel_rows (const ChannelInfo &channel_info, uint32_t ybegin,
+                            uint32_t yend, char *data);
+    //Convert the row in m_channel_buffers to the output layout
+    bool convert_row (void *data);
 
     //Interleave channels (RRRGGGBBB -> RGBRGBRGB).
     void interleave_row (char *dst);
@@ -523,6 +543,9 @@ OIIO_EXPORT const char* psd_imageio_library_version () { return NULL; }
 OIIO_EXPORT const char * psd_input_extensions[] = {
     "psd", "pdd", "psb", NULL
 };
+OIIO_EXPORT const char * psd_input_magic[] = {
+    "38425053", NULL
+};
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -595,6 +618,7 @@ PSDInput::open (const std::string &name, ImageSpec &newspec,
                 const ImageSpec &config)
 {
     m_WantRaw = config.get_int_attribute ("psd:RawData", 0) != 0;
+    m_headeronly = config.get_int_attribute ("oiio:headeronly", 0) != 0;
 
     if (config.get_int_attribute("oiio:UnassociatedAlpha", 0) == 1)
         m_keep_unassociated_alpha = true;
@@ -622,6 +646,12 @@ PSDInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
     if (subimage < 0 || subimage >= m_subimage_count)
         return false;
 
+    // Layers only learn where their rows are when they're first selected
+    for (ChannelInfo *channel_info : m_channels[subimage])
+        if (channel_info && !channel_info->rows_loaded)
+            if (!load_channel_rows (*channel_info))
+                return false;
+
     m_subimage = subimage;
     newspec = m_spec = m_specs[subimage];
     return true;
@@ -709,6 +739,52 @@ PSDInput::read_native_scanline (int y, int z, void *data)
         if (!read_channel_row (channel_info, y, &buffer[0]))
             return false;
     }
+    return convert_row (data);
+}
+
+
+
+bool
+PSDInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    yend = std::min (yend, m_spec.height);
+    if (ybegin < 0 || ybegin >= yend)
+        return false;
+
+    std::vector<ChannelInfo *> &channels = m_channels[m_subimage];
+    int channel_count = (int)channels.size ();
+    if ((int)m_channel_buffers.size () < channel_count)
+        m_channel_buffers.resize (channel_count);
+
+    // Decode every channel for the whole range, then lay out each row
+    std::vector<std::string> planes (channel_count);
+    for (int c = 0; c < channel_count; ++c) {
+        ChannelInfo &channel_info = *channels[c];
+        planes[c].resize (size_t(channel_info.row_length) * (yend - ybegin));
+        if (!read_channel_rows (channel_info, ybegin, yend, &planes[c][0]))
+            return false;
+        if (m_channel_buffers[c].size () < channel_info.row_length)
+            m_channel_buffers[c].resize (channel_info.row_length);
+    }
+    size_t scanline_bytes = m_spec.scanline_bytes (true);
+    for (int y = ybegin; y < yend; ++y) {
+        for (int c = 0; c < channel_count; ++c) {
+            uint32_t row_length = channels[c]->row_length;
+            std::memcpy (&m_channel_buffers[c][0],
+                         &planes[c][size_t(y - ybegin) * row_length],
+                         row_length);
+        }
+        if (!convert_row ((char *)data + (y - ybegin) * scanline_bytes))
+            return false;
+    }
+    return true;
+}
+
+
+
+bool
+PSDInput::convert_row (void *data)
+{
     char *dst = (char *)data;
     if (m_WantRaw || m_header.color_mode == ColorMode_RGB)
         interleave_row (dst);
@@ -762,6 +838,7 @@ PSDInput::init ()
     m_subimage_count = 0;
     m_specs.clear ();
     m_WantRaw = false;
+    m_headeronly = false;
     m_layers.clear ();
     m_image_data.channel_info.clear ();
     m_image_data.transparency = false;
@@ -1213,6 +1290,14 @@ PSDInput::load_resource_thumbnail (uint32_t length, bool isBGR)
         return false;
     }
 
+    if (m_headeronly) {
+        // The size is in the resource header; leave the JPEG undecoded
+        composite_attribute ("thumbnail_width", (int)width);
+        composite_attribute ("thumbnail_height", (int)height);
+        composite_attribute ("thumbnail_nchannels", 3);
+        return true;
+    }
+
     cinfo.err = jpeg_std_error (&jerr.pub);
     jerr.pub.error_exit = thumbnail_error_exit;
     if (setjmp (jerr.setjmp_buffer)) {
@@ -1480,20 +1565,15 @@ PSDInput::load_layer_channel (Layer &layer, ChannelInfo &channel_info)
             channel_info.data_length = channel_info.row_length * layer.height;
             break;
         case Compression_RLE:
-            // RLE lengths are stored before the channel data
-            if (!read_rle_lengths (layer.height, channel_info.rle_lengths))
-                return false;
-
-            // channel data is located after the RLE lengths
-            channel_info.data_pos = m_file.tellg ();
-            // subtract the RLE lengths read above
-            channel_info.data_length = channel_info.data_length - (channel_info.data_pos - start_pos);
-            if (layer.height) {
-                channel_info.row_pos[0] = channel_info.data_pos;
-                for (uint32_t i = 1; i < layer.height; ++i)
-                    channel_info.row_pos[i] = channel_info.row_pos[i - 1] + (std::streampos)channel_info.rle_lengths[i - 1];
-            }
-            break;
+            // RLE lengths are stored before the channel data. Don't read
+            // them until the layer is actually selected (load_channel_rows),
+            // just skip over the lot.
+            channel_info.rle_pos = channel_info.data_pos;
+            channel_info.rle_rows = layer.height;
+            channel_info.rows_loaded = false;
+            channel_info.row_pos.clear ();
+            m_file.seekg (start_pos + (std::streampos)channel_info.data_length);
+            return check_io ();
         // These two aren't currently supported. They would likely
         // require large changes in the code as they probably don't
         // support random access like the other modes. I doubt these are
@@ -1515,18 +1595,50 @@ PSDInput::load_layer_channel (Layer &layer, ChannelInfo &channel_info)
 bool
 PSDInput::read_rle_lengths (uint32_t height, std::vector<uint32_t> &rle_lengths)
 {
+    // Read the whole table at once rather than a value at a time
     rle_lengths.resize (height);
-    for (uint32_t row = 0; row < height && m_file; ++row) {
-        if (m_header.version == 1)
-            read_bige<uint16_t> (rle_lengths[row]);
-        else
-            read_bige<uint32_t> (rle_lengths[row]);
+    if (!height)
+        return check_io ();
+    if (m_header.version == 1) {
+        std::vector<uint16_t> lengths (height);
+        m_file.read ((char *)&lengths[0], height * sizeof(uint16_t));
+        if (!bigendian ())
+            swap_endian (&lengths[0], height);
+        std::copy (lengths.begin (), lengths.end (), rle_lengths.begin ());
+    } else {
+        m_file.read ((char *)&rle_lengths[0], height * sizeof(uint32_t));
+        if (!bigendian ())
+            swap_endian (&rle_lengths[0], height);
     }
     return check_io ();
 }
 
 
 
+bool
+PSDInput::load_channel_rows (ChannelInfo &channel_info)
+{
+    channel_info.rows_loaded = true;
+    m_file.seekg (channel_info.rle_pos);
+    if (!read_rle_lengths (channel_info.rle_rows, channel_info.rle_lengths))
+        return false;
+
+    // channel data is located after the RLE lengths
+    std::streampos rle_end = m_file.tellg ();
+    // subtract the compression field and the RLE lengths
+    channel_info.data_length -= 2 + (rle_end - channel_info.rle_pos);
+    channel_info.data_pos = rle_end;
+    channel_info.row_pos.resize (channel_info.rle_rows);
+    if (channel_info.rle_rows) {
+        channel_info.row_pos[0] = channel_info.data_pos;
+        for (uint32_t i = 1; i < channel_info.rle_rows; ++i)
+            channel_info.row_pos[i] = channel_info.row_pos[i - 1] + (std::streampos)channel_info.rle_lengths[i - 1];
+    }
+    return true;
+}
+
+
+
 bool
 PSDInput::load_global_mask_info ()
 {
@@ -1783,6 +1895,57 @@ PSDInput::read_channel_row (const ChannelInfo &channel_info, uint32_t row, char
 
 
 
+bool
+PSDInput::read_channel_rows (const ChannelInfo &channel_info, uint32_t ybegin,
+                             uint32_t yend, char *data)
+{
+    if (yend > channel_info.row_pos.size ())
+        return false;
+
+    uint32_t row_length = channel_info.row_length;
+    uint32_t nrows = yend - ybegin;
+    // Rows are stored back to back, so the range is one contiguous read
+    m_file.seekg (channel_info.row_pos[ybegin]);
+    if (channel_info.compression == Compression_Raw) {
+        m_file.read (data, size_t(row_length) * nrows);
+        if (!check_io ())
+            return false;
+    } else {
+        std::vector<size_t> offsets (nrows + 1, 0);
+        for (uint32_t r = 0; r < nrows; ++r)
+            offsets[r+1] = offsets[r] + channel_info.rle_lengths[ybegin + r];
+        std::vector<char> packed (std::max (offsets[nrows], size_t(1)));
+        m_file.read (&packed[0], offsets[nrows]);
+        if (!check_io ())
+            return false;
+        atomic_int bad (0);
+        parallel_for (0, int(nrows), [&](int64_t r) {
+            if (!decompress_packbits (&packed[offsets[r]],
+                                      data + size_t(r) * row_length,
+                                      offsets[r+1] - offsets[r], row_length))
+                bad = 1;
+        });
+        if (bad)
+            return false;
+    }
+
+    if (!bigendian ()) {
+        // 16 and 32 bit rows are exactly width samples, no padding
+        size_t n = size_t(m_spec.width) * nrows;
+        switch (m_header.depth) {
+            case 16:
+                swap_endian ((uint16_t *)data, n);
+                break;
+            case 32:
+                swap_endian ((uint32_t *)data, n);
+                break;
+        }
+    }
+    return true;
+}
+
+
+
 void
 PSDInput::interleave_row (char *dst)
 {
@@ -67,6 +67,21 @@ private:
     bool m_isTiled;
     bool m_hasMipMaps;
     int m_ntilesu;
+    TypeDesc m_format;
+    // Metadata and other per-file attributes, gathered once at open so
+    // that seeking from face to face (which the ImageCache does for every
+    // face when it opens the file) only has to fill in sizes and tiling.
+    ImageSpec m_common;
+    // Tiling of each face's full-res data, filled in lazily.
+    struct FaceTiling {
+        Ptex::Res tileres;
+        bool tiled;
+        bool known;
+        FaceTiling () : tiled(false), known(false) { }
+    };
+    std::vector<FaceTiling> m_facetiling;
+
+    bool setup_common ();
 
     /// Reset everything to initial state
     ///
@@ -76,6 +91,8 @@ private:
         m_ptex = NULL;
         m_subimage = -1;
         m_miplevel = -1;
+        m_common = ImageSpec();
+        m_facetiling.clear ();
     }
 
 };
@@ -96,6 +113,9 @@ OIIO_EXPORT const char* ptex_imageio_library_version () {
 OIIO_EXPORT const char * ptex_input_extensions[] = {
     "ptex", "ptx", NULL
 };
+OIIO_EXPORT const char * ptex_input_magic[] = {
+    "50746578", NULL
+};
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -117,6 +137,9 @@ PtexInput::open (const std::string &name, ImageSpec &newspec)
 
     m_numFaces = m_ptex->numFaces();
     m_hasMipMaps = m_ptex->hasMipMaps();
+    m_facetiling.resize (m_numFaces);
+    if (! setup_common ())
+        return false;
 
     bool ok = seek_subimage (0, 0, newspec);
     newspec = spec ();
@@ -128,8 +151,10 @@ PtexInput::open (const std::string &name, ImageSpec &newspec)
 bool
 PtexInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
 {
-    if (m_subimage == subimage && m_miplevel == miplevel)
+    if (m_subimage == subimage && m_miplevel == miplevel) {
+        newspec = m_spec;
         return true;   // Already fine
+    }
 
     if (subimage < 0 || subimage >= m_numFaces)
         return false;
@@ -144,6 +169,42 @@ PtexInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
     m_mipfaceres = Ptex::Res (std::max(0,m_faceres.ulog2-miplevel),
                               std::max(0,m_faceres.vlog2-miplevel));
 
+    m_spec = ImageSpec (std::max (1, m_faceres.u() >> miplevel),
+                        std::max (1, m_faceres.v() >> miplevel),
+                        m_ptex->numChannels(), m_format);
+    m_spec.alpha_channel = m_common.alpha_channel;
+    m_spec.extra_attribs = m_common.extra_attribs;
+
+    FaceTiling &tiling (m_facetiling[subimage]);
+    if (! tiling.known) {
+        PtexFaceData *facedata = m_ptex->getData (m_subimage, m_faceres);
+        tiling.tiled = facedata->isTiled();
+        if (tiling.tiled)
+            tiling.tileres = facedata->tileRes();
+        tiling.known = true;
+        facedata->release();
+    }
+    m_isTiled = tiling.tiled;
+    if (m_isTiled) {
+        m_tileres = tiling.tileres;
+        m_spec.tile_width = m_tileres.u();
+        m_spec.tile_height = m_tileres.v();
+        m_ntilesu = m_faceres.ntilesu (m_tileres);
+    } else {
+        // Always make it look tiled
+        m_spec.tile_width = m_spec.width;
+        m_spec.tile_height = m_spec.height;
+    }
+
+    newspec = m_spec;
+    return true;
+}
+
+
+
+bool
+PtexInput::setup_common ()
+{
     TypeDesc format = TypeDesc::UNKNOWN;
     switch (m_ptex->dataType()) {
     case Ptex::dt_uint8  : format = TypeDesc::UINT8;   break;
@@ -155,32 +216,17 @@ PtexInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
         return false;
     }
 
-    m_spec = ImageSpec (std::max (1, m_faceres.u() >> miplevel),
-                        std::max (1, m_faceres.v() >> miplevel),
-                        m_ptex->numChannels(), format);
-
-    m_spec.alpha_channel = m_ptex->alphaChannel();
+    m_format = format;
+    m_common = ImageSpec (1, 1, m_ptex->numChannels(), format);
+    m_common.alpha_channel = m_ptex->alphaChannel();
 
     if (m_ptex->meshType() == Ptex::mt_triangle)
-        m_spec.attribute ("ptex:meshType", "triangle");
+        m_common.attribute ("ptex:meshType", "triangle");
     else
-        m_spec.attribute ("ptex:meshType", "quad");
+        m_common.attribute ("ptex:meshType", "quad");
 
     if (m_ptex->hasEdits())
-        m_spec.attribute ("ptex:hasEdits", (int)1);
-
-    PtexFaceData *facedata = m_ptex->getData (m_subimage, m_faceres);
-    m_isTiled = facedata->isTiled();
-    if (m_isTiled) {
-        m_tileres = facedata->tileRes();
-        m_spec.tile_width = m_tileres.u();
-        m_spec.tile_height = m_tileres.v();
-        m_ntilesu = m_faceres.ntilesu (m_tileres);
-    } else {
-        // Always make it look tiled
-        m_spec.tile_width = m_spec.width;
-        m_spec.tile_height = m_spec.height;
-    }
+        m_common.attribute ("ptex:hasEdits", (int)1);
 
     std::string wrapmode;
     if (m_ptex->uBorderMode() == Ptex::m_clamp)
@@ -196,7 +242,7 @@ PtexInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
         wrapmode += "black";
     else // if (m_ptex->uBorderMode() == Ptex::m_periodic)
         wrapmode += "periodic";
-    m_spec.attribute ("wrapmode", wrapmode);
+    m_common.attribute ("wrapmode", wrapmode);
 
 #define GETMETA(pmeta,key,ptype,basetype,typedesc,value)        \
     {                                                           \
@@ -242,13 +288,11 @@ PtexInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
             default:
                 continue;
             }
-            m_spec.attribute (key, typedesc, value);
+            m_common.attribute (key, typedesc, value);
         }
         pmeta->release();
     }
 
-    facedata->release();
-    newspec = m_spec;
     return true;
 }
 
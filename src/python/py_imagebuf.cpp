@@ -297,7 +297,8 @@ ImageBuf_setpixel1 (ImageBuf &buf, int i, tuple p)
 
 
 object
-ImageBuf_get_pixels (const ImageBuf &buf, TypeDesc format, ROI roi=ROI::All())
+ImageBuf_get_pixels (const ImageBuf &buf, TypeDesc format, ROI roi=ROI::All(),
+                     bool planar=false)
 {
     // Allocate our own temp buffer and try to read the image into it.
     // If the read fails, return None.
@@ -310,22 +311,31 @@ ImageBuf_get_pixels (const ImageBuf &buf, TypeDesc format, ROI roi=ROI::All())
     if (! buf.get_pixels (roi, format, &data[0])) {
         return object(handle<>(Py_None));
     }
+    if (planar && roi.nchannels() > 1) {
+        // Hand back one plane per channel rather than interleaved pixels
+        std::unique_ptr<char[]> planes (new char [size]);
+        interleaved_to_planar (roi.nchannels(), roi.width(), roi.height(),
+                               roi.depth(), data.get(), format,
+                               planes.get(), format, AutoStride,
+                               buf.threads());
+        data.swap (planes);
+    }
 
     return C_array_to_Python_array (data.get(), format, size);
 }
 
 BOOST_PYTHON_FUNCTION_OVERLOADS(ImageBuf_get_pixels_overloads,
-                                ImageBuf_get_pixels, 2, 3)
+                                ImageBuf_get_pixels, 2, 4)
 
 object
 ImageBuf_get_pixels_bt (const ImageBuf &buf, TypeDesc::BASETYPE format,
-                        ROI roi=ROI::All())
+                        ROI roi=ROI::All(), bool planar=false)
 {
-    return ImageBuf_get_pixels (buf, TypeDesc(format), roi);
+    return ImageBuf_get_pixels (buf, TypeDesc(format), roi, planar);
 }
 
 BOOST_PYTHON_FUNCTION_OVERLOADS(ImageBuf_get_pixels_bt_overloads,
-                                ImageBuf_get_pixels_bt, 2, 3)
+                                ImageBuf_get_pixels_bt, 2, 4)
 
 
 
@@ -385,6 +395,184 @@ ImageBuf_set_pixels_array (ImageBuf &buf, ROI roi, numeric::array data)
 
 
 
+// Set pixels from any object with the buffer protocol (such as a NumPy
+// array), reading straight from its memory with its own strides.  The
+// array is flat, or shaped (height, width, channels) or (depth, height,
+// width, channels).
+bool
+ImageBuf_set_pixels_buffer (ImageBuf &buf, ROI roi, object data)
+{
+    if (! roi.defined())
+        roi = buf.roi();
+    roi.chend = std::min (roi.chend, buf.nchannels()+1);
+    size_t size = (size_t) roi.npixels() * roi.nchannels();
+    if (size == 0)
+        return true;   // done
+
+    Py_buffer view;
+    if (PyObject_GetBuffer (data.ptr(), &view, PyBUF_RECORDS_RO) != 0)
+        throw_error_already_set ();
+    TypeDesc type = typedesc_from_python_buffer_format (view.format,
+                                                        view.itemsize);
+    stride_t xstride = AutoStride, ystride = AutoStride, zstride = AutoStride;
+    bool ok = (type != TypeDesc::UNKNOWN);
+    if (ok && view.ndim >= 3 && view.ndim <= 4) {
+        int n = view.ndim;
+        ok = (view.shape[n-1] == roi.nchannels()
+              && view.shape[n-2] == roi.width()
+              && view.shape[n-3] == roi.height()
+              && (n == 3 ? roi.depth() == 1 : view.shape[0] == roi.depth())
+              && view.strides[n-1] == view.itemsize);
+        xstride = view.strides[n-2];
+        ystride = view.strides[n-3];
+        if (n == 4)
+            zstride = view.strides[0];
+    } else if (ok) {
+        ok = PyBuffer_IsContiguous (&view, 'C')
+             && size_t(view.len) >= size * type.size();
+    }
+    if (ok)
+        ok = buf.set_pixels (roi, type, view.buf, xstride, ystride, zstride);
+    PyBuffer_Release (&view);
+    return ok;
+}
+
+
+
+// A Python object that exposes an ImageBuf's local pixel memory through
+// the buffer protocol, so that memoryview or numpy.asarray can see (and
+// modify) the pixels in place.  It holds a reference to the Python
+// ImageBuf, but the memory is only valid until the ImageBuf reallocates
+// its pixels (by reset, read, etc.).
+struct PixelBufferObject {
+    PyObject_HEAD
+    PyObject *owner;
+    ImageBuf *buf;
+    Py_ssize_t dims[8];   // shape and strides of the exported buffer
+};
+
+static PyTypeObject PixelBufferType;
+static PyBufferProcs PixelBufferProcs;
+
+
+static int
+PixelBuffer_getbuffer (PyObject *self, Py_buffer *view, int flags)
+{
+    ImageBuf *ib = ((PixelBufferObject *)self)->buf;
+    void *data = ib->localpixels ();
+    if (! data) {
+        PyErr_SetString (PyExc_BufferError,
+                         "ImageBuf pixels are not local and contiguous");
+        view->obj = NULL;
+        return -1;
+    }
+    const ImageSpec &spec (ib->spec());
+    if (PyBuffer_FillInfo (view, self, data, Py_ssize_t(spec.image_bytes()),
+                           0, flags) != 0)
+        return -1;
+    if ((flags & PyBUF_ND) == PyBUF_ND) {
+        // (depth,) height, width, channels.  The shape and strides live
+        // in the object itself, not view->internal, because Python 2's
+        // memoryview shares the view (and internal) between exports.
+        int n = spec.depth > 1 ? 4 : 3;
+        Py_ssize_t *dims = ((PixelBufferObject *)self)->dims;
+        Py_ssize_t itemsize = Py_ssize_t (ib->pixeltype().size());
+        Py_ssize_t shape[4] = { spec.depth, spec.height, spec.width,
+                                spec.nchannels };
+        Py_ssize_t strides[4] = { Py_ssize_t(spec.scanline_bytes())*spec.height,
+                                  Py_ssize_t(spec.scanline_bytes()),
+                                  Py_ssize_t(spec.pixel_bytes()), itemsize };
+        std::copy (shape+4-n, shape+4, dims);
+        std::copy (strides+4-n, strides+4, dims+4);
+        view->ndim = n;
+        view->itemsize = itemsize;
+        view->shape = dims;
+        view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? dims+4 : NULL;
+    }
+    if (flags & PyBUF_FORMAT)
+        view->format = const_cast<char *>(python_buffer_format (ib->pixeltype()));
+    return 0;
+}
+
+
+static void
+PixelBuffer_dealloc (PyObject *self)
+{
+    Py_XDECREF (((PixelBufferObject *)self)->owner);
+    PyObject_Del (self);
+}
+
+
+
+object
+ImageBuf_localpixels (object self)
+{
+    ImageBuf &buf (extract<ImageBuf&>(self)());
+    if (! buf.localpixels())
+        return object();   // None
+    PixelBufferObject *pb = PyObject_New (PixelBufferObject, &PixelBufferType);
+    if (! pb)
+        throw_error_already_set ();
+    Py_INCREF (self.ptr());
+    pb->owner = self.ptr();
+    pb->buf = &buf;
+    return object (handle<> ((PyObject *)pb));
+}
+
+
+
+static void
+declare_pixelbuffer ()
+{
+    PixelBufferProcs.bf_getbuffer = PixelBuffer_getbuffer;
+    PyTypeObject &t (PixelBufferType);
+    t.tp_name = "OpenImageIO.ImageBufPixels";
+    t.tp_basicsize = sizeof(PixelBufferObject);
+    t.tp_dealloc = PixelBuffer_dealloc;
+    t.tp_as_buffer = &PixelBufferProcs;
+    t.tp_flags = Py_TPFLAGS_DEFAULT;
+#if PY_MAJOR_VERSION < 3
+    t.tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+    t.tp_doc = "The local pixels of an ImageBuf, through the buffer protocol";
+    if (PyType_Ready (&t) < 0)
+        throw_error_already_set ();
+}
+
+
+
+// Read the files in the filenames list concurrently, without the GIL,
+// and return a list of new ImageBufs (check each one's has_error).
+// format may be a TypeDesc or a basetype such as oiio.FLOAT.
+list
+read_images_py (object filenames, int nthreads, object format)
+{
+    TypeDesc convert;
+    extract<TypeDesc> td (format);
+    extract<TypeDesc::BASETYPE> bt (format);
+    if (td.check())
+        convert = td();
+    else if (bt.check())
+        convert = TypeDesc (bt());
+    std::vector<std::string> names;
+    for (int i = 0, e = len(filenames); i < e; ++i)
+        names.push_back (extract<std::string>(filenames[i]));
+    std::vector<ImageBuf *> bufs;
+    for (size_t i = 0; i < names.size(); ++i)
+        bufs.push_back (new ImageBuf);
+    {
+        ScopedGILRelease gil;
+        read_images (bufs, names, convert, nthreads);
+    }
+    list result;
+    manage_new_object::apply<ImageBuf *>::type to_python;
+    for (size_t i = 0; i < bufs.size(); ++i)
+        result.append (object (handle<> (to_python (bufs[i]))));
+    return result;
+}
+
+
+
 DeepData&
 ImageBuf_deepdataref (ImageBuf *ib)
 {
@@ -402,6 +590,12 @@ ImageBuf_deep_alloc_dummy ()
 
 void declare_imagebuf()
 {
+    declare_pixelbuffer ();
+
+    def("read_images", &read_images_py,
+        (arg("filenames"), arg("nthreads")=0,
+         arg("format")=TypeDesc(TypeDesc::UNKNOWN)));
+
     enum_<ImageBuf::WrapMode>("WrapMode")
         .value("WrapDefault",  ImageBuf::WrapDefault )
         .value("WrapBlack",    ImageBuf::WrapBlack )
@@ -438,6 +632,10 @@ void declare_imagebuf()
         .def("set_write_format", &ImageBuf_set_write_format)
         .def("set_write_tiles", &ImageBuf::set_write_tiles,
              (arg("width")=0, arg("height")=0, arg("depth")=0))
+        .def("set_local_tiles", &ImageBuf::set_local_tiles,
+             (arg("width"), arg("height"), arg("depth")=1))
+        .def("make_view", &ImageBuf::make_view,
+             (arg("src"), arg("roi")=ROI::All()))
 
         .def("spec", &ImageBuf::spec,
                 return_value_policy<copy_const_reference>())
@@ -513,8 +711,11 @@ void declare_imagebuf()
         .def("setpixel", &ImageBuf_setpixel1)
         .def("get_pixels", &ImageBuf_get_pixels, ImageBuf_get_pixels_overloads())
         .def("get_pixels", &ImageBuf_get_pixels_bt, ImageBuf_get_pixels_bt_overloads())
+        // The buffer version is declared first so that it's tried last
+        .def("set_pixels", &ImageBuf_set_pixels_buffer)
         .def("set_pixels", &ImageBuf_set_pixels_tuple)
         .def("set_pixels", &ImageBuf_set_pixels_array)
+        .def("localpixels", &ImageBuf_localpixels)
 
         .add_property("deep", &ImageBuf::deep)
         .def("deep_samples", &ImageBuf::deep_samples,
@@ -789,6 +789,19 @@ IBA_computePixelHashSHA1 (const ImageBuf &src,
 
 
 
+std::string
+IBA_computePixelHashXX64 (const ImageBuf &src,
+                          const std::string &extrainfo = std::string(),
+                          ROI roi = ROI::All(),
+                          int blocksize = 0, int nthreads=0)
+{
+    ScopedGILRelease gil;
+    return ImageBufAlgo::computePixelHashXX64 (src, extrainfo, roi,
+                                               blocksize, nthreads);
+}
+
+
+
 bool
 IBA_warp (ImageBuf &dst, const ImageBuf &src, tuple values_M,
           const std::string &filtername = "", float filterwidth = 0.0f,
@@ -808,6 +821,21 @@ IBA_warp (ImageBuf &dst, const ImageBuf &src, tuple values_M,
 
 
 
+bool
+IBA_st_warp (ImageBuf &dst, const ImageBuf &src, const ImageBuf &stbuf,
+             const std::string &filtername = "", float filterwidth = 0.0f,
+             int chan_s = 0, int chan_t = 1,
+             bool flip_s = false, bool flip_t = false,
+             ROI roi=ROI::All(), int nthreads=0)
+{
+    ScopedGILRelease gil;
+    return ImageBufAlgo::st_warp (dst, src, stbuf, filtername, filterwidth,
+                                  chan_s, chan_t, flip_s, flip_t,
+                                  roi, nthreads);
+}
+
+
+
 bool
 IBA_rotate (ImageBuf &dst, const ImageBuf &src, float angle,
             const std::string &filtername = "", float filterwidth = 0.0f,
@@ -879,6 +907,17 @@ IBA_convolve (ImageBuf &dst, const ImageBuf &src, const ImageBuf &kernel,
 
 
 
+bool
+IBA_blur (ImageBuf &dst, const ImageBuf &src, float width, float height,
+          const std::string &method, ROI roi, int nthreads)
+{
+    ScopedGILRelease gil;
+    return ImageBufAlgo::blur (dst, src, width, height, method,
+                               roi, nthreads);
+}
+
+
+
 bool
 IBA_unsharp_mask (ImageBuf &dst, const ImageBuf &src,
                   const std::string &kernel, float width,
@@ -1657,6 +1696,11 @@ void declare_imagebufalgo()
               arg("blocksize")=0, arg("nthreads")=0))
         .staticmethod("computePixelHashSHA1")
 
+        .def("computePixelHashXX64", &IBA_computePixelHashXX64,
+             (arg("src"), arg("extrainfo")="", arg("roi")=ROI::All(),
+              arg("blocksize")=0, arg("nthreads")=0))
+        .staticmethod("computePixelHashXX64")
+
         .def("warp", &IBA_warp,
              (arg("dst"), arg("src"), arg("M"),
               arg("filtername")="", arg("filterwidth")=0.0f,
@@ -1664,6 +1708,14 @@ void declare_imagebufalgo()
               arg("roi")=ROI::All(), arg("nthreads")=0))
         .staticmethod("warp")
 
+        .def("st_warp", &IBA_st_warp,
+             (arg("dst"), arg("src"), arg("stbuf"),
+              arg("filtername")="", arg("filterwidth")=0.0f,
+              arg("chan_s")=0, arg("chan_t")=1,
+              arg("flip_s")=false, arg("flip_t")=false,
+              arg("roi")=ROI::All(), arg("nthreads")=0))
+        .staticmethod("st_warp")
+
         .def("rotate", &IBA_rotate,
              (arg("dst"), arg("src"), arg("angle"),
               arg("filtername")="", arg("filterwidth")=0.0f,
@@ -1698,6 +1750,12 @@ void declare_imagebufalgo()
               arg("roi")=ROI::All(), arg("nthreads")=0))
         .staticmethod("convolve")
 
+        .def("blur", &IBA_blur,
+             (arg("dst"), arg("src"), arg("width"), arg("height")=0.0f,
+              arg("method")="gaussian",
+              arg("roi")=ROI::All(), arg("nthreads")=0))
+        .staticmethod("blur")
+
         .def("unsharp_mask", &IBA_unsharp_mask,
              (arg("dst"), arg("src"), arg("kernel")="gaussian",
               arg("width")=3.0f, arg("contrast")=1.0f,
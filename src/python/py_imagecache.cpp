@@ -31,6 +31,7 @@
 #include <memory>
 #include "py_oiio.h"
 #include "OpenImageIO/ustring.h"
+#include "OpenImageIO/parallel.h"
 
 namespace PyOpenImageIO
 {
@@ -78,24 +79,87 @@ object ImageCacheWrap::get_pixels (const std::string &filename_,
                        int ybegin, int yend, int zbegin, int zend,
                        TypeDesc datatype)
 { 
-    ScopedGILRelease gil;
     ustring filename (filename_);
     int chbegin = 0, chend = 0;
-    if (! m_cache->get_image_info (filename, subimage, miplevel,
-                                   ustring("channels"), TypeDesc::INT, &chend))
-        return object(handle<>(Py_None));  // couldn't open file
-
-    size_t size = size_t ((xend-xbegin) * (yend-ybegin) * (zend-zbegin) *
-                          (chend-chbegin) * datatype.size());
-    std::unique_ptr<char[]> data (new char [size]);
-    if (! m_cache->get_pixels (filename, subimage, miplevel, xbegin, xend,
-                               ybegin, yend, zbegin, zend, datatype, &data[0]))
-        return object(handle<>(Py_None));   // get_pixels failed;
+    size_t size = 0;
+    std::unique_ptr<char[]> data;
+    {
+        // Only hold the GIL to make the Python array below
+        ScopedGILRelease gil;
+        // If we can't open the file, data stays empty
+        if (m_cache->get_image_info (filename, subimage, miplevel,
+                                     ustring("channels"), TypeDesc::INT, &chend)) {
+            size = size_t ((xend-xbegin) * (yend-ybegin) * (zend-zbegin) *
+                           (chend-chbegin) * datatype.size());
+            data.reset (new char [size]);
+            if (! m_cache->get_pixels (filename, subimage, miplevel, xbegin, xend,
+                                       ybegin, yend, zbegin, zend, datatype, &data[0]))
+                data.reset ();   // get_pixels failed;
+        }
+    }
+    if (! data)
+        return object(handle<>(Py_None));
 
     return C_array_to_Python_array (data.get(), datatype, size);
 }
 
 
+
+// Read the pixels of each ROI in the rois list (or tuple), in parallel
+// and without the GIL, returning a list with an array of pixels (or
+// None if it failed) for each one.  Channels outside the file's are
+// dropped, so ROI.All reads the whole image.
+list ImageCacheWrap::get_pixels_batch (const std::string &filename_,
+                                       int subimage, int miplevel,
+                                       object rois, TypeDesc datatype)
+{
+    ustring filename (filename_);
+    std::vector<ROI> roilist;
+    for (int i = 0, e = len(rois); i < e; ++i)
+        roilist.push_back (extract<ROI>(rois[i]));
+    size_t n = roilist.size();
+    std::vector<std::unique_ptr<char[]> > data (n);
+    std::vector<size_t> sizes (n, 0);
+    {
+        ScopedGILRelease gil;
+        Perthread *thread_info = m_cache->get_perthread_info ();
+        ImageHandle *file = m_cache->get_image_handle (filename, thread_info);
+        ImageSpec spec;
+        if (file && m_cache->get_imagespec (filename, spec, subimage, miplevel)) {
+            parallel_for (0, int64_t(n), [&](int64_t i) {
+                ROI roi = roilist[i];
+                if (! roi.defined())
+                    roi = get_roi (spec);
+                roi.chend = std::min (roi.chend, spec.nchannels);
+                if (roi.npixels() <= 0 || roi.nchannels() <= 0)
+                    return;
+                size_t size = size_t(roi.npixels()) * roi.nchannels()
+                            * datatype.size();
+                std::unique_ptr<char[]> d (new char [size]);
+                Perthread *pt = m_cache->get_perthread_info ();
+                if (m_cache->get_pixels (file, pt, subimage, miplevel,
+                                         roi.xbegin, roi.xend, roi.ybegin,
+                                         roi.yend, roi.zbegin, roi.zend,
+                                         roi.chbegin, roi.chend, datatype,
+                                         d.get())) {
+                    data[i].swap (d);
+                    sizes[i] = size;
+                }
+            });
+        }
+    }
+    list result;
+    for (size_t i = 0; i < n; ++i) {
+        if (data[i])
+            result.append (C_array_to_Python_array (data[i].get(), datatype,
+                                                    sizes[i]));
+        else
+            result.append (object());
+    }
+    return result;
+}
+
+
 //Not sure how to expose this to Python. 
 /*
 Tile *get_tile (ImageCache &ic, ustring filename, int subimage,
@@ -121,6 +185,12 @@ std::string ImageCacheWrap::getstats (int level=1) const
     return m_cache->getstats(level);
 }
 
+std::string ImageCacheWrap::getstats_json (int level=1) const
+{
+    ScopedGILRelease gil;
+    return m_cache->getstats_json(level);
+}
+
 void ImageCacheWrap::invalidate (ustring filename)
 {
     ScopedGILRelease gil;
@@ -205,6 +275,7 @@ void declare_imagecache()
         // .def("get_imagespec", &ImageCacheWrap::get_imagespec,
         //      (arg("subimage")=0)),
         .def("get_pixels", &ImageCacheWrap::get_pixels)
+        .def("get_pixels_batch", &ImageCacheWrap::get_pixels_batch)
 //      .def("get_tile", &ImageCacheWrap::get_tile)
 //      .def("release_tile", &ImageCacheWrap::release_tile)
 //      .def("tile_pixels", &ImageCacheWrap::tile_pixels)
@@ -212,6 +283,7 @@ void declare_imagecache()
 //added _ to the method names for consistency
         .def("geterror",       &ImageCacheWrap::geterror)
         .def("getstats",       &ImageCacheWrap::getstats)
+        .def("getstats_json",  &ImageCacheWrap::getstats_json)
         .def("invalidate",     &ImageCacheWrap::invalidate)
         .def("invalidate_all", &ImageCacheWrap::invalidate_all)
     ;
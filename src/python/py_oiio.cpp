@@ -29,6 +29,7 @@
 */
 
 #include "py_oiio.h"
+#include "OpenImageIO/platform.h"
 
 namespace PyOpenImageIO
 {
@@ -79,6 +80,54 @@ typedesc_from_python_array_code (char code)
 
 
 
+const char *
+python_buffer_format (TypeDesc format)
+{
+    // Unlike array, the buffer protocol can describe half directly
+    if (format.basetype == TypeDesc::HALF)
+        return "e";
+    return python_array_code (format);
+}
+
+
+
+TypeDesc
+typedesc_from_python_buffer_format (const char *format, size_t itemsize)
+{
+    if (! format)
+        format = "B";   // no format means unsigned bytes
+    if (*format == '@' || *format == '='
+          || (*format == '<' && littleendian())
+          || ((*format == '>' || *format == '!') && bigendian()))
+        ++format;       // native (or matching) byte order
+    if (! format[0] || format[1])
+        return TypeDesc::UNKNOWN;  // byte-swapped, or not a simple scalar
+    TypeDesc t;
+    switch (*format) {
+    case 'e' : t = TypeDesc::HALF; break;
+    case 'c' :
+    case 'b' : t = TypeDesc::INT8; break;
+    case 'B' : t = TypeDesc::UINT8; break;
+    case 'f' : t = TypeDesc::FLOAT; break;
+    case 'd' : t = TypeDesc::DOUBLE; break;
+    case 'h' : case 'i' : case 'l' : case 'q' :
+        // The size of the C integer types varies, so go by the item size
+        t = itemsize == 2 ? TypeDesc::INT16 : itemsize == 4 ? TypeDesc::INT32
+          : itemsize == 8 ? TypeDesc::INT64 : TypeDesc::UNKNOWN;
+        break;
+    case 'H' : case 'I' : case 'L' : case 'Q' :
+        t = itemsize == 2 ? TypeDesc::UINT16 : itemsize == 4 ? TypeDesc::UINT32
+          : itemsize == 8 ? TypeDesc::UINT64 : TypeDesc::UNKNOWN;
+        break;
+    default : t = TypeDesc::UNKNOWN;
+    }
+    if (t.size() != itemsize)
+        return TypeDesc::UNKNOWN;
+    return t;
+}
+
+
+
 object
 C_array_to_Python_array (const char *data, TypeDesc type, size_t size)
 {
@@ -105,6 +154,57 @@ C_array_to_Python_array (const char *data, TypeDesc type, size_t size)
 
 
 
+FloatBuffer::FloatBuffer (const object &obj)
+    : m_have_view(false), m_valid(true), m_data(NULL), m_size(0)
+{
+    if (obj.ptr() == Py_None)
+        return;
+    if (PyObject_CheckBuffer (obj.ptr())) {
+        if (PyObject_GetBuffer (obj.ptr(), &m_view,
+                                PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) == 0) {
+            m_have_view = true;
+            if (typedesc_from_python_buffer_format (m_view.format,
+                                        m_view.itemsize) == TypeDesc::FLOAT) {
+                m_data = (const float *) m_view.buf;
+                m_size = size_t(m_view.len) / sizeof(float);
+                return;
+            }
+        } else {
+            PyErr_Clear ();
+        }
+    } else if (PyObject_HasAttrString (obj.ptr(), "typecode")) {
+        // Python 2's array.array only has the old buffer interface
+        extract<numeric::array> arr (obj);
+        if (arr.check()) {
+            numeric::array a (arr());
+            TypeDesc type;
+            size_t n = 0;
+            const void *addr = python_array_address (a, type, n);
+            if (addr && type == TypeDesc::FLOAT) {
+                m_data = (const float *) addr;
+                m_size = n;
+                return;
+            }
+        }
+    } else if (extract<const tuple&>(obj).check()) {
+        py_to_stdvector (m_copy, obj);
+        m_data = m_copy.size() ? &m_copy[0] : NULL;
+        m_size = m_copy.size();
+        return;
+    }
+    m_valid = false;
+}
+
+
+
+FloatBuffer::~FloatBuffer ()
+{
+    if (m_have_view)
+        PyBuffer_Release (&m_view);
+}
+
+
+
 struct ustring_to_python_str {
     static PyObject* convert(ustring const& s) {
         return boost::python::incref(boost::python::object(s.string()).ptr());
@@ -369,6 +469,7 @@ OIIO_DECLARE_PYMODULE(OIIO_PYMODULE_NAME) {
     declare_imageoutput();
     declare_imagebuf();
     declare_imagecache();
+    declare_texturesystem();
 
     declare_imagebufalgo();
     
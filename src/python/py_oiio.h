@@ -38,6 +38,7 @@
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/typedesc.h"
 #include "OpenImageIO/imagecache.h"
+#include "OpenImageIO/texture.h"
 #include "OpenImageIO/imagebuf.h"
 #include "OpenImageIO/deepdata.h"
 
@@ -60,6 +61,7 @@ void declare_typedesc();
 void declare_roi();
 void declare_deepdata();
 void declare_imagecache();
+void declare_texturesystem();
 void declare_imagebuf();
 void declare_imagebufalgo();
 void declare_paramvalue();
@@ -70,6 +72,13 @@ object C_array_to_Python_array (const char *data, TypeDesc type, size_t size);
 const char * python_array_code (TypeDesc format);
 TypeDesc typedesc_from_python_array_code (char code);
 
+// Buffer protocol (PEP 3118) format string for a TypeDesc, and the
+// TypeDesc for a buffer's format string and item size (UNKNOWN if it's
+// not a type we can handle, or not in native byte order).
+const char * python_buffer_format (TypeDesc format);
+TypeDesc typedesc_from_python_buffer_format (const char *format,
+                                             size_t itemsize);
+
 
 // Given python array 'data', figure out its element type and number of
 // elements, and return the memory address of its contents.  Return NULL as
@@ -79,6 +88,32 @@ const void * python_array_address (numeric::array &data, TypeDesc &elementtype,
 
 
 
+// Read-only access to the contents of a Python object as contiguous
+// floats, for the batch interfaces: anything that exports a buffer of
+// float32 values (a NumPy array, or array.array('f')) is used in place,
+// and a tuple of numbers is copied.  None gives an empty buffer.  Must
+// be constructed and destroyed with the GIL held, but data may be read
+// while it is released.
+class FloatBuffer {
+public:
+    FloatBuffer (const object &obj);
+    ~FloatBuffer ();
+    const float *data () const { return m_data; }
+    size_t size () const { return m_size; }
+    // Was obj something we could read as floats?
+    bool valid () const { return m_valid; }
+    // Value i, or 0 if there are too few (so missing derivatives are 0).
+    float operator[] (size_t i) const { return i < m_size ? m_data[i] : 0.0f; }
+private:
+    Py_buffer m_view;
+    bool m_have_view, m_valid;
+    const float *m_data;
+    size_t m_size;
+    std::vector<float> m_copy;
+};
+
+
+
 // Suck up one or more presumed T values into a vector<T>
 template<typename T>
 void py_to_stdvector (std::vector<T> &vals, const object &obj)
@@ -380,6 +415,9 @@ public:
                        int subimage, int miplevel, int xbegin, int xend,
                        int ybegin, int yend, int zbegin, int zend,
                        TypeDesc datatype);
+    list get_pixels_batch (const std::string &filename,
+                           int subimage, int miplevel, object rois,
+                           TypeDesc datatype);
 
     //First needs to be exposed to python in imagecache.cpp
     /*
@@ -397,12 +435,35 @@ public:
 
     std::string geterror () const;
     std::string getstats (int) const;
+    std::string getstats_json (int) const;
     void invalidate (ustring);
     void invalidate_all (bool);
 };
 
 
 
+class TextureSystemWrap {
+private:
+    TextureSystem *m_texsys;
+public:
+    static TextureSystemWrap *create (bool);
+    static void destroy (TextureSystemWrap*);
+    void attribute_int    (const std::string&, int );
+    void attribute_float  (const std::string&, float);
+    void attribute_string (const std::string&, const std::string&);
+    std::string resolve_filename (const std::string& filename);
+    object texture_batch (const std::string &filename, TextureOpt &opt,
+                          object s, object t, object dsdx, object dtdx,
+                          object dsdy, object dtdy, int nchannels);
+    std::string geterror () const;
+    std::string getstats (int, bool) const;
+    std::string getstats_json (int, bool) const;
+    void invalidate (const std::string&);
+    void invalidate_all (bool);
+};
+
+
+
 } // namespace PyOpenImageIO
 
 #endif // PYOPENIMAGEIO_PY_OIIO_H
@@ -0,0 +1,261 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+#include "py_oiio.h"
+#include "OpenImageIO/parallel.h"
+
+namespace PyOpenImageIO
+{
+using namespace boost::python;
+
+
+
+TextureSystemWrap*
+TextureSystemWrap::create (bool shared=true)
+{
+    TextureSystemWrap *tsw = new TextureSystemWrap;
+    tsw->m_texsys = TextureSystem::create (shared);
+    return tsw;
+}
+
+
+void
+TextureSystemWrap::destroy (TextureSystemWrap *x)
+{
+    TextureSystem::destroy (x->m_texsys);
+}
+
+
+
+void
+TextureSystemWrap::attribute_int (const std::string &name, int val)
+{
+    m_texsys->attribute (name, val);
+}
+
+
+void
+TextureSystemWrap::attribute_float (const std::string &name, float val)
+{
+    m_texsys->attribute (name, val);
+}
+
+
+void
+TextureSystemWrap::attribute_string (const std::string &name,
+                                     const std::string &val)
+{
+    m_texsys->attribute (name, val);
+}
+
+
+
+std::string
+TextureSystemWrap::resolve_filename (const std::string &val)
+{
+    ScopedGILRelease gil;
+    return m_texsys->resolve_filename (val);
+}
+
+
+
+// Filtered lookups of many points at once: s and t (and each derivative,
+// which may be None for zero) are float arrays of the same length N.  The
+// lookups run in parallel without the GIL, and the result is an array of
+// N*nchannels floats, or None if the texture couldn't be found.
+object
+TextureSystemWrap::texture_batch (const std::string &filename_,
+                                  TextureOpt &opt, object s, object t,
+                                  object dsdx, object dtdx,
+                                  object dsdy, object dtdy, int nchannels)
+{
+    ustring filename (filename_);
+    FloatBuffer sbuf (s), tbuf (t);
+    FloatBuffer dsdxbuf (dsdx), dtdxbuf (dtdx), dsdybuf (dsdy), dtdybuf (dtdy);
+    size_t n = sbuf.size();
+    const FloatBuffer *derivs[] = { &dsdxbuf, &dtdxbuf, &dsdybuf, &dtdybuf };
+    bool ok = sbuf.valid() && tbuf.valid() && tbuf.size() == n
+              && nchannels > 0;
+    for (int i = 0; i < 4; ++i)
+        ok &= derivs[i]->valid()
+              && (derivs[i]->size() == n || derivs[i]->size() == 0);
+    if (! ok) {
+        PyErr_SetString (PyExc_ValueError,
+                         "texture_batch: s, t and derivatives must be float "
+                         "arrays of the same length (derivatives may be None)");
+        throw_error_already_set ();
+    }
+
+    std::unique_ptr<float[]> result (new float [n*nchannels]);
+    bool found = true;
+    {
+        ScopedGILRelease gil;
+        TextureSystem::Perthread *thread_info = m_texsys->get_perthread_info ();
+        TextureSystem::TextureHandle *handle =
+            m_texsys->get_texture_handle (filename, thread_info);
+        found = handle && m_texsys->good (handle);
+        if (found) {
+            parallel_for_chunked (0, int64_t(n), 0,
+                                  [&](int64_t begin, int64_t end) {
+                // Each chunk gets its own option copy and per-thread info
+                TextureOpt myopt (opt);
+                TextureSystem::Perthread *pt = m_texsys->get_perthread_info ();
+                for (int64_t i = begin; i < end; ++i)
+                    m_texsys->texture (handle, pt, myopt, sbuf[i], tbuf[i],
+                                       dsdxbuf[i], dtdxbuf[i],
+                                       dsdybuf[i], dtdybuf[i],
+                                       nchannels, &result[i*nchannels]);
+            });
+        }
+    }
+    if (! found)
+        return object();   // None
+    return C_array_to_Python_array ((const char *)result.get(),
+                                    TypeDesc::FLOAT,
+                                    n * nchannels * sizeof(float));
+}
+
+
+
+std::string
+TextureSystemWrap::geterror () const
+{
+    return m_texsys->geterror ();
+}
+
+
+std::string
+TextureSystemWrap::getstats (int level=1, bool icstats=true) const
+{
+    ScopedGILRelease gil;
+    return m_texsys->getstats (level, icstats);
+}
+
+
+std::string
+TextureSystemWrap::getstats_json (int level=1, bool icstats=true) const
+{
+    ScopedGILRelease gil;
+    return m_texsys->getstats_json (level, icstats);
+}
+
+
+void
+TextureSystemWrap::invalidate (const std::string &filename)
+{
+    ScopedGILRelease gil;
+    m_texsys->invalidate (ustring(filename));
+}
+
+
+void
+TextureSystemWrap::invalidate_all (bool force=false)
+{
+    ScopedGILRelease gil;
+    m_texsys->invalidate_all (force);
+}
+
+
+
+void declare_texturesystem()
+{
+    {
+        scope texopt = class_<TextureOpt>("TextureOpt")
+            .def_readwrite("firstchannel",  &TextureOpt::firstchannel)
+            .def_readwrite("subimage",      &TextureOpt::subimage)
+            .def_readwrite("swrap",         &TextureOpt::swrap)
+            .def_readwrite("twrap",         &TextureOpt::twrap)
+            .def_readwrite("mipmode",       &TextureOpt::mipmode)
+            .def_readwrite("interpmode",    &TextureOpt::interpmode)
+            .def_readwrite("anisotropic",   &TextureOpt::anisotropic)
+            .def_readwrite("conservative_filter", &TextureOpt::conservative_filter)
+            .def_readwrite("sblur",         &TextureOpt::sblur)
+            .def_readwrite("tblur",         &TextureOpt::tblur)
+            .def_readwrite("swidth",        &TextureOpt::swidth)
+            .def_readwrite("twidth",        &TextureOpt::twidth)
+            .def_readwrite("fill",          &TextureOpt::fill)
+            .def_readwrite("time",          &TextureOpt::time)
+        ;
+
+        enum_<TextureOpt::Wrap>("Wrap")
+            .value("WrapDefault",  TextureOpt::WrapDefault)
+            .value("WrapBlack",    TextureOpt::WrapBlack)
+            .value("WrapClamp",    TextureOpt::WrapClamp)
+            .value("WrapPeriodic", TextureOpt::WrapPeriodic)
+            .value("WrapMirror",   TextureOpt::WrapMirror)
+            .value("WrapPeriodicPow2", TextureOpt::WrapPeriodicPow2)
+            .value("WrapPeriodicSharedBorder", TextureOpt::WrapPeriodicSharedBorder)
+            .export_values();
+
+        enum_<TextureOpt::MipMode>("MipMode")
+            .value("MipModeDefault",   TextureOpt::MipModeDefault)
+            .value("MipModeNoMIP",     TextureOpt::MipModeNoMIP)
+            .value("MipModeOneLevel",  TextureOpt::MipModeOneLevel)
+            .value("MipModeTrilinear", TextureOpt::MipModeTrilinear)
+            .value("MipModeAniso",     TextureOpt::MipModeAniso)
+            .value("MipModeEWA",       TextureOpt::MipModeEWA)
+            .export_values();
+
+        enum_<TextureOpt::InterpMode>("InterpMode")
+            .value("InterpClosest",      TextureOpt::InterpClosest)
+            .value("InterpBilinear",     TextureOpt::InterpBilinear)
+            .value("InterpBicubic",      TextureOpt::InterpBicubic)
+            .value("InterpSmartBicubic", TextureOpt::InterpSmartBicubic)
+            .export_values();
+    }
+
+    class_<TextureSystemWrap, boost::noncopyable>("TextureSystem", no_init)
+        .def("create", &TextureSystemWrap::create,
+                 (arg("shared")),
+                 return_value_policy<manage_new_object>())
+        .staticmethod("create")
+        .def("destroy", &TextureSystemWrap::destroy)
+        .staticmethod("destroy")
+        .def("attribute", &TextureSystemWrap::attribute_float)
+        .def("attribute", &TextureSystemWrap::attribute_int)
+        .def("attribute", &TextureSystemWrap::attribute_string)
+        .def("resolve_filename", &TextureSystemWrap::resolve_filename)
+        .def("texture_batch",  &TextureSystemWrap::texture_batch,
+             (arg("filename"), arg("opt"), arg("s"), arg("t"),
+              arg("dsdx")=object(), arg("dtdx")=object(),
+              arg("dsdy")=object(), arg("dtdy")=object(),
+              arg("nchannels")=3))
+        .def("geterror",       &TextureSystemWrap::geterror)
+        .def("getstats",       &TextureSystemWrap::getstats,
+             (arg("level")=1, arg("icstats")=true))
+        .def("getstats_json",  &TextureSystemWrap::getstats_json,
+             (arg("level")=1, arg("icstats")=true))
+        .def("invalidate",     &TextureSystemWrap::invalidate)
+        .def("invalidate_all", &TextureSystemWrap::invalidate_all,
+             (arg("force")=false))
+    ;
+}
+
+} // namespace PyOpenImageIO
@@ -30,6 +30,7 @@
 
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/fmath.h"
+#include "OpenImageIO/filesystem.h"
 #include <iostream>
 #include <time.h>       /* time_t, struct tm, gmtime */
 #include <libraw/libraw.h>
@@ -44,7 +45,8 @@ OIIO_PLUGIN_NAMESPACE_BEGIN
 
 class RawInput : public ImageInput {
 public:
-    RawInput () : m_process(true), m_image(NULL) {}
+    RawInput () : m_process(true), m_image(NULL), m_subimage(0),
+                  m_has_thumbnail(false), m_unpacked(false) {}
     virtual ~RawInput() { close(); }
     virtual const char * format_name (void) const { return "raw"; }
     virtual int supports (string_view feature) const {
@@ -55,15 +57,28 @@ public:
     virtual bool open (const std::string &name, ImageSpec &newspec,
                        const ImageSpec &config);
     virtual bool close();
+    virtual int current_subimage (void) const { return m_subimage; }
+    virtual bool seek_subimage (int subimage, int miplevel, ImageSpec &newspec);
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
 
 private:
     bool process();
     bool m_process;
     LibRaw m_processor;
     libraw_processed_image_t *m_image;
+    int m_subimage;
+    ImageSpec m_raw_spec;             // spec of the raw image (subimage 0)
+    // Embedded preview, exposed as subimage 1 if "raw:thumbnail" was
+    // requested and the file has one.
+    bool m_has_thumbnail;
+    ImageSpec m_thumb_spec;
+    std::vector<unsigned char> m_thumb_pixels;
+    bool m_unpacked;                  // false if opened "oiio:headeronly"
 
     void read_tiff_metadata (const std::string &filename);
+    bool load_thumbnail ();
 };
 
 
@@ -107,15 +122,27 @@ RawInput::open (const std::string &name, ImageSpec &newspec,
 {
     int ret;
 
+    // Decode at half resolution (unless config "raw:HalfSize" == 0). This
+    // skips demosaicing altogether by treating each 2x2 Bayer block as
+    // one pixel, so it must be set before LibRaw identifies the file.
+    m_processor.imgdata.params.half_size =
+        config.get_int_attribute("raw:HalfSize", 0) != 0;
+
     // open the image
     if ( (ret = m_processor.open_file(name.c_str()) ) != LIBRAW_SUCCESS) {
         error ("Could not open file \"%s\", %s", name.c_str(), libraw_strerror(ret));
         return false;
     }
 
-    if ( (ret = m_processor.unpack() ) != LIBRAW_SUCCESS) {
-        error ("Could not unpack \"%s\", %s",name.c_str(), libraw_strerror(ret));
-        return false;
+    // Unpacking reads all of the sensor data, which a header-only open
+    // can do without.
+    m_unpacked = false;
+    if (! config.get_int_attribute ("oiio:headeronly", 0)) {
+        if ( (ret = m_processor.unpack() ) != LIBRAW_SUCCESS) {
+            error ("Could not unpack \"%s\", %s",name.c_str(), libraw_strerror(ret));
+            return false;
+        }
+        m_unpacked = true;
     }
 
     // Forcing the Libraw to adjust sizes based on the capture device orientation
@@ -295,10 +322,16 @@ RawInput::open (const std::string &name, ImageSpec &newspec,
     if (other.artist[0])
         m_spec.attribute ("Artist", other.artist);
 
-    // FIXME -- thumbnail possibly in m_processor.imgdata.thumbnail
+    if (m_processor.imgdata.params.half_size && m_process)
+        m_spec.attribute ("raw:HalfSize", 1);
 
     read_tiff_metadata (name);
 
+    m_raw_spec = m_spec;
+    m_subimage = 0;
+    if (config.get_int_attribute ("raw:thumbnail", 0))
+        m_has_thumbnail = load_thumbnail ();
+
     // Copy the spec to return to the user
     newspec = m_spec;
     return true;
@@ -306,6 +339,76 @@ RawInput::open (const std::string &name, ImageSpec &newspec,
 
 
 
+bool
+RawInput::load_thumbnail ()
+{
+    // The embedded preview is either a JPEG or an 8 or 16 bit bitmap.
+    // Either way it's small, so decode it all right here.
+    if (m_processor.unpack_thumb () != LIBRAW_SUCCESS)
+        return false;
+    int ret = 0;
+    libraw_processed_image_t *thumb = m_processor.dcraw_make_mem_thumb (&ret);
+    if (! thumb)
+        return false;
+
+    bool ok = false;
+    if (thumb->type == LIBRAW_IMAGE_BITMAP && thumb->colors > 0) {
+        m_thumb_spec = ImageSpec (thumb->width, thumb->height, thumb->colors,
+                                  thumb->bits == 16 ? TypeDesc::UINT16
+                                                    : TypeDesc::UINT8);
+        m_thumb_pixels.assign (thumb->data, thumb->data + thumb->data_size);
+        ok = m_thumb_pixels.size () >= m_thumb_spec.image_bytes ();
+    } else if (thumb->type == LIBRAW_IMAGE_JPEG) {
+        ImageInput *jpeg = ImageInput::create ("jpeg");
+        if (jpeg) {
+            Filesystem::IOMemReader memreader (thumb->data, thumb->data_size);
+            Filesystem::IOProxy *io = &memreader;
+            ImageSpec config;
+            config.attribute ("oiio:ioproxy", TypeDesc::PTR, &io);
+            if (jpeg->open ("thumbnail.jpg", m_thumb_spec, config)) {
+                m_thumb_pixels.resize (m_thumb_spec.image_bytes (true));
+                ok = jpeg->read_image (m_thumb_spec.format, &m_thumb_pixels[0]);
+                jpeg->close ();
+            }
+            delete jpeg;
+        }
+        if (! ok)
+            (void) OIIO::geterror();  // eat the error
+        // Only the pixels matter; describe it like the raw image
+        ImageSpec spec (m_thumb_spec.width, m_thumb_spec.height,
+                        m_thumb_spec.nchannels, m_thumb_spec.format);
+        m_thumb_spec = spec;
+    }
+    LibRaw::dcraw_clear_mem (thumb);
+    if (! ok) {
+        m_thumb_pixels.clear ();
+        return false;
+    }
+    // Keep the camera metadata, but not the raw decoding settings, which
+    // don't apply to the (already processed, sRGB) preview.
+    for (const ImageIOParameter &p : m_raw_spec.extra_attribs)
+        if (! Strutil::istarts_with (p.name().string(), "raw:"))
+            m_thumb_spec.attribute (p.name().string(), p.type(), p.data());
+    m_thumb_spec.attribute ("oiio:ColorSpace", "sRGB");
+    m_thumb_spec.attribute ("raw:thumbnail", 1);
+    return true;
+}
+
+
+
+bool
+RawInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
+{
+    if (miplevel != 0 || subimage < 0 || subimage > (m_has_thumbnail ? 1 : 0))
+        return false;
+    m_subimage = subimage;
+    m_spec = subimage ? m_thumb_spec : m_raw_spec;
+    newspec = m_spec;
+    return true;
+}
+
+
+
 void
 RawInput::read_tiff_metadata (const std::string &filename)
 {
@@ -341,6 +444,10 @@ RawInput::close()
         LibRaw::dcraw_clear_mem(m_image);
         m_image = NULL;
     }
+    m_subimage = 0;
+    m_has_thumbnail = false;
+    m_thumb_pixels.clear ();
+    m_unpacked = false;
     return true;
 }
 
@@ -384,6 +491,17 @@ RawInput::read_native_scanline (int y, int z, void *data)
     if (y < 0 || y >= m_spec.height) // out of range scanline
         return false;
 
+    if (m_subimage == 1) {
+        size_t bytes = m_spec.scanline_bytes (true);
+        memcpy (data, &m_thumb_pixels[y*bytes], bytes);
+        return true;
+    }
+
+    if (! m_unpacked) {
+        error ("Raw pixels were not unpacked (opened \"oiio:headeronly\")");
+        return false;
+    }
+
     if (! m_process) {
         // The user has selected not to apply any debayering.
         // We take the raw data directly
@@ -409,5 +527,34 @@ RawInput::read_native_scanline (int y, int z, void *data)
     return true;
 }
 
+
+
+bool
+RawInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    yend = std::min (yend, m_spec.height);
+    if (ybegin < 0 || ybegin >= yend)
+        return false;
+
+    // All three sources are contiguous in memory, so the whole range is
+    // one copy.
+    size_t bytes = m_spec.scanline_bytes (true);
+    const unsigned char *src = NULL;
+    if (m_subimage == 1) {
+        src = &m_thumb_pixels[0];
+    } else if (! m_unpacked) {
+        error ("Raw pixels were not unpacked (opened \"oiio:headeronly\")");
+        return false;
+    } else if (! m_process) {
+        src = (const unsigned char *)m_processor.imgdata.rawdata.raw_image;
+    } else {
+        if (! m_image && ! process())
+            return false;
+        src = (const unsigned char *)m_image->data;
+    }
+    memcpy (data, src + ybegin*bytes, (yend-ybegin)*bytes);
+    return true;
+}
+
 OIIO_PLUGIN_NAMESPACE_END
 
@@ -40,6 +40,7 @@
 #include "OpenImageIO/fmath.h"
 
 #include "rla_pvt.h"
+#include "../libOpenImageIO/rle_pvt.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -62,6 +63,7 @@ private:
     FILE *m_file;                     ///< Open image handle
     RLAHeader m_rla;                  ///< Wavefront RLA header
     std::vector<unsigned char> m_buf; ///< Buffer the image pixels
+    std::vector<unsigned char> m_span; ///< One decoded span, if strided
     int m_subimage;                   ///< Current subimage index
     std::vector<uint32_t> m_sot;      ///< Scanline offsets table
     int m_stride;                     ///< Number of bytes a contig pixel takes
@@ -449,25 +451,22 @@ size_t
 RLAInput::decode_rle_span (unsigned char *buf, int n, int stride,
                            const char *encoded, size_t elen)
 {
-    size_t e = 0;
-    while (n > 0 && e < elen) {
-        signed char count = (signed char) encoded[e++];
-        if (count >= 0) {
-            // run count positive: value repeated count+1 times
-            for (int i = 0;  i <= count && n;  ++i, buf += stride, --n)
-                *buf = encoded[e];
-            ++e;
-        } else {
-            // run count negative: repeat bytes literally
-            count = -count;  // make it positive
-            for ( ; count && n > 0 && e < elen; --count, buf += stride, --n)
-                *buf = encoded[e++];
-        }
+    // Decode contiguously, then scatter if need be
+    unsigned char *span = buf;
+    if (stride != 1) {
+        m_span.resize (n);
+        span = &m_span[0];
     }
-    if (n != 0) {
+    size_t e = rle_pvt::decode (rle_pvt::SignedCount,
+                                (const unsigned char *)encoded, elen,
+                                span, n, 1);
+    if (e == 0) {
         error ("Read error: malformed RLE record");
         return 0;
     }
+    if (stride != 1)
+        for (int i = 0;  i < n;  ++i, buf += stride)
+            *buf = span[i];
     return e;
 }
 
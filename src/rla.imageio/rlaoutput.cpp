@@ -42,6 +42,7 @@
 #include "OpenImageIO/sysutil.h"
 
 #include "rla_pvt.h"
+#include "../libOpenImageIO/rle_pvt.h"
 
 #ifdef WIN32
 # define snprintf _snprintf
@@ -75,6 +76,7 @@ private:
     RLAHeader m_rla;                  ///< Wavefront RLA header
     std::vector<uint32_t> m_sot;      ///< Scanline offset table
     std::vector<unsigned char> m_rle; ///< Run record buffer for RLE
+    std::vector<unsigned char> m_span; ///< One byte of a channel, gathered
     std::vector<unsigned char> m_tilebuffer;
     unsigned int m_dither;
 
@@ -480,69 +482,13 @@ RLAOutput::encode_channel (unsigned char *data, stride_t xstride,
 
     // multi-byte data types are sliced to MSB, nextSB, ..., LSB
     int chsize = (int)chantype.size();
+    m_span.resize (m_spec.width);
     for (int byte = 0;  byte < chsize;  ++byte) {
-        int lastval = -1;     // last value
-        int count = 0;        // count of raw or repeats
-        bool repeat = false;  // if true, we're repeating
-        int runbegin = 0;     // where did the run begin
         int byteoffset = bigendian() ? byte : (chsize-byte-1);
-        for (int x = 0;  x < m_spec.width;  ++x) {
-            int newval = data[x*xstride+byteoffset];
-            if (count == 0) {   // beginning of a run.
-                count = 1;
-                repeat = true;  // presumptive
-                runbegin = x;
-            } else if (repeat) { // We've seen one or more repeating characters
-                if (newval == lastval) {
-                    // another repeating value
-                    ++count;
-                } else {
-                    // We stopped repeating.
-                    if (count < 3) {
-                        // If we didn't even have 3 in a row, just 
-                        // retroactively treat it as a raw run.
-                        ++count;
-                        repeat = false;
-                    } else {
-                        // We are ending a 3+ repetition
-                        m_rle.push_back (count-1);
-                        m_rle.push_back (lastval);
-                        count = 1;
-                        runbegin = x;
-                    }
-                }
-            } else {  // Have not been repeating
-                if (newval == lastval) {
-                    // starting a repetition?  Output previous
-                    ASSERT (count > 1);
-                    // write everything but the last char
-                    --count;
-                    m_rle.push_back (-count);
-                    for (int i = 0;  i < count;  ++i)
-                        m_rle.push_back (data[(runbegin+i)*xstride+byteoffset]);
-                    count = 2;
-                    runbegin = x - 1;
-                    repeat = true;
-                } else {
-                    ++count;  // another non-repeat
-                }
-            }
-
-            // If the run is too long or we're at the scanline end, write
-            if (count == 127 || x == m_spec.width-1) {
-                if (repeat) {
-                    m_rle.push_back (count-1); 
-                    m_rle.push_back (lastval);
-                } else {
-                    m_rle.push_back (-count);
-                    for (int i = 0;  i < count;  ++i)
-                        m_rle.push_back (data[(runbegin+i)*xstride+byteoffset]);
-                }
-                count = 0;
-            }
-            lastval = newval;
-        }
-        ASSERT (count == 0);
+        for (int x = 0;  x < m_spec.width;  ++x)
+            m_span[x] = data[x*xstride+byteoffset];
+        rle_pvt::encode (rle_pvt::SignedCount, &m_span[0], m_spec.width, 1,
+                         m_rle);
     }
 
     // Now that we know the size of the encoded buffer, save it at the
@@ -138,7 +138,7 @@ class SgiInput : public ImageInput {
 
 class SgiOutput : public ImageOutput {
  public:
-    SgiOutput () : m_fd(NULL) { }
+    SgiOutput () { init (); }
     virtual ~SgiOutput () { close(); }
     virtual const char *format_name (void) const { return "sgi"; }
     virtual int supports (string_view feature) const;
@@ -156,13 +156,23 @@ class SgiOutput : public ImageOutput {
     std::vector<unsigned char> m_scratch;
     unsigned int m_dither;
     std::vector<unsigned char> m_tilebuffer;
+    bool m_rle;                         ///< Writing RLE compressed?
+    std::vector<uint32_t> m_start_tab;  ///< RLE scanline offsets
+    std::vector<uint32_t> m_length_tab; ///< RLE scanline lengths
+    std::vector<unsigned char> m_rlebuf; ///< Encoded channel scanline
 
     void init () {
         m_fd = NULL;
+        m_rle = false;
+        m_start_tab.clear ();
+        m_length_tab.clear ();
     }
 
     bool create_and_write_header();
 
+    // Write the RLE offset tables, which follow the header.
+    bool write_offset_tables();
+
     /// Helper - write, with error detection
     template <class T>
     bool fwrite (const T *buf, size_t itemsize=sizeof(T), size_t nitems=1) {
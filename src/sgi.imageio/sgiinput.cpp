@@ -28,6 +28,7 @@
   (This is the Modified BSD License)
 */
 #include "sgi_pvt.h"
+#include "../libOpenImageIO/rle_pvt.h"
 #include "OpenImageIO/dassert.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
@@ -42,6 +43,9 @@ OIIO_PLUGIN_EXPORTS_BEGIN
     OIIO_EXPORT const char *sgi_input_extensions[] = {
         "sgi", "rgb", "rgba", "bw", "int", "inta", NULL
     };
+    OIIO_EXPORT const char *sgi_input_magic[] = {
+        "01da", NULL
+    };
 OIIO_PLUGIN_EXPORTS_END
 
 
@@ -192,68 +196,10 @@ SgiInput::uncompress_rle_channel(int scanline_off, int scanline_len,
     fseek (m_fd, scanline_off, SEEK_SET);
     if (! fread (&rle_scanline[0], 1, scanline_len))
         return false;
-    int limit = m_spec.width;
-    int i = 0;
-    if (bpc == 1) {
-        // 1 bit per channel
-        while (i < scanline_len) {
-            // Read a byte, it is the count.
-            unsigned char value = rle_scanline[i++];
-            int count = value & 0x7F;
-            // If the count is zero, we're done
-            if (! count)
-                break;
-            // If the high bit is set, we just copy the next 'count' values
-            if (value & 0x80) {
-                while (count--) {
-                    DASSERT (i < scanline_len && limit > 0);
-                    *(out++) = rle_scanline[i++];
-                    --limit;
-                }
-            }
-            // If the high bit is zero, we copy the NEXT value, count times
-            else {
-                value = rle_scanline[i++];
-                while (count--) {
-                    DASSERT (limit > 0);
-                    *(out++) = value;
-                    --limit;
-                }
-            }
-        }
-    } else {
-        // 2 bits per channel
-        ASSERT (bpc == 2);
-        while (i < scanline_len) {
-            // Read a byte, it is the count.
-            unsigned short value = (rle_scanline[i] << 8) | rle_scanline[i+1];
-            i += 2;
-            int count = value & 0x7F;
-            // If the count is zero, we're done
-            if (! count)
-                break;
-            // If the high bit is set, we just copy the next 'count' values
-            if (value & 0x80) {
-                while (count--) {
-                    DASSERT (i+1 < scanline_len && limit > 0);
-                    *(out++) = rle_scanline[i++];
-                    *(out++) = rle_scanline[i++];
-                    --limit;
-                }
-            }
-            // If the high bit is zero, we copy the NEXT value, count times
-            else {
-                while (count--) {
-                    DASSERT (limit > 0);
-                    *(out++) = rle_scanline[i];
-                    *(out++) = rle_scanline[i+1];
-                    --limit;
-                }
-                i += 2;
-            }
-        }
-    }
-    if (i != scanline_len || limit != 0) {
+    // The whole record must decode to exactly one scanline
+    size_t used = rle_pvt::decode (rle_pvt::HighBitLiteral, &rle_scanline[0],
+                                   scanline_len, out, m_spec.width, bpc);
+    if (used != size_t(scanline_len)) {
         error ("Corrupt RLE data");
         return false;
     }
@@ -29,6 +29,8 @@
 */
 
 #include "sgi_pvt.h"
+#include "../libOpenImageIO/rle_pvt.h"
+#include "OpenImageIO/strutil.h"
 
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
@@ -87,7 +89,15 @@ SgiOutput::open (const std::string &name, const ImageSpec &spec,
     if (m_spec.tile_width && m_spec.tile_height)
         m_tilebuffer.resize (m_spec.image_bytes());
 
-    return create_and_write_header();
+    m_rle = Strutil::iequals (m_spec.get_string_attribute ("compression"),
+                              "rle");
+    if (m_rle) {
+        m_start_tab.resize (m_spec.height * m_spec.nchannels, 0);
+        m_length_tab.resize (m_spec.height * m_spec.nchannels, 0);
+    }
+
+    // N.B. for RLE, this leaves zeroed tables, filled in by close()
+    return create_and_write_header() && (! m_rle || write_offset_tables());
 }
 
 
@@ -102,12 +112,8 @@ SgiOutput::write_scanline (int y, int z, TypeDesc format, const void *data,
 
     // In SGI format all channels are saved to file separately: firsty all
     // channel 1 scanlines are saved, then all channel2 scanlines are saved
-    // and so on.
-    //
-    // Note that since SGI images are pretty archaic and most probably
-    // people won't be too picky about full flexibility writing them, we
-    // content ourselves with only writing uncompressed data, and don't
-    // attempt to write with RLE encoding.
+    // and so on.  When RLE compressed, each channel scanline is just
+    // appended, and its place noted in the offset tables.
 
     int bpc = m_spec.format.size();  // bytes per channel
     std::vector<unsigned char> channeldata (m_spec.width * bpc);
@@ -122,6 +128,18 @@ SgiOutput::write_scanline (int y, int z, TypeDesc format, const void *data,
         }
         if (bpc == 2 && littleendian())
             swap_endian ((unsigned short *)&channeldata[0], m_spec.width);
+        if (m_rle) {
+            m_rlebuf.clear ();
+            rle_pvt::encode (rle_pvt::HighBitLiteral, &channeldata[0],
+                             m_spec.width, bpc, m_rlebuf);
+            int off = y + c*m_spec.height;
+            fseek (m_fd, 0, SEEK_END);
+            m_start_tab[off] = uint32_t (ftell (m_fd));
+            m_length_tab[off] = uint32_t (m_rlebuf.size());
+            if (!fwrite (&m_rlebuf[0], 1, m_rlebuf.size()))
+                return false;
+            continue;
+        }
         long scanline_offset = sgi_pvt::SGI_HEADER_LEN + (c * m_spec.height + y)
                                   * m_spec.width * bpc;
         fseek (m_fd, scanline_offset, SEEK_SET);
@@ -164,6 +182,12 @@ SgiOutput::close ()
         std::vector<unsigned char>().swap (m_tilebuffer);
     }
 
+    if (m_rle) {
+        // Now that we know where all the scanlines went
+        fseek (m_fd, sgi_pvt::SGI_HEADER_LEN, SEEK_SET);
+        ok &= write_offset_tables ();
+    }
+
     fclose (m_fd);
     init ();
     return ok;
@@ -176,7 +200,7 @@ SgiOutput::create_and_write_header()
 {
     sgi_pvt::SgiHeader sgi_header;
     sgi_header.magic = sgi_pvt::SGI_MAGIC;
-    sgi_header.storage = sgi_pvt::VERBATIM;
+    sgi_header.storage = m_rle ? sgi_pvt::RLE : sgi_pvt::VERBATIM;
     sgi_header.bpc = m_spec.format.size();
 
     if (m_spec.height == 1 && m_spec.nchannels == 1)
@@ -234,5 +258,18 @@ SgiOutput::create_and_write_header()
     return true;
 }
 
+
+
+bool
+SgiOutput::write_offset_tables ()
+{
+    // Both tables are big-endian, start offsets then lengths
+    std::vector<uint32_t> tabs (m_start_tab);
+    tabs.insert (tabs.end(), m_length_tab.begin(), m_length_tab.end());
+    if (littleendian())
+        swap_endian (&tabs[0], int(tabs.size()));
+    return fwrite (&tabs[0], sizeof(uint32_t), tabs.size());
+}
+
 OIIO_PLUGIN_NAMESPACE_END
 
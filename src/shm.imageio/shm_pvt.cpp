@@ -0,0 +1,291 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Private definitions internal to the shm.imageio plugin
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  include <time.h>
+#endif
+
+#include "OpenImageIO/sysutil.h"
+#include "shm_pvt.h"
+
+OIIO_PLUGIN_NAMESPACE_BEGIN
+
+namespace shm_pvt {
+
+static const uint32_t ring_magic = 0x4f495348;  // "OISH"
+static const uint32_t ring_version = 1;
+// How long a blocked side sleeps before rechecking whether its peer
+// has gone away.
+static const int wait_ms = 100;
+
+// The data area starts on a cache line boundary after the header
+static const size_t data_offset = (sizeof(RingHeader) + 63) & ~size_t(63);
+
+
+// Sleep until *word is no longer val (or a timeout passes).
+static void
+wait_on (std::atomic<uint32_t> *word, uint32_t val)
+{
+#ifdef __linux__
+    struct timespec ts;
+    ts.tv_sec = wait_ms / 1000;
+    ts.tv_nsec = (wait_ms % 1000) * 1000000L;
+    // Not FUTEX_PRIVATE: the word is shared between processes
+    syscall (SYS_futex, (uint32_t *)word, FUTEX_WAIT, val, &ts, NULL, 0);
+#else
+    if (word->load() == val)
+        Sysutil::usleep (50);
+#endif
+}
+
+
+static void
+wake (std::atomic<uint32_t> *word)
+{
+#ifdef __linux__
+    syscall (SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+
+
+bool
+Ring::map (int fd, size_t size, std::string &err)
+{
+    void *p = mmap (NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close (fd);
+    if (p == MAP_FAILED) {
+        err = Strutil::format ("mmap failed: %s", strerror(errno));
+        return false;
+    }
+    m_header = (RingHeader *) p;
+    m_data = (char *)p + data_offset;
+    m_mapsize = size;
+    return true;
+}
+
+
+
+bool
+Ring::create (const std::string &name, size_t capacity, std::string &err)
+{
+    close ();
+    shm_unlink (name.c_str());   // a leftover from a crashed session
+    int fd = shm_open (name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        err = Strutil::format ("Could not create shared memory \"%s\": %s",
+                               name, strerror(errno));
+        return false;
+    }
+    size_t size = data_offset + capacity;
+    if (ftruncate (fd, (off_t) size) != 0) {
+        err = Strutil::format ("Could not size shared memory \"%s\": %s",
+                               name, strerror(errno));
+        ::close (fd);
+        shm_unlink (name.c_str());
+        return false;
+    }
+    if (! map (fd, size, err)) {
+        shm_unlink (name.c_str());
+        return false;
+    }
+    m_owner = true;
+    m_name = name;
+    RingHeader *h = new (m_header) RingHeader;
+    h->capacity = capacity;
+    h->head = 0;
+    h->tail = 0;
+    h->data_seq = 0;
+    h->space_seq = 0;
+    h->writer_attached = 0;
+    h->writer_closed = 0;
+    h->reader_closed = 0;
+    h->version = ring_version;
+    std::atomic_thread_fence (std::memory_order_release);
+    h->magic = ring_magic;
+    return true;
+}
+
+
+
+bool
+Ring::attach (const std::string &name, std::string &err)
+{
+    close ();
+    int fd = shm_open (name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        err = Strutil::format ("No reader is waiting on shared memory \"%s\"",
+                               name);
+        return false;
+    }
+    struct stat st;
+    if (fstat (fd, &st) != 0 || size_t(st.st_size) <= data_offset) {
+        err = Strutil::format ("Shared memory \"%s\" is not an image ring",
+                               name);
+        ::close (fd);
+        return false;
+    }
+    if (! map (fd, size_t(st.st_size), err))
+        return false;
+    if (m_header->magic != ring_magic || m_header->version != ring_version ||
+        m_header->capacity != m_mapsize - data_offset) {
+        err = Strutil::format ("Shared memory \"%s\" is not an image ring",
+                               name);
+        close ();
+        return false;
+    }
+    uint32_t expected = 0;
+    if (! m_header->writer_attached.compare_exchange_strong (expected, 1)) {
+        err = Strutil::format ("Shared memory \"%s\" already has a writer",
+                               name);
+        close ();
+        return false;
+    }
+    m_name = name;
+    return true;
+}
+
+
+
+void
+Ring::close ()
+{
+    if (! m_header)
+        return;
+    if (m_owner) {
+        m_header->reader_closed = 1;
+        wake (&m_header->space_seq);
+    }
+    munmap ((void *)m_header, m_mapsize);
+    if (m_owner)
+        shm_unlink (m_name.c_str());
+    m_header = NULL;
+    m_data = NULL;
+    m_mapsize = 0;
+    m_owner = false;
+    m_name.clear ();
+}
+
+
+
+bool
+Ring::write (const void *data, size_t size)
+{
+    const char *src = (const char *) data;
+    uint64_t capacity = m_header->capacity;
+    while (size) {
+        uint32_t seq = m_header->space_seq.load (std::memory_order_acquire);
+        uint64_t head = m_header->head.load (std::memory_order_relaxed);
+        uint64_t tail = m_header->tail.load (std::memory_order_acquire);
+        size_t space = size_t (capacity - (head - tail));
+        if (! space) {
+            if (m_header->reader_closed)
+                return false;
+            wait_on (&m_header->space_seq, seq);
+            continue;
+        }
+        size_t n = std::min (space, size);
+        size_t pos = size_t (head % capacity);
+        size_t first = std::min (n, size_t(capacity) - pos);
+        memcpy (m_data + pos, src, first);
+        memcpy (m_data, src + first, n - first);
+        m_header->head.store (head + n, std::memory_order_release);
+        m_header->data_seq.fetch_add (1, std::memory_order_release);
+        wake (&m_header->data_seq);
+        src += n;
+        size -= n;
+    }
+    return true;
+}
+
+
+
+bool
+Ring::read (void *data, size_t size)
+{
+    char *dst = (char *) data;
+    uint64_t capacity = m_header->capacity;
+    while (size) {
+        uint32_t seq = m_header->data_seq.load (std::memory_order_acquire);
+        uint64_t tail = m_header->tail.load (std::memory_order_relaxed);
+        uint64_t head = m_header->head.load (std::memory_order_acquire);
+        size_t avail = size_t (head - tail);
+        if (! avail) {
+            if (m_header->writer_closed)
+                return false;
+            wait_on (&m_header->data_seq, seq);
+            continue;
+        }
+        size_t n = std::min (avail, size);
+        size_t pos = size_t (tail % capacity);
+        size_t first = std::min (n, size_t(capacity) - pos);
+        memcpy (dst, m_data + pos, first);
+        memcpy (dst + first, m_data, n - first);
+        m_header->tail.store (tail + n, std::memory_order_release);
+        m_header->space_seq.fetch_add (1, std::memory_order_release);
+        wake (&m_header->space_seq);
+        dst += n;
+        size -= n;
+    }
+    return true;
+}
+
+
+
+void
+Ring::writer_done ()
+{
+    if (! m_header)
+        return;
+    m_header->writer_closed = 1;
+    m_header->data_seq.fetch_add (1, std::memory_order_release);
+    wake (&m_header->data_seq);
+}
+
+}  // namespace shm_pvt
+
+OIIO_PLUGIN_NAMESPACE_END
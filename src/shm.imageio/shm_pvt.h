@@ -0,0 +1,169 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Private definitions internal to the shm.imageio plugin
+/////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OPENIMAGEIO_SHM_PVT_H
+#define OPENIMAGEIO_SHM_PVT_H
+
+#include <atomic>
+#include <map>
+#include <string>
+#include "OpenImageIO/imageio.h"
+
+
+OIIO_PLUGIN_NAMESPACE_BEGIN
+
+
+namespace shm_pvt {
+
+const char default_name[] = "/oiio_shm";
+
+// Default size of the ring buffer, in MB.
+const int default_size_mb = 64;
+
+
+// Control block at the start of the shared memory segment. The ring is a
+// single-producer, single-consumer byte stream carrying exactly what the
+// socket plugin sends over TCP: the spec as XML, then the pixels.
+struct RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;                  // bytes in the data area
+    std::atomic<uint64_t> head;         // total bytes ever written
+    std::atomic<uint64_t> tail;         // total bytes ever read
+    std::atomic<uint32_t> data_seq;     // bumped after each write (futex)
+    std::atomic<uint32_t> space_seq;    // bumped after each read (futex)
+    std::atomic<uint32_t> writer_attached;
+    std::atomic<uint32_t> writer_closed;
+    std::atomic<uint32_t> reader_closed;
+};
+
+
+// A shared memory ring buffer. The reading side (ShmInput, e.g. a viewer)
+// creates it, the writing side (ShmOutput, e.g. a renderer) attaches to
+// it. Blocked readers and writers sleep on a futex on Linux, and poll
+// briefly elsewhere.
+class Ring {
+public:
+    Ring () : m_header(NULL), m_data(NULL), m_mapsize(0), m_owner(false) { }
+    ~Ring () { close (); }
+
+    // Create (replacing any stale segment of that name) a ring with room
+    // for capacity bytes.
+    bool create (const std::string &name, size_t capacity, std::string &err);
+    // Attach to a ring created by another process.
+    bool attach (const std::string &name, std::string &err);
+    // Unmap, and if we created it, remove the segment.
+    void close ();
+    bool is_open () const { return m_header != NULL; }
+
+    // Write size bytes, blocking while the ring is full. Returns false if
+    // the reader went away.
+    bool write (const void *data, size_t size);
+    // Read exactly size bytes, blocking while the ring is empty. Returns
+    // false if the writer finished (or nowait was given) before enough
+    // data arrived.
+    bool read (void *data, size_t size);
+    // Tell the reader no more data is coming.
+    void writer_done ();
+
+private:
+    RingHeader *m_header;
+    char *m_data;
+    size_t m_mapsize;
+    bool m_owner;
+    std::string m_name;
+
+    bool map (int fd, size_t size, std::string &err);
+};
+
+}  // namespace shm_pvt
+
+
+
+class ShmOutput : public ImageOutput {
+ public:
+    ShmOutput () { }
+    virtual ~ShmOutput () { close(); }
+    virtual const char * format_name (void) const { return "shm"; }
+    virtual int supports (string_view property) const;
+    virtual bool open (const std::string &name, const ImageSpec &spec,
+                       OpenMode mode=Create);
+    virtual bool write_scanline (int y, int z, TypeDesc format,
+                                 const void *data, stride_t xstride);
+    virtual bool write_scanlines (int ybegin, int yend, int z,
+                                  TypeDesc format, const void *data,
+                                  stride_t xstride=AutoStride,
+                                  stride_t ystride=AutoStride);
+    virtual bool write_tile (int x, int y, int z,
+                             TypeDesc format, const void *data,
+                             stride_t xstride, stride_t ystride, stride_t zstride);
+    virtual bool close ();
+
+ private:
+    shm_pvt::Ring m_ring;
+    std::vector<unsigned char> m_scratch;
+
+    bool send (const void *data, size_t size);
+};
+
+
+
+class ShmInput : public ImageInput {
+ public:
+    ShmInput () { }
+    virtual ~ShmInput () { close(); }
+    virtual const char * format_name (void) const { return "shm"; }
+    virtual bool valid_file (const std::string &filename) const;
+    virtual bool open (const std::string &name, ImageSpec &spec);
+    virtual bool open (const std::string &name, ImageSpec &spec,
+                       const ImageSpec &config);
+    virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
+    virtual bool read_native_tile (int x, int y, int z, void *data);
+    virtual bool close ();
+
+ private:
+    shm_pvt::Ring m_ring;
+
+    bool receive (void *data, size_t size);
+};
+
+
+OIIO_PLUGIN_NAMESPACE_END
+
+
+#endif /* OPENIMAGEIO_SHM_PVT_H */
@@ -0,0 +1,166 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+#include "OpenImageIO/imageio.h"
+#include "shm_pvt.h"
+
+
+OIIO_PLUGIN_NAMESPACE_BEGIN
+
+// Export version number and create function symbols
+OIIO_PLUGIN_EXPORTS_BEGIN
+
+    OIIO_EXPORT int shm_imageio_version = OIIO_PLUGIN_VERSION;
+    OIIO_EXPORT const char* shm_imageio_library_version() { return NULL; }
+    OIIO_EXPORT ImageInput *shm_input_imageio_create () {
+        return new ShmInput;
+    }
+    OIIO_EXPORT const char *shm_input_extensions[] = {
+        "shm", NULL
+    };
+
+OIIO_PLUGIN_EXPORTS_END
+
+
+
+bool
+ShmInput::valid_file (const std::string &filename) const
+{
+    // Like the socket plugin, this would wait for a writer to show up, so
+    // a "nowait" open is the best we can do.
+    ImageSpec config;
+    config.attribute ("nowait", (int)1);
+
+    ImageSpec tmpspec;
+    bool ok = const_cast<ShmInput *>(this)->open (filename, tmpspec, config);
+    if (ok)
+        const_cast<ShmInput *>(this)->close ();
+    return ok;
+}
+
+
+
+bool
+ShmInput::open (const std::string &name, ImageSpec &newspec)
+{
+    return open (name, newspec, ImageSpec());
+}
+
+
+
+bool
+ShmInput::open (const std::string &name, ImageSpec &newspec,
+                const ImageSpec &config)
+{
+    // If there is a nonzero "nowait" request in the configuration, just
+    // return immediately.
+    if (config.get_int_attribute ("nowait", 0)) {
+        return false;
+    }
+
+    std::map<std::string, std::string> rest_args;
+    std::string baseurl;
+    rest_args["name"] = shm_pvt::default_name;
+    rest_args["size"] = Strutil::format ("%d", shm_pvt::default_size_mb);
+    if (! Strutil::get_rest_arguments (name, baseurl, rest_args)) {
+        error ("Invalid 'open ()' argument: %s", name.c_str ());
+        return false;
+    }
+    size_t capacity = size_t (std::max (1, atoi (rest_args["size"].c_str())))
+                    << 20;
+
+    std::string err;
+    if (! m_ring.create (rest_args["name"], capacity, err)) {
+        error ("%s", err);
+        return false;
+    }
+
+    // The writer sends the length of the spec's XML, then the XML
+    uint32_t spec_length = 0;
+    if (! receive (&spec_length, sizeof(spec_length)))
+        return false;
+    std::string spec_xml (spec_length, 0);
+    if (spec_length && ! receive (&spec_xml[0], spec_length))
+        return false;
+    newspec.from_xml (spec_xml.c_str());
+    m_spec = newspec;
+    return true;
+}
+
+
+
+bool
+ShmInput::read_native_scanline (int y, int z, void *data)
+{
+    return receive (data, m_spec.scanline_bytes ());
+}
+
+
+
+bool
+ShmInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    // Scanlines arrive in order, back to back
+    yend = std::min (yend, m_spec.y+m_spec.height);
+    if (ybegin >= yend)
+        return true;
+    return receive (data, (yend-ybegin) * m_spec.scanline_bytes ());
+}
+
+
+
+bool
+ShmInput::read_native_tile (int x, int y, int z, void *data)
+{
+    return receive (data, m_spec.tile_bytes ());
+}
+
+
+
+bool
+ShmInput::receive (void *data, size_t size)
+{
+    if (! m_ring.is_open () || ! m_ring.read (data, size)) {
+        error ("Error while reading: writer closed the connection");
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+ShmInput::close ()
+{
+    m_ring.close ();
+    return true;
+}
+
+OIIO_PLUGIN_NAMESPACE_END
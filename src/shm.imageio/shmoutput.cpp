@@ -0,0 +1,156 @@
+/*
+  Copyright 2017 Larry Gritz and the other authors and contributors.
+  All Rights Reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+  * Neither the name of the software's owners nor the names of its
+    contributors may be used to endorse or promote products derived from
+    this software without specific prior written permission.
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  (This is the Modified BSD License)
+*/
+
+#include "OpenImageIO/imageio.h"
+#include "shm_pvt.h"
+
+
+OIIO_PLUGIN_NAMESPACE_BEGIN
+
+
+OIIO_PLUGIN_EXPORTS_BEGIN
+
+    OIIO_EXPORT ImageOutput *shm_output_imageio_create () {
+        return new ShmOutput;
+    }
+    OIIO_EXPORT const char *shm_output_extensions[] = {
+        "shm", NULL
+    };
+
+OIIO_PLUGIN_EXPORTS_END
+
+
+
+int
+ShmOutput::supports (string_view feature) const
+{
+    return (feature == "alpha" ||
+            feature == "nchannels");
+}
+
+
+
+bool
+ShmOutput::open (const std::string &name, const ImageSpec &newspec,
+                 OpenMode mode)
+{
+    std::map<std::string, std::string> rest_args;
+    std::string baseurl;
+    rest_args["name"] = shm_pvt::default_name;
+    if (! Strutil::get_rest_arguments (name, baseurl, rest_args)) {
+        error ("Invalid 'open ()' argument: %s", name.c_str ());
+        return false;
+    }
+
+    std::string err;
+    if (! m_ring.attach (rest_args["name"], err)) {
+        error ("%s", err);
+        return false;
+    }
+
+    m_spec = newspec;
+    if (m_spec.format == TypeDesc::UNKNOWN)
+        m_spec.set_format (TypeDesc::UINT8);  // Default to 8 bit channels
+
+    // Same framing as the socket plugin: XML length, XML, then pixels
+    std::string spec_xml = newspec.to_xml ();
+    uint32_t xml_length = (uint32_t) spec_xml.length ();
+    return send (&xml_length, sizeof(xml_length)) &&
+           send (spec_xml.c_str (), spec_xml.length ());
+}
+
+
+
+bool
+ShmOutput::write_scanline (int y, int z, TypeDesc format,
+                           const void *data, stride_t xstride)
+{
+    data = to_native_scanline (format, data, xstride, m_scratch);
+    return send (data, m_spec.scanline_bytes ());
+}
+
+
+
+bool
+ShmOutput::write_scanlines (int ybegin, int yend, int z,
+                            TypeDesc format, const void *data,
+                            stride_t xstride, stride_t ystride)
+{
+    yend = std::min (yend, m_spec.y+m_spec.height);
+    if (ybegin >= yend)
+        return true;
+    // Native, contiguous data goes straight from the caller's buffer
+    // into the ring.
+    bool native = (format == TypeDesc::UNKNOWN ||
+                   (format == m_spec.format && m_spec.channelformats.empty()));
+    stride_t native_pixel_bytes = (stride_t) m_spec.pixel_bytes (true);
+    stride_t native_scanline_bytes = (stride_t) m_spec.scanline_bytes (true);
+    if (native &&
+        (xstride == AutoStride || xstride == native_pixel_bytes) &&
+        (ystride == AutoStride || ystride == native_scanline_bytes))
+        return send (data, (yend-ybegin) * native_scanline_bytes);
+    return ImageOutput::write_scanlines (ybegin, yend, z, format, data,
+                                         xstride, ystride);
+}
+
+
+
+bool
+ShmOutput::write_tile (int x, int y, int z,
+                       TypeDesc format, const void *data,
+                       stride_t xstride, stride_t ystride, stride_t zstride)
+{
+    data = to_native_tile (format, data, xstride, ystride, zstride, m_scratch);
+    return send (data, m_spec.tile_bytes ());
+}
+
+
+
+bool
+ShmOutput::send (const void *data, size_t size)
+{
+    if (! m_ring.is_open () || ! m_ring.write (data, size)) {
+        error ("Error while writing: reader closed the connection");
+        return false;
+    }
+    return true;
+}
+
+
+
+bool
+ShmOutput::close ()
+{
+    m_ring.writer_done ();
+    m_ring.close ();
+    return true;
+}
+
+OIIO_PLUGIN_NAMESPACE_END
@@ -45,7 +45,7 @@ using namespace boost::asio;
 namespace socket_pvt {
 
 std::size_t
-socket_write (ip::tcp::socket &s, TypeDesc &type, const void *data, int size)
+socket_write (ip::tcp::socket &s, TypeDesc &type, const void *data, std::size_t size)
 {
     std::size_t bytes;
 
@@ -55,6 +55,17 @@ socket_write (ip::tcp::socket &s, TypeDesc &type, const void *data, int size)
     return bytes;
 }
 
+
+
+void
+tune_socket (ip::tcp::socket &s)
+{
+    boost::system::error_code err;
+    s.set_option (ip::tcp::no_delay (true), err);
+    s.set_option (socket_base::send_buffer_size (socket_buffer_size), err);
+    s.set_option (socket_base::receive_buffer_size (socket_buffer_size), err);
+}
+
 }
 
 OIIO_PLUGIN_NAMESPACE_END
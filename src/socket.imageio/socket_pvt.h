@@ -69,9 +69,18 @@ class SocketOutput : public ImageOutput {
                        OpenMode mode=Create);
     virtual bool write_scanline (int y, int z, TypeDesc format,
                                  const void *data, stride_t xstride);
+    virtual bool write_scanlines (int ybegin, int yend, int z,
+                                  TypeDesc format, const void *data,
+                                  stride_t xstride=AutoStride,
+                                  stride_t ystride=AutoStride);
     virtual bool write_tile (int x, int y, int z,
                              TypeDesc format, const void *data,
                              stride_t xstride, stride_t ystride, stride_t zstride);
+    virtual bool write_tiles (int xbegin, int xend, int ybegin, int yend,
+                              int zbegin, int zend, TypeDesc format,
+                              const void *data, stride_t xstride=AutoStride,
+                              stride_t ystride=AutoStride,
+                              stride_t zstride=AutoStride);
     virtual bool close ();
     virtual bool copy_image (ImageInput *in);
 
@@ -80,9 +89,16 @@ class SocketOutput : public ImageOutput {
     io_service io;
     ip::tcp::socket socket;
     std::vector<unsigned char> m_scratch;
+    // While m_batch is set, write_scanline/write_tile append to m_pending
+    // instead of sending, so that a multi-scanline or multi-tile write
+    // goes out as one socket write.
+    bool m_batch;
+    std::vector<unsigned char> m_pending;
 
     bool connect_to_server (const std::string &name);
     bool send_spec_to_server (const ImageSpec &spec);
+    bool send (const void *data, size_t size);
+    bool flush_pending ();
 };
 
 
@@ -97,6 +113,8 @@ class SocketInput : public ImageInput {
     virtual bool open (const std::string &name, ImageSpec &spec,
                        const ImageSpec &config);
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
     virtual bool read_native_tile (int x, int y, int z, void *data);
     virtual bool close ();
 
@@ -108,6 +126,7 @@ class SocketInput : public ImageInput {
     
     bool accept_connection (const std::string &name);
     bool get_spec_from_client (ImageSpec &spec);
+    bool receive (void *data, size_t size);
 
     friend class SocketOutput;
 };
@@ -118,7 +137,15 @@ const char default_port[] = "10110";
 
 const char default_host[] = "127.0.0.1";
 
-std::size_t socket_write (ip::tcp::socket &s, TypeDesc &type, const void *data, int size);
+std::size_t socket_write (ip::tcp::socket &s, TypeDesc &type, const void *data, std::size_t size);
+
+// Socket buffer size requested on both ends, big enough to keep a
+// progressive render preview's worth of scanlines in flight.
+const int socket_buffer_size = 4 << 20;
+
+// Turn off Nagle and enlarge the kernel socket buffers. These are only
+// hints, so failures are ignored.
+void tune_socket (ip::tcp::socket &s);
 
 }
 
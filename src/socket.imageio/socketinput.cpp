@@ -107,29 +107,38 @@ SocketInput::open (const std::string &name, ImageSpec &newspec,
 
 bool
 SocketInput::read_native_scanline (int y, int z, void *data)
-{    
-    try {
-        boost::asio::read (socket, buffer (reinterpret_cast<char *> (data),
-                m_spec.scanline_bytes ()));
-    } catch (boost::system::system_error &err) {
-        error ("Error while reading: %s", err.what ());
-        return false;
-    } catch (...) {
-        error ("Error while reading: unknown exception");
-        return false;
-    }
+{
+    return receive (data, m_spec.scanline_bytes ());
+}
 
-    return true;
+
+
+bool
+SocketInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    // Scanlines arrive in order, back to back, so a range is one read
+    yend = std::min (yend, m_spec.y+m_spec.height);
+    if (ybegin >= yend)
+        return true;
+    return receive (data, (yend-ybegin) * m_spec.scanline_bytes ());
 }
 
 
 
 bool
 SocketInput::read_native_tile (int x, int y, int z, void *data)
+{
+    return receive (data, m_spec.tile_bytes ());
+}
+
+
+
+bool
+SocketInput::receive (void *data, size_t size)
 {
     try {
         boost::asio::read (socket, buffer (reinterpret_cast<char *> (data),
-                m_spec.tile_bytes ()));
+                size));
     } catch (boost::system::system_error &err) {
         error ("Error while reading: %s", err.what ());
         return false;
@@ -171,6 +180,7 @@ SocketInput::accept_connection(const std::string &name)
         acceptor = std::shared_ptr <ip::tcp::acceptor>
             (new ip::tcp::acceptor (io, ip::tcp::endpoint (ip::tcp::v4(), port)));
         acceptor->accept (socket);
+        socket_pvt::tune_socket (socket);
     } catch (boost::system::system_error &err) {
         error ("Error while accepting: %s", err.what ());
         return false;
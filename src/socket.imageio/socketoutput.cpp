@@ -51,7 +51,7 @@ OIIO_PLUGIN_EXPORTS_END
 
 
 SocketOutput::SocketOutput()
-    : socket (io)
+    : socket (io), m_batch (false)
 {
 
 }
@@ -91,15 +91,8 @@ SocketOutput::write_scanline (int y, int z, TypeDesc format,
 {
     data = to_native_scanline (format, data, xstride, m_scratch);
 
-    try {
-        socket_pvt::socket_write (socket, format, data, m_spec.scanline_bytes ());
-    } catch (boost::system::system_error &err) {
-        error ("Error while writing: %s", err.what ());
+    if (! send (data, m_spec.scanline_bytes ()))
         return false;
-    } catch (...) {
-        error ("Error while writing: unknown exception");
-        return false;
-    }
 
     ++m_next_scanline;
 
@@ -108,6 +101,38 @@ SocketOutput::write_scanline (int y, int z, TypeDesc format,
 
 
 
+bool
+SocketOutput::write_scanlines (int ybegin, int yend, int z,
+                               TypeDesc format, const void *data,
+                               stride_t xstride, stride_t ystride)
+{
+    yend = std::min (yend, m_spec.y+m_spec.height);
+    if (ybegin >= yend)
+        return true;
+    // Native, contiguous data is sent straight from the caller's buffer
+    bool native = (format == TypeDesc::UNKNOWN ||
+                   (format == m_spec.format && m_spec.channelformats.empty()));
+    stride_t native_pixel_bytes = (stride_t) m_spec.pixel_bytes (true);
+    stride_t native_scanline_bytes = (stride_t) m_spec.scanline_bytes (true);
+    if (native &&
+        (xstride == AutoStride || xstride == native_pixel_bytes) &&
+        (ystride == AutoStride || ystride == native_scanline_bytes)) {
+        if (! send (data, (yend-ybegin) * native_scanline_bytes))
+            return false;
+        m_next_scanline += yend - ybegin;
+        return true;
+    }
+    // Otherwise convert a scanline at a time, but send them all at once
+    m_pending.clear ();
+    m_batch = true;
+    bool ok = ImageOutput::write_scanlines (ybegin, yend, z, format, data,
+                                            xstride, ystride);
+    m_batch = false;
+    return flush_pending () && ok;
+}
+
+
+
 bool
 SocketOutput::write_tile (int x, int y, int z,
                           TypeDesc format, const void *data,
@@ -115,8 +140,40 @@ SocketOutput::write_tile (int x, int y, int z,
 {
     data = to_native_tile (format, data, xstride, ystride, zstride, m_scratch);
 
+    return send (data, m_spec.tile_bytes ());
+}
+
+
+
+bool
+SocketOutput::write_tiles (int xbegin, int xend, int ybegin, int yend,
+                           int zbegin, int zend, TypeDesc format,
+                           const void *data, stride_t xstride,
+                           stride_t ystride, stride_t zstride)
+{
+    // Let the generic code cut the region into tiles, but collect them
+    // and send them with one write.
+    m_pending.clear ();
+    m_batch = true;
+    bool ok = ImageOutput::write_tiles (xbegin, xend, ybegin, yend,
+                                        zbegin, zend, format, data,
+                                        xstride, ystride, zstride);
+    m_batch = false;
+    return flush_pending () && ok;
+}
+
+
+
+bool
+SocketOutput::send (const void *data, size_t size)
+{
+    if (m_batch) {
+        const unsigned char *d = (const unsigned char *)data;
+        m_pending.insert (m_pending.end(), d, d+size);
+        return true;
+    }
     try {
-        socket_pvt::socket_write (socket, format, data, m_spec.tile_bytes ());
+        socket_pvt::socket_write (socket, m_spec.format, data, size);
     } catch (boost::system::system_error &err) {
         error ("Error while writing: %s", err.what ());
         return false;
@@ -124,12 +181,21 @@ SocketOutput::write_tile (int x, int y, int z,
         error ("Error while writing: unknown exception");
         return false;
     }
-
     return true;
 }
 
 
 
+bool
+SocketOutput::flush_pending ()
+{
+    bool ok = m_pending.empty() || send (&m_pending[0], m_pending.size());
+    m_pending.clear ();
+    return ok;
+}
+
+
+
 bool
 SocketOutput::close ()
 {
@@ -199,6 +265,7 @@ SocketOutput::connect_to_server (const std::string &name)
             error ("Host \"%s\" not found", rest_args["host"].c_str ());
             return false;
         }
+        socket_pvt::tune_socket (socket);
     } catch (boost::system::system_error &err) {
         error ("Error while connecting: %s", err.what ());
         return false;
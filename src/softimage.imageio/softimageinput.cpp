@@ -74,12 +74,19 @@ private:
     ///
     bool read_pixels_mixed_run_length (const softimage_pvt::ChannelPacket & curPacket,
                                        void * data);
+    /// Put npixels of the packet's channels, read from the file, in their
+    /// places in the scanline data starting at pixel x.  If run is true,
+    /// src holds just one pixel, to be repeated npixels times.
+    void place_pixels (const softimage_pvt::ChannelPacket & curPacket,
+                       const std::vector<int> &channels, const uint8_t *src,
+                       size_t x, size_t npixels, bool run, void * data);
     
     FILE *m_fd;
     softimage_pvt::PicFileHeader m_pic_header;
     std::vector<softimage_pvt::ChannelPacket> m_channel_packets;
     std::string m_filename;
     std::vector<fpos_t> m_scanline_markers;
+    std::vector<uint8_t> m_packet;   ///< Raw pixels read from a packet
 };
 
 
@@ -93,6 +100,9 @@ OIIO_PLUGIN_EXPORTS_BEGIN
     OIIO_EXPORT const char *softimage_input_extensions[] = {
         "pic", NULL
     };
+    OIIO_EXPORT const char *softimage_input_magic[] = {
+        "5380f634", NULL
+    };
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -280,36 +290,62 @@ SoftimageInput::read_next_scanline (void * data)
 
 
 
+inline void
+SoftimageInput::place_pixels (const softimage_pvt::ChannelPacket & curPacket,
+                              const std::vector<int> &channels,
+                              const uint8_t *src, size_t x, size_t npixels,
+                              bool run, void * data)
+{
+    size_t pixelChannelSize = curPacket.size / 8;
+    size_t inPixelSize = pixelChannelSize * channels.size();
+    size_t outPixelSize = pixelChannelSize * m_spec.nchannels;
+    uint8_t * out = (uint8_t *)data + x * outPixelSize;
+    // The file's channel values are big-endian
+    bool swap = littleendian() && pixelChannelSize > 1;
+    for (size_t p = 0; p < npixels; ++p, out += outPixelSize) {
+        if (run && p > 0) {
+            // Replicate the first pixel's channels
+            for (size_t c = 0; c < channels.size(); c++) {
+                size_t off = channels[c] * pixelChannelSize;
+                memcpy (out + off, out - p*outPixelSize + off,
+                        pixelChannelSize);
+            }
+            continue;
+        }
+        const uint8_t *in = src + (run ? 0 : p * inPixelSize);
+        for (size_t c = 0; c < channels.size(); c++, in += pixelChannelSize) {
+            uint8_t *o = out + channels[c] * pixelChannelSize;
+            if (swap)
+                for (size_t byte = 0; byte < pixelChannelSize; byte++)
+                    o[byte] = in[pixelChannelSize - 1 - byte];
+            else
+                memcpy (o, in, pixelChannelSize);
+        }
+    }
+}
+
+
+
 inline bool
 SoftimageInput::read_pixels_uncompressed (const softimage_pvt::ChannelPacket & curPacket, void * data)
 {
     // We're going to need to use the channels more than once
     std::vector<int> channels = curPacket.channels();
-    // We'll need to use the pixelChannelSize a bit
-    size_t pixelChannelSize = curPacket.size / 8;
-    
+    size_t pixelSize = (curPacket.size / 8) * channels.size();
+    size_t bytes = m_pic_header.width * pixelSize;
+
     if (data) {
-        // data pointer is set so we're supposed to write data there
-        uint8_t * scanlineData = (uint8_t *)data;
-        for (size_t pixelX=0; pixelX < m_pic_header.width; pixelX++) {
-            for (size_t curChan=0; curChan < channels.size(); curChan++) {
-                for (size_t byte=0; byte < pixelChannelSize; byte++) {
-                    // Get which byte we should be placing this in depending on endianness
-                    size_t curByte = byte;
-                    if (littleendian())
-                        curByte = ((pixelChannelSize) - 1) - curByte;
-
-                    //read the data into the correct place
-                    if (fread (&scanlineData[(pixelX * pixelChannelSize * m_spec.nchannels) + (channels[curChan] * pixelChannelSize) + curByte],
-                        1, 1, m_fd) != 1)
-                        return false;
-                }
-            }
-        }
+        // data pointer is set so we're supposed to write data there --
+        // read the whole scanline at once, then put each value in place
+        m_packet.resize (bytes);
+        if (bytes && fread (&m_packet[0], 1, bytes, m_fd) != bytes)
+            return false;
+        place_pixels (curPacket, channels, &m_packet[0], 0,
+                      m_pic_header.width, false, data);
     } else {
         // data pointer is null so we should just seek to the next scanline
         // If the seek fails return false
-        if (fseek (m_fd, m_pic_header.width * pixelChannelSize * channels.size(), SEEK_CUR))
+        if (fseek (m_fd, bytes, SEEK_CUR))
             return false;
     }
     return true;
@@ -324,44 +360,31 @@ SoftimageInput::read_pixels_pure_run_length (const softimage_pvt::ChannelPacket
     size_t linePixelCount = 0;
     // Number of repeats of this value
     uint8_t curCount = 0;
-    // We'll need to use the pixelChannelSize a bit
-    size_t pixelChannelSize = curPacket.size / 8;
     // We're going to need to use the channels more than once
     std::vector<int> channels = curPacket.channels();
+    size_t pixelSize = (curPacket.size / 8) * channels.size();
+    uint8_t pixelData[64];  // at most 4 channels of 16 bytes
+    ASSERT (pixelSize <= sizeof(pixelData));
     // Read the pixels until we've read them all
     while (linePixelCount < m_pic_header.width) {
         // Read the repeats for the run length - return false if read fails
         if (fread (&curCount, 1, 1, m_fd) != 1)
             return false;
+        // Just to be safe let's make sure this wouldn't take us past
+        // the end of this scanline
+        size_t count = std::min (size_t(curCount),
+                                 m_pic_header.width - linePixelCount);
 
         if (data) {
             // data pointer is set so we're supposed to write data there
-            size_t pixelSize = pixelChannelSize * channels.size();
-            uint8_t * pixelData = new uint8_t[pixelSize];
-            if (fread (pixelData, pixelSize, 1, m_fd) != pixelSize)
+            if (fread (pixelData, 1, pixelSize, m_fd) != pixelSize)
                 return false;
-
-            // Now we've got the pixel value we need to push it into the data
-            uint8_t * scanlineData = (uint8_t *)data;
-            for (size_t pixelX=linePixelCount; pixelX < linePixelCount+curCount; pixelX++) {
-                for (size_t curChan=0; curChan < channels.size(); curChan++) {
-                    for (size_t byte=0; byte < pixelChannelSize; byte++) {
-                        // Get which byte we should be placing this in depending on endianness
-                        size_t curByte = byte;
-                        if (littleendian())
-                            curByte = ((pixelChannelSize) - 1) - curByte;
-                        
-                        //put the data into the correct place
-                        scanlineData[(pixelX * pixelChannelSize * m_spec.nchannels) + (channels[curChan] * pixelChannelSize) + curByte] =
-                            pixelData[(curChan * pixelChannelSize) + curByte];
-                    }
-                }
-            }
-            delete[] pixelData;
+            place_pixels (curPacket, channels, pixelData, linePixelCount,
+                          count, true, data);
         } else {
             // data pointer is null so we should just seek to the next scanline
             // If the seek fails return false
-            if (fseek (m_fd, pixelChannelSize * channels.size(), SEEK_CUR))
+            if (fseek (m_fd, pixelSize, SEEK_CUR))
                 return false;
         }
 
@@ -380,10 +403,9 @@ SoftimageInput::read_pixels_mixed_run_length (const softimage_pvt::ChannelPacket
     size_t linePixelCount = 0;
     // Number of repeats of this value
     uint8_t curCount = 0;
-    // We'll need to use the pixelChannelSize a bit
-    size_t pixelChannelSize = curPacket.size / 8;
     // We're going to need to use the channels more than once
     std::vector<int> channels = curPacket.channels();
+    size_t pixelSize = (curPacket.size / 8) * channels.size();
     // Read the pixels until we've read them all
     while (linePixelCount < m_pic_header.width) {
         // Read the repeats for the run length - return false if read fails
@@ -392,40 +414,30 @@ SoftimageInput::read_pixels_mixed_run_length (const softimage_pvt::ChannelPacket
 
         if (curCount < 128) {
             // It's a raw packet - so this means the count is 1 less then the actual value
-            curCount++;
+            size_t count = size_t(curCount) + 1;
             
             // Just to be safe let's make sure this wouldn't take us
             // past the end of this scanline
-            if (curCount + linePixelCount > m_pic_header.width)
-                curCount = m_pic_header.width - linePixelCount;
+            if (count + linePixelCount > m_pic_header.width)
+                count = m_pic_header.width - linePixelCount;
             
             if (data) {
-                // data pointer is set so we're supposed to write data there
-                uint8_t * scanlineData = (uint8_t *)data;
-                for (size_t pixelX=linePixelCount; pixelX < linePixelCount+curCount; pixelX++) {
-                    for (size_t curChan=0; curChan < channels.size(); curChan++) {
-                        for (size_t byte=0; byte < pixelChannelSize; byte++) {
-                            // Get which byte we should be placing this in depending on endianness
-                            size_t curByte = byte;
-                            if (littleendian())
-                                curByte = ((pixelChannelSize) - 1) - curByte;
-                            
-                            //read the data into the correct place
-                            if (fread (&scanlineData[(pixelX * pixelChannelSize * m_spec.nchannels) + (channels[curChan] * pixelChannelSize) + curByte],
-                                1, 1, m_fd) != 1)
-                                return false;
-                        }
-                    }
-                }
+                // data pointer is set so we're supposed to write data
+                // there -- read the whole packet at once.
+                m_packet.resize (count * pixelSize);
+                if (fread (&m_packet[0], 1, m_packet.size(), m_fd) != m_packet.size())
+                    return false;
+                place_pixels (curPacket, channels, &m_packet[0],
+                              linePixelCount, count, false, data);
             } else {
                 // data pointer is null so we should just seek to the
                 // next scanline If the seek fails return false.
-                if (fseek (m_fd, curCount * pixelChannelSize * channels.size(), SEEK_CUR))
+                if (fseek (m_fd, count * pixelSize, SEEK_CUR))
                     return false;
             }
 
             // Add these pixels to the current pixel count
-            linePixelCount += curCount;
+            linePixelCount += count;
         } else {
             // It's a run length encoded packet
             uint16_t longCount = 0;
@@ -444,37 +456,21 @@ SoftimageInput::read_pixels_mixed_run_length (const softimage_pvt::ChannelPacket
             } else {
                 longCount = curCount - 127;
             }
+            size_t count = std::min (size_t(longCount),
+                                     m_pic_header.width - linePixelCount);
 
             if (data) {
                 // data pointer is set so we're supposed to write data there
-                size_t pixelSize = pixelChannelSize * channels.size();
-                uint8_t * pixelData = new uint8_t[pixelSize];
+                uint8_t pixelData[64];  // at most 4 channels of 16 bytes
+                ASSERT (pixelSize <= sizeof(pixelData));
                 if (fread (pixelData, 1, pixelSize, m_fd) != pixelSize)
                     return false;
-                
-                // Now we've got the pixel value we need to push it into
-                // the data.
-                uint8_t * scanlineData = (uint8_t *)data;
-                for (size_t pixelX=linePixelCount; pixelX < linePixelCount+longCount; pixelX++) {
-                    for (size_t curChan=0; curChan < channels.size(); curChan++) {
-                        for (size_t byte=0; byte < pixelChannelSize; byte++) {
-                            // Get which byte we should be placing this
-                            // in depending on endianness.
-                            size_t curByte = byte;
-                            if (littleendian())
-                                curByte = ((pixelChannelSize) - 1) - curByte;
-                            
-                            //put the data into the correct place
-                            scanlineData[(pixelX * pixelChannelSize * m_spec.nchannels) + (channels[curChan] * pixelChannelSize) + curByte] =
-                                pixelData[(curChan * pixelChannelSize) + curByte];
-                        }
-                    }
-                }
-                delete[] pixelData;
+                place_pixels (curPacket, channels, pixelData,
+                              linePixelCount, count, true, data);
             } else {
                 // data pointer is null so we should just seek to the
                 // next scanline.  If the seek fails return false.
-                if (fseek (m_fd, pixelChannelSize * channels.size(), SEEK_CUR))
+                if (fseek (m_fd, pixelSize, SEEK_CUR))
                     return false;
             }
             
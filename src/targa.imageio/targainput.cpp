@@ -33,6 +33,7 @@
 #include <cmath>
 
 #include "targa_pvt.h"
+#include "../libOpenImageIO/rle_pvt.h"
 
 #include "OpenImageIO/dassert.h"
 #include "OpenImageIO/typedesc.h"
@@ -632,89 +633,51 @@ TGAInput::readimg ()
     m_buf.resize (m_spec.image_bytes());
 
     // read palette, if there is any
+    std::vector<unsigned char> palettebuf;
     unsigned char *palette = NULL;
     if (m_tga.cmap_type) {
-        palette = new unsigned char[palbytespp * m_tga.cmap_length];
+        palettebuf.resize (palbytespp * m_tga.cmap_length);
+        palette = &palettebuf[0];
         if (! fread (palette, palbytespp, m_tga.cmap_length))
             return false;
     }
 
-    unsigned char pixel[4];
+    // Get all the packed pixels in one go, expanding the RLE packets
+    // (which may span scanlines) if there are any.
+    size_t npixels = size_t(m_spec.width) * m_spec.height;
+    std::vector<unsigned char> raw (npixels * bytespp);
     if (m_tga.type < TYPE_PALETTED_RLE) {
         // uncompressed image data
-        unsigned char in[4];
-        for (int y = m_spec.height - 1; y >= 0; y--) {
-            for (int x = 0; x < m_spec.width; x++) {
-                if (! fread (in, bytespp, 1))
-                    return false;
-                decode_pixel (in, pixel, palette,
-                              bytespp, palbytespp, alphabits);
-                memcpy (&m_buf[y * m_spec.width * m_spec.nchannels
-                        + x * m_spec.nchannels],
-                        pixel, m_spec.nchannels);
-            }
-        }
+        if (! fread (&raw[0], bytespp, npixels))
+            return false;
     } else {
-        // Run Length Encoded image
-        unsigned char in[5];
-        int packet_size;
-        for (int y = m_spec.height - 1; y >= 0; y--) {
-            for (int x = 0; x < m_spec.width; x++) {
-                if (! fread (in, 1 + bytespp, 1))
-                    return false;
-                packet_size = 1 + (in[0] & 0x7f);
-                decode_pixel (&in[1], pixel, palette,
-                              bytespp, palbytespp, alphabits);
-                if (in[0] & 0x80) {  // run length packet
-                    /*std::cerr << "[tga] run length packet "
-                              << packet_size << "\n";*/
-                    for (int i = 0; i < packet_size; i++) {
-                        memcpy (&m_buf[y * m_spec.width * m_spec.nchannels
-                                + x * m_spec.nchannels],
-                                pixel, m_spec.nchannels);
-                        if (i < packet_size - 1) {
-                            x++;
-                            if (x >= m_spec.width) {
-                                // run spans across multiple scanlines
-                                x = 0;
-                                if (y > 0)
-                                    y--;
-                                else
-                                    goto loop_break;
-                            }
-                        }
-                    }
-                } else { // non-rle packet
-                    /*std::cerr << "[tga] non-run length packet "
-                              << packet_size << "\n";*/
-                    for (int i = 0; i < packet_size; i++) {
-                        memcpy (&m_buf[y * m_spec.width * m_spec.nchannels
-                                + x * m_spec.nchannels],
-                                pixel, m_spec.nchannels);
-                        if (i < packet_size - 1) {
-                            x++;
-                            if (x >= m_spec.width) {
-                                // run spans across multiple scanlines
-                                x = 0;
-                                if (y > 0)
-                                    y--;
-                                else
-                                    goto loop_break;
-                            }
-                            // skip the packet header byte
-                            if (! fread (&in[1], bytespp, 1))
-                                return false;
-                            decode_pixel(&in[1], pixel, palette,
-                                         bytespp, palbytespp, alphabits);
-                        }
-                    }
-                }
-            }
-            loop_break:;
+        // Run Length Encoded image -- the packets run on to the end of
+        // the image data, so just take everything that's left
+        long begin = ftell (m_file);
+        fseek (m_file, 0, SEEK_END);
+        long end = ftell (m_file);
+        fseek (m_file, begin, SEEK_SET);
+        std::vector<unsigned char> encoded (std::max (end - begin, 1L));
+        size_t n = ::fread (&encoded[0], 1, encoded.size(), m_file);
+        if (! rle_pvt::decode (rle_pvt::HighBitRun, &encoded[0], n,
+                               &raw[0], npixels, bytespp)) {
+            error ("Corrupt RLE data");
+            return false;
         }
     }
 
-    delete [] palette;
+    // The pixels are stored bottom to top
+    unsigned char pixel[4];
+    int nc = m_spec.nchannels;
+    const unsigned char *in = &raw[0];
+    for (int y = m_spec.height - 1; y >= 0; y--) {
+        unsigned char *out = &m_buf[size_t(y) * m_spec.width * nc];
+        for (int x = 0; x < m_spec.width; x++, in += bytespp, out += nc) {
+            decode_pixel ((unsigned char *)in, pixel, palette,
+                          bytespp, palbytespp, alphabits);
+            memcpy (out, pixel, nc);
+        }
+    }
 
     // flip the image, if necessary
     if (m_tga.cmap_type)
@@ -33,6 +33,7 @@
 #include <cmath>
 
 #include "targa_pvt.h"
+#include "../libOpenImageIO/rle_pvt.h"
 
 #include "OpenImageIO/dassert.h"
 #include "OpenImageIO/typedesc.h"
@@ -69,6 +70,7 @@ private:
     bool m_convert_alpha;             ///< Do we deassociate alpha?
     float m_gamma;                    ///< Gamma to use for alpha conversion
     std::vector<unsigned char> m_scratch;
+    std::vector<unsigned char> m_rle; ///< Encoded scanline, if RLE
     int m_idlen;                      ///< Length of the TGA ID block
     unsigned int m_dither;
     std::vector<unsigned char> m_tilebuffer;
@@ -83,14 +85,6 @@ private:
     // Helper function to write the TGA 2.0 data fields, called by close()
     bool write_tga20_data_fields ();
 
-    /// Helper function to flush a non-run-length packet
-    ///
-    inline void flush_rawp (unsigned char *& src, int size, int start);
-
-    /// Helper function to flush a run-length packet
-    ///
-    inline void flush_rlp (unsigned char *buf, int size);
-
     /// Helper - write, with error detection (no byte swapping!)
     template <class T>
     bool fwrite (const T *buf, size_t itemsize=sizeof(T), size_t nitems=1) {
@@ -472,58 +466,6 @@ TGAOutput::close ()
 
 
 
-inline void
-TGAOutput::flush_rlp (unsigned char *buf, int size)
-{
-    // early out
-    if (size < 1)
-        return;
-    // write packet header
-    unsigned char h = (size - 1) | 0x80;
-    // write packet pixel
-    if (!fwrite(&h) || !fwrite (buf, m_spec.nchannels)) {
-        // do something intelligent?
-        return;
-    }
-}
-
-
-
-inline void
-TGAOutput::flush_rawp (unsigned char *& src, int size, int start)
-{
-    // early out
-    if (size < 1)
-        return;
-    // write packet header
-    unsigned char h = (size - 1) & ~0x80;
-    if (!fwrite (&h))
-        return;
-    // rewind the scanline and flush packet pixels
-    unsigned char buf[4];
-    int n = m_spec.nchannels;
-    for (int i = 0; i < size; i++) {
-        if (n <= 2) {
-            // 1- and 2-channels can write directly
-            if (!fwrite (src+start, n)) {
-                return;
-            }
-        } else {
-            // 3- and 4-channel must swap red and blue
-            buf[0] = src[(start + i) * n + 2];
-            buf[1] = src[(start + i) * n + 1];
-            buf[2] = src[(start + i) * n + 0];
-            if (n > 3)
-                buf[3] = src[(start + i) * n + 3];
-            if (!fwrite (buf, n)) {
-                return;
-            }
-        }
-    }
-}
-
-
-
 template <class T>
 static void 
 deassociateAlpha (T * data, int size, int channels, int alpha_channel, float gamma)
@@ -578,116 +520,18 @@ TGAOutput::write_scanline (int y, int z, TypeDesc format,
     unsigned char *bdata = (unsigned char *)data;
 
     if (m_want_rle) {
-        // Run Length Encoding
-        // it's only profitable if n * b > 1 + b, where:
-        // n is the number of pixels in a run
-        // b is the pixel size in bytes
+        // Run Length Encoding, one scanline at a time, of whole pixels
+        // (with red and blue swapped -- in place, since data is our own
+        // copy by now)
         // FIXME: optimize runs spanning across multiple scanlines?
-        unsigned char buf[4] = { 0, 0, 0, 0 };
-        unsigned char buf2[4] = { 0, 0, 0, 0 };
-        bool rlp = false;
-        int rlcount = 0, rawcount = 0;
-
-        for (int x = 0; x < m_spec.width; x++) {
-            // save off previous pixel
-            memcpy (buf2, buf, sizeof (buf2));
-            // read the new one
-            switch (m_spec.nchannels) {
-#if 0
-            case 1:
-                buf[0] = bdata[x ];
-                break;
-            case 2:
-                buf[0] = bdata[(x * 2 + 0)];
-                buf[1] = bdata[(x * 2 + 1)];
-                break;
-#endif
-            case 3:
-                buf[0] = bdata[(x * 3 + 2)];
-                buf[1] = bdata[(x * 3 + 1)];
-                buf[2] = bdata[(x * 3 + 0)];
-                break;
-            case 4:
-                buf[0] = bdata[(x * 4 + 2)];
-                buf[1] = bdata[(x * 4 + 1)];
-                buf[2] = bdata[(x * 4 + 0)];
-                buf[3] = bdata[(x * 4 + 3)];
-                break;
-            }
-
-            //std::cerr << "[tga] x = " << x << "\n";
-
-            if (x == 0) {   // initial encoder state
-                rlp = false;
-                rlcount = 0;
-                rawcount = 1;
-                continue; // nothing to work with yet (need 2 pixels)
-            }
-
-            if (rlp) {  // in the middle of a run-length packet
-                // flush the packet if the run ends or max packet size is hit
-                if (rlcount < 0x80
-                    && buf[0] == buf2[0] && buf[1] == buf2[1]
-                    && buf[2] == buf2[2] && buf[3] == buf2[3])
-                    rlcount++;
-                else {
-                    // run broken or max size hit, flush RL packet and start
-                    // a new raw one
-                    flush_rlp (&buf2[0], rlcount);
-                    // count raw pixel
-                    rawcount++;
-                    // reset state
-                    rlcount -= 0x80;
-                    if (rlcount < 0)
-                        rlcount = 0;
-                    rlp = false;
-                }
-            } else {    // in the middle of a raw data packet
-                if (rawcount > 0    // make sure we have material to check
-                    && buf[0] == buf2[0] && buf[1] == buf2[1]
-                    && buf[2] == buf2[2] && buf[3] == buf2[3]) {
-                    // run continues, possibly material for RLE
-                    if (rlcount == 0) {
-                        // join the previous pixel into the run
-                        rawcount--;
-                        rlcount++;
-                    }
-                    rlcount++;
-                } else {
-                    // run broken
-                    // apart from the pixel we've just read, add any remaining
-                    // ones we may have considered for RLE
-                    rawcount += 1 + rlcount;
-                    rlcount = 0;
-                    // flush the packet if max packet size is hit
-                    if (rawcount >= 0x80) {
-                        // subtract 128 instead of setting to 0 because there
-                        // is a chance that rawcount is now > 128; if so, we'll
-                        // catch the remainder in the next iteration
-                        rawcount -= 0x80;
-                        flush_rawp (bdata, 0x80, x - 0x80 + 1);
-                    }
-                }
-                // check the encoding profitability condition
-                //if (rlcount * m_spec.nchannels > 1 + m_spec.nchannels) {
-                // NOTE: the condition below is valid, nchannels can be 1
-                if (rlcount > 1 + 1 / m_spec.nchannels) {
-                    // flush a packet of what we had so far
-                    flush_rawp (bdata, rawcount, x - rawcount - rlcount + 1);
-                    // reset state
-                    rawcount = 0;
-                    // mark this as a run-length packet
-                    rlp = true;
-                }
-            }
-        }
-        // flush anything that may be left
-        if (rlp)
-            flush_rlp (&buf2[0], rlcount);
-        else {
-            rawcount += rlcount;
-            flush_rawp (bdata, rawcount, m_spec.width - rawcount);
-        }
+        int n = m_spec.nchannels;
+        int w = m_spec.width;
+        for (int x = 0; x < w; x++)
+            std::swap (bdata[x*n], bdata[x*n+2]);
+        m_rle.clear ();
+        rle_pvt::encode (rle_pvt::HighBitRun, bdata, w, n, m_rle);
+        if (!fwrite (&m_rle[0], 1, m_rle.size()))
+            return false;
     } else {
         // raw, non-compressed data
         // seek to the correct scanline
@@ -54,6 +54,7 @@
 #include "OpenImageIO/strutil.h"
 #include "OpenImageIO/timer.h"
 #include "../libtexture/imagecache_pvt.h"
+#include "../libtexture/texture_pvt.h"
 
 OIIO_NAMESPACE_USING
 
@@ -107,6 +108,8 @@ static int ntrials = 1;
 static int testicwrite = 0;
 static bool test_derivs = false;
 static bool test_statquery = false;
+static std::string trace_filename;
+static std::string replay_filename;
 static Imath::M33f xform;
 static mutex error_mutex;
 void *dummyptr;
@@ -189,6 +192,8 @@ getargs (int argc, const char *argv[])
                   "--wedge", &wedge, "Wedge test",
                   "--testicwrite %d", &testicwrite, "Test ImageCache write ability (1=seeded, 2=generated)",
                   "--teststatquery", &test_statquery, "Test queries of statistics",
+                  "--trace %s", &trace_filename, "Record all texture lookups to a trace file",
+                  "--replay %s", &replay_filename, "Play back a texture lookup trace (uses --threads, --iters)",
                   NULL);
     if (ap.parse (argc, argv) < 0) {
         std::cerr << ap.geterror() << std::endl;
@@ -200,7 +205,7 @@ getargs (int argc, const char *argv[])
         exit (EXIT_FAILURE);
     }
 
-    if (filenames.size() < 1 &&
+    if (filenames.size() < 1 && replay_filename.empty() &&
           !test_construction && !test_getimagespec && !testhash) {
         std::cerr << "testtex: Must have at least one input file\n";
         ap.usage();
@@ -976,6 +981,130 @@ launch_tex_threads (int numthreads, int iterations)
 
 
 
+static void
+replay_thread (const std::vector<pvt::TraceLookup> *lookups,
+               const std::vector<TextureSystem::TextureHandle *> *handles,
+               size_t begin, size_t end)
+{
+    TextureSystem::Perthread *thread_info = texsys->get_perthread_info ();
+    float result[4], dresultds[4], dresultdt[4];
+    for (size_t i = begin;  i < end;  ++i) {
+        const pvt::TraceLookup &l ((*lookups)[i]);
+        TextureOpt opt;
+        opt.firstchannel = l.firstchannel;
+        opt.subimage = l.subimage;
+        opt.swrap = (TextureOpt::Wrap) l.swrap;
+        opt.twrap = (TextureOpt::Wrap) l.twrap;
+        opt.mipmode = (TextureOpt::MipMode) l.mipmode;
+        opt.interpmode = (TextureOpt::InterpMode) l.interpmode;
+        opt.anisotropic = l.anisotropic;
+        opt.conservative_filter = l.conservative_filter;
+        opt.sblur = l.sblur;
+        opt.tblur = l.tblur;
+        opt.swidth = l.swidth;
+        opt.twidth = l.twidth;
+        opt.fill = l.fill;
+        texsys->texture ((*handles)[l.file], thread_info, opt,
+                         l.s, l.t, l.dsdx, l.dtdx, l.dsdy, l.dtdy,
+                         std::min (int(l.nchannels), 4), result,
+                         l.derivs ? dresultds : NULL,
+                         l.derivs ? dresultdt : NULL);
+    }
+}
+
+
+
+// Play back a lookup trace recorded with --trace (or by a renderer
+// setting the "trace_file" attribute), splitting it evenly among the
+// threads so each one replays a contiguous run just as it was captured,
+// and report throughput and cache behavior.
+static void
+test_replay ()
+{
+    size_t size = (size_t) Filesystem::file_size (replay_filename);
+    std::vector<char> buf (size);
+    if (size < 8 ||
+        Filesystem::read_bytes (replay_filename, &buf[0], size) != size ||
+        memcmp (&buf[0], pvt::texture_trace_magic, 8)) {
+        std::cerr << "testtex: \"" << replay_filename
+                  << "\" is not a texture trace\n";
+        return;
+    }
+
+    std::vector<TextureSystem::TextureHandle *> handles;
+    std::vector<pvt::TraceLookup> lookups;
+    for (size_t pos = 8;  pos < size; ) {
+        char tag = buf[pos++];
+        if (tag == 'F' && pos + 8 <= size) {
+            uint32_t id, len;
+            memcpy (&id, &buf[pos], 4);
+            memcpy (&len, &buf[pos+4], 4);
+            pos += 8;
+            if (len > size - pos)
+                break;
+            if (id >= handles.size())
+                handles.resize (id+1, NULL);
+            handles[id] = texsys->get_texture_handle (ustring (&buf[pos], len));
+            pos += len;
+        } else if (tag == 'T' && pos + sizeof(pvt::TraceLookup) <= size) {
+            pvt::TraceLookup l;
+            memcpy (&l, &buf[pos], sizeof(l));
+            pos += sizeof(l);
+            if (l.file >= handles.size() || ! handles[l.file]) {
+                std::cerr << "testtex: lookup of an unknown texture at byte "
+                          << pos << " of the trace\n";
+                break;
+            }
+            lookups.push_back (l);
+        } else {
+            std::cerr << "testtex: trace is damaged or truncated at byte "
+                      << (pos-1) << "\n";
+            break;
+        }
+    }
+
+    const int nt = nthreads ? nthreads : Sysutil::hardware_concurrency();
+    std::cout << "Replaying " << lookups.size() << " lookups of "
+              << handles.size() << " textures, " << iters << " iterations, "
+              << nt << " threads\n";
+    Timer timer;
+    for (int iter = 0;  iter < iters;  ++iter) {
+        OIIO::thread_group threads;
+        for (int i = 0;  i < nt;  ++i)
+            threads.create_thread (OIIO::bind (replay_thread, &lookups,
+                                               &handles,
+                                               lookups.size() * i / nt,
+                                               lookups.size() * (i+1) / nt));
+        threads.join_all ();
+    }
+    double time = timer();
+
+    long long calls = 0, microcache_misses = 0, bytes_read = 0;
+    int cache_misses = 0, tiles_created = 0;
+    float fileio_time = 0.0f;
+    texsys->getattribute ("stat:find_tile_calls", TypeDesc::INT64, &calls);
+    texsys->getattribute ("stat:find_tile_microcache_misses", TypeDesc::INT64,
+                          &microcache_misses);
+    texsys->getattribute ("stat:find_tile_cache_misses", TypeDesc::INT,
+                          &cache_misses);
+    texsys->getattribute ("stat:tiles_created", TypeDesc::INT, &tiles_created);
+    texsys->getattribute ("stat:bytes_read", TypeDesc::INT64, &bytes_read);
+    texsys->getattribute ("stat:fileio_time", TypeDesc::FLOAT, &fileio_time);
+    double nlookups = double(lookups.size()) * iters;
+    std::cout << Strutil::format ("Replay time: %s, %.3f Mlookups/s\n",
+                                  Strutil::timeintervalformat (time, 2),
+                                  time > 0.0 ? nlookups / time * 1.0e-6 : 0.0);
+    std::cout << Strutil::format ("  tile lookups %lld, microcache hit rate %.2f%%, "
+                                  "cache hit rate %.2f%%\n", calls,
+                                  calls ? 100.0 * (calls - microcache_misses) / calls : 0.0,
+                                  calls ? 100.0 * (calls - cache_misses) / calls : 0.0);
+    std::cout << Strutil::format ("  tiles read %d, %s read, I/O time %s\n",
+                                  tiles_created, Strutil::memformat (bytes_read),
+                                  Strutil::timeintervalformat (fileio_time, 2));
+}
+
+
+
 class GridImageInput : public ImageInput {
 public:
     GridImageInput () : m_miplevel(-1) { }
@@ -1112,6 +1241,8 @@ main (int argc, const char *argv[])
         texsys->attribute ("accept_unmipped", 0);
     texsys->attribute ("gray_to_rgb", gray_to_rgb);
     texsys->attribute ("flip_t", flip_t);
+    if (trace_filename.size())
+        texsys->attribute ("trace_file", trace_filename);
 
     if (test_construction) {
         Timer t;
@@ -1155,7 +1286,10 @@ main (int argc, const char *argv[])
     xform = persp * rot * trans * scale;
     xform.invert();
 
-    if (threadtimes) {
+    if (replay_filename.size()) {
+        test_replay ();
+
+    } else if (threadtimes) {
         // If the --iters flag was used, do that number of iterations total
         // (divided among the threads). If not supplied (iters will be 1),
         // then use a large constant *per thread*.
@@ -32,11 +32,13 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <memory>
 
 #include <boost/regex.hpp>
 #include <boost/thread/tss.hpp>
 
 #include <tiffio.h>
+#include <zlib.h>
 
 #include "OpenImageIO/dassert.h"
 #include "OpenImageIO/typedesc.h"
@@ -45,6 +47,8 @@
 #include "OpenImageIO/strutil.h"
 #include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/fmath.h"
+#include "OpenImageIO/parallel.h"
+#include "../libOpenImageIO/palette_pvt.h"
 
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
@@ -91,6 +95,13 @@ struct TIFF_tag_info {
 
 
 
+// Open a TIFF through a Filesystem::IOProxy, with the usual TIFFOpen
+// modes (also used by TIFFOutput).
+TIFF *oiio_tiff_open_proxy (const std::string &name, const char *mode,
+                            Filesystem::IOProxy *io);
+
+
+
 class TIFFInput : public ImageInput {
 public:
     TIFFInput ();
@@ -99,7 +110,9 @@ public:
     virtual bool valid_file (const std::string &filename) const;
     virtual int supports (string_view feature) const {
         return (feature == "exif"
-             || feature == "iptc");
+             || feature == "iptc"
+             || feature == "ioproxy"
+             || (feature == "concurrent_tiles" && m_tif && TIFFIsTiled (m_tif)));
         // N.B. No support for arbitrary metadata.
     }
     virtual bool open (const std::string &name, ImageSpec &newspec);
@@ -117,6 +130,11 @@ public:
     virtual bool seek_subimage (int subimage, int miplevel, ImageSpec &newspec);
     virtual bool read_native_scanline (int y, int z, void *data);
     virtual bool read_native_tile (int x, int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
+    virtual bool read_native_tiles (int xbegin, int xend, int ybegin, int yend,
+                                    int zbegin, int zend, void *data);
+    virtual bool raw_pixel_layout (int64_t &offset, stride_t &ystride);
     virtual bool read_scanline (int y, int z, TypeDesc format, void *data,
                                 stride_t xstride);
     virtual bool read_scanlines (int ybegin, int yend, int z,
@@ -129,9 +147,16 @@ public:
                              int zbegin, int zend, int chbegin, int chend,
                              TypeDesc format, void *data,
                              stride_t xstride, stride_t ystride, stride_t zstride);
+    virtual bool read_tiles_concurrent (int subimage, int miplevel,
+                                        int xbegin, int xend,
+                                        int ybegin, int yend,
+                                        int zbegin, int zend,
+                                        int chbegin, int chend,
+                                        TypeDesc format, void *data);
 
 private:
     TIFF *m_tif;                     ///< libtiff handle
+    Filesystem::IOProxy *m_io;       ///< Caller's I/O proxy, if any
     std::string m_filename;          ///< Stash the filename
     std::vector<unsigned char> m_scratch; ///< Scratch space for us to use
     std::vector<unsigned char> m_scratch2; ///< More scratch
@@ -151,11 +176,29 @@ private:
     unsigned short m_compression;    ///< TIFF compression tag
     unsigned short m_inputchannels;  ///< Channels in the file (careful with CMYK)
     std::vector<unsigned short> m_colormap;  ///< Color map for palette images
+    palette_pvt::Palette m_palette;  ///< 8 bit m_colormap, for <= 8 bit indices
     std::vector<uint32_t> m_rgbadata; ///< Sometimes we punt
 
+    // Everything read_tiles_concurrent needs to know about one directory,
+    // captured by seek_subimage, so that it never touches m_tif, m_spec,
+    // or anything else another thread may be changing.  Tiles are fetched
+    // with pread, from m_io or from a second handle on the file.
+    struct ConcurrentLevel {
+        ImageSpec spec;
+        bool compressed;                  ///< Zip (otherwise uncompressed)
+        int predictor;
+        bool byteswapped;
+        std::vector<uint64_t> offsets;    ///< File offset of each tile
+        std::vector<uint64_t> bytecounts; ///< Stored size of each tile
+    };
+    std::vector<std::unique_ptr<ConcurrentLevel> > m_levels; ///< By directory
+    std::unique_ptr<Filesystem::IOProxy> m_preader; ///< pread handle
+    spin_mutex m_levels_mutex;       ///< Guards m_levels and m_preader
+
     // Reset everything to initial state
     void init () {
         m_tif = NULL;
+        m_io = NULL;
         m_subimage = -1;
         m_emulate_mipmap = false;
         m_keep_unassociated_alpha = false;
@@ -165,6 +208,20 @@ private:
         m_testopenconfig = false;
         m_colormap.clear();
         m_use_rgba_interface = false;
+        m_levels.clear ();
+        m_preader.reset ();
+    }
+
+    // Open m_filename, or m_io if we were given a proxy, for reading.
+    TIFF *open_tif () {
+        if (m_io)
+            return oiio_tiff_open_proxy (m_filename, "rm", m_io);
+#ifdef _WIN32
+        std::wstring wfilename = Strutil::utf8_to_utf16 (m_filename);
+        return TIFFOpenW (wfilename.c_str(), "rm");
+#else
+        return TIFFOpen (m_filename.c_str(), "rm");
+#endif
     }
 
     void close_tif () {
@@ -186,6 +243,12 @@ private:
                              const unsigned char *separate,
                              unsigned char *contig);
 
+    // Read scanlines [y0,y1) (relative to the data window) of a separate
+    // planarconfig file, one whole plane after another, and interleave
+    // them into data in one pass.  Return false (having read nothing) if
+    // the file needs conversions that only read_native_scanline does.
+    bool read_separate_scanlines (int y0, int y1, void *data, bool &ok);
+
     // Convert palette to RGB
     void palette_to_rgb (int n, const unsigned char *palettepels,
                          unsigned char *rgb);
@@ -197,6 +260,21 @@ private:
 
     void invert_photometric (int n, void *data);
 
+    // Can read_native_scanlines/read_native_tiles fetch the raw zip
+    // chunks and decompress them in parallel themselves?  If so, also
+    // return the file's predictor.
+    bool parallel_decode_ok (int &predictor) const;
+
+    // Decompress one raw zip strip or tile of nrows rows, each `width`
+    // pixels wide, into out, undoing the predictor and byte swapping so
+    // that the result matches what TIFFReadEncodedStrip/Tile would give.
+    bool decode_chunk (const std::vector<unsigned char> &raw, int predictor,
+                       int width, int nrows, unsigned char *out) const;
+
+    // If the current directory is tiled in a way read_tiles_concurrent
+    // can decode on its own, remember what it needs in m_levels.
+    void capture_concurrent_level ();
+
     // Calling TIFFGetField (tif, tag, &dest) is supposed to work fine for
     // simple types... as long as the tag types in the file are the correct
     // advertised types.  But for some types -- which we never expect, but
@@ -305,6 +383,9 @@ OIIO_EXPORT ImageInput *tiff_input_imageio_create () { return new TIFFInput; }
 OIIO_EXPORT const char * tiff_input_extensions[] = {
     "tiff", "tif", "tx", "env", "sm", "vsm", NULL
 };
+OIIO_EXPORT const char * tiff_input_magic[] = {
+    "49492a00", "4d4d002a", "49492b00", "4d4d002b", NULL
+};
 
 OIIO_PLUGIN_EXPORTS_END
 
@@ -355,6 +436,65 @@ oiio_tiff_set_error_handler ()
 
 
 
+// libtiff client I/O procedures for files accessed through an IOProxy,
+// which is the thandle_t.  The caller owns the proxy, so closing the
+// TIFF doesn't close it.
+static tsize_t
+proxy_readproc (thandle_t handle, tdata_t data, tsize_t size)
+{
+    return (tsize_t) ((Filesystem::IOProxy *)handle)->read (data, size_t(size));
+}
+
+static tsize_t
+proxy_writeproc (thandle_t handle, tdata_t data, tsize_t size)
+{
+    return (tsize_t) ((Filesystem::IOProxy *)handle)->write (data, size_t(size));
+}
+
+static toff_t
+proxy_seekproc (thandle_t handle, toff_t offset, int origin)
+{
+    Filesystem::IOProxy *io = (Filesystem::IOProxy *)handle;
+    return io->seek (int64_t(offset), origin) ? toff_t(io->tell()) : toff_t(-1);
+}
+
+static int
+proxy_closeproc (thandle_t handle)
+{
+    return 0;
+}
+
+static toff_t
+proxy_sizeproc (thandle_t handle)
+{
+    return toff_t (((Filesystem::IOProxy *)handle)->size());
+}
+
+static int
+proxy_mapproc (thandle_t handle, tdata_t *base, toff_t *size)
+{
+    return 0;   // no memory mapping
+}
+
+static void
+proxy_unmapproc (thandle_t handle, tdata_t base, toff_t size)
+{
+}
+
+
+
+TIFF *
+oiio_tiff_open_proxy (const std::string &name, const char *mode,
+                      Filesystem::IOProxy *io)
+{
+    return TIFFClientOpen (name.c_str(), mode, (thandle_t)io,
+                           proxy_readproc, proxy_writeproc, proxy_seekproc,
+                           proxy_closeproc, proxy_sizeproc,
+                           proxy_mapproc, proxy_unmapproc);
+}
+
+
+
 struct CompressionCode {
     int code;
     const char *name;
@@ -467,6 +607,10 @@ TIFFInput::open (const std::string &name, ImageSpec &newspec,
     // OIIO components.
     if (config.get_int_attribute("oiio:DebugOpenConfig!", 0))
         m_testopenconfig = true;
+    const ImageIOParameter *p = config.find_attribute ("oiio:ioproxy",
+                                                       TypeDesc::PTR);
+    if (p)
+        m_io = *(Filesystem::IOProxy **)p->data();
     return open (name, newspec);
 }
 
@@ -500,12 +644,7 @@ TIFFInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
     bool read_meta = !(m_emulate_mipmap && m_tif && m_subimage >= 0);
 
     if (! m_tif) {
-#ifdef _WIN32
-        std::wstring wfilename = Strutil::utf8_to_utf16 (m_filename);
-        m_tif = TIFFOpenW (wfilename.c_str(), "rm");
-#else
-        m_tif = TIFFOpen (m_filename.c_str(), "rm");
-#endif
+        m_tif = open_tif ();
         if (m_tif == NULL) {
             std::string e = oiio_tiff_last_error();
             error ("Could not open file: %s", e.length() ? e : m_filename);
@@ -518,6 +657,7 @@ TIFFInput::seek_subimage (int subimage, int miplevel, ImageSpec &newspec)
     if (TIFFSetDirectory (m_tif, subimage)) {
         m_subimage = subimage;
         readspec (read_meta);
+        capture_concurrent_level ();
         // OK, some edge cases we just don't handle. For those, fall back on
         // the TIFFRGBA interface.
         if (m_compression == COMPRESSION_JPEG || m_compression == COMPRESSION_OJPEG ||
@@ -810,6 +950,10 @@ TIFFInput::readspec (bool read_meta)
         m_colormap.insert (m_colormap.end(), r, r + (1 << m_bitspersample));
         m_colormap.insert (m_colormap.end(), g, g + (1 << m_bitspersample));
         m_colormap.insert (m_colormap.end(), b, b + (1 << m_bitspersample));
+        m_palette.clear ();
+        if (m_bitspersample <= 8)
+            for (int i = 0, n = 1 << m_bitspersample; i < n; ++i)
+                m_palette.set (i, r[i] / 257, g[i] / 257, b[i] / 257);
         // Palette TIFF images are always 3 channels (to the client)
         m_spec.nchannels = 3;
         m_spec.default_channel_names ();
@@ -963,12 +1107,7 @@ TIFFInput::readspec (bool read_meta)
         // I'm not sure what state TIFFReadEXIFDirectory leaves us.
         // So to be safe, close and re-seek.
         TIFFClose (m_tif);
-#ifdef _WIN32
-        std::wstring wfilename = Strutil::utf8_to_utf16 (m_filename);
-        m_tif = TIFFOpenW (wfilename.c_str(), "rm");
-#else
-        m_tif = TIFFOpen (m_filename.c_str(), "rm");
-#endif
+        m_tif = open_tif ();
         TIFFSetDirectory (m_tif, m_subimage);
 
         // A few tidbits to look for
@@ -1098,12 +1237,10 @@ TIFFInput::separate_to_contig (int nplanes, int nvals,
                                const unsigned char *separate,
                                unsigned char *contig)
 {
-    int channelbytes = m_spec.channel_bytes();
-    for (int p = 0;  p < nvals;  ++p)                     // loop over pixels
-        for (int c = 0;  c < nplanes;  ++c)   // loop over channels
-            for (int i = 0;  i < channelbytes;  ++i)  // loop over data bytes
-                contig[(p*nplanes+c)*channelbytes+i] =
-                    separate[(c*nvals+p)*channelbytes+i];
+    // Note: only the size of m_spec.format matters, and common channel
+    // counts and sizes get vectorized transposes.
+    planar_to_interleaved (nplanes, nvals, 1, 1, separate, m_spec.format,
+                           AutoStride, contig, m_spec.format, 1);
 }
 
 
@@ -1117,6 +1254,11 @@ TIFFInput::palette_to_rgb (int n, const unsigned char *palettepels,
     int highest = entries-1;
     DASSERT (m_spec.nchannels == 3);
     DASSERT (m_colormap.size() == 3*entries);
+    if (m_bitspersample <= 8 && vals_per_byte * m_bitspersample == 8) {
+        palette_pvt::expand_packed (m_palette, palettepels, m_bitspersample,
+                                    n, 3, rgb);
+        return;
+    }
     for (int x = 0;  x < n;  ++x) {
         int i = palettepels[x/vals_per_byte];
         i >>= (m_bitspersample * (vals_per_byte - 1 - (x % vals_per_byte)));
@@ -1216,6 +1358,40 @@ cmyk_to_rgb (int n, const T *cmyk, size_t cmyk_stride,
 
 
 
+bool
+TIFFInput::raw_pixel_layout (int64_t &offset, stride_t &ystride)
+{
+    // Only uncompressed, contiguous, native-byte-order strips of whole
+    // 8/16/32/64 bit samples that need no conversion on our side.
+    // Offsets into a proxy's stream mean nothing to a caller that maps
+    // the named file.
+    if (! m_tif || m_io || TIFFIsTiled (m_tif) || m_use_rgba_interface ||
+        m_compression != COMPRESSION_NONE || m_separate ||
+        m_convert_alpha || TIFFIsByteSwapped (m_tif) ||
+        (m_photometric != PHOTOMETRIC_MINISBLACK &&
+         m_photometric != PHOTOMETRIC_RGB) ||
+        m_inputchannels != m_spec.nchannels || m_spec.depth != 1 ||
+        m_spec.channelformats.size() ||
+        m_bitspersample != 8 * m_spec.format.size())
+        return false;
+    // The strips must follow one another with no gaps.
+    toff_t *offsets = NULL;
+    if (! TIFFGetField (m_tif, TIFFTAG_STRIPOFFSETS, &offsets) || ! offsets)
+        return false;
+    int rowsperstrip = m_spec.height;
+    TIFFGetField (m_tif, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
+    stride_t sl = (stride_t) m_spec.scanline_bytes();
+    uint64_t stripbytes = uint64_t(std::min (rowsperstrip, m_spec.height)) * sl;
+    for (tstrip_t s = 1, n = TIFFNumberOfStrips (m_tif);  s < n;  ++s)
+        if (uint64_t(offsets[s]) != uint64_t(offsets[s-1]) + stripbytes)
+            return false;
+    offset = (int64_t) offsets[0];
+    ystride = sl;
+    return true;
+}
+
+
+
 bool
 TIFFInput::read_native_scanline (int y, int z, void *data)
 {
@@ -1255,8 +1431,11 @@ TIFFInput::read_native_scanline (int y, int z, void *data)
             ImageSpec dummyspec;
             int old_subimage = current_subimage();
             int old_miplevel = current_miplevel();
-            if (! close ()  ||
-                ! open (m_filename, dummyspec)  ||
+            Filesystem::IOProxy *io = m_io;   // close() forgets it
+            if (! close ())
+                return false;
+            m_io = io;
+            if (! open (m_filename, dummyspec)  ||
                 ! seek_subimage (old_subimage, old_miplevel, dummyspec)) {
                 return false;    // Somehow, the re-open failed
             }
@@ -1452,6 +1631,443 @@ TIFFInput::read_native_tile (int x, int y, int z, void *data)
 
 
 
+bool
+TIFFInput::parallel_decode_ok (int &predictor) const
+{
+#if TIFFLIB_VERSION >= 20111221
+    // Only zip compressed, contiguous chunks of whole 8/16/32 bit samples
+    // that need no palette, CMYK, or bit depth conversion.
+    if (! m_tif || threads() == 1 || m_use_rgba_interface || m_separate ||
+        (m_compression != COMPRESSION_ADOBE_DEFLATE &&
+         m_compression != COMPRESSION_DEFLATE) ||
+        m_photometric == PHOTOMETRIC_PALETTE ||
+        m_photometric == PHOTOMETRIC_SEPARATED ||
+        m_inputchannels != m_spec.nchannels ||
+        m_spec.channelformats.size() ||
+        m_bitspersample != 8 * m_spec.format.size() ||
+        (m_bitspersample != 8 && m_bitspersample != 16 &&
+         m_bitspersample != 32))
+        return false;
+    uint16 pred = PREDICTOR_NONE;
+    TIFFGetFieldDefaulted (m_tif, TIFFTAG_PREDICTOR, &pred);
+    predictor = pred;
+    return (predictor == PREDICTOR_NONE ||
+            predictor == PREDICTOR_HORIZONTAL ||
+            (predictor == PREDICTOR_FLOATINGPOINT &&
+             m_spec.format.basetype == TypeDesc::FLOAT));
+#else
+    return false;
+#endif
+}
+
+
+
+template<class T>
+static void
+undo_horizontal (T *v, size_t rowvals, size_t nrows, int nc)
+{
+    for (size_t r = 0;  r < nrows;  ++r, v += rowvals)
+        for (size_t i = nc;  i < rowvals;  ++i)
+            v[i] = (T)(v[i] + v[i-nc]);
+}
+
+
+
+// Decode one raw strip or tile of nrows rows of `width` pixels, each of
+// nc channels of bps bytes, into out.  Zip data is decompressed and has
+// its predictor undone; uncompressed data is just copied.  Either way
+// the samples end up in native byte order.
+static bool
+decode_tiff_chunk (const unsigned char *raw, size_t rawsize, bool compressed,
+                   int predictor, int nc, size_t bps, bool byteswapped,
+                   int width, int nrows, unsigned char *out)
+{
+    size_t rowvals = size_t(width) * nc;
+    size_t rowbytes = rowvals * bps;
+    if (! compressed) {
+        if (rawsize < rowbytes * nrows)
+            return false;
+        memcpy (out, raw, rowbytes * nrows);
+        predictor = PREDICTOR_NONE;
+    } else {
+        uLongf len = uLongf(rowbytes * nrows);
+        if (! rawsize || uncompress (out, &len, raw, uLong(rawsize)) != Z_OK ||
+            len != uLongf(rowbytes * nrows))
+            return false;
+    }
+    if (predictor == PREDICTOR_FLOATINGPOINT) {
+        // Undo the byte differencing, then put the byte planes (most
+        // significant first) back together.  The result is already in
+        // native byte order.
+        std::vector<unsigned char> tmp (rowbytes);
+        for (int r = 0;  r < nrows;  ++r) {
+            unsigned char *cp = out + r*rowbytes;
+            for (size_t i = nc;  i < rowbytes;  ++i)
+                cp[i] = (unsigned char)(cp[i] + cp[i-nc]);
+            memcpy (&tmp[0], cp, rowbytes);
+            for (size_t count = 0;  count < rowvals;  ++count)
+                for (size_t byte = 0;  byte < bps;  ++byte) {
+                    size_t plane = bigendian() ? byte : bps - byte - 1;
+                    cp[bps * count + byte] = tmp[plane * rowvals + count];
+                }
+        }
+        return true;
+    }
+    if (bps == 2 && byteswapped)
+        swap_endian ((unsigned short *)out, int(rowvals * nrows));
+    else if (bps == 4 && byteswapped)
+        swap_endian ((unsigned int *)out, int(rowvals * nrows));
+    if (predictor == PREDICTOR_HORIZONTAL) {
+        if (bps == 1)
+            undo_horizontal (out, rowvals, nrows, nc);
+        else if (bps == 2)
+            undo_horizontal ((unsigned short *)out, rowvals, nrows, nc);
+        else
+            undo_horizontal ((unsigned int *)out, rowvals, nrows, nc);
+    }
+    return true;
+}
+
+
+
+bool
+TIFFInput::decode_chunk (const std::vector<unsigned char> &raw,
+                         int predictor, int width, int nrows,
+                         unsigned char *out) const
+{
+    return decode_tiff_chunk (raw.size() ? &raw[0] : NULL, raw.size(), true,
+                              predictor, m_spec.nchannels,
+                              m_spec.format.size(), TIFFIsByteSwapped (m_tif),
+                              width, nrows, out);
+}
+
+
+
+void
+TIFFInput::capture_concurrent_level ()
+{
+#if TIFFLIB_VERSION >= 20111221
+    if (! TIFFIsTiled (m_tif) || m_use_rgba_interface || m_separate ||
+        (m_compression != COMPRESSION_NONE &&
+         m_compression != COMPRESSION_ADOBE_DEFLATE &&
+         m_compression != COMPRESSION_DEFLATE) ||
+        m_photometric == PHOTOMETRIC_PALETTE ||
+        m_photometric == PHOTOMETRIC_SEPARATED ||
+        m_photometric == PHOTOMETRIC_MINISWHITE || m_convert_alpha ||
+        m_inputchannels != m_spec.nchannels ||
+        m_spec.channelformats.size() ||
+        m_bitspersample != 8 * m_spec.format.size() ||
+        (m_bitspersample != 8 && m_bitspersample != 16 &&
+         m_bitspersample != 32))
+        return;
+    {
+        spin_lock lock (m_levels_mutex);
+        if (m_subimage < int(m_levels.size()) && m_levels[m_subimage])
+            return;   // already have it
+    }
+    bool compressed = (m_compression != COMPRESSION_NONE);
+    uint16 pred = PREDICTOR_NONE;
+    if (compressed)
+        TIFFGetFieldDefaulted (m_tif, TIFFTAG_PREDICTOR, &pred);
+    if (pred != PREDICTOR_NONE && pred != PREDICTOR_HORIZONTAL &&
+        ! (pred == PREDICTOR_FLOATINGPOINT &&
+           m_spec.format.basetype == TypeDesc::FLOAT))
+        return;
+    toff_t *offsets = NULL, *bytecounts = NULL;
+    if (! TIFFGetField (m_tif, TIFFTAG_TILEOFFSETS, &offsets) || ! offsets ||
+        ! TIFFGetField (m_tif, TIFFTAG_TILEBYTECOUNTS, &bytecounts) ||
+        ! bytecounts)
+        return;
+    std::unique_ptr<ConcurrentLevel> level (new ConcurrentLevel);
+    level->spec = m_spec;
+    level->compressed = compressed;
+    level->predictor = pred;
+    level->byteswapped = TIFFIsByteSwapped (m_tif);
+    ttile_t ntiles = TIFFNumberOfTiles (m_tif);
+    level->offsets.assign (offsets, offsets + ntiles);
+    level->bytecounts.assign (bytecounts, bytecounts + ntiles);
+
+    // Readers only look at m_preader after finding a level, so it must
+    // be in place before the level is published.
+    if (! m_io && ! m_preader) {
+        Filesystem::IOFile *f = new Filesystem::IOFile (m_filename,
+                                               Filesystem::IOProxy::Read);
+        if (! f->opened()) {
+            delete f;
+            return;
+        }
+        spin_lock lock (m_levels_mutex);
+        m_preader.reset (f);
+    }
+    spin_lock lock (m_levels_mutex);
+    if (m_subimage >= int(m_levels.size()))
+        m_levels.resize (m_subimage+1);
+    m_levels[m_subimage].swap (level);
+#endif
+}
+
+
+
+bool
+TIFFInput::read_separate_scanlines (int y0, int y1, void *data, bool &ok)
+{
+    if (! m_tif || ! m_separate || m_use_rgba_interface ||
+        m_photometric == PHOTOMETRIC_PALETTE ||
+        m_photometric == PHOTOMETRIC_SEPARATED ||
+        m_inputchannels != m_spec.nchannels || m_spec.depth > 1 ||
+        m_spec.channelformats.size() ||
+        m_bitspersample != 8 * m_spec.format.size() ||
+        (m_no_random_access && m_next_scanline > y0))
+        return false;
+    // Reading plane by plane means libtiff decodes each strip once,
+    // rather than restarting it for every line as it switches planes.
+    int nlines = y1 - y0;
+    size_t plane_bytes = size_t(m_spec.width) * m_spec.format.size();
+    m_scratch.resize (plane_bytes * nlines * m_spec.nchannels);
+    for (int c = 0;  c < m_spec.nchannels;  ++c) {
+        for (int y = y0;  y < y1;  ++y) {
+            if (TIFFReadScanline (m_tif, &m_scratch[(c*nlines + y-y0) * plane_bytes],
+                                  y, c) < 0) {
+                error ("%s", oiio_tiff_last_error());
+                ok = false;
+                return true;
+            }
+        }
+    }
+    m_next_scanline = y1;
+    ok = planar_to_interleaved (m_spec.nchannels, m_spec.width, nlines, 1,
+                                &m_scratch[0], m_spec.format, AutoStride,
+                                data, m_spec.format, threads());
+    if (m_photometric == PHOTOMETRIC_MINISWHITE)
+        invert_photometric (nlines * m_spec.width * m_spec.nchannels, data);
+    return true;
+}
+
+
+
+bool
+TIFFInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    // libtiff decompresses one strip at a time on the calling thread.
+    // For zip compressed strips, fetch the raw bytes of all the strips
+    // the range touches in order, decompress them in parallel, then copy
+    // out the requested scanlines.  Anything else goes through
+    // read_native_scanline one line at a time.
+    int predictor = PREDICTOR_NONE;
+    uint32 rowsperstrip = uint32(m_spec.height);
+    if (m_tif)
+        TIFFGetFieldDefaulted (m_tif, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
+    rowsperstrip = std::min (rowsperstrip, uint32(m_spec.height));
+    yend = std::min (yend, m_spec.y+m_spec.height);
+    int y0 = ybegin - m_spec.y, y1 = yend - m_spec.y;
+    bool ok = true;
+    if (y0 >= 0 && y1 > y0+1 && read_separate_scanlines (y0, y1, data, ok))
+        return ok;
+    if (y0 < 0 || y1 <= y0 || rowsperstrip < 1 || m_spec.depth > 1 ||
+        (y1-y0) <= int(rowsperstrip) || ! parallel_decode_ok (predictor))
+        return ImageInput::read_native_scanlines (ybegin, yend, z, data);
+
+    toff_t *bytecounts = NULL;
+    if (! TIFFGetField (m_tif, TIFFTAG_STRIPBYTECOUNTS, &bytecounts) ||
+        ! bytecounts)
+        return ImageInput::read_native_scanlines (ybegin, yend, z, data);
+    int sbegin = y0 / rowsperstrip, send = (y1 - 1) / rowsperstrip + 1;
+    int nstrips = send - sbegin;
+    std::vector<std::vector<unsigned char> > raw (nstrips);
+    for (int s = 0;  s < nstrips;  ++s) {
+        tstrip_t strip = tstrip_t(sbegin + s);
+        raw[s].resize (size_t(bytecounts[strip]));
+        if (raw[s].size() &&
+            TIFFReadRawStrip (m_tif, strip, &raw[s][0],
+                              tmsize_t(raw[s].size())) < 0) {
+            error ("%s", oiio_tiff_last_error());
+            return false;
+        }
+    }
+
+    size_t sl = m_spec.scanline_bytes (true);
+    atomic_int failed (0);
+    parallel_for (0, nstrips, [&](int64_t s){
+        int sy0 = int(sbegin + s) * rowsperstrip;
+        int nrows = std::min (int(rowsperstrip), m_spec.height - sy0);
+        int first = std::max (sy0, y0), last = std::min (sy0 + nrows, y1);
+        unsigned char *dst = (unsigned char *)data + (first - y0) * sl;
+        // Strips wholly inside the range decompress straight into the
+        // caller's buffer; the partial ones at either end go via a
+        // temporary.
+        std::vector<unsigned char> tmp;
+        unsigned char *out = dst;
+        if (first != sy0 || last != sy0 + nrows) {
+            tmp.resize (nrows * sl);
+            out = &tmp[0];
+        }
+        if (! decode_chunk (raw[s], predictor, m_spec.width, nrows, out)) {
+            ++failed;
+            return;
+        }
+        std::vector<unsigned char>().swap (raw[s]);
+        if (out != dst)
+            memcpy (dst, out + (first - sy0) * sl, (last - first) * sl);
+    });
+    if (failed) {
+        error ("zip decompression failed");
+        return false;
+    }
+    m_next_scanline = y1;
+    if (m_photometric == PHOTOMETRIC_MINISWHITE)
+        invert_photometric ((y1-y0) * m_spec.width * m_spec.nchannels, data);
+    return true;
+}
+
+
+
+bool
+TIFFInput::read_native_tiles (int xbegin, int xend, int ybegin, int yend,
+                              int zbegin, int zend, void *data)
+{
+    // Like read_native_scanlines: fetch the raw zip tiles in order,
+    // decompress them in parallel, and copy each into place.
+    int predictor = PREDICTOR_NONE;
+    if (! m_spec.valid_tile_range (xbegin, xend, ybegin, yend, zbegin, zend))
+        return false;
+    int tw = m_spec.tile_width, th = m_spec.tile_height;
+    int td = std::max (1, m_spec.tile_depth);
+    int ntx = (xend - xbegin + tw - 1) / tw;
+    int nty = (yend - ybegin + th - 1) / th;
+    int ntz = (zend - zbegin + td - 1) / td;
+    int ntiles = ntx * nty * ntz;
+    toff_t *bytecounts = NULL;
+    if (ntiles < 2 || ! parallel_decode_ok (predictor) ||
+        ! TIFFGetField (m_tif, TIFFTAG_TILEBYTECOUNTS, &bytecounts) ||
+        ! bytecounts)
+        return ImageInput::read_native_tiles (xbegin, xend, ybegin, yend,
+                                              zbegin, zend, data);
+
+    std::vector<std::vector<unsigned char> > raw (ntiles);
+    for (int t = 0;  t < ntiles;  ++t) {
+        int tx = t % ntx, ty = (t / ntx) % nty, tz = t / (ntx*nty);
+        ttile_t tile = TIFFComputeTile (m_tif, xbegin + tx*tw - m_spec.x,
+                                        ybegin + ty*th - m_spec.y,
+                                        zbegin + tz*td - m_spec.z, 0);
+        raw[t].resize (size_t(bytecounts[tile]));
+        if (raw[t].size() &&
+            TIFFReadRawTile (m_tif, tile, &raw[t][0],
+                             tmsize_t(raw[t].size())) < 0) {
+            error ("%s", oiio_tiff_last_error());
+            return false;
+        }
+    }
+
+    stride_t pixel_bytes = (stride_t) m_spec.pixel_bytes (true);
+    stride_t ystride = (xend-xbegin) * pixel_bytes;
+    stride_t zstride = (yend-ybegin) * ystride;
+    atomic_int failed (0);
+    parallel_for (0, ntiles, [&](int64_t t){
+        int tx = int(t % ntx), ty = int((t / ntx) % nty), tz = int(t / (ntx*nty));
+        int x = xbegin + tx * tw, y = ybegin + ty * th, z = zbegin + tz * td;
+        std::vector<unsigned char> tile (m_spec.tile_bytes (true));
+        if (! decode_chunk (raw[t], predictor, tw, th * td, &tile[0])) {
+            ++failed;
+            return;
+        }
+        std::vector<unsigned char>().swap (raw[t]);
+        // Tiles at the image edges only copy the part inside the range.
+        copy_image (m_spec.nchannels, std::min (tw, xend-x),
+                    std::min (th, yend-y), std::min (td, zend-z),
+                    &tile[0], pixel_bytes, pixel_bytes, tw*pixel_bytes,
+                    tw*th*pixel_bytes,
+                    (char *)data + (z-zbegin)*zstride + (y-ybegin)*ystride
+                        + (x-xbegin)*pixel_bytes,
+                    pixel_bytes, ystride, zstride);
+    });
+    if (failed) {
+        error ("zip decompression failed");
+        return false;
+    }
+    if (m_photometric == PHOTOMETRIC_MINISWHITE)
+        invert_photometric ((xend-xbegin) * (yend-ybegin) * (zend-zbegin)
+                            * m_spec.nchannels, data);
+    return true;
+}
+
+
+
+bool
+TIFFInput::read_tiles_concurrent (int subimage, int miplevel,
+                                  int xbegin, int xend, int ybegin, int yend,
+                                  int zbegin, int zend, int chbegin, int chend,
+                                  TypeDesc format, void *data)
+{
+    // N.B. Only the captured ConcurrentLevel may be used here, never
+    // m_tif, m_spec, or anything else that seek_subimage changes.
+    int dir = m_emulate_mipmap ? (subimage == 0 ? miplevel : -1)
+                               : (miplevel == 0 ? subimage : -1);
+    const ConcurrentLevel *level = NULL;
+    Filesystem::IOProxy *io = NULL;
+    {
+        spin_lock lock (m_levels_mutex);
+        if (dir >= 0 && dir < int(m_levels.size()))
+            level = m_levels[dir].get();
+        io = m_io ? m_io : m_preader.get();
+    }
+    if (! level || ! io)
+        return false;
+    const ImageSpec &spec (level->spec);
+    chend = clamp (chend, chbegin+1, spec.nchannels);
+    int nchans = chend - chbegin;
+    int tw = spec.tile_width, th = spec.tile_height;
+    int td = std::max (1, spec.tile_depth);
+    if ((xbegin-spec.x) % tw || (ybegin-spec.y) % th || (zbegin-spec.z) % td ||
+        (xend-xbegin) % tw || (yend-ybegin) % th || (zend-zbegin) % td ||
+        xbegin < spec.x || ybegin < spec.y || zbegin < spec.z)
+        return false;
+    int ntx = (spec.width + tw - 1) / tw;
+    int nty = (spec.height + th - 1) / th;
+    int ntz = (std::max (1, spec.depth) + td - 1) / td;
+    int tx0 = (xbegin-spec.x) / tw, tx1 = tx0 + (xend-xbegin) / tw;
+    int ty0 = (ybegin-spec.y) / th, ty1 = ty0 + (yend-ybegin) / th;
+    int tz0 = (zbegin-spec.z) / td, tz1 = tz0 + (zend-zbegin) / td;
+    if (tx1 > ntx || ty1 > nty || tz1 > ntz)
+        return false;
+
+    if (format == TypeDesc::UNKNOWN)
+        format = spec.format;
+    size_t bps = spec.format.size();
+    stride_t pixelbytes = stride_t (spec.nchannels * bps);
+    stride_t opixelbytes = stride_t (nchans * format.size());
+    stride_t ystride = (xend-xbegin) * opixelbytes;
+    stride_t zstride = (yend-ybegin) * ystride;
+    std::vector<unsigned char> raw, tile (size_t(tw) * th * td * pixelbytes);
+    for (int tz = tz0;  tz < tz1;  ++tz) {
+        for (int ty = ty0;  ty < ty1;  ++ty) {
+            for (int tx = tx0;  tx < tx1;  ++tx) {
+                size_t t = (size_t(tz) * nty + ty) * ntx + tx;
+                if (t >= level->offsets.size())
+                    return false;
+                raw.resize (size_t(level->bytecounts[t]));
+                if (raw.empty() ||
+                    io->pread (&raw[0], raw.size(), int64_t(level->offsets[t]))
+                        != raw.size() ||
+                    ! decode_tiff_chunk (&raw[0], raw.size(), level->compressed,
+                                         level->predictor, spec.nchannels, bps,
+                                         level->byteswapped, tw, th * td,
+                                         &tile[0]))
+                    return false;
+                char *dst = (char *)data + (tz-tz0) * td * zstride
+                          + (ty-ty0) * th * ystride + (tx-tx0) * tw * opixelbytes;
+                if (! convert_image (nchans, tw, th, td, &tile[chbegin*bps],
+                                     spec.format, pixelbytes, tw*pixelbytes,
+                                     tw*th*pixelbytes, dst, format,
+                                     opixelbytes, ystride, zstride))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+
 bool TIFFInput::read_scanline (int y, int z, TypeDesc format, void *data,
                                stride_t xstride)
 {
@@ -37,6 +37,7 @@
 #include <memory>
 
 #include <tiffio.h>
+#include <zlib.h>
 
 // Some EXIF tags that don't seem to be in tiff.h
 #ifndef EXIFTAG_SECURITYCLASSIFICATION
@@ -53,6 +54,7 @@
 #include "OpenImageIO/sysutil.h"
 #include "OpenImageIO/timer.h"
 #include "OpenImageIO/fmath.h"
+#include "OpenImageIO/parallel.h"
 
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
@@ -79,9 +81,18 @@ public:
     virtual bool close ();
     virtual bool write_scanline (int y, int z, TypeDesc format,
                                  const void *data, stride_t xstride);
+    virtual bool write_scanlines (int ybegin, int yend, int z,
+                                  TypeDesc format, const void *data,
+                                  stride_t xstride=AutoStride,
+                                  stride_t ystride=AutoStride);
     virtual bool write_tile (int x, int y, int z,
                              TypeDesc format, const void *data,
                              stride_t xstride, stride_t ystride, stride_t zstride);
+    virtual bool write_tiles (int xbegin, int xend, int ybegin, int yend,
+                              int zbegin, int zend, TypeDesc format,
+                              const void *data, stride_t xstride=AutoStride,
+                              stride_t ystride=AutoStride,
+                              stride_t zstride=AutoStride);
 
 private:
     TIFF *m_tif;
@@ -114,6 +125,16 @@ private:
     bool put_parameter (const std::string &name, TypeDesc type,
                         const void *data);
     bool write_exif_data ();
+    // Predict (if the file calls for it) and zip- or LZW-compress one
+    // native strip or tile, whose rows are `width` pixels wide, in place
+    // in chunk, leaving the compressed bytes in out, as libtiff's codecs
+    // would.  Safe to call from several threads at once.
+    bool compress_chunk (std::vector<unsigned char> &chunk, int width,
+                         int predictor, int zipquality,
+                         std::vector<unsigned char> &out) const;
+    // Can write_scanlines/write_tiles compress whole strips or tiles
+    // themselves?  If so, also return the predictor and zip quality.
+    bool parallel_encode_ok (int &predictor, int &zipquality) const;
 };
 
 
@@ -141,6 +162,8 @@ OIIO_PLUGIN_EXPORTS_END
 
 
 extern std::string & oiio_tiff_last_error ();
+extern TIFF *oiio_tiff_open_proxy (const std::string &name, const char *mode,
+                                   Filesystem::IOProxy *io);
 extern void oiio_tiff_set_error_handler ();
 
 
@@ -236,6 +259,8 @@ TIFFOutput::supports (string_view feature) const
     // N.B. TIFF doesn't support "negativeorigin"
     if (feature == "exif")
         return true;
+    if (feature == "ioproxy")
+        return true;
     if (feature == "iptc")
         return true;
     // N.B. TIFF doesn't support arbitrary metadata.
@@ -279,13 +304,20 @@ TIFFOutput::open (const std::string &name, const ImageSpec &userspec,
     if (m_spec.depth < 1)
         m_spec.depth = 1;
 
-    // Open the file
+    // Open the file, or the caller's I/O proxy
+    const ImageIOParameter *p = m_spec.find_attribute ("oiio:ioproxy",
+                                                       TypeDesc::PTR);
+    if (p) {
+        Filesystem::IOProxy *io = *(Filesystem::IOProxy **)p->data();
+        m_tif = oiio_tiff_open_proxy (name, mode == AppendSubimage ? "a" : "w", io);
+    } else {
 #ifdef _WIN32
-    std::wstring wname = Strutil::utf8_to_utf16 (name);
-    m_tif = TIFFOpenW (wname.c_str(), mode == AppendSubimage ? "a" : "w");
+        std::wstring wname = Strutil::utf8_to_utf16 (name);
+        m_tif = TIFFOpenW (wname.c_str(), mode == AppendSubimage ? "a" : "w");
 #else
-    m_tif = TIFFOpen (name.c_str(), mode == AppendSubimage ? "a" : "w");
+        m_tif = TIFFOpen (name.c_str(), mode == AppendSubimage ? "a" : "w");
 #endif
+    }
     if (! m_tif) {
         error ("Can't open \"%s\" for output.", name.c_str());
         return false;
@@ -1058,5 +1090,349 @@ TIFFOutput::write_tile (int x, int y, int z,
     return true;
 }
 
+
+
+// LZW-encode n bytes the way libtiff's encoder does: MSB-first codes
+// of 9 to 12 bits, with the TIFF "early change" of code width, starting
+// with a clear code and ending with an end-of-information code.
+static void
+lzw_encode (const unsigned char *in, size_t n, std::vector<unsigned char> &out)
+{
+    enum { CODE_CLEAR = 256, CODE_EOI = 257, CODE_FIRST = 258,
+           BITS_MIN = 9, BITS_MAX = 12, CODE_MAX = (1<<BITS_MAX)-1,
+           HSIZE = 9001 };
+    // Open-addressed hash of (prefix code, next byte) -> code
+    std::vector<int32_t> hkey (HSIZE);
+    std::vector<uint16_t> hcode (HSIZE);
+    int nbits = BITS_MIN, maxcode = (1<<BITS_MIN)-1, free_ent = CODE_FIRST;
+    unsigned long nextdata = 0;
+    int nextbits = 0;
+    out.clear ();
+    out.reserve (n/2 + 16);
+    auto put = [&](int code) {
+        nextdata = (nextdata << nbits) | (unsigned long)code;
+        nextbits += nbits;
+        while (nextbits >= 8) {
+            out.push_back ((unsigned char)(nextdata >> (nextbits-8)));
+            nextbits -= 8;
+        }
+    };
+    auto clear = [&](){
+        std::fill (hkey.begin(), hkey.end(), -1);
+        put (CODE_CLEAR);
+        nbits = BITS_MIN;
+        maxcode = (1<<BITS_MIN)-1;
+        free_ent = CODE_FIRST;
+    };
+    // Account for a new table entry, resetting or widening the codes
+    // just when the decoder will.
+    auto grow = [&](){
+        if (++free_ent == CODE_MAX-1) {
+            clear ();
+        } else if (free_ent > maxcode) {
+            ++nbits;
+            maxcode = (1<<nbits)-1;
+        }
+    };
+    clear ();
+    if (n) {
+        int ent = in[0];
+        for (size_t i = 1;  i < n;  ++i) {
+            int c = in[i];
+            int32_t key = (ent << 8) | c;
+            size_t h = size_t(key) % HSIZE;
+            while (hkey[h] != -1 && hkey[h] != key)
+                h = (h + 1) % HSIZE;
+            if (hkey[h] == key) {
+                ent = hcode[h];
+                continue;
+            }
+            put (ent);
+            hkey[h] = key;
+            hcode[h] = (uint16_t) free_ent;
+            grow ();
+            ent = c;
+        }
+        put (ent);
+        grow ();
+    }
+    put (CODE_EOI);
+    if (nextbits > 0)
+        out.push_back ((unsigned char)(nextdata << (8-nextbits)));
+}
+
+
+
+bool
+TIFFOutput::compress_chunk (std::vector<unsigned char> &tile, int width,
+                            int predictor, int zipquality,
+                            std::vector<unsigned char> &out) const
+{
+    // The predictors work on one row of the chunk at a time, differencing
+    // each sample from the same channel of the previous pixel.
+    int nc = m_spec.nchannels;
+    size_t bps = m_spec.format.size();
+    size_t rowvals = size_t(width) * nc;
+    size_t rowbytes = rowvals * bps;
+    size_t nrows = tile.size() / rowbytes;
+    if (predictor == PREDICTOR_HORIZONTAL) {
+        for (size_t r = 0;  r < nrows;  ++r) {
+            if (bps == 1) {
+                unsigned char *v = &tile[r*rowbytes];
+                for (size_t i = rowvals-1;  i >= size_t(nc) && i < rowvals;  --i)
+                    v[i] = (unsigned char)(v[i] - v[i-nc]);
+            } else {
+                unsigned short *v = (unsigned short *)&tile[r*rowbytes];
+                for (size_t i = rowvals-1;  i >= size_t(nc) && i < rowvals;  --i)
+                    v[i] = (unsigned short)(v[i] - v[i-nc]);
+            }
+        }
+    } else if (predictor == PREDICTOR_FLOATINGPOINT) {
+        // Split each row into byte planes, most significant first, and
+        // difference the bytes.
+        std::vector<unsigned char> tmp (rowbytes);
+        for (size_t r = 0;  r < nrows;  ++r) {
+            unsigned char *cp = &tile[r*rowbytes];
+            memcpy (&tmp[0], cp, rowbytes);
+            for (size_t count = 0;  count < rowvals;  ++count)
+                for (size_t byte = 0;  byte < bps;  ++byte) {
+                    size_t plane = bigendian() ? byte : bps - byte - 1;
+                    cp[plane * rowvals + count] = tmp[bps * count + byte];
+                }
+            for (size_t i = rowbytes-1;  i >= size_t(nc) && i < rowbytes;  --i)
+                cp[i] = (unsigned char)(cp[i] - cp[i-nc]);
+        }
+    }
+    if (m_compression == COMPRESSION_LZW) {
+        lzw_encode (&tile[0], tile.size(), out);
+        return true;
+    }
+    uLongf len = compressBound (uLong(tile.size()));
+    out.resize (len);
+    if (compress2 (&out[0], &len, &tile[0], uLong(tile.size()),
+                   zipquality) != Z_OK)
+        return false;
+    out.resize (len);
+    return true;
+}
+
+
+
+bool
+TIFFOutput::parallel_encode_ok (int &predictor, int &zipquality) const
+{
+    uint16 pred = PREDICTOR_NONE;
+    TIFFGetField (m_tif, TIFFTAG_PREDICTOR, &pred);
+    predictor = pred;
+    zipquality = Z_DEFAULT_COMPRESSION;
+    if (m_compression != COMPRESSION_LZW)
+        TIFFGetField (m_tif, TIFFTAG_ZIPQUALITY, &zipquality);
+    return (m_compression == COMPRESSION_ADOBE_DEFLATE ||
+            m_compression == COMPRESSION_DEFLATE ||
+            m_compression == COMPRESSION_LZW)
+        && (m_planarconfig == PLANARCONFIG_CONTIG || m_spec.nchannels == 1)
+        && m_photometric != PHOTOMETRIC_SEPARATED
+        && m_spec.format.size()*8 == m_bitspersample
+        && (predictor == PREDICTOR_NONE ||
+            predictor == PREDICTOR_FLOATINGPOINT ||
+            (predictor == PREDICTOR_HORIZONTAL && m_spec.format.size() <= 2))
+        && threads() != 1;
+}
+
+
+
+bool
+TIFFOutput::write_scanlines (int ybegin, int yend, int z,
+                             TypeDesc format, const void *data,
+                             stride_t xstride, stride_t ystride)
+{
+    // Like write_tiles: whole strips of the range are converted and
+    // compressed in parallel and written raw, in order.  Lines before the
+    // first strip boundary or after the last one, and anything that
+    // write_scanline must convert itself, go one line at a time.
+    int predictor = PREDICTOR_NONE, zipquality = Z_DEFAULT_COMPRESSION;
+    int rowsperstrip = m_spec.height;
+    if (m_tif)
+        TIFFGetField (m_tif, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
+    rowsperstrip = OIIO::clamp (rowsperstrip, 1, m_spec.height);
+    yend = std::min (yend, m_spec.y+m_spec.height);
+    int y0 = ybegin - m_spec.y, y1 = yend - m_spec.y;
+    int sbegin = (y0 + rowsperstrip - 1) / rowsperstrip;
+    int send = (y1 == m_spec.height) ? (y1 + rowsperstrip - 1) / rowsperstrip
+                                     : y1 / rowsperstrip;
+    if (y0 < 0 || send - sbegin < 2 || m_spec.depth > 1 ||
+        ! parallel_encode_ok (predictor, zipquality))
+        return ImageOutput::write_scanlines (ybegin, yend, z, format, data,
+                                             xstride, ystride);
+
+    stride_t native_pixel_bytes = (stride_t) m_spec.pixel_bytes (true);
+    if (format == TypeDesc::UNKNOWN && xstride == AutoStride)
+        xstride = native_pixel_bytes;
+    stride_t zstride = AutoStride;
+    m_spec.auto_stride (xstride, ystride, zstride, format, m_spec.nchannels,
+                        m_spec.width, yend-ybegin);
+
+    // Lines up to the first strip boundary
+    int yfirst = std::min (sbegin * rowsperstrip, y1);
+    if (yfirst > y0 &&
+        ! ImageOutput::write_scanlines (ybegin, yfirst + m_spec.y, z, format,
+                                        data, xstride, ystride))
+        return false;
+
+    int nstrips = send - sbegin;
+    size_t sl = m_spec.scanline_bytes (true);
+    std::vector<std::vector<unsigned char> > compressed (nstrips);
+    parallel_for (0, nstrips, [&](int64_t s){
+        int sy0 = int(sbegin + s) * rowsperstrip;
+        int nrows = std::min (rowsperstrip, m_spec.height - sy0);
+        std::vector<unsigned char> strip (nrows * sl), scratch;
+        for (int r = 0;  r < nrows;  ++r) {
+            const char *line = (const char *)data + (sy0 + r - y0) * ystride;
+            const void *native = to_native_scanline (format, line, xstride,
+                                                     scratch, m_dither,
+                                                     sy0 + r + m_spec.y, z);
+            memcpy (&strip[r*sl], native, sl);
+        }
+        if (! compress_chunk (strip, m_spec.width, predictor, zipquality,
+                              compressed[s]))
+            compressed[s].clear ();
+    });
+
+    // libtiff may still hold the last strip written by TIFFWriteScanline.
+    TIFFFlushData (m_tif);
+    for (int s = 0;  s < nstrips;  ++s) {
+        if (compressed[s].empty() ||
+            TIFFWriteRawStrip (m_tif, tstrip_t(sbegin + s), &compressed[s][0],
+                               tmsize_t(compressed[s].size())) < 0) {
+            std::string err = oiio_tiff_last_error();
+            error ("TIFFWriteRawStrip failed writing strip %d (%s)",
+                   sbegin + s, err.size() ? err.c_str() : "unknown error");
+            return false;
+        }
+        std::vector<unsigned char>().swap (compressed[s]);
+    }
+    m_checkpointItems += std::min (send * rowsperstrip, m_spec.height)
+                         - sbegin * rowsperstrip;
+
+    // Lines after the last strip boundary
+    int ylast = send * rowsperstrip;
+    if (ylast < y1 &&
+        ! ImageOutput::write_scanlines (ylast + m_spec.y, yend, z, format,
+                                        (const char *)data + (ylast - y0) * ystride,
+                                        xstride, ystride))
+        return false;
+    return true;
+}
+
+
+
+bool
+TIFFOutput::write_tiles (int xbegin, int xend, int ybegin, int yend,
+                         int zbegin, int zend, TypeDesc format,
+                         const void *data, stride_t xstride,
+                         stride_t ystride, stride_t zstride)
+{
+    // libtiff compresses one tile at a time on the calling thread.  For
+    // zip or LZW compression of plain contiguous tiles, which is what
+    // maketx writes, compress the tiles of the whole range in parallel,
+    // then write the compressed bytes in order.  Anything else goes one
+    // tile at a time through write_tile.
+    int predictor = PREDICTOR_NONE, zipquality = Z_DEFAULT_COMPRESSION;
+    int ntx = (xend - xbegin + m_spec.tile_width - 1) / m_spec.tile_width;
+    int nty = (yend - ybegin + m_spec.tile_height - 1) / m_spec.tile_height;
+    int ntz = (zend - zbegin + std::max(1,m_spec.tile_depth) - 1) / std::max(1,m_spec.tile_depth);
+    int ntiles = ntx * nty * ntz;
+    bool parallel = ntiles > 1 && parallel_encode_ok (predictor, zipquality);
+    if (! parallel || ! m_spec.valid_tile_range (xbegin, xend, ybegin, yend,
+                                                 zbegin, zend))
+        return ImageOutput::write_tiles (xbegin, xend, ybegin, yend,
+                                         zbegin, zend, format, data,
+                                         xstride, ystride, zstride);
+
+    stride_t native_pixel_bytes = (stride_t) m_spec.pixel_bytes (true);
+    if (format == TypeDesc::UNKNOWN && xstride == AutoStride)
+        xstride = native_pixel_bytes;
+    m_spec.auto_stride (xstride, ystride, zstride, format, m_spec.nchannels,
+                        xend-xbegin, yend-ybegin);
+    stride_t pixelsize = format.size() * m_spec.nchannels;
+    size_t tilebytes = m_spec.tile_bytes();
+
+    std::vector<std::vector<unsigned char> > compressed (ntiles);
+    atomic_int failed (0);
+    parallel_for (0, ntiles, [&](int64_t t){
+        int tx = int(t % ntx), ty = int((t / ntx) % nty), tz = int(t / (ntx*nty));
+        int x = xbegin + tx * m_spec.tile_width;
+        int y = ybegin + ty * m_spec.tile_height;
+        int z = zbegin + tz * std::max(1,m_spec.tile_depth);
+        int xw = std::min (xend-x, m_spec.tile_width);
+        int yh = std::min (yend-y, m_spec.tile_height);
+        int zd = std::min (zend-z, std::max(1,m_spec.tile_depth));
+        const char *tilestart = (const char *)data + (x-xbegin)*xstride
+                              + (y-ybegin)*ystride + (z-zbegin)*zstride;
+        // Partial tiles (at the image edges) are padded with zeroes.
+        std::vector<unsigned char> padded, scratch, tile;
+        const void *src = tilestart;
+        stride_t xs = xstride, ys = ystride, zs = zstride;
+        if (xw < m_spec.tile_width || yh < m_spec.tile_height ||
+            zd < std::max(1,m_spec.tile_depth)) {
+            padded.assign (pixelsize * m_spec.tile_pixels(), 0);
+            OIIO::copy_image (m_spec.nchannels, xw, yh, zd, tilestart,
+                              pixelsize, xstride, ystride, zstride,
+                              &padded[0], pixelsize, pixelsize*m_spec.tile_width,
+                              pixelsize*m_spec.tile_width*m_spec.tile_height);
+            src = &padded[0];
+            xs = pixelsize;
+            ys = pixelsize * m_spec.tile_width;
+            zs = ys * m_spec.tile_height;
+        }
+        const void *native = to_native_tile (format, src, xs, ys, zs, scratch,
+                                             m_dither, x - m_spec.x,
+                                             y - m_spec.y, z - m_spec.z);
+        // Always compress from a private copy, since the predictors
+        // modify the data.
+        if (native == (const void *)&scratch[0] && scratch.size() >= tilebytes)
+            tile.swap (scratch);
+        else
+            tile.assign ((const unsigned char *)native,
+                         (const unsigned char *)native + tilebytes);
+        tile.resize (tilebytes);
+        if (! compress_chunk (tile, m_spec.tile_width, predictor,
+                              zipquality, compressed[t]))
+            ++failed;
+    });
+    if (failed) {
+        error ("zip compression failed");
+        return false;
+    }
+
+    for (int t = 0;  t < ntiles;  ++t) {
+        int tx = t % ntx, ty = (t / ntx) % nty, tz = t / (ntx*nty);
+        int x = xbegin + tx * m_spec.tile_width - m_spec.x;
+        int y = ybegin + ty * m_spec.tile_height - m_spec.y;
+        int z = zbegin + tz * std::max(1,m_spec.tile_depth) - m_spec.z;
+        ttile_t tile = TIFFComputeTile (m_tif, x, y, z, 0);
+        if (TIFFWriteRawTile (m_tif, tile, &compressed[t][0],
+                              tmsize_t(compressed[t].size())) < 0) {
+            std::string err = oiio_tiff_last_error();
+            error ("TIFFWriteRawTile failed writing tile x=%d,y=%d,z=%d (%s)",
+                   x+m_spec.x, y+m_spec.y, z+m_spec.z,
+                   err.size() ? err.c_str() : "unknown error");
+            return false;
+        }
+        std::vector<unsigned char>().swap (compressed[t]);
+    }
+
+    // Checkpoint as write_tile would have, had these been written one by
+    // one.
+    m_checkpointItems += ntiles;
+    if (m_checkpointTimer() > DEFAULT_CHECKPOINT_INTERVAL_SECONDS
+        && m_checkpointItems >= MIN_SCANLINES_OR_TILES_PER_CHECKPOINT) {
+        TIFFCheckpointDirectory (m_tif);
+        m_checkpointTimer.lap();
+        m_checkpointItems = 0;
+    }
+    return true;
+}
+
 OIIO_PLUGIN_NAMESPACE_END
 
@@ -28,6 +28,8 @@
   (This is the Modified BSD License)
 */
 #include <cstdio>
+#include <vector>
+#include <algorithm>
 #include <webp/decode.h>
 #include "OpenImageIO/imageio.h"
 #include "OpenImageIO/filesystem.h"
@@ -46,21 +48,32 @@ class WebpInput : public ImageInput
     virtual const char* format_name() const { return "webp"; }
     virtual bool open (const std::string &name, ImageSpec &spec);
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
     virtual bool close ();
 
  private:
     std::string m_filename;
-    uint8_t *m_decoded_image;
-    long int m_image_size;
+    std::vector<uint8_t> m_decoded_image;
     long int m_scanline_size;
     FILE *m_file;
+    // The file is decoded incrementally, only as far as the scanlines
+    // asked for so far: m_decoded_rows rows are ready in m_decoded_image.
+    WebPIDecoder *m_decoder;
+    int m_decoded_rows;
+    std::vector<uint8_t> m_chunk;
 
     void init()
     {
-        m_image_size = m_scanline_size = 0;
-        m_decoded_image = NULL;
+        m_scanline_size = 0;
+        m_decoded_image.clear ();
         m_file = NULL;
+        m_decoder = NULL;
+        m_decoded_rows = 0;
     }
+
+    // Feed the decoder until at least 'rows' scanlines are decoded
+    bool decode_rows (int rows);
 };
 
 
@@ -76,39 +89,73 @@ WebpInput::open (const std::string &name, ImageSpec &spec)
         return false;
     }
 
-    fseek (m_file, 0, SEEK_END);
-    m_image_size = ftell(m_file);
-    fseek (m_file, 0, SEEK_SET);
-
-    std::vector<uint8_t> encoded_image;
-    encoded_image.resize(m_image_size, 0);
-    size_t numRead = fread(&encoded_image[0], sizeof(uint8_t), encoded_image.size(), m_file);
-    if (numRead != encoded_image.size()) {
-    	error ("Read failure for \"%s\" (expected %d bytes, read %d)",
-               m_filename, encoded_image.size(), numRead);
-    	close ();
-    	return false;
+    // Only the headers are needed to know the size; read just enough
+    std::vector<uint8_t> header;
+    WebPBitstreamFeatures features;
+    VP8StatusCode status = VP8_STATUS_NOT_ENOUGH_DATA;
+    while (status == VP8_STATUS_NOT_ENOUGH_DATA) {
+        size_t oldsize = header.size();
+        header.resize (oldsize + 4096);
+        size_t numRead = fread (&header[oldsize], 1, 4096, m_file);
+        header.resize (oldsize + numRead);
+        status = WebPGetFeatures (header.size() ? &header[0] : NULL,
+                                  header.size(), &features);
+        if (numRead == 0)
+            break;
     }
-
-    int width = 0, height = 0;
-    if(!WebPGetInfo(&encoded_image[0], encoded_image.size(), &width, &height))
+    if (status != VP8_STATUS_OK)
     {
         error ("%s is not a WebP image file", m_filename.c_str());
         close();
         return false;
     }
+    fseek (m_file, 0, SEEK_SET);
 
     const int CHANNEL_NUM = 4;
-    m_scanline_size = width * CHANNEL_NUM;
-    m_spec = ImageSpec(width, height, CHANNEL_NUM, TypeDesc::UINT8);
+    m_scanline_size = features.width * CHANNEL_NUM;
+    m_spec = ImageSpec(features.width, features.height, CHANNEL_NUM,
+                       TypeDesc::UINT8);
     spec = m_spec;
 
-    if (!(m_decoded_image = WebPDecodeRGBA(&encoded_image[0], encoded_image.size(), &m_spec.width, &m_spec.height)))
+    // Decode straight into our full-size buffer
+    m_decoded_image.resize (size_t(m_scanline_size) * m_spec.height);
+    m_decoder = WebPINewRGB (MODE_RGBA, &m_decoded_image[0],
+                             m_decoded_image.size(), int(m_scanline_size));
+    if (! m_decoder)
     {
         error ("Couldn't decode %s", m_filename.c_str());
         close();
         return false;
     }
+    m_decoded_rows = 0;
+    return true;
+}
+
+
+bool
+WebpInput::decode_rows (int rows)
+{
+    const size_t chunksize = 64*1024;
+    m_chunk.resize (chunksize);
+    while (m_decoded_rows < rows) {
+        size_t numRead = fread (&m_chunk[0], 1, chunksize, m_file);
+        if (numRead == 0) {
+            error ("Read failure for \"%s\": file is truncated",
+                   m_filename.c_str());
+            return false;
+        }
+        VP8StatusCode status = WebPIAppend (m_decoder, &m_chunk[0], numRead);
+        if (status == VP8_STATUS_OK) {
+            m_decoded_rows = m_spec.height;   // all done
+        } else if (status == VP8_STATUS_SUSPENDED) {
+            int last_y = 0;
+            if (WebPIDecGetRGB (m_decoder, &last_y, NULL, NULL, NULL))
+                m_decoded_rows = last_y;
+        } else {
+            error ("Couldn't decode %s", m_filename.c_str());
+            return false;
+        }
+    }
     return true;
 }
 
@@ -116,26 +163,43 @@ WebpInput::open (const std::string &name, ImageSpec &spec)
 bool
 WebpInput::read_native_scanline (int y, int z, void *data)
 {
-    if (y < 0 || y >= m_spec.width)   // out of range scanline
+    if (y < 0 || y >= m_spec.height)   // out of range scanline
+        return false;
+    if (! decode_rows (y+1))
         return false;
     memcpy(data, &m_decoded_image[y*m_scanline_size], m_scanline_size);
     return true;    
 }
 
 
+bool
+WebpInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    yend = std::min (yend, m_spec.height);
+    if (ybegin < 0 || ybegin >= yend)
+        return false;
+    if (! decode_rows (yend))
+        return false;
+    memcpy (data, &m_decoded_image[ybegin*m_scanline_size],
+            (yend-ybegin)*m_scanline_size);
+    return true;
+}
+
+
 bool
 WebpInput::close()
 {
+    if (m_decoder)
+    {
+        WebPIDelete (m_decoder);
+        m_decoder = NULL;
+    }
     if (m_file)
     {
         fclose(m_file);
         m_file = NULL;
     }
-    if (m_decoded_image)
-    {
-        free(m_decoded_image); // this was allocated by WebPDecodeRGB and should be fread by free
-        m_decoded_image = NULL;
-    }
+    init ();
     return true;
 }
 
@@ -155,6 +219,9 @@ OIIO_PLUGIN_EXPORTS_BEGIN
     OIIO_EXPORT const char *webp_input_extensions[] = {
         "webp", NULL
     };
+    OIIO_EXPORT const char *webp_input_magic[] = {
+        "52494646????????57454250", NULL
+    };
 
 OIIO_PLUGIN_EXPORTS_END
 
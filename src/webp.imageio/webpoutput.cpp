@@ -31,6 +31,7 @@
 #include <webp/encode.h>
 #include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/imageio.h"
+#include "OpenImageIO/fmath.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -61,6 +62,7 @@ class WebpOutput : public ImageOutput
     int m_scanline_size;
     unsigned int m_dither;
     std::vector<uint8_t> m_uncompressed_image;
+    std::vector<uint8_t> m_scratch;
 
     void init()
     {
@@ -140,7 +142,12 @@ WebpOutput::open (const std::string &name, const ImageSpec &spec,
         return false;
     }
 
-    m_webp_config.method = 6;
+    // "webp:method" trades encode speed (0) for size (6)
+    m_webp_config.method = clamp (m_spec.get_int_attribute ("webp:method", 6),
+                                  0, 6);
+    // "webp:thread_level" lets libwebp use extra threads for the encode
+    m_webp_config.thread_level = m_spec.get_int_attribute ("webp:thread_level",
+                                                           0);
     int compression_quality = 100;
     const ImageIOParameter *qual = m_spec.find_attribute ("CompressionQuality",
                                                           TypeDesc::INT);
@@ -149,6 +156,12 @@ WebpOutput::open (const std::string &name, const ImageSpec &spec,
         compression_quality = *static_cast<const int*>(qual->data());
     }
     m_webp_config.quality = compression_quality;
+    if (! WebPValidateConfig (&m_webp_config))
+    {
+        error ("Invalid WebP encoding configuration");
+        close();
+        return false;
+    }
     
     // forcing UINT8 format
     m_spec.set_format (TypeDesc::UINT8);
@@ -171,8 +184,7 @@ WebpOutput::write_scanline (int y, int z, TypeDesc format,
         close ();
         return false;
     }
-    std::vector<uint8_t> scratch;
-    data = to_native_scanline (format, data, xstride, scratch,
+    data = to_native_scanline (format, data, xstride, m_scratch,
                                m_dither, y, z);
     memcpy(&m_uncompressed_image[y*m_scanline_size], data, m_scanline_size);
 
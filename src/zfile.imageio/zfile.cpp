@@ -41,6 +41,7 @@
 #include "OpenImageIO/strutil.h"
 #include "OpenImageIO/filesystem.h"
 #include "OpenImageIO/fmath.h"
+#include "OpenImageIO/parallel.h"
 
 OIIO_PLUGIN_NAMESPACE_BEGIN
 
@@ -58,6 +59,100 @@ struct ZfileHeader {
 static const int zfile_magic = 0x2f0867ab;
 static const int zfile_magic_endian = 0xab67082f;  // other endianness
 
+
+// Block-indexed compressed layout
+// -------------------------------
+// Rather than one gzip stream, the header and each block of
+// zfile_block_rows scanlines are written as separate gzip members, one
+// after the other.  Concatenated members are still a valid gzip file,
+// decompressing to exactly the bytes of a plain compressed zfile, so
+// any zfile reader (or gunzip) handles it as before.  The blocks can
+// be compressed in parallel, and, given their offsets, decompressed
+// independently.
+//
+// The offsets go in one last, empty, gzip member, in a subfield of the
+// "extra" header field that gzip readers skip.  That member ends with a
+// fixed-size trailer so it can be found from the end of the file:
+//
+//   1f 8b 08 04 00000000 00 ff  XLEN(2)  'O' 'Z' LEN(2)
+//     rows per block (u32), nblocks (u32), offsets (u64 x nblocks),
+//     offset of this member (u64), "OIZ1"
+//   03 00  00000000  00000000     (empty deflate stream, CRC, size)
+//
+// All index values are little-endian.
+
+static const int zfile_block_rows = 32;
+static const char zfile_index_magic[4] = { 'O', 'I', 'Z', '1' };
+static const unsigned char zfile_empty_member_tail[10] = {
+    0x03, 0x00, 0, 0, 0, 0, 0, 0, 0, 0
+};
+static const size_t zfile_index_trailer = 8 + 4 + 10;
+
+
+template<typename T>
+inline void
+append_le (std::vector<unsigned char> &buf, T val)
+{
+    if (bigendian())
+        swap_endian (&val);
+    const unsigned char *p = (const unsigned char *)&val;
+    buf.insert (buf.end(), p, p+sizeof(T));
+}
+
+
+template<typename T>
+inline T
+get_le (const unsigned char *p)
+{
+    T val;
+    memcpy (&val, p, sizeof(T));
+    if (bigendian())
+        swap_endian (&val);
+    return val;
+}
+
+
+
+// Compress len bytes of src into out as a complete gzip member.
+static bool
+deflate_member (const void *src, size_t len, std::vector<unsigned char> &out)
+{
+    z_stream strm;
+    memset (&strm, 0, sizeof(strm));
+    if (deflateInit2 (&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16 /*gzip*/,
+                      8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    out.resize (deflateBound (&strm, uLong(len)) + 18);
+    strm.next_in = (Bytef *)src;
+    strm.avail_in = uInt(len);
+    strm.next_out = &out[0];
+    strm.avail_out = uInt(out.size());
+    int r = deflate (&strm, Z_FINISH);
+    out.resize (strm.total_out);
+    deflateEnd (&strm);
+    return r == Z_STREAM_END;
+}
+
+
+
+// Decompress the gzip member in src, which must hold exactly len bytes.
+static bool
+inflate_member (const unsigned char *src, size_t srclen, void *dst, size_t len)
+{
+    z_stream strm;
+    memset (&strm, 0, sizeof(strm));
+    if (inflateInit2 (&strm, 15+16 /*gzip*/) != Z_OK)
+        return false;
+    strm.next_in = (Bytef *)src;
+    strm.avail_in = uInt(srclen);
+    strm.next_out = (Bytef *)dst;
+    strm.avail_out = uInt(len);
+    int r = inflate (&strm, Z_FINISH);
+    bool ok = (r == Z_STREAM_END && strm.total_out == len);
+    inflateEnd (&strm);
+    return ok;
+}
+
 }  // end anon namespace
 
 
@@ -71,19 +166,41 @@ public:
     virtual bool open (const std::string &name, ImageSpec &newspec);
     virtual bool close ();
     virtual bool read_native_scanline (int y, int z, void *data);
+    virtual bool read_native_scanlines (int ybegin, int yend, int z,
+                                        void *data);
 
 private:
     std::string m_filename;       ///< Stash the filename
     gzFile m_gz;                  ///< Handle for compressed files
+    FILE *m_file;                 ///< Handle for block-indexed files
     bool m_swab;                  ///< swap bytes for other endianness?
     int m_next_scanline;          ///< Which scanline is the next to be read?
+    int m_block_rows;             ///< Scanlines per block (if indexed)
+    std::vector<int64_t> m_block_offsets; ///< Block offsets, and index's
+    int m_cached_block;           ///< Which block is in m_block_pixels
+    std::vector<float> m_block_pixels;    ///< One decompressed block
 
     // Reset everything to initial state
     void init () {
         m_gz = 0;
+        m_file = NULL;
         m_swab = false;
         m_next_scanline = 0;
+        m_block_rows = 0;
+        m_block_offsets.clear ();
+        m_cached_block = -1;
+        std::vector<float>().swap (m_block_pixels);
     }
+
+    // Look for the block index at the end of the file.  If there is one,
+    // leave m_file open for reading blocks and return true.
+    bool read_index ();
+
+    int nblocks () const { return int(m_block_offsets.size()) - 1; }
+
+    // Read and decompress blocks [bbegin,bend) into dst, which has room
+    // for the (bend-bbegin)*m_block_rows scanlines.
+    bool read_blocks (int bbegin, int bend, float *dst);
 };
 
 
@@ -108,12 +225,26 @@ private:
     gzFile m_gz;                  ///< Handle for compressed files
     std::vector<unsigned char> m_scratch;
     std::vector<unsigned char> m_tilebuffer;
+    bool m_blockindex;            ///< Writing the block-indexed layout?
+    std::vector<float> m_pending; ///< Scanlines not yet compressed
+    int m_pending_rows;           ///< How many scanlines are in m_pending
+    std::vector<int64_t> m_block_offsets; ///< Offsets of blocks written
 
     // Initialize private members to pre-opened state
     void init (void) {
         m_file = NULL;
         m_gz = 0;
+        m_blockindex = false;
+        std::vector<float>().swap (m_pending);
+        m_pending_rows = 0;
+        m_block_offsets.clear ();
     }
+
+    // Compress (in parallel) and write the pending scanlines as blocks.
+    bool flush_blocks ();
+
+    // Write the member holding the block index.
+    bool write_index ();
 };
 
 
@@ -131,6 +262,9 @@ OIIO_EXPORT ImageInput *zfile_input_imageio_create () { return new ZfileInput; }
 OIIO_EXPORT const char * zfile_input_extensions[] = {
     "zfile", NULL
 };
+OIIO_EXPORT const char * zfile_input_magic[] = {
+    "2f0867ab", "ab67082f", NULL
+};
 
 OIIO_EXPORT ImageOutput *zfile_output_imageio_create () { return new ZfileOutput; }
 
@@ -204,12 +338,112 @@ ZfileInput::open (const std::string &name, ImageSpec &newspec)
     m_spec.attribute ("worldtocamera", TypeDesc::TypeMatrix,
                       (float *)&header.worldtocamera);
 
+    if (read_index ()) {
+        // Blocks are read directly, no need for the sequential stream
+        gzclose (m_gz);
+        m_gz = 0;
+        m_spec.attribute ("compression", "zip");
+        m_spec.attribute ("zfile:blockrows", m_block_rows);
+    }
+
     newspec = spec ();
     return true;
 }
 
 
 
+bool
+ZfileInput::read_index ()
+{
+    m_file = Filesystem::fopen (m_filename, "rb");
+    if (! m_file)
+        return false;
+    bool ok = false;
+    unsigned char trailer[zfile_index_trailer];
+    int64_t filesize = 0;
+    if (fseek (m_file, 0, SEEK_END) == 0)
+        filesize = ftell (m_file);
+    if (filesize > int64_t(zfile_index_trailer) &&
+        fseek (m_file, filesize - zfile_index_trailer, SEEK_SET) == 0 &&
+        fread (trailer, sizeof(trailer), 1, m_file) == 1 &&
+        ! memcmp (trailer+8, zfile_index_magic, 4) &&
+        ! memcmp (trailer+12, zfile_empty_member_tail, 10)) {
+        int64_t indexoffset = get_le<uint64_t> (trailer);
+        int64_t indexsize = filesize - indexoffset;
+        bool sane = (indexoffset > 0 &&
+                     indexsize > 16 + 8 + int64_t(zfile_index_trailer) &&
+                     indexsize < 16 + 65536 + 10);
+        std::vector<unsigned char> index (sane ? indexsize : 0);
+        const unsigned char *p = sane ? &index[0] : NULL;
+        if (sane && fseek (m_file, indexoffset, SEEK_SET) == 0 &&
+            fread (&index[0], indexsize, 1, m_file) == 1 &&
+            p[0] == 0x1f && p[1] == 0x8b && p[2] == 8 && (p[3] & 4) &&
+            p[12] == 'O' && p[13] == 'Z') {
+            size_t len = get_le<uint16_t> (p+14);
+            int rows = get_le<uint32_t> (p+16);
+            int n = get_le<uint32_t> (p+20);
+            int expected = rows > 0 ? (m_spec.height + rows - 1) / rows : -1;
+            if (n == expected && len == 8 + 8*size_t(n) + 12 &&
+                16 + len + 10 == size_t(indexsize)) {
+                m_block_rows = rows;
+                m_block_offsets.resize (n+1);
+                for (int b = 0; b < n; ++b)
+                    m_block_offsets[b] = get_le<uint64_t> (p + 24 + 8*b);
+                m_block_offsets[n] = indexoffset;
+                ok = true;
+                for (int b = 0; b < n; ++b)
+                    ok &= (m_block_offsets[b] > 0 &&
+                           m_block_offsets[b] < m_block_offsets[b+1]);
+                if (! ok) {
+                    m_block_rows = 0;
+                    m_block_offsets.clear ();
+                }
+            }
+        }
+    }
+    if (! ok) {
+        fclose (m_file);
+        m_file = NULL;
+    }
+    return ok;
+}
+
+
+
+bool
+ZfileInput::read_blocks (int bbegin, int bend, float *dst)
+{
+    // Read all the compressed blocks at once, then inflate them in
+    // parallel.
+    int64_t begin = m_block_offsets[bbegin];
+    std::vector<unsigned char> compressed (m_block_offsets[bend] - begin);
+    if (fseek (m_file, begin, SEEK_SET) != 0 ||
+        fread (&compressed[0], compressed.size(), 1, m_file) != 1) {
+        error ("Read error in \"%s\"", m_filename);
+        return false;
+    }
+    size_t rowpixels = m_spec.width;
+    atomic_int failed (0);
+    parallel_for (bbegin, bend, [&](int64_t b){
+        int ybegin = int(b) * m_block_rows;
+        int rows = std::min (m_block_rows, m_spec.height - ybegin);
+        float *out = dst + (b - bbegin) * m_block_rows * rowpixels;
+        if (! inflate_member (&compressed[m_block_offsets[b] - begin],
+                              m_block_offsets[b+1] - m_block_offsets[b],
+                              out, rows * rowpixels * sizeof(float)))
+            ++failed;
+        else if (m_swab)
+            swap_endian (out, rows * int(rowpixels));
+    });
+    if (failed) {
+        error ("Corrupt compressed data in \"%s\"", m_filename);
+        return false;
+    }
+    return true;
+}
+
+
+
 bool
 ZfileInput::close ()
 {
@@ -217,6 +451,10 @@ ZfileInput::close ()
         gzclose (m_gz);
         m_gz = 0;
     }
+    if (m_file) {
+        fclose (m_file);
+        m_file = NULL;
+    }
 
     init();  // Reset to initial state
     return true;
@@ -227,6 +465,22 @@ ZfileInput::close ()
 bool
 ZfileInput::read_native_scanline (int y, int z, void *data)
 {
+    if (m_file) {
+        // Block-indexed: decompress just the block holding y (if it
+        // isn't the one we already have), in any order.
+        int b = y / m_block_rows;
+        if (b != m_cached_block) {
+            m_block_pixels.resize (size_t(m_block_rows) * m_spec.width);
+            m_cached_block = -1;
+            if (! read_blocks (b, b+1, &m_block_pixels[0]))
+                return false;
+            m_cached_block = b;
+        }
+        memcpy (data, &m_block_pixels[size_t(y - b*m_block_rows) * m_spec.width],
+                m_spec.width*sizeof(float));
+        return true;
+    }
+
     if (m_next_scanline > y) {
         // User is trying to read an earlier scanline than the one we're
         // up to.  Easy fix: close the file and re-open.
@@ -250,6 +504,38 @@ ZfileInput::read_native_scanline (int y, int z, void *data)
 
 
 
+bool
+ZfileInput::read_native_scanlines (int ybegin, int yend, int z, void *data)
+{
+    int rows = m_block_rows;
+    if (! m_file || yend - ybegin <= rows)
+        return ImageInput::read_native_scanlines (ybegin, yend, z, data);
+
+    // Several blocks: the ones entirely within the range are decompressed
+    // in parallel right into data, the partial ones at either end go
+    // through the one-block cache.
+    size_t rowbytes = m_spec.width * sizeof(float);
+    char *out = (char *)data;
+    int y = ybegin;
+    for ( ; y < yend && (y % rows); ++y, out += rowbytes)
+        if (! read_native_scanline (y, z, out))
+            return false;
+    // N.B. the last block of the image may be short
+    int yfull = (yend == m_spec.height) ? yend : yend / rows * rows;
+    if (yfull > y) {
+        if (! read_blocks (y / rows, (yfull + rows - 1) / rows, (float *)out))
+            return false;
+        out += size_t(yfull - y) * rowbytes;
+        y = yfull;
+    }
+    for ( ; y < yend; ++y, out += rowbytes)
+        if (! read_native_scanline (y, z, out))
+            return false;
+    return true;
+}
+
+
+
 
 bool
 ZfileOutput::open (const std::string &name, const ImageSpec &userspec,
@@ -303,7 +589,11 @@ ZfileOutput::open (const std::string &name, const ImageSpec &userspec,
     else
         memcpy (header.worldtoscreen, ident, 16*sizeof(float));
 
-    if (m_spec.get_string_attribute ("compression", "none") != std::string("none")) {
+    bool compressed = (m_spec.get_string_attribute ("compression", "none")
+                       != std::string("none"));
+    m_blockindex = compressed &&
+                   m_spec.get_int_attribute ("zfile:blockindex", 1) != 0;
+    if (compressed && ! m_blockindex) {
         FILE *fd = Filesystem::fopen (name, "wb");
         if (fd) {
             m_gz = gzdopen (fileno (fd), "wb");
@@ -320,6 +610,16 @@ ZfileOutput::open (const std::string &name, const ImageSpec &userspec,
 
     if (m_gz)
         gzwrite (m_gz, &header, sizeof(header));
+    else if (m_blockindex) {
+        std::vector<unsigned char> member;
+        if (! deflate_member (&header, sizeof(header), member) ||
+            fwrite (&member[0], member.size(), 1, m_file) != 1) {
+            error ("Failed write zfile::open");
+            return false;
+        }
+        m_pending.resize (size_t(zfile_block_rows) * m_spec.width *
+                          std::max (1, OIIO::get_int_attribute ("threads", 1)));
+    }
     else {
     	size_t b = fwrite (&header, sizeof(header), 1, m_file);
     	if (b != 1) {
@@ -338,6 +638,70 @@ ZfileOutput::open (const std::string &name, const ImageSpec &userspec,
 
 
 
+bool
+ZfileOutput::flush_blocks ()
+{
+    if (! m_pending_rows)
+        return true;
+    int nblocks = (m_pending_rows + zfile_block_rows - 1) / zfile_block_rows;
+    size_t blockpixels = size_t(zfile_block_rows) * m_spec.width;
+    std::vector<std::vector<unsigned char> > compressed (nblocks);
+    atomic_int failed (0);
+    parallel_for (0, nblocks, [&](int64_t b){
+        int rows = std::min (zfile_block_rows,
+                             m_pending_rows - int(b) * zfile_block_rows);
+        if (! deflate_member (&m_pending[b * blockpixels],
+                              rows * m_spec.width * sizeof(float),
+                              compressed[b]))
+            ++failed;
+    });
+    m_pending_rows = 0;
+    if (failed) {
+        error ("zlib compression failed");
+        return false;
+    }
+    for (auto &block : compressed) {
+        m_block_offsets.push_back (ftell (m_file));
+        if (fwrite (&block[0], block.size(), 1, m_file) != 1) {
+            error ("Failed write zfile (block)");
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+bool
+ZfileOutput::write_index ()
+{
+    int64_t indexoffset = ftell (m_file);
+    uint32_t nblocks = uint32_t (m_block_offsets.size());
+    std::vector<unsigned char> member = {
+        0x1f, 0x8b, 8, 4 /*FEXTRA*/, 0, 0, 0, 0, 0, 0xff
+    };
+    size_t len = 8 + 8*nblocks + 12;
+    append_le (member, uint16_t(len + 4));    // XLEN
+    member.push_back ('O');
+    member.push_back ('Z');
+    append_le (member, uint16_t(len));
+    append_le (member, uint32_t(zfile_block_rows));
+    append_le (member, nblocks);
+    for (auto off : m_block_offsets)
+        append_le (member, uint64_t(off));
+    append_le (member, uint64_t(indexoffset));
+    member.insert (member.end(), zfile_index_magic, zfile_index_magic+4);
+    member.insert (member.end(), zfile_empty_member_tail,
+                   zfile_empty_member_tail+10);
+    if (fwrite (&member[0], member.size(), 1, m_file) != 1) {
+        error ("Failed write zfile (index)");
+        return false;
+    }
+    return true;
+}
+
+
+
 bool
 ZfileOutput::close ()
 {
@@ -350,6 +714,10 @@ ZfileOutput::close ()
         std::vector<unsigned char>().swap (m_tilebuffer);
     }
 
+    if (m_blockindex && m_file) {
+        ok &= flush_blocks ();
+        ok &= write_index ();
+    }
     if (m_gz) {
         gzclose (m_gz);
         m_gz = 0;
@@ -379,7 +747,15 @@ ZfileOutput::write_scanline (int y, int z, TypeDesc format,
         data = &m_scratch[0];
     }
 
-    if (m_gz)
+    if (m_blockindex) {
+        // Collect scanlines until there are enough blocks to keep all
+        // the threads busy compressing them.
+        memcpy (&m_pending[size_t(m_pending_rows) * m_spec.width], data,
+                m_spec.width*sizeof(float));
+        if (++m_pending_rows * size_t(m_spec.width) == m_pending.size())
+            return flush_blocks ();
+    }
+    else if (m_gz)
         gzwrite (m_gz, data, m_spec.width*sizeof(float));
     else {
     	size_t b = fwrite (data, sizeof(float), m_spec.width, m_file);
@@ -406,4 +782,3 @@ ZfileOutput::write_tile (int x, int y, int z, TypeDesc format,
 
 
 OIIO_PLUGIN_NAMESPACE_END
-
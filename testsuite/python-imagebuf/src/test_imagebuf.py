@@ -104,6 +104,9 @@ try:
     print "Interpolating bicubic 0.25,0.5 ->", b.interppixel_bicubic(1.0,0.5)
     print "Interpolating NDC bicubic 0.25,0.5 ->", b.interppixel_bicubic_NDC(0.25,0.5)
     print "The whole image is: ", b.get_pixels(oiio.TypeDesc.TypeFloat)
+    m = memoryview (b.localpixels())
+    print "Local pixels:", m.format, "strides", tuple(int(i) for i in m.strides), "first value", ord(m.tobytes()[0])
+    del m
     print ""
     print "Saving file..."
     b.write ("out.tif")
@@ -122,6 +125,9 @@ try:
                   array.array('H',[6554,32767,58982, 13107,32767,45874,
                                    19660,32767,52428, 26214,32767,39321]))
     write (b, "outarrayH.tif", oiio.UINT16)
+    b.set_pixels (oiio.ROI(0, 2, 0, 2, 0, 1, 0, 3),
+                  bytearray([0,0,0, 0,0,0, 0,0,0, 255,0,255]))
+    print "After set_pixels from a buffer, pixel 1,1 is", b.getpixel(1,1)
 
     # Test write and read of deep data
     # Let's try writing one